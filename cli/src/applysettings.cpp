@@ -23,6 +23,40 @@
 #include <common/src/output.h>
 #include <QJsonDocument>
 
+namespace
+{
+    // Parse the settings JSON parameter and build the RPC arguments.  Prints
+    // an error and throws if the parameters are not valid.
+    QJsonArray buildRpcArgs(const QStringList &params)
+    {
+        if(params.length() != 2)
+        {
+            errln() << "usage:" << params[0] << "<settings-json>";
+            throw Error{HERE, Error::Code::CliInvalidArgs};
+        }
+
+        // Parse the JSON payload and build the RPC arguments
+        QJsonParseError parseError;
+        auto doc = QJsonDocument::fromJson(params[1].toUtf8(), &parseError);
+        if(doc.isNull())
+        {
+            qWarning() << "JSON parse error:" << parseError.errorString();
+            qWarning() << "Unparseable JSON:" << params[1];
+            errln() << "Invalid JSON:" << parseError.errorString();
+            throw Error{HERE, Error::Code::CliInvalidArgs};
+        }
+
+        if(!doc.isObject())
+        {
+            qWarning() << "JSON is not object:" << params[1];
+            errln() << "JSON payload must be an object";
+            throw Error{HERE, Error::Code::CliInvalidArgs};
+        }
+
+        return QJsonArray{doc.object()};
+    }
+}
+
 void ApplySettingsCommand::printHelp(const QString &name)
 {
     outln() << "usage:" << name << "<settings-json>";
@@ -33,31 +67,11 @@ void ApplySettingsCommand::printHelp(const QString &name)
 
 int ApplySettingsCommand::exec(const QStringList &params, QCoreApplication &app)
 {
-    if(params.length() != 2)
-    {
-        errln() << "usage:" << params[0] << "<settings-json>";
-        throw Error{HERE, Error::Code::CliInvalidArgs};
-    }
-
-    // Parse the JSON payload and build the RPC arguments
-    QJsonParseError parseError;
-    auto doc = QJsonDocument::fromJson(params[1].toUtf8(), &parseError);
-    if(doc.isNull())
-    {
-        qWarning() << "JSON parse error:" << parseError.errorString();
-        qWarning() << "Unparseable JSON:" << params[1];
-        errln() << "Invalid JSON:" << parseError.errorString();
-        throw Error{HERE, Error::Code::CliInvalidArgs};
-    }
-
-    if(!doc.isObject())
-    {
-        qWarning() << "JSON is not object:" << params[1];
-        errln() << "JSON payload must be an object";
-        throw Error{HERE, Error::Code::CliInvalidArgs};
-    }
-
-    QJsonArray rpcArgs{doc.object()};
-    execOneShot(app, QStringLiteral("applySettings"), rpcArgs);
+    execOneShot(app, QStringLiteral("applySettings"), buildRpcArgs(params));
     return CliExitCode::Success;
 }
+
+auto ApplySettingsCommand::prepareBatch(const QStringList &params, CliClient &) -> BatchRpc
+{
+    return {QStringLiteral("applySettings"), buildRpcArgs(params)};
+}
@@ -29,6 +29,7 @@ class ApplySettingsCommand : public CliCommand
 public:
     virtual void printHelp(const QString &name) override;
     virtual int exec(const QStringList &params, QCoreApplication &app) override;
+    virtual BatchRpc prepareBatch(const QStringList &params, CliClient &client) override;
 };
 
 #endif
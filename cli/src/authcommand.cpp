@@ -67,6 +67,8 @@ void LoginCommand::printHelp(const QString &name)
 int LoginCommand::exec(const QStringList &params, QCoreApplication &app)
 {
     CliClient client;
+    client.connection().setPropertySubscriptions({{QStringLiteral("account"),
+        QJsonArray{QStringLiteral("loggedIn"), QStringLiteral("username")}}});
 
     if(params.size() < 2) {
         errln() << "Missing parameter: <login_file>";
@@ -0,0 +1,139 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("batchcommand.cpp")
+
+#include "batchcommand.h"
+#include "makecommand.h"
+#include "cliclient.h"
+#include <common/src/output.h>
+#include <QFile>
+#include <QProcess>
+#include <optional>
+#include <vector>
+
+void BatchCommand::printHelp(const QString &name)
+{
+    outln() << "usage:" << name << "[<file>]";
+    outln() << "Run commands from a file (or stdin if no file is given, or the file is \"-\").";
+    outln() << "Each line is one command with its parameters, such as \"set protocol wireguard\".";
+    outln() << "Empty lines and lines beginning with \"#\" are ignored.";
+    outln() << "Commands run in order over one connection to the daemon, and the batch stops";
+    outln() << "at the first command that fails (with that command's exit code).";
+    outln() << "Supported commands: get, set, applysettings, connect, disconnect, logout,";
+    outln() << "resetsettings";
+}
+
+int BatchCommand::exec(const QStringList &params, QCoreApplication &app)
+{
+    if(params.length() > 2)
+    {
+        errln() << "Usage:" << params[0] << "[<file>]";
+        throw Error{HERE, Error::Code::CliInvalidArgs};
+    }
+
+    QFile input;
+    bool opened{false};
+    if(params.length() < 2 || params[1] == QStringLiteral("-"))
+        opened = input.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+    else
+    {
+        input.setFileName(params[1]);
+        opened = input.open(QIODevice::ReadOnly | QIODevice::Text);
+    }
+    if(!opened)
+    {
+        errln() << "Unable to read commands:" << input.errorString();
+        throw Error{HERE, Error::Code::CliInvalidArgs};
+    }
+
+    // Read and split all the commands first, so unknown commands are found
+    // before anything is done
+    std::vector<QStringList> commands;
+    while(!input.atEnd())
+    {
+        const auto &line = QString::fromUtf8(input.readLine()).trimmed();
+        if(line.isEmpty() || line.startsWith('#'))
+            continue;
+        QStringList commandParams = QProcess::splitCommand(line);
+        if(commandParams.isEmpty())
+            continue;
+        getCommand(true, commandParams.front());   // Throws if unknown
+        commands.push_back(std::move(commandParams));
+    }
+    qInfo() << "Running batch of" << commands.size() << "commands";
+
+    CliClient client;
+    QObject localConnState{};
+    // Each command gets the full timeout, the batch as a whole could take much
+    // longer
+    std::optional<CliTimeout> timeout;
+    timeout.emplace(app);
+    Async<void> rpcResult;
+    std::size_t nextCommand{0};
+
+    // Run commands until one needs an RPC, then continue when it completes
+    std::function<void()> runCommands;
+    runCommands = [&]()
+    {
+        timeout.emplace(app);
+        while(nextCommand < commands.size())
+        {
+            const QStringList &commandParams = commands[nextCommand];
+            ++nextCommand;
+            qInfo() << "Batch command" << nextCommand << "-" << commandParams;
+            // Can't throw across a Qt signal invocation
+            try
+            {
+                CliCommand::BatchRpc rpc = getCommand(true, commandParams.front())
+                    .prepareBatch(commandParams, client);
+                if(rpc.method.isEmpty())
+                    continue;
+
+                rpcResult = client.connection().call(rpc.method, rpc.args)
+                    ->next(&localConnState, [&](const Error &error, const QJsonValue &)
+                    {
+                        if(error)
+                        {
+                            app.exit(traceRpcError(error));
+                            return;
+                        }
+                        // Continue after this callback returns - it's invoked
+                        // by rpcResult, which the next RPC will replace
+                        QMetaObject::invokeMethod(&localConnState, runCommands,
+                                                  Qt::QueuedConnection);
+                    });
+                return;
+            }
+            catch(const Error &error)
+            {
+                qWarning() << "Batch command" << nextCommand << "failed:" << error;
+                app.exit(mapErrorCode(error.code()));
+                return;
+            }
+        }
+
+        qInfo() << "Batch completed";
+        app.exit(CliExitCode::Success);
+    };
+
+    QObject::connect(&client, &CliClient::firstConnected, &localConnState, runCommands);
+
+    return app.exec();
+}
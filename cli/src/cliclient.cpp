@@ -21,10 +21,11 @@
 
 #include "cliclient.h"
 
-CliClient::CliClient()
+CliClient::CliClient(bool connectNow)
     : _connection{nullptr}
 {
-    _connection.connectToDaemon();
+    if(connectNow)
+        _connection.connectToDaemon();
 
     // Trace the state just for diagnostics
     QObject::connect(&_connection, &DaemonConnection::connectedChanged, this,
@@ -36,6 +37,14 @@ CliClient::CliClient()
                      &CliClient::checkFirstConnected);
 }
 
+QJsonObject CliClient::noPropertySubscriptions()
+{
+    // A group subscribed with 'false' receives nothing, and the client is
+    // subscribed to nothing else.  (Subscriptions can't just be empty, that
+    // means to receive everything.)
+    return {{QStringLiteral("state"), false}};
+}
+
 void CliClient::checkFirstConnected(bool connected)
 {
     if(connected)
@@ -31,10 +31,21 @@ class CliClient : public QObject
     Q_OBJECT
 
 public:
-    CliClient();
+    // By default, the connection is started immediately.  Commands that might
+    // not need a connection can pass connectNow=false, then call
+    // connectToDaemon() if needed.
+    explicit CliClient(bool connectNow = true);
+
+public:
+    // Property subscriptions for commands that only issue RPCs and don't use
+    // any daemon properties.  The daemon still sends its (empty) initial data,
+    // which establishes the connection, so the command doesn't have to
+    // receive the entire daemon state before it can make its RPC.
+    static QJsonObject noPropertySubscriptions();
 
 public:
     DaemonConnection &connection() {return _connection;}
+    void connectToDaemon() {_connection.connectToDaemon();}
 
 private:
     void checkFirstConnected(bool connected);
@@ -144,6 +144,8 @@ QJsonValue CliCommand::execOneShot(QCoreApplication &app,
                                    const QJsonArray &rpcArgs)
 {
     CliClient client;
+    // One-shot RPCs don't use any daemon properties
+    client.connection().setPropertySubscriptions(CliClient::noPropertySubscriptions());
 
     // We don't have to reference this later, just hang onto the Async here so
     // it's kept alive until either it completes or we abort.
@@ -187,6 +189,12 @@ QJsonValue CliCommand::execOneShot(QCoreApplication &app,
     return rpcValue;
 }
 
+auto CliCommand::prepareBatch(const QStringList &params, CliClient &) -> BatchRpc
+{
+    errln() << "Command can't be used in a batch:" << params[0];
+    throw Error{HERE, Error::Code::CliInvalidArgs};
+}
+
 void TrivialRpcCommand::printHelp(const QString &)
 {
     outln() << _description;
@@ -200,3 +208,9 @@ int TrivialRpcCommand::exec(const QStringList &params, QCoreApplication &app)
     execOneShot(app, _method, {});
     return CliExitCode::Success;
 }
+
+auto TrivialRpcCommand::prepareBatch(const QStringList &params, CliClient &) -> BatchRpc
+{
+    checkNoParams(params);
+    return {_method, {}};
+}
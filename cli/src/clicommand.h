@@ -26,6 +26,8 @@
 #include <QElapsedTimer>
 #include <chrono>
 
+class CliClient;
+
 // Exit codes that can be returned from the CLI app.  Exit codes are limited to
 // the range 0-127, so we can't return any arbitrary Error::Code value.
 //
@@ -119,6 +121,24 @@ public:
     // params always contains at least the command name (ensured by
     // makeCommand() / cliMain().)
     virtual int exec(const QStringList &params, QCoreApplication &app) = 0;
+
+    // The daemon RPC issued by a command when it's run as part of a batch (see
+    // BatchCommand).
+    struct BatchRpc
+    {
+        // Empty if the command doesn't need an RPC (it just printed a value)
+        QString method;
+        QJsonArray args;
+    };
+
+    // Prepare a command to run as part of a batch.  'client' is already
+    // connected and has received the daemon's state.  Commands that only
+    // print values can print them here and return an empty method; otherwise
+    // this returns the RPC to issue.  Like exec(), this can throw an Error to
+    // fail with a specific exit code.
+    //
+    // The default implementation throws, most commands can't be batched.
+    virtual BatchRpc prepareBatch(const QStringList &params, CliClient &client);
 };
 
 // Model of a trivial RPC command with no params and no result
@@ -131,6 +151,7 @@ public:
 public:
     virtual void printHelp(const QString &name) override;
     virtual int exec(const QStringList &params, QCoreApplication &app) override;
+    virtual BatchRpc prepareBatch(const QStringList &params, CliClient &client) override;
 private:
     QString _method, _description;
 };
@@ -88,6 +88,7 @@ int DedicatedIpCommand::execRemove(const QStringList &params, QCoreApplication &
     // Like "set", we can't implement this with execOneShot because we need the
     // daemon state to determine the real ID of the specified region.
     CliClient client;
+    client.connection().setPropertySubscriptions(GetSetValue::locationSubscriptions());
     CliTimeout timeout{app};
     QObject localConnState{};
     Async<void> removeResult;
@@ -148,6 +148,12 @@ namespace GetSetValue
         qWarning() << "No match found for specified location:" << location;
         return {};
     }
+
+    QJsonObject locationSubscriptions()
+    {
+        return {{QStringLiteral("state"), QJsonArray{QStringLiteral("availableLocations"),
+            QStringLiteral("regionsMetadata"), QStringLiteral("groupedLocations")}}};
+    }
 }
 
 namespace
@@ -452,6 +458,88 @@ namespace
         }
     }
 
+    // Get the daemon property subscriptions needed to render a type, so the
+    // daemon only sends the properties that are actually used.
+    QJsonObject typeSubscriptions(const QString &type)
+    {
+        auto props = [](const QString &group, std::initializer_list<QString> names)
+        {
+            QJsonArray namesArray;
+            for(const auto &name : names)
+                namesArray.push_back(name);
+            return QJsonObject{{group, namesArray}};
+        };
+
+        if(type == GetSetType::connectionState)
+            return props(QStringLiteral("state"), {QStringLiteral("connectionState")});
+        if(type == GetSetType::debugLogging)
+            return props(QStringLiteral("settings"), {QStringLiteral("debugLogging")});
+        if(type == GetSetType::portForward)
+            return props(QStringLiteral("state"), {QStringLiteral("forwardedPort")});
+        if(type == GetSetType::requestPortForward)
+            return props(QStringLiteral("settings"), {QStringLiteral("portForward")});
+        if(type == GetSetType::protocol)
+            return props(QStringLiteral("settings"), {QStringLiteral("method")});
+        if(type == GetSetType::allowLAN)
+            return props(QStringLiteral("settings"), {QStringLiteral("allowLAN")});
+        if(type == GetSetType::vpnIp)
+            return props(QStringLiteral("state"), {QStringLiteral("externalVpnIp")});
+        if(type == GetSetType::pubIp)
+            return props(QStringLiteral("state"), {QStringLiteral("externalIp")});
+        // Locations are rendered using the regions metadata and the country
+        // groups
+        if(type == GetSetType::region)
+        {
+            return props(QStringLiteral("state"), {QStringLiteral("vpnLocations"),
+                QStringLiteral("regionsMetadata"), QStringLiteral("groupedLocations")});
+        }
+        if(type == GetSetType::regions)
+        {
+            return props(QStringLiteral("state"), {QStringLiteral("dedicatedIpLocations"),
+                QStringLiteral("regionsMetadata"), QStringLiteral("groupedLocations")});
+        }
+        if(type == GetSetType::daemonState)
+            return {{QStringLiteral("state"), true}};
+        if(type == GetSetType::daemonSettings)
+            return {{QStringLiteral("settings"), true}};
+        if(type == GetSetType::daemonData)
+            return {{QStringLiteral("data"), true}};
+        if(type == GetSetType::daemonAccount)
+            return {{QStringLiteral("account"), true}};
+        // Unknown - receive everything
+        return {};
+    }
+
+    // Print the value for 'get'
+    void printGetValue(CliClient &client, const QString &type)
+    {
+        // Handle types only supported by 'get' specifically
+        if(type == GetSetType::regions)
+        {
+            // Print locations in the default order they're listed in the
+            // client - DIP locations by latency, then normal locations by
+            // country and latency
+            outln() << GetSetValue::locationAuto;
+
+            const auto &dedicatedIpLocations = client.connection().state["dedicatedIpLocations"].toArray();
+            for(const auto &dip : dedicatedIpLocations)
+            {
+                outln() << ValuePrinter::renderLocation(dip.toObject(), client.connection().state);
+            }
+
+            const auto &groupedLocations = client.connection().state["groupedLocations"].toArray();
+            for(const auto &country : groupedLocations)
+            {
+                for(const auto &location : country[QStringLiteral("locations")].toArray())
+                {
+                    outln() << ValuePrinter::renderLocation(location.toObject(), client.connection().state);
+                }
+            }
+        }
+        else
+            outln() << ValuePrinter::renderValue(client, type);
+    }
+
     // Check get/monitor parameters.  Prints an error and throws if the
     // parameters are not valid
     void checkParams(const QStringList &params, const std::map<QString, SupportedType> &types)
@@ -481,44 +569,37 @@ int GetCommand::exec(const QStringList &params, QCoreApplication &app)
 {
     checkParams(params, _getSupportedTypes);
 
-    CliClient client;
+    CliClient client{false};
+
+    // Everything 'get' prints comes from the state and settings, so if the
+    // daemon's state mirror is available, there's no need to connect at all.
+    if(client.connection().readStateMirror())
+    {
+        printGetValue(client, params[1]);
+        return CliExitCode::Success;
+    }
+
+    client.connection().setPropertySubscriptions(typeSubscriptions(params[1]));
+    client.connectToDaemon();
     CliTimeout timeout{app};
     QObject localConnState{};
 
     QObject::connect(&client, &CliClient::firstConnected, &localConnState, [&]()
     {
-        // Handle types only supported by 'get' specifically
-        if(params[1] == GetSetType::regions)
-        {
-            // Print locations in the default order they're listed in the
-            // client - DIP locations by latency, then normal locations by
-            // country and latency
-            outln() << GetSetValue::locationAuto;
-
-            const auto &dedicatedIpLocations = client.connection().state["dedicatedIpLocations"].toArray();
-            for(const auto &dip : dedicatedIpLocations)
-            {
-                outln() << ValuePrinter::renderLocation(dip.toObject(), client.connection().state);
-            }
-
-            const auto &groupedLocations = client.connection().state["groupedLocations"].toArray();
-            for(const auto &country : groupedLocations)
-            {
-                for(const auto &location : country[QStringLiteral("locations")].toArray())
-                {
-                    outln() << ValuePrinter::renderLocation(location.toObject(), client.connection().state);
-                }
-            }
-        }
-        else
-            outln() << ValuePrinter::renderValue(client, params[1]);
-
+        printGetValue(client, params[1]);
         app.exit(CliExitCode::Success);
     });
 
     return app.exec();
 }
 
+auto GetCommand::prepareBatch(const QStringList &params, CliClient &client) -> BatchRpc
+{
+    checkParams(params, _getSupportedTypes);
+    printGetValue(client, params[1]);
+    return {};
+}
+
 
 void MonitorCommand::printHelp(const QString &name)
 {
@@ -534,6 +615,7 @@ int MonitorCommand::exec(const QStringList &params, QCoreApplication &app)
     checkParams(params, _monitorSupportedTypes);
 
     CliClient client;
+    client.connection().setPropertySubscriptions(typeSubscriptions(params[1]));
     ValuePrinter printer{client, params[1]};
 
     return app.exec();
@@ -552,6 +634,7 @@ int DumpCommand::exec(const QStringList &params, QCoreApplication &app)
     checkParams(params, _dumpSupportedTypes);
 
     CliClient client;
+    client.connection().setPropertySubscriptions(typeSubscriptions(params[1]));
     CliTimeout timeout{app};
     QObject localConnState{};
     QObject::connect(&client, &CliClient::firstConnected, &localConnState, [&]()
@@ -40,6 +40,8 @@ namespace GetSetValue
     extern const QString locationAuto;
     QString getRegionCliName(const QJsonObject &location);
     QString matchSpecifiedLocation(const DaemonState &state, const QString &location);
+    // Daemon property subscriptions needed by matchSpecifiedLocation()
+    QJsonObject locationSubscriptions();
 }
 
 // Implements the "get" command - gets a value from daemon state/settings
@@ -49,6 +51,7 @@ class GetCommand : public CliCommand
 public:
     virtual void printHelp(const QString &name) override;
     virtual int exec(const QStringList &params, QCoreApplication &app) override;
+    virtual BatchRpc prepareBatch(const QStringList &params, CliClient &client) override;
 };
 
 // "monitor" is similar to "get" - it displays specific values supported by the
@@ -22,6 +22,7 @@
 #include "makecommand.h"
 #include <common/src/output.h>
 #include "applysettings.h"
+#include "batchcommand.h"
 #include "getcommand.h"
 #include "setcommand.h"
 #include "brand.h"
@@ -30,6 +31,8 @@
 #include "dedicatedipcommand.h"
 #include "brand.h"
 #include "backgroundcommand.h"
+#include "profilecommand.h"
+#include "wakeupscommand.h"
 
 const QString connectDescription =
     QStringLiteral(
@@ -63,6 +66,7 @@ const CommandMap stableCommands
 const CommandMap unstableCommands
 {
     {"applysettings", std::make_shared<ApplySettingsCommand>()},
+    {"batch", std::make_shared<BatchCommand>()},
 #ifdef Q_OS_WIN
     // Windows only - used to hint to the daemon to re-check driver installation
     // states that do not provide change notifications.
@@ -72,6 +76,8 @@ const CommandMap unstableCommands
     // crash on shutdown.
     {"checkdriver", std::make_shared<TrivialRpcCommand>("checkDriverState", checkDriverDescription)},
 #endif
+    {"profile", std::make_shared<ProfileCommand>()},
+    {"wakeups", std::make_shared<WakeupsCommand>()},
     {"watch", std::make_shared<WatchCommand>()},
     {"dump", std::make_shared<DumpCommand>()}
 };
@@ -0,0 +1,67 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("profilecommand.cpp")
+
+#include "profilecommand.h"
+#include <common/src/output.h>
+#include "brand.h"
+
+void ProfileCommand::printHelp(const QString &name)
+{
+    outln() << "usage:" << name << "start [interval_ms]";
+    outln() << "usage:" << name << "stop";
+    outln() << "Start or stop sampling the " BRAND_SHORT_NAME " daemon's CPU usage.";
+    outln() << "Samples are taken every interval_ms of CPU time (default 10).  Debug logging must be enabled.";
+    outln() << "'stop' writes the profile and prints its path; the last profile is included in debug reports.";
+}
+
+int ProfileCommand::exec(const QStringList &params, QCoreApplication &app)
+{
+    if(params.length() >= 2 && params.length() <= 3 && params[1] == QStringLiteral("start"))
+    {
+        QJsonArray rpcArgs;
+        if(params.length() == 3)
+        {
+            bool valid{false};
+            qint64 intervalMs = params[2].toLongLong(&valid);
+            if(!valid || intervalMs <= 0)
+            {
+                errln() << "Invalid interval:" << params[2];
+                throw Error{HERE, Error::Code::CliInvalidArgs};
+            }
+            rpcArgs.push_back(intervalMs);
+        }
+        execOneShot(app, QStringLiteral("startProfiler"), rpcArgs);
+        return CliExitCode::Success;
+    }
+
+    if(params.length() == 2 && params[1] == QStringLiteral("stop"))
+    {
+        QJsonValue profilePath = execOneShot(app, QStringLiteral("stopProfiler"), {});
+        if(profilePath.isString())
+            outln() << profilePath.toString();
+        else
+            errln() << "Profiler was not running";
+        return CliExitCode::Success;
+    }
+
+    errln() << "Usage:" << params[0] << "<start [interval_ms]|stop>";
+    throw Error{HERE, Error::Code::CliInvalidArgs};
+}
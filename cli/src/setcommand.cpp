@@ -94,6 +94,23 @@ namespace
         Q_ASSERT(false);
         throw Error{HERE, Error::Code::CliInvalidArgs};
     }
+
+    // Check 'set' parameters.  Prints an error and throws if the parameters
+    // are not valid
+    void checkParams(const QStringList &params)
+    {
+        if(params.length() != 3)
+        {
+            errln() << "Usage:" << params[0] << "<type> <value>";
+            throw Error{HERE, Error::Code::CliInvalidArgs};
+        }
+
+        if(_setSupportedTypes.count(params[1]) == 0)
+        {
+            errln() << "Unknown type:" << params[1];
+            throw Error{HERE, Error::Code::CliInvalidArgs};
+        }
+    }
 }
 
 void SetCommand::printHelp(const QString &name)
@@ -108,21 +125,17 @@ void SetCommand::printHelp(const QString &name)
 
 int SetCommand::exec(const QStringList &params, QCoreApplication &app)
 {
-    if(params.length() != 3)
-    {
-        errln() << "Usage:" << params[0] << "<type> <value>";
-        throw Error{HERE, Error::Code::CliInvalidArgs};
-    }
-
-    if(_setSupportedTypes.count(params[1]) == 0)
-    {
-        errln() << "Unknown type:" << params[1];
-        throw Error{HERE, Error::Code::CliInvalidArgs};
-    }
+    checkParams(params);
 
     // 'set' isn't implemented with a one-shot RPC because we need the daemon
-    // state to validate the location choice before creating the RPC payload
+    // state to validate the location choice before creating the RPC payload.
+    // Only receive the properties needed for that, other types just need the
+    // connection.
     CliClient client;
+    if(params[1] == GetSetType::region)
+        client.connection().setPropertySubscriptions(GetSetValue::locationSubscriptions());
+    else
+        client.connection().setPropertySubscriptions(CliClient::noPropertySubscriptions());
     CliTimeout timeout{app};
     QObject localConnState{};
 
@@ -159,3 +172,9 @@ int SetCommand::exec(const QStringList &params, QCoreApplication &app)
 
     return app.exec();
 }
+
+auto SetCommand::prepareBatch(const QStringList &params, CliClient &client) -> BatchRpc
+{
+    checkParams(params);
+    return {QStringLiteral("applySettings"), buildRpcArgs(client, params)};
+}
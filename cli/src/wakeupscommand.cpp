@@ -0,0 +1,68 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("wakeupscommand.cpp")
+
+#include "wakeupscommand.h"
+#include <common/src/output.h>
+#include "brand.h"
+#include <algorithm>
+#include <vector>
+
+void WakeupsCommand::printHelp(const QString &name)
+{
+    outln() << "usage:" << name;
+    outln() << "Print the wakeups and CPU time used by each subsystem of the " BRAND_SHORT_NAME " daemon since it started.";
+    outln() << "Subsystems are sorted by wakeups, highest first.";
+}
+
+int WakeupsCommand::exec(const QStringList &params, QCoreApplication &app)
+{
+    checkNoParams(params);
+
+    QJsonObject totals = execOneShot(app, QStringLiteral("getWakeupAccounting"), {}).toObject();
+
+    struct Row
+    {
+        QString tag;
+        qint64 wakeups;
+        double cpuMs;
+    };
+    std::vector<Row> rows;
+    rows.reserve(totals.size());
+    int tagWidth{0};
+    for(auto itTag = totals.begin(); itTag != totals.end(); ++itTag)
+    {
+        QJsonObject tagTotals = itTag.value().toObject();
+        rows.push_back({itTag.key(), tagTotals.value(QStringLiteral("wakeups")).toInteger(),
+                        tagTotals.value(QStringLiteral("cpuMs")).toDouble()});
+        tagWidth = std::max(tagWidth, static_cast<int>(itTag.key().size()));
+    }
+    std::sort(rows.begin(), rows.end(),
+        [](const Row &first, const Row &second){return first.wakeups > second.wakeups;});
+
+    outln() << QStringLiteral("subsystem").leftJustified(tagWidth) << "   wakeups      cpu ms";
+    for(const auto &row : rows)
+    {
+        outln() << row.tag.leftJustified(tagWidth)
+            << QString::number(row.wakeups).rightJustified(10)
+            << QString::number(row.cpuMs, 'f', 1).rightJustified(11);
+    }
+    return CliExitCode::Success;
+}
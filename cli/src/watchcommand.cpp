@@ -40,6 +40,20 @@ public:
                 &JsonChangePrinter::printChange);
     }
 
+public:
+    // Daemon property subscriptions for all groups, excluding the blacklist
+    static QJsonObject subscriptions()
+    {
+        QJsonArray excluded;
+        for(const auto &propName : propertyBlacklist)
+            excluded.push_back(propName);
+        QJsonObject groupSubscription{{QStringLiteral("exclude"), excluded}};
+        return {{QStringLiteral("data"), groupSubscription},
+                {QStringLiteral("account"), groupSubscription},
+                {QStringLiteral("settings"), groupSubscription},
+                {QStringLiteral("state"), groupSubscription}};
+    }
+
 public:
     void printChange(const QString &propName)
     {
@@ -85,6 +99,8 @@ int WatchCommand::exec(const QStringList &params, QCoreApplication &app)
     checkNoParams(params);
 
     CliClient client;
+    // Don't receive the blacklisted properties at all
+    client.connection().setPropertySubscriptions(JsonChangePrinter::subscriptions());
 
     QObject localConnState{};
     JsonChangePrinter data{client.connection().data, QStringLiteral("data")};
@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 import QtQuick 2.0
+import "../daemon"
 // ClientUIState contains state controlled by the UI QML code.  This is state
 // that would otherwise be held in local properties, but is instead stored here
 // to preserve it when the client UI is destroyed and recreated.
@@ -35,6 +36,9 @@ QtObject {
     //   before the dashboard loaded (even if the app was launched in quiet
     //   mode)
     property bool shown: false
+    // The daemon scales back its periodic work on battery power when no
+    // dashboard is shown
+    onShownChanged: Daemon.notifyClientVisible(shown)
 
     // Scroll positions for dashboard pages; held here since the pages are
     // unloaded when not visible.
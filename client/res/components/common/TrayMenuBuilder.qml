@@ -301,11 +301,14 @@ Item {
       wSettings.showSettings()
       break
     case 'show-changelog':
-      wChangeLog.show()
-      wChangeLog.raise()
+      var changelogWindow = wChangeLogLoader.load()
+      if(!changelogWindow)
+        break
+      changelogWindow.show()
+      changelogWindow.raise()
       if(Qt.platform.os !== 'linux')
       {
-        wChangeLog.requestActivate()
+        changelogWindow.requestActivate()
       }
       break
     case 'toggle-debug-logging':
@@ -19,16 +19,18 @@
 import QtQuick 2.9
 import PIA.NativeHelpers 1.0
 
-// Wrapper to dynamically load a DecoratedWindow the first time it is shown.
+// Wrapper to dynamically load a DecoratedWindow the first time it is needed.
 // Provides an open() method that either loads and displays the window, or
-// re-displays the window if it's been shown before.
+// re-displays the window if it's been shown before.  load() loads the window
+// without showing it, for windows that need to be set up before they're
+// shown.
 //
 // The window is shown with its open() method (DecoratedWindow provides such a
 // method for most PIA windows).
 //
-// Currently there's no way to unload a window, this is currently only used for
-// Dev Tools, which is not normally used by most users (and adds a significant
-// amount of time to the initial load due to TextArea layout processing).
+// Currently there's no way to unload a window.  This is used for windows that
+// most users rarely open (Dev Tools, the changelog, and the quick tour), so
+// they don't add to the initial load time.
 QtObject {
   id: windowLoader
 
@@ -42,33 +44,29 @@ QtObject {
   property Loader loaderProp: Loader {
     id: loader
     active: false // Initially not active, loaded when needed
-    onLoaded: {
-      loader.item.open()
-    }
   }
 
-  // The loaded window, once it has been loaded by open()
+  // The loaded window, once it has been loaded by open() or load()
   property alias window: loader.item
 
-  function open() {
-    switch(loader.status) {
-      case Loader.Null:
-        // First time being shown, activate to load the component.  onLoaded()
-        // will show after the load completes
-        console.info('Loading ' + objectName)
-        loader.active = true
-        break
-      case Loader.Ready:
-        console.info('Already loaded ' + objectName + ' - show again')
-        loader.item.open()
-        break
-      case Loader.Loading:
-        // Nothing to do, already loading it, it'll be shown by onLoaded()
-        console.info('Currently loading ' + objectName + ' - ignore additional request')
-        break
-      case Loader.Error:
-        console.warn('Error occurred loading ' + objectName + ' - can\'t show it')
-        break
+  // Load the window if it hasn't been loaded yet, and return it.  Returns
+  // null if the window couldn't be loaded.
+  function load() {
+    if(!loader.active) {
+      console.info('Loading ' + objectName)
+      // The Loader is synchronous, so the window is ready after this
+      loader.active = true
+    }
+    if(loader.status !== Loader.Ready) {
+      console.warn('Error occurred loading ' + objectName + ' - can\'t show it')
+      return null
     }
+    return loader.item
+  }
+
+  function open() {
+    var loadedWindow = load()
+    if(loadedWindow)
+      loadedWindow.open()
   }
 }
@@ -27,6 +27,8 @@ import "../../settings/stores"
 import "qrc:/javascript/keyutil.js" as KeyUtil
 import "qrc:/javascript/util.js" as Util
 import PIA.NativeAcc 1.0 as NativeAcc
+import PIA.NativeClient 1.0
+import PIA.RegionListModel 1.0
 
 // RegionListView is used to select a region from the list of available regions.
 // It's used to select the VPN region, as well as the Shadowsocks region.
@@ -228,11 +230,11 @@ Rectangle {
         }
         Repeater {
           id: regionsRepeater
-          model: displayRegionsArray
+          model: displayRegionsModel
           delegate: RegionDelegate {
-            region: modelData.region
-            regionCountry: modelData.regionCountry
-            regionChildren: modelData.regionChildren
+            region: model.region
+            regionCountry: model.regionCountry
+            regionChildren: model.regionChildren
             portForwardEnabled: regionListView.portForwardEnabled
             serviceLocations: regionListView.serviceLocations
             canFavorite: regionListView.canFavorite
@@ -458,70 +460,10 @@ Rectangle {
     return filteredDedicatedIps
   }
 
-  // Filter the 'countries' object from DaemonState.groupedLocations,
-  // which is an array of CountryLocations (which has a 'locations' property,
-  // which is an array of locations).
-  //
-  // - Single regions or regions in a group are included if the region name
-  //   contains the search string
-  // - An entire group is included if the group name contains the search string
-  function filterCountryLocations() {
-    var countries = Daemon.state.groupedLocations
-    if(!searchTerm && !regionFilter)
-      return countries
-
-    var filteredCountries = []
-    for(var i=0; i<countries.length; ++i) {
-      // Filter the locations in this country using the region filter.  This
-      // could cause a country group to become a single location (which affects
-      // the search term matching below)
-      var filteredLocations = countries[i].locations
-      if(regionFilter)
-        filteredLocations = filteredLocations.filter(regionFilter)
-
-      if(filteredLocations.length <= 0)
-        continue  // Nothing to display in this country
-
-      // If the country contains exactly one region, check the country name.
-      // Note that this still considers locations eliminated by regionFilter,
-      // e.g. CA Vancouver is the only CA region with Shadowsocks but we still
-      // display it as "CA Vancouver", not "Canada", since there are other CA
-      // regions in general.
-      //
-      // For single-region countries, don't look at the city name (nested name),
-      // since we do not display it.
-      if(!Daemon.state.shouldNestCountry(countries[i].code)) {
-        if(matchesSearchTerm(Client.getRegionCountryName(filteredLocations[0].id)))
-          filteredCountries.push({code: countries[i].code, locations: filteredLocations})
-      }
-      // The country contains more than one region.  If the country name
-      // matches, include everything.
-      else if(matchesSearchTerm(Client.getCountryName(countries[i].code)))
-        filteredCountries.push({code: countries[i].code, locations: filteredLocations})
-      // The country has more than one region, and the country name doesn't
-      // match.  Filter the individual regions.
-      else {
-        var filteredRegions = filteredLocations.filter(function(loc) {
-          return matchesSearchTerm(Client.getRegionNestedName(loc.id))
-        })
-        // If at least one region matched, include the country with the filtered
-        // regions
-        if(filteredRegions.length > 0)
-          filteredCountries.push({code: countries[i].code, locations: filteredRegions})
-      }
-    }
-
-    return filteredCountries
-  }
-
   function localeCompareRegions(first, second) {
     return first.localeCompare(second, Client.state.activeLanguage.locale)
   }
 
-  function countrySortName(country) {
-    return Client.getCountryName(country.code).toLowerCase()
-  }
-
   function sortLocations(locations) {
     var sortedLocations = locations.slice()
     sortedLocations.sort(function(first, second) {
@@ -541,60 +483,6 @@ Rectangle {
     return sortedLocations
   }
 
-  // Sort the (possibly filtered) country locations by name.
-  function sortCountriesByName(countries) {
-    // Sort the country groups by either the country name or single-region name.
-    // Sort a copy of the array because this could be the actual array from
-    // DaemonState.
-    countries = countries.slice()
-    countries.sort(function(first, second) {
-      return localeCompareRegions(countrySortName(first), countrySortName(second))
-    })
-
-    // Sort each country's regions
-    for(var i=0; i<countries.length; ++i) {
-      // Create new country objects, because these could still be the actual
-      // objects from DaemonState.  sortLocations() creates a new array with the
-      // sorted locations.
-      countries[i] = {code: countries[i].code, locations: sortLocations(countries[i].locations)}
-    }
-
-    return countries
-  }
-
-  // Build an array of regions from the country map.
-  function buildRegionArray(countries) {
-    var result = []
-    for(var i=0; i<countries.length; ++i) {
-      var rlist = countries[i].locations
-      var countryId = countries[i].code
-      // Single location
-      if (rlist.length === 1) {
-        result.push({
-                      region: rlist[0],
-                      regionCountry: countryId,
-                      regionChildren: []
-                    })
-      }
-      // Group of locations in a country
-      else {
-        var subregions = rlist.map(function(rgn) {
-          return {
-            subregion: rgn
-          }});
-
-        // Country groups have a null region (they don't represent a single
-        // location).
-        result.push({
-                      region: null,
-                      regionCountry: countryId,
-                      regionChildren: subregions
-                    })
-      }
-    }
-    return result
-  }
-
   property var displayDedicatedIpsArray: {
     // Get the filtered dedicated IP locations
     var dedicatedIps = filterDedicatedIps()
@@ -606,25 +494,15 @@ Rectangle {
     return dedicatedIps
   }
 
-  // The array of country groups and single regions used as the model for the
-  // regions repeater.
-  //
-  // This consists of objects with the following properties:
-  // - region: null for a country group, or a Location object for a single region
-  // - regionCountry: country code for the group or location
-  // - regionChildren: array of {subregion: <Location>} objects for a country
-  //   group, or empty array for a single region
-  property var displayRegionsArray: {
-    // Get the filtered country locations
-    var countries = filterCountryLocations()
-
-    // If sorting by name, re-sort the countries and their locations.
-    // (If sorting by latency, Daemon has already sorted them.)
-    if(sortKey.currentValue === "name")
-      countries = sortCountriesByName(countries)
-
-    // Build the actual model into a list with children
-    return buildRegionArray(countries)
+  // The country groups and single regions used as the model for the regions
+  // repeater.  See RegionListModel for the roles provided.
+  RegionListModel {
+    id: displayRegionsModel
+    groupedLocations: Daemon.state.groupedLocations
+    searchTerm: regionListView.searchTerm
+    sortKey: regionListView.sortKey.currentValue
+    regionFilter: regionListView.regionFilter || null
+    clientState: NativeClient.state
   }
 
   // Build a flat tabular representation of the contents that we use for
@@ -667,7 +545,7 @@ Rectangle {
                 regionItem: regionAuto})
 
     // The accessibility table is built from the actual items that represent the
-    // regions, not the displayRegionsArray, so it can include references to the
+    // regions, not displayRegionsModel, so it can include references to the
     // row items.  These are used to build the accessibility elements in
     // NativeAcc.Table.rows.
     //
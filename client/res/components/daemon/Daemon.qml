@@ -129,6 +129,12 @@ QtObject {
   function getCountryBestRegion(countryCode) {
     call ("getCountryBestRegion", arguments);
   }
+  function getThroughputHistory(resolution, since) {
+    call ("getThroughputHistory", arguments);
+  }
+  function notifyClientVisible(visible) {
+    call("notifyClientVisible", arguments);
+  }
   function writeDiagnostics () {
     call("writeDiagnostics", arguments);
   }
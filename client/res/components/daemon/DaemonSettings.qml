@@ -26,6 +26,7 @@ QtObject {
   // Settings
   readonly property string lastUsedVersion: NativeDaemon.settings.lastUsedVersion
   readonly property string location: NativeDaemon.settings.location
+  readonly property string autoLocationMode: NativeDaemon.settings.autoLocationMode
   readonly property bool includeGeoOnly: NativeDaemon.settings.includeGeoOnly
   readonly property string method: NativeDaemon.settings.method
   readonly property string protocol: NativeDaemon.settings.protocol
@@ -41,6 +42,7 @@ QtObject {
   readonly property int remotePortTCP: NativeDaemon.settings.remotePortTCP
   readonly property int mtu: NativeDaemon.settings.mtu
   readonly property string cipher: NativeDaemon.settings.cipher
+  readonly property string openvpnPerformanceProfile: NativeDaemon.settings.openvpnPerformanceProfile
   readonly property string windowsIpMethod: NativeDaemon.settings.windowsIpMethod
   readonly property string proxyType: NativeDaemon.settings.proxyType
   readonly property bool proxyEnabled: NativeDaemon.settings.proxyEnabled
@@ -58,7 +60,11 @@ QtObject {
   readonly property var splitTunnelRules: NativeDaemon.settings.splitTunnelRules
   readonly property var bypassSubnets: NativeDaemon.settings.bypassSubnets
   readonly property bool wireguardUseKernel: NativeDaemon.settings.wireguardUseKernel
+  readonly property bool wireguardGoHighThroughput: NativeDaemon.settings.wireguardGoHighThroughput
+  readonly property bool wireguardSeamlessSwitch: NativeDaemon.settings.wireguardSeamlessSwitch
+  readonly property bool wireguardFastResume: NativeDaemon.settings.wireguardFastResume
   readonly property int wireguardPingTimeout: NativeDaemon.settings.wireguardPingTimeout
+  readonly property bool warmStandby: NativeDaemon.settings.warmStandby
   readonly property bool persistDaemon: NativeDaemon.settings.persistDaemon
   readonly property int sessionCount: NativeDaemon.settings.sessionCount
   readonly property int successfulSessionCount: NativeDaemon.settings.successfulSessionCount
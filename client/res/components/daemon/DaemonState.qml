@@ -44,9 +44,13 @@ QtObject {
   readonly property var regionsMetadata: NativeDaemon.state.regionsMetadata
   readonly property var groupedLocations: NativeDaemon.state.groupedLocations
   readonly property var dedicatedIpLocations: NativeDaemon.state.dedicatedIpLocations
+  readonly property var latencyStatistics: NativeDaemon.state.latencyStatistics
   readonly property var openvpnUdpPortChoices: NativeDaemon.state.openvpnUdpPortChoices
   readonly property var openvpnTcpPortChoices: NativeDaemon.state.openvpnTcpPortChoices
   readonly property var intervalMeasurements: NativeDaemon.state.intervalMeasurements
+  readonly property var connectionTimeline: NativeDaemon.state.connectionTimeline
+  readonly property var lastFirewallApply: NativeDaemon.state.lastFirewallApply
+  readonly property var totalFirewallApply: NativeDaemon.state.totalFirewallApply
   readonly property double connectionTimestamp: NativeDaemon.state.connectionTimestamp
   readonly property var overridesFailed: NativeDaemon.state.overridesFailed
   readonly property var overridesActive: NativeDaemon.state.overridesActive
@@ -72,6 +76,7 @@ QtObject {
   readonly property bool killedClient: NativeDaemon.state.killedClient
   readonly property double hnsdFailing: NativeDaemon.state.hnsdFailing
   readonly property double hnsdSyncFailure: NativeDaemon.state.hnsdSyncFailure
+  readonly property double hnsdSyncHeight: NativeDaemon.state.hnsdSyncHeight
   readonly property string originalGatewayIp: NativeDaemon.state.originalGatewayIp
   readonly property string originalInterfaceIp: NativeDaemon.state.originalInterfaceIp
   readonly property string originalInterface: NativeDaemon.state.originalInterface
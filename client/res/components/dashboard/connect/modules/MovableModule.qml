@@ -42,6 +42,11 @@ Module {
   // Whether to show the bookmark icon (safe alias for moduleData.showBookmarks)
   readonly property bool showBookmark: moduleData ? moduleData.showBookmarks : false
 
+  // Whether the dashboard window is currently shown.  Modules that display
+  // frequently-changing daemon state (or tick timers) stop updating while the
+  // dashboard is hidden; nothing is displayed then anyway.
+  readonly property bool windowVisible: Window.window ? Window.window.visible : false
+
   // Switch the list that this module is in (used to implement bookmark button)
   function switchModuleList() {
     var primaries = Client.settings.primaryModules
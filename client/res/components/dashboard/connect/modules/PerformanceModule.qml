@@ -72,12 +72,12 @@ MovableModule {
     id: durationTimer
     interval: 1000
     repeat: true
-    running: Daemon.state.connectionTimestamp > 0
+    running: windowVisible && Daemon.state.connectionTimestamp > 0
     onTriggered: currentTimestamp = NativeHelpers.getMonotonicTime()
     onRunningChanged: {
-      // When the timer starts (due to the connection being established, or due
-      // to loading this component when the connection is already up),
-      // immediately set the current timestamp so we show the correct time
+      // When the timer starts (due to the connection being established, the
+      // dashboard being shown, or due to loading this component when the
+      // connection is already up), immediately set the current timestamp so we show the correct time
       // before the timer elapses the first time.
       if(running) {
         if(currentTimestamp === 0)
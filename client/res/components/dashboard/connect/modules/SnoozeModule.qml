@@ -106,8 +106,9 @@ MovableModule {
 
   Timer {
     id: remainingTimeCalculator
-    // Run timer only when in "snoozed" state and connection is down
-    running: connState.snoozeState === connState.snoozeDisconnected
+    // Run timer only when in "snoozed" state and connection is down, and only
+    // while the dashboard is shown
+    running: windowVisible && connState.snoozeState === connState.snoozeDisconnected
     repeat: true
     interval: 1000
     function calculateRemainingTime () {
@@ -121,6 +122,11 @@ MovableModule {
     onTriggered: {
       calculateRemainingTime();
     }
+    // Catch up immediately when the dashboard is shown again
+    onRunningChanged: {
+      if(running)
+        calculateRemainingTime();
+    }
   }
 
   readonly property int adjustButtonWidth: 30
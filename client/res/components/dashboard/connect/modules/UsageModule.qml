@@ -69,7 +69,8 @@ MovableModule {
   }
 
   ValueText {
-    text: formatUsageBytes(Daemon.state.bytesReceived)
+    // Don't reformat on every update while hidden
+    text: windowVisible ? formatUsageBytes(Daemon.state.bytesReceived) : ""
     label: downloadLabel.text
     color: Theme.dashboard.moduleTextColor
     font.pixelSize: Theme.dashboard.moduleValueTextPx
@@ -91,7 +92,7 @@ MovableModule {
   }
 
   ValueText {
-    text: formatUsageBytes(Daemon.state.bytesSent)
+    text: windowVisible ? formatUsageBytes(Daemon.state.bytesSent) : ""
     label: uploadLabel.text
     color: Theme.dashboard.moduleTextColor
     font.pixelSize: Theme.dashboard.moduleValueTextPx
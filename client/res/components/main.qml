@@ -67,12 +67,27 @@ QtObject {
     component: Component { DevToolsWindow { visible: false }}
   }
 
-  property var wChangeLog: ChangelogWindow {
-    onTop: reloaderActive
-    visible: reloaderActive
+  // The changelog and quick tour are rarely opened, so they're only created
+  // when needed
+  property var wChangeLogLoader: WindowLoader {
+    objectName: 'wChangeLogLoader'
+    component: Component {
+      ChangelogWindow {
+        onTop: reloaderActive
+        visible: reloaderActive
+      }
+    }
+  }
+
+  property var wOnboardingLoader: WindowLoader {
+    objectName: 'wOnboardingLoader'
+    component: Component { OnboardingWindow {} }
   }
 
-  property var wOnboarding: OnboardingWindow {
+  // The reloader shows the changelog, load it when the reloader is activated
+  onReloaderActiveChanged: {
+    if(reloaderActive)
+      wChangeLogLoader.load()
   }
 
   property Connections showDashboardHandler: Connections {
@@ -104,8 +119,11 @@ QtObject {
     repeat: false
     running: false
     onTriggered: {
-      wChangeLog.activePage = 0 // What's New
-      wChangeLog.open()
+      var changelogWindow = wChangeLogLoader.load()
+      if(changelogWindow) {
+        changelogWindow.activePage = 0 // What's New
+        changelogWindow.open()
+      }
     }
   }
 
@@ -128,7 +146,9 @@ QtObject {
     TrayIcon.dashboard = dashboard.window
 
     if(Client.state.firstRunFlag) {
-      wOnboarding.showOnboarding();
+      var onboardingWindow = wOnboardingLoader.load()
+      if(onboardingWindow)
+        onboardingWindow.showOnboarding()
     }
     else if(Client.state.showWhatsNew) {
       centerChangelogTimer.start();
@@ -148,8 +168,10 @@ QtObject {
   function cleanUpResources() {
     NativeHelpers.trimComponentCache()
     NativeHelpers.releaseWindowResources(wSettings)
-    NativeHelpers.releaseWindowResources(wChangeLog)
-    NativeHelpers.releaseWindowResources(wOnboarding)
+    if(wChangeLogLoader.window)
+      NativeHelpers.releaseWindowResources(wChangeLogLoader.window)
+    if(wOnboardingLoader.window)
+      NativeHelpers.releaseWindowResources(wOnboardingLoader.window)
     if(wDevToolsLoader.window) {
       console.info("release window resources: dev tools")
       NativeHelpers.releaseWindowResources(wDevToolsLoader.window)
@@ -156,7 +156,7 @@ Page {
             text: uiTr("Changelog")
             underlined: true
             onClicked: {
-              wChangeLog.open()
+              wChangeLogLoader.open()
             }
           }
 
@@ -166,7 +166,9 @@ Page {
             text: uiTr("Quick Tour")
             underlined: true
             onClicked: {
-              wOnboarding.showOnboarding()
+              var onboardingWindow = wOnboardingLoader.load()
+              if(onboardingWindow)
+                onboardingWindow.showOnboarding()
             }
           }
         }
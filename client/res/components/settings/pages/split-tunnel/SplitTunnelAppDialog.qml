@@ -67,7 +67,11 @@ OverlayDialog {
   }
 
   function openDialog() {
-    // Skip the app list for Linux since we don't scan apps on Linux currently.
+    // Skip the app list on Linux and macOS since we don't scan apps there
+    // currently (the LinuxAppScanner/MacAppScanner are stubs); the system file
+    // picker is used instead, so there's nothing to cache on those platforms.
+    // On Windows, WinAppScanner keeps its link cache between scans, and
+    // SplitTunnelManager keeps the last results until a rescan is forced.
     if(Qt.platform.os === 'windows') {
       addApplicationDialog.open();
       SplitTunnelManager.scanApplications();
@@ -112,8 +116,14 @@ OverlayDialog {
     })
   }
   property int browseAppSelectedIndex: -1
+  // The list can change while the dialog is open (apps found later in a scan,
+  // or a refresh), the selected index would no longer refer to the same app
+  onScannedApplicationsChanged: browseAppSelectedIndex = -1
 
   readonly property bool applicationScanRunning: SplitTunnelManager.scanActive
+  // Some scanners report apps before the scan completes - show them while the
+  // scan continues, the list grows when the rest are found.
+  readonly property bool applicationListLoading: applicationScanRunning && scannedApplications.length === 0
   readonly property var webkitApps: [
         "/Applications/Safari.app",
         "/Applications/Mail.app",
@@ -259,7 +269,7 @@ OverlayDialog {
         // Loading indicator
         Item {
           anchors.fill: parent
-          visible: applicationScanRunning
+          visible: applicationListLoading
 
           Image {
             id: spinnerImage
@@ -270,7 +280,7 @@ OverlayDialog {
 
             RotationAnimator {
               target: spinnerImage
-              running: applicationScanRunning
+              running: applicationListLoading
               from: 0;
               to: 360;
               duration: 1000
@@ -281,7 +291,7 @@ OverlayDialog {
 
         ThemedScrollView {
           id: scannedAppScrollView
-          visible: !applicationScanRunning
+          visible: !applicationListLoading
           ScrollBar.vertical.policy: ScrollBar.AlwaysOn
           label: uiTr("Applications")
           anchors.fill: parent
@@ -342,6 +352,20 @@ OverlayDialog {
                   }
                   visible: matchesSearch
 
+                  // Whether this row is currently within the visible part of
+                  // the list.  Icons are only loaded once a row has been
+                  // scrolled into view, so opening the dialog doesn't extract
+                  // the icon of every installed app up front.
+                  readonly property bool inViewport: visible &&
+                    y + height > scannedAppFlickable.contentY &&
+                    y < scannedAppFlickable.contentY + scannedAppFlickable.height
+                  property bool iconRequested: false
+                  onInViewportChanged: {
+                    if(inViewport)
+                      iconRequested = true
+                  }
+                  Component.onCompleted: iconRequested = inViewport
+
                   readonly property string includedAppsLine: {
                     var sortedApps = includedApps.slice().sort(function(first, second) {
                       first = first.toLowerCase()
@@ -401,6 +425,7 @@ OverlayDialog {
                     width: Qt.platform.os === 'windows' ? 16 : 20
                     height: width
                     appPath: modelData.path
+                    loadIcon: iconRequested
                   }
 
                   Text {
@@ -27,6 +27,11 @@ Item {
   id: appIcon
 
   property string appPath
+  // The icon is only requested from the "appicon" provider when this is set.
+  // Long lists can clear it for rows that haven't been scrolled into view,
+  // since extracting icons is relatively expensive.  Once loaded, icons are
+  // cached by the QML pixmap cache, so it doesn't need to be cleared again.
+  property bool loadIcon: true
 
   clip: logoImg.zoom !== 1
 
@@ -50,7 +55,7 @@ Item {
     }
     width: parent.width * zoom
     height: parent.height * zoom
-    source: "image://appicon/" + NativeHelpers.encodeUriComponent(appPath)
+    source: loadIcon ? "image://appicon/" + NativeHelpers.encodeUriComponent(appPath) : ""
 
     // Set the source size to ensure the image is loaded in high
     // DPI if needed.  Qt applies its scale factor on Mac; on
@@ -37,6 +37,10 @@ public:
     virtual void scanApplications () = 0;
 
 signals:
+    // Some applications have been found, but the scan is still in progress.
+    // The array contains all applications found so far.  Scanners that find
+    // all applications at once don't emit this.
+    void applicationsFound(const QJsonArray &applications);
     void applicationScanComplete(const QJsonArray &applications);
 };
 
@@ -40,6 +40,7 @@
 #include "product.h"
 #include "nativeacc/nativeacc.h"
 #include "splittunnelmanager.h"
+#include "regionlistmodel.h"
 #include <common/src/appsingleton.h>
 #include <common/src/apiretry.h>
 
@@ -65,6 +66,7 @@
 #include <QPointer>
 #include <QProcess>
 #include <QQmlContext>
+#include <QQuickWindow>
 #include <QTimer>
 #include <QtGlobal>
 #include <QUrl>
@@ -73,6 +75,82 @@
 
 KAPPS_CORE_LOG_MODULE(client, "src/client.cpp")
 
+namespace
+{
+    QElapsedTimer startedTimer()
+    {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }
+
+    // Started during static initialization, so the startup timeline traced by
+    // Client is measured from (approximately) process start.
+    const QElapsedTimer processStartTime = startedTimer();
+
+    // Set PIA_TRACE_FRAME_TIMES=1 to trace render times of the QML windows.
+    // This is meant for diagnosing GUI performance on users' systems - the
+    // results end up in the client log, which is included in support tool
+    // reports.
+    bool traceFrameTimesEnabled()
+    {
+        static const bool enabled = qEnvironmentVariableIntValue("PIA_TRACE_FRAME_TIMES") != 0;
+        return enabled;
+    }
+
+    // Trace the time at which a window renders its first frame.
+    void traceFirstFrame(QQuickWindow *pWindow, const QElapsedTimer &startupTime)
+    {
+        auto pConnection = std::make_shared<QMetaObject::Connection>();
+        // frameSwapped is emitted on the render thread, trace it directly
+        // rather than queueing it so the timing is accurate
+        *pConnection = QObject::connect(pWindow, &QQuickWindow::frameSwapped, pWindow,
+            [pConnection, startupTime, title = pWindow->title()]()
+            {
+                qInfo() << "First frame rendered for" << title << "-"
+                    << startupTime.elapsed() << "ms since startup";
+                QObject::disconnect(*pConnection);
+            }, Qt::DirectConnection);
+    }
+
+    // Trace a summary of the render time of each frame (from synchronizing the
+    // scene graph to swapping buffers) every 100 frames.  Idle time between
+    // frames isn't counted, QML only renders when something changes.
+    void traceFrameTimes(QQuickWindow *pWindow)
+    {
+        struct FrameStats
+        {
+            QElapsedTimer frameTime;
+            int frames{0};
+            qint64 totalUs{0};
+            qint64 maxUs{0};
+        };
+        // Both signals are emitted on the render thread, which is the only
+        // thread that accesses the stats
+        auto pStats = std::make_shared<FrameStats>();
+        QObject::connect(pWindow, &QQuickWindow::beforeSynchronizing, pWindow,
+            [pStats](){pStats->frameTime.start();}, Qt::DirectConnection);
+        QObject::connect(pWindow, &QQuickWindow::frameSwapped, pWindow,
+            [pStats, title = pWindow->title()]()
+            {
+                if(!pStats->frameTime.isValid())
+                    return;
+                qint64 frameUs = pStats->frameTime.nsecsElapsed() / 1000;
+                pStats->frameTime.invalidate();
+                ++pStats->frames;
+                pStats->totalUs += frameUs;
+                pStats->maxUs = std::max(pStats->maxUs, frameUs);
+                if(pStats->frames >= 100)
+                {
+                    qInfo() << "Frame times for" << title << "- avg"
+                        << (pStats->totalUs / pStats->frames) << "us, max"
+                        << pStats->maxUs << "us over" << pStats->frames << "frames";
+                    *pStats = {};
+                }
+            }, Qt::DirectConnection);
+    }
+}
+
 QmlCallResult::QmlCallResult(Async<QJsonValue> asyncResult)
     : _asyncResult{std::move(asyncResult)}
 {
@@ -537,7 +615,8 @@ std::atomic<qintptr> Client::_currentDaemonSocket{-1};
 
 Client::Client(bool hasExistingSettingsFile, const QJsonObject &initialSettings,
                GraphicsMode gfxMode, bool quietLaunch, bool forceClearCache)
-    : _daemon(new DaemonConnection(this))
+    : _startupTime{processStartTime}
+    , _daemon(new DaemonConnection(this))
     , _daemonInterface{_daemon}
     , _nativeHelpers{}
     , _preConnectStatus{*_daemon}
@@ -581,6 +660,7 @@ Client::Client(bool hasExistingSettingsFile, const QJsonObject &initialSettings,
     qmlRegisterType<FocusCue>("PIA.FocusCue", 1, 0, "FocusCue");
     qmlRegisterType<DragHandle>("PIA.DragHandle", 1, 0, "DragHandle");
     qmlRegisterType<FlexValidator>("PIA.FlexValidator", 1, 0, "FlexValidator");
+    qmlRegisterType<RegionListModel>("PIA.RegionListModel", 1, 0, "RegionListModel");
 
     qmlRegisterSingletonType<DaemonInterface>("PIA.NativeDaemon", 1, 0, "NativeDaemon",
         [](auto, auto) -> QObject* {return &Client::instance()->_daemonInterface;});
@@ -610,13 +690,14 @@ Client::Client(bool hasExistingSettingsFile, const QJsonObject &initialSettings,
     auto updateLogger = []() {
         const auto& value = g_daemonSettings.debugLogging();
         if (value == nullptr)
-            g_logger->configure(false, g_daemonSettings.largeLogFiles(), {});
+            g_logger->configure(false, g_daemonSettings.largeLogFiles(), g_daemonSettings.binaryLogFiles(), {});
         else
-            g_logger->configure(true, g_daemonSettings.largeLogFiles(), *value);
+            g_logger->configure(true, g_daemonSettings.largeLogFiles(), g_daemonSettings.binaryLogFiles(), *value);
     };
 
     connect(&g_daemonSettings, &DaemonSettings::debugLoggingChanged, this, updateLogger);
     connect(&g_daemonSettings, &DaemonSettings::largeLogFilesChanged, this, updateLogger);
+    connect(&g_daemonSettings, &DaemonSettings::binaryLogFilesChanged, this, updateLogger);
 
     connect(g_logger, &Logger::configurationChanged, this, [](bool logToFile, const QStringList& filters) {
         if (!logToFile)
@@ -660,6 +741,8 @@ Client::Client(bool hasExistingSettingsFile, const QJsonObject &initialSettings,
             _clientInterface.get_state()->setRegionsMetadata(_daemon->state.regionsMetadata());
         });
     _clientInterface.get_state()->setRegionsMetadata(_daemon->state.regionsMetadata());
+
+    qInfo() << "Client initialized after" << _startupTime.elapsed() << "ms";
 }
 
 Client::~Client()
@@ -811,11 +894,33 @@ void Client::checkForURL()
 void Client::loadQml(const QString &qmlResource)
 {
     auto prevRootCount = _engine.rootObjects().size();
+    QElapsedTimer loadTime;
+    loadTime.start();
     _engine.load(QUrl(qmlResource));
     if (_engine.rootObjects().size() == prevRootCount)
     {
         qCritical() << "Failed to load QML resource" << qmlResource;
         QCoreApplication::quit();
+        return;
+    }
+    qInfo() << "Loaded QML resource" << qmlResource << "in" << loadTime.elapsed()
+        << "ms -" << _startupTime.elapsed() << "ms since startup";
+
+    // Trace the first frame of the first resource loaded (the splash screen),
+    // and frame times if enabled
+    const auto &rootObjects = _engine.rootObjects();
+    for(auto itRoot = rootObjects.begin() + prevRootCount; itRoot != rootObjects.end(); ++itRoot)
+    {
+        QList<QQuickWindow*> windows = (*itRoot)->findChildren<QQuickWindow*>();
+        if(auto pRootWindow = qobject_cast<QQuickWindow*>(*itRoot))
+            windows.prepend(pRootWindow);
+        for(auto pWindow : windows)
+        {
+            if(prevRootCount == 0)
+                traceFirstFrame(pWindow, _startupTime);
+            if(traceFrameTimesEnabled())
+                traceFrameTimes(pWindow);
+        }
     }
 }
 
@@ -863,6 +968,12 @@ void Client::daemonConnectedChanged(bool connected)
     // client connection
     if(connected)
     {
+        if(!_mainUiLoaded)
+        {
+            qInfo() << "Connected to daemon -" << _startupTime.elapsed()
+                << "ms since startup";
+        }
+
         // Can't be active or have an in-flight request, because this would have
         // been preceded by a change with connected=false which resets these
         Q_ASSERT(!_notifyActivateResult);
@@ -888,7 +999,8 @@ void Client::daemonConnectedChanged(bool connected)
                 // load the main client UI.
                 if(!_mainUiLoaded)
                 {
-                    qInfo() << "Client connected, loading UI";
+                    qInfo() << "Client connected, loading UI -"
+                        << _startupTime.elapsed() << "ms since startup";
                     _mainUiLoaded = true;
 
                     // If we need to migrate daemon-side client settings, do
@@ -33,6 +33,7 @@
 #include <common/src/appsingleton.h>
 #include <kapps_core/src/winapi.h> // Due to QWindow below including windows.h
 
+#include <QElapsedTimer>
 #include <QFontDatabase>
 #include <QObject>
 #include <QQmlApplicationEngine>
@@ -281,6 +282,10 @@ protected slots:
     void daemonConnectedChanged(bool connected);
 
 protected:
+    // Measures the time since process start; used to trace the startup
+    // timeline (client initialized, daemon connected, QML loaded, first
+    // frame).
+    QElapsedTimer _startupTime;
     DaemonConnection* _daemon;
     DaemonInterface _daemonInterface;
     NativeHelpers _nativeHelpers;
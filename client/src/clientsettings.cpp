@@ -99,10 +99,30 @@ void ClientState::updateActiveLanguageTag()
             << "is not a valid BCP-47 tag, defaulting to en-US";
         _activeLanguageTag = kapps::regions::Bcp47Tag{"en", {}, "US"};
     }
+    updateTranslatedNames();
+}
+
+auto ClientState::translateNames(const DisplayTexts &names,
+    const kapps::regions::LanguageFallbacks &fallbacks) -> TranslatedNames
+{
+    TranslatedNames translated;
+    translated.reserve(names.size());
+    for(const auto &[id, text] : names)
+        translated.emplace(id, qs::toQString(text.getLanguageText(fallbacks)));
+    return translated;
+}
+
+void ClientState::updateTranslatedNames()
+{
+    kapps::regions::LanguageFallbacks fallbacks{_activeLanguageTag};
+    _translatedRegionNames = translateNames(_regionNames, fallbacks);
+    _translatedCountryNames = translateNames(_countryNames, fallbacks);
+    _translatedCountryPrefixes = translateNames(_countryPrefixes, fallbacks);
+    emit translatedNamesChanged();
 }
 
 QString ClientState::getTranslatedName(const QString &id,
-    const std::unordered_map<QString, kapps::regions::DisplayText> &names) const
+    const TranslatedNames &names) const
 {
     auto itName = names.find(id);
     if(itName == names.end())
@@ -115,7 +135,7 @@ QString ClientState::getTranslatedName(const QString &id,
         return id;
     }
 
-    return qs::toQString(itName->second.getLanguageText(_activeLanguageTag));
+    return itName->second;
 }
 
 void ClientState::setRegionsMetadata(const QJsonObject &metadata)
@@ -127,15 +147,16 @@ void ClientState::setRegionsMetadata(const QJsonObject &metadata)
         _regionNames.clear();
         _countryNames.clear();
         _countryPrefixes.clear();
+        updateTranslatedNames();
         return;
     }
 
     try
     {
         auto j = nlohmann::json::parse(QJsonDocument{metadata}.toJson());
-        std::unordered_map<QString, kapps::regions::DisplayText> regionNames;
-        std::unordered_map<QString, kapps::regions::DisplayText> countryNames;
-        std::unordered_map<QString, kapps::regions::DisplayText> countryPrefixes;
+        DisplayTexts regionNames;
+        DisplayTexts countryNames;
+        DisplayTexts countryPrefixes;
 
         for(const auto &[id, region] : kapps::core::jsonObject(j.at("regionDisplays")).items())
         {
@@ -154,6 +175,7 @@ void ClientState::setRegionsMetadata(const QJsonObject &metadata)
         _regionNames = std::move(regionNames);
         _countryNames = std::move(countryNames);
         _countryPrefixes = std::move(countryPrefixes);
+        updateTranslatedNames();
     }
     catch(const std::exception &ex)
     {
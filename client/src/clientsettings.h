@@ -210,9 +210,17 @@ public:
     ClientState();
 
 private:
+    using DisplayTexts = std::unordered_map<QString, kapps::regions::DisplayText>;
+    using TranslatedNames = std::unordered_map<QString, QString>;
+
     void updateActiveLanguageTag();
-    QString getTranslatedName(const QString &id,
-        const std::unordered_map<QString, kapps::regions::DisplayText> &names) const;
+    // Resolve all names from the metadata for the active language.  This is
+    // done once when the metadata or language changes, so the lookups from
+    // QML are just one hash lookup.
+    static TranslatedNames translateNames(const DisplayTexts &names,
+        const kapps::regions::LanguageFallbacks &fallbacks);
+    void updateTranslatedNames();
+    QString getTranslatedName(const QString &id, const TranslatedNames &names) const;
 
 public:
     // Client provides the regions metadata JSON whenever the daemon state
@@ -251,22 +259,31 @@ public:
     // Daemon.state.regionsMetadata in order to reevaluate if either changes.
     Q_INVOKABLE QString getTranslatedRegionName(const QString &regionId) const
     {
-        return getTranslatedName(regionId, _regionNames);
+        return getTranslatedName(regionId, _translatedRegionNames);
     }
     Q_INVOKABLE QString getTranslatedCountryName(const QString &countryCode) const
     {
-        return getTranslatedName(countryCode, _countryNames);
+        return getTranslatedName(countryCode, _translatedCountryNames);
     }
     Q_INVOKABLE QString getTranslatedCountryPrefix(const QString &countryCode) const
     {
-        return getTranslatedName(countryCode, _countryPrefixes);
+        return getTranslatedName(countryCode, _translatedCountryPrefixes);
     }
 
+signals:
+    // The translated names have been resolved again, due to a change in the
+    // active language or the regions metadata
+    void translatedNamesChanged();
+
 private:
     // Current language (derived from activeLanguage) as a Bcp47Tag
     kapps::regions::Bcp47Tag _activeLanguageTag;
     // DisplayTexts read from the regions metadata
-    std::unordered_map<QString, kapps::regions::DisplayText> _regionNames;
-    std::unordered_map<QString, kapps::regions::DisplayText> _countryNames;
-    std::unordered_map<QString, kapps::regions::DisplayText> _countryPrefixes;
+    DisplayTexts _regionNames;
+    DisplayTexts _countryNames;
+    DisplayTexts _countryPrefixes;
+    // Names resolved from the DisplayTexts for _activeLanguageTag
+    TranslatedNames _translatedRegionNames;
+    TranslatedNames _translatedCountryNames;
+    TranslatedNames _translatedCountryPrefixes;
 };
@@ -93,11 +93,19 @@ TrayIconShim::TrayIconShim(const QString &iconPath)
 {
 }
 
+const QIcon &TrayIconShim::getIcon(const QString &iconPath)
+{
+    auto itIcon = _iconCache.find(iconPath);
+    if(itIcon == _iconCache.end())
+        itIcon = _iconCache.insert(iconPath, QIcon{iconPath});
+    return *itIcon;
+}
+
 void TrayIconShim::setIcon(const QString &iconPath)
 {
     _lastIconPath = iconPath;
     if(_pTrayIcon)
-        _pTrayIcon->setIcon(QIcon{iconPath});
+        _pTrayIcon->setIcon(getIcon(iconPath));
 }
 
 void TrayIconShim::showMessage(const QString &title, const QString &message,
@@ -106,7 +114,7 @@ void TrayIconShim::showMessage(const QString &title, const QString &message,
     Q_ASSERT(!message.isEmpty());   // Can't be empty, would indicate empty queue
 
     if(_pTrayIcon)
-        _pTrayIcon->showMessage(title, message, QIcon{iconPath});
+        _pTrayIcon->showMessage(title, message, getIcon(iconPath));
     else
     {
         // Queue the message and show it when the icon is created
@@ -128,19 +136,19 @@ void TrayIconShim::create(QMenu &menu)
     // Destroy the old icon (if there is one) before creating the new one
     _pTrayIcon.reset();
     // Create the new icon and set invariant state
-    _pTrayIcon.reset(new QSystemTrayIcon{QIcon{_lastIconPath}});
+    _pTrayIcon.reset(new QSystemTrayIcon{getIcon(_lastIconPath)});
     _pTrayIcon->setVisible(true);
     _pTrayIcon->setContextMenu(&menu);
     QObject::connect(_pTrayIcon.data(), &QSystemTrayIcon::activated, this,
                      &TrayIconShim::activated);
     // Restore stored state
-    _pTrayIcon->setIcon(QIcon{_lastIconPath});
+    _pTrayIcon->setIcon(getIcon(_lastIconPath));
     _pTrayIcon->setToolTip(_lastToolTip);
 
     // If there's a queued message, show it
     if(!_queuedMsg.isEmpty())
     {
-        _pTrayIcon->showMessage(_queuedMsgTitle, _queuedMsg, QIcon{_queuedMsgIcon});
+        _pTrayIcon->showMessage(_queuedMsgTitle, _queuedMsg, getIcon(_queuedMsgIcon));
         _queuedMsgTitle.clear();
         _queuedMsg.clear();
         _queuedMsgIcon.clear();
@@ -68,11 +68,21 @@ public:
     // properties are stored by TrayIconShim and reapplied.
     void create(QMenu &menu);
 
+private:
+    // Get the QIcon for an icon resource, loading it if it hasn't been loaded
+    // yet
+    const QIcon &getIcon(const QString &iconPath);
+
 signals:
     void activated(QSystemTrayIcon::ActivationReason reason);
 
 private:
     QScopedPointer<QSystemTrayIcon> _pTrayIcon;
+    // Icons that have been loaded, by resource path.  The icon changes often
+    // while connecting and reconnecting, but there are only a few possible
+    // icons.  Keeping the QIcons also keeps the pixmaps they render for each
+    // size and scale.
+    QHash<QString, QIcon> _iconCache;
     // Store these values that we set in the tray icon so we know them when
     // recreating the icon
     // The menu isn't stored; NativeTrayQt keeps the QMenu around anyway so it
@@ -69,6 +69,9 @@ public:
 private:
     NSMenu* createMenu(const NativeMenuItem::List& items);
     QRect getScreenBound() const;
+    // Get the tray icon for a state and icon set, loading it if it hasn't been
+    // loaded yet
+    NSImage *getTrayIcon(IconState icon, const QString &iconSet);
 
 public:
     virtual void setIconState(IconState icon, const QString &iconSet) override;
@@ -109,6 +112,12 @@ private:
     NSMenu *_pTrayMenu = nullptr;
     // Menu icon cache.
     QHash<QString, NSImage*> _icons;
+    // Tray icons that have been loaded, by icon set and state.  The icon
+    // changes often while connecting and reconnecting, this avoids reading and
+    // decoding the image each time.  The images are sized for the status bar
+    // thickness that they were loaded with; they're reloaded if it changes.
+    QHash<QString, NSImage*> _trayIcons;
+    CGFloat _trayIconsThickness = 0;
 };
 
 std::unique_ptr<NativeTray> createNativeTrayMac(NativeTray::IconState initialIcon, const QString &initialIconSet)
@@ -481,7 +490,7 @@ NativeTrayMac::NativeTrayMac(NativeTray::IconState initialIcon, const QString &i
     _pStatusItem = [_pStatusBar statusItemWithLength:NSSquareStatusItemLength];
 
     // Create a status bar button
-    NSImage *pInitialIcon = loadIconForState(initialIcon, initialIconSet);
+    NSImage *pInitialIcon = getTrayIcon(initialIcon, initialIconSet);
     // This is the default frame that would have been used by
     // NSButton.buttonWithImage:target:action:.  It doesn't really matter since
     // the button will be bounded by the status item.
@@ -623,9 +632,25 @@ QRect NativeTrayMac::getScreenBound() const
     return qtBounds.toRect();
 }
 
+NSImage *NativeTrayMac::getTrayIcon(IconState icon, const QString &iconSet)
+{
+    CGFloat thickness = [[NSStatusBar systemStatusBar] thickness];
+    if(thickness != _trayIconsThickness)
+    {
+        _trayIcons.clear();
+        _trayIconsThickness = thickness;
+    }
+
+    QString key = iconSet + QStringLiteral("/") + QString::number(static_cast<int>(icon));
+    auto itIcon = _trayIcons.find(key);
+    if(itIcon == _trayIcons.end())
+        itIcon = _trayIcons.insert(key, loadIconForState(icon, iconSet));
+    return *itIcon;
+}
+
 void NativeTrayMac::setIconState(IconState icon, const QString &iconSet)
 {
-    NSImage *pIconImage = loadIconForState(icon, iconSet);
+    NSImage *pIconImage = getTrayIcon(icon, iconSet);
     _pButton.image = pIconImage;
 }
 
@@ -374,7 +374,18 @@ void TableAttached::setRows(const QJSValue &rows)
 {
     // Like the columns, assume the rows have changed.
     _rows = rows;
+    emit rowsChanged();
+
+    // The rows array is rebuilt by the QML code whenever any row item changes,
+    // which can happen several times for one change (such as a latency update
+    // or the region list being rebuilt).  Matching up and reattaching all the
+    // cells is expensive when a screen reader is active, so only do it once
+    // for all of those changes.
+    queueNotification(&TableAttached::applyRows);
+}
 
+void TableAttached::applyRows()
+{
     // Map the row IDs to the existing rows.  We don't want setRows() to be
     // O(N^2), it's called every time the table changes (including latency
     // measurements, etc.)  Making a map ahead of time keeps it to O(N*log(N)).
@@ -447,8 +458,6 @@ void TableAttached::setRows(const QJSValue &rows)
         setRowCellSpans(rowIdx, newRow);
     }
 
-    emit rowsChanged();
-
     updateFocusDelegateCell();
 }
 
@@ -537,7 +546,10 @@ QList<QAccessibleInterface*> TableAttached::getRowOutlineChildren(int row) const
     while(rowIdx < _rowDefs.size())
     {
         if(!_rowDefs[rowIdx].pAccDef)
+        {
+            ++rowIdx;
             continue;
+        }
         int rowOutlineLevel = _rowDefs[rowIdx].pAccDef->outlineLevel();
 
         // If it's the child level, add it.
@@ -115,6 +115,9 @@ public:
     // by TableAttached.  (Properties of the RowCell objects and cell
     // definitions update normally.)  Normally the QML code builds the entire
     // array as a property binding, so any change causes the property to be reassigned.
+    //
+    // Since that can happen several times for one change in the UI, the new
+    // rows are applied once in the next event loop iteration.
     Q_PROPERTY(QJSValue rows READ rows WRITE setRows NOTIFY rowsChanged)
     // The current position highlighted by keyboard navigation.  This causes the
     // table to report this cell as the current focus item - even though cells
@@ -206,6 +209,9 @@ private:
     // Update the cell to which we've delegated focus
     void updateFocusDelegateCell();
 
+    // Apply the rows last given to setRows()
+    void applyRows();
+
 public:
     QJSValue columns() const {return _columns;}
     void setColumns(const QJSValue &columns);
@@ -262,6 +268,8 @@ public:
     virtual QList<QAccessibleInterface *> getTableColumns() const override;
     virtual QList<QAccessibleInterface*> getSelectedRows() const override;
 
+    IMPLEMENT_NOTIFICATIONS(TableAttached)
+
 signals:
     void columnsChanged();
     void rowsChanged();
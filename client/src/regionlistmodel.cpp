@@ -0,0 +1,353 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("regionlistmodel.cpp")
+
+#include "regionlistmodel.h"
+#include <QCollator>
+#include <QJSEngine>
+#include <algorithm>
+
+RegionListModel::RegionListModel(QObject *pParent)
+    : QAbstractListModel{pParent}, _complete{true}
+{
+}
+
+bool RegionListModel::matchesSearchTerm(const QString &value) const
+{
+    return value.contains(_searchTerm, Qt::CaseInsensitive);
+}
+
+bool RegionListModel::acceptLocation(const QJsonObject &location) const
+{
+    if(!_regionFilter.isCallable())
+        return true;
+    QJSEngine *pEngine = qjsEngine(this);
+    if(!pEngine)
+        return true;
+    return _regionFilter.call({pEngine->toScriptValue(location)}).toBool();
+}
+
+QString RegionListModel::countryName(const QString &countryCode) const
+{
+    return _pClientState ? _pClientState->getTranslatedCountryName(countryCode) : QString{};
+}
+
+QString RegionListModel::locationName(const QString &countryCode,
+                                      const QJsonObject &location,
+                                      int countryLocationCount) const
+{
+    // Same as Client.getRegionAutoName() - single-region countries are
+    // displayed with the country name, otherwise the prefix and city name are
+    // used
+    if(countryLocationCount <= 1)
+        return countryName(countryCode);
+    if(!_pClientState)
+        return {};
+    const auto &id = location.value(QStringLiteral("id")).toString();
+    return _pClientState->getTranslatedCountryPrefix(countryCode) +
+        _pClientState->getTranslatedRegionName(id);
+}
+
+auto RegionListModel::buildRows() const -> std::vector<Row>
+{
+    struct Country
+    {
+        QString code;
+        QString name;
+        std::vector<QJsonObject> locations;
+        std::vector<QString> locationNames;
+    };
+    std::vector<Country> countries;
+    countries.reserve(_groupedLocations.size());
+
+    for(const auto &countryValue : _groupedLocations)
+    {
+        const auto &countryObj = countryValue.toObject();
+        const auto &allLocations = countryObj.value(QStringLiteral("locations")).toArray();
+        Country country;
+        country.code = countryObj.value(QStringLiteral("code")).toString();
+        country.name = countryName(country.code);
+
+        // Filter the locations with the region filter.  This could cause a
+        // country group to become a single location, but the names are still
+        // determined by the unfiltered location count, e.g. CA Vancouver is
+        // the only CA region with Shadowsocks but it's still displayed as "CA
+        // Vancouver", not "Canada".
+        for(const auto &locationValue : allLocations)
+        {
+            const auto &location = locationValue.toObject();
+            if(acceptLocation(location))
+            {
+                country.locations.push_back(location);
+                country.locationNames.push_back(locationName(country.code, location,
+                                                              allLocations.size()));
+            }
+        }
+
+        if(country.locations.empty())
+            continue;   // Nothing to display in this country
+
+        if(!_searchTerm.isEmpty())
+        {
+            // For single-region countries, only the country name is displayed.
+            // For groups, include everything if the country name matches,
+            // otherwise filter the individual regions.
+            if(allLocations.size() <= 1 || !matchesSearchTerm(country.name))
+            {
+                std::size_t kept{0};
+                for(std::size_t i=0; i<country.locations.size(); ++i)
+                {
+                    if(matchesSearchTerm(country.locationNames[i]))
+                    {
+                        country.locations[kept] = std::move(country.locations[i]);
+                        country.locationNames[kept] = std::move(country.locationNames[i]);
+                        ++kept;
+                    }
+                }
+                country.locations.resize(kept);
+                country.locationNames.resize(kept);
+                if(country.locations.empty())
+                    continue;
+            }
+        }
+
+        countries.push_back(std::move(country));
+    }
+
+    // If sorting by name, re-sort the countries and their locations.  (If
+    // sorting by latency, the daemon has already sorted them.)
+    if(_sortKey == QStringLiteral("name"))
+    {
+        QCollator collator{_pClientState ? QLocale{_pClientState->activeLanguage().locale()} : QLocale{}};
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+        // Country groups are sorted by the country name, even if only one
+        // location remains after filtering
+        std::stable_sort(countries.begin(), countries.end(),
+            [&](const Country &first, const Country &second)
+            {
+                return collator.compare(first.name, second.name) < 0;
+            });
+
+        for(auto &country : countries)
+        {
+            std::vector<std::size_t> order(country.locations.size());
+            for(std::size_t i=0; i<order.size(); ++i)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(),
+                [&](std::size_t first, std::size_t second)
+                {
+                    int nameComp = collator.compare(country.locationNames[first],
+                                                    country.locationNames[second]);
+                    if(nameComp != 0)
+                        return nameComp < 0;
+                    // Dedicated IP regions could have the same name if there's
+                    // more than one, sort by IP next.  This is empty for other
+                    // regions.
+                    const auto &dipKey = QStringLiteral("dedicatedIp");
+                    return collator.compare(country.locations[first].value(dipKey).toString(),
+                                            country.locations[second].value(dipKey).toString()) < 0;
+                });
+            std::vector<QJsonObject> sorted;
+            sorted.reserve(order.size());
+            for(auto i : order)
+                sorted.push_back(std::move(country.locations[i]));
+            country.locations = std::move(sorted);
+        }
+    }
+
+    std::vector<Row> rows;
+    rows.reserve(countries.size());
+    for(auto &country : countries)
+    {
+        Row row;
+        row.country = std::move(country.code);
+        if(country.locations.size() == 1)
+            row.region = std::move(country.locations.front());
+        else
+        {
+            for(auto &location : country.locations)
+                row.children.push_back(QJsonObject{{QStringLiteral("subregion"), std::move(location)}});
+        }
+        rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+void RegionListModel::update()
+{
+    if(!_complete)
+        return;
+
+    std::vector<Row> rows = buildRows();
+
+    // Determine whether the rows are the same - the same countries, locations,
+    // and order.  Each location is identified by its ID.
+    auto locationId = [](const QJsonValue &location)
+    {
+        return location.toObject().value(QStringLiteral("id"));
+    };
+    auto sameRow = [&](const Row &first, const Row &second)
+    {
+        if(first.country != second.country ||
+            locationId(first.region) != locationId(second.region) ||
+            first.children.size() != second.children.size())
+        {
+            return false;
+        }
+        for(qsizetype i=0; i<first.children.size(); ++i)
+        {
+            const auto &subregionKey = QStringLiteral("subregion");
+            if(locationId(first.children[i].toObject().value(subregionKey)) !=
+                locationId(second.children[i].toObject().value(subregionKey)))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if(rows.size() != _rows.size() ||
+        !std::equal(rows.begin(), rows.end(), _rows.begin(), sameRow))
+    {
+        beginResetModel();
+        _rows = std::move(rows);
+        endResetModel();
+        return;
+    }
+
+    // Same rows - just emit dataChanged() for the rows whose locations changed
+    // (typically just latencies)
+    for(std::size_t i=0; i<rows.size(); ++i)
+    {
+        if(rows[i].region != _rows[i].region || rows[i].children != _rows[i].children)
+        {
+            _rows[i] = std::move(rows[i]);
+            auto rowIdx = index(static_cast<int>(i));
+            emit dataChanged(rowIdx, rowIdx, {RegionRole, RegionChildrenRole});
+        }
+    }
+}
+
+int RegionListModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid())
+        return 0;
+    return static_cast<int>(_rows.size());
+}
+
+QVariant RegionListModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() < 0 ||
+        static_cast<std::size_t>(index.row()) >= _rows.size())
+    {
+        return {};
+    }
+
+    const Row &row = _rows[static_cast<std::size_t>(index.row())];
+    switch(role)
+    {
+    case RegionRole:
+        // Country groups have a null region
+        if(row.region.isEmpty())
+            return QVariant::fromValue(nullptr);
+        return row.region;
+    case RegionCountryRole:
+        return row.country;
+    case RegionChildrenRole:
+        return row.children;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> RegionListModel::roleNames() const
+{
+    return {
+        {RegionRole, QByteArrayLiteral("region")},
+        {RegionCountryRole, QByteArrayLiteral("regionCountry")},
+        {RegionChildrenRole, QByteArrayLiteral("regionChildren")}
+    };
+}
+
+void RegionListModel::classBegin()
+{
+    _complete = false;
+}
+
+void RegionListModel::componentComplete()
+{
+    _complete = true;
+    update();
+}
+
+void RegionListModel::setGroupedLocations(const QJsonArray &groupedLocations)
+{
+    if(groupedLocations == _groupedLocations)
+        return;
+    _groupedLocations = groupedLocations;
+    emit groupedLocationsChanged();
+    update();
+}
+
+void RegionListModel::setSearchTerm(const QString &searchTerm)
+{
+    if(searchTerm == _searchTerm)
+        return;
+    _searchTerm = searchTerm;
+    emit searchTermChanged();
+    update();
+}
+
+void RegionListModel::setSortKey(const QString &sortKey)
+{
+    if(sortKey == _sortKey)
+        return;
+    _sortKey = sortKey;
+    emit sortKeyChanged();
+    update();
+}
+
+void RegionListModel::setRegionFilter(const QJSValue &regionFilter)
+{
+    if(regionFilter.strictlyEquals(_regionFilter))
+        return;
+    _regionFilter = regionFilter;
+    emit regionFilterChanged();
+    update();
+}
+
+void RegionListModel::setClientState(ClientState *pClientState)
+{
+    if(pClientState == _pClientState)
+        return;
+    if(_pClientState)
+        disconnect(_pClientState, nullptr, this, nullptr);
+    _pClientState = pClientState;
+    // Names and the collation order depend on the active language and the
+    // regions metadata
+    if(_pClientState)
+    {
+        connect(_pClientState, &ClientState::translatedNamesChanged, this,
+                &RegionListModel::update);
+    }
+    emit clientStateChanged();
+    update();
+}
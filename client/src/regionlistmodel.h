@@ -0,0 +1,138 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("regionlistmodel.h")
+
+#ifndef REGIONLISTMODEL_H
+#define REGIONLISTMODEL_H
+
+#include "clientsettings.h"
+#include <QAbstractListModel>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJSValue>
+#include <QPointer>
+#include <QQmlParserStatus>
+
+// RegionListModel provides the country groups and single regions displayed by
+// RegionListView.  It filters and sorts DaemonState.groupedLocations natively,
+// which used to be done in JS every time any location changed.
+//
+// Each row has the following roles:
+// - region: null for a country group, or a Location object for a single region
+// - regionCountry: country code for the group or location
+// - regionChildren: array of {subregion: <Location>} objects for a country
+//   group, or empty array for a single region
+//
+// Most updates just change latencies or other properties of the locations, the
+// rows themselves stay the same.  In that case, only dataChanged() is emitted
+// for the rows that actually changed, so the delegates are kept and just update
+// their bindings.  If rows are added, removed, or reordered, the model is
+// reset.
+class RegionListModel : public QAbstractListModel, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
+
+public:
+    enum Role : int
+    {
+        RegionRole = Qt::UserRole,
+        RegionCountryRole,
+        RegionChildrenRole,
+    };
+
+    // The grouped locations from DaemonState
+    Q_PROPERTY(QJsonArray groupedLocations READ groupedLocations WRITE setGroupedLocations NOTIFY groupedLocationsChanged)
+    // Search term - regions are displayed if their displayed name (or their
+    // country group name) contains this term
+    Q_PROPERTY(QString searchTerm READ searchTerm WRITE setSearchTerm NOTIFY searchTermChanged)
+    // The regionSortKey setting - "name" sorts by the translated names,
+    // otherwise the daemon's order (by latency) is kept
+    Q_PROPERTY(QString sortKey READ sortKey WRITE setSortKey NOTIFY sortKeyChanged)
+    // Optional JS function used to filter locations, see
+    // RegionListView.regionFilter
+    Q_PROPERTY(QJSValue regionFilter READ regionFilter WRITE setRegionFilter NOTIFY regionFilterChanged)
+    // ClientState provides the translated names and active language
+    Q_PROPERTY(ClientState *clientState READ clientState WRITE setClientState NOTIFY clientStateChanged)
+
+public:
+    RegionListModel(QObject *pParent = nullptr);
+
+private:
+    struct Row
+    {
+        QString country;
+        // Single location, or empty for a country group
+        QJsonObject region;
+        // Locations in a country group
+        QJsonArray children;
+    };
+
+private:
+    bool matchesSearchTerm(const QString &value) const;
+    bool acceptLocation(const QJsonObject &location) const;
+    QString countryName(const QString &countryCode) const;
+    // Display name of a location, given the number of locations in its country
+    // (before filtering)
+    QString locationName(const QString &countryCode, const QJsonObject &location,
+                         int countryLocationCount) const;
+    std::vector<Row> buildRows() const;
+    void update();
+
+public:
+    // QAbstractListModel
+    int rowCount(const QModelIndex &parent = {}) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    // QQmlParserStatus
+    void classBegin() override;
+    void componentComplete() override;
+
+    const QJsonArray &groupedLocations() const {return _groupedLocations;}
+    void setGroupedLocations(const QJsonArray &groupedLocations);
+    const QString &searchTerm() const {return _searchTerm;}
+    void setSearchTerm(const QString &searchTerm);
+    const QString &sortKey() const {return _sortKey;}
+    void setSortKey(const QString &sortKey);
+    const QJSValue &regionFilter() const {return _regionFilter;}
+    void setRegionFilter(const QJSValue &regionFilter);
+    ClientState *clientState() const {return _pClientState;}
+    void setClientState(ClientState *pClientState);
+
+signals:
+    void groupedLocationsChanged();
+    void searchTermChanged();
+    void sortKeyChanged();
+    void regionFilterChanged();
+    void clientStateChanged();
+
+private:
+    QJsonArray _groupedLocations;
+    QString _searchTerm;
+    QString _sortKey;
+    QJSValue _regionFilter;
+    QPointer<ClientState> _pClientState;
+    // Don't build the rows until all initial property values have been set
+    bool _complete;
+    std::vector<Row> _rows;
+};
+
+#endif
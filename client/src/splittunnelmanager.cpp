@@ -51,6 +51,7 @@ void SplitTunnelManager::installImageHandler(QQmlApplicationEngine *engine)
 SplitTunnelManager::SplitTunnelManager()
 {
     _appScanner = AppScanner::create();
+    connect(_appScanner.get(), &AppScanner::applicationsFound, this, &SplitTunnelManager::applicationsFound);
     connect(_appScanner.get(), &AppScanner::applicationScanComplete, this, &SplitTunnelManager::applicationScanCompleted);
 }
 
@@ -140,6 +141,13 @@ QString SplitTunnelManager::getMacWebkitFrameworkPath() const
 #endif
 }
 
+void SplitTunnelManager::applicationsFound(const QJsonArray &applications)
+{
+    // Show these while the scan continues; scanActive remains set
+    _scannedApplications = applications;
+    emit applicationListChanged(_scannedApplications);
+}
+
 void SplitTunnelManager::applicationScanCompleted(const QJsonArray &applications)
 {
     _scannedApplications = applications;
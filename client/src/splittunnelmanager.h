@@ -69,6 +69,7 @@ public:
     QString getMacWebkitFrameworkPath () const;
 
 protected:
+    void applicationsFound (const QJsonArray &applications);
     void applicationScanCompleted (const QJsonArray &applications);
 
 signals:
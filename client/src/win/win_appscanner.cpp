@@ -27,6 +27,7 @@
 #include <common/src/builtin/path.h>
 #include "brand.h"
 #include "../client.h"
+#include <QDateTime>
 #include <QDirIterator>
 #include <QMutex>
 #include <array>
@@ -40,6 +41,24 @@
 #pragma comment(lib, "Shlwapi.lib")
 #pragma comment(lib, "Ole32.lib")
 
+// Information read from a shell link, kept between scans.  Each entry is valid
+// as long as the link's modification time doesn't change; reading the link,
+// canonicalizing its target, loading localized names, and checking the
+// executable's architecture are the expensive parts of a scan.
+struct WinAppScanner::CachedLink
+{
+    QDateTime _lastModified;
+    // Canonicalized target - empty if the link can't be used (not an
+    // executable, PIA itself, or couldn't be read)
+    std::wstring _canonicalTarget;
+    std::size_t _argsLength;
+    // The rest is filled in the first time the link is included in the results
+    bool _haveAppInfo;
+    QString _displayName;
+    QStringList _folders;
+    bool _compatible;
+};
+
 namespace
 {
     // Path to the WWA host for WWA apps
@@ -186,6 +205,9 @@ namespace
     class LinkScanner
     {
     public:
+        using LinkCache = WinAppScanner::LinkCache;
+        using CachedLink = WinAppScanner::CachedLink;
+
         // Entry in the _apps map.
         struct ScannedApp
         {
@@ -198,16 +220,21 @@ namespace
         };
 
     public:
-        LinkScanner();
+        // Links are looked up in linkCache, which is replaced with the links
+        // seen by this scan when buildAppsArray() is called.
+        LinkScanner(LinkCache &linkCache);
 
     private:
         std::wstring canonicalizePath(const wchar_t *pPath);
+        // Read a link that isn't cached (or has changed)
+        CachedLink resolveLink(const QString &linkPath);
         void readLink(const QString &baseFolderPath, const QFileInfo &link);
 
     public:
         void scanDirectory(REFKNOWNFOLDERID folderId);
-        // After scanning folders, build the JSON array of apps.
-        QJsonArray buildAppsArray() const;
+        // After scanning folders, build the JSON array of apps, and store the
+        // links seen in the cache.
+        QJsonArray buildAppsArray();
 
     private:
         kapps::core::WinLinkReader _reader;
@@ -216,9 +243,15 @@ namespace
         // Map of found apps by the target name.  Keys are the _canonicalize_
         // target paths.
         std::unordered_map<std::wstring, ScannedApp> _apps;
+        // Links cached by prior scans, and links seen during this scan (keyed
+        // by link path).  Links that weren't seen in this scan are dropped
+        // from the cache.
+        LinkCache &_linkCache;
+        LinkCache _seenLinks;
     };
 
-    LinkScanner::LinkScanner()
+    LinkScanner::LinkScanner(LinkCache &linkCache)
+        : _linkCache{linkCache}
     {
         // Native separators to match canonicalized paths
         QString instDirNative = QDir::toNativeSeparators(Path::InstallationDir);
@@ -256,20 +289,23 @@ namespace
         return canonicalPath;
     }
 
-    void LinkScanner::readLink(const QString &baseFolderPath, const QFileInfo &link)
+    auto LinkScanner::resolveLink(const QString &linkPath) -> CachedLink
     {
-        const auto &linkFilePath{link.filePath().toStdWString()};
+        // An unusable link is cached with an empty target
+        CachedLink result{};
+
+        const auto &linkFilePath{linkPath.toStdWString()};
         if(!_reader.loadLink(linkFilePath))
-            return;
+            return result;
 
         std::wstring targetPath = _reader.getLinkTarget(linkFilePath);
         if(targetPath.empty())
-            return;
+            return result;
 
         // Canonicalize the target path
         std::wstring canonicalTarget{canonicalizePath(targetPath.c_str())};
         if(canonicalTarget.empty())
-            return; // Traced by canonicalizePath()
+            return result; // Traced by canonicalizePath()
 
         // QStringView provides endsWith()
         QStringView canonicalQstr{canonicalTarget.c_str(), static_cast<qsizetype>(canonicalTarget.size())};
@@ -278,12 +314,41 @@ namespace
         if(!canonicalQstr.endsWith(QStringLiteral(".exe"), Qt::CaseSensitivity::CaseInsensitive) ||
            canonicalQstr.startsWith(_piaBasePath.c_str(), Qt::CaseSensitivity::CaseInsensitive))
         {
-            return; // Not an executable, can't do anything with this.
+            return result; // Not an executable, can't do anything with this.
         }
 
+        result._canonicalTarget = std::move(canonicalTarget);
         // Get the argument length - if it fails that's fine, just use the
         // default max value
-        std::size_t argsLength = _reader.getArgsLength(linkFilePath);
+        result._argsLength = _reader.getArgsLength(linkFilePath);
+        return result;
+    }
+
+    void LinkScanner::readLink(const QString &baseFolderPath, const QFileInfo &link)
+    {
+        QString linkPath{link.filePath()};
+        QDateTime lastModified{link.lastModified()};
+
+        // Use the cached information if the link hasn't changed, otherwise
+        // read it again
+        CachedLink &cached = _seenLinks[linkPath];
+        auto itCached = _linkCache.find(linkPath);
+        if(itCached != _linkCache.end() &&
+           itCached->second._lastModified == lastModified)
+        {
+            cached = std::move(itCached->second);
+        }
+        else
+        {
+            cached = resolveLink(linkPath);
+            cached._lastModified = lastModified;
+        }
+
+        if(cached._canonicalTarget.empty())
+            return; // Can't use this link
+
+        const std::wstring &canonicalTarget = cached._canonicalTarget;
+        std::size_t argsLength = cached._argsLength;
 
         // Do we already have an app for this target?
         auto itExistingApp = _apps.find(canonicalTarget);
@@ -438,7 +503,7 @@ namespace
         return arch;
     }
 
-    QJsonArray LinkScanner::buildAppsArray() const
+    QJsonArray LinkScanner::buildAppsArray()
     {
         QJsonArray appsArray;
         const Architecture systemArch = getSystemArch();
@@ -448,23 +513,35 @@ namespace
             // (returns E_INVALIDARG if we give it a path with slashes instead
             // of backslashes).  ::PathRelativePathToW() also fails.
             QString linkPath = QDir::toNativeSeparators(app.second._link.filePath());
-            QString realPath = QFileInfo{linkPath}.symLinkTarget();
-            QString displayName{getLinkDisplayName(app.second._link, linkPath)};
-            // Windows apps are frequently cluttered with shortcuts to "help",
-            // "uninstall", etc. that don't make much sense if they're sorted
-            // away from the app they correspond to.  We can't reliably filter
-            // these out, but sort apps using folder names to keep them
-            // together in the list.
-            // In the future, we might display these folder names in some way.
-            QStringList folders{getFolderNames(app.second._basePath, linkPath)};
-            const auto arch = checkExecutableArch(qstringWBuf(realPath));
-            if (executableIsCompatible(systemArch, arch))
+
+            // Always present, readLink() added it
+            CachedLink &cached = _seenLinks[app.second._link.filePath()];
+            if(!cached._haveAppInfo)
+            {
+                QString realPath = QFileInfo{linkPath}.symLinkTarget();
+                cached._displayName = getLinkDisplayName(app.second._link, linkPath);
+                // Windows apps are frequently cluttered with shortcuts to "help",
+                // "uninstall", etc. that don't make much sense if they're sorted
+                // away from the app they correspond to.  We can't reliably filter
+                // these out, but sort apps using folder names to keep them
+                // together in the list.
+                // In the future, we might display these folder names in some way.
+                cached._folders = getFolderNames(app.second._basePath, linkPath);
+                const auto arch = checkExecutableArch(qstringWBuf(realPath));
+                cached._compatible = executableIsCompatible(systemArch, arch);
+                cached._haveAppInfo = true;
+            }
+            if (cached._compatible)
             {
-                appsArray.append(SystemApplication{linkPath, std::move(displayName),
-                                 std::move(folders)}.toJsonObject());
+                appsArray.append(SystemApplication{linkPath, cached._displayName,
+                                 cached._folders}.toJsonObject());
             }
 
         }
+
+        // Keep only the links seen by this scan for the next scan
+        _linkCache = std::move(_seenLinks);
+        _seenLinks.clear();
         return appsArray;
     }
 
@@ -700,13 +777,13 @@ namespace
 // access any members of WinAppScanner, which is why it's static - a pointer
 // to the WinAppScanner is provided just to queue the result back to the
 // main thread.
-void WinAppScanner::scanOnThread(WinAppScanner *pScanner)
+void WinAppScanner::scanOnThread(WinAppScanner *pScanner, LinkCache &linkCache)
 {
     QJsonArray nativeApps;
 
     try
     {
-        LinkScanner scanner;
+        LinkScanner scanner{linkCache};
 
         // Scan programs in the global start menu
         scanner.scanDirectory(FOLDERID_CommonPrograms);
@@ -719,6 +796,14 @@ void WinAppScanner::scanOnThread(WinAppScanner *pScanner)
         qWarning() << "Unable to scan applications:" << ex;
     }
 
+    // Show the native apps now; enumerating and inspecting UWP apps takes a
+    // while longer
+    QMetaObject::invokeMethod(pScanner,
+        [pScanner, nativeApps]()
+        {
+            emit pScanner->applicationsFound(nativeApps);
+        }, Qt::ConnectionType::QueuedConnection);
+
     auto uwpApps = getWinRtSupport().getUwpApps();
 
     // Finished scanning the applications, finalize and emit on main thread
@@ -740,6 +825,7 @@ private:
 };
 
 WinAppScanner::WinAppScanner()
+    : _pLinkCache{new LinkCache{}}
 {
     // Initialize COM on the worker thread.
     _workerThread.invokeOnThread([this]()
@@ -751,11 +837,15 @@ WinAppScanner::WinAppScanner()
     });
 }
 
+WinAppScanner::~WinAppScanner()
+{
+}
+
 void WinAppScanner::scanApplications()
 {
     // Kick off the scan on the worker thread.  When it's complete, it'll queue
     // a call back to the main thread to emit applicationScanComplete().
-    _workerThread.queueOnThread([this](){scanOnThread(this);});
+    _workerThread.queueOnThread([this](){scanOnThread(this, *_pLinkCache);});
 }
 
 void WinAppScanner::completeScan(QJsonArray nativeApps,
@@ -25,20 +25,30 @@
 #include "../appscanner.h"
 #include "../../extras/winrtsupport/src/winrtsupport.h"
 #include <common/src/thread.h>
+#include <memory>
+#include <unordered_map>
 
 class WinAppScanner : public AppScanner
 {
     Q_OBJECT
 
+public:
+    // Shell links read by prior scans, keyed by link path (defined in
+    // win_appscanner.cpp)
+    struct CachedLink;
+    using LinkCache = std::unordered_map<QString, CachedLink>;
+
 private:
     // Scan for native and UWP apps on a worker thread.  The COM APIs used to do
     // this take a measurable amount of time, so this is done on a worker thread
-    // asynchronously.  (It can't access any members of WinAppScanner, which is
-    // why it's static.)
-    static void scanOnThread(WinAppScanner *pScanner);
+    // asynchronously.  (It can't access any members of WinAppScanner other than
+    // the link cache, which is only used on the worker thread - that's why
+    // it's static.)
+    static void scanOnThread(WinAppScanner *pScanner, LinkCache &linkCache);
 
 public:
     WinAppScanner();
+    ~WinAppScanner() override;
 
 private:
     // Finish the app scan on the main thread.  This receives the results from
@@ -51,6 +61,9 @@ public:
     virtual void scanApplications() override;
 
 private:
+    // Only accessed on the worker thread.  Declared before _workerThread so the
+    // thread is shut down before this is destroyed.
+    std::unique_ptr<LinkCache> _pLinkCache;
     RunningWorkerThread _workerThread;
 };
 
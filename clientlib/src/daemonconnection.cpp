@@ -20,6 +20,26 @@
 #line SOURCE_FILE("daemonconnection.cpp")
 
 #include "daemonconnection.h"
+#include <common/src/jsondelta.h>
+#include <common/src/statemirror.h>
+#include <QCborMap>
+#include <QCborValue>
+
+namespace
+{
+    // Apply the structural deltas for one group of properties (see
+    // Daemon::pushDataChanges()), adding the patched values to 'props'.
+    void applyDataDeltas(const NativeJsonObject &target, QJsonObject &props,
+                         const QJsonValue &groupDeltas)
+    {
+        const auto &deltasObj = groupDeltas.toObject();
+        for(auto itDelta = deltasObj.begin(); itDelta != deltasObj.end(); ++itDelta)
+        {
+            props.insert(itDelta.key(),
+                         jsonPatch(target.get(itDelta.key()), itDelta.value()));
+        }
+    }
+}
 
 DaemonConnection::DaemonConnection(QObject* parent)
     : QObject(parent)
@@ -92,6 +112,25 @@ void DaemonConnection::connectToDaemon()
     _ipc = new ThreadedLocalIPCConnection(this);
 
     connect(_ipc, &IPCConnection::connected, this, &DaemonConnection::socketConnected);
+    // Ask for the compact "data" encoding.  Older daemons just reject this
+    // with "method not found", and we continue to receive plain JSON.  If
+    // we've received data before, the daemon can resume from that version
+    // instead of sending the full state again.
+    connect(_ipc, &IPCConnection::connected, this, [this]()
+    {
+        // Subscriptions must be sent first so they apply to the initial
+        // snapshot.  Older daemons ignore this too and send everything.
+        if(!_subscriptions.isEmpty())
+            post(QStringLiteral("subscribeProperties"), {_subscriptions});
+
+        QJsonObject capabilities{
+            {QStringLiteral("cbor"), true},
+            {QStringLiteral("deltas"), true}
+        };
+        if(!_dataVersion.isEmpty())
+            capabilities.insert(QStringLiteral("resumeVersion"), _dataVersion);
+        post(QStringLiteral("negotiateDataEncoding"), {capabilities});
+    });
     connect(_ipc, &IPCConnection::disconnected, this, &DaemonConnection::socketDisconnected);
     connect(_ipc, &IPCConnection::error, this, &DaemonConnection::socketError);
 
@@ -102,17 +141,68 @@ void DaemonConnection::connectToDaemon()
     _ipc->connectToServer();
 }
 
+void DaemonConnection::setPropertySubscriptions(QJsonObject subscriptions)
+{
+    // The daemon can't resume a connection from data that was filtered
+    // differently
+    if(subscriptions != _subscriptions)
+        _dataVersion.clear();
+    _subscriptions = std::move(subscriptions);
+}
+
+bool DaemonConnection::readStateMirror()
+{
+    const QByteArray &snapshotData = ::readStateMirror();
+    if(snapshotData.isEmpty())
+        return false;
+
+    QCborParserError parseError{};
+    const QCborMap &snapshot = QCborValue::fromCbor(snapshotData, &parseError).toMap();
+    if(parseError.error != QCborError::NoError || snapshot.isEmpty())
+    {
+        qWarning() << "Unable to parse state mirror snapshot:" << parseError.errorString();
+        return false;
+    }
+
+    state.assign(snapshot.value(QStringLiteral("state")).toJsonValue().toObject());
+    settings.assign(snapshot.value(QStringLiteral("settings")).toJsonValue().toObject());
+    qInfo() << "Read state mirror snapshot" << snapshot.value(QStringLiteral("version")).toString()
+        << "-" << snapshotData.size() << "bytes";
+    return true;
+}
+
 void DaemonConnection::RPC_data(const QJsonObject &data)
 {
     QJsonObject::const_iterator it;
+    const auto &deltas = data.value(QStringLiteral("deltas")).toObject();
+    try
+    {
 #define AssignObject(name) \
-    if ((it = data.find(QStringLiteral(#name))) != data.end() && it.value().isObject()) this->name.assign(it.value().toObject())
+        if ((it = data.find(QStringLiteral(#name))) != data.end() && it.value().isObject()) \
+        { \
+            QJsonObject props = it.value().toObject(); \
+            applyDataDeltas(this->name, props, deltas.value(QStringLiteral(#name))); \
+            this->name.assign(props); \
+        }
 
-    AssignObject(data);
-    AssignObject(account);
-    AssignObject(settings);
-    AssignObject(state);
+        AssignObject(data);
+        AssignObject(account);
+        AssignObject(settings);
+        AssignObject(state);
 #undef AssignObject
+    }
+    catch(const Error &ex)
+    {
+        // Our baseline doesn't match the daemon's, we can't apply any further
+        // deltas.  Drop the connection; reconnecting resyncs the full state.
+        qWarning() << "Unable to apply data delta from daemon:" << ex;
+        _dataVersion.clear();
+        _ipc->close();
+        return;
+    }
+
+    if(data.contains(QStringLiteral("version")))
+        _dataVersion = data.value(QStringLiteral("version")).toString();
 
     if (!_connected && _ipc->isConnected())
     {
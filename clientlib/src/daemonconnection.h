@@ -43,6 +43,19 @@ public:
     void connectToDaemon();
     bool isConnected() const { return _connected; }
 
+    // Receive only a subset of the daemon's properties (see
+    // ClientConnection::setSubscriptions() in the daemon for the format).
+    // Lightweight clients like the CLI use this to avoid receiving large
+    // properties they don't use.  This is sent when the connection is
+    // established, so set it before the connection completes; it applies to
+    // later connections too.
+    void setPropertySubscriptions(QJsonObject subscriptions);
+
+    // Load the state and settings from the daemon's state mirror (see
+    // statemirror.h) without connecting.  Returns false if the mirror isn't
+    // available; the caller should connect normally in that case.
+    bool readStateMirror();
+
 // Information gathered from the daemon to display in the client
 public:
     // List of server locations and certificate info
@@ -98,6 +111,11 @@ private:
     ClientSideInterface* _rpc;
     QTimer _connectionTimer;
     bool _connected;
+    // Version token of the last "data" notification.  Sent when reconnecting
+    // so the daemon only has to send properties that have changed since.
+    QString _dataVersion;
+    // Property subscriptions - empty to receive all properties
+    QJsonObject _subscriptions;
 };
 
 #endif
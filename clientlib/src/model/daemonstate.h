@@ -73,19 +73,25 @@ public:
     JsonField(QString, externalVpnIp, {})
     JsonField(QJsonValue, chosenTransport, {})
     JsonField(QJsonValue, actualTransport, {})
-    JsonField(QJsonObject, vpnLocations, {})
-    JsonField(QJsonObject, shadowsocksLocations, {})
+    // The large location and metadata properties are lazy - they're only
+    // converted if something reads them (see JsonLazyField())
+    JsonLazyField(QJsonObject, vpnLocations, {})
+    JsonLazyField(QJsonObject, shadowsocksLocations, {})
     JsonField(QJsonObject, connectingConfig, {})
     JsonField(QJsonObject, connectedConfig, {})
     JsonField(QJsonObject, nextConfig, {})
     JsonField(QJsonValue, connectedServer, {})
-    JsonField(QJsonObject, availableLocations, {})
-    JsonField(QJsonObject, regionsMetadata, {})
-    JsonField(QJsonArray, groupedLocations, {})
-    JsonField(QJsonArray, dedicatedIpLocations, {})
+    JsonLazyField(QJsonObject, availableLocations, {})
+    JsonLazyField(QJsonObject, regionsMetadata, {})
+    JsonLazyField(QJsonArray, groupedLocations, {})
+    JsonLazyField(QJsonArray, dedicatedIpLocations, {})
+    JsonLazyField(QJsonObject, latencyStatistics, {})
     JsonField(QJsonArray, openvpnUdpPortChoices, {})
     JsonField(QJsonArray, openvpnTcpPortChoices, {})
-    JsonField(QJsonArray, intervalMeasurements, {})
+    JsonLazyField(QJsonArray, intervalMeasurements, {})
+    JsonField(QJsonArray, connectionTimeline, {})
+    JsonField(QJsonObject, lastFirewallApply, {})
+    JsonField(QJsonObject, totalFirewallApply, {})
     JsonField(qint64, connectionTimestamp, {})
     JsonField(QStringList, overridesFailed, {})
     JsonField(QStringList, overridesActive, {})
@@ -17,6 +17,17 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "apibase.h"
+#include <algorithm>
+
+namespace
+{
+    // Minimum number of latency samples before a base's requests are hedged
+    const unsigned minHedgeSamples{5};
+    // Minimum hedge delay - very fast bases aren't worth hedging, a short
+    // hiccup would send an extra request every time.
+    const std::chrono::milliseconds minHedgeDelay{250};
+}
+
 ApiBaseData::ApiBaseData(const std::vector<QString> &baseUris)
     : _baseUris{}, _nextStartIndex{0}
 {
@@ -72,6 +83,35 @@ void ApiBaseData::attemptSucceeded(unsigned successIndex)
     _nextStartIndex = successIndex;
 }
 
+void ApiBaseData::recordLatency(unsigned index, std::chrono::milliseconds latency)
+{
+    Q_ASSERT(index < _baseUris.size());  // Guaranteed by caller
+    if(_latencies.size() < _baseUris.size())
+        _latencies.resize(_baseUris.size());
+
+    LatencyHistory &history = _latencies[index];
+    history.samples[history.next] = latency;
+    history.next = (history.next + 1) % latencySampleCount;
+    if(history.count < latencySampleCount)
+        ++history.count;
+}
+
+std::chrono::milliseconds ApiBaseData::getHedgeDelay(unsigned index) const
+{
+    if(_baseUris.size() < 2 || index >= _latencies.size())
+        return {};
+    const LatencyHistory &history = _latencies[index];
+    if(history.count < minHedgeSamples)
+        return {};
+
+    auto samples = history.samples;
+    auto end = samples.begin() + history.count;
+    // Index of the 90th percentile - ceil(0.9 * count) - 1
+    auto percentile = samples.begin() + (history.count * 9 + 9) / 10 - 1;
+    std::nth_element(samples.begin(), percentile, end);
+    return std::max(*percentile, minHedgeDelay);
+}
+
 ApiBaseSequence FixedApiBase::beginAttempt()
 {
     Q_ASSERT(_pData);   // Class invariant
@@ -102,8 +142,16 @@ BaseUri ApiBaseSequence::getNextUri()
     return _pData->getUri(_currentBaseUri);
 }
 
-void ApiBaseSequence::attemptSucceeded()
+std::chrono::milliseconds ApiBaseSequence::getHedgeDelay() const
+{
+    Q_ASSERT(_pData);   // Class invariant
+    return _pData->getHedgeDelay(_currentBaseUri);
+}
+
+void ApiBaseSequence::attemptSucceeded(unsigned baseIndex,
+                                       std::chrono::milliseconds latency)
 {
     Q_ASSERT(_pData);   // Class invariant
-    _pData->attemptSucceeded(_currentBaseUri);
+    _pData->attemptSucceeded(baseIndex);
+    _pData->recordLatency(baseIndex, latency);
 }
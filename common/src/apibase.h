@@ -24,6 +24,8 @@
 
 #include "openssl.h"
 #include <QSharedPointer>
+#include <array>
+#include <chrono>
 #include <vector>
 #include <initializer_list>
 
@@ -64,7 +66,8 @@ struct COMMON_EXPORT BaseUri
 // Data used by both ApiBase and ApiBaseSequence - the actual base URIs and the
 // last successful one.
 // Note that this is not currently thread-safe; all API requests of any kind are
-// handled on the main thread.
+// sequenced on the main thread.  (The requests themselves may be sent on
+// ApiNetwork's network thread, but they don't use ApiBaseData there.)
 class COMMON_EXPORT ApiBaseData
 {
 public:
@@ -91,9 +94,34 @@ public:
     BaseUri getUri(unsigned index);
     void attemptSucceeded(unsigned successIndex);
 
+    // Record the latency of a successful request to a base URI.
+    void recordLatency(unsigned index, std::chrono::milliseconds latency);
+    // Get the delay after which a request to a base URI should be hedged by
+    // also sending it to the next base URI.  This is the 90th percentile of
+    // the recent latencies for that base, so a request that's slower than
+    // usual is hedged, but a base that's slow all the time isn't.
+    //
+    // Returns 0 if requests shouldn't be hedged - there's only one base, or
+    // there's not enough latency history for this base yet.
+    std::chrono::milliseconds getHedgeDelay(unsigned index) const;
+
+private:
+    // Number of recent latencies kept for each base
+    static constexpr unsigned latencySampleCount = 16;
+
+    // Recent latencies for one base URI, in a ring buffer
+    struct LatencyHistory
+    {
+        std::array<std::chrono::milliseconds, latencySampleCount> samples;
+        unsigned count{0};
+        unsigned next{0};
+    };
+
 private:
     std::vector<BaseUri> _baseUris;
     unsigned _nextStartIndex;
+    // Latency history for each base URI; populated as requests succeed
+    std::vector<LatencyHistory> _latencies;
 };
 
 // ApiBaseSequence keeps track of the base URIs being used for a particular
@@ -106,7 +134,14 @@ public:
 
 public:
     BaseUri getNextUri();
-    void attemptSucceeded();
+    // Index of the base URI returned by the last getNextUri()
+    unsigned getCurrentIndex() const {return _currentBaseUri;}
+    // Hedge delay for the current base URI; see ApiBaseData::getHedgeDelay()
+    std::chrono::milliseconds getHedgeDelay() const;
+    // A request to a particular base succeeded (not necessarily the current
+    // one, if the request was hedged).  It becomes the first base tried for
+    // later requests, and the latency is recorded for hedging.
+    void attemptSucceeded(unsigned baseIndex, std::chrono::milliseconds latency);
 
 private:
     const QSharedPointer<ApiBaseData> _pData;
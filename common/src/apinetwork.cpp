@@ -23,10 +23,20 @@
 #include "testshim.h"
 #include <algorithm>
 #include <QNetworkProxyFactory>
+#include <QHostInfo>
 #include <atomic>
 
 namespace
 {
+    // QHostInfo doesn't provide the record TTLs, so API host addresses are
+    // refreshed after a fixed interval.  Stale addresses are still used for
+    // a while longer if the refresh hasn't completed.
+    const std::chrono::minutes hostRefreshTime{5};
+    const std::chrono::hours hostExpireTime{1};
+    // Limit on the number of cached hosts - there are only a few API hosts,
+    // this just ensures overrides can't grow it without bound
+    const int maxCachedHosts{64};
+
     // Counter used to vary the proxy username.
     //
     // QNetworkAccessManager caches connections, and we can no longer clear the
@@ -68,9 +78,24 @@ namespace
     private:
         const QNetworkProxy _proxy;
     };
+
+    void applyProxyTo(QNetworkAccessManager &manager,
+                      const nullable_t<QNetworkProxy> &proxy)
+    {
+        if(proxy)
+            manager.setProxyFactory(new UsernameCounterProxyFactory{*proxy});
+        else
+            manager.setProxyFactory(nullptr);
+        // Clear the connection cache now.  This kills any ongoing requests,
+        // but they were using the old proxy (or no proxy), so we want to
+        // abandon them anyway.
+        manager.clearConnectionCache();
+    }
 }
 
 ApiNetwork::ApiNetwork()
+    : _pNetworkThread{nullptr}, _pThreadAccessManager{nullptr},
+      _hostCacheEnabled{false}
 {
     _pAccessManager.reset(TestShim::create<QNetworkAccessManager>());
 }
@@ -90,19 +115,73 @@ void ApiNetwork::setProxy(QNetworkProxy proxy)
     //
     // Additionally, this proxy factory varies the username in order to trick
     // the QNAM connection cache.
-    getAccessManager().setProxyFactory(new UsernameCounterProxyFactory{std::move(proxy)});
-    // Clear the connection cache now.  It's possible that ongoing request might
-    // actually complete in this case, but since we're starting the proxy we
-    // want to abandon them anyway.
-    getAccessManager().clearConnectionCache();
+    _proxy = std::move(proxy);
+    applyProxy();
 }
 
 void ApiNetwork::clearProxy()
 {
-    getAccessManager().setProxyFactory(nullptr);
-    // Clear the connection cache now.  This kills any ongoing requests, but
-    // since we're shutting down the proxy, that's fine.
+    _proxy.clear();
+    applyProxy();
+}
+
+void ApiNetwork::applyProxy()
+{
+    applyProxyTo(getAccessManager(), _proxy);
+    if(_pNetworkThread)
+    {
+        // Queued like requests, so requests made before this still use the
+        // old proxy (and are killed by clearing the connection cache), and
+        // requests made after it use the new one.
+        QNetworkAccessManager *pManager = _pThreadAccessManager;
+        _pNetworkThread->queueOnThread([pManager, proxy = _proxy]()
+        {
+            applyProxyTo(*pManager, proxy);
+        });
+    }
+}
+
+void ApiNetwork::clearConnectionCache()
+{
     getAccessManager().clearConnectionCache();
+    invokeWithApiAccessManager([](QNetworkAccessManager &manager)
+    {
+        manager.clearConnectionCache();
+    });
+}
+
+void ApiNetwork::useNetworkThread(RunningWorkerThread *pNetworkThread)
+{
+    if(_pNetworkThread)
+    {
+        // Destroy the thread's QNetworkAccessManager, after any requests that
+        // were already queued.  Its replies are destroyed with it.
+        QNetworkAccessManager *pManager = _pThreadAccessManager;
+        _pNetworkThread->invokeOnThread([pManager](){delete pManager;});
+        _pThreadAccessManager = nullptr;
+        _pNetworkThread = nullptr;
+        qInfo() << "Stopped sending API requests on the network thread";
+    }
+
+    if(pNetworkThread)
+    {
+        QNetworkAccessManager *pManager{nullptr};
+        pNetworkThread->invokeOnThread([&]()
+        {
+            pManager = TestShim::create<QNetworkAccessManager>();
+            pManager->setParent(&pNetworkThread->objectOwner());
+        });
+        _pNetworkThread = pNetworkThread;
+        _pThreadAccessManager = pManager;
+        applyProxy();
+        qInfo() << "Sending API requests on the network thread";
+    }
+}
+
+void ApiNetwork::moveToApiThread(QObject &object)
+{
+    if(_pNetworkThread)
+        object.moveToThread(_pNetworkThread->objectOwner().thread());
 }
 
 QNetworkAccessManager &ApiNetwork::getAccessManager() const
@@ -111,4 +190,72 @@ QNetworkAccessManager &ApiNetwork::getAccessManager() const
     return *_pAccessManager;
 }
 
+QByteArray ApiNetwork::tlsSessionTicket(const QString &key) const
+{
+    return _tlsSessionTickets.value(key);
+}
+
+void ApiNetwork::storeTlsSessionTicket(const QString &key, QByteArray ticket)
+{
+    if(ticket.isEmpty())
+        _tlsSessionTickets.remove(key);
+    else
+        _tlsSessionTickets.insert(key, std::move(ticket));
+}
+
+QHostAddress ApiNetwork::cachedHostAddress(const QString &host)
+{
+    if(!_hostCacheEnabled || host.isEmpty())
+        return {};
+    // Nothing to do for IP addresses
+    if(!QHostAddress{host}.isNull())
+        return {};
+
+    auto itEntry = _hostCache.find(host);
+    if(itEntry == _hostCache.end())
+    {
+        refreshHost(host);
+        return {};
+    }
+
+    if(itEntry->refresh.hasExpired())
+        refreshHost(host);
+    if(itEntry->expire.hasExpired())
+        return {};
+
+    for(const auto &address : itEntry->addresses)
+    {
+        if(address.protocol() == QAbstractSocket::NetworkLayerProtocol::IPv4Protocol)
+            return address;
+    }
+    return itEntry->addresses.value(0);
+}
+
+void ApiNetwork::refreshHost(const QString &host)
+{
+    if(_pendingLookups.contains(host))
+        return;
+    _pendingLookups.insert(host);
+
+    QHostInfo::lookupHost(host, this, [this, host](const QHostInfo &info)
+    {
+        _pendingLookups.remove(host);
+        if(info.error() != QHostInfo::HostInfoError::NoError || info.addresses().isEmpty())
+        {
+            // Keep any existing addresses; they're still used until they
+            // expire
+            qInfo() << "Unable to resolve API host" << host << "-"
+                << info.errorString();
+            return;
+        }
+
+        if(!_hostCache.contains(host) && _hostCache.size() >= maxCachedHosts)
+            _hostCache.clear();
+        HostEntry &entry = _hostCache[host];
+        entry.addresses = info.addresses();
+        entry.refresh.setRemainingTime(hostRefreshTime);
+        entry.expire.setRemainingTime(hostExpireTime);
+    });
+}
+
 template class COMMON_EXPORT AutoSingleton<ApiNetwork>;
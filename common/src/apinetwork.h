@@ -22,7 +22,26 @@
 #ifndef APINETWORK_H
 #define APINETWORK_H
 
+#include "thread.h"
 #include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QHostAddress>
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QSet>
+
+// ApiRequestContext lives on the thread that sends an API request, alongside
+// its QNetworkReply (see ApiNetwork::moveToApiThread()).  It's shared by the
+// requesting thread and the network thread, so it should be owned by a
+// QSharedPointer with QObject::deleteLater() as the deleter.
+class COMMON_EXPORT ApiRequestContext : public QObject
+{
+    Q_OBJECT
+
+signals:
+    // Can be emitted from any thread to abort the request
+    void abortRequested();
+};
 
 // ApiNetwork keeps track of the local network address that we need to use for
 // API requests (such as server lists, web API, port forwarding/MACE).
@@ -31,6 +50,9 @@
 // requests, in order to bind outgoing connections to that interface.
 // (QNetworkAccessManager does not provide any way to bind its outgoing
 // connections.)
+//
+// API requests can be sent on a network thread (see useNetworkThread()); the
+// rest of ApiNetwork is only used on the main thread.
 class COMMON_EXPORT ApiNetwork : public QObject, public AutoSingleton<ApiNetwork>
 {
     Q_OBJECT
@@ -44,15 +66,102 @@ public:
     void setProxy(QNetworkProxy proxy);
     // Stop using a proxy for future requests.
     void clearProxy();
+    // Clear the connection cache of all QNetworkAccessManagers
+    void clearConnectionCache();
 
-    // Get the shared QNetworkAccessManager.  This object remains valid until
-    // static destruction.
+    // Send API requests on a network thread, so TLS handshakes, certificate
+    // verification, and reply handling don't delay IPC and connection state
+    // processing on the main thread.  A separate QNetworkAccessManager is
+    // created on that thread for API requests.
+    //
+    // Pass nullptr to stop using the network thread - this must be done
+    // before the thread is destroyed.  Requests still in progress on the
+    // network thread are abandoned.
+    //
+    // This is off by default so unit tests' mock replies stay on the test
+    // thread; the daemon enables it.
+    void useNetworkThread(RunningWorkerThread *pNetworkThread);
+
+    // Get the shared QNetworkAccessManager on the main thread.  This object
+    // remains valid until static destruction.  API requests should use
+    // invokeWithApiAccessManager() instead; this is used for downloads that
+    // are driven from the main thread.
     QNetworkAccessManager &getAccessManager() const;
 
+    // Move an object to the thread that sends API requests - used for objects
+    // that interact with API replies, like ApiRequestContext.  No effect if
+    // the network thread isn't in use.
+    void moveToApiThread(QObject &object);
+
+    // Invoke a functor with the QNetworkAccessManager for API requests, on
+    // the thread where it lives.  If the network thread is in use, this is
+    // queued to that thread; otherwise it's invoked synchronously.
+    template<class Func>
+    void invokeWithApiAccessManager(Func f)
+    {
+        if(_pNetworkThread)
+        {
+            QNetworkAccessManager *pManager = _pThreadAccessManager;
+            _pNetworkThread->queueOnThread([pManager, f]() mutable {f(*pManager);});
+        }
+        else
+            f(getAccessManager());
+    }
+
+    // TLS session tickets for API hosts.  Connections are intentionally never
+    // reused (see setProxy()), but requests can still resume the last TLS
+    // session with a host to avoid a full handshake.  The key identifies the
+    // host, port, and peer verify name; see NetworkTaskWithRetry.
+    QByteArray tlsSessionTicket(const QString &key) const;
+    // Store a new ticket for a host, or pass an empty ticket to discard it
+    void storeTlsSessionTicket(const QString &key, QByteArray ticket);
+
+    // Enable the API host address cache.  This is off by default so unit
+    // tests using mock hosts never do real lookups; the daemon enables it.
+    void enableHostCache() {_hostCacheEnabled = true;}
+
+    // Get a cached address for an API hostname, preferring IPv4 (the SOCKS
+    // proxy only supports IPv4).  Returns a null address if nothing has been
+    // resolved yet - the caller should just connect by name in that case.
+    //
+    // Resolving API hosts through the system resolver for every request adds
+    // latency to each API call, which is most noticeable while connecting.
+    // The cache is kept across connections, and a stale result is still
+    // returned while it's being refreshed (or if the refresh fails), since
+    // the API hosts rarely change addresses.  A missing or stale entry
+    // starts a lookup in the background.
+    QHostAddress cachedHostAddress(const QString &host);
+
 private:
+    void refreshHost(const QString &host);
+    // Apply the current proxy to all QNetworkAccessManagers
+    void applyProxy();
+
+private:
+    struct HostEntry
+    {
+        QList<QHostAddress> addresses;
+        // When the addresses should be refreshed
+        QDeadlineTimer refresh;
+        // When the addresses are too old to use at all
+        QDeadlineTimer expire;
+    };
+
     // The QNetworkAccessManager used for all connections.  Dynamically
     // allocated so it can be mocked in unit tests.
     std::unique_ptr<QNetworkAccessManager> _pAccessManager;
+    // The network thread and its QNetworkAccessManager, if in use.  The
+    // QNetworkAccessManager is owned by the network thread's objectOwner().
+    RunningWorkerThread *_pNetworkThread;
+    QNetworkAccessManager *_pThreadAccessManager;
+    // The proxy set by setProxy(), if any - applied to the network thread's
+    // QNetworkAccessManager when it's created
+    nullable_t<QNetworkProxy> _proxy;
+    QHash<QString, QByteArray> _tlsSessionTickets;
+    bool _hostCacheEnabled;
+    QHash<QString, HostEntry> _hostCache;
+    // Hosts with a lookup in progress
+    QSet<QString> _pendingLookups;
 };
 
 extern template class COMMON_EXPORT_TMPL_SPEC_DECL AutoSingleton<ApiNetwork>;
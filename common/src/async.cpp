@@ -22,6 +22,8 @@
 #include "async.h"
 
 #include <QMutex>
+#include <algorithm>
+#include <thread>
 
 // If we guarantee that all Tasks will be owned/managed by the main thread, this mutex is unnecessary
 static QMutex g_taskMutex;
@@ -35,7 +37,9 @@ static inline const QMetaMethod& taskFinishedSignal()
 }
 
 BaseTask::BaseTask(QObject *parent)
-    : QObject(parent), _error(HERE, Error::TaskStillPending)
+    : QObject(parent), _error(HERE, Error::TaskStillPending),
+      _pFirstContinuation{}, _pLastContinuation{},
+      _continuationsDispatched{false}
 {
     QMutexLocker lock(&g_taskMutex);
     insertLast(&g_taskList);
@@ -44,6 +48,14 @@ BaseTask::BaseTask(QObject *parent)
 
 BaseTask::~BaseTask()
 {
+    // Any remaining continuations are for recipients that have been destroyed
+    // (a live recipient would be keeping us alive)
+    while (_pFirstContinuation)
+    {
+        std::unique_ptr<impl::Continuation> pContinuation{_pFirstContinuation};
+        _pFirstContinuation = pContinuation->_pNext;
+    }
+
     // Unlink us from the task list while holding the task lock.
     QMutexLocker lock(&g_taskMutex);
     remove();
@@ -98,6 +110,133 @@ void BaseTask::disconnectDependents()
     // that tasks are only manipulated while holding strong references.
 }
 
+void BaseTask::lock()
+{
+    while (_lock.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+void BaseTask::unlock()
+{
+    _lock.clear(std::memory_order_release);
+}
+
+void BaseTask::addDependency(QSharedPointer<BaseTask> pDependency)
+{
+    lock();
+    _dependencies.push_back(std::move(pDependency));
+    unlock();
+}
+
+void BaseTask::releaseDependency(const BaseTask* pDependency)
+{
+    // Release the reference after unlocking, this could destroy the
+    // dependency
+    QSharedPointer<BaseTask> pReleased;
+    lock();
+    auto itDependency = std::find_if(_dependencies.begin(), _dependencies.end(),
+        [&](const QSharedPointer<BaseTask>& pTask) { return pTask.get() == pDependency; });
+    if (itDependency != _dependencies.end())
+    {
+        pReleased = std::move(*itDependency);
+        _dependencies.erase(itDependency);
+    }
+    unlock();
+}
+
+void BaseTask::deliverContinuation(std::unique_ptr<impl::Continuation> pContinuation)
+{
+    auto pRecipient = pContinuation->_pRecipient.toStrongRef();
+    // If the recipient has been destroyed, there's nothing to do
+    if (!pRecipient)
+        return;
+
+    const auto type = pContinuation->_type;
+    if (type == Qt::DirectConnection || (type == Qt::AutoConnection && pRecipient->thread() == QThread::currentThread()))
+    {
+        pContinuation->invoke(*this);
+        pRecipient->releaseDependency(this);
+        return;
+    }
+
+    // Queue it to the recipient's thread.  Keep this task alive until then;
+    // if it's being destroyed (rejected from destructorCheck()), it's too
+    // late to do that.
+    auto self = sharedFromThis();
+    if (!self)
+        return;
+    const auto actualType = static_cast<Qt::ConnectionType>(type & ~Qt::UniqueConnection);
+    QSharedPointer<impl::Continuation> pQueued{pContinuation.release()};
+    QMetaObject::invokeMethod(pRecipient.get(), [self, pQueued]
+    {
+        auto pRecipient = pQueued->_pRecipient.toStrongRef();
+        if (!pRecipient)
+            return;
+        pQueued->invoke(*self);
+        pRecipient->releaseDependency(self.get());
+    }, actualType);
+}
+
+void BaseTask::dispatchContinuations()
+{
+    lock();
+    impl::Continuation* pFirst = _pFirstContinuation;
+    _pFirstContinuation = _pLastContinuation = nullptr;
+    _continuationsDispatched = true;
+    unlock();
+
+    // Own the whole list before delivering any of them, so they're all freed
+    // even if a callback throws
+    struct ContinuationList
+    {
+        impl::Continuation* pFirst;
+        ~ContinuationList()
+        {
+            while (pFirst)
+            {
+                std::unique_ptr<impl::Continuation> pContinuation{pFirst};
+                pFirst = pContinuation->_pNext;
+            }
+        }
+    } continuations{pFirst};
+
+    while (continuations.pFirst)
+    {
+        std::unique_ptr<impl::Continuation> pContinuation{continuations.pFirst};
+        continuations.pFirst = pContinuation->_pNext;
+        deliverContinuation(std::move(pContinuation));
+    }
+}
+
+void BaseTask::addContinuation(const QSharedPointer<BaseTask>& pRecipient, std::unique_ptr<impl::Continuation> pContinuation)
+{
+    Q_ASSERT(pRecipient);    // Ensured by caller
+    setConnected();
+
+    // The recipient keeps us alive until the continuation is delivered.  Add
+    // this first, since we could finish on another thread as soon as the
+    // continuation is added.  (If we're not owned by a QSharedPointer yet, no
+    // one else can have a reference to us either.)
+    if (auto self = sharedFromThis())
+        pRecipient->addDependency(std::move(self));
+
+    lock();
+    if (!_continuationsDispatched)
+    {
+        if (_pLastContinuation)
+            _pLastContinuation->_pNext = pContinuation.get();
+        else
+            _pFirstContinuation = pContinuation.get();
+        _pLastContinuation = pContinuation.release();
+        unlock();
+        return;
+    }
+    unlock();
+
+    // Already finished, deliver it now
+    deliverContinuation(std::move(pContinuation));
+}
+
 void BaseTask::resetTaskIndex()
 {
     QMutexLocker lock(&g_taskMutex);
@@ -154,9 +293,10 @@ void BaseTask::reject(Error error)
     {
         _error = std::move(error);
         notifyRejected();
-        // We have to keep the task alive, in case slots connected to finished()
-        // drop their reference when the signal is emitted
+        // We have to keep the task alive, in case continuations or slots
+        // connected to finished() drop their reference
         auto keepAlive = sharedFromThis();
+        dispatchContinuations();
         emit finished();
         // This must be called last in the function
         disconnectDependents();
@@ -260,9 +400,10 @@ void Task<void>::resolve()
     if (setFinished(Resolved))
     {
         _error = Error(HERE, Error::Success);
-        // We have to keep the task alive, in case slots connected to finished()
-        // drop their reference when the signal is emitted
+        // We have to keep the task alive, in case continuations or slots
+        // connected to finished() drop their reference
         auto keepAlive = sharedFromThis();
+        dispatchContinuations();
         emit finished();
         // This must be called last in the function
         disconnectDependents();
@@ -30,6 +30,8 @@
 #include <QTimer>
 
 #include <atomic>
+#include <memory>
+#include <vector>
 
 /*
 
@@ -130,12 +132,20 @@ a mistake. For every task, you should do one of the following:
 --- Lifetime management ---
 
 As a general rule, tasks hold strong references to their dependencies and
-weak references to their dependents. Qt's signal system is used to invoke
-callbacks in the dependent's context, while holding a strong reference to
-the parent task as a lambda capture. Once a task finishes, it disconnects
-all its listeners, which, if the listener was the only thing holding a
-reference to the parent, properly disposes of the parent when it is no
-longer needed.
+weak references to their dependents. When the recipient of a callback is
+another task (as it is for 'then', 'except', 'next', 'race' and 'all'), the
+parent task keeps a lightweight continuation holding a weak reference to the
+recipient, and the recipient holds a strong reference to the parent. Once
+the parent finishes and the continuation has been delivered, the recipient
+releases that reference, which properly disposes of the parent when it is no
+longer needed. If the recipient is destroyed first, the parent is released
+along with it.
+
+Continuations are invoked directly when the recipient lives in the thread
+that finishes the task; otherwise they're queued to the recipient's thread.
+Callbacks for recipients that aren't tasks use Qt's signal system instead,
+holding a strong reference to the parent as a lambda capture until the
+parent finishes or the recipient is destroyed.
 
 
 --- Running tasks without keeping a reference ---
@@ -150,7 +160,7 @@ If you don't care about the actual result and just want the task to run
 until completion, you can use the 'runUntilFinished' function, which behaves
 like 'notify' but with an empty callback.
 
-In both cases a signal connection between the task and a recipient object
+In both cases a continuation or signal connection for the recipient object
 is what keeps the task alive, so if the recipient is destroyed the task will
 be abandoned as well. While the recipient/context argument is optional, you
 should always pass it so the task doesn't outlive its recipient.
@@ -180,6 +190,12 @@ or the task can expire unexpectedly. (The 'notify' function does this for
 you if the recipient is a Task object.)
 
 
+--- Coroutines ---
+
+When built as C++20, asynccoroutine.h allows functions returning Async<T> to
+be written as coroutines that co_await other Asyncs.  See that header.
+
+
 */
 
 
@@ -263,6 +279,51 @@ namespace impl {
     template<typename T> T* getNakedPointer(const QPointer<T>& ptr) { return ptr.data(); }
     template<typename T> T* getNakedPointer(T* ptr) { return ptr; }
 
+    // Get a strong reference to a recipient if it's a task that can receive
+    // a continuation.  This is null for other QObjects, and for tasks that
+    // aren't owned by a QSharedPointer yet (notify() called in a constructor).
+    template<typename T> auto recipientTask(T* ptr) -> std::enable_if_t< std::is_base_of<BaseTask, T>::value, QSharedPointer<BaseTask>>;
+    template<typename T> auto recipientTask(T*) -> std::enable_if_t<!std::is_base_of<BaseTask, T>::value, QSharedPointer<BaseTask>> { return {}; }
+
+    // A callback attached to a task for a recipient that is also a task; see
+    // BaseTask::addContinuation().  Continuations are linked in a list owned
+    // by the task, and the callable is stored in the same allocation.
+    class COMMON_EXPORT Continuation
+    {
+    public:
+        Continuation(QWeakPointer<BaseTask> pRecipient, Qt::ConnectionType type)
+            : _pNext{}, _pRecipient{std::move(pRecipient)}, _type{type}
+        {}
+        virtual ~Continuation() = default;
+
+    private:
+        Continuation(const Continuation&) = delete;
+        Continuation& operator=(const Continuation&) = delete;
+
+    public:
+        // Invoke the callback for a task that has finished
+        virtual void invoke(BaseTask& task) = 0;
+
+    public:
+        Continuation* _pNext;
+        QWeakPointer<BaseTask> _pRecipient;
+        Qt::ConnectionType _type;
+    };
+
+    template<typename Func>
+    class FuncContinuation : public Continuation
+    {
+    public:
+        FuncContinuation(QWeakPointer<BaseTask> pRecipient, Qt::ConnectionType type, Func func)
+            : Continuation{std::move(pRecipient), type}, _func{std::move(func)}
+        {}
+
+        virtual void invoke(BaseTask& task) override { _func(task); }
+
+    private:
+        Func _func;
+    };
+
 }
 
 // T -> QVector<T> but void -> void
@@ -322,6 +383,23 @@ protected:
     // from possibly arbitrary threads (whenever something is connected).
     std::atomic<uint> _state;
 
+private:
+    // Continuations and dependencies can be added from any thread, and the
+    // task can finish on any thread; _lock guards the members below.  It's
+    // only held for a few pointer operations, so it's a spin lock rather than
+    // a mutex.
+    std::atomic_flag _lock = ATOMIC_FLAG_INIT;
+    // Continuations to invoke when this task finishes, in the order they were
+    // added.  Once they've been dispatched, _continuationsDispatched is set
+    // and continuations added later are delivered immediately.
+    impl::Continuation* _pFirstContinuation;
+    impl::Continuation* _pLastContinuation;
+    bool _continuationsDispatched;
+    // Tasks that this task receives continuations from.  These are kept alive
+    // until they've delivered the continuation (or until this task is
+    // destroyed).
+    std::vector<QSharedPointer<BaseTask>> _dependencies;
+
 private:
     // Constructor is private so only our friend subclass Tasks can construct.
     explicit BaseTask(QObject* parent = nullptr);
@@ -333,6 +411,17 @@ private:
     // ourselves, so this is only called last in any function.
     void disconnectDependents();
 
+    void lock();
+    void unlock();
+    void addDependency(QSharedPointer<BaseTask> pDependency);
+    void releaseDependency(const BaseTask* pDependency);
+    // Deliver a continuation, in the recipient's thread - directly if that's
+    // the current thread, or queued otherwise.
+    void deliverContinuation(std::unique_ptr<impl::Continuation> pContinuation);
+    // Deliver all continuations; called when the task finishes.
+    void dispatchContinuations();
+    void addContinuation(const QSharedPointer<BaseTask>& pRecipient, std::unique_ptr<impl::Continuation> pContinuation);
+
 public:
     virtual ~BaseTask() override;
 
@@ -384,8 +473,26 @@ protected:
 
     bool setConnected();
     bool setFinished(State state);
+
+    // Add a continuation that invokes func(BaseTask&) with this task in
+    // pRecipient's thread when this task finishes (or right away if it's
+    // already finished).  This is used by notify() when the recipient is a
+    // task, it's much cheaper than a signal connection, and chains use it
+    // heavily.
+    template<typename Func>
+    void addContinuation(const QSharedPointer<BaseTask>& pRecipient, Func&& func, Qt::ConnectionType type)
+    {
+        addContinuation(pRecipient, std::unique_ptr<impl::Continuation>{
+            new impl::FuncContinuation<std::decay_t<Func>>{pRecipient, type, std::forward<Func>(func)}});
+    }
 };
 
+template<typename T>
+inline auto impl::recipientTask(T* ptr) -> std::enable_if_t<std::is_base_of<BaseTask, T>::value, QSharedPointer<BaseTask>>
+{
+    return ptr->BaseTask::sharedFromThis();
+}
+
 // Templated task implementation that can resolve to a particular value,
 // which upon completion can be accessed with the result() function. If the
 // task ends with rejection or an exception, the error is instead accessible
@@ -1052,9 +1159,10 @@ inline void Task<Result>::resolve(Args&&... args)
     {
         _error = Error(HERE, Error::Success);
         new(_result) Result(std::forward<Args>(args)...);
-        // We have to keep the task alive, in case slots connected to finished()
-        // drop their reference when the signal is emitted
+        // We have to keep the task alive, in case continuations or slots
+        // connected to finished() drop their reference
         auto keepAlive = sharedFromThis();
+        dispatchContinuations();
         emit finished();
         // This must be called last in the function
         disconnectDependents();
@@ -1130,6 +1238,17 @@ template<typename Result>
 template<class Recipient, typename Func>
 inline auto Task<Result>::notify(Recipient* recipient, Func&& fn, Qt::ConnectionType type) -> std::enable_if_t<!std::is_function<Recipient>::value>
 {
+    if (auto pRecipientTask = impl::recipientTask(recipient))
+    {
+        // The continuation keeps the recipient alive while it's invoked, like
+        // KeepAliveIfNeeded() below
+        addContinuation(pRecipientTask, [recipient, f = std::move(fn)](BaseTask& task) mutable {
+            auto& self = static_cast<Task<Result>&>(task);
+            impl::invoke(recipient, f, self.error(), self.result());
+        }, type);
+        return;
+    }
+
     const bool done = isFinished();
     const auto actualType = static_cast<Qt::ConnectionType>(type & ~Qt::UniqueConnection);
     if (done && (type == Qt::DirectConnection || (type == Qt::AutoConnection && recipient->thread() == QThread::currentThread())))
@@ -1232,6 +1351,14 @@ inline auto Task<void>::except(Context* context, Func&& fn, Qt::ConnectionType t
 template<class Recipient, typename Func>
 inline auto Task<void>::notify(Recipient* recipient, Func&& fn, Qt::ConnectionType type) -> std::enable_if_t<!std::is_function<Recipient>::value>
 {
+    if (auto pRecipientTask = impl::recipientTask(recipient))
+    {
+        addContinuation(pRecipientTask, [recipient, f = std::move(fn)](BaseTask& task) mutable {
+            impl::invoke(recipient, f, task.error());
+        }, type);
+        return;
+    }
+
     const bool done = isFinished();
     const auto actualType = static_cast<Qt::ConnectionType>(type & ~Qt::UniqueConnection);
     if (done && (type == Qt::DirectConnection || (type == Qt::AutoConnection && recipient->thread() == QThread::currentThread())))
@@ -0,0 +1,243 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#ifndef ASYNCCOROUTINE_H
+#define ASYNCCOROUTINE_H
+#pragma once
+
+#include "async.h"
+
+/*
+
+=== Coroutine support for Async<T> ===
+
+A function returning Async<T> can be written as a C++20 coroutine, using
+co_await to wait for other Asyncs instead of chaining then()/except():
+
+  Async<QString> Example::loadName()
+  {
+      QJsonDocument doc = co_await _apiClient.get(QStringLiteral("name"));
+      co_return doc.object().value("name").toString();
+  }
+
+- The coroutine starts running immediately when called (like a chain is
+  built immediately), and returns an Async<T> representing its result once
+  it first suspends.
+
+- co_await on an Async<T> evaluates to a copy of the result.  If the awaited
+  task rejects, its Error is thrown from co_await, so it can be handled with
+  try/catch like except().
+
+- co_return resolves the coroutine's task.  An exception escaping the
+  coroutine rejects it, like an exception thrown from a then() callback.
+
+- The coroutine is always resumed in the thread of its own task (the thread
+  that called it), like a then() callback using that task as the context.
+
+- The coroutine's task owns the coroutine frame.  If the returned Async is
+  abandoned, the frame is destroyed, which releases the Async being awaited
+  (abandoning it too if it's not referenced elsewhere).  The coroutine is not
+  resumed in that case - like any other task chain, the reference to the
+  returned Async is what keeps it running.
+
+The whole flow uses one coroutine frame, rather than a task and a callback
+for each step of a chain.
+
+This requires C++20 coroutines; the header is empty when they're not
+available.
+
+*/
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <optional>
+
+namespace impl {
+
+    // The task created for a coroutine returning Async<Result>; it owns the
+    // coroutine frame.
+    template<typename Result>
+    class CoroutineTask : public Task<Result>
+    {
+    public:
+        explicit CoroutineTask(std::coroutine_handle<> handle) : _handle{handle} {}
+        ~CoroutineTask() override
+        {
+            // The coroutine is suspended - either waiting for another task or
+            // at its final suspend point.  It's never running here, because
+            // it's only resumed by a continuation delivered to this task,
+            // which keeps the task alive until it returns.
+            if (_handle)
+                _handle.destroy();
+        }
+
+    private:
+        std::coroutine_handle<> _handle;
+    };
+
+    template<typename Result> class AsyncPromise;
+
+    // Parts of the promise type common to void and non-void results
+    template<typename Result>
+    class AsyncPromiseBase
+    {
+    private:
+        // Finish the task once the coroutine has reached its final suspend
+        // point.  Resolving the task can release the last reference to it,
+        // which destroys the coroutine frame (including this promise), so
+        // this must be the last thing done by the coroutine.
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<AsyncPromise<Result>> handle) noexcept
+            {
+                handle.promise().finish();
+            }
+            void await_resume() noexcept {}
+        };
+
+    public:
+        Async<Result> get_return_object()
+        {
+            QSharedPointer<CoroutineTask<Result>> pTask{new CoroutineTask<Result>{
+                std::coroutine_handle<AsyncPromise<Result>>::from_promise(
+                    static_cast<AsyncPromise<Result>&>(*this))}};
+            _pTask = pTask.get();
+            return Async<Result>{pTask};
+        }
+
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception()
+        {
+            GUARD_WITH([this](const Error& error) { _error = error; },
+                       std::rethrow_exception(std::current_exception()));
+        }
+
+        CoroutineTask<Result>* task() const { return _pTask; }
+
+    protected:
+        CoroutineTask<Result>* _pTask{};
+        std::optional<Error> _error;
+    };
+
+    template<typename Result>
+    class AsyncPromise : public AsyncPromiseBase<Result>
+    {
+    public:
+        template<typename Value>
+        void return_value(Value&& value) { _result.emplace(std::forward<Value>(value)); }
+
+        void finish() noexcept
+        {
+            // Move everything out of the frame first, it may be destroyed by
+            // resolve() or reject()
+            CoroutineTask<Result>* pTask = this->_pTask;
+            if (this->_error)
+            {
+                Error error{std::move(*this->_error)};
+                GUARD(pTask->reject(std::move(error)));
+            }
+            else
+            {
+                Result result{std::move(*_result)};
+                GUARD(pTask->resolve(std::move(result)));
+            }
+        }
+
+    private:
+        std::optional<Result> _result;
+    };
+
+    template<>
+    class AsyncPromise<void> : public AsyncPromiseBase<void>
+    {
+    public:
+        void return_void() {}
+
+        void finish() noexcept
+        {
+            CoroutineTask<void>* pTask = this->_pTask;
+            if (this->_error)
+            {
+                Error error{std::move(*this->_error)};
+                GUARD(pTask->reject(std::move(error)));
+            }
+            else
+                GUARD(pTask->resolve());
+        }
+    };
+
+    // Awaiter used by co_await on an Async<T>.  This holds a strong reference
+    // to the awaited task while the coroutine is waiting for it.
+    template<typename Result>
+    class AsyncAwaiter
+    {
+    public:
+        explicit AsyncAwaiter(QSharedPointer<Task<Result>> pTask) : _pTask{std::move(pTask)}
+        {
+            Q_ASSERT(_pTask);   // Ensured by caller
+        }
+
+        bool await_ready() const { return _pTask->isFinished(); }
+
+        template<typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> handle)
+        {
+            // Resume in the thread of the coroutine's task.  If that task is
+            // destroyed first, this isn't delivered, and the frame is destroyed
+            // with the task.  This may resume the coroutine before returning if
+            // the task finishes concurrently, so it must be the last thing done
+            // here.
+            _pTask->notify(handle.promise().task(), [handle] { handle.resume(); });
+        }
+
+        Result await_resume()
+        {
+            if (_pTask->isRejected())
+                throw _pTask->error();
+            if constexpr (!std::is_void<Result>::value)
+                return _pTask->result();
+        }
+
+    private:
+        QSharedPointer<Task<Result>> _pTask;
+    };
+
+}
+
+template<typename Type, typename Result, class Class>
+inline impl::AsyncAwaiter<Result> operator co_await(Async<Type, Result, Class> task)
+{
+    return impl::AsyncAwaiter<Result>{std::move(task)};
+}
+
+namespace std {
+    // Allow Async<T> to be returned by coroutines
+    template<typename Result, typename... Args>
+    struct coroutine_traits<Async<Result, Result, Task<Result>>, Args...>
+    {
+        using promise_type = impl::AsyncPromise<Result>;
+    };
+}
+
+#endif
+
+#endif // ASYNCCOROUTINE_H
@@ -0,0 +1,336 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#ifndef BUILTIN_BINARYLOG_H
+#define BUILTIN_BINARYLOG_H
+#pragma once
+
+// Binary log file format.  Logger can write log files in this format instead
+// of text; they're much smaller than the equivalent text logs, since the
+// category, file, and line of each trace are written once and referred to by
+// ID, and timestamps are delta-encoded.  tools/logdecode converts binary logs
+// back to text or JSON.
+//
+// This header only depends on the standard library, since it's also used by
+// tools/logdecode.
+//
+// ===Format===
+//
+// All integers are unsigned LEB128 varints unless noted otherwise.  A file is a
+// sequence of records, each starting with a one-byte tag:
+//
+// - Signature ("PIALOGB1") - starts a log session.  Written at the beginning
+//   of each file, and again each time logging resumes in an existing file.
+//   String and location IDs from a prior session are discarded.
+// - String (1): <id> <length> <bytes> - defines a string ID
+// - Location (2): <id> <category string id> <file string id> <line> - defines
+//   a location ID
+// - Message (3): <timestamp delta ms> <thread tag> <level (1 byte)>
+//   <location id> <length> <bytes> - a message.  The timestamp of the first
+//   message in a session is relative to the Unix epoch; later timestamps are
+//   relative to the prior message.  Messages may contain line breaks.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace BinaryLog
+{
+    const char signature[] = {'P', 'I', 'A', 'L', 'O', 'G', 'B', '1'};
+
+    enum class RecordType : std::uint8_t
+    {
+        String = 1,
+        Location = 2,
+        Message = 3,
+    };
+
+    // Same order as kapps::core::LogMessage::Level
+    enum class Level : std::uint8_t
+    {
+        Fatal,
+        Error,
+        Warning,
+        Info,
+        Debug,
+    };
+
+    inline const char *levelName(Level level)
+    {
+        switch(level)
+        {
+            case Level::Fatal: return "fatal";
+            case Level::Error: return "error";
+            case Level::Warning: return "warning";
+            case Level::Info: return "info";
+            case Level::Debug: return "debug";
+            default: return "??";
+        }
+    }
+
+    inline void appendVarint(std::string &out, std::uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Read a varint, advancing pPos.  Returns false if the data is truncated
+    // or the varint is too long.
+    inline bool readVarint(const char *&pPos, const char *pEnd, std::uint64_t &value)
+    {
+        value = 0;
+        for(unsigned shift = 0; shift < 64 && pPos != pEnd; shift += 7)
+        {
+            auto byte = static_cast<std::uint8_t>(*pPos++);
+            value |= std::uint64_t{byte & 0x7Fu} << shift;
+            if(!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    // Metadata for a message written to a binary log
+    struct MessageInfo
+    {
+        std::int64_t timestampMs;
+        std::uint16_t threadTag;
+        Level level;
+        std::string category;
+        std::string file;
+        int line;
+    };
+
+    // Encodes messages into a binary log session.  Strings and locations are
+    // defined the first time they're used in the session.
+    class Encoder
+    {
+    public:
+        Encoder() : _lastTimestampMs{0} {}
+
+    public:
+        // Start a new session - writes the signature and discards all IDs
+        void beginSession(std::string &out)
+        {
+            _strings.clear();
+            _locations.clear();
+            _lastTimestampMs = 0;
+            out.append(signature, sizeof(signature));
+        }
+
+        void encode(std::string &out, const MessageInfo &info, const char *pPayload,
+                    std::size_t payloadLen)
+        {
+            std::uint64_t categoryId = stringId(out, info.category);
+            std::uint64_t fileId = stringId(out, info.file);
+            std::uint64_t line = static_cast<std::uint64_t>(info.line < 0 ? 0 : info.line);
+
+            auto locationKey = std::make_tuple(categoryId, fileId, line);
+            auto itLocation = _locations.find(locationKey);
+            if(itLocation == _locations.end())
+            {
+                itLocation = _locations.emplace(locationKey, _locations.size()).first;
+                out.push_back(static_cast<char>(RecordType::Location));
+                appendVarint(out, itLocation->second);
+                appendVarint(out, categoryId);
+                appendVarint(out, fileId);
+                appendVarint(out, line);
+            }
+
+            // Timestamps are normally nondecreasing, but the clock could be
+            // adjusted; write 0 if it went backward.
+            std::int64_t delta = info.timestampMs - _lastTimestampMs;
+            if(delta < 0)
+                delta = 0;
+            else
+                _lastTimestampMs = info.timestampMs;
+
+            out.push_back(static_cast<char>(RecordType::Message));
+            appendVarint(out, static_cast<std::uint64_t>(delta));
+            appendVarint(out, info.threadTag);
+            out.push_back(static_cast<char>(info.level));
+            appendVarint(out, itLocation->second);
+            appendVarint(out, payloadLen);
+            out.append(pPayload, payloadLen);
+        }
+
+    private:
+        std::uint64_t stringId(std::string &out, const std::string &value)
+        {
+            auto itString = _strings.find(value);
+            if(itString != _strings.end())
+                return itString->second;
+
+            std::uint64_t id = _strings.size();
+            _strings.emplace(value, id);
+            out.push_back(static_cast<char>(RecordType::String));
+            appendVarint(out, id);
+            appendVarint(out, value.size());
+            out.append(value);
+            return id;
+        }
+
+    private:
+        std::unordered_map<std::string, std::uint64_t> _strings;
+        std::map<std::tuple<std::uint64_t, std::uint64_t, std::uint64_t>, std::uint64_t> _locations;
+        std::int64_t _lastTimestampMs;
+    };
+
+    // Message decoded from a binary log
+    struct DecodedMessage
+    {
+        std::int64_t timestampMs;
+        std::uint16_t threadTag;
+        Level level;
+        std::string category;
+        std::string file;
+        std::uint64_t line;
+        std::string message;
+    };
+
+    // Decodes a binary log.  Undefined string or location IDs are decoded as
+    // "??" so a damaged log still decodes as much as possible.
+    class Decoder
+    {
+    private:
+        struct Location
+        {
+            std::uint64_t categoryId;
+            std::uint64_t fileId;
+            std::uint64_t line;
+        };
+
+    public:
+        Decoder(const char *pData, std::size_t size)
+            : _pPos{pData}, _pEnd{pData + size}, _timestampMs{0}, _error{false}
+        {}
+
+    public:
+        // Decode the next message.  Returns false at the end of the data, or
+        // if the data is invalid (check error()).
+        bool next(DecodedMessage &msg)
+        {
+            while(_pPos != _pEnd)
+            {
+                if(static_cast<std::size_t>(_pEnd - _pPos) >= sizeof(signature) &&
+                    std::memcmp(_pPos, signature, sizeof(signature)) == 0)
+                {
+                    _pPos += sizeof(signature);
+                    _strings.clear();
+                    _locations.clear();
+                    _timestampMs = 0;
+                    continue;
+                }
+
+                auto type = static_cast<RecordType>(*_pPos++);
+                std::uint64_t id, a, b, c;
+                switch(type)
+                {
+                    case RecordType::String:
+                    {
+                        std::string value;
+                        if(!readVarint(_pPos, _pEnd, id) || !readBytes(value))
+                            return fail();
+                        _strings[id] = std::move(value);
+                        break;
+                    }
+                    case RecordType::Location:
+                        if(!readVarint(_pPos, _pEnd, id) || !readVarint(_pPos, _pEnd, a) ||
+                            !readVarint(_pPos, _pEnd, b) || !readVarint(_pPos, _pEnd, c))
+                        {
+                            return fail();
+                        }
+                        _locations[id] = {a, b, c};
+                        break;
+                    case RecordType::Message:
+                    {
+                        if(!readVarint(_pPos, _pEnd, a) || !readVarint(_pPos, _pEnd, b) ||
+                            _pPos == _pEnd)
+                        {
+                            return fail();
+                        }
+                        _timestampMs += static_cast<std::int64_t>(a);
+                        msg.timestampMs = _timestampMs;
+                        msg.threadTag = static_cast<std::uint16_t>(b);
+                        msg.level = static_cast<Level>(*_pPos++);
+                        if(!readVarint(_pPos, _pEnd, id) || !readBytes(msg.message))
+                            return fail();
+
+                        auto itLocation = _locations.find(id);
+                        if(itLocation != _locations.end())
+                        {
+                            msg.category = string(itLocation->second.categoryId);
+                            msg.file = string(itLocation->second.fileId);
+                            msg.line = itLocation->second.line;
+                        }
+                        else
+                        {
+                            msg.category = msg.file = "??";
+                            msg.line = 0;
+                        }
+                        return true;
+                    }
+                    default:
+                        return fail();
+                }
+            }
+            return false;
+        }
+
+        bool error() const {return _error;}
+
+    private:
+        bool fail() {_error = true; _pPos = _pEnd; return false;}
+
+        bool readBytes(std::string &value)
+        {
+            std::uint64_t len;
+            if(!readVarint(_pPos, _pEnd, len) ||
+                len > static_cast<std::uint64_t>(_pEnd - _pPos))
+            {
+                return false;
+            }
+            value.assign(_pPos, static_cast<std::size_t>(len));
+            _pPos += len;
+            return true;
+        }
+
+        std::string string(std::uint64_t id) const
+        {
+            auto itString = _strings.find(id);
+            return itString != _strings.end() ? itString->second : "??";
+        }
+
+    private:
+        const char *_pPos, *_pEnd;
+        std::unordered_map<std::uint64_t, std::string> _strings;
+        std::unordered_map<std::uint64_t, Location> _locations;
+        std::int64_t _timestampMs;
+        bool _error;
+    };
+}
+
+#endif
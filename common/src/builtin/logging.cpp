@@ -20,6 +20,7 @@
 #line SOURCE_FILE("builtin/logging.cpp")
 
 #include "logging.h"
+#include "binarylog.h"
 #include "error.h"
 #include "path.h"
 #include "util.h"
@@ -39,9 +40,17 @@
 #include <QTextStream>
 #include <QThread>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <cstring>
+#include <vector>
 
 #if defined(QT_DEBUG) && defined(Q_OS_WIN)
 extern "C" Q_DECL_IMPORT void __stdcall OutputDebugStringW(const wchar_t *str);
@@ -65,51 +74,205 @@ namespace
             Logger::writeMsg(std::move(msg));
         }
     };
-    // Log redactions - maps redact strings to replacements (which now include
-    // the angle brackets).  All redactions are applied sequentially when
-    // redacting text, but they're stored in a map so that adding the same
-    // redaction again doesn't accumulate.
-    std::unordered_map<std::string, std::string> g_redactions;
-
-    QString redactTextNoLock(QString text)
+    // Matches all of the log redactions in a single pass over the text (an
+    // Aho-Corasick automaton).  This is rebuilt whenever the redactions
+    // change, which is rare compared to the number of messages redacted.
+    //
+    // Matches are replaced leftmost-first (preferring the longest match at a
+    // given position), and replacement texts are not matched again.
+    class RedactionMatcher
     {
-        for(const auto &redaction : g_redactions)
+    private:
+        static const std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+        struct Node
         {
-            text.replace(QString::fromStdString(redaction.first),
-                         QString::fromStdString(redaction.second));
-        }
-        return text;
-    }
+            // Transitions, sorted by character
+            std::vector<std::pair<unsigned char, std::uint32_t>> next;
+            // Longest proper suffix of this node that is also in the trie
+            std::uint32_t fail = 0;
+            // Nearest node in the fail chain that ends a pattern
+            std::uint32_t dictLink = none;
+            // Pattern ending at this node, if any
+            std::uint32_t pattern = none;
+
+            std::uint32_t find(unsigned char c) const
+            {
+                auto itNext = std::lower_bound(next.begin(), next.end(), c,
+                    [](const auto &n, unsigned char c){return n.first < c;});
+                if(itNext != next.end() && itNext->first == c)
+                    return itNext->second;
+                return none;
+            }
+        };
 
-    QByteArray redactTextNoLock(QByteArray text)
-    {
-        for(const auto &redaction : g_redactions)
+        struct Match
         {
-            text.replace(redaction.first.c_str(), redaction.first.size(),
-                         redaction.second.c_str(), redaction.second.size());
+            std::size_t start;
+            std::uint32_t pattern;
+        };
+
+    public:
+        void build(const std::unordered_map<std::string, std::string> &redactions)
+        {
+            _nodes.clear();
+            _nodes.emplace_back();
+            _patterns.clear();
+            _replacements.clear();
+
+            // Build the trie
+            for(const auto &redaction : redactions)
+            {
+                if(redaction.first.empty())
+                    continue;
+                std::uint32_t node = 0;
+                for(char c : redaction.first)
+                {
+                    auto uc = static_cast<unsigned char>(c);
+                    std::uint32_t child = _nodes[node].find(uc);
+                    if(child == none)
+                    {
+                        child = static_cast<std::uint32_t>(_nodes.size());
+                        auto &next = _nodes[node].next;
+                        next.insert(std::upper_bound(next.begin(), next.end(), uc,
+                                        [](unsigned char c, const auto &n){return c < n.first;}),
+                                    {uc, child});
+                        _nodes.emplace_back();
+                    }
+                    node = child;
+                }
+                _nodes[node].pattern = static_cast<std::uint32_t>(_patterns.size());
+                _patterns.push_back(redaction.first.size());
+                _replacements.push_back(redaction.second);
+            }
+
+            // Compute fail and dictionary links breadth-first
+            std::deque<std::uint32_t> queue;
+            for(const auto &n : _nodes[0].next)
+                queue.push_back(n.second);
+            while(!queue.empty())
+            {
+                std::uint32_t node = queue.front();
+                queue.pop_front();
+                for(const auto &n : _nodes[node].next)
+                {
+                    std::uint32_t fail = _nodes[node].fail;
+                    std::uint32_t failNext = _nodes[fail].find(n.first);
+                    while(failNext == none && fail != 0)
+                    {
+                        fail = _nodes[fail].fail;
+                        failNext = _nodes[fail].find(n.first);
+                    }
+                    Node &child = _nodes[n.second];
+                    child.fail = (failNext == none) ? 0 : failNext;
+                    child.dictLink = (_nodes[child.fail].pattern != none) ?
+                        child.fail : _nodes[child.fail].dictLink;
+                    queue.push_back(n.second);
+                }
+            }
         }
-        return text;
-    }
 
-    std::string redactTextNoLock(std::string text)
-    {
-        for(const auto &redaction : g_redactions)
+        std::string redact(std::string text) const
         {
-            while(true)
+            if(_patterns.empty())
+                return text;
+
+            // Find every match
+            std::vector<Match> matches;
+            std::uint32_t node = 0;
+            for(std::size_t i=0; i<text.size(); ++i)
             {
-                auto pos = text.find(redaction.first);
-                if(pos == std::string::npos)
-                    break;
-                text.replace(pos, redaction.first.size(), redaction.second);
+                auto c = static_cast<unsigned char>(text[i]);
+                std::uint32_t next = _nodes[node].find(c);
+                while(next == none && node != 0)
+                {
+                    node = _nodes[node].fail;
+                    next = _nodes[node].find(c);
+                }
+                node = (next == none) ? 0 : next;
+
+                std::uint32_t out = (_nodes[node].pattern != none) ? node : _nodes[node].dictLink;
+                while(out != none)
+                {
+                    std::uint32_t pattern = _nodes[out].pattern;
+                    matches.push_back({i + 1 - _patterns[pattern], pattern});
+                    out = _nodes[out].dictLink;
+                }
             }
+            if(matches.empty())
+                return text;
+
+            // Take the leftmost (then longest) matches that don't overlap
+            std::sort(matches.begin(), matches.end(),
+                [this](const Match &first, const Match &second)
+                {
+                    if(first.start != second.start)
+                        return first.start < second.start;
+                    return _patterns[first.pattern] > _patterns[second.pattern];
+                });
+            std::string result;
+            result.reserve(text.size());
+            std::size_t copied = 0;
+            for(const auto &match : matches)
+            {
+                if(match.start < copied)
+                    continue;   // Overlaps a prior match
+                result.append(text, copied, match.start - copied);
+                result += _replacements[match.pattern];
+                copied = match.start + _patterns[match.pattern];
+            }
+            result.append(text, copied, std::string::npos);
+            return result;
         }
-        return text;
+
+    private:
+        std::vector<Node> _nodes;
+        // Length of each pattern
+        std::vector<std::size_t> _patterns;
+        // Replacement for each pattern
+        std::vector<std::string> _replacements;
+    };
+
+    // Log redactions - maps redact strings to replacements (which now include
+    // the angle brackets).  These are stored in a map so that adding the same
+    // redaction again doesn't accumulate; g_redactionMatcher is rebuilt from
+    // the map whenever it changes.
+    std::unordered_map<std::string, std::string> g_redactions;
+    RedactionMatcher g_redactionMatcher;
+
+    std::string redactTextNoLock(std::string text)
+    {
+        return g_redactionMatcher.redact(std::move(text));
+    }
+
+    QString redactTextNoLock(QString text)
+    {
+        return QString::fromStdString(redactTextNoLock(text.toStdString()));
+    }
+
+    QByteArray redactTextNoLock(QByteArray text)
+    {
+        return QByteArray::fromStdString(redactTextNoLock(text.toStdString()));
     }
 }
 
 // The log limit in bytes
 const qint64 standardLogFileLimit = 4000000;
 const qint64 largeLogFileLimit = 40000000;
+// The most log file output that can be queued for the writer thread.  If the
+// writer can't keep up, messages beyond this are dropped (and counted) rather
+// than letting the queue grow without bound.
+const std::size_t maxQueuedLogBytes = 4000000;
+
+// A message queued for the log file writer
+struct QueuedLogMsg
+{
+    // For text logs, the complete rendered lines.  For binary logs, just the
+    // message text.
+    std::string text;
+    // Message metadata - only used for binary logs
+    BinaryLog::MessageInfo info;
+};
 
 class LoggerPrivate
 {
@@ -120,19 +283,44 @@ class LoggerPrivate
     Logger * const q_ptr;
 
     LoggerPrivate(Logger* logger, const Path &logFilePath);
+    ~LoggerPrivate();
 
+    // The log file and its size are guarded by fileMutex; they're used by the
+    // writer thread.  Opening or closing the log file also requires
+    // g_logMutex, since logToFile() is checked under g_logMutex.
     QFile logFile;
     qint64 logSize;
     qint64 logFileLimit = standardLogFileLimit;
     QStringList filters;
     QFileSystemWatcher watcher;
     Path logFilePath;
+    // Whether the log file is written in the binary log format.  Guarded by
+    // both g_logMutex and fileMutex; also readable without either to decide
+    // whether to capture binary metadata, which is rechecked later.
+    std::atomic<bool> binaryLog;
+    // Encoder for the current binary log session - guarded by fileMutex
+    BinaryLog::Encoder binaryEncoder;
+
+    // Log file output is queued by the logging threads and written in batches
+    // by writerThread.  Loggers only hold queueMutex long enough to append a
+    // chunk; the file I/O happens without blocking them.
+    std::timed_mutex fileMutex;
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    std::vector<QueuedLogMsg> queue;
+    std::size_t queueBytes;
+    std::size_t droppedMsgs;
+    bool stopWriter;
+    std::thread writerThread;
 
     static const QString defaultFilters;
     static const QString disabledFilters;
 
     // Use fileName != "" as the "should log to file" flag
     bool logToFile() const { return !logFile.fileName().isEmpty(); }
+    // Path to the current log file - binary logs use a different file name so
+    // text log readers don't try to read them
+    Path activeLogFilePath() const { return binaryLog ? logFilePath + binaryLogSuffix : logFilePath; }
 
     // Read debug.txt and update config
     void readDebugFile(bool watchingDirectory = false);
@@ -142,8 +330,21 @@ class LoggerPrivate
     void removeDebugFile();
     // Attempt to open the log file for writing
     bool openLogFile(bool newSession = true);
-    // Helper to write a pre-formatted chunk of lines to the log file
+    // Helper to write a pre-formatted chunk of lines (or binary records) to
+    // the log file
     void writeToLogFile(const kapps::core::StringSlice &data);
+    // Write a message to a binary log file - fileMutex must be held
+    void writeBinaryMsg(const QueuedLogMsg &msg);
+    // Queue a message for the writer thread (drops it if the queue is full).
+    // Doesn't require fileMutex.
+    void queueLogFileWrite(QueuedLogMsg msg);
+    // Write everything queued so far to the log file - fileMutex must be held
+    void writeQueuedNoLock();
+    // Write everything queued so far and close the log file synchronously -
+    // used for fatal errors, since the process is about to abort
+    void flushAndCloseLogFile();
+    // Body of the writer thread
+    void runWriter();
 
     // Wipe log file and backup log file if exists
     void wipeLogFile();
@@ -195,7 +396,13 @@ void Logger::enableStdErr(bool logToStdErr)
 void Logger::addRedaction(const QString &redact, const QString &replace)
 {
     QMutexLocker lock{&g_logMutex};
-    g_redactions[redact.toStdString()] = QStringLiteral("<<%1>>").arg(replace).toStdString();
+    std::string replacement{QStringLiteral("<<%1>>").arg(replace).toStdString()};
+    std::string &existing = g_redactions[redact.toStdString()];
+    if(existing != replacement)
+    {
+        existing = std::move(replacement);
+        g_redactionMatcher.build(g_redactions);
+    }
 }
 
 QString Logger::redactText(QString text)
@@ -248,19 +455,49 @@ QStringList Logger::filters() const
     return d->filters;
 }
 
+std::size_t Logger::queuedLogBytes()
+{
+    Q_D(Logger);
+    std::lock_guard<std::mutex> queueLock{d->queueMutex};
+    return d->queueBytes;
+}
+
 void Logger::wipeLogFile()
 {
     Q_D(Logger);
     d->wipeLogFile();
 }
 
-void Logger::configure(bool logToFile, bool largeLogFiles, const QStringList& filters)
+void Logger::configure(bool logToFile, bool largeLogFiles, bool binaryLogFiles,
+                       const QStringList& filters)
 {
     Q_D(Logger);
     bool changed = false, success = true, writeDebugFile = false, removeDebugFile = false;
     {
         d->logFileLimit = largeLogFiles ? largeLogFileLimit : standardLogFileLimit;
         QMutexLocker lock(&g_logMutex);
+        // Lock out the writer thread while opening/closing the log file.
+        // Anything queued for the old file is written before it's closed.
+        std::lock_guard<std::timed_mutex> fileLock{d->fileMutex};
+        if (binaryLogFiles != d->binaryLog)
+        {
+            // Switch to the other log file.  Messages queued so far were
+            // rendered for the current format.
+            bool reopen = d->logToFile();
+            if (reopen)
+            {
+                d->writeQueuedNoLock();
+                d->logFile.close();
+                d->logFile.setFileName({});
+            }
+            d->binaryLog = binaryLogFiles;
+            if (reopen && !d->openLogFile())
+            {
+                d->logFile.setFileName({});
+                success = false;
+                changed = true;
+            }
+        }
         if (logToFile && !d->logToFile())
         {
             if (d->openLogFile())
@@ -276,6 +513,7 @@ void Logger::configure(bool logToFile, bool largeLogFiles, const QStringList& fi
         }
         else if (!logToFile && d->logToFile())
         {
+            d->writeQueuedNoLock();
             d->logFile.close();
             d->logFile.remove();
 #ifdef Q_OS_MAC
@@ -302,7 +540,7 @@ void Logger::configure(bool logToFile, bool largeLogFiles, const QStringList& fi
         }
     }
     if (!success)
-        qError() << "Unable to open log file for writing:" << d->logFilePath;
+        qError() << "Unable to open log file for writing:" << d->activeLogFilePath();
     if (removeDebugFile)
         d->removeDebugFile();
     else if (writeDebugFile)
@@ -316,7 +554,13 @@ LoggerPrivate::LoggerPrivate(Logger* logger, const Path &logFilePath)
     : q_ptr(logger)
     , logSize(0)
     , logFilePath{logFilePath}
+    , binaryLog{false}
+    , queueBytes{0}
+    , droppedMsgs{0}
+    , stopWriter{false}
 {
+    writerThread = std::thread{[this]{runWriter();}};
+
     QLoggingCategory::setFilterRules(disabledFilters + filters.join('\n'));
 
     QObject::connect(&watcher, &QFileSystemWatcher::directoryChanged, logger, [this]() { readDebugFile(true); });
@@ -359,8 +603,11 @@ void LoggerPrivate::readDebugFile(bool watchingDirectory)
         debugFile.close();
 
         g_logMutex.lock();
-        if (!logFile.isOpen() && openLogFile())
-            changed = true;
+        {
+            std::lock_guard<std::timed_mutex> fileLock{fileMutex};
+            if (!logFile.isOpen() && openLogFile())
+                changed = true;
+        }
         if (filterLines != filters)
         {
             filters = filterLines;
@@ -429,13 +676,25 @@ void LoggerPrivate::removeDebugFile()
 bool LoggerPrivate::openLogFile(bool newSession)
 {
     logFilePath.mkparent();
-    logFile.setFileName(logFilePath);
-    if (logFile.open(QFile::WriteOnly | QFile::Append | QFile::Text))
+    logFile.setFileName(activeLogFilePath());
+    QFile::OpenMode mode{QFile::WriteOnly | QFile::Append};
+    if (!binaryLog)
+        mode |= QFile::Text;
+    if (logFile.open(mode))
     {
         logSize = logFile.size();
+        if (binaryLog)
+        {
+            // Every file (including after rotation) starts a new binary
+            // session, so each file can be decoded on its own
+            std::string signature;
+            binaryEncoder.beginSession(signature);
+            logFile.write(signature.data(), signature.size());
+            logSize += signature.size();
+        }
         if (newSession)
         {
-            if (logSize != 0)
+            if (logSize != 0 && !binaryLog)
             {
                 {
                     QTextStream s(&logFile);
@@ -451,16 +710,26 @@ bool LoggerPrivate::openLogFile(bool newSession)
     return false;
 }
 
+LoggerPrivate::~LoggerPrivate()
+{
+    {
+        std::lock_guard<std::mutex> queueLock{queueMutex};
+        stopWriter = true;
+    }
+    queueCond.notify_one();
+    // The writer drains anything still queued before it exits
+    writerThread.join();
+}
+
 void LoggerPrivate::writeToLogFile(const kapps::core::StringSlice &data)
 {
     if (logFile.isOpen())
     {
         logFile.write(data.data(), data.size());
-        logFile.flush();
         logSize += data.size();
 
         if(logSize > logFileLimit) {
-            Path oldFilePath = logFilePath + oldFileSuffix;
+            Path oldFilePath = activeLogFilePath() + oldFileSuffix;
             QFileInfo oldFileInfo(oldFilePath);
 
             if(oldFileInfo.exists()) {
@@ -473,6 +742,13 @@ void LoggerPrivate::writeToLogFile(const kapps::core::StringSlice &data)
                     logFile.resize(0);
                     logFile.seek(0);
                     logSize = 0;
+                    if(binaryLog)
+                    {
+                        std::string signature;
+                        binaryEncoder.beginSession(signature);
+                        logFile.write(signature.data(), signature.size());
+                        logSize += signature.size();
+                    }
                     return;
                 }
             }
@@ -486,18 +762,115 @@ void LoggerPrivate::writeToLogFile(const kapps::core::StringSlice &data)
     }
 }
 
+void LoggerPrivate::writeBinaryMsg(const QueuedLogMsg &msg)
+{
+    std::string records;
+    binaryEncoder.encode(records, msg.info, msg.text.data(), msg.text.size());
+    writeToLogFile(records);
+}
+
+void LoggerPrivate::queueLogFileWrite(QueuedLogMsg msg)
+{
+    {
+        std::lock_guard<std::mutex> queueLock{queueMutex};
+        if(queueBytes + msg.text.size() > maxQueuedLogBytes)
+        {
+            ++droppedMsgs;
+            return;
+        }
+        queueBytes += msg.text.size();
+        queue.push_back(std::move(msg));
+    }
+    queueCond.notify_one();
+}
+
+void LoggerPrivate::writeQueuedNoLock()
+{
+    std::vector<QueuedLogMsg> batch;
+    std::size_t dropped;
+    {
+        std::lock_guard<std::mutex> queueLock{queueMutex};
+        batch.swap(queue);
+        dropped = droppedMsgs;
+        queueBytes = 0;
+        droppedMsgs = 0;
+    }
+
+    // Note dropped messages in the log itself; this can't trace normally since
+    // the writer must not take g_logMutex while holding fileMutex.
+    if(dropped)
+    {
+        std::string note{"Dropped " + std::to_string(dropped) +
+                         " log messages, log writer did not keep up"};
+        if(binaryLog)
+        {
+            writeBinaryMsg({std::move(note),
+                            {QDateTime::currentMSecsSinceEpoch(), 0,
+                             BinaryLog::Level::Warning, "logger", {}, 0}});
+        }
+        else
+            writeToLogFile("[logger] " + note + "\n");
+    }
+    for(const auto &msg : batch)
+    {
+        if(binaryLog)
+            writeBinaryMsg(msg);
+        else
+            writeToLogFile(msg.text);
+    }
+    if(logFile.isOpen())
+        logFile.flush();
+}
+
+void LoggerPrivate::flushAndCloseLogFile()
+{
+    // Don't wait indefinitely - if the fatal error was traced while this
+    // thread already holds fileMutex (or the writer is stuck), give up on the
+    // remaining output rather than hanging instead of aborting.
+    std::unique_lock<std::timed_mutex> fileLock{fileMutex, std::defer_lock};
+    if(!fileLock.try_lock_for(std::chrono::seconds{1}))
+        return;
+    writeQueuedNoLock();
+    logFile.close();
+}
+
+void LoggerPrivate::runWriter()
+{
+    while(true)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> queueLock{queueMutex};
+            queueCond.wait(queueLock, [this]{return stopWriter || !queue.empty();});
+            stopping = stopWriter;
+        }
+
+        {
+            std::lock_guard<std::timed_mutex> fileLock{fileMutex};
+            writeQueuedNoLock();
+        }
+
+        if(stopping)
+            return;
+    }
+}
+
 void LoggerPrivate::wipeLogFile()
 {
-    Path oldFilePath = logFilePath + oldFileSuffix;
     if(logToFile()) {
         qWarning () << "Tried to wipe logfile while logging still enabled.";
         return;
     }
-    if(QFile::exists(logFilePath)) {
-        QFile::remove(logFilePath);
-    }
-    if(QFile::exists(oldFilePath)) {
-        QFile::remove(oldFilePath);
+    // Remove both the text and binary logs, either may have been used
+    for(const Path &path : {logFilePath, logFilePath + binaryLogSuffix})
+    {
+        Path oldFilePath = path + oldFileSuffix;
+        if(QFile::exists(path)) {
+            QFile::remove(path);
+        }
+        if(QFile::exists(oldFilePath)) {
+            QFile::remove(oldFilePath);
+        }
     }
 }
 
@@ -529,15 +902,21 @@ namespace
         }
     }
 
-    void renderTimeThread(std::ostream &os)
+    // Short tag identifying the current thread in log lines
+    quint16 currentThreadTag()
     {
         auto tid = reinterpret_cast<quintptr>(QThread::currentThreadId());
         tid ^= tid >> 16;
     #if QT_POINTER_SIZE > 4
         tid ^= tid >> 32;
     #endif
+        return static_cast<quint16>(tid);
+    }
+
+    void renderTimeThread(std::ostream &os)
+    {
         char tidHex[8];
-        std::snprintf(tidHex, sizeof(tidHex), "%04x", (quint16)tid);
+        std::snprintf(tidHex, sizeof(tidHex), "%04x", currentThreadTag());
 
         // TODO - Should render directly to UTF-8
         QDateTime now{QDateTime::currentDateTimeUtc()};
@@ -563,6 +942,44 @@ namespace
         return s.str();
     }
 
+    BinaryLog::Level binaryLogLevel(QtMsgType type)
+    {
+        switch (type)
+        {
+            case QtFatalMsg:    return BinaryLog::Level::Fatal;
+            case QtCriticalMsg: return BinaryLog::Level::Error;
+            case QtWarningMsg:  return BinaryLog::Level::Warning;
+            case QtInfoMsg:     return BinaryLog::Level::Info;
+            default:            return BinaryLog::Level::Debug;
+        }
+    }
+
+    // Capture metadata for a binary log message.  This is only done when the
+    // binary log is enabled, since the category and file have to be copied.
+    BinaryLog::MessageInfo buildBinaryLogInfo(kapps::core::LogMessage::Level type,
+                                              const kapps::core::SourceLocation &loc,
+                                              const kapps::core::LogCategory &cat)
+    {
+        std::string category;
+        if(cat.module() && cat.module()->name())
+            category = cat.module()->name().to_string();
+        else
+            category = "??";
+        category += '.';
+        category += cat.name().to_string();
+        return {QDateTime::currentMSecsSinceEpoch(), currentThreadTag(),
+                static_cast<BinaryLog::Level>(type), std::move(category),
+                loc.file() ? loc.file().to_string() : std::string{"??"},
+                loc.line()};
+    }
+
+    BinaryLog::MessageInfo buildBinaryLogInfo(QtMsgType type, const QMessageLogContext &context)
+    {
+        return {QDateTime::currentMSecsSinceEpoch(), currentThreadTag(),
+                binaryLogLevel(type), context.category ? context.category : "??",
+                context.file ? context.file : "??", context.line};
+    }
+
     std::string buildLogFilePrefix(QtMsgType type, const QMessageLogContext &context)
     {
         std::stringstream s{std::ios_base::out};
@@ -595,8 +1012,11 @@ void Logger::loggingHandler(QtMsgType type, const QMessageLogContext &context, c
     LoggerPrivate *d = self ? self->d_func() : nullptr;
 
     std::string logPrefix{buildLogFilePrefix(type, context)};
+    BinaryLog::MessageInfo binaryInfo{};
+    if(d && d->binaryLog)
+        binaryInfo = buildBinaryLogInfo(type, context);
 
-    writePrefixedMsg(d, logPrefix, msg.toStdString());
+    writePrefixedMsg(d, logPrefix, msg.toStdString(), std::move(binaryInfo));
 
     // Failure to queue arguments is a programming error (and hard to debug),
     // assert to provide a way to debug it.
@@ -624,7 +1044,10 @@ void Logger::writeMsg(kapps::core::LogMessage msg)
     LoggerPrivate *d = self ? self->d_func() : nullptr;
 
     std::string logPrefix{buildLogFilePrefix(msg.level(), msg.loc(), msg.category())};
-    writePrefixedMsg(d, logPrefix, std::move(msg).message());
+    BinaryLog::MessageInfo binaryInfo{};
+    if(d && d->binaryLog)
+        binaryInfo = buildBinaryLogInfo(msg.level(), msg.loc(), msg.category());
+    writePrefixedMsg(d, logPrefix, std::move(msg).message(), std::move(binaryInfo));
 
     if(msg.level() == kapps::core::LogMessage::Level::Fatal)
         fatalExit(d);
@@ -632,9 +1055,10 @@ void Logger::writeMsg(kapps::core::LogMessage msg)
 
 void Logger::fatalExit(LoggerPrivate *d)
 {
-    // One last extra attempt to ensure file data is flushed
+    // Write out anything still queued (including the fatal message itself)
+    // synchronously, since the writer thread won't get a chance to
     if (d)
-        d->logFile.close();
+        d->flushAndCloseLogFile();
 
     // Abort - treat this as an unclean exit.  Also gives a chance to debug
     // in debug builds (this is how failed asserts are handled).
@@ -658,13 +1082,19 @@ void Logger::writeToConsoleNoLock(const kapps::core::StringSlice &data)
     }
 }
 
-void Logger::writePrefixedMsg(LoggerPrivate *d, const std::string &logPrefix, std::string msg)
+void Logger::writePrefixedMsg(LoggerPrivate *d, const std::string &logPrefix,
+                              std::string msg, BinaryLog::MessageInfo &&binaryInfo)
 {
     g_logMutex.lock();
 
     std::string redacted = redactTextNoLock(std::move(msg));
 
-    // Slice out each line of the message and log it with the prefix
+    // Render the whole message into one chunk, so the console gets a single
+    // write and the log file gets a single queued chunk
+    std::string output;
+    output.reserve(redacted.size() + logPrefix.size() + 1);
+
+    // Slice out each line of the message and prefix it
     std::size_t lineEnd = 0;
     while(lineEnd < redacted.size())
     {
@@ -675,27 +1105,34 @@ void Logger::writePrefixedMsg(LoggerPrivate *d, const std::string &logPrefix, st
         else
             ++lineEnd;  // Include the line break in the output
 
-        kapps::core::StringSlice line{redacted.c_str() + lineStart,
-                                     redacted.c_str() + lineEnd};
+        output += logPrefix;
+        output.append(redacted, lineStart, lineEnd - lineStart);
+    }
+
+    // Terminate the last line
+    output += '\n';
 
-        writeToConsoleNoLock(logPrefix);
-        writeToConsoleNoLock(line);
-        if(d)
+    writeToConsoleNoLock(output);
+    if(d && d->logToFile())
+    {
+        // Binary logs just store the message, the writer encodes the
+        // metadata.  If binary logging was just enabled, the metadata wasn't
+        // captured - at least fill in the timestamp.
+        if(d->binaryLog)
         {
-            d->writeToLogFile(logPrefix);
-            d->writeToLogFile(line);
+            if(binaryInfo.timestampMs == 0)
+                binaryInfo.timestampMs = QDateTime::currentMSecsSinceEpoch();
+            d->queueLogFileWrite({std::move(redacted), std::move(binaryInfo)});
         }
+        else
+            d->queueLogFileWrite({std::move(output), {}});
     }
 
-    // Terminate the last line
-    writeToConsoleNoLock("\n");
-    if(d)
-        d->writeToLogFile("\n");
-
     g_logMutex.unlock();
 }
 
 const QString oldFileSuffix = QStringLiteral(".old");
+const QString binaryLogSuffix = QStringLiteral(".bin");
 
 TraceStopwatch::TraceStopwatch(const char *pMsg)
     : _pMsg{pMsg}
@@ -62,6 +62,7 @@ using CodeLocation = kapps::core::SourceLocation;
 
 class Path;
 class LoggerPrivate;
+namespace BinaryLog { struct MessageInfo; }
 
 class COMMON_EXPORT Logger;
 // See Singleton - CRTP template with static member in dynamic lib
@@ -133,8 +134,13 @@ public:
     // List of filter rules to apply to log output
     QStringList filters() const;
     void wipeLogFile ();
+    // Bytes of log file output currently queued for the writer thread
+    std::size_t queuedLogBytes();
 
-    Q_SLOT void configure(bool logToFile, bool largeLogFiles, const QStringList& filters);
+    // When binaryLogFiles is set, the log file is written in the binary log
+    // format (see binarylog.h) to the log file path + binaryLogSuffix.
+    Q_SLOT void configure(bool logToFile, bool largeLogFiles, bool binaryLogFiles,
+                          const QStringList& filters);
     Q_SIGNAL void configurationChanged(bool logToFile, const QStringList& filters);
 
 public:
@@ -151,13 +157,15 @@ private:
     static void fatalExit(LoggerPrivate *d);
     static void writeToConsoleNoLock(const kapps::core::StringSlice &data);
     static void writePrefixedMsg(LoggerPrivate *d, const std::string &logPrefix,
-                                 std::string msg);
+                                 std::string msg, BinaryLog::MessageInfo &&binaryInfo);
 };
 
 #define g_logger (Logger::instance())
 
 // Replace daemon.log with daemon.log.old
 extern COMMON_EXPORT const QString oldFileSuffix;
+// Binary logs are written to daemon.log.bin (and rotated to daemon.log.bin.old)
+extern COMMON_EXPORT const QString binaryLogSuffix;
 
 // TraceStopwatch traces how long a function took to execute; useful here when
 // starting/stopping services, which is done synchronously but theoretically
@@ -58,6 +58,7 @@ Path Path::OpenVPNExecutable;
 Path Path::OpenVPNConfigFile;
 Path Path::OpenVPNUpDownScript;
 Path Path::HnsdExecutable;
+Path Path::HnsdDataDir;
 Path Path::SsLocalExecutable;
 Path Path::UnboundExecutable;
 Path Path::UnboundConfigFile;
@@ -283,6 +284,7 @@ void Path::initializePostApp()
 #endif
 
     UnboundConfigFile = DaemonDataDir / "unbound.conf";
+    HnsdDataDir = DaemonDataDir / "hnsd";
     UnboundDnsStubConfigFile = DaemonDataDir / "unbound_stub.conf";
     WireguardInterfaceFile = DaemonDataDir / "wg" BRAND_CODE "0-tun";
 
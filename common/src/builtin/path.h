@@ -159,6 +159,11 @@ public:
     // macOS & Linux: <ExecutableDir>/pia-hnsd
     static Path HnsdExecutable;
 
+    // hnsd data directory - hnsd persists its chain state here so it doesn't
+    // have to sync from scratch each time it starts
+    // All: <DaemonDataDir>/hnsd
+    static Path HnsdDataDir;
+
     // ss-local executable (Shadowsocks local client)
     // Windows: <ExecutableDir>/pia-ss-local.exe
     // macOS & Linux: <ExecutableDir>/pia-ss-local
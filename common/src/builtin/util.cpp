@@ -46,6 +46,9 @@
 #include <QElapsedTimer>
 #include <QTimeZone>
 #include <QRect>
+#include <map>
+#include <mutex>
+#include <string_view>
 
 #ifdef QT_DEBUG
 # if defined(Q_OS_WIN)
@@ -112,6 +115,14 @@ void startSupportTool (const QString &mode, const QString &diagFile)
     args << "--log" << Path::ConfigLogFile;
     args << "--log" << Path::UpdownLogFile;
 
+    // Binary logs are attached as-is; they're decoded with tools/logdecode
+    for(const Path &logFile : {Path::ClientLogFile, Path::DaemonLogFile})
+    {
+        QString binaryLogFile = logFile + binaryLogSuffix;
+        if(QFile::exists(binaryLogFile))
+            args << "--file" << binaryLogFile;
+    }
+
     if(!diagFile.isEmpty())
         args << "--file" << diagFile;
 
@@ -380,6 +391,20 @@ QString qs::toQString(const kapps::core::WStringSlice &str)
     return QString::fromWCharArray(str.data(), str.size());
 }
 
+QString qs::internQString(const kapps::core::StringSlice &str)
+{
+    static std::mutex internedMutex;
+    // std::less<> allows lookups by string_view without copying the key
+    static std::map<std::string, QString, std::less<>> interned;
+
+    std::string_view key{str.data(), str.size()};
+    std::lock_guard<std::mutex> lock{internedMutex};
+    auto itInterned = interned.find(key);
+    if(itInterned == interned.end())
+        itInterned = interned.emplace(std::string{key}, toQString(str)).first;
+    return itInterned->second;
+}
+
 std::ostream &operator<<(std::ostream &os, const QRect &rect)
 {
     os << "QRect(" << rect.x() << ',' << rect.y() << ' ' << rect.width() << 'x'
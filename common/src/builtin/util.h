@@ -698,5 +698,14 @@ namespace qs
     COMMON_EXPORT QString toQString(const std::string &str);
     COMMON_EXPORT QString toQString(const kapps::core::StringSlice &str);
     COMMON_EXPORT QString toQString(const kapps::core::WStringSlice &str);
+
+    // Convert an identifier (region ID, server IP or common name, etc.) to an
+    // interned QString.  Equal values share the same QString data, so each
+    // distinct value is converted and allocated once, no matter how many
+    // times the regions lists and locations are rebuilt.
+    //
+    // The table is global and never shrinks, so only use this for the bounded
+    // set of identifiers from the regions lists.  Thread-safe.
+    COMMON_EXPORT QString internQString(const kapps::core::StringSlice &str);
 }
 #endif // BUILTIN_UTIL_H
@@ -18,6 +18,7 @@
 
 #include "dtop.h"
 #include "common.h"
+#include "wakeupaccounting.h"
 #include <kapps_core/src/eventloop.h>
 #include <kapps_core/src/timer.h>
 #include <unordered_map>
@@ -38,6 +39,8 @@ namespace
             {
                 _r.setEnabled(false);
                 _w.setEnabled(false);
+                tagWakeups(_r, QByteArrayLiteral("kapps::core::EventLoop"));
+                tagWakeups(_w, QByteArrayLiteral("kapps::core::EventLoop"));
             }
 
             QSocketNotifier &forType(WatchType t)
@@ -66,6 +69,12 @@ namespace
             return token >> 1;
         }
 
+    public:
+        // Timer events are accounted to the EventLoop; each kapps::core::Timer
+        // that elapses is accounted separately (see Timer::tag()).
+        EventLoopQt() {tagWakeups(*this, QByteArrayLiteral("kapps::core::EventLoop"));}
+
+    private:
         // Implementation of EventLoop
         virtual TokenT setTimer(std::chrono::milliseconds interval, bool single) override;
         virtual void cancelTimer(TokenT token) override;
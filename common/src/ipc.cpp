@@ -28,6 +28,7 @@
 #include <QUuid>
 #include <QFile>
 #include <QLocalServer>
+#include <cstring>
 
 #ifdef Q_OS_UNIX
 #include <unistd.h>
@@ -78,6 +79,12 @@
 // For messages, the payload length is in the range [2, 0x100000].
 // Acknowledgements are indicated with a length field of 0.
 //
+// The top bit of the sequence high field (offset 7, 0x80) flags a binary
+// payload, such as CBOR.  Binary payloads may contain 0xFF, so the receiver
+// doesn't scan them for the start of a new frame and relies on the length
+// alone.  Binary frames are only sent to peers that asked for them; older
+// peers never see the flag.
+//
 // Messages are assigned a 16-bit sequence value by the sender.  Upon receiving
 // a message, the receiver sends an acknowledgement with the sender's latest
 // sequence that was received.  The sender can thus determine the number of
@@ -96,8 +103,9 @@
 //   be suspended by the OS when the system is idling to save battery.  The
 //   system would allow daemon updates to queue up in client memory
 //   indefinitely, and the client would have to process them all upon waking.
-//   Instead, the daemon kills the connection if the client starts to lag, and
-//   the client can reconnect and re-sync upon waking.
+//   Instead, the daemon stops sending state updates to a lagging client and
+//   collapses them into a single update, which is sent once the client
+//   catches up (see ClientConnection in the daemon).
 
 namespace
 {
@@ -152,16 +160,45 @@ namespace
 #endif
 
 static quint32_be PIA_LOCAL_SOCKET_MAGIC { 0xFFACCE56 }; // Note first 0xFF character (always invalid in UTF-8)
+// Flag in the (shifted) sequence high field indicating a binary payload.  The
+// shifted sequence never uses the top nibble, so this can't produce 0xFF.
+static const quint16 PIA_LOCAL_SOCKET_BINARY_FLAG{0x8000};
 
-// Scan for the start of a (possible) magic value.
-static const char* scanForMagic(const char* begin, const char* end)
+namespace
 {
-    while (begin != end)
+    // Serialized frame header (see format above)
+    struct FrameHeader
+    {
+        quint32_be tag;
+        quint16_le sequenceLow;
+        quint16_le sequenceHigh;
+        quint32_le size;
+    };
+    Q_STATIC_ASSERT(sizeof(FrameHeader) == 12);
+
+    FrameHeader buildFrameHeader(quint16 sequence, quint32 size, bool binary)
     {
-        if (*begin == (char)0xFF) return begin;
-        ++begin;
+        FrameHeader header;
+        header.tag = PIA_LOCAL_SOCKET_MAGIC;
+        // The sequence bytes are split up and each straddle two message bytes
+        // to ensure that this doesn't result in an 0xFF byte.
+        quint16 sequenceLowShifted = (sequence & 0x00FF) << 4;
+        quint16 sequenceHighShifted = (sequence & 0xFF00) >> 4;
+        if(binary)
+            sequenceHighShifted |= PIA_LOCAL_SOCKET_BINARY_FLAG;
+        header.sequenceLow = sequenceLowShifted;
+        header.sequenceHigh = sequenceHighShifted;
+        header.size = size;
+        return header;
     }
-    return nullptr;
+}
+
+// Scan for the start of a (possible) magic value.  This runs over every byte
+// of every UTF-8 payload received, so use memchr() (which is vectorized by the
+// C library) rather than a byte loop.
+static const char* scanForMagic(const char* begin, const char* end)
+{
+    return static_cast<const char*>(std::memchr(begin, 0xFF, end - begin));
 }
 
 static qint64 getClientPid(QLocalSocket* clientSocket)
@@ -337,8 +374,10 @@ LocalSocketIPCConnection::LocalSocketIPCConnection(QLocalSocket *socket, QObject
     : ClientIPCConnection{parent}, _socket{socket}, _payloadReceived{0},
       _lagThreshold{DefaultLagThreshold},
       _payloadSequence{0},
+      _payloadBinary{false},
       _lastSendSequence{0xFFF0},    // Start from a high value so wraparound is easily verified
       _acknowledgedSequence{_lastSendSequence},
+      _remoteLagging{false},
       _error{false}
 {
     connect(socket, &QLocalSocket::errorOccurred, this, [this](QLocalSocket::LocalSocketError e) {
@@ -403,23 +442,22 @@ void LocalSocketIPCConnection::setLagThreshold(int threshold)
     _lagThreshold = threshold;
 }
 
+qint64 LocalSocketIPCConnection::bufferedBytes() const
+{
+    qint64 bytes = _payload.size();
+    if(_socket)
+        bytes += _socket->bytesToWrite() + _socket->bytesAvailable();
+    return bytes;
+}
+
 void LocalSocketIPCConnection::writeFrame(quint16 sequence,
                                           const QByteArray &data,
-                                          QDataStream& stream)
-{
-    auto byteOrder = stream.byteOrder();
-    stream.setByteOrder(QDataStream::BigEndian);
-    stream << PIA_LOCAL_SOCKET_MAGIC;
-    stream.setByteOrder(QDataStream::LittleEndian);
-    // The sequence bytes are split up and each straddle two message bytes to
-    // ensure that this doesn't result in an 0xFF byte.
-    quint16 sequenceLowShifted = (sequence & 0x00FF) << 4;
-    quint16 sequenceHighShifted = (sequence & 0xFF00) >> 4;
-    stream << sequenceLowShifted;
-    stream << sequenceHighShifted;
-    // This writes a 32-bit length and the payload data
-    stream << data;
-    stream.setByteOrder(byteOrder);
+                                          QDataStream& stream, bool binary)
+{
+    FrameHeader header = buildFrameHeader(sequence, static_cast<quint32>(data.size()),
+                                          binary);
+    stream.writeRawData(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.writeRawData(data.data(), data.size());
 }
 
 #ifdef UNIT_TEST
@@ -446,18 +484,33 @@ int LocalSocketIPCConnection::getUnackedCount() const
     return lastSend - acked;
 }
 
-void LocalSocketIPCConnection::sendFrame(quint16 sequence, const QByteArray &payload)
+void LocalSocketIPCConnection::sendFrame(quint16 sequence, const QByteArray &payload,
+                                         bool binary)
 {
     Q_ASSERT(isConnected());     // Checked by caller
 
-    {
-        QDataStream stream{_socket};
-        writeFrame(sequence, payload, stream);
-    }
+    // Write the header and payload directly to the socket, rather than
+    // building the frame in a temporary buffer or writing each header field
+    // individually.
+    FrameHeader header = buildFrameHeader(sequence, static_cast<quint32>(payload.size()),
+                                          binary);
+    _socket->write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(!payload.isEmpty())
+        _socket->write(payload);
     _socket->flush();
 }
 
 void LocalSocketIPCConnection::sendMessage(const QByteArray &data)
+{
+    sendMessageFrame(data, false);
+}
+
+void LocalSocketIPCConnection::sendBinaryMessage(const QByteArray &data)
+{
+    sendMessageFrame(data, true);
+}
+
+void LocalSocketIPCConnection::sendMessageFrame(const QByteArray &data, bool binary)
 {
     if (!isConnected())
     {
@@ -466,7 +519,7 @@ void LocalSocketIPCConnection::sendMessage(const QByteArray &data)
     }
 
     ++_lastSendSequence;
-    sendFrame(_lastSendSequence, data);
+    sendFrame(_lastSendSequence, data, binary);
 
     int sequenceUnacked = getUnackedCount();
     // Check if the remote end is falling behind
@@ -478,7 +531,10 @@ void LocalSocketIPCConnection::sendMessage(const QByteArray &data)
         // Emit the lagging signal at 10 messages - the client/server may decide
         // to kill the connection
         if(sequenceUnacked >= _lagThreshold)
+        {
+            _remoteLagging = true;
             emit remoteLagging();
+        }
     }
 }
 
@@ -491,14 +547,7 @@ void LocalSocketIPCConnection::onReadReady()
             // We are not currently receiving a message; look for the next
             // start of a packet, identified by its magic tag.
 
-            struct
-            {
-                quint32_be tag;
-                quint16_le sequenceLow;
-                quint16_le sequenceHigh;
-                quint32_le size;
-            } header;
-            Q_STATIC_ASSERT(sizeof(header) == 12);
+            FrameHeader header;
 
             if (_socket->bytesAvailable() < (qint64)sizeof(header) || _socket->peek(reinterpret_cast<char*>(&header), sizeof(header)) != (qint64)sizeof(header))
             {
@@ -507,8 +556,11 @@ void LocalSocketIPCConnection::onReadReady()
             }
 
             // Reconstruct the sequence being received or acknowledged
+            quint16 sequenceHigh{header.sequenceHigh};
+            _payloadBinary = sequenceHigh & PIA_LOCAL_SOCKET_BINARY_FLAG;
+            sequenceHigh &= ~PIA_LOCAL_SOCKET_BINARY_FLAG;
             _payloadSequence = (quint16{header.sequenceLow} >> 4) |
-                                (quint16{header.sequenceHigh} << 4);
+                                (sequenceHigh << 4);
 
             if (header.tag != PIA_LOCAL_SOCKET_MAGIC)
             {
@@ -532,6 +584,12 @@ void LocalSocketIPCConnection::onReadReady()
                         << priorUnacked << ")";
                 }
 
+                if(_remoteLagging && newUnacked < _lagThreshold / 2)
+                {
+                    _remoteLagging = false;
+                    emit remoteCaughtUp();
+                }
+
                 // Skip over the ack and continue reading in case more data are
                 // available
                 _socket->skip(sizeof(header));
@@ -593,8 +651,12 @@ void LocalSocketIPCConnection::onReadReady()
                 // Not enough data avilable yet; wait for next readyRead.
                 return;
             }
-            // Check for start of magic tag, indicating a truncated message
-            auto magic = scanForMagic(_payload.data() + _payloadReceived, _payload.data() + _payloadReceived + read);
+            // Check for start of magic tag, indicating a truncated message.
+            // Binary payloads can legitimately contain 0xFF, so they can't be
+            // checked.
+            const char *magic = nullptr;
+            if(!_payloadBinary)
+                magic = scanForMagic(_payload.data() + _payloadReceived, _payload.data() + _payloadReceived + read);
             if (magic)
             {
                 qWarning() << "Invalid message: truncated message";
@@ -613,16 +675,14 @@ void LocalSocketIPCConnection::onReadReady()
             // We have finished reading a message.
             // Send an acknowledgement frame
             if(isConnected())
-            {
-                // QByteArray{} and QByteArray{nullptr} actually create a "null"
-                // byte array that serializes as length -1.  Send an empty byte
-                // array with length 0 using
-                // QByteArray{0, Qt::Initialization::Uninitialized}.
-                sendFrame(_payloadSequence, {0, Qt::Initialization::Uninitialized});
-            }
-            emit messageReceived(_payload);
-            _payload.resize(0);
+                sendFrame(_payloadSequence, {}, false);
+            // Hand off the payload buffer itself rather than emitting it and
+            // then resizing it, which would detach (and reallocate) since the
+            // receivers share it.
+            QByteArray payload{std::move(_payload)};
+            _payload = {};
             _payloadReceived = 0;
+            emit messageReceived(payload);
         }
     }
 }
@@ -658,6 +718,8 @@ ThreadedLocalIPCConnection::ThreadedLocalIPCConnection(QObject *pParent)
             &ThreadedLocalIPCConnection::messageError);
     connect(_pConnection, &ClientIPCConnection::remoteLagging, this,
             &ThreadedLocalIPCConnection::remoteLagging);
+    connect(_pConnection, &ClientIPCConnection::remoteCaughtUp, this,
+            &ThreadedLocalIPCConnection::remoteCaughtUp);
 }
 
 void ThreadedLocalIPCConnection::onConnected(qintptr socketFd)
@@ -745,6 +807,17 @@ void ThreadedLocalIPCConnection::sendMessage(const QByteArray &msg)
         });
 }
 
+void ThreadedLocalIPCConnection::sendBinaryMessage(const QByteArray &msg)
+{
+    // As in sendMessage(), capture _pConnection by value
+    auto pConnLocal = _pConnection;
+    QMetaObject::invokeMethod(pConnLocal,
+        [pConnLocal, msg]()
+        {
+            pConnLocal->sendBinaryMessage(msg);
+        });
+}
+
 void ThreadedLocalIPCConnection::close()
 {
     QMetaObject::invokeMethod(_pConnection, &ClientIPCConnection::close);
@@ -762,3 +835,188 @@ void ThreadedLocalIPCConnection::sendRawMessage(const QByteArray &msg)
         });
 }
 #endif
+
+ThreadedLocalSocketIPCServer::ThreadedLocalSocketIPCServer(QObject *parent)
+    : IPCServer{parent}, _pServer{nullptr}
+{
+    _socketThread.invokeOnThread([&]()
+    {
+        _pServer = new LocalSocketIPCServer{&_socketThread.objectOwner()};
+        // This is emitted on the worker thread.  Wrap the connection right
+        // away so none of its signals are missed, then hand the wrapper over
+        // to this thread.  Anything the wrapper receives in the meantime is
+        // queued after addConnection(), so it's delivered after
+        // newConnection() has been emitted.
+        connect(_pServer, &IPCServer::newConnection, _pServer,
+            [this](IPCConnection *pConnection)
+            {
+                auto pThreaded = new ThreadedServerIPCConnection{pConnection,
+                    _socketThread.objectOwner()};
+                pThreaded->moveToThread(thread());
+                QMetaObject::invokeMethod(this, [this, pThreaded]()
+                {
+                    addConnection(pThreaded);
+                });
+            });
+    });
+}
+
+ThreadedLocalSocketIPCServer::~ThreadedLocalSocketIPCServer()
+{
+    // Stop accepting connections before the worker thread is shut down
+    stop();
+}
+
+void ThreadedLocalSocketIPCServer::addConnection(ThreadedServerIPCConnection *pConnection)
+{
+    pConnection->setParent(this);
+    // As in LocalSocketIPCServer, clean out the connection later in its own
+    // call stack
+    connect(pConnection, &IPCConnection::disconnected, this, [this, pConnection]()
+    {
+        _connections.remove(pConnection);
+        pConnection->deleteLater();
+    }, Qt::QueuedConnection);
+    _connections.insert(pConnection);
+    emit newConnection(pConnection);
+}
+
+bool ThreadedLocalSocketIPCServer::listen()
+{
+    bool listening{false};
+    _socketThread.invokeOnThread([&](){listening = _pServer->listen();});
+    return listening;
+}
+
+void ThreadedLocalSocketIPCServer::stop()
+{
+    _socketThread.invokeOnThread([&](){_pServer->stop();});
+}
+
+ThreadedServerIPCConnection::ThreadedServerIPCConnection(IPCConnection *pConnection,
+                                                         QObject &workerContext)
+    : IPCConnection{nullptr}, _pConnection{pConnection},
+      _pWorkerContext{&workerContext},
+      _pBufferedBytes{std::make_shared<std::atomic<qint64>>(0)},
+      _connected{true}, _error{false}, _disconnected{false}
+{
+    connect(pConnection, &IPCConnection::messageReceived, this,
+            &ThreadedServerIPCConnection::messageReceived);
+    connect(pConnection, &IPCConnection::disconnected, this,
+            &ThreadedServerIPCConnection::onDisconnected);
+    // LocalSocketIPCServer destroys the connection when the socket
+    // disconnects, which can happen without disconnected() after an error
+    connect(pConnection, &QObject::destroyed, this,
+            &ThreadedServerIPCConnection::onDisconnected);
+    connect(pConnection, &IPCConnection::error, this,
+            &ThreadedServerIPCConnection::onError);
+    connect(pConnection, &IPCConnection::messageError, this,
+            &ThreadedServerIPCConnection::messageError);
+    connect(pConnection, &IPCConnection::remoteLagging, this,
+            &ThreadedServerIPCConnection::remoteLagging);
+    connect(pConnection, &IPCConnection::remoteCaughtUp, this,
+            &ThreadedServerIPCConnection::remoteCaughtUp);
+
+    // Sample the buffered byte count on the worker thread after receiving a
+    // message (invokeOnConnection() does this after sending)
+    connect(pConnection, &IPCConnection::messageReceived, pConnection,
+        [pConnection, pBufferedBytes = _pBufferedBytes]()
+        {
+            *pBufferedBytes = pConnection->bufferedBytes();
+        });
+}
+
+void ThreadedServerIPCConnection::onDisconnected()
+{
+    _connected = false;
+    // After being disconnected, LocalSocketIPCConnection returns true for
+    // isError(), as in ThreadedLocalIPCConnection
+    _error = true;
+    if(!_disconnected)
+    {
+        _disconnected = true;
+        emit disconnected();
+    }
+}
+
+void ThreadedServerIPCConnection::onError(const QString &errorString)
+{
+    _connected = false;
+    _error = true;
+    emit error(errorString);
+}
+
+template<class Func>
+void ThreadedServerIPCConnection::invokeOnConnection(Func func)
+{
+    // The worker context is only destroyed when the server is destroyed,
+    // which happens on this thread
+    if(!_pWorkerContext)
+        return;
+    // Capture the QPointer by value; it's only dereferenced on the worker
+    // thread, where the connection is destroyed
+    QMetaObject::invokeMethod(_pWorkerContext.data(),
+        [pConnection = _pConnection, pBufferedBytes = _pBufferedBytes,
+         func = std::move(func)]()
+        {
+            if(pConnection)
+            {
+                func(*pConnection);
+                *pBufferedBytes = pConnection->bufferedBytes();
+            }
+        });
+}
+
+bool ThreadedServerIPCConnection::isConnected()
+{
+    return _connected;
+}
+
+bool ThreadedServerIPCConnection::isError()
+{
+    return _error;
+}
+
+void ThreadedServerIPCConnection::setLagThreshold(int threshold)
+{
+    invokeOnConnection([threshold](IPCConnection &connection)
+    {
+        connection.setLagThreshold(threshold);
+    });
+}
+
+qint64 ThreadedServerIPCConnection::bufferedBytes() const
+{
+    return *_pBufferedBytes;
+}
+
+void ThreadedServerIPCConnection::sendMessage(const QByteArray &msg)
+{
+    if(!_connected)
+    {
+        emit messageError({HERE, Error::Code::IPCNotConnected}, msg);
+        return;
+    }
+    invokeOnConnection([msg](IPCConnection &connection)
+    {
+        connection.sendMessage(msg);
+    });
+}
+
+void ThreadedServerIPCConnection::sendBinaryMessage(const QByteArray &msg)
+{
+    if(!_connected)
+    {
+        emit messageError({HERE, Error::Code::IPCNotConnected}, msg);
+        return;
+    }
+    invokeOnConnection([msg](IPCConnection &connection)
+    {
+        connection.sendBinaryMessage(msg);
+    });
+}
+
+void ThreadedServerIPCConnection::close()
+{
+    invokeOnConnection([](IPCConnection &connection){connection.close();});
+}
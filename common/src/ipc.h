@@ -25,8 +25,11 @@
 
 #include "thread.h"
 #include <QByteArray>
+#include <QPointer>
 #include <QSet>
 #include <QString>
+#include <atomic>
+#include <memory>
 
 class COMMON_EXPORT IPCConnection;
 
@@ -70,8 +73,16 @@ public:
     // Set the threshold used to trigger the remoteLagging() signal.  Tracing
     // starts at half this threshold.  (Used in unit tests.)
     virtual void setLagThreshold(int threshold) = 0;
+    // Bytes currently buffered by the connection (sent but not yet written,
+    // and received but not yet processed), for memory accounting
+    virtual qint64 bufferedBytes() const { return 0; }
 public slots:
     virtual void sendMessage(const QByteArray &msg) = 0;
+    // Send a message with a binary (non-UTF-8) payload, such as CBOR-encoded
+    // JSON-RPC.  Binary frames are flagged in the frame header, since the
+    // payload may contain 0xFF bytes.  Only send these to a remote party that
+    // has indicated it supports them.
+    virtual void sendBinaryMessage(const QByteArray &msg) = 0;
     virtual void close() = 0;
 
 signals:
@@ -84,6 +95,9 @@ signals:
     // The remote party is not acknowledging messages (emitted when a message is
     // sent if there are 9 prior unacknowledged messages)
     void remoteLagging();
+    // The remote party has caught up after remoteLagging() was emitted (the
+    // unacknowledged count has dropped below half the lag threshold).
+    void remoteCaughtUp();
 };
 
 // IPC connection for use in clients.  In addition to IPCConnection, has
@@ -133,9 +147,10 @@ class COMMON_EXPORT LocalSocketIPCConnection : public ClientIPCConnection
 
 public:
     // Just serialize a frame into a raw buffer.  This can be a message frame
-    // (non-empty data) or an acknowledgement frame (empty data).
+    // (non-empty data) or an acknowledgement frame (empty data).  Set 'binary'
+    // for a binary payload frame; see sendBinaryMessage().
     static void writeFrame(quint16 sequence, const QByteArray &data,
-                           QDataStream &stream);
+                           QDataStream &stream, bool binary = false);
 
 private:
     // Wrap around an existing socket
@@ -151,6 +166,7 @@ public:
     virtual bool isConnected() override;
     virtual bool isError() override;
     virtual void setLagThreshold(int threshold) override;
+    virtual qint64 bufferedBytes() const override;
 
 #ifdef UNIT_TEST
     virtual void sendRawMessage(const QByteArray& msg) override;
@@ -161,10 +177,12 @@ protected slots:
 
 private:
     int getUnackedCount() const;
-    void sendFrame(quint16 sequence, const QByteArray &payload);
+    void sendFrame(quint16 sequence, const QByteArray &payload, bool binary);
+    void sendMessageFrame(const QByteArray &msg, bool binary);
 
 public slots:
     virtual void sendMessage(const QByteArray &msg) override;
+    virtual void sendBinaryMessage(const QByteArray &msg) override;
     virtual void close() override;
 
 private:
@@ -178,10 +196,15 @@ private:
     int _lagThreshold;
     // The sequence of the payload currently being received
     quint16 _payloadSequence;
+    // Whether the payload currently being received is binary - binary payloads
+    // aren't scanned for the 0xFF magic byte.
+    bool _payloadBinary;
     // Sequence that was last sent - incremented when we send a message
     quint16 _lastSendSequence;
     // The last sequence that was acknowledged from the remote side
     quint16 _acknowledgedSequence;
+    // Whether remoteLagging() has been emitted since the remote last caught up
+    bool _remoteLagging;
     bool _error;
 
     friend class LocalSocketIPCServer;
@@ -218,6 +241,7 @@ public:
     // calls to sendMessage().
     virtual void setLagThreshold(int threshold) override;
     virtual void sendMessage(const QByteArray &msg) override;
+    virtual void sendBinaryMessage(const QByteArray &msg) override;
     virtual void close() override;
 
 #ifdef UNIT_TEST
@@ -239,4 +263,87 @@ public:
     bool _error;
 };
 
+// ThreadedLocalSocketIPCServer is an IPC server that runs a
+// LocalSocketIPCServer and all of its connections on a worker thread.  Socket
+// I/O and frame parsing happen on that thread, and complete messages are
+// delivered to the server's thread, so large writes to one client (or many
+// clients) don't stall the server's event loop.
+//
+// The connections emitted by newConnection() live on the server's thread;
+// they forward to the actual connections on the worker thread (see
+// ThreadedServerIPCConnection).
+class COMMON_EXPORT ThreadedLocalSocketIPCServer : public IPCServer
+{
+    Q_OBJECT
+
+public:
+    ThreadedLocalSocketIPCServer(QObject *parent = nullptr);
+    ~ThreadedLocalSocketIPCServer();
+
+private:
+    void addConnection(class ThreadedServerIPCConnection *pConnection);
+
+public:
+    virtual bool listen() override;
+    virtual void stop() override;
+
+private:
+    // The LocalSocketIPCServer and its connections run on this thread.
+    RunningWorkerThread _socketThread;
+    // The actual server, parented to _socketThread's object owner.  Only
+    // accessed on the worker thread.
+    LocalSocketIPCServer *_pServer;
+};
+
+// Server-side connection returned by ThreadedLocalSocketIPCServer.  This lives
+// on the server's thread and decorates a LocalSocketIPCConnection on the
+// worker thread, like ThreadedLocalIPCConnection does for clients.
+//
+// The actual connection is destroyed on the worker thread when the client
+// disconnects, so it's referenced with a QPointer that is only dereferenced on
+// the worker thread.
+class COMMON_EXPORT ThreadedServerIPCConnection : public IPCConnection
+{
+    Q_OBJECT
+
+public:
+    // Must be constructed on the worker thread, since it connects to the
+    // actual connection's signals before any more of them can be emitted.
+    // The caller then moves it to the server's thread.  workerContext is an
+    // object on the worker thread that outlives the connection.
+    ThreadedServerIPCConnection(IPCConnection *pConnection, QObject &workerContext);
+
+private:
+    void onDisconnected();
+    void onError(const QString &errorString);
+    // Queue a call to the actual connection on the worker thread, if it still
+    // exists.
+    template<class Func>
+    void invokeOnConnection(Func func);
+
+public:
+    virtual bool isConnected() override;
+    virtual bool isError() override;
+    virtual void setLagThreshold(int threshold) override;
+    // The buffered byte count is sampled on the worker thread each time a
+    // message is sent or received.
+    virtual qint64 bufferedBytes() const override;
+    virtual void sendMessage(const QByteArray &msg) override;
+    virtual void sendBinaryMessage(const QByteArray &msg) override;
+    virtual void close() override;
+
+private:
+    QPointer<IPCConnection> _pConnection;
+    // Context for calls queued to the worker thread
+    QPointer<QObject> _pWorkerContext;
+    std::shared_ptr<std::atomic<qint64>> _pBufferedBytes;
+    // The connection and error states are stored on the server's thread to
+    // avoid blocking calls over to the worker thread to check them.
+    bool _connected;
+    bool _error;
+    // Whether disconnected() has been emitted; it's emitted once, either when
+    // the actual connection disconnects or when it's destroyed
+    bool _disconnected;
+};
+
 #endif // IPC_H
@@ -25,6 +25,9 @@
 
 #include <QJsonDocument>
 #include <QFile>
+#include <QMutex>
+#include <cstring>
+#include <memory>
 #include <nlohmann/json.hpp>
 
 std::ostream &operator<<(std::ostream &os, const QJsonValue &val)
@@ -84,10 +87,87 @@ bool json_cast(const QJsonValue &from, float &to)
 NativeJsonObject::NativeJsonObject(UnknownPropertyBehavior unknownPropertyBehavior, QObject *parent)
     : QObject(parent),
       _saveUnknownProperties(unknownPropertyBehavior == SaveUnknownProperties),
-      _pDeferredChanges{nullptr}
+      _pDeferredChanges{nullptr},
+      _pPropertyTable{nullptr}
 {
 }
 
+// Maps the property names of one NativeJsonObject class to their meta-property
+// indices.  get()/set()/assign() are used heavily (every settings/state change
+// is applied and observed by name), so the names are hashed once per class
+// instead of searching the meta-object for every access.
+struct NativeJsonObject::PropertyTable
+{
+    QHash<QByteArray, PropertyEntry> properties;
+};
+
+auto NativeJsonObject::propertyTable() const -> const PropertyTable &
+{
+    if(!_pPropertyTable)
+    {
+        // Tables are never destroyed, and each class's table never changes
+        // once built, so they can be used without holding the lock
+        static QMutex tablesMutex;
+        static std::unordered_map<const QMetaObject*, std::unique_ptr<PropertyTable>> tables;
+
+        auto m = this->metaObject();
+        QMutexLocker lock{&tablesMutex};
+        auto &pTable = tables[m];
+        if(!pTable)
+        {
+            pTable.reset(new PropertyTable{});
+            for (int i = m->propertyOffset(), c = m->propertyCount(); i < c; i++)
+            {
+                auto p = m->property(i);
+                pTable->properties.insert(QByteArray{p.name()},
+                    {i, p.metaType() == QMetaType::fromType<QJsonValue>()});
+            }
+        }
+        _pPropertyTable = pTable.get();
+    }
+    return *_pPropertyTable;
+}
+
+auto NativeJsonObject::findProperty(const char* asciiName) const -> const PropertyEntry *
+{
+    const auto &properties = propertyTable().properties;
+    auto it = properties.find(QByteArray::fromRawData(asciiName, static_cast<qsizetype>(std::strlen(asciiName))));
+    return it == properties.end() ? nullptr : &it.value();
+}
+
+QJsonValue NativeJsonObject::readProperty(const PropertyEntry &entry) const
+{
+    if(!entry.isJsonValue)
+        return QJsonValue::fromVariant(metaObject()->property(entry.index).read(this));
+
+    // Call the moc-generated accessor directly with a QJsonValue, like
+    // QMetaProperty::read() does, but without boxing it in a QVariant
+    QJsonValue value;
+    int status{-1};
+    void *argv[]{&value, nullptr, &status};
+    QMetaObject::metacall(const_cast<NativeJsonObject*>(this),
+                          QMetaObject::ReadProperty, entry.index, argv);
+    return value;
+}
+
+void NativeJsonObject::writeProperty(const PropertyEntry &entry, const QJsonValue &value)
+{
+    if(!entry.isJsonValue)
+    {
+        auto p = metaObject()->property(entry.index);
+        if (!p.write(this, value.toVariant()))
+            _error = JsonFieldError(HERE, QLatin1String(p.name()), p.typeName(), jsonValueString(value));
+        return;
+    }
+
+    // As in readProperty(), skip the QVariant.  set_<name>() reports any
+    // error in _error.
+    int status{-1};
+    int flags{0};
+    void *argv[]{const_cast<QJsonValue*>(&value), nullptr, &status, &flags};
+    QMetaObject::metacall(this, QMetaObject::WriteProperty, entry.index, argv);
+}
+
 void NativeJsonObject::setError(Error error)
 {
     _error = std::move(error);
@@ -123,12 +203,9 @@ QStringList NativeJsonObject::choices(const QString*, const std::initializer_lis
 template<typename T>
 QJsonValue NativeJsonObject::getInternal(const char* asciiName, const T& name) const
 {
-    auto m = this->metaObject();
-    auto pi = m->indexOfProperty(asciiName);
-    if (pi >= m->propertyOffset())
+    if (auto pEntry = findProperty(asciiName))
     {
-        auto p = m->property(pi);
-        return QJsonValue::fromVariant(p.read(this));
+        return readProperty(*pEntry);
     }
     else
     {
@@ -152,16 +229,9 @@ template<typename T>
 bool NativeJsonObject::setInternal(const char* asciiName, const T& name, const QJsonValue& value)
 {
     clearError();
-    auto m = this->metaObject();
-    auto pi = m->indexOfProperty(asciiName);
-    if (pi >= m->propertyOffset())
+    if (auto pEntry = findProperty(asciiName))
     {
-        auto p = m->property(pi);
-        if (!p.write(this, value.toVariant()))
-        {
-            _error = JsonFieldError(HERE, name, p.typeName(), jsonValueString(value));
-            return false;
-        }
+        writeProperty(*pEntry, value);
         return error() == nullptr;
     }
     else if (_saveUnknownProperties)
@@ -197,8 +267,7 @@ bool NativeJsonObject::set(const QString &name, const QJsonValue &value)
 
 bool NativeJsonObject::isKnownProperty(const char *name) const
 {
-    auto m = this->metaObject();
-    return m->indexOfProperty(name) >= m->propertyOffset();
+    return findProperty(name) != nullptr;
 }
 bool NativeJsonObject::isKnownProperty(const QLatin1String &name) const
 {
@@ -206,8 +275,7 @@ bool NativeJsonObject::isKnownProperty(const QLatin1String &name) const
 }
 bool NativeJsonObject::isKnownProperty(const QString &name) const
 {
-    auto m = this->metaObject();
-    return m->indexOfProperty(qUtf8Printable(name)) >= m->propertyOffset();
+    return findProperty(qUtf8Printable(name)) != nullptr;
 }
 
 bool NativeJsonObject::assign(const QJsonObject &properties)
@@ -267,12 +335,9 @@ template<typename T>
 void NativeJsonObject::resetInternal(const char* asciiName, const T& name)
 {
     clearError();
-    auto m = this->metaObject();
-    auto pi = m->indexOfProperty(asciiName);
-    if (pi >= m->propertyOffset())
+    if (auto pEntry = findProperty(asciiName))
     {
-        auto p = m->property(pi);
-        p.reset(this);
+        metaObject()->property(pEntry->index).reset(this);
     }
     else
     {
@@ -327,11 +392,10 @@ void NativeJsonObject::reset(const QStringList& properties)
 QJsonObject NativeJsonObject::toJsonObject() const
 {
     QJsonObject result = _other;
-    auto m = this->metaObject();
-    for (int i = m->propertyOffset(), c = m->propertyCount(); i < c; i++)
+    const auto &properties = propertyTable().properties;
+    for (auto it = properties.begin(); it != properties.end(); ++it)
     {
-        auto p = m->property(i);
-        result.insert(QLatin1String(p.name()), QJsonValue::fromVariant(p.read(this)));
+        result.insert(QLatin1String(it.key()), readProperty(it.value()));
     }
     return result;
 }
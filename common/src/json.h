@@ -375,6 +375,21 @@ public:
     static QStringList choices(const QString*, const QStringList &valid) {return valid;}
 
 private:
+    struct PropertyTable;
+    struct PropertyEntry
+    {
+        int index;
+        // Whether the property's type is QJsonValue - true for all JsonField
+        // properties, which can be read and written without a QVariant
+        bool isJsonValue;
+    };
+    const PropertyTable &propertyTable() const;
+    // Find a property declared by this class (or any class between it and
+    // NativeJsonObject); nullptr if the name isn't a known property.
+    const PropertyEntry *findProperty(const char* asciiName) const;
+    QJsonValue readProperty(const PropertyEntry &entry) const;
+    void writeProperty(const PropertyEntry &entry, const QJsonValue &value);
+
     template<typename T> QJsonValue getInternal(const char* asciiName, const T& name) const;
     template<typename T> bool setInternal(const char* asciiName, const T& name, const QJsonValue& value);
     template<typename T> void resetInternal(const char* asciiName, const T& name);
@@ -437,6 +452,9 @@ private:
     const bool _saveUnknownProperties;
     // When set, change signals are being deferred during a call to assign()
     QVector<DeferredChange> *_pDeferredChanges;
+    // Property table for this object's class; found on first use since
+    // metaObject() isn't the final class during construction
+    mutable const PropertyTable *_pPropertyTable;
 };
 
 
@@ -539,6 +557,39 @@ private:
     JsonField(type, name, defaultValue,##__VA_ARGS__) \
     public: type& name() { return _##name; }
 
+// JsonLazyField() is like JsonField(), but values assigned from JSON (with
+// assign() or set_name()) are kept as the raw QJsonValue and only converted
+// to 'type' when name() is first called.  The JSON getter returns the raw
+// value without converting it at all.
+//
+// Assigning from JSON does not compare the new value to the old one - it
+// always emits a change.  This is intended for large properties that are
+// only sent when they actually change (like the daemon's region lists),
+// where a deep comparison of every push costs more than a spurious change
+// signal, and where many clients never read the property at all.
+//
+// Validators aren't supported.  If a raw value can't be converted when it's
+// materialized, an error is traced and the property keeps its prior value.
+#define JsonLazyField(type, name, defaultValue) \
+    public: const type& name() const { materialize_##name(); return _##name; } \
+    public: void name(const type& value) { clearError(); materialize_##name(); if (_##name != value) { _##name = value; emitPropertyChange({[this](){emit name##Changed();}, QStringLiteral(#name)}); } } \
+    public: void set_##name(const QJsonValue& value) { clearError(); _raw_##name = value; emitPropertyChange({[this](){emit name##Changed();}, QStringLiteral(#name)}); } \
+    public: QJsonValue get_##name() const { if (!_raw_##name.isUndefined()) return _raw_##name; QJsonValue value; if (!json_cast(_##name, value)) { qCritical() << "Unable to convert field " #name " to JSON"; } return value; } \
+    signals: Q_SIGNAL void name##Changed(); \
+    public: static type default_##name() { return defaultValue; } \
+    public: void reset_##name() { type value = default_##name(); materialize_##name(); if (_##name != value) { _##name = std::move(value); emitPropertyChange({[this](){emit name##Changed();}, QStringLiteral(#name)}); } } \
+    private: void materialize_##name() const \
+    { \
+        if (_raw_##name.isUndefined()) return; \
+        type actual; \
+        if (json_cast(_raw_##name, actual)) _##name = std::move(actual); \
+        else qWarning() << "Unable to convert field " #name " from" << jsonValueString(_raw_##name); \
+        _raw_##name = QJsonValue{QJsonValue::Undefined}; \
+    } \
+    private: mutable type _##name = default_##name(); \
+    private: mutable QJsonValue _raw_##name{QJsonValue::Undefined}; \
+    Q_PROPERTY(QJsonValue name READ get_##name WRITE set_##name NOTIFY name##Changed RESET reset_##name FINAL)
+
 // Inline functions definitions
 
 template<typename T, typename U>
@@ -719,20 +770,121 @@ COMMON_EXPORT void writeProperties(const QJsonObject &object, const Path &settin
 // QML), but since it is intended to move to a dynamic model instead of the
 // static models in DaemonState/etc., it shouldn't need any bridging.
 
+// Convert a JSON value directly between nlohmann::json and Qt.  These walk the
+// value instead of rendering JSON text and parsing it with the other library,
+// which used to be done at each boundary between the two.  The results are the
+// same as the text round trip:
+// - non-finite numbers become null (neither library renders them as numbers)
+// - integral numbers that Qt would render without a fraction become integers
+//   in nlohmann::json (unsigned if non-negative, like its parser)
+// - binary values can't be represented in Qt JSON, these throw
+template<class JsonT>
+QJsonValue adaptNljValueToQt(const JsonT &j)
+{
+    using value_t = typename JsonT::value_t;
+    switch(j.type())
+    {
+        case value_t::null:
+        case value_t::discarded:
+            return QJsonValue{QJsonValue::Null};
+        case value_t::boolean:
+            return QJsonValue{j.template get<bool>()};
+        case value_t::number_integer:
+            return QJsonValue{static_cast<qint64>(j.template get<typename JsonT::number_integer_t>())};
+        case value_t::number_unsigned:
+        {
+            auto value = j.template get<typename JsonT::number_unsigned_t>();
+            if(value <= static_cast<typename JsonT::number_unsigned_t>(std::numeric_limits<qint64>::max()))
+                return QJsonValue{static_cast<qint64>(value)};
+            return QJsonValue{static_cast<double>(value)};
+        }
+        case value_t::number_float:
+        {
+            double value = j.template get<double>();
+            if(!std::isfinite(value))
+                return QJsonValue{QJsonValue::Null};
+            return QJsonValue{value};
+        }
+        case value_t::string:
+        {
+            const auto &value = j.template get_ref<const typename JsonT::string_t&>();
+            return QJsonValue{QString::fromUtf8(value.data(), static_cast<qsizetype>(value.size()))};
+        }
+        case value_t::array:
+        {
+            QJsonArray array;
+            for(const auto &element : j)
+                array.push_back(adaptNljValueToQt(element));
+            return array;
+        }
+        case value_t::object:
+        {
+            QJsonObject object;
+            for(auto it = j.begin(); it != j.end(); ++it)
+            {
+                const auto &key = it.key();
+                object.insert(QString::fromUtf8(key.data(), static_cast<qsizetype>(key.size())),
+                              adaptNljValueToQt(it.value()));
+            }
+            return object;
+        }
+        default:
+            break;
+    }
+    KAPPS_CORE_WARNING() << "Can't adapt JSON of type" << j.type() << "to Qt";
+    throw std::runtime_error{"unsupported JSON value type"};
+}
+template<class JsonT>
+JsonT adaptQtToNlj(const QJsonValue &v)
+{
+    switch(v.type())
+    {
+        case QJsonValue::Type::Bool:
+            return JsonT(v.toBool());
+        case QJsonValue::Type::Double:
+        {
+            double value = v.toDouble();
+            if(!std::isfinite(value))
+                return JsonT(nullptr);
+            // Qt renders integral values up to 2^53 without a fraction
+            if(value == std::trunc(value) && std::abs(value) < 9007199254740992.0)
+            {
+                if(value >= 0)
+                    return JsonT(static_cast<typename JsonT::number_unsigned_t>(value));
+                return JsonT(static_cast<typename JsonT::number_integer_t>(value));
+            }
+            return JsonT(value);
+        }
+        case QJsonValue::Type::String:
+            return JsonT(v.toString().toStdString());
+        case QJsonValue::Type::Array:
+        {
+            JsonT array = JsonT::array();
+            const auto &qtArray = v.toArray();
+            for(const auto &element : qtArray)
+                array.push_back(adaptQtToNlj<JsonT>(element));
+            return array;
+        }
+        case QJsonValue::Type::Object:
+        {
+            JsonT object = JsonT::object();
+            const auto &qtObject = v.toObject();
+            for(auto it = qtObject.begin(); it != qtObject.end(); ++it)
+                object.emplace(it.key().toStdString(), adaptQtToNlj<JsonT>(it.value()));
+            return object;
+        }
+        default:
+        case QJsonValue::Type::Null:
+        case QJsonValue::Type::Undefined:
+            return JsonT(nullptr);
+    }
+}
+
 // Get a QJsonObject from an nlohman::json that is expected to have an object
-// value.  This is relatively complex because:
-// - Qt can only parse object- or array-valued JSON, not other types as
-//   permitted by RFC8259.
-// - Qt's error handling is, as usual, really cumbersome.  Qt doesn't use
-//   exceptions, so we have to manually check for lots of error conditions and
-//   extract relevant information for tracing.
-//
-// If the conversion is not possible for any reason (including if the
-// nlohmann::json is not an object value), this throws.
+// value.  If the nlohmann::json is not an object value, this throws.
 //
-// There is no helper for the reverse (QJsonObject to nlohmann::json), because
-// it's trivial - just QJsonDocument{o}.toJson() followed by
-// nlohmann::json::parse(), which throws good exceptions for errors.
+// adaptJsonTextToQJsonObject() parses JSON text that is expected to contain an
+// object (throws if it can't be parsed or isn't an object).
 COMMON_EXPORT QJsonObject adaptJsonTextToQJsonObject(kapps::core::StringSlice jsonText);
 template<class JsonT>
 QJsonObject adaptNljToQt(const JsonT &j)
@@ -744,8 +896,7 @@ QJsonObject adaptNljToQt(const JsonT &j)
         throw std::runtime_error{"object JSON value expected"};
     }
 
-    auto jsonText = j.dump();
-    return adaptJsonTextToQJsonObject(jsonText);
+    return adaptNljValueToQt(j).toObject();
 }
 
 // Convert QSharedPointer<T> to/from JSON.  nullptr is represented as a JSON null.
@@ -795,8 +946,7 @@ void from_json(const JsonT &j, QString &s)
 template<class JsonT>
 void to_json(JsonT &j, const NativeJsonObject &o)
 {
-    QByteArray jsonText = QJsonDocument{o.toJsonObject()}.toJson();
-    j = JsonT::parse(jsonText);
+    j = adaptQtToNlj<JsonT>(o.toJsonObject());
 }
 
 template<class JsonT>
@@ -821,14 +971,12 @@ void from_json(const JsonT &j, NativeJsonObject &o)
     }
 }
 
-// Convert QJsonValue to kapps::core::JsonReadable.  This has to serialize the
-// JSON to transport between Qt and nlohmann::json.
+// Convert QJsonValue to kapps::core::JsonReadable (through nlohmann::json).
 //
-// Qt can only serialize JSON for an object or array value (not any JSON
-// value, as is now allowed by RFC8259).  This implementation assumes that T
-// wants an object value, and it rejects other types.  (We could still relax
-// this by putting 'from' into an object for serialization, but no existing
-// types need this.)
+// This implementation assumes that T wants an object value, and it rejects
+// other types.  (This was required when the value was transported as JSON
+// text, since Qt can only serialize objects and arrays; no existing types need
+// anything else.)
 template<class T, class JsonT = nlohmann::json>
 bool json_cast(const QJsonValue &from, kapps::core::JsonReadable<T> &to)
 {
@@ -842,9 +990,7 @@ bool json_cast(const QJsonValue &from, kapps::core::JsonReadable<T> &to)
             return false;
         }
 
-        QJsonDocument doc{from.toObject()};
-        QByteArray docJson = doc.toJson();
-        auto nljDoc = JsonT::parse(docJson.begin(), docJson.end());
+        auto nljDoc = adaptQtToNlj<JsonT>(from);
         from_json(nljDoc, to);
         return true;
     }
@@ -869,12 +1015,10 @@ bool json_cast(const kapps::core::JsonReadable<T> &, QJsonValue&)
     return false;
 }
 
-// Convert kapps::core::JsonWritable to a QJsonValue.  Like the conversion from
-// kapps::core::JsonReadable, this has to serialize the JSON to transport
-// between the libraries.
+// Convert kapps::core::JsonWritable to a QJsonValue (through nlohmann::json).
 //
-// Again, since Qt can only deserialize object- or array-valued JSON documents,
-// this assumes that T wants an object value.
+// Like the conversion from kapps::core::JsonReadable, this assumes that T
+// renders an object value.
 template<class T, class JsonT = nlohmann::json>
 bool json_cast(const kapps::core::JsonWritable<T> &from, QJsonValue& to)
 {
@@ -0,0 +1,189 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "common.h"
+#line SOURCE_FILE("jsondelta.cpp")
+
+#include "jsondelta.h"
+#include <QJsonArray>
+#include <QJsonObject>
+
+namespace
+{
+    const QString deltaValueKey{QStringLiteral("v")};
+    const QString deltaObjectKey{QStringLiteral("o")};
+    const QString deltaDeleteKey{QStringLiteral("d")};
+    const QString deltaArrayLengthKey{QStringLiteral("a")};
+    const QString deltaElementsKey{QStringLiteral("e")};
+
+    QJsonObject replaceDelta(const QJsonValue &current)
+    {
+        return QJsonObject{{deltaValueKey, current}};
+    }
+
+    // If more than half of the children changed, a structural delta isn't
+    // worth it - the client would have to walk both trees anyway, and the
+    // delta would be about as big as the value.
+    bool worthStructuralDelta(qsizetype changed, qsizetype total)
+    {
+        return changed * 2 <= total;
+    }
+
+    QJsonValue diffObject(const QJsonObject &prior, const QJsonObject &current)
+    {
+        QJsonObject nested;
+        QJsonArray removed;
+
+        for(auto itPrior = prior.begin(); itPrior != prior.end(); ++itPrior)
+        {
+            if(!current.contains(itPrior.key()))
+                removed.append(itPrior.key());
+        }
+
+        for(auto itCurrent = current.begin(); itCurrent != current.end(); ++itCurrent)
+        {
+            auto itPrior = prior.find(itCurrent.key());
+            if(itPrior == prior.end())
+                nested.insert(itCurrent.key(), replaceDelta(itCurrent.value()));
+            else
+            {
+                QJsonValue childDelta = jsonDiff(itPrior.value(), itCurrent.value());
+                if(!childDelta.isUndefined())
+                    nested.insert(itCurrent.key(), childDelta);
+            }
+        }
+
+        if(nested.isEmpty() && removed.isEmpty())
+            return QJsonValue::Undefined;
+        if(!worthStructuralDelta(nested.size() + removed.size(), current.size()))
+            return replaceDelta(current);
+
+        QJsonObject delta;
+        if(!nested.isEmpty())
+            delta.insert(deltaObjectKey, nested);
+        if(!removed.isEmpty())
+            delta.insert(deltaDeleteKey, removed);
+        return delta;
+    }
+
+    QJsonValue diffArray(const QJsonArray &prior, const QJsonArray &current)
+    {
+        QJsonObject elements;
+        for(qsizetype i = 0; i < current.size(); ++i)
+        {
+            QJsonValue elementDelta = (i < prior.size()) ?
+                jsonDiff(prior[i], current[i]) :
+                replaceDelta(current[i]);
+            if(!elementDelta.isUndefined())
+                elements.insert(QString::number(i), elementDelta);
+        }
+
+        if(elements.isEmpty() && prior.size() == current.size())
+            return QJsonValue::Undefined;
+        if(!worthStructuralDelta(elements.size(), current.size()))
+            return replaceDelta(current);
+
+        QJsonObject delta{{deltaArrayLengthKey, static_cast<qint64>(current.size())}};
+        if(!elements.isEmpty())
+            delta.insert(deltaElementsKey, elements);
+        return delta;
+    }
+
+    QJsonObject patchObject(QJsonObject value, const QJsonObject &delta)
+    {
+        const auto &removed = delta[deltaDeleteKey];
+        if(!removed.isUndefined() && !removed.isArray())
+            throw Error{HERE, Error::JsonCastError};
+        for(const auto &key : removed.toArray())
+            value.remove(key.toString());
+
+        const auto &nested = delta[deltaObjectKey];
+        if(!nested.isUndefined() && !nested.isObject())
+            throw Error{HERE, Error::JsonCastError};
+        const auto &nestedObj = nested.toObject();
+        for(auto itNested = nestedObj.begin(); itNested != nestedObj.end(); ++itNested)
+        {
+            value.insert(itNested.key(),
+                         jsonPatch(value.value(itNested.key()), itNested.value()));
+        }
+        return value;
+    }
+
+    QJsonArray patchArray(QJsonArray value, const QJsonObject &delta)
+    {
+        const auto &lengthValue = delta[deltaArrayLengthKey];
+        if(!lengthValue.isDouble() || lengthValue.toDouble() < 0)
+            throw Error{HERE, Error::JsonCastError};
+        auto length = static_cast<qsizetype>(lengthValue.toDouble());
+
+        while(value.size() > length)
+            value.removeLast();
+        // New elements are always given as "v" deltas; fill with null so the
+        // indices line up until they're patched below.
+        while(value.size() < length)
+            value.append(QJsonValue::Null);
+
+        const auto &elements = delta[deltaElementsKey];
+        if(!elements.isUndefined() && !elements.isObject())
+            throw Error{HERE, Error::JsonCastError};
+        const auto &elementsObj = elements.toObject();
+        for(auto itElement = elementsObj.begin(); itElement != elementsObj.end(); ++itElement)
+        {
+            bool indexOk{false};
+            qsizetype index = itElement.key().toLongLong(&indexOk);
+            if(!indexOk || index < 0 || index >= length)
+                throw Error{HERE, Error::JsonCastError};
+            value[index] = jsonPatch(value[index], itElement.value());
+        }
+        return value;
+    }
+}
+
+QJsonValue jsonDiff(const QJsonValue &prior, const QJsonValue &current)
+{
+    if(prior == current)
+        return QJsonValue::Undefined;
+
+    if(prior.isObject() && current.isObject())
+        return diffObject(prior.toObject(), current.toObject());
+    if(prior.isArray() && current.isArray())
+        return diffArray(prior.toArray(), current.toArray());
+    return replaceDelta(current);
+}
+
+QJsonValue jsonPatch(const QJsonValue &prior, const QJsonValue &delta)
+{
+    if(!delta.isObject())
+        throw Error{HERE, Error::JsonCastError};
+    const auto &deltaObj = delta.toObject();
+
+    auto itValue = deltaObj.find(deltaValueKey);
+    if(itValue != deltaObj.end())
+        return itValue.value();
+
+    if(deltaObj.contains(deltaArrayLengthKey))
+    {
+        if(!prior.isArray())
+            throw Error{HERE, Error::JsonCastError};
+        return patchArray(prior.toArray(), deltaObj);
+    }
+
+    if(!prior.isObject())
+        throw Error{HERE, Error::JsonCastError};
+    return patchObject(prior.toObject(), deltaObj);
+}
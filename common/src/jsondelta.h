@@ -0,0 +1,54 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "common.h"
+#line HEADER_FILE("jsondelta.h")
+
+#ifndef JSONDELTA_H
+#define JSONDELTA_H
+
+#include <QJsonValue>
+
+// Structural deltas between JSON values.  The daemon uses these to push only
+// the parts of large state properties (regionsMetadata, availableLocations,
+// groupedLocations, etc.) that actually changed to clients that negotiated
+// delta support.
+//
+// A delta is itself a JSON object in one of these forms:
+//   {"v": <value>}
+//      Replace the prior value entirely
+//   {"o": {<key>: <delta>, ...}, "d": [<key>, ...]}
+//      Object delta - apply nested deltas to the given keys (new keys use a
+//      "v" delta), and remove the keys listed in "d".  Both are optional.
+//   {"a": <length>, "e": {"<index>": <delta>, ...}}
+//      Array delta - truncate or extend the array to <length>, then apply
+//      nested deltas to the given indices (new elements use a "v" delta).
+//
+// A delta is only meaningful when applied to the same prior value it was
+// computed from; the caller is responsible for keeping the baselines in sync.
+
+// Compute a delta from 'prior' to 'current'.  Returns Undefined if the values
+// are equal.  When most of the value changed, this just returns a "v" delta,
+// since a structural delta would not be any smaller.
+COMMON_EXPORT QJsonValue jsonDiff(const QJsonValue &prior, const QJsonValue &current);
+
+// Apply a delta produced by jsonDiff() to 'prior'.  Throws if the delta is
+// malformed or doesn't match the structure of 'prior'.
+COMMON_EXPORT QJsonValue jsonPatch(const QJsonValue &prior, const QJsonValue &delta) throws(Error);
+
+#endif
@@ -20,23 +20,34 @@
 #line SOURCE_FILE("jsonrefresher.cpp")
 
 #include "jsonrefresher.h"
-#include "networktaskwithretry.h"
+#include "wakeupaccounting.h"
 #include "openssl.h"
 #include <QNetworkReply>
 #include <QDir>
 #include <QJsonArray>
 #include <QJsonObject>
 
+namespace
+{
+    const QString etagValidator{QStringLiteral("etag")};
+    const QString lastModifiedValidator{QStringLiteral("lastModified")};
+
+    // 304 Not Modified, in response to a conditional fetch
+    const int httpNotModified = 304;
+}
+
 JsonRefresher::JsonRefresher(QString name, QString resource,
                              std::chrono::milliseconds initialInterval,
                              std::chrono::milliseconds refreshInterval)
     : _name{std::move(name)}, _resource{std::move(resource)},
       _initialInterval{std::move(initialInterval)},
-      _refreshInterval{std::move(refreshInterval)}
+      _refreshInterval{std::move(refreshInterval)}, _intervalScale{1},
+      _usingRefreshInterval{false}, _replyGeneration{0}
 {
     connect(&_refreshTimer, &QTimer::timeout, this,
             &JsonRefresher::refreshTimerElapsed);
     _refreshTimer.setInterval(static_cast<int>(_initialInterval.count()));
+    tagWakeups(_refreshTimer, _name.toUtf8());
 }
 
 JsonRefresher::~JsonRefresher()
@@ -58,18 +69,20 @@ void JsonRefresher::refreshTimerElapsed()
     }
 
     // Fetch the resource.  Try each possible base URI one time.
-    Async<QByteArray> pBodyTask = Async<QByteArray>{new NetworkTaskWithRetry{
+    Async<NetworkTaskWithRetry> pBodyTask{new NetworkTaskWithRetry{
                                         QNetworkAccessManager::GetOperation,
                                         *_pApiBaseUris, _resource,
                                         ApiRetries::counted(_pApiBaseUris->getAttemptCount(1)),
-                                        {}, {}}};
+                                        {}, {}, conditionalHeaders()}};
+    // The body task is alive when it invokes the callback below
+    const NetworkTaskWithRetry *pRequest = pBodyTask.get();
     // Use next() instead of notify() so we can abandon the task (if the
     // JsonRefresher is stopped) by dropping our reference to the outermost
     // task.
     // Note that the stored task refers to the void result of our callback, not
     // to the QByteArray result of the body task.
     _pFetchTask = pBodyTask->next(this,
-            [this](const Error& error, const QByteArray& body)
+            [this, pRequest](const Error& error, const QByteArray& body)
             {
                 // We shouldn't get this signal if we're not running; we abandon
                 // tasks when stopped.
@@ -87,12 +100,50 @@ void JsonRefresher::refreshTimerElapsed()
                 }
                 else
                 {
-                    emitReply(body);
+                    fetchCompleted(*pRequest, body);
                 }
             });
 }
 
-QJsonDocument JsonRefresher::readReply(QByteArray responsePayload) const
+void JsonRefresher::fetchCompleted(const NetworkTaskWithRetry &request,
+                                   QByteArray body)
+{
+    // We only send validators for content that was accepted, so "not
+    // modified" means the accepted content is still current.  There's nothing
+    // to verify or parse, just count it as a successful load.
+    if(request.replyStatus() == httpNotModified && !_validators.isEmpty())
+    {
+        qInfo() << "Cached" << _name << "is not modified";
+        _pendingValidators = _validators;
+        loadSucceeded();
+        return;
+    }
+
+    QJsonObject validators;
+    QByteArray etag = request.replyHeader(QByteArrayLiteral("ETag"));
+    if(!etag.isEmpty())
+        validators.insert(etagValidator, QString::fromLatin1(etag));
+    QByteArray lastModified = request.replyHeader(QByteArrayLiteral("Last-Modified"));
+    if(!lastModified.isEmpty())
+        validators.insert(lastModifiedValidator, QString::fromLatin1(lastModified));
+    emitReply(std::move(body), std::move(validators));
+}
+
+NetworkTaskWithRetry::RawHeaders JsonRefresher::conditionalHeaders() const
+{
+    NetworkTaskWithRetry::RawHeaders headers;
+    const auto &etag = _validators.value(etagValidator).toString();
+    if(!etag.isEmpty())
+        headers.push_back({QByteArrayLiteral("If-None-Match"), etag.toLatin1()});
+    const auto &lastModified = _validators.value(lastModifiedValidator).toString();
+    if(!lastModified.isEmpty())
+        headers.push_back({QByteArrayLiteral("If-Modified-Since"), lastModified.toLatin1()});
+    return headers;
+}
+
+QJsonDocument JsonRefresher::readReply(const QString &name,
+                                       const QByteArray &signatureKey,
+                                       QByteArray responsePayload)
 {
     // The response can optionally contain a GPG signature appended to the
     // end after a double newline. If one exists, verify that it matches
@@ -108,35 +159,35 @@ QJsonDocument JsonRefresher::readReply(QByteArray responsePayload) const
         if (end >= 0 && end != responsePayload.length() - 1)
         {
             if (end + 2 >= responsePayload.length() || responsePayload.at(end + 1) != '\n' || responsePayload.at(end + 2) != '\n')
-                qWarning() << "Nonstandard appended data found after JSON response for" << _name;
+                qWarning() << "Nonstandard appended data found after JSON response for" << name;
             signature = QByteArray::fromBase64(responsePayload.mid(end + 1));
             responsePayload.truncate(end + 1);
         }
     }
 
     // If a key was supplied, check that there is a valid signature.
-    if (!_signatureKey.isNull())
+    if (!signatureKey.isNull())
     {
         if (signature.isEmpty())
         {
-            qError() << "Missing signature in response for" << _name;
+            qError() << "Missing signature in response for" << name;
             return {};
         }
-        if (!verifySignature(_signatureKey, signature, responsePayload))
+        if (!verifySignature(signatureKey, signature, responsePayload))
         {
             // Urgh; piaproxy.net alters content in-transit without re-signing it...
             // Make a single educated guess what the original content was.
-            if (!verifySignature(_signatureKey, signature, QByteArray(responsePayload).replace(".piaproxy.net", ".privateinternetaccess.com")))
+            if (!verifySignature(signatureKey, signature, QByteArray(responsePayload).replace(".piaproxy.net", ".privateinternetaccess.com")))
             {
-                qError() << "Invalid signature in response for" << _name;
+                qError() << "Invalid signature in response for" << name;
                 return {};
             }
         }
-        qInfo() << "Verified signature in response for" << _name;
+        qInfo() << "Verified signature in response for" << name;
     }
     else if (!signature.isEmpty())
     {
-        qWarning() << "Unexpected signature found in response for" << _name;
+        qWarning() << "Unexpected signature found in response for" << name;
     }
 
     // Parse the JSON response
@@ -145,7 +196,7 @@ QJsonDocument JsonRefresher::readReply(QByteArray responsePayload) const
                                                          &parseError);
     if(jsonDoc.isNull())
     {
-        qWarning() << "Could not parse" << _name << "due to error:"
+        qWarning() << "Could not parse" << name << "due to error:"
             << parseError.error << "at position" << parseError.offset;
         qWarning() << "Retrieved JSON:" << responsePayload.data();
         return {};
@@ -155,11 +206,31 @@ QJsonDocument JsonRefresher::readReply(QByteArray responsePayload) const
     return jsonDoc;
 }
 
-void JsonRefresher::emitReply(QByteArray responsePayload)
+void JsonRefresher::emitReply(QByteArray responsePayload, QJsonObject validators)
 {
-    QJsonDocument doc{readReply(std::move(responsePayload))};
-    if(!doc.isNull())
-        emit contentLoaded(doc);
+    // The worker only uses copies of the name and key, they can change on this
+    // thread while a reply is being read.  'this' is valid until the worker
+    // is destroyed, which waits for the reply.
+    _replyWorker.queueOnThread(
+        [this, name = _name, signatureKey = _signatureKey,
+         generation = _replyGeneration,
+         responsePayload = std::move(responsePayload),
+         validators = std::move(validators)]() mutable
+        {
+            QJsonDocument doc{readReply(name, signatureKey, std::move(responsePayload))};
+            if(doc.isNull())
+                return;
+            QMetaObject::invokeMethod(this,
+                [this, generation, doc = std::move(doc),
+                 validators = std::move(validators)]()
+                {
+                    // Discard the result if we were stopped in the meantime
+                    if(generation != _replyGeneration)
+                        return;
+                    _pendingValidators = validators;
+                    emit contentLoaded(doc);
+                }, Qt::QueuedConnection);
+        });
 }
 
 bool JsonRefresher::processOverrideFile(const QString &overridePath)
@@ -221,7 +292,8 @@ void JsonRefresher::startOrOverride(std::shared_ptr<ApiBase> pApiBaseUris,
                                     const QString &overridePath,
                                     const QString &bundledPath,
                                     const QByteArray &signatureKey,
-                                    const QJsonDocument &cache)
+                                    const QJsonDocument &cache,
+                                    const QJsonObject &validators)
 {
     Q_ASSERT(pApiBaseUris); // Ensured by caller
 
@@ -230,6 +302,9 @@ void JsonRefresher::startOrOverride(std::shared_ptr<ApiBase> pApiBaseUris,
     stop();
 
     _signatureKey = signatureKey;
+    // Don't make conditional fetches until content has been accepted
+    _validators = {};
+    _pendingValidators = {};
 
     if(processOverrideFile(overridePath))
     {
@@ -250,6 +325,7 @@ void JsonRefresher::startOrOverride(std::shared_ptr<ApiBase> pApiBaseUris,
     if(isCacheValid(cache))
     {
         qInfo() << "Using cached data for initial" << _name;
+        _pendingValidators = validators;
         emit contentLoaded(cache);
     }
     // Otherwise, use the bundled data if it's present.  Note that this still
@@ -258,7 +334,7 @@ void JsonRefresher::startOrOverride(std::shared_ptr<ApiBase> pApiBaseUris,
     else if(bundledRegionFile.open(QFile::OpenModeFlag::ReadOnly))
     {
         qInfo() << "Loading initial" << _name << "from bundled file";
-        emitReply(bundledRegionFile.readAll());
+        emitReply(bundledRegionFile.readAll(), {});
     }
 
     // Then, start fetching from the endpoint.  Start with the fast interval,
@@ -273,6 +349,8 @@ void JsonRefresher::stop()
     if(isRunning())
     {
         _refreshTimer.stop();
+        // Discard any reply that's still being read
+        ++_replyGeneration;
         // If there's an ongoing request right now, abandon it.
         if(_pFetchTask)
         {
@@ -294,6 +372,7 @@ void JsonRefresher::refresh()
     // change the timer interval.  Here, we specifically want to issue a request
     // now and then wait the full _initialInterval - calling start() this way
     // is documented as restarting the timer if it was running before.
+    _usingRefreshInterval = false;
     if(isRunning())
     {
         // Issue a new request now
@@ -313,8 +392,27 @@ void JsonRefresher::loadSucceeded()
 {
     //A load succeeded.  If we were still using the shorter initial
     //interval, switch to the longer refresh interval.
-    if(std::chrono::milliseconds{_refreshTimer.interval()} != _refreshInterval)
+    if(!_usingRefreshInterval)
+    {
+        _usingRefreshInterval = true;
+        _refreshTimer.setInterval(msec32(_refreshInterval * _intervalScale));
+    }
+
+    if(_pendingValidators != _validators)
     {
-        _refreshTimer.setInterval(static_cast<int>(_refreshInterval.count()));
+        _validators = _pendingValidators;
+        emit validatorsChanged(_validators);
     }
 }
+
+void JsonRefresher::setIntervalScale(int scale)
+{
+    Q_ASSERT(scale >= 1);
+    if(scale == _intervalScale)
+        return;
+    _intervalScale = scale;
+    // Changing the interval restarts the timer if it's running; the next
+    // refresh is then a full (scaled) interval from now
+    if(_usingRefreshInterval)
+        _refreshTimer.setInterval(msec32(_refreshInterval * _intervalScale));
+}
@@ -24,8 +24,11 @@
 #include "async.h"
 #include "testshim.h"
 #include "filewatcher.h"
+#include "thread.h"
+#include "networktaskwithretry.h"
 #include <QObject>
 #include <QJsonDocument>
+#include <QJsonObject>
 #include <QByteArray>
 #include <QSharedPointer>
 #include <QTimer>
@@ -41,6 +44,15 @@
 // that URI will be the first one tried for subsequent attempts.
 //
 // The JSON payload is expected to have a GPG signature if signatureKey is set.
+// Verifying and parsing the payload occur on a worker thread, since the
+// resources can be large; contentLoaded() is still emitted on the
+// JsonRefresher's thread.
+//
+// Fetches are conditional when the content is cached - the validators
+// (ETag/Last-Modified) of the cached content are sent, and if the server
+// replies "304 Not Modified", the cached content is still current; nothing is
+// verified, parsed, or emitted.  The validators are provided with
+// validatorsChanged() to be persisted alongside the cache.
 class COMMON_EXPORT JsonRefresher : public QObject
 {
     Q_OBJECT
@@ -55,11 +67,20 @@ public:
 private:
     void refreshTimerElapsed();
     // Read a reply payload into a QJsonDocument, including validating the
-    // signature if a key is configured on this JsonRefresher.  If the response
-    // can't be read for any reason, returns a null QJsonDocument.
-    QJsonDocument readReply(QByteArray responsePayload) const;
-    // Read a reply, and emit it to contentLoaded() if successful.
-    void emitReply(QByteArray responsePayload);
+    // signature if a signature key is given.  If the response can't be read
+    // for any reason, returns a null QJsonDocument.
+    //
+    // This is static since it's called on the worker thread.
+    static QJsonDocument readReply(const QString &name,
+                                   const QByteArray &signatureKey,
+                                   QByteArray responsePayload);
+    // Read a reply on the worker thread, and emit it to contentLoaded() if
+    // successful.  'validators' are the validators of this content.
+    void emitReply(QByteArray responsePayload, QJsonObject validators);
+    // Handle a completed fetch, including a conditional "not modified" reply
+    void fetchCompleted(const NetworkTaskWithRetry &request, QByteArray body);
+    // Request headers for a conditional fetch based on _validators
+    NetworkTaskWithRetry::RawHeaders conditionalHeaders() const;
 
     bool processOverrideFile(const QString &overridePath);
 
@@ -92,13 +113,18 @@ public:
     // - Otherwise, just start the refresher - there may be no data available
     //   until it loads the resource.
     //
+    // 'validators' are the validators of 'cache' from validatorsChanged().
+    // They're used for conditional fetches once the cache is accepted with
+    // loadSucceeded().
+    //
     // Emits overrideActive() if an override is active, or overrideFailed() if
     // an override was present but could not be loaded.
     void startOrOverride(std::shared_ptr<ApiBase> pApiBaseUris,
                          const QString &overridePath,
                          const QString &bundledPath,
                          const QByteArray &signatureKey,
-                         const QJsonDocument &cache);
+                         const QJsonDocument &cache,
+                         const QJsonObject &validators = {});
     // Stop refreshing the resource.  If a request was in-flight, it is
     // canceled (contentLoaded() cannot be emitted while stopped).
     void stop();
@@ -119,12 +145,26 @@ public:
     //
     // This isn't implicitly done when contentLoaded is emitted, because there
     // may be resource-specific validation done on the JSON body.
+    //
+    // The content's validators are used for subsequent conditional fetches
+    // once it has been accepted, which may emit validatorsChanged().
     void loadSucceeded();
 
+    // Scale the long refresh interval, such as to refresh less often on
+    // battery power.  The short initial interval isn't scaled, since that's
+    // used until the resource has been loaded at all.  If the timer is using
+    // the long interval, it's restarted with the new interval.
+    void setIntervalScale(int scale);
+
 signals:
     // Emitted any time the content of the resource is successfully loaded.
     void contentLoaded(const QJsonDocument &content);
 
+    // The validators for the last content accepted with loadSucceeded() have
+    // changed.  Persist these with the cached content to pass to
+    // startOrOverride().
+    void validatorsChanged(const QJsonObject &validators);
+
     // An override file was present and loaded by startOrOverride().
     void overrideActive();
     // An override file was present during startOrOverride(), but could not be
@@ -138,12 +178,26 @@ public:
     std::shared_ptr<ApiBase> _pApiBaseUris;
     QString _resource;
     std::chrono::milliseconds _initialInterval, _refreshInterval;
+    // Factor applied to _refreshInterval (see setIntervalScale())
+    int _intervalScale;
+    // Whether _refreshTimer is using the long interval
+    bool _usingRefreshInterval;
     QTimer _refreshTimer;
     // If a fetch task is ongoing, it's held here.  Dropping this reference
     // abandons the task.
     Async<void> _pFetchTask;
     QByteArray _signatureKey;
     nullable_t<FileWatcher> _pOverrideFileWatcher;
+    // Validators of the last accepted content, used for conditional fetches.
+    // _pendingValidators are those of the last emitted content, which become
+    // _validators if the content is accepted.
+    QJsonObject _validators, _pendingValidators;
+    // Incremented when stopped, so replies still being read on the worker
+    // thread are discarded.
+    quint64 _replyGeneration;
+    // Reads replies - last, so it's destroyed (and waits for any reply being
+    // read) before the rest of JsonRefresher.
+    RunningWorkerThread _replyWorker;
 };
 
 #endif
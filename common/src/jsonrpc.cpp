@@ -20,6 +20,8 @@
 #line SOURCE_FILE("jsonrpc.cpp")
 
 #include "jsonrpc.h"
+#include <QCborValue>
+#include <QCborMap>
 
 namespace
 {
@@ -32,8 +34,45 @@ namespace
     }
 }
 
+namespace
+{
+    bool isJsonText(const QByteArray &msg)
+    {
+        if(msg.isEmpty())
+            return true;    // Let the JSON parser produce the error
+        switch(msg.front())
+        {
+            case '{':
+            case '[':
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    QJsonObject parseCborRPCMessage(const QByteArray &msg) throws(Error)
+    {
+        QCborParserError error;
+        QCborValue cbor = QCborValue::fromCbor(msg, &error);
+        if(error.error != QCborError::NoError)
+            throw JsonRPCParseError(HERE, error.errorString());
+        if(cbor.isArray())
+            throw JsonRPCInvalidRequestError(HERE, "batch messages not supported");
+        else if(!cbor.isMap())
+            throw JsonRPCInvalidRequestError(HERE, "unrecognized message");
+        return cbor.toMap().toJsonObject();
+    }
+}
+
 QJsonObject parseJsonRPCMessage(const QByteArray &msg) throws(Error)
 {
+    if(!isJsonText(msg))
+        return parseCborRPCMessage(msg);
+
     QJsonParseError error;
     QJsonDocument json = QJsonDocument::fromJson(msg, &error);
     if (error.error != QJsonParseError::NoError)
@@ -66,6 +105,18 @@ void parseJsonRPCRequest(const QJsonObject &request, QString &method, QJsonArray
         params = QJsonArray();
 }
 
+QByteArray buildJsonRPCNotification(const QString &method, const QJsonArray &params,
+                                    JsonRPCEncoding encoding)
+{
+    QJsonObject msg;
+    msg[QStringLiteral("jsonrpc")] = QStringLiteral("2.0");
+    msg[QStringLiteral("method")] = method;
+    msg[QStringLiteral("params")] = params;
+    if(encoding == JsonRPCEncoding::Cbor)
+        return QCborValue::fromJsonValue(msg).toCbor();
+    return QJsonDocument(msg).toJson(QJsonDocument::Compact);
+}
+
 Async<QJsonValue> LocalMethod::operator()(const QJsonArray &params) noexcept
 {
     try
@@ -138,11 +189,13 @@ Async<QJsonValue> LocalMethodRegistry::invoke(const QString &method, const QJson
         // be traced by LocalCallInterface if the result is being sent back to
         // the caller, but this only happens if the caller is interested in the
         // result (the GUI client frequently ignores the result).
+        auto start = std::chrono::steady_clock::now();
         try
         {
             return (*it)(params)
-                ->next([method](const Error &err, const QJsonValue &result)
+                ->next([this, method, start](const Error &err, const QJsonValue &result)
                 {
+                    recordInvocation(method, err, start);
                     if(err)
                     {
                         qWarning() << "Invocation of" << method
@@ -162,16 +215,19 @@ Async<QJsonValue> LocalMethodRegistry::invoke(const QString &method, const QJson
         }
         catch(const Error &error)
         {
+            recordInvocation(method, true, start);
             qWarning() << "Invocation of" << method << "threw error:" << error;
             throw;
         }
         catch(const std::exception &ex)
         {
+            recordInvocation(method, true, start);
             qWarning() << "Invocation of" << method << "threw exception:" << ex.what();
             throw;
         }
         catch(...)
         {
+            recordInvocation(method, true, start);
             qWarning() << "Invocation of" << method << "threw unknown exception";
             throw;
         }
@@ -183,6 +239,31 @@ Async<QJsonValue> LocalMethodRegistry::invoke(const QString &method, const QJson
     }
 }
 
+void LocalMethodRegistry::recordInvocation(const QString &method, bool error,
+                                           std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    MethodStats &stats = _stats[method];
+    ++stats.calls;
+    if(error)
+        ++stats.errors;
+    stats.totalTime += elapsed;
+    stats.maxTime = std::max(stats.maxTime, elapsed);
+}
+
+void LocalMethodRegistry::traceStats() const
+{
+    for(auto itStats = _stats.begin(); itStats != _stats.end(); ++itStats)
+    {
+        const MethodStats &stats = itStats.value();
+        auto avgTime = stats.calls ? stats.totalTime / stats.calls : std::chrono::microseconds{};
+        qInfo() << "RPC" << itStats.key() << "-" << stats.calls << "calls,"
+            << stats.errors << "errors, avg" << avgTime.count() << "us, max"
+            << stats.maxTime.count() << "us";
+    }
+}
+
 LocalNotificationInterface::LocalNotificationInterface(LocalMethodRegistry *registry, QObject *parent)
     : QObject(parent), _registry(registry)
 {
@@ -300,6 +381,12 @@ bool LocalCallInterface::processRequest(const QJsonObject &request)
     }
 }
 
+void LocalCallInterface::processParseError(const Error &error)
+{
+    qWarning() << error;
+    respondWithError(QJsonValue::Null, error);
+}
+
 void LocalCallInterface::respondWithResult(const QJsonValue &id, const QJsonValue &result)
 {
     // Indicate success, but don't trace the result (can't clean the result for
@@ -523,3 +610,74 @@ bool ServerSideInterface::processMessage(const QByteArray &msg)
 {
     return _local.processMessage(msg);
 }
+
+bool ServerSideInterface::processRequest(const QJsonObject &request)
+{
+    return _local.processRequest(request);
+}
+
+void ServerSideInterface::processParseError(const Error &error)
+{
+    _local.processParseError(error);
+}
+
+void JsonRPCParseThread::queueParse(const QByteArray &msg, QPointer<JsonRPCParseQueue> pReceiver)
+{
+    // Deliver the result back using the RunningWorkerThread as the context
+    // object - it lives on the requesting thread and outlives the worker.
+    // pReceiver is only dereferenced on the requesting thread.
+    QObject *pContext = &_worker;
+    _worker.queueOnThread([msg, pReceiver, pContext]()
+    {
+        QJsonObject request;
+        Error error;
+        try
+        {
+            request = parseJsonRPCMessage(msg);
+        }
+        catch(const Error &parseError)
+        {
+            error = parseError;
+        }
+        QMetaObject::invokeMethod(pContext,
+            [pReceiver, request = std::move(request), error = std::move(error)]()
+            {
+                if(pReceiver)
+                    pReceiver->onParsed(request, error);
+            }, Qt::QueuedConnection);
+    });
+}
+
+JsonRPCParseQueue::JsonRPCParseQueue(JsonRPCParseThread &parseThread, QObject *pParent)
+    : QObject{pParent}, _parseThread{parseThread}, _pendingParses{0}
+{
+}
+
+void JsonRPCParseQueue::parseMessage(const QByteArray &msg)
+{
+    if(_pendingParses == 0 && msg.size() < ThreadedParseThreshold)
+    {
+        try
+        {
+            emit requestParsed(parseJsonRPCMessage(msg));
+        }
+        catch(const Error &error)
+        {
+            emit parseError(error);
+        }
+        return;
+    }
+
+    ++_pendingParses;
+    _parseThread.queueParse(msg, this);
+}
+
+void JsonRPCParseQueue::onParsed(const QJsonObject &request, const Error &error)
+{
+    Q_ASSERT(_pendingParses > 0);
+    --_pendingParses;
+    if(error)
+        emit parseError(error);
+    else
+        emit requestParsed(request);
+}
@@ -25,6 +25,7 @@
 
 #include "async.h"
 #include "json.h"
+#include "thread.h"
 
 #include <QHash>
 #include <QJsonArray>
@@ -32,14 +33,31 @@
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QObject>
+#include <QPointer>
 #include <QSet>
 
+#include <chrono>
 #include <cmath>
 #include <initializer_list>
 
 
+// Messages are normally UTF-8 JSON text.  Peers that negotiate it can also
+// receive CBOR-encoded messages (see IPCConnection::sendBinaryMessage());
+// parseJsonRPCMessage() accepts either, distinguishing them by the first
+// byte (JSON text always begins with '{', '[', or whitespace here).
+enum class JsonRPCEncoding
+{
+    Json,
+    Cbor,
+};
+
 COMMON_EXPORT QJsonObject parseJsonRPCMessage(const QByteArray& msg) throws(Error);
 COMMON_EXPORT void parseJsonRPCRequest(const QJsonObject& request, QString& method, QJsonArray& params) throws(Error);
+// Build a serialized JSON-RPC notification (no ID) in the given encoding.
+// Used when the same notification is sent to many peers, so it can be
+// serialized once per encoding rather than once per peer.
+COMMON_EXPORT QByteArray buildJsonRPCNotification(const QString &method, const QJsonArray &params,
+                                                  JsonRPCEncoding encoding);
 
 
 // Helper type that wraps a callable of a given signature and converts the
@@ -173,8 +191,25 @@ public:
 public:
     Async<QJsonValue> invoke(const QString& method, const QJsonArray& params);
 
+    // Trace the per-method invocation counters (call count, errors, and time
+    // until the result was available).
+    void traceStats() const;
+
+private:
+    struct MethodStats
+    {
+        quint64 calls{0};
+        quint64 errors{0};
+        std::chrono::microseconds totalTime{0};
+        std::chrono::microseconds maxTime{0};
+    };
+
+    void recordInvocation(const QString &method, bool error,
+                          std::chrono::steady_clock::time_point start);
+
 private:
     QHash<QString, std::function<Async<QJsonValue>(const QJsonArray&)>> _methods;
+    QHash<QString, MethodStats> _stats;
 };
 
 
@@ -212,6 +247,9 @@ public:
 public slots:
     virtual bool processMessage(const QByteArray& msg) override;
     virtual bool processRequest(const QJsonObject& request) override;
+    // Respond to a message that could not be parsed (when the message was
+    // parsed elsewhere, such as by JsonRPCParseThread)
+    void processParseError(const Error &error);
 
 protected:
     void respondWithResult(const QJsonValue& id, const QJsonValue& result);
@@ -307,11 +345,66 @@ public:
 
 public slots:
     bool processMessage(const QByteArray& msg);
+    // Process a message that was already parsed with parseJsonRPCMessage(),
+    // or the error that resulted from parsing
+    bool processRequest(const QJsonObject &request);
+    void processParseError(const Error &error);
 
 private:
     LocalCallInterface _local;
 };
 
+// Parses JSON-RPC messages on a worker thread, so large requests (such as
+// applySettings with many split tunnel rules) don't block the receiving thread.
+// The parsed requests (or parse errors) are delivered back to the requesting
+// thread in the order the messages were queued.
+//
+// Small messages aren't worth the thread hop; JsonRPCParseQueue parses those
+// inline when nothing is pending.  One JsonRPCParseThread can be shared by
+// many JsonRPCParseQueues.
+class COMMON_EXPORT JsonRPCParseThread
+{
+public:
+    // Queue a message for parsing.  The result is delivered to 'pReceiver' on
+    // its thread if it still exists.
+    void queueParse(const QByteArray &msg, QPointer<class JsonRPCParseQueue> pReceiver);
+
+private:
+    RunningWorkerThread _worker;
+};
+
+class COMMON_EXPORT JsonRPCParseQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum : qsizetype
+    {
+        // Messages at least this large are parsed on the parse thread
+        ThreadedParseThreshold = 16 * 1024,
+    };
+
+public:
+    JsonRPCParseQueue(JsonRPCParseThread &parseThread, QObject *pParent = nullptr);
+
+public:
+    void parseMessage(const QByteArray &msg);
+
+private:
+    friend class JsonRPCParseThread;
+    void onParsed(const QJsonObject &request, const Error &error);
+
+signals:
+    void requestParsed(const QJsonObject &request);
+    void parseError(const Error &error);
+
+private:
+    JsonRPCParseThread &_parseThread;
+    // Number of messages queued to the parse thread and not yet delivered -
+    // if nonzero, small messages have to be queued too to preserve order.
+    int _pendingParses;
+};
+
 // Inline function definitions
 
 template<typename... Args>
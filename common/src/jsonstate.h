@@ -20,6 +20,7 @@
 #include "common.h"
 #include <kapps_core/src/corejson.h>
 #include <kapps_core/src/coresignal.h>
+#include <memory>
 #include <unordered_map>
 
 // JsonState represents a set of state properties using JSON.  The properties
@@ -88,6 +89,12 @@
 #define JsonProperty(T, name, ...) \
     Property<T> name{*this, #name,##__VA_ARGS__}
 
+// Like JsonProperty(), but declares a CachedProperty<>, which keeps the JSON
+// representation once it's rendered until the value changes.  Use this for
+// large values that change rarely but are serialized often.
+#define JsonCachedProperty(T, name, ...) \
+    CachedProperty<T> name{*this, #name,##__VA_ARGS__}
+
 // The JsonState class keeps track of the defined properties so the complete
 // JSON object can be assembled with getJsonObject() and general property
 // changes can be observed.
@@ -171,6 +178,7 @@ public:
             if(!(value == _value))
             {
                 _value = std::move(value);
+                valueChanged();
                 this->signalChange();
             }
         }
@@ -183,10 +191,52 @@ public:
             return JsonT(_value);
         }
 
+    protected:
+        // Called when the value changes, before the change is signaled
+        virtual void valueChanged() {}
+
     private:
         T _value;
     };
 
+    // CachedProperty keeps the JSON representation of the value after it's
+    // first rendered, and reuses it until the value changes.
+    //
+    // This is used for the large DaemonState values (the regions lists and
+    // metadata).  These are serialized for each client's change notification
+    // and for snapshots, but typically only change when the regions list is
+    // refreshed.  (Those values hold their locations as shared immutable
+    // objects that are reused when unchanged, so equality is mostly pointer
+    // comparisons already; the serialization was the remaining cost.)
+    template<class T>
+    class CachedProperty : public Property<T>
+    {
+    public:
+        using Property<T>::Property;
+
+        // Assignment is inherited from Property; the cached JSON is discarded
+        // if the value changes, and it's not copied from other.
+        CachedProperty &operator=(const CachedProperty &other)
+        {
+            Property<T>::operator=(other);
+            return *this;
+        }
+
+    public:
+        virtual JsonT getJson() const override
+        {
+            if(!_pJson)
+                _pJson.reset(new JsonT(Property<T>::getJson()));
+            return *_pJson;
+        }
+
+    protected:
+        virtual void valueChanged() override {_pJson.reset();}
+
+    private:
+        mutable std::unique_ptr<JsonT> _pJson;
+    };
+
 public:
     // Default construction is fine; initially there are no properties until
     // the Property objects add themselves.
@@ -20,21 +20,29 @@
 #line SOURCE_FILE("linebuffer.cpp")
 
 #include "linebuffer.h"
+#include <QMetaMethod>
 
 void LineBuffer::append(const QByteArray &data)
 {
     _buffer += data;
 
-    int lineStartPos = 0;
-    int lineEndPos = _buffer.indexOf('\n', lineStartPos);
+    // Copies of each line are only needed if something is connected to
+    // lineComplete()
+    bool emitCopies = isSignalConnected(QMetaMethod::fromSignal(&LineBuffer::lineComplete));
+
+    qsizetype lineStartPos = 0;
+    qsizetype lineEndPos = _buffer.indexOf('\n', _scanPos);
     while(lineEndPos >= 0)
     {
-        int lineTrimmedEnd = lineEndPos;
+        qsizetype lineTrimmedEnd = lineEndPos;
         if(lineEndPos > lineStartPos && _buffer[lineEndPos-1] == '\r')
             --lineTrimmedEnd;
 
-        QByteArray line = _buffer.mid(lineStartPos, lineTrimmedEnd - lineStartPos);
-        emit lineComplete(line);
+        QByteArrayView line{_buffer.constData() + lineStartPos,
+                            lineTrimmedEnd - lineStartPos};
+        emit lineView(line);
+        if(emitCopies)
+            emit lineComplete(line.toByteArray());
 
         lineStartPos = lineEndPos + 1;
         lineEndPos = _buffer.indexOf('\n', lineStartPos);
@@ -42,11 +50,16 @@ void LineBuffer::append(const QByteArray &data)
 
     // lineStartPos is now the beginning of the last partial line in the buffer.
     // If the buffer content ended with '\n', it's the length of the buffer, so
-    // this empties the buffer.
-    _buffer = _buffer.mid(lineStartPos);
+    // this empties the buffer.  Completed lines are removed in place, which
+    // just moves the partial line (if any) to the front, and the buffer's
+    // capacity is kept for the next append().
+    if(lineStartPos > 0)
+        _buffer.remove(0, lineStartPos);
+    _scanPos = _buffer.size();
 }
 
 QByteArray LineBuffer::reset()
 {
+    _scanPos = 0;
     return std::exchange(_buffer, QByteArray{});
 }
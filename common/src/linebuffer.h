@@ -27,12 +27,17 @@
 // Any partial line that remains on destruction (a partial line that wasn't
 // terminated with a line break) is ignored.  If the process is restarted,
 // reset() can be used to reset the buffer.
+//
+// Each line is emitted as a view of the buffer with lineView(), and as a copy
+// with lineComplete() if anything is connected to it.  Consumers that just
+// parse or log the line should use lineView() to avoid allocating each line.
 class COMMON_EXPORT LineBuffer : public QObject
 {
     Q_OBJECT
 
 public:
-    // Add data to the buffer; emits lineComplete() for completed lines.
+    // Add data to the buffer; emits lineView() and lineComplete() for
+    // completed lines.
     void append(const QByteArray &data);
 
     // Reset the buffer; returns the partial line left in the buffer (if there
@@ -40,11 +45,18 @@ public:
     QByteArray reset();
 
 signals:
-    // A completed line was read
+    // A completed line was read.  The view refers to the buffer and is only
+    // valid during the signal, so this must only be connected with direct
+    // connections, and receivers must not call append() or reset().
+    void lineView(QByteArrayView line);
+    // A completed line was read (a copy of the line)
     void lineComplete(const QByteArray &line);
 
 private:
     QByteArray _buffer;
+    // Position in _buffer to resume searching for a line break - the partial
+    // line before this position is already known not to contain one.
+    qsizetype _scanPos{0};
 };
 
 #endif
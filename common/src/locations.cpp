@@ -22,7 +22,9 @@
 #include "locations.h"
 #include <kapps_regions/src/regionlist.h>
 #include <kapps_regions/src/metadata.h>
+#include <QCryptographicHash>
 #include <QJsonDocument>
+#include <optional>
 
 namespace
 {
@@ -49,17 +51,136 @@ const std::unordered_map<QString, QString> shadowsocksLegacyRegionMap
     {QStringLiteral("nl_amsterdam"), QStringLiteral("nl")}
 };
 
+namespace
+{
+    // DIP and manual region descriptions converted for kapps::regions.  The
+    // DedicatedIp and ManualRegion structures refer to strings held by this
+    // object.
+    class RegionInputs
+    {
+    public:
+        RegionInputs(const std::vector<AccountDedicatedIp> &dedicatedIps,
+                     const ManualServer &manualServer);
+        RegionInputs(const RegionInputs &) = delete;
+        RegionInputs &operator=(const RegionInputs &) = delete;
+
+    private:
+        // We can't reference QString data with a StringSlice because QString
+        // is UTF-16, we have to convert them
+        kapps::core::StringSlice qstrSlice(const QString &qstr)
+        {
+            _convertedStrings.push_back(qstr.toStdString());
+            return _convertedStrings.back();
+        }
+        // Similarly with the arrays of service groups
+        kapps::core::ArraySlice<const kapps::core::StringSlice>
+            serviceGroupsSlice(const std::vector<QString> &serviceGroups)
+        {
+            _convertedServiceGroups.push_back({});
+            _convertedServiceGroups.back().reserve(serviceGroups.size());
+            for(const auto &groupName : serviceGroups)
+                _convertedServiceGroups.back().push_back(qstrSlice(groupName));
+            return _convertedServiceGroups.back();
+        }
+
+    public:
+        const std::vector<kapps::regions::DedicatedIp> &dips() const {return _dips;}
+        const std::vector<kapps::regions::ManualRegion> &manual() const {return _manual;}
+
+    private:
+        std::deque<std::string> _convertedStrings;
+        std::deque<std::vector<kapps::core::StringSlice>> _convertedServiceGroups;
+        std::vector<kapps::regions::DedicatedIp> _dips;
+        std::vector<kapps::regions::ManualRegion> _manual;
+    };
+
+    RegionInputs::RegionInputs(const std::vector<AccountDedicatedIp> &dedicatedIps,
+                               const ManualServer &manualServer)
+    {
+        _dips.reserve(dedicatedIps.size());
+        for(const auto &accountDip : dedicatedIps)
+        {
+            _dips.push_back({qstrSlice(accountDip.id()),
+                             kapps::core::Ipv4Address{accountDip.ip().toStdString()},
+                             qstrSlice(accountDip.cn()),
+                             {}, // FQDN is not used in PIA
+                             serviceGroupsSlice(accountDip.serviceGroups()),
+                             qstrSlice(accountDip.regionId())});
+        }
+
+        _manual.reserve(1);
+        if(!manualServer.ip().isEmpty() && !manualServer.cn().isEmpty())
+        {
+            const std::vector<QString> &groups = manualServer.serviceGroups().empty() ?
+                manualRegionDefaultGroups : manualServer.serviceGroups();
+            _manual.push_back({manualRegionId,
+                               kapps::core::Ipv4Address{manualServer.ip().toStdString()},
+                               qstrSlice(manualServer.cn()),
+                               {},   // FQDN is not used in PIA
+                               serviceGroupsSlice(groups),
+                               qstrSlice(manualServer.correspondingRegionId()),
+                               manualServer.openvpnNcpSupport(),
+                               manualServer.openvpnUdpPorts(),
+                               manualServer.openvpnTcpPorts()});
+        }
+    }
+
+    // Build the Location objects for a RegionList.  If pPrevious is given,
+    // Locations are reused from it for regions that are identical and have
+    // the same latency.
+    LocationsById buildLocationsById(const LatencyMap &latencies,
+                                     const kapps::regions::RegionList &regionlist,
+                                     const LocationsById *pPrevious)
+    {
+        LocationsById newLocations;
+        newLocations.reserve(regionlist.regions().size());
+        for(const auto &pRegion : regionlist.regions())
+        {
+            if(!pRegion)
+                continue;
+            QString regionId{qs::toQString(pRegion->id())};
+            nullable_t<double> latency;
+            auto itLatency = latencies.find(regionId);
+            if(itLatency != latencies.end())
+                latency.emplace(itLatency->second);
+
+            std::string id{pRegion->id().to_string()};
+            if(pPrevious)
+            {
+                // Region's comparison covers everything Location exposes
+                // except the latency
+                auto itPrevious = pPrevious->find(id);
+                if(itPrevious != pPrevious->end() && itPrevious->second &&
+                   itPrevious->second->latency() == latency &&
+                   itPrevious->second->impl() == *pRegion)
+                {
+                    newLocations.emplace(std::move(id), itPrevious->second);
+                    continue;
+                }
+            }
+
+            newLocations.emplace(std::move(id),
+                QSharedPointer<Location>::create(pRegion->shared_from_this(), latency));
+        }
+        return newLocations;
+    }
+}
+
 auto buildModernLocations(const LatencyMap &latencies,
                           const QJsonObject &regionsObj,
                           const QJsonArray &shadowsocksObj,
                           const QJsonObject &metadataObj,
                           const std::vector<AccountDedicatedIp> &dedicatedIps,
-                          const ManualServer &manualServer)
+                          const ManualServer &manualServer,
+                          QByteArray *pImage, QString *pImageTag,
+                          const LocationsById *pPreviousLocations)
     -> std::pair<LocationsById, kapps::regions::Metadata>
 {
-    QByteArray regionsJson = QJsonDocument{regionsObj}.toJson();
-    QByteArray shadowsocksJson = QJsonDocument{shadowsocksObj}.toJson();
-    QByteArray metadataJson = QJsonDocument{metadataObj}.toJson();
+    // kapps::regions parses the lists from JSON text.  Render them compactly,
+    // they're only used for parsing and the image tag.
+    QByteArray regionsJson = QJsonDocument{regionsObj}.toJson(QJsonDocument::Compact);
+    QByteArray shadowsocksJson = QJsonDocument{shadowsocksObj}.toJson(QJsonDocument::Compact);
+    QByteArray metadataJson = QJsonDocument{metadataObj}.toJson(QJsonDocument::Compact);
     kapps::core::StringSlice regionsJsonSlice{regionsJson.data(),
         static_cast<std::size_t>(regionsJson.size())};
     kapps::core::StringSlice shadowsocksJsonSlice{shadowsocksJson.data(),
@@ -67,76 +188,63 @@ auto buildModernLocations(const LatencyMap &latencies,
     kapps::core::StringSlice metadataJsonSlice{metadataJson.data(),
         static_cast<std::size_t>(metadataJson.size())};
 
-    // We can't reference QString data with a StringSlice because QString is
-    // UTF-16, we have to convert them
-    std::deque<std::string> convertedStrings;
-    auto qstrSlice = [&](const QString &qstr) -> kapps::core::StringSlice
-    {
-        convertedStrings.push_back(qstr.toStdString());
-        return convertedStrings.back();
-    };
-    // Similarly with the arrays of service groups
-    std::deque<std::vector<kapps::core::StringSlice>> convertedServiceGroups;
-    auto serviceGroupsSlice = [&](const std::vector<QString> &serviceGroups)
-        -> kapps::core::ArraySlice<const kapps::core::StringSlice>
-    {
-        convertedServiceGroups.push_back({});
-        convertedServiceGroups.back().reserve(serviceGroups.size());
-        for(const auto &groupName : serviceGroups)
-            convertedServiceGroups.back().push_back(qstrSlice(groupName));
-        return convertedServiceGroups.back();
-    };
-    std::vector<kapps::regions::DedicatedIp> dips;
-    dips.reserve(dedicatedIps.size());
-    for(const auto &accountDip : dedicatedIps)
-    {
-        dips.push_back({qstrSlice(accountDip.id()),
-                        kapps::core::Ipv4Address{accountDip.ip().toStdString()},
-                        qstrSlice(accountDip.cn()),
-                        {}, // FQDN is not used in PIA
-                        serviceGroupsSlice(accountDip.serviceGroups()),
-                        qstrSlice(accountDip.regionId())});
-    }
+    RegionInputs inputs{dedicatedIps, manualServer};
 
-    std::vector<kapps::regions::ManualRegion> manual;
-    manual.reserve(1);
-    if(!manualServer.ip().isEmpty() && !manualServer.cn().isEmpty())
+    // The image is tagged with a hash of the lists it was built from, so an
+    // identical refresh produces an identical image
+    std::optional<kapps::regions::ImageWriter> image;
+    if(pImage)
     {
-        const std::vector<QString> &groups = manualServer.serviceGroups().empty() ?
-            manualRegionDefaultGroups : manualServer.serviceGroups();
-        manual.push_back({manualRegionId,
-                          kapps::core::Ipv4Address{manualServer.ip().toStdString()},
-                          qstrSlice(manualServer.cn()),
-                          {},   // FQDN is not used in PIA
-                          serviceGroupsSlice(groups),
-                          qstrSlice(manualServer.correspondingRegionId()),
-                          manualServer.openvpnNcpSupport(),
-                          manualServer.openvpnUdpPorts(),
-                          manualServer.openvpnTcpPorts()});
+        QCryptographicHash tagHash{QCryptographicHash::Sha256};
+        tagHash.addData(regionsJson);
+        tagHash.addData(shadowsocksJson);
+        tagHash.addData(metadataJson);
+        QString imageTag = QString::fromLatin1(tagHash.result().toHex());
+        image.emplace(imageTag.toStdString());
+        if(pImageTag)
+            *pImageTag = std::move(imageTag);
     }
 
     kapps::regions::RegionList regionlist{kapps::regions::RegionList::PIAv6,
                                           regionsJsonSlice, shadowsocksJsonSlice,
-                                          dips, manual};
+                                          inputs.dips(), inputs.manual(),
+                                          image ? &*image : nullptr};
     kapps::regions::Metadata metadata{regionsJsonSlice, metadataJsonSlice,
-                                      dips, manual};
+                                      inputs.dips(), inputs.manual(),
+                                      image ? &*image : nullptr};
 
-    LocationsById newLocations;
-    for(const auto &pRegion : regionlist.regions())
+    if(pImage)
     {
-        if(!pRegion)
-            continue;
-        QString regionId{qs::toQString(pRegion->id())};
-        nullable_t<double> latency;
-        auto itLatency = latencies.find(regionId);
-        if(itLatency != latencies.end())
-            latency.emplace(itLatency->second);
-
-        newLocations.emplace(pRegion->id().to_string(),
-            QSharedPointer<Location>::create(pRegion->shared_from_this(), latency));
+        const auto &imageData = image->data();
+        *pImage = QByteArray{reinterpret_cast<const char*>(imageData.data()),
+                             static_cast<int>(imageData.size())};
     }
 
-    return {std::move(newLocations), std::move(metadata)};
+    return {buildLocationsById(latencies, regionlist, pPreviousLocations),
+            std::move(metadata)};
+}
+
+auto buildModernLocationsFromImage(const LatencyMap &latencies,
+                                   const QByteArray &image,
+                                   const QString &imageTag,
+                                   const std::vector<AccountDedicatedIp> &dedicatedIps,
+                                   const ManualServer &manualServer,
+                                   const LocationsById *pPreviousLocations)
+    -> std::pair<LocationsById, kapps::regions::Metadata>
+{
+    RegionInputs inputs{dedicatedIps, manualServer};
+
+    std::string tag{imageTag.toStdString()};
+    kapps::regions::ImageReader reader{{reinterpret_cast<const std::uint8_t*>(image.data()),
+                                        static_cast<std::size_t>(image.size())},
+                                       tag};
+    kapps::regions::RegionList regionlist{reader, inputs.dips(), inputs.manual()};
+    kapps::regions::Metadata metadata{reader, inputs.dips(), inputs.manual()};
+    if(!reader.atEnd())
+        throw std::runtime_error{"Unexpected data at end of regions image"};
+
+    return {buildLocationsById(latencies, regionlist, pPreviousLocations),
+            std::move(metadata)};
 }
 
 // Compare two locations to sort them.
@@ -231,30 +339,72 @@ void buildGroupedLocations(const LocationsById &locations,
         });
 }
 
+int NearestLocations::selectionTier(const Location &location)
+{
+    // The tier precedence is auto-safe/non-geo, auto-safe/geo, non-geo, then
+    // everything else.
+    return (location.autoSafe() ? 0 : 2) + (location.geoLocated() ? 1 : 0);
+}
+
 NearestLocations::NearestLocations(const LocationsById &allLocations)
 {
+    // Offline locations are never selected, leave them out
     _locations.reserve(allLocations.size());
     for(const auto &locationEntry : allLocations)
-        _locations.push_back(locationEntry.second);
+    {
+        if(locationEntry.second && !locationEntry.second->offline())
+            _locations.push_back(locationEntry.second);
+    }
+
+    // Sort by the selection tiers, then by latency.
     std::sort(_locations.begin(), _locations.end(),
                    [](const auto &pFirst, const auto &pSecond) {
                        Q_ASSERT(pFirst);
                        Q_ASSERT(pSecond);
 
+                       int firstTier = selectionTier(*pFirst);
+                       int secondTier = selectionTier(*pSecond);
+                       if(firstTier != secondTier)
+                           return firstTier < secondTier;
                        return compareEntries(*pFirst, *pSecond);
                    });
+
+    for(const auto &pLocation : _locations)
+    {
+        for(std::size_t i = 0; i < _bestForService.size(); ++i)
+        {
+            if(!_bestForService[i] && pLocation->hasService(static_cast<Service>(i)))
+                _bestForService[i] = pLocation;
+        }
+        if(!_bestPortForward && pLocation->portForward())
+            _bestPortForward = pLocation;
+    }
 }
 
 QSharedPointer<const Location> NearestLocations::getNearestSafeVpnLocation(bool portForward) const
 {
     // If port forwarding is on, then find fastest server that supports port forwarding
-    if(portForward)
-    {
-        auto result = getBestMatchingLocation([](const Location &loc){return loc.portForward();});
-        if(result)
-            return result;
-    }
+    if(portForward && _bestPortForward)
+        return _bestPortForward;
 
     // otherwise just find the best non-PF server
     return getBestLocation();
 }
+
+QSharedPointer<const Location> NearestLocations::getBestLocationForService(Service service) const
+{
+    auto index = static_cast<std::size_t>(service);
+    if(index < _bestForService.size())
+        return _bestForService[index];
+    return {};
+}
+
+QSharedPointer<const Location> NearestLocations::getBestLocation() const
+{
+    if(_locations.empty())
+    {
+        qWarning() << "There are no available Server Locations!";
+        return {};
+    }
+    return _locations.front();
+}
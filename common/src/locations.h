@@ -24,17 +24,44 @@
 #include "settings/locations.h"
 #include "settings/dedicatedip.h"
 #include <kapps_regions/src/metadata.h>
+#include <algorithm>
+#include <array>
 
 
 // Build Location and Server objects for the modern region infrastructure from
 // the latencies, modern regions list, and Shadowsocks regions list.
 // Dedicated IPs and the dev manual server are added as additional regions.
+//
+// If pImage is given, a regions image of the parsed data is also built, and its
+// tag (a hash of the lists) is stored in pImageTag; see
+// buildModernLocationsFromImage().
+//
+// If pPreviousLocations is given, the Location objects from that generation
+// are reused for any region that hasn't changed (including its latency), so
+// unchanged locations keep their identity and aren't built again.
 COMMON_EXPORT auto buildModernLocations(const LatencyMap &latencies,
                                         const QJsonObject &regionsObj,
                                         const QJsonArray &shadowsocksObj,
                                         const QJsonObject &metadataObj,
                                         const std::vector<AccountDedicatedIp> &dedicatedIps,
-                                        const ManualServer &manualServer)
+                                        const ManualServer &manualServer,
+                                        QByteArray *pImage = nullptr,
+                                        QString *pImageTag = nullptr,
+                                        const LocationsById *pPreviousLocations = nullptr)
+    -> std::pair<LocationsById, kapps::regions::Metadata>;
+
+// Build the locations from a regions image created by buildModernLocations()
+// (pass pImage to create it).  The image holds the parsed regions lists and
+// metadata, so this doesn't need to parse any JSON; dedicated IPs and the
+// manual server are still applied from the current values.  Throws if the
+// image is invalid or doesn't have the expected tag.  pPreviousLocations is
+// used like buildModernLocations().
+COMMON_EXPORT auto buildModernLocationsFromImage(const LatencyMap &latencies,
+                                                 const QByteArray &image,
+                                                 const QString &imageTag,
+                                                 const std::vector<AccountDedicatedIp> &dedicatedIps,
+                                                 const ManualServer &manualServer,
+                                                 const LocationsById *pPreviousLocations = nullptr)
     -> std::pair<LocationsById, kapps::regions::Metadata>;
 
 // Build the grouped and sorted locations from the flat locations.
@@ -43,9 +70,15 @@ COMMON_EXPORT void buildGroupedLocations(const LocationsById &locations,
                                          std::vector<CountryLocations> &groupedLocations,
                                          std::vector<QSharedPointer<const Location>> &dedicatedIpLocations);
 
+// NearestLocations is an index of the available locations ordered for "auto"
+// selections (see the selection algorithm below).  It's built once each time
+// the locations change (the latencies are part of the locations), then
+// queries are scans that stop at the first match, and the best location for
+// each service is precomputed.
 class COMMON_EXPORT NearestLocations
 {
 public:
+    NearestLocations() = default;   // No locations
     NearestLocations(const LocationsById &locations);
 
 public:
@@ -91,6 +124,10 @@ public:
     // "requires Shadowsocks" is a hard requirement, but "supports port
     // forwarding" can be dropped.  This is handled contextually by falling back
     // from getBestMatchingLocation() to getBestLocation() if possible.
+    //
+    // The index is kept in exactly this order - sorted by the auto safe / not
+    // geo tier, then by latency - and offline locations are excluded, so the
+    // first location matching the context is the selection.
 
     // Find the closest server location that is safe, non-geo, and satisfies an
     // arbitrary predicate.
@@ -100,7 +137,7 @@ public:
     // do not match the predicate; use getBestLocation() as a fallback if that
     // is possible and this method fails to find a location.
     template<class LocationTestFunc>
-    QSharedPointer<const Location> getBestMatchingLocation(LocationTestFunc isAllowedBase) const
+    QSharedPointer<const Location> getBestMatchingLocation(LocationTestFunc isAllowed) const
     {
         if(_locations.empty())
         {
@@ -108,45 +145,10 @@ public:
             return {};
         }
 
-        // Ensure we never select an offline region
-        auto isAllowed = [&isAllowedBase](const Location &loc) {
-            return !loc.offline() && isAllowedBase(loc);
-        };
-
-        // Find the nearest matching server that's safe for auto and not geo.
         auto itResult = std::find_if(_locations.begin(), _locations.end(),
             [&isAllowed](const auto &pLocation)
             {
-                return pLocation && pLocation->autoSafe() &&
-                    !pLocation->geoLocated() && isAllowed(*pLocation);
-            });
-        if(itResult != _locations.end())
-            return *itResult;
-
-        // No matching locations are safe for auto and not geo.  Prefer auto
-        // safe; allow geo.
-        itResult = std::find_if(_locations.begin(), _locations.end(),
-            [&isAllowed](const auto &pLocation)
-            {
-                return pLocation && pLocation->autoSafe() && isAllowed(*pLocation);
-            });
-        if(itResult != _locations.end())
-            return *itResult;
-
-        // No auto-safe location is allowed.  Prefer a non-geo location.
-        itResult = std::find_if(_locations.begin(), _locations.end(),
-            [&isAllowed](const auto &pLocation)
-            {
-                return pLocation && !pLocation->geoLocated() && isAllowed(*pLocation);
-            });
-        if(itResult != _locations.end())
-            return *itResult;
-
-        // Allow any location regardless of auto/geo.
-        itResult = std::find_if(_locations.begin(), _locations.end(),
-            [&isAllowed](const auto &pLocation)
-            {
-                return pLocation && isAllowed(*pLocation);
+                return isAllowed(*pLocation);
             });
         if(itResult != _locations.end())
             return *itResult;
@@ -156,14 +158,61 @@ public:
         return {};
     }
 
-    QSharedPointer<const Location> getBestLocation() const
+    // Find the closest server location that has a particular service, per the
+    // selection above.  This is precomputed, so it doesn't scan the locations.
+    QSharedPointer<const Location> getBestLocationForService(Service service) const;
+
+    QSharedPointer<const Location> getBestLocation() const;
+
+    // Find the best server location that is safe to use with 'connect auto'
+    // based on a score rather than latency; used for the "quality" auto
+    // location mode.
+    //
+    // This considers the same locations as getNearestSafeVpnLocation() - the
+    // best selection tier, and port forwarding if requested and possible - and
+    // chooses the one with the lowest score among those.  Ties are broken by
+    // latency.
+    template<class ScoreFunc>
+    QSharedPointer<const Location> getBestScoringVpnLocation(bool portForward,
+                                                             ScoreFunc score) const
     {
-        // No context criterion, just use a default predicate.
-        return getBestMatchingLocation([](const Location &){return true;});
+        bool requirePf = portForward && _bestPortForward;
+        QSharedPointer<const Location> pBest;
+        int bestTier{0};
+        double bestScore{0.0};
+        for(const auto &pLocation : _locations)
+        {
+            if(requirePf && !pLocation->portForward())
+                continue;
+            int tier = selectionTier(*pLocation);
+            // The locations are sorted by tier; stop when leaving the tier of
+            // the first candidate
+            if(pBest && tier != bestTier)
+                break;
+            double locationScore = score(*pLocation);
+            if(!pBest || locationScore < bestScore)
+            {
+                pBest = pLocation;
+                bestTier = tier;
+                bestScore = locationScore;
+            }
+        }
+        return pBest;
     }
 
 private:
+    // Selection tier of a location (lower is better); see the selection
+    // algorithm above.
+    static int selectionTier(const Location &location);
+
+private:
+    // Online locations, in selection order
     std::vector<QSharedPointer<const Location>> _locations;
+    // The first location in _locations with each Service (indexed by Service;
+    // Meta is the last Service), and the first that supports port forwarding
+    std::array<QSharedPointer<const Location>,
+               static_cast<std::size_t>(Service::Meta) + 1> _bestForService;
+    QSharedPointer<const Location> _bestPortForward;
 };
 
 #endif
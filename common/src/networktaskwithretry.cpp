@@ -26,11 +26,26 @@
 #include <QTimer>
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QPointer>
 
 namespace
 {
     const QByteArray authHeaderName{QByteArrayLiteral("Authorization")};
 
+    // The parts of an API reply used by NetworkTaskWithRetry.  These are
+    // read on the network thread, where the reply lives, and handled on the
+    // requesting thread.
+    struct ApiReplyResult
+    {
+        QNetworkReply::NetworkError error{QNetworkReply::NetworkError::NoError};
+        int statusCode{0};
+        QByteArray statusMsg;
+        QByteArray retryAfter;
+        QList<QNetworkReply::RawHeaderPair> headers;
+        QByteArray sessionTicket;
+        QByteArray body;
+    };
+
     // Set the authorization header on a QNetworkRequest
     void setAuth(QNetworkRequest &request, const QByteArray &authHeaderVal)
     {
@@ -43,12 +58,16 @@ NetworkTaskWithRetry::NetworkTaskWithRetry(QNetworkAccessManager::Operation verb
                                            QString resource,
                                            std::unique_ptr<ApiRetry> pRetryStrategy,
                                            const QJsonDocument &data,
-                                           QByteArray authHeaderVal)
+                                           QByteArray authHeaderVal,
+                                           RawHeaders requestHeaders)
     : _verb{std::move(verb)}, _baseUriSequence{apiBaseUris.beginAttempt()},
       _pRetryStrategy{std::move(pRetryStrategy)}, _resource{std::move(resource)},
-      _data{(data.isNull() ? QByteArray() : data.toJson())},
+      _data{(data.isNull() ? QByteArray() : data.toJson(QJsonDocument::JsonFormat::Compact))},
       _authHeaderVal{std::move(authHeaderVal)},
-      _worstRetriableError{Error::Code::ApiNetworkError}
+      _requestHeaders{std::move(requestHeaders)},
+      _attemptId{0}, _pendingRequests{0}, _attemptTimeout{0},
+      _worstRetriableError{Error::Code::ApiNetworkError},
+      _replyStatus{0}
 {
     Q_ASSERT(_pRetryStrategy);
     // Only GET and HEAD are supported right now
@@ -56,6 +75,15 @@ NetworkTaskWithRetry::NetworkTaskWithRetry(QNetworkAccessManager::Operation verb
              _verb == QNetworkAccessManager::Operation::PostOperation ||
              _verb == QNetworkAccessManager::Operation::HeadOperation);
 
+    _hedgeTimer.setSingleShot(true);
+    connect(&_hedgeTimer, &QTimer::timeout, this, [this]
+    {
+        qInfo() << "Request for" << _resource << "is taking longer than"
+            << traceMsec(std::chrono::milliseconds{_hedgeTimer.interval()})
+            << "- also trying next base";
+        sendAttemptRequest();
+    });
+
     scheduleNextAttempt(std::chrono::milliseconds{0});
 }
 
@@ -64,6 +92,17 @@ NetworkTaskWithRetry::~NetworkTaskWithRetry()
 
 }
 
+QByteArray NetworkTaskWithRetry::replyHeader(const QByteArray &name) const
+{
+    // Header names are case-insensitive
+    for(const auto &header : _replyHeaders)
+    {
+        if(header.first.compare(name, Qt::CaseInsensitive) == 0)
+            return header.second;
+    }
+    return {};
+}
+
 void NetworkTaskWithRetry::scheduleNextAttempt(std::chrono::milliseconds nextDelay)
 {
     Q_ASSERT(_pRetryStrategy);  // Class invariant
@@ -73,72 +112,135 @@ void NetworkTaskWithRetry::scheduleNextAttempt(std::chrono::milliseconds nextDel
 
 void NetworkTaskWithRetry::executeNextAttempt()
 {
-    // Handle the request
-    sendRequest()
-            ->notify(this, [this](const Error& error, const QByteArray& body) {
-
-                // Release this task; it's no longer needed
-                _pNetworkReply.reset();
+    Q_ASSERT(_pRetryStrategy);  // Class invariant
+    ++_attemptId;
+    _pendingRequests = 0;
+    _attemptTimeout = _pRetryStrategy->beginAttempt(_resource);
+    _attemptTime.start();
+    sendAttemptRequest();
+
+    // Hedge the attempt if it's slower than usual for this base.  POST
+    // requests aren't hedged, they might not be idempotent.
+    if(_verb != QNetworkAccessManager::Operation::PostOperation)
+    {
+        auto hedgeDelay = _baseUriSequence.getHedgeDelay();
+        if(hedgeDelay.count() > 0 && hedgeDelay < _attemptTimeout)
+            _hedgeTimer.start(msec(hedgeDelay));
+    }
+}
 
-                // Check for errors
-                if (error)
-                {
-                    // Auth and "payment required" (expired account) errors can't be retried.
-                    if (error.code() == Error::ApiUnauthorizedError ||
-                        error.code() == Error::ApiPaymentRequiredError ||
-                        error.code() == Error::ApiRateLimitedError)
-                    {
-                        reject(error);
-                        return;
-                    }
-
-                    // A rate limiting error is worse than a network error - set the worst
-                    // retriable error, but keep trying in case another API endpoint gives us
-                    // 200 or 401.
-                    // (Otherwise, leave the worst error alone, it might already be set to a
-                    // rate limiting error by a prior attempt.)
-                    if (error.code() == Error::ApiRateLimitedError)
-                        _worstRetriableError = Error::Code::ApiRateLimitedError;
-
-                    qWarning() << "Attempt for" << _resource
-                        << "failed with error" << error;
-
-                    // Retry if we still have attempts left.
-                    Q_ASSERT(_pRetryStrategy);  // Class invariant
-                    auto nextDelay = _pRetryStrategy->attemptFailed(_resource);
-                    if(!nextDelay)
-                    {
-                        qWarning() << "Request for resource" << _resource
-                            << "failed, returning error" << _worstRetriableError;
-                        reject({HERE, _worstRetriableError});
-                        return;
-                    }
-                    else
-                        scheduleNextAttempt(*nextDelay);
-                }
-                else
-                {
-                    _baseUriSequence.attemptSucceeded();
-                    resolve(body);
-                }
+void NetworkTaskWithRetry::sendAttemptRequest()
+{
+    BaseUri nextBase = _baseUriSequence.getNextUri();
+    unsigned baseIndex = _baseUriSequence.getCurrentIndex();
+    // A hedged request gets the remainder of the attempt's timeout
+    std::chrono::milliseconds sentTime{_attemptTime.elapsed()};
+    auto timeout = std::max(_attemptTimeout - sentTime, std::chrono::milliseconds{0});
+    ++_pendingRequests;
+
+    sendRequest(nextBase, timeout)
+        ->notify(this, [this, attemptId = _attemptId, baseIndex, sentTime](const Error& error, const QByteArray& body)
+            {
+                requestFinished(attemptId, baseIndex, sentTime, error, body);
             });
 }
 
-Async<QByteArray> NetworkTaskWithRetry::sendRequest()
+void NetworkTaskWithRetry::requestFinished(unsigned attemptId, unsigned baseIndex,
+                                           std::chrono::milliseconds sentTime,
+                                           const Error &error,
+                                           const QByteArray &body)
 {
-    // Use ApiNetwork's QNetworkAccessManager, this binds us to the VPN
-    // interface when connected (important when we do not route the default
-    // gateway into the VPN).
-    QNetworkAccessManager &networkManager = ApiNetwork::instance()->getAccessManager();
+    // Ignore the losing request of a hedged attempt
+    if(attemptId != _attemptId || isFinished())
+        return;
+
+    Q_ASSERT(_pendingRequests > 0);    // This request was pending
+    --_pendingRequests;
+
+    // Check for errors
+    if (error)
+    {
+        // Auth and "payment required" (expired account) errors can't be retried.
+        if (error.code() == Error::ApiUnauthorizedError ||
+            error.code() == Error::ApiPaymentRequiredError ||
+            error.code() == Error::ApiRateLimitedError)
+        {
+            _hedgeTimer.stop();
+            reject(error);
+            return;
+        }
+
+        // A rate limiting error is worse than a network error - set the worst
+        // retriable error, but keep trying in case another API endpoint gives us
+        // 200 or 401.
+        // (Otherwise, leave the worst error alone, it might already be set to a
+        // rate limiting error by a prior attempt.)
+        if (error.code() == Error::ApiRateLimitedError)
+            _worstRetriableError = Error::Code::ApiRateLimitedError;
+
+        qWarning() << "Attempt for" << _resource
+            << "failed with error" << error;
 
+        // If the attempt was hedged, wait for the other request
+        if(_pendingRequests > 0)
+            return;
+        // The attempt failed before it was hedged - just retry normally
+        _hedgeTimer.stop();
+
+        // Retry if we still have attempts left.
+        Q_ASSERT(_pRetryStrategy);  // Class invariant
+        auto nextDelay = _pRetryStrategy->attemptFailed(_resource);
+        if(!nextDelay)
+        {
+            qWarning() << "Request for resource" << _resource
+                << "failed, returning error" << _worstRetriableError;
+            reject({HERE, _worstRetriableError});
+            return;
+        }
+        else
+            scheduleNextAttempt(*nextDelay);
+    }
+    else
+    {
+        _hedgeTimer.stop();
+        std::chrono::milliseconds latency{_attemptTime.elapsed() - sentTime.count()};
+        _baseUriSequence.attemptSucceeded(baseIndex, latency);
+        resolve(body);
+    }
+}
 
-    const BaseUri &nextBase = _baseUriSequence.getNextUri();
+Async<QByteArray> NetworkTaskWithRetry::sendRequest(const BaseUri &nextBase,
+                                                    std::chrono::milliseconds timeout)
+{
     ApiResource requestResource{nextBase.uri + _resource};
     QUrl requestUri{requestResource};
     QNetworkRequest request(requestUri);
+    // If the API host's address is cached, connect to it directly rather
+    // than resolving it again.  The host name is still used for the Host
+    // header, SNI, and certificate verification.
+    QHostAddress cachedAddress = ApiNetwork::instance()->cachedHostAddress(requestUri.host());
+    if(!cachedAddress.isNull())
+    {
+        QUrl addressUri{requestUri};
+        addressUri.setHost(cachedAddress.toString());
+        request.setUrl(addressUri);
+        QByteArray hostHeader = requestUri.host(QUrl::ComponentFormattingOption::FullyEncoded).toUtf8();
+        if(requestUri.port() >= 0)
+            hostHeader += ':' + QByteArray::number(requestUri.port());
+        request.setRawHeader(QByteArrayLiteral("Host"), hostHeader);
+        if(nextBase.peerVerifyName.isEmpty())
+            request.setPeerVerifyName(requestUri.host());
+    }
     if (!_authHeaderVal.isEmpty())
         setAuth(request, _authHeaderVal);
-
+    // Accept-Encoding is intentionally not set here - QNetworkAccessManager
+    // requests the encodings it supports on its own (gzip/deflate, and brotli
+    // when Qt is built with it), and it only decodes the body transparently
+    // when it chose the encoding.
+    for(const auto &header : _requestHeaders)
+        request.setRawHeader(header.first, header.second);
+
+    QSslConfiguration sslConfig{request.sslConfiguration()};
     // The URL for each request is logged to indicate if there is trouble with
     // specific API URLs, etc.  Query parameters are redacted by ApiResource.
     if(nextBase.pCA && !nextBase.peerVerifyName.isEmpty())
@@ -146,20 +248,31 @@ Async<QByteArray> NetworkTaskWithRetry::sendRequest()
         qDebug() << "requesting:" << requestResource
             << "using peer name" << nextBase.peerVerifyName;
         // Since we're using a custom CA and peer name, do not use the default
-        // CAs.  Copy the SSL configuration and explicitly set an empty CA list.
+        // CAs.  Explicitly set an empty CA list.
         //
         // We can't just apply the custom CA in the configuration.   Qt 5.12
         // lacks QNetworkRequest::setPeerVerifyName(), so we have to validate
         // the cert ourselves.
-        QSslConfiguration sslConfig{request.sslConfiguration()};
         sslConfig.setCaCertificates({});
-        request.setSslConfiguration(sslConfig);
     }
     else
     {
         qDebug() << "requesting:" << requestResource;
     }
 
+    // Resume the last TLS session with this host if possible.  Many requests
+    // go to the same few API hosts, but connections are never reused (see
+    // ApiNetwork::setProxy()), so this saves a full handshake for each one.
+    // The peer name is part of the key, so a session is only resumed for the
+    // same identity that was verified when it was established.
+    QString tlsSessionKey = requestUri.host() + QChar(':') +
+        QString::number(requestUri.port(443)) + QChar('/') + nextBase.peerVerifyName;
+    sslConfig.setSslOption(QSsl::SslOption::SslOptionDisableSessionPersistence, false);
+    QByteArray sessionTicket = ApiNetwork::instance()->tlsSessionTicket(tlsSessionKey);
+    if(!sessionTicket.isEmpty())
+        sslConfig.setSessionTicket(sessionTicket);
+    request.setSslConfiguration(sslConfig);
+
     // Permit same-origin redirects.  Qt does not follow redirects by default,
     // which has resulted in some near-misses in the past when load balancers,
     // meta proxies, etc. have been reconfigured.
@@ -171,121 +284,61 @@ Async<QByteArray> NetworkTaskWithRetry::sendRequest()
     request.setAttribute(QNetworkRequest::Attribute::RedirectPolicyAttribute,
                          QNetworkRequest::RedirectPolicy::UserVerifiedRedirectPolicy);
 
-    // Seems like QNetworkAccessManager could provide this, but the closest
-    // thing it has is sendCustomRequest().  It looks like that would produce a
-    // QNetworkReply that says its operation was "custom" even if the method
-    // was a standard one, and there might be other subtleties, so this is more
-    // robust.
-    QNetworkReply* replyPtr;
-    switch (_verb)
-    {
-        default:
-        case QNetworkAccessManager::GetOperation:
-            replyPtr = networkManager.get(request);
-            break;
-        case QNetworkAccessManager::PostOperation:
-            request.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/json"));
-            replyPtr = networkManager.post(request, _data);
-            break;
-        case QNetworkAccessManager::HeadOperation:
-            replyPtr = networkManager.head(request);
-            break;
-    }
-    Q_ASSERT(replyPtr); // Postcondition of QNetworkAccessManager::get/post/head
-
-    // Wrap the reply in a shared pointer. Use deleteLater as the deleter
-    // since the finished signal is not always safe to destroy ourselves
-    // in (e.g. abort->finished->delete is not currently safe). This way
-    // we don't have to delay the entire finished signal to stay safe.
-    QSharedPointer<QNetworkReply> reply(replyPtr, &QObject::deleteLater);
-
-    // Abort the request if it doesn't complete within a certain interval
-    Q_ASSERT(_pRetryStrategy);  // Class invariant
-    QTimer::singleShot(msec(_pRetryStrategy->beginAttempt(_resource)), reply.get(), &QNetworkReply::abort);
-
-    // Handle redirects by permitting same-origin HTTPS redirects only
-    connect(reply.get(), &QNetworkReply::redirected, this,
-        [reply, requestUri](const QUrl &url)
-        {
-            // Resolve the redirect URL if it's relative.  Typical relative
-            // paths as URLs won't affect the scheme/host/port and will be
-            // accepted since they are unchanged, but if something odd like a
-            // protocol-relative URL shows up, this will handle it properly.
-            const auto &targetResolved = requestUri.resolved(url);
-            if(targetResolved.scheme() == QStringLiteral("https") &&
-                targetResolved.host() == requestUri.host() &&
-                targetResolved.port(443) == requestUri.port(443))
-            {
-                qInfo() << "Accepted redirect from"
-                    << ApiResource{requestUri.toString()} << "to"
-                    << ApiResource{url.toString()} << "(resolved:"
-                    << ApiResource{targetResolved.toString()} << ")";
-                reply->redirectAllowed();
-            }
-            else
-            {
-                qInfo() << "Rejected redirect from"
-                    << ApiResource{requestUri.toString()} << "to"
-                    << ApiResource{url.toString()} << "(resolved:"
-                    << ApiResource{targetResolved.toString()} << ")";
-                reply->abort();
-            }
-        });
-
-    // If a custom CA and peer name are specified, handle SSL errors by
-    // validating the cert manually
-    if(nextBase.pCA && !nextBase.peerVerifyName.isEmpty())
-    {
-        connect(reply.get(), &QNetworkReply::sslErrors, this,
-            [this, reply, nextBase](const QList<QSslError> &errors)
-            {
-                checkSslCertificate(*reply, nextBase, errors);
-            });
-    }
-
     // Create a network task that resolves to the result of the request
     auto networkTask = Async<QByteArray>::create();
-    ApiResource resource = _resource;
-    connect(reply.get(), &QNetworkReply::finished, networkTask.get(), [networkTask = networkTask.get(), reply, resource]
+
+    // Handle the reply on this thread.  The reply itself lives on ApiNetwork's
+    // network thread (if it's in use), so its results are copied to an
+    // ApiReplyResult there.
+    auto handleReply = [pTaskWeak = networkTask.toWeakRef(),
+                        resource = _resource,
+                        pThis = QPointer<NetworkTaskWithRetry>{this},
+                        tlsSessionKey](const ApiReplyResult &result)
     {
-        auto keepAlive = networkTask->sharedFromThis();
+        auto pTask = pTaskWeak.toStrongRef();
+        // Ignore a reply that finishes again after being aborted, or that
+        // finishes after the task was abandoned
+        if(!pTask || pTask->isFinished())
+            return;
 
         // Log the status just for supportability.
-        const auto &statusCode = reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute);
-        const auto &statusMsg = reply->attribute(QNetworkRequest::Attribute::HttpReasonPhraseAttribute);
+        qInfo() << "Request for" << resource << "-" << result.statusCode
+            << result.statusMsg.data() << "- error code:" << result.error;
 
-        auto replyError = reply->error();
-        qInfo() << "Request for" << resource << "-" << statusCode.toInt()
-            << statusMsg.toByteArray().data() << "- error code:" << replyError;
+        // Keep the TLS session for the next request to this host.  If the
+        // handshake failed, don't try to resume this session again.
+        if(result.error == QNetworkReply::NetworkError::SslHandshakeFailedError)
+            ApiNetwork::instance()->storeTlsSessionTicket(tlsSessionKey, {});
+        else if(!result.sessionTicket.isEmpty())
+            ApiNetwork::instance()->storeTlsSessionTicket(tlsSessionKey, result.sessionTicket);
 
         // Check specifically for an auth error, which indicates that the creds are
         // not valid.
-        if (replyError == QNetworkReply::NetworkError::AuthenticationRequiredError)
+        if (result.error == QNetworkReply::NetworkError::AuthenticationRequiredError)
         {
             qWarning() << "Could not request" << resource << "due to invalid credentials";
-            networkTask->reject(Error(HERE, Error::ApiUnauthorizedError));
+            pTask->reject(Error(HERE, Error::ApiUnauthorizedError));
             return;
         }
 
         // If the API returned 429, it is rate limiting us, return a specific error.
         // This is still retriable, but it can cause NetworkTaskWithRetry to return
         // a specific error if all retries fail.
-        if (reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt() == 429)
+        if (result.statusCode == 429)
         {
-            QByteArray header = reply->rawHeader("Retry-After");
             // Default retry delay is 59 seconds
             int retryDelay = 59;
-            if(!header.isEmpty())
+            if(!result.retryAfter.isEmpty())
             {
                 bool ok{false};
-                int val = header.toInt(&ok);
+                int val = result.retryAfter.toInt(&ok);
                 if(ok)
                 {
                     retryDelay = val;
                 }
                 else
                 {
-                    qWarning() << "Invalid Retry-After value, got: " << QString{header};
+                    qWarning() << "Invalid Retry-After value, got: " << QString{result.retryAfter};
                 }
             }
             else
@@ -300,40 +353,158 @@ Async<QByteArray> NetworkTaskWithRetry::sendRequest()
             // 200 or 401.
             // (Otherwise, leave the worst error alone, it might already be set to a
             // rate limiting error by a prior attempt.)
-            networkTask->reject(Error(HERE, Error::ApiRateLimitedError,
+            pTask->reject(Error(HERE, Error::ApiRateLimitedError,
                                   QDateTime::currentDateTime().addSecs(retryDelay)));
             return;
         }
 
-        if (reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt() == 402)
+        if (result.statusCode == 402)
         {
             // 402 is used by our client API to indicate an account subscription has expired
             qWarning() << "Could not request" << resource << "due to payment required";
-            networkTask->reject(Error(HERE, Error::ApiPaymentRequiredError));
+            pTask->reject(Error(HERE, Error::ApiPaymentRequiredError));
             return;
         }
 
 
-        if (replyError != QNetworkReply::NetworkError::NoError)
+        if (result.error != QNetworkReply::NetworkError::NoError)
         {
-            qWarning() << "Could not request" << resource << "due to error:" << replyError;
-            networkTask->reject(Error(HERE, Error::Code::ApiNetworkError));
+            qWarning() << "Could not request" << resource << "due to error:" << result.error;
+            pTask->reject(Error(HERE, Error::Code::ApiNetworkError));
             return;
         }
 
-        networkTask->resolve(reply->readAll());
+        if(pThis)
+        {
+            pThis->_replyStatus = result.statusCode;
+            pThis->_replyHeaders = result.headers;
+        }
+        pTask->resolve(result.body);
+    };
+
+    // The context lives with the reply, and aborts it if we finish first - it
+    // lost a hedged attempt.
+    QSharedPointer<ApiRequestContext> pContext{new ApiRequestContext{}, &QObject::deleteLater};
+    ApiNetwork::instance()->moveToApiThread(*pContext);
+    connect(this, &BaseTask::finished, pContext.get(), &ApiRequestContext::abortRequested);
+
+    // Use ApiNetwork's QNetworkAccessManager, this binds us to the VPN
+    // interface when connected (important when we do not route the default
+    // gateway into the VPN).
+    ApiNetwork *pApiNetwork = ApiNetwork::instance();
+    pApiNetwork->invokeWithApiAccessManager(
+        [pApiNetwork, pContext, handleReply, request, verb = _verb,
+         data = _data, timeout, nextBase, requestUri,
+         resource = _resource](QNetworkAccessManager &networkManager) mutable
+    {
+        // Seems like QNetworkAccessManager could provide this, but the closest
+        // thing it has is sendCustomRequest().  It looks like that would produce a
+        // QNetworkReply that says its operation was "custom" even if the method
+        // was a standard one, and there might be other subtleties, so this is more
+        // robust.
+        //
+        // The reply is the context for its own connections, so they can refer
+        // to it directly.  It's destroyed with deleteLater() once it finishes,
+        // since the finished signal is not always safe to destroy ourselves
+        // in (e.g. abort->finished->delete is not currently safe).
+        QNetworkReply* reply;
+        switch (verb)
+        {
+            default:
+            case QNetworkAccessManager::GetOperation:
+                reply = networkManager.get(request);
+                break;
+            case QNetworkAccessManager::PostOperation:
+                request.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/json"));
+                reply = networkManager.post(request, data);
+                break;
+            case QNetworkAccessManager::HeadOperation:
+                reply = networkManager.head(request);
+                break;
+        }
+        Q_ASSERT(reply); // Postcondition of QNetworkAccessManager::get/post/head
+
+        // Abort the request if it doesn't complete within a certain interval
+        QTimer::singleShot(msec(timeout), reply, &QNetworkReply::abort);
+        connect(pContext.get(), &ApiRequestContext::abortRequested, reply,
+                &QNetworkReply::abort);
+
+        // Handle redirects by permitting same-origin HTTPS redirects only
+        connect(reply, &QNetworkReply::redirected, reply,
+            [reply, requestUri, connectHost = request.url().host()](const QUrl &url)
+            {
+                // Resolve the redirect URL if it's relative.  Typical relative
+                // paths as URLs won't affect the scheme/host/port and will be
+                // accepted since they are unchanged, but if something odd like a
+                // protocol-relative URL shows up, this will handle it properly.
+                const auto &targetResolved = requestUri.resolved(url);
+                if(targetResolved.scheme() == QStringLiteral("https") &&
+                    (targetResolved.host() == requestUri.host() ||
+                     targetResolved.host() == connectHost) &&
+                    targetResolved.port(443) == requestUri.port(443))
+                {
+                    qInfo() << "Accepted redirect from"
+                        << ApiResource{requestUri.toString()} << "to"
+                        << ApiResource{url.toString()} << "(resolved:"
+                        << ApiResource{targetResolved.toString()} << ")";
+                    reply->redirectAllowed();
+                }
+                else
+                {
+                    qInfo() << "Rejected redirect from"
+                        << ApiResource{requestUri.toString()} << "to"
+                        << ApiResource{url.toString()} << "(resolved:"
+                        << ApiResource{targetResolved.toString()} << ")";
+                    reply->abort();
+                }
+            });
+
+        // If a custom CA and peer name are specified, handle SSL errors by
+        // validating the cert manually.  This happens on the network thread,
+        // the handshake waits for it.
+        if(nextBase.pCA && !nextBase.peerVerifyName.isEmpty())
+        {
+            connect(reply, &QNetworkReply::sslErrors, reply,
+                [reply, nextBase, resource](const QList<QSslError> &errors)
+                {
+                    checkSslCertificate(*reply, nextBase, resource, errors);
+                });
+        }
+
+        connect(reply, &QNetworkReply::finished, reply,
+            [pApiNetwork, pContext, handleReply, reply]()
+            {
+                reply->deleteLater();
+
+                ApiReplyResult result;
+                result.error = reply->error();
+                result.statusCode = reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt();
+                result.statusMsg = reply->attribute(QNetworkRequest::Attribute::HttpReasonPhraseAttribute).toByteArray();
+                result.retryAfter = reply->rawHeader("Retry-After");
+                result.headers = reply->rawHeaderPairs();
+                result.sessionTicket = reply->sslConfiguration().sessionTicket();
+                // Reading the body here also keeps any decompression on the
+                // network thread
+                result.body = reply->readAll();
+
+                // ApiNetwork lives on the requesting thread; this is direct
+                // if the network thread isn't in use
+                QMetaObject::invokeMethod(pApiNetwork,
+                    [handleReply, result = std::move(result)](){handleReply(result);});
+            });
     });
 
     return networkTask;
 }
 
-void NetworkTaskWithRetry::traceLeafCert(const QSslCertificate &leafCert) const
+void NetworkTaskWithRetry::traceLeafCert(const QSslCertificate &leafCert,
+                                         const ApiResource &resource)
 {
     // In general, there can be any number of each of these fields
     const auto &commonNames = leafCert.subjectInfo(QSslCertificate::SubjectInfo::CommonName);
     const auto &serialNumbers = leafCert.subjectInfo(QSslCertificate::SubjectInfo::SerialNumber);
     const auto &altNames = leafCert.subjectAlternativeNames();
-    qInfo() << "Certificate for" << _resource << "has" << commonNames.size()
+    qInfo() << "Certificate for" << resource << "has" << commonNames.size()
         << "common names," << serialNumbers.size() << "serial numbers, and"
         << altNames.size() << "subject alternative names";
     for(const auto &cn : commonNames)
@@ -352,6 +523,7 @@ void NetworkTaskWithRetry::traceLeafCert(const QSslCertificate &leafCert) const
 
 void NetworkTaskWithRetry::checkSslCertificate(QNetworkReply &reply,
                                                const BaseUri &baseUri,
+                                               const ApiResource &resource,
                                                const QList<QSslError> &errors)
 {
     // This shouldn't happen, we don't connect this slot if pCA or peerName are
@@ -360,7 +532,7 @@ void NetworkTaskWithRetry::checkSslCertificate(QNetworkReply &reply,
     if(!baseUri.pCA || baseUri.peerVerifyName.isEmpty())
     {
         qWarning() << "Not ignoring" << errors.size()
-            << "SSL errors in request for" << _resource
+            << "SSL errors in request for" << resource
             << "- CA or peer name is not known";
         return;
     }
@@ -377,12 +549,12 @@ void NetworkTaskWithRetry::checkSslCertificate(QNetworkReply &reply,
                                            baseUri.peerVerifyName))
     {
         qInfo() << "Accepted certificate for" << baseUri.peerVerifyName;
-        traceLeafCert(certChain.first());
+        traceLeafCert(certChain.first(), resource);
         reply.ignoreSslErrors();
     }
     else
     {
         qWarning() << "Rejected certificate for" << baseUri.peerVerifyName;
-        traceLeafCert(certChain.first());
+        traceLeafCert(certChain.first(), resource);
     }
 }
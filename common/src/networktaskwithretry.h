@@ -27,15 +27,27 @@
 #include "apiretry.h"
 #include <QJsonDocument>
 #include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <memory>
 
 // NetworkTaskWithRetry executes an API request until either it succeeds or
 // the maximum attempt count is reached.  It uses a NetworkReplyHandler for each
 // attempt.
+//
+// GET and HEAD requests are hedged when the API base has more than one base
+// URI.  If a request takes longer than usual for its base (see
+// ApiBaseData::getHedgeDelay()), the same request is also sent to the next
+// base, and the first success is used.  Both requests are part of the same
+// attempt, and the attempt only fails once both have failed.
 class COMMON_EXPORT NetworkTaskWithRetry : public Task<QByteArray>
 {
     CLASS_LOGGING_CATEGORY("apiclient")
 
+public:
+    using RawHeaders = QList<QNetworkReply::RawHeaderPair>;
+
 public:
     // Create NetworkTaskWithRetry with the verb and request that will be used
     // for each attempt.
@@ -53,13 +65,21 @@ public:
     // URIs and 4 max attempts, each URI could be tried twice).
     //
     // If authHeaderVal is not empty, it is applied as an authorization header
-    // to each request.
+    // to each request.  Any requestHeaders are also applied to each request.
     NetworkTaskWithRetry(QNetworkAccessManager::Operation verb,
                          ApiBase &apiBaseUris, QString resource,
                          std::unique_ptr<ApiRetry> pRetryStrategy,
-                         const QJsonDocument &data, QByteArray authHeaderVal);
+                         const QJsonDocument &data, QByteArray authHeaderVal,
+                         RawHeaders requestHeaders = {});
     ~NetworkTaskWithRetry();
 
+public:
+    // After the task resolves, these provide the HTTP status and headers of
+    // the successful reply.  (For example, a conditional GET resolves with an
+    // empty body if the status is 304.)
+    int replyStatus() const {return _replyStatus;}
+    QByteArray replyHeader(const QByteArray &name) const;
+
 private:
     // Schedule an attempt, or reject if all attempts have been used.
     void scheduleNextAttempt(std::chrono::milliseconds nextDelay);
@@ -67,16 +87,29 @@ private:
     // Execute an attempt (used by scheduleNextAttempt())
     void executeNextAttempt();
 
+    // Send a request to the next base URI as part of the current attempt -
+    // used to start an attempt and to hedge it.
+    void sendAttemptRequest();
+
+    // Handle the result of a request from sendAttemptRequest().
+    void requestFinished(unsigned attemptId, unsigned baseIndex,
+                         std::chrono::milliseconds sentTime, const Error &error,
+                         const QByteArray &body);
+
     // Create task to issue a single request and return its body.
-    Async<QByteArray> sendRequest();
+    Async<QByteArray> sendRequest(const BaseUri &nextBase,
+                                  std::chrono::milliseconds timeout);
 
-    // Trace a leaf certificate; used by checkSslErrorPeerName().
-    void traceLeafCert(const QSslCertificate &leafCert) const;
+    // Trace a leaf certificate; used by checkSslCertificate().
+    static void traceLeafCert(const QSslCertificate &leafCert,
+                              const ApiResource &resource);
 
     // Check the SSL certificate for a request using a custom CA and peer name.
-    // If the certificate is accepted, calls reply.ignoreSslErrors().
-    void checkSslCertificate(QNetworkReply &reply, const BaseUri &baseUri,
-                             const QList<QSslError> &errors);
+    // If the certificate is accepted, calls reply.ignoreSslErrors().  This is
+    // called on the thread where the reply lives (see ApiNetwork).
+    static void checkSslCertificate(QNetworkReply &reply, const BaseUri &baseUri,
+                                    const ApiResource &resource,
+                                    const QList<QSslError> &errors);
 
 private:
     QNetworkAccessManager::Operation _verb;
@@ -85,12 +118,26 @@ private:
     ApiResource _resource;
     QByteArray _data;
     QByteArray _authHeaderVal;
-    Async<QByteArray> _pNetworkReply;
+    RawHeaders _requestHeaders;
+    // Identifies the current attempt; results of requests from an earlier
+    // attempt are ignored.
+    unsigned _attemptId;
+    // Number of requests still pending in the current attempt - 2 if the
+    // attempt has been hedged
+    unsigned _pendingRequests;
+    // Timeout for the current attempt and the time since it began
+    std::chrono::milliseconds _attemptTimeout;
+    QElapsedTimer _attemptTime;
+    // Elapses when the current attempt should be hedged
+    QTimer _hedgeTimer;
     // ApiRateLimitedError is retriable but causes us to return that instead of
     // the generic error if we don't encounter an auth error.
     // This field keeps track of the worst retriable error we have seen, if we
     // fail due to all attempts failing, this is the error we return.
     Error::Code _worstRetriableError;
+    // Status and headers of the successful reply
+    int _replyStatus;
+    RawHeaders _replyHeaders;
 };
 
 #endif
@@ -22,11 +22,14 @@
 #include "openssl.h"
 #include "builtin/path.h"
 
+#include <QDateTime>
 #include <QDir>
+#include <QHash>
 #include <QLibrary>
 #include <QSslSocket>
 
 #include <cctype>
+#include <mutex>
 
 #if defined(Q_OS_WIN)
     #if defined(_M_X64)
@@ -353,8 +356,22 @@ using OpenSSLPtr = std::unique_ptr<T, OpenSSLDeleter>;
 struct PrivateCA::data
 {
     OpenSSLPtr<X509_STORE> pCertStore;
+    // Chains that were verified successfully, keyed by a digest of the chain
+    // and peer name.  The value is the earliest notAfter in the chain; the
+    // result is reused until then.  API requests verify certificates on the
+    // API network thread, so this is guarded by verifiedChainsMutex.
+    QHash<QByteArray, QDateTime> verifiedChains;
+    std::mutex verifiedChainsMutex;
 };
 
+namespace
+{
+    // Limit on the number of verified chains cached by PrivateCA.  There are
+    // only a handful of API and meta hosts at any time, this just keeps a
+    // long-running daemon from growing the cache without bound.
+    enum : int { MaxVerifiedChains = 32 };
+}
+
 OpenSSLPtr<X509> convertCert(const QSslCertificate &cert)
 {
     auto der = cert.toDer();
@@ -421,6 +438,28 @@ bool PrivateCA::verifyHttpsCertificate(const QList<QSslCertificate> &certificate
         return false;
     }
 
+    // If this exact chain was already verified for this peer, and none of
+    // the certificates have expired since, reuse the result.  Results with
+    // allowExpired aren't cached, they would permit expired certs later.
+    QByteArray chainKey;
+    if(!allowExpired && !certificateChain.isEmpty())
+    {
+        QCryptographicHash chainHash{QCryptographicHash::Sha256};
+        for(const auto &cert : certificateChain)
+            chainHash.addData(cert.digest(QCryptographicHash::Sha256));
+        chainHash.addData(peerName.toUtf8());
+        chainKey = chainHash.result();
+
+        std::lock_guard<std::mutex> lock{_pData->verifiedChainsMutex};
+        auto itCached = _pData->verifiedChains.find(chainKey);
+        if(itCached != _pData->verifiedChains.end())
+        {
+            if(QDateTime::currentDateTimeUtc() < itCached.value())
+                return true;
+            _pData->verifiedChains.erase(itCached);
+        }
+    }
+
     // Convert the certificates
     std::vector<OpenSSLPtr<X509>> certObjs;
     certObjs.reserve(certificateChain.size());
@@ -510,6 +549,37 @@ bool PrivateCA::verifyHttpsCertificate(const QList<QSslCertificate> &certificate
 
     qInfo() << "Accepted matching name" << QString::fromUtf8(pMatchedName.get())
         << "for peer" << peerName;
+
+    if(!chainKey.isEmpty())
+    {
+        QDateTime expiry;
+        for(const auto &cert : certificateChain)
+        {
+            if(!expiry.isValid() || cert.expiryDate() < expiry)
+                expiry = cert.expiryDate();
+        }
+
+        std::lock_guard<std::mutex> lock{_pData->verifiedChainsMutex};
+        auto &verifiedChains = _pData->verifiedChains;
+        if(verifiedChains.size() >= MaxVerifiedChains)
+        {
+            // Drop expired entries first; if that doesn't free up space,
+            // start over, the hosts in use have probably changed
+            QDateTime now = QDateTime::currentDateTimeUtc();
+            auto itEntry = verifiedChains.begin();
+            while(itEntry != verifiedChains.end())
+            {
+                if(itEntry.value() <= now)
+                    itEntry = verifiedChains.erase(itEntry);
+                else
+                    ++itEntry;
+            }
+            if(verifiedChains.size() >= MaxVerifiedChains)
+                verifiedChains.clear();
+        }
+        verifiedChains.insert(chainKey, expiry);
+    }
+
     return true;
 }
 
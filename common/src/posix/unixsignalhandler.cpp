@@ -18,6 +18,7 @@
 
 #include "../common.h"
 #include "unixsignalhandler.h"
+#include "../wakeupaccounting.h"
 #line SOURCE_FILE("unixsignalhandler.cpp")
 #include <signal.h>
 #include <sys/socket.h>
@@ -69,6 +70,7 @@ UnixSignalHandler::UnixSignalHandler(QObject *parent)
         return;
     }
     _snUsr1 = new QSocketNotifier(_sigFd[1], QSocketNotifier::Read, this);
+    tagWakeups(*_snUsr1, QByteArrayLiteral("signals"));
     connect(_snUsr1, &QSocketNotifier::activated, this, &UnixSignalHandler::handleSignal);
 
     struct sigaction action{};
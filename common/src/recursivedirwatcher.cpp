@@ -20,6 +20,13 @@
 #line SOURCE_FILE("recursivedirwatcher.cpp")
 
 #include "recursivedirwatcher.h"
+#include <algorithm>
+
+namespace
+{
+    // Changes observed within this interval are coalesced into one check()
+    const int checkCoalesceInterval = 20;
+}
 
 RecursiveWatcher::RecursiveWatcher(Path target)
     : _target{std::move(target)}
@@ -40,6 +47,20 @@ RecursiveWatcher::RecursiveWatcher(Path target)
     _timer.setInterval(100);
     _timer.start();
 #else
+    Path watchDir = _target;
+    while(true)
+    {
+        _watchPaths.push_back(watchDir);
+        Path parent = watchDir.parent();
+        if(parent == watchDir)
+            break;  // We reached the filesystem root
+        watchDir = std::move(parent);
+    }
+    std::reverse(_watchPaths.begin(), _watchPaths.end());
+
+    _checkTimer.setSingleShot(true);
+    _checkTimer.setInterval(checkCoalesceInterval);
+    connect(&_checkTimer, &QTimer::timeout, this, &RecursiveWatcher::emitCheck);
     connect(&_fsWatcher, &QFileSystemWatcher::directoryChanged, this,
             &RecursiveWatcher::pathChanged);
     addRecursiveWatches();
@@ -49,9 +70,17 @@ RecursiveWatcher::RecursiveWatcher(Path target)
 #ifndef Q_OS_MACOS
 void RecursiveWatcher::pathChanged(const QString &path)
 {
-    // Any time a change occurs, add watches for all parents again.  We
-    // can't watch a directory that doesn't exist, so we need to try
-    // again if a directory was added.
+    if(!_changedPaths.contains(path))
+        _changedPaths.push_back(path);
+    if(!_checkTimer.isActive())
+        _checkTimer.start();
+}
+
+void RecursiveWatcher::emitCheck()
+{
+    // Add watches for any directories that were created.  We can't watch a
+    // directory that doesn't exist, so we need to try again if a directory
+    // was added.
     //
     // This means that even if a parent directory is created, then
     // contents are added, we won't emit changed() for the contents if
@@ -60,21 +89,24 @@ void RecursiveWatcher::pathChanged(const QString &path)
     // the contents exist when the parent change was emitted, so we
     // don't emit changes for the children.
     addRecursiveWatches();
-    qInfo() << "Change in path" << path << "watching"
-        << _target;
+    qInfo() << "Change in paths" << _changedPaths << "watching" << _target;
+    _changedPaths.clear();
     emit check();
-};
+}
 
 void RecursiveWatcher::addRecursiveWatches()
 {
-    Path watchDir = _target;
-    while(true)
+    // QFileSystemWatcher stops watching directories that are deleted, so
+    // check what's currently watched, then add watches from the first path
+    // that isn't watched.  If a path doesn't exist, its descendants can't
+    // either, so stop there.
+    QStringList watched = _fsWatcher.directories() + _fsWatcher.files();
+    for(const auto &watchPath : _watchPaths)
     {
-        _fsWatcher.addPath(watchDir);
-        Path parent = watchDir.parent();
-        if(parent == watchDir)
-            break;  // We reached the filesystem root
-        watchDir = std::move(parent);
+        if(watched.contains(watchPath))
+            continue;
+        if(!_fsWatcher.addPath(watchPath))
+            break;
     }
 }
 #endif
@@ -25,6 +25,7 @@
 #include <QFileSystemWatcher>
 #include <QTimer>
 #include "builtin/path.h"
+#include <vector>
 
 // RecursiveWatcher watches a path to a file or directory that may or may not
 // exist yet.  It watches all parent directories to detect when the target path
@@ -38,6 +39,8 @@
 // On Linux, this is properly implemented using a QFileSystemWatcher, which is
 // the ideal behavior - we don't do any extra work polling the file, and we
 // don't have to wait for a poll interval to elapse before checking again.
+// Watches are only added for ancestors that aren't watched yet, and a burst of
+// changes (such as a directory being populated) results in one check().
 //
 // On macOS, crashes were observed on macOS 10.13 using Qt 5.15.2, it appears
 // that a change in Qt may have caused this to start crashing on 10.13:
@@ -55,9 +58,12 @@ public:
 
 private:
 #ifndef Q_OS_MACOS
-    // Add watches to _fsWatcher for _target and all of its ancestors.
+    // Add watches to _fsWatcher for _target and its ancestors that aren't
+    // watched yet.
     void addRecursiveWatches();
     void pathChanged(const QString &path);
+    // Emit check() for the changes observed since the last check()
+    void emitCheck();
 #endif
 
 public:
@@ -67,8 +73,9 @@ signals:
     // The caller should re-check the file/directory of interest.
     //
     // On Linux, this is emitted when the path specified or any ancestor has
-    // changed.  (It's still possible that the file doesn't exist, etc., since
-    // more than one change could have occurred.)
+    // changed (shortly after, to coalesce a burst of changes).  (It's still
+    // possible that the file doesn't exist, etc., since more than one change
+    // could have occurred.)
     //
     // On macOS, this is emitted periodically with a timer to fall back to
     // short-polling due to the QFileSystemWatcher issues mentioned above.
@@ -79,7 +86,14 @@ private:
 #ifdef Q_OS_MACOS
     QTimer _timer;
 #else
+    // _target and its ancestors, from the root down to _target
+    std::vector<Path> _watchPaths;
     QFileSystemWatcher _fsWatcher;
+    // Changes are coalesced with this timer, so a burst of changes emits one
+    // check()
+    QTimer _checkTimer;
+    // Paths that changed since the last check() (for tracing)
+    QStringList _changedPaths;
 #endif
 };
 
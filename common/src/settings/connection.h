@@ -54,6 +54,48 @@ public:
     JsonField(quint64, sent, {})
 };
 
+// One phase reached while establishing a VPN connection.  The elapsed time is
+// measured with a monotonic clock from the start of the connection sequence,
+// so phases from several attempts can be compared.
+class COMMON_EXPORT ConnectionPhase : public NativeJsonObject
+{
+    Q_OBJECT
+public:
+    ConnectionPhase() {}
+    ConnectionPhase(const QString &phaseVal, int attemptVal, qint64 elapsedVal)
+    {
+        phase(phaseVal);
+        attempt(attemptVal);
+        elapsed(elapsedVal);
+    }
+    ConnectionPhase(const ConnectionPhase &other) {*this = other;}
+    ConnectionPhase &operator=(const ConnectionPhase &other)
+    {
+        phase(other.phase());
+        attempt(other.attempt());
+        elapsed(other.elapsed());
+        return *this;
+    }
+    bool operator==(const ConnectionPhase &other) const
+    {
+        return phase() == other.phase() && attempt() == other.attempt() &&
+            elapsed() == other.elapsed();
+    }
+    bool operator!=(const ConnectionPhase &other) const
+    {
+        return !(*this == other);
+    }
+
+    // Name of the phase, such as "beginConnection" or "interfaceCreated"
+    JsonField(QString, phase, {})
+    // Number of connection attempts started when this phase was reached.
+    // Phases before a server is selected belong to the attempt that follows
+    // (so the first of these have attempt 0).
+    JsonField(int, attempt, 0)
+    // Milliseconds since the connection sequence started
+    JsonField(qint64, elapsed, 0)
+};
+
 // Transport settings that might vary due to automatic failover.
 class COMMON_EXPORT Transport : public NativeJsonObject
 {
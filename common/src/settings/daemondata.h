@@ -102,6 +102,30 @@ public:
     // values.
     JsonField(LatencyMap, modernLatencies, {})
 
+    // Latency measurements cached for each network that has been used, so
+    // they can be restored immediately when returning to a network.  Keys are
+    // network identifiers (see Daemon::onNetworksChanged()); values are
+    // objects with "timestamp" (when the profile was stored, ms since the
+    // epoch) and "latencies" (in the same form as modernLatencies).  Old
+    // profiles are discarded.
+    JsonField(QJsonObject, modernLatencyProfiles, {})
+    // The network identifier that modernLatencies were measured on, or empty
+    // if it isn't known.
+    JsonField(QString, modernLatenciesNetwork, {})
+
+    // The location ID of the last connection established with the "auto"
+    // location.  If no latencies are known yet (such as at boot on a network
+    // without a latency profile), "auto" uses this location instead of an
+    // arbitrary unmeasured one.
+    JsonField(QString, lastConnectedLocation, {})
+
+    // Tunnel MTUs discovered by MtuPinger, so they can be applied immediately
+    // when connecting to the same server on the same network.  Keys are
+    // "<network identifier>/<encapsulation>/<server IP>"; values are objects
+    // with "timestamp" (ms since the epoch) and "mtu".  Old entries are
+    // discarded.
+    JsonField(QJsonObject, pathMtuCache, {})
+
     // Cached regions lists.  This is the exact JSON content from the actual
     // regions list; it hasn't been digested or interpreted by the daemon.  This
     // works well when the daemon is upgraded; the API format doesn't change so
@@ -112,6 +136,18 @@ public:
 
     JsonField(QJsonObject, modernRegionMeta, {})
 
+    // HTTP validators (ETag/Last-Modified) of the cached lists above, from
+    // JsonRefresher.  These are used to fetch the lists conditionally.
+    JsonField(QJsonObject, cachedModernShadowsocksValidators, {})
+    JsonField(QJsonObject, cachedModernRegionsValidators, {})
+    JsonField(QJsonObject, modernRegionMetaValidators, {})
+
+    // Tag of the regions image built from the cached lists above.  The daemon
+    // writes the parsed lists to a binary image so it can rebuild locations
+    // without parsing them again; the image is only used if its tag matches
+    // this, so a stale image (from a crash, etc.) is ignored.
+    JsonField(QString, modernRegionsImageTag, {})
+
     // Persistent caches of the version advertised by update channel(s).  This
     // is mainly provided to provide consistent UX if the client/daemon are
     // restarted while an update is available (they restore the same "update
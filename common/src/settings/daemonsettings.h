@@ -68,6 +68,12 @@ public:
     // values expressed in DaemonState.  (The client should only use this to set
     // a new choice.)
     JsonField(QString, location, QStringLiteral("auto"))
+    // How the 'auto' location is chosen:
+    // - "latency" - the location with the lowest latency
+    // - "quality" - among the locations that could be chosen by "latency", the
+    //   one with the best quality score (latency percentile, jitter, and loss;
+    //   see LatencyStatistics::qualityScore())
+    JsonField(QString, autoLocationMode, QStringLiteral("latency"), {"latency", "quality"})
     // Whether to include geo-only locations.
     JsonField(bool, includeGeoOnly, true)
     // The method used to connect to the VPN
@@ -114,6 +120,14 @@ public:
     //   users sometimes disable.
     JsonField(QString, windowsIpMethod, QStringLiteral("wintun"), {"wintun", "dhcp", "static"})
 
+    // OpenVPN data channel tuning.
+    // - standard - moderate socket buffers, suitable for any system
+    // - throughput - large socket buffers, plus fast-io for UDP (Mac/Linux)
+    //   and a longer TUN transmit queue (Linux)
+    // - auto - throughput on systems with at least 4 cores and hardware AES,
+    //   standard otherwise
+    JsonField(QString, openvpnPerformanceProfile, QStringLiteral("auto"), {"auto", "standard", "throughput"})
+
     // Proxy setting
     //  - "custom" - Use proxyCustom
     //  - "shadowsocks" - Use a PIA shadowsocks region - proxyShadowsocksLocation
@@ -184,13 +198,47 @@ public:
     // available.
     JsonField(bool, wireguardUseKernel, true)
 
-    // If no data is received for (wireguardPingTimeout/2) seconds, fire off a ping.
-    // If no data is recieved for another (wireguardPingTimeout/2) seconds, assume that the connection
-    // is lost
+    // Tune the wireguard-go userspace backend for throughput (Linux only).
+    // This lets wireguard-go use all CPU cores and lengthens the TUN device's
+    // transmit queue.  wireguard-go itself uses batched socket I/O and
+    // GSO/GRO offloads when the kernel supports them, falling back
+    // automatically otherwise.
+    JsonField(bool, wireguardGoHighThroughput, true)
+
+    // When switching from one WireGuard server to another, keep the WireGuard
+    // interface up and replace the peer, instead of tearing down the
+    // interface and creating a new one.  Only the addresses, routes, and DNS
+    // that differ are updated.  (Mac and Linux; the Windows service backend
+    // can't change the peer of a running tunnel.)
+    JsonField(bool, wireguardSeamlessSwitch, false)
+
+    // When disconnecting for sleep, keep the WireGuard interface up (blocked
+    // by the killswitch) and try to resume it after wake with the same server
+    // and key - rebinding the socket and waiting briefly for a handshake -
+    // before falling back to a normal reconnect.  (Mac and Linux, like
+    // wireguardSeamlessSwitch.)
+    JsonField(bool, wireguardFastResume, true)
+
+    // If no data is received for wireguardPingTimeout seconds, assume that the
+    // connection is lost.  (The tunnel is also probed whenever it's idle, which
+    // usually detects a lost connection much sooner once the server has
+    // answered a probe; this is the upper limit.)
     //
     // Should be a multiple of statsInterval (5)
     JsonField(uint, wireguardPingTimeout, 60)
 
+    // Keep a warm standby server while connected - another server in the
+    // connected region is probed periodically, so if the connection is lost,
+    // the first reconnect attempt goes to a server that was recently
+    // responding instead of retrying the one that was lost.
+    JsonField(bool, warmStandby, false)
+
+    // Interval (ms) used to batch low-priority change notifications to clients
+    // (byte counters, bandwidth measurements, latencies).  High-priority
+    // changes like the connection state are still sent immediately, along
+    // with any batched changes.  0 sends all changes immediately.
+    JsonField(uint, notificationBatchInterval, 500)
+
     // These settings are legacy and have been moved to client-side settings.
     // They're still present in DaemonSettings so the client can migrate them.
     JsonField(bool, connectOnLaunch, false) // Connect when first client connects
@@ -222,6 +270,16 @@ public:
     // by default and can only be turned on using the CLI
     JsonField(bool, largeLogFiles, false)
 
+    // Write log files in the compact binary format (daemon.log.bin, etc.),
+    // which can be converted back to text with tools/logdecode.  Like
+    // largeLogFiles, this can only be turned on using the CLI
+    JsonField(bool, binaryLogFiles, false)
+
+    // Serve daemon performance metrics in the OpenMetrics format on
+    // 127.0.0.1:<port>, for scraping with Prometheus, etc.  0 (the default)
+    // disables the endpoint.  This can only be set using the CLI
+    JsonField(uint, metricsPort, 0)
+
     // Whether to allow server latency to be calculated in the background
     // when the VPN is disconnected
     JsonField(bool, enableBackgroundLatencyChecks, true)
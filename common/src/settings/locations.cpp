@@ -26,6 +26,10 @@ Server::Server(std::shared_ptr<const kapps::regions::Server> pImpl)
     : _pImpl{std::move(pImpl)}
 {
     Q_ASSERT(_pImpl);   // Ensured by caller
+    _ip = qs::internQString(_pImpl->address().toString());
+    _commonName = qs::internQString(_pImpl->commonName());
+    _shadowsocksKey = qs::internQString(_pImpl->shadowsocksKey());
+    _shadowsocksCipher = qs::internQString(_pImpl->shadowsocksCipher());
 }
 
 bool Server::hasService(Service service) const
@@ -90,6 +94,7 @@ Location::Location(std::shared_ptr<const kapps::regions::Region> pImpl,
     : _pImpl{std::move(pImpl)}, _latency{std::move(latency)}
 {
     Q_ASSERT(_pImpl);   // Ensured by caller
+    _id = qs::internQString(_pImpl->id());
     // Wrap the kapps::regions::Server objects with our Server wrapper; the idea
     // is to eventually eliminate this in the daemon and use the kapps::regions
     // types directly
@@ -23,6 +23,9 @@
 #include "../json.h"
 #include <kapps_regions/src/region.h>
 #include <kapps_regions/src/regiondisplay.h>
+#include <kapps_core/src/smallvector.h>
+#include <algorithm>
+#include <functional>
 #include <set>
 #include <unordered_map>
 
@@ -42,7 +45,62 @@ enum class Service
 // This is subtle, but it generally places the ports that feel more natural at
 // the top (defaults, 8080, TCP 443), and unusual ports that are repurposed for
 // the VPN (DNS/POP/HTTP) at the bottom.
-using DescendingPortSet = std::set<quint16, std::greater<quint16>>;
+//
+// This is a set of ports, but it's stored as a sorted SmallVector - there are
+// only a handful of ports, and std::set would allocate a node for each one.
+class DescendingPortSet
+{
+public:
+    using value_type = quint16;
+    using const_iterator = const quint16*;
+    using iterator = const_iterator;
+
+public:
+    DescendingPortSet() = default;
+    DescendingPortSet(std::initializer_list<quint16> ports)
+    {
+        for(quint16 port : ports)
+            insert(port);
+    }
+
+    bool operator==(const DescendingPortSet &other) const {return _ports == other._ports;}
+    bool operator!=(const DescendingPortSet &other) const {return !(*this == other);}
+
+public:
+    const_iterator begin() const {return _ports.begin();}
+    const_iterator end() const {return _ports.end();}
+    bool empty() const {return _ports.empty();}
+    std::size_t size() const {return _ports.size();}
+
+    std::size_t count(quint16 port) const
+    {
+        auto itPort = lowerBound(port);
+        return (itPort != _ports.end() && *itPort == port) ? 1 : 0;
+    }
+
+    void insert(quint16 port)
+    {
+        auto itPort = lowerBound(port);
+        if(itPort == _ports.end() || *itPort != port)
+            _ports.insert(itPort, port);
+    }
+    template<class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first)
+            insert(*first);
+    }
+
+private:
+    const quint16 *lowerBound(quint16 port) const
+    {
+        return std::lower_bound(_ports.begin(), _ports.end(), port,
+                                std::greater<quint16>{});
+    }
+
+private:
+    kapps::core::SmallVector<quint16, 16> _ports;
+};
 
 // Server describes a single server in a region, which may provide any
 // combination of services.
@@ -82,9 +140,9 @@ public:
     }
 
     // The server's IP address (used for all services)
-    QString ip() const {return qs::toQString(_pImpl->address().toString());}
+    const QString &ip() const {return _ip;}
     // The server certificate CN to expect
-    QString commonName() const {return qs::toQString(_pImpl->commonName());}
+    const QString &commonName() const {return _commonName;}
 
     // These fields identify the available ports on this server for each
     // possible service.  If a server doesn't have a particular service, that
@@ -101,8 +159,8 @@ public:
 
     // For servers with the Shadowsocks service, the key and cipher used to
     // connect
-    QString shadowsocksKey() const {return qs::toQString(_pImpl->shadowsocksKey());}
-    QString shadowsocksCipher() const {return qs::toQString(_pImpl->shadowsocksCipher());}
+    const QString &shadowsocksKey() const {return _shadowsocksKey;}
+    const QString &shadowsocksCipher() const {return _shadowsocksCipher;}
 
     // For servers with the OpenVPN service, whether we use NCP cipher
     // negotiation (the default), or pia-signal-settings negotiation.
@@ -129,6 +187,9 @@ public:
 
 private:
     std::shared_ptr<const kapps::regions::Server> _pImpl;
+    // Interned from _pImpl when constructed (see qs::internQString()); these
+    // are used heavily and the locations are rebuilt frequently.
+    QString _ip, _commonName, _shadowsocksKey, _shadowsocksCipher;
 };
 
 // Location describes a single location, which can contain any number of servers
@@ -162,10 +223,17 @@ public:
     bool operator!=(const Location &other) const {return !(*this == other);}
 
 public:
+    // Get the underlying kapps::regions::Region
+    const kapps::regions::Region &impl() const
+    {
+        Q_ASSERT(_pImpl);   // Class invariant
+        return *_pImpl;
+    }
+
     // The region's ID.  This is the immutable identifier for this region, which
     // is used to identify location choices, favorites, etc.  Avoid displaying
     // this in the UI (except possibly as a last resort).
-    QString id() const {return qs::toQString(_pImpl->id());}
+    const QString &id() const {return _id;}
     // Whether this region has port forwarding
     bool portForward() const {return _pImpl->portForward();}
     // Whether this location is provided by geolocation only.
@@ -282,6 +350,8 @@ public:
 
 private:
     std::shared_ptr<const kapps::regions::Region> _pImpl;
+    // Interned from _pImpl when constructed
+    QString _id;
     nullable_t<double> _latency;
     std::vector<Server> _servers;
 };
@@ -291,15 +361,49 @@ private:
 inline bool compareLocationsValue(const QSharedPointer<const Location> &pFirst,
                                   const QSharedPointer<const Location> &pSecond)
 {
-    // If one is nullptr, they're only the same if they're both nullptr
+    // Unchanged locations are usually the same object - see
+    // buildModernLocations().  If one is nullptr, they're only the same if
+    // they're both nullptr.
+    if(pFirst == pSecond)
+        return true;
     if(!pFirst || !pSecond)
-        return pFirst == pSecond;
+        return false;
     return *pFirst == *pSecond;
 }
 
 using LocationsById = std::unordered_map<std::string, QSharedPointer<const Location>>;
 using LatencyMap = std::unordered_map<QString, double>;
 
+// Latency statistics for a location, estimated by LatencyTracker from all of
+// its measurements.  Times are in milliseconds.
+struct COMMON_EXPORT LatencyStatistics
+{
+    // Exponentially-weighted moving average round trip time
+    double mean{0.0};
+    // Exponentially-weighted moving standard deviation of the round trip time
+    double jitter{0.0};
+    // Estimated median and 95th percentile round trip times
+    double p50{0.0};
+    double p95{0.0};
+    // Exponentially-weighted fraction of pings that were not answered
+    double lossRate{0.0};
+
+    bool operator==(const LatencyStatistics &other) const
+    {
+        return mean == other.mean && jitter == other.jitter &&
+            p50 == other.p50 && p95 == other.p95 && lossRate == other.lossRate;
+    }
+    bool operator!=(const LatencyStatistics &other) const {return !(*this == other);}
+
+    // Score used to select the "best quality" location - lower is better.
+    // This is the 95th percentile plus jitter, scaled up by packet loss (10%
+    // loss doubles it), so a location with a slightly higher latency but a
+    // stable connection is preferred.
+    double qualityScore() const {return (p95 + jitter) * (1.0 + 10.0 * lossRate);}
+};
+
+using LatencyStatisticsById = std::unordered_map<std::string, LatencyStatistics>;
+
 // Locations for a given country, sorted by latency (ties broken by id).
 class COMMON_EXPORT CountryLocations
 {
@@ -0,0 +1,286 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+
+#include "common.h"
+#line SOURCE_FILE("statemirror.cpp")
+
+#include "statemirror.h"
+#include "brand.h"
+#include "builtin/util.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(Q_OS_WIN)
+    #include <kapps_core/src/winapi.h>
+    #include <sddl.h>
+    #pragma comment(lib, "advapi32.lib")
+#else
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // Header at the beginning of the mirror; the snapshot data follows it.
+    struct MirrorHeader
+    {
+        // Set last by the daemon once the header is initialized
+        std::atomic<quint32> magic;
+        quint32 formatVersion;
+        // Seqlock sequence - odd while the daemon is writing a snapshot
+        std::atomic<quint64> sequence;
+        // Size of the current snapshot; 0 if there is no snapshot
+        std::atomic<quint32> size;
+        quint32 capacity;
+        // Daemon's PID - on POSIX, the mirror outlives the daemon if it
+        // crashes, so readers check if it's still running.
+        quint64 ownerPid;
+    };
+
+    static_assert(std::atomic<quint64>::is_always_lock_free,
+                  "State mirror requires lock-free 64-bit atomics");
+
+    const quint32 mirrorMagic = 0x50494153;
+    const quint32 mirrorFormatVersion = 1;
+    // Total size of the mapping.  Pages are only committed when touched on
+    // POSIX, so this just needs to be large enough for any realistic state.
+    const std::size_t mirrorMappingSize = 8 * 1024 * 1024;
+    // Readers give up after this many inconsistent reads and fall back to the
+    // socket; this is very unlikely since the daemon publishes at most about
+    // once per second.
+    const int maxReadAttempts = 100;
+
+#if defined(Q_OS_WIN)
+    const wchar_t mirrorName[]{L"Global\\" BRAND_CODE "-state-mirror"};
+#else
+    const char mirrorName[]{"/" BRAND_CODE "-state-mirror"};
+#endif
+
+    unsigned char *snapshotData(void *pMapping)
+    {
+        return reinterpret_cast<unsigned char*>(pMapping) + sizeof(MirrorHeader);
+    }
+}
+
+StateMirrorWriter::StateMirrorWriter()
+    : _pMapping{nullptr}, _mappingSize{mirrorMappingSize}
+#if defined(Q_OS_WIN)
+    , _mappingHandle{nullptr}
+#endif
+{
+#if defined(Q_OS_WIN)
+    // SYSTEM and Administrators have full access, everyone else can only read
+    PSECURITY_DESCRIPTOR pSecDesc{nullptr};
+    if(!::ConvertStringSecurityDescriptorToSecurityDescriptorW(
+        L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;WD)", SDDL_REVISION_1,
+        &pSecDesc, nullptr))
+    {
+        qWarning() << "Unable to create state mirror security descriptor -"
+            << SystemError{HERE};
+        return;
+    }
+    SECURITY_ATTRIBUTES secAttrs{};
+    secAttrs.nLength = sizeof(secAttrs);
+    secAttrs.lpSecurityDescriptor = pSecDesc;
+    secAttrs.bInheritHandle = FALSE;
+    _mappingHandle = ::CreateFileMappingW(INVALID_HANDLE_VALUE, &secAttrs,
+                                          PAGE_READWRITE, 0,
+                                          static_cast<DWORD>(_mappingSize),
+                                          mirrorName);
+    ::LocalFree(pSecDesc);
+    if(!_mappingHandle)
+    {
+        qWarning() << "Unable to create state mirror -" << SystemError{HERE};
+        return;
+    }
+    _pMapping = ::MapViewOfFile(_mappingHandle, FILE_MAP_WRITE, 0, 0, _mappingSize);
+    if(!_pMapping)
+    {
+        qWarning() << "Unable to map state mirror -" << SystemError{HERE};
+        ::CloseHandle(_mappingHandle);
+        _mappingHandle = nullptr;
+        return;
+    }
+#else
+    // Remove a stale mirror left behind if the daemon crashed.  Clients that
+    // still have it open are unaffected.
+    ::shm_unlink(mirrorName);
+    int fd = ::shm_open(mirrorName, O_RDWR|O_CREAT|O_EXCL, 0644);
+    if(fd < 0)
+    {
+        qWarning() << "Unable to create state mirror -" << SystemError{HERE};
+        return;
+    }
+    // Apply the mode regardless of the daemon's umask, any local user can
+    // read the same information from the IPC socket
+    if(::fchmod(fd, 0644) != 0 ||
+       ::ftruncate(fd, static_cast<off_t>(_mappingSize)) != 0)
+    {
+        qWarning() << "Unable to size state mirror -" << SystemError{HERE};
+        ::close(fd);
+        ::shm_unlink(mirrorName);
+        return;
+    }
+    void *pMapping = ::mmap(nullptr, _mappingSize, PROT_READ|PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(pMapping == MAP_FAILED)
+    {
+        qWarning() << "Unable to map state mirror -" << SystemError{HERE};
+        ::shm_unlink(mirrorName);
+        return;
+    }
+    _pMapping = pMapping;
+#endif
+
+    // The new mapping is zero-filled, which is a valid empty header except
+    // for the magic value
+    MirrorHeader *pHeader = new(_pMapping) MirrorHeader{};
+    pHeader->formatVersion = mirrorFormatVersion;
+    pHeader->capacity = static_cast<quint32>(_mappingSize - sizeof(MirrorHeader));
+#if defined(Q_OS_WIN)
+    pHeader->ownerPid = ::GetCurrentProcessId();
+#else
+    pHeader->ownerPid = static_cast<quint64>(::getpid());
+#endif
+    pHeader->magic.store(mirrorMagic, std::memory_order_release);
+    qInfo() << "Created state mirror with capacity" << pHeader->capacity;
+}
+
+StateMirrorWriter::~StateMirrorWriter()
+{
+    if(!_pMapping)
+        return;
+#if defined(Q_OS_WIN)
+    ::UnmapViewOfFile(_pMapping);
+    ::CloseHandle(_mappingHandle);
+#else
+    ::munmap(_pMapping, _mappingSize);
+    ::shm_unlink(mirrorName);
+#endif
+}
+
+bool StateMirrorWriter::publish(const QByteArray &snapshot)
+{
+    if(!_pMapping)
+        return false;
+
+    MirrorHeader &header = *reinterpret_cast<MirrorHeader*>(_pMapping);
+    bool fits = static_cast<std::size_t>(snapshot.size()) <= header.capacity;
+    if(!fits)
+    {
+        qWarning() << "State snapshot of" << snapshot.size()
+            << "bytes exceeds mirror capacity of" << header.capacity;
+    }
+
+    quint64 sequence = header.sequence.load(std::memory_order_relaxed);
+    header.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if(fits)
+    {
+        std::memcpy(snapshotData(_pMapping), snapshot.data(), snapshot.size());
+        header.size.store(static_cast<quint32>(snapshot.size()), std::memory_order_relaxed);
+    }
+    else
+        header.size.store(0, std::memory_order_relaxed);
+    header.sequence.store(sequence + 2, std::memory_order_release);
+    return fits;
+}
+
+QByteArray readStateMirror()
+{
+    const void *pMapping{nullptr};
+    std::size_t mappingSize{0};
+#if defined(Q_OS_WIN)
+    // The mapping goes away with the daemon, so if it can be opened, the
+    // daemon is running
+    HANDLE mappingHandle = ::OpenFileMappingW(FILE_MAP_READ, FALSE, mirrorName);
+    if(!mappingHandle)
+        return {};
+    pMapping = ::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(mappingHandle);
+    if(!pMapping)
+        return {};
+    MEMORY_BASIC_INFORMATION mapInfo{};
+    if(::VirtualQuery(pMapping, &mapInfo, sizeof(mapInfo)))
+        mappingSize = mapInfo.RegionSize;
+    auto unmap = raii_sentinel([pMapping]{::UnmapViewOfFile(pMapping);});
+#else
+    int fd = ::shm_open(mirrorName, O_RDONLY, 0);
+    if(fd < 0)
+        return {};
+    struct stat mirrorStat{};
+    if(::fstat(fd, &mirrorStat) == 0)
+        mappingSize = static_cast<std::size_t>(mirrorStat.st_size);
+    if(mappingSize >= sizeof(MirrorHeader))
+    {
+        pMapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+        if(pMapping == MAP_FAILED)
+            pMapping = nullptr;
+    }
+    ::close(fd);
+    if(!pMapping)
+        return {};
+    auto unmap = raii_sentinel([pMapping, mappingSize]
+    {
+        ::munmap(const_cast<void*>(pMapping), mappingSize);
+    });
+#endif
+
+    if(mappingSize < sizeof(MirrorHeader))
+        return {};
+    const MirrorHeader &header = *reinterpret_cast<const MirrorHeader*>(pMapping);
+    if(header.magic.load(std::memory_order_acquire) != mirrorMagic ||
+       header.formatVersion != mirrorFormatVersion ||
+       header.capacity > mappingSize - sizeof(MirrorHeader))
+    {
+        return {};
+    }
+#if !defined(Q_OS_WIN)
+    // Ignore a stale mirror from a daemon that crashed.  (EPERM means the
+    // process exists but belongs to another user, which is expected.)
+    if(::kill(static_cast<pid_t>(header.ownerPid), 0) != 0 && errno != EPERM)
+        return {};
+#endif
+
+    const unsigned char *pData = reinterpret_cast<const unsigned char*>(pMapping) + sizeof(MirrorHeader);
+    for(int attempt = 0; attempt < maxReadAttempts; ++attempt)
+    {
+        quint64 sequence = header.sequence.load(std::memory_order_acquire);
+        if(sequence & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        quint32 size = header.size.load(std::memory_order_relaxed);
+        if(size > header.capacity)
+            continue;
+        QByteArray snapshot{reinterpret_cast<const char*>(pData), static_cast<qsizetype>(size)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(header.sequence.load(std::memory_order_relaxed) == sequence)
+            return snapshot;
+    }
+    qWarning() << "Unable to read a consistent snapshot from the state mirror";
+    return {};
+}
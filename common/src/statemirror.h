@@ -0,0 +1,77 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+
+#include "common.h"
+#line HEADER_FILE("statemirror.h")
+
+#ifndef STATEMIRROR_H
+#define STATEMIRROR_H
+
+#include <QByteArray>
+#include <cstddef>
+
+// The state mirror is a read-only shared-memory copy of the daemon's
+// DaemonState and DaemonSettings for local processes.  One-shot clients (like
+// 'piactl get') can read it directly instead of connecting to the daemon and
+// waiting for a full snapshot over the IPC socket.
+//
+// The mirror contains one serialized snapshot (a CBOR map with "state",
+// "settings", and "version" - the daemon's data version token) protected by a
+// seqlock.  The daemon is the only writer; readers retry if the snapshot
+// changes while they're copying it, so neither side ever blocks.
+//
+// The mirror only exposes what any local client could read from the IPC
+// socket.  It's not a substitute for the socket for long-running clients;
+// those still use "data" notifications (with deltas), which are much cheaper
+// than re-reading the whole snapshot on each change.
+class COMMON_EXPORT StateMirrorWriter
+{
+public:
+    // Creates the shared memory object, replacing any stale one left behind.
+    // If this fails, a warning is traced and publish() has no effect.
+    StateMirrorWriter();
+    ~StateMirrorWriter();
+
+private:
+    StateMirrorWriter(const StateMirrorWriter &) = delete;
+    StateMirrorWriter &operator=(const StateMirrorWriter &) = delete;
+
+public:
+    bool isValid() const {return _pMapping;}
+
+    // Publish a new snapshot.  If it's too large for the mirror, the mirror
+    // is marked unavailable (readers fall back to the socket) and this
+    // returns false.
+    bool publish(const QByteArray &snapshot);
+
+private:
+    void *_pMapping;
+    std::size_t _mappingSize;
+#if defined(Q_OS_WIN)
+    void *_mappingHandle;
+#endif
+};
+
+// Read the current snapshot from the state mirror.  Returns an empty
+// QByteArray if there is no mirror (the daemon isn't running, is an older
+// version, or the snapshot was too large), or if a consistent snapshot
+// couldn't be read.
+COMMON_EXPORT QByteArray readStateMirror();
+
+#endif
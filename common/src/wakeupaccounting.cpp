@@ -0,0 +1,84 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "common.h"
+#line SOURCE_FILE("wakeupaccounting.cpp")
+
+#include "wakeupaccounting.h"
+#include <kapps_core/src/wakeups.h>
+#include <QEvent>
+
+namespace
+{
+    const char wakeupTagProperty[]{"wakeupTag"};
+
+    // Whether an event type is a wakeup - a timer or socket notifier event
+    bool isWakeupEvent(QEvent::Type type)
+    {
+        switch(type)
+        {
+            case QEvent::Type::Timer:
+            case QEvent::Type::SockAct:
+            case QEvent::Type::SockClose:
+            case QEvent::Type::WinEventAct:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    QByteArray findWakeupTag(const QObject &receiver)
+    {
+        for(const QObject *pObject = &receiver; pObject; pObject = pObject->parent())
+        {
+            QVariant tag = pObject->property(wakeupTagProperty);
+            if(tag.isValid())
+                return tag.toByteArray();
+        }
+        return QByteArrayLiteral("untagged ") + receiver.metaObject()->className();
+    }
+}
+
+void tagWakeups(QObject &object, const QByteArray &tag)
+{
+    object.setProperty(wakeupTagProperty, tag);
+}
+
+bool WakeupAccountingApplication::notify(QObject *pReceiver, QEvent *pEvent)
+{
+    if(!pReceiver || !pEvent || !isWakeupEvent(pEvent->type()))
+        return QCoreApplication::notify(pReceiver, pEvent);
+
+    // The tag must outlive the scope, which records it when destroyed
+    QByteArray tag = findWakeupTag(*pReceiver);
+    kapps::core::WakeupScope wakeup{tag.constData()};
+    return QCoreApplication::notify(pReceiver, pEvent);
+}
+
+QJsonObject wakeupAccountingJson()
+{
+    QJsonObject totals;
+    for(const auto &[tag, tagTotals] : kapps::core::WakeupAccounting::snapshot())
+    {
+        totals.insert(QString::fromStdString(tag), QJsonObject{
+            {QStringLiteral("wakeups"), static_cast<qint64>(tagTotals.wakeups)},
+            {QStringLiteral("cpuMs"), tagTotals.cpuTime.count() / 1000.0}
+        });
+    }
+    return totals;
+}
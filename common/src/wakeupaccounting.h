@@ -0,0 +1,52 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "common.h"
+#line HEADER_FILE("wakeupaccounting.h")
+
+#ifndef WAKEUPACCOUNTING_H
+#define WAKEUPACCOUNTING_H
+
+#include <QCoreApplication>
+#include <QJsonObject>
+
+// Qt integration for kapps::core::WakeupAccounting.
+//
+// Tag a QTimer, QSocketNotifier, or any other QObject that receives timer or
+// socket events with the subsystem it belongs to.  Events for untagged
+// objects are accounted to the nearest tagged parent, or to the receiver's
+// class name if there is none.
+COMMON_EXPORT void tagWakeups(QObject &object, const QByteArray &tag);
+
+// WakeupAccountingApplication accounts for the timer and socket notifier
+// events delivered on the main thread.  (Qt only calls notify() for objects
+// on the main thread, so objects on worker threads aren't accounted.)
+class COMMON_EXPORT WakeupAccountingApplication : public QCoreApplication
+{
+public:
+    using QCoreApplication::QCoreApplication;
+
+public:
+    virtual bool notify(QObject *pReceiver, QEvent *pEvent) override;
+};
+
+// Get the wakeup totals for each tag as JSON - an object with tags as keys,
+// each having "wakeups" and "cpuMs"
+COMMON_EXPORT QJsonObject wakeupAccountingJson();
+
+#endif
@@ -22,6 +22,7 @@
 #include "apiclient.h"
 #include <common/src/testshim.h>
 #include <common/src/networktaskwithretry.h>
+#include <QCryptographicHash>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QPointer>
@@ -40,6 +41,34 @@ namespace
     // API base.
     const int apiAttemptsPerBase{2};
 
+    // Build the key identifying identical GET requests.  The auth header is
+    // hashed so credentials aren't kept around in the key.
+    QByteArray getRequestKey(const ApiBase &apiBaseUris, const QString &resource,
+                             const QByteArray &auth, const QByteArray &retryKey)
+    {
+        QByteArray key = QByteArray::number(reinterpret_cast<quintptr>(&apiBaseUris), 16);
+        key += ' ';
+        key += retryKey;
+        key += ' ';
+        key += QCryptographicHash::hash(auth, QCryptographicHash::Algorithm::Sha256).toHex();
+        key += ' ';
+        key += resource.toUtf8();
+        return key;
+    }
+
+    // Remove entries from a QHash that match a predicate
+    template<class Hash, class Pred>
+    void removeEntries(Hash &hash, Pred pred)
+    {
+        for(auto it = hash.begin(); it != hash.end(); )
+        {
+            if(pred(it.value()))
+                it = hash.erase(it);
+            else
+                ++it;
+        }
+    }
+
     static inline QJsonDocument parseJsonBody(const QByteArray& body)
     {
         QJsonParseError parseError;
@@ -77,39 +106,110 @@ Async<QByteArray> ApiClient::requestRetry(QNetworkAccessManager::Operation verb,
                                           const QJsonDocument &data, QByteArray auth)
 {
     // Create a retriable task to fetch the response body
-    return Async<NetworkTaskWithRetry>::create(verb, apiBaseUris,
-                                               resource,
-                                               std::move(pRetryStrategy),
-                                               data,
-                                               std::move(auth));
+    auto request = Async<NetworkTaskWithRetry>::create(verb, apiBaseUris,
+                                                       resource,
+                                                       std::move(pRetryStrategy),
+                                                       data,
+                                                       std::move(auth));
+    // Like getShared(), connect to the finished signal directly so this
+    // doesn't keep the request alive
+    NetworkTaskWithRetry *pTask = request.get();
+    const ApiBase *pApiBase = &apiBaseUris;
+    auto start = std::chrono::steady_clock::now();
+    connect(pTask, &BaseTask::finished, this, [this, pTask, pApiBase, start]
+        {
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+            emit requestFinished(pApiBase, duration, pTask->isResolved());
+            if(pTask->isResolved())
+                emit requestSucceeded();
+        });
+    return request;
+}
+
+Async<QByteArray> ApiClient::getShared(ApiBase &apiBaseUris, QString resource,
+                                       QByteArray auth, const QByteArray &retryKey,
+                                       const std::function<std::unique_ptr<ApiRetry>()> &makeRetry,
+                                       std::chrono::milliseconds cacheTtl)
+{
+    QByteArray key = getRequestKey(apiBaseUris, resource, auth, retryKey);
+
+    auto itCached = _responseCache.find(key);
+    if(itCached != _responseCache.end())
+    {
+        if(!itCached->expiry.hasExpired())
+        {
+            qInfo() << "Using cached response for" << ApiResource{resource};
+            return Async<QByteArray>::resolve(itCached->body);
+        }
+        _responseCache.erase(itCached);
+    }
+
+    auto pInFlight = _inFlightGets.value(key).toStrongRef();
+    if(pInFlight)
+    {
+        qInfo() << "Sharing in-flight request for" << ApiResource{resource};
+        return Async<QByteArray>{pInFlight};
+    }
+
+    // Drop any requests that were abandoned by all callers before finishing,
+    // and any expired responses
+    removeEntries(_inFlightGets, [](const QWeakPointer<Task<QByteArray>> &pTask)
+        {return pTask.isNull();});
+    removeEntries(_responseCache, [](const CachedResponse &response)
+        {return response.expiry.hasExpired();});
+
+    auto request = requestRetry(QNetworkAccessManager::Operation::GetOperation,
+                                apiBaseUris, std::move(resource), makeRetry(),
+                                {}, std::move(auth));
+    _inFlightGets.insert(key, request.toWeakRef());
+
+    // Connect to the finished signal directly rather than using notify(), so
+    // the callers' references are still the only thing keeping the request
+    // alive.
+    Task<QByteArray> *pTask = request.get();
+    connect(pTask, &BaseTask::finished, this, [this, key, cacheTtl, pTask]
+        {
+            auto itInFlight = _inFlightGets.find(key);
+            if(itInFlight != _inFlightGets.end() &&
+                itInFlight->toStrongRef().get() == pTask)
+            {
+                _inFlightGets.erase(itInFlight);
+            }
+            if(cacheTtl.count() > 0 && pTask->isResolved())
+                _responseCache.insert(key, {pTask->result(), QDeadlineTimer{cacheTtl}});
+        });
+
+    return request;
 }
 
 Async<QJsonDocument> ApiClient::getRetry(ApiBase &apiBaseUris, QString resource,
-                                         QByteArray auth)
+                                         QByteArray auth,
+                                         std::chrono::milliseconds cacheTtl)
 {
-    return requestRetry(QNetworkAccessManager::Operation::GetOperation,
-                        apiBaseUris, std::move(resource),
-                        apiBaseUris.getAttemptCount(apiAttemptsPerBase), {},
-                        std::move(auth))
+    unsigned attemptCount = apiBaseUris.getAttemptCount(apiAttemptsPerBase);
+    return getShared(apiBaseUris, std::move(resource), std::move(auth),
+                     "counted:" + QByteArray::number(attemptCount),
+                     [attemptCount]{return ApiRetries::counted(attemptCount);},
+                     cacheTtl)
             ->then(parseJsonBody);
 }
 
 Async<QJsonDocument> ApiClient::getTimedRetry(ApiBase &apiBaseUris, QString resource,
                                               QByteArray auth)
 {
-    return requestRetry(QNetworkAccessManager::Operation::GetOperation,
-                        apiBaseUris, std::move(resource),
-                        ApiRetries::timed(std::chrono::seconds{3}, std::chrono::seconds{10}),
-                        {}, std::move(auth))
+    return getShared(apiBaseUris, std::move(resource), std::move(auth),
+                     QByteArrayLiteral("timed:3:10"),
+                     []{return ApiRetries::timed(std::chrono::seconds{3}, std::chrono::seconds{10});})
             ->then(parseJsonBody);
 }
 
 Async<QJsonDocument> ApiClient::getIp(ApiBase &apiBaseUris, QString resource, QByteArray auth)
 {
     // Max of 1 attempt so no retries occur
-    return requestRetry(QNetworkAccessManager::Operation::GetOperation,
-                        apiBaseUris, std::move(resource), 1,
-                        {}, std::move(auth))
+    return getShared(apiBaseUris, std::move(resource), std::move(auth),
+                     QByteArrayLiteral("counted:1"),
+                     []{return ApiRetries::counted(1);})
             ->then(parseJsonBody);
 }
 
@@ -118,10 +218,9 @@ Async<QJsonDocument> ApiClient::getVpnIpRetry(ApiBase &apiBaseUris,
                                               std::chrono::seconds timeout,
                                               QByteArray auth)
 {
-    return requestRetry(QNetworkAccessManager::Operation::GetOperation,
-                        apiBaseUris, std::move(resource),
-                        ApiRetries::timed(std::chrono::seconds{5}, timeout),
-                        {}, std::move(auth))
+    return getShared(apiBaseUris, std::move(resource), std::move(auth),
+                     "timed:5:" + QByteArray::number(static_cast<qint64>(timeout.count())),
+                     [timeout]{return ApiRetries::timed(std::chrono::seconds{5}, timeout);})
             ->then(parseJsonBody);
 }
 
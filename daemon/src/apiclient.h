@@ -28,13 +28,24 @@
 #include "environment.h"
 #include <QJsonDocument>
 #include <QNetworkReply>
+#include <QDeadlineTimer>
+#include <QHash>
 #include <QPointer>
 #include <QSharedPointer>
+#include <chrono>
+#include <functional>
 #include <memory>
 
 // ApiClient is used to make requests to the PrivateInternetAccess client API.
 // This API includes requests such as connection status detection, geolocation,
 // and problem reports.
+//
+// Identical GET requests are coalesced - if a GET is already in flight with
+// the same API base, resource, auth, and retry strategy, the new caller shares
+// its result instead of sending another request.  This matters after network
+// changes, when several parts of the daemon refresh at once.  getRetry() can
+// also cache a response for a short time; callers opt in to this for
+// resources that don't change often.
 class ApiClient : public QObject
 {
     Q_OBJECT
@@ -59,6 +70,16 @@ private:
                                    std::unique_ptr<ApiRetry> pRetryStrategy,
                                    const QJsonDocument &data, QByteArray auth);
 
+    // Issue a GET request, sharing an identical request that's already in
+    // flight, or a cached response that hasn't expired.  retryKey identifies
+    // the retry strategy created by makeRetry, since requests using different
+    // strategies aren't identical.  If cacheTtl is nonzero, a successful
+    // response is cached for that long.
+    Async<QByteArray> getShared(ApiBase &apiBaseUris, QString resource,
+                                QByteArray auth, const QByteArray &retryKey,
+                                const std::function<std::unique_ptr<ApiRetry>()> &makeRetry,
+                                std::chrono::milliseconds cacheTtl = {});
+
 public:
     // Get an API resource, such as "geo" or "status".
     // - resource is the path to the resource (under /api/client/), such as
@@ -72,8 +93,12 @@ public:
     // credentials for forward compatibility, but this means a valid response
     // does not necessarily mean that the credentials were valid for all
     // requests.
+    //
+    // If cacheTtl is nonzero, a successful response is cached and reused for
+    // identical requests for that long.
     Async<QJsonDocument> getRetry(ApiBase &apiBaseUris, QString resource,
-                                  QByteArray auth = {});
+                                  QByteArray auth = {},
+                                  std::chrono::milliseconds cacheTtl = {});
 
     // Get an API resource, such as the port forwarding token.
     //
@@ -107,6 +132,30 @@ public:
     // Generate an authentication header from a token, or a username and
     // password if a token is not available.
     static QByteArray autoAuth(const QString& username, const QString& password, const QString& token);
+
+signals:
+    // Emitted when any API request succeeds.  Deferrable requests can be sent
+    // at this point, while the network is known to be working and the radio
+    // is already awake, instead of waking up separately.
+    void requestSucceeded();
+    // Emitted when any API request finishes, with the total time taken
+    // including retries.  The ApiBase is only provided to identify the API
+    // for metrics, it shouldn't be dereferenced.
+    void requestFinished(const ApiBase *pApiBase,
+                         std::chrono::microseconds duration, bool succeeded);
+
+private:
+    struct CachedResponse
+    {
+        QByteArray body;
+        QDeadlineTimer expiry;
+    };
+
+    // GET requests in flight, by request key (see getShared()).  These are
+    // weak references, the callers still own the requests.
+    QHash<QByteArray, QWeakPointer<Task<QByteArray>>> _inFlightGets;
+    // Cached GET responses, by request key
+    QHash<QByteArray, CachedResponse> _responseCache;
 };
 
 
@@ -17,65 +17,41 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "automation.h"
-auto Automation::ruleMatchesNetwork(const AutomationRule &rule,
-                                    const NetworkConnection &network) const
-    -> RuleTest
+void Automation::compileRules()
 {
-    // If the default connection is Wi-Fi, but the interface is not yet known to
-    // be associated, it cannot match any rule.
-    // This occurs as a transient state when connecting - all platform backends
-    // get routing and Wi-Fi information separately, and we may not know that
-    // the interface is connected by the time the routes appear.  Since we do
-    // not know whether the interface is encrypted or what SSID it's connected
-    // to, no rule can match.
-    if(network.medium() == NetworkConnection::Medium::WiFi &&
-        !network.wifiAssociated())
-    {
-        return RuleTest::NoMatch;
-    }
+    _compiledRules = {};
 
-    // Check the rule type
-    if(rule.condition().ruleType() == QStringLiteral("openWifi"))
+    // Several rules could match with the same specificity (such as duplicate
+    // SSID rules); the first one is used, so only keep the first of each.
+    for(const auto &rule : _rules)
     {
-        if(network.medium() == NetworkConnection::Medium::WiFi &&
-           !network.wifiEncrypted())
+        const QString &ruleType = rule.condition().ruleType();
+        if(ruleType == QStringLiteral("openWifi"))
         {
-            return RuleTest::GeneralMatch;
+            if(!_compiledRules.pOpenWifi)
+                _compiledRules.pOpenWifi = &rule;
         }
-        return RuleTest::NoMatch;
-    }
-    else if(rule.condition().ruleType() == QStringLiteral("protectedWifi"))
-    {
-        if(network.medium() == NetworkConnection::Medium::WiFi &&
-           network.wifiEncrypted())
+        else if(ruleType == QStringLiteral("protectedWifi"))
         {
-            return RuleTest::GeneralMatch;
+            if(!_compiledRules.pProtectedWifi)
+                _compiledRules.pProtectedWifi = &rule;
         }
-        return RuleTest::NoMatch;
-    }
-    else if(rule.condition().ruleType() == QStringLiteral("wired"))
-    {
-        if(network.medium() == NetworkConnection::Medium::Wired)
-            return RuleTest::GeneralMatch;
-        return RuleTest::NoMatch;
-    }
-    else if(rule.condition().ruleType() == QStringLiteral("ssid"))
-    {
-        // Look for the specified SSID.  If no SSID is set (somehow), the rule
-        // is broken, don't match this.  (Shouldn't happen normally but could
-        // occur if settings were manipulated manually, via CLI, etc.)
-        if(rule.condition().ssid() != QStringLiteral("") &&
-           network.wifiSsid() == rule.condition().ssid())
+        else if(ruleType == QStringLiteral("wired"))
         {
-            return RuleTest::WifiSsidMatch;
+            if(!_compiledRules.pWired)
+                _compiledRules.pWired = &rule;
+        }
+        else if(ruleType == QStringLiteral("ssid"))
+        {
+            // If no SSID is set (somehow), the rule is broken, it can't match
+            // anything.  (Shouldn't happen normally but could occur if
+            // settings were manipulated manually, via CLI, etc.)
+            const QString &ssid = rule.condition().ssid();
+            if(!ssid.isEmpty() && !_compiledRules.ssidRules.contains(ssid))
+                _compiledRules.ssidRules.insert(ssid, &rule);
         }
-        return RuleTest::NoMatch;
-    }
-    else
-    {
         // Otherwise, this rule type is not known (possibly a new rule type
         // added by a future release) - ignore it.
-        return RuleTest::NoMatch;
     }
 }
 
@@ -115,22 +91,40 @@ const AutomationRule *Automation::matchLastDefIpv4() const
     if(!_pLastDefIpv4)
         return nullptr; // No network currently, no rules can match
 
-    RuleTest currentResult{RuleTest::NoMatch};
-    const AutomationRule *pCurrentMatch{};
+    const NetworkConnection &network = *_pLastDefIpv4;
 
-    // Find the most specific rule - if no rules match, we'll return the
-    // nullptr from above
-    for(const auto &rule : _rules)
+    // If the default connection is Wi-Fi, but the interface is not yet known to
+    // be associated, it cannot match any rule.
+    // This occurs as a transient state when connecting - all platform backends
+    // get routing and Wi-Fi information separately, and we may not know that
+    // the interface is connected by the time the routes appear.  Since we do
+    // not know whether the interface is encrypted or what SSID it's connected
+    // to, no rule can match.
+    if(network.medium() == NetworkConnection::Medium::WiFi &&
+        !network.wifiAssociated())
     {
-        RuleTest nextResult{ruleMatchesNetwork(rule, *_pLastDefIpv4)};
-        if(nextResult > currentResult)
-        {
-            pCurrentMatch = &rule;
-            currentResult = nextResult;
-        }
+        return nullptr;
+    }
+
+    // A rule for this specific SSID is preferred over a general rule for the
+    // network type
+    if(!network.wifiSsid().isEmpty())
+    {
+        auto itSsidRule = _compiledRules.ssidRules.find(network.wifiSsid());
+        if(itSsidRule != _compiledRules.ssidRules.end())
+            return itSsidRule.value();
     }
 
-    return pCurrentMatch;
+    switch(network.medium())
+    {
+        case NetworkConnection::Medium::WiFi:
+            return network.wifiEncrypted() ? _compiledRules.pProtectedWifi :
+                _compiledRules.pOpenWifi;
+        case NetworkConnection::Medium::Wired:
+            return _compiledRules.pWired;
+        default:
+            return nullptr;
+    }
 }
 
 bool Automation::updateLastRule(const AutomationRule *pNewRule)
@@ -173,14 +167,19 @@ void Automation::setRules(std::vector<AutomationRule> rules)
         << rules.size() << "rules";
 
     _rules = std::move(rules);
+    compileRules();
 
     const AutomationRule *pNewRule = matchLastDefIpv4();
     if(updateLastRule(pNewRule))
         emit ruleTriggered(_pLastRule, Trigger::RuleChange);
 }
 
-void Automation::setNetworks(const std::vector<NetworkConnection> &newNetworks)
+void Automation::setNetworks(const std::vector<NetworkConnection> &newNetworks,
+                             const NetworkChanges &changes)
 {
+    if(!changes.defaultChanged)
+        return;
+
     // Find the default IPv4 network (if there is one)
     auto itDefIpv4 = std::find_if(newNetworks.begin(), newNetworks.end(),
         [](const NetworkConnection &conn){return conn.defaultIpv4();});
@@ -22,6 +22,7 @@
 #include <common/src/common.h>
 #include <common/src/settings/automation.h>
 #include "networkmonitor.h"
+#include <QHash>
 
 // Automation applies a set of rules to the current network detected by
 // NetworkMonitor.  When a rule is triggered, it's emitted from ruleTriggered().
@@ -33,20 +34,18 @@ class Automation : public QObject
     Q_OBJECT
 
 private:
-    // Result of a rule test against a network.  This indicates whether the
-    // rule matches at all, and if so, the specificity of the rule, as more
-    // specific matches are preferred.
-    //
-    // These values are in ascending order so we can find the maximum
-    // specificity when matching.
-    enum RuleTest : int
+    // The rules from _rules that can match a network, organized for lookup -
+    // built by compileRules() when the rules are set.  The pointers refer to
+    // rules in _rules.
+    struct CompiledRules
     {
-        NoMatch,
-        // General network type match only
-        GeneralMatch,
-        // Wi-Fi SSID matches a specific rule criterion, this is the only
-        // specific type of match currently
-        WifiSsidMatch,
+        // Rules for specific Wi-Fi SSIDs - these are the most specific rules,
+        // so they're preferred over the general rules below
+        QHash<QString, const AutomationRule*> ssidRules;
+        // General rules for each network type, if present
+        const AutomationRule *pOpenWifi{nullptr};
+        const AutomationRule *pProtectedWifi{nullptr};
+        const AutomationRule *pWired{nullptr};
     };
 
 public:
@@ -59,10 +58,8 @@ public:
     Q_ENUM(Trigger);
 
 private:
-    // Test if a rule matches a specific network - returns a RuleTest value
-    // indicating whether it matched and the specificity of the match.
-    RuleTest ruleMatchesNetwork(const AutomationRule &rule,
-                                const NetworkConnection &network) const;
+    // Build _compiledRules from _rules
+    void compileRules();
 
     // Test whether a default IPv4 network matches the last default IPv4
     // network.  This determines whether this network causes a new rule trigger
@@ -71,8 +68,9 @@ private:
     bool networkMatchesLastDefIpv4(const NetworkConnection &newDefIpv4) const;
 
     // Match the last default IPv4 network (_pLastDefIpv4) to the current rules
-    // in _rules - return the matching rule (or no rule).  The result points to
-    // a rule in _rules.
+    // in _compiledRules - return the matching rule (or no rule).  The result
+    // points to a rule in _rules.  If more than one rule matches, the most
+    // specific one is used, or the first one if they're equally specific.
     const AutomationRule *matchLastDefIpv4() const;
 
     // Update _pLastRule, result indicates whether it has changed
@@ -98,7 +96,11 @@ public:
     // for the same rule to trigger again with no change at all - this occurs
     // when switching directly from one network to another when both networks
     // match the same rule.
-    void setNetworks(const std::vector<NetworkConnection> &newNetworks);
+    //
+    // Rules only depend on the default IPv4 network, so nothing is checked if
+    // changes.defaultChanged is false.
+    void setNetworks(const std::vector<NetworkConnection> &newNetworks,
+                     const NetworkChanges &changes);
 
 signals:
     // The current rule has changed.  The current rule could be 'none'; which
@@ -111,6 +113,8 @@ signals:
 private:
     // The current set of rules (specified by setRules())
     std::vector<AutomationRule> _rules;
+    // The rules organized for lookup - rebuilt whenever _rules changes
+    CompiledRules _compiledRules;
     // The last default IPv4 network that we detected - or none
     nullable_t<NetworkConnection> _pLastDefIpv4;
     // The last rule that triggered - or none if no rule matches this network
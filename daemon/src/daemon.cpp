@@ -23,12 +23,15 @@
 #include "vpnmethod.h"
 #include <common/src/ipc.h>
 #include <common/src/jsonrpc.h>
+#include <common/src/jsondelta.h>
 #include <common/src/locations.h>
+#include <kapps_regions/src/regionlistdiff.h>
 #include <common/src/builtin/path.h>
 #include "version.h"
 #include "brand.h"
 #include <common/src/builtin/util.h>
 #include <common/src/apinetwork.h>
+#include <common/src/wakeupaccounting.h>
 #if defined(Q_OS_WIN)
 #include "win/wfp_filters.h"
 #include "win/win_networks.h"
@@ -46,11 +49,15 @@
 #include <chrono>
 #include <QFileInfo>
 #include <QDir>
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QRegularExpression>
 #include <QRandomGenerator>
 #include <QRegularExpression>
 #include <QStringView>
+#include <QUuid>
+#include <QCborMap>
+#include <QCborValue>
 
 #if defined(Q_OS_WIN)
 #include <kapps_core/src/winapi.h>
@@ -82,6 +89,29 @@ namespace
     const std::chrono::minutes dipRefreshFastInterval{10};
     const std::chrono::hours dipRefreshSlowInterval{24};
 
+    // New clients normally negotiate the data encoding right after connecting,
+    // which triggers the initial snapshot.  Older clients that don't get the
+    // full snapshot after this timeout.
+    const std::chrono::milliseconds snapshotNegotiationTimeout{250};
+
+    // State mirror updates are rate-limited, since each one serializes the
+    // entire state
+    const std::chrono::seconds stateMirrorInterval{1};
+
+    // Maximum time that deferrable work is postponed for a connection
+    // transition.  Reconnecting or Interrupted can last indefinitely, the
+    // data files still need to be written eventually.
+    const std::chrono::seconds maxConnectionDeferral{15};
+
+    // Regions image of the cached regions lists, in the daemon settings
+    // directory
+    const QString regionsImageFilename{QStringLiteral("regions.cache")};
+
+    // Latency profiles for networks that haven't been used for this long are
+    // discarded, and only the most recently used profiles are kept.
+    const std::chrono::hours latencyProfileMaxAge{24*14};
+    const std::size_t latencyProfileLimit{10};
+
     // Resource paths for various regions-related resource (relative to the API
     // base)
     const QString shadowsocksRegionsResource{QStringLiteral("shadow_socks")};
@@ -252,10 +282,12 @@ Daemon::Daemon(QObject* parent)
     , _checkInstallFeatureFlags{false}
     , _server(nullptr)
     , _methodRegistry(new LocalMethodRegistry(this))
-    , _rpc(new RemoteNotificationInterface(this))
+    , _dataInstance{QUuid::createUuid().toString(QUuid::StringFormat::Id128)}
+    , _dataVersion{0}
     , _connection(new VPNConnection(this))
     , _environment{_state}
     , _apiClient{}
+    , _metricsServer{_metrics, [this](){collectMetrics();}}
     , _modernLatencyTracker{}
     , _portForwarder{_apiClient, _account, _state, _environment}
     , _modernRegionRefresher{QStringLiteral("modern regions"),
@@ -272,11 +304,23 @@ Daemon::Daemon(QObject* parent)
                             publicIpLoadInterval, publicIpRefreshInterval}
     , _snoozeTimer(this)
     , _pendingSerializations(0)
+    , _serializationDeferred{false}
+    , _stateMirrorDeferred{false}
+    , _regionsListGeneration{0}
 {
+    _startupTime.start();
+
 #ifdef PIA_CRASH_REPORTING
     initCrashReporting(false);
 #endif
 
+    // Keep API host addresses across connections (see
+    // ApiNetwork::cachedHostAddress())
+    ApiNetwork::instance()->enableHostCache();
+    // Send API requests on a network thread, so bursts of requests (such as
+    // after waking from sleep) don't delay IPC and connection handling
+    ApiNetwork::instance()->useNetworkThread(&_apiNetworkThread);
+
     // Redact dedicated IP addresses and tokens from logs.  We can't just avoid
     // tracing these, because OpenVPN and WireGuard may trace them, etc.  Set
     // this up before reading the account information so the redactions will
@@ -311,7 +355,9 @@ Daemon::Daemon(QObject* parent)
     // its permissions.
     if(!readProperties(_account, Path::DaemonSettingsDir, "account.json"))
     {
-        writeProperties(_account.toJsonObject(), Path::DaemonSettingsDir, "account.json");
+        _settingsPersistence.queueWrite(_account.toJsonObject(), Path::DaemonSettingsDir,
+                                        QStringLiteral("account.json"));
+        _settingsPersistence.flush();
         // Do this only when writing the file the first time, don't do it on
         // every daemon start in case the user overrides the permissions.
         restrictAccountJson();
@@ -323,36 +369,87 @@ Daemon::Daemon(QObject* parent)
     // they occur.
     _serializationTimer.setSingleShot(true);
     connect(&_serializationTimer, &QTimer::timeout, this, &Daemon::serialize);
+    _connectionDeferralTimer.setSingleShot(true);
+    connect(&_connectionDeferralTimer, &QTimer::timeout, this, &Daemon::runDeferredWork);
 
-    // Refresh account information every 5 mins.
-    _accountRefreshTimer.setInterval(msec(std::chrono::minutes(5)));
+    // Refresh account information every 5 mins (scaled back on battery power
+    // by PowerPolicy).
+    _powerPolicy.manage(_accountRefreshTimer, std::chrono::minutes(5),
+                        PowerPolicy::Work::Background);
     connect(&_accountRefreshTimer, &QTimer::timeout, this, &Daemon::refreshAccountInfo);
 
-    _dedicatedIpRefreshTimer.setInterval(msec(dipRefreshFastInterval));
+    _powerPolicy.manage(_dedicatedIpRefreshTimer, dipRefreshFastInterval,
+                        PowerPolicy::Work::Background);
     connect(&_dedicatedIpRefreshTimer, &QTimer::timeout, this, &Daemon::refreshDedicatedIps);
 
-    _memTraceTimer.setInterval(msec(std::chrono::minutes(5)));
+    _powerPolicy.manage(_memTraceTimer, std::chrono::minutes(5),
+                        PowerPolicy::Work::Diagnostic);
     connect(&_memTraceTimer, &QTimer::timeout, this, &Daemon::traceMemory);
+    connect(&_memTraceTimer, &QTimer::timeout, _methodRegistry, &LocalMethodRegistry::traceStats);
+
+    // Subsystems that compute their own intervals apply the policy's scale
+    // when it changes
+    connect(&_powerPolicy, &PowerPolicy::modeChanged, this, &Daemon::applyPowerPolicy);
+    applyPowerPolicy();
+
+    // Account for the periodic timers' wakeups by subsystem (see
+    // WakeupAccounting)
+    tagWakeups(_accountRefreshTimer, QByteArrayLiteral("account"));
+    tagWakeups(_dedicatedIpRefreshTimer, QByteArrayLiteral("dedicatedip"));
+    tagWakeups(_memTraceTimer, QByteArrayLiteral("diagnostics"));
+    tagWakeups(_serializationTimer, QByteArrayLiteral("settings"));
+    tagWakeups(_stateMirrorTimer, QByteArrayLiteral("statemirror"));
+    tagWakeups(_connectionDeferralTimer, QByteArrayLiteral("settings"));
+    tagWakeups(_notificationBatchTimer, QByteArrayLiteral("ipc"));
+
+    _stateMirrorTimer.setSingleShot(true);
+    _stateMirrorTimer.setInterval(msec(stateMirrorInterval));
+    connect(&_stateMirrorTimer, &QTimer::timeout, this, &Daemon::publishStateMirror);
+    // Publish the initial state once the event loop starts
+    if(_stateMirror.isValid())
+        _stateMirrorTimer.start(0);
+
+    _notificationBatchTimer.setSingleShot(true);
+    connect(&_notificationBatchTimer, &QTimer::timeout, this,
+            [this](){queueNotification(&Daemon::notifyChanges);});
+
+    // Properties that change frequently and are only informational - changes
+    // to these are batched.  Properties that participate in invariants with
+    // other properties (connectionState, connectedServer, the location
+    // properties, etc.) must not be batched, since the client must always
+    // observe them together.
+    static const QSet<QString> batchedDataProperties{
+        QStringLiteral("modernLatencies"),
+    };
+    static const std::unordered_set<std::string> batchedStateProperties{
+        "bytesReceived",
+        "bytesSent",
+        "intervalMeasurements",
+        "latencyStatistics",
+    };
+    static const QSet<QString> noBatchedProperties{};
 
-    auto connectPropertyChanges = [this](NativeJsonObject &object, QSet<QString> Daemon::* pSet)
+    auto connectPropertyChanges = [this](NativeJsonObject &object, QSet<QString> Daemon::* pSet,
+                                         const QSet<QString> &batched)
     {
         connect(&object, &NativeJsonObject::propertyChanged, this,
-            [this, pSet](const QString& name)
+            [this, pSet, &batched](const QString& name)
             {
                 auto &set = (*this).*pSet;
                 int size = set.size();
                 set += name;
                 if (set.size() > size)
-                    queueNotification(&Daemon::notifyChanges);
+                    queueChangeNotification(batched.contains(name));
             });
     };
-    connectPropertyChanges(_data, &Daemon::_dataChanges);
-    connectPropertyChanges(_account, &Daemon::_accountChanges);
-    connectPropertyChanges(_settings, &Daemon::_settingsChanges);
+    connectPropertyChanges(_data, &Daemon::_dataChanges, batchedDataProperties);
+    connectPropertyChanges(_account, &Daemon::_accountChanges, noBatchedProperties);
+    connectPropertyChanges(_settings, &Daemon::_settingsChanges, noBatchedProperties);
     _state.propertyChanged = [this](kapps::core::StringSlice name)
     {
-        if(_stateChanges.insert(name.to_string()).second)
-            queueNotification(&Daemon::notifyChanges);
+        std::string nameStr = name.to_string();
+        if(_stateChanges.insert(nameStr).second)
+            queueChangeNotification(batchedStateProperties.count(nameStr) > 0);
         // Update nextConfig unless it was nextConfig itself that changed.
         // (Even if it was nextConfig, updating would be a no-op since
         // nextConfig does not depend on itself, but ignore it for robustness)
@@ -370,15 +467,16 @@ Daemon::Daemon(QObject* parent)
     auto updateLogger =  [this]() {
         const auto& value = _settings.debugLogging();
         if (value == nullptr)
-            g_logger->configure(false, _settings.largeLogFiles(), {});
+            g_logger->configure(false, _settings.largeLogFiles(), _settings.binaryLogFiles(), {});
         else
-            g_logger->configure(true, _settings.largeLogFiles(), *value);
+            g_logger->configure(true, _settings.largeLogFiles(), _settings.binaryLogFiles(), *value);
     };
 
     // Set up logging.  Do this before migrating settings so tracing from the
     // migration is written (if debug logging is enabled).
     connect(&_settings, &DaemonSettings::debugLoggingChanged, this, updateLogger);
     connect(&_settings, &DaemonSettings::largeLogFilesChanged, this, updateLogger);
+    connect(&_settings, &DaemonSettings::binaryLogFilesChanged, this, updateLogger);
 
     connect(g_logger, &Logger::configurationChanged, this, [this](bool logToFile, const QStringList& filters) {
         if (logToFile)
@@ -407,7 +505,8 @@ Daemon::Daemon(QObject* parent)
     {
         if(!g_logger->logToFile())
         {
-            g_logger->configure(true, _settings.largeLogFiles(), DaemonSettings::defaultDebugLogging);
+            g_logger->configure(true, _settings.largeLogFiles(), _settings.binaryLogFiles(),
+                               DaemonSettings::defaultDebugLogging);
             qInfo() << "Enabled debug logging due to" << earlyDebugFile;
         }
         else
@@ -426,18 +525,16 @@ Daemon::Daemon(QObject* parent)
     // Migrate/upgrade any settings to the current daemon version
     upgradeSettings(settingsFileRead);
 
-    // Load locations from the cached data, if there is any.  Don't start
-    // fetching yet or check for region overrides / bundled region lists; that
-    // is done when the daemon activates.
-    //
-    // The daemon doesn't really need the built locations until it activates,
-    // but piactl exposes them and user scripts might be using this.
-    rebuildActiveLocations();
+    qInfo() << "Startup: loaded settings -" << _startupTime.elapsed() << "ms";
+
+    // Locations are loaded from the cached data in finishStartup(), after the
+    // IPC server is listening - see loadCachedLocations().
 
     #define RPC_METHOD(name, ...) LocalMethod(QStringLiteral(#name), this, &Daemon::RPC_##name)
     _methodRegistry->add(RPC_METHOD(applySettings).defaultArguments(false));
     _methodRegistry->add(RPC_METHOD(resetSettings));
     _methodRegistry->add(RPC_METHOD(getCountryBestRegion));
+    _methodRegistry->add(RPC_METHOD(getThroughputHistory).defaultArguments(0));
     _methodRegistry->add(RPC_METHOD(addDedicatedIp));
     _methodRegistry->add(RPC_METHOD(removeDedicatedIp));
     _methodRegistry->add(RPC_METHOD(dismissDedicatedIpChange));
@@ -446,12 +543,18 @@ Daemon::Daemon(QObject* parent)
     _methodRegistry->add(RPC_METHOD(startSnooze));
     _methodRegistry->add(RPC_METHOD(stopSnooze));
     _methodRegistry->add(RPC_METHOD(writeDiagnostics));
+    _methodRegistry->add(RPC_METHOD(getMemoryUsage));
+    _methodRegistry->add(RPC_METHOD(startProfiler).defaultArguments(10));
+    _methodRegistry->add(RPC_METHOD(stopProfiler));
     _methodRegistry->add(RPC_METHOD(writeDummyLogs));
     _methodRegistry->add(RPC_METHOD(crash));
     _methodRegistry->add(RPC_METHOD(refreshMetadata));
     _methodRegistry->add(RPC_METHOD(sendServiceQualityEvents));
     _methodRegistry->add(RPC_METHOD(notifyClientActivate));
     _methodRegistry->add(RPC_METHOD(notifyClientDeactivate));
+    _methodRegistry->add(RPC_METHOD(notifyClientVisible));
+    _methodRegistry->add(RPC_METHOD(negotiateDataEncoding));
+    _methodRegistry->add(RPC_METHOD(subscribeProperties));
     _methodRegistry->add(RPC_METHOD(emailLogin));
     _methodRegistry->add(RPC_METHOD(setToken));
     _methodRegistry->add(RPC_METHOD(login));
@@ -464,6 +567,8 @@ Daemon::Daemon(QObject* parent)
     _methodRegistry->add(RPC_METHOD(checkDriverState));
     _methodRegistry->add(RPC_METHOD(systemSleep));
     _methodRegistry->add(RPC_METHOD(systemWake));
+    _methodRegistry->add(RPC_METHOD(getPowerPolicy));
+    _methodRegistry->add(RPC_METHOD(getWakeupAccounting));
     #undef RPC_METHOD
 
     connect(_connection, &VPNConnection::stateChanged, this, &Daemon::vpnStateChanged);
@@ -472,6 +577,8 @@ Daemon::Daemon(QObject* parent)
         [this](bool usingSlowInterval){_state.usingSlowInterval(usingSlowInterval);});
     connect(_connection, &VPNConnection::error, this, &Daemon::vpnError);
     connect(_connection, &VPNConnection::byteCountsChanged, this, &Daemon::vpnByteCountsChanged);
+    connect(_connection, &VPNConnection::connectionTimelineChanged, this,
+        [this](){_state.connectionTimeline(_connection->connectionTimeline());});
     connect(_connection, &VPNConnection::usingTunnelConfiguration, this,
         [this](const QString &deviceName, const QString &deviceLocalAddress,
                const QString &deviceRemoteAddress)
@@ -499,6 +606,8 @@ Daemon::Daemon(QObject* parent)
             else if(_state.hnsdSyncFailure() == 0)
                 _state.hnsdSyncFailure(QDateTime::currentMSecsSinceEpoch());
         });
+    connect(_connection, &VPNConnection::hnsdSyncHeight, this,
+            [this](qint64 height){_state.hnsdSyncHeight(height);});
     connect(_connection, &VPNConnection::reconnectionNeeded, this,
         [this]()
         {
@@ -512,6 +621,8 @@ Daemon::Daemon(QObject* parent)
 
     connect(&_modernLatencyTracker, &LatencyTracker::newMeasurements, this,
             &Daemon::newLatencyMeasurements);
+    connect(&_modernLatencyTracker, &LatencyTracker::statisticsChanged, this,
+            &Daemon::latencyStatisticsChanged);
     // No locations are loaded yet - they're loaded when the daemon activates
 
     connect(&_portForwarder, &PortForwarder::portForwardUpdated, this,
@@ -528,6 +639,8 @@ Daemon::Daemon(QObject* parent)
 
     connect(&_modernRegionRefresher, &JsonRefresher::contentLoaded, this,
             &Daemon::modernRegionsLoaded);
+    connect(&_modernRegionRefresher, &JsonRefresher::validatorsChanged, this,
+            [this](const QJsonObject &validators){_data.cachedModernRegionsValidators(validators);});
     connect(&_modernRegionRefresher, &JsonRefresher::overrideActive, this,
             [this](){Daemon::setOverrideActive(QStringLiteral("modern regions list"));});
     connect(&_modernRegionRefresher, &JsonRefresher::overrideFailed, this,
@@ -535,12 +648,16 @@ Daemon::Daemon(QObject* parent)
 
     connect(&_modernRegionMetaRefresher, &JsonRefresher::contentLoaded, this,
             &Daemon::modernRegionsMetaLoaded);
+    connect(&_modernRegionMetaRefresher, &JsonRefresher::validatorsChanged, this,
+            [this](const QJsonObject &validators){_data.modernRegionMetaValidators(validators);});
     connect(&_modernRegionMetaRefresher, &JsonRefresher::overrideActive, this,
             [this](){Daemon::setOverrideActive(QStringLiteral("modern regions meta"));});
     connect(&_modernRegionMetaRefresher, &JsonRefresher::overrideFailed, this,
             [this](){Daemon::setOverrideFailed(QStringLiteral("modern regions meta"));});
     connect(&_shadowsocksRefresher, &JsonRefresher::contentLoaded, this,
             &Daemon::shadowsocksRegionsLoaded);
+    connect(&_shadowsocksRefresher, &JsonRefresher::validatorsChanged, this,
+            [this](const QJsonObject &validators){_data.cachedModernShadowsocksValidators(validators);});
     connect(&_shadowsocksRefresher, &JsonRefresher::overrideActive, this,
             [this](){Daemon::setOverrideActive(QStringLiteral("shadowsocks list"));});
     connect(&_shadowsocksRefresher, &JsonRefresher::overrideFailed, this,
@@ -549,6 +666,10 @@ Daemon::Daemon(QObject* parent)
             &Daemon::publicIpLoaded);
 
     connect(this, &Daemon::daemonActivated, this, [this]() {
+        // If a client activated the daemon before finishStartup() ran, the
+        // cached locations are needed now (auto-connect uses them)
+        loadCachedLocations();
+
         // Reset override states since we are (re)activating
         _state.overridesFailed({});
         _state.overridesActive({});
@@ -564,17 +685,20 @@ Daemon::Daemon(QObject* parent)
                                                Path::ModernRegionOverride,
                                                Path::ModernRegionBundle,
                                                _environment.getRegionsListPublicKey(),
-                                               QJsonDocument{_data.cachedModernRegionsList()});
+                                               QJsonDocument{_data.cachedModernRegionsList()},
+                                               _data.cachedModernRegionsValidators());
         _modernRegionMetaRefresher.startOrOverride(environment().getModernRegionsListApi(),
                                                Path::ModernRegionMetaOverride,
                                                Path::ModernRegionMetaBundle,
                                                _environment.getRegionsListPublicKey(),
-                                               QJsonDocument{_data.modernRegionMeta()});
+                                               QJsonDocument{_data.modernRegionMeta()},
+                                               _data.modernRegionMetaValidators());
         _shadowsocksRefresher.startOrOverride(environment().getModernRegionsListApi(),
                                               Path::ModernShadowsocksOverride,
                                               Path::ModernShadowsocksBundle,
                                               _environment.getRegionsListPublicKey(),
-                                              QJsonDocument{_data.cachedModernShadowsocksList()});
+                                              QJsonDocument{_data.cachedModernShadowsocksList()},
+                                              _data.cachedModernShadowsocksValidators());
         updatePublicIpRefresher(_connection->state());
         _updateDownloader.run(true, _environment.getUpdateApi());
 
@@ -604,7 +728,16 @@ Daemon::Daemon(QObject* parent)
         updatePublicIpRefresher(_connection->state());
         _state.externalIp({});
     });
-    connect(&_settings, &DaemonSettings::killswitchChanged, this, &Daemon::queueApplyFirewallRules);
+    // Turning on the killswitch is applied right away rather than on the next
+    // event loop iteration, so there's no window where it's on but not
+    // enforced.  Other changes are coalesced with queueApplyFirewallRules().
+    connect(&_settings, &DaemonSettings::killswitchChanged, this, [this]()
+    {
+        if(_settings.killswitch() == QLatin1String("on"))
+            applyFirewallRulesNow();
+        else
+            queueApplyFirewallRules();
+    });
     connect(&_settings, &DaemonSettings::allowLANChanged, this, &Daemon::queueApplyFirewallRules);
     connect(&_settings, &DaemonSettings::overrideDNSChanged, this, &Daemon::queueApplyFirewallRules);
     connect(&_settings, &DaemonSettings::bypassSubnetsChanged, this, &Daemon::queueApplyFirewallRules);
@@ -642,6 +775,21 @@ Daemon::Daemon(QObject* parent)
                 _updateDownloader.enableBetaChannel(_settings.offerBetaUpdates(), _environment.getUpdateApi());
             });
 
+    connect(&_settings, &DaemonSettings::metricsPortChanged, this,
+            [this]()
+            {
+                _metricsServer.listen(static_cast<quint16>(_settings.metricsPort()));
+            });
+    connect(&_apiClient, &ApiClient::requestFinished, this,
+            [this](const ApiBase *pApiBase, std::chrono::microseconds duration,
+                   bool succeeded)
+            {
+                _metrics.observe(QStringLiteral("api_request_seconds"),
+                    {{QStringLiteral("api"), apiBaseMetricName(pApiBase)},
+                     {QStringLiteral("result"), succeeded ? QStringLiteral("success") : QStringLiteral("failure")}},
+                    duration);
+            });
+
     connect(&_settings, &DaemonSettings::enableBackgroundLatencyChecksChanged, this,
             [this]()
             {
@@ -662,6 +810,7 @@ Daemon::Daemon(QObject* parent)
     _updateDownloader.setGaUpdateChannel(_settings.updateChannel(), _environment.getUpdateApi());
     _updateDownloader.setBetaUpdateChannel(_settings.betaUpdateChannel(), _environment.getUpdateApi());
     _updateDownloader.enableBetaChannel(_settings.offerBetaUpdates(), _environment.getUpdateApi());
+    _metricsServer.listen(static_cast<quint16>(_settings.metricsPort()));
     _updateDownloader.reloadAvailableUpdates(Update{_data.gaChannelVersionUri(), _data.gaChannelVersion(),
                                                     _data.gaChannelOsRequired()},
                                              Update{_data.betaChannelVersionUri(), _data.betaChannelVersion(),
@@ -705,7 +854,10 @@ Daemon::Daemon(QObject* parent)
     {
         connect(_pNetworkMonitor.get(), &NetworkMonitor::networksChanged, this,
                 &Daemon::onNetworksChanged);
-        onNetworksChanged(_pNetworkMonitor->getNetworks());
+        // Apply the initial state completely
+        NetworkChanges initialChanges = NetworkChanges::diff({}, _pNetworkMonitor->getNetworks());
+        initialChanges.defaultChanged = true;
+        onNetworksChanged(_pNetworkMonitor->getNetworks(), initialChanges);
 
         connect(_pNetworkMonitor.get(), &NetworkMonitor::networksChanged,
                 &_automation, &Automation::setNetworks);
@@ -736,6 +888,7 @@ Daemon::Daemon(QObject* parent)
 
 Daemon::~Daemon()
 {
+    ApiNetwork::instance()->useNetworkThread(nullptr);
     qInfo() << "Daemon shutdown complete";
 }
 
@@ -832,6 +985,7 @@ void Daemon::RPC_applySettings(const QJsonObject &settings, bool reconnectIfNeed
     // Otherwise, If the settings affect the location choices, recompute them.
     // Port forwarding and method affect the "best" location selection.
     else if(settings.contains(QLatin1String("location")) ||
+       settings.contains(QLatin1String("autoLocationMode")) ||
        settings.contains(QLatin1String("proxyShadowsocksLocation")) ||
        settings.contains(QLatin1String("portForward")) ||
        settings.contains(QLatin1String("method")))
@@ -932,9 +1086,8 @@ void Daemon::RPC_resetSettings()
 
 QString Daemon::RPC_getCountryBestRegion(const QString &country)
 {
-    NearestLocations nearest{_state.availableLocations()};
     const auto &countryLower = country.toLower();
-    const auto &pBestInCountry = nearest.getBestMatchingLocation(
+    const auto &pBestInCountry = _nearestLocations.getBestMatchingLocation(
         [&](const Location &loc)
         {
             auto pRegionDisplay = _state.regionsMetadata().getRegionDisplay(loc.id().toStdString());
@@ -948,6 +1101,19 @@ QString Daemon::RPC_getCountryBestRegion(const QString &country)
     throw Error{HERE, Error::Code::JsonRPCInvalidRequest};
 }
 
+QJsonArray Daemon::RPC_getThroughputHistory(int resolution, qint64 since)
+{
+    QJsonArray samples;
+    if(!_connection->throughputHistory().queryJson(std::chrono::seconds{resolution},
+                                                   since, samples))
+    {
+        qWarning() << "Throughput history resolution" << resolution
+            << "is not available";
+        throw Error{HERE, Error::Code::JsonRPCInvalidRequest};
+    }
+    return samples;
+}
+
 Async<void> Daemon::RPC_addDedicatedIp(const QString &token)
 {
     return _apiClient.postRetry(*_environment.getApiv2(), QStringLiteral("dedicated_ip"),
@@ -1096,8 +1262,12 @@ void Daemon::RPC_stopSnooze()
     _snoozeTimer.stopSnooze();
 }
 
+const std::chrono::milliseconds DiagnosticsFile::CommandTimeout{5000};
+const std::chrono::seconds DiagnosticsFile::CommandTimeBudget{60};
+
 DiagnosticsFile::DiagnosticsFile(const QString &filePath)
-    : _diagFile{filePath}, _currentSize{0}
+    : _diagFile{filePath}, _currentSize{0}, _runningCommands{0},
+      _commandBudget{CommandTimeBudget}
 {
     if(!_diagFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
     {
@@ -1109,6 +1279,11 @@ DiagnosticsFile::DiagnosticsFile(const QString &filePath)
     _fileWriter.setDevice(&_diagFile);
 }
 
+DiagnosticsFile::~DiagnosticsFile()
+{
+    finish();
+}
+
 QString DiagnosticsFile::diagnosticsCommandHeader(const QString &commandName)
 {
     return QStringLiteral("\n/PIA_PART/%1\n").arg(commandName);
@@ -1125,19 +1300,36 @@ void DiagnosticsFile::logPart(const QString &title, QElapsedTimer &commandTime)
         << partSize << "bytes";
 }
 
-void DiagnosticsFile::execAndWriteOutput(QProcess &cmd, const QString &commandName,
-                                         const ProcessOutputFunction &processOutput)
+void DiagnosticsFile::startCommand(std::unique_ptr<QProcess> pCmd,
+                                   const QString &commandName,
+                                   const ProcessOutputFunction &processOutput)
 {
-    QElapsedTimer commandTime;
-    commandTime.start();
-
-    _fileWriter << diagnosticsCommandHeader(commandName);
+    PendingPart part;
+    part.title = commandName;
+    part.partTime.start();
+    part.processOutput = processOutput;
+    part.pCmd = std::move(pCmd);
+    part.pCmd->start();
+    _pendingParts.push_back(std::move(part));
+    ++_runningCommands;
+
+    // If too many commands are running, write parts (in order) until enough of
+    // them have finished
+    while(_runningCommands > MaxRunningCommands)
+        writeNextPart();
+}
 
-    cmd.start();
-    // Only wait 5 seconds for each process.  Occasionally some commands might
-    // time out, but it's confusing for users if this takes a long time due to
-    // the current lack of feedback that we're preparing the report.
-    if(cmd.waitForFinished(5000))
+void DiagnosticsFile::writeCommandOutput(QProcess &cmd,
+                                         const ProcessOutputFunction &processOutput)
+{
+    // Only wait 5 seconds for each process, and don't exceed the overall
+    // budget.  Occasionally some commands might time out, but it's confusing
+    // for users if this takes a long time due to the current lack of feedback
+    // that we're preparing the report.
+    std::chrono::milliseconds waitTime{_commandBudget.remainingTime()};
+    if(waitTime > CommandTimeout)
+        waitTime = CommandTimeout;
+    if(cmd.waitForFinished(msec32(waitTime)))
     {
         _fileWriter << "Exit code: " << cmd.exitCode() << Qt::endl;
         _fileWriter << "STDOUT: " << Qt::endl;
@@ -1149,11 +1341,36 @@ void DiagnosticsFile::execAndWriteOutput(QProcess &cmd, const QString &commandNa
     else
     {
         _fileWriter << "Failed to run command: " << cmd.program() << Qt::endl;
+        if(_commandBudget.hasExpired())
+            _fileWriter << "Diagnostics time budget exceeded" << Qt::endl;
         _fileWriter << qEnumToString(cmd.error()) << Qt::endl;
         _fileWriter << cmd.errorString() << Qt::endl;
+        cmd.kill();
     }
+}
+
+void DiagnosticsFile::writeNextPart()
+{
+    Q_ASSERT(!_pendingParts.empty());  // Ensured by callers
+    PendingPart part{std::move(_pendingParts.front())};
+    _pendingParts.pop_front();
 
-    logPart(commandName, commandTime);
+    _fileWriter << diagnosticsCommandHeader(part.title);
+    if(part.pCmd)
+    {
+        --_runningCommands;
+        writeCommandOutput(*part.pCmd, part.processOutput);
+    }
+    else
+        _fileWriter << part.text << Qt::endl;
+
+    logPart(part.title, part.partTime);
+}
+
+void DiagnosticsFile::finish()
+{
+    while(!_pendingParts.empty())
+        writeNextPart();
 }
 
 void DiagnosticsFile::writeCommand(const QString &commandName,
@@ -1161,7 +1378,8 @@ void DiagnosticsFile::writeCommand(const QString &commandName,
                                    const QStringList &args,
                                    const ProcessOutputFunction &processOutput)
 {
-    UidGidProcess cmd;
+    auto pCmd = std::make_unique<UidGidProcess>();
+    UidGidProcess &cmd = *pCmd;
     cmd.setArguments(args);
     cmd.setProgram(command);
     // Drop the "piavpn" group for diagnostic processes on Linux/Mac - there are
@@ -1173,7 +1391,7 @@ void DiagnosticsFile::writeCommand(const QString &commandName,
 #elif defined(Q_OS_LINUX)
     cmd.setGroup(QStringLiteral("root"));
 #endif
-    execAndWriteOutput(cmd, commandName, processOutput);
+    startCommand(std::move(pCmd), commandName, processOutput);
 }
 
 void DiagnosticsFile::writeCommandIf(bool predicate,
@@ -1194,10 +1412,10 @@ void DiagnosticsFile::writeCommand(const QString &commandName,
                                    const QString &nativeArgs,
                                    const ProcessOutputFunction &processOutput)
 {
-    QProcess cmd;
-    cmd.setNativeArguments(nativeArgs);
-    cmd.setProgram(command);
-    execAndWriteOutput(cmd, commandName, processOutput);
+    auto pCmd = std::make_unique<QProcess>();
+    pCmd->setNativeArguments(nativeArgs);
+    pCmd->setProgram(command);
+    startCommand(std::move(pCmd), commandName, processOutput);
 }
 
 void DiagnosticsFile::writeCommandIf(bool predicate,
@@ -1213,16 +1431,18 @@ void DiagnosticsFile::writeCommandIf(bool predicate,
 
 void DiagnosticsFile::writeText(const QString &title, QString text)
 {
-    QElapsedTimer commandTime;
-    commandTime.start();
-
-    _fileWriter << diagnosticsCommandHeader(title);
-    _fileWriter << Logger::redactText(std::move(text)) << Qt::endl;
-
-    // Only the size is really important for logging a text part, but log the
-    // time too for consistency (the time to generate the text isn't included,
-    // but it can be calculated from the log timestamps)
-    logPart(title, commandTime);
+    PendingPart part;
+    part.title = title;
+    part.partTime.start();
+    part.text = Logger::redactText(std::move(text));
+    _pendingParts.push_back(std::move(part));
+
+    // Write this now unless it's waiting for earlier commands.  Only the size
+    // is really important for logging a text part, but the time is logged too
+    // for consistency (the time to generate the text isn't included, but it
+    // can be calculated from the log timestamps)
+    if(_pendingParts.size() == 1)
+        writeNextPart();
 }
 
 QJsonValue Daemon::RPC_writeDiagnostics()
@@ -1274,11 +1494,62 @@ QJsonValue Daemon::RPC_writeDiagnostics()
     // credentials.
     writePrettyJson("DaemonSettings", _settings.toJsonObject(), { "proxyCustom" });
 
+    file.writeText("Settings persistence", _settingsPersistence.diagnostics());
+    writePrettyJson("Memory usage", memoryUsage());
+    writePrettyJson("Power policy", _powerPolicy.diagnostics());
+    writePrettyJson("Wakeup accounting", wakeupAccountingJson());
+
+    // Include the last profile taken with the sampling profiler, if any.  (If
+    // it's still running, it's not included until it's stopped.)
+    if(!_profiler.lastProfilePath().isEmpty())
+    {
+        QFile profileFile{_profiler.lastProfilePath()};
+        if(profileFile.open(QIODevice::ReadOnly))
+        {
+            file.writeText(QStringLiteral("Sampling profile (%1)").arg(_profiler.lastProfilePath()),
+                           QString::fromUtf8(profileFile.readAll()));
+        }
+    }
+
+    file.finish();
     qInfo() << "Finished writing diagnostics file" << diagFilePath;
 
     return QJsonValue{diagFilePath};
 }
 
+QJsonObject Daemon::RPC_getMemoryUsage()
+{
+    return memoryUsage();
+}
+
+QJsonObject Daemon::RPC_getPowerPolicy()
+{
+    return _powerPolicy.diagnostics();
+}
+
+QJsonObject Daemon::RPC_getWakeupAccounting()
+{
+    return wakeupAccountingJson();
+}
+
+void Daemon::RPC_startProfiler(qint64 intervalMs)
+{
+    if(!_settings.debugLogging())
+    {
+        qInfo() << "Not starting profiler, logging is not enabled";
+        throw Error{HERE, Error::Code::DaemonRPCDiagnosticsNotEnabled};
+    }
+    _profiler.start(std::chrono::milliseconds{intervalMs});
+}
+
+QJsonValue Daemon::RPC_stopProfiler()
+{
+    QString profilePath = _profiler.stop();
+    if(profilePath.isEmpty())
+        return QJsonValue::Null;
+    return profilePath;
+}
+
 QString Daemon::diagnosticsOverview() const
 {
     auto boolToString = [](bool b) { return b == true ? QStringLiteral("true") : QStringLiteral("false"); };
@@ -1413,6 +1684,41 @@ void Daemon::RPC_notifyClientActivate()
         emit daemonActivated();
 }
 
+void Daemon::RPC_negotiateDataEncoding(const QJsonObject &capabilities)
+{
+    ClientConnection *pClient = ClientConnection::getInvokingClient();
+
+    if(!pClient)
+    {
+        qWarning() << "Invalid invoking client in client RPC";
+        return;
+    }
+
+    bool cbor = capabilities.value(QStringLiteral("cbor")).toBool();
+    bool deltas = capabilities.value(QStringLiteral("deltas")).toBool();
+    qInfo() << "Client" << pClient << "negotiated data encoding - CBOR:" << cbor
+        << "- deltas:" << deltas;
+    pClient->setDataEncoding(cbor, deltas);
+
+    if(pClient->getSnapshotPending())
+        sendSnapshot(pClient, capabilities.value(QStringLiteral("resumeVersion")).toString());
+}
+
+void Daemon::RPC_subscribeProperties(const QJsonObject &subscriptions)
+{
+    ClientConnection *pClient = ClientConnection::getInvokingClient();
+
+    if(!pClient)
+    {
+        qWarning() << "Invalid invoking client in client RPC";
+        return;
+    }
+
+    qInfo() << "Client" << pClient << "subscribed to properties:"
+        << QJsonDocument{subscriptions}.toJson(QJsonDocument::Compact);
+    pClient->setSubscriptions(subscriptions);
+}
+
 void Daemon::RPC_notifyClientDeactivate()
 {
     mustBeAwake(); // If this runs, the system must be awake
@@ -1448,6 +1754,38 @@ void Daemon::RPC_notifyClientDeactivate()
         emit daemonDeactivated();
 }
 
+void Daemon::RPC_notifyClientVisible(bool visible)
+{
+    ClientConnection *pClient = ClientConnection::getInvokingClient();
+
+    if(!pClient)
+    {
+        qWarning() << "Invalid invoking client in client RPC";
+        return;
+    }
+
+    qInfo() << "Client" << pClient << "dashboard visible:" << visible;
+    pClient->setDashboardVisible(visible);
+    updateDashboardVisible();
+}
+
+void Daemon::updateDashboardVisible()
+{
+    bool visible = std::any_of(_clients.begin(), _clients.end(),
+        [](const ClientConnection *pClient){return pClient->getDashboardVisible();});
+    _powerPolicy.setDashboardVisible(visible);
+}
+
+void Daemon::applyPowerPolicy()
+{
+    int scale = _powerPolicy.scale(PowerPolicy::Work::Background);
+    _modernRegionRefresher.setIntervalScale(scale);
+    _modernRegionMetaRefresher.setIntervalScale(scale);
+    _shadowsocksRefresher.setIntervalScale(scale);
+    _publicIpRefresher.setIntervalScale(scale);
+    _modernLatencyTracker.setIntervalScale(scale);
+}
+
 Async<void> Daemon::RPC_emailLogin(const QString &email)
 {
     mustBeAwake(); // If this runs, the system must be awake
@@ -1714,7 +2052,9 @@ void Daemon::handleSleepWakeTransitions()
         {
             qInfo() << "VPN will disconnect for sleep";
             _settings.connectOnWake(true);
-            _connection->disconnectVPN();
+            // A WireGuard connection keeps its interface so it can be resumed
+            // quickly after wake
+            _connection->disconnectForSleep();
         }
     }
     else
@@ -1738,6 +2078,12 @@ void Daemon::handleSleepWakeTransitions()
                 qWarning() << "Already connected when waking, will remove connect on wake flag. This should not happen";
             }
         }
+        else if(_connection->state() == VPNConnection::State::Disconnected)
+        {
+            // Not reconnecting (or the connection after wake has ended); tear
+            // down an interface kept to resume after sleep, if there is one
+            _connection->discardResume();
+        }
         // Else: We are not sleeping and we did not just wake up, do nothing.
         // This should be the most common case from connection state changes
     }
@@ -1748,9 +2094,8 @@ void Daemon::start()
     // Perform any startup actions such as listening on sockets and setting
     // up timers here, then emit started().
 
-    _server = new LocalSocketIPCServer(this);
+    _server = new ThreadedLocalSocketIPCServer(this);
     connect(_server, &IPCServer::newConnection, this, &Daemon::clientConnected);
-    connect(_rpc, &RemoteNotificationInterface::messageReady, _server, &IPCServer::sendMessageToAllClients);
     _server->listen();
 
     connect(&_account, &DaemonAccount::loggedInChanged, this, [this]() {
@@ -1764,14 +2109,41 @@ void Daemon::start()
         _accountRefreshTimer.start();
         refreshAccountInfo();
     }
-    traceMemory();
 
+    qInfo() << "Startup: listening for clients -" << _startupTime.elapsed() << "ms";
     qInfo() << "Daemon started and waiting for connections...";
 
+    // Do the rest once the event loop is running
+    queueNotification(&Daemon::finishStartup);
+
     _started = true;
     emit started();
 }
 
+void Daemon::loadCachedLocations()
+{
+    if(_cachedLocationsLoaded)
+        return;
+    _cachedLocationsLoaded = true;
+
+    // Load locations from the cached data, if there is any.  Don't start
+    // fetching yet or check for region overrides / bundled region lists; that
+    // is done when the daemon activates.
+    //
+    // The daemon doesn't really need the built locations until it activates,
+    // but piactl exposes them and user scripts might be using this.
+    loadRegionsImage();
+    rebuildActiveLocations();
+    qInfo() << "Startup: loaded cached locations -" << _startupTime.elapsed() << "ms";
+}
+
+void Daemon::finishStartup()
+{
+    loadCachedLocations();
+    traceMemory();
+    qInfo() << "Startup: finished -" << _startupTime.elapsed() << "ms";
+}
+
 void Daemon::stop()
 {
     if (!_started)
@@ -1789,6 +2161,10 @@ void Daemon::stop()
         return;
     }
 
+    // Don't leave any work deferred for the connection transition
+    _connectionTransitionTime.invalidate();
+    runDeferredWork();
+
     qInfo() << "Daemon cleanly stopped";
 
     _started = false;
@@ -1797,7 +2173,7 @@ void Daemon::stop()
 
 void Daemon::clientConnected(IPCConnection* connection)
 {
-    auto client = new ClientConnection(connection, _methodRegistry, this);
+    auto client = new ClientConnection(connection, _methodRegistry, _rpcParseThread, this);
     _clients.insert(connection, client);
     qInfo() << "New client" << client << "connected, total client count now"
         << _clients.size() << "- have active client:" << hasActiveClient();
@@ -1807,6 +2183,7 @@ void Daemon::clientConnected(IPCConnection* connection)
         _clients.remove(connection);
         qInfo() << "Client" << client << "disconnected, total client count now"
             << _clients.size() << "- have active client:" << hasActiveClient();
+        updateDashboardVisible();
 
         // If the client was active, this exit is unexpected.  Either the daemon
         // was killing the connection due to lack of response, or we assume the
@@ -1839,24 +2216,123 @@ void Daemon::clientConnected(IPCConnection* connection)
         }
     });
 
+    // Wait for the client to negotiate the data encoding before sending the
+    // snapshot - it may be able to resume from a prior connection.  Older
+    // clients that don't negotiate get the full snapshot when they send any
+    // other request, or after a short timeout.
+    client->setSnapshotPending(true);
+    connect(client, &ClientConnection::requestReceived, this,
+        [this, client](const QString &method)
+        {
+            if(client->getSnapshotPending() &&
+               method != QStringLiteral("negotiateDataEncoding") &&
+               method != QStringLiteral("subscribeProperties"))
+            {
+                sendSnapshot(client, {});
+            }
+        });
+    QTimer::singleShot(msec(snapshotNegotiationTimeout), client, [this, client]()
+    {
+        if(client->getSnapshotPending())
+        {
+            qInfo() << "Client" << client << "did not negotiate, sending full snapshot";
+            sendSnapshot(client, {});
+        }
+    });
+}
+
+QString Daemon::dataVersionToken() const
+{
+    return QStringLiteral("%1:%2").arg(_dataInstance).arg(_dataVersion);
+}
+
+QJsonObject Daemon::getSnapshotGroup(const QString &group)
+{
+    auto itCached = _snapshotCache.find(group);
+    if(itCached != _snapshotCache.end())
+        return itCached.value();
+
+    QJsonObject snapshot;
+    if(group == QStringLiteral("data"))
+        snapshot = _data.toJsonObject();
+    else if(group == QStringLiteral("account"))
+    {
+        snapshot = _account.toJsonObject();
+        for(const auto &sensitiveProp : DaemonAccount::sensitiveProperties())
+            snapshot.remove(sensitiveProp);
+    }
+    else if(group == QStringLiteral("settings"))
+        snapshot = _settings.toJsonObject();
+    else if(group == QStringLiteral("state"))
+    {
+        try
+        {
+            snapshot = adaptNljToQt(_state.getJsonObject());
+        }
+        catch(const std::exception &ex)
+        {
+            KAPPS_CORE_WARNING() << "Unable to serialize state:" << ex.what();
+            // Don't cache the failed result
+            return {};
+        }
+    }
+    _snapshotCache.insert(group, snapshot);
+    return snapshot;
+}
+
+void Daemon::sendSnapshot(ClientConnection *pClient, const QString &resumeVersion)
+{
+    // Flush any pending changes to the other clients first, so the snapshot
+    // matches the delta baselines.  Otherwise, a later delta could be computed
+    // from an older baseline than what this client has.  (This client doesn't
+    // receive this push, its snapshot is still pending.)
+    if(cancelNotification(&Daemon::notifyChanges))
+        notifyChanges();
+    pClient->setSnapshotPending(false);
+
+    // A token is only valid for this daemon run, and can't be from the future
+    bool resume = false;
+    quint64 resumeFrom = 0;
+    const auto &tokenParts = resumeVersion.split(':');
+    if(tokenParts.size() == 2 && tokenParts[0] == _dataInstance)
+    {
+        resumeFrom = tokenParts[1].toULongLong(&resume);
+        resume = resume && resumeFrom <= _dataVersion;
+    }
+
     QJsonObject all;
-    all.insert(QStringLiteral("data"), _data.toJsonObject());
-    QJsonObject accountJsonObj = _account.toJsonObject();
-    for(const auto &sensitiveProp : DaemonAccount::sensitiveProperties())
-        accountJsonObj.remove(sensitiveProp);
-    all.insert(QStringLiteral("account"), std::move(accountJsonObj));
-    all.insert(QStringLiteral("settings"), _settings.toJsonObject());
-    QJsonObject stateJson;
-    try
+    for(const auto &group : {QStringLiteral("data"), QStringLiteral("account"),
+                             QStringLiteral("settings"), QStringLiteral("state")})
     {
-        stateJson = adaptNljToQt(_state.getJsonObject());
+        QJsonObject groupSnapshot = getSnapshotGroup(group);
+        if(resume)
+        {
+            for(auto itProp = groupSnapshot.begin(); itProp != groupSnapshot.end(); )
+            {
+                if(_propertyVersions.value(group + '.' + itProp.key(), 0) > resumeFrom)
+                    ++itProp;
+                else
+                    itProp = groupSnapshot.erase(itProp);
+            }
+        }
+        all.insert(group, groupSnapshot);
     }
-    catch(const std::exception &ex)
+    all.insert(QStringLiteral("version"), dataVersionToken());
+
+    if(resume)
+    {
+        qInfo() << "Client" << pClient << "resumed from version" << resumeFrom
+            << "of" << _dataVersion;
+    }
+    // Always send the snapshot, even if nothing is left after filtering; the
+    // client waits for it to be connected.
+    if(pClient->hasSubscriptions())
     {
-        KAPPS_CORE_WARNING() << "Unable to serialize state:" << ex.what();
+        QJsonObject filtered = pClient->filterSubscribed(all);
+        filtered.insert(QStringLiteral("version"), dataVersionToken());
+        all = std::move(filtered);
     }
-    all.insert(QStringLiteral("state"), stateJson);
-    client->post(QStringLiteral("data"), all);
+    pClient->post(QStringLiteral("data"), all);
 }
 
 QJsonObject getProperties(const NativeJsonObject& object, const QSet<QString>& properties)
@@ -1899,8 +2375,32 @@ QJsonObject getProperties(const JsonState<clientjson::json> &object,
     return {};
 }
 
+void Daemon::queueChangeNotification(bool batched)
+{
+    unsigned batchInterval = _settings.notificationBatchInterval();
+    if(batched && batchInterval > 0)
+    {
+        // If a notification is already queued, this change will go out with
+        // it.  Otherwise, start the batch timer if it's not already running.
+        if(!isNotificationQueued(&Daemon::notifyChanges) &&
+            !_notificationBatchTimer.isActive())
+        {
+            _notificationBatchTimer.start(static_cast<int>(batchInterval));
+        }
+    }
+    else
+        queueNotification(&Daemon::notifyChanges);
+}
+
 void Daemon::notifyChanges()
 {
+    // Everything batched so far is sent now
+    _notificationBatchTimer.stop();
+
+    auto start = std::chrono::steady_clock::now();
+    RAII_SENTINEL(_metrics.observe(QStringLiteral("notify_changes_seconds"), {},
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)));
+
     QJsonObject all;
     if (!_dataChanges.empty())
     {
@@ -1928,7 +2428,157 @@ void Daemon::notifyChanges()
         all.insert(QStringLiteral("state"), getProperties(_state, std::exchange(_stateChanges, {})));
     }
     serialize();
-    _rpc->post(QStringLiteral("data"), all);
+
+    if(all.isEmpty())
+        return;
+
+    // Update the property versions and patch the cached snapshots
+    ++_dataVersion;
+    for(auto itGroup = all.begin(); itGroup != all.end(); ++itGroup)
+    {
+        const auto &groupProps = itGroup.value().toObject();
+        auto itCached = _snapshotCache.find(itGroup.key());
+        for(auto itProp = groupProps.begin(); itProp != groupProps.end(); ++itProp)
+        {
+            _propertyVersions.insert(itGroup.key() + '.' + itProp.key(), _dataVersion);
+            if(itCached != _snapshotCache.end())
+                itCached.value().insert(itProp.key(), itProp.value());
+        }
+    }
+    all.insert(QStringLiteral("version"), dataVersionToken());
+
+    if(_stateMirror.isValid() && !_stateMirrorTimer.isActive() &&
+       (all.contains(QStringLiteral("state")) || all.contains(QStringLiteral("settings"))))
+    {
+        _stateMirrorTimer.start();
+    }
+
+    pushDataChanges(all);
+}
+
+void Daemon::publishStateMirror()
+{
+    if(deferForConnection())
+    {
+        _stateMirrorDeferred = true;
+        return;
+    }
+
+    // The snapshot groups are cached and kept up to date by notifyChanges(),
+    // so this just has to encode them
+    QCborMap snapshot;
+    snapshot.insert(QStringLiteral("state"), QCborValue::fromJsonValue(getSnapshotGroup(QStringLiteral("state"))));
+    snapshot.insert(QStringLiteral("settings"), QCborValue::fromJsonValue(getSnapshotGroup(QStringLiteral("settings"))));
+    snapshot.insert(QStringLiteral("version"), dataVersionToken());
+    _stateMirror.publish(QCborValue{std::move(snapshot)}.toCbor());
+}
+
+namespace
+{
+    // Properties that are large and typically change only partially - these
+    // are sent as deltas to clients that support them.  Other properties are
+    // small enough that it's not worth tracking baselines.
+    const std::initializer_list<std::pair<QString, QStringList>> deltaProperties
+    {
+        {QStringLiteral("data"), {
+            QStringLiteral("modernLatencies"),
+            QStringLiteral("cachedModernRegionsList"),
+            QStringLiteral("cachedModernShadowsocksList"),
+            QStringLiteral("modernRegionMeta"),
+        }},
+        {QStringLiteral("state"), {
+            QStringLiteral("vpnLocations"),
+            QStringLiteral("shadowsocksLocations"),
+            QStringLiteral("availableLocations"),
+            QStringLiteral("regionsMetadata"),
+            QStringLiteral("groupedLocations"),
+            QStringLiteral("dedicatedIpLocations"),
+            QStringLiteral("intervalMeasurements"),
+            QStringLiteral("latencyStatistics"),
+        }},
+    };
+}
+
+void Daemon::pushDataChanges(const QJsonObject &all)
+{
+    bool anyDeltaClients = std::any_of(_clients.begin(), _clients.end(),
+        [](const ClientConnection *pClient){return pClient->getDeltaData();});
+
+    // Build the delta form of this push.  Baselines are updated even if no
+    // clients are using deltas right now, since a client could negotiate
+    // deltas later.
+    QJsonObject allWithDeltas{all};
+    QJsonObject deltas;
+    for(const auto &group : deltaProperties)
+    {
+        auto itGroup = allWithDeltas.find(group.first);
+        if(itGroup == allWithDeltas.end())
+            continue;
+        QJsonObject groupProps = itGroup.value().toObject();
+        QJsonObject groupDeltas;
+        for(const auto &name : group.second)
+        {
+            auto itProp = groupProps.find(name);
+            if(itProp == groupProps.end())
+                continue;
+            QJsonValue &baseline = _deltaBaselines[group.first + '.' + name];
+            if(anyDeltaClients && !baseline.isUndefined())
+            {
+                QJsonValue delta = jsonDiff(baseline, itProp.value());
+                // If the value didn't actually change, delta clients don't
+                // need it at all
+                if(!delta.isUndefined())
+                    groupDeltas.insert(name, delta);
+                baseline = itProp.value();
+                groupProps.erase(itProp);
+            }
+            else
+                baseline = itProp.value();
+        }
+        if(!groupDeltas.isEmpty())
+            deltas.insert(group.first, groupDeltas);
+        // Keep the group even if it's now empty, the client uses it to find
+        // the deltas for that group
+        itGroup.value() = groupProps;
+    }
+    allWithDeltas.insert(QStringLiteral("deltas"), deltas);
+
+    // Serialize each form only once, no matter how many clients there are.
+    // Indexed by [cbor][deltas]
+    QByteArray messages[2][2];
+    for(ClientConnection *pClient : _clients)
+    {
+        // Clients waiting for a snapshot will get these changes in the
+        // snapshot
+        if(pClient->getSnapshotPending())
+            continue;
+        bool cbor = pClient->getCborData();
+        bool useDeltas = pClient->getDeltaData();
+        // Subscribed clients get their own message, and nothing at all if
+        // none of their properties changed
+        if(pClient->hasSubscriptions())
+        {
+            QJsonObject filtered = pClient->filterSubscribed(all);
+            if(filtered.isEmpty() || pClient->holdDataIfLagging(filtered))
+                continue;
+            if(useDeltas)
+                filtered = pClient->filterSubscribed(allWithDeltas);
+            pClient->sendSerialized(buildJsonRPCNotification(QStringLiteral("data"),
+                {filtered}, cbor ? JsonRPCEncoding::Cbor : JsonRPCEncoding::Json),
+                cbor);
+            continue;
+        }
+        if(pClient->holdDataIfLagging(all))
+            continue;
+        QByteArray &msg = messages[cbor][useDeltas];
+        if(msg.isEmpty())
+        {
+            msg = buildJsonRPCNotification(QStringLiteral("data"),
+                {useDeltas ? allWithDeltas : all},
+                cbor ? JsonRPCEncoding::Cbor : JsonRPCEncoding::Json);
+        }
+        pClient->sendSerialized(msg, cbor);
+    }
 }
 
 void Daemon::serialize()
@@ -1937,15 +2587,32 @@ void Daemon::serialize()
     {
         if (!_serializationTimer.isActive())
         {
+            // Building the QJsonObjects can take a while with large cached
+            // regions lists, don't hold up a connection transition for it
+            if (deferForConnection())
+            {
+                _serializationDeferred = true;
+                return;
+            }
+
+            // The files are serialized and written on the persistence
+            // thread; only the QJsonObjects are built here.
             if (_pendingSerializations & 1)
-                writeProperties(_data.toJsonObject(), Path::DaemonSettingsDir, "data.json");
+            {
+                _settingsPersistence.queueWrite(_data.toJsonObject(), Path::DaemonSettingsDir,
+                                                QStringLiteral("data.json"));
+            }
             if (_pendingSerializations & 2)
-                writeProperties(_account.toJsonObject(), Path::DaemonSettingsDir, "account.json");
+            {
+                _settingsPersistence.queueWrite(_account.toJsonObject(), Path::DaemonSettingsDir,
+                                                QStringLiteral("account.json"));
+            }
             if (_pendingSerializations & 4)
             {
                 QJsonObject settings = _settings.toJsonObject();
                 settings.remove(QStringLiteral("debugLogging"));
-                writeProperties(settings, Path::DaemonSettingsDir, "settings.json");
+                _settingsPersistence.queueWrite(std::move(settings), Path::DaemonSettingsDir,
+                                                QStringLiteral("settings.json"));
             }
             _pendingSerializations = 0;
             _serializationTimer.start(5000);
@@ -1953,6 +2620,29 @@ void Daemon::serialize()
     }
 }
 
+bool Daemon::deferForConnection()
+{
+    if(!_connectionTransitionTime.isValid())
+        return false;
+
+    std::chrono::milliseconds remaining{msec(maxConnectionDeferral) - _connectionTransitionTime.elapsed()};
+    if(remaining <= std::chrono::milliseconds::zero())
+        return false;
+
+    if(!_connectionDeferralTimer.isActive())
+        _connectionDeferralTimer.start(msec32(remaining));
+    return true;
+}
+
+void Daemon::runDeferredWork()
+{
+    _connectionDeferralTimer.stop();
+    if(std::exchange(_serializationDeferred, false))
+        serialize();
+    if(std::exchange(_stateMirrorDeferred, false))
+        publishStateMirror();
+}
+
 struct IpResult
 {
     QString address;    // VPN IP address
@@ -2169,6 +2859,26 @@ void Daemon::vpnStateChanged(VPNConnection::State state,
     if (!_connection->needsReconnect())
         _state.needsReconnect(false);
     _state.connectionState(qEnumToString(state));
+    _powerPolicy.setConnected(state == VPNConnection::State::Connected);
+    // Postpone deferrable work while connecting, reconnecting, etc.; run it
+    // as soon as the connection settles
+    if(state == VPNConnection::State::Connected ||
+       state == VPNConnection::State::Disconnected)
+    {
+        if(_connectionTransitionTime.isValid())
+        {
+            _connectionTransitionTime.invalidate();
+            runDeferredWork();
+        }
+    }
+    else if(!_connectionTransitionTime.isValid())
+        _connectionTransitionTime.start();
+    // The WireGuard stats gauges only apply while connected
+    if(state != VPNConnection::State::Connected)
+    {
+        _metrics.clear(QStringLiteral("tunnel_rate_bytes_per_second"));
+        _metrics.clear(QStringLiteral("wireguard_handshake_age_seconds"));
+    }
     _state.chosenTransport(chosenTransport);
     _state.actualTransport(actualTransport);
 
@@ -2239,6 +2949,10 @@ void Daemon::vpnStateChanged(VPNConnection::State state,
         else
             _portForwarder.updateConnectionState(PortForwarder::State::ConnectedUnsupported);
 
+        // Remember the last automatic location for the next cold start
+        if(connectedConfig.vpnLocationAuto())
+            _data.lastConnectedLocation(connectedConfig.vpnLocation()->id());
+
         // Perform a refresh immediately after connect so we get a new IP on reconnect.
         _modernRegionRefresher.refresh();
         _shadowsocksRefresher.refresh();
@@ -2395,6 +3109,16 @@ void Daemon::newLatencyMeasurements(const LatencyTracker::Latencies &measurement
     rebuildActiveLocations();
 }
 
+void Daemon::latencyStatisticsChanged()
+{
+    _state.latencyStatistics(_modernLatencyTracker.statistics());
+
+    // New measurements rebuild the locations, which recalculates the
+    // preferences anyway, but lost pings only change the statistics.
+    if(_settings.autoLocationMode() == QLatin1String("quality"))
+        calculateLocationPreferences();
+}
+
 void Daemon::portForwardUpdated(int port)
 {
     qInfo() << "Forwarded port updated to" << port;
@@ -2412,30 +3136,83 @@ void Daemon::applyBuiltLocations(LocationsById newLocations,
     // - favorites/recents for geo locations are ignored
     // - piactl does not display or accept them
     // - the regions lists (both VPN and Shadowsocks) do not display them
-    LocationsById nonGeoLocations;
     if(!_settings.includeGeoOnly())
     {
+        LocationsById nonGeoLocations;
         nonGeoLocations.reserve(newLocations.size());
         for(const auto &locEntry : newLocations)
         {
             if(locEntry.second && !locEntry.second->geoLocated())
                 nonGeoLocations[locEntry.first] = locEntry.second;
         }
-        _state.availableLocations(std::move(nonGeoLocations));
+        newLocations = std::move(nonGeoLocations);
     }
-    else
+
+    // Most refreshes (and all latency updates) change only a few regions, if
+    // any.  The builder already reused the existing Location objects for
+    // regions that didn't change at all - the location properties hold
+    // Locations by pointer, so this is what lets StateModel see them as
+    // unchanged.  If nothing changed, the location properties (which are
+    // large) aren't rebuilt or sent to clients.
+    //
+    // Lists built on the worker thread used a copy of the locations that might
+    // have been replaced since, so still compare by value here; this is cheap
+    // for the reused Locations since they're the same object.
+    const LocationsById &oldLocations = _state.availableLocations();
+    auto regionsSlice = [](const LocationsById &locations)
+    {
+        std::vector<const kapps::regions::Region*> regions;
+        regions.reserve(locations.size());
+        for(const auto &locEntry : locations)
+        {
+            if(locEntry.second)
+                regions.push_back(&locEntry.second->impl());
+        }
+        return regions;
+    };
+    auto regionsDiff = kapps::regions::diffRegions(regionsSlice(oldLocations),
+                                                   regionsSlice(newLocations));
+    bool locationsChanged = !regionsDiff.empty();
+    for(auto &locEntry : newLocations)
+    {
+        auto itOldLocation = oldLocations.find(locEntry.first);
+        if(itOldLocation != oldLocations.end() &&
+           compareLocationsValue(itOldLocation->second, locEntry.second))
+        {
+            locEntry.second = itOldLocation->second;
+        }
+        else
+            locationsChanged = true;    // New, changed, or latency changed
+    }
+
+    if(!regionsDiff.empty())
+    {
+        qInfo() << "Regions changed:" << regionsDiff.added.size() << "added,"
+            << regionsDiff.removed.size() << "removed,"
+            << regionsDiff.changed.size() << "changed";
+    }
+
+    bool metadataChanged = !(metadata == _state.regionsMetadata());
+    if(locationsChanged)
+    {
         _state.availableLocations(std::move(newLocations));
-    _state.regionsMetadata(std::move(metadata));
+        _nearestLocations = NearestLocations{_state.availableLocations()};
+    }
+    if(metadataChanged)
+        _state.regionsMetadata(std::move(metadata));
 
     // Update the grouped locations from the new stored locations
-    std::vector<CountryLocations> groupedLocations;
-    std::vector<QSharedPointer<const Location>> dedicatedIpLocations;
-    buildGroupedLocations(_state.availableLocations(),
-                          _state.regionsMetadata(),
-                          groupedLocations,
-                          dedicatedIpLocations);
-    _state.groupedLocations(std::move(groupedLocations));
-    _state.dedicatedIpLocations(std::move(dedicatedIpLocations));
+    if(locationsChanged || metadataChanged)
+    {
+        std::vector<CountryLocations> groupedLocations;
+        std::vector<QSharedPointer<const Location>> dedicatedIpLocations;
+        buildGroupedLocations(_state.availableLocations(),
+                              _state.regionsMetadata(),
+                              groupedLocations,
+                              dedicatedIpLocations);
+        _state.groupedLocations(std::move(groupedLocations));
+        _state.dedicatedIpLocations(std::move(dedicatedIpLocations));
+    }
 
     // Find the closest expiration time for any dedicated IP, and find the most
     // recent dedicated IP change
@@ -2513,28 +3290,25 @@ bool Daemon::rebuildModernLocations(const QJsonObject &regionsObj,
 {
     try
     {
+        // Build a new regions image too; if these lists are then cached, the
+        // image is valid for the cached lists
+        QByteArray newImage;
+        QString newImageTag;
         auto newLocations = buildModernLocations(_data.modernLatencies(),
                                                  regionsObj,
                                                  shadowsocksObj,
                                                  metadataObj,
                                                  _account.dedicatedIps(),
-                                                 _settings.manualServer());
+                                                 _settings.manualServer(),
+                                                 &newImage, &newImageTag,
+                                                 &_state.availableLocations());
 
         // Like the legacy list, if no regions are found, treat this as an error
         // and keep the data we have (which might still be usable).
-        if(newLocations.first.empty() ||
-            newLocations.second.countryDisplays().empty() ||
-            newLocations.second.regionDisplays().empty())
-        {
+        if(!applyModernLocations(std::move(newLocations)))
             return false;
-        }
-
-        // Apply the modern locations to the modern latency tracker
-        _modernLatencyTracker.updateLocations(newLocations.first);
-
-        applyBuiltLocations(std::move(newLocations.first),
-                            std::move(newLocations.second));
 
+        storeRegionsImage(std::move(newImage), std::move(newImageTag));
         return true;
     }
     catch(const std::exception &ex)
@@ -2544,74 +3318,220 @@ bool Daemon::rebuildModernLocations(const QJsonObject &regionsObj,
     return false;
 }
 
+bool Daemon::applyModernLocations(std::pair<LocationsById, kapps::regions::Metadata> newLocations)
+{
+    if(newLocations.first.empty() ||
+        newLocations.second.countryDisplays().empty() ||
+        newLocations.second.regionDisplays().empty())
+    {
+        return false;
+    }
+
+    // Apply the modern locations to the modern latency tracker
+    _modernLatencyTracker.updateLocations(newLocations.first);
+
+    applyBuiltLocations(std::move(newLocations.first),
+                        std::move(newLocations.second));
+    return true;
+}
+
+void Daemon::loadRegionsImage()
+{
+    _regionsImageFile.setFileName(Path::DaemonSettingsDir / regionsImageFilename);
+    if(_data.modernRegionsImageTag().isEmpty() ||
+       !_regionsImageFile.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    uchar *pMapped = _regionsImageFile.map(0, _regionsImageFile.size());
+    if(!pMapped)
+    {
+        qWarning() << "Unable to map regions image:" << _regionsImageFile.errorString();
+        _regionsImageFile.close();
+        return;
+    }
+    // The data is used in place from the mapping; the tag is checked when
+    // it's loaded
+    _regionsImage = QByteArray::fromRawData(reinterpret_cast<const char*>(pMapped),
+                                            static_cast<int>(_regionsImageFile.size()));
+    qInfo() << "Mapped regions image," << _regionsImage.size() << "bytes";
+}
+
+void Daemon::storeRegionsImage(QByteArray image, QString imageTag)
+{
+    if(imageTag == _data.modernRegionsImageTag() && !_regionsImage.isEmpty())
+        return; // Same lists, the existing image is still valid
+
+    // Release the old mapping first - the file can't be replaced on Windows
+    // while it's mapped
+    _regionsImage = std::move(image);
+    _regionsImageFile.close();
+    _data.modernRegionsImageTag(std::move(imageTag));
+    _settingsPersistence.queueWrite(_regionsImage, Path::DaemonSettingsDir,
+                                    regionsImageFilename);
+}
+
 void Daemon::rebuildActiveLocations()
 {
+    // Use the regions image if we have one, which avoids parsing the lists
+    // again.  This happens for every latency update, as well as at startup.
+    if(!_regionsImage.isEmpty())
+    {
+        try
+        {
+            auto newLocations = buildModernLocationsFromImage(_data.modernLatencies(),
+                                                              _regionsImage,
+                                                              _data.modernRegionsImageTag(),
+                                                              _account.dedicatedIps(),
+                                                              _settings.manualServer(),
+                                                              &_state.availableLocations());
+            if(applyModernLocations(std::move(newLocations)))
+                return;
+        }
+        catch(const std::exception &ex)
+        {
+            qWarning() << "Unable to load regions image:" << ex.what();
+        }
+        // Discard the image, rebuilding below will create a new one
+        _regionsImage.clear();
+        _regionsImageFile.close();
+    }
+
     rebuildModernLocations(_data.cachedModernRegionsList(),
                            _data.cachedModernShadowsocksList(),
                            _data.modernRegionMeta());
 }
 
-void Daemon::shadowsocksRegionsLoaded(const QJsonDocument &shadowsocksRegionsJsonDoc)
+void Daemon::buildLoadedRegionsList(RegionsList list, QJsonDocument content)
 {
-    const auto &shadowsocksRegionsObj = shadowsocksRegionsJsonDoc.array();
+    // Build with the new content and the other cached lists.  The inputs are
+    // copied for the worker; only the result is applied on this thread.
+    QJsonObject regionsObj = list == RegionsList::Regions ?
+        content.object() : _data.cachedModernRegionsList();
+    QJsonArray shadowsocksObj = list == RegionsList::Shadowsocks ?
+        content.array() : _data.cachedModernShadowsocksList();
+    QJsonObject metadataObj = list == RegionsList::Metadata ?
+        content.object() : _data.modernRegionMeta();
+
+    auto pBuilt = std::make_shared<BuiltRegionsList>();
+    _regionsListBuilder.queueOnThread(
+        [this, list, content = std::move(content), pBuilt,
+         generation = _regionsListGeneration,
+         regionsObj = std::move(regionsObj),
+         shadowsocksObj = std::move(shadowsocksObj),
+         metadataObj = std::move(metadataObj),
+         latencies = _data.modernLatencies(),
+         dedicatedIps = _account.dedicatedIps(),
+         manualServer = _settings.manualServer(),
+         previousLocations = _state.availableLocations()]()
+        {
+            try
+            {
+                pBuilt->locations = buildModernLocations(latencies, regionsObj,
+                                                         shadowsocksObj,
+                                                         metadataObj,
+                                                         dedicatedIps,
+                                                         manualServer,
+                                                         &pBuilt->image,
+                                                         &pBuilt->imageTag,
+                                                         &previousLocations);
+                pBuilt->valid = true;
+            }
+            catch(const std::exception &ex)
+            {
+                qWarning() << "Unable to build locations:" << ex.what();
+            }
+            // The worker is destroyed (and waits for this) before the rest of
+            // Daemon, so 'this' is still valid.
+            QMetaObject::invokeMethod(this,
+                [this, list, content, pBuilt, generation]()
+                {
+                    regionsListBuilt(list, content, generation,
+                                     std::move(*pBuilt));
+                }, Qt::QueuedConnection);
+        });
+}
 
-    // It's unlikely that the Shadowsocks regions list could totally hose us,
-    // but the same resiliency is here for robustness.
-    if(!rebuildModernLocations(_data.cachedModernRegionsList(), shadowsocksRegionsObj, _data.modernRegionMeta()))
+void Daemon::regionsListBuilt(RegionsList list, const QJsonDocument &content,
+                              quint64 generation, BuiltRegionsList built)
+{
+    // If another list was cached while this was being built, it was built
+    // with an outdated list; build it again
+    if(generation != _regionsListGeneration)
     {
-        qWarning() << "Shadowsocks location data could not be loaded.  Received"
-            << shadowsocksRegionsJsonDoc;
-        // Don't update cachedModernShadowsocksList, keep the last content
-        // (which might still be usable, the new content is no good).
-        // Don't treat this as a successful load (don't notify JsonRefresher)
+        buildLoadedRegionsList(list, content);
         return;
     }
 
-    _data.cachedModernShadowsocksList(shadowsocksRegionsObj);
-    _shadowsocksRefresher.loadSucceeded();
-}
-
-void Daemon::modernRegionsLoaded(const QJsonDocument &modernRegionsJsonDoc)
-{
-    const auto &modernRegionsObj = modernRegionsJsonDoc.object();
+    JsonRefresher *pRefresher{};
+    const char *listName{};
+    switch(list)
+    {
+        default:
+        case RegionsList::Regions:
+            pRefresher = &_modernRegionRefresher;
+            listName = "Modern location data";
+            break;
+        case RegionsList::Shadowsocks:
+            pRefresher = &_shadowsocksRefresher;
+            listName = "Shadowsocks location data";
+            break;
+        case RegionsList::Metadata:
+            pRefresher = &_modernRegionMetaRefresher;
+            listName = "Modern region metadata";
+            break;
+    }
 
     // If this results in an empty list, don't cache the unusable data.  This
     // would totally hose the client and more likely indicates a problem in the
     // servers list - keep whatever content we had before even though it's
     // older.
-    if(!rebuildModernLocations(modernRegionsObj, _data.cachedModernShadowsocksList(), _data.modernRegionMeta()))
+    //
+    // Currently, since some metadata are still incorporated into the Locations
+    // models, it's possible (but unlikely) that the metadata or Shadowsocks
+    // list could hose the regions list too, the same resiliency applies to
+    // them.
+    if(!built.valid || !applyModernLocations(std::move(built.locations)))
     {
-        qWarning() << "Modern location data could not be loaded.  Received"
-            << modernRegionsJsonDoc;
+        qWarning() << listName << "could not be loaded.  Received" << content;
         // Don't update the cache - keep the existing data, which might still be
-        // usable.  Don't treat this as a successful load.
+        // usable.  Don't treat this as a successful load (don't notify
+        // JsonRefresher).
         return;
     }
 
-    _data.cachedModernRegionsList(modernRegionsObj);
-    _modernRegionRefresher.loadSucceeded();
+    storeRegionsImage(std::move(built.image), std::move(built.imageTag));
+    switch(list)
+    {
+        default:
+        case RegionsList::Regions:
+            _data.cachedModernRegionsList(content.object());
+            break;
+        case RegionsList::Shadowsocks:
+            _data.cachedModernShadowsocksList(content.array());
+            break;
+        case RegionsList::Metadata:
+            _data.modernRegionMeta(content.object());
+            break;
+    }
+    ++_regionsListGeneration;
+    pRefresher->loadSucceeded();
 }
 
-void Daemon::modernRegionsMetaLoaded(const QJsonDocument &modernRegionsMetaJsonDoc)
+void Daemon::shadowsocksRegionsLoaded(const QJsonDocument &shadowsocksRegionsJsonDoc)
 {
-    const auto &modernRegionsMetaObj = modernRegionsMetaJsonDoc.object();
+    buildLoadedRegionsList(RegionsList::Shadowsocks, shadowsocksRegionsJsonDoc);
+}
 
-    // Currently, since some metadata are still incorporated into the Locations
-    // models, it's possible (but unlikely) that the metadata could hose the
-    // regions list.  Once the client has fully moved metadata references to the
-    // new metadata objects, we should be able to stop putting metadata into the
-    // Location objects and remove this.
-    if(!rebuildModernLocations(_data.cachedModernRegionsList(), _data.cachedModernShadowsocksList(), modernRegionsMetaObj))
-    {
-        qWarning() << "Modern region metadata could not be loaded.  Received"
-            << modernRegionsMetaJsonDoc;
-        // Don't update the cache - keep the existing data, which might still be
-        // usable.  Don't treat this as a successful load.
-        return;
-    }
+void Daemon::modernRegionsLoaded(const QJsonDocument &modernRegionsJsonDoc)
+{
+    buildLoadedRegionsList(RegionsList::Regions, modernRegionsJsonDoc);
+}
 
-    _data.modernRegionMeta(modernRegionsMetaObj);
-    _modernRegionMetaRefresher.loadSucceeded();
+void Daemon::modernRegionsMetaLoaded(const QJsonDocument &modernRegionsMetaJsonDoc)
+{
+    buildLoadedRegionsList(RegionsList::Metadata, modernRegionsMetaJsonDoc);
 }
 
 void Daemon::publicIpLoaded(const QJsonDocument &publicIpDoc)
@@ -2641,7 +3561,8 @@ void Daemon::forcePublicIpRefresh ()
      _publicIpRefresher.refresh();
 }
 
-void Daemon::onNetworksChanged(const std::vector<NetworkConnection> &networks)
+void Daemon::onNetworksChanged(const std::vector<NetworkConnection> &networks,
+                               const NetworkChanges &changes)
 {
     OriginalNetworkScan defaultConnection;
     qInfo() << "Networks changed: currently" << networks.size() << "networks";
@@ -2653,6 +3574,10 @@ void Daemon::onNetworksChanged(const std::vector<NetworkConnection> &networks)
     // networks
     std::vector<AutomationRuleCondition> wifiNetworkConditions;
 
+    // Identity of the default network for latency profiles - the Wi-Fi SSID if
+    // there is one, otherwise the gateway address.
+    QString networkIdentity;
+
     int netIdx=0;
     for(const auto &network : networks)
     {
@@ -2706,6 +3631,15 @@ void Daemon::onNetworksChanged(const std::vector<NetworkConnection> &networks)
 #ifdef Q_OS_MACOS
             macosPrimaryServiceKey = network.macosPrimaryServiceKey();
 #endif
+
+            // The tunnel isn't a network for latency profiles
+            if(network.networkInterface() != _state.tunnelDeviceName())
+            {
+                if(!network.wifiSsid().isEmpty())
+                    networkIdentity = QStringLiteral("ssid:") + network.wifiSsid();
+                else if(network.gatewayIpv4() != kapps::core::Ipv4Address{})
+                    networkIdentity = QStringLiteral("gw4:") + QString::fromStdString(network.gatewayIpv4().toString());
+            }
         }
         if(network.defaultIpv6())
         {
@@ -2729,6 +3663,17 @@ void Daemon::onNetworksChanged(const std::vector<NetworkConnection> &networks)
         ++netIdx;
     }
 
+    _state.automationCurrentNetworks(std::move(wifiNetworkConditions));
+
+    // Everything else is derived from the default connections.  Other
+    // connections come and go (or change addresses, etc.) frequently on some
+    // systems, don't reapply the firewall, etc. for those.
+    if(!changes.defaultChanged)
+    {
+        qInfo() << "Default network has not changed";
+        return;
+    }
+
     _state.originalGatewayIp(QString::fromStdString(defaultConnection.gatewayIp()));
     _state.originalInterface(QString::fromStdString(defaultConnection.interfaceName()));
     _state.originalInterfaceNetPrefix(defaultConnection.prefixLength());
@@ -2741,7 +3686,12 @@ void Daemon::onNetworksChanged(const std::vector<NetworkConnection> &networks)
     // Relevant only to macOS
     _state.macosPrimaryServiceKey(macosPrimaryServiceKey);
 
-    _state.automationCurrentNetworks(std::move(wifiNetworkConditions));
+    // The identity is hashed so SSIDs aren't stored in the daemon data
+    if(!networkIdentity.isEmpty())
+    {
+        applyLatencyProfile(QString::fromLatin1(QCryptographicHash::hash(networkIdentity.toUtf8(),
+                                                                         QCryptographicHash::Sha256).toHex()));
+    }
 
     // Emit this here so it'll run callbacks before firewall rules update
     emit networksChanged();
@@ -2750,6 +3700,73 @@ void Daemon::onNetworksChanged(const std::vector<NetworkConnection> &networks)
     _connection->updateNetwork(originalNetwork());
 }
 
+void Daemon::applyLatencyProfile(const QString &networkId)
+{
+    // Nothing to do if the latencies are already for this network
+    if(networkId == _data.modernLatenciesNetwork())
+        return;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QJsonObject profiles = _data.modernLatencyProfiles();
+
+    // Store the current latencies for the network they were measured on
+    if(!_data.modernLatenciesNetwork().isEmpty() && !_data.modernLatencies().empty())
+    {
+        QJsonObject latenciesJson;
+        for(const auto &latency : _data.modernLatencies())
+            latenciesJson.insert(latency.first, latency.second);
+        profiles.insert(_data.modernLatenciesNetwork(),
+                        QJsonObject{{QStringLiteral("timestamp"), now},
+                                    {QStringLiteral("latencies"), latenciesJson}});
+    }
+
+    // Discard profiles that are too old, then the oldest ones past the limit
+    std::vector<std::pair<qint64, QString>> profileTimestamps;
+    auto itProfile = profiles.begin();
+    while(itProfile != profiles.end())
+    {
+        qint64 timestamp = itProfile.value().toObject().value(QStringLiteral("timestamp")).toInteger();
+        if(now - timestamp > msec(latencyProfileMaxAge))
+            itProfile = profiles.erase(itProfile);
+        else
+        {
+            profileTimestamps.push_back({timestamp, itProfile.key()});
+            ++itProfile;
+        }
+    }
+    if(profileTimestamps.size() > latencyProfileLimit)
+    {
+        std::sort(profileTimestamps.begin(), profileTimestamps.end());
+        for(std::size_t i = 0; i < profileTimestamps.size() - latencyProfileLimit; ++i)
+            profiles.remove(profileTimestamps[i].second);
+    }
+
+    // Restore the latencies for the new network if it's known.  Otherwise,
+    // keep the current latencies until new measurements replace them.
+    const auto &profileLatencies = profiles.value(networkId).toObject().value(QStringLiteral("latencies")).toObject();
+    bool restored{!profileLatencies.isEmpty()};
+    if(restored)
+    {
+        qInfo() << "Restoring" << profileLatencies.size()
+            << "latencies cached for this network";
+        LatencyMap latencies;
+        latencies.reserve(profileLatencies.size());
+        for(auto itLatency = profileLatencies.begin(); itLatency != profileLatencies.end(); ++itLatency)
+            latencies.emplace(itLatency.key(), itLatency.value().toDouble());
+        _data.modernLatencies(std::move(latencies));
+    }
+    else
+        qInfo() << "No latencies cached for this network";
+
+    _data.modernLatencyProfiles(std::move(profiles));
+    _data.modernLatenciesNetwork(networkId);
+
+    // Measure everything again on the new network
+    _modernLatencyTracker.resetMeasurements();
+    if(restored)
+        rebuildActiveLocations();
+}
+
 void Daemon::refreshAccountInfo()
 {
     qInfo() << "Refreshing account info";
@@ -2914,7 +3931,8 @@ void Daemon::refreshDedicatedIps()
                 return;
             }
 
-            _dedicatedIpRefreshTimer.setInterval(msec(dipRefreshSlowInterval));
+            _powerPolicy.manage(_dedicatedIpRefreshTimer, dipRefreshSlowInterval,
+                                PowerPolicy::Work::Background);
             auto dedicatedIps = _account.dedicatedIps();
             int priorSize = dedicatedIps.size();
 
@@ -2997,7 +4015,11 @@ Async<QJsonObject> Daemon::loadAccountInfo(const QString& username, const QStrin
 {
     ApiBase &base = token.isEmpty() ? *_environment.getApiv1() : *_environment.getApiv2();
 
-    return _apiClient.getRetry(base, QStringLiteral("account"), ApiClient::autoAuth(username, password, token))
+    // Account info is requested from several places after a network change;
+    // cache it briefly so they share one response.
+    return _apiClient.getRetry(base, QStringLiteral("account"),
+                               ApiClient::autoAuth(username, password, token),
+                               std::chrono::seconds{10})
             ->then(this, [=](const QJsonDocument& json) {
                 if (!json.isObject())
                     throw Error(HERE, Error::ApiBadResponseError);
@@ -3187,8 +4209,16 @@ void Daemon::reapplyFirewallRules()
             << "dnsServers:" << (connectionSettings ? connectionSettings->getDnsServers() : QStringList{});
 
     bool killswitchEnabled = params.leakProtectionEnabled;
+    bool isConnected = params.isConnected;
+    auto applyStart = std::chrono::steady_clock::now();
     applyFirewallRules(std::move(params));
+    _metrics.observe(QStringLiteral("firewall_apply_seconds"), {},
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - applyStart));
     _state.killswitchEnabled(killswitchEnabled);
+
+    // The rules applied once connected complete the connection timeline
+    if(isConnected)
+        _connection->recordPhase(QStringLiteral("firewallApplied"));
 }
 
 void Daemon::updatePortForwarder()
@@ -3236,6 +4266,9 @@ void Daemon::updateNextConfig()
 {
     ConnectionConfig connection{_settings, _state, _account};
     _state.nextConfig(populateConnection(connection));
+    // Keep the plan for the next connection up to date too
+    if(_connection)
+        _connection->updatePlan(connection);
 }
 
 static QString decryptOldPassword(const QString& bytes)
@@ -3448,9 +4481,39 @@ void Daemon::upgradeSettings(bool existingSettingsFile)
 void Daemon::calculateLocationPreferences()
 {
     // Pick the best location
-    NearestLocations nearest{_state.availableLocations()};
-
-    QSharedPointer<const Location> pVpnBest{nearest.getNearestSafeVpnLocation(_settings.portForward())};
+    QSharedPointer<const Location> pVpnBest;
+    if(_settings.autoLocationMode() == QLatin1String("quality"))
+    {
+        const auto &statistics = _state.latencyStatistics();
+        pVpnBest = _nearestLocations.getBestScoringVpnLocation(_settings.portForward(),
+            [&statistics](const Location &location)
+            {
+                auto itStatistics = statistics.find(location.id().toStdString());
+                if(itStatistics != statistics.end())
+                    return itStatistics->second.qualityScore();
+                // No statistics yet; these are ranked after all measured
+                // locations
+                return std::numeric_limits<double>::max();
+            });
+    }
+    else
+        pVpnBest = _nearestLocations.getNearestSafeVpnLocation(_settings.portForward());
+
+    // If nothing has been measured yet, the best location is just the first
+    // unmeasured one.  Prefer the last location we connected to instead, so a
+    // connection at boot can start right away with a server that's known to
+    // work rather than an arbitrary one.  (Latencies are measured once we
+    // disconnect, and the next connection uses them.)
+    if(pVpnBest && !pVpnBest->latency() && !_data.lastConnectedLocation().isEmpty())
+    {
+        auto itLastLocation = _state.availableLocations().find(_data.lastConnectedLocation().toStdString());
+        if(itLastLocation != _state.availableLocations().end() &&
+           !itLastLocation->second->offline() &&
+           (!_settings.portForward() || itLastLocation->second->portForward()))
+        {
+            pVpnBest = itLastLocation->second;
+        }
+    }
 
     // Find the user's chosen location (nullptr if it's 'auto' or doesn't exist)
     const auto &locationId = _settings.location();
@@ -3492,8 +4555,7 @@ void Daemon::calculateLocationPreferences()
         else
         {
             // If no SS locations are known, this is set to nullptr
-            pSsBest = nearest.getBestMatchingLocation(
-                [](auto loc){ return loc.hasService(Service::Shadowsocks); });
+            pSsBest = _nearestLocations.getBestLocationForService(Service::Shadowsocks);
         }
 
         // Determine the next SS location
@@ -3891,9 +4953,110 @@ void logProcessMemoryWindows(const QString &id, DWORD pid) {
 }
 #endif
 
+QJsonObject Daemon::memoryUsage() const
+{
+    QJsonObject regions{
+        {QStringLiteral("imageBytes"), _regionsImage.size()},
+        {QStringLiteral("availableLocations"), static_cast<qint64>(_state.availableLocations().size())},
+        {QStringLiteral("groupedCountries"), static_cast<qint64>(_state.groupedLocations().size())},
+        {QStringLiteral("dedicatedIpLocations"), static_cast<qint64>(_state.dedicatedIpLocations().size())},
+        {QStringLiteral("regionDisplays"), static_cast<qint64>(_state.regionsMetadata().regionDisplays().size())},
+        {QStringLiteral("modernLatencies"), static_cast<qint64>(_data.modernLatencies().size())}
+    };
+
+    QJsonObject latency{
+        {QStringLiteral("trackedLocations"), static_cast<qint64>(_modernLatencyTracker.locationCount())},
+        {QStringLiteral("storedMeasurements"), _modernLatencyTracker.storedMeasurements()},
+        {QStringLiteral("statistics"), static_cast<qint64>(_state.latencyStatistics().size())}
+    };
+
+    QJsonArray clients;
+    for(const auto *pClient : _clients)
+        clients.push_back(pClient->memoryUsage());
+
+    QJsonObject notifications{
+        {QStringLiteral("snapshotCacheGroups"), _snapshotCache.size()},
+        {QStringLiteral("propertyVersions"), _propertyVersions.size()}
+    };
+
+    QJsonObject usage{
+        {QStringLiteral("regions"), regions},
+        {QStringLiteral("latency"), latency},
+        {QStringLiteral("clients"), clients},
+        {QStringLiteral("notifications"), notifications},
+        {QStringLiteral("asyncTasks"), BaseTask::getTaskCount()}
+    };
+    if(g_logger)
+        usage.insert(QStringLiteral("queuedLogBytes"), static_cast<qint64>(g_logger->queuedLogBytes()));
+    return usage;
+}
+
+QString Daemon::apiBaseMetricName(const ApiBase *pApiBase)
+{
+    const std::pair<const ApiBase *, const char *> knownApis[]
+    {
+        {_environment.getApiv1().get(), "apiv1"},
+        {_environment.getApiv2().get(), "apiv2"},
+        {_environment.getModernRegionsListApi().get(), "regions"},
+        {_environment.getIpAddrApi().get(), "ipaddr"},
+        {_environment.getIpProxyApi().get(), "ipproxy"},
+        {_environment.getUpdateApi().get(), "update"},
+    };
+    for(const auto &knownApi : knownApis)
+    {
+        if(knownApi.first == pApiBase)
+            return QString::fromLatin1(knownApi.second);
+    }
+    return QStringLiteral("other");
+}
+
+void Daemon::collectMetrics()
+{
+    const QString direction{QStringLiteral("direction")};
+    const QString received{QStringLiteral("received")};
+    const QString sent{QStringLiteral("sent")};
+
+    // Rebuild the client series so disconnected clients are removed
+    _metrics.clear(QStringLiteral("ipc_messages"));
+    _metrics.clear(QStringLiteral("ipc_bytes"));
+    for(const ClientConnection *pClient : _clients)
+    {
+        QString id = QString::number(pClient->id());
+        _metrics.set(QStringLiteral("ipc_messages"), {{QStringLiteral("client"), id}, {direction, received}},
+                     static_cast<double>(pClient->messagesReceived()));
+        _metrics.set(QStringLiteral("ipc_messages"), {{QStringLiteral("client"), id}, {direction, sent}},
+                     static_cast<double>(pClient->messagesSent()));
+        _metrics.set(QStringLiteral("ipc_bytes"), {{QStringLiteral("client"), id}, {direction, received}},
+                     static_cast<double>(pClient->bytesReceived()));
+        _metrics.set(QStringLiteral("ipc_bytes"), {{QStringLiteral("client"), id}, {direction, sent}},
+                     static_cast<double>(pClient->bytesSent()));
+    }
+
+    const auto &probes = _modernLatencyTracker.probeCounts();
+    _metrics.set(QStringLiteral("latency_probes"), {{QStringLiteral("result"), sent}},
+                 static_cast<double>(probes.sent));
+    _metrics.set(QStringLiteral("latency_probes"), {{QStringLiteral("result"), QStringLiteral("replied")}},
+                 static_cast<double>(probes.replied));
+    _metrics.set(QStringLiteral("latency_probes"), {{QStringLiteral("result"), QStringLiteral("lost")}},
+                 static_cast<double>(probes.lost));
+
+    // Same counts as VPNConnection::updateByteCounts() reports in the state
+    _metrics.set(QStringLiteral("tunnel_bytes"), {{direction, received}},
+                 static_cast<double>(_connection->bytesReceived()));
+    _metrics.set(QStringLiteral("tunnel_bytes"), {{direction, sent}},
+                 static_cast<double>(_connection->bytesSent()));
+
+    _metrics.set(QStringLiteral("log_queue_bytes"), {},
+                 static_cast<double>(g_logger->queuedLogBytes()));
+}
+
 void Daemon::traceMemory()
 {
     qDebug () << "Tracing memory";
+    qInfo() << "Daemon memory usage:"
+        << QJsonDocument{memoryUsage()}.toJson(QJsonDocument::Compact);
+    qInfo() << "Power policy:"
+        << QJsonDocument{_powerPolicy.diagnostics()}.toJson(QJsonDocument::Compact);
 #ifdef Q_OS_MACOS
     logProcessMemoryUnix(QStringLiteral("client"), QStringLiteral(BRAND_NAME));
     logProcessMemoryUnix(QStringLiteral("daemon"), QStringLiteral(BRAND_CODE "-daemon"));
@@ -3941,13 +5104,26 @@ void Daemon::traceMemory()
 #endif
 }
 
-ClientConnection::ClientConnection(IPCConnection *connection, LocalMethodRegistry* registry, QObject *parent)
+ClientConnection::ClientConnection(IPCConnection *connection, LocalMethodRegistry* registry,
+                                   JsonRPCParseThread &parseThread, QObject *parent)
     : QObject(parent)
+    , _id(_nextId++)
     , _connection(connection)
     , _rpc(new ServerSideInterface(registry, this))
+    , _pParseQueue(new JsonRPCParseQueue(parseThread, this))
     , _active(false)
     , _killed(false)
     , _state(Connected)
+    , _cborData(false)
+    , _deltaData(false)
+    , _lagging(false)
+    , _snapshotPending(false)
+    , _subscribed(false)
+    , _dashboardVisible(false)
+    , _messagesReceived(0)
+    , _bytesReceived(0)
+    , _messagesSent(0)
+    , _bytesSent(0)
 {
     auto setDisconnected = [this]() {
         if (_state < Disconnected)
@@ -3959,21 +5135,192 @@ ClientConnection::ClientConnection(IPCConnection *connection, LocalMethodRegistr
     };
     connect(_connection, &IPCConnection::disconnected, this, setDisconnected);
     connect(_connection, &IPCConnection::destroyed, this, setDisconnected);
+    // Rather than killing a lagging client (which would then reconnect and
+    // need the entire state again), hold state updates until it catches up.
     connect(_connection, &IPCConnection::remoteLagging, this, [this]
     {
-        qWarning() << "Killing connection" << this << "due to unacknowledged messages";
-        kill();
+        if(!_lagging)
+        {
+            qWarning() << "Client" << this << "is lagging, holding state updates";
+            _lagging = true;
+        }
+    });
+    connect(_connection, &IPCConnection::remoteCaughtUp, this, [this]
+    {
+        _lagging = false;
+        flushHeldData();
     });
 
-    connect(_connection, &IPCConnection::messageReceived, [this](const QByteArray & msg) {
-      ClientConnection::_invokingClient = this;
+    connect(_connection, &IPCConnection::messageReceived, this, [this](const QByteArray & msg) {
       qInfo() << "Received message from client" << this;
-      auto cleanup = raii_sentinel([]{_invokingClient = nullptr;});
-      _rpc->processMessage(msg);
+      ++_messagesReceived;
+      _bytesReceived += static_cast<quint64>(msg.size());
+      _pParseQueue->parseMessage(msg);
     });
-    connect(_rpc, &ServerSideInterface::messageReady, _connection, &IPCConnection::sendMessage);
+    connect(_pParseQueue, &JsonRPCParseQueue::requestParsed, this,
+            &ClientConnection::processRequest);
+    connect(_pParseQueue, &JsonRPCParseQueue::parseError, _rpc,
+            &ServerSideInterface::processParseError);
+    connect(_rpc, &ServerSideInterface::messageReady, this,
+            [this](const QByteArray &msg){sendMessage(msg, false);});
 }
 ClientConnection* ClientConnection::_invokingClient = nullptr;
+quint64 ClientConnection::_nextId = 0;
+
+void ClientConnection::sendSerialized(const QByteArray &msg, bool binary)
+{
+    if(!_connection || !_connection->isConnected())
+        return;
+    sendMessage(msg, binary);
+}
+
+void ClientConnection::sendMessage(const QByteArray &msg, bool binary)
+{
+    if(!_connection)
+        return;
+    ++_messagesSent;
+    _bytesSent += static_cast<quint64>(msg.size());
+    if(binary)
+        _connection->sendBinaryMessage(msg);
+    else
+        _connection->sendMessage(msg);
+}
+
+void ClientConnection::processRequest(const QJsonObject &request)
+{
+    // If the client disconnected while the request was being parsed, ignore
+    // it, as we would have if it had been received after disconnecting
+    if(!_connection)
+        return;
+    emit requestReceived(request.value(QStringLiteral("method")).toString());
+    ClientConnection::_invokingClient = this;
+    auto cleanup = raii_sentinel([]{_invokingClient = nullptr;});
+    _rpc->processRequest(request);
+}
+
+bool ClientConnection::holdDataIfLagging(const QJsonObject &all)
+{
+    if(!_lagging)
+        return false;
+
+    // Later values replace earlier ones for the same property
+    for(auto itGroup = all.begin(); itGroup != all.end(); ++itGroup)
+    {
+        // Non-group values, like the version token, are just replaced
+        if(!itGroup.value().isObject())
+        {
+            _heldData.insert(itGroup.key(), itGroup.value());
+            continue;
+        }
+        QJsonObject heldGroup = _heldData.value(itGroup.key()).toObject();
+        const auto &groupProps = itGroup.value().toObject();
+        for(auto itProp = groupProps.begin(); itProp != groupProps.end(); ++itProp)
+            heldGroup.insert(itProp.key(), itProp.value());
+        _heldData.insert(itGroup.key(), heldGroup);
+    }
+    return true;
+}
+
+void ClientConnection::setSubscriptions(const QJsonObject &subscriptions)
+{
+    _subscriptions.clear();
+    for(auto itGroup = subscriptions.begin(); itGroup != subscriptions.end(); ++itGroup)
+    {
+        GroupSubscription groupSub{};
+        QJsonArray names;
+        if(itGroup.value().isBool())
+        {
+            if(!itGroup.value().toBool())
+                continue;
+            // true - exclude nothing
+            groupSub.exclude = true;
+        }
+        else if(itGroup.value().isArray())
+            names = itGroup.value().toArray();
+        else if(itGroup.value().isObject())
+        {
+            groupSub.exclude = true;
+            names = itGroup.value().toObject().value(QStringLiteral("exclude")).toArray();
+        }
+        else
+        {
+            qWarning() << "Ignoring invalid subscription for group" << itGroup.key();
+            continue;
+        }
+        for(const auto &name : names)
+            groupSub.properties.insert(name.toString());
+        _subscriptions.insert(itGroup.key(), std::move(groupSub));
+    }
+    _subscribed = true;
+}
+
+QJsonObject ClientConnection::filterGroup(const QString &group, const QJsonObject &props) const
+{
+    auto itSub = _subscriptions.find(group);
+    if(itSub == _subscriptions.end())
+        return {};
+    QJsonObject filtered;
+    for(auto itProp = props.begin(); itProp != props.end(); ++itProp)
+    {
+        if(itSub->includes(itProp.key()))
+            filtered.insert(itProp.key(), itProp.value());
+    }
+    return filtered;
+}
+
+QJsonObject ClientConnection::filterSubscribed(const QJsonObject &all) const
+{
+    QJsonObject filtered;
+    QJsonObject filteredDeltas;
+    const auto &deltas = all.value(QStringLiteral("deltas")).toObject();
+    for(auto itDeltaGroup = deltas.begin(); itDeltaGroup != deltas.end(); ++itDeltaGroup)
+    {
+        QJsonObject groupDeltas = filterGroup(itDeltaGroup.key(), itDeltaGroup.value().toObject());
+        if(!groupDeltas.isEmpty())
+            filteredDeltas.insert(itDeltaGroup.key(), groupDeltas);
+    }
+
+    bool anyChanges = !filteredDeltas.isEmpty();
+    for(auto itGroup = all.begin(); itGroup != all.end(); ++itGroup)
+    {
+        if(itGroup.key() == QStringLiteral("deltas"))
+            continue;
+        if(!itGroup.value().isObject())
+        {
+            // Not a group, like the version token
+            filtered.insert(itGroup.key(), itGroup.value());
+            continue;
+        }
+        QJsonObject groupProps = filterGroup(itGroup.key(), itGroup.value().toObject());
+        // Keep empty groups that have deltas, the client finds the deltas
+        // through the group
+        if(!groupProps.isEmpty() || filteredDeltas.contains(itGroup.key()))
+        {
+            anyChanges = anyChanges || !groupProps.isEmpty();
+            filtered.insert(itGroup.key(), groupProps);
+        }
+    }
+
+    if(!anyChanges)
+        return {};
+    if(all.contains(QStringLiteral("deltas")))
+        filtered.insert(QStringLiteral("deltas"), filteredDeltas);
+    return filtered;
+}
+
+void ClientConnection::flushHeldData()
+{
+    if(_heldData.isEmpty())
+        return;
+
+    qInfo() << "Client" << this << "caught up, sending held state updates";
+    // The held values are full values, even for a client using deltas.  This
+    // is still consistent with the delta baselines, since each held value is
+    // the latest value pushed for that property.
+    QJsonObject held{std::exchange(_heldData, {})};
+    sendSerialized(buildJsonRPCNotification(QStringLiteral("data"), {held},
+        _cborData ? JsonRPCEncoding::Cbor : JsonRPCEncoding::Json), _cborData);
+}
 
 void ClientConnection::kill()
 {
@@ -3984,6 +5331,15 @@ void ClientConnection::kill()
     }
 }
 
+QJsonObject ClientConnection::memoryUsage() const
+{
+    return {
+        {QStringLiteral("bufferedBytes"), _connection->bufferedBytes()},
+        {QStringLiteral("heldDataGroups"), _heldData.size()},
+        {QStringLiteral("subscribedGroups"), _subscriptions.size()}
+    };
+}
+
 SnoozeTimer::SnoozeTimer(Daemon *daemon) : QObject(nullptr)
 {
     _daemon = daemon;
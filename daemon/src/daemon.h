@@ -25,6 +25,7 @@
 
 #include <common/src/settings/daemonaccount.h>
 #include <common/src/settings/daemondata.h>
+#include <common/src/locations.h>
 #include "model/state.h"
 #include <common/src/settings/daemonsettings.h>
 #include <common/src/async.h>
@@ -33,19 +34,28 @@
 #include "latencytracker.h"
 #include "networkmonitor.h"
 #include "portforwarder.h"
+#include "powerpolicy.h"
+#include "metrics.h"
+#include "samplingprofiler.h"
 #include "socksserverthread.h"
 #include "updatedownloader.h"
 #include "servicequality.h"
+#include "settingspersistence.h"
+#include <common/src/statemirror.h>
+#include <common/src/thread.h>
 #include "vpn.h"
 #include "apiclient.h"
 #include "automation.h"
 #include <kapps_net/src/firewallparams.h>
 
 #include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QFile>
 #include <QHash>
 #include <QSet>
 #include <QTimer>
 #include <QNetworkAccessManager>
+#include <deque>
 
 class IPCConnection;
 class IPCServer;
@@ -63,11 +73,55 @@ public:
     static ClientConnection* getInvokingClient() { return _invokingClient; }
     enum State { Connected, Authenticated, Disconnecting, Disconnected };
 
-    explicit ClientConnection(IPCConnection* connection, LocalMethodRegistry* registry, QObject* parent = nullptr);
+    explicit ClientConnection(IPCConnection* connection, LocalMethodRegistry* registry,
+                              JsonRPCParseThread &parseThread, QObject* parent = nullptr);
 
     template<typename... Args>
     void post(const QString& name, Args&&... args) { _rpc->post(name, std::forward<Args>(args)...); }
 
+    // Send an already-serialized notification.  Set 'binary' for CBOR
+    // messages (only if the client negotiated CBOR).
+    void sendSerialized(const QByteArray &msg, bool binary);
+
+    // The "data" notification encoding negotiated by the client with
+    // RPC_negotiateDataEncoding().  Clients initially receive plain JSON with
+    // full property values.
+    bool getCborData() const {return _cborData;}
+    bool getDeltaData() const {return _deltaData;}
+    void setDataEncoding(bool cbor, bool deltas) {_cborData = cbor; _deltaData = deltas;}
+
+    // While the client is lagging (not acknowledging messages), "data"
+    // notifications are held and collapsed into one pending notification
+    // instead of being queued up in the socket.  Only the latest value of each
+    // property is kept, so this is bounded by the size of the state.  The held
+    // notification is sent once the client catches up.
+    //
+    // If the client is lagging, this merges 'all' (the full form of a "data"
+    // notification) into the held notification and returns true, the caller
+    // must not send it.  Otherwise, returns false.
+    bool holdDataIfLagging(const QJsonObject &all);
+
+    // New clients receive their initial state snapshot once they negotiate the
+    // data encoding (which may include a version token to resume from), or
+    // once they send any other request, or after a short timeout.  No "data"
+    // notifications are sent until then.
+    bool getSnapshotPending() const {return _snapshotPending;}
+    void setSnapshotPending(bool pending) {_snapshotPending = pending;}
+
+    // Clients can subscribe to specific properties with
+    // RPC_subscribeProperties(); otherwise they receive all properties.
+    // The subscription is an object keyed by group ("data", "account", etc.).
+    // Each value is one of:
+    // - true - all properties in the group
+    // - an array of property names - only those properties
+    // - {"exclude": [names]} - all properties except those
+    // Groups that aren't present are not sent at all.
+    void setSubscriptions(const QJsonObject &subscriptions);
+    bool hasSubscriptions() const {return _subscribed;}
+    // Filter a "data" notification (either form) to the subscribed properties.
+    // Returns an empty object if there's nothing left for this client.
+    QJsonObject filterSubscribed(const QJsonObject &all) const;
+
     // Daemon distinguishes between two types of client connections so it knows
     // whether to disconnect the VPN on a client exit, and to handle client
     // crashes.
@@ -96,35 +150,117 @@ public:
 
     bool getKilled() const {return _killed;}
 
+    // Whether the client is currently showing its dashboard, reported with
+    // RPC_notifyClientVisible().  Used by PowerPolicy.
+    bool getDashboardVisible() const {return _dashboardVisible;}
+    void setDashboardVisible(bool visible) {_dashboardVisible = visible;}
+
     void kill();
 
+    // Approximate memory held for this client (see Daemon::memoryUsage())
+    QJsonObject memoryUsage() const;
+
+    // Identifies the client in metrics; assigned in connection order
+    quint64 id() const {return _id;}
+    // IPC messages and bytes exchanged with this client, for metrics
+    quint64 messagesReceived() const {return _messagesReceived;}
+    quint64 bytesReceived() const {return _bytesReceived;}
+    quint64 messagesSent() const {return _messagesSent;}
+    quint64 bytesSent() const {return _bytesSent;}
+
 signals:
     void disconnected();
+    // A request is about to be invoked.
+    void requestReceived(const QString &method);
 
 private:
+    struct GroupSubscription
+    {
+        // If set, 'properties' lists excluded properties, otherwise it lists
+        // the only included properties.
+        bool exclude;
+        QSet<QString> properties;
+        bool includes(const QString &name) const {return properties.contains(name) != exclude;}
+    };
+
+private:
+    QJsonObject filterGroup(const QString &group, const QJsonObject &props) const;
+    void flushHeldData();
+    // Invoke a parsed request from this client
+    void processRequest(const QJsonObject &request);
+    // Send a message to the client, counting it for metrics
+    void sendMessage(const QByteArray &msg, bool binary);
+
+private:
+    static quint64 _nextId;
+    quint64 _id;
     IPCConnection* _connection;
     static ClientConnection *_invokingClient;
     ServerSideInterface* _rpc;
+    // Incoming messages are parsed by the Daemon's shared parse thread when
+    // they're large
+    JsonRPCParseQueue* _pParseQueue;
     bool _active;
     // Whether the client connection is being killed by the server.  If an
     // active client connection unexpectedly exits, this affects the way the
     // daemon remains active (invalidClientExit vs. killedClient)
     bool _killed;
     State _state;
-
+    bool _cborData;
+    bool _deltaData;
+    bool _lagging;
+    bool _snapshotPending;
+    bool _subscribed;
+    bool _dashboardVisible;
+    quint64 _messagesReceived, _bytesReceived, _messagesSent, _bytesSent;
+    QHash<QString, GroupSubscription> _subscriptions;
+    // Held "data" notification (full property values) - see
+    // holdDataIfLagging()
+    QJsonObject _heldData;
 };
 
 // From kapps-net
 Q_DECLARE_METATYPE(kapps::net::FirewallParams)
 
+// DiagnosticsFile writes the parts of a diagnostics file.
+//
+// Commands are run concurrently (up to MaxRunningCommands at once), but parts
+// are always written in the order they were added - a text part added after a
+// command is held until the command's output has been written.  All commands
+// share an overall time budget, so a few hanging commands can't hold up the
+// report for several minutes.
 class DiagnosticsFile
 {
 public:
     // Function type for processing command output for diagnostics.
     using ProcessOutputFunction = std::function<QByteArray(const QByteArray&)>;
 
+private:
+    // Maximum number of commands running at once
+    static const std::size_t MaxRunningCommands{8};
+    // Maximum time to wait for each command once it's the next part to write
+    static const std::chrono::milliseconds CommandTimeout;
+    // Overall time budget for all commands; once it elapses, commands that
+    // haven't finished are killed.
+    static const std::chrono::seconds CommandTimeBudget;
+
+    // A part that hasn't been written yet - either a command, which may still
+    // be running, or text waiting for earlier commands.
+    struct PendingPart
+    {
+        QString title;
+        // The command, or nullptr for a text part
+        std::unique_ptr<QProcess> pCmd;
+        ProcessOutputFunction processOutput;
+        // Text for a text part (already redacted)
+        QString text;
+        // Measures the time from adding the part to writing it
+        QElapsedTimer partTime;
+    };
+
 public:
     DiagnosticsFile(const QString &filePath);
+    ~DiagnosticsFile();
 
 private:
     QString diagnosticsCommandHeader(const QString &commandName);
@@ -133,9 +269,15 @@ private:
     // _currentSize).
     void logPart(const QString &title, QElapsedTimer &commandTime);
 
-    // Execute a QProcess and write the output as a file part
-    void execAndWriteOutput(QProcess &cmd, const QString &commandName,
-                            const ProcessOutputFunction &processOutput);
+    // Start a QProcess; its output is written as a file part once the earlier
+    // parts have been written
+    void startCommand(std::unique_ptr<QProcess> pCmd, const QString &commandName,
+                      const ProcessOutputFunction &processOutput);
+    // Write the output of a command (waits for it to finish, within the
+    // time budget)
+    void writeCommandOutput(QProcess &cmd, const ProcessOutputFunction &processOutput);
+    // Write the first pending part
+    void writeNextPart();
 
 public:
     // Write the result of a command as a file part
@@ -167,10 +309,18 @@ public:
     // Write a text blob as a file part
     void writeText(const QString &title, QString text);
 
+    // Wait for all commands and write the remaining parts.  The destructor
+    // does this too if it hasn't been done.
+    void finish();
+
 private:
     QFile _diagFile;
     QTextStream _fileWriter;
     qint64 _currentSize;
+    std::deque<PendingPart> _pendingParts;
+    // Number of commands in _pendingParts
+    std::size_t _runningCommands;
+    QDeadlineTimer _commandBudget;
 };
 
 class Daemon;
@@ -216,6 +366,10 @@ public:
     DaemonAccount& account() { return _account; }
     DaemonSettings& settings() { return _settings; }
     StateModel& state() { return _state; }
+    // Power policy - scales periodic work on battery power (see PowerPolicy)
+    PowerPolicy &powerPolicy() {return _powerPolicy;}
+    // Performance metrics, served when metricsPort is set (see Metrics)
+    Metrics &metrics() {return _metrics;}
 
     // Get the _state.original* fields as an OriginalNetworkScan
     OriginalNetworkScan originalNetwork() const;
@@ -230,6 +384,9 @@ protected:
     void resetAccountInfo();
     void upgradeSettings(bool existingSettingsFile);
     void queueApplyFirewallRules() { queueNotification(&Daemon::reapplyFirewallRules); }
+    // Apply the firewall rules immediately, for security-critical changes.
+    // Any queued reapply is canceled, since it'd be redundant.
+    void applyFirewallRulesNow() { cancelNotification(&Daemon::reapplyFirewallRules); reapplyFirewallRules(); }
 
     // Check whether any active clients are connected
     bool hasActiveClient() const;
@@ -286,8 +443,29 @@ protected:
     // replaced with proper country selections.
     QString RPC_getCountryBestRegion(const QString &country);
 
+    // Get the bandwidth history of the current connection at a given
+    // resolution (in seconds - 5, 60, or 600), starting at 'since' (ms since
+    // epoch, 0 for all history).  Returns an array of objects with "time",
+    // "received", and "sent", oldest first.  This lets clients fetch history
+    // as needed rather than accumulating intervalMeasurements.
+    QJsonArray RPC_getThroughputHistory(int resolution, qint64 since);
+
     // Diagnostics
     QJsonValue RPC_writeDiagnostics();
+    // Get the memory used by each subsystem; see memoryUsage()
+    QJsonObject RPC_getMemoryUsage();
+    // Get the power policy's mode, inputs, and the measured timer wakeup rate
+    // (see PowerPolicy::diagnostics())
+    QJsonObject RPC_getPowerPolicy();
+    // Get the wakeups and CPU time accounted to each subsystem since the daemon
+    // started (see WakeupAccounting); used by piactl wakeups
+    QJsonObject RPC_getWakeupAccounting();
+    // Start or stop the sampling profiler (see SamplingProfiler).  Starting
+    // requires debug logging, like diagnostics.  intervalMs is the sampling
+    // interval in CPU time.  Stopping returns the path to the profile, or null
+    // if the profiler wasn't running.
+    void RPC_startProfiler(qint64 intervalMs);
+    QJsonValue RPC_stopProfiler();
     void RPC_writeDummyLogs();
     void RPC_crash();
 
@@ -302,6 +480,20 @@ protected:
     // Client activation
     void RPC_notifyClientActivate();
     void RPC_notifyClientDeactivate();
+    // Client reports whether it's showing its dashboard; the daemon scales
+    // back periodic work on battery power when no dashboard is visible.
+    void RPC_notifyClientVisible(bool visible);
+    // Client requests a more compact "data" notification encoding.
+    // Capabilities is an object with optional boolean fields:
+    // - "cbor" - send "data" notifications as CBOR binary frames
+    // - "deltas" - send large properties as structural deltas (jsondelta.h)
+    // It can also include "resumeVersion" - the version token of the last
+    // "data" notification from a prior connection (see sendSnapshot()).
+    void RPC_negotiateDataEncoding(const QJsonObject &capabilities);
+    // Client subscribes to a subset of properties (see
+    // ClientConnection::setSubscriptions()).  This must be sent before
+    // negotiateDataEncoding to apply to the initial snapshot.
+    void RPC_subscribeProperties(const QJsonObject &subscriptions);
 
     // Sleep-related events for robust macOS sleep
     // Notify the daemon that the system is about to go to sleep
@@ -389,8 +581,33 @@ public slots:
 
 private:
     void clientConnected(IPCConnection* connection);
+    // Send the initial state snapshot to a new client.  If the client
+    // presents a valid version token from a prior connection to this daemon,
+    // only properties changed since that version are sent.
+    void sendSnapshot(ClientConnection *pClient, const QString &resumeVersion);
+    // Get the full snapshot of one group ("data", "account", etc.), cached
+    // until it's discarded or patched by notifyChanges().
+    QJsonObject getSnapshotGroup(const QString &group);
+    QString dataVersionToken() const;
+    // Queue notifyChanges() for a property change.  Batched (low-priority)
+    // changes wait for the notification batch interval unless a high-priority
+    // change flushes them first.
+    void queueChangeNotification(bool batched);
     void notifyChanges();
+    // Send a "data" notification with the given changes to all clients, using
+    // each client's negotiated encoding.
+    void pushDataChanges(const QJsonObject &all);
+    // Publish the current state and settings to the state mirror, when
+    // _stateMirrorTimer elapses
+    void publishStateMirror();
     void serialize();
+    // Check whether deferrable work (serializing the data files, publishing
+    // the state mirror) should wait for a connection transition to finish.
+    // If so, this ensures the deferred work will run when the transition
+    // ends, or when the deferral limit elapses.
+    bool deferForConnection();
+    // Run work that was deferred by deferForConnection()
+    void runDeferredWork();
     Async<void> loadVpnIp();
     void vpnStateChanged(VPNConnection::State state,
                          VPNConnection::State oldState,
@@ -402,6 +619,7 @@ private:
     void vpnError(const Error& error);
     void vpnByteCountsChanged();
     void newLatencyMeasurements(const LatencyTracker::Latencies &measurements);
+    void latencyStatisticsChanged();
     void portForwardUpdated(int port);
 
     // Store new locations built from one of the regions lists and update
@@ -420,18 +638,66 @@ private:
                                 const QJsonArray &shadowsocksObj,
                                 const QJsonObject &metadataObj);
 
+    // Apply locations built by rebuildModernLocations() or from the regions
+    // image.  Returns false (and applies nothing) if they're empty.
+    bool applyModernLocations(std::pair<LocationsById, kapps::regions::Metadata> newLocations);
+
+    // Map the regions image written by a prior run, if there is one.  It's
+    // only used if its tag matches DaemonData::modernRegionsImageTag.
+    void loadRegionsImage();
+    // Store a new regions image built from the lists that are about to be
+    // cached
+    void storeRegionsImage(QByteArray image, QString imageTag);
+
     // Rebuild either the legacy or modern locations from the cached data,
     // depending on the infrastructure setting.  Used when latencies are updated
     // or when initially building the regions list.
     void rebuildActiveLocations();
 
+    // Load the cached locations (regions image and rebuilt locations).  This
+    // is deferred from the constructor so clients can connect sooner; it's
+    // done by finishStartup() or on activation, whichever is first.  Only the
+    // first call does anything.
+    void loadCachedLocations();
+    // Work deferred until the event loop is running after start()
+    void finishStartup();
+
+    // The regions lists loaded by JsonRefreshers
+    enum class RegionsList
+    {
+        Regions,
+        Shadowsocks,
+        Metadata,
+    };
+    // Locations built on the _regionsListBuilder worker
+    struct BuiltRegionsList
+    {
+        bool valid{false};
+        std::pair<LocationsById, kapps::regions::Metadata> locations;
+        QByteArray image;
+        QString imageTag;
+    };
+    // Build locations from a loaded regions list on the _regionsListBuilder
+    // worker (with the other cached lists).  regionsListBuilt() then applies
+    // them and caches the list if it's usable.
+    void buildLoadedRegionsList(RegionsList list, QJsonDocument content);
+    void regionsListBuilt(RegionsList list, const QJsonDocument &content,
+                          quint64 generation, BuiltRegionsList built);
+
     // Handle region list results from JsonRefresher
     void shadowsocksRegionsLoaded(const QJsonDocument &shadowsocksRegionsJsonDoc);
     void modernRegionsLoaded(const QJsonDocument &modernRegionsJsonDoc);
     void modernRegionsMetaLoaded(const QJsonDocument &modernRegionsJsonDoc);
     void publicIpLoaded(const QJsonDocument &publicIpDoc);
     void updatePublicIpRefresher (VPNConnection::State state);
-    void onNetworksChanged(const std::vector<NetworkConnection> &networks);
+    // The network connections have changed.  Work that depends only on the
+    // default connections is skipped when changes.defaultChanged is false.
+    void onNetworksChanged(const std::vector<NetworkConnection> &networks,
+                           const NetworkChanges &changes);
+    // The default network has changed - store the latencies in the profile for
+    // the previous network, restore the latencies for this network if they're
+    // known, and re-measure.  networkId is from onNetworksChanged().
+    void applyLatencyProfile(const QString &networkId);
 
     void refreshAccountInfo();
     void applyDedicatedIpJson(const QJsonObject &tokenData, AccountDedicatedIp &dipInfo);
@@ -488,6 +754,21 @@ private:
     void updatePortForwarder();
 
     void traceMemory();
+    // Update PowerPolicy's dashboard visibility from the connected clients
+    void updateDashboardVisible();
+    // Apply the power policy to subsystems that scale their own intervals
+    void applyPowerPolicy();
+    // Update metrics that are kept elsewhere, before they're scraped
+    void collectMetrics();
+    // Name an API base for metrics, based on the Environment's APIs
+    QString apiBaseMetricName(const ApiBase *pApiBase);
+    // Approximate memory used by the daemon's subsystems - sizes and counts of
+    // the things that grow over time (regions data, latency history, queued
+    // log output, client buffers, live tasks, etc.).  This doesn't add up to
+    // the process's memory usage, it's used to attribute growth over long
+    // uptimes.  It's traced periodically with traceMemory(), and it's in
+    // diagnostics and RPC_getMemoryUsage().
+    QJsonObject memoryUsage() const;
 
     // Set _state.overridesActive() or _state.overridesFailed() and log
     // appropriately
@@ -516,6 +797,9 @@ private:
     void disconnectVPN(ServiceQuality::ConnectionSource source);
 protected:
     bool _started, _stopping;
+    // Measures startup phases from construction, just for tracing
+    QElapsedTimer _startupTime;
+    bool _cachedLocationsLoaded{false};
 
     // Some setting defaults for new installations can be changed by feature
     // flags (currently, the default OpenVPN driver on Windows, which we are
@@ -528,7 +812,25 @@ protected:
     IPCServer* _server;
     QHash<IPCConnection*, ClientConnection*> _clients;
     LocalMethodRegistry* _methodRegistry;
-    RemoteNotificationInterface* _rpc;
+    // Parses large incoming RPC messages off of the main thread
+    JsonRPCParseThread _rpcParseThread;
+    // Last value pushed to clients for each property that can be sent as a
+    // delta (keyed by "<group>.<property>", such as "state.groupedLocations").
+    // Deltas are computed against these.  All clients either received these
+    // values or are not using deltas, since clientConnected() flushes pending
+    // changes before sending the initial snapshot.
+    QHash<QString, QJsonValue> _deltaBaselines;
+    // Data version tokens are "<instance>:<version>".  The instance identifies
+    // this daemon run (tokens from a prior run are not valid), and the version
+    // is incremented by each change notification.
+    QString _dataInstance;
+    quint64 _dataVersion;
+    // Version when each property (keyed as in _deltaBaselines) last changed.
+    // Properties that haven't changed since startup are not present.
+    QHash<QString, quint64> _propertyVersions;
+    // Cached full snapshots of each group for new clients, kept up to date by
+    // notifyChanges()
+    QHash<QString, QJsonObject> _snapshotCache;
 
     VPNConnection* _connection;
 
@@ -556,6 +858,10 @@ protected:
     Environment _environment;
     ApiClient _apiClient;
 
+    // Constructed before the subsystems that register timers with it
+    PowerPolicy _powerPolicy;
+    Metrics _metrics;
+    MetricsServer _metricsServer;
     LatencyTracker _modernLatencyTracker;
     PortForwarder _portForwarder;
     JsonRefresher _modernRegionRefresher, _modernRegionMetaRefresher,
@@ -572,15 +878,46 @@ protected:
     QSet<QString> _accountChanges;
     QSet<QString> _settingsChanges;
     std::unordered_set<std::string> _stateChanges;
+    // Running while low-priority changes are waiting to be sent
+    QTimer _notificationBatchTimer;
 
     unsigned int _pendingSerializations;
     QTimer _serializationTimer;
+    SettingsPersistence _settingsPersistence;
+    // Read-only shared-memory copy of the state and settings for one-shot
+    // clients.  It's republished at most once per _stateMirrorTimer interval.
+    StateMirrorWriter _stateMirror;
+    QTimer _stateMirrorTimer;
+
+    // While the VPN connection is transitioning (connecting, reconnecting,
+    // etc.), deferrable main-thread work is postponed so it doesn't delay
+    // connection state changes.  This measures the current transition, and
+    // _connectionDeferralTimer limits how long work is deferred.
+    QElapsedTimer _connectionTransitionTime;
+    QTimer _connectionDeferralTimer;
+    bool _serializationDeferred;
+    bool _stateMirrorDeferred;
+
+    // Regions image of the cached regions lists, used to rebuild locations
+    // without parsing the lists.  This may be mapped from _regionsImageFile
+    // (the image written by a prior run), or it may hold a new image.
+    QFile _regionsImageFile;
+    QByteArray _regionsImage;
+
+    // Index of StateModel::availableLocations for location selections, rebuilt
+    // when the locations change
+    NearestLocations _nearestLocations;
+
+    // Incremented whenever a loaded regions list is cached, so a list built
+    // with an outdated cache can be detected and built again
+    quint64 _regionsListGeneration;
 
     QTimer _accountRefreshTimer;
     QTimer _dedicatedIpRefreshTimer;
 
     QTimer _checkForAppMessagesTimer;
     QTimer _memTraceTimer;
+    SamplingProfiler _profiler;
 
     // Ongoing login attempt.  If we try to log in again or log out, we need to
     // abort the prior attempt.  This is an AbortableTask so it'll still
@@ -592,6 +929,12 @@ protected:
     // time, so we discard it if we leave the Connected state.
     Async<void> _pVpnIpRequest;
 
+    // API requests are sent on this thread (see ApiNetwork::useNetworkThread())
+    RunningWorkerThread _apiNetworkThread;
+
+    // Builds locations from loaded regions lists.  This is last, so it's
+    // destroyed (waiting for any build in progress) before the rest of Daemon.
+    RunningWorkerThread _regionsListBuilder;
 };
 
 #define g_daemon (Daemon::instance())
@@ -20,7 +20,11 @@
 #line SOURCE_FILE("latencytracker.cpp")
 
 #include "latencytracker.h"
+#include <common/src/wakeupaccounting.h>
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <QRandomGenerator>
 
 #if defined(Q_OS_WIN)
@@ -31,12 +35,39 @@
 
 namespace
 {
-    const std::chrono::minutes latencyRefreshInterval{1};
+    // Locations are measured at different intervals depending on their rank
+    // by latency.  The nearest locations are measured at the first interval;
+    // each tier includes the ranks up to its limit.  Locations that have never
+    // responded use the middle tier.
+    struct MeasurementTier
+    {
+        std::size_t rankLimit;
+        std::chrono::milliseconds interval;
+    };
+    const std::array<MeasurementTier, 3> measurementTiers
+    {{
+        {10, std::chrono::minutes{1}},
+        {30, std::chrono::minutes{3}},
+        {std::numeric_limits<std::size_t>::max(), std::chrono::minutes{10}}
+    }};
+    // Locations whose deviation exceeds this fraction of their latency are
+    // moved up one tier.
+    const double unstableDeviationRatio{0.25};
+    // The measure trigger checks for locations that are due at this interval.
+    const std::chrono::seconds latencyTriggerInterval{5};
+    // At most this many pings are sent per second on average; locations that
+    // are due beyond this limit wait for the next trigger.  (Newly added
+    // locations are always measured immediately.)
+    const int maxPingsPerSecond{10};
     const std::chrono::seconds latencyEchoTimeout{10};
     const std::chrono::milliseconds latencyBatchInterval{100};
 
     //The number of measurements that LatencyHistory stores
     const int measurementHistoryCount{5};
+    //Weight of a new sample in LatencyHistory's moving statistics.  With 1
+    //minute between measurements for the nearest locations, this mostly
+    //reflects the last 10 minutes or so.
+    const double statisticsSmoothing{0.2};
 
     RegisterMetaType<std::chrono::milliseconds> rxChronoMilliseconds;
     RegisterMetaType<LatencyTracker::Latencies> rxLatencies;
@@ -91,9 +122,9 @@ namespace
                 pendingReplies[HostPortKey{QHostAddress{echoAddr}, 0}] = pLocation->id();
 
                 connect(pEcho.data(), &WinIcmpEcho::receivedReply, this,
-                        [this](quint32 address)
+                        [this](quint32 address, std::chrono::milliseconds roundtrip)
                         {
-                            emit receivedResponse(QHostAddress{address}, 0);
+                            emit receivedResponse(QHostAddress{address}, 0, roundtrip);
                         });
             }
         }
@@ -111,39 +142,185 @@ namespace
         // PosixIcmpBatchPinger will insert all locations that were successfully
         // pinged into pendingReplies (values are the location IDs).  Ports are
         // always 0 for PosixIcmpBatchPinger since it uses ICMP.
+        //
+        // The echoes are sent with pPing, which must outlive the batch; if it's
+        // nullptr, PosixIcmpBatchPinger opens its own socket.
         PosixIcmpBatchPinger(const std::vector<QSharedPointer<const Location>> &locations,
-                             PendingRepliesMap &pendingReplies);
+                             PendingRepliesMap &pendingReplies,
+                             PosixPing *pPing);
 
     private:
-        PosixPing _ping;
+        std::unique_ptr<PosixPing> _pOwnedPing;
     };
 
     PosixIcmpBatchPinger::PosixIcmpBatchPinger(const std::vector<QSharedPointer<const Location>> &locations,
-                                               PendingRepliesMap &pendingReplies)
+                                               PendingRepliesMap &pendingReplies,
+                                               PosixPing *pPing)
     {
-        //Ping each location.
+        if(!pPing)
+        {
+            _pOwnedPing.reset(new PosixPing{});
+            pPing = _pOwnedPing.get();
+        }
+
+        // Select an address for each location, then send all the echoes at
+        // once.
+        std::vector<quint32> echoAddrs;
+        std::unordered_map<quint32, QString> echoLocations;
+        echoAddrs.reserve(locations.size());
+        echoLocations.reserve(locations.size());
         for(const auto &pLocation : locations)
         {
             quint32 echoAddr = selectIcmpPingAddress(pLocation);
-            if(echoAddr && _ping.sendEchoRequest(echoAddr))
-            {
-                // Pinged this location, put it in the pending replies.
-                pendingReplies[HostPortKey{QHostAddress{echoAddr}, 0}] = pLocation->id();
-            }
+            if(echoAddr && echoLocations.emplace(echoAddr, pLocation->id()).second)
+                echoAddrs.push_back(echoAddr);
+        }
+
+        for(quint32 sentAddr : pPing->sendEchoRequests(echoAddrs))
+        {
+            // Pinged this location, put it in the pending replies.
+            pendingReplies[HostPortKey{QHostAddress{sentAddr}, 0}] = echoLocations[sentAddr];
         }
 
-        connect(&_ping, &PosixPing::receivedReply, this,
-                [this](quint32 addr)
+        connect(pPing, &PosixPing::receivedReply, this,
+                [this](quint32 addr, std::chrono::microseconds roundtrip)
                 {
-                    receivedResponse(QHostAddress{addr}, 0);
+                    emit receivedResponse(QHostAddress{addr}, 0, roundtrip);
                 });
     }
 
 #endif
 }
 
+P2Quantile::P2Quantile(double quantile)
+    : _quantile{quantile}, _count{0}, _heights{}, _positions{1, 2, 3, 4, 5},
+      _desired{1.0, 1.0 + 2.0*quantile, 1.0 + 4.0*quantile, 3.0 + 2.0*quantile, 5.0},
+      _increments{0.0, quantile/2.0, quantile, (1.0 + quantile)/2.0, 1.0}
+{
+}
+
+double P2Quantile::parabolic(int i, int d) const
+{
+    double n = _positions[i], nPrev = _positions[i-1], nNext = _positions[i+1];
+    return _heights[i] + d / (nNext - nPrev) *
+        ((n - nPrev + d) * (_heights[i+1] - _heights[i]) / (nNext - n) +
+         (nNext - n - d) * (_heights[i] - _heights[i-1]) / (n - nPrev));
+}
+
+double P2Quantile::linear(int i, int d) const
+{
+    return _heights[i] + d * (_heights[i+d] - _heights[i]) /
+        (_positions[i+d] - _positions[i]);
+}
+
+void P2Quantile::addSample(double sample)
+{
+    // The first five samples initialize the markers
+    if(_count < 5)
+    {
+        _heights[_count] = sample;
+        ++_count;
+        if(_count == 5)
+            std::sort(_heights.begin(), _heights.end());
+        return;
+    }
+    ++_count;
+
+    // Find the cell containing the sample, extending the extreme markers if
+    // needed
+    int cell;
+    if(sample < _heights[0])
+    {
+        _heights[0] = sample;
+        cell = 0;
+    }
+    else if(sample >= _heights[4])
+    {
+        _heights[4] = sample;
+        cell = 3;
+    }
+    else
+    {
+        cell = 0;
+        while(sample >= _heights[cell+1])
+            ++cell;
+    }
+
+    for(int i = cell+1; i < 5; ++i)
+        ++_positions[i];
+    for(int i = 0; i < 5; ++i)
+        _desired[i] += _increments[i];
+
+    // Adjust the middle markers if they're too far from their desired
+    // positions
+    for(int i = 1; i < 4; ++i)
+    {
+        double offset = _desired[i] - _positions[i];
+        if((offset >= 1.0 && _positions[i+1] - _positions[i] > 1) ||
+           (offset <= -1.0 && _positions[i-1] - _positions[i] < -1))
+        {
+            int d = offset > 0 ? 1 : -1;
+            double height = parabolic(i, d);
+            if(_heights[i-1] < height && height < _heights[i+1])
+                _heights[i] = height;
+            else
+                _heights[i] = linear(i, d);
+            _positions[i] += d;
+        }
+    }
+}
+
+double P2Quantile::value() const
+{
+    if(_count == 0)
+        return 0.0;
+    if(_count >= 5)
+        return _heights[2];
+
+    // Not enough samples for the markers yet, use the nearest sample
+    std::array<double, 5> samples{_heights};
+    std::sort(samples.begin(), samples.begin() + _count);
+    return samples[static_cast<std::size_t>(std::lround(_quantile * (_count - 1)))];
+}
+
+LatencyHistory::LatencyHistory()
+    : _pings{0}, _samples{0}, _mean{0.0}, _variance{0.0}, _lossRate{0.0},
+      _p50{0.5}, _p95{0.95}
+{
+}
+
+void LatencyHistory::updateLossRate(double lost)
+{
+    if(_pings == 0)
+        _lossRate = lost;
+    else
+        _lossRate += statisticsSmoothing * (lost - _lossRate);
+    ++_pings;
+}
+
+void LatencyHistory::recordLoss()
+{
+    updateLossRate(1.0);
+}
+
 std::chrono::milliseconds LatencyHistory::updateLatency(std::chrono::milliseconds newMeasurement)
 {
+    // Update the streaming statistics
+    double sample = static_cast<double>(newMeasurement.count());
+    if(_samples == 0)
+        _mean = sample;
+    else
+    {
+        // Exponentially-weighted mean and variance
+        double diff = sample - _mean;
+        _mean += statisticsSmoothing * diff;
+        _variance = (1.0 - statisticsSmoothing) * (_variance + statisticsSmoothing * diff * diff);
+    }
+    ++_samples;
+    _p50.addSample(sample);
+    _p95.addSample(sample);
+    updateLossRate(0.0);
+
     //If we already have the maximum number of entries, discard the oldest one.
     if(_lastMeasurements.size() >= measurementHistoryCount)
     {
@@ -153,6 +330,14 @@ std::chrono::milliseconds LatencyHistory::updateLatency(std::chrono::millisecond
     //Store the new one.
     _lastMeasurements.push_back(newMeasurement);
 
+    return latency();
+}
+
+std::chrono::milliseconds LatencyHistory::latency() const
+{
+    if(_lastMeasurements.isEmpty())
+        return {};
+
     //Compute the average latency over these measurements.
     //An average is probably the best way to aggregate these (as opposed to min/
     //max/etc.), because it'll reduce the effect of anomalous measurements at
@@ -160,34 +345,135 @@ std::chrono::milliseconds LatencyHistory::updateLatency(std::chrono::millisecond
     std::chrono::milliseconds sum = std::accumulate(_lastMeasurements.begin(),
                                                     _lastMeasurements.end(),
                                                     std::chrono::milliseconds{0});
-
     return sum / _lastMeasurements.size();
 }
 
+std::chrono::milliseconds LatencyHistory::deviation() const
+{
+    if(_lastMeasurements.isEmpty())
+        return {};
+    std::chrono::milliseconds mean = latency();
+    std::chrono::milliseconds sumDeviation{0};
+    for(const auto &measurement : _lastMeasurements)
+        sumDeviation += (measurement > mean) ? (measurement - mean) : (mean - measurement);
+    return sumDeviation / _lastMeasurements.size();
+}
+
+LatencyStatistics LatencyHistory::statistics() const
+{
+    return {_mean, std::sqrt(_variance), _p50.value(), _p95.value(), _lossRate};
+}
+
 LatencyTracker::LatencyTracker()
 {
-    _measureTrigger.setInterval(std::chrono::milliseconds(latencyRefreshInterval).count());
+#if !defined(Q_OS_WIN)
+    // Open the ICMP socket on the worker thread, where it will be used
+    _measurementThread.invokeOnThread([this]()
+    {
+        _pPing = new PosixPing{&_measurementThread.objectOwner()};
+    });
+#endif
+    _measureTrigger.setTimerType(Qt::TimerType::VeryCoarseTimer);
+    _measureTrigger.setInterval(msec32(latencyTriggerInterval));
+    tagWakeups(_measureTrigger, QByteArrayLiteral("latency"));
     connect(&_measureTrigger, &QTimer::timeout, this,
             &LatencyTracker::onMeasureTrigger);
 }
 
+std::chrono::milliseconds LatencyTracker::measurementInterval(const LocationData &location,
+                                                              std::size_t rank) const
+{
+    // Locations that have never responded use the middle tier - they're
+    // probably unreachable right now, but they might come back.
+    if(!location.latency.hasMeasurements())
+        return measurementTiers[1].interval * _intervalScale;
+
+    std::size_t tier{0};
+    while(rank >= measurementTiers[tier].rankLimit)
+        ++tier;
+
+    // Unstable locations are measured more often, their latency could change
+    // enough to affect automatic selection
+    auto latency = location.latency.latency();
+    if(tier > 0 && location.latency.deviation().count() >
+        latency.count() * unstableDeviationRatio)
+    {
+        --tier;
+    }
+
+    return measurementTiers[tier].interval * _intervalScale;
+}
+
+void LatencyTracker::setIntervalScale(int scale)
+{
+    Q_ASSERT(scale >= 1);
+    if(scale == _intervalScale)
+        return;
+    _intervalScale = scale;
+    // Locations already scheduled keep their next measurement time; the new
+    // scale applies when they're measured again.  This restarts the trigger
+    // if it's running.
+    _measureTrigger.setInterval(msec32(latencyTriggerInterval * _intervalScale));
+}
+
 void LatencyTracker::onMeasureTrigger()
 {
-    //Measure all known addresses (if there are any)
-    //This vector of PingLocations could in principle be built with _locations
-    //and stored, but it shouldn't be a significant cost to just build it here.
+    // Rank the locations by latency to determine their measurement intervals.
+    // Locations with no measurements are ranked last; this doesn't matter
+    // since they don't use the rank.
+    std::vector<std::pair<std::chrono::milliseconds, LocationData*>> rankedLocations;
+    rankedLocations.reserve(_locations.size());
+    for(auto &locationEntry : _locations)
+    {
+        const auto &latency = locationEntry.second.latency;
+        rankedLocations.push_back({latency.hasMeasurements() ? latency.latency() : std::chrono::milliseconds::max(),
+                                   &locationEntry.second});
+    }
+    std::sort(rankedLocations.begin(), rankedLocations.end(),
+              [](const auto &first, const auto &second){return first.first < second.first;});
+
+    // Find the locations that are due
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::pair<std::size_t, LocationData*>> dueLocations;
+    for(std::size_t rank = 0; rank < rankedLocations.size(); ++rank)
+    {
+        // Locations that haven't been attempted are measured by
+        // measureNewLocations() instead
+        LocationData *pLocation = rankedLocations[rank].second;
+        if(pLocation->pingAttempted && pLocation->nextMeasurement <= now)
+            dueLocations.push_back({rank, pLocation});
+    }
+
+    // If more locations are due than we can measure now, measure the ones that
+    // have been waiting the longest.  The rest remain due for the next trigger.
+    auto maxPings = static_cast<std::size_t>(maxPingsPerSecond * latencyTriggerInterval.count() * _intervalScale);
+    if(dueLocations.size() > maxPings)
+    {
+        std::partial_sort(dueLocations.begin(), dueLocations.begin() + maxPings,
+                          dueLocations.end(),
+                          [](const auto &first, const auto &second)
+                          {
+                              return first.second->nextMeasurement < second.second->nextMeasurement;
+                          });
+        qInfo() << "Deferring" << (dueLocations.size() - maxPings)
+            << "latency measurements to limit ping rate";
+        dueLocations.resize(maxPings);
+    }
+
     std::vector<QSharedPointer<const Location>> measureLocations;
-    measureLocations.reserve(_locations.size());
-    for(auto itLocation = _locations.begin(); itLocation != _locations.end();
-        ++itLocation)
+    measureLocations.reserve(dueLocations.size());
+    for(const auto &dueLocation : dueLocations)
     {
-        measureLocations.push_back(itLocation->second.pLocation);
+        LocationData &location{*dueLocation.second};
+        location.nextMeasurement = now + measurementInterval(location, dueLocation.first);
+        measureLocations.push_back(location.pLocation);
     }
     beginMeasurement(measureLocations);
 }
 
 void LatencyTracker::onNewMeasurements(const Latencies &measurements)
 {
+    _probeCounts.replied += measurements.size();
     Latencies aggregatedMeasurements;
     aggregatedMeasurements.reserve(measurements.size());
     for(const auto &measurement : measurements)
@@ -206,12 +492,36 @@ void LatencyTracker::onNewMeasurements(const Latencies &measurements)
     }
 
     if(!aggregatedMeasurements.empty())
+    {
+        emit statisticsChanged();
         emit newMeasurements(aggregatedMeasurements);
+    }
+}
+
+void LatencyTracker::onLostMeasurements(const QStringList &locationIds)
+{
+    _probeCounts.lost += static_cast<quint64>(locationIds.size());
+    bool anyLost{false};
+    for(const auto &locationId : locationIds)
+    {
+        auto itLocation = _locations.find(locationId);
+        if(itLocation != _locations.end())
+        {
+            itLocation->second.latency.recordLoss();
+            anyLost = true;
+        }
+    }
+
+    if(anyLost)
+        emit statisticsChanged();
 }
 
 void LatencyTracker::measureNewLocations()
 {
     std::vector<QSharedPointer<const Location>> newLocations;
+    // Measure new locations again at the shortest interval; they'll be moved
+    // to the correct tier after that.
+    auto nextMeasurement = std::chrono::steady_clock::now() + measurementTiers[0].interval * _intervalScale;
 
     for(auto &locationEntry : _locations)
     {
@@ -219,6 +529,7 @@ void LatencyTracker::measureNewLocations()
         if(!locationEntry.second.pingAttempted)
         {
             locationEntry.second.pingAttempted = true;
+            locationEntry.second.nextMeasurement = nextMeasurement;
             newLocations.push_back(locationEntry.second.pLocation);
         }
     }
@@ -234,6 +545,7 @@ void LatencyTracker::beginMeasurement(const std::vector<QSharedPointer<const Loc
     //If there's at least one address to measure, start a measurement.
     if(!locations.empty())
     {
+        _probeCounts.sent += locations.size();
         // Create the LatencyBatch on the worker thread so there's no
         // interference between activity on the main thread and the events that
         // have to be measured to calculate latency.
@@ -247,11 +559,19 @@ void LatencyTracker::beginMeasurement(const std::vector<QSharedPointer<const Loc
         {
             //Create a LatencyBatch; parent it to this object so it is cleaned up if
             //LatencyTracker is destroyed
+#if defined(Q_OS_WIN)
             LatencyBatch *pNewBatch = new LatencyBatch{locations,
                                                        &_measurementThread.objectOwner()};
+#else
+            LatencyBatch *pNewBatch = new LatencyBatch{locations,
+                                                       &_measurementThread.objectOwner(),
+                                                       _pPing};
+#endif
             //Forward newMeasurements signals from this new batch
             connect(pNewBatch, &LatencyBatch::newMeasurements, this,
                     &LatencyTracker::onNewMeasurements);
+            connect(pNewBatch, &LatencyBatch::lostMeasurements, this,
+                    &LatencyTracker::onLostMeasurements);
         });
     }
 }
@@ -271,7 +591,7 @@ void LatencyTracker::updateLocations(const LocationsById &serverLocations)
         // Create the location.  No pings have been attempted yet if we don't
         // find this location in oldLocations
         auto &newLocation = _locations[idQstr];
-        newLocation = {location.second, {}, false};
+        newLocation = {location.second, {}, false, {}};
 
         // Did we have this location before?
         auto itOldLocation = oldLocations.find(idQstr);
@@ -279,8 +599,9 @@ void LatencyTracker::updateLocations(const LocationsById &serverLocations)
         {
             //It existed, so preserve its latency measurements
             newLocation.latency = std::move(itOldLocation->second.latency);
-            //Preserve pingAttempted
+            //Preserve pingAttempted and the measurement schedule
             newLocation.pingAttempted = itOldLocation->second.pingAttempted;
+            newLocation.nextMeasurement = itOldLocation->second.nextMeasurement;
         }
     }
 
@@ -301,6 +622,41 @@ void LatencyTracker::start()
     }
 }
 
+void LatencyTracker::resetMeasurements()
+{
+    for(auto &locationEntry : _locations)
+    {
+        locationEntry.second.latency = {};
+        locationEntry.second.pingAttempted = false;
+    }
+
+    if(_measureTrigger.isActive())
+        measureNewLocations();
+}
+
+LatencyStatisticsById LatencyTracker::statistics() const
+{
+    LatencyStatisticsById allStatistics;
+    allStatistics.reserve(_locations.size());
+    for(const auto &locationEntry : _locations)
+    {
+        if(locationEntry.second.latency.hasMeasurements())
+        {
+            allStatistics.emplace(locationEntry.first.toStdString(),
+                                  locationEntry.second.latency.statistics());
+        }
+    }
+    return allStatistics;
+}
+
+qsizetype LatencyTracker::storedMeasurements() const
+{
+    qsizetype measurements = 0;
+    for(const auto &locationEntry : _locations)
+        measurements += locationEntry.second.latency.storedMeasurements();
+    return measurements;
+}
+
 void LatencyTracker::stop()
 {
     qInfo() << "Stopping background latency checks";
@@ -308,30 +664,42 @@ void LatencyTracker::stop()
 }
 
 LatencyBatch::LatencyBatch(const std::vector<QSharedPointer<const Location>> &locations,
-                           QObject *pParent)
+                           QObject *pParent, PosixPing *pPing)
     : QObject{pParent}
 {
-    _batchTimer.setInterval(std::chrono::milliseconds(latencyBatchInterval).count());
-    _batchTimer.setSingleShot(true);
-    connect(&_batchTimer, &QTimer::timeout, this,
-            &LatencyBatch::onBatchElapsed);
-
-    //Start the timer before sending the ping packets
-    _timeSincePing.start();
-
 #if defined(Q_OS_WIN)
+    Q_UNUSED(pPing);
     _pPinger.reset(new WinIcmpBatchPinger{locations, _pendingReplies, latencyEchoTimeout});
 #else
-    _pPinger.reset(new PosixIcmpBatchPinger{locations, _pendingReplies});
+    _pPinger.reset(new PosixIcmpBatchPinger{locations, _pendingReplies, pPing});
 #endif
 
+    start(latencyEchoTimeout);
+}
+
+LatencyBatch::LatencyBatch(std::unique_ptr<BatchPinger> pPinger,
+                           PendingRepliesMap pendingReplies,
+                           std::chrono::milliseconds timeout, QObject *pParent)
+    : QObject{pParent}, _pendingReplies{std::move(pendingReplies)},
+      _pPinger{std::move(pPinger)}
+{
+    start(timeout);
+}
+
+void LatencyBatch::start(std::chrono::milliseconds timeout)
+{
+    _batchTimer.setInterval(std::chrono::milliseconds(latencyBatchInterval).count());
+    _batchTimer.setSingleShot(true);
+    connect(&_batchTimer, &QTimer::timeout, this,
+            &LatencyBatch::onBatchElapsed);
+
     connect(_pPinger.get(), &BatchPinger::receivedResponse, this,
             &LatencyBatch::onReceivedResponse);
 
     if(_pendingReplies.size() >= 1)
     {
         //We sent at least one ping, so start the timeout timer.
-        QTimer::singleShot(std::chrono::milliseconds(latencyEchoTimeout).count(), this,
+        QTimer::singleShot(timeout.count(), this,
                            &LatencyBatch::onTimeoutElapsed);
     }
     else
@@ -353,10 +721,10 @@ void LatencyBatch::emitBatchedMeasurements()
     }
 }
 
-void LatencyBatch::onReceivedResponse(const QHostAddress &address, quint16 port)
+void LatencyBatch::onReceivedResponse(const QHostAddress &address, quint16 port,
+                                      std::chrono::microseconds roundtrip)
 {
-    // Get the roundtrip latency measurement.
-    std::chrono::milliseconds roundtripLatency{_timeSincePing.elapsed()};
+    std::chrono::milliseconds roundtripLatency{std::chrono::duration_cast<std::chrono::milliseconds>(roundtrip)};
 
     //Look up this host in the pending replies.  Look for any possible
     //equivalent address - for example, an IPv4 address could now be represented
@@ -414,11 +782,17 @@ void LatencyBatch::onTimeoutElapsed()
                  << "addresses";
     }
 
+    QStringList lostLocations;
+    lostLocations.reserve(_pendingReplies.size());
     for(const auto &replyEntry : _pendingReplies)
     {
         qInfo() << "Location" << replyEntry.second
                 << "did not respond to latency ping";
+        lostLocations.push_back(replyEntry.second);
     }
+    _pendingReplies.clear();
+    if(!lostLocations.isEmpty())
+        emit lostMeasurements(lostLocations);
 
     // Nothing left to do.  Emit any remaining measurements, then destroy this
     // LatencyBatch
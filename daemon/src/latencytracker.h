@@ -26,8 +26,11 @@
 #include <QHostAddress>
 #include <QTimer>
 #include <QUdpSocket>
+#include <array>
 #include <chrono>
 
+class PosixPing;
+
 namespace std
 {
     template<>
@@ -54,18 +57,74 @@ struct HashPair
 // values are the associated location IDs.
 using PendingRepliesMap = std::unordered_map<HostPortKey, QString, HashPair>;
 
+//Streaming estimate of one quantile of a series of samples, using the P-square
+//algorithm (Jain and Chlamtac, 1985).  This keeps five markers instead of
+//storing the samples.
+class P2Quantile
+{
+public:
+    //quantile is in (0, 1), such as 0.95 for the 95th percentile
+    explicit P2Quantile(double quantile);
+
+    void addSample(double sample);
+    //The current estimate, or 0 if there are no samples yet
+    double value() const;
+
+private:
+    double parabolic(int i, int d) const;
+    double linear(int i, int d) const;
+
+private:
+    double _quantile;
+    int _count;
+    //Marker heights, actual positions, desired positions, and desired position
+    //increments.  Until there are five samples, _heights holds the samples.
+    std::array<double, 5> _heights;
+    std::array<int, 5> _positions;
+    std::array<double, 5> _desired;
+    std::array<double, 5> _increments;
+};
+
 //LatencyHistory queues up latency measurements for a particular remote host.
 //As measurements are taken, they're queued up in LatencyHistory, which
 //computes a latency value based on those measurements.
+//
+//LatencyHistory also keeps streaming statistics of all measurements (moving
+//average and deviation, quantiles, and loss rate) for quality-based location
+//selection; see statistics().
 class LatencyHistory
 {
     CLASS_LOGGING_CATEGORY("latency");
 
+public:
+    LatencyHistory();
+
 public:
     //Add a new measurement and calculate the current latency based on all
     //recent measurements.
     std::chrono::milliseconds updateLatency(std::chrono::milliseconds newMeasurement);
 
+    //Record that a ping was not answered.  This only affects the loss rate.
+    void recordLoss();
+
+    //Whether any measurements have been taken
+    bool hasMeasurements() const {return !_lastMeasurements.isEmpty();}
+    //Number of recent measurements stored
+    qsizetype storedMeasurements() const {return _lastMeasurements.size();}
+    //The current latency (the same value last returned by updateLatency()), or
+    //0 if there are no measurements.
+    std::chrono::milliseconds latency() const;
+    //The mean absolute deviation of the recent measurements from latency(),
+    //used as an estimate of jitter.
+    std::chrono::milliseconds deviation() const;
+
+    //Statistics of all measurements and losses
+    LatencyStatistics statistics() const;
+
+private:
+    //Update the moving loss rate with one ping result
+    void updateLossRate(double lost);
+
 private:
     //The last few measurements are stored here.  Qt doesn't have a deque,
     //which would probably be ideal, but a QList should be OK.  It'll still have
@@ -73,6 +132,17 @@ private:
     //buffer, but it'll probably do better than a vector since it won't have to
     //do it every time we delete something from the front.
     QList<std::chrono::milliseconds> _lastMeasurements;
+    //Streaming statistics - moving average and variance of the measurements,
+    //quantile estimates, and the moving loss rate.  _pings counts measurements
+    //and losses, and _samples counts just measurements; the moving values are
+    //initialized from the first sample.
+    int _pings;
+    int _samples;
+    double _mean;
+    double _variance;
+    double _lossRate;
+    P2Quantile _p50;
+    P2Quantile _p95;
 };
 
 //LatencyTracker takes measurements of the latency to each location's "ping"
@@ -83,6 +153,11 @@ private:
 //each location periodically and emits the "newMeasurements" signal when new
 //measurements are taken.
 //
+//The nearest locations are measured most often, since those are the ones that
+//can be selected automatically.  Distant locations are measured much less
+//often unless their latency is unstable, and the number of pings sent per
+//second is limited.
+//
 //LatencyTracker identifies locations by their ID, not by their ping address.
 //This means that if a location's ping address changes (which usually happens
 //when we refresh the server list), the measurements from the old address carry
@@ -100,12 +175,24 @@ private:
         //Locations can sit in _locations without having been attempted if
         //measurements are not enabled.
         bool pingAttempted;
+        //When this location is next due to be measured.  Locations are measured
+        //at different rates; see onMeasureTrigger().
+        std::chrono::steady_clock::time_point nextMeasurement;
     };
 
 public:
     // Group of latency measurements - location IDs and latency values.
     using Latencies = std::vector<QPair<QString, std::chrono::milliseconds>>;
 
+    // Total probes sent, replied to, and lost since startup (for metrics).
+    // Probes that are still outstanding are neither replied nor lost.
+    struct ProbeCounts
+    {
+        quint64 sent;
+        quint64 replied;
+        quint64 lost;
+    };
+
 public:
     // LatencyTracker begins with measurements stopped - call start() to enable
     // them.
@@ -117,13 +204,25 @@ signals:
     // (Note that moc requires redundant qualifications of nested types)
     void newMeasurements(const LatencyTracker::Latencies &measurements);
 
+    // The statistics for at least one location have changed, due to new
+    // measurements or lost pings.  When new measurements are taken, this is
+    // emitted before newMeasurements().
+    void statisticsChanged();
+
 private slots:
     //Trigger a new latency measurement
     void onMeasureTrigger();
     //Measurements were taken by a LatencyBatch
     void onNewMeasurements(const Latencies &measurements);
+    //Some locations did not respond to a LatencyBatch
+    void onLostMeasurements(const QStringList &locationIds);
 
 private:
+    //Get the interval until a location should be measured again, based on its
+    //rank (by latency, 0 is the lowest) and deviation.
+    std::chrono::milliseconds measurementInterval(const LocationData &location,
+                                                  std::size_t rank) const;
+
     //Begin a measurement for all locations in _locations that haven't been
     //attempted yet
     void measureNewLocations();
@@ -146,6 +245,28 @@ public:
     //a measurement is started immediately for those locations.
     void start();
 
+    //The network has changed, so the existing measurements no longer apply.
+    //Discard the measurement history for all locations and measure them again
+    //(immediately if measurements are enabled, otherwise when they are
+    //enabled).
+    void resetMeasurements();
+
+    //Get the latency statistics for all locations that have been measured.
+    LatencyStatisticsById statistics() const;
+
+    //Number of locations tracked and recent measurements stored for them
+    //(for memory accounting)
+    std::size_t locationCount() const {return _locations.size();}
+    qsizetype storedMeasurements() const;
+
+    //Get the total probes sent, replied, and lost
+    const ProbeCounts &probeCounts() const {return _probeCounts;}
+
+    //Scale the measurement intervals (and the trigger that checks for due
+    //locations), such as to measure less often on battery power.  1 is the
+    //normal rate.
+    void setIntervalScale(int scale);
+
     //Stop latency measurements.  If they were already stopped, this has no
     //effect.  If a measurement is taking place right now, it will still wait
     //for responses, but no new measurements will be started.  (The measurement
@@ -156,10 +277,18 @@ public:
 private:
     // Measurement batches are executed on this thread.
     RunningWorkerThread _measurementThread;
-    //This QTimer triggers when we need to refresh the measurements for all
-    //servers.  This timer is running if and only if measurements have been
-    //started.
+#if !defined(Q_OS_WIN)
+    // The ICMP socket is opened once and used for all batches, rather than
+    // opening a socket for each batch.  This lives on _measurementThread and
+    // is owned by its objectOwner().
+    PosixPing *_pPing;
+#endif
+    //This QTimer triggers periodically to measure the locations that are due.
+    //This timer is running if and only if measurements have been started.
     QTimer _measureTrigger;
+    //Factor applied to the measurement intervals (see setIntervalScale())
+    int _intervalScale{1};
+    ProbeCounts _probeCounts{0, 0, 0};
     //All locations received from the last call to updateLocations() are
     //held here.  The rest of the location list isn't stored; we only keep track
     //of the distinct addresses that are pinged.
@@ -194,16 +323,21 @@ signals:
     // It's possible that the BatchPinger could receive spurious replies from
     // hosts that weren't pinged in this batch; the receiver of this signal
     // should ignore these.
-    void receivedResponse(const QHostAddress &address, quint16 port);
+    //
+    // roundtrip is the latency measured by the ping implementation - the
+    // kernel's receive timestamp is used when possible, so this doesn't
+    // include any delay in processing the reply.
+    void receivedResponse(const QHostAddress &address, quint16 port,
+                          std::chrono::microseconds roundtrip);
 };
 
 // LatencyBatch represents one batch of latency measurements.
 // LatencyTracker creates a batch each time it needs to measure latency to one or
 // more servers.
 //
-// LatencyBatch sends UDP packets to each configured address, then waits for
+// LatencyBatch sends ICMP echoes to each configured address, then waits for
 // echos until the timeout time elapses.  When a reply is received, it
-// calculates the measured latency.  Groups of measurements are emitted in the
+// records the latency measured by the BatchPinger.  Groups of measurements are emitted in the
 // newMeasurements signal, which LatencyTracker forwards on.
 //
 // Once all measurements are received, or if the timeout time elapses,
@@ -218,8 +352,22 @@ public:
 
 public:
     //Create LatencyBatch with the locations that will be checked.
+    //
+    //On Mac/Linux, pPing is the ICMP socket to use; if it's nullptr, the batch
+    //opens its own socket.  (It's ignored on Windows, which always uses the
+    //shared ICMP handle.)
     LatencyBatch(const std::vector<QSharedPointer<const Location>> &locations,
-                 QObject *pParent);
+                 QObject *pParent, PosixPing *pPing = nullptr);
+    //Create LatencyBatch with a specific BatchPinger that has already sent
+    //the requests in pendingReplies.  This is used to simulate pinging in the
+    //latency benchmark.
+    LatencyBatch(std::unique_ptr<BatchPinger> pPinger,
+                 PendingRepliesMap pendingReplies,
+                 std::chrono::milliseconds timeout, QObject *pParent);
+
+private:
+    //Start waiting for replies from _pPinger
+    void start(std::chrono::milliseconds timeout);
 
 signals:
     // This signal is emitted when new measurements have been calculated.
@@ -231,19 +379,21 @@ signals:
     // also can't figure out a type alias)
     void newMeasurements(const LatencyTracker::Latencies &measurements);
 
+    // Emitted when the timeout elapses with the locations that did not
+    // respond.
+    void lostMeasurements(const QStringList &locationIds);
+
 private:
     void emitBatchedMeasurements();
 
 private:
-    void onReceivedResponse(const QHostAddress &address, quint16 port);
+    void onReceivedResponse(const QHostAddress &address, quint16 port,
+                            std::chrono::microseconds roundtrip);
     void onTimeoutElapsed();
     // The batch timer has elapsed, process the batched measurements
     void onBatchElapsed();
 
 private:
-    //This timer measures the elapsed time since the pings were sent, which is
-    //used to calculate latency when the echoes are received.
-    QElapsedTimer _timeSincePing;
     //This map holds the addresses that we haven't heard echoes from yet.
     //Values are the location IDs that we received in the constructor.
     PendingRepliesMap _pendingReplies;
@@ -93,6 +93,7 @@ namespace libnl
         loadLibnl(nl_cache_mngt_unprovide);
         loadLibnl(nl_cache_nitems);
         loadLibnl(nl_cache_refill);
+        loadLibnl(nl_cache_remove);
         loadLibnl(nl_connect);
         loadLibnl(nl_geterror);
         loadLibnl(nl_msg_parse);
@@ -126,6 +127,7 @@ namespace libnl
         loadLibrtnl(rtnl_addr_get_ifindex);
         loadLibrtnl(rtnl_addr_get_local);
         loadLibrtnl(rtnl_link_get);
+        loadLibrtnl(rtnl_link_get_ifindex);
         loadLibrtnl(rtnl_link_get_mtu);
         loadLibrtnl(rtnl_link_get_name);
         loadLibrtnl(rtnl_link_put);
@@ -166,6 +168,7 @@ namespace libnl
     LIBNL_FUNC(nl_cache_mngt_unprovide);
     LIBNL_FUNC(nl_cache_nitems);
     LIBNL_FUNC(nl_cache_refill);
+    LIBNL_FUNC(nl_cache_remove);
     LIBNL_FUNC(nl_connect);
     LIBNL_FUNC(nl_geterror);
     LIBNL_FUNC(nl_msg_parse);
@@ -199,6 +202,7 @@ namespace libnl
     LIBNL_FUNC(rtnl_addr_get_ifindex);
     LIBNL_FUNC(rtnl_addr_get_local);
     LIBNL_FUNC(rtnl_link_get);
+    LIBNL_FUNC(rtnl_link_get_ifindex);
     LIBNL_FUNC(rtnl_link_get_mtu);
     LIBNL_FUNC(rtnl_link_get_name);
     LIBNL_FUNC(rtnl_link_put);
@@ -144,6 +144,7 @@ namespace libnl
     LIBNL_FUNC(nl_cache_mngt_unprovide);
     LIBNL_FUNC(nl_cache_nitems);
     LIBNL_FUNC(nl_cache_refill);
+    LIBNL_FUNC(nl_cache_remove);
     LIBNL_FUNC(nl_connect);
     LIBNL_FUNC(nl_geterror);
     LIBNL_FUNC(nl_msg_parse);
@@ -177,6 +178,7 @@ namespace libnl
     LIBNL_FUNC(rtnl_addr_get_ifindex);
     LIBNL_FUNC(rtnl_addr_get_local);
     LIBNL_FUNC(rtnl_link_get);
+    LIBNL_FUNC(rtnl_link_get_ifindex);
     LIBNL_FUNC(rtnl_link_get_mtu);
     LIBNL_FUNC(rtnl_link_get_name);
     LIBNL_FUNC(rtnl_link_put);
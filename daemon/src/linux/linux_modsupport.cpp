@@ -20,8 +20,10 @@
 #line SOURCE_FILE("linux_modsupport.cpp")
 
 #include "linux_modsupport.h"
-#include <common/src/exec.h>
+#include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
+#include <QProcess>
 #include <QTimer>
 #include <sys/utsname.h>
 
@@ -78,7 +80,7 @@ void LinuxModSupport::queueModulesUpdated()
     }
 }
 
-bool LinuxModSupport::hasModule(const QString &module)
+bool LinuxModSupport::isModuleLoaded(const QString &module)
 {
     // Check if the module is present as a loaded module.  This always detects
     // built-in modules (since they're always loaded), although it's probably
@@ -88,12 +90,48 @@ bool LinuxModSupport::hasModule(const QString &module)
         qInfo() << "Module" << module << "is loaded";
         return true;
     }
+    return false;
+}
+
+void LinuxModSupport::checkModule(const QString &module,
+                                  std::function<void(bool)> callback)
+{
+    if(isModuleLoaded(module))
+    {
+        callback(true);
+        return;
+    }
+
     // Check if the module is available to load using modprobe.  This detects
     // loadable modules even if they aren't loaded, but can't detect built-in
     // modules.
-    if(Exec::cmd(QStringLiteral("modprobe"), {QStringLiteral("--show-depends"), module}) == 0)
-        return true;
+    QProcess *pModprobe = new QProcess{this};
+    auto complete = [pModprobe, module, callback](bool available)
+    {
+        qInfo() << "Module" << module << "available:" << available;
+        pModprobe->deleteLater();
+        callback(available);
+    };
+    connect(pModprobe, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [complete](int exitCode, QProcess::ExitStatus exitStatus)
+            {
+                complete(exitStatus == QProcess::NormalExit && exitCode == 0);
+            });
+    // finished() isn't emitted if the process can't be started
+    connect(pModprobe, &QProcess::errorOccurred, this,
+            [complete](QProcess::ProcessError error)
+            {
+                if(error == QProcess::FailedToStart)
+                    complete(false);
+            });
+    pModprobe->start(QStringLiteral("modprobe"),
+                     {QStringLiteral("--show-depends"), module});
+}
 
-    // Not available
-    return false;
+QString LinuxModSupport::modulesDepStamp() const
+{
+    QFileInfo modulesDep{_modulesDepPath};
+    if(!modulesDep.exists())
+        return {};
+    return QString::number(modulesDep.lastModified().toMSecsSinceEpoch());
 }
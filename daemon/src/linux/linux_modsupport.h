@@ -24,6 +24,7 @@
 
 #include <QFileSystemWatcher>
 #include <common/src/builtin/path.h>
+#include <functional>
 
 // LinuxModSupport detects whether the kernel has support for modules that can
 // be used by PIA (currently just 'wireguard').  It watches modules.dep to
@@ -39,8 +40,18 @@ private:
     void queueModulesUpdated();
 
 public:
-    // Test if a module is available (either built-in or loadable).
-    bool hasModule(const QString &module);
+    // Test if a module is loaded right now (including built-in modules).
+    // This only checks /sys/module; it doesn't run any commands.
+    bool isModuleLoaded(const QString &module);
+
+    // Test asynchronously whether a module is available (loaded, built-in, or
+    // loadable).  This runs modprobe if the module isn't loaded; the result is
+    // passed to callback when it completes.
+    void checkModule(const QString &module, std::function<void(bool)> callback);
+
+    // A stamp identifying the current modules.dep (its modification time),
+    // used to key cached module results.  Empty if modules.dep doesn't exist.
+    QString modulesDepStamp() const;
 
 signals:
     // The installed modules have been updated, re-check relevant modules.
@@ -26,6 +26,7 @@
 #include "linux_libnl.h"
 #include <QMetaObject>
 #include <cstring>
+#include <unordered_set>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -34,6 +35,29 @@
 class LinuxNl::Worker
 {
 private:
+    // State of one interface in the model
+    struct InterfaceState
+    {
+        // Lowest-metric default gateway route in the main table for each
+        // family on this interface, if there is one
+        bool hasRoute4{false};
+        std::uint32_t metric4{0};
+        kapps::core::Ipv4Address gateway4;
+        bool hasRoute6{false};
+        std::uint32_t metric6{0};
+        kapps::core::Ipv6Address gateway6;
+        // Whether the interface is known to nl80211
+        bool wifi{false};
+        // Addresses and link info, re-read when the interface is dirty
+        std::vector<std::pair<kapps::core::Ipv4Address, unsigned>> addressesIpv4;
+        std::vector<std::pair<kapps::core::Ipv6Address, unsigned>> addressesIpv6;
+        // Whether there were any IPv4/IPv6 address objects at all for this
+        // interface; interfaces with none aren't reported
+        bool hasAddrs{false};
+        QString name;
+        unsigned mtu{0};
+    };
+
     enum PollIdx : size_t
     {
         KillSocket,
@@ -51,8 +75,21 @@ public:
     explicit Worker(LinuxNl &parent, kapps::core::PosixFd killSocket);
 
 private:
-    // Read the current state of the caches and send state to main thread
-    void readCaches();
+    // Updates received for each cache - these only note what has to be
+    // re-read in updateNetworks().  Updates that can't affect the reported
+    // networks are ignored.
+    void linkUpdated(libnl::nl_object *pObj);
+    void addrUpdated(libnl::nl_object *pObj);
+    void routeUpdated(libnl::nl_object *pObj);
+
+    // Re-read the default gateway routes and the Wi-Fi interfaces (if they
+    // may have changed), then the addresses and link info of any interfaces
+    // that changed.  Interfaces that are no longer relevant are removed.
+    void updateInterfaces();
+
+    // Apply pending updates to the interface model, and send state to the
+    // main thread if the reported networks changed
+    void updateNetworks();
 
     // Wrappers to receive events for each socket - if revents is nonzero,
     // passes it to the appropriate socket, then checks for updates to the data
@@ -85,14 +122,28 @@ private:
     // nl80211 socket and cache - created dynamically when the nl80211 generic
     // netlink family is present.  This is nullptr when nl80211 isn't present.
     std::unique_ptr<LinuxNl80211Cache> _p80211Cache;
+    // Model of the interfaces relevant to network detection - those with a
+    // default gateway route in the main table, and Wi-Fi interfaces - by
+    // interface index.  On hosts running containers, there are often hundreds
+    // of other interfaces and routes that come and go; those don't affect the
+    // reported networks, so they aren't tracked at all.
+    std::unordered_map<int, InterfaceState> _interfaces;
+    // Interfaces whose addresses or link info have to be re-read
+    std::unordered_set<int> _dirtyInterfaces;
+    // Whether the default gateway routes or Wi-Fi interfaces have to be
+    // re-read.  Both are set initially to load the initial state.
+    bool _routesDirty;
+    bool _wifiDirty;
     // The last emitted connections are cached in order to ignore irrelevant/
-    // duplicate events.  These are sorted and checked in readCaches().
+    // duplicate events.  These are sorted and checked in updateNetworks().
     std::vector<NetworkConnection> _lastConnections;
 };
 
+bool isDefaultRoute(libnl::rtnl_route *pRoute);
+
 LinuxNl::Worker::Worker(LinuxNl &parent, kapps::core::PosixFd killSocket)
     : _parent{parent}, _pollCfgs{}, _killSocket{std::move(killSocket)},
-      _routeSock{NETLINK_ROUTE}
+      _routeSock{NETLINK_ROUTE}, _routesDirty{true}, _wifiDirty{true}
 {
     _pollCfgs[PollIdx::KillSocket].fd = _killSocket.get();
     _pollCfgs[PollIdx::RouteSocket].fd = _routeSock.getFd();
@@ -123,6 +174,22 @@ LinuxNl::Worker::Worker(LinuxNl &parent, kapps::core::PosixFd killSocket)
                                         RTNLGRP_DECnet_ROUTE}, // Just to stay in sync with libnl
                                        {RTM_NEWROUTE, RTM_DELROUTE, RTM_GETROUTE});
 
+    // Only default routes in the main table are used.  Other routes - for
+    // container networks, policy routing tables including PIA's own split
+    // tunnel tables, etc. - are never kept in the cache.  (Multipath default
+    // routes are kept; they aren't used as gateways, but a route could change
+    // between one and several next-hops.)
+    _pRouteCache->setFilter([](libnl::nl_object *pObj)
+    {
+        auto pRoute = reinterpret_cast<libnl::rtnl_route*>(pObj);
+        return libnl::rtnl_route_get_table(pRoute) == RT_TABLE_MAIN &&
+            isDefaultRoute(pRoute);
+    });
+
+    _pLinkCache->objectUpdated = [this](libnl::nl_object *pObj){linkUpdated(pObj);};
+    _pAddrCache->objectUpdated = [this](libnl::nl_object *pObj){addrUpdated(pObj);};
+    _pRouteCache->objectUpdated = [this](libnl::nl_object *pObj){routeUpdated(pObj);};
+
     // Don't report anything yet, because the _genlFamilies cache definitely
     // isn't ready yet (it fills asynchronously).  Note that older distributions
     // tend to report an "initial change" for the route cache immediately, but
@@ -242,25 +309,152 @@ libnl::nl_addr *getNlRouteGateway(libnl::rtnl_route *pRoute, int &ifIndex)
     return pGateway;
 }
 
-void LinuxNl::Worker::readCaches()
+void LinuxNl::Worker::linkUpdated(libnl::nl_object *pObj)
+{
+    // Name or MTU might have changed
+    int ifindex = libnl::rtnl_link_get_ifindex(reinterpret_cast<libnl::rtnl_link*>(pObj));
+    if(_interfaces.count(ifindex))
+        _dirtyInterfaces.insert(ifindex);
+}
+
+void LinuxNl::Worker::addrUpdated(libnl::nl_object *pObj)
 {
-    // The various pieces of data that we need are reported separately.
-    // Assemble them using interface IDs, then look up the interface IDs to find
-    // the interface names.
-    struct RawInterfaceData
+    int ifindex = libnl::rtnl_addr_get_ifindex(reinterpret_cast<libnl::rtnl_addr*>(pObj));
+    if(_interfaces.count(ifindex))
+        _dirtyInterfaces.insert(ifindex);
+}
+
+void LinuxNl::Worker::routeUpdated(libnl::nl_object *)
+{
+    // The route cache's filter only admits default routes in the main table,
+    // so any update is relevant
+    _routesDirty = true;
+}
+
+void LinuxNl::Worker::updateInterfaces()
+{
+    if(_routesDirty)
     {
-        // All of these objects are owned by the various netlink caches; these
-        // values are only held locally here in readCaches().  Any of these
-        // addresses can be nullptr.
-        std::vector<libnl::nl_addr*> _addrs4;
-        std::vector<libnl::nl_addr*> _addrs6;
-        libnl::nl_addr *_pIpv4Gateway;
-        libnl::nl_addr *_pIpv6Gateway;
-    };
+        for(auto &itf : _interfaces)
+        {
+            itf.second.hasRoute4 = false;
+            itf.second.hasRoute6 = false;
+        }
+
+        // Look for default gateway routes.  The route cache only contains
+        // default routes from the main table, and it's only walked again
+        // when one of them changed.
+        for(const auto &pObj : *_pRouteCache)
+        {
+            // These are rtnl_route objects
+            auto pRoute = reinterpret_cast<libnl::rtnl_route*>(pObj);
+
+            int ifindex{};
+            libnl::nl_addr *pGateway = getNlRouteGateway(pRoute, ifindex);
+            if(!pGateway)
+                continue;
+
+            // New interfaces need their addresses and link info read
+            auto itInterface = _interfaces.find(ifindex);
+            if(itInterface == _interfaces.end())
+            {
+                itInterface = _interfaces.emplace(ifindex, InterfaceState{}).first;
+                _dirtyInterfaces.insert(ifindex);
+            }
+            InterfaceState &itf = itInterface->second;
+
+            // Get the metric (called "priority" by the kernel, "metrics" are
+            // other parameters)
+            std::uint32_t metric = libnl::rtnl_route_get_priority(pRoute);
+            int family = libnl::rtnl_route_get_family(pRoute);
+            switch(family)
+            {
+                case AF_INET:
+                    if(!itf.hasRoute4 || metric < itf.metric4)
+                    {
+                        itf.hasRoute4 = true;
+                        itf.metric4 = metric;
+                        itf.gateway4 = readNlAddr4(pGateway);
+                    }
+                    break;
+                case AF_INET6:
+                    if(!itf.hasRoute6 || metric < itf.metric6)
+                    {
+                        itf.hasRoute6 = true;
+                        itf.metric6 = metric;
+                        itf.gateway6 = readNlAddr6(pGateway);
+                    }
+                    break;
+                default:
+                    // Something else, don't care
+                    break;
+            }
+        }
+        _routesDirty = false;
+    }
+
+    if(_wifiDirty)
+    {
+        for(auto &itf : _interfaces)
+            itf.second.wifi = false;
+
+        if(_p80211Cache)
+        {
+            for(const auto &wifiItf : _p80211Cache->interfaces())
+            {
+                int ifindex = static_cast<int>(wifiItf.first);
+                auto itInterface = _interfaces.find(ifindex);
+                if(itInterface == _interfaces.end())
+                {
+                    itInterface = _interfaces.emplace(ifindex, InterfaceState{}).first;
+                    _dirtyInterfaces.insert(ifindex);
+                }
+                itInterface->second.wifi = true;
+            }
+        }
+        _wifiDirty = false;
+    }
+
+    // Drop interfaces that are no longer relevant
+    auto itInterface = _interfaces.begin();
+    while(itInterface != _interfaces.end())
+    {
+        const InterfaceState &itf = itInterface->second;
+        if(!itf.hasRoute4 && !itf.hasRoute6 && !itf.wifi)
+        {
+            _dirtyInterfaces.erase(itInterface->first);
+            itInterface = _interfaces.erase(itInterface);
+        }
+        else
+            ++itInterface;
+    }
+
+    if(_dirtyInterfaces.empty())
+        return;
+
+    for(int ifindex : _dirtyInterfaces)
+    {
+        InterfaceState &itf = _interfaces[ifindex];
+        itf.addressesIpv4.clear();
+        itf.addressesIpv6.clear();
+        itf.hasAddrs = false;
+
+        // Look up the link using the interface index to get the interface name
+        // This retains the link, so we have to release it later
+        NlUniquePtr<libnl::rtnl_link> pItfLink{libnl::rtnl_link_get(_pLinkCache->get(), ifindex)};
+        if(pItfLink)
+        {
+            itf.name = QString::fromUtf8(libnl::rtnl_link_get_name(pItfLink.get()));
+            itf.mtu = libnl::rtnl_link_get_mtu(pItfLink.get());
+        }
+        else
+        {
+            itf.name.clear();
+            itf.mtu = 0;
+        }
+    }
 
-    // Keys are interface IDs.
-    std::unordered_map<int, RawInterfaceData> interfaceAddrs;
-    interfaceAddrs.reserve(_pAddrCache->count());   // Reserve using this upper bound
+    // Read the addresses of the dirty interfaces in one pass
     for(const auto &pObj : *_pAddrCache)
     {
         // libnl uses crude "declare all the same members" inheritance, these
@@ -269,6 +463,10 @@ void LinuxNl::Worker::readCaches()
 
         // Get the interface index
         int ifindex = libnl::rtnl_addr_get_ifindex(pAddr);
+        if(!_dirtyInterfaces.count(ifindex))
+            continue;
+        InterfaceState &itf = _interfaces[ifindex];
+
         // Get the local address
         libnl::nl_addr *pLocal = libnl::rtnl_addr_get_local(pAddr);
         // Is it IPv4 or IPv6?
@@ -276,77 +474,73 @@ void LinuxNl::Worker::readCaches()
         switch(family)
         {
             case AF_INET:
-                interfaceAddrs[ifindex]._addrs4.push_back(pLocal);
+            {
+                itf.hasAddrs = true;
+                kapps::core::Ipv4Address addr4 = readNlAddr4(pLocal);
+                if(addr4 != kapps::core::Ipv4Address{})
+                    itf.addressesIpv4.push_back({addr4, libnl::nl_addr_get_prefixlen(pLocal)});
                 break;
+            }
             case AF_INET6:
-                interfaceAddrs[ifindex]._addrs6.push_back(pLocal);
+            {
+                itf.hasAddrs = true;
+                kapps::core::Ipv6Address addr6 = readNlAddr6(pLocal);
+                if(addr6 != kapps::core::Ipv6Address{})
+                    itf.addressesIpv6.push_back({addr6, libnl::nl_addr_get_prefixlen(pLocal)});
                 break;
+            }
             default:
                 // Something else, don't care
                 break;
         }
     }
 
-    // Keep track of the default route with the lowest metric to determine the
-    // default interface, for each of IPv4 and IPv6.
+    _dirtyInterfaces.clear();
+}
+
+void LinuxNl::Worker::updateNetworks()
+{
+    // If nothing relevant changed, there's nothing to do.  Most updates on
+    // the route socket are ignored here.
+    if(!_routesDirty && !_wifiDirty && _dirtyInterfaces.empty())
+        return;
+
+    updateInterfaces();
+
+    // Find the default route with the lowest metric to determine the default
+    // interface, for each of IPv4 and IPv6.
+    //
+    // It does sometimes happen that we get routes from libnl for interfaces
+    // that no longer exist.  Specifically, this has been observed with a USB
+    // Ethernet adapter by unplugging USB while it is connected to a network.
+    //
+    // It seems the IPv4 gateway route is removed in this case (the kernel no
+    // longer returns it in dumps), but no "delete route" notification is sent.
+    // (The IPv6 gateway route deletion is sent correctly.)  It's not clear why
+    // this happens, but the route no longer matters anyway since the
+    // interface is gone - the interface's addresses are gone, so it's ignored
+    // here.
     struct DefaultGateway
     {
         std::uint32_t metric;
         int ifindex; // -1 indicates we haven't observed a default route yet
     } lowestGateway4{0, -1}, lowestGateway6{0, -1};
-
-    // Look for default gateway routes and add them to the connection info
-    for(const auto &pObj : *_pRouteCache)
+    for(const auto &itf : _interfaces)
     {
-        // These are rtnl_route objects
-        auto pRoute = reinterpret_cast<libnl::rtnl_route*>(pObj);
-
-        int ifindex{};
-        libnl::nl_addr *pGateway = getNlRouteGateway(pRoute, ifindex);
-
-        if(!pGateway)
-            continue;
-
-        auto itItfAddrs = interfaceAddrs.find(ifindex);
-        // It does sometimes happen that we get routes from libnl for
-        // interfaces that no longer exist.  Specifically, this has been
-        // observed with a USB Ethernet adapter by unplugging USB while it
-        // is connected to a network.
-        //
-        // It seems the IPv4 gateway route is removed in this case (the
-        // kernel no longer returns it in dumps), but no "delete route"
-        // notification is sent.  (The IPv6 gateway route deletion is sent
-        // correctly.)  It's not clear why this happens, but the route no
-        // longer matters anyway since the interface is gone, and libnl
-        // resyncs the next time it dumps IPv4 routes (which happens pretty
-        // frequently), so it should not cause accumulation of memory even
-        // if it happens a lot.
-        if(itItfAddrs == interfaceAddrs.end())
+        if(!itf.second.hasAddrs)
             continue;
-
-        // Get the metric (called "priority" by the kernel, "metrics" are other
-        // parameters)
-        std::uint32_t metric = libnl::rtnl_route_get_priority(pRoute);
-        int family = libnl::rtnl_route_get_family(pRoute);
-        switch(family)
+        if(itf.second.hasRoute4 &&
+            (lowestGateway4.ifindex == -1 || itf.second.metric4 < lowestGateway4.metric))
         {
-            case AF_INET:
-                itItfAddrs->second._pIpv4Gateway = pGateway;
-                if(lowestGateway4.ifindex == -1 || metric < lowestGateway4.metric)
-                    lowestGateway4 = {metric, ifindex};
-                break;
-            case AF_INET6:
-                itItfAddrs->second._pIpv6Gateway = pGateway;
-                if(lowestGateway6.ifindex == -1 || metric < lowestGateway6.metric)
-                    lowestGateway6 = {metric, ifindex};
-                break;
-            default:
-                // Something else, don't care
-                break;
+            lowestGateway4 = {itf.second.metric4, itf.first};
+        }
+        if(itf.second.hasRoute6 &&
+            (lowestGateway6.ifindex == -1 || itf.second.metric6 < lowestGateway6.metric))
+        {
+            lowestGateway6 = {itf.second.metric6, itf.first};
         }
     }
 
-    // Get the nl80211 state too
     // emptyWifi is used as a default if the 802.11 cache hasn't been created
     // (because the nl80211 family doesn't exist yet in the kernel)
     static const std::map<std::uint32_t, LinuxNl80211Cache::WifiStatus> emptyWifi{};
@@ -354,54 +548,28 @@ void LinuxNl::Worker::readCaches()
 
     // Build NetworkConnection objects
     std::vector<NetworkConnection> connections;
-    connections.reserve(interfaceAddrs.size());
-    for(const auto &itfAddrs : interfaceAddrs)
+    connections.reserve(_interfaces.size());
+    for(const auto &itf : _interfaces)
     {
-        // Look up the link using the interface index to get the interface name
-        // This retains the link, so we have to release it later
-        NlUniquePtr<libnl::rtnl_link> pItfLink{libnl::rtnl_link_get(_pLinkCache->get(), itfAddrs.first)};
-        QString itfName;
-        unsigned mtu{0};
-        if(pItfLink)
-        {
-            itfName = QString::fromUtf8(libnl::rtnl_link_get_name(pItfLink.get()));
-            mtu = libnl::rtnl_link_get_mtu(pItfLink.get());
-        }
-
-        std::vector<std::pair<kapps::core::Ipv4Address, unsigned>> addressesIpv4;
-        addressesIpv4.reserve(itfAddrs.second._addrs4.size());
-        for(const auto &pNlAddr4 : itfAddrs.second._addrs4)
-        {
-            kapps::core::Ipv4Address addr4 = readNlAddr4(pNlAddr4);
-            if(addr4 != kapps::core::Ipv4Address{})
-                addressesIpv4.push_back({addr4, libnl::nl_addr_get_prefixlen(pNlAddr4)});
-        }
-
-        std::vector<std::pair<kapps::core::Ipv6Address, unsigned>> addressesIpv6;
-        addressesIpv6.reserve(itfAddrs.second._addrs6.size());
-        for(const auto &pNlAddr6 : itfAddrs.second._addrs6)
-        {
-            kapps::core::Ipv6Address addr6 = readNlAddr6(pNlAddr6);
-            if(addr6 != kapps::core::Ipv6Address{})
-                addressesIpv6.push_back({addr6, libnl::nl_addr_get_prefixlen(pNlAddr6)});
-        }
+        if(!itf.second.hasAddrs)
+            continue;
 
         // Linux does not have separate IPv4 and IPv6 MTUs; it's just set once
         // for the link.
-        connections.push_back(NetworkConnection{itfName,
+        connections.push_back(NetworkConnection{itf.second.name,
                                                 NetworkConnection::Medium::Unknown,
-                                                itfAddrs.first == lowestGateway4.ifindex,
-                                                itfAddrs.first == lowestGateway6.ifindex,
-                                                readNlAddr4(itfAddrs.second._pIpv4Gateway),
-                                                readNlAddr6(itfAddrs.second._pIpv6Gateway),
-                                                std::move(addressesIpv4),
-                                                std::move(addressesIpv6),
-                                                mtu, mtu});
+                                                itf.first == lowestGateway4.ifindex,
+                                                itf.first == lowestGateway6.ifindex,
+                                                itf.second.hasRoute4 ? itf.second.gateway4 : kapps::core::Ipv4Address{},
+                                                itf.second.hasRoute6 ? itf.second.gateway6 : kapps::core::Ipv6Address{},
+                                                itf.second.addressesIpv4,
+                                                itf.second.addressesIpv6,
+                                                itf.second.mtu, itf.second.mtu});
 
         // If the interface is known to nl80211, it's a Wi-Fi interface.
         // Otherwise, assume that it's wired.  This isn't precisely correct for
         // other interfaces like cellular modems, etc., but it's reasonable.
-        auto itWifi = wifiInterfaces.find(itfAddrs.first);
+        auto itWifi = wifiInterfaces.find(static_cast<std::uint32_t>(itf.first));
         if(itWifi == wifiInterfaces.end())
         {
             connections.back().medium(NetworkConnection::Medium::Wired);
@@ -412,17 +580,16 @@ void LinuxNl::Worker::readCaches()
             if(itWifi->second.associated)
             {
                 connections.back().wifiAssociated(true);
-                connections.back().parseWifiSsid(reinterpret_cast<const char *>(itWifi->second.ssid),
-                                                itWifi->second.ssidLength);
+                // The SSID was already decoded by LinuxNl80211Cache
+                connections.back().wifiSsid(itWifi->second.ssidText);
                 connections.back().wifiEncrypted(itWifi->second.encrypted);
             }
         }
     }
 
     // If the set of network connections hasn't changed, ignore this update.
-    // We seem to get a lot of irrelevant traffic on the route socket, so this
-    // is important to ignore all those updates, in particular to avoid
-    // generating lots of noise in logs.
+    // A relevant interface can still change in ways that don't matter, like
+    // an address lifetime being refreshed.
     std::sort(connections.begin(), connections.end());
     if(connections == _lastConnections)
     {
@@ -497,6 +664,7 @@ void LinuxNl::Worker::receiveGenlFamilies(short &revents)
             // nl80211 or config group is gone, or IDs changed, destroy cache
             _p80211Cache.reset();
             _pollCfgs[PollIdx::Nl80211Socket].fd = kapps::core::PosixFd::Invalid;
+            _wifiDirty = true;
         }
     }
 
@@ -511,6 +679,7 @@ void LinuxNl::Worker::receiveGenlFamilies(short &revents)
                                                     configGroupId,
                                                     mlmeGroupId});
         _pollCfgs[PollIdx::Nl80211Socket].fd = _p80211Cache->getFd();
+        _wifiDirty = true;
     }
 }
 
@@ -523,6 +692,7 @@ void LinuxNl::Worker::receiveNl80211(short &revents)
     {
         qInfo() << "Receiving nl80211 events";
         _p80211Cache->receive(revents);
+        _wifiDirty = true;
     }
     revents = 0;
 }
@@ -567,7 +737,7 @@ bool LinuxNl::Worker::receive()
         else
         {
             // Everything is ready, report
-            readCaches();
+            updateNetworks();
         }
     }
     else if(errno != EINTR)
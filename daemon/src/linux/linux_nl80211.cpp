@@ -19,6 +19,7 @@
 #include <common/src/common.h>
 #include "linux_nl80211.h"
 #include "linux_libnl.h"
+#include "../networkmonitor.h"
 #include <array>
 #include <algorithm>
 
@@ -125,6 +126,39 @@ void LinuxNl80211Cache::requestScanDump(std::uint32_t interface)
     _dumpProgress = DumpProgress::ReceivingScans;
 }
 
+void LinuxNl80211Cache::requestPendingScanDumps()
+{
+    // Only when no dump is needed or occurring, checked by caller
+    Q_ASSERT(_pendingDump == PendingDumpRequest::None);
+    Q_ASSERT(_dumpProgress == DumpProgress::Inactive);
+    Q_ASSERT(_receivingInterfaces.empty());
+
+    // Start from the current state; only the pending interfaces are replaced
+    _receivingInterfaces = _interfaces;
+    _scanQueue.clear();
+    for(std::uint32_t ifindex : _pendingScans)
+    {
+        auto itItf = _receivingInterfaces.find(ifindex);
+        if(itItf != _receivingInterfaces.end())
+        {
+            itItf->second = {};
+            _scanQueue.insert(ifindex);
+        }
+    }
+    _pendingScans.clear();
+
+    if(_scanQueue.empty())
+    {
+        _receivingInterfaces.clear();
+        return;
+    }
+
+    qInfo() << "Re-dumping scans for" << _scanQueue.size() << "interfaces";
+    _dumpProgress = DumpProgress::ReceivingScans;
+    _receivingScanInterface = *_scanQueue.begin();
+    requestScanDump(_receivingScanInterface);
+}
+
 void LinuxNl80211Cache::parseInterfaceMsg(libnl::nlattr **attrs)
 {
     std::uint32_t ifindex{};
@@ -286,6 +320,16 @@ void LinuxNl80211Cache::parseScanMsg(
         }
     }
 
+    if(newStatus.ssidLength)
+    {
+        // Decode the SSID now, so it isn't decoded again each time networks
+        // are reported
+        NetworkConnection decoded;
+        decoded.parseWifiSsid(reinterpret_cast<const char *>(newStatus.ssid),
+                              newStatus.ssidLength);
+        newStatus.ssidText = decoded.wifiSsid();
+    }
+
     qInfo() << "Found associated BSS for interface" << _receivingScanInterface
         << "- enc:" << newStatus.encrypted << "- ssid:"
         << QString::fromLatin1(QByteArray::fromRawData(reinterpret_cast<const char *>(newStatus.ssid), newStatus.ssidLength).toPercentEncoding());
@@ -348,24 +392,45 @@ int LinuxNl80211Cache::handleMsg(libnl::nl_msg *pMsg)
         //
         // NetworkManager seems to poll every second or so when it expects
         // changes; these dumps should at least be less overhead than that.
+        //
+        // If the event is for a known interface, only that interface's scan is
+        // dumped again.
         case NL80211_CMD_AUTHENTICATE:
         case NL80211_CMD_ASSOCIATE:
         case NL80211_CMD_DEAUTHENTICATE:
         case NL80211_CMD_DISASSOCIATE:
         case NL80211_CMD_CONNECT:
         case NL80211_CMD_DISCONNECT:
-            // We need a new dump
-            if(_pendingDump == PendingDumpRequest::None)
+        case NL80211_CMD_ROAM:
+        {
+            std::array<libnl::nlattr*, nl80211Attrs.ifaceAttrs().size()> attrs{};
+            auto parseErr = libnl::nlmsg_parse(pHeader, GENL_HDRLEN, attrs.data(),
+                                               attrs.size()-1,
+                                               nl80211Attrs.ifaceAttrs().data());
+            std::uint32_t ifindex{};
+            if(parseErr >= 0 && attrs[NL80211_ATTR_IFINDEX])
+                ifindex = libnl::nla_get_u32(attrs[NL80211_ATTR_IFINDEX]);
+
+            // If a complete dump is already needed, it'll pick up this change
+            if(_pendingDump != PendingDumpRequest::None)
             {
-                qInfo() << "Request interface dump due to event" << pGenHeader->cmd;
-                _pendingDump = PendingDumpRequest::Needed;
+                qInfo() << "No dump needed for event" << pGenHeader->cmd
+                    << "- already in state" << traceEnum(_pendingDump);
+            }
+            else if(ifindex && _interfaces.count(ifindex))
+            {
+                qInfo() << "Request scan dump for interface" << ifindex
+                    << "due to event" << pGenHeader->cmd;
+                _pendingScans.insert(ifindex);
             }
             else
             {
-                qInfo() << "No dump needed for event" << pGenHeader->cmd
-                    << "- already in state" << traceEnum(_pendingDump);
+                qInfo() << "Request interface dump due to event" << pGenHeader->cmd
+                    << "for interface" << ifindex;
+                _pendingDump = PendingDumpRequest::Needed;
             }
             break;
+        }
         case NL80211_CMD_NEW_SCAN_RESULTS:
         {
             // Parse the scan attributes at the top level
@@ -428,14 +493,20 @@ int LinuxNl80211Cache::handleFinish(libnl::nl_msg *)
                 << _receivingInterfaces.size()
                 << "interfaces, check each interface";
             _receivingScanInterface = 0;
+            _scanQueue.clear();
+            for(const auto &itf : _receivingInterfaces)
+                _scanQueue.insert(itf.first);
+            // All interfaces are about to be scanned, which covers any events
+            // received so far
+            _pendingScans.clear();
             [[fallthrough]];
         case DumpProgress::ReceivingScans:
         {
-            // Find the next interface index (note that this is an ordered map)
-            auto itNextItf = _receivingInterfaces.upper_bound(_receivingScanInterface);
-            if(itNextItf != _receivingInterfaces.end())
+            // Find the next interface index (note that this is an ordered set)
+            auto itNextItf = _scanQueue.upper_bound(_receivingScanInterface);
+            if(itNextItf != _scanQueue.end())
             {
-                _receivingScanInterface = itNextItf->first;
+                _receivingScanInterface = *itNextItf;
                 requestScanDump(_receivingScanInterface);
             }
             else
@@ -443,6 +514,7 @@ int LinuxNl80211Cache::handleFinish(libnl::nl_msg *)
                 // No more interfaces, publish new results
                 _interfaces.swap(_receivingInterfaces);
                 _receivingInterfaces.clear();
+                _scanQueue.clear();
                 qInfo() << "Scan dump completed with" << _interfaces.size()
                     << "interfaces";
                 // We're done, go to Inactive.  It's possible that another dump
@@ -486,4 +558,16 @@ void LinuxNl80211Cache::handleMsgBatchEnd()
             requestInterfaceDump();
         }
     }
+    else if(!_pendingScans.empty())
+    {
+        // Like complete dumps, wait for any ongoing dump to complete
+        if(_dumpProgress != DumpProgress::Inactive || inDump())
+        {
+            qInfo() << "Scan dump has been requested but an ongoing dump hasn't completed, wait to send deferred request";
+        }
+        else
+        {
+            requestPendingScanDumps();
+        }
+    }
 }
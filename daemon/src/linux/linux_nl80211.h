@@ -22,6 +22,8 @@
 #include <common/src/common.h>
 #include "linux_nlcache.h"
 #include "linux_libnl.h"
+#include <QString>
+#include <set>
 
 // LinuxNl80211Cache caches nl80211 config objects.  It uses a LinuxNlNtfSock to
 // receive updates - it can't use LinuxNlCacheSock because libnl doesn't provide
@@ -112,6 +114,10 @@ public:
         unsigned char ssid[SsidMaxLen];
         // Whether the network is encrypted (when associated).
         bool encrypted;
+        // The SSID decoded as text (see NetworkConnection::parseWifiSsid()).
+        // This is decoded once when the scan is received, not each time the
+        // networks are reported.  Empty if the SSID can't be represented.
+        QString ssidText;
     };
 
 public:
@@ -120,6 +126,9 @@ public:
 private:
     void requestInterfaceDump();
     void requestScanDump(std::uint32_t interface);
+    // Re-dump the scans for the interfaces in _pendingScans only, keeping the
+    // state of all other interfaces
+    void requestPendingScanDumps();
 
     // Parse and apply a netlink message.
     void parseInterfaceMsg(libnl::nlattr **attrs);
@@ -168,10 +177,17 @@ private:
     // When dumps are occurring, this is the new interface state we're filling
     // out.  This pivots over to _interfaces when the dump completes.
     std::map<std::uint32_t, WifiStatus> _receivingInterfaces;
+    // Interfaces whose scans are dumped in the current dump - all interfaces
+    // for a complete dump, or just the interfaces that had events otherwise.
+    std::set<std::uint32_t> _scanQueue;
     // When receiving scans for the current dump, this is the interface index
     // that is currently being received.  When this one completes, we'll find
-    // the next interface in _receivingInterfaces and then scan it.
+    // the next interface in _scanQueue and then scan it.
     std::uint32_t _receivingScanInterface;
+    // Known interfaces that had connection events and need their scans
+    // dumped again.  Events for a known interface only re-dump that
+    // interface's scan, rather than re-dumping all interfaces and scans.
+    std::set<std::uint32_t> _pendingScans;
 };
 
 #endif
@@ -307,6 +307,10 @@ LinuxNlCache::~LinuxNlCache()
 void LinuxNlCache::cache_include(libnl::nl_object *pObj)
 {
     Q_ASSERT(pObj); // Checked by caller
+    if(_filter && !_filter(pObj))
+        return;
+    if(objectUpdated)
+        objectUpdated(pObj);
     int libnlErr = libnl::nl_cache_include(_pCache.get(), pObj, nullptr, nullptr);
     LibnlError::checkRet(libnlErr, HERE, "Unable to apply update to cache");
 }
@@ -319,6 +323,38 @@ void LinuxNlCache::refill()
 
     auto libnlErr = libnl::nl_cache_refill(reqSock.get(), _pCache.get());
     LibnlError::checkRet(libnlErr, HERE, "Unable to fill cache");
+
+    removeFiltered();
+}
+
+void LinuxNlCache::setFilter(std::function<bool(libnl::nl_object*)> filter)
+{
+    _filter = std::move(filter);
+    removeFiltered();
+}
+
+void LinuxNlCache::removeFiltered()
+{
+    if(!_filter)
+        return;
+
+    std::size_t removed{0};
+    libnl::nl_object *pObj = libnl::nl_cache_get_first(_pCache.get());
+    while(pObj)
+    {
+        // Get the next object before removing this one - removing it drops
+        // the cache's reference, which may destroy it
+        libnl::nl_object *pNextObj = libnl::nl_cache_get_next(pObj);
+        if(!_filter(pObj))
+        {
+            libnl::nl_cache_remove(pObj);
+            ++removed;
+        }
+        pObj = pNextObj;
+    }
+
+    if(removed)
+        qInfo() << "Removed" << removed << "filtered objects from cache";
 }
 
 std::size_t LinuxNlCache::count()
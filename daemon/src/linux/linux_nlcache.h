@@ -20,6 +20,7 @@
 #define LINUX_NLCACHE_H
 
 #include <common/src/common.h>
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include "linux_libnl.h"
@@ -298,9 +299,20 @@ public:
     void cache_include(libnl::nl_object *pObj);
 
     // Refill the cache - request a new dump from the kernel.  Called
-    // automatically in constructor
+    // automatically in constructor.  Objects rejected by the filter are
+    // removed after the dump.
     void refill();
 
+    // Set a filter to limit the objects kept in the cache.  Updates for
+    // objects that the filter rejects are dropped before they're applied to
+    // the cache (and objectUpdated isn't called for them), and any rejected
+    // objects already in the cache are removed now.
+    //
+    // libnl's dump requests can't be limited by table, etc., so this is done
+    // in userspace, but it still keeps the cache (and anything walking it)
+    // small when the kernel has many objects we don't care about.
+    void setFilter(std::function<bool(libnl::nl_object*)> filter);
+
     // Get the count of items in the cache
     std::size_t count();
 
@@ -315,17 +327,32 @@ public:
     // Dump summary of cache to qInfo()
     void dumpSummary() const;
 
+    // Called by cache_include() with each update received, before it's
+    // applied to the cache.  The object is the parsed update; for a deletion
+    // it still has the key fields of the deleted object.  This lets the owner
+    // follow individual changes without re-reading the whole cache.
+    //
+    // Not called for the initial fill or a refill(), or for updates rejected
+    // by the filter.
+    std::function<void(libnl::nl_object*)> objectUpdated;
+
     // Get the raw nl_cache* - for use with type-specific cache operations when
     // you know the type of the cache.
     // The nl_cache* is still owned by LinuxNlCache and isn't retained by this
     // call.
     libnl::nl_cache *get() {Q_ASSERT(_pCache); return _pCache.get();}
 
+private:
+    // Remove objects rejected by _filter from the cache
+    void removeFiltered();
+
 private:
     // The libnl cache object - always valid.
     NlUniquePtr<libnl::nl_cache> _pCache;
     // Whether the cache has been provided as a shared cache (with provide())
     bool _provided;
+    // Filter set with setFilter(), if any
+    std::function<bool(libnl::nl_object*)> _filter;
     int _netlinkFamily;
 };
 
@@ -0,0 +1,114 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+#include <common/src/common.h>
+#line SOURCE_FILE("linux_probecache.cpp")
+
+#include "linux_probecache.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <sys/utsname.h>
+
+namespace
+{
+    const QString hostKeyName{QStringLiteral("host")};
+    const QString resultsName{QStringLiteral("results")};
+    const QString keyName{QStringLiteral("key")};
+    const QString valueName{QStringLiteral("value")};
+
+    QString buildHostKey()
+    {
+        utsname kernelName{};
+        uname(&kernelName);
+
+        QFile bootIdFile{QStringLiteral("/proc/sys/kernel/random/boot_id")};
+        QByteArray bootId;
+        if(bootIdFile.open(QIODevice::ReadOnly))
+            bootId = bootIdFile.readAll().trimmed();
+
+        // If the boot ID can't be read, don't use the cache at all - we
+        // couldn't tell if the results are from a prior boot
+        if(bootId.isEmpty())
+        {
+            qWarning() << "Unable to read boot ID, probe results won't be cached";
+            return {};
+        }
+
+        return QString::fromUtf8(kernelName.release) + QLatin1Char('/') +
+            QString::fromLatin1(bootId);
+    }
+}
+
+LinuxProbeCache::LinuxProbeCache()
+    : _cachePath{Path::DaemonDataDir / QStringLiteral("probecache.json")},
+      _hostKey{buildHostKey()}
+{
+    if(_hostKey.isEmpty())
+        return;
+
+    QFile cacheFile{_cachePath};
+    if(!cacheFile.open(QIODevice::ReadOnly))
+        return;
+
+    QJsonObject cache = QJsonDocument::fromJson(cacheFile.readAll()).object();
+    if(cache.value(hostKeyName).toString() != _hostKey)
+    {
+        qInfo() << "Discarding probe results from" << cache.value(hostKeyName).toString()
+            << "- now" << _hostKey;
+        return;
+    }
+
+    _results = cache.value(resultsName).toObject();
+    qInfo() << "Loaded" << _results.size() << "cached probe results";
+}
+
+QJsonValue LinuxProbeCache::get(const QString &name, const QString &key) const
+{
+    QJsonObject result = _results.value(name).toObject();
+    if(result.isEmpty() || result.value(keyName).toString() != key)
+        return QJsonValue::Undefined;
+    return result.value(valueName);
+}
+
+void LinuxProbeCache::set(const QString &name, const QJsonValue &value,
+                          const QString &key)
+{
+    if(_hostKey.isEmpty())
+        return;
+
+    QJsonObject result{{keyName, key}, {valueName, value}};
+    if(_results.value(name).toObject() == result)
+        return;
+
+    _results.insert(name, result);
+    write();
+}
+
+void LinuxProbeCache::write() const
+{
+    QJsonObject cache{{hostKeyName, _hostKey}, {resultsName, _results}};
+
+    QSaveFile cacheFile{_cachePath};
+    if(!cacheFile.open(QIODevice::WriteOnly) ||
+       cacheFile.write(QJsonDocument{cache}.toJson(QJsonDocument::Compact)) < 0 ||
+       !cacheFile.commit())
+    {
+        qWarning() << "Unable to write probe cache" << _cachePath << "-"
+            << cacheFile.errorString();
+    }
+}
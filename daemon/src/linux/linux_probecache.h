@@ -0,0 +1,60 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+#include <common/src/common.h>
+#line HEADER_FILE("linux_probecache.h")
+
+#ifndef LINUX_PROBECACHE_H
+#define LINUX_PROBECACHE_H
+
+#include <common/src/builtin/path.h>
+#include <QJsonObject>
+#include <QJsonValue>
+
+// LinuxProbeCache persists the results of host feature probes (kernel
+// modules, iptables version, etc.) across daemon restarts, so the last
+// results can be used immediately at startup while the probes are re-run
+// asynchronously.
+//
+// The cache is only valid for the same kernel release and boot (boot_id); it's
+// discarded if either changes.  Each result can also have its own key for
+// other inputs that might change within a boot, like modules.dep.
+class LinuxProbeCache
+{
+public:
+    // Loads the cache file, if it's valid for this kernel and boot.
+    LinuxProbeCache();
+
+public:
+    // Get a cached result.  Returns an undefined value if there's no result
+    // for this name, or if it was stored with a different key.
+    QJsonValue get(const QString &name, const QString &key = {}) const;
+    // Store a result, and write the cache file if it changed.
+    void set(const QString &name, const QJsonValue &value,
+             const QString &key = {});
+
+private:
+    void write() const;
+
+private:
+    Path _cachePath;
+    // Kernel release and boot ID - the cache is valid only if these match
+    QString _hostKey;
+    QJsonObject _results;
+};
+
+#endif
@@ -105,6 +105,24 @@ auto WireguardKernelBackend::getStatus() -> Async<WgDevPtr>
     return Async<WgDevPtr>::resolve(pDev);
 }
 
+Async<void> WireguardKernelBackend::reconfigure(const wg_device &wgDev)
+{
+    // wg_set_device() doesn't modify the device, but it isn't const; the
+    // peers are only referenced, not copied
+    wg_device dev{wgDev};
+    std::memset(dev.name, 0, sizeof(dev.name));
+    std::strncpy(dev.name, interfaceName.data(), sizeof(dev.name)-1);
+
+    int err = ::wg_set_device(&dev);
+    if(err)
+    {
+        qWarning() << "Can't reconfigure device" << interfaceName << "- error"
+            << err;
+        return Async<void>::reject({HERE, Error::Code::WireguardConfigDeviceFailed});
+    }
+    return Async<void>::resolve();
+}
+
 Async<void> WireguardKernelBackend::shutdown()
 {
     // There's no asynchronous shutdown to do for the kernel backend; the
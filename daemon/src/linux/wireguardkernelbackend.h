@@ -48,6 +48,8 @@ public:
         -> Async<std::shared_ptr<NetworkAdapter>> override;
     virtual Async<WgDevPtr> getStatus() override;
     virtual Async<void> shutdown() override;
+    virtual bool canReconfigure() const override {return _created;}
+    virtual Async<void> reconfigure(const wg_device &wgDev) override;
 
 private:
     // Whether we have created an interface - just indicates whether we should
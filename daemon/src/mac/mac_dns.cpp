@@ -20,18 +20,30 @@
 #line SOURCE_FILE("mac_dns.cpp")
 
 #include "mac_dns.h"
+#include <common/src/wakeupaccounting.h>
 #include <common/src/builtin/path.h>
 #include <common/src/exec.h>
 
+namespace
+{
+    // How long to wait for further configuration changes before invoking the
+    // DNS helper
+    const std::chrono::milliseconds checkDelay{100};
+}
+
 MacDns::MacDns()
 {
+    _checkTimer.setSingleShot(true);
+    _checkTimer.setInterval(msec(checkDelay));
+    tagWakeups(_checkTimer, QByteArrayLiteral("macdns"));
+    connect(&_checkTimer, &QTimer::timeout, this, &MacDns::checkConfiguration);
+
     connect(&_dynStore, &MacDynamicStore::keysChanged, this,
-        []()
+        [this]()
         {
-            qInfo() << "System configuration changed, invoke DNS helper to re-check";
-            QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-            env.insert("script_type", "watch-notify");
-            Exec::cmdWithEnv(Path::OpenVPNUpDownScript, {}, env);
+            // If a check is already pending, it will observe this change too
+            if(!_checkTimer.isActive())
+                _checkTimer.start();
         });
 
     // In addition to DNS state, the helper script also detects the primary
@@ -52,4 +64,13 @@ void MacDns::enableMonitor()
 void MacDns::disableMonitor()
 {
     _dynStore.setNotificationKeys(nullptr, nullptr);
+    _checkTimer.stop();
+}
+
+void MacDns::checkConfiguration()
+{
+    qInfo() << "System configuration changed, invoke DNS helper to re-check";
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert("script_type", "watch-notify");
+    Exec::cmdWithEnv(Path::OpenVPNUpDownScript, {}, env);
 }
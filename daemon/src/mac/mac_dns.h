@@ -24,6 +24,7 @@
 
 #include "mac_dynstore.h"
 #include "mac_objects.h"
+#include <QTimer>
 
 // MacDns is used to monitors for changes to the DNS configuration on MacOS and
 // restores PIA's configuration.  (MacOS tends to overwrite the DNS
@@ -42,9 +43,17 @@ public:
     void enableMonitor();
     void disableMonitor();
 
+private:
+    // Invoke the DNS helper to check and reapply the configuration
+    void checkConfiguration();
+
 private:
     MacDynamicStore _dynStore;
     MacArray _monitorKeyRegexes;
+    // Changes to the configuration usually arrive as several notifications
+    // (the DNS state, DNS setup, and IPv4 keys are rewritten together), so the
+    // helper check is deferred briefly to handle a burst with one check.
+    QTimer _checkTimer;
 };
 
 #endif
@@ -17,6 +17,17 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "net_extension_checker.h"
+#include <common/src/builtin/util.h>
+#include <algorithm>
+
+namespace
+{
+    // Once the installed state has been stable for a while, checks back off
+    // up to this interval.  Each check spawns two processes, so there's no
+    // reason to keep checking every minute indefinitely.
+    const std::chrono::minutes maxStableInterval{15};
+}
+
 NetExtensionChecker::NetExtensionChecker(std::string transparentProxyCliExecutable,
                                          std::chrono::milliseconds shortInterval,
                                          std::chrono::milliseconds longInterval)
@@ -60,6 +71,27 @@ void NetExtensionChecker::updateTimer(StateModel::NetExtensionState installState
     _timer.setInterval(newInterval);
 }
 
+void NetExtensionChecker::backOff()
+{
+    // Double the interval after each check that finds no change.  While not
+    // installed, this backs off to the long interval - a user installing the
+    // extension right now gets quick feedback, but we don't keep checking
+    // every few seconds if they never do.  Once installed, back off up to
+    // maxStableInterval.
+    std::chrono::milliseconds maxInterval = _longInterval;
+    if(_lastState == StateModel::NetExtensionState::Installed)
+        maxInterval = std::max<std::chrono::milliseconds>(_longInterval, maxStableInterval);
+
+    std::chrono::milliseconds newInterval = std::min(_timer.intervalAsDuration() * 2,
+                                                     maxInterval);
+    if(newInterval != _timer.intervalAsDuration())
+    {
+        qDebug() << "MacOS Network Extension state unchanged, next check in"
+            << traceMsec(newInterval);
+        _timer.setInterval(newInterval);
+    }
+}
+
 StateModel::NetExtensionState NetExtensionChecker::checkInstallationState() const
 {
     qDebug() << "Checking MacOS Network Extension Status";
@@ -78,8 +110,12 @@ void NetExtensionChecker::checkIfNetExtensionStateChanged()
     {
         qInfo() << "MacOS Network Extension installation state has changed from:" <<qEnumToString(_lastState) << "to:" << qEnumToString(currentState);
         _lastState = currentState;
+        // Check at the base interval again after a change
+        updateTimer(currentState);
         emit stateChanged(currentState);
     }
+    else
+        backOff();
 }
 
 bool NetExtensionChecker::isInstalled() const
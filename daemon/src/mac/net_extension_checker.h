@@ -41,14 +41,22 @@ public:
 
     // Timer is set to long interval in every scenario, except when
     // Split Tunnel is enabled and the extension is not yet installed.
-    // In the latter, we check faster to give a quicker user feedback
+    // In the latter, we check faster to give a quicker user feedback.
+    // The interval then backs off while the state doesn't change (see
+    // backOff()); this resets it to the base interval.
     void updateTimer(StateModel::NetExtensionState installState);
 
     StateModel::NetExtensionState checkInstallationState() const;
 
+    // The state found by the last check; doesn't run any commands
+    StateModel::NetExtensionState lastState() const {return _lastState;}
+
 private:
     void checkIfNetExtensionStateChanged();
 
+    // Lengthen the timer interval after a check that found no change
+    void backOff();
+
     // Check that the network extension is installed in the system.
     bool isNetExtensionInstalled() const;
 
@@ -74,10 +74,7 @@ ApiBaseSequence MetaServiceApiBase::beginAttempt()
     // Find the nearest region that has meta
     if(!pFirstBaseRegion)
     {
-        pFirstBaseRegion = nearest.getBestMatchingLocation([](const Location &loc)
-        {
-            return loc.hasService(Service::Meta);
-        });
+        pFirstBaseRegion = nearest.getBestLocationForService(Service::Meta);
         if(pFirstBaseRegion)
         {
             qInfo() << "First region for API request is nearest meta region"
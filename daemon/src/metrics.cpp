@@ -0,0 +1,314 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("metrics.cpp")
+
+#include "metrics.h"
+#include "brand.h"
+#include <common/src/builtin/util.h>
+#include <QTcpSocket>
+#include <QTimer>
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    struct FamilyDefinition
+    {
+        const char *pName;
+        Metrics::Type type;
+        const char *pHelp;
+    };
+
+    const FamilyDefinition familyDefinitions[]
+    {
+        {"ipc_messages", Metrics::Type::Counter, "IPC messages exchanged with each connected client"},
+        {"ipc_bytes", Metrics::Type::Counter, "IPC message bytes exchanged with each connected client"},
+        {"notify_changes_seconds", Metrics::Type::Histogram, "Time taken to send state changes to clients"},
+        {"firewall_apply_seconds", Metrics::Type::Histogram, "Time taken to apply firewall rules"},
+        {"api_request_seconds", Metrics::Type::Histogram, "API request latency, including retries, for each API base"},
+        {"latency_probes", Metrics::Type::Counter, "Region latency probes sent, replied, and lost"},
+        {"tunnel_bytes", Metrics::Type::Counter, "Bytes received and sent through the tunnel in the current connection"},
+        {"tunnel_rate_bytes_per_second", Metrics::Type::Gauge, "Tunnel throughput measured over the last WireGuard stats interval"},
+        {"wireguard_handshake_age_seconds", Metrics::Type::Gauge, "Time since the last WireGuard handshake"},
+        {"log_queue_bytes", Metrics::Type::Gauge, "Log file output waiting for the log writer thread"},
+    };
+
+    // Histogram bucket upper bounds in seconds; there's also an implicit +Inf
+    // bucket
+    const std::array<double, 13> histogramBounds
+    {
+        0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+    };
+
+    // Requests larger than this are rejected; a scrape is just a request line
+    // and a few headers
+    const qint64 maxRequestSize{8192};
+    // Connections that haven't sent a complete request by this time are
+    // closed
+    const std::chrono::seconds requestTimeout{5};
+
+    QString familyName(const QString &name)
+    {
+        return QStringLiteral(BRAND_CODE "_") + name;
+    }
+
+    // Escape a label value - backslash, quote, and newline are escaped
+    QString escapeLabel(QString value)
+    {
+        value.replace(QLatin1Char('\\'), QStringLiteral("\\\\"));
+        value.replace(QLatin1Char('"'), QStringLiteral("\\\""));
+        value.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
+        return value;
+    }
+
+    QString renderLabels(const Metrics::Labels &labels,
+                         const QString &extraName = {},
+                         const QString &extraValue = {})
+    {
+        QStringList parts;
+        for(const auto &label : labels)
+            parts.push_back(QStringLiteral("%1=\"%2\"").arg(label.first, escapeLabel(label.second)));
+        if(!extraName.isEmpty())
+            parts.push_back(QStringLiteral("%1=\"%2\"").arg(extraName, extraValue));
+        if(parts.isEmpty())
+            return {};
+        return QLatin1Char('{') + parts.join(QLatin1Char(',')) + QLatin1Char('}');
+    }
+
+    QString renderValue(double value)
+    {
+        return QString::number(value, 'g', 15);
+    }
+}
+
+Metrics::Metrics()
+{
+    for(const auto &definition : familyDefinitions)
+    {
+        _families.emplace(QString::fromLatin1(definition.pName),
+                          Family{definition.type, QString::fromLatin1(definition.pHelp), {}});
+    }
+}
+
+auto Metrics::findSeries(const QString &name, Type type, const Labels &labels)
+    -> Series *
+{
+    auto itFamily = _families.find(name);
+    if(itFamily == _families.end() || itFamily->second.type != type)
+    {
+        qWarning() << "Metric" << name << "is not a known metric of type"
+            << static_cast<int>(type);
+        Q_ASSERT(false);
+        return nullptr;
+    }
+
+    QString key = renderLabels(labels);
+    auto itSeries = itFamily->second.series.find(key);
+    if(itSeries == itFamily->second.series.end())
+    {
+        Series series{labels, 0.0, {}, 0};
+        if(type == Type::Histogram)
+            series.buckets.resize(histogramBounds.size() + 1);
+        itSeries = itFamily->second.series.emplace(std::move(key), std::move(series)).first;
+    }
+    return &itSeries->second;
+}
+
+void Metrics::add(const QString &name, const Labels &labels, double amount)
+{
+    if(Series *pSeries = findSeries(name, Type::Counter, labels))
+        pSeries->value += amount;
+}
+
+void Metrics::set(const QString &name, const Labels &labels, double value)
+{
+    auto itFamily = _families.find(name);
+    Type type = (itFamily != _families.end()) ? itFamily->second.type : Type::Gauge;
+    // Counters can be set to totals kept elsewhere, but not histograms
+    if(type == Type::Histogram)
+        type = Type::Gauge;
+    if(Series *pSeries = findSeries(name, type, labels))
+        pSeries->value = value;
+}
+
+void Metrics::observe(const QString &name, const Labels &labels,
+                      std::chrono::microseconds duration)
+{
+    Series *pSeries = findSeries(name, Type::Histogram, labels);
+    if(!pSeries)
+        return;
+
+    double seconds = duration.count() / 1000000.0;
+    auto itBound = std::lower_bound(histogramBounds.begin(), histogramBounds.end(), seconds);
+    ++pSeries->buckets[static_cast<std::size_t>(itBound - histogramBounds.begin())];
+    ++pSeries->count;
+    pSeries->value += seconds;
+}
+
+void Metrics::clear(const QString &name)
+{
+    auto itFamily = _families.find(name);
+    if(itFamily != _families.end())
+        itFamily->second.series.clear();
+}
+
+QByteArray Metrics::render() const
+{
+    QString output;
+    for(const auto &[name, family] : _families)
+    {
+        QString metricName = familyName(name);
+        const char *pType{"gauge"};
+        if(family.type == Type::Counter)
+            pType = "counter";
+        else if(family.type == Type::Histogram)
+            pType = "histogram";
+        output += QStringLiteral("# TYPE %1 %2\n").arg(metricName, QLatin1String{pType});
+        output += QStringLiteral("# HELP %1 %2\n").arg(metricName, family.help);
+
+        for(const auto &[labelsKey, series] : family.series)
+        {
+            switch(family.type)
+            {
+                case Type::Counter:
+                    output += metricName + QStringLiteral("_total") + labelsKey +
+                        QLatin1Char(' ') + renderValue(series.value) + QLatin1Char('\n');
+                    break;
+                case Type::Gauge:
+                    output += metricName + labelsKey + QLatin1Char(' ') +
+                        renderValue(series.value) + QLatin1Char('\n');
+                    break;
+                case Type::Histogram:
+                {
+                    // Buckets are cumulative in the output
+                    quint64 cumulative{0};
+                    for(std::size_t i=0; i<series.buckets.size(); ++i)
+                    {
+                        cumulative += series.buckets[i];
+                        QString bound = (i < histogramBounds.size()) ?
+                            renderValue(histogramBounds[i]) : QStringLiteral("+Inf");
+                        output += metricName + QStringLiteral("_bucket") +
+                            renderLabels(series.labels, QStringLiteral("le"), bound) +
+                            QLatin1Char(' ') + QString::number(cumulative) + QLatin1Char('\n');
+                    }
+                    output += metricName + QStringLiteral("_count") + labelsKey +
+                        QLatin1Char(' ') + QString::number(series.count) + QLatin1Char('\n');
+                    output += metricName + QStringLiteral("_sum") + labelsKey +
+                        QLatin1Char(' ') + renderValue(series.value) + QLatin1Char('\n');
+                    break;
+                }
+            }
+        }
+    }
+    output += QStringLiteral("# EOF\n");
+    return output.toUtf8();
+}
+
+MetricsServer::MetricsServer(Metrics &metrics, std::function<void()> collect)
+    : _metrics{metrics}, _collect{std::move(collect)}
+{
+    connect(&_server, &QTcpServer::newConnection, this,
+            &MetricsServer::acceptConnections);
+}
+
+void MetricsServer::listen(quint16 port)
+{
+    if(_server.isListening())
+    {
+        if(_server.serverPort() == port)
+            return;
+        qInfo() << "Stopping metrics endpoint on port" << _server.serverPort();
+        _server.close();
+    }
+
+    if(port == 0)
+        return;
+
+    // Only listen on localhost; the metrics aren't meant to be exposed to the
+    // network
+    if(_server.listen(QHostAddress::LocalHost, port))
+        qInfo() << "Serving metrics on 127.0.0.1 port" << port;
+    else
+        qWarning() << "Unable to listen for metrics on port" << port << "-" << _server.errorString();
+}
+
+void MetricsServer::acceptConnections()
+{
+    while(QTcpSocket *pSocket = _server.nextPendingConnection())
+    {
+        connect(pSocket, &QTcpSocket::disconnected, pSocket, &QObject::deleteLater);
+        connect(pSocket, &QTcpSocket::readyRead, this, [this, pSocket]()
+        {
+            handleRequest(*pSocket);
+        });
+        // Drop connections that don't complete a request
+        QTimer::singleShot(msec32(requestTimeout), pSocket, [pSocket]()
+        {
+            pSocket->abort();
+            pSocket->deleteLater();
+        });
+    }
+}
+
+void MetricsServer::handleRequest(QTcpSocket &socket)
+{
+    // Wait for the complete request header.  Any body is ignored; the
+    // connection is closed after responding.
+    if(socket.bytesAvailable() > maxRequestSize)
+    {
+        socket.abort();
+        return;
+    }
+    QByteArray request = socket.peek(maxRequestSize);
+    if(!request.contains("\r\n\r\n"))
+        return;
+    socket.readAll();
+    disconnect(&socket, &QTcpSocket::readyRead, this, nullptr);
+
+    QByteArray requestLine = request.left(request.indexOf("\r\n"));
+    QList<QByteArray> parts = requestLine.split(' ');
+    QByteArray status{"200 OK"};
+    QByteArray contentType{"application/openmetrics-text; version=1.0.0; charset=utf-8"};
+    QByteArray body;
+    if(parts.size() != 3 || parts[0] != "GET")
+    {
+        status = "405 Method Not Allowed";
+        contentType = "text/plain";
+    }
+    else if(parts[1] != "/metrics")
+    {
+        status = "404 Not Found";
+        contentType = "text/plain";
+    }
+    else
+    {
+        if(_collect)
+            _collect();
+        body = _metrics.render();
+    }
+
+    QByteArray response = "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: " + contentType + "\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+        "Connection: close\r\n"
+        "\r\n" + body;
+    socket.write(response);
+    socket.disconnectFromHost();
+}
@@ -0,0 +1,135 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("metrics.h")
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Metrics holds the daemon's performance counters, gauges, and histograms,
+// and renders them in the OpenMetrics text format for MetricsServer.
+//
+// The metric families are fixed (see metrics.cpp); each family can have any
+// number of series, identified by their labels.  Names are given without the
+// brand prefix or the "_total" suffix for counters - for example,
+// "ipc_messages" is rendered as "pia_ipc_messages_total".
+//
+// Values are pushed as events occur (add(), observe()), or set from data the
+// daemon already keeps just before rendering (set(), see
+// MetricsServer::collect).  Series are kept until cleared, so use clear() for
+// series that no longer apply (disconnected clients, etc.)
+class Metrics
+{
+public:
+    using Labels = std::vector<std::pair<QString, QString>>;
+
+    enum class Type
+    {
+        Counter,
+        Gauge,
+        Histogram,
+    };
+
+public:
+    Metrics();
+
+public:
+    // Add to a counter
+    void add(const QString &name, const Labels &labels, double amount = 1);
+    // Set a gauge, or a counter whose total is kept elsewhere
+    void set(const QString &name, const Labels &labels, double value);
+    // Observe a duration in a histogram
+    void observe(const QString &name, const Labels &labels,
+                 std::chrono::microseconds duration);
+    // Remove all series of a family
+    void clear(const QString &name);
+
+    // Render all families in the OpenMetrics text format
+    QByteArray render() const;
+
+private:
+    struct Series
+    {
+        Labels labels;
+        // Counter/gauge value, or histogram sum (in seconds)
+        double value;
+        // Histogram observations in each bucket (not cumulative) and the
+        // total count
+        std::vector<quint64> buckets;
+        quint64 count;
+    };
+
+    struct Family
+    {
+        Type type;
+        QString help;
+        // Keyed by rendered labels, which keeps the output stable
+        std::map<QString, Series> series;
+    };
+
+private:
+    // Find the series for a metric of the given type, creating it if needed.
+    // Returns nullptr (and traces) if the metric isn't known or is a
+    // different type.
+    Series *findSeries(const QString &name, Type type, const Labels &labels);
+
+private:
+    std::map<QString, Family> _families;
+};
+
+// MetricsServer serves Metrics over HTTP on a localhost-only TCP port, for
+// scraping with Prometheus, etc.  This is opt-in with the metricsPort
+// setting; it's not listening by default.
+//
+// This is a minimal HTTP/1.1 server - it answers "GET /metrics" and closes
+// each connection after one response.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+    CLASS_LOGGING_CATEGORY("metrics")
+
+public:
+    // collect is invoked before each scrape to update Metrics with values
+    // kept elsewhere in the daemon
+    MetricsServer(Metrics &metrics, std::function<void()> collect);
+
+public:
+    // Listen on 127.0.0.1:port, or stop listening if port is 0.  No effect if
+    // already listening on that port.
+    void listen(quint16 port);
+
+private:
+    void acceptConnections();
+    void handleRequest(QTcpSocket &socket);
+
+private:
+    Metrics &_metrics;
+    std::function<void()> _collect;
+    QTcpServer _server;
+};
+
+#endif
@@ -74,6 +74,18 @@ using json = nlohmann::basic_json<
         std::vector<std::uint8_t>
     >;
 
+// DescendingPortSet is sent as an array of ports, in descending order
+template<>
+struct serializer<DescendingPortSet>
+{
+    static void to_json(json &j, const DescendingPortSet &ports)
+    {
+        j = json::array();
+        for(quint16 port : ports)
+            j.push_back(port);
+    }
+};
+
 // Though Location doesn't serialize its servers for clients, there is a
 // StateModel::connectedServer property that serializes one server to clients
 template<>
@@ -133,6 +145,21 @@ struct serializer<ServiceLocations>
     }
 };
 
+template<>
+struct serializer<LatencyStatistics>
+{
+    static void to_json(json &j, const LatencyStatistics &ls)
+    {
+        j = {
+            {"mean", ls.mean},
+            {"jitter", ls.jitter},
+            {"p50", ls.p50},
+            {"p95", ls.p95},
+            {"lossRate", ls.lossRate}
+        };
+    }
+};
+
 // Serializers for kapps::regions::Metadata and contained types.  This allows us
 // to put a kapps::regions::Metadata directly into StateModel::regionsMetadata.
 template<>
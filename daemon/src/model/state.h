@@ -25,6 +25,7 @@
 #include <common/src/settings/locations.h>
 #include <common/src/settings/connection.h>
 #include <common/src/settings/automation.h>
+#include <kapps_net/src/firewall.h>
 #include <nlohmann/json.hpp>
 
 // Information about the current ongoing connection and the last successful
@@ -145,6 +146,24 @@ namespace clientjson
     };
 }
 
+namespace clientjson
+{
+    template<>
+    struct serializer<kapps::net::FirewallApplyStats>
+    {
+        static void to_json(json &j, const kapps::net::FirewallApplyStats &stats)
+        {
+            j = {
+                {"applies", stats.applies},
+                {"durationUs", stats.duration.count()},
+                {"operations", stats.operations},
+                {"processes", stats.processes},
+                {"rules", stats.rules}
+            };
+        }
+    };
+}
+
 // This is the Daemon's model of its own state expressed to clients.  The
 // internal model has strong invariants describing the daemon state, and can be
 // serialized to JSON (but not from JSON, as this isn't needed for DaemonState
@@ -278,11 +297,11 @@ public:
     // current or new regions list.  This includes both dedicated IP regions and
     // regular regions, which are treated the same way by most logic referring
     // to regions.
-    JsonProperty(LocationsById, availableLocations);
+    JsonCachedProperty(LocationsById, availableLocations);
 
     // Metadata for all locations and countries; includes map coordinates,
     // display texts, etc.
-    JsonProperty(kapps::regions::Metadata, regionsMetadata);
+    JsonCachedProperty(kapps::regions::Metadata, regionsMetadata);
 
     // Locations grouped by country and sorted by latency.  The locations are
     // chosen from the active infrastructure specified by the "infrastructure"
@@ -301,12 +320,18 @@ public:
     // The countries are sorted by the lowest latency of any location in the
     // country (which ensures that the lowest-latency location's country is
     // first).  Ties are broken by country code.
-    JsonProperty(std::vector<CountryLocations>, groupedLocations);
+    JsonCachedProperty(std::vector<CountryLocations>, groupedLocations);
+
+    // Latency statistics for each location that has been measured, by
+    // location ID.  These are used to select the best location when
+    // DaemonSettings::autoLocationMode is "quality", and are provided for
+    // display.
+    JsonProperty(LatencyStatisticsById, latencyStatistics);
 
     // Dedicated IP locations sorted by latency with the same tie-breaking logic
     // as groupedLocations().  This is used in display contexts alongside
     // groupedLocations(), as dedicated IP regions are displayed differently.
-    JsonProperty(std::vector<QSharedPointer<const Location>>, dedicatedIpLocations);
+    JsonCachedProperty(std::vector<QSharedPointer<const Location>>, dedicatedIpLocations);
 
     // All supported ports for the OpenVpnUdp and OpenVpnTcp services in the
     // active infrastructure (union of the supported ports among all advertised
@@ -324,6 +349,22 @@ public:
     //
     // When not connected, this is an empty array.
     JsonProperty(std::deque<IntervalBandwidth>, intervalMeasurements);
+
+    // Timeline of the most recent connection sequence - each phase reached
+    // while connecting (fetching the IP, starting the VPN method, creating the
+    // interface, applying DNS and the firewall, etc.), with the monotonic time
+    // elapsed since the connection was requested.  Only the first occurrence
+    // of each phase in each attempt is recorded, and only a limited number of
+    // phases are kept (older phases are dropped first).
+    //
+    // This is kept after connecting (and after disconnecting) for diagnostics;
+    // it's reset when a new connection sequence begins.
+    JsonProperty(std::deque<ConnectionPhase>, connectionTimeline);
+    // Cost of the last firewall rule application, and the sum of all
+    // applications since the daemon started (duration, firewall operations,
+    // processes spawned, rules installed) - for diagnostics.
+    JsonProperty(kapps::net::FirewallApplyStats, lastFirewallApply);
+    JsonProperty(kapps::net::FirewallApplyStats, totalFirewallApply);
     // Timestamp when the VPN connection was established - ms since system
     // startup, using a monotonic clock.  0 if we are not connected.
     //
@@ -449,6 +490,11 @@ public:
     // once it syncs a block.  This can overlap with hnsdFailing if it also
     // crashes or restarts after this condition occurs.
     JsonProperty(qint64, hnsdSyncFailure);
+    // The chain height hnsd has synced to, or 0 if hnsd isn't running or
+    // hasn't synced a block since it started.  Since hnsd persists its chain
+    // state, this is usually nonzero shortly after hnsd starts.  Updated every
+    // 1000 blocks during a sync.
+    JsonProperty(qint64, hnsdSyncHeight);
 
     // The original gateway IP address before we activated the VPN
     JsonProperty(QString, originalGatewayIp);
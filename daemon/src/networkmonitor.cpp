@@ -170,11 +170,67 @@ void NetworkConnection::parseWifiSsid(const char *data, std::size_t len)
     }
 }
 
+NetworkChanges NetworkChanges::diff(const std::vector<NetworkConnection> &oldNetworks,
+                                    const std::vector<NetworkConnection> &newNetworks)
+{
+    NetworkChanges changes;
+
+    // There are only a few connections; just search linearly
+    auto findItf = [](const std::vector<NetworkConnection> &networks,
+                      const QString &itf) -> const NetworkConnection *
+    {
+        auto itNetwork = std::find_if(networks.begin(), networks.end(),
+            [&itf](const NetworkConnection &network){return network.networkInterface() == itf;});
+        return itNetwork == networks.end() ? nullptr : &*itNetwork;
+    };
+
+    for(const auto &network : newNetworks)
+    {
+        const NetworkConnection *pOld = findItf(oldNetworks, network.networkInterface());
+        if(!pOld)
+            changes.added.push_back(network);
+        else if(*pOld != network)
+            changes.changed.push_back(network);
+    }
+    for(const auto &network : oldNetworks)
+    {
+        if(!findItf(newNetworks, network.networkInterface()))
+            changes.removed.push_back(network);
+    }
+
+    // Compare the default connections, including the case where either one
+    // doesn't exist
+    auto findDefault = [](const std::vector<NetworkConnection> &networks,
+                          bool (NetworkConnection::*isDefault)() const) -> const NetworkConnection *
+    {
+        auto itNetwork = std::find_if(networks.begin(), networks.end(),
+            [isDefault](const NetworkConnection &network){return (network.*isDefault)();});
+        return itNetwork == networks.end() ? nullptr : &*itNetwork;
+    };
+    auto defaultDiffers = [&](bool (NetworkConnection::*isDefault)() const)
+    {
+        const NetworkConnection *pOld = findDefault(oldNetworks, isDefault);
+        const NetworkConnection *pNew = findDefault(newNetworks, isDefault);
+        if(!pOld || !pNew)
+            return pOld != pNew;
+        return *pOld != *pNew ||
+            pOld->macosPrimaryServiceKey() != pNew->macosPrimaryServiceKey();
+    };
+    changes.defaultChanged = defaultDiffers(&NetworkConnection::defaultIpv4) ||
+        defaultDiffers(&NetworkConnection::defaultIpv6);
+
+    return changes;
+}
+
 void NetworkMonitor::updateNetworks(std::vector<NetworkConnection> newNetworks)
 {
     if(newNetworks != _lastNetworks)
     {
+        NetworkChanges changes = NetworkChanges::diff(_lastNetworks, newNetworks);
+        qInfo() << "Networks changed:" << changes.added.size() << "added,"
+            << changes.removed.size() << "removed," << changes.changed.size()
+            << "changed, default" << (changes.defaultChanged ? "changed" : "unchanged");
         _lastNetworks = std::move(newNetworks);
-        emit networksChanged(_lastNetworks);
+        emit networksChanged(_lastNetworks, changes);
     }
 }
@@ -214,6 +214,30 @@ private:
     unsigned _mtu4, _mtu6;
 };
 
+// Changes between two sets of network connections.  NetworkMonitor emits this
+// along with the new connections, so consumers can skip work that isn't
+// affected by a change.  Connections are matched by interface name.
+struct NetworkChanges
+{
+    // Compute the changes from oldNetworks to newNetworks
+    static NetworkChanges diff(const std::vector<NetworkConnection> &oldNetworks,
+                               const std::vector<NetworkConnection> &newNetworks);
+
+    bool empty() const {return added.empty() && removed.empty() && changed.empty();}
+
+    // Connections on interfaces that weren't present before
+    std::vector<NetworkConnection> added;
+    // Connections on interfaces that are no longer present (the old state)
+    std::vector<NetworkConnection> removed;
+    // Connections on interfaces that are still present but changed in some
+    // way (the new state)
+    std::vector<NetworkConnection> changed;
+    // Whether the default IPv4 or IPv6 connection changed - either a
+    // different connection became the default, or the default connection
+    // itself changed
+    bool defaultChanged{false};
+};
+
 // NetworkMonitor monitors the current network connections and identifies the
 // networks that we're currently connected to, as a list of NetworkConnection
 // objects.
@@ -239,8 +263,10 @@ public:
     const std::vector<NetworkConnection> &getNetworks() const {return _lastNetworks;}
 
 signals:
-    // The network connections have changed
-    void networksChanged(const std::vector<NetworkConnection> &newNetworks);
+    // The network connections have changed.  'changes' describes what changed
+    // since the last emit.
+    void networksChanged(const std::vector<NetworkConnection> &newNetworks,
+                         const NetworkChanges &changes);
 
 private:
     std::vector<NetworkConnection> _lastNetworks;
@@ -27,6 +27,7 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QTimer>
+#include <limits>
 
 OpenVPNProcess::OpenVPNProcess(QObject *parent)
     : QObject(parent)
@@ -55,8 +56,6 @@ OpenVPNProcess::OpenVPNProcess(QObject *parent)
         qCritical() << "Management socket accept error:" << _managementServer->errorString();
         raiseError(Error(HERE, Error::OpenVPNManagementAcceptError));
     });
-
-    connect(this, &OpenVPNProcess::managementLine, this, &OpenVPNProcess::handleManagementLine);
 }
 
 void OpenVPNProcess::run(const QStringList& arguments)
@@ -194,18 +193,44 @@ void OpenVPNProcess::managementConnected()
 
 void OpenVPNProcess::managementReadyRead()
 {
-    if (_managementSocket->bytesAvailable() > 0)
+    qint64 available = _managementSocket->bytesAvailable();
+    if (available <= 0)
+        return;
+
+    // Read in place after the partial line left from the last read
+    qsizetype oldSize = _managementReadBuffer.size();
+    _managementReadBuffer.resize(oldSize + available);
+    qint64 read = _managementSocket->read(_managementReadBuffer.data() + oldSize, available);
+    _managementReadBuffer.resize(oldSize + std::max<qint64>(read, 0));
+
+    // Only the new data can complete a line
+    qsizetype lastBreak = _managementReadBuffer.lastIndexOf('\n');
+    if (lastBreak < oldSize)
+        return;
+
+    // Move the complete lines to the scan buffer and keep the partial line in
+    // the read buffer before handling anything, since handlers can re-enter
+    // (an error can cause the socket to be read again).
+    QByteArray lines = std::move(_managementScanBuffer);
+    lines.swap(_managementReadBuffer);
+    _managementReadBuffer.resize(0);
+    _managementReadBuffer.append(lines.constData() + lastBreak + 1,
+                                 lines.size() - lastBreak - 1);
+
+    qsizetype lineStart = 0;
+    while (lineStart <= lastBreak)
     {
-        _managementReadBuffer += _managementSocket->readAll();
-        auto lines = _managementReadBuffer.split('\n');
-        _managementReadBuffer = lines.last();
-        for (int i = 0; i < lines.size() - 1; i++)
-        {
-            if (lines[i].endsWith('\r'))
-                lines[i].chop(1);
-            emit managementLine(QString::fromLatin1(lines[i]));
-        }
+        qsizetype lineEnd = lines.indexOf('\n', lineStart);
+        qsizetype trimmedEnd = lineEnd;
+        if (trimmedEnd > lineStart && lines[trimmedEnd - 1] == '\r')
+            --trimmedEnd;
+        handleManagementLine(QByteArrayView{lines.constData() + lineStart,
+                                            trimmedEnd - lineStart});
+        lineStart = lineEnd + 1;
     }
+
+    lines.resize(0);
+    _managementScanBuffer = std::move(lines);
 }
 
 void OpenVPNProcess::managementReadFinished()
@@ -213,8 +238,8 @@ void OpenVPNProcess::managementReadFinished()
     managementReadyRead();
     if (_managementReadBuffer.size() > 0)
     {
-        emit managementLine(QString::fromLatin1(_managementReadBuffer));
-        _managementReadBuffer.clear();
+        QByteArray partial = std::exchange(_managementReadBuffer, {});
+        handleManagementLine(partial);
     }
 }
 
@@ -248,76 +273,150 @@ void OpenVPNProcess::setState(State state)
     }
 }
 
-void OpenVPNProcess::handleManagementLine(const QString& line)
+bool OpenVPNProcess::parseBytecount(QByteArrayView params, quint64 &received,
+                                    quint64 &sent)
 {
-    if (line.isEmpty() || line[0] != '>')
-        return;
-    if (line.startsWith(QLatin1String(">STATE:")))
+    quint64 values[2]{};
+    int field = 0;
+    bool haveDigit = false;
+    for (char c : params)
     {
-        auto params = QStringView{line}.mid(7).split(',');
-        if (params.size() < 2)
+        if (c >= '0' && c <= '9')
         {
-            qWarning() << "Unrecognized OpenVPN state:" << QStringView{line}.mid(7);
-            return;
+            quint64 digit = static_cast<quint64>(c - '0');
+            if (values[field] > (std::numeric_limits<quint64>::max() - digit) / 10)
+                return false;   // Overflow
+            values[field] = values[field] * 10 + digit;
+            haveDigit = true;
         }
-        QStringView description, tunnelIP, remoteIP, remotePort, localIP, localPort, tunnelIPv6;
-        switch (params.size())
+        else if (c == ',' && field == 0 && haveDigit)
         {
-        default:
-        case 9: tunnelIPv6 = params[8];
-        case 8: localPort = params[7];
-        case 7: localIP = params[6];
-        case 6: remotePort = params[5];
-        case 5: remoteIP = params[4];
-        case 4: tunnelIP = params[3];
-        case 3: description = params[2];
-        case 2: case 1: case 0: break;
+            field = 1;
+            haveDigit = false;
         }
+        else
+            return false;
+    }
+    if (field != 1 || !haveDigit)
+        return false;
+    received = values[0];
+    sent = values[1];
+    return true;
+}
 
-        auto assignUInt = [](uint& var, const QStringView& str) { bool ok; uint value = str.toUInt(&ok); if (ok) var = value; };
-
-        if (!tunnelIP.isEmpty())
-            _tunnelIP = tunnelIP.toString();
-        if (!tunnelIPv6.isEmpty())
-            _tunnelIPv6 = tunnelIPv6.toString();
-        if (!remoteIP.isEmpty())
-            _remoteIP = remoteIP.toString();
-        if (!localIP.isEmpty())
-            _localIP = localIP.toString();
-        if (!remotePort.isEmpty())
-            assignUInt(_remotePort, remotePort);
-        if (!localPort.isEmpty())
-            assignUInt(_localPort, localPort);
-
-        if (params[1] == QLatin1String("CONNECTING"))
-            setState(Connecting);
-        else if (params[1] == QLatin1String("RESOLVE"))
-            setState(Resolve);
-        else if (params[1] == QLatin1String("TCP_CONNECT"))
-            setState(TCPConnect);
-        else if (params[1] == QLatin1String("WAIT"))
-            setState(Wait);
-        else if (params[1] == QLatin1String("AUTH"))
-            setState(Auth);
-        else if (params[1] == QLatin1String("GET_CONFIG"))
-            setState(GetConfig);
-        else if (params[1] == QLatin1String("ASSIGN_IP"))
-            setState(AssignIP);
-        else if (params[1] == QLatin1String("ADD_ROUTES"))
-            setState(AddRoutes);
-        else if (params[1] == QLatin1String("CONNECTED"))
-            setState(Connected);
-        else if (params[1] == QLatin1String("RECONNECTING"))
-            setState(Reconnecting);
-        else if (params[1] == QLatin1String("EXITING"))
+void OpenVPNProcess::handleManagementLine(QByteArrayView line)
+{
+    // Messages handled here, by their prefix.  Byte counts are by far the
+    // most frequent, so they're first and aren't passed on as a QString.
+    struct MessageHandler
+    {
+        QByteArrayView prefix;
+        void (OpenVPNProcess::*pHandler)(QByteArrayView params);
+        bool forward;   // Also emit managementLine()
+    };
+    static const MessageHandler handlers[]
+    {
+        {">BYTECOUNT:", &OpenVPNProcess::handleBytecountMessage, false},
+        {">STATE:", &OpenVPNProcess::handleStateMessage, true},
+        {">HOLD:", &OpenVPNProcess::handleHoldMessage, true},
+    };
+
+    if (!line.isEmpty() && line[0] == '>')
+    {
+        for (const auto &handler : handlers)
         {
-            if (description == QLatin1String("tls-error"))
-                raiseError(Error(HERE, Error::OpenVPNTLSHandshakeError));
-            setState(Exiting);
+            if (line.startsWith(handler.prefix))
+            {
+                (this->*handler.pHandler)(line.sliced(handler.prefix.size()));
+                if (!handler.forward)
+                    return;
+                break;
+            }
         }
-        else
-            qWarning() << "Unrecognized OpenVPN state:" << QStringView{line}.mid(7);
     }
-    else if (line.startsWith(QLatin1String(">HOLD:")))
-        sendManagementCommand(QLatin1String("hold release"));
+
+    emit managementLine(QString::fromLatin1(line));
+}
+
+void OpenVPNProcess::handleBytecountMessage(QByteArrayView params)
+{
+    quint64 received, sent;
+    if (parseBytecount(params, received, sent))
+        emit bytecount(received, sent);
+    else
+        qWarning() << "Invalid OpenVPN byte count:" << QString::fromLatin1(params);
+}
+
+void OpenVPNProcess::handleStateMessage(QByteArrayView message)
+{
+    // State changes are infrequent, just parse them as a QString
+    const QString line = QString::fromLatin1(message);
+    auto params = QStringView{line}.split(',');
+    if (params.size() < 2)
+    {
+        qWarning() << "Unrecognized OpenVPN state:" << line;
+        return;
+    }
+    QStringView description, tunnelIP, remoteIP, remotePort, localIP, localPort, tunnelIPv6;
+    switch (params.size())
+    {
+    default:
+    case 9: tunnelIPv6 = params[8];
+    case 8: localPort = params[7];
+    case 7: localIP = params[6];
+    case 6: remotePort = params[5];
+    case 5: remoteIP = params[4];
+    case 4: tunnelIP = params[3];
+    case 3: description = params[2];
+    case 2: case 1: case 0: break;
+    }
+
+    auto assignUInt = [](uint& var, const QStringView& str) { bool ok; uint value = str.toUInt(&ok); if (ok) var = value; };
+
+    if (!tunnelIP.isEmpty())
+        _tunnelIP = tunnelIP.toString();
+    if (!tunnelIPv6.isEmpty())
+        _tunnelIPv6 = tunnelIPv6.toString();
+    if (!remoteIP.isEmpty())
+        _remoteIP = remoteIP.toString();
+    if (!localIP.isEmpty())
+        _localIP = localIP.toString();
+    if (!remotePort.isEmpty())
+        assignUInt(_remotePort, remotePort);
+    if (!localPort.isEmpty())
+        assignUInt(_localPort, localPort);
+
+    if (params[1] == QLatin1String("CONNECTING"))
+        setState(Connecting);
+    else if (params[1] == QLatin1String("RESOLVE"))
+        setState(Resolve);
+    else if (params[1] == QLatin1String("TCP_CONNECT"))
+        setState(TCPConnect);
+    else if (params[1] == QLatin1String("WAIT"))
+        setState(Wait);
+    else if (params[1] == QLatin1String("AUTH"))
+        setState(Auth);
+    else if (params[1] == QLatin1String("GET_CONFIG"))
+        setState(GetConfig);
+    else if (params[1] == QLatin1String("ASSIGN_IP"))
+        setState(AssignIP);
+    else if (params[1] == QLatin1String("ADD_ROUTES"))
+        setState(AddRoutes);
+    else if (params[1] == QLatin1String("CONNECTED"))
+        setState(Connected);
+    else if (params[1] == QLatin1String("RECONNECTING"))
+        setState(Reconnecting);
+    else if (params[1] == QLatin1String("EXITING"))
+    {
+        if (description == QLatin1String("tls-error"))
+            raiseError(Error(HERE, Error::OpenVPNTLSHandshakeError));
+        setState(Exiting);
+    }
+    else
+        qWarning() << "Unrecognized OpenVPN state:" << line;
+}
+
+void OpenVPNProcess::handleHoldMessage(QByteArrayView)
+{
+    sendManagementCommand(QLatin1String("hold release"));
 }
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <QByteArray>
+#include <QByteArrayView>
 #include <QObject>
 #include <QProcess>
 #include <QStringList>
@@ -65,6 +66,12 @@ public:
     };
     Q_ENUM(State)
 
+public:
+    // Parse the parameters of a >BYTECOUNT: message ("<received>,<sent>")
+    // without allocating.  Returns false if they're not valid.
+    static bool parseBytecount(QByteArrayView params, quint64 &received,
+                               quint64 &sent);
+
 public:
     explicit OpenVPNProcess(QObject *parent = nullptr);
 
@@ -81,7 +88,10 @@ public:
 signals:
     void stdoutLine(const QString& line);
     void stderrLine(const QString& line);
+    // Management interface lines, except byte counts (see bytecount())
     void managementLine(const QString& line);
+    // A >BYTECOUNT: message was received
+    void bytecount(quint64 received, quint64 sent);
     void stateChanged();
     void exited(int exitCode);
     void error(const Error& error);
@@ -104,7 +114,12 @@ private slots:
 
 protected:
     void setState(State state);
-    void handleManagementLine(const QString& line);
+    // Handle a complete management line.  The line refers to the read buffer,
+    // it's only valid during this call.
+    void handleManagementLine(QByteArrayView line);
+    void handleStateMessage(QByteArrayView params);
+    void handleHoldMessage(QByteArrayView params);
+    void handleBytecountMessage(QByteArrayView params);
 
 private:
     State _state;
@@ -114,6 +129,10 @@ private:
 
     QByteArray _stdoutBuffer, _stderrBuffer;
     QByteArray _managementReadBuffer, _managementWriteBuffer;
+    // Complete lines are moved here from _managementReadBuffer to be handled.
+    // Both buffers keep their capacity, so reading management messages
+    // normally doesn't allocate.
+    QByteArray _managementScanBuffer;
 
     QString _tunnelIP, _tunnelIPv6;
     QString _remoteIP, _localIP;
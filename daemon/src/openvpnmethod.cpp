@@ -26,17 +26,67 @@
 #include <kapps_core/src/ipaddress.h>
 #include <QStandardPaths>
 #include <QRegularExpression>
+#include <QThread>
 
 #if defined(Q_OS_WIN)
+    #include <kapps_core/src/winapi.h>
     #include "win/win_daemon.h" // For WinDaemon::getTapAdapter() / WinDaemon::getTunAdapter()
     #include "win/win_interfacemonitor.h"
     #include <common/src/win/win_util.h>
+    #if defined(Q_PROCESSOR_X86)
+        #include <intrin.h>
+    #endif
 #endif
 
 #if defined(Q_OS_UNIX)
     #include "posix/posix_mtu.h"
 #endif
 
+#if defined(Q_OS_LINUX) && defined(Q_PROCESSOR_ARM_64)
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+#endif
+
+namespace
+{
+    // Socket buffer sizes for the "standard" and "throughput" profiles.  The
+    // standard size is the value used by the previous client.
+    const int standardSocketBuffer{262144};
+    const int throughputSocketBuffer{1048576};
+    // The "auto" profile selects "throughput" when there are at least this
+    // many logical cores (and hardware AES)
+    const int throughputMinCores{4};
+    // TUN transmit queue length for the "throughput" profile (Linux only)
+    const int throughputTxQueueLen{1000};
+
+    // Whether the CPU has AES instructions.  OpenVPN's data channel runs on a
+    // single thread, so without them, the cipher is usually the bottleneck.
+    bool hasHardwareAes()
+    {
+#if defined(Q_PROCESSOR_X86)
+    #if defined(Q_CC_MSVC)
+        int cpuInfo[4]{};
+        __cpuid(cpuInfo, 1);
+        return (cpuInfo[2] & (1 << 25)) != 0;   // ECX bit 25 - AES-NI
+    #else
+        return __builtin_cpu_supports("aes");
+    #endif
+#elif defined(Q_PROCESSOR_ARM_64)
+    #if defined(Q_OS_MAC)
+        return true;    // All Apple Silicon CPUs have the ARMv8 crypto extensions
+    #elif defined(Q_OS_LINUX)
+        return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+    #elif defined(Q_OS_WIN)
+        return ::IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE);
+    #else
+        return false;
+    #endif
+#else
+        return false;
+#endif
+    }
+}
+
 HelperIpcConnection::HelperIpcConnection(QLocalSocket *pConnection)
     : _pConnection{pConnection}
 {
@@ -47,7 +97,7 @@ HelperIpcConnection::HelperIpcConnection(QLocalSocket *pConnection)
     {
         _buffer.append(_pConnection->readAll());
     });
-    connect(&_buffer, &LineBuffer::lineComplete, this, [this](const QByteArray &line)
+    connect(&_buffer, &LineBuffer::lineView, this, [this](QByteArrayView line)
     {
         QString lineStr{QString::fromUtf8(line)};
         qInfo() << "HELPER" << reinterpret_cast<qintptr>(_pConnection.get())
@@ -122,7 +172,7 @@ bool HelperIpcServer::listen()
 Executor OpenVPNMethod::_executor{CURRENT_CATEGORY};
 
 OpenVPNMethod::OpenVPNMethod(QObject *pParent, const OriginalNetworkScan &netScan)
-    : VPNMethod{pParent, netScan}, _openvpn{}
+    : VPNMethod{pParent, netScan}, _openvpn{}, _useUpdownScript{true}
 {
 }
 
@@ -312,11 +362,27 @@ void OpenVPNMethod::run(const ConnectionConfig &connectingConfig,
         }
 #endif
 
-        // Use the same script for --up and --down
-        arguments += "--up";
-        arguments += updownCmd;
-        arguments += "--down";
-        arguments += updownCmd;
+        // On Linux, the up/down script only applies DNS (pushed DNS servers
+        // are always ignored).  If we're not applying DNS, skip the script -
+        // the tunnel configuration is found from OpenVPN's output instead,
+        // which avoids spawning the script on every connect and disconnect.
+        _useUpdownScript = true;
+#if defined(Q_OS_LINUX)
+        _useUpdownScript = !dnsServers.isEmpty();
+#endif
+        _tunDeviceName.clear();
+        _tunGateway.clear();
+
+        if(_useUpdownScript)
+        {
+            // Use the same script for --up and --down
+            arguments += "--up";
+            arguments += updownCmd;
+            arguments += "--down";
+            arguments += updownCmd;
+        }
+        else
+            qInfo() << "Not applying DNS, up/down script is not needed";
 
         arguments += QStringLiteral("--config");
 
@@ -354,6 +420,7 @@ void OpenVPNMethod::run(const ConnectionConfig &connectingConfig,
     connect(_openvpn, &OpenVPNProcess::stdoutLine, this, &OpenVPNMethod::openvpnStdoutLine);
     connect(_openvpn, &OpenVPNProcess::stderrLine, this, &OpenVPNMethod::openvpnStderrLine);
     connect(_openvpn, &OpenVPNProcess::managementLine, this, &OpenVPNMethod::openvpnManagementLine);
+    connect(_openvpn, &OpenVPNProcess::bytecount, this, &OpenVPNMethod::openvpnBytecount);
     connect(_openvpn, &OpenVPNProcess::stateChanged, this, &OpenVPNMethod::openvpnStateChanged);
     connect(_openvpn, &OpenVPNProcess::exited, this, &OpenVPNMethod::openvpnExited);
     connect(_openvpn, &OpenVPNProcess::error, this, &OpenVPNMethod::raiseError);
@@ -367,6 +434,7 @@ void OpenVPNMethod::run(const ConnectionConfig &connectingConfig,
                                                          raiseError({HERE, Error::Code::OpenVPNError});
                                                        });
     _connectingTimer.start();
+    emitPhase(QStringLiteral("openvpnStarted"));
     _openvpn->run(arguments);
 }
 
@@ -393,6 +461,29 @@ void OpenVPNMethod::networkChanged()
     emit networkHasChanged();
 }
 
+bool OpenVPNMethod::useThroughputProfile() const
+{
+    const auto &profile = _connectingConfig.openvpnPerformanceProfile();
+    bool hardwareAes = hasHardwareAes();
+    int cores = QThread::idealThreadCount();
+
+    // Without AES instructions, AES-256-GCM costs noticeably more than
+    // AES-128-GCM.  The cipher is the user's choice, just mention it.
+    if (!hardwareAes && _connectingConfig.openvpnCipher() == QStringLiteral("AES-256-GCM"))
+        qInfo() << "CPU has no hardware AES, AES-128-GCM would be faster than"
+            << _connectingConfig.openvpnCipher();
+
+    if (profile == QStringLiteral("throughput"))
+        return true;
+    if (profile == QStringLiteral("standard"))
+        return false;
+
+    bool throughput = hardwareAes && cores >= throughputMinCores;
+    qInfo() << "Selected" << (throughput ? "throughput" : "standard")
+        << "profile - cores:" << cores << "hardware AES:" << hardwareAes;
+    return throughput;
+}
+
 bool OpenVPNMethod::writeOpenVPNConfig(QFile& outFile,
                                        const Server &vpnServer,
                                        const Transport &transport,
@@ -478,9 +569,24 @@ bool OpenVPNMethod::writeOpenVPNConfig(QFile& outFile,
     out << "pull-filter ignore \"auth-token\"" << endl;
 
     // Increasing sndbuf/rcvbuf can boost throughput, which is what most users
-    // prioritize. For now, just copy the values used in the previous client.
-    out << "sndbuf 262144" << endl;
-    out << "rcvbuf 262144" << endl;
+    // prioritize.  The "throughput" profile goes further for systems that can
+    // make use of it.
+    bool throughputProfile = useThroughputProfile();
+    int socketBuffer = throughputProfile ? throughputSocketBuffer : standardSocketBuffer;
+    out << "sndbuf " << socketBuffer << endl;
+    out << "rcvbuf " << socketBuffer << endl;
+    if (throughputProfile)
+    {
+#ifndef Q_OS_WIN
+        // fast-io skips a poll() before each UDP write; it only applies to UDP
+        // and isn't supported on Windows
+        if (transport.protocol() != QStringLiteral("tcp"))
+            out << "fast-io" << endl;
+#endif
+#ifdef Q_OS_LINUX
+        out << "txqueuelen " << throughputTxQueueLen << endl;
+#endif
+    }
 
     if (_connectingConfig.setDefaultRoute())
     {
@@ -686,8 +792,6 @@ void OpenVPNMethod::openvpnStateChanged()
             advanceState(State::Created);
             break;
         case OpenVPNProcess::State::AssignIP:
-            advanceState(State::Connecting);
-            break;
         case OpenVPNProcess::State::Connecting:
         case OpenVPNProcess::State::Resolve:
         case OpenVPNProcess::State::TCPConnect:
@@ -695,10 +799,22 @@ void OpenVPNMethod::openvpnStateChanged()
         case OpenVPNProcess::State::Auth:
         case OpenVPNProcess::State::GetConfig:
         case OpenVPNProcess::State::AddRoutes:
+            emitPhase(QStringLiteral("openvpn") + qEnumToString(openvpnState));
             advanceState(State::Connecting);
             break;
         case OpenVPNProcess::State::Connected:
             _connectingTimer.stop();
+            // Without the up/down script, the tunnel configuration comes from
+            // OpenVPN - the tunnel IP is reported with the CONNECTED state.
+            if(!_useUpdownScript)
+            {
+                if(_tunDeviceName.isEmpty() || _tunGateway.isEmpty())
+                {
+                    qWarning() << "Tunnel configuration incomplete - device:"
+                        << _tunDeviceName << "gateway:" << _tunGateway;
+                }
+                configureTunnel(_tunDeviceName, _openvpn->tunnelIP(), _tunGateway);
+            }
             advanceState(State::Connected);
             break;
         case OpenVPNProcess::State::Reconnecting:
@@ -728,6 +844,8 @@ void OpenVPNMethod::openvpnStdoutLine(const QString& line)
     qDebug() << line;
 
     checkStdoutErrors(line);
+    if(!_useUpdownScript)
+        checkTunnelConfigLine(line);
 }
 
 void OpenVPNMethod::checkStdoutErrors(const QString &line)
@@ -799,24 +917,65 @@ unsigned OpenVPNMethod::findMaxMtu(const kapps::core::Ipv4Address &host)
     return mtu;
 }
 
+void OpenVPNMethod::checkTunnelConfigLine(const QString &line)
+{
+    // "TUN/TAP device tun0 opened"
+    static const QRegularExpression tunOpenedRegex{R"(TUN/TAP device ([^ ]+) opened)"};
+    // The gateway is pushed as 'route-gateway' (topology subnet), or as the
+    // remote end of 'ifconfig' (net30/p2p).  This is the same as OpenVPN's
+    // route_vpn_gateway given to the up/down script.
+    static const QRegularExpression routeGatewayRegex{R"(PUSH_REPLY.*[,']route-gateway ([0-9.]+))"};
+    static const QRegularExpression ifconfigRemoteRegex{R"(PUSH_REPLY.*[,']ifconfig [0-9.]+ ([0-9.]+))"};
+
+    auto tunOpenedMatch = tunOpenedRegex.match(line);
+    if(tunOpenedMatch.hasMatch())
+    {
+        _tunDeviceName = tunOpenedMatch.captured(1);
+        return;
+    }
+
+    if(!line.contains(QLatin1String("PUSH_REPLY")))
+        return;
+    auto gatewayMatch = routeGatewayRegex.match(line);
+    if(gatewayMatch.hasMatch())
+        _tunGateway = gatewayMatch.captured(1);
+    else
+    {
+        // With topology subnet, the second ifconfig parameter is a netmask
+        auto ifconfigMatch = ifconfigRemoteRegex.match(line);
+        if(ifconfigMatch.hasMatch() && !ifconfigMatch.captured(1).startsWith(QLatin1String("255.")))
+            _tunGateway = ifconfigMatch.captured(1);
+    }
+}
+
+void OpenVPNMethod::configureTunnel(const QString &deviceName,
+                                    const QString &localAddress,
+                                    const QString &remoteAddress)
+{
+    if(!_networkAdapter)
+        _networkAdapter.reset(new NetworkAdapter{deviceName});
+
+    int maxMtu = findMaxMtu(_vpnHost);
+    qInfo() << "MTU config:" << _connectingConfig.mtu()
+        << " - calculated tunnel MTU to VPN host" << _vpnHost << ":"
+        << maxMtu;
+
+    QString pathId{QStringLiteral("openvpn-udp/")};
+    if(_connectingConfig.openvpnProtocol() == ConnectionConfig::Protocol::TCP)
+        pathId = QStringLiteral("openvpn-tcp/");
+    pathId += qs::toQString(_vpnHost.toString());
+    _mtuPinger.reset(new MtuPinger(_networkAdapter, maxMtu, _connectingConfig.mtu(), pathId));
+
+    emitTunnelConfiguration(deviceName, localAddress, remoteAddress);
+}
+
 void OpenVPNMethod::checkForMagicStrings(const QString& line)
 {
     QRegularExpression tunDeviceNameRegex{R"(Using device:([^ ]+) local_address:([^ ]+) remote_address:([^ ]+))"};
     const auto match = tunDeviceNameRegex.match(line);
     if(match.hasMatch())
     {
-        if(!_networkAdapter)
-            _networkAdapter.reset(new NetworkAdapter{match.captured(1)});
-
-        int maxMtu = findMaxMtu(_vpnHost);
-        qInfo() << "MTU config:" << _connectingConfig.mtu()
-            << " - calculated tunnel MTU to VPN host" << _vpnHost << ":"
-            << maxMtu;
-
-        _mtuPinger.reset(new MtuPinger(_networkAdapter, maxMtu, _connectingConfig.mtu()));
-
-        emitTunnelConfiguration(match.captured(1), match.captured(2),
-                                match.captured(3));
+        configureTunnel(match.captured(1), match.captured(2), match.captured(3));
 
         // TODO: extract this out into a more general error mechanism, where the "!!!" prefix
         // indicates an error condition followed by the code.
@@ -886,22 +1045,16 @@ void OpenVPNMethod::openvpnManagementLine(const QString& line)
             // All unhandled cases
             raiseError(Error(HERE, Error::OpenVPNAuthenticationError));
         }
-        else if (line.startsWith(QLatin1String(">BYTECOUNT:")))
-        {
-            auto params = QStringView{line}.mid(11).split(',');
-            if (params.size() >= 2)
-            {
-                bool ok = false;
-                quint64 up, down;
-                if (((down = params[0].toULongLong(&ok)), ok) && ((up = params[1].toULongLong(&ok)), ok))
-                {
-                    emitBytecounts(down, up);
-                }
-            }
-        }
     }
 }
 
+void OpenVPNMethod::openvpnBytecount(quint64 received, quint64 sent)
+{
+    FUNCTION_LOGGING_CATEGORY("openvpn.mgmt");
+    qDebug().nospace() << ">BYTECOUNT:" << received << "," << sent;
+    emitBytecounts(received, sent);
+}
+
 void OpenVPNMethod::openvpnExited(int exitCode)
 {
     if (_networkAdapter)
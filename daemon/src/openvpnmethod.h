@@ -119,6 +119,9 @@ private:
     virtual void networkChanged() override;
 
 private:
+    // Whether to apply the "throughput" data channel profile, based on the
+    // profile setting and (for "auto") the CPU's capabilities
+    bool useThroughputProfile() const;
     bool writeOpenVPNConfig(QFile& outFile,
                             const Server &vpnServer,
                             const Transport &transport,
@@ -131,9 +134,17 @@ private:
     void checkStdoutErrors(const QString &line);
     void openvpnStderrLine(const QString& line);
     void checkForMagicStrings(const QString& line);
+    // Pick up the tunnel device and gateway from OpenVPN's output, used when
+    // the up/down script isn't run
+    void checkTunnelConfigLine(const QString &line);
+    // Set up the MTU pinger and emit the tunnel configuration once the
+    // tunnel device is known (from the up/down script or OpenVPN itself)
+    void configureTunnel(const QString &deviceName, const QString &localAddress,
+                         const QString &remoteAddress);
     bool respondToMgmtAuth(const QString &line, const QString &user,
                            const QString &password);
     void openvpnManagementLine(const QString& line);
+    void openvpnBytecount(quint64 received, quint64 sent);
     void openvpnExited(int exitCode);
 
     // Calculate the maximum MTU that we could have to the specified VPN server,
@@ -156,6 +167,13 @@ private:
     QTimer _connectingTimer;
     static Executor _executor;
     std::unique_ptr<MtuPinger> _mtuPinger;
+    // Whether OpenVPN runs the up/down script for this connection.  On Linux,
+    // the script is only needed to apply DNS; otherwise the tunnel
+    // configuration is taken from OpenVPN's output and management interface.
+    bool _useUpdownScript;
+    // Tunnel device and gateway found in OpenVPN's output when the up/down
+    // script isn't used
+    QString _tunDeviceName, _tunGateway;
 };
 
 #endif
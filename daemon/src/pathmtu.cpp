@@ -17,6 +17,11 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "pathmtu.h"
+#include <common/src/wakeupaccounting.h>
+#include "daemon.h"
+#include <QDateTime>
+#include <QJsonObject>
+#include <algorithm>
 #include <kapps_core/src/ipaddress.h>
 #if defined(Q_OS_WIN)
     #include "win/win_daemon.h"
@@ -36,25 +41,71 @@ namespace
     {
         VpnServerGateway = 0x0A000001,  // 10.0.0.1
     };
+
+    // IPv4 and ICMP header overhead included in the MTU of each probe
+    const int icmpProbeOverhead{28};
+    // Sizes up to this MTU are assumed to work without probing
+    const int baseMtu{1200};
+    // The search stops when the range is closed to less than this.  We don't
+    // probe further to get down to the exact byte; this adds a lot of time for
+    // little improved accuracy (failed probes can only be detected by a
+    // timeout)
+    const int searchResolution{10};
+    // Number of sizes probed concurrently in each search round
+    const int probesPerRound{3};
+    // Unanswered probes are sent this many times in total, this far apart; a
+    // size is considered too large after the last one times out.
+    const int maxProbeTransmissions{2};
+    const std::chrono::milliseconds probeInterval{750};
+    // Interval to re-validate the MTU while connected
+    const std::chrono::minutes revalidateInterval{10};
+    // Limits on the cached MTUs kept in DaemonData
+    const std::chrono::hours mtuCacheMaxAge{24*14};
+    const std::size_t mtuCacheLimit{32};
 }
 
 Executor MtuPinger::_executor{CURRENT_CATEGORY};
 
 MtuPinger::MtuPinger(std::shared_ptr<NetworkAdapter> pTunnelAdapter,
-                     int maxTunnelMtu, int mtuSetting)
-    : _pTunnelAdapter{std::move(pTunnelAdapter)}, _mtu{1200}, _goodMtu{1200},
-      _badMtu{maxTunnelMtu+1}, _retryCounter{0}
+                     int maxTunnelMtu, int mtuSetting, const QString &pathId)
+    : _pTunnelAdapter{std::move(pTunnelAdapter)}, _maxMtu{maxTunnelMtu},
+      _floorMtu{std::min(baseMtu, maxTunnelMtu)}, _goodMtu{_floorMtu},
+      _badMtu{maxTunnelMtu+1}, _appliedMtu{0}, _validating{false},
+      _transmissions{0}
 {
+    if(!g_data.modernLatenciesNetwork().isEmpty())
+        _cacheKey = g_data.modernLatenciesNetwork() + '/' + pathId;
+
 #if !defined(Q_OS_WIN)
-    connect(&_ping, &PosixPing::receivedReply, this, &MtuPinger::receivedReply);
+    connect(&_ping, &PosixPing::receivedReply, this,
+            [this](quint32, std::chrono::microseconds, int payloadSize)
+            {
+                receivedReply(payloadSize + icmpProbeOverhead);
+            });
 #endif
-    connect(&_pingTimeout, &QTimer::timeout, this, &MtuPinger::timeout);
-    _pingTimeout.setInterval(3000);
+    _probeTimer.setSingleShot(true);
+    _probeTimer.setInterval(msec32(probeInterval));
+    connect(&_probeTimer, &QTimer::timeout, this, &MtuPinger::probeTimeout);
+    _revalidateTimer.setInterval(msec32(revalidateInterval));
+    tagWakeups(_probeTimer, QByteArrayLiteral("pathmtu"));
+    tagWakeups(_revalidateTimer, QByteArrayLiteral("pathmtu"));
+    connect(&_revalidateTimer, &QTimer::timeout, this, &MtuPinger::validate);
 
     // Auto MTU - detect automatically, using maxMtu as upper bound
     if(mtuSetting < 0)
     {
-        start();
+        int cachedMtu = loadCachedMtu();
+        if(cachedMtu > 0)
+        {
+            // Use the cached MTU right away, and just check that it still
+            // works
+            qInfo() << "Using cached MTU" << cachedMtu << "for this network";
+            _goodMtu = cachedMtu;
+            applyMtu(cachedMtu);
+            validate();
+        }
+        else
+            startSearch();
     }
     // "Small packets" or some other specific MTU requested
     else if(mtuSetting > 0)
@@ -70,68 +121,229 @@ MtuPinger::MtuPinger(std::shared_ptr<NetworkAdapter> pTunnelAdapter,
     }
 }
 
-void MtuPinger::start()
+void MtuPinger::startSearch()
 {
-    // Check if we're done - the range is closed to < 10 bytes.  We don't probe
-    // further to get down to the exact byte; this adds a lot of time for little
-    // improved accuracy (failed probes can only be detected by a timeout)
-    if (_goodMtu > _badMtu || _badMtu - _goodMtu < 10)
+    _goodMtu = _floorMtu;
+    _badMtu = _maxMtu + 1;
+    // Probes can't be larger than the interface MTU, so open it up to the
+    // maximum while searching (if we had applied something smaller, such as a
+    // cached MTU that no longer works)
+    if(_appliedMtu && _appliedMtu < _maxMtu)
+        applyMtu(_maxMtu);
+    searchNext();
+}
+
+void MtuPinger::searchNext()
+{
+    // Check if we're done - the range is closed to less than the resolution
+    if(_badMtu - _goodMtu < searchResolution)
     {
         qInfo() << "MTU search done with final range" << _badMtu << "-" <<
             _goodMtu << ", choose MTU" << _goodMtu;
         applyMtu(_goodMtu);
+        storeCachedMtu(_goodMtu);
+        _revalidateTimer.start();
         return;
     }
 
-    // Test the midpoint of the current range
-    _mtu = (_goodMtu + _badMtu) / 2;
-    qInfo() << "try MTU: " << _mtu;
-    _pingTimeout.start(3000);
+    // Probe sizes spread evenly across the range
+    std::vector<int> sizes;
+    sizes.reserve(probesPerRound);
+    for(int i = 1; i <= probesPerRound; ++i)
+    {
+        int size = _goodMtu + (_badMtu - _goodMtu) * i / (probesPerRound + 1);
+        if(size > _goodMtu && size < _badMtu &&
+           (sizes.empty() || sizes.back() != size))
+        {
+            sizes.push_back(size);
+        }
+    }
+    _validating = false;
+    qInfo() << "Probe MTUs" << sizes << "in range" << _badMtu << "-" << _goodMtu;
+    startRound(sizes);
+}
+
+void MtuPinger::validate()
+{
+    _revalidateTimer.stop();
+    _validating = true;
+    qInfo() << "Validate MTU" << _goodMtu;
+    startRound({_goodMtu});
+}
+
+void MtuPinger::startRound(const std::vector<int> &sizes)
+{
+    _probes.clear();
+    for(int size : sizes)
+        _probes.emplace(size, false);
+    _transmissions = 0;
+    sendProbes();
+}
+
+void MtuPinger::sendProbes()
+{
+    ++_transmissions;
+    for(const auto &probe : _probes)
+    {
+        if(probe.second)
+            continue;
+        int payloadSize = probe.first - icmpProbeOverhead;
 #if defined(Q_OS_WIN)
-     std::chrono::milliseconds timeout{3000};
-     QPointer<WinIcmpEcho> echo = WinIcmpEcho::send(VpnServerGateway, timeout, _mtu - 28, false);
-     connect(echo.data(), &WinIcmpEcho::receivedReply, this, &MtuPinger::receivedReply);
-     connect(echo.data(), &WinIcmpEcho::receivedError, this, &MtuPinger::receivedError);
+        // WinIcmpEcho requires a timeout; use the remaining time in the round
+        std::chrono::milliseconds timeout{probeInterval * (maxProbeTransmissions - _transmissions + 1)};
+        QPointer<WinIcmpEcho> echo = WinIcmpEcho::send(VpnServerGateway, timeout, payloadSize, false);
+        if(echo)
+        {
+            int size = probe.first;
+            connect(echo.data(), &WinIcmpEcho::receivedReply, this,
+                    [this, size](){receivedReply(size);});
+        }
 #else
-    _ping.sendEchoRequest(VpnServerGateway, _mtu - 28, false);
+        _ping.sendEchoRequest(VpnServerGateway, payloadSize, false);
 #endif
+    }
+    _probeTimer.start();
 }
 
-void MtuPinger::receivedReply(quint32 addr)
+void MtuPinger::receivedReply(int mtu)
 {
-    _pingTimeout.stop();
-    _goodMtu = _mtu;
-    _retryCounter = 0;
-    qInfo() << "MTU" << _mtu << "succeeded, now have range" << _badMtu
-            << "-" << _goodMtu;
-    start();
+    auto itProbe = _probes.find(mtu);
+    // Ignore late replies from an earlier round
+    if(itProbe == _probes.end() || itProbe->second)
+        return;
+
+    qInfo() << "MTU" << mtu << "succeeded";
+    itProbe->second = true;
+    // Finish the round early if everything was answered
+    if(std::all_of(_probes.begin(), _probes.end(),
+                   [](const auto &probe){return probe.second;}))
+    {
+        finishRound();
+    }
 }
 
-void MtuPinger::timeout()
+void MtuPinger::probeTimeout()
 {
-    _pingTimeout.stop();
-    _retryCounter++;
-    if (_retryCounter > 2) {
-        _badMtu = _mtu;
-        qInfo() << "MTU" << _mtu << "timed out for all" << _retryCounter <<
-          "attempts, now have range" << _badMtu << "-" << _goodMtu;
-        _retryCounter = 0;
-        // apply MTU closer to the target, note that the good MTU can't be
-        // applied here since larget packets need to come through
-        applyMtu(_badMtu);
-    } else
-        qInfo() << "MTU" << _mtu << "timed out after try" <<
-            _retryCounter << ", try again";
-    start();
+    if(_transmissions < maxProbeTransmissions)
+    {
+        qInfo() << "MTU probe timed out after try" << _transmissions
+            << ", try again";
+        sendProbes();
+    }
+    else
+        finishRound();
 }
 
-void MtuPinger::receivedError(int code)
+void MtuPinger::finishRound()
 {
-    timeout();
+    _probeTimer.stop();
+
+    bool allAnswered = std::all_of(_probes.begin(), _probes.end(),
+                                   [](const auto &probe){return probe.second;});
+
+    // The largest answered size works.  The smallest unanswered size above
+    // that is too large - if a smaller size was lost, it doesn't matter since
+    // a larger size worked.
+    for(const auto &probe : _probes)
+    {
+        if(probe.second)
+            _goodMtu = std::max(_goodMtu, probe.first);
+    }
+    int newBadMtu = _badMtu;
+    for(const auto &probe : _probes)
+    {
+        if(!probe.second && probe.first > _goodMtu)
+        {
+            newBadMtu = std::min(newBadMtu, probe.first);
+            break;
+        }
+    }
+    _probes.clear();
+
+    if(_validating)
+    {
+        _validating = false;
+        if(allAnswered)
+        {
+            qInfo() << "MTU" << _goodMtu << "is still valid";
+            storeCachedMtu(_goodMtu);
+            _revalidateTimer.start();
+        }
+        else
+        {
+            qInfo() << "MTU" << _goodMtu << "no longer works, search again";
+            startSearch();
+        }
+        return;
+    }
+
+    if(newBadMtu < _badMtu)
+    {
+        _badMtu = newBadMtu;
+        qInfo() << "MTU" << _badMtu << "timed out for all" << maxProbeTransmissions
+            << "attempts, now have range" << _badMtu << "-" << _goodMtu;
+        // Apply an MTU closer to the target; the good MTU can't be applied
+        // yet since larger probes still need to come through
+        applyMtu(_badMtu - 1);
+    }
+    searchNext();
+}
+
+int MtuPinger::loadCachedMtu() const
+{
+    if(_cacheKey.isEmpty())
+        return 0;
+
+    const auto &entry = g_data.pathMtuCache().value(_cacheKey).toObject();
+    qint64 timestamp = entry.value(QStringLiteral("timestamp")).toInteger();
+    int mtu = entry.value(QStringLiteral("mtu")).toInt();
+    if(QDateTime::currentMSecsSinceEpoch() - timestamp > msec(mtuCacheMaxAge) ||
+       mtu < _floorMtu || mtu > _maxMtu)
+    {
+        return 0;
+    }
+    return mtu;
+}
+
+void MtuPinger::storeCachedMtu(int mtu) const
+{
+    if(_cacheKey.isEmpty())
+        return;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QJsonObject cache = g_data.pathMtuCache();
+    cache.insert(_cacheKey, QJsonObject{{QStringLiteral("timestamp"), now},
+                                        {QStringLiteral("mtu"), mtu}});
+
+    // Discard entries that are too old, then the oldest ones past the limit
+    std::vector<std::pair<qint64, QString>> timestamps;
+    auto itEntry = cache.begin();
+    while(itEntry != cache.end())
+    {
+        qint64 timestamp = itEntry.value().toObject().value(QStringLiteral("timestamp")).toInteger();
+        if(now - timestamp > msec(mtuCacheMaxAge))
+            itEntry = cache.erase(itEntry);
+        else
+        {
+            timestamps.push_back({timestamp, itEntry.key()});
+            ++itEntry;
+        }
+    }
+    if(timestamps.size() > mtuCacheLimit)
+    {
+        std::sort(timestamps.begin(), timestamps.end());
+        for(std::size_t i = 0; i < timestamps.size() - mtuCacheLimit; ++i)
+            cache.remove(timestamps[i].second);
+    }
+
+    g_data.pathMtuCache(std::move(cache));
 }
 
 void MtuPinger::applyMtu(int mtu)
 {
+    if(mtu == _appliedMtu)
+        return;
+    _appliedMtu = mtu;
     qInfo() << "set MTU: " << mtu;
 #if defined(Q_OS_WIN)
     auto pWinAdapter = std::static_pointer_cast<WinNetworkAdapter>(_pTunnelAdapter);
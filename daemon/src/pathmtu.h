@@ -29,6 +29,8 @@
 #include <QTimer>
 #include <QUdpSocket>
 #include <chrono>
+#include <map>
+#include <vector>
 
 #if defined(Q_OS_WIN)
 #include "win/win_ping.h"
@@ -36,6 +38,18 @@
 #include "posix/posix_ping.h"
 #endif
 
+// MtuPinger detects the path MTU through the tunnel, in the style of
+// packetization-layer PMTUD (RFC 8899) with ICMP probes.
+//
+// The search keeps a range between the largest size known to work and the
+// smallest size known not to work.  Each round probes several sizes spread
+// across the range at once, retransmitting unanswered probes once, so each
+// round narrows the range to a fraction of its size in about one probe timeout.
+//
+// The discovered MTU is cached per (network, server) in DaemonData.  When a
+// cached MTU is known, it's applied immediately and then just re-validated in
+// the background; the full search only runs if it no longer works.  The MTU
+// is also re-validated periodically while connected.
 class MtuPinger : public QObject
 {
     Q_OBJECT
@@ -52,6 +66,9 @@ public:
     //   and the known encapsulation overhead for the protocol in use
     // - The value of the MTU setting for this connection (-1 => auto,
     //   0 => large packets, >0 => specific MTU ("small packets" is 1250))
+    // - An identifier for the server and encapsulation in use (such as
+    //   "wireguard/<server IP>"); this is combined with the current network to
+    //   cache the discovered MTU.
     //
     // If auto is selected, MtuPinger starts probing to detect the actual MTU
     // and applies the results to the tunnel adapter.
@@ -59,23 +76,51 @@ public:
     // Otherwise, MtuPinger applies a specific MTU determined by the maximum
     // MTU and the MTU setting, then does not probe anything.
     MtuPinger(std::shared_ptr<NetworkAdapter> pTunnelAdapter, int maxTunnelMtu,
-              int mtuSetting);
+              int mtuSetting, const QString &pathId);
 
 private:
-    void start();
-    void receivedReply(quint32 addr);
-    void receivedError(int errCode);
-    void timeout();
+    // Start a full search over the whole range
+    void startSearch();
+    // Probe the next sizes in the search range, or finish the search if the
+    // range is small enough
+    void searchNext();
+    // Re-validate the current MTU with a single probe
+    void validate();
+    // Start a round probing the given sizes
+    void startRound(const std::vector<int> &sizes);
+    // Send (or re-send) the probes that haven't been answered yet
+    void sendProbes();
+    void receivedReply(int mtu);
+    void probeTimeout();
+    void finishRound();
     void applyMtu(int mtu);
+    // Load or store the MTU cached for this network and server.  Returns 0 if
+    // there is no cached MTU.
+    int loadCachedMtu() const;
+    void storeCachedMtu(int mtu) const;
 
 private:
     std::shared_ptr<NetworkAdapter> _pTunnelAdapter;
-    QTimer _pingTimeout;
+    // Key for the MTU cache, empty if the network isn't known
+    QString _cacheKey;
+    // Fires for each retransmission and then to end the round
+    QTimer _probeTimer;
+    // Starts periodic re-validation after the search completes
+    QTimer _revalidateTimer;
 #if defined(Q_OS_UNIX)
     PosixPing _ping;
 #endif
-    int _mtu, _goodMtu, _badMtu;
-    int _retryCounter;
+    int _maxMtu, _floorMtu;
+    int _goodMtu, _badMtu;
+    // The MTU currently applied to the tunnel interface, 0 if none has been
+    // applied yet
+    int _appliedMtu;
+    // Whether the current round is validating _goodMtu (rather than searching)
+    bool _validating;
+    // The sizes being probed in the current round, and whether each one has
+    // been answered
+    std::map<int, bool> _probes;
+    int _transmissions;
 };
 
 #endif // PATHMTU_H
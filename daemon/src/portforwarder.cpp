@@ -20,6 +20,7 @@
 #line SOURCE_FILE("portforwarder.cpp")
 
 #include "portforwarder.h"
+#include <common/src/wakeupaccounting.h>
 #include <common/src/testshim.h>
 #include <QJsonDocument>
 #include <QNetworkRequest>
@@ -44,6 +45,7 @@ PortForwarder::PortForwarder(ApiClient &apiClient, DaemonAccount &account,
 {
     _retryTimer.setInterval(msec(pfRetryDelay));
     _retryTimer.setSingleShot(true);
+    tagWakeups(_retryTimer, QByteArrayLiteral("portforward"));
     connect(&_retryTimer, &QTimer::timeout, this, &PortForwarder::requestPort);
 }
 
@@ -122,7 +124,8 @@ void PortForwarder::requestPort()
     // If, somehow, we were to try to do a PF request while not connected, this
     // would just default to the modern implementation.
     _pPortForwardRequest.reset(
-        new PortForwardRequestModern{_apiClient, _account, _state, _environment});
+        new PortForwardRequestModern{_apiClient, _account, _state, _environment,
+                                     _bindCache});
 
     emit portForwardUpdated(PortForwardState::Attempting);
     connect(_pPortForwardRequest.get(), &PortForwardRequest::stateUpdated,
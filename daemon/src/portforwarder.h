@@ -117,6 +117,9 @@ private:
     // If the port forward request enters the Retry state, we start this timer
     // to retry after a delay.
     QTimer _retryTimer;
+    // The last port bound, used by PortForwardRequestModern to report the
+    // port immediately when reconnecting to the same server
+    PortForwardBindCache _bindCache;
 };
 
 #endif // PORTFORWARDER_H
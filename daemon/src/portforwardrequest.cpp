@@ -20,6 +20,7 @@
 #line SOURCE_FILE("portforwardrequest.cpp")
 
 #include "portforwardrequest.h"
+#include <QRandomGenerator>
 #include <chrono>
 
 namespace
@@ -33,6 +34,9 @@ namespace
 
     // How often we need to bind the port to keep it alive.
     std::chrono::minutes modernPfBindInterval{15};
+    // Binds are scheduled up to this much earlier than the bind interval, so
+    // binds from clients that connected at the same time spread out.
+    std::chrono::seconds modernPfBindJitter{60};
 
     // Wait for the auth token to be available.  If we hadn't obtained a token
     // before connecting, we need to wait for the token to be obtained before
@@ -69,13 +73,25 @@ namespace
 PortForwardRequestModern::PortForwardRequestModern(ApiClient &apiClient,
                                                    DaemonAccount &account,
                                                    StateModel &state,
-                                                   const Environment &environment)
-    : _apiClient{apiClient}, _account{account},
+                                                   const Environment &environment,
+                                                   PortForwardBindCache &bindCache)
+    : _apiClient{apiClient}, _account{account}, _bindCache{bindCache},
       _pfApiBase{QStringLiteral("https://") + state.tunnelDeviceRemoteAddress() + QStringLiteral(":19999"),
                  environment.getRsa4096CA(),
                  state.connectedServer().isNull() ? QString{} : state.connectedServer()->commonName()},
-      _canRetry{true}
+      _gateway{state.tunnelDeviceRemoteAddress() + QChar('/') +
+               (state.connectedServer().isNull() ? QString{} : state.connectedServer()->commonName())},
+      _port{0}, _canRetry{true}
 {
+    // Rebind periodically to keep the forwarded port alive.  The interval is
+    // long, so this doesn't need to be precise.
+    _bindTimer.setSingleShot(true);
+    _bindTimer.setTimerType(Qt::TimerType::VeryCoarseTimer);
+    connect(&_bindTimer, &QTimer::timeout, this, [this]()
+    {
+        bindWithToken(false);
+    });
+
     if(!checkAccountPfToken())
     {
         // Reason traced by checkAccountPfToken()
@@ -109,31 +125,46 @@ PortForwardRequestModern::PortForwardRequestModern(ApiClient &apiClient,
                         // Obtained token, save it and bind the port
                         _account.portForwardPayload(token._payload);
                         _account.portForwardSignature(token._signature);
+                        useToken(token);
                         qInfo() << "Obtained token, bind port on this server";
-                        bindWithToken(token, true);
+                        bindWithToken(true);
                     }
                 });
     }
     else
     {
         // Use the existing token
-        qInfo() << "Already have existing token, bind port on this server";
-        bindWithToken({_account.portForwardPayload(),
-                       _account.portForwardSignature()}, true);
-    }
+        useToken({_account.portForwardPayload(), _account.portForwardSignature()});
 
-    // Rebind periodically to keep the forwarded port alive
-    _bindTimer.setInterval(msec(modernPfBindInterval));
-    connect(&_bindTimer, &QTimer::timeout, this, [this]()
-    {
-        bindWithToken({_account.portForwardPayload(),
-                       _account.portForwardSignature()}, false);
-    });
+        // If this token was just bound on this server (we reconnected to the
+        // same server), the port is still forwarded - report it now and
+        // refresh the bind in the background.  If the refresh fails, we go to
+        // the Retry state like any other bind failure.
+        if(_port > 0 && _bindCache.gateway == _gateway &&
+            _bindCache.payload == _token._payload && _bindCache.port == _port &&
+            !_bindCache.validUntil.hasExpired())
+        {
+            qInfo() << "Port" << _port
+                << "is still bound on this server, refresh bind";
+            // Emit after PortForwarder has connected to stateUpdated()
+            QMetaObject::invokeMethod(this, [this]
+                {
+                    _canRetry = true;
+                    emit stateUpdated(State::Success, _port);
+                }, Qt::QueuedConnection);
+            bindWithToken(false);
+        }
+        else
+        {
+            qInfo() << "Already have existing token, bind port on this server";
+            bindWithToken(true);
+        }
+    }
 }
 
-QJsonDocument PortForwardRequestModern::parsePfPayload()
+QJsonDocument PortForwardRequestModern::parsePfPayload(const QString &payload)
 {
-    auto portForwardJson = QByteArray::fromBase64(_account.portForwardPayload().toUtf8());
+    auto portForwardJson = QByteArray::fromBase64(payload.toUtf8());
     QJsonParseError parseErr;
     auto portForwardDoc = QJsonDocument::fromJson(portForwardJson, &parseErr);
     if(portForwardDoc.isNull())
@@ -141,6 +172,23 @@ QJsonDocument PortForwardRequestModern::parsePfPayload()
     return portForwardDoc;
 }
 
+void PortForwardRequestModern::useToken(PfToken token)
+{
+    _token = std::move(token);
+
+    // If the document couldn't be parsed, we'll get port 0, which is handled
+    // when the port is bound.  This is unlikely (would mean that the server
+    // signed and accepted invalid JSON) but could happen.
+    _port = parsePfPayload(_token._payload)[QStringLiteral("port")].toInt();
+    if(_port <= 0 || _port > std::numeric_limits<quint16>::max())
+        _port = 0;
+
+    _bindResource = QStringLiteral("bindPort?payload=") +
+        QString::fromLatin1(QUrl::toPercentEncoding(_token._payload)) +
+        QStringLiteral("&signature=") +
+        QString::fromLatin1(QUrl::toPercentEncoding(_token._signature));
+}
+
 bool PortForwardRequestModern::checkAccountPfToken()
 {
     if(_account.portForwardPayload().isEmpty() && _account.portForwardSignature().isEmpty())
@@ -161,7 +209,7 @@ bool PortForwardRequestModern::checkAccountPfToken()
 
     // Check if we have a valid port forwarding token, and it isn't going to
     // expire soon.
-    auto portForwardDoc = parsePfPayload();
+    auto portForwardDoc = parsePfPayload(_account.portForwardPayload());
     if(portForwardDoc.isNull())
     {
         qWarning() << "Discarding invalid token - unable to parse JSON";
@@ -212,6 +260,8 @@ void PortForwardRequestModern::retryNewToken()
     // Discard the existing token (if any) since it failed
     _account.portForwardPayload({});
     _account.portForwardSignature({});
+    _bindCache = {};
+    _bindTimer.stop();
     if(_canRetry)
     {
         qWarning() << "Unable to bind existing token, retry with new token";
@@ -224,13 +274,9 @@ void PortForwardRequestModern::retryNewToken()
     }
 }
 
-void PortForwardRequestModern::bindWithToken(const PfToken &token, bool initial)
+void PortForwardRequestModern::bindWithToken(bool initial)
 {
-    QString resource = QStringLiteral("bindPort?payload=") +
-        QString::fromLatin1(QUrl::toPercentEncoding(token._payload)) +
-        QStringLiteral("&signature=") +
-        QString::fromLatin1(QUrl::toPercentEncoding(token._signature));
-    _apiClient.getRetry(_pfApiBase, resource, {})
+    _apiClient.getRetry(_pfApiBase, _bindResource, {})
         ->notify(this, [this, initial](const Error &err, const QJsonDocument &bindResult)
         {
             if(err)
@@ -252,33 +298,37 @@ void PortForwardRequestModern::bindWithToken(const PfToken &token, bool initial)
             qInfo() << "Server accepted PF bind, message:"
                 << bindResult[QStringLiteral("message")].toString();
 
-            // If this is the first success, parse the token to find and emit
-            // the port.
+            // The port was parsed from the token when we started using it
+            if(_port <= 0)
+            {
+                qWarning() << "Could not determine port number from token";
+                retryNewToken();
+                return;
+            }
+
+            _bindCache.gateway = _gateway;
+            _bindCache.payload = _token._payload;
+            _bindCache.port = _port;
+            _bindCache.validUntil.setRemainingTime(msec(modernPfBindInterval));
+            scheduleBind();
+
+            // If this is the first success, emit the port.
             // If we have already succeeded, we don't need to emit the port
             // again, we're just keeping the bind alive.
             if(initial)
             {
-                // Parse the token to determine the port that was forwarded
-                auto portForwardDoc = parsePfPayload();
-                // If the document couldn't be parsed, we'll get port 0 and handle
-                // it below.  This is unlikely (would mean that the server signed
-                // and accepted invalid JSON) but could happen.
-                int port = portForwardDoc[QStringLiteral("port")].toInt();
-                if(port <= 0 || port > std::numeric_limits<quint16>::max())
-                {
-                    qWarning() << "Could not determine port number from token, got"
-                        << port;
-                    retryNewToken();
-                    return;
-                }
-
-                emit stateUpdated(State::Success, port);
+                emit stateUpdated(State::Success, _port);
 
                 // Since we successfully bound the port, if it later fails, we
                 // can attempt to get a new token, even if this was a new token
                 // for this attempt.
                 _canRetry = true;
-                _bindTimer.start();
             }
         });
 }
+
+void PortForwardRequestModern::scheduleBind()
+{
+    int jitter = QRandomGenerator::global()->bounded(msec32(modernPfBindJitter));
+    _bindTimer.start(msec32(modernPfBindInterval) - jitter);
+}
@@ -25,6 +25,8 @@
 #include <common/src/settings/daemonaccount.h>
 #include "model/state.h"
 #include "apiclient.h"
+#include <QDeadlineTimer>
+#include <QTimer>
 
 // PortForwardRequest is the interface to the port forwarding implementation.
 // Historically there was an alternate implementation for the legacy
@@ -63,6 +65,21 @@ signals:
 };
 
 
+// The last port bound by PortForwardRequestModern.  PortForwarder keeps this
+// across requests, so when reconnecting to the same server with the same PF
+// token, the port can be reported immediately while the bind is refreshed.
+struct PortForwardBindCache
+{
+    // The server the port was bound on - remote tunnel address and CN
+    QString gateway;
+    // The PF payload that was bound
+    QString payload;
+    int port{0};
+    // The bind is known to still be alive until this expires (one bind
+    // interval after the last successful bind)
+    QDeadlineTimer validUntil;
+};
+
 // This is the modern infrastructure implementation of PortForwardRequest.
 // - This uses the portForwardPayload and portForwardSignature from
 //   DaemonAccount (collectively, the "PF token").
@@ -75,6 +92,9 @@ signals:
 // - bindPort will be called periodically to keep the port bound.  If this
 //   fails, it will wipe the token and go to the Retry state to attempt to
 //   allocate and bind a new port.
+// - If the same token was bound on the same server within the last bind
+//   interval (see PortForwardBindCache), the port is reported right away, and
+//   the bind is refreshed in the background.
 class PortForwardRequestModern : public PortForwardRequest
 {
     Q_OBJECT
@@ -87,11 +107,16 @@ private:
 
 public:
     PortForwardRequestModern(ApiClient &apiClient, DaemonAccount &account,
-                             StateModel &state, const Environment &environment);
+                             StateModel &state, const Environment &environment,
+                             PortForwardBindCache &bindCache);
 
 private:
-    // Parse the PF payload from DaemonAccount into a JSON document.
-    QJsonDocument parsePfPayload();
+    // Parse a PF payload into a JSON document.
+    QJsonDocument parsePfPayload(const QString &payload);
+    // Use a PF token for this request - parse the port from the payload and
+    // build the bind resource.  These don't change while the token is in use,
+    // so they are only computed once.
+    void useToken(PfToken token);
 
     // Check whether DaemonAccount holds a valid PF token, and if so, if it will
     // expire soon.
@@ -108,16 +133,26 @@ private:
     // retry is possible.
     void retryNewToken();
 
-    // Bind the port to the current server.  If this was the initial bind, it
-    // also starts the recurring bind timer and emits the Success state with the
-    // bound port.
-    void bindWithToken(const PfToken &token, bool initial);
+    // Bind the port to the current server using the current token.  If this
+    // was the initial bind, it also emits the Success state with the bound
+    // port.  Each successful bind schedules the next one.
+    void bindWithToken(bool initial);
+    // Schedule the next bind - one bind interval from now, less some jitter so
+    // binds from many clients don't line up
+    void scheduleBind();
 
 private:
     ApiClient &_apiClient;
     DaemonAccount &_account;
+    PortForwardBindCache &_bindCache;
     FixedApiBase _pfApiBase;
+    // Identifies the server - remote tunnel address and CN
     QString _gateway;
+    // The token in use, the port it forwards (0 if it couldn't be determined),
+    // and the resource used to bind it
+    PfToken _token;
+    int _port;
+    QString _bindResource;
     // Whether we are able to retry with a new token if the request fails.
     // If we just obtained a new token and it fails immediately, we won't retry;
     // an old token or a token that fails after being bound for a while can be
@@ -53,6 +53,7 @@
 #include <kapps_net/src/firewall.h>
 
 #include <QDir>
+#include <QStandardPaths>
 
 #include <QOperatingSystemVersion>
 
@@ -67,6 +68,36 @@ namespace
 }
 #endif
 
+#ifdef Q_OS_LINUX
+namespace
+{
+    // Names of results kept in LinuxProbeCache
+    const QString iptablesProbeName{QStringLiteral("iptablesVersion")};
+    const QString wireguardModuleProbeName{QStringLiteral("wireguardModule")};
+
+    // Check the first line of "iptables --version" output - 1.6.1 or newer is
+    // required.
+    bool isIptablesVersionValid(const QByteArray &output)
+    {
+        auto match = QRegularExpression{R"(([0-9]+)(\.|)([0-9]+|)(\.|)([0-9]+|))"}.match(output);
+        // Note that captured() returns QString{} by default if the pattern didn't
+        // match, so these will be 0 by default.
+        auto major = match.captured(1).toInt();
+        auto minor = match.captured(3).toInt();
+        auto patch = match.captured(5).toInt();
+        // output.data() is "iptables vX.X.X (nf_tables)" when iptables is installed
+        // otherwise it is empty when no iptables package is installed.
+        qInfo().nospace() << "iptables version command output " << output.data()
+        << " -> " << major << "." << minor << "." << patch;
+
+        // SemVersion implements a suitable operator<(), we don't use it to parse
+        // the version because we're not sure that iptables will always return three
+        // parts in its version number though.
+        return !(SemVersion{major, minor, patch} < SemVersion{1, 6, 1});
+    }
+}
+#endif
+
 void setUidAndGid()
 {
     // Make sure we're running as root:VPN_GROUP
@@ -157,9 +188,9 @@ PosixDaemon::PosixDaemon()
     // Check for the WireGuard kernel module
     connect(&_linuxModSupport, &LinuxModSupport::modulesUpdated, this,
             &PosixDaemon::checkLinuxModules);
-    connect(this, &Daemon::networksChanged, this, &PosixDaemon::updateExistingDNS);
-    connect(&_resolvconfWatcher, &FileWatcher::changed, this, &PosixDaemon::updateExistingDNS);
-    updateExistingDNS();
+    connect(this, &Daemon::networksChanged, this, [this]{updateExistingDNS(true);});
+    connect(&_resolvconfWatcher, &FileWatcher::changed, this, [this]{updateExistingDNS(false);});
+    updateExistingDNS(true);
 
     checkLinuxModules();
 
@@ -304,27 +335,64 @@ void PosixDaemon::handleSignal(int sig) Q_DECL_NOEXCEPT
 }
 
 #ifdef Q_OS_LINUX
-void PosixDaemon::updateExistingDNS()
+namespace
+{
+    // Read the 'nameserver' entries from a resolv.conf-format file
+    QStringList readNameservers(const QString &path)
+    {
+        QStringList nameservers;
+        QFile file{path};
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qInfo() << "Unable to read" << path << "-" << file.errorString();
+            return nameservers;
+        }
+        while(!file.atEnd())
+        {
+            auto fields = QString::fromUtf8(file.readLine()).simplified().split(' ');
+            if(fields.size() >= 2 && fields[0] == QStringLiteral("nameserver"))
+                nameservers.push_back(fields[1]);
+        }
+        return nameservers;
+    }
+}
+
+void PosixDaemon::updateExistingDNS(bool networkChanged)
 {
-    qInfo() << "Networks changed, updating existing DNS";
     const auto netScan = originalNetwork();
-    // Use realpath, not QFile::symlinkTarget(), to match the updown script -
-    // resolvconf usually uses 2 or more symlinks to reach the actual file from
-    // /etc/resolv.conf.
-    QString linkTarget = Exec::bashWithOutput(QStringLiteral("realpath /etc/resolv.conf"));
-    if(linkTarget.endsWith('\n'))
-        linkTarget.remove(linkTarget.size()-1, 1);
+    // Use realpath semantics, not QFile::symlinkTarget(), to match the updown
+    // script - resolvconf usually uses 2 or more symlinks to reach the actual
+    // file from /etc/resolv.conf.
+    QString linkTarget = QFileInfo{QStringLiteral("/etc/resolv.conf")}.canonicalFilePath();
     const QString resolvBackup = Path::DaemonDataDir / QStringLiteral("pia.resolv.conf");
 
+    // With systemd-resolved, /etc/resolv.conf just points to the local stub
+    // resolver, so a change to that file without a network change doesn't
+    // affect the upstream servers - there's no need to query resolved again.
+    // (This happens each time we connect or disconnect, for example.)
+    bool systemdResolved = linkTarget.contains("systemd");
+    if(!networkChanged && systemdResolved &&
+        linkTarget == _existingDnsLinkTarget &&
+        netScan.interfaceName() == _existingDnsInterface)
+    {
+        qInfo() << "resolv.conf changed, but still using systemd-resolved on"
+            << netScan.interfaceName() << "- existing DNS is unchanged";
+        return;
+    }
+    _existingDnsLinkTarget = linkTarget;
+    _existingDnsInterface = netScan.interfaceName();
+
+    qInfo() << (networkChanged ? "Networks changed" : "resolv.conf changed")
+        << "- updating existing DNS";
     qInfo() << "realpath /etc/resolv.conf ->" << linkTarget;
 
     // systemd-resolve: connected or disconnected
     QStringList rawDnsList;
-    if(linkTarget.contains("systemd"))
+    if(systemdResolved)
     {
         // systemd-resolve was replaced with resolvectl in newer versions of
         // systemd
-        if(0 == Exec::bash(QStringLiteral("which resolvectl"), true))
+        if(!QStandardPaths::findExecutable(QStringLiteral("resolvectl")).isEmpty())
         {
             qInfo() << "Saving existingDNS for systemd using resolvectl";
             QString output = Exec::bashWithOutput(QStringLiteral("resolvectl dns | grep %1 | cut -d ':' -f 2-").arg(QString::fromStdString(netScan.interfaceName())));
@@ -404,26 +472,21 @@ void PosixDaemon::updateExistingDNS()
         {
             // Ignore tun devices, otherwise look for 'nameserver' lines just
             // like resolv.conf
-            if(!itf.startsWith("tun"))
-            {
-                QString output = Exec::bashWithOutput(QStringLiteral("cat '/run/resolvconf/interface/%1' | awk '$1==\"nameserver\" { printf \"%s \", $2; }'").arg(itf));
-                rawDnsList += output.split(' ');
-            }
+            if(!itf.isEmpty() && !itf.startsWith("tun"))
+                rawDnsList += readNameservers(QStringLiteral("/run/resolvconf/interface/") + itf);
         }
     }
     // resolv.conf - connected
     else if(QFile::exists(resolvBackup))
     {
         qInfo() << "Saving existing DNS - resolv.conf, connected";
-        QString output = Exec::bashWithOutput(QStringLiteral("cat %1 | awk '$1==\"nameserver\" { printf \"%s \", $2; }'").arg(resolvBackup));
-        rawDnsList = output.split(' ');
+        rawDnsList = readNameservers(resolvBackup);
     }
     // resolv.conf - disconnected
     else
     {
         qInfo() << "Saving existing DNS - resolv.conf, disconnected";
-        QString output = Exec::bashWithOutput(QStringLiteral("cat /etc/resolv.conf | awk '$1==\"nameserver\" { printf \"%s \", $2; }'"));
-        rawDnsList = output.split(' ');
+        rawDnsList = readNameservers(QStringLiteral("/etc/resolv.conf"));
     }
 
     std::vector<quint32> dnsIps;
@@ -482,10 +545,25 @@ void PosixDaemon::applyFirewallRules(kapps::net::FirewallParams params)
         params.transparentProxyLogEnabled = (daemonDebugLogEnabled != nullptr) ? true : false;
 #endif
 
-    if(_pFirewall)
-        _pFirewall->applyRules(params);
-    else
+    if(!_pFirewall)
+    {
         qInfo() << "Firewall has already been shut down, not applying firewall rules";
+        return;
+    }
+
+    // Several changes often cause a reapply with the same result (such as a
+    // settings change that doesn't affect the rules); the firewall state
+    // depends only on these parameters on Mac/Linux, so skip those.
+    if(_lastFirewallParams && *_lastFirewallParams == params)
+    {
+        qInfo() << "Firewall parameters have not changed, nothing to apply";
+        return;
+    }
+
+    _pFirewall->applyRules(params);
+    _lastFirewallParams = std::move(params);
+    _state.lastFirewallApply(_pFirewall->lastApplyStats());
+    _state.totalFirewallApply(_pFirewall->totalApplyStats());
 }
 
 #ifdef Q_OS_MAC
@@ -542,10 +620,7 @@ auto tcpdumpMetaEndpoint(const StateModel &state)
     };
 
     NearestLocations nearest(state.availableLocations());
-    QSharedPointer<const Location> pMetaRegion = nearest.getBestMatchingLocation([](const Location &loc)
-    {
-        return loc.hasService(Service::Meta);
-    });
+    QSharedPointer<const Location> pMetaRegion = nearest.getBestLocationForService(Service::Meta);
 
     const Server *pMetaServer{};
     if(pMetaRegion)
@@ -741,50 +816,20 @@ void PosixDaemon::checkFeatureSupport()
     std::vector<QString> errors;
 
 #ifdef Q_OS_LINUX
-    // iptables 1.6.1 is required.
-    QProcess iptablesVersion;
-    iptablesVersion.start(QStringLiteral("iptables"), QStringList{QStringLiteral("--version")});
-    iptablesVersion.waitForFinished();
-
-    bool iptablesDetected = false;
-    // To correctly evaluate the exitCode the process must have a NormalExit exitStatus
-    // otherwise we assume there was a problem with it.
-    if(iptablesVersion.exitStatus() == QProcess::NormalExit)
-    {
-        // Every non zero exitCode value (1-255) means the command "iptables --version"
-        // returned an error.
-        if(iptablesVersion.exitCode() == 0)
-        {
-            iptablesDetected = true;
-        }
+    // iptables 1.6.1 is required.  Use the last result if it's cached, the
+    // probe is re-run asynchronously and updates the errors if it changed.
+    QJsonObject cachedIptables = _probeCache.get(iptablesProbeName).toObject();
+    if(!cachedIptables.isEmpty())
+    {
+        bool detected = cachedIptables.value(QStringLiteral("detected")).toBool();
+        QByteArray output = cachedIptables.value(QStringLiteral("output")).toString().toUtf8();
+        qInfo() << "Using cached iptables version result";
+        if(!detected)
+            _state.vpnSupportErrors({QStringLiteral("iptables_missing")});
+        if(!isIptablesVersionValid(output))
+            errors.push_back(QStringLiteral("iptables_invalid"));
     }
-    // Adding the error to the vpnSupportErrors JsonProperty
-    if(!iptablesDetected)
-        _state.vpnSupportErrors({QStringLiteral("iptables_missing")});
-
-    qInfo() << "vpnSupportErrors: " << _state.vpnSupportErrors();
-
-    auto output = iptablesVersion.readAllStandardOutput();
-    auto outputNewline = output.indexOf('\n');
-    // First line only
-    if(outputNewline >= 0)
-        output = output.left(outputNewline);
-    auto match = QRegularExpression{R"(([0-9]+)(\.|)([0-9]+|)(\.|)([0-9]+|))"}.match(output);
-    // Note that captured() returns QString{} by default if the pattern didn't
-    // match, so these will be 0 by default.
-    auto major = match.captured(1).toInt();
-    auto minor = match.captured(3).toInt();
-    auto patch = match.captured(5).toInt();
-    // output.data() is "iptables vX.X.X (nf_tables)" when iptables is installed
-    // otherwise it is empty when no iptables package is installed.
-    qInfo().nospace() << "iptables version command output " << output.data()
-    << " -> " << major << "." << minor << "." << patch;
-
-    // SemVersion implements a suitable operator<(), we don't use it to parse
-    // the version because we're not sure that iptables will always return three
-    // parts in its version number though.
-    if(SemVersion{major, minor, patch} < SemVersion{1, 6, 1})
-        errors.push_back(QStringLiteral("iptables_invalid"));
+    probeIptablesVersion();
 
     // If the network monitor couldn't be created, libnl is missing.  (This was
     // not required in some releases, but it is now used to monitor the default
@@ -861,10 +906,95 @@ void PosixDaemon::checkFeatureSupport()
 }
 
 #ifdef Q_OS_LINUX
+void PosixDaemon::setSplitTunnelSupportError(const QString &error, bool present)
+{
+    auto errors = _state.splitTunnelSupportErrors();
+    auto itError = std::find(errors.begin(), errors.end(), error);
+    if(present && itError == errors.end())
+        errors.push_back(error);
+    else if(!present && itError != errors.end())
+        errors.erase(itError);
+    else
+        return;
+    _state.splitTunnelSupportErrors(errors);
+}
+
+void PosixDaemon::probeIptablesVersion()
+{
+    QProcess *pIptables = new QProcess{this};
+    auto complete = [this, pIptables](bool detected)
+    {
+        pIptables->deleteLater();
+
+        auto output = pIptables->readAllStandardOutput();
+        auto outputNewline = output.indexOf('\n');
+        // First line only
+        if(outputNewline >= 0)
+            output = output.left(outputNewline);
+
+        _probeCache.set(iptablesProbeName, QJsonObject{
+            {QStringLiteral("detected"), detected},
+            {QStringLiteral("output"), QString::fromUtf8(output)}
+        });
+
+        // Adding the error to the vpnSupportErrors JsonProperty
+        if(detected)
+            _state.vpnSupportErrors({});
+        else
+            _state.vpnSupportErrors({QStringLiteral("iptables_missing")});
+        qInfo() << "vpnSupportErrors: " << _state.vpnSupportErrors();
+
+        setSplitTunnelSupportError(QStringLiteral("iptables_invalid"),
+                                   !isIptablesVersionValid(output));
+    };
+
+    // To correctly evaluate the exitCode the process must have a NormalExit
+    // exitStatus, otherwise we assume there was a problem with it.  Every non
+    // zero exitCode value (1-255) means the command "iptables --version"
+    // returned an error.
+    connect(pIptables, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [complete](int exitCode, QProcess::ExitStatus exitStatus)
+            {
+                complete(exitStatus == QProcess::NormalExit && exitCode == 0);
+            });
+    // finished() isn't emitted if iptables can't be started at all
+    connect(pIptables, &QProcess::errorOccurred, this,
+            [complete](QProcess::ProcessError error)
+            {
+                if(error == QProcess::FailedToStart)
+                    complete(false);
+            });
+    pIptables->start(QStringLiteral("iptables"), QStringList{QStringLiteral("--version")});
+}
+
 void PosixDaemon::checkLinuxModules()
 {
-    bool hasWg = _linuxModSupport.hasModule(QStringLiteral("wireguard"));
-    _state.wireguardKernelSupport(hasWg);
-    qInfo() << "Wireguard kernel module present:" << hasWg;
+    const QString wireguardModule{QStringLiteral("wireguard")};
+
+    // If the module is loaded, there's no need to check anything else.
+    // Otherwise, use the cached result (if modules.dep hasn't changed) while
+    // modprobe checks asynchronously.
+    if(_linuxModSupport.isModuleLoaded(wireguardModule))
+    {
+        _state.wireguardKernelSupport(true);
+        qInfo() << "Wireguard kernel module present:" << true;
+        return;
+    }
+
+    QString modulesDepStamp = _linuxModSupport.modulesDepStamp();
+    QJsonValue cachedHasWg = _probeCache.get(wireguardModuleProbeName, modulesDepStamp);
+    if(cachedHasWg.isBool())
+    {
+        _state.wireguardKernelSupport(cachedHasWg.toBool());
+        qInfo() << "Wireguard kernel module present (cached):" << cachedHasWg.toBool();
+    }
+
+    _linuxModSupport.checkModule(wireguardModule,
+        [this, modulesDepStamp](bool hasWg)
+        {
+            _probeCache.set(wireguardModuleProbeName, hasWg, modulesDepStamp);
+            _state.wireguardKernelSupport(hasWg);
+            qInfo() << "Wireguard kernel module present:" << hasWg;
+        });
 }
 #endif
@@ -33,6 +33,7 @@
 #include "../mac/net_extension_checker.h"
 #elif defined(Q_OS_LINUX)
 #include "../linux/linux_modsupport.h"
+#include "../linux/linux_probecache.h"
 #include <kapps_net/src/linux/linux_cn_proc.h>
 #endif
 
@@ -58,7 +59,9 @@ protected:
     virtual void applyPlatformInstallFeatureFlags() override {}
 private:
 #if defined(Q_OS_LINUX)
-    void updateExistingDNS();
+    // Detect the existing DNS servers.  'networkChanged' indicates that the
+    // default network changed; otherwise /etc/resolv.conf changed.
+    void updateExistingDNS(bool networkChanged);
 #endif
 
     // Check whether the host supports advanced features (split tunnel,
@@ -70,7 +73,14 @@ private:
     void onAboutToConnect();
 
 #ifdef Q_OS_LINUX
+    // Check for the WireGuard kernel module.  A cached result is applied
+    // immediately if available; the module is then checked asynchronously.
     void checkLinuxModules();
+    // Run "iptables --version" asynchronously, then update the cached result
+    // and support errors
+    void probeIptablesVersion();
+    // Add or remove one error in splitTunnelSupportErrors
+    void setSplitTunnelSupportError(const QString &error, bool present);
 #endif
 
 private:
@@ -81,7 +91,14 @@ private:
 
 #ifdef Q_OS_LINUX
     FileWatcher _resolvconfWatcher;
+    // The resolv.conf target and interface used for the last existing DNS
+    // update; see updateExistingDNS()
+    QString _existingDnsLinkTarget;
+    std::string _existingDnsInterface;
     LinuxModSupport _linuxModSupport;
+    // Results of feature probes from the last run, see checkFeatureSupport()
+    // and checkLinuxModules()
+    LinuxProbeCache _probeCache;
     // Used to test if the running kernel is configured with cn_proc; there's no
     // way to figure this out other than to try to connect to it and see if we
     // get the initial notification.
@@ -99,6 +116,8 @@ private:
     // this can be nullptr; it's cleared early if we receive a signal that will
     // shut down the daemon.
     nullable_t<kapps::net::Firewall> _pFirewall;
+    // The parameters last applied to _pFirewall; see applyFirewallRules()
+    nullable_t<kapps::net::FirewallParams> _lastFirewallParams;
 };
 
 void setUidAndGid();
@@ -32,6 +32,7 @@ void dummyPosixMain() {}
 #include "version.h"
 #include "brand.h"
 #include <common/src/dtop.h>
+#include <common/src/wakeupaccounting.h>
 
 #include <exception>
 #include <stdexcept>
@@ -110,7 +111,7 @@ int main(int argc, char** argv)
     umask(S_IWGRP | S_IWOTH);
 
     Path::initializePreApp();
-    QCoreApplication app(argc, argv);
+    WakeupAccountingApplication app(argc, argv);
 
     g_oldTerminateHandler = std::set_terminate(terminateHandler);
 
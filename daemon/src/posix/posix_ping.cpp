@@ -20,17 +20,40 @@
 #line SOURCE_FILE("posix_ping.cpp")
 
 #include "posix_ping.h"
+#include <common/src/wakeupaccounting.h>
 #include <QRandomGenerator>
 #include <QTimer>
 #include <QHostAddress>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <netinet/ip.h>
 #include <fcntl.h>
+#include <algorithm>
+#include <array>
+#include <ctime>
+#include <cstring>
 
-PosixPing::PosixPing()
-    : _identifier{static_cast<quint16>(QRandomGenerator::global()->bounded(std::numeric_limits<quint16>::max()))},
+namespace
+{
+    // Requests older than this can't be answered any more; LatencyBatch and
+    // MtuPinger give up well before this.
+    const std::chrono::seconds pendingEchoExpiration{30};
+
+    // Get the current time from the same clock used for kernel receive
+    // timestamps
+    std::chrono::nanoseconds realtimeNow()
+    {
+        timespec now{};
+        ::clock_gettime(CLOCK_REALTIME, &now);
+        return std::chrono::seconds{now.tv_sec} + std::chrono::nanoseconds{now.tv_nsec};
+    }
+}
+
+PosixPing::PosixPing(QObject *pParent)
+    : QObject{pParent},
+      _identifier{static_cast<quint16>(QRandomGenerator::global()->bounded(std::numeric_limits<quint16>::max()))},
       _nextSequence{0}
 {
     // Unit tests don't run as root, so we can't actually do the ICMP pings.  We
@@ -49,11 +72,24 @@ PosixPing::PosixPing()
       qWarning() << "Failed to set IP_HDRINCL flag on ICMP socket";
     }
 
+    // Ask for receive timestamps, so latency measurements don't include the
+    // time taken to wake up and read the reply.  If this fails, the time is
+    // taken when the reply is read instead.
+#if defined(Q_OS_LINUX)
+    if(setsockopt(_icmpSocket.get(), SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(val)) < 0)
+#else
+    if(setsockopt(_icmpSocket.get(), SOL_SOCKET, SO_TIMESTAMP, &val, sizeof(val)) < 0)
+#endif
+    {
+        qWarning() << "Failed to enable receive timestamps on ICMP socket:" << errno;
+    }
+
     // apply NONBLOCK flag
     int oldFlags = ::fcntl(_icmpSocket.get(), F_GETFL);
     ::fcntl(_icmpSocket.get(), F_SETFL, oldFlags | O_NONBLOCK);
 
     _pReadNotifier.emplace(_icmpSocket.get(), QSocketNotifier::Type::Read);
+    tagWakeups(*_pReadNotifier, QByteArrayLiteral("ping"));
     connect(_pReadNotifier.ptr(), &QSocketNotifier::activated, this,
             &PosixPing::onReadyRead);
 #endif
@@ -82,27 +118,11 @@ quint16 PosixPing::calcChecksum(const quint8 *data, std::size_t len) const
     return ~static_cast<quint16>(accum);
 }
 
-bool PosixPing::sendEchoRequest(quint32 address, int payloadSize, bool allowFragment)
+quint16 PosixPing::buildEchoRequest(std::vector<quint8> &rawPacket,
+                                    quint32 address, int payloadSize)
 {
-#ifdef UNIT_TEST
-    // Fake this in unit tests since we can't send real ICMP pings when not run
-    // as root.
-    // Unit tests use the IPv4 documentation range to test a lack of response,
-    // so check for that too (but act like a request was sent with no reply).
-    if((address & 0xFFFFFF00) != 0xC0000200)    // 192.0.2.0/24
-    {
-        qInfo() << "Mocking ping to" << QHostAddress{address};
-        QTimer::singleShot(30, this, [this, address]{emit receivedReply(address);});
-    }
-    return true;
-#endif
-    if(!_icmpSocket)
-        return false; // Can't do anything, failed to open raw socket - traced earlier
-
-    // Build an ICMP echo request packet.
     int rawPacketSize = sizeof(IcmpEcho) + payloadSize + sizeof(struct ip);
     int packetSize = sizeof(IcmpEcho) + payloadSize;
-    std::vector<std::uint8_t> rawPacket;
     rawPacket.resize(rawPacketSize);
     quint8* pRawPacket = rawPacket.data();
     quint8* packet = pRawPacket + sizeof(struct ip);
@@ -124,13 +144,15 @@ bool PosixPing::sendEchoRequest(quint32 address, int payloadSize, bool allowFrag
     ip->ip_sum = 0;
     ip->ip_dst.s_addr = htonl(address);
 
+    quint16 sequence = _nextSequence;
+    ++_nextSequence;
+
     pEcho->type = 8;
     pEcho->code = 0;
     pEcho->checksum = 0;
     pEcho->identifier = htons(_identifier);
-    pEcho->sequence = htons(_nextSequence);
+    pEcho->sequence = htons(sequence);
 
-    ++_nextSequence;
     // The default payload on Mac/Linux is 56 bytes from 0x00 - 0x37.  The first
     // few bytes are replaced with a timestamp.
     for(int i = 0; i < payloadSize; ++i)
@@ -157,6 +179,49 @@ bool PosixPing::sendEchoRequest(quint32 address, int payloadSize, bool allowFrag
     // carries in.
     pEcho->checksum = calcChecksum(packet, packetSize);
 
+    return sequence;
+}
+
+void PosixPing::addPendingEcho(quint16 sequence, quint32 address,
+                               int payloadSize, std::chrono::nanoseconds sentTime)
+{
+    auto itPending = _pendingEchoes.begin();
+    while(itPending != _pendingEchoes.end())
+    {
+        if(sentTime - itPending->second.sentTime > pendingEchoExpiration)
+            itPending = _pendingEchoes.erase(itPending);
+        else
+            ++itPending;
+    }
+
+    _pendingEchoes[sequence] = {address, payloadSize, sentTime};
+}
+
+bool PosixPing::sendEchoRequest(quint32 address, int payloadSize, bool allowFragment)
+{
+#ifdef UNIT_TEST
+    // Fake this in unit tests since we can't send real ICMP pings when not run
+    // as root.
+    // Unit tests use the IPv4 documentation range to test a lack of response,
+    // so check for that too (but act like a request was sent with no reply).
+    if((address & 0xFFFFFF00) != 0xC0000200)    // 192.0.2.0/24
+    {
+        qInfo() << "Mocking ping to" << QHostAddress{address};
+        QTimer::singleShot(30, this, [this, address, payloadSize]
+        {
+            emit receivedReply(address, std::chrono::milliseconds{30}, payloadSize);
+        });
+    }
+    return true;
+#endif
+    if(!_icmpSocket)
+        return false; // Can't do anything, failed to open raw socket - traced earlier
+
+    // Build an ICMP echo request packet.
+    std::vector<std::uint8_t> rawPacket;
+    quint16 sequence = buildEchoRequest(rawPacket, address, payloadSize);
+    struct ip *ip = reinterpret_cast<struct ip *>(rawPacket.data());
+
     if (!allowFragment) {
 #if defined(Q_OS_MAC)
         ip->ip_off = IP_DF;
@@ -176,7 +241,8 @@ bool PosixPing::sendEchoRequest(quint32 address, int payloadSize, bool allowFrag
     to.sin_family = AF_INET;
     to.sin_port = 0;    // Not used for ICMP raw socket
     to.sin_addr.s_addr = htonl(address);
-    auto sent = ::sendto(_icmpSocket.get(), pRawPacket, rawPacketSize, 0,
+    auto sentTime = realtimeNow();
+    auto sent = ::sendto(_icmpSocket.get(), rawPacket.data(), rawPacket.size(), 0,
                          reinterpret_cast<sockaddr*>(&to), sizeof(to));
     if(sent < 0)
     {
@@ -192,17 +258,83 @@ bool PosixPing::sendEchoRequest(quint32 address, int payloadSize, bool allowFrag
         }
         return false;
     }
-    else if(sent != rawPacketSize)
+    else if(static_cast<std::size_t>(sent) != rawPacket.size())
     {
-        qWarning() << "Only sent" << sent << "/" << rawPacketSize
+        qWarning() << "Only sent" << sent << "/" << rawPacket.size()
             << "bytes in ping to" << QHostAddress{address}.toString();
         return false;
     }
 
+    addPendingEcho(sequence, address, payloadSize, sentTime);
     return true;
 }
 
-void PosixPing::onReadyRead()
+std::vector<quint32> PosixPing::sendEchoRequests(const std::vector<quint32> &addresses)
+{
+    std::vector<quint32> sentAddresses;
+    sentAddresses.reserve(addresses.size());
+
+#if defined(Q_OS_LINUX) && !defined(UNIT_TEST)
+    if(!_icmpSocket)
+        return sentAddresses; // Failed to open raw socket - traced earlier
+
+    // Build all the packets, then send them with as few calls to sendmmsg()
+    // as possible.
+    std::vector<std::vector<quint8>> packets(addresses.size());
+    std::vector<quint16> sequences(addresses.size());
+    std::vector<sockaddr_in> destinations(addresses.size());
+    std::vector<iovec> iovecs(addresses.size());
+    std::vector<mmsghdr> messages(addresses.size());
+    for(std::size_t i = 0; i < addresses.size(); ++i)
+    {
+        sequences[i] = buildEchoRequest(packets[i], addresses[i], 32);
+        destinations[i].sin_family = AF_INET;
+        destinations[i].sin_port = 0;    // Not used for ICMP raw socket
+        destinations[i].sin_addr.s_addr = htonl(addresses[i]);
+        iovecs[i].iov_base = packets[i].data();
+        iovecs[i].iov_len = packets[i].size();
+        messages[i].msg_hdr.msg_name = &destinations[i];
+        messages[i].msg_hdr.msg_namelen = sizeof(destinations[i]);
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    std::size_t next{0};
+    while(next < messages.size())
+    {
+        auto sentTime = realtimeNow();
+        int sentCount = ::sendmmsg(_icmpSocket.get(), messages.data() + next,
+                                   messages.size() - next, 0);
+        if(sentCount <= 0)
+        {
+            // sendmmsg() only fails if the first remaining message couldn't be
+            // sent; skip it and continue with the rest.
+            qWarning() << "Failed to ping" << QHostAddress{addresses[next]}.toString()
+                << "-" << errno;
+            ++next;
+            continue;
+        }
+
+        for(int i = 0; i < sentCount; ++i, ++next)
+        {
+            addPendingEcho(sequences[next], addresses[next], 32, sentTime);
+            sentAddresses.push_back(addresses[next]);
+        }
+    }
+#else
+    // No sendmmsg() on macOS, and unit tests mock each request; send the
+    // requests individually.
+    for(quint32 address : addresses)
+    {
+        if(sendEchoRequest(address))
+            sentAddresses.push_back(address);
+    }
+#endif
+
+    return sentAddresses;
+}
+
+bool PosixPing::readReply()
 {
     struct Ipv4
     {
@@ -219,20 +351,56 @@ void PosixPing::onReadyRead()
     };
 
     alignas(Ipv4) std::array<quint8, 2048> packet;
-    auto read = recv(_icmpSocket.get(), packet.data(), packet.size(), 0);
+    alignas(cmsghdr) std::array<char, 256> control;
+    iovec packetIov{packet.data(), packet.size()};
+    msghdr message{};
+    message.msg_iov = &packetIov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    auto read = ::recvmsg(_icmpSocket.get(), &message, 0);
     if(read < 0)
     {
-        // Shouldn't happen, socket said it was ready
-        qWarning() << "Failed to read from ICMP socket -" << read << "- err:"
-            << errno;
-        return;
+        // EWOULDBLOCK just means that all packets have been read
+        if(errno != EWOULDBLOCK && errno != EAGAIN)
+        {
+            qWarning() << "Failed to read from ICMP socket -" << read << "- err:"
+                << errno;
+        }
+        return false;
     }
 
+    // Use the kernel receive timestamp if there is one
+    std::chrono::nanoseconds receivedTime{0};
+    for(cmsghdr *pCmsg = CMSG_FIRSTHDR(&message); pCmsg;
+        pCmsg = CMSG_NXTHDR(&message, pCmsg))
+    {
+#if defined(Q_OS_LINUX)
+        if(pCmsg->cmsg_level == SOL_SOCKET && pCmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec timestamp{};
+            std::memcpy(&timestamp, CMSG_DATA(pCmsg), sizeof(timestamp));
+            receivedTime = std::chrono::seconds{timestamp.tv_sec} +
+                std::chrono::nanoseconds{timestamp.tv_nsec};
+        }
+#else
+        if(pCmsg->cmsg_level == SOL_SOCKET && pCmsg->cmsg_type == SCM_TIMESTAMP)
+        {
+            timeval timestamp{};
+            std::memcpy(&timestamp, CMSG_DATA(pCmsg), sizeof(timestamp));
+            receivedTime = std::chrono::seconds{timestamp.tv_sec} +
+                std::chrono::microseconds{timestamp.tv_usec};
+        }
+#endif
+    }
+    if(receivedTime.count() == 0)
+        receivedTime = realtimeNow();
+
     if(static_cast<std::size_t>(read) < sizeof(Ipv4))
     {
         qWarning() << "Read incomplete packet of" << read << "bytes, expected"
             << sizeof(Ipv4) << "bytes";
-        return;
+        return true;
     }
 
     const Ipv4 *pIpHdr = reinterpret_cast<const Ipv4*>(packet.data());
@@ -244,7 +412,7 @@ void PosixPing::onReadyRead()
     if((pIpHdr->version_ihl >> 4) != 4)
     {
         qWarning() << "Invalid IPv4 version:" << (pIpHdr->version_ihl >> 4);
-        return;
+        return true;
     }
 
     std::size_t headerBytes = (pIpHdr->version_ihl & 0x0F) * 4;
@@ -253,14 +421,14 @@ void PosixPing::onReadyRead()
     {
         qWarning() << "Invalid IP header length:" << headerBytes
             << "bytes (read" << read << "bytes)";
-        return;
+        return true;
     }
 
     // Should be ICMP - this is an ICMP socket
     if(pIpHdr->protocol != 1)
     {
         qWarning() << "Received non-ICMP packet with protocol" << pIpHdr->protocol;
-        return;
+        return true;
     }
 
     // Check ICMP checksum
@@ -277,9 +445,31 @@ void PosixPing::onReadyRead()
        ntohs(pEchoReply->identifier) != _identifier)
     {
         // Don't trace, this will probably happen a lot.
-        return;
+        return true;
     }
 
+    // Find the request - ignore duplicate replies and replies from any address
+    // other than the one pinged
+    quint32 replyAddr = ntohl(pIpHdr->src);
+    auto itPending = _pendingEchoes.find(ntohs(pEchoReply->sequence));
+    if(itPending == _pendingEchoes.end() || itPending->second.address != replyAddr)
+        return true;
+
+    auto roundtrip = std::max(receivedTime - itPending->second.sentTime,
+                              std::chrono::nanoseconds{0});
+    int payloadSize = itPending->second.payloadSize;
+    _pendingEchoes.erase(itPending);
+
     // It's our reply - emit the response.
-    emit receivedReply(ntohl(pIpHdr->src));
+    emit receivedReply(replyAddr,
+                       std::chrono::duration_cast<std::chrono::microseconds>(roundtrip),
+                       payloadSize);
+    return true;
+}
+
+void PosixPing::onReadyRead()
+{
+    // Read all the replies that are available - when a batch of requests is
+    // sent, the replies tend to arrive close together.
+    while(readReply());
 }
@@ -22,13 +22,19 @@
 #include <common/src/common.h>
 #include <kapps_core/src/posix/posix_objects.h>
 #include <QSocketNotifier>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
 
 // Open an ICMP socket and send pings on Mac/Linux.
 // An identifier is chosen randomly when the object is created; responses are
-// detected based on that identifier.
+// detected based on that identifier.  Each request is also given a sequence
+// number, and replies are only emitted for a pending sequence number from the
+// address that was pinged, so duplicate or spurious responses are ignored.
 //
-// It is possible (but unlikely) that duplicate or spurious responses could be
-// emitted if they happen to have that identifier.
+// One PosixPing can be kept for any number of requests; LatencyTracker keeps
+// one for the life of the daemon.  The round trip time is measured using the
+// kernel's receive timestamp when the platform provides it.
 class PosixPing : public QObject
 {
     Q_OBJECT
@@ -47,23 +53,51 @@ private:
         quint16 identifier;
         quint16 sequence;
     };
+    // A request that was sent and hasn't been answered yet
+    struct PendingEcho
+    {
+        quint32 address;
+        int payloadSize;
+        std::chrono::nanoseconds sentTime;
+    };
 
 public:
-    PosixPing();
+    explicit PosixPing(QObject *pParent = nullptr);
 
 private:
     quint16 calcChecksum(const quint8 *data, std::size_t len) const;
+    // Build an ICMP echo request packet (including the IP header) in
+    // rawPacket.  Returns the sequence number used.
+    quint16 buildEchoRequest(std::vector<quint8> &rawPacket, quint32 address,
+                             int payloadSize);
+    // Record that a request was sent, and discard pending requests too old to
+    // be answered so their sequence numbers can't be matched by a late reply
+    // after wrapping around.
+    void addPendingEcho(quint16 sequence, quint32 address, int payloadSize,
+                        std::chrono::nanoseconds sentTime);
 
 public:
     // Send an ICMP echo request.  If a reply is received, it will be signaled
     // with receivedReply().
     bool sendEchoRequest(quint32 address, int payloadSize = 32, bool allowFragment = true);
 
+    // Send an ICMP echo request to each address.  On Linux, the requests are
+    // all sent in one system call with sendmmsg().  Returns the addresses that
+    // were sent successfully; replies are signaled with receivedReply().
+    std::vector<quint32> sendEchoRequests(const std::vector<quint32> &addresses);
+
 private:
+    // Read one packet; returns false if there are no more packets to read
+    bool readReply();
     void onReadyRead();
 
 signals:
-    void receivedReply(quint32 address);
+    // A reply was received for a pending request.  roundtrip is the time from
+    // sending the request to the kernel receiving the reply, and payloadSize
+    // is the payload size of the request (used by MtuPinger to tell which
+    // probe was answered).
+    void receivedReply(quint32 address, std::chrono::microseconds roundtrip,
+                       int payloadSize);
 
 private:
     kapps::core::PosixFd _icmpSocket;
@@ -72,6 +106,8 @@ private:
     nullable_t<QSocketNotifier> _pReadNotifier;
     quint16 _identifier;
     quint16 _nextSequence;
+    // Requests that haven't been answered, by sequence number
+    std::unordered_map<quint16, PendingEcho> _pendingEchoes;
 };
 
 #endif
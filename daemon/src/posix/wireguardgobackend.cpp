@@ -24,6 +24,8 @@
 #include <common/src/async.h>
 #include <common/src/exec.h>
 #include "brand.h"
+#include <QSysInfo>
+#include <QVersionNumber>
 #include <unistd.h>
 #include <memory>
 
@@ -38,6 +40,28 @@ namespace
     // How long to wait for each individual attempt to connect to the local
     // socket
     std::chrono::seconds localSocketAttemptTimeout{1};
+
+#if defined(Q_OS_LINUX)
+    // Transmit queue length for the TUN device in high-throughput mode.  TUN
+    // devices default to 500, which drops bursts from fast senders before
+    // wireguard-go can read them.
+    const int highThroughputTxQueueLen{1000};
+
+    // wireguard-go detects and uses these kernel features itself, falling back
+    // when they're not available.  Trace what the kernel supports so throughput
+    // problems can be diagnosed from logs.
+    void traceOffloadSupport()
+    {
+        QVersionNumber kernel = QVersionNumber::fromString(QSysInfo::kernelVersion());
+        auto supported = [&](int major, int minor)
+        {
+            return kernel >= QVersionNumber{major, minor} ? "yes" : "no";
+        };
+        qInfo() << "Kernel" << QSysInfo::kernelVersion()
+            << "- UDP GSO:" << supported(4, 18) << "UDP GRO:" << supported(5, 0)
+            << "TUN UDP offload:" << supported(6, 2);
+    }
+#endif
 }
 
 // Task to get the device name once wireguard-go is started on Mac.
@@ -350,6 +374,14 @@ void WireguardGoRunner::setupProcess(UidGidProcess &process)
     // This has the same effect as --foreground, but it also suppresses the
     // "you should use the kernel module" warning
     env.insert(QStringLiteral("WG_PROCESS_FOREGROUND"), QStringLiteral("1"));
+    // wireguard-go runs one encryption/decryption worker per CPU; don't let a
+    // GOMAXPROCS inherited from the daemon's environment limit that.
+    if(_highThroughput && env.contains(QStringLiteral("GOMAXPROCS")))
+    {
+        qInfo() << "Ignoring GOMAXPROCS" << env.value(QStringLiteral("GOMAXPROCS"))
+            << "for wireguard-go in high-throughput mode";
+        env.remove(QStringLiteral("GOMAXPROCS"));
+    }
 #endif
     env.insert(QStringLiteral("LOG_LEVEL"), QStringLiteral("debug"));
     process.setProcessEnvironment(env);
@@ -442,10 +474,10 @@ auto debounce(Func_t func, qint64 timeout)
     };
 }
 
-WireguardGoBackend::WireguardGoBackend()
-    : _wgGoPid{0}
+WireguardGoBackend::WireguardGoBackend(bool highThroughput)
+    : _wgGoPid{0}, _highThroughput{highThroughput}
 {
-    _wgGoRunner.emplace(wgGoRestartParams);
+    _wgGoRunner.emplace(wgGoRestartParams, _highThroughput);
 
 #ifdef Q_OS_MACOS
     // Rate-limit logIntefaces method to max invocations of once a second
@@ -586,6 +618,15 @@ auto WireguardGoBackend::createInterface(wg_device &wgDev,
                 {
                     qInfo() << "WireGuard device configured successfully";
                 }
+#if defined(Q_OS_LINUX)
+                if(_highThroughput)
+                {
+                    traceOffloadSupport();
+                    Exec::bash(QStringLiteral("ip link set dev %1 txqueuelen %2")
+                                .arg(_interfaceName).arg(highThroughputTxQueueLen),
+                               true);
+                }
+#endif
             })
         ->then(this, [this](){return std::make_shared<NetworkAdapter>(_interfaceName);});
 }
@@ -598,25 +639,41 @@ auto WireguardGoBackend::getStatus() -> Async<WgDevPtr>
         return Async<WgDevPtr>::reject({HERE, Error::Code::WireguardCreateDeviceFailed});
     }
 
-    // wireguard-go only allows one IPC request per connection (it closes the
-    // socket after the first request), so we have to create a new connection
-    // for each stat poll.
-    //
-    // However, we don't retry the local socket or watch for it to be created
-    // during stat polls; it should stay up after the connection is established
-    // (if it's gone, consider the connection lost).
+    // Status polls use a persistent UAPI session.  We don't retry the local
+    // socket or watch for it to be created during stat polls; it should stay
+    // up after the connection is established (if it's gone, consider the
+    // connection lost).
+    if(!_pUapiSession)
+    {
+        _pUapiSession.reset(new WireguardUapiSession{[socketPath = _wgSocketPath]()
+            {
+                return Async<std::shared_ptr<QLocalSocket>>{Async<LocalSocketTask>::create(socketPath)};
+            }});
+    }
+    return _pUapiSession->getStatus();
+}
+
+Async<void> WireguardGoBackend::reconfigure(const wg_device &wgDev)
+{
+    if(_wgSocketPath.isEmpty())
+        return Async<void>::reject({HERE, Error::Code::WireguardConfigDeviceFailed});
+
+    // The socket should exist since the device is up, don't wait for it
     return Async<LocalSocketTask>::create(_wgSocketPath)
-        ->then([](const std::shared_ptr<QLocalSocket> &pSocket)
+        ->then(this, [devConfig = WgDevStatus{wgDev}](const std::shared_ptr<QLocalSocket> &pSocket)
         {
-            Q_ASSERT(pSocket);  // Postcondition of LocalSocketTask (rejects otherwise)
-            return Async<WireguardDeviceStatusTask>::create(pSocket);
+            return Async<WireguardConfigDeviceTask>::create(pSocket, devConfig.device());
         })
-        ->then([](const std::shared_ptr<WgDevStatus> &pDev)
+        ->then(this, [this](int returnedErrno)
         {
-            Q_ASSERT(pDev); // Postcondition of WireguardDeviceStatusTask
-            // Return an aliased shared pointer - dereferences to a wg_device,
-            // but frees the complete WgDevStatus
-            return WgDevPtr{pDev, &pDev->device()};
+            if(returnedErrno)
+            {
+                qWarning() << "WireGuard device" << _interfaceName
+                    << "could not be reconfigured, returned errno"
+                    << returnedErrno;
+                throw Error{HERE, Error::Code::WireguardConfigDeviceFailed};
+            }
+            qInfo() << "WireGuard device reconfigured successfully";
         });
 }
 
@@ -626,6 +683,8 @@ Async<void> WireguardGoBackend::shutdown()
     // warnings)
     if(_pConnectAttempt)
         _pConnectAttempt.abandon();
+    // Close the UAPI session's connection too
+    _pUapiSession.reset();
 
     // Allow wireguard-go to cleanly shut down.
     // Set _pShutdownTask, even if it's resolved immediately, because this
@@ -35,9 +35,13 @@
 class WireguardGoRunner : public ProcessRunner
 {
 public:
-    using ProcessRunner::ProcessRunner;
+    WireguardGoRunner(const RestartStrategy::Params &params, bool highThroughput)
+        : ProcessRunner{params}, _highThroughput{highThroughput}
+    {}
 public:
     virtual void setupProcess(UidGidProcess &process) override;
+private:
+    bool _highThroughput;
 };
 
 // WireguardGoBackend uses the wireguard-go userspace implementation of
@@ -58,7 +62,9 @@ public:
     static void cleanup();
 
 public:
-    WireguardGoBackend();
+    // If highThroughput is set, wireguard-go is tuned for throughput on
+    // Linux (see DaemonSettings::wireguardGoHighThroughput)
+    WireguardGoBackend(bool highThroughput);
     virtual ~WireguardGoBackend() override;
 
 private:
@@ -73,6 +79,9 @@ public:
     virtual Async<WgDevPtr> getStatus() override;
 
     virtual Async<void> shutdown() override;
+
+    virtual bool canReconfigure() const override {return !_wgSocketPath.isEmpty();}
+    virtual Async<void> reconfigure(const wg_device &wgDev) override;
 private:
     // Handling the various error and finish signals from QProcess is
     // nontrivial, so use a ProcessRunner to run wireguard-go.
@@ -99,11 +108,15 @@ private:
     QString _interfaceName;
     // Wireguard socket path; built from that interface name.
     QString _wgSocketPath;
+    // UAPI session used for status polls, created with the socket path
+    std::unique_ptr<WireguardUapiSession> _pUapiSession;
     // PID of the wireguard-go process
     qint64 _wgGoPid;
     // When shutdown() is called, we try to shut down wireguard-go.  If it shuts
     // down, this task (the task returned by shutdown()) is resolved.
     Async<void> _pShutdownTask;
+    // Whether to tune for throughput
+    bool _highThroughput;
 };
 
 #endif
@@ -0,0 +1,254 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("powerpolicy.cpp")
+
+#include "powerpolicy.h"
+#include <common/src/builtin/util.h>
+#include <common/src/wakeupaccounting.h>
+#include <QCoreApplication>
+#include <QEvent>
+#include <algorithm>
+
+#if defined(Q_OS_LINUX)
+#include <QDir>
+#include <QFile>
+#elif defined(Q_OS_MACOS)
+#include <IOKit/ps/IOPowerSources.h>
+#include <IOKit/ps/IOPSKeys.h>
+#elif defined(Q_OS_WIN)
+#include <qt_windows.h>
+#endif
+
+namespace
+{
+    // The power source is polled at this interval
+    const std::chrono::minutes powerSourcePollInterval{1};
+
+    // Interval scale factors for each mode, indexed by PowerPolicy::Work
+    const int normalScales[]{1, 1, 1};
+    const int reducedScales[]{2, 2, 4};
+    const int idleScales[]{2, 4, 12};
+
+#if defined(Q_OS_LINUX)
+    QByteArray readSupplyAttribute(const QString &supply, const char *attribute)
+    {
+        QFile file{QStringLiteral("/sys/class/power_supply/%1/%2").arg(supply, QLatin1String{attribute})};
+        if(!file.open(QIODevice::ReadOnly))
+            return {};
+        return file.readAll().trimmed();
+    }
+#endif
+
+    // Whether the system is running on battery power.  Systems without a
+    // battery, or where the power source can't be determined, are treated as
+    // being on AC power.
+    bool queryOnBattery()
+    {
+#if defined(Q_OS_LINUX)
+        // On battery if there's a battery and no external supply (mains, USB,
+        // etc.) is online
+        QDir supplies{QStringLiteral("/sys/class/power_supply")};
+        bool hasBattery{false};
+        for(const auto &supply : supplies.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            if(readSupplyAttribute(supply, "type") == "Battery")
+                hasBattery = true;
+            else if(readSupplyAttribute(supply, "online") == "1")
+                return false;
+        }
+        return hasBattery;
+#elif defined(Q_OS_MACOS)
+        CFTypeRef info = ::IOPSCopyPowerSourcesInfo();
+        if(!info)
+            return false;
+        CFStringRef source = ::IOPSGetProvidingPowerSourceType(info);
+        bool onBattery = source && ::CFStringCompare(source, CFSTR(kIOPMBatteryPowerKey), 0) == kCFCompareEqualTo;
+        ::CFRelease(info);
+        return onBattery;
+#elif defined(Q_OS_WIN)
+        SYSTEM_POWER_STATUS status{};
+        if(!::GetSystemPowerStatus(&status))
+            return false;
+        // 0 is offline; 1 is online and 255 is unknown
+        return status.ACLineStatus == 0;
+#else
+        return false;
+#endif
+    }
+}
+
+PowerPolicy::PowerPolicy()
+    : _mode{Mode::Normal}, _onBattery{false}, _dashboardVisible{false},
+      _connected{false}, _wakeupCount{0}, _wakeupsPerMinute{0}
+{
+    _powerSourceTimer.setTimerType(Qt::TimerType::VeryCoarseTimer);
+    _powerSourceTimer.setInterval(msec32(powerSourcePollInterval));
+    tagWakeups(_powerSourceTimer, QByteArrayLiteral("powerpolicy"));
+    connect(&_powerSourceTimer, &QTimer::timeout, this, &PowerPolicy::pollPowerSource);
+    _powerSourceTimer.start();
+
+    // Application event filters only see events for objects on the main
+    // thread, which is what we want to measure
+    if(QCoreApplication::instance())
+        QCoreApplication::instance()->installEventFilter(this);
+    _wakeupElapsed.start();
+
+    _onBattery = queryOnBattery();
+    updateMode();
+}
+
+PowerPolicy::~PowerPolicy()
+{
+    if(QCoreApplication::instance())
+        QCoreApplication::instance()->removeEventFilter(this);
+}
+
+int PowerPolicy::scale(Work work) const
+{
+    auto index = static_cast<std::size_t>(work);
+    switch(_mode)
+    {
+        default:
+        case Mode::Normal:
+            return normalScales[index];
+        case Mode::Reduced:
+            return reducedScales[index];
+        case Mode::Idle:
+            return idleScales[index];
+    }
+}
+
+std::chrono::milliseconds PowerPolicy::scaled(std::chrono::milliseconds interval,
+                                              Work work) const
+{
+    return interval * scale(work);
+}
+
+void PowerPolicy::manage(QTimer &timer, std::chrono::milliseconds baseInterval,
+                         Work work)
+{
+    auto itExisting = std::find_if(_timers.begin(), _timers.end(),
+        [&](const ManagedTimer &managed){return managed.pTimer == &timer;});
+    if(itExisting != _timers.end())
+    {
+        itExisting->baseInterval = baseInterval;
+        itExisting->work = work;
+    }
+    else
+    {
+        _timers.push_back({&timer, baseInterval, work});
+        connect(&timer, &QObject::destroyed, this, [this]()
+        {
+            _timers.erase(std::remove_if(_timers.begin(), _timers.end(),
+                [](const ManagedTimer &managed){return !managed.pTimer;}),
+                _timers.end());
+        });
+    }
+
+    // Very coarse timers are rounded to whole seconds, which lets their
+    // wakeups line up with each other
+    timer.setTimerType(Qt::TimerType::VeryCoarseTimer);
+    applyTimer(timer, baseInterval, work);
+}
+
+void PowerPolicy::setDashboardVisible(bool visible)
+{
+    if(visible != _dashboardVisible)
+    {
+        _dashboardVisible = visible;
+        updateMode();
+    }
+}
+
+void PowerPolicy::setConnected(bool connected)
+{
+    if(connected != _connected)
+    {
+        _connected = connected;
+        updateMode();
+    }
+}
+
+QJsonObject PowerPolicy::diagnostics() const
+{
+    return {
+        {QStringLiteral("mode"), qEnumToString(_mode)},
+        {QStringLiteral("onBattery"), _onBattery},
+        {QStringLiteral("dashboardVisible"), _dashboardVisible},
+        {QStringLiteral("connected"), _connected},
+        {QStringLiteral("managedTimers"), static_cast<qint64>(_timers.size())},
+        {QStringLiteral("wakeupsPerMinute"), _wakeupsPerMinute}
+    };
+}
+
+bool PowerPolicy::eventFilter(QObject *, QEvent *pEvent)
+{
+    if(pEvent->type() == QEvent::Type::Timer)
+        ++_wakeupCount;
+    return false;
+}
+
+void PowerPolicy::pollPowerSource()
+{
+    // Roll over the wakeup rate; this timer's own wakeup is included
+    auto elapsed = _wakeupElapsed.restart();
+    if(elapsed > 0)
+        _wakeupsPerMinute = _wakeupCount * 60000.0 / elapsed;
+    _wakeupCount = 0;
+
+    bool onBattery = queryOnBattery();
+    if(onBattery != _onBattery)
+    {
+        _onBattery = onBattery;
+        updateMode();
+    }
+}
+
+void PowerPolicy::updateMode()
+{
+    Mode mode{Mode::Normal};
+    if(_onBattery && !_dashboardVisible)
+        mode = _connected ? Mode::Reduced : Mode::Idle;
+
+    if(mode == _mode)
+        return;
+
+    qInfo() << "Power policy mode changed from" << qEnumToString(_mode) << "to"
+        << qEnumToString(mode) << "- on battery:" << _onBattery
+        << "- dashboard visible:" << _dashboardVisible << "- connected:"
+        << _connected << "- wakeups/min:" << _wakeupsPerMinute;
+    _mode = mode;
+    for(const auto &managed : _timers)
+    {
+        if(managed.pTimer)
+            applyTimer(*managed.pTimer, managed.baseInterval, managed.work);
+    }
+    emit modeChanged();
+}
+
+void PowerPolicy::applyTimer(QTimer &timer, std::chrono::milliseconds baseInterval,
+                             Work work)
+{
+    auto interval = msec32(scaled(baseInterval, work));
+    // Changing the interval restarts an active timer, only do that if it
+    // actually changed
+    if(timer.interval() != interval)
+        timer.setInterval(interval);
+}
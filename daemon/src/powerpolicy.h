@@ -0,0 +1,143 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("powerpolicy.h")
+
+#ifndef POWERPOLICY_H
+#define POWERPOLICY_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QPointer>
+#include <QTimer>
+#include <chrono>
+#include <vector>
+
+// PowerPolicy decides how often the daemon's periodic work runs, so an idle
+// daemon on a laptop doesn't keep the CPU out of deep idle states.
+//
+// The mode is derived from:
+// - the power source (polled from the OS once a minute)
+// - whether any client is showing its dashboard (RPC_notifyClientVisible())
+// - whether the VPN is connected
+//
+// On AC power, or while a dashboard is visible, everything runs at its normal
+// interval.  On battery with no visible dashboard, periodic work is scaled
+// back - more so when disconnected, since nothing is relying on connection
+// monitoring then.
+//
+// Subsystems either register their QTimers with manage(), or apply scale()
+// to their own intervals when modeChanged() is emitted (for subsystems that
+// compute their own intervals, like LatencyTracker and JsonRefresher).
+// Managed timers are also made very coarse, so the OS can coalesce their
+// wakeups.
+//
+// To see the effect, PowerPolicy counts timer events on the daemon thread and
+// reports them as wakeups per minute in diagnostics().
+class PowerPolicy : public QObject
+{
+    Q_OBJECT
+    CLASS_LOGGING_CATEGORY("powerpolicy")
+
+public:
+    enum class Mode
+    {
+        // AC power or a visible dashboard
+        Normal,
+        // On battery, dashboard hidden, VPN connected
+        Reduced,
+        // On battery, dashboard hidden, VPN not connected
+        Idle,
+    };
+    Q_ENUM(Mode)
+
+    // Kinds of periodic work, which are scaled differently
+    enum class Work
+    {
+        // Connection health monitoring (WireGuard stats, etc.).  Scaled back
+        // only slightly, since it also detects a lost tunnel.
+        Monitor,
+        // Background refreshes - regions lists, latency measurements, account
+        // info, etc.
+        Background,
+        // Diagnostics (memory tracing) - nearly suspended when idle
+        Diagnostic,
+    };
+
+public:
+    PowerPolicy();
+    ~PowerPolicy();
+
+public:
+    Mode mode() const {return _mode;}
+    // The factor applied to intervals of the given kind of work in the current
+    // mode.  Always at least 1.
+    int scale(Work work) const;
+    // Scale an interval for the current mode
+    std::chrono::milliseconds scaled(std::chrono::milliseconds interval, Work work) const;
+
+    // Register a timer to be scaled by the policy.  The timer's interval is
+    // set now and whenever the mode changes; the owner continues to start and
+    // stop it as usual.  If the owner changes the base interval, call
+    // manage() again.  The timer is forgotten automatically when it's
+    // destroyed.
+    void manage(QTimer &timer, std::chrono::milliseconds baseInterval, Work work);
+
+    // Update the inputs
+    void setDashboardVisible(bool visible);
+    void setConnected(bool connected);
+
+    // Current inputs, mode, managed timers, and the wakeup rate
+    QJsonObject diagnostics() const;
+
+protected:
+    // Counts timer events delivered on the daemon thread
+    virtual bool eventFilter(QObject *pWatched, QEvent *pEvent) override;
+
+private:
+    void pollPowerSource();
+    void updateMode();
+    void applyTimer(QTimer &timer, std::chrono::milliseconds baseInterval, Work work);
+
+signals:
+    void modeChanged();
+
+private:
+    struct ManagedTimer
+    {
+        QPointer<QTimer> pTimer;
+        std::chrono::milliseconds baseInterval;
+        Work work;
+    };
+
+    Mode _mode;
+    bool _onBattery;
+    bool _dashboardVisible;
+    bool _connected;
+    std::vector<ManagedTimer> _timers;
+    // Polls the power source; also rolls over the wakeup count
+    QTimer _powerSourceTimer;
+    // Timer events counted since _wakeupElapsed was started, and the rate
+    // measured over the last complete period
+    quint64 _wakeupCount;
+    QElapsedTimer _wakeupElapsed;
+    double _wakeupsPerMinute;
+};
+
+#endif
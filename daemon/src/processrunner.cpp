@@ -137,10 +137,11 @@ ProcessRunner::ProcessRunner(RestartStrategy::Params restartParams)
     connect(&_stdoutBuf, &LineBuffer::lineComplete, this,
             &ProcessRunner::stdoutLine);
     // stderr is just logged at warning level
-    connect(&_stderrBuf, &LineBuffer::lineComplete, this,
-        [this](const QByteArray &line)
+    connect(&_stderrBuf, &LineBuffer::lineView, this,
+        [this](QByteArrayView line)
         {
-            qWarning() << objectName() << "- stderr:" << line.data();
+            qWarning() << objectName() << "- stderr:"
+                << QLatin1String{line.data(), line.size()};
         });
 }
 
@@ -0,0 +1,281 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("samplingprofiler.cpp")
+
+#include "samplingprofiler.h"
+#include <common/src/wakeupaccounting.h>
+#include <common/src/builtin/path.h>
+#include <common/src/builtin/util.h>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <atomic>
+#include <unordered_map>
+
+#if defined(Q_OS_UNIX)
+#include <cerrno>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+namespace
+{
+    // Samples are drained from the ring this often
+    const std::chrono::seconds drainInterval{1};
+
+#if defined(Q_OS_UNIX)
+    // Frames recorded per sample; deeper stacks are truncated (at the root end)
+    const int maxFrames = 64;
+    // The signal handler itself and the signal trampoline are the first
+    // frames of each sample, skip them
+    const int skipFrames = 2;
+    // Size of the sample ring.  At the default 10 ms interval, this holds
+    // several seconds of samples even with several threads busy.
+    const std::size_t sampleSlotCount = 2048;
+
+    enum SlotState : int
+    {
+        Free,
+        Writing,
+        Ready
+    };
+
+    // The ring is static since the signal handler can't be given any context.
+    // Each slot is claimed by the handler with its state, so handlers running
+    // concurrently on different threads never write the same slot.  If the
+    // daemon thread hasn't drained a slot by the time the ring wraps around,
+    // that sample is dropped.
+    struct SampleSlot
+    {
+        std::atomic<int> state;
+        int frameCount;
+        void *frames[maxFrames];
+    };
+    SampleSlot sampleSlots[sampleSlotCount];
+    std::atomic<std::size_t> nextSampleSlot{0};
+    std::atomic<std::size_t> droppedSamples{0};
+
+    static_assert(std::atomic<int>::is_always_lock_free, "Sample slot state must be usable in a signal handler");
+    static_assert(std::atomic<std::size_t>::is_always_lock_free, "Sample index must be usable in a signal handler");
+
+    void sampleSignalHandler(int)
+    {
+        int savedErrno = errno;
+        std::size_t index = nextSampleSlot.fetch_add(1, std::memory_order_relaxed) % sampleSlotCount;
+        SampleSlot &slot = sampleSlots[index];
+        int expected = SlotState::Free;
+        if(slot.state.compare_exchange_strong(expected, SlotState::Writing,
+                                              std::memory_order_acquire))
+        {
+            slot.frameCount = ::backtrace(slot.frames, maxFrames);
+            slot.state.store(SlotState::Ready, std::memory_order_release);
+        }
+        else
+            droppedSamples.fetch_add(1, std::memory_order_relaxed);
+        errno = savedErrno;
+    }
+
+    void setSampleTimer(std::chrono::milliseconds interval)
+    {
+        itimerval timer{};
+        auto usec = std::chrono::duration_cast<std::chrono::microseconds>(interval).count();
+        timer.it_interval.tv_sec = static_cast<time_t>(usec / 1000000);
+        timer.it_interval.tv_usec = static_cast<suseconds_t>(usec % 1000000);
+        timer.it_value = timer.it_interval;
+        if(::setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+        {
+            int err = errno;
+            qWarning() << "Unable to set profiling timer:" << err;
+            throw UnknownError{HERE, QStringLiteral("Unable to set profiling timer")};
+        }
+    }
+#endif
+}
+
+SamplingProfiler::SamplingProfiler()
+    : _running{false}, _interval{0}, _sampleCount{0}
+{
+    _drainTimer.setInterval(msec32(drainInterval));
+    tagWakeups(_drainTimer, QByteArrayLiteral("profiler"));
+    connect(&_drainTimer, &QTimer::timeout, this, &SamplingProfiler::drainSamples);
+}
+
+SamplingProfiler::~SamplingProfiler()
+{
+#if defined(Q_OS_UNIX)
+    if(_running)
+    {
+        setSampleTimer(std::chrono::milliseconds{0});
+        ::signal(SIGPROF, SIG_IGN);
+    }
+#endif
+}
+
+void SamplingProfiler::start(std::chrono::milliseconds interval)
+{
+#if defined(Q_OS_UNIX)
+    if(interval.count() <= 0)
+        throw UnknownError{HERE, QStringLiteral("Invalid sampling interval")};
+
+    if(_running)
+    {
+        qInfo() << "Restarting profiler, discarding" << _sampleCount << "samples";
+        setSampleTimer(std::chrono::milliseconds{0});
+        drainSamples();
+    }
+    _stacks.clear();
+    _sampleCount = 0;
+    droppedSamples = 0;
+
+    // backtrace() loads the unwinder on its first call, which isn't safe in a
+    // signal handler.  Call it once now so that's done.
+    void *preload[1];
+    ::backtrace(preload, 1);
+
+    struct sigaction action{};
+    action.sa_handler = &sampleSignalHandler;
+    action.sa_flags = SA_RESTART;
+    ::sigemptyset(&action.sa_mask);
+    if(::sigaction(SIGPROF, &action, nullptr) != 0)
+    {
+        int err = errno;
+        qWarning() << "Unable to install profiling signal handler:" << err;
+        throw UnknownError{HERE, QStringLiteral("Unable to install profiling signal handler")};
+    }
+
+    _interval = interval;
+    setSampleTimer(_interval);
+    _running = true;
+    _drainTimer.start();
+    qInfo() << "Started profiler with interval" << traceMsec(_interval);
+#else
+    Q_UNUSED(interval);
+    qWarning() << "Sampling profiler is not supported on this platform";
+    throw UnknownError{HERE, QStringLiteral("Sampling profiler is not supported on this platform")};
+#endif
+}
+
+QString SamplingProfiler::stop()
+{
+    if(!_running)
+        return {};
+
+#if defined(Q_OS_UNIX)
+    setSampleTimer(std::chrono::milliseconds{0});
+    // A signal could still be pending, ignore it rather than restoring the
+    // default action (which would terminate the daemon)
+    ::signal(SIGPROF, SIG_IGN);
+#endif
+    _drainTimer.stop();
+    _running = false;
+    drainSamples();
+
+    Path::DaemonDiagnosticsDir.mkpath();
+    const auto &nowUtc = QDateTime::currentDateTimeUtc();
+    QString profilePath = Path::DaemonDiagnosticsDir /
+        nowUtc.toString(QStringLiteral("'profile_'yyyyMMdd'_'hhmmsszzz'.folded'"));
+    QFile profileFile{profilePath};
+    if(!profileFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        profileFile.write(renderFolded()) < 0)
+    {
+        qWarning() << "Unable to write profile to" << profilePath << "-"
+            << profileFile.errorString();
+        throw UnknownError{HERE, QStringLiteral("Unable to write profile")};
+    }
+
+    std::size_t dropped{0};
+#if defined(Q_OS_UNIX)
+    dropped = droppedSamples.load();
+#endif
+    qInfo() << "Stopped profiler with" << _sampleCount << "samples," << dropped
+        << "dropped, wrote" << profilePath;
+    _lastProfilePath = profilePath;
+    _stacks.clear();
+    return profilePath;
+}
+
+void SamplingProfiler::drainSamples()
+{
+#if defined(Q_OS_UNIX)
+    std::vector<std::uintptr_t> stack;
+    for(auto &slot : sampleSlots)
+    {
+        if(slot.state.load(std::memory_order_acquire) != SlotState::Ready)
+            continue;
+
+        stack.clear();
+        // backtrace() gives the innermost frame first, store the root first
+        for(int i = slot.frameCount - 1; i >= skipFrames; --i)
+            stack.push_back(reinterpret_cast<std::uintptr_t>(slot.frames[i]));
+        slot.state.store(SlotState::Free, std::memory_order_release);
+
+        ++_stacks[stack];
+        ++_sampleCount;
+    }
+#endif
+}
+
+QByteArray SamplingProfiler::renderFolded() const
+{
+    QByteArray folded;
+    std::unordered_map<std::uintptr_t, QByteArray> frameNames;
+
+    auto frameName = [&](std::uintptr_t address) -> const QByteArray &
+    {
+        auto itName = frameNames.find(address);
+        if(itName != frameNames.end())
+            return itName->second;
+
+        QByteArray name;
+#if defined(Q_OS_UNIX)
+        // Return addresses point after the call; subtract 1 so the address
+        // is within the calling instruction when it's symbolized
+        Dl_info info{};
+        if(::dladdr(reinterpret_cast<void*>(address - 1), &info) && info.dli_fname)
+        {
+            name = QFileInfo{QString::fromLocal8Bit(info.dli_fname)}.fileName().toUtf8();
+            name += "+0x";
+            name += QByteArray::number(static_cast<qulonglong>(address - 1 -
+                reinterpret_cast<std::uintptr_t>(info.dli_fbase)), 16);
+        }
+#endif
+        if(name.isEmpty())
+            name = "0x" + QByteArray::number(static_cast<qulonglong>(address), 16);
+        return frameNames.emplace(address, std::move(name)).first->second;
+    };
+
+    for(const auto &[stack, count] : _stacks)
+    {
+        if(stack.empty())
+            folded += "[unknown]";
+        for(std::size_t i = 0; i < stack.size(); ++i)
+        {
+            if(i > 0)
+                folded += ';';
+            folded += frameName(stack[i]);
+        }
+        folded += ' ';
+        folded += QByteArray::number(static_cast<qulonglong>(count));
+        folded += '\n';
+    }
+    return folded;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("samplingprofiler.h")
+
+#ifndef SAMPLINGPROFILER_H
+#define SAMPLINGPROFILER_H
+
+#include <QString>
+#include <QTimer>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// SamplingProfiler samples the daemon's call stacks while it's running, so
+// performance problems seen in the field can be investigated without a
+// profiler attached.  It's opt-in - it's started and stopped with the
+// startProfiler/stopProfiler RPCs (piactl profile), and only when debug
+// logging is enabled.
+//
+// The profile is written to the diagnostics directory in the "folded stacks"
+// format used by flame graph tools (one line per distinct stack, root first,
+// followed by the sample count).  Release builds don't have symbols at
+// runtime, so frames are written as module-relative addresses
+// ("pia-daemon+0x1a2b3").  These are symbolized offline with the breakpad
+// symbols produced by the build (dump_syms), which list the same offsets.
+//
+// On Linux and macOS, samples are taken with a SIGPROF interval timer, which
+// measures CPU time - the thread using the CPU is interrupted, and the
+// signal handler copies its stack into a preallocated ring.  The ring is
+// drained periodically on the daemon thread.  An idle daemon isn't sampled
+// at all.
+//
+// Windows isn't supported yet (sampling there requires suspending each
+// thread from a sampler thread); start() throws.
+class SamplingProfiler : public QObject
+{
+    Q_OBJECT
+    CLASS_LOGGING_CATEGORY("profiler");
+
+public:
+    SamplingProfiler();
+    ~SamplingProfiler();
+
+public:
+    bool isRunning() const {return _running;}
+    // Start sampling at the given interval (of CPU time).  Throws if sampling
+    // isn't supported or can't be started.  If the profiler is already
+    // running, the existing samples are discarded and it restarts.
+    void start(std::chrono::milliseconds interval);
+    // Stop sampling and write the profile.  Returns the path to the profile,
+    // or an empty string if the profiler wasn't running.
+    QString stop();
+    // Path to the last profile written by stop(), if any
+    const QString &lastProfilePath() const {return _lastProfilePath;}
+
+private:
+    // Move the samples taken so far into _stacks
+    void drainSamples();
+    // Render the folded stacks, symbolized with module-relative addresses
+    QByteArray renderFolded() const;
+
+private:
+    bool _running;
+    std::chrono::milliseconds _interval;
+    QTimer _drainTimer;
+    // Sample count for each distinct stack (root first)
+    std::map<std::vector<std::uintptr_t>, std::size_t> _stacks;
+    std::size_t _sampleCount;
+    QString _lastProfilePath;
+};
+
+#endif
@@ -0,0 +1,136 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("serverprobe.cpp")
+
+#include "serverprobe.h"
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include "win/win_ping.h"
+#else
+#include "posix/posix_ping.h"
+#endif
+
+namespace
+{
+#if defined(Q_OS_WIN)
+    // WinIcmpEcho requests can't be canceled, so they always run for this
+    // long even if the probe finishes first.
+    const std::chrono::seconds icmpEchoTimeout{5};
+#endif
+}
+
+ServerProbeTask::ServerProbeTask(const std::vector<Server> &candidates,
+                                 ProbeMethod method, quint16 port,
+                                 const QHostAddress &localAddress)
+{
+    _addresses.reserve(candidates.size());
+    for(const auto &server : candidates)
+        _addresses.push_back(QHostAddress{server.ip()});
+
+    if(method == ProbeMethod::Tcp)
+        probeTcp(port, localAddress);
+    else
+        probeIcmp();
+}
+
+ServerProbeTask::~ServerProbeTask() = default;
+
+void ServerProbeTask::probeTcp(quint16 port, const QHostAddress &localAddress)
+{
+    bool anySent{false};
+    _tcpSockets.reserve(_addresses.size());
+    for(int i = 0; i < static_cast<int>(_addresses.size()); ++i)
+    {
+        _tcpSockets.push_back(std::make_unique<QTcpSocket>());
+        QTcpSocket &socket = *_tcpSockets.back();
+        if(!localAddress.isNull() && !socket.bind(localAddress))
+        {
+            qWarning() << "Unable to bind probe socket to" << localAddress
+                << "-" << socket.errorString();
+            continue;
+        }
+        connect(&socket, &QTcpSocket::connected, this,
+                [this, i](){candidateResponded(i);});
+        socket.connectToHost(_addresses[i], port);
+        anySent = true;
+    }
+
+    if(!anySent)
+        reject({HERE, Error::Code::Unknown});
+}
+
+void ServerProbeTask::probeIcmp()
+{
+    std::vector<quint32> echoAddrs;
+    echoAddrs.reserve(_addresses.size());
+    for(const auto &address : _addresses)
+        echoAddrs.push_back(address.toIPv4Address());
+
+    auto onReply = [this](quint32 address)
+    {
+        auto itCandidate = std::find(_addresses.begin(), _addresses.end(),
+                                     QHostAddress{address});
+        if(itCandidate != _addresses.end())
+            candidateResponded(static_cast<int>(itCandidate - _addresses.begin()));
+    };
+
+    bool anySent{false};
+#if defined(Q_OS_WIN)
+    for(quint32 echoAddr : echoAddrs)
+    {
+        QPointer<WinIcmpEcho> pEcho = WinIcmpEcho::send(echoAddr, icmpEchoTimeout);
+        if(pEcho)
+        {
+            connect(pEcho.data(), &WinIcmpEcho::receivedReply, this,
+                    [onReply](quint32 address, std::chrono::milliseconds)
+                    {
+                        onReply(address);
+                    });
+            anySent = true;
+        }
+    }
+#else
+    _pPing.reset(new PosixPing{});
+    connect(_pPing.get(), &PosixPing::receivedReply, this,
+            [onReply](quint32 address, std::chrono::microseconds)
+            {
+                onReply(address);
+            });
+    anySent = !_pPing->sendEchoRequests(echoAddrs).empty();
+#endif
+
+    if(!anySent)
+        reject({HERE, Error::Code::Unknown});
+}
+
+void ServerProbeTask::candidateResponded(int index)
+{
+    auto keepAlive = sharedFromThis();
+    if(!isPending())
+        return;
+
+    qInfo() << "Server" << _addresses[index] << "responded first to probe";
+    // Close the probe connections now; the winning connection was only a
+    // probe.
+    for(auto &pSocket : _tcpSockets)
+        pSocket->abort();
+    resolve(index);
+}
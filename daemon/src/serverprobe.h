@@ -0,0 +1,83 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("serverprobe.h")
+
+#ifndef SERVERPROBE_H
+#define SERVERPROBE_H
+
+#include <common/src/async.h>
+#include <common/src/settings/locations.h>
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+class PosixPing;
+
+// ServerProbeTask races several candidate servers before a connection attempt
+// and resolves with the index of the first one to respond.
+//
+// All candidates are probed at once:
+// - With ProbeMethod::Tcp, a TCP connection is opened to the candidate port on
+//   each server (the handshake completing is the response; the connection is
+//   then closed).
+// - With ProbeMethod::Icmp, an ICMP echo is sent to each server.  This is
+//   used for UDP transports, since neither WireGuard nor OpenVPN with
+//   tls-auth answer a UDP datagram from an unauthenticated peer.
+//
+// The task does not time out on its own; use Async::timeout().  It rejects if
+// no probe could be sent at all.
+class ServerProbeTask : public Task<int>
+{
+    Q_OBJECT
+    CLASS_LOGGING_CATEGORY("vpn")
+
+public:
+    enum class ProbeMethod
+    {
+        Icmp,
+        Tcp,
+    };
+    Q_ENUM(ProbeMethod)
+
+public:
+    // Probe the candidate servers.  For TCP probes, port is the port to
+    // connect to, and localAddress (if not null) is bound for each connection
+    // so the probe takes the same route as the connection attempt.
+    ServerProbeTask(const std::vector<Server> &candidates, ProbeMethod method,
+                    quint16 port, const QHostAddress &localAddress);
+    // Defined in serverprobe.cpp where PosixPing is complete
+    ~ServerProbeTask();
+
+private:
+    void probeTcp(quint16 port, const QHostAddress &localAddress);
+    void probeIcmp();
+    void candidateResponded(int index);
+
+private:
+    std::vector<QHostAddress> _addresses;
+    std::vector<std::unique_ptr<QTcpSocket>> _tcpSockets;
+#if !defined(Q_OS_WIN)
+    std::unique_ptr<PosixPing> _pPing;
+#endif
+};
+
+#endif
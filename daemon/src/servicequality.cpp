@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "servicequality.h"
+#include <common/src/wakeupaccounting.h>
 #include <kapps_core/src/uuid.h>
 #include <chrono>
 #include <array>
@@ -101,6 +102,8 @@ ServiceQuality::ServiceQuality(ApiClient &apiClient, Environment &environment,
     _earlySendTimer.setObjectName(QStringLiteral("early send timer"));
     _rotateIdTimer.setSingleShot(true);
     _earlySendTimer.setSingleShot(true);
+    tagWakeups(_rotateIdTimer, QByteArrayLiteral("servicequality"));
+    tagWakeups(_earlySendTimer, QByteArrayLiteral("servicequality"));
 
     connect(&_rotateIdTimer, &QTimer::timeout, this,
             &ServiceQuality::onRotateIdElapsed);
@@ -109,6 +112,10 @@ ServiceQuality::ServiceQuality(ApiClient &apiClient, Environment &environment,
 
     generateEarlySendTime();
 
+    // Send partial batches along with other API traffic when possible
+    connect(&_apiClient, &ApiClient::requestSucceeded, this,
+            &ServiceQuality::onApiRequestSucceeded);
+
     // Whenever the aggregation ID rotate time changes, set our timer so we'll
     // actually rotate it at that time.
     connect(&_data, &DaemonData::qualityAggIdRotateTimeChanged, this,
@@ -297,6 +304,29 @@ void ServiceQuality::onEarlySendElapsed()
     sendBatch();
 }
 
+void ServiceQuality::onApiRequestSucceeded()
+{
+    // Nothing to do if a batch is already in flight (this might be its own
+    // response) or nothing is queued
+    const auto &queued{_data.qualityEventsQueued()};
+    if(_sendingBatchSize || queued.empty())
+        return;
+
+    // Only send early if the newest event is at least _minEarlySendTime old.
+    // This keeps the same minimum delay as the early-send timer - events are
+    // never sent in the same hour they were generated - but doesn't require a
+    // separate wakeup when the daemon is making other API requests anyway.
+    // The timing is driven by other requests, so it still isn't aligned to the
+    // hour.
+    if(!hasExpired(timeFromSec(queued.back().event_time()), _minEarlySendTime))
+        return;
+
+    qInfo() << "Sending partial event batch along with other API requests";
+    _earlySendTimer.stop();
+    generateEarlySendTime();
+    sendBatch();
+}
+
 void ServiceQuality::moveQueuedToSent(std::size_t count)
 {
     auto queued{_data.qualityEventsQueued()};
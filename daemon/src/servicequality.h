@@ -142,6 +142,9 @@ private:
     void onQueuedEventsChanged();
     void onRotateIdElapsed();
     void onEarlySendElapsed();
+    // Another API request succeeded - send a partial batch early if the
+    // queued events are old enough (see _minEarlySendTime).
+    void onApiRequestSucceeded();
 
     // Move events from the beginning of DaemonData::qualityEventsQueued() to
     // the end of DaemonData::qualityEventsSent()
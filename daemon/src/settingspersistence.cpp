@@ -0,0 +1,166 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+
+#include <common/src/common.h>
+#line SOURCE_FILE("settingspersistence.cpp")
+
+#include "settingspersistence.h"
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <cstdio>
+
+#if defined(Q_OS_WIN)
+    #include <kapps_core/src/winapi.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // Replace 'targetPath' with 'tempPath'.  This is atomic on POSIX; on
+    // Windows ReplaceFileW() is used, which also keeps the existing file's
+    // security descriptor (see restrictAccountJson() for account.json).
+    bool replaceFile(const QString &tempPath, const QString &targetPath)
+    {
+#if defined(Q_OS_WIN)
+        std::wstring target = QDir::toNativeSeparators(targetPath).toStdWString();
+        std::wstring temp = QDir::toNativeSeparators(tempPath).toStdWString();
+        if(QFile::exists(targetPath))
+        {
+            return ::ReplaceFileW(target.c_str(), temp.c_str(), nullptr,
+                                  REPLACEFILE_IGNORE_MERGE_ERRORS, nullptr,
+                                  nullptr);
+        }
+        return ::MoveFileExW(temp.c_str(), target.c_str(),
+                             MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH);
+#else
+        return std::rename(QFile::encodeName(tempPath).constData(),
+                           QFile::encodeName(targetPath).constData()) == 0;
+#endif
+    }
+}
+
+void SettingsPersistence::queueWrite(QJsonObject object, Path settingsDir,
+                                     QString filename)
+{
+    _worker.queueOnThread([this, object = std::move(object),
+                           settingsDir = std::move(settingsDir),
+                           filename = std::move(filename)]()
+    {
+        writeFile(QJsonDocument(object).toJson(QJsonDocument::Compact),
+                  settingsDir, filename);
+    });
+}
+
+void SettingsPersistence::queueWrite(QByteArray content, Path settingsDir,
+                                     QString filename)
+{
+    _worker.queueOnThread([this, content = std::move(content),
+                           settingsDir = std::move(settingsDir),
+                           filename = std::move(filename)]()
+    {
+        writeFile(content, settingsDir, filename);
+    });
+}
+
+void SettingsPersistence::flush()
+{
+    // The worker processes calls in order, so this returns once all prior
+    // writes are done
+    _worker.invokeOnThread([](){});
+}
+
+QString SettingsPersistence::diagnostics() const
+{
+    std::unique_lock<std::mutex> lock{_statsMutex};
+    qint64 avgWriteMs = _stats.written ? _stats.totalWriteMs / _stats.written : 0;
+    return QStringLiteral("Files written: %1\nUnchanged writes skipped: %2\n"
+                          "Failed writes: %3\nLast write: %4 ms\n"
+                          "Average write: %5 ms\nMax write: %6 ms")
+        .arg(_stats.written).arg(_stats.unchanged).arg(_stats.failed)
+        .arg(_stats.lastWriteMs).arg(avgWriteMs).arg(_stats.maxWriteMs);
+}
+
+void SettingsPersistence::writeFile(const QByteArray &content,
+                                    const Path &settingsDir,
+                                    const QString &filename)
+{
+    QElapsedTimer writeTime;
+    writeTime.start();
+
+    const QString filePath = settingsDir.mkpath() / filename;
+    const QByteArray contentHash = QCryptographicHash::hash(content, QCryptographicHash::Sha256);
+
+    auto itLastHash = _lastContentHashes.find(filePath);
+    if(itLastHash != _lastContentHashes.end() && itLastHash.value() == contentHash)
+    {
+        std::unique_lock<std::mutex> lock{_statsMutex};
+        ++_stats.unchanged;
+        return;
+    }
+
+    const QString tempPath = filePath + QStringLiteral(".tmp");
+    bool success = false;
+    {
+        QFile tempFile{tempPath};
+        if(tempFile.open(QFile::WriteOnly | QFile::Truncate) &&
+           tempFile.write(content) == content.size() && tempFile.flush())
+        {
+#if !defined(Q_OS_WIN)
+            // Keep the permissions of the existing file (account.json is only
+            // readable by root), and make sure the content is on disk before
+            // it replaces the old file.
+            if(QFile::exists(filePath))
+                tempFile.setPermissions(QFile::permissions(filePath));
+            success = ::fsync(tempFile.handle()) == 0;
+#else
+            success = true;
+#endif
+        }
+    }
+    success = success && replaceFile(tempPath, filePath);
+
+    qint64 elapsedMs = writeTime.elapsed();
+    if(success)
+    {
+        _lastContentHashes.insert(filePath, contentHash);
+        qDebug() << "Successfully wrote" << filename << "in" << elapsedMs << "ms";
+    }
+    else
+    {
+        // Forget the last content; the file's state is unknown now
+        _lastContentHashes.remove(filePath);
+        QFile::remove(tempPath);
+        qCritical() << "Unable to write" << filename;
+    }
+
+    std::unique_lock<std::mutex> lock{_statsMutex};
+    if(success)
+    {
+        ++_stats.written;
+        _stats.lastWriteMs = elapsedMs;
+        _stats.totalWriteMs += elapsedMs;
+        _stats.maxWriteMs = std::max(_stats.maxWriteMs, elapsedMs);
+    }
+    else
+        ++_stats.failed;
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+
+#ifndef SETTINGSPERSISTENCE_H
+#define SETTINGSPERSISTENCE_H
+
+#include <common/src/common.h>
+#include <common/src/thread.h>
+#include <common/src/builtin/path.h>
+#include <QJsonObject>
+#include <QHash>
+#include <mutex>
+
+// SettingsPersistence writes the daemon's JSON files (data.json,
+// account.json, settings.json) on a worker thread, so slow disks don't block
+// the daemon's event loop.
+//
+// Each file is written to a temporary file that then replaces the real file,
+// so a crash or power loss during a write can't leave a truncated file.  If
+// the serialized content is identical to what was last written, the write is
+// skipped entirely.
+//
+// Writes are processed in order.  Any queued writes are completed when
+// SettingsPersistence is destroyed.
+class SettingsPersistence
+{
+    CLASS_LOGGING_CATEGORY("json.settings")
+
+public:
+    // Queue a write of 'object' to 'filename' in 'settingsDir'.  The object is
+    // serialized on the worker thread.
+    void queueWrite(QJsonObject object, Path settingsDir, QString filename);
+    // Queue a write of raw content (used for binary caches)
+    void queueWrite(QByteArray content, Path settingsDir, QString filename);
+
+    // Wait for all writes queued so far to complete.
+    void flush();
+
+    // Describe the write statistics for diagnostics
+    QString diagnostics() const;
+
+private:
+    // Write a file - on the worker thread.
+    void writeFile(const QByteArray &content, const Path &settingsDir,
+                   const QString &filename);
+
+private:
+    struct Stats
+    {
+        int written{0};
+        int unchanged{0};
+        int failed{0};
+        qint64 lastWriteMs{0};
+        qint64 maxWriteMs{0};
+        qint64 totalWriteMs{0};
+    };
+
+    // Hash of the content last written to each file, keyed by the file path.
+    // Only used on the worker thread.
+    QHash<QString, QByteArray> _lastContentHashes;
+    mutable std::mutex _statsMutex;
+    Stats _stats;
+    // Declared last so it's destroyed first - this completes any queued
+    // writes while the rest of the object is still valid.
+    RunningWorkerThread _worker;
+};
+
+#endif
@@ -24,6 +24,7 @@
 #include <QRandomGenerator>
 #include <QCryptographicHash>
 #include <QNetworkProxy>
+#include <QTimerEvent>
 
 // For SO_BINDTODEVICE
 #ifdef Q_OS_LINUX
@@ -32,6 +33,17 @@
 
 namespace
 {
+    // Data is relayed through a fixed buffer of this size per connection
+    const qint64 relayChunkSize{16 * 1024};
+    // Once connected, each socket's read buffer is bounded to this size.  When
+    // the destination can't keep up, data is left in the kernel's socket
+    // buffer instead, which applies TCP flow control to the sender.
+    const qint64 relayReadBufferSize{64 * 1024};
+    // Stop relaying to a socket once this much data is waiting to be written
+    // to it, and resume once it has drained to the low watermark.
+    const qint64 relayHighWatermark{256 * 1024};
+    const qint64 relayLowWatermark{64 * 1024};
+
     // SOCKS protocol constants
     enum : quint8
     {
@@ -277,18 +289,30 @@ SocksConnection::SocksConnection(QTcpSocket &socksSocket,
     connect(&_targetSocket, &QTcpSocket::readyRead, this, &SocksConnection::onTargetReadyRead);
     connect(&_targetSocket, &QTcpSocket::errorOccurred, this, &SocksConnection::onTargetError);
     connect(&_targetSocket, &QTcpSocket::disconnected, this, &SocksConnection::onTargetDisconnected);
+    connect(&_socksSocket, &QTcpSocket::bytesWritten, this, &SocksConnection::onSocksBytesWritten);
+    connect(&_targetSocket, &QTcpSocket::bytesWritten, this, &SocksConnection::onTargetBytesWritten);
+
+    // Time out if initial negotiation isn't completed
+    startAbortTimer();
+}
 
-    _abortTimer.setSingleShot(true);
-    _abortTimer.setInterval(msec(std::chrono::seconds(5)));
-    _abortTimer.callOnTimeout(this, [this]()
+void SocksConnection::startAbortTimer()
+{
+    _abortTimer.start(msec(std::chrono::seconds(5)), this);
+}
+
+void SocksConnection::timerEvent(QTimerEvent *pEvent)
+{
+    if(!pEvent || pEvent->timerId() != _abortTimer.timerId())
     {
-        qWarning() << "API proxy:" << this << "Aborting SOCKS connection in state" << traceEnum(_state)
-            << "due to timeout";
-        abortConnection();
-    });
+        QObject::timerEvent(pEvent);
+        return;
+    }
 
-    // Time out if initial negotiation isn't completed
-    _abortTimer.start();
+    _abortTimer.stop();
+    qWarning() << "API proxy:" << this << "Aborting SOCKS connection in state" << traceEnum(_state)
+        << "due to timeout";
+    abortConnection();
 }
 
 void SocksConnection::abortConnection()
@@ -318,7 +342,7 @@ void SocksConnection::rejectConnection(const QByteArray &response)
     _state = State::SocksDisconnecting;
     // Abort if the client doesn't disconnect soon.  (If the timer was already
     // running for the negotiation phase, this restarts it.)
-    _abortTimer.start();
+    startAbortTimer();
     respond(response);
     // As long as we didn't abort in respond(), disconnect the socket.  This
     // waits for buffers to clear before disconnecting.
@@ -356,19 +380,27 @@ bool SocksConnection::checkUPAuthVersion(const QByteArray &message)
 }
 
 void SocksConnection::forwardData(QTcpSocket &source, QTcpSocket &dest,
-                                  const QString &directionTrace)
+                                  const QString &directionTrace, bool drain)
 {
     Q_ASSERT(_state == State::Connected);   // Ensured by caller
+    Q_ASSERT(_relayBuffer.size() == relayChunkSize); // Allocated when connected
 
-    auto data = source.readAll();
-    if(!data.isEmpty())
+    // Relay until the source is empty or the destination reaches its high
+    // watermark.  Anything left over stays in the source's read buffer and is
+    // relayed when the destination drains.
+    while(source.bytesAvailable() > 0 &&
+          (drain || dest.bytesToWrite() < relayHighWatermark))
     {
-        auto size = dest.write(data);
-        if(size != data.size())
+        auto readSize = source.read(_relayBuffer.data(), _relayBuffer.size());
+        if(readSize <= 0)
+            break;
+        auto size = dest.write(_relayBuffer.constData(), readSize);
+        if(size != readSize)
         {
-            qWarning() << "API proxy:" << this << "Failed to forward" << data.size()
+            qWarning() << "API proxy:" << this << "Failed to forward" << readSize
                 << "bytes of" << directionTrace << "data -" << size;
             abortConnection();
+            return;
         }
     }
 }
@@ -708,10 +740,14 @@ void SocksConnection::onSocksDisconnected()
             abortConnection();
             break;
         case State::Connected:
-            // This is normal, SOCKS side has shut down the connection.
+            // This is normal, SOCKS side has shut down the connection.  Relay
+            // anything that was held back by the watermark first.
+            forwardData(_socksSocket, _targetSocket, QStringLiteral("outbound"), true);
+            if(_state != State::Connected)
+                break;  // Aborted
             _state = State::TargetDisconnecting;
             _targetSocket.disconnectFromHost(); // Flushes data
-            _abortTimer.start();
+            startAbortTimer();
             break;
         case State::SocksDisconnecting:
             // All done, both sides have disconnected, just shut down
@@ -743,6 +779,11 @@ void SocksConnection::onTargetConnected()
         case State::Connecting:
         {
             _state = State::Connected;
+            // Relay through a fixed buffer with bounded socket buffers, see
+            // forwardData()
+            _relayBuffer.resize(relayChunkSize);
+            _socksSocket.setReadBufferSize(relayReadBufferSize);
+            _targetSocket.setReadBufferSize(relayReadBufferSize);
             // Send the success reply to the SOCKS connection
             QByteArray response{ConnectResponseMsg::Length, 0};
             response[ConnectResponseMsg::Version] = SocksVersion;
@@ -890,10 +931,14 @@ void SocksConnection::onTargetDisconnected()
             abortConnection();
             break;
         case State::Connected:
-            // This is normal, target side has shut down the connection.
+            // This is normal, target side has shut down the connection.  Relay
+            // anything that was held back by the watermark first.
+            forwardData(_targetSocket, _socksSocket, QStringLiteral("inbound"), true);
+            if(_state != State::Connected)
+                break;  // Aborted
             _state = State::SocksDisconnecting;
             _socksSocket.disconnectFromHost(); // Flushes data
-            _abortTimer.start();
+            startAbortTimer();
             break;
         case State::TargetDisconnecting:
             // All done, both sides have disconnected, just shut down
@@ -902,3 +947,17 @@ void SocksConnection::onTargetDisconnected()
             break;
     }
 }
+
+void SocksConnection::onSocksBytesWritten()
+{
+    // If the SOCKS side has drained, relay more inbound data
+    if(_state == State::Connected && _socksSocket.bytesToWrite() <= relayLowWatermark)
+        forwardData(_targetSocket, _socksSocket, QStringLiteral("inbound"));
+}
+
+void SocksConnection::onTargetBytesWritten()
+{
+    // If the target side has drained, relay more outbound data
+    if(_state == State::Connected && _targetSocket.bytesToWrite() <= relayLowWatermark)
+        forwardData(_socksSocket, _targetSocket, QStringLiteral("outbound"));
+}
@@ -24,7 +24,7 @@
 
 #include <QTcpServer>
 #include <QTcpSocket>
-#include <QTimer>
+#include <QBasicTimer>
 
 // SocksServer runs a minimal TCP SOCKS5 server that forwards connections
 // through the VPN interface.  This is used to route QNetworkAccessManager-based
@@ -62,6 +62,11 @@ private:
 };
 
 // SocksConnection handles a single connection established to the SocksServer.
+//
+// The client can pipeline the handshake - send the greeting, authentication,
+// and CONNECT request without waiting for each response.  Each message is
+// processed as soon as it's complete, and any data sent after the CONNECT
+// request is held in the socket buffer until the target connects.
 class SocksConnection : public QObject
 {
     Q_OBJECT
@@ -129,6 +134,10 @@ public:
                     QHostAddress bindAddress, QString bindInterface);
 
 private:
+    // (Re)start the abort timer
+    void startAbortTimer();
+    virtual void timerEvent(QTimerEvent *pEvent) override;
+
     // Close the TCP connection(s) immediately without sending any failure
     // response.  Used for protocol errors.  Goes to the Closed state and queues
     // deletion of the QTcpSocket parent (and this SocksConnection).
@@ -149,10 +158,11 @@ private:
     bool checkSocksVersion(const QByteArray &message);
     bool checkUPAuthVersion(const QByteArray &message);
 
-    // Forward all available data in both directions.  If any write fails, this
-    // aborts the connection.
+    // Forward available data from source to dest, until dest reaches the
+    // high watermark of unwritten data (unless 'drain' is set, which forwards
+    // everything).  If any write fails, this aborts the connection.
     void forwardData(QTcpSocket &source, QTcpSocket &dest,
-                     const QString &directionTrace);
+                     const QString &directionTrace, bool drain = false);
     // Process incoming data on the SOCKS connection (protocol messages or
     // application data).  Used by onSocksReadyRead().
     void processSocksData();
@@ -166,6 +176,10 @@ private:
     void onTargetReadyRead();
     void onTargetDisconnected();
 
+    // When a socket drains below the low watermark, resume relaying to it
+    void onSocksBytesWritten();
+    void onTargetBytesWritten();
+
 private:
     // The incoming QTcpSocket is held by reference - since SocksConnection is
     // parented to it, this reference remains valid as long as SocksConnection
@@ -176,17 +190,20 @@ private:
     QString _bindInterface;
     State _state;
     // In states other than Connecting and Connected, we set a 5-second timer
-    // that will abort the connection.  This means that:
+    // that will abort the connection.  (This is a QBasicTimer, which is just a
+    // timer ID, to keep per-connection state small.)  This means that:
     // - The SOCKS client must complete the initial negotiation within 5 seconds
     // - If the connection fails, the client has 5 seconds to receive the
     //   response
     // - If either side disconnects, the other side has 5 seconds to recieve any
     //   remaining data and disconnect
-    QTimer _abortTimer;
+    QBasicTimer _abortTimer;
     // In Receive* states, the number of bytes in the next message.  In other
     // states, 0.
     qint64 _nextMessageBytes;
     QTcpSocket _targetSocket;
+    // Buffer used to relay data once connected (reused for both directions)
+    QByteArray _relayBuffer;
 };
 
 #endif
@@ -0,0 +1,125 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("throughputhistory.cpp")
+
+#include "throughputhistory.h"
+#include <QJsonObject>
+#include <algorithm>
+
+namespace
+{
+    struct RingParams
+    {
+        std::chrono::seconds _resolution;
+        std::size_t _capacity;
+    };
+    // 5 s x 360 = 30 minutes, 1 min x 240 = 4 hours, 10 min x 144 = 1 day
+    const RingParams ringParams[]
+    {
+        {std::chrono::seconds{5}, 360},
+        {std::chrono::minutes{1}, 240},
+        {std::chrono::minutes{10}, 144},
+    };
+}
+
+const std::vector<std::chrono::seconds> &ThroughputHistory::resolutions()
+{
+    static const std::vector<std::chrono::seconds> values = []()
+    {
+        std::vector<std::chrono::seconds> result;
+        for(const auto &params : ringParams)
+            result.push_back(params._resolution);
+        return result;
+    }();
+    return values;
+}
+
+ThroughputHistory::ThroughputHistory()
+{
+    _rings.reserve(std::size(ringParams));
+    for(const auto &params : ringParams)
+        _rings.push_back({msec(params._resolution), params._capacity, {}});
+}
+
+void ThroughputHistory::addMeasurement(quint64 received, quint64 sent, qint64 time)
+{
+    for(auto &ring : _rings)
+    {
+        qint64 sampleTime = time - (time % ring._resolutionMs);
+        if(!ring._samples.empty() && ring._samples.back()._time >= sampleTime)
+        {
+            // Same sample (or the clock went backward; add to the latest
+            // sample rather than going out of order)
+            ring._samples.back()._received += received;
+            ring._samples.back()._sent += sent;
+            continue;
+        }
+
+        if(ring._samples.size() >= ring._capacity)
+            ring._samples.pop_front();
+        ring._samples.push_back({sampleTime, received, sent});
+    }
+}
+
+void ThroughputHistory::clear()
+{
+    for(auto &ring : _rings)
+        ring._samples.clear();
+}
+
+auto ThroughputHistory::findRing(std::chrono::seconds resolution) const -> const Ring *
+{
+    auto itRing = std::find_if(_rings.begin(), _rings.end(),
+        [&](const Ring &ring){return ring._resolutionMs == msec(resolution);});
+    return itRing == _rings.end() ? nullptr : &*itRing;
+}
+
+bool ThroughputHistory::query(std::chrono::seconds resolution, qint64 since,
+                              std::vector<Sample> &samples) const
+{
+    const Ring *pRing = findRing(resolution);
+    if(!pRing)
+        return false;
+
+    // Samples are in order, find the first one in the range
+    auto itFirst = std::lower_bound(pRing->_samples.begin(), pRing->_samples.end(), since,
+        [](const Sample &sample, qint64 value){return sample._time < value;});
+    samples.assign(itFirst, pRing->_samples.end());
+    return true;
+}
+
+bool ThroughputHistory::queryJson(std::chrono::seconds resolution, qint64 since,
+                                  QJsonArray &samples) const
+{
+    std::vector<Sample> values;
+    if(!query(resolution, since, values))
+        return false;
+
+    samples = {};
+    for(const auto &value : values)
+    {
+        samples.push_back(QJsonObject{
+            {QStringLiteral("time"), value._time},
+            {QStringLiteral("received"), static_cast<qint64>(value._received)},
+            {QStringLiteral("sent"), static_cast<qint64>(value._sent)}
+        });
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("throughputhistory.h")
+
+#ifndef THROUGHPUTHISTORY_H
+#define THROUGHPUTHISTORY_H
+
+#include <QJsonArray>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+// ThroughputHistory keeps the bandwidth measured while connected at several
+// resolutions, so clients can fetch any part of it when they need it instead
+// of keeping their own history.
+//
+// Each resolution is a fixed-size ring of samples aligned to multiples of the
+// resolution (in wall-clock time).  Each measurement is added to the current
+// sample of every resolution, so the total memory used is bounded, and the
+// coarser resolutions cover longer periods.
+class ThroughputHistory
+{
+public:
+    struct Sample
+    {
+        // Start of the sample (ms since epoch), a multiple of the resolution
+        qint64 _time;
+        quint64 _received;
+        quint64 _sent;
+    };
+
+    // The resolutions kept - 5 seconds is the measurement interval of both
+    // VPN methods.
+    static const std::vector<std::chrono::seconds> &resolutions();
+
+public:
+    ThroughputHistory();
+
+public:
+    // Add a measurement taken at the given time (ms since epoch)
+    void addMeasurement(quint64 received, quint64 sent, qint64 time);
+    // Discard all samples
+    void clear();
+
+    // Get the samples at this resolution starting at or after 'since' (ms
+    // since epoch), oldest first.  Returns false if the resolution isn't one
+    // of resolutions().
+    bool query(std::chrono::seconds resolution, qint64 since,
+               std::vector<Sample> &samples) const;
+    // Same as query(), but renders the samples as JSON for RPC - each sample
+    // is an object with "time", "received", and "sent"
+    bool queryJson(std::chrono::seconds resolution, qint64 since,
+                   QJsonArray &samples) const;
+
+private:
+    struct Ring
+    {
+        qint64 _resolutionMs;
+        std::size_t _capacity;
+        std::deque<Sample> _samples;
+    };
+    const Ring *findRing(std::chrono::seconds resolution) const;
+
+private:
+    std::vector<Ring> _rings;
+};
+
+#endif
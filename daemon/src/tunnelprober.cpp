@@ -0,0 +1,180 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("tunnelprober.cpp")
+
+#include "tunnelprober.h"
+#include <common/src/wakeupaccounting.h>
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include "win/win_ping.h"
+#else
+#include "posix/posix_ping.h"
+#endif
+
+namespace
+{
+    // The probe timeout is kept within these bounds; the initial timeout is
+    // used until a reply has been received.
+    const std::chrono::milliseconds minProbeTimeout{500};
+    const std::chrono::milliseconds maxProbeTimeout{5000};
+    const std::chrono::milliseconds initialProbeTimeout{1000};
+    // The tunnel is considered lost after this many consecutive probes are
+    // unanswered.  Each retransmission doubles the timeout.
+    const int maxMissedProbes{3};
+}
+
+TunnelProber::TunnelProber(QObject *pParent)
+    : QObject{pParent}, _srtt{0}, _rttvar{0}, _missedProbes{-1}, _probeId{0}
+{
+#if !defined(Q_OS_WIN)
+    _pPing.reset(new PosixPing{});
+    connect(_pPing.get(), &PosixPing::receivedReply, this,
+            &TunnelProber::receivedReply);
+#endif
+    _probeTimer.setSingleShot(true);
+    tagWakeups(_probeTimer, QByteArrayLiteral("tunnelprober"));
+    connect(&_probeTimer, &QTimer::timeout, this, &TunnelProber::onProbeTimeout);
+}
+
+TunnelProber::~TunnelProber() = default;
+
+void TunnelProber::endpoint(const QHostAddress &address)
+{
+    stop();
+    _endpoint = address;
+    _srtt = _rttvar = std::chrono::microseconds{0};
+}
+
+void TunnelProber::probe()
+{
+    if(_missedProbes >= 0 || _endpoint.isNull())
+        return; // Already waiting on a probe, or nothing to probe
+    _missedProbes = 0;
+    sendProbe();
+}
+
+void TunnelProber::dataReceived()
+{
+    if(_missedProbes > 0)
+    {
+        qInfo() << "Received data after" << _missedProbes
+            << "unanswered probes";
+    }
+    stop();
+}
+
+void TunnelProber::stop()
+{
+    _probeTimer.stop();
+    _missedProbes = -1;
+    ++_probeId;
+}
+
+std::chrono::milliseconds TunnelProber::probeTimeout() const
+{
+    if(_srtt.count() == 0)
+        return initialProbeTimeout;
+    auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(_srtt + 4 * _rttvar);
+    return std::max(minProbeTimeout, std::min(maxProbeTimeout, timeout));
+}
+
+void TunnelProber::sendProbe()
+{
+    // Back off for each probe that has been missed
+    auto timeout = std::min(maxProbeTimeout, probeTimeout() * (1 << _missedProbes));
+    ++_probeId;
+
+    quint32 address = _endpoint.toIPv4Address();
+#if defined(Q_OS_WIN)
+    QPointer<WinIcmpEcho> pEcho = WinIcmpEcho::send(address, timeout);
+    if(pEcho)
+    {
+        quint64 probeId = _probeId;
+        connect(pEcho.data(), &WinIcmpEcho::receivedReply, this,
+                [this, probeId](quint32 replyAddr, std::chrono::milliseconds roundtrip)
+                {
+                    if(probeId == _probeId)
+                        receivedReply(replyAddr, roundtrip);
+                });
+    }
+#else
+    _pPing->sendEchoRequest(address);
+#endif
+    // If the probe couldn't be sent, it counts as missed when the timer
+    // elapses.
+    _probeTimer.start(msec32(timeout));
+}
+
+void TunnelProber::receivedReply(quint32 address, std::chrono::microseconds roundtrip)
+{
+    // Ignore replies when no probe is outstanding (such as a late reply after
+    // data was received)
+    if(_missedProbes < 0 || address != _endpoint.toIPv4Address())
+        return;
+
+    // Update the round trip estimates.  Only probes that weren't retransmitted
+    // are used, since the reply could be for any of the retransmissions
+    // (Karn's algorithm).
+    if(_missedProbes == 0)
+    {
+        if(_srtt.count() == 0)
+        {
+            _srtt = roundtrip;
+            _rttvar = roundtrip / 2;
+        }
+        else
+        {
+            auto delta = _srtt > roundtrip ? _srtt - roundtrip : roundtrip - _srtt;
+            _rttvar = (_rttvar * 3 + delta) / 4;
+            _srtt = (_srtt * 7 + roundtrip) / 8;
+        }
+    }
+
+    stop();
+}
+
+void TunnelProber::onProbeTimeout()
+{
+    if(_missedProbes < 0)
+        return;
+
+    ++_missedProbes;
+    if(_missedProbes >= maxMissedProbes)
+    {
+        // If the endpoint has never answered, it might just not answer
+        // probes at all; don't treat that as a lost tunnel.
+        if(_srtt.count() == 0)
+        {
+            qInfo() << "Tunnel endpoint" << _endpoint
+                << "has not responded to any probes yet";
+            stop();
+            return;
+        }
+        qWarning() << "Tunnel endpoint" << _endpoint << "did not respond to"
+            << _missedProbes << "probes";
+        stop();
+        emit tunnelLost();
+        return;
+    }
+
+    qInfo() << "Tunnel probe" << _missedProbes << "timed out, retrying";
+    sendProbe();
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("tunnelprober.h")
+
+#ifndef TUNNELPROBER_H
+#define TUNNELPROBER_H
+
+#include <QHostAddress>
+#include <QObject>
+#include <QTimer>
+#include <chrono>
+#include <memory>
+
+class PosixPing;
+
+// TunnelProber checks that a tunnel is still alive by sending ICMP echoes to
+// an address on the far side of the tunnel (such as the server's virtual IP).
+//
+// The owner calls probe() whenever the tunnel has been idle; if the tunnel is
+// alive, the reply arrives within a round trip.  Unanswered probes are
+// retransmitted with a backoff; if several are missed in a row, tunnelLost()
+// is emitted.  (This only happens once the endpoint has answered at least one
+// probe, in case it doesn't answer probes at all.)  Any data received through the tunnel
+// (dataReceived()) also shows that it is alive.
+//
+// The probe timeout adapts to the tunnel's round trip time, like TCP's
+// retransmission timeout (RFC 6298), so a dead tunnel is detected in a few
+// seconds on a healthy low-latency connection without misfiring on a slow
+// one.
+class TunnelProber : public QObject
+{
+    Q_OBJECT
+    CLASS_LOGGING_CATEGORY("tunnelprober")
+
+public:
+    explicit TunnelProber(QObject *pParent = nullptr);
+    // Defined in tunnelprober.cpp where PosixPing is complete
+    ~TunnelProber();
+
+public:
+    // Set the address to probe; this resets any outstanding probe.
+    void endpoint(const QHostAddress &address);
+    // Send a probe if one isn't already outstanding
+    void probe();
+    // Data was received through the tunnel; cancel any outstanding probe.
+    void dataReceived();
+    // Stop probing (for example, when the connection is shutting down)
+    void stop();
+
+    // The current probe timeout
+    std::chrono::milliseconds probeTimeout() const;
+
+private:
+    void sendProbe();
+    void receivedReply(quint32 address, std::chrono::microseconds roundtrip);
+    void onProbeTimeout();
+
+signals:
+    // The tunnel didn't respond to several probes in a row
+    void tunnelLost();
+
+private:
+    QHostAddress _endpoint;
+#if !defined(Q_OS_WIN)
+    std::unique_ptr<PosixPing> _pPing;
+#endif
+    QTimer _probeTimer;
+    // Smoothed round trip time and its variation (RFC 6298).  _srtt is 0 until
+    // the first reply.
+    std::chrono::microseconds _srtt, _rttvar;
+    // Consecutive unanswered probes; -1 when no probe is outstanding
+    int _missedProbes;
+    // Incremented for each probe so stale replies from Windows echoes can be
+    // ignored
+    quint64 _probeId;
+};
+
+#endif
@@ -34,6 +34,7 @@
 #include <QNetworkReply>
 #include <QDir>
 #include <QProcess>
+#include <algorithm>
 
 #ifdef Q_OS_WIN
 #include <kapps_core/src/winapi.h>
@@ -81,6 +82,13 @@ namespace
     const std::chrono::hours versionRefreshInterval{1};
     // Timeout for no progress during update download
     const std::chrono::seconds timeoutInterval{15};
+    // Update downloads are limited to this rate (bytes per second), so they
+    // don't compete with user traffic.  The limit is applied by reading from
+    // the reply in slices each throttleInterval; the reply's read buffer is
+    // limited so Qt stops reading from the socket when we do.
+    const qint64 downloadRateLimit{4 * 1024 * 1024};
+    const std::chrono::milliseconds throttleInterval{100};
+    const qint64 downloadReadBufferSize{256 * 1024};
 }
 
 Update::Update(const QString &uri, const QString &version, const QString &osRequired)
@@ -278,7 +286,17 @@ UpdateDownloader::UpdateDownloader()
     , _running{false}
     , _enableBeta{false}
     , _downloadTimedOut{false}
+    , _installerHash{QCryptographicHash::Algorithm::Sha256}
+    , _resumeOffset{0}
+    , _throttleBudget{0}
 {
+    _progressTimer.setInterval(timeoutInterval);
+    connect(&_progressTimer, &QTimer::timeout, this,
+            &UpdateDownloader::downloadTimerElapsed);
+    _throttleTimer.setInterval(throttleInterval);
+    connect(&_throttleTimer, &QTimer::timeout, this,
+            &UpdateDownloader::throttleTimerElapsed);
+
     // If the daemon's version can't be parsed, we log an error and proceed with
     // the default version above that will never offer an upgrade.  This might
     // happen for developer builds if they're doing really crazy stuff; it
@@ -497,20 +515,69 @@ Async<DownloadResult> UpdateDownloader::downloadUpdate()
     Path downloadPath{Path::DaemonUpdateDir / reqUrl.fileName()};
     _installerFile.unsetError();
     _installerFile.setFileName(downloadPath);
+    _installerHash.reset();
+    _resumeOffset = 0;
+
+    // If this installer was already downloaded (the user might have dismissed
+    // the update and downloaded it again), use the existing file if it hasn't
+    // changed.
+    if(_completedDownloadUrl == reqUrl &&
+        _installerFile.open(QFile::OpenModeFlag::ReadOnly))
+    {
+        QCryptographicHash existingHash{QCryptographicHash::Algorithm::Sha256};
+        bool intact = existingHash.addData(&_installerFile) &&
+            existingHash.result() == _completedDownloadHash;
+        _installerFile.close();
+        if(intact)
+        {
+            qInfo() << "Installer for" << availableUpdate.version()
+                << "was already downloaded to" << downloadPath;
+            emit downloadProgress(availableUpdate.version(), 100);
+            emit downloadFinished(availableUpdate.version(), _installerFile.fileName());
+            return Async<DownloadResult>::resolve(DownloadResult().version(availableUpdate.version()).succeeded(true));
+        }
+        qWarning() << "Installer for" << availableUpdate.version()
+            << "has changed since it was downloaded, downloading it again";
+    }
+    _completedDownloadUrl.clear();
+    _completedDownloadHash.clear();
 
-    // Attempt to clean any old downloads that exist to limit accumulation of
-    // installers.  Failure does not prevent us from downloading the new file
-    // though.
-    // Note that QDir::removeRecursively() returns true (success) if the
-    // directory doesn't exist ("expected result already reached" per doc).
-    if(!QDir{Path::DaemonUpdateDir}.removeRecursively())
+    // If the last download of this URL was interrupted, resume it.  Hash the
+    // data we already have so the hash still covers the whole file.
+    if(_partialDownloadUrl == reqUrl &&
+        _installerFile.open(QFile::OpenModeFlag::ReadOnly))
+    {
+        if(_installerHash.addData(&_installerFile))
+            _resumeOffset = _installerFile.size();
+        else
+            _installerHash.reset();
+        _installerFile.close();
+    }
+    _partialDownloadUrl.clear();
+
+    if(_resumeOffset > 0)
+    {
+        qInfo() << "Resuming installer download of" << availableUpdate.version()
+            << "from" << _resumeOffset << "bytes";
+    }
+    else
     {
-        qWarning() << "Unable to clean update directory:"
-            << Path::DaemonUpdateDir;
+        // Attempt to clean any old downloads that exist to limit accumulation
+        // of installers.  Failure does not prevent us from downloading the new
+        // file though.
+        // Note that QDir::removeRecursively() returns true (success) if the
+        // directory doesn't exist ("expected result already reached" per doc).
+        if(!QDir{Path::DaemonUpdateDir}.removeRecursively())
+        {
+            qWarning() << "Unable to clean update directory:"
+                << Path::DaemonUpdateDir;
+        }
     }
 
     Path::DaemonUpdateDir.mkpath();
-    if(!_installerFile.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+    QFile::OpenMode openMode{QFile::OpenModeFlag::WriteOnly};
+    openMode |= (_resumeOffset > 0) ? QFile::OpenModeFlag::Append : QFile::OpenModeFlag::Truncate;
+    if(!_installerFile.open(openMode))
     {
         // Can't open the file for some reason.  This could legitimately happen,
         // ensure that it's visible if it does.
@@ -521,15 +588,18 @@ Async<DownloadResult> UpdateDownloader::downloadUpdate()
         return Async<DownloadResult>::resolve(DownloadResult().version(availableUpdate.version()).failed(true));
     }
 
-    // Creating the progress timer, but not starting it.
-    connect(&_progressTimer, &QTimer::timeout, this,
-            &UpdateDownloader::downloadTimerElapsed);
-    _progressTimer.setInterval(timeoutInterval);
+    // The progress timer is started when progress is reported.
     _downloadTimedOut = false;
 
     QNetworkRequest downloadReq{availableUpdate.uri()};
+    if(_resumeOffset > 0)
+    {
+        downloadReq.setRawHeader(QByteArrayLiteral("Range"),
+            QByteArrayLiteral("bytes=") + QByteArray::number(_resumeOffset) + '-');
+    }
     _pDownloadReply = ApiNetwork::instance()->getAccessManager().get(downloadReq);
     _pDownloadReply->setParent(this);
+    _pDownloadReply->setReadBufferSize(downloadReadBufferSize);
     _pDownloadTask = Async<DownloadResult>::create();
     _downloadingVersion = availableUpdate.version();
 
@@ -537,10 +607,14 @@ Async<DownloadResult> UpdateDownloader::downloadUpdate()
     // with the error "HostNotFoundError"
     connect(_pDownloadReply, &QNetworkReply::downloadProgress, this,
             &UpdateDownloader::onDownloadProgress);
+    connect(_pDownloadReply, &QNetworkReply::metaDataChanged, this,
+            &UpdateDownloader::onDownloadMetaDataChanged);
     connect(_pDownloadReply, &QIODevice::readyRead, this,
             &UpdateDownloader::onDownloadReadyRead);
     connect(_pDownloadReply, &QNetworkReply::finished, this,
             &UpdateDownloader::onDownloadFinished);
+    _throttleBudget = downloadRateLimit * throttleInterval.count() / 1000;
+    _throttleTimer.start();
     emit downloadProgress(_downloadingVersion, 0);
 
     return _pDownloadTask;
@@ -586,23 +660,90 @@ void UpdateDownloader::onDownloadProgress(qint64 bytesReceived,
     // This signal can be emitted with bytesTotal == 0 if the download fails
     // before getting the content length from the server (or presumably if the
     // file isn't found, etc.).
+    // When resuming, the reply only covers the rest of the file.
     int progressPct = 0;
     if(bytesTotal > 0 && bytesReceived >= 0)
-        progressPct = static_cast<int>(bytesReceived * 100 / bytesTotal);
+    {
+        progressPct = static_cast<int>((_resumeOffset + bytesReceived) * 100 /
+                                       (_resumeOffset + bytesTotal));
+    }
     emit downloadProgress(_downloadingVersion, progressPct);
 }
 
-void UpdateDownloader::onDownloadReadyRead()
+void UpdateDownloader::onDownloadMetaDataChanged()
 {
     // Class invariant - valid when this signal is connected
     Q_ASSERT(_pDownloadReply);
+
+    if(_resumeOffset <= 0)
+        return;
+
+    int status = _pDownloadReply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt();
+    if(status == 206)
+    {
+        // Make sure the server is sending the part we asked for
+        QByteArray expectedRange = QByteArrayLiteral("bytes ") +
+            QByteArray::number(_resumeOffset) + '-';
+        if(!_pDownloadReply->rawHeader(QByteArrayLiteral("Content-Range")).startsWith(expectedRange))
+        {
+            qWarning() << "Can't resume installer download, server returned range"
+                << _pDownloadReply->rawHeader(QByteArrayLiteral("Content-Range"));
+            _pDownloadReply->abort();
+        }
+        return;
+    }
+
+    // The server ignored the Range header and is sending the whole file, start
+    // over.  (Nothing has been read from the reply yet, this signal precedes
+    // readyRead().)
+    qInfo() << "Server did not resume installer download (status" << status
+        << "), downloading whole file";
+    _resumeOffset = 0;
+    _installerHash.reset();
+    if(!_installerFile.resize(0))
+    {
+        qError() << "Failed to truncate installer file"
+            << _installerFile.fileName() << "-" << _installerFile.error();
+        _pDownloadReply->abort();
+    }
+}
+
+void UpdateDownloader::onDownloadReadyRead()
+{
+    readDownloadData(false);
+}
+
+void UpdateDownloader::throttleTimerElapsed()
+{
+    // Don't accumulate budget while the download is idle, so it can't burst
+    // above the limit later
+    _throttleBudget = downloadRateLimit * throttleInterval.count() / 1000;
+    if(_pDownloadReply)
+        readDownloadData(false);
+}
+
+void UpdateDownloader::readDownloadData(bool ignoreThrottle)
+{
+    // Class invariant - valid when this is called
+    Q_ASSERT(_pDownloadReply);
     // Class invariant - file open when _pDownloadReply is set
     Q_ASSERT(_installerFile.isOpen());
 
-    // Write the new data to the file.
+    qint64 readSize = _pDownloadReply->bytesAvailable();
+    if(!ignoreThrottle)
+        readSize = std::min(readSize, _throttleBudget);
+    if(readSize <= 0)
+        return;
+
+    // Write the new data to the file, and hash it as it arrives so the hash is
+    // ready as soon as the download finishes.
     // QIODevice doesn't provide any way to observe the new data without copying
     // it, so we make a copy here just to write it and throw the copy away.
-    if(_installerFile.write(_pDownloadReply->readAll()) < 0)
+    QByteArray data = _pDownloadReply->read(readSize);
+    if(!ignoreThrottle)
+        _throttleBudget -= data.size();
+    _installerHash.addData(data);
+    if(_installerFile.write(data) < 0)
     {
         // The write failed, cancel the download by aborting the network
         // request.  This will cause onDownloadFinished() to be called with an
@@ -629,6 +770,11 @@ void UpdateDownloader::onDownloadFinished()
     // Class invariant - set when _pDownloadReply is set
     Q_ASSERT(!_downloadingVersion.isEmpty());
 
+    _throttleTimer.stop();
+    // Write any data that's still buffered due to throttling
+    if(_pDownloadReply->error() == QNetworkReply::NetworkError::NoError)
+        readDownloadData(true);
+
     // Delete the reply when we're done here
     _pDownloadReply->deleteLater();
     _installerFile.close();
@@ -651,13 +797,23 @@ void UpdateDownloader::onDownloadFinished()
         qInfo() << "Installer download of" << finishedVersion << "from"
             << pFinishedReply->url() << "failed with error:"
             << qEnumToString(error);
-        // Delete the partial file - failure is ignored
-        _installerFile.remove();
         // 'OperationCanceledError' indicates that the user canceled the
         // download (we only call abort() due to a user cancellation).
         bool dueToError = error != QNetworkReply::NetworkError::OperationCanceledError;
         dueToError = _downloadTimedOut ? true : dueToError;
         _downloadTimedOut = false;
+        // If the connection was interrupted (network and proxy errors, or
+        // timeouts), keep the partial file so the download can be resumed.
+        // Otherwise, delete it - failure is ignored
+        if(dueToError && error < QNetworkReply::NetworkError::ContentAccessDenied &&
+            _installerFile.size() > 0)
+        {
+            qInfo() << "Keeping" << _installerFile.size()
+                << "bytes of partial download to resume later";
+            _partialDownloadUrl = pFinishedReply->request().url();
+        }
+        else
+            _installerFile.remove();
         emit downloadFailed(finishedVersion, dueToError);
         // The result is an error if we detected an error above, canceled
         // otherwise.
@@ -666,6 +822,11 @@ void UpdateDownloader::onDownloadFinished()
     else
     {
         // Otherwise, we're done, the download succeeded
+        _completedDownloadUrl = pFinishedReply->request().url();
+        _completedDownloadHash = _installerHash.result();
+        qInfo() << "Downloaded installer" << finishedVersion << "-"
+            << _installerFile.size() << "bytes, SHA-256"
+            << _completedDownloadHash.toHex();
 #ifdef Q_OS_LINUX
         // Add the executable bit on Linux so the client can execute the
         // downloaded installer.
@@ -30,6 +30,7 @@
 #include <QObject>
 #include <QJsonDocument>
 #include <QNetworkAccessManager>
+#include <QCryptographicHash>
 #include <QFile>
 #include <QPointer>
 #include <QSslKey>
@@ -265,8 +266,14 @@ public:
 private:
     void downloadTimerElapsed();
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void onDownloadMetaDataChanged();
     void onDownloadReadyRead();
     void onDownloadFinished();
+    void throttleTimerElapsed();
+    // Read data from the download reply and write it to the installer file,
+    // up to the current throttle budget (or all available data if
+    // ignoreThrottle is set).
+    void readDownloadData(bool ignoreThrottle);
     bool validateOSRequirements(const QString &requirement) const;
 
 signals:
@@ -319,6 +326,26 @@ private:
     // When this timer finishes, too much time has passed since the onDownloadProgress()
     // call. The download is aborted.
     QTimer _progressTimer;
+    // SHA-256 of the installer data written so far (including any data from
+    // an interrupted download that's being resumed)
+    QCryptographicHash _installerHash;
+    // The URL and SHA-256 of the last installer downloaded completely.  If the
+    // same URL is requested again and the file is unchanged, it's used again
+    // instead of downloading it again.
+    QUrl _completedDownloadUrl;
+    QByteArray _completedDownloadHash;
+    // If a download was interrupted by a network error, the URL that was being
+    // downloaded.  The partial file is kept, and if the same URL is downloaded
+    // again, it resumes with a Range request.
+    QUrl _partialDownloadUrl;
+    // The offset the current download resumed from, or 0 if it started from
+    // the beginning
+    qint64 _resumeOffset;
+    // Update downloads are throttled so they don't compete with user traffic.
+    // This is the number of bytes that can be read from the reply until the
+    // throttle timer elapses again.
+    qint64 _throttleBudget;
+    QTimer _throttleTimer;
 };
 
 #endif
@@ -20,6 +20,7 @@
 #line SOURCE_FILE("vpn.cpp")
 
 #include "vpn.h"
+#include <common/src/wakeupaccounting.h>
 #include "vpnmethod.h"
 #include "daemon.h"
 #include <common/src/exec.h>
@@ -46,6 +47,8 @@
 #include <arpa/inet.h>
 #include <net/if.h>
 #include <unistd.h>
+#include <grp.h>
+#include <sys/stat.h>
 #elif defined(Q_OS_WIN)
 #include "win/win.h"
 #endif
@@ -66,6 +69,10 @@ namespace
 {
     // Maximum number of measurements in _intervalMeasurements
     const std::size_t g_maxMeasurementIntervals{32};
+    // Maximum number of phases in _connectionTimeline.  A connection sequence
+    // that keeps failing records around 10 phases per attempt, so this keeps
+    // the last several attempts.
+    const std::size_t g_maxTimelinePhases{128};
 
     // This seed is run by PIA Ops, this is used in addition to hnsd's
     // hard-coded seeds.  It has a static IP address but it's also resolvable
@@ -90,6 +97,9 @@ namespace
     const RestartStrategy::Params shadowsocksRestart{std::chrono::milliseconds(100),
                                                      std::chrono::seconds(5),
                                                      std::chrono::seconds(5)};
+    // ss-local is kept running this long after disconnecting (or after
+    // starting it ahead of time), in case the next connection uses it
+    const std::chrono::minutes shadowsocksIdleTimeout{2};
 
     // Sync timeout for hnsd.  This should be shorter than the "successful" time
     // in the RestartStrategy, so the warning doesn't flap if hnsd fails for a
@@ -99,6 +109,23 @@ namespace
     // Timeout for preferred transport before starting to try alternate transports
     const std::chrono::seconds preferredTransportTimeout{30};
 
+    // Up to this many servers are raced before each connection attempt,
+    // including the server chosen by TransportSelector.
+    const std::size_t maxProbeCandidates{4};
+    // If no server responds to the race in this time, the attempt uses the
+    // chosen server anyway.
+    const std::chrono::milliseconds serverProbeTimeout{1500};
+    // Interval to probe for a warm standby server while connected (when
+    // enabled)
+    const std::chrono::minutes standbyProbeInterval{1};
+    // While disconnected, the next location's servers are raced again this
+    // often, and shortly after the next connection config changes (several
+    // inputs tend to change together).  The first connection attempt uses the
+    // result if it's no older than planMaxAge.
+    const std::chrono::minutes planRefreshInterval{2};
+    const std::chrono::seconds planChangeDelay{2};
+    const std::chrono::minutes planMaxAge{3};
+
     // Maximum time between bytecount intervals, if the interval exceeds this
     // limit we abandon the connection.  This is intended to detect waking from
     // sleep; see updateByteCounts()
@@ -108,6 +135,56 @@ namespace
     // ConnectionConfig::ConnectionConfig()
     const int dipUsernameRandSuffixChars{8};
 
+    // Check whether a server can be used for a connection with the given VPN
+    // method and the transport selected by TransportSelector.  For OpenVPN,
+    // the server must have the selected port; for WireGuard, the transport is
+    // vestigial, and any WireGuard server will do.
+    bool serverUsableForTransport(const Server &server,
+                                  ConnectionConfig::Method method,
+                                  const Transport &transport)
+    {
+        if(method == ConnectionConfig::Method::Wireguard)
+            return server.hasService(Service::WireGuard);
+        Service service = transport.protocol() == QStringLiteral("tcp") ?
+            Service::OpenVpnTcp : Service::OpenVpnUdp;
+        return server.hasPort(service, transport.port());
+    }
+
+    // TCP transports can be probed with a real connection to the OpenVPN
+    // port.  UDP transports are probed with ICMP, since the servers do not
+    // answer unauthenticated datagrams.
+    ServerProbeTask::ProbeMethod probeMethodForTransport(ConnectionConfig::Method method,
+                                                         const Transport &transport)
+    {
+        if(method == ConnectionConfig::Method::OpenVPN &&
+           transport.protocol() == QStringLiteral("tcp"))
+        {
+            return ServerProbeTask::ProbeMethod::Tcp;
+        }
+        return ServerProbeTask::ProbeMethod::Icmp;
+    }
+
+    // The transport TransportSelector tries first for a connection config.
+    // Port 0 means the default port of each server.
+    Transport preferredTransport(const ConnectionConfig &config)
+    {
+        return {config.openvpnProtocol() == ConnectionConfig::Protocol::TCP ?
+                    QStringLiteral("tcp") : QStringLiteral("udp"),
+                config.openvpnRemotePort()};
+    }
+
+    // Whether a connection plan computed for planConfig can be used to
+    // connect with config
+    bool planApplies(const ConnectionConfig &planConfig,
+                     const ConnectionConfig &config)
+    {
+        return planConfig.vpnLocation() && config.vpnLocation() &&
+            planConfig.vpnLocation()->id() == config.vpnLocation()->id() &&
+            planConfig.method() == config.method() &&
+            planConfig.proxyType() == config.proxyType() &&
+            preferredTransport(planConfig) == preferredTransport(config);
+    }
+
     [[maybe_unused]] kapps::core::ConfigWriter &operator<<(kapps::core::ConfigWriter &w, const QString &str)
     {
         w << str.toStdString();
@@ -116,7 +193,8 @@ namespace
 }
 
 ResolverRunner::ResolverRunner(RestartStrategy::Params restartParams)
-    : ProcessRunner{std::move(restartParams)}, _activeResolver{Resolver::Unbound}
+    : ProcessRunner{std::move(restartParams)}, _activeResolver{Resolver::Unbound},
+      _hnsdHeight{0}
 {
     setObjectName(QStringLiteral("resolver"));
 
@@ -135,17 +213,29 @@ ResolverRunner::ResolverRunner(RestartStrategy::Params restartParams)
     connect(this, &ProcessRunner::stdoutLine, this,
             [this](const QByteArray &line)
             {
-                if(_activeResolver == Resolver::Handshake && line.contains(QByteArrayLiteral(" new height: ")))
+                const QByteArray heightPrefix{QByteArrayLiteral(" new height: ")};
+                int heightPos = line.indexOf(heightPrefix);
+                if(_activeResolver == Resolver::Handshake && heightPos >= 0)
                 {
                     // At least 1 block has been synced, handshake is connected.
                     _hnsdSyncTimer.stop();
                     emit hnsdSyncFailure(false);
 
-                    // We just want to show some progress of hnsd's sync in the log.
-                    // Qt regexes don't work on byte arrays but this check works
-                    // well enough to trace every 1000 blocks.
-                    if(line.endsWith(QByteArrayLiteral("000")))
+                    // We just want to show some progress of hnsd's sync in the
+                    // log and state.  Qt regexes don't work on byte arrays but
+                    // this check works well enough to trace every 1000 blocks.
+                    // Also report the first block after starting, which
+                    // indicates that DNS is ready.
+                    if(_hnsdHeight == 0 || line.endsWith(QByteArrayLiteral("000")))
+                    {
                         qInfo() << objectName() << "-" << line.data();
+                        qint64 height = line.mid(heightPos + heightPrefix.size()).trimmed().toLongLong();
+                        if(height > 0)
+                        {
+                            _hnsdHeight = height;
+                            emit hnsdSyncHeight(_hnsdHeight);
+                        }
+                    }
                 }
             });
     // We never clear hnsdSyncFailure() when hnsd starts / stops / restarts.  We
@@ -156,9 +246,14 @@ ResolverRunner::ResolverRunner(RestartStrategy::Params restartParams)
     connect(this, &ProcessRunner::started, this,
             [this]()
             {
-                // For handshake, start (or restart) the sync timer.
+                // For handshake, start (or restart) the sync timer.  Report
+                // the height again once hnsd loads its chain and syncs a
+                // block.
                 if(_activeResolver == Resolver::Handshake)
+                {
+                    _hnsdHeight = 0;
                     _hnsdSyncTimer.start();
+                }
             });
     // 'succeeded' means that the process has been running for long enough that
     // ProcessRunner considers it successful.  It hasn't necessarily synced any
@@ -201,10 +296,39 @@ bool ResolverRunner::enable(Resolver resolver, QStringList arguments)
 #ifdef Q_OS_MACOS
     Exec::cmd(QStringLiteral("ifconfig"), {"lo0", "alias", ::resolverLocalAddress(), "up"});
 #endif
+    // hnsd keeps its chain state in the data directory, so it only has to
+    // sync the headers it missed since it last ran
+    if(resolver == Resolver::Handshake)
+    {
+        prepareHnsdDataDir();
+        arguments << QStringLiteral("--prefix") << QString{Path::HnsdDataDir};
+    }
     // Invoke the original
     return ProcessRunner::enable(getResolverExecutable(), std::move(arguments));
 }
 
+void ResolverRunner::prepareHnsdDataDir()
+{
+    Path::HnsdDataDir.mkpath();
+#ifdef Q_OS_UNIX
+    // hnsd runs with the resolver group (and on Linux, possibly as 'nobody'),
+    // so it needs group write access to its data directory
+    struct group *gr = getgrnam(BRAND_CODE "hnsd");
+    if(!gr)
+    {
+        qWarning() << "Group" << BRAND_CODE "hnsd" << "does not exist, hnsd may not be able to write"
+            << Path::HnsdDataDir;
+        return;
+    }
+    if(chown(qUtf8Printable(Path::HnsdDataDir), 0, gr->gr_gid) ||
+       chmod(qUtf8Printable(Path::HnsdDataDir), 0770))
+    {
+        qWarning().nospace() << "Unable to set permissions on " << Path::HnsdDataDir
+            << " (" << errno << ": " << qt_error_string(errno) << ")";
+    }
+#endif
+}
+
 void ResolverRunner::disable()
 {
     // Invoke the original
@@ -213,6 +337,11 @@ void ResolverRunner::disable()
     // Not syncing or failing to sync since hnsd is no longer enabled.
     _hnsdSyncTimer.stop();
     emit hnsdSyncFailure(false);
+    if(_hnsdHeight != 0)
+    {
+        _hnsdHeight = 0;
+        emit hnsdSyncHeight(0);
+    }
 
 #ifdef Q_OS_MACOS
     QString out = Exec::cmdWithOutput(QStringLiteral("ifconfig"), {QStringLiteral("lo0")});
@@ -260,7 +389,8 @@ ShadowsocksRunner::ShadowsocksRunner(RestartStrategy::Params restartParams)
             _localPort = line.mid(pos + marker.length()).toUShort();
             if(_localPort)
             {
-                qInfo() << objectName() << "assigned port:" << _localPort;
+                qInfo() << objectName() << "assigned port:" << _localPort
+                    << "after" << traceMsec(_startElapsed.elapsed());
                 emit localPortAssigned();
             }
             else
@@ -277,12 +407,20 @@ ShadowsocksRunner::ShadowsocksRunner(RestartStrategy::Params restartParams)
     {
         qInfo() << objectName() << "started, waiting for local port";
         _localPort = 0;
+        _startElapsed.start();
     });
 }
 
-bool ShadowsocksRunner::enable(QString program, QStringList arguments)
+bool ShadowsocksRunner::enable(const Server &server)
 {
-    if(ProcessRunner::enable(std::move(program), std::move(arguments)))
+    _serverIp = server.ip();
+    if(ProcessRunner::enable(Path::SsLocalExecutable,
+        QStringList{QStringLiteral("-s"), server.ip(),
+                    QStringLiteral("-p"), QString::number(server.defaultServicePort(Service::Shadowsocks)),
+                    QStringLiteral("-k"), server.shadowsocksKey(),
+                    QStringLiteral("-b"), QStringLiteral("127.0.0.1"),
+                    QStringLiteral("-l"), QStringLiteral("0"),
+                    QStringLiteral("-m"), server.shadowsocksCipher()}))
     {
         // Wipe the local port since the process is being restarted; doConnect()
         // will wait for the next process startup rather than attempting a
@@ -327,7 +465,7 @@ TransportSelector::TransportSelector()
 TransportSelector::TransportSelector(const std::chrono::seconds &transportTimeout)
     : _selected{QStringLiteral("udp"), 0},
       _lastPreferred{QStringLiteral("udp"), 0},
-      _lastUsed{QStringLiteral("udp"), 0}, _alternates{},
+      _lastUsed{QStringLiteral("udp"), 0},
       _nextAlternate{0}, _startAlternates{-1}, _transportTimeout{transportTimeout},
       _serverIndex{0},
       _triedAllServers{false}
@@ -337,18 +475,17 @@ TransportSelector::TransportSelector(const std::chrono::seconds &transportTimeou
 void TransportSelector::addAlternates(const QString &protocol,
                                       const DescendingPortSet &ports)
 {
-    Transport nextTransport{protocol, 0};
+    bool selectedProtocol = _selected.protocol() == protocol;
 
     // Add the implicit default port (although this may be the same as one of
     // the listed ports)
-    if(_selected != nextTransport)
-        _alternates.emplace_back(nextTransport);
+    if(!selectedProtocol || _selected.port() != 0)
+        _alternates.push_back({protocol, 0});
 
     for(quint16 port : ports)
     {
-        nextTransport.port(port);
-        if(_selected != nextTransport)
-            _alternates.emplace_back(nextTransport);
+        if(!selectedProtocol || _selected.port() != port)
+            _alternates.push_back({protocol, port});
     }
 }
 
@@ -492,7 +629,9 @@ const Server *TransportSelector::beginAttempt(const Location &location,
         // Try the next alternate
         if(_nextAlternate >= _alternates.size())
             _nextAlternate = 0;
-        _lastUsed = _alternates[_nextAlternate];
+        const Alternate &alternate = _alternates[_nextAlternate];
+        _lastUsed.protocol(alternate.protocol);
+        _lastUsed.port(alternate.port);
         ++_nextAlternate;
         _useAlternateNext = false;
     }
@@ -650,6 +789,7 @@ ConnectionConfig::ConnectionConfig(DaemonSettings &settings, StateModel &state,
     if(_method == Method::OpenVPN)
     {
         _openvpnCipher = settings.cipher();
+        _openvpnPerformanceProfile = settings.openvpnPerformanceProfile();
         if(settings.windowsIpMethod() == QStringLiteral("wintun"))
             _openvpnUseWintun = true; // WinTUN; IP method does not apply
         else if(settings.windowsIpMethod() == QStringLiteral("static"))
@@ -699,7 +839,10 @@ ConnectionConfig::ConnectionConfig(DaemonSettings &settings, StateModel &state,
     }
     // Capture WireGuard-specific settings
     else if(_method == Method::Wireguard)
+    {
         _wireguardUseKernel = settings.wireguardUseKernel();
+        _wireguardGoHighThroughput = settings.wireguardGoHighThroughput();
+    }
 
     // The port forwarding setting is more complex, because changes are
     // applied on the fly in some cases, but require reconnects in others.
@@ -799,9 +942,11 @@ bool ConnectionConfig::hasChanged(const ConnectionConfig &other) const
         openvpnCipher() != other.openvpnCipher() ||
         openvpnUseWintun() != other.openvpnUseWintun() ||
         openvpnUseStaticTapConfig() != other.openvpnUseStaticTapConfig() ||
+        openvpnPerformanceProfile() != other.openvpnPerformanceProfile() ||
         openvpnProtocol() != other.openvpnProtocol() ||
         openvpnRemotePort() != other.openvpnRemotePort() ||
         wireguardUseKernel() != other.wireguardUseKernel() ||
+        wireguardGoHighThroughput() != other.wireguardGoHighThroughput() ||
         mtu() != other.mtu() ||
         automaticTransport() != other.automaticTransport() ||
         dnsType() != other.dnsType() ||
@@ -853,12 +998,34 @@ VPNConnection::VPNConnection(QObject* parent)
     , _lastSentByteCount(0)
     , _lastBytecountTime{}
     , _needsReconnect(false)
+    , _probeServers{true}
+    , _pWireguardPreauth{std::make_shared<WireguardPreauth>()}
+    , _pWireguardHandoff{std::make_shared<WireguardHandoff>()}
 {
     _shadowsocksRunner.setObjectName("shadowsocks");
 
+    _shadowsocksIdleTimer.setSingleShot(true);
+    _shadowsocksIdleTimer.setInterval(msec(shadowsocksIdleTimeout));
+    connect(&_shadowsocksIdleTimer, &QTimer::timeout, this, [this]()
+    {
+        if(_state == State::Disconnected && _shadowsocksRunner.isEnabled())
+        {
+            qInfo() << "Stopping Shadowsocks proxy, unused for"
+                << traceMsec(shadowsocksIdleTimeout);
+            _shadowsocksRunner.disable();
+        }
+    });
+
     _connectTimer.setSingleShot(true);
     connect(&_connectTimer, &QTimer::timeout, this, &VPNConnection::beginConnection);
 
+    _standbyTimer.setInterval(msec32(standbyProbeInterval));
+    tagWakeups(_connectTimer, QByteArrayLiteral("vpnconnection"));
+    tagWakeups(_standbyTimer, QByteArrayLiteral("vpnconnection"));
+    tagWakeups(_planTimer, QByteArrayLiteral("vpnconnection"));
+    connect(&_standbyTimer, &QTimer::timeout, this, &VPNConnection::probeStandby);
+    connect(&_planTimer, &QTimer::timeout, this, &VPNConnection::probePlan);
+
     connect(&_resolverRunner, &ResolverRunner::resolverSucceeded, this,
         [this](ResolverRunner::Resolver _resolver)
         {
@@ -876,6 +1043,7 @@ VPNConnection::VPNConnection(QObject* parent)
                 emit unboundFailed(failureDuration);
         });
     connect(&_resolverRunner, &ResolverRunner::hnsdSyncFailure, this, &VPNConnection::hnsdSyncFailure);
+    connect(&_resolverRunner, &ResolverRunner::hnsdSyncHeight, this, &VPNConnection::hnsdSyncHeight);
 
     // The succeeded/failed signals from _shadowsocksRunner are ignored.  It
     // rarely fails, particularly since it does not do much of anything until we
@@ -896,8 +1064,14 @@ VPNConnection::VPNConnection(QObject* parent)
         {
             qInfo() << "Shadowsocks proxy assigned local port"
                 << _shadowsocksRunner.localPort() << "- continue connecting";
+            recordPhase(QStringLiteral("proxyReady"));
             doConnect();
         }
+        else if(_state == State::Disconnected)
+        {
+            qInfo() << "Shadowsocks proxy assigned local port"
+                << _shadowsocksRunner.localPort() << "for the next connection";
+        }
         else
         {
             qWarning() << "Shadowsocks proxy assigned local port"
@@ -992,6 +1166,84 @@ void VPNConnection::updateNetwork(const OriginalNetworkScan &newNetwork)
 {
     if(_method)
         _method->updateNetwork(newNetwork);
+
+    // A planned server was raced on the old network; race again on this one
+    if(_planTimer.isActive())
+    {
+        _plannedServer.clear();
+        _pPlanProbeTask.abandon();
+        _planTimer.start(msec32(planChangeDelay));
+    }
+}
+
+void VPNConnection::updatePlan(const ConnectionConfig &nextConfig)
+{
+    // If the next connection uses Shadowsocks, start ss-local now so the
+    // connection doesn't have to wait for it
+    if(_state == State::Disconnected && g_daemon->isActive() &&
+       nextConfig.proxyType() == ConnectionConfig::ProxyType::Shadowsocks &&
+       nextConfig.shadowsocksLocation())
+    {
+        const Server *pSsServer = selectShadowsocksServer(*nextConfig.shadowsocksLocation());
+        if(pSsServer && !pSsServer->shadowsocksKey().isEmpty() &&
+           !pSsServer->shadowsocksCipher().isEmpty())
+        {
+            if(_shadowsocksRunner.serverIp() != pSsServer->ip())
+                qInfo() << "Starting Shadowsocks proxy for" << pSsServer->ip() << "ahead of time";
+            _shadowsocksRunner.enable(*pSsServer);
+            _shadowsocksIdleTimer.start();
+        }
+    }
+
+    if(_state != State::Disconnected ||
+       !g_settings.enableBackgroundLatencyChecks() ||
+       !nextConfig.vpnLocation() ||
+       nextConfig.proxyType() != ConnectionConfig::ProxyType::None)
+    {
+        // Stop planning, but keep a planned server when leaving the
+        // Disconnected state; the first connection attempt may use it.
+        if(_state == State::Disconnected)
+            clearPlan();
+        else
+        {
+            _planTimer.stop();
+            _pPlanProbeTask.abandon();
+        }
+        return;
+    }
+
+    if(_planTimer.isActive() && planApplies(_planConfig, nextConfig))
+        return;
+
+    _planConfig = nextConfig;
+    _plannedServer.clear();
+    _pPlanProbeTask.abandon();
+    _planTimer.start(msec32(planChangeDelay));
+}
+
+const Server *VPNConnection::selectShadowsocksServer(const Location &location) const
+{
+    // Keep the server ss-local is already running for if it's still in this
+    // location.  After a failed attempt, pick randomly again in case that
+    // server was the problem.
+    const QString runningIp = _shadowsocksRunner.serverIp();
+    if(!runningIp.isEmpty() && _connectionAttemptCount == 0)
+    {
+        for(const auto &server : location.servers())
+        {
+            if(server.ip() == runningIp && server.hasService(Service::Shadowsocks))
+                return &server;
+        }
+    }
+    return location.randomServerForService(Service::Shadowsocks);
+}
+
+void VPNConnection::clearPlan()
+{
+    _planTimer.stop();
+    _pPlanProbeTask.abandon();
+    _planConfig = {};
+    _plannedServer.clear();
 }
 
 bool VPNConnection::connectVPN(bool force)
@@ -1005,8 +1257,18 @@ bool VPNConnection::connectVPN(bool force)
             return false;
 
         // Otherwise, change to DisconnectingToReconnect
+        startTimeline(QStringLiteral("connectVPN"));
         copySettings(State::DisconnectingToReconnect, State::Disconnecting);
 
+        // When switching between WireGuard servers, keep the interface up for
+        // the next connection
+        if(g_settings.wireguardSeamlessSwitch() &&
+           _connectedConfig.method() == ConnectionConfig::Method::Wireguard &&
+           _connectingConfig.method() == ConnectionConfig::Method::Wireguard)
+        {
+            _pWireguardHandoff->expectSwitch();
+        }
+
         Q_ASSERT(_method); // Valid in this state
         _method->shutdown();
         return true;
@@ -1016,6 +1278,7 @@ bool VPNConnection::connectVPN(bool force)
         if (!force && !needsReconnect())
             return false;   // Still in same connection attempt
         // fallthrough
+        startTimeline(QStringLiteral("connectVPN"));
         if (_method)
         {
             _method->shutdown();
@@ -1051,6 +1314,7 @@ bool VPNConnection::connectVPN(bool force)
         qWarning() << "Connecting in unhandled state " << _state;
         // fallthrough
     case State::Disconnected:
+        startTimeline(QStringLiteral("connectVPN"));
         updateAttemptCount(0);
         _connectedConfig = {};
         _connectedServer = {};
@@ -1076,9 +1340,27 @@ void VPNConnection::disconnectVPN()
     }
 }
 
+void VPNConnection::disconnectForSleep()
+{
+    if(_state == State::Connected && g_settings.wireguardFastResume() &&
+       _connectedConfig.method() == ConnectionConfig::Method::Wireguard)
+    {
+        _pWireguardHandoff->expectResume();
+    }
+    disconnectVPN();
+}
+
+void VPNConnection::discardResume()
+{
+    if(_pWireguardHandoff->parkedForResume())
+        _pWireguardHandoff->discard();
+}
+
 void VPNConnection::beginConnection()
 {
+    _pServerProbeTask.abandon();
     _connectionStep = ConnectionStep::Initializing;
+    recordPhase(QStringLiteral("beginConnection"));
     doConnect();
 }
 
@@ -1144,8 +1426,11 @@ void VPNConnection::doConnect()
         // Do we need to fetch the non-VPN IP address?  Do this for the first
         // connection attempt (which resets if the network connection changes).
         // However, we can't do it at all if we're reconnecting, because the
-        // killswitch blocks DNS resolution.
-        if(_connectionAttemptCount == 0 && _state == State::Connecting)
+        // killswitch blocks DNS resolution.  It's also skipped when resuming
+        // after sleep - the interface kept to resume still routes everything
+        // into the tunnel, and the IP was known before sleeping.
+        if(_connectionAttemptCount == 0 && _state == State::Connecting &&
+           !_pWireguardHandoff->parkedForResume())
         {
             // We only get one shot at this, clear the connection cache to make
             // sure we're not reusing an old bogus connection.  We're about to
@@ -1156,12 +1441,13 @@ void VPNConnection::doConnect()
             // not connected, since we don't use a proxy, so if the network
             // changes it might otherwise take ~2 minutes for stale connections
             // to die.
-            ApiNetwork::instance()->getAccessManager().clearConnectionCache();
+            ApiNetwork::instance()->clearConnectionCache();
 
             // Usually the external IP refresher has already found an IP by this
             // point.  If it hasn't, give it a chance to find it before we
             // connect, this often applies when "connect on launch" is enabled
             // in the client.
+            recordPhase(QStringLiteral("fetchingIp"));
             _pExternalIpTask.abandon();
             g_daemon->forcePublicIpRefresh();
             _pExternalIpTask = Async<ExternalIpTask>::create()
@@ -1187,7 +1473,7 @@ void VPNConnection::doConnect()
         _shadowsocksServerIp = {};
         const Server *pSsServer{nullptr};
         if(_connectingConfig.shadowsocksLocation())
-            pSsServer = _connectingConfig.shadowsocksLocation()->randomServerForService(Service::Shadowsocks);
+            pSsServer = selectShadowsocksServer(*_connectingConfig.shadowsocksLocation());
         // randomServerForService() ensures that a returned server has the
         // Shadowsocks service and at least one port, but it does not verify
         // that we have an SS key and cipher
@@ -1210,13 +1496,10 @@ void VPNConnection::doConnect()
                 return;
             }
 
-            _shadowsocksRunner.enable(Path::SsLocalExecutable,
-                QStringList{QStringLiteral("-s"), pSsServer->ip(),
-                            QStringLiteral("-p"), QString::number(pSsServer->defaultServicePort(Service::Shadowsocks)),
-                            QStringLiteral("-k"), pSsServer->shadowsocksKey(),
-                            QStringLiteral("-b"), QStringLiteral("127.0.0.1"),
-                            QStringLiteral("-l"), QStringLiteral("0"),
-                            QStringLiteral("-m"), pSsServer->shadowsocksCipher()});
+            _shadowsocksIdleTimer.stop();
+            _shadowsocksRunner.enable(*pSsServer);
+
+            recordPhase(QStringLiteral("startingProxy"));
 
             // If we don't already know a listening port, wait for it to tell
             // us (we could already know if the SS client was already running)
@@ -1232,7 +1515,10 @@ void VPNConnection::doConnect()
             }
         }
         else    // Not using Shadowsocks
+        {
+            _shadowsocksIdleTimer.stop();
             _shadowsocksRunner.disable();
+        }
     }
 
     // We either finished starting a proxy or we skipped it.  We're ready to connect
@@ -1265,6 +1551,8 @@ void VPNConnection::doConnect()
                                  _connectingConfig.automaticTransport(),
                                  _connectingConfig.vpnLocation()->allPortsForService(Service::OpenVpnUdp),
                                  _connectingConfig.vpnLocation()->allPortsForService(Service::OpenVpnTcp));
+        _attemptedServerIps.clear();
+        _probeServers = true;
     }
 
     // Reset traffic counters since we have a new process
@@ -1306,6 +1594,71 @@ void VPNConnection::doConnect()
         }
     }
 
+    // After losing a connection, go straight to the warm standby server if we
+    // have one, instead of retrying the server that was lost.  It was probed
+    // recently, so it isn't raced again.
+    bool alreadyProbed{false};
+    if(_standbyServer && pVpnServer && _state == State::Reconnecting &&
+       _connectionAttemptCount == 0)
+    {
+        for(const auto &server : _connectingConfig.vpnLocation()->servers())
+        {
+            if(server.ip() == _standbyServer->ip() &&
+               serverUsableForTransport(server, _connectingConfig.method(),
+                                        _transportSelector.lastUsed()))
+            {
+                qInfo() << "Reconnecting to standby server" << server.ip();
+                pVpnServer = &server;
+                alreadyProbed = true;
+                break;
+            }
+        }
+    }
+    _standbyServer.clear();
+
+    // After waking from sleep, go back to the server of the interface kept to
+    // resume the connection, so it can be resumed with the same key
+    QString resumeServerIp = _pWireguardHandoff->resumeServerIp();
+    if(!alreadyProbed && !resumeServerIp.isEmpty() && pVpnServer &&
+       _state == State::Connecting && _connectionAttemptCount == 0 &&
+       _connectingConfig.method() == ConnectionConfig::Method::Wireguard)
+    {
+        for(const auto &server : _connectingConfig.vpnLocation()->servers())
+        {
+            if(server.ip() == resumeServerIp &&
+               serverUsableForTransport(server, _connectingConfig.method(),
+                                        _transportSelector.lastUsed()))
+            {
+                qInfo() << "Resuming connection to server" << server.ip();
+                pVpnServer = &server;
+                alreadyProbed = true;
+                break;
+            }
+        }
+    }
+
+    // Similarly, the first attempt of a new connection can use the server
+    // planned while disconnected, if the plan is still fresh.
+    if(!alreadyProbed && _plannedServer && pVpnServer &&
+       _state == State::Connecting && _connectionAttemptCount == 0 &&
+       planApplies(_planConfig, _connectingConfig) &&
+       _plannedServerAge.isValid() && !_plannedServerAge.hasExpired(msec(planMaxAge)))
+    {
+        for(const auto &server : _connectingConfig.vpnLocation()->servers())
+        {
+            if(server.ip() == _plannedServer->ip() &&
+               serverUsableForTransport(server, _connectingConfig.method(),
+                                        _transportSelector.lastUsed()))
+            {
+                qInfo() << "Connecting to planned server" << server.ip();
+                pVpnServer = &server;
+                alreadyProbed = true;
+                break;
+            }
+        }
+    }
+    _plannedServer.clear();
+
     // Set when the next earliest reconnect attempt is allowed
     if(delayNext)
     {
@@ -1336,14 +1689,239 @@ void VPNConnection::doConnect()
     }
 
     _connectingServer = *pVpnServer;
+    recordPhase(QStringLiteral("serverSelected"));
+
+    // Race the other servers in this location against the selected one; if a
+    // probe starts, the VPN method is started when it finishes.
+    if(alreadyProbed)
+        _attemptedServerIps.insert(pVpnServer->ip());
+    if(alreadyProbed || !probeServers(*pVpnServer))
+        startVpnMethod(netScan);
+}
+
+bool VPNConnection::probeServers(const Server &selectedServer)
+{
+    Q_ASSERT(_connectingConfig.vpnLocation());  // Postcondition of copySettings()
+
+    // The probes go directly to the servers, so they don't tell us anything
+    // about the route through a proxy.
+    if(!_probeServers || _connectingConfig.proxyType() != ConnectionConfig::ProxyType::None)
+        return false;
+
+    // Race servers that can be used with the same transport, so the transport
+    // reported by TransportSelector is still accurate.  Port and protocol
+    // fallback is still handled by TransportSelector across attempts.
+    const Transport &transport = _transportSelector.lastUsed();
+    std::vector<Server> candidates{selectedServer};
+    for(const auto &server : _connectingConfig.vpnLocation()->servers())
+    {
+        if(candidates.size() >= maxProbeCandidates)
+            break;
+        if(serverUsableForTransport(server, _connectingConfig.method(), transport) &&
+           server.ip() != selectedServer.ip() &&
+           _attemptedServerIps.count(server.ip()) == 0)
+        {
+            candidates.push_back(server);
+        }
+    }
+
+    if(candidates.size() < 2)
+    {
+        // Nothing to race - either there's only one server, or all the others
+        // have been attempted already.  Start over with all servers on the
+        // next attempt.
+        _attemptedServerIps.clear();
+        _attemptedServerIps.insert(selectedServer.ip());
+        return false;
+    }
+
+    auto probeMethod = probeMethodForTransport(_connectingConfig.method(), transport);
+
+    qInfo() << "Racing" << candidates.size() << "servers in"
+        << _connectingConfig.vpnLocation()->id() << "using"
+        << traceEnum(probeMethod);
+    _connectionStep = ConnectionStep::ProbingServers;
+    recordPhase(QStringLiteral("probingServers"));
+    _pServerProbeTask.abandon();
+    _pServerProbeTask = Async<ServerProbeTask>::create(candidates, probeMethod,
+                                                       static_cast<quint16>(transport.port()),
+                                                       _transportSelector.lastLocalAddress())
+        .timeout(serverProbeTimeout)
+        ->next(this, [this, candidates](const Error &err, const int &winner)
+        {
+            // Ignore the result if the attempt was abandoned
+            if(_connectionStep != ConnectionStep::ProbingServers ||
+               (_state != State::Connecting && _state != State::Reconnecting))
+            {
+                return;
+            }
+
+            if(err)
+            {
+                // Don't keep delaying attempts if the probes aren't getting
+                // through; just use TransportSelector's order for the rest of
+                // this connection sequence.
+                qWarning() << "No server responded to probe -" << err
+                    << "- connecting to selected server"
+                    << candidates.front().ip();
+                _probeServers = false;
+            }
+            else if(winner >= 0 && winner < static_cast<int>(candidates.size()))
+                _connectingServer = candidates[winner];
+
+            recordPhase(QStringLiteral("serversProbed"));
+            _attemptedServerIps.insert(_connectingServer->ip());
+            _connectionStep = ConnectionStep::ConnectingOpenVPN;
+            startVpnMethod(g_daemon->originalNetwork());
+        }, Qt::QueuedConnection); // Deliver results asynchronously so we never recurse
+    return true;
+}
+
+void VPNConnection::probeStandby()
+{
+    if(_state != State::Connected || !g_settings.warmStandby())
+        return;
+
+    Q_ASSERT(_connectedConfig.vpnLocation());   // Valid in Connected state
+    Q_ASSERT(_connectedServer);
+
+    // As with probeServers(), probing directly doesn't tell us anything about
+    // a proxy route.
+    if(_connectedConfig.proxyType() != ConnectionConfig::ProxyType::None)
+        return;
+
+    // Probe the other servers usable with the current transport.  These
+    // probes may be routed through the tunnel while connected, so they only
+    // show which servers are up, not which is fastest from this network,
+    // but that's what matters for a standby.
+    const Transport &transport = _transportSelector.lastUsed();
+    std::vector<Server> candidates;
+    for(const auto &server : _connectedConfig.vpnLocation()->servers())
+    {
+        if(candidates.size() >= maxProbeCandidates)
+            break;
+        if(server.ip() != _connectedServer->ip() &&
+           serverUsableForTransport(server, _connectedConfig.method(), transport))
+        {
+            candidates.push_back(server);
+        }
+    }
+
+    if(candidates.empty())
+    {
+        _standbyServer.clear();
+        return;
+    }
+
+    _pStandbyProbeTask.abandon();
+    _pStandbyProbeTask = Async<ServerProbeTask>::create(candidates,
+                                                        probeMethodForTransport(_connectedConfig.method(), transport),
+                                                        static_cast<quint16>(transport.port()),
+                                                        QHostAddress{})
+        .timeout(serverProbeTimeout)
+        ->next(this, [this, candidates](const Error &err, const int &winner)
+        {
+            if(_state != State::Connected)
+                return;
+
+            if(err || winner < 0 || winner >= static_cast<int>(candidates.size()))
+            {
+                if(_standbyServer)
+                    qInfo() << "No standby server responded -" << err;
+                _standbyServer.clear();
+                return;
+            }
+
+            if(!_standbyServer || _standbyServer->ip() != candidates[winner].ip())
+                qInfo() << "Standby server is now" << candidates[winner].ip();
+            _standbyServer = candidates[winner];
+        });
+}
+
+void VPNConnection::probePlan()
+{
+    _planTimer.start(msec32(planRefreshInterval));
+
+    // Like the latency tracker, don't send probes when the daemon is inactive
+    if(_state != State::Disconnected || !_planConfig.vpnLocation() ||
+       !g_daemon->isActive())
+    {
+        return;
+    }
+
+    // Resolve the default port from the location for TCP probes; servers
+    // that don't have that port aren't raced.
+    Transport transport{preferredTransport(_planConfig)};
+    if(transport.port() == 0)
+    {
+        Service service = transport.protocol() == QStringLiteral("tcp") ?
+            Service::OpenVpnTcp : Service::OpenVpnUdp;
+        const Server *pServer = _planConfig.vpnLocation()->randomServerForService(service);
+        if(pServer)
+            transport.port(pServer->defaultServicePort(service));
+    }
+
+    std::vector<Server> candidates;
+    for(const auto &server : _planConfig.vpnLocation()->servers())
+    {
+        if(candidates.size() >= maxProbeCandidates)
+            break;
+        if(serverUsableForTransport(server, _planConfig.method(), transport))
+            candidates.push_back(server);
+    }
+
+    // There's nothing to plan with less than two servers
+    if(candidates.size() < 2)
+    {
+        _plannedServer.clear();
+        return;
+    }
+
+    _pPlanProbeTask.abandon();
+    _pPlanProbeTask = Async<ServerProbeTask>::create(candidates,
+                                                     probeMethodForTransport(_planConfig.method(), transport),
+                                                     static_cast<quint16>(transport.port()),
+                                                     QHostAddress{})
+        .timeout(serverProbeTimeout)
+        ->next(this, [this, candidates](const Error &err, const int &winner)
+        {
+            if(_state != State::Disconnected)
+                return;
+
+            if(err || winner < 0 || winner >= static_cast<int>(candidates.size()))
+            {
+                if(_plannedServer)
+                    qInfo() << "No planned server responded -" << err;
+                _plannedServer.clear();
+                return;
+            }
+
+            if(!_plannedServer || _plannedServer->ip() != candidates[winner].ip())
+                qInfo() << "Planned server for next connection is now" << candidates[winner].ip();
+            _plannedServer = candidates[winner];
+            _plannedServerAge.start();
+            // Register a WireGuard key with it too, so connecting can skip
+            // addKey
+            if(_planConfig.method() == ConnectionConfig::Method::Wireguard)
+                _pWireguardPreauth->preauthenticate(_planConfig, *_plannedServer);
+        });
+}
+
+void VPNConnection::startVpnMethod(const OriginalNetworkScan &netScan)
+{
+    Q_ASSERT(_connectionStep == ConnectionStep::ConnectingOpenVPN);
+    Q_ASSERT(_connectingServer);    // Selected by doConnect()
 
     switch(_connectingConfig.method())
     {
         case ConnectionConfig::Method::OpenVPN:
+            // A parked WireGuard interface can't be used
+            _pWireguardHandoff->discard();
             _method = new OpenVPNMethod{this, netScan};
             break;
         case ConnectionConfig::Method::Wireguard:
-            _method = createWireguardMethod(this, netScan).release();
+            _method = createWireguardMethod(this, netScan, _pWireguardPreauth,
+                                            _pWireguardHandoff).release();
             break;
         default:
             Q_ASSERT(false);
@@ -1355,6 +1933,7 @@ void VPNConnection::doConnect()
     connect(_method, &VPNMethod::bytecount, this, &VPNConnection::updateByteCounts);
     connect(_method, &VPNMethod::firewallParamsChanged, this, &VPNConnection::firewallParamsChanged);
     connect(_method, &VPNMethod::error, this, &VPNConnection::raiseError);
+    connect(_method, &VPNMethod::phaseReached, this, &VPNConnection::recordPhase);
 
     // In order to avoid waiting for OpenVPN to timeout after a network change
     // a reconnection is forced
@@ -1365,6 +1944,7 @@ void VPNConnection::doConnect()
 
     QHostAddress localBindAddress = _transportSelector.lastLocalAddress();
 
+    recordPhase(QStringLiteral("methodStarted"));
     try
     {
         _method->run(_connectingConfig, *_connectingServer,
@@ -1401,6 +1981,15 @@ void VPNConnection::vpnMethodStateChanged()
 
             if(_connectedConfig.dnsType() == ConnectionConfig::DnsType::Local)
             {
+                // If unbound is still running from before a reconnect, it's
+                // kept (with its cache) as long as the config is the same.
+                QByteArray oldConfig;
+                {
+                    QFile oldConfigFile{Path::UnboundConfigFile};
+                    if(_resolverRunner.isEnabled() && oldConfigFile.open(QIODevice::ReadOnly))
+                        oldConfig = oldConfigFile.readAll();
+                }
+
                 // Write the config file
                 {
                     kapps::core::ConfigWriter conf{Path::UnboundConfigFile};
@@ -1409,6 +1998,16 @@ void VPNConnection::vpnMethodStateChanged()
                     conf << "    edns-buffer-size: 4096" << conf.endl;
                     conf << "    max-udp-size: 4096" << conf.endl;
                     conf << "    qname-minimisation: yes" << conf.endl;
+                    // Refresh popular records before they expire, and if an
+                    // upstream is slow to answer for an expired record, serve
+                    // the expired record after a short wait
+                    conf << "    prefetch: yes" << conf.endl;
+                    conf << "    serve-expired: yes" << conf.endl;
+                    conf << "    serve-expired-client-timeout: 1800" << conf.endl;
+                    // unbound keeps running across reconnects, don't let
+                    // servers that were unreachable while the tunnel was down
+                    // stay marked as down
+                    conf << "    infra-keep-probing: yes" << conf.endl;
                     conf << "    do-ip6: no" << conf.endl;
                     conf << "    interface: " << resolverLocalAddress().toStdString() << conf.endl;
                     conf << "    outgoing-interface:" << g_state.tunnelDeviceLocalAddress().toStdString() << conf.endl;
@@ -1430,8 +2029,30 @@ void VPNConnection::vpnMethodStateChanged()
                     conf << "    pidfile: \"\"" << conf.endl;
                     conf << "    chroot: \"\"" << conf.endl;
                 }
+                QByteArray newConfig;
+                {
+                    QFile newConfigFile{Path::UnboundConfigFile};
+                    if(newConfigFile.open(QIODevice::ReadOnly))
+                        newConfig = newConfigFile.readAll();
+                }
+                if(_resolverRunner.isEnabled())
+                {
+                    if(newConfig == oldConfig)
+                        qInfo() << "Keeping local resolver running, config has not changed";
+                    else
+                    {
+                        qInfo() << "Restarting local resolver, config has changed";
+                        _resolverRunner.disable();
+                    }
+                }
                 _resolverRunner.enable(ResolverRunner::Resolver::Unbound, {"-c", Path::UnboundConfigFile});
             }
+            else if(_resolverRunner.isEnabled())
+            {
+                // Kept running through a reconnect, but DNS has changed
+                _resolverRunner.disable();
+                QFile::remove(Path::UnboundConfigFile);
+            }
 
             // For any DNS method other than "Use Existing DNS", schedule a
             // DNS cache flush.
@@ -1568,18 +2189,63 @@ void VPNConnection::updateAttemptCount(int newCount)
     }
 }
 
+void VPNConnection::startTimeline(const QString &phase)
+{
+    _timelineElapsed.start();
+    _connectionTimeline.clear();
+    recordPhase(phase);
+}
+
+void VPNConnection::recordPhase(const QString &phase)
+{
+    if(!_timelineElapsed.isValid())
+        return;
+
+    // Only the first occurrence in each attempt is interesting; later ones
+    // usually just indicate a retry within the VPN method.
+    for(const auto &entry : _connectionTimeline)
+    {
+        if(entry.attempt() == _connectionAttemptCount && entry.phase() == phase)
+            return;
+    }
+
+    qint64 elapsed = _timelineElapsed.elapsed();
+    qInfo() << "Connection phase" << phase << "- attempt"
+        << _connectionAttemptCount << "at" << elapsed << "ms";
+    if(_connectionTimeline.size() == g_maxTimelinePhases)
+        _connectionTimeline.pop_front();
+    _connectionTimeline.push_back({phase, _connectionAttemptCount, elapsed});
+    emit connectionTimelineChanged();
+}
+
 void VPNConnection::setState(State state)
 {
     if (state != _state)
     {
+        // Record this before the attempt count is reset below
+        if(state == State::Connected)
+        {
+            recordPhase(QStringLiteral("connected"));
+            qInfo() << "Connected after" << _timelineElapsed.elapsed() << "ms -"
+                << _connectionAttemptCount << "attempts";
+        }
+
         if(state == State::Disconnected)
         {
             // We have completely disconnected, drop the measurement intervals.
             _intervalMeasurements.clear();
+            _throughputHistory.clear();
             emit byteCountsChanged();
 
-            // Stop shadowsocks if it was running.
-            _shadowsocksRunner.disable();
+            // Tear down a WireGuard interface kept for a server switch, but
+            // not one kept to resume after sleep
+            if(!_pWireguardHandoff->parkedForResume())
+                _pWireguardHandoff->discard();
+
+            // Keep shadowsocks running for a while if it was running, the
+            // next connection will probably use the same server.
+            if(_shadowsocksRunner.isEnabled())
+                _shadowsocksIdleTimer.start();
         }
 
         // Several members are only valid in the [Still]Connecting and
@@ -1587,22 +2253,46 @@ void VPNConnection::setState(State state)
         // them.
         if(state != State::Connecting && state != State::Reconnecting)
         {
+            _pServerProbeTask.abandon();
             _connectionStep = ConnectionStep::Initializing;
             updateAttemptCount(0);
             _connectTimer.stop();
         }
 
-        // In any state other than Connected, stop the resolver, even if that's
-        // our current DNS setting.  (If we're reconnecting while Handshake/Local
-        // DNS is selected, it'll be restarted after we connect.)
-        if(state != State::Connected)
+        // The warm standby is only probed while connected.  The last standby
+        // server is kept until the next connection attempt, so a reconnect
+        // after losing the connection can use it.
+        if(state == State::Connected && g_settings.warmStandby())
+        {
+            _standbyServer.clear();
+            _standbyTimer.start();
+            QTimer::singleShot(0, this, &VPNConnection::probeStandby);
+        }
+        else if(state != State::Connected)
+        {
+            _standbyTimer.stop();
+            _pStandbyProbeTask.abandon();
+            if(state == State::Disconnected)
+                _standbyServer.clear();
+        }
+
+        // When disconnecting, stop the resolver.  While reconnecting, keep it
+        // running so its cache survives the reconnect - when we connect again,
+        // it's restarted only if its config changed (such as a new tunnel
+        // address), or stopped if the DNS setting changed.
+        if(state == State::Disconnecting || state == State::Disconnected)
         {
             _resolverRunner.disable();
             // If it was Unbound, delete the old config file
             QFile::remove(Path::UnboundConfigFile);
-            // Don't measure intervals between bytecounts
-            _lastBytecountTime.clear();
         }
+        // Don't measure intervals between bytecounts
+        if(state != State::Connected)
+            _lastBytecountTime.clear();
+
+        // A lost connection begins a new connection sequence.
+        if(state == State::Interrupted)
+            startTimeline(QStringLiteral("connectionLost"));
 
         State oldState = _state;
         _state = state;
@@ -1668,6 +2358,8 @@ void VPNConnection::updateByteCounts(quint64 received, quint64 sent)
     if(_intervalMeasurements.size() == g_maxMeasurementIntervals)
         _intervalMeasurements.pop_front();
     _intervalMeasurements.push_back({intervalReceived, intervalSent});
+    _throughputHistory.addMeasurement(intervalReceived, intervalSent,
+                                      QDateTime::currentMSecsSinceEpoch());
 
     // The interval measurements always change even if the perpetual totals do
     // not (we added a 0,0 entry).
@@ -26,9 +26,12 @@
 #include <common/src/settings/daemonsettings.h>
 #include "model/state.h"
 #include "processrunner.h"
+#include "serverprobe.h"
+#include "throughputhistory.h"
 #include <common/src/vpnstate.h>
 #include <common/src/elapsedtime.h>
 #include <common/src/async.h>
+#include <kapps_core/src/smallvector.h>
 
 #include <QDateTime>
 #include <QDeadlineTimer>
@@ -40,8 +43,11 @@
 #include <QFile>
 #include <QTimer>
 #include <kapps_net/src/originalnetworkscan.h>
+#include <set>
 
 class VPNMethod;
+class WireguardPreauth;
+class WireguardHandoff;
 
 // A descriptor for the desired network adapter (--dev-node) to use.
 // Only one subclass of this class (or the class itself) should ever
@@ -100,6 +106,10 @@ signals:
     // Other conditions (such as hnsd crashing / failing to start) do not emit
     // this, we keep the current sync failure state.
     void hnsdSyncFailure(bool failing);
+    // Indicate the chain height hnsd has synced to - emitted for the first
+    // block synced after hnsd starts, then every 1000 blocks.  Emitted with 0
+    // when hnsd is disabled.
+    void hnsdSyncHeight(qint64 height);
 
 public:
     // Change process UID/GID on Linux/MacOS
@@ -112,6 +122,9 @@ private:
     // Only used by Linux - check whether the resolver can bind to low ports
     // (cap_net_bind_service capability)
     bool hasNetBindServiceCapability();
+    // Create the hnsd data directory, and on Unix, allow the resolver group to
+    // write it (hnsd may not run as root)
+    void prepareHnsdDataDir();
 
 private:
     // Timer used to detect the "hnsd failing to sync" condition - hnsd needs to
@@ -121,6 +134,9 @@ private:
     // The resolver we're currently running when active.  Controls whether we
     // do the hnsd sync timeout, and emitted with success/failure signals.
     Resolver _activeResolver;
+    // The last height reported with hnsdSyncHeight(), 0 if no block has been
+    // synced since hnsd started.
+    qint64 _hnsdHeight;
 };
 
 // ProcessRunner for Shadowsocks - drops UID to 'nobody' on Unix platforms, and
@@ -134,12 +150,16 @@ public:
     ShadowsocksRunner(RestartStrategy::Params restartParams);
 
 public:
-    bool enable(QString program, QStringList arguments);
+    // Run ss-local for this Shadowsocks server.  If it's already running for
+    // this server, it's left running (and keeps its local port).
+    bool enable(const Server &server);
     virtual void setupProcess(UidGidProcess &process) override;
 
     // Get the local port - 0 if it hasn't been detected yet since Shadowsocks
     // was started (localPortAssigned() will be emitted in that case).
     quint16 localPort() const {return _localPort;}
+    // The server ss-local is running for, empty if it's not enabled
+    QString serverIp() const {return isEnabled() ? _serverIp : QString{};}
 
 signals:
     // The local port has been assigned - happens after the Shadowsocks client
@@ -150,6 +170,10 @@ signals:
 private:
     // Local port emitted by the Shadowsocks client when starting
     quint16 _localPort;
+    QString _serverIp;
+    // Time since the process was started, to trace how long it takes to
+    // assign a port
+    QElapsedTimer _startElapsed;
 };
 
 // from kapps-net
@@ -219,7 +243,16 @@ private:
     // resolved port is needed to determine if the actual transport is really
     // different from the user's selection.
     Transport _lastPreferred, _lastUsed;
-    std::vector<Transport> _alternates;
+    // The alternates are just the protocol and port - Transport is a
+    // NativeJsonObject, which would allocate for each one.  There are usually
+    // only a handful (the UDP and TCP ports plus the two defaults), so they're
+    // stored inline.
+    struct Alternate
+    {
+        QString protocol;
+        uint port;
+    };
+    kapps::core::SmallVector<Alternate, 16> _alternates;
     QHostAddress _lastLocalAddress;
     std::size_t _nextAlternate;
     QDeadlineTimer _startAlternates;
@@ -369,6 +402,8 @@ public:
     // Use the static configuration method for TAP instead of the default DHCP
     // method
     bool openvpnUseStaticTapConfig() const {return _openvpnUseStaticTapConfig;}
+    // Data channel tuning profile - "auto", "standard", or "throughput"
+    const QString &openvpnPerformanceProfile() const {return _openvpnPerformanceProfile;}
     // Preferred protocol and port (collectively "transport") for OpenVPN.  Note
     // that the actual transport can differ if "Try Alternate Settings" is
     // enabled and this transport isn't reachable.
@@ -378,6 +413,9 @@ public:
 
     // For the WireGuard method only, whether to use kernel support if available
     bool wireguardUseKernel() const {return _wireguardUseKernel;}
+    // For the WireGuard method only, whether to tune wireguard-go for
+    // throughput (see DaemonSettings::wireguardGoHighThroughput)
+    bool wireguardGoHighThroughput() const {return _wireguardGoHighThroughput;}
 
     int mtu() const {return _mtu;}
 
@@ -469,9 +507,11 @@ private:
     QString _vpnUsername, _vpnPassword, _vpnToken;
     QString _openvpnCipher;
     bool _openvpnUseWintun{false}, _openvpnUseStaticTapConfig{false};
+    QString _openvpnPerformanceProfile;
     Protocol _openvpnProtocol{Protocol::UDP};
     quint16 _openvpnRemotePort{};
     bool _wireguardUseKernel{false};
+    bool _wireguardGoHighThroughput{false};
     int _mtu{-1};
     bool _automaticTransport{false};
 
@@ -506,6 +546,17 @@ private:
     void checkExternalIp();
 };
 
+// VPNConnection manages the VPN connection - selecting servers and
+// transports, running the VPN method, and retrying or reconnecting as needed.
+//
+// There is exactly one VPN method at a time.  The state model, firewall,
+// routing, DNS, and split tunnel all assume a single tunnel: the firewall and
+// split tunnel rules refer to one tunnel interface and one VPN server, the
+// Linux WireGuard routing table and fwmark are fixed, the WireGuard interface
+// name is fixed, and DNS is applied system-wide.  Running several tunnels at
+// once would require each of those to become per-tunnel, so it isn't
+// supported; a second VPN method is only started after the last one exits
+// (see WireguardHandoff for how an interface is kept across a server switch).
 class VPNConnection : public QObject
 {
     Q_OBJECT
@@ -529,6 +580,10 @@ public:
         // Starting proxy, only done when starting up Shadowsocks client with
         // ephemeral port
         StartingProxy,
+        // Racing several servers in the location to find the fastest one to
+        // attempt; skipped when there's only one candidate or when using a
+        // proxy
+        ProbingServers,
         // OpenVPN has been started and is connecting
         ConnectingOpenVPN,
     };
@@ -543,8 +598,20 @@ public:
     quint64 bytesReceived() const { return _receivedByteCount; }
     quint64 bytesSent() const { return _sentByteCount; }
     const std::deque<IntervalBandwidth> &intervalMeasurements() const {return _intervalMeasurements;}
+    // Bandwidth history at several resolutions since connecting; see
+    // Daemon::RPC_getThroughputHistory()
+    const ThroughputHistory &throughputHistory() const {return _throughputHistory;}
+    // Phases reached during the most recent connection sequence; see
+    // StateModel::connectionTimeline
+    const std::deque<ConnectionPhase> &connectionTimeline() const {return _connectionTimeline;}
     void activateMACE ();
 
+    // Record a phase in the connection timeline.  Ignored if no connection
+    // sequence has started yet, or if the phase was already recorded in the
+    // current attempt.  Daemon uses this for phases it handles itself, like
+    // applying the firewall.
+    void recordPhase(const QString &phase);
+
     bool needsReconnect();
     // Get the current VPN method, if one exists - for updating firewall params
     // specified by the VPN method.  If a valid method is returned, it remains
@@ -553,6 +620,10 @@ public:
 
     // Update the current network in the VPNMethod when it has changed.
     void updateNetwork(const OriginalNetworkScan &newNetwork);
+    // Update the plan for the next connection.  Daemon calls this whenever
+    // the next connection config might have changed; the plan is only
+    // recomputed if the location, method, transport, or proxy changed.
+    void updatePlan(const ConnectionConfig &nextConfig);
     void scheduleDnsCacheFlush();
 
 public slots:
@@ -573,6 +644,13 @@ public slots:
     // similar to a hard error due to auth failure.)
     bool connectVPN(bool force);
     void disconnectVPN();
+    // Disconnect before the system sleeps.  A WireGuard connection keeps its
+    // interface so the connection after wake can resume it (see
+    // WireguardHandoff and DaemonSettings::wireguardFastResume).
+    void disconnectForSleep();
+    // Tear down an interface kept to resume after sleep, if the connection
+    // after wake won't take it
+    void discardResume();
 
 private:
     void beginConnection();
@@ -614,12 +692,15 @@ signals:
     // The total sent/received bytecounts and the interval measurements have
     // changed.
     void byteCountsChanged();
+    // A phase was added to the connection timeline, or it was reset
+    void connectionTimelineChanged();
     // Signals forwarded from ResolverRunner for each resolver
     void unboundSucceeded();
     void unboundFailed(std::chrono::milliseconds failureDuration);
     void hnsdSucceeded();
     void hnsdFailed(std::chrono::milliseconds failureDuration);
     void hnsdSyncFailure(bool failing);
+    void hnsdSyncHeight(qint64 height);
     void usingTunnelConfiguration(const QString &deviceName,
                                   const QString &deviceLocalAddress,
                                   const QString &deviceRemoteAddress);
@@ -638,6 +719,26 @@ private:
     // not be found), it instead transitions to failureState and returns false.
     // _connectingConfig is cleared in this case.
     bool copySettings(State successState, State failureState);
+    // Start racing other servers against the server selected for this
+    // attempt.  If a probe is started, the connection continues when it
+    // finishes and this returns true; otherwise this returns false to connect
+    // to the selected server immediately.
+    bool probeServers(const Server &selectedServer);
+    // Create the VPN method and start connecting to _connectingServer
+    void startVpnMethod(const OriginalNetworkScan &netScan);
+    // While connected with the warm standby enabled, probe the other servers
+    // in the connected location to keep a standby server for failover
+    void probeStandby();
+    // Reset the connection timeline to begin a new connection sequence, with
+    // the given phase as its first entry
+    void startTimeline(const QString &phase);
+    // While disconnected, race the servers in the next location ahead of time
+    // so the first connection attempt can skip the race
+    void probePlan();
+    void clearPlan();
+    // Select a Shadowsocks server from this location - prefers the server
+    // ss-local is already running for, so it doesn't have to restart.
+    const Server *selectShadowsocksServer(const Location &location) const;
 
 private:
     State _state;
@@ -649,8 +750,12 @@ private:
     // Runner for hnsd process, enabled when we connect with Handshake DNS.
     ResolverRunner _resolverRunner;
     // Runner for ss-local process, enabled when we connect with a Shadowsocks
-    // proxy.
+    // proxy.  It's started ahead of time when the next connection will use
+    // Shadowsocks, and kept running for a while after disconnecting, so
+    // connecting doesn't have to wait for it to start.
     ShadowsocksRunner _shadowsocksRunner;
+    // Stops ss-local if it's unused for a while in the Disconnected state
+    QTimer _shadowsocksIdleTimer;
     // Stored settings as of last/current connection.  These are valid in any
     // state, they are the settings that will be used for the next connection
     // (even in the Connected state; they'll be applied when a reconnect occurs)
@@ -689,6 +794,9 @@ private:
     quint64 _lastReceivedByteCount, _lastSentByteCount;
     // Interval measurements for the current OpenVPN process
     std::deque<IntervalBandwidth> _intervalMeasurements;
+    // Bandwidth history since connecting (kept across reconnects, cleared
+    // when disconnected)
+    ThroughputHistory _throughputHistory;
     // Time since the last bytecount measurement - if it comes in after the
     // abandon deadline, we assume the connection is lost and terminate it.  See
     // updateByteCounts().
@@ -697,6 +805,39 @@ private:
     bool _needsReconnect;
 
     Async<ExternalIpTask> _pExternalIpTask;
+    Async<void> _pServerProbeTask;
+    // Servers already attempted in the current connection sequence; these are
+    // not raced again until all servers have been tried, so a server that keeps
+    // winning the race but fails to connect doesn't block the others.
+    std::set<QString> _attemptedServerIps;
+    // Whether to race servers before each attempt - cleared for the rest of a
+    // connection sequence if no server responds to a probe (probably because
+    // the network filters the probes).
+    bool _probeServers;
+    // Warm standby server, probed periodically while connected (if enabled).
+    // The first reconnect attempt after losing the connection uses it.
+    QTimer _standbyTimer;
+    Async<void> _pStandbyProbeTask;
+    nullable_t<Server> _standbyServer;
+    // Monotonic time since the current connection sequence started, and the
+    // phases reached so far (see connectionTimeline())
+    QElapsedTimer _timelineElapsed;
+    std::deque<ConnectionPhase> _connectionTimeline;
+    // Plan for the next connection - the config it was computed for, and the
+    // server that won the last race in that location.  This is only kept up to
+    // date while disconnected with background latency checks enabled, since
+    // the probes are similar traffic.
+    QTimer _planTimer;
+    Async<void> _pPlanProbeTask;
+    ConnectionConfig _planConfig;
+    nullable_t<Server> _plannedServer;
+    QElapsedTimer _plannedServerAge;
+    // WireGuard keys registered with the planned server, or kept from the last
+    // connection (shared with WireguardMethod)
+    std::shared_ptr<WireguardPreauth> _pWireguardPreauth;
+    // WireGuard interface kept up while switching servers (shared with
+    // WireguardMethod)
+    std::shared_ptr<WireguardHandoff> _pWireguardHandoff;
 };
 
 // The 127/8 loopback address used for local DNS.
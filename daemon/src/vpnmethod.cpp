@@ -60,6 +60,7 @@ void VPNMethod::emitTunnelConfiguration(const QString &deviceName,
                                         const QString &deviceLocalAddress,
                                         const QString &deviceRemoteAddress)
 {
+    emitPhase(QStringLiteral("tunnelConfigured"));
     emit tunnelConfiguration(deviceName, deviceLocalAddress,
                              deviceRemoteAddress);
 }
@@ -79,3 +80,8 @@ void VPNMethod::raiseError(const Error &err)
     qInfo() << "VPN method error:" << err;
     emit error(err);
 }
+
+void VPNMethod::emitPhase(const QString &phase)
+{
+    emit phaseReached(phase);
+}
@@ -181,6 +181,11 @@ protected:
     // already, it may or may not call shutdown().)
     void raiseError(const Error &err);
 
+    // Indicate that the connection attempt reached a phase; VPNConnection
+    // records these in the connection timeline.  Phases that are reached
+    // more than once in an attempt are only recorded the first time.
+    void emitPhase(const QString &phase);
+
 private:
     // The network state returned by originalNetwork() has changed.  Override
     // this to update routes, or abort the connection, etc.
@@ -196,6 +201,7 @@ signals:
     void firewallParamsChanged();
     void error(const Error &err);
     void networkHasChanged();
+    void phaseReached(const QString &phase);
 
 private:
     State _state;
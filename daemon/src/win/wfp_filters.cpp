@@ -66,91 +66,162 @@ QByteArray WfpFilters::render()
 
 void WfpFilters::parseXml()
 {
-    QDomDocument doc;
-    doc.setContent(_xml);
-    QDomNodeList items = doc.elementsByTagName("item");
+    QXmlStreamReader reader{_xml};
 
-    for (int i = 0; i < items.size(); i++)
+    // Filters are the outermost <item> elements; parseFilterItem() consumes
+    // the nested <item>s (flags, conditions, etc.)
+    while(!reader.atEnd())
     {
-        QDomNode node = items.item(i);
-        QDomElement el = node.firstChildElement("subLayerKey");
+        reader.readNext();
+        if(reader.isStartElement() && reader.name() == QLatin1String("item"))
+            parseFilterItem(reader);
+    }
 
-        if (el.text() == subLayerKey)
-        {
-            int weight = dig(node, {"weight", "uint8"}).toInt();
-            QString ipVersion = tr(dig(node, {"layerKey"}));
-            QString action = tr(dig(node, {"action", "type"}));
-            QString condition = processCondition(node);
+    if(reader.hasError())
+    {
+        qWarning() << "Error reading WFP XML at line" << reader.lineNumber()
+            << "-" << reader.errorString();
+    }
+}
+
+void WfpFilters::parseFilterItem(QXmlStreamReader &reader)
+{
+    bool isPiaFilter{false};
+    WfpFilter filter{};
 
-            _wfpFilters.push_back({weight, ipVersion, action, condition});
+    while(reader.readNextStartElement())
+    {
+        const auto name = reader.name();
+        if(name == QLatin1String("subLayerKey"))
+        {
+            isPiaFilter = reader.readElementText() == subLayerKey;
+            // Skip the rest of any other filter right away
+            if(!isPiaFilter)
+            {
+                reader.skipCurrentElement();
+                return;
+            }
         }
+        else if(name == QLatin1String("layerKey"))
+            filter.ipVersion = tr(reader.readElementText());
+        else if(name == QLatin1String("weight"))
+            filter.weight = readChildText(reader, QLatin1String("uint8")).toInt();
+        else if(name == QLatin1String("action"))
+            filter.action = tr(readChildText(reader, QLatin1String("type")));
+        else if(name == QLatin1String("filterCondition"))
+            filter.condition = processCondition(reader);
+        else
+            reader.skipCurrentElement();
     }
+
+    if(isPiaFilter)
+        _wfpFilters.push_back(std::move(filter));
 }
 
-QString WfpFilters::processConditionValue(const QDomElement &cv) const
+// A condition value is read into this small tree before rendering, since each
+// element's rendering depends on whether it has child elements.
+struct WfpFilters::ConditionValueNode
 {
-    QDomNodeList children = cv.childNodes();
-    QStringList result {};
+    QString name;
+    QString text;
+    std::vector<ConditionValueNode> children;
+};
 
-    for (int i = 0; i < children.size(); i++)
+auto WfpFilters::readConditionValue(QXmlStreamReader &reader) const
+    -> ConditionValueNode
+{
+    ConditionValueNode node;
+    node.name = reader.name().toString();
+    while(!reader.atEnd())
     {
-        QDomElement element = children.item(i).toElement();
+        reader.readNext();
+        if(reader.isStartElement())
+            node.children.push_back(readConditionValue(reader));
+        else if(reader.isCharacters())
+            node.text += reader.text();
+        else if(reader.isEndElement())
+            break;
+    }
+    return node;
+}
+
+QString WfpFilters::processConditionValue(const ConditionValueNode &cv) const
+{
+    QStringList result {};
 
-        if (element.tagName() == "type")
+    for (const auto &child : cv.children)
+    {
+        if (child.name == QLatin1String("type"))
             continue; // Not interested in type information
-        else if (element.firstChild().isText())
-            result << maybeTruncate(element.text());
+        else if (child.children.empty())
+            result << maybeTruncate(child.text);
         else
-            result << QStringLiteral("%1: %2").arg(element.tagName()).arg(processConditionValue(element));
+            result << QStringLiteral("%1: %2").arg(child.name).arg(processConditionValue(child));
     }
 
     return result.join(", ");
 }
 
-QString WfpFilters::processCondition(const QDomNode &node) const
+QString WfpFilters::processCondition(QXmlStreamReader &reader) const
 {
-    QDomElement filterCondition { node.firstChildElement("filterCondition") };
-
-    if (filterCondition.attribute("numItems").toInt() < 1)
+    if (reader.attributes().value(QLatin1String("numItems")).toInt() < 1)
     {
         // No conditions exist on this filter
+        reader.skipCurrentElement();
         return "None";
     }
-    else
-    {
-        QDomNodeList items = filterCondition.elementsByTagName("item");
 
-        QStringList result {};
-        for (int i = 0; i < items.size(); i++)
+    QStringList result {};
+    while (reader.readNextStartElement())
+    {
+        if (reader.name() != QLatin1String("item"))
         {
-            QString conditionString;
-            auto item = items.item(i);
-            auto conditionValue = item.firstChildElement("conditionValue");
+            reader.skipCurrentElement();
+            continue;
+        }
 
-            result << QStringLiteral("<%2 %1 %3>")
-                .arg(tr(dig(item, { "matchType" }))).arg(tr(dig(item, { "fieldKey" })))
-                .arg(processConditionValue(conditionValue));
+        QString fieldKey, matchType, conditionValue;
+        while (reader.readNextStartElement())
+        {
+            const auto name = reader.name();
+            if (name == QLatin1String("fieldKey"))
+                fieldKey = reader.readElementText();
+            else if (name == QLatin1String("matchType"))
+                matchType = reader.readElementText();
+            else if (name == QLatin1String("conditionValue"))
+                conditionValue = processConditionValue(readConditionValue(reader));
+            else
+                reader.skipCurrentElement();
         }
-        return result.join(" ");
+
+        result << QStringLiteral("<%2 %1 %3>")
+            .arg(tr(matchType)).arg(tr(fieldKey)).arg(conditionValue);
     }
+    return result.join(" ");
 }
 
-QString WfpFilters::dig(const QDomNode &node, const QStringList &elementNames) const
+QString WfpFilters::readChildText(QXmlStreamReader &reader, QLatin1String childName) const
 {
-    QDomElement element { node.toElement() };
-
-    for (const QString &str : elementNames)
+    QString text;
+    bool found{false};
+    while (reader.readNextStartElement())
     {
-        element = element.firstChildElement(str);
-        if (element.isNull())
+        if (!found && reader.name() == childName)
         {
-            auto errorStr { QStringLiteral("No such element: %1").arg(str) };
-            qError() << errorStr;
-            return errorStr;
+            text = reader.readElementText();
+            found = true;
         }
+        else
+            reader.skipCurrentElement();
     }
 
-    return element.text();
+    if (!found)
+    {
+        auto errorStr { QStringLiteral("No such element: %1").arg(childName) };
+        qError() << errorStr;
+        return errorStr;
+    }
+    return text;
 }
 
 
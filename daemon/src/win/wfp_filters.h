@@ -22,7 +22,7 @@
 #ifndef WFP_FILTERS_H
 #define WFP_FILTERS_H
 
-#include <QDomDocument>
+#include <QXmlStreamReader>
 
 // Data associated with a WFP filter
 struct WfpFilter
@@ -36,6 +36,11 @@ struct WfpFilter
 // Converts WFP (Windows Filtering Platform) XML into a human-readable form.
 // This allows us to introspect on our network filters: killswitch, LAN access, and so on.
 //
+// The XML is read as a stream, and filters that aren't in the PIA sublayer are
+// skipped as soon as their sublayer is known.  Systems with third-party
+// security products can have a very large number of filters, so the XML is
+// never loaded into a document.
+//
 // See an example of the XML at the bottom of this file.
 class WfpFilters
 {
@@ -53,17 +58,33 @@ private:
     // Process all the PIA WFP XML filters, storing them in _wfpFilters
     void parseXml();
 
-    // Process XML for the condition values of a filter condition
-    QString processConditionValue(const QDomElement &cv) const;
+    // Process a filter <item>; the reader is positioned at its start element.
+    // Consumes the item through its end element, and stores it in _wfpFilters
+    // if it's a PIA filter.
+    void parseFilterItem(QXmlStreamReader &reader);
+
+    // Condition values are read into a small tree of these before rendering
+    struct ConditionValueNode;
+
+    // Read the element at the reader's current start element through its end
+    // element
+    ConditionValueNode readConditionValue(QXmlStreamReader &reader) const;
+
+    // Render the condition values of a filter condition
+    QString processConditionValue(const ConditionValueNode &cv) const;
 
-    // Process XML for filter conditions
-    QString processCondition(const QDomNode &node) const;
+    // Process XML for filter conditions; the reader is positioned at the
+    // <filterCondition> start element.  Consumes it through its end element.
+    QString processCondition(QXmlStreamReader &reader) const;
 
     // Truncate a WFP string depending on its content
     QString maybeTruncate(QString text) const;
 
-    // Easily navigate nested xml nodes
-    QString dig(const QDomNode &node, const QStringList &elementNames) const;
+    // Read the text of the first child element with the given name, skipping
+    // anything else in the current element (consumes through the current
+    // element's end element).  Returns an error string if there is no such
+    // child.
+    QString readChildText(QXmlStreamReader &reader, QLatin1String childName) const;
 
     // Wrapper around wfpNameMap
     QString tr(const QString &wfpName) const;
@@ -52,6 +52,8 @@ namespace
     wchar_t wfpProviderCtxDescription[] = L"" BRAND_SHORT_NAME " WFP Provider Context";
     wchar_t wfpCalloutName[] = L"" BRAND_SHORT_NAME " WFP Callout";
     wchar_t wfpCalloutDescription[] = L"" BRAND_SHORT_NAME " WFP Callout";
+    // Name of the ETW session used by WinAppMonitor to observe new processes
+    const wchar_t appMonitorTraceName[] = L"" BRAND_SHORT_NAME " Split Tunnel Process Trace";
 
     // GUIDs of the callouts defined by the PIA WFP callout driver.  These must
     // match the callouts in the driver.  If you build a rebranded driver,
@@ -100,7 +102,8 @@ std::chrono::microseconds WinUnbiasedDeadline::remaining() const
 WinDaemon::WinDaemon(QObject* parent)
     : Daemon{parent},
       MessageWnd{WindowType::Invisible},
-      _wfpCalloutMonitor{L"PiaWfpCallout"}
+      _wfpCalloutMonitor{L"PiaWfpCallout"},
+      _appMonitor{appMonitorTraceName}
 {
     kapps::net::FirewallConfig config{};
     config.daemonDataDir = Path::DaemonDataDir;
@@ -440,6 +443,8 @@ void WinDaemon::applyFirewallRules(kapps::net::FirewallParams params)
     params.excludeApps = _appMonitor.getExcludedAppIds();
     params.vpnOnlyApps = _appMonitor.getVpnOnlyAppIds();
     _pFirewall->applyRules(params);
+    _state.lastFirewallApply(_pFirewall->lastApplyStats());
+    _state.totalFirewallApply(_pFirewall->totalApplyStats());
 }
 
 QJsonValue WinDaemon::RPC_inspectUwpApps(const QJsonArray &familyIds)
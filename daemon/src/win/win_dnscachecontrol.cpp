@@ -297,6 +297,8 @@ void WinDnsCacheControl::serviceStateChanged(WinServiceState::State newState,
         _lastDnsCacheState = DnsCacheState::Down;
     }
 
+    checkTransitionDone();
+
     // If the normal Dnscache service has somehow started again, and we were
     // supposed to be running the stub, stub it again.
     if(_lastDnsCacheState == DnsCacheState::Normal && _stubEnabled)
@@ -335,6 +337,30 @@ void WinDnsCacheControl::serviceStateChanged(WinServiceState::State newState,
     }
 }
 
+void WinDnsCacheControl::beginTransition()
+{
+    if(_transitionElapsed.isValid())
+    {
+        qInfo() << "Dnscache transition superseded after"
+            << traceMsec(_transitionElapsed.elapsed());
+    }
+    _transitionElapsed.start();
+}
+
+void WinDnsCacheControl::checkTransitionDone()
+{
+    if(!_transitionElapsed.isValid())
+        return;
+
+    DnsCacheState desiredState = _stubEnabled ? DnsCacheState::Stubbed : DnsCacheState::Normal;
+    if(_lastDnsCacheState == desiredState)
+    {
+        qInfo() << "Dnscache reached" << (_stubEnabled ? "stubbed" : "normal")
+            << "state after" << traceMsec(_transitionElapsed.elapsed());
+        _transitionElapsed.invalidate();
+    }
+}
+
 void WinDnsCacheControl::stubDnsCache(const WinHandle &dnscacheProcess,
                                       DWORD dnscachePid)
 {
@@ -529,6 +555,12 @@ void WinDnsCacheControl::startDnsCache()
         ->notify(this, [this](const Error &err)
         {
             qInfo() << "Result of restarting Dnscache -" << err;
+            if(_transitionElapsed.isValid())
+            {
+                qInfo() << "Dnscache start completed"
+                    << traceMsec(_transitionElapsed.elapsed())
+                    << "after transition began";
+            }
             // In some cases, when Dnscache is hosted by a shared
             // svchost with other services, attempting to restore the
             // normal service can fail with ERROR_INCOMPATIBLE_SERVICE_SID_TYPE.
@@ -610,6 +642,7 @@ void WinDnsCacheControl::disableDnsCache()
 
     _stubEnabled = true;
     qInfo() << "Enabling Dnscache stub service to disable DNS cache";
+    beginTransition();
     // Rerun the state change logic to sync up to the new _stubEnabled state.
     // This also re-detects _lastDnsCacheState, but that's fine.
     serviceStateChanged(_serviceState.lastState(), _serviceState.lastPid());
@@ -622,6 +655,7 @@ void WinDnsCacheControl::restoreDnsCache()
 
     _stubEnabled = false;
     qInfo() << "Restoring Dnscache service";
+    beginTransition();
     // As in disable(), just rerun the state change logic.
     serviceStateChanged(_serviceState.lastState(), _serviceState.lastPid());
 }
@@ -24,6 +24,7 @@
 
 #include "win_servicestate.h"
 #include <common/src/win/win_util.h>
+#include <QElapsedTimer>
 #include <QTimer>
 
 // WinDnsCacheControl disables or restores the DnsCache service, which is
@@ -93,6 +94,13 @@ private:
     std::wstring getDnscacheRunningBasename(DWORD pid, WinHandle &dnscacheProcess);
     void serviceStateChanged(WinServiceState::State newState, DWORD newPid);
 
+    // Start timing a transition to the stubbed or normal state (traces the
+    // prior transition if it hadn't completed).
+    void beginTransition();
+    // If a transition is being timed and Dnscache has reached the desired
+    // state, trace how long it took.
+    void checkTransitionDone();
+
     // Stub the Dnscache service - temporarily point it to the stub, then kill
     // it and let the system start the stub
     void stubDnsCache(const WinHandle &dnscacheProcess, DWORD dnscachePid);
@@ -127,6 +135,11 @@ private:
     // don't have to constantly recheck it for every firewall update.)
     DnsCacheState _lastDnsCacheState;
     QTimer _restartDelayTimer;
+    // Time since disableDnsCache()/restoreDnsCache() was called; valid only
+    // until Dnscache reaches the desired state.  Stubbing or restoring
+    // Dnscache requires terminating and restarting the service, so this traces
+    // how long DNS was disrupted.
+    QElapsedTimer _transitionElapsed;
 };
 
 #endif
@@ -20,8 +20,15 @@
 #line SOURCE_FILE("win_interfacemonitor.cpp")
 
 #include "win_interfacemonitor.h"
+#include <chrono>
 #include <cstddef>
 
+namespace
+{
+    // Interface changes are coalesced for this long before emitting signals
+    const std::chrono::milliseconds signalCoalesceTime{250};
+}
+
 void WinNetworkAdapter::setMetricToLowest()
 {
     if (!luid()) return;
@@ -137,10 +144,9 @@ void WINAPI WinInterfaceMonitor::ipChangeCallback(PVOID callerContext,
     // Signal all changes with configChanged().  This is used to detect DNS
     // configuration changes due to changing networks; there's no way to be
     // notified about DNS changes specifically.  We don't know what changes may
-    // have affected DNS, so indicate any change.
-    QMetaObject::invokeMethod(pThis, &WinInterfaceMonitor::configChanged,
-                              Qt::QueuedConnection);
-
+    // have affected DNS, so indicate any change.  (emitSignals() always emits
+    // this.)
+    //
     // Signal any add/delete notification with interfacesChanged().  This is
     // used to indicate that the TAP adapter is missing.
     //
@@ -154,7 +160,12 @@ void WINAPI WinInterfaceMonitor::ipChangeCallback(PVOID callerContext,
         notificationType == MibDeleteInstance ||
         notificationType == MibInitialNotification)
     {
-        QMetaObject::invokeMethod(pThis, &WinInterfaceMonitor::interfacesChanged,
+        pThis->_interfacesChangedPending = true;
+    }
+
+    if(!pThis->_signalsQueued.exchange(true))
+    {
+        QMetaObject::invokeMethod(pThis, &WinInterfaceMonitor::scheduleSignals,
                                   Qt::QueuedConnection);
     }
 }
@@ -245,8 +256,14 @@ WinInterfaceMonitor &WinInterfaceMonitor::instance()
 }
 
 WinInterfaceMonitor::WinInterfaceMonitor()
-    : _ipNotificationHandle{}
+    : _signalsQueued{false}, _interfacesChangedPending{false},
+      _ipNotificationHandle{}
 {
+    _signalDelayTimer.setInterval(signalCoalesceTime);
+    _signalDelayTimer.setSingleShot(true);
+    connect(&_signalDelayTimer, &QTimer::timeout, this,
+            &WinInterfaceMonitor::emitSignals);
+
     auto notifyResult = ::NotifyIpInterfaceChange(AF_UNSPEC, &ipChangeCallback,
                                                   reinterpret_cast<void*>(this),
                                                   TRUE, &_ipNotificationHandle);
@@ -269,3 +286,21 @@ WinInterfaceMonitor::~WinInterfaceMonitor()
     else
         qInfo() << "IP interface change callback was not initialized, nothing to clean up";
 }
+
+void WinInterfaceMonitor::scheduleSignals()
+{
+    // Clear this before checking the timer - any notification after this
+    // point queues another call, so no change can be missed.
+    _signalsQueued = false;
+    // Don't restart the timer if it's already running, so the delay is bounded
+    // even if changes keep occurring.
+    if(!_signalDelayTimer.isActive())
+        _signalDelayTimer.start();
+}
+
+void WinInterfaceMonitor::emitSignals()
+{
+    emit configChanged();
+    if(_interfacesChangedPending.exchange(false))
+        emit interfacesChanged();
+}
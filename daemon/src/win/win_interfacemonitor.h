@@ -24,6 +24,8 @@
 
 #include "../daemon.h" // NetworkAdapter
 #include "win.h"
+#include <QTimer>
+#include <atomic>
 
 class WinNetworkAdapter : public NetworkAdapter
 {
@@ -72,6 +74,10 @@ inline std::ostream &operator<<(std::ostream &os, const WinNetworkAdapter &adapt
 // signal might not notice any change between two consecutive signals, but if
 // they re-check the state of the relevant interface for each signal, they'll
 // always end up observing the correct final state at least once.
+//
+// Notifications are coalesced for a short time before the signals are
+// emitted, so a burst of changes (such as docking a laptop) emits each signal
+// once.
 class WinInterfaceMonitor : public QObject
 {
     Q_OBJECT
@@ -112,6 +118,12 @@ private:
     WinInterfaceMonitor();
     ~WinInterfaceMonitor();
 
+    // Start the coalescing timer if it isn't already running.  Invoked on the
+    // service thread by ipChangeCallback().
+    void scheduleSignals();
+    // Emit the signals for the changes observed since the last emit.
+    void emitSignals();
+
 signals:
     // Any interface change has occurred; including add/delete/configuration
     // changed.
@@ -121,6 +133,13 @@ signals:
     void interfacesChanged();
 
 private:
+    QTimer _signalDelayTimer;
+    // Set by ipChangeCallback() when it has queued a call to
+    // scheduleSignals(), so a burst of notifications only queues one call.
+    std::atomic<bool> _signalsQueued;
+    // Set by ipChangeCallback() when an interface was added or deleted, cleared
+    // when interfacesChanged() is emitted.
+    std::atomic<bool> _interfacesChangedPending;
     HANDLE _ipNotificationHandle;
 };
 
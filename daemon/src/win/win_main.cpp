@@ -31,6 +31,7 @@ void dummyWinMain() {}
 #include <common/src/builtin/path.h>
 #include "win.h"
 #include <common/src/dtop.h>
+#include <common/src/wakeupaccounting.h>
 
 #include <QTextStream>
 
@@ -67,7 +68,7 @@ int main(int argc, char** argv)
         try
         {
             Path::initializePreApp();
-            QCoreApplication app(argc, argv);
+            WakeupAccountingApplication app(argc, argv);
             Path::initializePostApp();
             return WinConsole().run();
         }
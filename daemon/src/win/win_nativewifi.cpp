@@ -59,6 +59,46 @@ void WinLuid::trace(std::ostream &os) const
     os << "-" << _luid.Info.NetLuidIndex;
 }
 
+bool WinNativeWifi::isIgnoredNotification(const WLAN_NOTIFICATION_DATA &data)
+{
+    if(data.NotificationSource == WLAN_NOTIFICATION_SOURCE_ACM)
+    {
+        switch(data.NotificationCode)
+        {
+            // Silently ignore some codes that we definitely don't care about
+            // (and that happen a lot).
+            case wlan_notification_acm_background_scan_enabled:
+            case wlan_notification_acm_background_scan_disabled:
+            case wlan_notification_acm_scan_complete:
+            case wlan_notification_acm_profile_change:
+            case wlan_notification_acm_profiles_exhausted:
+            case wlan_notification_acm_network_not_available:
+            case wlan_notification_acm_network_available:
+            case wlan_notification_acm_scan_list_refresh:
+                return true;
+            default:
+                return false;
+        }
+    }
+    if(data.NotificationSource == WLAN_NOTIFICATION_SOURCE_MSM)
+    {
+        switch(data.NotificationCode)
+        {
+            // Ignore some common notifications that we definitely don't care
+            // about
+            case wlan_notification_msm_signal_quality_change:
+            case wlan_notification_msm_radio_state_change:
+            case 59:    // Not documented - unclear what this is, but it happens a
+                        // _lot_ - probably some other sort of status update while
+                        // connected.
+                return true;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
 void WINAPI WinNativeWifi::wlanNotificationCallback(PWLAN_NOTIFICATION_DATA pData,
                                                     PVOID pThis)
 {
@@ -69,7 +109,28 @@ void WINAPI WinNativeWifi::wlanNotificationCallback(PWLAN_NOTIFICATION_DATA pDat
         return;
     }
 
-    reinterpret_cast<WinNativeWifi*>(pThis)->handleWlanNotification(*pData);
+    if(isIgnoredNotification(*pData))
+        return;
+
+    // Copy the notification and its payload, and handle it on the object's
+    // thread - the interface state is read on that thread.  (If the object is
+    // destroyed first, the queued call is discarded; closing the client handle
+    // waits for any callbacks in progress.)
+    WinNativeWifi *pWifi = reinterpret_cast<WinNativeWifi*>(pThis);
+    WLAN_NOTIFICATION_DATA data = *pData;
+    std::vector<unsigned char> payload;
+    if(pData->pData && pData->dwDataSize)
+    {
+        const unsigned char *pPayload = reinterpret_cast<const unsigned char*>(pData->pData);
+        payload.assign(pPayload, pPayload + pData->dwDataSize);
+    }
+    QMetaObject::invokeMethod(pWifi,
+        [pWifi, data, payload = std::move(payload)]() mutable
+        {
+            data.pData = payload.empty() ? nullptr : payload.data();
+            data.dwDataSize = static_cast<DWORD>(payload.size());
+            pWifi->handleWlanNotification(data);
+        }, Qt::ConnectionType::QueuedConnection);
 }
 
 WifiHandle WinNativeWifi::createWlanHandle()
@@ -144,8 +205,13 @@ WinNativeWifi::WinNativeWifi()
         addInitialInterface(pItfList->InterfaceInfo[i]);
 }
 
-WinLuid WinNativeWifi::getInterfaceLuid(const GUID &interfaceGuid) const
+WinLuid WinNativeWifi::getInterfaceLuid(const GUID &interfaceGuid)
 {
+    QUuid interfaceUuid{interfaceGuid};
+    auto itLuid = _interfaceLuids.find(interfaceUuid);
+    if(itLuid != _interfaceLuids.end())
+        return itLuid->second;
+
     // Native Wifi gives us the interface GUID; we report interfaces using LUIDs
     // to align with the routing APIs used by WinNetworks.
     WinLuid interfaceLuid{};
@@ -154,8 +220,10 @@ WinLuid WinNativeWifi::getInterfaceLuid(const GUID &interfaceGuid) const
     if(err != NO_ERROR)
     {
         qWarning() << "Unable to find interface LUID interface"
-            << QUuid{interfaceGuid}.toString() << "-" << kapps::core::WinErrTracer{err};
+            << interfaceUuid.toString() << "-" << kapps::core::WinErrTracer{err};
     }
+    else
+        _interfaceLuids.emplace(interfaceUuid, interfaceLuid);
 
     return interfaceLuid;
 }
@@ -261,20 +329,10 @@ void WinNativeWifi::handleAcmNotification(const WinLuid &luid,
     {
         // Trace other codes so in the event that we fail to identify the
         // network state correctly, we can see what events we were getting.
+        // (Codes that happen a lot are dropped by isIgnoredNotification().)
         default:
             qInfo() << "Interface" << luid << "ignored ACM code" << data.NotificationCode;
             break;
-        // Silently ignore some codes that we definitely don't care about (and
-        // that happen a lot).
-        case wlan_notification_acm_background_scan_enabled:
-        case wlan_notification_acm_background_scan_disabled:
-        case wlan_notification_acm_scan_complete:
-        case wlan_notification_acm_profile_change:
-        case wlan_notification_acm_profiles_exhausted:
-        case wlan_notification_acm_network_not_available:
-        case wlan_notification_acm_network_available:
-        case wlan_notification_acm_scan_list_refresh:
-            break;
         case wlan_notification_acm_disconnecting:
         {
             // An interface is disconnecting, it is no longer associated.
@@ -397,6 +455,10 @@ void WinNativeWifi::handleAcmNotification(const WinLuid &luid,
             // Remove this interface.  It might already be gone if the
             // notification raced with the initial interface dump, in that case
             // there's nothing to do.
+            //
+            // Forget its LUID too; the GUID won't be seen again until it's
+            // re-added.
+            _interfaceLuids.erase(QUuid{data.InterfaceGuid});
             if(_interfaces.erase(luid) > 0)
             {
                 qInfo() << "Interface" << luid << "interface removed";
@@ -426,15 +488,11 @@ void WinNativeWifi::handleMsmNotification(const WinLuid &luid,
     // complete.  These are traced though in case there's some situation found
     // where we do not receive ACM notifications but do receive MSM
     // notifications.
+    //
+    // Common notifications that we don't care about are dropped by
+    // isIgnoredNotification().
     switch(data.NotificationCode)
     {
-        // Ignore some common notifications that we definitely don't care about
-        case wlan_notification_msm_signal_quality_change:
-        case wlan_notification_msm_radio_state_change:
-        case 59:    // Not documented - unclear what this is, but it happens a
-                    // _lot_ - probably some other sort of status update while
-                    // connected.
-            break;
         default:
             qInfo() << "Interface" << luid << "MSM code" << data.NotificationCode;
             break;
@@ -22,7 +22,10 @@
 #include <common/src/common.h>
 #include "win.h"
 #include <common/src/win/win_util.h>
+#include <QUuid>
 #include <Wlanapi.h>
+#include <map>
+#include <vector>
 
 // Close a NativeWifi handle
 struct WinCloseNativeWifi
@@ -74,6 +77,10 @@ namespace std
 
 // WinNativeWifi uses the Native Wifi API to enumerate 802.11 interfaces on the
 // system and determine their current states.
+//
+// The state is loaded once, then kept up to date by Native Wifi notifications,
+// so interfaces() just reads the state from memory.  Notifications are
+// received on a Native Wifi thread and handled on WinNativeWifi's thread.
 class WinNativeWifi : public QObject
 {
     Q_OBJECT
@@ -102,6 +109,9 @@ public:
 
     using InterfaceMap = std::unordered_map<WinLuid, WifiStatus>;
 private:
+    // Check if a notification can be ignored entirely.  Some notifications
+    // occur very frequently, these are dropped on the Native Wifi thread.
+    static bool isIgnoredNotification(const WLAN_NOTIFICATION_DATA &data);
     // Static notification callback passed to Win32
     static void WINAPI wlanNotificationCallback(PWLAN_NOTIFICATION_DATA pData, PVOID pThis);
 
@@ -114,7 +124,9 @@ public:
     WinNativeWifi();
 
 private:
-    WinLuid getInterfaceLuid(const GUID &interfaceGuid) const;
+    // Get the LUID for an interface GUID.  LUIDs of known interfaces are
+    // cached; converting the GUID requires looking through all interfaces.
+    WinLuid getInterfaceLuid(const GUID &interfaceGuid);
     void addInitialInterface(const WLAN_INTERFACE_INFO &info);
     void handleWlanNotification(const WLAN_NOTIFICATION_DATA &data);
     void handleAcmNotification(const WinLuid &luid,
@@ -137,6 +149,8 @@ public:
     // WiFi interfaces are present, if they're not associated (or we can't
     // detect that they're associated), that's indicated in the WifiStatus.
     InterfaceMap _interfaces;
+    // LUIDs of the interfaces seen, by interface GUID
+    std::map<QUuid, WinLuid> _interfaceLuids;
 };
 
 #endif
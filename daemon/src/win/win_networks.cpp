@@ -23,7 +23,11 @@
 #include "win.h"
 #include <common/src/win/win_util.h>
 #include <QMetaObject>
+#include <QTimer>
 #include <iphlpapi.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
 namespace
 {
@@ -37,6 +41,11 @@ namespace
     template<class MibType>
     using WinMibPtr = WinGenericHandle<MibType*, WinMibDeleter>;
 
+    // Changes are coalesced for this long before re-reading the routing table.
+    // Connecting a dock, etc., produces dozens of route, address, and
+    // interface notifications in a short burst.
+    const std::chrono::milliseconds updateCoalesceTime{250};
+
     QHostAddress parseWinSockaddr(const SOCKADDR_INET &addr)
     {
         return QHostAddress{reinterpret_cast<const sockaddr*>(&addr)};
@@ -66,6 +75,9 @@ public:
     ~WinNetworks();
 
 private:
+    // Start the coalescing timer for a change notification if it isn't
+    // already running.  Invoked on the service thread by queueUpdate().
+    void scheduleUpdate();
     // Read the routing table and report the default IPv4 and IPv6 interfaces.
     std::vector<NetworkConnection> readRoutes();
     // Read the routing table, then emit the new network connections
@@ -83,6 +95,12 @@ private:
     // Our Native Wifi client that reads state from WlanSvc.  This is only
     // present when it's possible to connect to the service.
     nullable_t<WinNativeWifi> _pWifi;
+    // Delays the update after a change notification so a burst of changes
+    // results in one scan of the routing table
+    QTimer _updateDelayTimer;
+    // Set by queueUpdate() on an IPHelper thread when it has queued a call to
+    // scheduleUpdate(), so a burst of notifications only queues one call.
+    std::atomic<bool> _updateQueued;
     HANDLE _routeNotificationHandle, _unicastIpNotificationHandle,
            _ipInterfaceNotificationHandle;
 };
@@ -108,8 +126,22 @@ void WinNetworks::queueUpdate(PVOID callerContext)
 {
     WinNetworks *pThis = reinterpret_cast<WinNetworks*>(callerContext);
     Q_ASSERT(pThis);    // Ensured by ctor
-    QMetaObject::invokeMethod(pThis, &WinNetworks::updateConnections,
-                              Qt::ConnectionType::QueuedConnection);
+    if(!pThis->_updateQueued.exchange(true))
+    {
+        QMetaObject::invokeMethod(pThis, &WinNetworks::scheduleUpdate,
+                                  Qt::ConnectionType::QueuedConnection);
+    }
+}
+
+void WinNetworks::scheduleUpdate()
+{
+    // Clear this before checking the timer - any notification after this
+    // point queues another call, so no change can be missed.
+    _updateQueued = false;
+    // Don't restart the timer if it's already running; this bounds the delay
+    // even if changes keep occurring.
+    if(!_updateDelayTimer.isActive())
+        _updateDelayTimer.start();
 }
 
 void WINAPI WinNetworks::routeChangeCallback(PVOID callerContext,
@@ -166,6 +198,7 @@ void WINAPI WinNetworks::ipInterfaceChangeCallback(PVOID callerContext,
 
 WinNetworks::WinNetworks()
     : _wlanSvcState{L"WlanSvc", 0}, // We don't need any start/stop rights
+      _updateQueued{false},
       _routeNotificationHandle{}, _unicastIpNotificationHandle{},
       _ipInterfaceNotificationHandle{}
 {
@@ -176,6 +209,11 @@ WinNetworks::WinNetworks()
     // Postcondition of WinServiceState::WinServiceState()
     Q_ASSERT(_wlanSvcState.lastState() != WinServiceState::State::Running);
 
+    _updateDelayTimer.setInterval(updateCoalesceTime);
+    _updateDelayTimer.setSingleShot(true);
+    connect(&_updateDelayTimer, &QTimer::timeout, this,
+            &WinNetworks::updateConnections);
+
     // We don't need initial callbacks for any of these notifications - we just
     // scan the routing table once after initializing
     auto notifyResult = ::NotifyRouteChange2(AF_UNSPEC, &WinNetworks::routeChangeCallback,
@@ -209,6 +247,10 @@ WinNetworks::~WinNetworks()
 {
     if(_routeNotificationHandle)
         ::CancelMibChangeNotify2(_routeNotificationHandle);
+    if(_unicastIpNotificationHandle)
+        ::CancelMibChangeNotify2(_unicastIpNotificationHandle);
+    if(_ipInterfaceNotificationHandle)
+        ::CancelMibChangeNotify2(_ipInterfaceNotificationHandle);
 }
 
 std::vector<NetworkConnection> WinNetworks::readRoutes()
@@ -459,11 +501,19 @@ std::vector<NetworkConnection> WinNetworks::readRoutes()
         }
     }
 
+    // Interfaces were collated in an unordered map, so sort the connections.
+    // NetworkMonitor only emits a change when the connections differ from the
+    // last scan; this ensures a scan that finds the same connections isn't
+    // reported as a change.
+    std::sort(connections.begin(), connections.end());
+
     return connections;
 }
 
 void WinNetworks::updateConnections()
 {
+    // Nothing is pending now, even if this update was triggered some other way
+    _updateDelayTimer.stop();
     try
     {
         updateNetworks(readRoutes());
@@ -484,6 +534,10 @@ void WinNetworks::connectNativeWifi()
     {
         qInfo() << "Connect to Native Wifi now, service is up";
         _pWifi.emplace();
+        // Wi-Fi state changes (like the SSID) don't necessarily change routes
+        // or interfaces, rescan when they change too.
+        connect(&_pWifi.get(), &WinNativeWifi::interfacesChanged, this,
+                &WinNetworks::scheduleUpdate);
     }
     catch(const Error &ex)
     {
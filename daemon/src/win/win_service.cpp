@@ -21,6 +21,7 @@
 
 #include "win_service.h"
 #include <common/src/builtin/path.h>
+#include <common/src/wakeupaccounting.h>
 #include "win.h"
 #include "brand.h"
 #include "../../../extras/installer/win/service_inl.h"
@@ -55,7 +56,7 @@ static void serviceMain(int argc, wchar_t** argv)
         // Note: argc and argv are actually picked up with GetCommandLine()
         // on Windows to get the proper unicode, so pass dummy values here.
         int c = 1; char* v = new char(1);
-        QCoreApplication app(c, &v);
+        WakeupAccountingApplication app(c, &v);
 
         Path::initializePostApp();
         Logger logSingleton{Path::DaemonLogFile};
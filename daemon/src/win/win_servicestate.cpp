@@ -129,6 +129,29 @@ namespace
     };
 }
 
+auto WinServiceState::stateFromScm(DWORD scmState) -> State
+{
+    switch(scmState)
+    {
+        case SERVICE_CONTINUE_PENDING:
+            return State::ContinuePending;
+        case SERVICE_PAUSE_PENDING:
+            return State::PausePending;
+        case SERVICE_PAUSED:
+            return State::Paused;
+        case SERVICE_RUNNING:
+            return State::Running;
+        case SERVICE_START_PENDING:
+            return State::StartPending;
+        case SERVICE_STOP_PENDING:
+            return State::StopPending;
+        case SERVICE_STOPPED:
+            return State::Stopped;
+        default:
+            return State::Initializing;
+    }
+}
+
 void CALLBACK WinServiceState::serviceNotifyCallback(void *pParam)
 {
     WinServiceState *pThis{nullptr};
@@ -184,6 +207,7 @@ void WinServiceState::startNotifications()
 {
     // If we can't initialize, we'll consider the service deleted
     _lastState = State::Deleted;
+    _lastPid = 0;
 
     _scm.reset(::OpenSCManagerW(nullptr, nullptr, SC_MANAGER_ENUMERATE_SERVICE));
     if(!_scm)
@@ -206,6 +230,26 @@ void WinServiceState::startNotifications()
         return;
     }
 
+    // Load the current state now, so lastState() is accurate as soon as the
+    // service is open - a start/stop right after opening the service doesn't
+    // have to wait for the first notification.  (The first notification
+    // normally reports this same state, which is ignored as a duplicate.)
+    SERVICE_STATUS_PROCESS status{};
+    DWORD statusSize{0};
+    State initialState{State::Initializing};
+    if(::QueryServiceStatusEx(_service, SC_STATUS_PROCESS_INFO,
+                              reinterpret_cast<LPBYTE>(&status),
+                              sizeof(status), &statusSize))
+    {
+        initialState = stateFromScm(status.dwCurrentState);
+    }
+    else
+    {
+        kapps::core::WinErrTracer error{::GetLastError()};
+        qWarning() << "Unable to query initial state of service" << _serviceName
+            << "- wait for notification:" << error;
+    }
+
     // Start the first notification request.
     if(!requestNotifications())
     {
@@ -218,10 +262,17 @@ void WinServiceState::startNotifications()
     }
 
     // Otherwise, if requestNotifications() requested a notification
-    // successfully, go to the Initializing state.  (If it couldn't request a
-    // notification, we're hosed and consider the service deleted.)
+    // successfully, go to the initial state, or Initializing if it couldn't be
+    // loaded.  (If it couldn't request a notification, we're hosed and
+    // consider the service deleted.)
     if(_pScmNotify)
-        _lastState = State::Initializing;
+    {
+        _lastState = initialState;
+        if(initialState != State::Initializing)
+            _lastPid = status.dwProcessId;
+        qInfo() << "Service" << _serviceName << "is initially"
+            << traceEnum(_lastState) << "(pid" << _lastPid << ")";
+    }
 }
 
 bool WinServiceState::requestNotifications()
@@ -313,35 +364,12 @@ void WinServiceState::serviceChanged(const WinServiceNotify &notify)
 
     // Check the new state.  Avoid tracing duplicate notifications, these occur
     // a lot.
-    State newState = State::Initializing;
-    switch(notify.ServiceStatus.dwCurrentState)
+    State newState = stateFromScm(notify.ServiceStatus.dwCurrentState);
+    if(newState == State::Initializing)
     {
-        case SERVICE_CONTINUE_PENDING:
-            newState = State::ContinuePending;
-            break;
-        case SERVICE_PAUSE_PENDING:
-            newState = State::PausePending;
-            break;
-        case SERVICE_PAUSED:
-            newState = State::Paused;
-            break;
-        case SERVICE_RUNNING:
-            newState = State::Running;
-            break;
-        case SERVICE_START_PENDING:
-            newState = State::StartPending;
-            break;
-        case SERVICE_STOP_PENDING:
-            newState = State::StopPending;
-            break;
-        case SERVICE_STOPPED:
-            newState = State::Stopped;
-            break;
-        default:
-            qWarning() << "Unexpected service state"
-                << notify.ServiceStatus.dwCurrentState << "for service"
-                << _serviceName;
-            break;
+        qWarning() << "Unexpected service state"
+            << notify.ServiceStatus.dwCurrentState << "for service"
+            << _serviceName;
     }
 
     // Ignore duplicate changes, or unknown states (represented here by
@@ -361,9 +389,8 @@ void WinServiceState::serviceChanged(const WinServiceNotify &notify)
         qWarning() << "Couldn't request notifications for" << _serviceName
             << "due to client lagging, try to reinitialize";
         startNotifications();
-        // This updates the state to either Deleted or Initializing, emit the
-        // change
-        emit stateChanged(_lastState, 0);
+        // This reloads the state (or goes to Deleted), emit the change
+        emit stateChanged(_lastState, _lastPid);
     }
     // Otherwise, if requestNotifications() wasn't able to start a notification
     // we're hosed, go to the Deleted state
@@ -63,12 +63,18 @@ public:
     Q_ENUM(State);
 
 private:
+    // Get the State for an SCM SERVICE_* state, or Initializing if it's not
+    // known
+    static State stateFromScm(DWORD scmState);
     static void CALLBACK serviceNotifyCallback(void *pParam);
 
 public:
     // Open and monitor the service specified by serviceName.  The initial state
-    // is always Initializing or Deleted, any other state is reported
-    // asynchronously.
+    // is loaded when the service is opened, so lastState() is immediately
+    // accurate; changes after that are reported asynchronously.  The initial
+    // state is Deleted if the service can't be opened, or Initializing if the
+    // state couldn't be loaded (it's then reported by the first
+    // notification).
     //
     // The start/stop rights desired can be specified; by default both start and
     // stop are requested.  Occasionally, some rights may need to be omitted to
@@ -86,7 +92,8 @@ public:
 
 private:
     // Open SCM, the service, and start notifications.  This updates _lastState
-    // to either Deleted or Initializing (but does not emit stateChanged).
+    // to the initial state, Initializing, or Deleted (but does not emit
+    // stateChanged).
     void startNotifications();
 
     // Request service change notifications from SCM using
@@ -36,6 +36,13 @@ namespace
     constexpr const char *rawInterfaceName{"wg" BRAND_CODE "0"};
     static_assert(literalLength(rawInterfaceName) < sizeof(wg_device::name)-1,
                   "Brand code is too long - Wireguard interface name exceeds IFNAMESIZ");
+
+    // Handshake polling starts with this interval, and the interval grows with
+    // each poll up to the maximum.  The first handshake normally takes about
+    // one round trip to the server, so early polls are the most likely to
+    // find it.
+    const std::chrono::milliseconds handshakePollInitial{10};
+    const std::chrono::milliseconds handshakePollMax{200};
 }
 
 WgDevStatus::WgDevStatus(const wg_device &dev)
@@ -95,14 +102,80 @@ wg_allowedip &WgDevStatus::addAllowedIp(const wg_allowedip &allowedIp)
     return *_dev.last_peer->last_allowedip;
 }
 
+void WgDevStatus::clear()
+{
+    _dev = {};
+    _peers.clear();
+    _allowedIps.clear();
+}
+
 const QLatin1String WireguardBackend::interfaceName{rawInterfaceName};
 
+WireguardBackend::WireguardBackend()
+    : _handshakePollInterval{handshakePollInitial}, _handshakeWatchId{0}
+{
+    _handshakePollTimer.setSingleShot(true);
+    connect(&_handshakePollTimer, &QTimer::timeout, this,
+            &WireguardBackend::pollHandshake);
+}
+
 void WireguardBackend::raiseError(const Error &err)
 {
     qWarning() << "WireGuard backend error:" << err;
     emit error(err);
 }
 
+Async<void> WireguardBackend::reconfigure(const wg_device &)
+{
+    return Async<void>::reject({HERE, Error::Code::WireguardConfigDeviceFailed});
+}
+
+void WireguardBackend::pollHandshake()
+{
+    getStatus()
+        .timeout(handshakePollMax)
+        ->notify(this, [this, watchId = _handshakeWatchId](const Error &err, const WgDevPtr &pDev)
+        {
+            // Ignore the result if the watch was stopped or restarted
+            if(watchId != _handshakeWatchId)
+                return;
+
+            // Errors are normal here if the device isn't fully up yet; keep
+            // polling.  WireguardMethod applies the handshake timeout.
+            if(!err && pDev)
+            {
+                for(auto pPeer = pDev->first_peer; pPeer; pPeer = pPeer->next_peer)
+                {
+                    if(pPeer->last_handshake_time.tv_sec ||
+                       pPeer->last_handshake_time.tv_nsec)
+                    {
+                        ++_handshakeWatchId;
+                        emit handshakeCompleted(pDev);
+                        return;
+                    }
+                }
+            }
+
+            _handshakePollInterval = std::min(_handshakePollInterval * 2,
+                                              handshakePollMax);
+            _handshakePollTimer.start(msec32(_handshakePollInterval));
+        });
+}
+
+void WireguardBackend::watchFirstHandshake()
+{
+    stopHandshakeWatch();
+    _handshakePollInterval = handshakePollInitial;
+    pollHandshake();
+}
+
+void WireguardBackend::stopHandshakeWatch()
+{
+    _handshakePollTimer.stop();
+    // Discard any poll still in flight
+    ++_handshakeWatchId;
+}
+
 QString wgKeyToB64(const wg_key &key)
 {
     auto base64Ascii = QByteArray::fromRawData(reinterpret_cast<const char*>(&key[0]), sizeof(key)).toBase64();
@@ -23,6 +23,7 @@
 #define WIREGUARD_BACKEND_H
 
 #include <QHostAddress>
+#include <QTimer>
 #include <common/src/async.h>
 #include "vpn.h"
 #include <deque>
@@ -68,6 +69,9 @@ public:
     // Add an allowed IP to the end of the last peer
     // There must be at least one peer
     wg_allowedip &addAllowedIp(const wg_allowedip &allowedip);
+    // Reset the device and remove all peers and allowed IPs.  The storage
+    // may be kept, so a WgDevStatus can be reused for repeated status polls.
+    void clear();
 
 private:
     wg_device _dev;
@@ -108,6 +112,7 @@ public:
     using WgDevPtr = std::shared_ptr<wg_device>;
 
 public:
+    WireguardBackend();
     // shutdown() will be called before destroying the backend to permit
     // asynchronous shutdown (even if createInterface() was not called or
     // failed), but the backend will still be destroyed if the shutdown task
@@ -118,6 +123,9 @@ protected:
     // Inform WireguardMethod that an error occurred
     void raiseError(const Error &err);
 
+private:
+    void pollHandshake();
+
 public:
     // Create and configure the Wireguard interface with the given Wireguard
     // device configuration, and peer IP/mask.
@@ -159,8 +167,42 @@ public:
     // If shutdown times out, or the task is rejected, the backend will still be
     // destroyed.
     virtual Async<void> shutdown() = 0;
+
+    // Whether reconfigure() is supported by this backend
+    virtual bool canReconfigure() const {return false;}
+    // Apply a new device configuration to the interface created by
+    // createInterface(), keeping the interface up.  This is used to switch to
+    // another server without recreating the interface; wgDev replaces the
+    // peers like the configuration given to createInterface().
+    //
+    // The default implementation rejects; backends that can configure a live
+    // device override this and canReconfigure().
+    virtual Async<void> reconfigure(const wg_device &wgDev);
+
+    // Watch for the first handshake once createInterface() has resolved.
+    // handshakeCompleted() is emitted as soon as a handshake is observed.
+    //
+    // None of the interfaces we use to talk to WireGuard push handshake events
+    // (the kernel's netlink family has no multicast group, and UAPI / the
+    // Windows service only answer requests), so the default implementation
+    // polls getStatus().  It polls very frequently at first, since the
+    // handshake usually completes within one round trip, then backs off.  A
+    // backend that can be notified of handshakes can override this.
+    virtual void watchFirstHandshake();
+    // Stop watching for the first handshake, if watching.
+    virtual void stopHandshakeWatch();
+
 signals:
     void error(const Error &err);
+    // A peer handshake was observed by watchFirstHandshake().  pDev is the
+    // device status that showed the handshake.
+    void handshakeCompleted(const WgDevPtr &pDev);
+
+private:
+    QTimer _handshakePollTimer;
+    std::chrono::milliseconds _handshakePollInterval;
+    // Incremented when the watch stops, so results of stale polls are ignored
+    unsigned _handshakeWatchId;
 };
 
 // Encode a WireGuard key in base64.
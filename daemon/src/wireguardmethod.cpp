@@ -27,7 +27,9 @@
 #include <common/src/exec.h>
 #include <common/src/openssl.h>
 #include <common/src/builtin/path.h>
+#include <common/src/wakeupaccounting.h>
 #include "pathmtu.h"
+#include "tunnelprober.h"
 #include <QTimer>
 #include <QRandomGenerator>
 #include <cstring>
@@ -72,12 +74,13 @@ namespace
     // Mac/Linux.
     const std::chrono::seconds createInterfaceTimeout{25};
 #endif
-    // Interval of checks for the first handshake - should be much faster than
-    // the stat interval to detect the handshake promptly
-    const std::chrono::milliseconds firstHandshakeInterval{200};
     // If the first handshake doesn't occur for this long after the interface is
     // up, the connection is failed.
     const std::chrono::seconds firstHandshakeTimeout{10};
+    // When resuming an interface parked for sleep, the server already knows
+    // the key, so a handshake should occur within a round trip or two.  Fall
+    // back to a normal reconnect quickly if it doesn't.
+    const std::chrono::seconds resumeHandshakeTimeout{3};
 
     // Fetching stats must complete within this timeout
     const std::chrono::seconds statFetchTimeout{1};
@@ -100,6 +103,27 @@ namespace
     // After 1 minute though, if we haven't shut down, we time out to avoid
     // getting completely stuck.
     const std::chrono::minutes shutdownTimeout{1};
+
+    // Keys registered ahead of time (or by a previous connection) are reused
+    // for this long.  Servers keep keys for much longer than this, even when
+    // they're not in use.  Pre-registration is repeated for a server once its
+    // result reaches half of this age, so the key rotates.
+    const std::chrono::minutes preauthTtl{5};
+
+    // A parked interface is torn down if the next connection doesn't take it
+    // within this time.  The next connection normally takes it within a
+    // couple of seconds (after authenticating with the new server).
+    const std::chrono::seconds handoffParkTimeout{30};
+
+    // The credential used to authenticate with a WireGuard server - the token
+    // for normal regions, or the username and password for dedicated IPs.  A
+    // preauthenticated key is only used with the same credential.
+    QString authCredential(const ConnectionConfig &config)
+    {
+        if(!config.vpnToken().isEmpty())
+            return config.vpnToken();
+        return config.vpnUsername() + QChar{'\n'} + config.vpnPassword();
+    }
 }
 
 class WireguardKeypair
@@ -125,6 +149,17 @@ private:
     wg_key _privateKey, _publicKey;
 };
 
+struct WireguardPreauth::Entry
+{
+    WireguardKeypair _keypair;
+    QJsonDocument _result;
+    QString _serverIp;
+    QString _commonName;
+    QString _credential;
+    // Time since the key was registered
+    QElapsedTimer _age;
+};
+
 // WireguardMethod is a VPNMethod that connects with Wireguard using any
 // WireguardBackend.
 class WireguardMethod : public VPNMethod
@@ -146,8 +181,23 @@ private:
 public:
     static void cleanup();
 
+    // Tear down the routes and DNS configuration for an interface - used when
+    // deleting the interface, and for a parked interface that isn't taken.
+    static void teardownHostConfig(const QHostAddress &vpnHost);
+
+    // Validate the server and send an addKey request for this keypair.  Used
+    // both when connecting and by WireguardPreauth.  Throws if the server or
+    // config is not valid.
+    static Async<QJsonDocument> requestAddKey(const ConnectionConfig &config,
+                                              const Server &vpnServer,
+                                              const WireguardKeypair &clientKeypair);
+    // Parse and validate an addKey result.  Throws if it is not valid.
+    static AuthResult parseAuthResult(const QJsonDocument &result);
+
 public:
-    WireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan);
+    WireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan,
+                    std::shared_ptr<WireguardPreauth> pPreauth,
+                    std::shared_ptr<WireguardHandoff> pHandoff);
     ~WireguardMethod() override;
 
 private:
@@ -156,7 +206,6 @@ private:
 
     void handleAuthResult(const WireguardKeypair &clientKeypair,
                           const QJsonDocument &result);
-    AuthResult parseAuthResult(const QJsonDocument &result);
     void createInterface(const WireguardKeypair &clientKeypair,
                          const AuthResult &authResult);
 
@@ -169,6 +218,21 @@ private:
     void finalizeInterface(const QString &deviceName,
                            const AuthResult &authResult);
 
+    // Switch a parked interface to the new server - applies the new peer
+    // through the backend, then updates the host configuration.
+    void switchInterface(const wg_device &wgDev, const AuthResult &authResult,
+                         std::shared_ptr<WireguardHandoff::Interface> pParked);
+    // Like finalizeInterface(), but only changes the addresses, routes, and
+    // DNS that differ from the parked interface's configuration.
+    void updateInterface(const WireguardHandoff::Interface &parked,
+                         const AuthResult &authResult);
+    // Park the interface for the next connection if a switch is expected and
+    // the backend supports it.  Returns true if it was parked.
+    bool parkInterface();
+
+    // The interface is configured, wait for the first handshake
+    void startHandshakeWatch();
+
     // Bring up DNS on MacOs/Linux
     bool setupPosixDNS(const QString &deviceName, const QStringList &dnsServers);
 
@@ -186,15 +250,14 @@ private:
    // abandon threshold
     void checkPeerHandshake(const wg_device &dev);
 
-    void checkFirstHandshake();
+    // The first handshake didn't occur within firstHandshakeTimeout
+    void firstHandshakeTimedOut();
 
     // Update stats with the latest information from the adapter
     void updateStats();
 
-    // Ping the endpoint
-    void pingEndpoint();
-
-    // Verify that pings are hitting endpoiint
+    // Verify that data is still being received, and probe the tunnel if it
+    // isn't
     void checkPing(const quint64 &rx, const quint64 &tx);
 
     void checkDNS();
@@ -223,6 +286,16 @@ private:
     kapps::net::Fwmark _fwmark;
 #endif
 
+    // Pre-registered keys shared with VPNConnection, and the key/auth result
+    // used by this connection (kept there once connected)
+    std::shared_ptr<WireguardPreauth> _pPreauth;
+    std::shared_ptr<WireguardPreauth::Entry> _pAuthEntry;
+    // The key used once connected, kept with the interface if it's parked for
+    // resume after sleep
+    std::shared_ptr<WireguardPreauth::Entry> _pConnectedEntry;
+    // Interface kept up between connections when switching servers (shared
+    // with VPNConnection)
+    std::shared_ptr<WireguardHandoff> _pHandoff;
     // Authentication API request - set once the request is started (remains set
     // after that).
     Async<void> _pAuthRequest;
@@ -230,10 +303,10 @@ private:
     // when we shut down
     std::unique_ptr<WireguardBackend> _pBackend;
     std::shared_ptr<NetworkAdapter> _pNetworkAdapter;
-    // Elapsed time while checking for the first handshake
+    // Elapsed time while waiting for the first handshake
     QElapsedTimer _firstHandshakeElapsed;
-    // First handshake timer - used to check frequently for the first handshake
-    // until firstHandshakeTimeout elapses
+    // First handshake timer - fails the connection if the backend doesn't
+    // observe a handshake within firstHandshakeTimeout
     QTimer _firstHandshakeTimer;
     // Stats timer - started when WG interface is configured
     QTimer _statsTimer;
@@ -241,20 +314,36 @@ private:
     ConnectionConfig _connectionConfig;
     // The address of the VPN host
     QHostAddress _vpnHost;
+    // The local tunnel address, and the maximum MTU found for the VPN host
+    // (kept when parking the interface)
+    QPair<QHostAddress, int> _peerIpNet;
+    unsigned _maxMtu;
     // Whether routes are up for this connection.  They go up during the
     // Connecting state.  It's possible a network change could occur after
     // routes go up, but before we've reached the Connected state, so we need to
     // be sure we update them in that case.
     bool _routesUp;
 
-    // Number of consecutive intervals with no new data received
-    unsigned _noRxIntervals;
+    // Time spent in consecutive stats intervals with no new data received.
+    // This is accumulated rather than counting intervals, since the stats
+    // interval is scaled by the power policy.
+    std::chrono::milliseconds _noRxTime;
 
     // The last cumulative received byte count
     quint64 _lastReceivedBytes;
 
+    // Throughput diagnostics - the byte counts at the last stats update and the
+    // time since then, used to trace the rate for each interval, and the peak
+    // rates (bytes/second) observed during this connection.
+    quint64 _lastStatRx, _lastStatTx;
+    QElapsedTimer _lastStatElapsed;
+    quint64 _peakRxRate, _peakTxRate;
+
     // The address for the ping endpoint
     QHostAddress _pingEndpointAddress;
+    // Probes _pingEndpointAddress when the tunnel is idle to detect a lost
+    // connection quickly
+    TunnelProber _tunnelProber;
 
     QStringList _dnsServers;
 
@@ -263,22 +352,78 @@ private:
     std::unique_ptr<MtuPinger> _mtuPinger;
 };
 
+struct WireguardHandoff::Interface
+{
+    ~Interface();
+
+    std::unique_ptr<WireguardBackend> _pBackend;
+    std::shared_ptr<NetworkAdapter> _pNetworkAdapter;
+    QString _deviceName;
+    QPair<QHostAddress, int> _peerIpNet;
+    QHostAddress _vpnHost;
+    QHostAddress _pingEndpointAddress;
+    QStringList _dnsServers;
+    unsigned _maxMtu{0};
+    // The configuration used to set up the interface
+    ConnectionConfig _config;
+    // The network at the time the interface was parked
+    OriginalNetworkScan _netScan;
+    // Whether the interface was parked for resume after sleep, and the key it
+    // uses in that case
+    bool _resume{false};
+    std::shared_ptr<WireguardPreauth::Entry> _pAuthEntry;
+};
+
+WireguardHandoff::Interface::~Interface()
+{
+    // Nothing to do if a connection took the interface
+    if(!_pBackend)
+        return;
+
+    qInfo() << "Tearing down parked WireGuard interface" << _deviceName;
+    // The backend is destroyed even if it hasn't finished shutting down, like
+    // when WireguardMethod's shutdown times out.  This must be synchronous,
+    // the next connection may be about to create an interface.
+    _pBackend->shutdown();
+    WireguardMethod::teardownHostConfig(_vpnHost);
+    if(_pNetworkAdapter)
+        _pNetworkAdapter->restoreOriginalMetric();
+    _pBackend.reset();
+}
+
 Executor WireguardMethod::_executor{CURRENT_CATEGORY};
 
-WireguardMethod::WireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan)
+WireguardMethod::WireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan,
+                                 std::shared_ptr<WireguardPreauth> pPreauth,
+                                 std::shared_ptr<WireguardHandoff> pHandoff)
     : VPNMethod{pParent, netScan},
 #if defined(KAPPS_CORE_OS_LINUX)
       _routing{BRAND_CODE},
       _fwmark{BRAND_LINUX_FWMARK_BASE},
 #endif
-      _routesUp{false}, _noRxIntervals{0}, _lastReceivedBytes{0}
+      _pPreauth{std::move(pPreauth)}, _pHandoff{std::move(pHandoff)},
+      _maxMtu{0}, _routesUp{false}, _noRxTime{0}, _lastReceivedBytes{0},
+      _lastStatRx{0}, _lastStatTx{0}, _peakRxRate{0}, _peakTxRate{0}
 {
-    _firstHandshakeTimer.setInterval(msec(firstHandshakeInterval));
+    _firstHandshakeTimer.setSingleShot(true);
+    _firstHandshakeTimer.setInterval(msec(firstHandshakeTimeout));
     connect(&_firstHandshakeTimer, &QTimer::timeout, this,
-        &WireguardMethod::checkFirstHandshake);
-    _statsTimer.setInterval(msec(statsInterval));
+        &WireguardMethod::firstHandshakeTimedOut);
+    g_daemon->powerPolicy().manage(_statsTimer, statsInterval,
+                                   PowerPolicy::Work::Monitor);
+    tagWakeups(_statsTimer, QByteArrayLiteral("wireguard"));
     connect(&_statsTimer, &QTimer::timeout, this,
         &WireguardMethod::updateStats);
+    connect(&_tunnelProber, &TunnelProber::tunnelLost, this, [this]()
+        {
+            // Only meaningful once connected; before that, the first handshake
+            // timeout applies
+            if(state() != State::Connected)
+                return;
+            qWarning() << "Abandoning connection, the tunnel stopped responding after"
+                << traceMsec(_noRxTime) << "with no data";
+            raiseError({HERE, Error::Code::WireguardPingTimeout});
+        });
 }
 
 WireguardMethod::~WireguardMethod()
@@ -328,33 +473,41 @@ void WireguardMethod::teardownPosixDNS()
     _executor.cmdWithEnv(Path::OpenVPNUpDownScript, {}, env);
 }
 
-void WireguardMethod::deleteInterface()
+void WireguardMethod::teardownHostConfig(const QHostAddress &vpnHost)
 {
-    // Routing/DNS cleanup
-    _routesUp = false;
 #if defined(Q_OS_LINUX)
     teardownPosixDNS();
 
     // Remove routing rule for Wireguard (this is safe even if no rule exists)
+    kapps::net::Fwmark fwmark{BRAND_LINUX_FWMARK_BASE};
+    kapps::net::Routing routing{BRAND_CODE};
     _executor.bash(QStringLiteral("ip rule del not from all fwmark %1 lookup %2")
-                   .arg(_fwmark.wireguardFwmark()).arg(QString::fromStdString(_routing.wireguardTable())));
+                   .arg(fwmark.wireguardFwmark()).arg(QString::fromStdString(routing.wireguardTable())));
 
     // Delete the VPN route
     // This route is only created on Linux when _connectionConfig.setDefaultRoute()
     // is false, but there's no harm in attempting to delete it in all cases
-    if(!_vpnHost.isNull())
-        _executor.bash(QStringLiteral("ip route delete %1").arg(_vpnHost.toString()));
+    if(!vpnHost.isNull())
+        _executor.bash(QStringLiteral("ip route delete %1").arg(vpnHost.toString()));
 
 #elif defined(Q_OS_MAC)
     teardownPosixDNS();
 
     // Delete the VPN route
-    if(!_vpnHost.isNull())
-        _executor.bash(QStringLiteral("route delete %1").arg(_vpnHost.toString()));
+    if(!vpnHost.isNull())
+        _executor.bash(QStringLiteral("route delete %1").arg(vpnHost.toString()));
 #elif defined(Q_OS_WIN)
     // Nothing to do on Windows.  The backend takes care of the routes, and
     // destroying the interface takes care of DNS.
+    Q_UNUSED(vpnHost);
 #endif
+}
+
+void WireguardMethod::deleteInterface()
+{
+    // Routing/DNS cleanup
+    _routesUp = false;
+    teardownHostConfig(_vpnHost);
     if(_pNetworkAdapter)
         _pNetworkAdapter->restoreOriginalMetric();
     _pNetworkAdapter.reset();
@@ -367,6 +520,7 @@ void WireguardMethod::handleAuthResult(const WireguardKeypair &clientKeypair,
                                        const QJsonDocument &result)
 {
     auto authResult = parseAuthResult(result);
+    emitPhase(QStringLiteral("authenticated"));
 
     auto serverPubkeyTrace = wgKeyToB64(authResult._serverPubkey);
     qInfo().nospace() << "Server address: " << authResult._serverIp << ":"
@@ -493,21 +647,57 @@ void WireguardMethod::createInterface(const WireguardKeypair &clientKeypair,
     anyIpv4Allowed.ip4.s_addr = 0;
     anyIpv4Allowed.cidr = 0;
 
-    // Create the backend in order to create the interface
+    // If the last connection parked its interface for a server switch, use
+    // it instead of creating a new one
+    std::shared_ptr<WireguardHandoff::Interface> pParked;
+    if(_pHandoff)
+        pParked = _pHandoff->take(_connectionConfig);
+
+    if(pParked && pParked->_resume)
+    {
+        // The routes of an interface parked for sleep refer to the network
+        // at that time; if it changed, create a new interface
+        if(pParked->_netScan != originalNetwork())
+        {
+            qInfo() << "Network changed during sleep, can't resume interface"
+                << pParked->_deviceName;
+            pParked.reset();    // Tears it down
+        }
+        else if(pParked->_vpnHost == authResult._serverIp)
+        {
+            // Resuming with the same server and key.  Give the device a new
+            // listen port so it rebinds its socket - the old one may refer to
+            // a network state from before sleep.  The sessions are reset by
+            // replacing the peer, so this probes with a new handshake.
+            qInfo() << "Resuming interface" << pParked->_deviceName
+                << "with" << authResult._serverIp;
+            wgDev.flags = static_cast<wg_device_flags>(wgDev.flags | WGDEVICE_HAS_LISTEN_PORT);
+            wgDev.listen_port = 0;
+            _firstHandshakeTimer.setInterval(msec(resumeHandshakeTimeout));
+            emitPhase(QStringLiteral("resuming"));
+        }
+    }
+
+    if(pParked)
+        _pBackend = std::move(pParked->_pBackend);
+    else
+    {
+        // Create the backend in order to create the interface
 #if defined(Q_OS_LINUX)
-    // Prefer the kernel backend if it's enabled and available
-    if(_connectionConfig.wireguardUseKernel() && g_state.wireguardKernelSupport())
-        _pBackend.reset(new WireguardKernelBackend{});
+        // Prefer the kernel backend if it's enabled and available
+        if(_connectionConfig.wireguardUseKernel() && g_state.wireguardKernelSupport())
+            _pBackend.reset(new WireguardKernelBackend{});
 #endif
 #if defined(Q_OS_WIN)
-    _pBackend.reset(new WireguardServiceBackend{});
+        _pBackend.reset(new WireguardServiceBackend{});
 #endif
 #if defined(Q_OS_UNIX)
-    // On Linux, the kernel backend is preferred, but if that's not suitable,
-    // use the userspace backend.
-    if(!_pBackend)
-        _pBackend.reset(new WireguardGoBackend{});
+        // On Linux, the kernel backend is preferred, but if that's not
+        // suitable, use the userspace backend.
+        if(!_pBackend)
+            _pBackend.reset(new WireguardGoBackend{_connectionConfig.wireguardGoHighThroughput()});
 #endif
+    }
 
     if(!_pBackend)
     {
@@ -517,16 +707,37 @@ void WireguardMethod::createInterface(const WireguardKeypair &clientKeypair,
 
     connect(_pBackend.get(), &WireguardBackend::error, this,
             &WireguardMethod::raiseError);
+    connect(_pBackend.get(), &WireguardBackend::handshakeCompleted, this,
+            [this](const WireguardBackend::WgDevPtr &pDev)
+            {
+                if(state() != State::Connecting || !pDev || !pDev->first_peer)
+                    return;
+                qInfo() << "First handshake observed after"
+                    << traceMsec(_firstHandshakeElapsed.elapsed());
+                checkPeerHandshake(*pDev);
+            });
 
     // Persist the VPN host IP
     _vpnHost = authResult._serverIp;
 
     // Ping the server's virtual IP to test connectivity
     _pingEndpointAddress = authResult._serverVirtualIp;
+    _tunnelProber.endpoint(_pingEndpointAddress);
 
     // Reset to 0 before connect
-    _noRxIntervals = 0;
+    _noRxTime = {};
     _lastReceivedBytes = 0;
+    _lastStatRx = 0;
+    _lastStatTx = 0;
+    _lastStatElapsed.invalidate();
+    _peakRxRate = 0;
+    _peakTxRate = 0;
+
+    if(pParked)
+    {
+        switchInterface(wgDev, authResult, std::move(pParked));
+        return;
+    }
 
     // Create the device; this throws if the device can't be created.
     // The backend may modify wgDev, we don't use it after this point.
@@ -553,6 +764,8 @@ void WireguardMethod::createInterface(const WireguardKeypair &clientKeypair,
             // handshake timer
             Q_ASSERT(state() == State::Connecting);
 
+            emitPhase(QStringLiteral("interfaceCreated"));
+
             // The interface is up, store the NetworkAdapter
             _pNetworkAdapter = pDevice;
             _pNetworkAdapter->setMetricToLowest();
@@ -561,14 +774,66 @@ void WireguardMethod::createInterface(const WireguardKeypair &clientKeypair,
 
             // Bring up the interface and configure routing and DNS
             finalizeInterface(pDevice->devNode(), authResult);
+            emitPhase(QStringLiteral("interfaceConfigured"));
 
-            // We're not "connected" yet - wait for a handshake to complete
-            _firstHandshakeElapsed.start();
-            _firstHandshakeTimer.start();
-            _statsTimer.start();
+            startHandshakeWatch();
         });
 }
 
+void WireguardMethod::switchInterface(const wg_device &wgDev,
+                                      const AuthResult &authResult,
+                                      std::shared_ptr<WireguardHandoff::Interface> pParked)
+{
+    qInfo() << "Switching interface" << pParked->_deviceName << "from"
+        << pParked->_vpnHost << "to" << authResult._serverIp;
+
+    // This connection owns the interface now, so its routes are torn down
+    // by deleteInterface() if anything fails.  Until updateInterface(), they
+    // still refer to the last server.
+    _pNetworkAdapter = pParked->_pNetworkAdapter;
+    _vpnHost = pParked->_vpnHost;
+    _peerIpNet = pParked->_peerIpNet;
+    _routesUp = true;
+
+    _pBackend->reconfigure(wgDev)
+        .timeout(createInterfaceTimeout)
+        ->notify(this, [this, authResult, pParked](const Error &err)
+        {
+            if(err)
+            {
+                qWarning() << "Could not switch interface:" << err;
+                raiseError(err);
+                return;
+            }
+
+            if(state() >= State::Exiting)
+            {
+                qWarning() << "Ignoring switch result, already advanced to state"
+                    << traceEnum(state());
+                return;
+            }
+            Q_ASSERT(state() == State::Connecting);
+
+            emitPhase(QStringLiteral("interfaceSwitched"));
+            // The firewall still has to be updated for the new server
+            emitFirewallParamsChanged();
+
+            updateInterface(*pParked, authResult);
+            emitPhase(QStringLiteral("interfaceConfigured"));
+
+            startHandshakeWatch();
+        });
+}
+
+void WireguardMethod::startHandshakeWatch()
+{
+    // We're not "connected" yet - wait for a handshake to complete
+    _firstHandshakeElapsed.start();
+    _firstHandshakeTimer.start();
+    _pBackend->watchFirstHandshake();
+    _statsTimer.start();
+}
+
 unsigned WireguardMethod::findMaxMtu(const QHostAddress &host)
 {
     int mtu = 0;
@@ -606,6 +871,8 @@ void WireguardMethod::finalizeInterface(const QString &deviceName, const AuthRes
     // the fwmark applied by WireGuard, so it would incorrectly detect the
     // WireGuard interface once it is up.
     int maxMtu = findMaxMtu(authResult._serverIp);
+    _maxMtu = maxMtu;
+    _peerIpNet = peerIpNet;
 
 // OS specific interface config (including DNS and routing)
 #if defined(Q_OS_LINUX)
@@ -804,7 +1071,8 @@ void WireguardMethod::finalizeInterface(const QString &deviceName, const AuthRes
     qInfo() << "MTU config:" << _connectionConfig.mtu()
         << " - calculated tunnel MTU to VPN host" << authResult._serverIp << ":"
         << maxMtu;
-    _mtuPinger.reset(new MtuPinger{_pNetworkAdapter, maxMtu, _connectionConfig.mtu()});
+    _mtuPinger.reset(new MtuPinger{_pNetworkAdapter, maxMtu, _connectionConfig.mtu(),
+                                   QStringLiteral("wireguard/") + authResult._serverIp.toString()});
 
     // Routes are up, if a network change occurs, update the routes
     _routesUp = true;
@@ -813,6 +1081,135 @@ void WireguardMethod::finalizeInterface(const QString &deviceName, const AuthRes
                             authResult._serverVirtualIp.toString());
 }
 
+void WireguardMethod::updateInterface(const WireguardHandoff::Interface &parked,
+                                      const AuthResult &authResult)
+{
+    TraceStopwatch stopwatch{"Updating WireGuard interface"};
+
+    const OriginalNetworkScan &netScan = originalNetwork();
+    const QString &deviceName = parked._deviceName;
+    const auto &peerIpNet = authResult._peerIpNet;
+    if(_connectionConfig.setDefaultDns())
+        _dnsServers = _connectionConfig.getDnsServers();
+
+    // findMaxMtu() can't be used now that the interface is up (see
+    // finalizeInterface()).  The physical interface hasn't changed (a network
+    // change would have been observed), so the last result still applies.
+    _maxMtu = parked._maxMtu;
+    _peerIpNet = peerIpNet;
+
+    // DNS servers to stop and start routing into the tunnel
+    QStringList removedDns, addedDns;
+    if(_connectionConfig.setDefaultDns())
+    {
+        for(const auto &dnsServer : parked._dnsServers)
+        {
+            if(!_dnsServers.contains(dnsServer) &&
+               !kapps::core::Ipv4Address{dnsServer.toStdString()}.isLocalDNS())
+                removedDns.push_back(dnsServer);
+        }
+        for(const auto &dnsServer : _dnsServers)
+        {
+            if(!parked._dnsServers.contains(dnsServer) &&
+               !kapps::core::Ipv4Address{dnsServer.toStdString()}.isLocalDNS())
+                addedDns.push_back(dnsServer);
+        }
+    }
+
+#if defined(Q_OS_LINUX)
+    // Add the new address before removing the old one so the interface is
+    // never without an address
+    if(peerIpNet != parked._peerIpNet)
+    {
+        if(_executor.bash(QStringLiteral("ip addr add %1/%2 dev %3")
+            .arg(peerIpNet.first.toString())
+            .arg(peerIpNet.second)
+            .arg(deviceName)))
+        {
+            throw Error{HERE, Error::Code::WireguardConfigDeviceFailed};
+        }
+        _executor.bash(QStringLiteral("ip addr del %1/%2 dev %3")
+            .arg(parked._peerIpNet.first.toString())
+            .arg(parked._peerIpNet.second)
+            .arg(deviceName));
+    }
+
+    // The routing rule and default route don't depend on the server.  Only
+    // the VPN host route does, if the VPN isn't the default route.
+    if(!_connectionConfig.setDefaultRoute() && parked._vpnHost != authResult._serverIp)
+    {
+        _executor.bash(QStringLiteral("ip route delete %1").arg(parked._vpnHost.toString()));
+        if(netScan.ipv4Valid())
+            _executor.bash(QStringLiteral("ip route add %1 via %2").arg(authResult._serverIp.toString(), QString::fromStdString(netScan.gatewayIp())));
+        else
+            qInfo() << "Can't create VPN host route yet, original gateway not known";
+    }
+
+    // Route virtual server IP (ping endpoint) through VPN
+    if(_pingEndpointAddress != parked._pingEndpointAddress)
+    {
+        _executor.bash(QStringLiteral("ip route add %1 dev %2").arg(_pingEndpointAddress.toString(), deviceName));
+        _executor.bash(QStringLiteral("ip route del %1 dev %2").arg(parked._pingEndpointAddress.toString(), deviceName));
+    }
+
+    for(const auto &dnsServer : addedDns)
+        _executor.bash(QStringLiteral("ip route add %1 dev %2").arg(dnsServer, deviceName));
+    for(const auto &dnsServer : removedDns)
+        _executor.bash(QStringLiteral("ip route del %1 dev %2").arg(dnsServer, deviceName));
+
+    if(_connectionConfig.setDefaultDns() && _dnsServers != parked._dnsServers)
+    {
+        if(!setupPosixDNS(deviceName, _dnsServers))
+            raiseError(Error(HERE, Error::OpenVPNDNSConfigError));
+    }
+#elif defined(Q_OS_MACOS)
+    if(peerIpNet != parked._peerIpNet)
+    {
+        _executor.bash(QStringLiteral("ifconfig %1 inet %2/%3 %2 alias").arg(deviceName, peerIpNet.first.toString(), QString::number(peerIpNet.second)));
+        _executor.bash(QStringLiteral("ifconfig %1 inet %2 -alias").arg(deviceName, parked._peerIpNet.first.toString()));
+    }
+
+    if(!_connectionConfig.setDefaultRoute() && _pingEndpointAddress != parked._pingEndpointAddress)
+    {
+        _executor.bash(QStringLiteral("route -q -n add %1 -interface %2").arg(_pingEndpointAddress.toString(), deviceName));
+        _executor.bash(QStringLiteral("route -q -n delete %1 -interface %2").arg(parked._pingEndpointAddress.toString(), deviceName));
+    }
+
+    if(parked._vpnHost != authResult._serverIp)
+    {
+        _executor.bash(QStringLiteral("route delete %1").arg(parked._vpnHost.toString()));
+        if(netScan.ipv4Valid())
+            _executor.bash(QStringLiteral("route -q -n add -inet %1 -gateway %2").arg(authResult._serverIp.toString(), QString::fromStdString(netScan.gatewayIp())));
+        else
+            qInfo() << "Can't create VPN host route yet, original gateway not known";
+    }
+
+    for(const auto &dnsServer : addedDns)
+        _executor.bash(QStringLiteral("route -q -n add -inet %1 -interface %2").arg(dnsServer, deviceName));
+    for(const auto &dnsServer : removedDns)
+        _executor.bash(QStringLiteral("route -q -n delete -inet %1 -interface %2").arg(dnsServer, deviceName));
+
+    if(_connectionConfig.setDefaultDns() && _dnsServers != parked._dnsServers)
+        setupPosixDNS(deviceName, _dnsServers);
+#else
+    // Backends on other platforms don't support reconfigure(), so interfaces
+    // are never parked
+    Q_UNUSED(netScan);
+    Q_ASSERT(false);
+#endif
+
+    _vpnHost = authResult._serverIp;
+
+    qInfo() << "MTU config:" << _connectionConfig.mtu()
+        << " - last tunnel MTU to VPN host" << authResult._serverIp << ":"
+        << _maxMtu;
+    _mtuPinger.reset(new MtuPinger{_pNetworkAdapter, _maxMtu, _connectionConfig.mtu(),
+                                   QStringLiteral("wireguard/") + authResult._serverIp.toString()});
+
+    emitTunnelConfiguration(deviceName, peerIpNet.first.toString(),
+                            authResult._serverVirtualIp.toString());
+}
+
 auto WireguardMethod::getWireguardDevice() -> Async<WireguardBackend::WgDevPtr>
 {
     if(!_pBackend)
@@ -864,12 +1261,25 @@ void WireguardMethod::checkPeerHandshake(const wg_device &dev)
     }
 
     time_t now = time(nullptr);
+    if(state() < State::Connected)
+        emitPhase(QStringLiteral("handshake"));
     // Since we got a handshake, advance to Connected and stop the
     // failure timer (if we haven't yet)
     advanceState(State::Connected);
     _firstHandshakeTimer.stop();
+    if(_pBackend)
+        _pBackend->stopHandshakeWatch();
+    // The key works; keep it so a quick reconnect can skip addKey
+    if(_pAuthEntry && _pPreauth)
+    {
+        _pConnectedEntry = _pAuthEntry;
+        _pPreauth->store(std::move(_pAuthEntry));
+        _pAuthEntry.reset();
+    }
 
     std::chrono::seconds handshakeTimeAgo{now - lastHandshakeTime};
+    g_daemon->metrics().set(QStringLiteral("wireguard_handshake_age_seconds"), {},
+                            static_cast<double>(handshakeTimeAgo.count()));
     if(handshakeTimeAgo < handshakeTraceThreshold)
     {
         qInfo() << "peer: handshake at"
@@ -893,46 +1303,14 @@ void WireguardMethod::checkPeerHandshake(const wg_device &dev)
     }
 }
 
-void WireguardMethod::checkFirstHandshake()
+void WireguardMethod::firstHandshakeTimedOut()
 {
     if(state() != State::Connecting)
         return; // Nothing to do, already connected or exiting
 
-    getWireguardDevice()
-        .timeout(firstHandshakeInterval)
-        ->notify(this, [this](const Error &err, const WireguardBackend::WgDevPtr &pDev)
-            {
-                // If we're not still in the Connecting state, there's nothing
-                // to do, we already moved to another state
-                if(state() != State::Connecting)
-                {
-                    qWarning() << "Ignoring first handshake stats, already advanced to state"
-                        << traceEnum(state());
-                    return;
-                }
-                if(err || !pDev)
-                    return; // Traced by getWireguardDevice()
-
-                checkPeerHandshake(*pDev);
-
-                // If we haven't gone to the connected state, and the connection
-                // has timed out, raise an error.
-                auto elapsed = _firstHandshakeElapsed.elapsed();
-                if(state() == State::Connecting)
-                {
-                    if(elapsed > msec(firstHandshakeTimeout))
-                    {
-                        qWarning() << "Connection timed out; no handshake after"
-                            << traceMsec(elapsed);
-                        raiseError({HERE, Error::Code::WireguardHandshakeTimeout});
-                    }
-                    else
-                    {
-                        qInfo() << "Still waiting for first handshake after"
-                            << traceMsec(elapsed);
-                    }
-                }
-            });
+    qWarning() << "Connection timed out; no handshake after"
+        << traceMsec(_firstHandshakeElapsed.elapsed());
+    raiseError({HERE, Error::Code::WireguardHandshakeTimeout});
 }
 
 void WireguardMethod::updateStats()
@@ -968,10 +1346,34 @@ void WireguardMethod::updateStats()
                     tx += pPeer->tx_bytes;
                 }
 
+                // Find the throughput since the last update.  The counters
+                // could go backwards if the peer was replaced, just report 0
+                // in that case.
+                quint64 rxRate{0}, txRate{0};
+                qint64 statElapsedMs = _lastStatElapsed.isValid() ? _lastStatElapsed.elapsed() : 0;
+                if(statElapsedMs > 0 && rx >= _lastStatRx && tx >= _lastStatTx)
+                {
+                    rxRate = (rx - _lastStatRx) * 1000 / statElapsedMs;
+                    txRate = (tx - _lastStatTx) * 1000 / statElapsedMs;
+                }
+                _lastStatRx = rx;
+                _lastStatTx = tx;
+                _lastStatElapsed.start();
+                _peakRxRate = std::max(_peakRxRate, rxRate);
+                _peakTxRate = std::max(_peakTxRate, txRate);
+                g_daemon->metrics().set(QStringLiteral("tunnel_rate_bytes_per_second"),
+                                        {{QStringLiteral("direction"), QStringLiteral("received")}},
+                                        static_cast<double>(rxRate));
+                g_daemon->metrics().set(QStringLiteral("tunnel_rate_bytes_per_second"),
+                                        {{QStringLiteral("direction"), QStringLiteral("sent")}},
+                                        static_cast<double>(txRate));
+
                 // Trace bytecounts - this is pretty useful for diagnostics.
                 // The OpenVPN method gets this trace from the management
-                // interface, this is similar.
-                qInfo().nospace() << "BYTECOUNT: " << rx << ", " << tx;
+                // interface, this is similar.  The rates help diagnose
+                // throughput limits.
+                qInfo().nospace() << "BYTECOUNT: " << rx << ", " << tx
+                    << " - rate: " << rxRate << ", " << txRate << " B/s";
                 emitBytecounts(rx, tx);
 
                 checkPeerHandshake(*pDev);
@@ -1037,72 +1439,46 @@ void WireguardMethod::checkPing(const quint64 &rx, const quint64 &tx)
     _lastReceivedBytes = rx;
 
     // If we're receiving data, then we still have a connection
-    // So reset _noRxIntervals
+    // So reset _noRxTime
     if(receivedDelta != 0)
     {
-        _noRxIntervals = 0;
+        _noRxTime = {};
+        _tunnelProber.dataReceived();
         return;
     }
 
     // Otherwise, this is an additional interval with no data
-    ++_noRxIntervals;
+    _noRxTime += std::chrono::milliseconds{_statsTimer.interval()};
 
     std::chrono::seconds pingTimeout{g_settings.wireguardPingTimeout()};
 
 
     // If pingTimeout seconds have elapsed and we haven't yet received data, abort the connection
-    if(_noRxIntervals >= pingTimeout / statsInterval)
+    if(_noRxTime >= pingTimeout)
     {
         qWarning() << "Abandoning connection due to ping timeout."
-            << "No response after" << traceMsec(statsInterval * _noRxIntervals);
+            << "No response after" << traceMsec(_noRxTime);
 
          raiseError({HERE, Error::Code::WireguardPingTimeout});
          return;
     }
 
-    // Otherwise if only pingThreshold seconds have elapsed since we last received data - start pinging the endpoint
-    // This ping will be repeated each time checkPing() is called, which should be every 5 seconds
-    if(_noRxIntervals >= (pingTimeout / 2) / statsInterval)
-    {
-        qWarning() << "No data received in" << traceMsec(statsInterval * _noRxIntervals)
-            << "- pinging endpoint";
-        pingEndpoint();
-    }
-}
-
-void WireguardMethod::pingEndpoint()
-{
-#if defined(Q_OS_UNIX)
-    // -f flag should fire and forget - i.e not wait around for ICMP echo reply
-    _executor.cmd("ping", {"-f", "-n", "-c", "1", "-W", "1", _pingEndpointAddress.toString()});
-#elif defined(Q_OS_WIN)
-    QProcess pingProc;
-    pingProc.setProgram("ping");
-    pingProc.setArguments({"/w", "1", "/n", "1", _pingEndpointAddress.toString()});
-
-    // We do not need to reap the exit code on Windows (on Unix we do, otherwise we end up with a Zombie process)
-    pingProc.startDetached();
-#endif
+    // Otherwise, probe the tunnel now - if it's alive, the reply shows up
+    // within a round trip, and if it's not, TunnelProber detects that after a
+    // few retransmissions instead of waiting for the full ping timeout.  This
+    // repeats each time checkPing() is called (every stats interval) while
+    // idle.
+    qInfo() << "No data received in" << traceMsec(_noRxTime)
+        << "- probing endpoint";
+    _tunnelProber.probe();
 }
 
-void WireguardMethod::run(const ConnectionConfig &connectingConfig,
-                          const Server &vpnServer,
-                          const Transport &transport,
-                          const QHostAddress &localAddress,
-                          const QHostAddress &shadowsocksServerAddress,
-                          quint16 shadowsocksProxyPort)
+auto WireguardMethod::requestAddKey(const ConnectionConfig &config,
+                                    const Server &vpnServer,
+                                    const WireguardKeypair &clientKeypair)
+    -> Async<QJsonDocument>
 {
-    advanceState(State::Connecting);
-
-    // Generate a keypair, and push the public key to the server with our
-    // credentials
-    WireguardKeypair clientKeypair;
-
-    // Store a copy of the connection config, we need things like DNS servers
-    // later after the interface is created
-    _connectionConfig = connectingConfig;
-
-    if(!connectingConfig.vpnLocation())
+    if(!config.vpnLocation())
     {
         qWarning() << "No VPN location specified";
         throw Error{HERE, Error::Code::VPNConfigInvalid};
@@ -1114,7 +1490,7 @@ void WireguardMethod::run(const ConnectionConfig &connectingConfig,
     if(wgHost.isNull() || !wgPort)
     {
         qWarning() << "WireGuard host" << vpnServer.ip() << ":" << wgPort
-            << "not valid in location" << connectingConfig.vpnLocation()->id();
+            << "not valid in location" << config.vpnLocation()->id();
         throw Error{HERE, Error::Code::VPNConfigInvalid};
     }
 
@@ -1123,7 +1499,7 @@ void WireguardMethod::run(const ConnectionConfig &connectingConfig,
     {
         qWarning() << "Certificate serial number not known for server"
             << vpnServer.ip() << "in region"
-            << connectingConfig.vpnLocation()->id();
+            << config.vpnLocation()->id();
         throw Error{HERE, Error::Code::VPNConfigInvalid};
     }
 
@@ -1138,26 +1514,93 @@ void WireguardMethod::run(const ConnectionConfig &connectingConfig,
     QByteArray authHeader;
     // For normal regions, WireGuard only supports token auth; we get vpnToken().
     // For dedicated IP regions, we get credentials in vpnUsername() / vpnPassword().
-    if(connectingConfig.vpnToken().isEmpty())
+    if(config.vpnToken().isEmpty())
     {
         // Credential auth, use Basic authentication header
-        authHeader = ApiClient::passwordAuth(connectingConfig.vpnUsername(),
-                                             connectingConfig.vpnPassword());
+        authHeader = ApiClient::passwordAuth(config.vpnUsername(),
+                                             config.vpnPassword());
     }
     else
     {
         // Token auth, pass in query parameter
         resource += QStringLiteral("&pt=");
-        resource += QString::fromLatin1(QUrl::toPercentEncoding(connectingConfig.vpnToken()));
+        resource += QString::fromLatin1(QUrl::toPercentEncoding(config.vpnToken()));
     }
     // Don't do DNS resolution while connecting - specify the IP address in the
     // request, and use the host name to verify the certificate.
     FixedApiBase hostAuthBase{authHost, g_daemon->environment().getRsa4096CA(), certCommonName};
 
-    _pAuthRequest = g_daemon->apiClient().getRetry(hostAuthBase, resource, authHeader)
-        ->then(this, [this, clientKeypair=std::move(clientKeypair)](const QJsonDocument &result)
+    return g_daemon->apiClient().getRetry(hostAuthBase, resource, authHeader);
+}
+
+void WireguardMethod::run(const ConnectionConfig &connectingConfig,
+                          const Server &vpnServer,
+                          const Transport &transport,
+                          const QHostAddress &localAddress,
+                          const QHostAddress &shadowsocksServerAddress,
+                          quint16 shadowsocksProxyPort)
+{
+    advanceState(State::Connecting);
+
+    // Store a copy of the connection config, we need things like DNS servers
+    // later after the interface is created
+    _connectionConfig = connectingConfig;
+
+    if(!connectingConfig.vpnLocation())
+    {
+        qWarning() << "No VPN location specified";
+        throw Error{HERE, Error::Code::VPNConfigInvalid};
+    }
+
+    // If a key was already registered with this server (ahead of time, or by
+    // a connection that just ended), use it and skip the addKey request.
+    // Entries are taken, so if the server rejects the key (the handshake
+    // times out), the next attempt registers a new one.
+    //
+    // The key of an interface parked for sleep is used regardless of its age,
+    // resuming the interface tests whether the server still accepts it.  A
+    // key kept for this server is taken either way (it's probably the same
+    // key), so a failed resume doesn't try it again.
+    if(_pHandoff)
+        _pAuthEntry = _pHandoff->resumeKey(connectingConfig, vpnServer);
+    if(_pPreauth)
+    {
+        auto pPreauthEntry = _pPreauth->take(connectingConfig, vpnServer);
+        if(!_pAuthEntry)
+            _pAuthEntry = std::move(pPreauthEntry);
+    }
+    if(_pAuthEntry)
+    {
+        qInfo() << "Using key registered with" << vpnServer.ip()
+            << traceMsec(_pAuthEntry->_age.elapsed()) << "ago";
+        emitPhase(QStringLiteral("authenticating"));
+        auto pEntry = _pAuthEntry;
+        // Continue asynchronously like a completed request, so run() does not
+        // reach the interface states synchronously
+        _pAuthRequest = Async<void>::resolve()
+            ->then(this, [this, pEntry]()
+                {
+                    handleAuthResult(pEntry->_keypair, pEntry->_result);
+                }, Qt::QueuedConnection)
+            ->except(this, [this](const Error &ex){raiseError(ex);});
+        return;
+    }
+
+    // Generate a keypair, and push the public key to the server with our
+    // credentials
+    auto pEntry = std::make_shared<WireguardPreauth::Entry>();
+    pEntry->_serverIp = vpnServer.ip();
+    pEntry->_commonName = vpnServer.commonName();
+    pEntry->_credential = authCredential(connectingConfig);
+
+    emitPhase(QStringLiteral("authenticating"));
+    _pAuthRequest = requestAddKey(connectingConfig, vpnServer, pEntry->_keypair)
+        ->then(this, [this, pEntry](const QJsonDocument &result)
             {
-                handleAuthResult(clientKeypair, result);
+                pEntry->_result = result;
+                pEntry->_age.start();
+                _pAuthEntry = pEntry;
+                handleAuthResult(pEntry->_keypair, result);
             })
         ->except(this, [this](const Error &ex){raiseError(ex);});
 }
@@ -1170,9 +1613,31 @@ void WireguardMethod::shutdown()
 
     _statsTimer.stop();
     _firstHandshakeTimer.stop();
+    if(_pBackend)
+        _pBackend->stopHandshakeWatch();
+    if(_lastStatElapsed.isValid())
+    {
+        qInfo() << "Peak throughput during connection - received"
+            << _peakRxRate << "B/s, sent" << _peakTxRate << "B/s";
+    }
+    _tunnelProber.stop();
+
+    bool parked = parkInterface();
 
     advanceState(State::Exiting);
 
+    if(parked)
+    {
+        // Nothing to tear down; go to Exited asynchronously as below, but
+        // without the delay since the tunnel is still up
+        QTimer::singleShot(0, this, [this]()
+        {
+            qInfo() << "WireGuard shutdown complete, interface parked";
+            advanceState(State::Exited);
+        });
+        return;
+    }
+
     // Allow the backend to shut down
     Async<void> pShutdownTask;
     if(_pBackend)
@@ -1210,6 +1675,43 @@ void WireguardMethod::shutdown()
         });
 }
 
+bool WireguardMethod::parkInterface()
+{
+    if(!_pHandoff || !_pHandoff->takeExpectedSwitch())
+        return false;
+
+    // Only park an interface that is fully up
+    if(state() != State::Connected || !_routesUp || !_pBackend ||
+       !_pBackend->canReconfigure() || !_pNetworkAdapter)
+    {
+        qInfo() << "Can't keep the interface for the next connection in state"
+            << traceEnum(state());
+        return false;
+    }
+
+    auto pInterface = std::make_unique<WireguardHandoff::Interface>();
+    _pBackend->disconnect(this);
+    pInterface->_pBackend = std::move(_pBackend);
+    pInterface->_pNetworkAdapter = std::move(_pNetworkAdapter);
+    pInterface->_deviceName = pInterface->_pNetworkAdapter->devNode();
+    pInterface->_peerIpNet = _peerIpNet;
+    pInterface->_vpnHost = _vpnHost;
+    pInterface->_pingEndpointAddress = _pingEndpointAddress;
+    pInterface->_dnsServers = _dnsServers;
+    pInterface->_maxMtu = _maxMtu;
+    pInterface->_config = _connectionConfig;
+    pInterface->_netScan = originalNetwork();
+    pInterface->_pAuthEntry = _pConnectedEntry;
+
+    // This method no longer owns the routes
+    _routesUp = false;
+    _vpnHost.clear();
+    _mtuPinger.reset();
+
+    _pHandoff->park(std::move(pInterface));
+    return true;
+}
+
 void WireguardMethod::networkChanged()
 {
     const auto &netScan = originalNetwork();
@@ -1280,9 +1782,208 @@ void cleanupWireguard()
     WireguardMethod::cleanup();
 }
 
-std::unique_ptr<VPNMethod> createWireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan)
+void WireguardPreauth::preauthenticate(const ConnectionConfig &config, const Server &server)
+{
+    if(_pEntry && _pEntry->_serverIp == server.ip() &&
+       _pEntry->_credential == authCredential(config) &&
+       _pEntry->_age.elapsed() < msec(preauthTtl) / 2)
+    {
+        return; // Still fresh
+    }
+    if(_pRequest && _requestServerIp == server.ip())
+        return; // Already registering a key here
+
+    qInfo() << "Registering key ahead of time with" << server.ip();
+    _requestServerIp = server.ip();
+    try
+    {
+        auto pEntry = std::make_shared<Entry>();
+        pEntry->_serverIp = server.ip();
+        pEntry->_commonName = server.commonName();
+        pEntry->_credential = authCredential(config);
+
+        _pRequest = WireguardMethod::requestAddKey(config, server, pEntry->_keypair)
+            ->then(this, [this, pEntry](const QJsonDocument &result)
+                {
+                    WireguardMethod::parseAuthResult(result);    // Throws if not valid
+                    pEntry->_result = result;
+                    pEntry->_age.start();
+                    _pEntry = pEntry;
+                    _requestServerIp.clear();
+                    qInfo() << "Registered key with" << pEntry->_serverIp;
+                })
+            ->except(this, [this](const Error &err)
+                {
+                    qInfo() << "Could not register key with" << _requestServerIp
+                        << "ahead of time -" << err;
+                    _requestServerIp.clear();
+                });
+    }
+    catch(const Error &err)
+    {
+        qInfo() << "Can't register key with" << server.ip() << "-" << err;
+        _requestServerIp.clear();
+        _pRequest.abandon();
+    }
+}
+
+auto WireguardPreauth::take(const ConnectionConfig &config, const Server &server)
+    -> std::shared_ptr<Entry>
+{
+    std::shared_ptr<Entry> pEntry;
+    pEntry.swap(_pEntry);
+    if(!pEntry)
+        return {};
+    if(pEntry->_serverIp != server.ip() ||
+       pEntry->_commonName != server.commonName() ||
+       pEntry->_credential != authCredential(config))
+    {
+        // Not for this server; keep it in case the next attempt uses it
+        _pEntry = std::move(pEntry);
+        return {};
+    }
+    if(pEntry->_age.elapsed() >= msec(preauthTtl))
+    {
+        qInfo() << "Key registered with" << server.ip() << "expired after"
+            << traceMsec(pEntry->_age.elapsed());
+        return {};
+    }
+    return pEntry;
+}
+
+void WireguardPreauth::store(std::shared_ptr<Entry> pEntry)
+{
+    if(pEntry && pEntry->_age.isValid())
+        _pEntry = std::move(pEntry);
+}
+
+void WireguardPreauth::clear()
+{
+    _pEntry.reset();
+    _pRequest.abandon();
+    _requestServerIp.clear();
+}
+
+WireguardHandoff::WireguardHandoff()
+    : _switchExpected{false}, _resumeExpected{false}
+{
+    _parkTimer.setSingleShot(true);
+    _parkTimer.setInterval(msec(handoffParkTimeout));
+    connect(&_parkTimer, &QTimer::timeout, this, [this]()
+    {
+        qInfo() << "Parked interface wasn't taken after"
+            << traceMsec(handoffParkTimeout);
+        discard();
+    });
+}
+
+// Defined here since Interface is incomplete in the header
+WireguardHandoff::~WireguardHandoff() = default;
+
+void WireguardHandoff::expectSwitch()
+{
+    _switchExpected = true;
+    _resumeExpected = false;
+}
+
+void WireguardHandoff::expectResume()
+{
+    _switchExpected = true;
+    _resumeExpected = true;
+}
+
+bool WireguardHandoff::takeExpectedSwitch()
+{
+    bool expected = _switchExpected;
+    _switchExpected = false;
+    return expected;
+}
+
+void WireguardHandoff::park(std::unique_ptr<Interface> pInterface)
+{
+    _pInterface = std::move(pInterface);
+    if(_resumeExpected)
+    {
+        // Kept until the connection after wake takes it
+        qInfo() << "Keeping interface" << _pInterface->_deviceName
+            << "up to resume after sleep";
+        _pInterface->_resume = true;
+        _resumeExpected = false;
+        _parkTimer.stop();
+        return;
+    }
+    qInfo() << "Keeping interface" << _pInterface->_deviceName
+        << "up for the next connection";
+    _parkTimer.start();
+}
+
+auto WireguardHandoff::take(const ConnectionConfig &config) -> std::unique_ptr<Interface>
+{
+    _parkTimer.stop();
+    std::unique_ptr<Interface> pInterface;
+    pInterface.swap(_pInterface);
+    if(!pInterface)
+        return {};
+
+    // The interface can only be reused if it was set up the same way,
+    // besides the server
+    const ConnectionConfig &parkedConfig = pInterface->_config;
+    if(config.setDefaultRoute() != parkedConfig.setDefaultRoute() ||
+       config.setDefaultDns() != parkedConfig.setDefaultDns() ||
+       config.mtu() != parkedConfig.mtu() ||
+       config.wireguardUseKernel() != parkedConfig.wireguardUseKernel() ||
+       config.wireguardGoHighThroughput() != parkedConfig.wireguardGoHighThroughput())
+    {
+        qInfo() << "Settings changed, can't reuse parked interface"
+            << pInterface->_deviceName;
+        return {};  // Destroying it tears it down
+    }
+    return pInterface;
+}
+
+void WireguardHandoff::discard()
+{
+    _switchExpected = false;
+    _resumeExpected = false;
+    _parkTimer.stop();
+    _pInterface.reset();
+}
+
+bool WireguardHandoff::parkedForResume() const
+{
+    return _pInterface && _pInterface->_resume;
+}
+
+QString WireguardHandoff::resumeServerIp() const
+{
+    if(!parkedForResume())
+        return {};
+    return _pInterface->_vpnHost.toString();
+}
+
+auto WireguardHandoff::resumeKey(const ConnectionConfig &config,
+                                 const Server &server) const
+    -> std::shared_ptr<WireguardPreauth::Entry>
+{
+    if(!parkedForResume() || !_pInterface->_pAuthEntry)
+        return {};
+    const auto &pEntry = _pInterface->_pAuthEntry;
+    if(pEntry->_serverIp != server.ip() ||
+       pEntry->_commonName != server.commonName() ||
+       pEntry->_credential != authCredential(config))
+    {
+        return {};
+    }
+    return pEntry;
+}
+
+std::unique_ptr<VPNMethod> createWireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan,
+                                                 std::shared_ptr<WireguardPreauth> pPreauth,
+                                                 std::shared_ptr<WireguardHandoff> pHandoff)
 {
-    return std::unique_ptr<VPNMethod>{new WireguardMethod{pParent, netScan}};
+    return std::unique_ptr<VPNMethod>{new WireguardMethod{pParent, netScan,
+                                                          std::move(pPreauth),
+                                                          std::move(pHandoff)}};
 }
 
 #include "wireguardmethod.moc"
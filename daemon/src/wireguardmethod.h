@@ -24,11 +24,116 @@
 
 #include "vpnmethod.h"
 #include <common/src/openssl.h>
+#include <QTimer>
 
 // Clean any Wireguard leftovers that could exist if the daemon crashed while a
 // connection was up.  (Cleans for all WG backends supported on this platform.)
 void cleanupWireguard();
 
-std::unique_ptr<VPNMethod> createWireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan);
+// WireguardPreauth registers a key with the likely next WireGuard server ahead
+// of time, so a connection can skip the addKey request.  The auth result from
+// a connection is also kept, so a quick reconnect to the same server can reuse
+// it.
+//
+// Results are kept for a limited time (the server eventually forgets keys that
+// are not in use), and each result is used by one connection attempt at most.
+// Every pre-registration generates a new keypair.
+class WireguardPreauth : public QObject
+{
+    Q_OBJECT
+    CLASS_LOGGING_CATEGORY("wireguardpreauth")
+
+public:
+    // Keypair and addKey result for one server (defined in wireguardmethod.cpp)
+    struct Entry;
+
+public:
+    // Register a new key with this server in the background, unless a recent
+    // result for it already exists or a request for it is in progress.
+    void preauthenticate(const ConnectionConfig &config, const Server &server);
+    // Take the result for this server and credentials if there is a valid
+    // one.  Returns nullptr otherwise.
+    std::shared_ptr<Entry> take(const ConnectionConfig &config, const Server &server);
+    // Keep a result obtained by a connection, so a reconnect can reuse it
+    void store(std::shared_ptr<Entry> pEntry);
+    // Discard any result and abandon a request in progress
+    void clear();
+
+private:
+    std::shared_ptr<Entry> _pEntry;
+    Async<void> _pRequest;
+    // Server IP of the request in progress
+    QString _requestServerIp;
+};
+
+// WireguardHandoff keeps the WireGuard interface up while switching servers
+// (see DaemonSettings::wireguardSeamlessSwitch).  VPNConnection indicates that
+// a switch is starting, and the WireguardMethod shutting down parks its
+// interface here instead of tearing it down.  The next WireguardMethod takes
+// it, replaces the peer through the backend, and updates only the addresses,
+// routes, and DNS that changed.
+//
+// Until the interface is taken, it still routes traffic to the previous
+// server, so nothing leaves the tunnel during the switch.  It's torn down if
+// it isn't taken within a short time, if the next connection can't use it, or
+// if VPNConnection discards it.
+//
+// The same mechanism resumes a connection after the system sleeps.  The
+// interface is parked for resume when disconnecting for sleep, and it's kept
+// (with the key it uses) until the connection after wake takes it.  That
+// connection prefers the same server and key, so it only has to rebind the
+// socket and complete a handshake; if that fails, it reconnects normally.
+class WireguardHandoff : public QObject
+{
+    Q_OBJECT
+    CLASS_LOGGING_CATEGORY("wireguardhandoff")
+
+public:
+    // The parked interface and its host configuration; tears it down when
+    // destroyed unless its backend was taken (defined in wireguardmethod.cpp)
+    struct Interface;
+
+public:
+    WireguardHandoff();
+    ~WireguardHandoff() override;
+
+public:
+    // The next WireguardMethod to shut down after connecting can park its
+    // interface.
+    void expectSwitch();
+    // Like expectSwitch(), but for a disconnect before the system sleeps -
+    // the interface is kept until it's taken or discarded, not just for a
+    // short time.
+    void expectResume();
+    // Called by WireguardMethod when shutting down - returns whether
+    // expectSwitch() was called, and clears it.
+    bool takeExpectedSwitch();
+    // Park an interface
+    void park(std::unique_ptr<Interface> pInterface);
+    // Take the parked interface if it can be used with this configuration.
+    // Returns nullptr otherwise; an interface that can't be used is torn down.
+    std::unique_ptr<Interface> take(const ConnectionConfig &config);
+    // Cancel an expected switch and tear down the parked interface, if any
+    void discard();
+
+    // Whether an interface is parked for resume after sleep
+    bool parkedForResume() const;
+    // The server IP of an interface parked for resume, empty otherwise
+    QString resumeServerIp() const;
+    // The key used by an interface parked for resume, if it can be used for
+    // this server and credentials.  Returns nullptr otherwise.
+    std::shared_ptr<WireguardPreauth::Entry> resumeKey(const ConnectionConfig &config,
+                                                       const Server &server) const;
+
+private:
+    bool _switchExpected;
+    bool _resumeExpected;
+    std::unique_ptr<Interface> _pInterface;
+    QTimer _parkTimer;
+};
+
+std::unique_ptr<VPNMethod> createWireguardMethod(QObject *pParent, const OriginalNetworkScan &netScan,
+                                                 std::shared_ptr<WireguardPreauth> pPreauth,
+                                                 std::shared_ptr<WireguardHandoff> pHandoff);
 
 #endif
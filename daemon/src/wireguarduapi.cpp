@@ -383,7 +383,7 @@ WireguardIpc::WireguardIpc(std::shared_ptr<QLocalSocket> pIpcSocket)
     // completion, which will generate a disconnect error.  If we were to queue
     // data in any way, it would deserialize those events, and the connection
     // could be aborted before we process all the data.
-    connect(&_ipcLineBuffer, &LineBuffer::lineComplete, this,
+    connect(&_ipcLineBuffer, &LineBuffer::lineView, this,
             &WireguardIpc::processLine);
 }
 
@@ -394,7 +394,7 @@ WireguardIpc::~WireguardIpc()
     _pIpcSocket->disconnect(this);
 }
 
-void WireguardIpc::processLine(const QByteArray &line)
+void WireguardIpc::processLine(QByteArrayView line)
 {
     if(_finished)
     {
@@ -420,7 +420,7 @@ void WireguardIpc::processLine(const QByteArray &line)
         auto keyEndIdx = line.indexOf('=');
         if(keyEndIdx < 0 || keyEndIdx >= line.size())
         {
-            qWarning() << "Invalid IPC line:" << line.data();
+            qWarning() << "Invalid IPC line:" << QLatin1String{line.data(), line.size()};
             return;
         }
 
@@ -429,7 +429,7 @@ void WireguardIpc::processLine(const QByteArray &line)
         auto itKeyMatch = Uapi::lookupKey.find(key);
         if(itKeyMatch == Uapi::lookupKey.end())
         {
-            qWarning() << "Unknown key in IPC line:" << line.data();
+            qWarning() << "Unknown key in IPC line:" << QLatin1String{line.data(), line.size()};
             return;
         }
 
@@ -572,9 +572,15 @@ void WireguardConfigDeviceTask::receiveValue(Uapi::Key key, const QLatin1String
         _errno = Uapi::parseInt<int>(value);
 }
 
-WireguardDeviceStatusTask::WireguardDeviceStatusTask(std::shared_ptr<QLocalSocket> pIpcSocket)
-    : _ipc{std::move(pIpcSocket)}, _pDev{new WgDevStatus{}}, _errno{EBADMSG}
+WireguardDeviceStatusTask::WireguardDeviceStatusTask(std::shared_ptr<QLocalSocket> pIpcSocket,
+                                                     std::shared_ptr<WgDevStatus> pDev)
+    : _ipc{std::move(pIpcSocket)}, _pDev{std::move(pDev)}, _errno{EBADMSG}
 {
+    if(_pDev)
+        _pDev->clear();
+    else
+        _pDev.reset(new WgDevStatus{});
+
     if(!_ipc.writeIpcRequest(QByteArrayLiteral("get=1\n\n")))
     {
         // Failed; traced by writeIpcRequest
@@ -723,4 +729,85 @@ void WireguardDeviceStatusTask::receiveValue(Uapi::Key key, const QLatin1String
     }
 }
 
+WireguardUapiSession::WireguardUapiSession(ConnectFunc connectFunc)
+    : _connectFunc{std::move(connectFunc)}, _singleRequest{false}
+{
+    Q_ASSERT(_connectFunc);  // Ensured by caller
+}
+
+auto WireguardUapiSession::getStatus() -> Async<WireguardBackend::WgDevPtr>
+{
+    // Reuse the last status unless a caller still holds it (or a request
+    // using it is still in progress)
+    if(!_pStatus || _pStatus.use_count() > 1)
+        _pStatus = std::make_shared<WgDevStatus>();
+
+    // Take the kept connection, if there is one - it's only used by one
+    // request at a time.
+    std::shared_ptr<QLocalSocket> pSocket;
+    pSocket.swap(_pSocket);
+    if(pSocket && pSocket->state() != QLocalSocket::LocalSocketState::ConnectedState)
+    {
+        qInfo() << "UAPI server closed connection after request, will connect for each request";
+        _singleRequest = true;
+        pSocket.reset();
+    }
+
+    Async<std::shared_ptr<WgDevStatus>> pRequest;
+    if(pSocket)
+    {
+        pRequest = Async<WireguardDeviceStatusTask>::create(pSocket, _pStatus)
+            ->next(this, [this, pSocket, pStatus = _pStatus](const Error &err,
+                                                             const std::shared_ptr<WgDevStatus> &pDev)
+            {
+                if(!err)
+                {
+                    keepConnection(pSocket);
+                    return Async<std::shared_ptr<WgDevStatus>>::resolve(pDev);
+                }
+                // The server may have closed the connection just as we sent
+                // the request.  Try once more on a new connection.
+                qInfo() << "UAPI request failed on kept connection, retrying on new connection -"
+                    << err;
+                _singleRequest = true;
+                return requestOnNewConnection(pStatus);
+            });
+    }
+    else
+        pRequest = requestOnNewConnection(_pStatus);
+
+    return pRequest->then([](const std::shared_ptr<WgDevStatus> &pDev)
+        {
+            Q_ASSERT(pDev); // Postcondition of WireguardDeviceStatusTask
+            // Return an aliased shared pointer - dereferences to a wg_device,
+            // but frees the complete WgDevStatus
+            return WireguardBackend::WgDevPtr{pDev, &pDev->device()};
+        });
+}
+
+auto WireguardUapiSession::requestOnNewConnection(std::shared_ptr<WgDevStatus> pStatus)
+    -> Async<std::shared_ptr<WgDevStatus>>
+{
+    return _connectFunc()
+        ->then(this, [this, pStatus = std::move(pStatus)](const std::shared_ptr<QLocalSocket> &pSocket)
+        {
+            Q_ASSERT(pSocket);  // Postcondition of _connectFunc (rejects otherwise)
+            return Async<WireguardDeviceStatusTask>::create(pSocket, pStatus)
+                ->then(this, [this, pSocket](const std::shared_ptr<WgDevStatus> &pDev)
+                {
+                    keepConnection(pSocket);
+                    return pDev;
+                });
+        });
+}
+
+void WireguardUapiSession::keepConnection(std::shared_ptr<QLocalSocket> pSocket)
+{
+    if(!_singleRequest && pSocket &&
+       pSocket->state() == QLocalSocket::LocalSocketState::ConnectedState)
+    {
+        _pSocket = std::move(pSocket);
+    }
+}
+
 #include "wireguarduapi.moc"
@@ -28,6 +28,7 @@
 #include <QLocalSocket>
 #include <memory>
 #include <deque>
+#include <functional>
 
 namespace Uapi
 {
@@ -128,7 +129,7 @@ public:
     ~WireguardIpc();
 
 private:
-    void processLine(const QByteArray &line);
+    void processLine(QByteArrayView line);
 
 public:
     // Send the IPC request in 'message'.  Returns true if it's sent
@@ -177,6 +178,9 @@ private:
 
 // Request device stats from UAPI.  Populates a wg_device.  If the returned
 // errno is nonzero, the task rejects.
+//
+// A WgDevStatus from an earlier request can be passed in to be cleared and
+// reused; otherwise a new one is allocated.
 class WireguardDeviceStatusTask : public Task<std::shared_ptr<WgDevStatus>>
 {
     Q_OBJECT
@@ -189,7 +193,8 @@ private:
     void addFlag(FlagsT &flags, FlagsT newFlag);
 
 public:
-    WireguardDeviceStatusTask(std::shared_ptr<QLocalSocket> pIpcSocket);
+    WireguardDeviceStatusTask(std::shared_ptr<QLocalSocket> pIpcSocket,
+                              std::shared_ptr<WgDevStatus> pDev = {});
 
 private:
     void ensureHasPeer();
@@ -204,4 +209,45 @@ private:
     int _errno;
 };
 
+// Long-lived UAPI session used for status polls.  The connection is kept open
+// and reused for the next request if the UAPI server allows that (current
+// wireguard-go handles any number of requests per connection).  If the server
+// closes the connection after a request, the session connects again for each
+// request from then on.
+//
+// The WgDevStatus from the last poll is also reused once nothing refers to it,
+// so regular polls don't allocate a new device, peers, and allowed IPs.
+class WireguardUapiSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Function to open a new UAPI connection; the task must resolve with a
+    // connected socket or reject.
+    using ConnectFunc = std::function<Async<std::shared_ptr<QLocalSocket>>()>;
+
+public:
+    WireguardUapiSession(ConnectFunc connectFunc);
+
+public:
+    // Get the device status, like WireguardBackend::getStatus().
+    Async<WireguardBackend::WgDevPtr> getStatus();
+
+private:
+    // Request the status on a new connection
+    Async<std::shared_ptr<WgDevStatus>> requestOnNewConnection(std::shared_ptr<WgDevStatus> pStatus);
+    // Keep a connection for the next request after a request succeeded on it
+    void keepConnection(std::shared_ptr<QLocalSocket> pSocket);
+
+private:
+    ConnectFunc _connectFunc;
+    // Connection kept from the last request, if any
+    std::shared_ptr<QLocalSocket> _pSocket;
+    // Set once the server has closed a connection after a request; we don't
+    // try to keep connections after that.
+    bool _singleRequest;
+    // Status object from the last request, reused if it's no longer referenced
+    std::shared_ptr<WgDevStatus> _pStatus;
+};
+
 #endif
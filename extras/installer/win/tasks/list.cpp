@@ -17,6 +17,13 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "list.h"
+#include <typeinfo>
+
+// Tasks that take at least this long (in milliseconds) have their execution
+// time logged.  Most tasks (individual files, registry values) are much
+// faster than this and would just clutter the log.
+static const ULONGLONG LogTaskTimeThreshold = 50;
+
 void TaskList::add(std::shared_ptr<Task> task)
 {
     task->setListener(this);
@@ -43,7 +50,15 @@ void TaskList::execute()
         _currentExecutionTime = _tasks[_currentTaskIndex]->getEstimatedExecutionTime();
 
         setProgress(0.0, _currentExecutionTime);
+        ULONGLONG startTime = GetTickCount64();
         _tasks[_currentTaskIndex]->execute();
+        ULONGLONG elapsed = GetTickCount64() - startTime;
+        if (elapsed >= LogTaskTimeThreshold)
+        {
+            const Task& task = *_tasks[_currentTaskIndex];
+            LOG("%s took %llu ms (estimated %.0f ms)", typeid(task).name(),
+                elapsed, _currentExecutionTime * 1000.0);
+        }
         setProgress(1.0, 0.0);
 
         checkAbort();
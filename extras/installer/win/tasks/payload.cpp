@@ -42,6 +42,13 @@ bool initializePayload()
 #include "7zAlloc.h"
 #include "7zCrc.h"
 #include "7zFile.h"
+#include "Lzma2DecMt.h"
+
+// 7z method ID of LZMA2 (see 7zDec.c)
+static constexpr UInt32 k7zMethodLzma2 = 0x21;
+// Maximum number of threads used to decode LZMA2.  Each thread buffers a
+// block of output, so this also limits memory use.
+static constexpr unsigned MaxDecodeThreads = 8;
 
 WRes InFile_Open(CSzFile *p, const WCHAR *name);
 WRes OutFile_Open(CSzFile *p, const WCHAR *name);
@@ -118,6 +125,70 @@ void MemoryInStream_CreateVTable(CMemoryInStream* p, const Byte* buf, size_t siz
     p->pos = 0;
 }
 
+// Sequential streams over memory buffers, and a progress callback, for the
+// multithreaded LZMA2 decoder.
+struct CMemorySeqInStream
+{
+    ISeqInStream vt;
+    const Byte *buf;
+    size_t size;
+    size_t pos;
+
+    static CMemorySeqInStream* fromVTable(const ISeqInStream* pp) { return const_cast<CMemorySeqInStream*>(reinterpret_cast<const CMemorySeqInStream*>(reinterpret_cast<const char*>(pp) - offsetof(CMemorySeqInStream, vt))); }
+};
+
+struct CMemorySeqOutStream
+{
+    ISeqOutStream vt;
+    Byte *buf;
+    size_t size;
+    size_t pos;
+
+    static CMemorySeqOutStream* fromVTable(const ISeqOutStream* pp) { return const_cast<CMemorySeqOutStream*>(reinterpret_cast<const CMemorySeqOutStream*>(reinterpret_cast<const char*>(pp) - offsetof(CMemorySeqOutStream, vt))); }
+};
+
+struct CDecodeProgress
+{
+    ICompressProgress vt;
+    size_t inputStreamOffset;
+
+    static CDecodeProgress* fromVTable(const ICompressProgress* pp) { return const_cast<CDecodeProgress*>(reinterpret_cast<const CDecodeProgress*>(reinterpret_cast<const char*>(pp) - offsetof(CDecodeProgress, vt))); }
+};
+
+SRes MemorySeqInStream_Read(const ISeqInStream* pp, void* buf, size_t* size)
+{
+    auto p = CMemorySeqInStream::fromVTable(pp);
+    size_t read = p->size - p->pos;
+    if (read > *size)
+        read = *size;
+    memcpy(buf, p->buf + p->pos, read);
+    p->pos += read;
+    *size = read;
+    return SZ_OK;
+}
+
+size_t MemorySeqOutStream_Write(const ISeqOutStream* pp, const void* buf, size_t size)
+{
+    auto p = CMemorySeqOutStream::fromVTable(pp);
+    // Writing less than requested signals an error to the decoder
+    if (size > p->size - p->pos)
+        size = p->size - p->pos;
+    memcpy(p->buf + p->pos, buf, size);
+    p->pos += size;
+    return size;
+}
+
+// The decoder serializes progress calls, but they may come from any of its
+// threads.  PayloadTask::notifyInputStreamPosition() only updates the
+// (locked) installer progress.
+SRes DecodeProgress_Progress(const ICompressProgress* pp, UInt64 inSize, UInt64 outSize)
+{
+    auto p = CDecodeProgress::fromVTable(pp);
+    if (inSize != (UInt64)(Int64)-1)
+        PayloadTask::notifyInputStreamPosition(p->inputStreamOffset + (size_t)inSize, 0);
+    return SZ_OK;
+}
+
 
 PayloadTask::UnpackTask* PayloadTask::_currentUnpackTask = nullptr;
 
@@ -149,9 +220,12 @@ void PayloadTask::UnpackTask::execute()
         _inputStreamOffset = packs[0] + parent._db.dataPos;
         _inputStreamLength = packs[1] - packs[0];
 
-        // Decode the LZMA folder
+        // Decode the folder.  LZMA2 folders are decoded with multiple threads
+        // when possible; anything else uses the 7z decoder.
         _currentUnpackTask = this;
-        SRes err = SzAr_DecodeFolder(&parent._db.db, _folderIndex, &parent._stream.vt, parent._db.dataPos, parent._buffer, parent._bufferSize, &parent._allocTemp);
+        SRes err = decodeLzma2Mt();
+        if (err == SZ_ERROR_UNSUPPORTED)
+            err = SzAr_DecodeFolder(&parent._db.db, _folderIndex, &parent._stream.vt, parent._db.dataPos, parent._buffer, parent._bufferSize, &parent._allocTemp);
         _currentUnpackTask = nullptr;
         if (err)
         {
@@ -161,6 +235,81 @@ void PayloadTask::UnpackTask::execute()
     }
 }
 
+SRes PayloadTask::UnpackTask::decodeLzma2Mt()
+{
+    auto& parent = this->parent();
+    const CSzAr& db = parent._db.db;
+
+    // Only a folder with a single LZMA2 coder and one pack stream can be
+    // handed to the multithreaded decoder.  Folders with filters (BCJ, etc.)
+    // use the 7z decoder.
+    CSzData sd;
+    sd.Data = db.CodersData + db.FoCodersOffsets[_folderIndex];
+    sd.Size = db.FoCodersOffsets[_folderIndex + 1] - db.FoCodersOffsets[_folderIndex];
+    CSzFolder folder;
+    if (SzGetNextFolderItem(&folder, &sd) != SZ_OK || folder.NumCoders != 1 ||
+        folder.NumPackStreams != 1 || folder.Coders[0].MethodID != k7zMethodLzma2 ||
+        folder.Coders[0].PropsSize != 1)
+    {
+        return SZ_ERROR_UNSUPPORTED;
+    }
+    Byte prop = (db.CodersData + db.FoCodersOffsets[_folderIndex])[folder.Coders[0].PropsOffset];
+
+    if (_inputStreamOffset + _inputStreamLength > parent._stream.size)
+        return SZ_ERROR_DATA;
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    unsigned numThreads = systemInfo.dwNumberOfProcessors;
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > MaxDecodeThreads)
+        numThreads = MaxDecodeThreads;
+
+    CLzma2DecMtProps props;
+    Lzma2DecMtProps_Init(&props);
+    props.numThreads = numThreads;
+
+    CMemorySeqInStream inStream;
+    inStream.vt.Read = &MemorySeqInStream_Read;
+    inStream.buf = parent._stream.buf + _inputStreamOffset;
+    inStream.size = _inputStreamLength;
+    inStream.pos = 0;
+
+    CMemorySeqOutStream outStream;
+    outStream.vt.Write = &MemorySeqOutStream_Write;
+    outStream.buf = parent._buffer;
+    outStream.size = parent._bufferSize;
+    outStream.pos = 0;
+
+    CDecodeProgress progress;
+    progress.vt.Progress = &DecodeProgress_Progress;
+    progress.inputStreamOffset = _inputStreamOffset;
+
+    CLzma2DecMtHandle decoder = Lzma2DecMt_Create(&parent._alloc, &parent._allocTemp);
+    if (!decoder)
+        return SZ_ERROR_MEM;
+    UInt64 outSize = parent._bufferSize;
+    UInt64 inProcessed = 0;
+    int isMT = 0;
+    SRes err = Lzma2DecMt_Decode(decoder, prop, &props, &outStream.vt, &outSize, 1,
+                                 &inStream.vt, &inProcessed, &isMT, &progress.vt);
+    Lzma2DecMt_Destroy(decoder);
+
+    LOG("Decoded LZMA2 folder %d with %d threads (%s)", _folderIndex, numThreads,
+        isMT ? "multithreaded" : "stream has no independent blocks, used one thread");
+
+    if (err == SZ_OK && outStream.pos != parent._bufferSize)
+        err = SZ_ERROR_DATA;
+    // SzAr_DecodeFolder() checks the folder CRC, do the same here
+    if (err == SZ_OK && SzBitWithVals_Check(&db.FolderCRCs, _folderIndex) &&
+        CrcCalc(parent._buffer, parent._bufferSize) != db.FolderCRCs.Vals[_folderIndex])
+    {
+        err = SZ_ERROR_CRC;
+    }
+    return err;
+}
+
 void PayloadTask::UnpackTask::inputStreamPosition(size_t offset, size_t size)
 {
     if (_inputStreamLength > 0)
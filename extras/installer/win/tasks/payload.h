@@ -58,6 +58,10 @@ private:
         virtual double getEstimatedExecutionTime() const override { return _folderSize / DecompressBytesPerSecond; }
         virtual double getEstimatedRollbackTime() const override { return 0.0; }
         void inputStreamPosition(size_t offset, size_t size);
+    private:
+        // Decode an LZMA2 folder with the multithreaded decoder.  Returns
+        // SZ_ERROR_UNSUPPORTED if the folder can't be decoded this way.
+        SRes decodeLzma2Mt();
     private:
         UInt32 _folderIndex;
         size_t _folderSize;
@@ -489,3 +489,46 @@ QJsonValue scutilParse(const QString &text)
         return QJsonValue::Undefined;
     }
 }
+
+QStringList scutilSplit(const QString &text)
+{
+    QStringList results;
+    QString current;
+    int depth{0};
+    const auto lines = text.split('\n');
+    for(const auto &line : lines)
+    {
+        const QString trimmed{line.trimmed()};
+        if(depth == 0)
+        {
+            // Between objects - this is the start of an object or a key error.
+            // Anything else (like blank lines) isn't part of a result.
+            if(line.startsWith('<') && trimmed.endsWith('{'))
+            {
+                current = line + '\n';
+                depth = 1;
+            }
+            else if(trimmed == QStringLiteral("No such key"))
+                results.push_back(QStringLiteral("  No such key\n"));
+            continue;
+        }
+
+        current += line + '\n';
+        if(trimmed.endsWith('{'))
+            ++depth;
+        else if(trimmed == QStringLiteral("}"))
+            --depth;
+
+        if(depth == 0)
+        {
+            results.push_back(current);
+            current.clear();
+        }
+    }
+
+    // An incomplete object is still returned, scutilParse() will reject it
+    if(depth > 0)
+        results.push_back(current);
+
+    return results;
+}
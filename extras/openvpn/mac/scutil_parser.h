@@ -18,8 +18,15 @@
 
 #pragma once
 #include <QString>
+#include <QStringList>
 #include <QJsonValue>
 
 // Entrypoint for parser code - takes a string of scutil object syntax,
 // parses it, and returns the correspondong QJson object.
 QJsonValue scutilParse(const QString &text);
+
+// Split the output of a scutil session containing several 'show' commands into
+// the output of each command (each a complete object or a "No such key"
+// error), so each can be passed to scutilParse().  This allows several keys to
+// be read with one scutil process.
+QStringList scutilSplit(const QString &text);
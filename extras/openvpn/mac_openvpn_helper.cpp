@@ -112,13 +112,40 @@ QJsonObject scutilGet(const QString& path, bool* present = nullptr)
     return value.toObject();
 }
 
-bool scutilExists(const QString& path)
+// Get several keys with one scutil process.  Like scutilGet(), a key that
+// isn't present results in a non-object value (which becomes an empty object
+// with toObject()).
+QList<QJsonValue> scutilGetMultiple(const QStringList& paths)
 {
-    bool exists;
-    QJsonObject data = scutilGet(path, &exists);
-    return exists && !data.contains(QStringLiteral("PIAEmpty"));
+    QStringList commands{QStringLiteral("open")};
+    for(const auto &path : paths)
+        commands << QStringLiteral("show %1").arg(path);
+    commands << QStringLiteral("quit");
+
+    QStringList outputs = scutilSplit(QString(scutil(commands, IgnoreErrors)));
+    QList<QJsonValue> values;
+    if(outputs.size() != paths.size())
+    {
+        // Shouldn't happen, but if the output can't be matched up with the
+        // keys, read them individually instead
+        qWarning() << "Expected" << paths.size() << "scutil results, got"
+            << outputs.size() << "- reading keys individually";
+        for(const auto &path : paths)
+            values.push_back(scutilParse(QString(scutil({ QStringLiteral("open"), QStringLiteral("show %1").arg(path), QStringLiteral("quit") }, IgnoreErrors))));
+        return values;
+    }
+
+    for(const auto &output : outputs)
+        values.push_back(scutilParse(output));
+    return values;
 }
 
+bool scutilValueExists(const QJsonValue& value)
+{
+    return value.isObject() && !value.toObject().contains(QStringLiteral("PIAEmpty"));
+}
+
+
 QStringList arrayToStringList(const QJsonArray& array)
 {
     QStringList result;
@@ -183,9 +210,14 @@ void applyConfiguration(const QString &primaryService, int killPid, QStringList
 
     QByteArray oldDNS = scutil({ QStringLiteral("open"), QStringLiteral("show State:/Network/Global/DNS"), QStringLiteral("quit") });
 
-    QJsonObject primaryIPv4 = scutilGet(QStringLiteral("State:/Network/Service/%1/IPv4").arg(primaryService));
-    QJsonObject primarySetupDNS = scutilGet(QStringLiteral("Setup:/Network/Service/%1/DNS").arg(primaryService));
-    QJsonObject primarySetupSMB = scutilGet(QStringLiteral("Setup:/Network/Service/%1/SMB").arg(primaryService));
+    const auto primaryValues = scutilGetMultiple({
+        QStringLiteral("State:/Network/Service/%1/IPv4").arg(primaryService),
+        QStringLiteral("Setup:/Network/Service/%1/DNS").arg(primaryService),
+        QStringLiteral("Setup:/Network/Service/%1/SMB").arg(primaryService)
+    });
+    QJsonObject primaryIPv4 = primaryValues[0].toObject();
+    QJsonObject primarySetupDNS = primaryValues[1].toObject();
+    QJsonObject primarySetupSMB = primaryValues[2].toObject();
 
     QStringList originalAddresses = arrayToStringList(primaryIPv4.value(QLatin1String("Addresses")).toArray());
     QStringList staticDNSServers = arrayToStringList(primarySetupDNS.value(QLatin1String("ServerAddresses")).toArray());
@@ -285,9 +317,22 @@ void restoreConfiguration()
     QStringList commands;
     commands << QStringLiteral("open");
 
-    QJsonObject intendedDNS = scutilGet(QStringLiteral("State:/Network/PrivateInternetAccess/DNS"));
+    const QString oldStateDNSKey{QStringLiteral("State:/Network/PrivateInternetAccess/OldStateDNS")};
+    const QString stateDNSKey{QStringLiteral("State:/Network/Service/%1/DNS").arg(service)};
+    const QString oldSetupDNSKey{QStringLiteral("State:/Network/PrivateInternetAccess/OldSetupDNS")};
+    const QString setupDNSKey{QStringLiteral("Setup:/Network/Service/%1/DNS").arg(service)};
+    const QString oldStateSMBKey{QStringLiteral("State:/Network/PrivateInternetAccess/OldStateSMB")};
+    const QString stateSMBKey{QStringLiteral("State:/Network/Service/%1/SMB").arg(service)};
+
+    // Read everything needed with one scutil process
+    const auto values = scutilGetMultiple({
+        QStringLiteral("State:/Network/PrivateInternetAccess/DNS"),
+        oldStateDNSKey, stateDNSKey, oldSetupDNSKey, setupDNSKey, oldStateSMBKey, stateSMBKey
+    });
+    QJsonObject intendedDNS = values[0].toObject();
 
-    auto restoreConfigKey = [&commands, &intendedDNS](const QString& savedKey, const QString& destKey)
+    auto restoreConfigKey = [&commands, &intendedDNS](const QString& savedKey, const QJsonValue& savedValue,
+                                                      const QString& destKey, const QJsonValue& destValue)
     {
         // Only restore the key if the value PIA applied is still there.
         // Otherwise, it has likely been changed by the system to reflect a new
@@ -296,14 +341,12 @@ void restoreConfiguration()
         // In particular, we shouldn't restore to a "State" key that no longer
         // exists, that commonly happens when a network interface is
         // disconnected while connected to PIA.
-        bool destExists;
-        QJsonObject destValue = scutilGet(destKey, &destExists);
         // We can restore the backup over this value if it still exists and is still
         // set to the configuration applied by PIA
-        if(destExists && destValue == intendedDNS)
+        if(destValue.isObject() && destValue.toObject() == intendedDNS)
         {
             // If we backed up a value (and it's not PIAEmpty), restore it.
-            if (scutilExists(savedKey))
+            if (scutilValueExists(savedValue))
             {
                 commands << QStringLiteral("get %1").arg(savedKey);
                 commands << QStringLiteral("set %1").arg(destKey);
@@ -319,9 +362,9 @@ void restoreConfiguration()
         commands << QStringLiteral("remove %1").arg(savedKey);
     };
 
-    restoreConfigKey(QStringLiteral("State:/Network/PrivateInternetAccess/OldStateDNS"), QStringLiteral("State:/Network/Service/%1/DNS").arg(service));
-    restoreConfigKey(QStringLiteral("State:/Network/PrivateInternetAccess/OldSetupDNS"), QStringLiteral("Setup:/Network/Service/%1/DNS").arg(service));
-    restoreConfigKey(QStringLiteral("State:/Network/PrivateInternetAccess/OldStateSMB"), QStringLiteral("State:/Network/Service/%1/SMB").arg(service));
+    restoreConfigKey(oldStateDNSKey, values[1], stateDNSKey, values[2]);
+    restoreConfigKey(oldSetupDNSKey, values[3], setupDNSKey, values[4]);
+    restoreConfigKey(oldStateSMBKey, values[5], stateSMBKey, values[6]);
 
     commands << QStringLiteral("remove State:/Network/PrivateInternetAccess/DNS");
     commands << QStringLiteral("remove State:/Network/PrivateInternetAccess");
@@ -338,8 +381,15 @@ void restoreConfiguration()
 
 void configurationChanged()
 {
-    bool present;
-    QJsonObject setupParams = scutilGet(QStringLiteral("State:/Network/PrivateInternetAccess/SetupParams"), &present);
+    // Read the PIA state and the current primary service with one scutil
+    // process
+    const auto stateValues = scutilGetMultiple({
+        QStringLiteral("State:/Network/PrivateInternetAccess/SetupParams"),
+        QStringLiteral("State:/Network/PrivateInternetAccess"),
+        QStringLiteral("State:/Network/Global/IPv4")
+    });
+    bool present = stateValues[0].isObject();
+    QJsonObject setupParams = stateValues[0].toObject();
 
     if(!present)
     {
@@ -361,12 +411,24 @@ void configurationChanged()
 
     uint killPid = setupParams.value(QLatin1String("killPid")).toString().toUInt();
 
-    QJsonObject data = scutilGet(QStringLiteral("State:/Network/PrivateInternetAccess"));
+    QJsonObject data = stateValues[1].toObject();
 
     QString oldPrimary = data.value(QLatin1String("Service")).toString();
     QStringList originalAddresses = arrayToStringList(data.value(QLatin1String("Addresses")).toArray());
-    QString currentPrimary{detectPrimaryService()};
-    QStringList currentAddresses = arrayToStringList(scutilGet(QStringLiteral("State:/Network/Service/%1/IPv4").arg(currentPrimary)).value(QLatin1String("Addresses")).toArray());
+    QString currentPrimary{stateValues[2].toObject().value(QLatin1String("PrimaryService")).toString()};
+    qInfo() << "Primary service:" << currentPrimary;
+
+    // Read the primary service's state and all of the DNS configuration with
+    // one scutil process
+    const auto serviceValues = scutilGetMultiple({
+        QStringLiteral("State:/Network/Service/%1/IPv4").arg(currentPrimary),
+        QStringLiteral("State:/Network/PrivateInternetAccess/OldStateDNS"),
+        QStringLiteral("State:/Network/PrivateInternetAccess/OldSetupDNS"),
+        QStringLiteral("State:/Network/PrivateInternetAccess/DNS"),
+        QStringLiteral("State:/Network/Service/%1/DNS").arg(currentPrimary),
+        QStringLiteral("Setup:/Network/Service/%1/DNS").arg(currentPrimary)
+    });
+    QStringList currentAddresses = arrayToStringList(serviceValues[0].toObject().value(QLatin1String("Addresses")).toArray());
 
     // Have the primary service or the local IP addresses changed?
     if(oldPrimary != currentPrimary || originalAddresses != currentAddresses)
@@ -416,11 +478,11 @@ void configurationChanged()
         return;
     }
 
-    QJsonObject oldStateDNS = scutilGet(QStringLiteral("State:/Network/PrivateInternetAccess/OldStateDNS"));
-    QJsonObject oldSetupDNS = scutilGet(QStringLiteral("State:/Network/PrivateInternetAccess/OldSetupDNS"));
-    QJsonObject intendedDNS = scutilGet(QStringLiteral("State:/Network/PrivateInternetAccess/DNS"));
-    QJsonObject currentStateDNS = scutilGet(QStringLiteral("State:/Network/Service/%1/DNS").arg(currentPrimary));
-    QJsonObject currentSetupDNS = scutilGet(QStringLiteral("Setup:/Network/Service/%1/DNS").arg(currentPrimary));
+    QJsonObject oldStateDNS = serviceValues[1].toObject();
+    QJsonObject oldSetupDNS = serviceValues[2].toObject();
+    QJsonObject intendedDNS = serviceValues[3].toObject();
+    QJsonObject currentStateDNS = serviceValues[4].toObject();
+    QJsonObject currentSetupDNS = serviceValues[5].toObject();
 
     // Check if DNS has changed
     if (data.value(QLatin1String("OverrideDNS")).toString() == QLatin1String("TRUE"))
@@ -39,7 +39,7 @@ Item {
 
   function trySendPayload () {
       retryCount ++;
-      ReportHelper.sendPayload(PayloadBuilder.payloadZipContent(),
+      ReportHelper.sendPayload(PayloadBuilder.payloadZipPath(),
                                comments.text)
       formStatus = 1
   }
@@ -23,9 +23,15 @@
 #include <common/src/builtin/path.h>
 #include "reporthelper.h"
 
-QByteArray PayloadBuilder::payloadZipContent() const
+namespace
 {
-    return _payloadZipContent;
+    // Log files are copied into the combined log file in chunks of this size
+    const qint64 copyChunkSize = 256 * 1024;
+}
+
+QString PayloadBuilder::payloadZipPath() const
+{
+    return _payloadZipPath;
 }
 
 PayloadBuilder::PayloadBuilder(QObject *parent)
@@ -47,7 +53,7 @@ void PayloadBuilder::start()
     // Create a new file in the payload called "logs.txt" which will contain all logs added via addLogFile
     _combinedLogFile.reset(new QFile(payloadPath("logs.txt")));
     _combinedLogFile->open(QIODevice::WriteOnly);
-    _payloadZipContent.clear();
+    _payloadZipPath.clear();
 }
 
 bool PayloadBuilder::finish(const QString &copyToPath)
@@ -83,9 +89,7 @@ bool PayloadBuilder::finish(const QString &copyToPath)
         QFile resultFile(_targetDir->filePath(PAYLOAD_FILE));
         qDebug() << (_targetDir->filePath(PAYLOAD_FILE));
         if(resultFile.exists()) {
-            resultFile.open(QIODevice::ReadOnly);
-            _payloadZipContent.append(resultFile.readAll());
-            resultFile.close();
+            _payloadZipPath = resultFile.fileName();
 
             // If we need to store a copy elsewhere (for save as zip) make a copy
             // but success is determined by whether we could copy or not.
@@ -189,9 +193,15 @@ void PayloadBuilder::addLogFile(const QString &fullPath)
             return;
         }
 
+        // Copy in chunks rather than reading the whole file into memory
         QFile file(fi.filePath());
         file.open(QFile::ReadOnly);
-        _combinedLogFile->write(file.readAll());
+        while(!file.atEnd()) {
+            const QByteArray &chunk = file.read(copyChunkSize);
+            if(chunk.isEmpty())
+                break;
+            _combinedLogFile->write(chunk);
+        }
         file.close();
     }
     else {
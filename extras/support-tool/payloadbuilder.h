@@ -48,8 +48,10 @@ private:
     // Target temp dir where we build the payload
     QScopedPointer<QTemporaryDir> _targetDir;
 
-    // A bute array containing the contents of the zip file for uploading
-    QByteArray _payloadZipContent;
+    // Path to the zip file for uploading, once it has been built.  The zip is
+    // uploaded directly from disk rather than read into memory, since it can
+    // be large with largeLogFiles enabled.
+    QString _payloadZipPath;
 
     // Returns a full filesystem path for a given relative file path
     // For example, if "file" is "client-crash/bar.dmp"
@@ -86,7 +88,7 @@ public:
     // Add any misc file (currently used for diagnostics.txt)
     Q_INVOKABLE void addFile (const QString &fullPath);
 
-    Q_INVOKABLE QByteArray payloadZipContent() const;
+    Q_INVOKABLE QString payloadZipPath() const;
 signals:
 
 public slots:
@@ -45,23 +45,28 @@
 
 QObject *ReportHelper::_uiParams;
 
-void ReportHelper::sendPayload(const QByteArray &payloadContent, const QString &comment)
+void ReportHelper::sendPayload(const QString &payloadPath, const QString &comment)
 {
     // Set up the request
     QString url = getUrl();
-    qDebug () << "Sending payload to URL: " << url << "Payload size: " << payloadContent.size();
+    qDebug () << "Sending payload to URL: " << url << "Payload size: " << QFileInfo(payloadPath).size();
     _request.setUrl(url);
 
     // Create a multipart uploader. We will delete this in `onUploadFinished`
     QHttpMultiPart *uploader = new QHttpMultiPart(QHttpMultiPart::FormDataType);
 
     //
-    // Create a file part from the zip file contents from PayloadBuilder
+    // Create a file part from the zip file built by PayloadBuilder.  The body
+    // is streamed from the file as it's uploaded; the file is owned by the
+    // uploader so it stays open until the upload is done.
     //
+    QFile *payloadFile = new QFile(payloadPath, uploader);
+    if(!payloadFile->open(QIODevice::ReadOnly))
+        qWarning () << "Unable to open payload file" << payloadPath << "-" << payloadFile->errorString();
     QHttpPart filePart;
     filePart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"payload\"; filename=\""+ PAYLOAD_FILE + "\""));
     filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/octet-stream"));
-    filePart.setBody(payloadContent);
+    filePart.setBodyDevice(payloadFile);
 
     //
     // Create parts for the version/comment/platform
@@ -34,7 +34,8 @@ class ReportHelper: public QObject
     Q_OBJECT
 
 public:
-    Q_INVOKABLE void sendPayload(const QByteArray &payloadContent, const QString &comment);
+    // Upload the payload zip file (see PayloadBuilder::payloadZipPath())
+    Q_INVOKABLE void sendPayload(const QString &payloadPath, const QString &comment);
     Q_INVOKABLE void restartApp(bool safeMode);
     Q_INVOKABLE void exitReporter();
     Q_INVOKABLE void showFileInSystemViewer(const QString &fullPath);
@@ -0,0 +1,136 @@
+require_relative 'src/piactl.rb'
+require_relative 'src/regions.rb'
+require_relative 'src/leakchecker.rb'
+require_relative 'src/latencystats.rb'
+require_relative 'src/systemutil'
+require 'securerandom'
+require 'socket'
+require 'time'
+require 'timeout'
+
+# These measure how long the common user-visible operations take, so builds can
+# be compared on the same reference machine.  They take a while and depend on
+# the network, so they're excluded by default; run them with:
+#   rspec --tag performance performance_spec.rb
+#
+# PERF_ITERATIONS sets the number of samples per measurement (default 5), and
+# the results are written as JSON to PERF_REPORT (default perf_report.json).
+# PROTOCOL limits the measurements to one protocol, like the other specs.
+PERF_ITERATIONS = (ENV['PERF_ITERATIONS'] || 5).to_i
+PERF_REPORT = ENV['PERF_REPORT'] || 'perf_report.json'
+
+# URL fetched through the tunnel to measure time to first byte
+FIRST_BYTE_URL = "https://www.privateinternetaccess.com/api/client/status"
+
+# Poll the block until it returns true; returns the monotonic time at the
+# start of the successful poll
+def wait_until(timeout, description)
+    deadline = LatencyStats.now + timeout
+    loop do
+        poll_start = LatencyStats.now
+        return poll_start if yield
+        raise Timeout::Error, "Timed out waiting for #{description}" if LatencyStats.now > deadline
+        sleep 0.05
+    end
+end
+
+# Connect and return the monotonic time when the daemon reported Connected
+def timed_connect(stats, metric)
+    monitor = PiaCtlMonitor.new("connectionstate")
+    start = LatencyStats.now
+    raise "Failed to connect" if PiaCtl.run_and_wait(['connect']) != 0
+    monitor.expect "Connected", 60
+    connected_at = LatencyStats.now
+    monitor.stop
+    stats.record(metric, (connected_at - start) * 1000.0)
+    connected_at
+end
+
+def first_byte_received?
+    system "curl", "--silent", "--output", File::NULL, "--max-time", "2",
+        FIRST_BYTE_URL, :out => File::NULL, :err => File::NULL
+end
+
+# Resolve a unique name so the result can't be cached anywhere
+def resolve_uncached
+    Addrinfo.getaddrinfo("#{SecureRandom.hex(8)}.privateinternetaccess.com", nil)
+rescue SocketError
+    # NXDOMAIN is expected, the round trip to the resolver is what's measured
+end
+
+stats = LatencyStats.new
+protocols = ENV['PROTOCOL'] ? [ENV['PROTOCOL']] : PiaCtl::Protocols
+
+describe "Connection performance", :performance => true do
+    after(:all) do
+        stats.print_summary
+        stats.write_report(PERF_REPORT, {
+            os: SystemUtil.os,
+            arch: SystemUtil.arch,
+            iterations: PERF_ITERATIONS,
+            time: Time.now.utc.iso8601
+        })
+        puts "Performance report written to #{PERF_REPORT}"
+    end
+
+    protocols.each do |protocol|
+        describe "with #{protocol}" do
+            before(:each) do
+                PiaCtl.set("protocol", protocol)
+            end
+
+            it "measures connect, first byte, and DNS latency" do
+                PERF_ITERATIONS.times do
+                    connected_at = timed_connect(stats, "#{protocol} connect")
+
+                    first_byte_at = wait_until(30, "first byte through the tunnel") { first_byte_received? }
+                    stats.record("#{protocol} first byte after connect", (first_byte_at - connected_at) * 1000.0)
+
+                    stats.measure("#{protocol} DNS after connect") { resolve_uncached }
+
+                    PiaCtl.disconnect
+                end
+            end
+
+            it "measures region switch time" do
+                regions = Regions.get_subset_of_regions
+                PiaCtl.set("region", regions.first)
+                PiaCtl.connect
+                regions.drop(1).first(PERF_ITERATIONS).each do |region|
+                    monitor = PiaCtlMonitor.new("connectionstate")
+                    monitor.expect "Connected"
+                    start = LatencyStats.now
+                    PiaCtl.set("region", region)
+                    # Wait for the reconnect to start, then to finish
+                    monitor.expect_match(/^(?!Connected$)/)
+                    monitor.expect "Connected", 60
+                    stats.record("#{protocol} region switch", (LatencyStats.now - start) * 1000.0)
+                    monitor.stop
+                end
+            end
+        end
+    end
+
+    describe "firewall" do
+        # The firewall apply time is measured by enabling the killswitch while
+        # disconnected and probing for leaks until they're blocked.  The
+        # resolution is limited by the probe time.
+        it "measures killswitch apply time" do
+            PiaCtl.set_unstable("killswitch", "off")
+            leak_checker = LeakChecker.new
+            methods = leak_checker.available_methods
+            skip "No leak check method works on this system" if methods.empty?
+            method = methods.first
+
+            PERF_ITERATIONS.times do
+                PiaCtl.set_unstable("killswitch", "off")
+                wait_until(30, "killswitch to turn off") { leak_checker.leaks?(method) }
+
+                start = LatencyStats.now
+                PiaCtl.set_unstable("killswitch", "on")
+                blocked_at = wait_until(30, "killswitch to block leaks") { !leak_checker.leaks?(method) }
+                stats.record("firewall apply (#{method})", (blocked_at - start) * 1000.0)
+            end
+        end
+    end
+end
@@ -0,0 +1,72 @@
+require 'json'
+
+# Collects timing samples for named metrics and reports percentiles.
+# Used by the performance specs to compare builds on the same machine.
+class LatencyStats
+    PERCENTILES = [50, 90, 99]
+
+    def initialize
+        @samples = Hash.new { |hash, key| hash[key] = [] }
+    end
+
+    # Monotonic time in seconds, for measuring intervals
+    def self.now
+        Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    end
+
+    # Run the block and record how long it took (in milliseconds) under
+    # metric.  Returns the block's result.
+    def measure(metric)
+        start = LatencyStats.now
+        result = yield
+        record(metric, (LatencyStats.now - start) * 1000.0)
+        result
+    end
+
+    def record(metric, msec)
+        @samples[metric] << msec
+    end
+
+    # Nearest-rank percentile of the samples
+    def self.percentile(samples, pct)
+        sorted = samples.sort
+        rank = ((pct / 100.0) * sorted.length).ceil - 1
+        sorted[rank.clamp(0, sorted.length - 1)]
+    end
+
+    def summary
+        @samples.transform_values do |samples|
+            stats = {
+                count: samples.length,
+                min: samples.min.round(1),
+                mean: (samples.sum / samples.length).round(1),
+                max: samples.max.round(1)
+            }
+            PERCENTILES.each do |pct|
+                stats["p#{pct}".to_sym] = LatencyStats.percentile(samples, pct).round(1)
+            end
+            stats
+        end
+    end
+
+    # Print a table of the metrics, all times in milliseconds
+    def print_summary
+        columns = [:count, :min, *PERCENTILES.map { |pct| "p#{pct}".to_sym }, :max, :mean]
+        name_width = [@samples.keys.map(&:length).max || 0, 6].max
+        puts "#{'metric'.ljust(name_width)}  #{columns.map { |c| c.to_s.rjust(9) }.join}"
+        summary.each do |metric, stats|
+            puts "#{metric.ljust(name_width)}  #{columns.map { |c| stats[c].to_s.rjust(9) }.join}"
+        end
+    end
+
+    # Write the summary and raw samples as JSON, so results from different
+    # builds can be compared
+    def write_report(path, metadata = {})
+        report = {
+            metadata: metadata,
+            summary: summary,
+            samples: @samples
+        }
+        File.write(path, JSON.pretty_generate(report))
+    end
+end
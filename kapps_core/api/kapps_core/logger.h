@@ -93,6 +93,45 @@ typedef struct KACLogCallback
 // is changed then the old one will no longer be called from any thread.
 KAPPS_CORE_EXPORT void KACLogInit(KACLogCallback *pCallback);
 
+// The batched callback implemented by the application to receive log messages.
+//
+// This is called on a kapps_core delivery thread with an array of messages,
+// in the order they were logged.  Calls are serialized.  The messages (and the
+// strings they refer to) are only valid for the duration of the call.  As with
+// KACLogCallbackWrite, the callback MUST NOT create any log messages.
+typedef void (*KACLogCallbackWriteBatch)(
+    void *pContext, // Context for user, specified when installing callback
+    const KACLogMessage *pMessages,
+    size_t count
+);
+
+// Structure defining the batched log callback.
+typedef struct KACLogBatchCallback
+{
+    void *pContext; // User context pointer, forwarded to callbacks
+    KACLogCallbackWriteBatch pWriteBatchFn;
+    // Maximum number of messages in one call; 0 uses a default (256)
+    size_t maxBatch;
+    // Maximum time a message waits for a batch to fill before it's delivered,
+    // in milliseconds; 0 uses a default (100).  Fatal messages are delivered
+    // immediately.
+    unsigned maxDelayMs;
+} KACLogBatchCallback;
+
+// Initialize the logger with a batched callback, as an alternative to
+// KACLogInit().  Logging threads just queue each message; the callback is
+// called from a background thread, so a slow sink doesn't block the threads
+// that log.  If the callback falls far behind, messages are dropped, and a
+// warning with the number dropped is delivered once it catches up.
+//
+// The KACLogBatchCallback struct is copied.  When the callback is changed
+// (with this function or KACLogInit()), queued messages are delivered to the
+// old callback before this returns; it's not called after that.
+//
+// Messages refer to their log categories until delivered, so dynamically
+// created categories/modules must outlive any messages queued for them.
+KAPPS_CORE_EXPORT void KACLogInitBatched(KACLogBatchCallback *pCallback);
+
 // Enable or disable logging.  Logging is initially disabled.  This can be
 // called before installing a log callback; traces will start to be written
 // once the callback is installed.
@@ -100,6 +139,20 @@ KAPPS_CORE_EXPORT void KACEnableLogging(int enable);
 // Check whether logging is enabled.
 KAPPS_CORE_EXPORT int KACLoggingEnabled();
 
+// Set the most verbose level logged for a category (a
+// KAPPS_CORE_LOG_MESSAGE_LEVEL_* value).  Messages in the category that are
+// more verbose are skipped before they're rendered, so they cost about as
+// little as they would with logging disabled.
+//
+// If category is empty, the level applies to all categories in the module
+// that don't have their own level.  Pass any other value for maxLevel (such as
+// -1) to remove the level for that category or module.
+KAPPS_CORE_EXPORT void KACLogSetCategoryLevel(KACStringSlice module,
+                                              KACStringSlice category,
+                                              int maxLevel);
+// Remove all category levels set with KACLogSetCategoryLevel().
+KAPPS_CORE_EXPORT void KACLogClearCategoryLevels();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,62 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "arena.h"
+#include <cstdint>
+#include <new>
+
+namespace kapps::core {
+
+void *Arena::allocate(std::size_t size, std::size_t align)
+{
+    // Align the next pointer within the current chunk, if there's room
+    if(_pNext)
+    {
+        std::size_t padding = (align - reinterpret_cast<std::uintptr_t>(_pNext) % align) % align;
+        if(padding + size <= _remaining)
+        {
+            void *pResult = _pNext + padding;
+            _pNext += padding + size;
+            _remaining -= padding + size;
+            _bytesUsed += size;
+            return pResult;
+        }
+    }
+
+    // Large allocations get their own chunk, so they don't waste the rest of
+    // the current chunk.  Chunks from new[] are aligned for any fundamental
+    // type; over-aligned types aren't supported.
+    if(align > alignof(std::max_align_t))
+        throw std::bad_alloc{};
+    if(size > _chunkSize / 4)
+    {
+        _chunks.push_back(std::unique_ptr<std::byte[]>{new std::byte[size]});
+        _bytesReserved += size;
+        _bytesUsed += size;
+        return _chunks.back().get();
+    }
+
+    _chunks.push_back(std::unique_ptr<std::byte[]>{new std::byte[_chunkSize]});
+    _bytesReserved += _chunkSize;
+    _pNext = _chunks.back().get() + size;
+    _remaining = _chunkSize - size;
+    _bytesUsed += size;
+    return _chunks.back().get();
+}
+
+}
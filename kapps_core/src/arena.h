@@ -0,0 +1,111 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace kapps::core {
+
+// Arena is a simple bump allocator for object graphs that are built all at
+// once and then freed all at once, like a RegionList or Metadata.  Memory is
+// taken from large chunks, individual deallocations do nothing, and all chunks
+// are freed together when the Arena is destroyed.
+//
+// Arena is not thread-safe; allocations must be synchronized (typically, all
+// allocations occur while building the object graph on one thread).
+//
+// Objects are normally allocated with makeArenaShared<T>(), which places both
+// the object and the shared_ptr control block in the arena.  Each of those
+// control blocks holds a reference to the Arena, so the arena lives until the
+// last object allocated from it is released - objects can still be retained
+// independently (including via the C API), but note that retaining any one
+// object keeps the whole arena alive.
+class KAPPS_CORE_EXPORT Arena
+{
+public:
+    // Default chunk size - large allocations get a dedicated chunk
+    enum : std::size_t { DefaultChunkSize = 64 * 1024 };
+
+public:
+    explicit Arena(std::size_t chunkSize = DefaultChunkSize) : _chunkSize{chunkSize} {}
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+public:
+    // Allocate storage with the given size and alignment.  Throws
+    // std::bad_alloc if the storage can't be allocated.
+    void *allocate(std::size_t size, std::size_t align);
+
+    // Total bytes handed out by allocate(), and total bytes reserved in chunks
+    std::size_t bytesUsed() const {return _bytesUsed;}
+    std::size_t bytesReserved() const {return _bytesReserved;}
+    std::size_t chunkCount() const {return _chunks.size();}
+
+private:
+    std::size_t _chunkSize;
+    std::vector<std::unique_ptr<std::byte[]>> _chunks;
+    // Free space in the current chunk
+    std::byte *_pNext{nullptr};
+    std::size_t _remaining{0};
+    std::size_t _bytesUsed{0};
+    std::size_t _bytesReserved{0};
+};
+
+// Standard allocator allocating from an Arena.  The allocator shares ownership
+// of the Arena, so containers and control blocks using it keep it alive.
+template<class T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+public:
+    explicit ArenaAllocator(std::shared_ptr<Arena> pArena) : _pArena{std::move(pArena)} {}
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : _pArena{other.arena()} {}
+
+public:
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T*>(_pArena->allocate(sizeof(T) * n, alignof(T)));
+    }
+    void deallocate(T *, std::size_t) {}   // Freed with the arena
+
+    const std::shared_ptr<Arena> &arena() const {return _pArena;}
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U> &other) const {return _pArena == other.arena();}
+    template<class U>
+    bool operator!=(const ArenaAllocator<U> &other) const {return _pArena != other.arena();}
+
+private:
+    std::shared_ptr<Arena> _pArena;
+};
+
+// Create a shared object in an arena - like std::make_shared(), but both the
+// object and its control block are allocated from pArena.
+template<class T, class... Args>
+std::shared_ptr<T> makeArenaShared(const std::shared_ptr<Arena> &pArena, Args&&... args)
+{
+    return std::allocate_shared<T>(ArenaAllocator<T>{pArena}, std::forward<Args>(args)...);
+}
+
+}
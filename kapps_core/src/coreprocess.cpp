@@ -22,10 +22,80 @@
 #include "coreprocess.h"
 #include "logger.h"
 #include <signal.h>
+#include <spawn.h>
 #include <sys/wait.h>
 
+#if defined(KAPPS_CORE_OS_MACOS)
+#include <crt_externs.h>
+#else
+extern char **environ;
+#endif
+
 namespace kapps { namespace core {
 
+namespace
+{
+    char **currentEnviron()
+    {
+#if defined(KAPPS_CORE_OS_MACOS)
+        // 'environ' isn't available to shared libraries on macOS
+        return *::_NSGetEnviron();
+#else
+        return ::environ;
+#endif
+    }
+
+    // Trace the spawn latency histogram after this many processes
+    const std::uint64_t spawnLatencyTraceInterval{256};
+}
+
+const std::array<std::chrono::microseconds, SpawnLatencyHistogram::BucketCount-1>
+    SpawnLatencyHistogram::bucketBounds
+{
+    std::chrono::microseconds{100}, std::chrono::microseconds{250},
+    std::chrono::microseconds{500}, std::chrono::microseconds{1000},
+    std::chrono::microseconds{2500}, std::chrono::microseconds{5000},
+    std::chrono::microseconds{10000}
+};
+
+std::uint64_t SpawnLatencyHistogram::record(std::chrono::microseconds latency)
+{
+    std::size_t bucket{0};
+    while(bucket < bucketBounds.size() && latency >= bucketBounds[bucket])
+        ++bucket;
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    return _count.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+auto SpawnLatencyHistogram::buckets() const -> std::array<std::uint64_t, BucketCount>
+{
+    std::array<std::uint64_t, BucketCount> values;
+    for(std::size_t i=0; i<BucketCount; ++i)
+        values[i] = _buckets[i].load(std::memory_order_relaxed);
+    return values;
+}
+
+void SpawnLatencyHistogram::trace(std::ostream &os) const
+{
+    auto values = buckets();
+    for(std::size_t i=0; i<BucketCount; ++i)
+    {
+        if(i > 0)
+            os << ", ";
+        if(i < bucketBounds.size())
+            os << "<" << bucketBounds[i].count() << " us: ";
+        else
+            os << ">=" << bucketBounds.back().count() << " us: ";
+        os << values[i];
+    }
+}
+
+SpawnLatencyHistogram &Process::spawnLatency()
+{
+    static SpawnLatencyHistogram _spawnLatency;
+    return _spawnLatency;
+}
+
 Process::Process(std::string pathName, std::vector<std::string> args,
                  std::vector<std::string> env)
     : _pathName{std::move(pathName)},
@@ -78,25 +148,37 @@ void Process::wait(ReadyReadFunc stdoutReadyRead, ReadyReadFunc stderrReadyRead)
     waitPidExit();
 }
 
-void Process::execChild(PosixFd stdoutWriteEnd, PosixFd stderrWriteEnd)
+std::vector<char*> Process::execArgs()
 {
-    // Set stdout/stderr to the write end of the pipes
-    NO_EINTR(dup2(stdoutWriteEnd.get(), STDOUT_FILENO));
-    NO_EINTR(dup2(stderrWriteEnd.get(), STDERR_FILENO));
-
     // The +2 reserves space for
     // (1) the first argument (name of program)
     // (2) the nullptr to indicate end of arg array
     std::vector<char*> cArgs{_args.size() + 2};
-    // +1 for nullptr indicating end of env array
-    std::vector<char*> cEnv{_env.size() + 1};
 
     // First element in args for exec is the name of the program
     // NOT the first argument
     cArgs[0] = &_pathName[0];
 
     std::transform(_args.begin(), _args.end(), cArgs.begin() + 1, [](const std::string& str){return const_cast<char*>(str.c_str());});
+    return cArgs;
+}
+
+std::vector<char*> Process::execEnv()
+{
+    // +1 for nullptr indicating end of env array
+    std::vector<char*> cEnv{_env.size() + 1};
     std::transform(_env.begin(), _env.end(), cEnv.begin(), [](const std::string& str){return const_cast<char*>(str.c_str());});
+    return cEnv;
+}
+
+void Process::execChild(PosixFd stdoutWriteEnd, PosixFd stderrWriteEnd)
+{
+    // Set stdout/stderr to the write end of the pipes
+    NO_EINTR(dup2(stdoutWriteEnd.get(), STDOUT_FILENO));
+    NO_EINTR(dup2(stderrWriteEnd.get(), STDERR_FILENO));
+
+    std::vector<char*> cArgs = execArgs();
+    std::vector<char*> cEnv = execEnv();
 
     int execReturn{-1};
     if(_withEnv)
@@ -266,9 +348,9 @@ void Process::throwIfRunning()
 
 void Process::startChild()
 {
-    // Don't touch any members until we know fork() succeeded.  If it fails, or
-    // anything before that fails (like createPipe()), we throw and remain in
-    // the NotStarted state.
+    // Don't touch any members until we know the child was created.  If that
+    // fails, or anything before that fails (like createPipe()), we throw and
+    // remain in the NotStarted state.
 
     // We need to inherit the write ends across exec() so suppress FD_CLOEXEC
     // initially and only apply it to the read ends.
@@ -283,6 +365,100 @@ void Process::startChild()
     stdoutPipe.writeEnd.applyClOExec();
     stderrPipe.writeEnd.applyClOExec();
 
+    auto spawnStart = std::chrono::steady_clock::now();
+    int childPid{0};
+    // posix_spawn() can't run prepareChildProcess in the child
+    if(!prepareChildProcess)
+        childPid = spawnChild(stdoutPipe.writeEnd, stderrPipe.writeEnd);
+    if(!childPid)
+        childPid = forkChild(std::move(stdoutPipe.writeEnd), std::move(stderrPipe.writeEnd));
+
+    auto spawnCount = spawnLatency().record(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - spawnStart));
+    if(spawnCount % spawnLatencyTraceInterval == 0)
+    {
+        KAPPS_CORE_INFO() << "Spawn latency after" << spawnCount
+            << "processes -" << spawnLatency();
+    }
+
+    _childPid = childPid;
+    // Hang on to the read ends of the pipes.  The write ends will be closed
+    // by the PosixFds in the Pipe objects.
+    std::swap(_stdoutReadEnd, stdoutPipe.readEnd);
+    std::swap(_stderrReadEnd, stderrPipe.readEnd);
+}
+
+int Process::spawnChild(const PosixFd &stdoutWriteEnd, const PosixFd &stderrWriteEnd)
+{
+    posix_spawn_file_actions_t fileActions;
+    posix_spawnattr_t attributes;
+    int result = ::posix_spawn_file_actions_init(&fileActions);
+    if(result)
+    {
+        KAPPS_CORE_WARNING() << "Unable to initialize spawn file actions:"
+            << ErrnoTracer{result};
+        return 0;
+    }
+    result = ::posix_spawnattr_init(&attributes);
+    if(result)
+    {
+        KAPPS_CORE_WARNING() << "Unable to initialize spawn attributes:"
+            << ErrnoTracer{result};
+        ::posix_spawn_file_actions_destroy(&fileActions);
+        return 0;
+    }
+
+    // Set stdout/stderr to the write end of the pipes.  dup2() clears
+    // FD_CLOEXEC on the new descriptors; the pipes themselves are FD_CLOEXEC.
+    result = ::posix_spawn_file_actions_adddup2(&fileActions, stdoutWriteEnd.get(), STDOUT_FILENO);
+    if(!result)
+        result = ::posix_spawn_file_actions_adddup2(&fileActions, stderrWriteEnd.get(), STDERR_FILENO);
+    // Close any other descriptors that weren't opened with FD_CLOEXEC, so they
+    // don't leak into the child
+#if defined(KAPPS_CORE_OS_MACOS)
+    if(!result)
+        result = ::posix_spawn_file_actions_addinherit_np(&fileActions, STDIN_FILENO);
+    if(!result)
+        result = ::posix_spawnattr_setflags(&attributes, POSIX_SPAWN_CLOEXEC_DEFAULT);
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+    if(!result)
+        result = ::posix_spawn_file_actions_addclosefrom_np(&fileActions, STDERR_FILENO+1);
+#endif
+
+    pid_t childPid{0};
+    if(!result)
+    {
+        std::vector<char*> cArgs = execArgs();
+        if(_withEnv)
+        {
+            // Like execve(), this does not search PATH
+            std::vector<char*> cEnv = execEnv();
+            result = ::posix_spawn(&childPid, _pathName.c_str(), &fileActions,
+                                   &attributes, cArgs.data(), cEnv.data());
+        }
+        else
+        {
+            // Like execvp(), search PATH for executable file names
+            result = ::posix_spawnp(&childPid, _pathName.c_str(), &fileActions,
+                                    &attributes, cArgs.data(), currentEnviron());
+        }
+    }
+
+    ::posix_spawnattr_destroy(&attributes);
+    ::posix_spawn_file_actions_destroy(&fileActions);
+
+    if(result)
+    {
+        KAPPS_CORE_WARNING() << "Unable to spawn" << _pathName << "-"
+            << ErrnoTracer{result} << "- falling back to fork()";
+        return 0;
+    }
+    return childPid;
+}
+
+int Process::forkChild(PosixFd stdoutWriteEnd, PosixFd stderrWriteEnd)
+{
     int childPid = ::fork();
 
     if(childPid < 0)
@@ -296,16 +472,9 @@ void Process::startChild()
         // Give the caller a chance to set up any specific requirements in the
         // child process, such as changing UID/GID, etc.
         prepareChildProcess();
-        execChild(std::move(stdoutPipe.writeEnd), std::move(stderrPipe.writeEnd));
-    }
-    else
-    {
-        _childPid = childPid;
-        // Hang on to the read ends of the pipes.  The write ends will be closed
-        // by the PosixFds in the Pipe objects.
-        std::swap(_stdoutReadEnd, stdoutPipe.readEnd);
-        std::swap(_stderrReadEnd, stderrPipe.readEnd);
+        execChild(std::move(stdoutWriteEnd), std::move(stderrWriteEnd));
     }
+    return childPid;
 }
 
 void Process::waitIfAsyncHangup()
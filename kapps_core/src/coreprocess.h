@@ -30,6 +30,8 @@
 #include <atomic>
 #include <array>
 #include <exception>
+#include <chrono>
+#include <cstdint>
 #include <poll.h>
 #include <thread>
 #include "posix/posix_objects.h"
@@ -46,6 +48,29 @@
 
 namespace kapps { namespace core {
 
+// Histogram of the time taken to create child processes - the time spent in
+// posix_spawn() or fork() in the parent.  Process records every child it
+// creates in Process::spawnLatency(), and traces it periodically.
+class KAPPS_CORE_EXPORT SpawnLatencyHistogram : public OStreamInsertable<SpawnLatencyHistogram>
+{
+public:
+    enum : std::size_t { BucketCount = 8 };
+    // Upper bounds of each bucket; the last bucket has no upper bound
+    static const std::array<std::chrono::microseconds, BucketCount-1> bucketBounds;
+
+public:
+    // Record a latency - returns the total number of latencies recorded
+    std::uint64_t record(std::chrono::microseconds latency);
+    std::array<std::uint64_t, BucketCount> buckets() const;
+    // Total number of latencies recorded (i.e. processes created)
+    std::uint64_t count() const {return _count.load(std::memory_order_relaxed);}
+    void trace(std::ostream &os) const;
+
+private:
+    std::array<std::atomic<std::uint64_t>, BucketCount> _buckets{};
+    std::atomic<std::uint64_t> _count{0};
+};
+
 // Start a child process, with:
 // - optional arguments
 // - optional environment
@@ -143,6 +168,21 @@ namespace kapps { namespace core {
 // rest of startChild() from the first fork (which forks again), then
 // immediately exit the first fork without waiting.)
 //
+// ************
+// * Spawning *
+// ************
+//
+// Child processes are created with posix_spawn(), which avoids copying the
+// parent's address space (glibc and macOS implement it with vfork() semantics
+// or a dedicated syscall).  Only stdout and stderr are passed to the child;
+// other descriptors are closed where the platform supports it, and are
+// otherwise closed by FD_CLOEXEC.
+//
+// If prepareChildProcess is connected, the child has to run code before
+// exec(), so fork() is used instead.  fork() is also used if posix_spawn()
+// fails, so errors (like a nonexistent executable) are reported the same way
+// in either case - the child exits with an error code.
+//
 class KAPPS_CORE_EXPORT Process
 {
 private:
@@ -207,7 +247,22 @@ private:
     // ignore it.
     void wait(ReadyReadFunc stdoutReadyRead, ReadyReadFunc stderrReadyRead);
 
+    // Build the argv/envp arrays for exec() - these refer to _pathName, _args,
+    // and _env
+    std::vector<char*> execArgs();
+    std::vector<char*> execEnv();
     void execChild(PosixFd stdoutWriteEnd, PosixFd stderrWriteEnd);
+    // Create the child process with posix_spawn().  Returns the child PID, or
+    // 0 if posix_spawn() failed (traced).
+    int spawnChild(const PosixFd &stdoutWriteEnd, const PosixFd &stderrWriteEnd);
+    // Create the child process with fork(), running prepareChildProcess in the
+    // child.  Returns the child PID in the parent (never returns in the child),
+    // throws if fork() fails.
+    int forkChild(PosixFd stdoutWriteEnd, PosixFd stderrWriteEnd);
+
+public:
+    // Latency of creating child processes, for all Processes
+    static SpawnLatencyHistogram &spawnLatency();
 
 public:
     int exitCode() const;
@@ -333,6 +388,9 @@ public:
     // caller hooks this up just before start()/run(), it can capture references
     // to the environment.  (In that case, clear it out again after
     // start()/run() returns in the parent process.)
+    //
+    // Connecting this forces Process to use fork() instead of posix_spawn(),
+    // so only connect it when the child really needs to be set up.
     Signal<> prepareChildProcess;
 
 private:
@@ -68,6 +68,9 @@ public:
             _callback(std::forward<CallArgs>(args)...);
     }
 
+    // Whether a callback is connected
+    explicit operator bool() const {return static_cast<bool>(_callback);}
+
 private:
     std::function<void(Args...)> _callback;
 };
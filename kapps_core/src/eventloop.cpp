@@ -17,7 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "eventloop.h"
-#include "timer.h"
+#include "timerwheel.h"
 #include <memory>
 #include <stdexcept>
 
@@ -50,9 +50,24 @@ EventLoop &EventLoop::getThreadEventLoop()
     return *pThreadEventLoop;
 }
 
+EventLoop::EventLoop()
+{
+}
+
+EventLoop::~EventLoop()
+{
+}
+
+TimerWheel &EventLoop::timerWheel()
+{
+    if(!_pTimerWheel)
+        _pTimerWheel.reset(new TimerWheel{*this});
+    return *_pTimerWheel;
+}
+
 void EventLoop::timerElapsed(TokenT token)
 {
-    Timer::timerElapsed(token);
+    timerWheel().eventLoopTimerElapsed(token);
 }
 
 #if defined(KAPPS_CORE_OS_POSIX)
@@ -23,6 +23,8 @@
 
 namespace kapps { namespace core {
 
+class TimerWheel;
+
 // EventLoop provides integrations between the kapps libraries and the thread's
 // event loop.  The kapps libraries do not mandate a particular event loop
 // structure, so these primitives allow us to tie into whatever event loop is
@@ -49,7 +51,10 @@ namespace kapps { namespace core {
 // single-shot timer that's automatically rescheduled.  Picking one style would
 // be a poor fit for opposite-style systems.)
 //
-// kapps::core::Timer is implemented with this API.
+// kapps::core::Timer is implemented with this API.  All Timers on a thread
+// are multiplexed onto one EventLoop timer by the EventLoop's TimerWheel, so
+// the EventLoop usually has at most one single-shot timer set at a time (see
+// timerwheel.h).
 //
 // ***************************
 // * File descriptor watches *
@@ -122,7 +127,15 @@ public:
     static EventLoop &getThreadEventLoop();
 
 public:
-    virtual ~EventLoop() = default;
+    EventLoop();
+    virtual ~EventLoop();
+
+private:
+    // Timer uses the TimerWheel to set and cancel timers
+    friend class Timer;
+
+    // The TimerWheel for this event loop, created when first used
+    TimerWheel &timerWheel();
 
 protected:
     // Invoke timerElapsed() from your event loop when a timer configured with
@@ -201,6 +214,9 @@ public:
     // Cancel a file descriptor watch.
     virtual void cancelFdWatch(TokenT token) = 0;
 #endif
+
+private:
+    std::unique_ptr<TimerWheel> _pTimerWheel;
 };
 
 }}
@@ -0,0 +1,288 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include "util.h"
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace kapps { namespace core {
+
+// FlatHashMap is an open-addressing hash map - entries are stored directly in
+// one array of slots, rather than in separately-allocated nodes like
+// std::unordered_map.  Lookups probe adjacent slots (linear probing), which is
+// much friendlier to the cache for small keys and values.
+//
+// The hash from Hash is finished with hashFinish(), so identity hashes (such
+// as std::hash for integers) still spread across the table.  The table is a
+// power of two in size and is kept at most 3/4 full.  Erasing shifts the
+// following entries back rather than leaving tombstones, so lookups don't
+// degrade after many erasures.
+//
+// The interface is a subset of std::unordered_map's, with these differences:
+// - Inserting or erasing invalidates all iterators and references (entries
+//   move when the table grows or when an entry before them is erased).
+// - The entries are std::pair<Key, Value>, not std::pair<const Key, Value>;
+//   the key must not be modified through an iterator.
+// - Heterogeneous lookup and bucket interfaces are not provided.
+template<class Key, class Value, class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>>
+class FlatHashMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using size_type = std::size_t;
+
+private:
+    using Slot = std::optional<value_type>;
+
+    template<bool IsConst>
+    class IteratorImpl
+    {
+    private:
+        using SlotPtr = std::conditional_t<IsConst, const Slot*, Slot*>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+        using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+
+    public:
+        IteratorImpl() : _pSlot{}, _pEnd{} {}
+        IteratorImpl(SlotPtr pSlot, SlotPtr pEnd) : _pSlot{pSlot}, _pEnd{pEnd} {skipEmpty();}
+        // Non-const -> const conversion
+        template<bool OtherConst, class = std::enable_if_t<IsConst && !OtherConst>>
+        IteratorImpl(const IteratorImpl<OtherConst> &other)
+            : _pSlot{other._pSlot}, _pEnd{other._pEnd} {}
+
+    private:
+        void skipEmpty() {while(_pSlot != _pEnd && !*_pSlot) ++_pSlot;}
+
+    public:
+        reference operator*() const {return **_pSlot;}
+        pointer operator->() const {return &**_pSlot;}
+        IteratorImpl &operator++() {++_pSlot; skipEmpty(); return *this;}
+        IteratorImpl operator++(int) {IteratorImpl old{*this}; ++*this; return old;}
+        bool operator==(const IteratorImpl &other) const {return _pSlot == other._pSlot;}
+        bool operator!=(const IteratorImpl &other) const {return _pSlot != other._pSlot;}
+
+    private:
+        SlotPtr _pSlot, _pEnd;
+        friend class FlatHashMap;
+        friend class IteratorImpl<!IsConst>;
+    };
+
+public:
+    using iterator = IteratorImpl<false>;
+    using const_iterator = IteratorImpl<true>;
+
+public:
+    FlatHashMap() : _size{0} {}
+
+private:
+    std::size_t mask() const {return _slots.size() - 1;}
+    std::size_t homeSlot(const Key &key) const
+    {
+        return hashFinish(Hash{}(key)) & mask();
+    }
+
+    // Find the slot containing this key, or the empty slot where it would be
+    // inserted.  The table must not be empty.
+    std::size_t findSlot(const Key &key) const
+    {
+        std::size_t slot = homeSlot(key);
+        while(_slots[slot] && !KeyEqual{}(_slots[slot]->first, key))
+            slot = (slot + 1) & mask();
+        return slot;
+    }
+
+    // Whether the table needs to grow to hold 'count' entries
+    bool needsGrow(std::size_t count) const
+    {
+        return count * 4 > _slots.size() * 3;
+    }
+
+    void rehash(std::size_t slotCount)
+    {
+        std::vector<Slot> oldSlots{std::move(_slots)};
+        _slots.clear();
+        _slots.resize(slotCount);
+        for(auto &oldSlot : oldSlots)
+        {
+            if(oldSlot)
+                _slots[findSlot(oldSlot->first)].emplace(std::move(*oldSlot));
+        }
+    }
+
+    void growFor(std::size_t count)
+    {
+        if(!needsGrow(count) && !_slots.empty())
+            return;
+        std::size_t slotCount = _slots.empty() ? 8 : _slots.size();
+        while(count * 4 > slotCount * 3)
+            slotCount *= 2;
+        rehash(slotCount);
+    }
+
+    iterator iteratorAt(std::size_t slot)
+    {
+        return {_slots.data() + slot, _slots.data() + _slots.size()};
+    }
+    const_iterator iteratorAt(std::size_t slot) const
+    {
+        return {_slots.data() + slot, _slots.data() + _slots.size()};
+    }
+
+public:
+    bool empty() const {return _size == 0;}
+    std::size_t size() const {return _size;}
+
+    iterator begin() {return iteratorAt(0);}
+    iterator end() {return iteratorAt(_slots.size());}
+    const_iterator begin() const {return iteratorAt(0);}
+    const_iterator end() const {return iteratorAt(_slots.size());}
+    const_iterator cbegin() const {return begin();}
+    const_iterator cend() const {return end();}
+
+    // Make room for at least 'count' entries without growing again
+    void reserve(std::size_t count) {growFor(count);}
+
+    // Remove all entries; keeps the allocated table
+    void clear()
+    {
+        for(auto &slot : _slots)
+            slot.reset();
+        _size = 0;
+    }
+
+    iterator find(const Key &key)
+    {
+        if(_slots.empty())
+            return end();
+        std::size_t slot = findSlot(key);
+        return _slots[slot] ? iteratorAt(slot) : end();
+    }
+    const_iterator find(const Key &key) const
+    {
+        if(_slots.empty())
+            return end();
+        std::size_t slot = findSlot(key);
+        return _slots[slot] ? iteratorAt(slot) : end();
+    }
+    bool contains(const Key &key) const {return find(key) != end();}
+    std::size_t count(const Key &key) const {return contains(key) ? 1 : 0;}
+
+    Value &at(const Key &key)
+    {
+        auto it = find(key);
+        if(it == end())
+            throw std::out_of_range{"key not found in FlatHashMap"};
+        return it->second;
+    }
+    const Value &at(const Key &key) const
+    {
+        auto it = find(key);
+        if(it == end())
+            throw std::out_of_range{"key not found in FlatHashMap"};
+        return it->second;
+    }
+
+    // Insert if the key isn't present.  Like std::unordered_map::emplace(),
+    // the value is not constructed if the key is already present.
+    template<class KeyArg, class... ValueArgs>
+    std::pair<iterator, bool> emplace(KeyArg &&key, ValueArgs &&...valueArgs)
+    {
+        growFor(_size + 1);
+        std::size_t slot = findSlot(key);
+        if(_slots[slot])
+            return {iteratorAt(slot), false};
+        _slots[slot].emplace(std::piecewise_construct,
+                             std::forward_as_tuple(std::forward<KeyArg>(key)),
+                             std::forward_as_tuple(std::forward<ValueArgs>(valueArgs)...));
+        ++_size;
+        return {iteratorAt(slot), true};
+    }
+    std::pair<iterator, bool> insert(value_type entry)
+    {
+        return emplace(std::move(entry.first), std::move(entry.second));
+    }
+
+    Value &operator[](const Key &key) {return emplace(key).first->second;}
+
+    // Erase a key; returns the number of entries erased (0 or 1)
+    std::size_t erase(const Key &key)
+    {
+        if(_slots.empty())
+            return 0;
+        std::size_t slot = findSlot(key);
+        if(!_slots[slot])
+            return 0;
+        eraseSlot(slot);
+        return 1;
+    }
+    // Erase the entry at a valid iterator.  Unlike std::unordered_map, this
+    // doesn't return an iterator to the next entry, since following entries
+    // may be moved back into the erased slot.
+    void erase(const_iterator pos)
+    {
+        assert(pos._pSlot && pos._pSlot != pos._pEnd && *pos._pSlot);
+        eraseSlot(static_cast<std::size_t>(pos._pSlot - _slots.data()));
+    }
+
+private:
+    void eraseSlot(std::size_t hole)
+    {
+        // Shift back any following entries that would no longer be reachable
+        // through the hole - those whose home slot is not between the hole
+        // and their current slot (cyclically)
+        std::size_t slot = hole;
+        while(true)
+        {
+            slot = (slot + 1) & mask();
+            if(!_slots[slot])
+                break;
+            std::size_t home = homeSlot(_slots[slot]->first);
+            bool homeInRange = (hole <= slot) ? (hole < home && home <= slot)
+                                              : (hole < home || home <= slot);
+            if(!homeInRange)
+            {
+                _slots[hole] = std::move(_slots[slot]);
+                hole = slot;
+            }
+        }
+        _slots[hole].reset();
+        --_size;
+    }
+
+private:
+    std::vector<Slot> _slots;
+    std::size_t _size;
+};
+
+}}
@@ -20,6 +20,7 @@
 #include <array>
 #include <string>
 #include <algorithm>
+#include <charconv>
 
 #if defined(KAPPS_CORE_OS_POSIX)
 #include <sys/types.h>
@@ -57,15 +58,95 @@ namespace
 
         return {subnet.substr(0, slashPos), prefix};
     }
+
+    // Longest dotted-decimal IPv4 address ("255.255.255.255")
+    const std::size_t ipv4AddrStrMaxLen{15};
+
+    // Render an IPv4 address (host byte order) in dotted-decimal form - used
+    // for tracing so it doesn't have to go through a std::string.  The buffer
+    // must have room for ipv4AddrStrMaxLen chars; the result is not
+    // null-terminated.  Returns the end of the rendered text.
+    char *renderIpv4(std::uint32_t address, char *pBuf)
+    {
+        for(int shift = 24; shift >= 0; shift -= 8)
+        {
+            pBuf = std::to_chars(pBuf, pBuf + 3, (address >> shift) & 0xFF).ptr;
+            if(shift > 0)
+                *pBuf++ = '.';
+        }
+        return pBuf;
+    }
+
+    bool isDigit(char c) {return c >= '0' && c <= '9';}
+
+    // Parse 'count' dotted-decimal octets (1-4) from text, like inet_pton() -
+    // each octet is 0-255 with no leading zeroes, and there can't be any other
+    // text.  The octets are returned in the low bits of 'address' (host byte
+    // order).  Returns false if the text isn't valid.
+    bool parseIpv4Octets(StringSlice text, int count, std::uint32_t &address)
+    {
+        const char *pPos = text.data();
+        const char *pEnd = pPos + text.size();
+        std::uint32_t result{0};
+        for(int i=0; i<count; ++i)
+        {
+            if(i > 0)
+            {
+                if(pPos == pEnd || *pPos != '.')
+                    return false;
+                ++pPos;
+            }
+            if(pPos == pEnd || !isDigit(*pPos))
+                return false;
+            std::uint32_t octet = static_cast<std::uint32_t>(*pPos++ - '0');
+            // inet_pton() doesn't accept leading zeroes, such as "01"
+            if(octet == 0 && pPos != pEnd && isDigit(*pPos))
+                return false;
+            while(pPos != pEnd && isDigit(*pPos))
+            {
+                octet = octet * 10 + static_cast<std::uint32_t>(*pPos++ - '0');
+                if(octet > 255)
+                    return false;
+            }
+            result = (result << 8) | octet;
+        }
+        if(pPos != pEnd)
+            return false;
+        address = result;
+        return true;
+    }
+
+    // Longest IPv6 address text, including the null terminator (the same as
+    // INET6_ADDRSTRLEN)
+    const std::size_t ipv6AddrStrBufLen{46};
+
+    // Parse an IPv6 address with inet_pton().  The text is copied to a stack
+    // buffer to null-terminate it, rather than allocating a std::string.
+    bool parseIpv6(StringSlice text, in6_addr &networkAddress)
+    {
+        char buf[ipv6AddrStrBufLen];
+        if(text.size() >= sizeof(buf))
+            return false;
+        std::copy(text.begin(), text.end(), buf);
+        buf[text.size()] = 0;
+        return inet_pton(AF_INET6, buf, &networkAddress) == 1;
+    }
+
+    // Render an IPv6 address with inet_ntop().  Returns the null-terminated
+    // text in the buffer, or nullptr if it fails.
+    const char *renderIpv6(const Ipv6Address::AddressValue &address,
+                           char (&buf)[ipv6AddrStrBufLen])
+    {
+        return inet_ntop(AF_INET6, address, buf, sizeof(buf));
+    }
 }
 
-Ipv4Address::Ipv4Address(const std::string &addressString)
+Ipv4Address::Ipv4Address(StringSlice address)
     : Ipv4Address{}
 {
-    in_addr networkAddress{};
-    if (inet_pton(AF_INET, addressString.c_str(), &networkAddress) == 1)
-        // We store in host byte order
-        _address = ntohl(networkAddress.s_addr);
+    // We store in host byte order.  If it's invalid, leave the address
+    // 0.0.0.0
+    parseIpv4Octets(address, 4, _address);
 }
 
 bool Ipv4Address::inSubnet(std::uint32_t netAddress, unsigned prefixLen) const
@@ -95,14 +176,14 @@ unsigned Ipv4Address::getSubnetMaskPrefix() const
 
 std::string Ipv4Address::toString() const
 {
-    static const std::uint32_t inet4AddrStrLen{16};
-    char buf[inet4AddrStrLen]{};
-    // Convert from host to network
-    std::uint32_t networkAddress{htonl(_address)};
-    if(inet_ntop(AF_INET, &networkAddress, buf, sizeof(buf)))
-        return buf;
-    else
-        return {};
+    char buf[ipv4AddrStrMaxLen];
+    return {buf, renderIpv4(_address, buf)};
+}
+
+void Ipv4Address::trace(std::ostream &os) const
+{
+    char buf[ipv4AddrStrMaxLen];
+    os.write(buf, renderIpv4(_address, buf) - buf);
 }
 
 Ipv4Address Ipv4Address::maskIpv4(const Ipv4Address &address, unsigned prefix)
@@ -127,11 +208,11 @@ Ipv6Address::Ipv6Address(const uint8_t *address)
     ::memcpy(_address, address, sizeof(_address));
 }
 
-Ipv6Address::Ipv6Address(const std::string &addressString)
+Ipv6Address::Ipv6Address(StringSlice address)
     : Ipv6Address{}
 {
     in6_addr networkAddress{};
-    if(inet_pton(AF_INET6, addressString.c_str(), &networkAddress) == 1)
+    if(parseIpv6(address, networkAddress))
     {
         std::copy(&networkAddress.s6_addr[0], &networkAddress.s6_addr[16],
                   &_address[0]);
@@ -244,15 +325,20 @@ bool Ipv6Address::inSubnet(const Ipv6Address &ipAddr, std::uint32_t prefixLength
 
 std::string Ipv6Address::toString() const
 {
-    // Maximum size of ipv6 address string
-    static const std::uint32_t inet6AddrStrLen{46};
-    char buf[inet6AddrStrLen]{};
-    if(inet_ntop(AF_INET6, _address, buf, sizeof(buf)))
-        return buf;
+    char buf[ipv6AddrStrBufLen];
+    if(const char *pText = renderIpv6(_address, buf))
+        return pText;
     else
         return {};
 }
 
+void Ipv6Address::trace(std::ostream &os) const
+{
+    char buf[ipv6AddrStrBufLen];
+    if(const char *pText = renderIpv6(_address, buf))
+        os << pText;
+}
+
 Ipv6Address Ipv6Address::maskIpv6(const Ipv6Address &address, unsigned prefix)
 {
     return maskIpv6(address.address(), prefix);
@@ -294,7 +380,7 @@ Ipv4Subnet::Ipv4Subnet(StringSlice subnet)
     auto brokenSubnet = breakSubnet(subnet);
 
     // To handle omitted octets in IPv4, just check how many octets seem to be
-    // present based on dots, and append '.0.0.0', '.0.0', or '.0'.
+    // present based on dots.
     int dots{0};
     for(char c : brokenSubnet.first)
     {
@@ -313,34 +399,17 @@ Ipv4Subnet::Ipv4Subnet(StringSlice subnet)
         --dots;
     }
 
-    // We need a null-terminated string for inet_pton(), and we might need to
-    // append a suffix
-    auto addressPart = brokenSubnet.first.to_string();
-    int defaultPrefix = 0;
-
-    switch(dots)
-    {
-        case 0: // 10
-            addressPart += ".0.0.0";
-            defaultPrefix = 8;
-            break;
-        case 1: // 10.0
-            addressPart += ".0.0";
-            defaultPrefix = 16;
-            break;
-        case 2: // 10.0.0
-            addressPart += ".0";
-            defaultPrefix = 24;
-            break;
-        default:
-        case 3: // 10.0.0.1
-            defaultPrefix = 32;
-            break;
-    }
+    // Omitted octets are 0, and the prefix defaults to the octets specified
+    // (8, 16, 24, or 32)
+    int octets = dots + 1;
+    int defaultPrefix = octets * 8;
 
-    in_addr parsedAddr{};
-    if(inet_pton(AF_INET, addressPart.c_str(), &parsedAddr) != 1)
+    std::uint32_t parsedAddr{0};
+    if(!parseIpv4Octets(brokenSubnet.first, octets, parsedAddr))
         throw std::runtime_error{"invalid IPv4 address in subnet"};
+    // Shift the omitted octets in (shifting by 32 would be undefined)
+    if(octets < 4)
+        parsedAddr <<= 8 * (4 - octets);
 
     if(brokenSubnet.second < 0)
         brokenSubnet.second = defaultPrefix;
@@ -348,7 +417,7 @@ Ipv4Subnet::Ipv4Subnet(StringSlice subnet)
         throw std::runtime_error{"invalid prefix length in IPv4 subnet"};
 
     _prefix = static_cast<unsigned>(brokenSubnet.second);
-    _address = Ipv4Address::maskIpv4(ntohl(parsedAddr.s_addr), _prefix);
+    _address = Ipv4Address::maskIpv4(parsedAddr, _prefix);
 }
 
 bool Ipv4Subnet::operator==(const Ipv4Subnet &other) const
@@ -372,13 +441,11 @@ Ipv6Subnet::Ipv6Subnet(StringSlice subnet)
 
     if(brokenSubnet.second < 0)
         brokenSubnet.second = 128;
-    else if(brokenSubnet.second >= 128)
+    else if(brokenSubnet.second > 128)
         throw std::runtime_error{"invalid prefix length in IPv6 subnet"};
 
     in6_addr networkAddress{};
-    // Need a null-terminated string for inet_pton()
-    auto addressString = brokenSubnet.first.to_string();
-    if(inet_pton(AF_INET6, addressString.c_str(), &networkAddress) != 1)
+    if(!parseIpv6(brokenSubnet.first, networkAddress))
         throw std::runtime_error{"invalid IPv4 address in subnet"};
 
     _prefix = static_cast<unsigned>(brokenSubnet.second);
@@ -45,8 +45,11 @@ public:
                    (std::uint32_t{b2} << 8) | std::uint32_t{b3}}
     {}
     // Parse an IP address from a string.  If it's not a valid IPv4 address,
-    // the resulting Ipv4Address is 0.0.0.0.
-    Ipv4Address(const std::string &address);
+    // the resulting Ipv4Address is 0.0.0.0.  This accepts the same dotted
+    // decimal form as inet_pton() and doesn't allocate.
+    Ipv4Address(StringSlice address);
+    Ipv4Address(const std::string &address) : Ipv4Address{StringSlice{address}} {}
+    Ipv4Address(const char *address) : Ipv4Address{StringSlice{address}} {}
 
 public:
     bool operator==(const Ipv4Address &other) const {return address() == other.address();}
@@ -117,7 +120,7 @@ public:
     // 1 bits - i.e. 255.255.128.0 -> 17)
     unsigned getSubnetMaskPrefix() const;
 
-    void trace(std::ostream &os) const {os << toString();}
+    void trace(std::ostream &os) const;
 
     static Ipv4Address maskIpv4(const Ipv4Address &address, unsigned prefix);
     static Ipv4Address maskIpv4(std::uint32_t address, unsigned prefix);
@@ -137,7 +140,7 @@ void to_json(JsonT &j, const Ipv4Address &v)
 template<class JsonT>
 void from_json(const JsonT &j, Ipv4Address &v)
 {
-    Ipv4Address addr = j.template get_ref<const std::string&>();
+    Ipv4Address addr{j.template get_ref<const std::string&>()};
     // Invalid addresses or 0.0.0.0 are not accepted
     if(addr == Ipv4Address{})
     {
@@ -186,8 +189,10 @@ public:
                    h8(w6), l8(w6), h8(w7), l8(w7)}
     {}
     // Parse an IP address from a string.  If it's not a valid IPv6 address,
-    // the resulting Ipv6Address is ::.
-    Ipv6Address(const std::string &address);
+    // the resulting Ipv6Address is ::.  This doesn't allocate.
+    Ipv6Address(StringSlice address);
+    Ipv6Address(const std::string &address) : Ipv6Address{StringSlice{address}} {}
+    Ipv6Address(const char *address) : Ipv6Address{StringSlice{address}} {}
 
 public:
     bool operator==(const Ipv6Address &other) const;
@@ -215,7 +220,7 @@ public:
     static Ipv6Address maskIpv6(const Ipv6Address::AddressValue &address, unsigned prefix);
     static Ipv6Address maskIpv6(const Ipv6Address &address, unsigned prefix);
 
-    void trace(std::ostream &os) const {os << toString();}
+    void trace(std::ostream &os) const;
 
 private:
     AddressValue _address;
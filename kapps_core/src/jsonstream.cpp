@@ -0,0 +1,170 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "jsonstream.h"
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace kapps::core {
+
+namespace
+{
+    // SAX handler for streamJsonObject().  A small DOM builder is used for
+    // each captured value; the top-level object itself and streamed arrays
+    // are never built.
+    class StreamingHandler
+    {
+    public:
+        using json = nlohmann::json;
+
+    public:
+        StreamingHandler(const std::function<bool(StringSlice)> &isStreamed,
+                         const std::function<void(StringSlice, json &&)> &onValue)
+            : _isStreamed{isStreamed}, _onValue{onValue}
+        {}
+
+    private:
+        // Add a complete value (scalar or empty container) to the capture.
+        // Returns a pointer to the value in the capture.
+        json *addValue(json value)
+        {
+            if(_captureStack.empty())
+            {
+                // Starting a new capture
+                _capture = std::move(value);
+                return &_capture;
+            }
+            json &parent = *_captureStack.back();
+            if(parent.is_array())
+            {
+                parent.push_back(std::move(value));
+                return &parent.back();
+            }
+            json &member = parent[_captureKey];
+            member = std::move(value);
+            return &member;
+        }
+
+        // A value is complete at the current position; deliver it if that
+        // finished a capture
+        void valueDone()
+        {
+            if(_captureStack.empty())
+                _onValue(_topKey, std::move(_capture));
+        }
+
+        bool scalar(json value)
+        {
+            // A scalar at the top level isn't an object
+            if(_depth == 0)
+                throw std::runtime_error{"Expected JSON object at top level"};
+            addValue(std::move(value));
+            valueDone();
+            return true;
+        }
+
+        bool startContainer(json emptyContainer)
+        {
+            ++_depth;
+            if(_depth == 1)
+            {
+                if(!emptyContainer.is_object())
+                    throw std::runtime_error{"Expected JSON object at top level"};
+                return true;    // Top-level object, not captured
+            }
+            // A streamed array at the top level isn't captured either, its
+            // elements are
+            if(_depth == 2 && emptyContainer.is_array() && _isStreamed(_topKey))
+            {
+                _streamingArray = true;
+                return true;
+            }
+            _captureStack.push_back(addValue(std::move(emptyContainer)));
+            return true;
+        }
+
+        bool endContainer()
+        {
+            --_depth;
+            if(_depth == 0)
+                return true;    // End of top-level object
+            if(_depth == 1 && _streamingArray)
+            {
+                _streamingArray = false;
+                return true;
+            }
+            _captureStack.pop_back();
+            valueDone();
+            return true;
+        }
+
+    public:
+        bool null() {return scalar(nullptr);}
+        bool boolean(bool val) {return scalar(val);}
+        bool number_integer(json::number_integer_t val) {return scalar(val);}
+        bool number_unsigned(json::number_unsigned_t val) {return scalar(val);}
+        bool number_float(json::number_float_t val, const json::string_t &) {return scalar(val);}
+        bool string(json::string_t &val) {return scalar(std::move(val));}
+        bool binary(json::binary_t &val) {return scalar(json::binary(std::move(val)));}
+        bool start_object(std::size_t) {return startContainer(json::object());}
+        bool end_object() {return endContainer();}
+        bool start_array(std::size_t) {return startContainer(json::array());}
+        bool end_array() {return endContainer();}
+        bool key(json::string_t &val)
+        {
+            if(_depth == 1)
+                _topKey = std::move(val);
+            else
+                _captureKey = std::move(val);
+            return true;
+        }
+        bool parse_error(std::size_t, const std::string &,
+                         const nlohmann::detail::exception &ex)
+        {
+            throw std::runtime_error{ex.what()};
+        }
+
+    private:
+        const std::function<bool(StringSlice)> &_isStreamed;
+        const std::function<void(StringSlice, json &&)> &_onValue;
+        // Nesting depth of the current position - 1 is inside the top-level
+        // object
+        int _depth{0};
+        // Current top-level property key
+        std::string _topKey;
+        // Whether we're in a streamed top-level array
+        bool _streamingArray{false};
+        // The value currently being captured and the open containers within
+        // it.  The stack is empty between captures.
+        json _capture;
+        std::vector<json*> _captureStack;
+        // Key for the next member of the innermost captured object
+        std::string _captureKey;
+    };
+}
+
+void streamJsonObject(StringSlice json,
+    const std::function<bool(StringSlice key)> &isStreamed,
+    const std::function<void(StringSlice key, nlohmann::json &&value)> &onValue)
+{
+    StreamingHandler handler{isStreamed, onValue};
+    nlohmann::json::sax_parse(json.begin(), json.end(), &handler);
+}
+
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include "stringslice.h"
+#include <nlohmann/json_fwd.hpp>
+#include <functional>
+
+namespace kapps::core {
+
+// Stream a large JSON object document without building a DOM for the whole
+// thing.  This is a single pass over the raw bytes using nlohmann::json's SAX
+// interface.
+//
+// Each top-level property is delivered to onValue() as a DOM of its own.  For
+// top-level properties where isStreamed(key) returns true and the value is an
+// array, onValue() is instead called once for each array element, so only one
+// element is held in memory at a time.
+//
+// Throws if the JSON is malformed or the top-level value isn't an object.
+// Exceptions thrown by the callbacks propagate out of streamJsonObject().
+KAPPS_CORE_EXPORT void streamJsonObject(StringSlice json,
+    const std::function<bool(StringSlice key)> &isStreamed,
+    const std::function<void(StringSlice key, nlohmann::json &&value)> &onValue);
+
+}
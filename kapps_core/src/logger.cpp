@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "logger.h"
+#include <atomic>
 #include <cstring>
 #include <mutex>
 #include <unordered_map>
@@ -89,16 +90,117 @@ namespace
 
 namespace log
 {
+    namespace
+    {
+        // Size of the per-thread buffer used by LogBuffer.  Nearly all log
+        // messages fit in this.
+        const std::size_t logBufferSize{2048};
+        thread_local char t_logBuffer[logBufferSize];
+        thread_local bool t_logBufferInUse{false};
+    }
+
+    LogBuffer::LogBuffer()
+        : _pFixed{}
+    {
+        if(!t_logBufferInUse)
+        {
+            t_logBufferInUse = true;
+            _pFixed = t_logBuffer;
+            setp(_pFixed, _pFixed + logBufferSize);
+        }
+        // Otherwise, render to the heap - the put area is empty, so everything
+        // goes through overflow()/xsputn().
+    }
+
+    LogBuffer::~LogBuffer()
+    {
+        if(_pFixed)
+            t_logBufferInUse = false;
+    }
+
+    void LogBuffer::spill()
+    {
+        if(pbase())
+        {
+            _spilled.reserve(logBufferSize * 2);
+            _spilled.assign(pbase(), pptr());
+            setp(nullptr, nullptr);
+        }
+    }
+
+    auto LogBuffer::overflow(int_type ch) -> int_type
+    {
+        if(traits_type::eq_int_type(ch, traits_type::eof()))
+            return traits_type::not_eof(ch);
+        spill();
+        _spilled.push_back(traits_type::to_char_type(ch));
+        return ch;
+    }
+
+    std::streamsize LogBuffer::xsputn(const char *s, std::streamsize n)
+    {
+        if(n <= epptr() - pptr())
+        {
+            std::memcpy(pptr(), s, static_cast<std::size_t>(n));
+            pbump(static_cast<int>(n));
+        }
+        else
+        {
+            spill();
+            _spilled.append(s, static_cast<std::size_t>(n));
+        }
+        return n;
+    }
+
+    std::string LogBuffer::take()
+    {
+        // If the message never spilled, this is the only allocation for the
+        // message (and none if it's short enough for the small string
+        // optimization).
+        if(pbase())
+            return {pbase(), pptr()};
+        return std::move(_spilled);
+    }
+
     struct LogData
     {
         // Mutex protection all parts of LogData
         std::mutex _dataMutex;
         // Current log callback
         std::shared_ptr<LogCallback> _pCallback;
-        // Whether logging is enabled
-        bool _enabled;
+        // Whether logging is enabled.  This is checked for every log message
+        // (even when disabled), so it's atomic and read without _dataMutex.
+        std::atomic<bool> _enabled;
+
+        // Category levels are protected by _filterMutex instead of
+        // _dataMutex, since they're checked when beginning a message, not
+        // while holding _dataMutex to write one.
+        std::mutex _filterMutex;
+        // Most verbose level logged for each category, keyed by
+        // "module.category" - or by just "module" for module-wide levels
+        std::unordered_map<std::string, LogMessage::Level> _categoryLevels;
+        // Whether _categoryLevels has any entries; checked without
+        // _filterMutex so unfiltered logging never locks
+        std::atomic<bool> _haveCategoryLevels;
     };
 
+    std::string categoryLevelKey(const StringSlice &module,
+                                 const StringSlice &category)
+    {
+        std::string key{module.data(), module.size()};
+        if(!category.empty())
+        {
+            key.push_back('.');
+            key.append(category.data(), category.size());
+        }
+        return key;
+    }
+
+    // A disabled log message must cost no more than this check - ensure it's
+    // a plain load and branch, not a hidden lock.
+    static_assert(std::atomic<bool>::is_always_lock_free,
+                  "logging enabled flag must be lock-free");
+
     LogData &logData()
     {
         static LogData _data{};
@@ -114,19 +216,56 @@ namespace log
     }
 
     void enableLogging(bool enable)
+    {
+        logData()._enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    bool loggingEnabled()
+    {
+        return logData()._enabled.load(std::memory_order_relaxed);
+    }
+
+    void setCategoryLevel(const StringSlice &module, const StringSlice &category,
+                          LogMessage::Level maxLevel)
     {
         auto &data = logData();
-        mutex_lock l{data._dataMutex};
+        mutex_lock l{data._filterMutex};
+        data._categoryLevels[categoryLevelKey(module, category)] = maxLevel;
+        data._haveCategoryLevels.store(true, std::memory_order_relaxed);
+    }
 
-        data._enabled = enable;
+    void clearCategoryLevel(const StringSlice &module, const StringSlice &category)
+    {
+        auto &data = logData();
+        mutex_lock l{data._filterMutex};
+        data._categoryLevels.erase(categoryLevelKey(module, category));
+        data._haveCategoryLevels.store(!data._categoryLevels.empty(),
+                                       std::memory_order_relaxed);
     }
 
-    bool loggingEnabled()
+    void clearCategoryLevels()
     {
         auto &data = logData();
-        mutex_lock l{data._dataMutex};
+        mutex_lock l{data._filterMutex};
+        data._categoryLevels.clear();
+        data._haveCategoryLevels.store(false, std::memory_order_relaxed);
+    }
+
+    bool categoryLevelEnabled(const LogCategory &category, LogMessage::Level level)
+    {
+        auto &data = logData();
+        if(!data._haveCategoryLevels.load(std::memory_order_relaxed))
+            return true;
 
-        return data._enabled;
+        StringSlice module = category.module() ? category.module()->name() : StringSlice{};
+        mutex_lock l{data._filterMutex};
+        // A level for the category takes precedence over the module's level
+        auto itLevel = data._categoryLevels.find(categoryLevelKey(module, category.name()));
+        if(itLevel == data._categoryLevels.end())
+            itLevel = data._categoryLevels.find(categoryLevelKey(module, {}));
+        if(itLevel == data._categoryLevels.end())
+            return true;
+        return level <= itLevel->second;
     }
 
     void write(LogMessage msg)
@@ -343,10 +482,11 @@ LogWriter::LogWriter(SourceLocation loc, LogMessage::Level level,
       _category{pManualCategory ? *pManualCategory : loc.category()},
       _spacesEnabled{true}, _spaceBeforeNext{false}
 {
-    // Skip the message entirely if logging is not enabled
-    if(log::loggingEnabled())
+    // Skip the message entirely if logging is not enabled, or if this
+    // category's level excludes it
+    if(log::loggingEnabled() && log::categoryLevelEnabled(_category, _level))
     {
-        _pMsg.emplace(std::ios_base::out);
+        _pMsg.emplace();
     }
 }
 
@@ -354,10 +494,7 @@ LogWriter::~LogWriter()
 {
     if(_pMsg)
     {
-        // This copies the message unnecessarily - in C++14 there is no way to
-        // move out the string content.  C++20 adds an rvalue str() overload, or
-        // in C++14 we could write our own streambuf implementation.
-        log::write({_loc, _level, _category, _pMsg->str()});
+        log::write({_loc, _level, _category, _pMsg->take()});
     }
 }
 
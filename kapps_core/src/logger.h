@@ -26,8 +26,9 @@
 #include <set>
 #include <string>
 #include <memory>
-#include <sstream>
 #include <ostream>
+#include <streambuf>
+#include <charconv>
 #include <cassert>
 #include <deque>
 #include <vector>
@@ -202,9 +203,9 @@ private:
 // should almost always be string literals - the string must outlive the
 // LogCategory.
 //
-// Currently this is just emitted in logs - there is no way to filter individual
-// categories, etc.  However, for consistency with Qt categories and for
-// possible future expansion, category names should generally be "dotted label"
+// Categories are emitted in logs, and the level logged can be limited for
+// individual categories with log::setCategoryLevel().  For consistency with Qt
+// categories, category names should generally be "dotted label"
 // identifiers following these rules:
 //
 // - Use alphanumerics and basic punctuation like dash(-) / underscore (_),
@@ -355,21 +356,94 @@ namespace log
     void KAPPS_CORE_EXPORT enableLogging(bool enable);
     bool KAPPS_CORE_EXPORT loggingEnabled();
 
+    // Set the most verbose level logged for a category - messages in that
+    // category that are more verbose are skipped before they are rendered,
+    // like disabled logging.  If category is empty, this applies to all
+    // categories in the module that don't have their own level.
+    void KAPPS_CORE_EXPORT setCategoryLevel(const StringSlice &module,
+                                            const StringSlice &category,
+                                            LogMessage::Level maxLevel);
+    // Remove the level for a category (or a module if category is empty)
+    void KAPPS_CORE_EXPORT clearCategoryLevel(const StringSlice &module,
+                                              const StringSlice &category);
+    // Remove all category levels
+    void KAPPS_CORE_EXPORT clearCategoryLevels();
+    // Check whether a message at this level in this category would be
+    // logged, considering the category levels only (not loggingEnabled()).
+    // This is just an atomic load when no category levels are set.
+    bool KAPPS_CORE_EXPORT categoryLevelEnabled(const LogCategory &category,
+                                                LogMessage::Level level);
+
+    // Stream buffer used to render log messages.  Messages are rendered into a
+    // fixed per-thread buffer, so typical messages don't allocate until the
+    // final message string is taken.  If a message outgrows the buffer, it
+    // spills to a heap-allocated string.
+    //
+    // If a message is rendered while another message is being rendered on the
+    // same thread (an operator<<() that logs, etc.), the nested message can't
+    // use the per-thread buffer and just renders to the heap.
+    class KAPPS_CORE_EXPORT LogBuffer : public std::streambuf
+    {
+    public:
+        LogBuffer();
+        ~LogBuffer();
+
+    private:
+        LogBuffer(const LogBuffer &) = delete;
+        LogBuffer &operator=(const LogBuffer &) = delete;
+
+        // Move anything in the fixed buffer to the heap string, and render
+        // everything after this to the heap string.
+        void spill();
+
+    protected:
+        virtual int_type overflow(int_type ch) override;
+        virtual std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+    public:
+        // Take the rendered message.  The LogBuffer can't be used after this.
+        std::string take();
+
+    private:
+        // The per-thread buffer, if this LogBuffer is using it
+        char *_pFixed;
+        // Heap storage, used once the message has spilled
+        std::string _spilled;
+    };
 
-    // A stringstream used to construct log messages.  This just allows
-    // specializations of operator<<() to be defined in the kapps::core::log
-    // namespace, which is used for STL types since we couldn't otherwise define
-    // them in the argument's namespace.
+    // A stream used to construct log messages.  This allows specializations of
+    // operator<<() to be defined in the kapps::core::log namespace, which is
+    // used for STL types since we couldn't otherwise define them in the
+    // argument's namespace.
     //
     // (It's not legal to define std::operator<<(std::ostream &, const std::vector<...> &),
     // as specializations in namespace std are only allowed when they depend on a
     // user type.)
-    class LogStream : public std::stringstream
+    //
+    // It's also used to render integers directly with std::to_chars(), which
+    // is much cheaper than going through the locale facets of std::ostream.
+    class LogStream : public std::ostream
     {
     public:
-        using std::stringstream::stringstream;
+        LogStream() : std::ostream{nullptr} {rdbuf(&_buffer);}
+
+    public:
+        std::string take() {return _buffer.take();}
+
+    private:
+        LogBuffer _buffer;
     };
 
+    // Integers (other than bool and character types) are rendered with
+    // std::to_chars().
+    template<class T>
+    struct IsLogInteger : public std::integral_constant<bool,
+        std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+        !std::is_same<T, char>::value && !std::is_same<T, signed char>::value &&
+        !std::is_same<T, unsigned char>::value && !std::is_same<T, wchar_t>::value &&
+        !std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value>
+    {};
+
     // A streamer is provided for std::vector (other STL containers can be
     // added as needed).  streamContainer() can also be used to implement
     // operator<<() for other container types.
@@ -436,6 +510,17 @@ namespace log
         return os;
     }
 
+    template<class T>
+    auto operator<<(LogStream &os, T value)
+        -> std::enable_if_t<IsLogInteger<T>::value, LogStream &>
+    {
+        // Enough for any 64-bit integer with sign
+        char buf[24];
+        auto result = std::to_chars(buf, buf + sizeof(buf), value);
+        os.write(buf, result.ptr - buf);
+        return os;
+    }
+
     // For any other type that doesn't have a streamer in the kapps::core::log
     // namespace, forward to the regular std::ostream streamer.
     //
@@ -447,7 +532,7 @@ namespace log
     // specialized streamer rather than a conversion to one of the above types.
     template<class ValueT>
     auto operator<<(LogStream &os, const ValueT &v)
-        -> std::enable_if_t<!std::is_enum<ValueT>::value, LogStream&>
+        -> std::enable_if_t<!std::is_enum<ValueT>::value && !IsLogInteger<ValueT>::value, LogStream&>
     {
         std::ostream &stdOs{os};
         stdOs << v;
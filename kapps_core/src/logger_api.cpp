@@ -18,9 +18,59 @@
 
 #include <kapps_core/logger.h>
 #include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace kapps { namespace core {
 
+namespace
+{
+    KACStringSlice adaptSlice(const StringSlice &val)
+    {
+        return {val.data(), val.size()};
+    }
+
+    int adaptLevel(LogMessage::Level l)
+    {
+        switch(l)
+        {
+            default:
+            case LogMessage::Level::Fatal: return KAPPS_CORE_LOG_MESSAGE_LEVEL_FATAL;
+            case LogMessage::Level::Error: return KAPPS_CORE_LOG_MESSAGE_LEVEL_ERROR;
+            case LogMessage::Level::Warning: return KAPPS_CORE_LOG_MESSAGE_LEVEL_WARNING;
+            case LogMessage::Level::Info: return KAPPS_CORE_LOG_MESSAGE_LEVEL_INFO;
+            case LogMessage::Level::Debug: return KAPPS_CORE_LOG_MESSAGE_LEVEL_DEBUG;
+        }
+    }
+
+    // The KACLogMessage refers to msg's data; it's valid as long as msg is
+    KACLogMessage adaptMessage(const LogMessage &msg)
+    {
+        return
+        {
+            adaptSlice(msg.category().module() ? msg.category().module()->name() : StringSlice{}),
+            adaptSlice(msg.category().name()),
+            adaptLevel(msg.level()),
+            adaptSlice(msg.loc().file()),
+            msg.loc().line(),
+            msg.message().c_str()
+        };
+    }
+
+    // Defaults for KACLogBatchCallback
+    const std::size_t defaultMaxBatch{256};
+    const std::chrono::milliseconds defaultMaxDelay{100};
+    // If the batch callback falls this many batches behind, further messages
+    // are dropped (and counted) until it catches up, rather than letting the
+    // queue grow without bound
+    const std::size_t maxQueuedBatches{64};
+}
+
 // Implementation of kapps::core::LogCallback using KACLogCallback
 // Like PIA's LoggerCallback, final here silences a warning from clang that
 // we're calling a destructor of a polymorphic type without a virtual
@@ -39,35 +89,139 @@ private:
 
 void ApiCallback::write(LogMessage msg)
 {
-    auto adaptSlice = [](const StringSlice &val) -> KACStringSlice
+    KACLogMessage apiMsg{adaptMessage(msg)};
+    (*_cb.pWriteFn)(_cb.pContext, &apiMsg);
+}
+
+// Implementation of kapps::core::LogCallback using KACLogBatchCallback.
+// write() just queues the message; a delivery thread passes queued messages
+// to the batch callback.  The destructor delivers any remaining messages and
+// stops the thread, so the batch callback is never called after this is
+// replaced.
+class BatchApiCallback final : public LogCallback
+{
+public:
+    BatchApiCallback(KACLogBatchCallback cb);
+    ~BatchApiCallback();
+
+private:
+    BatchApiCallback(const BatchApiCallback &) = delete;
+    BatchApiCallback &operator=(const BatchApiCallback &) = delete;
+
+    void deliverThreadProc();
+    void deliver(const std::vector<LogMessage> &messages);
+
+public:
+    virtual void write(LogMessage msg) override;
+
+private:
+    KACLogBatchCallback _cb;
+    std::size_t _maxBatch;
+    std::chrono::milliseconds _maxDelay;
+    // _queueMutex protects _queue, _dropped, _flush, and _stop
+    std::mutex _queueMutex;
+    std::condition_variable _queueChanged;
+    std::vector<LogMessage> _queue;
+    // Messages dropped since the last delivery due to a full queue
+    std::size_t _dropped;
+    // Deliver the queue without waiting for a full batch (set by fatal
+    // messages, which probably precede a crash)
+    bool _flush;
+    bool _stop;
+    std::thread _deliverThread;
+};
+
+BatchApiCallback::BatchApiCallback(KACLogBatchCallback cb)
+    : _cb{cb}, _maxBatch{cb.maxBatch ? cb.maxBatch : defaultMaxBatch},
+      _maxDelay{cb.maxDelayMs ? std::chrono::milliseconds{cb.maxDelayMs} : defaultMaxDelay},
+      _dropped{0}, _flush{false}, _stop{false}
+{
+    _deliverThread = std::thread{[this]{deliverThreadProc();}};
+}
+
+BatchApiCallback::~BatchApiCallback()
+{
     {
-        return {val.data(), val.size()};
-    };
+        std::lock_guard<std::mutex> l{_queueMutex};
+        _stop = true;
+    }
+    _queueChanged.notify_one();
+    _deliverThread.join();
+}
 
-    auto adaptLevel = [](LogMessage::Level l) -> int
+void BatchApiCallback::write(LogMessage msg)
+{
+    bool notify{false};
     {
-        switch(l)
+        std::lock_guard<std::mutex> l{_queueMutex};
+        if(_queue.size() >= _maxBatch * maxQueuedBatches)
         {
-            default:
-            case LogMessage::Level::Fatal: return KAPPS_CORE_LOG_MESSAGE_LEVEL_FATAL;
-            case LogMessage::Level::Error: return KAPPS_CORE_LOG_MESSAGE_LEVEL_ERROR;
-            case LogMessage::Level::Warning: return KAPPS_CORE_LOG_MESSAGE_LEVEL_WARNING;
-            case LogMessage::Level::Info: return KAPPS_CORE_LOG_MESSAGE_LEVEL_INFO;
-            case LogMessage::Level::Debug: return KAPPS_CORE_LOG_MESSAGE_LEVEL_DEBUG;
+            ++_dropped;
+            return;
         }
-    };
+        if(msg.level() == LogMessage::Level::Fatal)
+            _flush = true;
+        _queue.push_back(std::move(msg));
+        // Wake the delivery thread for the first message (to start the delay)
+        // and when a batch is full or must be flushed
+        notify = _flush || _queue.size() == 1 || _queue.size() == _maxBatch;
+    }
+    if(notify)
+        _queueChanged.notify_one();
+}
 
-    KACLogMessage apiMsg
+void BatchApiCallback::deliverThreadProc()
+{
+    std::vector<LogMessage> messages;
+    std::unique_lock<std::mutex> lock{_queueMutex};
+    while(true)
     {
-        adaptSlice(msg.category().module() ? msg.category().module()->name() : StringSlice{}),
-        adaptSlice(msg.category().name()),
-        adaptLevel(msg.level()),
-        adaptSlice(msg.loc().file()),
-        msg.loc().line(),
-        msg.message().c_str()
-    };
+        _queueChanged.wait(lock, [this]{return _stop || !_queue.empty();});
+        // Give more messages a chance to arrive to fill a batch
+        _queueChanged.wait_for(lock, _maxDelay, [this]
+        {
+            return _stop || _flush || _queue.size() >= _maxBatch;
+        });
 
-    (*_cb.pWriteFn)(_cb.pContext, &apiMsg);
+        messages.swap(_queue);
+        std::size_t dropped = _dropped;
+        _dropped = 0;
+        _flush = false;
+        bool stop = _stop;
+
+        lock.unlock();
+        if(dropped)
+        {
+            SourceLocation loc{KAPPS_CORE_LOG_FILE, __LINE__};
+            messages.push_back({loc, LogMessage::Level::Warning, loc.category(),
+                                "Dropped " + std::to_string(dropped) +
+                                    " log messages; the log callback is not keeping up"});
+        }
+        deliver(messages);
+        messages.clear();
+        lock.lock();
+
+        // Deliver anything remaining before stopping
+        if(stop && _queue.empty())
+            break;
+    }
+}
+
+void BatchApiCallback::deliver(const std::vector<LogMessage> &messages)
+{
+    std::vector<KACLogMessage> apiMsgs;
+    apiMsgs.reserve(std::min(messages.size(), _maxBatch));
+    auto itMsg = messages.begin();
+    while(itMsg != messages.end())
+    {
+        apiMsgs.clear();
+        while(itMsg != messages.end() && apiMsgs.size() < _maxBatch)
+        {
+            apiMsgs.push_back(adaptMessage(*itMsg));
+            ++itMsg;
+        }
+        (*_cb.pWriteBatchFn)(_cb.pContext, apiMsgs.data(), apiMsgs.size());
+    }
 }
 
 }}
@@ -86,6 +240,17 @@ void KACLogInit(KACLogCallback *pCallback)
     kapps::core::log::init(std::make_shared<kapps::core::ApiCallback>(*pCallback));
 }
 
+void KACLogInitBatched(KACLogBatchCallback *pCallback)
+{
+    if(!pCallback || !pCallback->pWriteBatchFn)
+    {
+        kapps::core::log::init({});
+        return;
+    }
+
+    kapps::core::log::init(std::make_shared<kapps::core::BatchApiCallback>(*pCallback));
+}
+
 void KACEnableLogging(int enable)
 {
     kapps::core::log::enableLogging(enable);
@@ -96,4 +261,31 @@ int KACLoggingEnabled()
     return kapps::core::log::loggingEnabled();
 }
 
+void KACLogSetCategoryLevel(KACStringSlice module, KACStringSlice category,
+                            int maxLevel)
+{
+    using Level = kapps::core::LogMessage::Level;
+    Level level;
+    switch(maxLevel)
+    {
+        case KAPPS_CORE_LOG_MESSAGE_LEVEL_FATAL: level = Level::Fatal; break;
+        case KAPPS_CORE_LOG_MESSAGE_LEVEL_ERROR: level = Level::Error; break;
+        case KAPPS_CORE_LOG_MESSAGE_LEVEL_WARNING: level = Level::Warning; break;
+        case KAPPS_CORE_LOG_MESSAGE_LEVEL_INFO: level = Level::Info; break;
+        case KAPPS_CORE_LOG_MESSAGE_LEVEL_DEBUG: level = Level::Debug; break;
+        default:
+            // Not a valid level; remove the level instead
+            kapps::core::log::clearCategoryLevel(kapps::core::fromApi(module),
+                                                 kapps::core::fromApi(category));
+            return;
+    }
+    kapps::core::log::setCategoryLevel(kapps::core::fromApi(module),
+                                       kapps::core::fromApi(category), level);
+}
+
+void KACLogClearCategoryLevels()
+{
+    kapps::core::log::clearCategoryLevels();
+}
+
 }
@@ -43,6 +43,58 @@ namespace
         // (program is "bash" and args[0] is "-c", don't need to see those)
         os << "$ " << args[1];
     };
+
+    // Tracer for shell commands that were split and executed directly
+    const auto traceSplitShellCmd = [](std::ostream &os, const std::string &program, const StringVector &args) {
+        os << "$ " << program;
+        for(const auto &arg : args)
+            os << ' ' << arg;
+    };
+
+    // Split a shell command into a program and arguments if it's just words
+    // separated by whitespace, so it can be executed directly instead of
+    // starting bash.  Returns false if the command uses any shell syntax
+    // (quoting, expansions, redirections, control operators, etc.) or starts
+    // with a shell builtin/keyword - those have to be executed by bash.
+    bool splitSimpleCommand(const std::string &command, std::string &program,
+                            StringVector &args)
+    {
+        static const StringSlice shellChars{"|&;<>()$`\\\"'*?[]{}#~!\n"};
+        static const std::array<StringSlice, 28> shellWords
+        {
+            "alias", "break", "builtin", "case", "cd", "command", "continue",
+            "declare", "echo", "eval", "exec", "exit", "export", "false",
+            "for", "function", "if", "kill", "let", "local", "printf", "read",
+            "set", "shift", "source", "test", "true", "while"
+        };
+
+        if(command.find_first_of(shellChars.data(), 0, shellChars.size()) != std::string::npos)
+            return false;
+
+        StringVector words;
+        std::string::size_type pos{0};
+        while(true)
+        {
+            pos = command.find_first_not_of(" \t", pos);
+            if(pos == std::string::npos)
+                break;
+            auto end = command.find_first_of(" \t", pos);
+            words.push_back(command.substr(pos, end - pos));
+            pos = end;
+        }
+
+        // A variable assignment or builtin has to be run by bash
+        if(words.empty() || words[0].find('=') != std::string::npos ||
+            std::find(shellWords.begin(), shellWords.end(), words[0]) != shellWords.end())
+        {
+            return false;
+        }
+
+        program = std::move(words[0]);
+        args.assign(std::make_move_iterator(words.begin()+1),
+                    std::make_move_iterator(words.end()));
+        return true;
+    }
 #endif
 
     // Delete all occurrences of a value from a string (in place)
@@ -190,18 +242,29 @@ int Executor::cmdImpl(const std::string &program, const StringVector &args,
 }
 
 #if defined(KAPPS_CORE_OS_POSIX)
+int Executor::shellImpl(const std::string &command, std::string *pOut,
+                        bool ignoreErrors)
+{
+    // Most commands are just a program and arguments - run those directly
+    // rather than starting bash too
+    std::string program;
+    StringVector args;
+    if(splitSimpleCommand(command, program, args))
+        return cmdImpl(program, args, traceSplitShellCmd, {}, pOut, ignoreErrors);
+
+    return cmdImpl("/bin/bash", {"-c", command}, traceShellCmd, {}, pOut,
+                   ignoreErrors);
+}
+
 int Executor::bash(const std::string &command, bool ignoreErrors)
 {
-    return cmdImpl("/bin/bash", {"-c", command},
-                   traceShellCmd, {}, nullptr, ignoreErrors);
+    return shellImpl(command, nullptr, ignoreErrors);
 }
 
 std::string Executor::bashWithOutput(const std::string &command, bool ignoreErrors)
 {
     std::string output;
-    cmdImpl("/bin/bash", {"-c", command},
-            traceShellCmd, {}, &output, ignoreErrors);
-
+    shellImpl(command, &output, ignoreErrors);
     return output;
 }
 #endif
@@ -72,10 +72,18 @@ private:
                 void(*traceFunc)(std::ostream &, const std::string&, const StringVector&),
                 const StringVector &env, std::string *pOut,
                 bool ignoreErrors);
+#if defined(KAPPS_CORE_OS_POSIX)
+    // Implementation of bash()/bashWithOutput() - executes the command
+    // directly if it has no shell syntax, otherwise with bash -c.
+    int shellImpl(const std::string &command, std::string *pOut,
+                  bool ignoreErrors);
+#endif
 
 public:
 #if defined(KAPPS_CORE_OS_POSIX)
-    // Execute a shell command with /bin/bash -c "cmd"
+    // Execute a shell command with /bin/bash -c "cmd".  Simple commands (just
+    // a program and literal arguments, with no shell syntax) are executed
+    // directly without starting bash.
     int bash(const std::string &command, bool ignoreErrors = false);
 
     // Execute a shell command with /bin/bash -c "cmd" and return the stdout
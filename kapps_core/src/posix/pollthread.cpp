@@ -18,10 +18,19 @@
 
 #include "pollthread.h"
 #include "../logger.h"
+#include "../wakeups.h"
 #include "../workfunc.h"
 #include "posixfdnotifier.h"
 #include <cassert>
 #include <unistd.h>
+#include <algorithm>
+#include <array>
+
+#if defined(KAPPS_CORE_OS_LINUX)
+#include <sys/epoll.h>
+#elif defined(KAPPS_CORE_OS_MACOS)
+#include <sys/event.h>
+#endif
 
 namespace kapps { namespace core {
 
@@ -74,8 +83,9 @@ public:
     // special with it here.  The thread then hands in work items that come from
     // the queue though when the pipe is signaled.
     PollThreadWorker(std::function<void(Any)> userWorkHandler, int fd,
-                     std::function<void()> handler)
-        : _running{true}, _userWorkHandler{std::move(userWorkHandler)}
+                     std::function<void()> handler, const char *pWakeupTag)
+        : _running{true}, _pWakeupTag{pWakeupTag},
+          _userWorkHandler{std::move(userWorkHandler)}
     {
         // Set up the EventLoop integration for this thread
         EventLoop::setThreadEventLoop(std::unique_ptr<EventLoop>{new PollThreadEventLoop(*this)});
@@ -93,10 +103,45 @@ public:
 
 private:
     bool _running;
+    const char *_pWakeupTag;
     PosixFdNotifier _workNotifier;
     std::function<void(Any)> _userWorkHandler;
 };
 
+namespace
+{
+    // Maximum events received from one epoll/kqueue wait; more are picked up
+    // by the next wait
+    const std::size_t maxKernelEvents{32};
+
+#if defined(KAPPS_CORE_OS_LINUX)
+    // The poll(2) and epoll(7) event flags are the same on Linux, so events
+    // are passed through as-is.
+    static_assert(POLLIN == EPOLLIN && POLLOUT == EPOLLOUT &&
+                  POLLERR == EPOLLERR && POLLHUP == EPOLLHUP,
+                  "poll(2) and epoll(7) events must match");
+#endif
+}
+
+PollWorker::PollWorker()
+    : _batch{0}
+{
+#if defined(KAPPS_CORE_OS_LINUX)
+    _kernelQueue = PosixFd{::epoll_create1(EPOLL_CLOEXEC)};
+#elif defined(KAPPS_CORE_OS_MACOS)
+    _kernelQueue = PosixFd{::kqueue()};
+    if(_kernelQueue)
+        _kernelQueue.applyClOExec();
+#endif
+#if defined(KAPPS_CORE_OS_LINUX) || defined(KAPPS_CORE_OS_MACOS)
+    if(!_kernelQueue)
+    {
+        KAPPS_CORE_WARNING() << "Can't create kernel event queue, using poll() instead:"
+            << ErrnoTracer{};
+    }
+#endif
+}
+
 int PollWorker::addFd(int fd, int events)
 {
     pollfd newFd{};
@@ -104,25 +149,37 @@ int PollWorker::addFd(int fd, int events)
     newFd.events = events;
     // revents is always zero.  This is important to ensure that fds added
     // during pollFds() by a handler are never activated immediately,
-    // regardless of where they are actually placed in _fds.
+    // regardless of where they are actually placed in _fds.  (With the kernel
+    // queue, _addedBatches serves the same purpose.)
 
     // Look for a vacant entry in _fds to reuse.  This prevents _fds and
     // _handlers from growing without bound if a consumer cycles fds
     // periodically, while still simplifying pollFds() even if handlers remove
     // arbitrary fds.
-    for(std::size_t i=0; i<_fds.size(); ++i)
+    std::size_t token{0};
+    while(token < _fds.size() && _fds[token].fd != PosixFd::Invalid)
+        ++token;
+
+    if(token < _fds.size())
     {
-        if(_fds[i].fd == PosixFd::Invalid)
-        {
-            _fds[i] = std::move(newFd);
-            // The tokens used by PollWorker are actually indices into _fds
-            return static_cast<int>(i);
-        }
+        _fds[token] = std::move(newFd);
+        _addedBatches[token] = _batch;
+    }
+    else
+    {
+        // Otherwise, there are no vacant entries, add to the end.
+        _fds.push_back(newFd);
+        _addedBatches.push_back(_batch);
+    }
+
+    if(_kernelQueue)
+    {
+        _registrations[fd].tokens.push_back(static_cast<int>(token));
+        updateRegistration(fd);
     }
 
-    // Otherwise, there are no vacant entries, add to the end.
-    _fds.push_back(newFd);
-    return static_cast<int>(_fds.size()-1);
+    // The tokens used by PollWorker are actually indices into _fds
+    return static_cast<int>(token);
 }
 
 void PollWorker::removeFd(int token)
@@ -142,13 +199,118 @@ void PollWorker::removeFd(int token)
         return;
     }
 
+    if(_kernelQueue)
+    {
+        auto itRegistration = _registrations.find(fd.fd);
+        assert(itRegistration != _registrations.end()); // Class invariant
+        auto &tokens = itRegistration->second.tokens;
+        tokens.erase(std::remove(tokens.begin(), tokens.end(), token), tokens.end());
+    }
+
     // Don't actually remove the entry from _fds.  We'll reuse the vacant entry
     // if another fd is added.  We use these indices as tokens, and we can't
     // invalidate them by erasing from the middle.  We could probably erase at
     // the end, but since this can occur during pollFds(), it is simpler if we
     // leave the vacant entries.
+    int removedFd = fd.fd;
     fd.fd = PosixFd::Invalid;
     fd.events = 0;
+
+    if(_kernelQueue)
+        updateRegistration(removedFd);
+}
+
+void PollWorker::updateRegistration(int fd)
+{
+    auto itRegistration = _registrations.find(fd);
+    if(itRegistration == _registrations.end())
+        return;
+    auto &registration = itRegistration->second;
+
+    // Register the combined events of all watches on this fd.  Errors and
+    // hangups are always reported, like poll(2).
+    int events{0};
+    for(int token : registration.tokens)
+        events |= _fds[static_cast<std::size_t>(token)].events;
+    events &= POLLIN|POLLOUT;
+    int oldEvents = registration.events;
+    bool removed = registration.tokens.empty();
+
+    if(removed)
+        _registrations.erase(itRegistration);
+    else if(events == oldEvents)
+        return; // Nothing changed
+    else
+        registration.events = events;
+
+#if defined(KAPPS_CORE_OS_LINUX)
+    epoll_event event{};
+    event.events = static_cast<std::uint32_t>(events);
+    event.data.fd = fd;
+    int op{EPOLL_CTL_MOD};
+    if(removed)
+        op = EPOLL_CTL_DEL;
+    else if(oldEvents == Registration::Unregistered)
+        op = EPOLL_CTL_ADD;
+    if(::epoll_ctl(_kernelQueue.get(), op, fd, &event) != 0)
+    {
+        KAPPS_CORE_WARNING() << "Can't update epoll registration for fd" << fd
+            << "to events" << events << "-" << ErrnoTracer{};
+    }
+#elif defined(KAPPS_CORE_OS_MACOS)
+    // kqueue has separate read and write filters; add or delete each one
+    // that changed
+    if(oldEvents == Registration::Unregistered)
+        oldEvents = 0;
+    if(removed)
+        events = 0;
+    std::array<struct kevent, 2> changes{};
+    int changeCount{0};
+    auto changeFilter = [&](int pollEvent, std::int16_t filter)
+    {
+        bool wanted = events & pollEvent;
+        if(wanted != static_cast<bool>(oldEvents & pollEvent))
+        {
+            EV_SET(&changes[static_cast<std::size_t>(changeCount)],
+                   static_cast<uintptr_t>(fd), filter,
+                   wanted ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+            ++changeCount;
+        }
+    };
+    changeFilter(POLLIN, EVFILT_READ);
+    changeFilter(POLLOUT, EVFILT_WRITE);
+    if(changeCount &&
+       ::kevent(_kernelQueue.get(), changes.data(), changeCount, nullptr, 0, nullptr) != 0)
+    {
+        KAPPS_CORE_WARNING() << "Can't update kqueue registration for fd" << fd
+            << "to events" << events << "-" << ErrnoTracer{};
+    }
+#endif
+}
+
+void PollWorker::traceEvents(int fd, int revents) const
+{
+    // Always trace POLLERR/POLLNVAL/POLLHUP.  Trace POLLERR and POLLNVAL
+    // at warning, this is not expected - callers should not watch invalid fds
+    // or close them while we're using them
+    if(revents & POLLERR)
+    {
+        KAPPS_CORE_WARNING() << "Error polling file descriptor"
+            << fd << "- got events" << revents;
+    }
+    if(revents & POLLNVAL)
+    {
+        KAPPS_CORE_WARNING() << "Invalid file descriptor" << fd
+            << "- got events" << revents;
+    }
+    // POLLHUP may be expected - remote side hung up.  Log at info, it still
+    // doesn't happen unreasonably often and usually indicates something is
+    // shutting down, etc.
+    if(revents & POLLHUP)
+    {
+        KAPPS_CORE_INFO() << "File descriptor" << fd
+            << "was hung up - got events" << revents;
+    }
 }
 
 void PollWorker::pollFds()
@@ -163,6 +325,14 @@ void PollWorker::pollFds()
     if(_fds.empty())
         throw std::runtime_error{"PollWorker::pollFds() requires at least one file descriptor"};
 
+    if(_kernelQueue)
+        waitKernelQueue();
+    else
+        pollAllFds();
+}
+
+void PollWorker::pollAllFds()
+{
     int pollResult{-1};
     NO_EINTR(pollResult = ::poll(_fds.data(), _fds.size(), -1));
 
@@ -195,27 +365,7 @@ void PollWorker::pollFds()
         auto fd = _fds[i].fd;
         auto revents = _fds[i].revents;
 
-        // Always trace POLLERR/POLLNVAL/POLLHUP.  Trace POLLERR and POLLNVAL
-        // at warning, this is not expected - callers should not watch invalid fds
-        // or close them while we're using them
-        if(revents & POLLERR)
-        {
-            KAPPS_CORE_WARNING() << "Error polling file descriptor"
-                << fd << "- got events" << revents;
-        }
-        if(revents & POLLNVAL)
-        {
-            KAPPS_CORE_WARNING() << "Invalid file descriptor" << fd
-                << "- got events" << revents;
-        }
-        // POLLHUP may be expected - remote side hung up.  Log at info, it still
-        // doesn't happen unreasonably often and usually indicates something is
-        // shutting down, etc.
-        if(revents & POLLHUP)
-        {
-            KAPPS_CORE_INFO() << "File descriptor" << fd
-                << "was hung up - got events" << revents;
-        }
+        traceEvents(fd, revents);
 
         // If any events triggered, invoke activated().  The token is just the
         // index in _fds.
@@ -224,7 +374,81 @@ void PollWorker::pollFds()
     }
 }
 
-PollThread::PollThread(std::function<void(Any)> workFunc)
+void PollWorker::waitKernelQueue()
+{
+    // Watches added from here on won't receive events from this wait
+    ++_batch;
+
+#if defined(KAPPS_CORE_OS_LINUX)
+    std::array<epoll_event, maxKernelEvents> events;
+    int eventCount{-1};
+    NO_EINTR(eventCount = ::epoll_wait(_kernelQueue.get(), events.data(),
+                                       static_cast<int>(events.size()), -1));
+#elif defined(KAPPS_CORE_OS_MACOS)
+    std::array<struct kevent, maxKernelEvents> events;
+    int eventCount{-1};
+    NO_EINTR(eventCount = ::kevent(_kernelQueue.get(), nullptr, 0, events.data(),
+                                   static_cast<int>(events.size()), nullptr));
+#else
+    // Never happens, _kernelQueue is only created on Linux and macOS
+    int eventCount{-1};
+#endif
+
+    // As with poll(2), trace failures and timeouts and don't process any
+    // events
+    if(eventCount <= 0)
+    {
+        KAPPS_CORE_WARNING() << "Waiting for events failed:" << ErrnoTracer{};
+        return;
+    }
+
+    for(int i=0; i<eventCount; ++i)
+    {
+        const auto &event = events[static_cast<std::size_t>(i)];
+#if defined(KAPPS_CORE_OS_LINUX)
+        dispatchFd(event.data.fd, static_cast<int>(event.events));
+#elif defined(KAPPS_CORE_OS_MACOS)
+        int revents{0};
+        if(event.filter == EVFILT_READ)
+            revents |= POLLIN;
+        else if(event.filter == EVFILT_WRITE)
+            revents |= POLLOUT;
+        if(event.flags & EV_EOF)
+            revents |= POLLHUP;
+        if(event.flags & EV_ERROR)
+            revents |= POLLERR;
+        dispatchFd(static_cast<int>(event.ident), revents);
+#endif
+    }
+}
+
+void PollWorker::dispatchFd(int fd, int revents)
+{
+    auto itRegistration = _registrations.find(fd);
+    // A handler may have already removed this fd
+    if(itRegistration == _registrations.end())
+        return;
+
+    traceEvents(fd, revents);
+
+    // Handlers can add and remove watches, so copy the tokens first.  This is
+    // usually just one or two tokens.
+    auto tokens = itRegistration->second.tokens;
+    for(int token : tokens)
+    {
+        const auto &watch = _fds[static_cast<std::size_t>(token)];
+        // Skip watches removed by a handler, or added during this dispatch
+        // (possibly for a different file that reused this fd number)
+        if(watch.fd != fd || _addedBatches[static_cast<std::size_t>(token)] == _batch)
+            continue;
+        // Like poll(2), report the requested events plus errors/hangups
+        if(revents & (watch.events | POLLERR | POLLHUP | POLLNVAL))
+            activated(token);
+    }
+}
+
+PollThread::PollThread(std::function<void(Any)> workFunc,
+                       const char *pWakeupTag)
 {
     // Make the work-item-signaling pipe.  On Linux, an eventfd would be a tad
     // more efficient, but that's not available on macOS and probably isn't
@@ -238,7 +462,7 @@ PollThread::PollThread(std::function<void(Any)> workFunc)
     // - Move the read end of the pipe to this thread
     // - Pass workFunc all the way through to the PollThreadWorker, the outer
     //   lamba is mutable so we can move it again
-    _workThread = std::thread{[this, itemPipe = std::move(pipe.readEnd), workFunc = std::move(workFunc)]() mutable
+    _workThread = std::thread{[this, itemPipe = std::move(pipe.readEnd), workFunc = std::move(workFunc), pWakeupTag]() mutable
     {
         PollThreadWorker worker{std::move(workFunc), itemPipe.get(),
             [this, &itemPipe, &worker]()
@@ -253,7 +477,7 @@ PollThread::PollThread(std::function<void(Any)> workFunc)
                     _items.pop();
                     worker.handle(std::move(item));
                 }
-            }};
+            }, pWakeupTag};
         worker.run();
     }};
 }
@@ -292,7 +516,11 @@ void PollThread::syncInvoke(std::function<void()> func)
 void PollThreadWorker::run()
 {
     while(_running)
+    {
+        // The scope includes the wait, but blocking doesn't use CPU time
+        WakeupScope wakeup{_pWakeupTag};
         pollFds();
+    }
 }
 
 void PollThreadWorker::handle(Any item)
@@ -22,10 +22,13 @@
 #include "posix_objects.h"
 #include "../coresignal.h"
 #include <poll.h>
+#include <cstdint>
 #include <functional>
 #include <thread>
 #include <queue>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace kapps { namespace core {
 
@@ -44,7 +47,11 @@ public:
     // PollThread's constructor creates the thread, which initially has no
     // file descriptors.  Specify the function used to handle work items.
     // Add file descriptors with addFds().
-    PollThread(std::function<void(Any)> workFunc);
+    //
+    // Each wakeup of the thread is accounted to pWakeupTag (see
+    // WakeupAccounting); it must be a string with static storage duration.
+    PollThread(std::function<void(Any)> workFunc,
+               const char *pWakeupTag = "kapps::core::PollThread");
 
     // PollThread's destructor waits on the thread to exit.
     ~PollThread();
@@ -87,49 +94,96 @@ private:
 };
 
 
-// A generic poll(2) worker - just keeps track of a set of file descriptors and
-// their handlers for poll(2).  PollThread creates one of these on its worker
-// thread, and the first file descriptor it provides is the work item signal
-// pipe.
+// A generic poll worker - just keeps track of a set of file descriptors and
+// their handlers.  PollThread creates one of these on its worker thread, and
+// the first file descriptor it provides is the work item signal pipe.
+//
+// On Linux and macOS, this uses epoll(7) or kqueue(2), so each wakeup only
+// visits the file descriptors that are ready.  Otherwise (or if the kernel
+// queue can't be created), it falls back to poll(2) over all file descriptors.
+// Either way, the watches are level-triggered - handlers aren't required to
+// drain a file descriptor completely when activated.
 //
 // Initially, PollWorker has no file descriptors - add them with addFd().
 class PollWorker
 {
 public:
-    // Add a file descriptor to monitor and its desired events.  This can be
-    // called by the functor connected to activated().  (Note that PollWorker
-    // itself is not thread-safe, to add a file descriptor for any thread, use
-    // PollThread::addFd().)
+    PollWorker();
+
+public:
+    // Add a file descriptor to monitor and its desired events (POLLIN,
+    // POLLOUT, etc.).  This can be called by the functor connected to
+    // activated().  (Note that PollWorker itself is not thread-safe, to add a
+    // file descriptor for any thread, use PollThread::addFd().)
     //
     // When the file descriptor receives events, activated() is invoked with
     // the token returned here.  Cancel the watch with removeFd() using the
     // token.
+    //
+    // The same file descriptor can be watched more than once (for example,
+    // separate read and write watches); each watch has its own token.
     int addFd(int fd, int events);
 
     // Remove a file descriptor.  Note that the file descriptor should still be
     // open at this point - if it's closed first, it could have already been
     // reused, and there may be a risk that someone else has already added it to
-    // this PollWorker.
+    // this PollWorker.  (epoll and kqueue also need the file descriptor to
+    // still be open to remove it.)
     void removeFd(int token);
 
-    // Call poll(2) and invoke activated() for each triggered fd.
+    // Wait for events and invoke activated() for each triggered watch.
     // If there are no file descriptors yet, this will throw a
     // std::runtime_error.
     void pollFds();
 
+    // Whether this worker is using poll(2) rather than epoll/kqueue.
+    bool usingPollFallback() const {return !_kernelQueue;}
+
 public:
     Signal<int> activated; // Recieves watch token
 
 private:
-    // The file descriptors being monitored, their requested events, and
-    // their received events - used as the pollfd vector for poll(2).  This
-    // must be a vector because poll(2) requires contiguous storage.
+    // Trace unusual events received for a file descriptor
+    void traceEvents(int fd, int revents) const;
+    // Wait with poll(2) over all file descriptors
+    void pollAllFds();
+    // Wait with epoll/kqueue, then dispatch the ready file descriptors
+    void waitKernelQueue();
+    // Invoke activated() for the watches on fd that match revents
+    void dispatchFd(int fd, int revents);
+    // Update the kernel queue's registration for fd after its watches change
+    void updateRegistration(int fd);
+
+private:
+    // The watches - file descriptors, their requested events, and their
+    // received events.  Tokens are indices into this vector.  With the poll(2)
+    // fallback, this is the pollfd vector for poll(2), which is why it must be
+    // a vector (poll(2) requires contiguous storage).
     //
     // "Empty" entries with fd=-1 can occur here once file descriptors are
     // removed.  These are reused by addFd().  The vector never shrinks to
     // simplify pollFd(), which has to account for handlers possibly removing
     // file descriptors arbitrarily.
     std::vector<pollfd> _fds;
+
+    // The epoll/kqueue file descriptor - invalid when using poll(2).
+    PosixFd _kernelQueue;
+    // For the kernel queue - each watched file descriptor, the watches
+    // (tokens) on it, and the events currently registered with the kernel.
+    struct Registration
+    {
+        enum : int {Unregistered = -1};
+        std::vector<int> tokens;
+        int events{Unregistered};
+    };
+    std::unordered_map<int, Registration> _registrations;
+    // For the kernel queue - each wait increments the batch, and each watch
+    // records the batch that was current when it was added.  A watch added
+    // by a handler during dispatch is not activated by events from that same
+    // wait, which may have been meant for a file descriptor that was removed
+    // and whose number was reused.  Parallel to _fds.
+    std::uint64_t _batch;
+    std::vector<std::uint64_t> _addedBatches;
 };
 
 }}
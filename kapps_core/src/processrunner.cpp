@@ -44,7 +44,8 @@ void RestartStrategy::resetFailures()
 
 void RestartStrategy::processStarting()
 {
-    _successTimer.set(_params._successRunTime, true);
+    // Exactly when this elapses doesn't matter much, let it coalesce
+    _successTimer.set(_params._successRunTime, true, Timer::Precision::Coarse);
 
     // If the process was stopped before, start tracking the failure duration.
     // If it never starts successfully, the duration is measured from the
@@ -121,7 +122,10 @@ void ProcessRunner::startProcess()
     _stderrSink.reset();
     _pProcess.emplace(_program, _arguments);
 
-    _pProcess->prepareChildProcess = [this]{prepareChildProcess();};
+    // Only connect this if it's needed, Process can't use posix_spawn() when
+    // it's connected
+    if(prepareChildProcess)
+        _pProcess->prepareChildProcess = [this]{prepareChildProcess();};
 
     _pProcess->start([this]{processFinished();}, _stdoutSink.readyFunc(),
                      _stderrSink.readyFunc());
@@ -187,7 +191,7 @@ void ProcessRunner::handleProcessEnded()
             << traceMsec(retryDelay);
 
         // This was unexpected, so wait briefly before restarting
-        _postExitTimer.set(retryDelay, true);
+        _postExitTimer.set(retryDelay, true, Timer::Precision::Coarse);
         // This was unexpected so emit a failure signal.  (Do this last after
         // all state changes are done.)
         failed(failureDuration);
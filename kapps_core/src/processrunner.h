@@ -231,6 +231,9 @@ public:
     // Note that although the first execution in the forked child occurs during
     // enable(), it can also occur when the process is being restarted due to a
     // failure.
+    //
+    // This must be connected before enable() to take effect.  When it's not
+    // connected, the process is started with posix_spawn() instead of fork().
     Signal<> prepareChildProcess;
 
     // Line printed to standard output.  (Lines printed to stderr are logged by
@@ -0,0 +1,259 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include "stringslice.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace kapps { namespace core {
+
+// SmallVector is a vector that stores up to N elements inline, only allocating
+// once it grows beyond that.  Port lists and similar short lists are usually
+// just a few elements, so this avoids a tiny allocation for each one and keeps
+// the elements next to the object that owns them.
+//
+// Unlike std::vector, moving a SmallVector that's using inline storage moves
+// the individual elements, so iterators and pointers to the elements are
+// invalidated by a move (as well as by any insertion that grows the storage).
+template<class T, std::size_t N>
+class SmallVector
+{
+    static_assert(N > 0, "SmallVector needs at least one inline element");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+public:
+    SmallVector() = default;
+    SmallVector(std::initializer_list<T> init) {append(init.begin(), init.end());}
+    template<class InputIt,
+             class = typename std::iterator_traits<InputIt>::iterator_category>
+    SmallVector(InputIt first, InputIt last) {append(first, last);}
+    SmallVector(const SmallVector &other) {append(other.begin(), other.end());}
+    SmallVector(SmallVector &&other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        takeFrom(other);
+    }
+    ~SmallVector()
+    {
+        clear();
+        releaseHeap();
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if(this != &other)
+        {
+            clear();
+            append(other.begin(), other.end());
+        }
+        return *this;
+    }
+    SmallVector &operator=(SmallVector &&other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if(this != &other)
+        {
+            clear();
+            releaseHeap();
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    bool operator==(const SmallVector &other) const
+    {
+        return size() == other.size() && std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(const SmallVector &other) const {return !(*this == other);}
+
+    // SmallVector can be viewed as an ArraySlice, like std::vector
+    operator ArraySlice<T>() {return {data(), size()};}
+    operator ArraySlice<const T>() const {return {data(), size()};}
+
+public:
+    T &operator[](std::size_t pos) {assert(pos < _size); return _pData[pos];}
+    const T &operator[](std::size_t pos) const {assert(pos < _size); return _pData[pos];}
+
+    T &front() {assert(!empty()); return _pData[0];}
+    const T &front() const {assert(!empty()); return _pData[0];}
+    T &back() {assert(!empty()); return _pData[_size-1];}
+    const T &back() const {assert(!empty()); return _pData[_size-1];}
+
+    T *data() {return _pData;}
+    const T *data() const {return _pData;}
+
+    iterator begin() {return _pData;}
+    const_iterator begin() const {return _pData;}
+    const_iterator cbegin() const {return _pData;}
+    iterator end() {return _pData + _size;}
+    const_iterator end() const {return _pData + _size;}
+    const_iterator cend() const {return _pData + _size;}
+
+    bool empty() const {return _size == 0;}
+    std::size_t size() const {return _size;}
+    std::size_t capacity() const {return _capacity;}
+    // Whether the elements are currently stored inline (mainly for tests)
+    bool isInline() const {return _pData == inlineData();}
+
+    void reserve(std::size_t capacity)
+    {
+        if(capacity <= _capacity)
+            return;
+
+        T *pNewData = std::allocator<T>{}.allocate(capacity);
+        std::size_t moved{0};
+        try
+        {
+            for(; moved < _size; ++moved)
+                new(pNewData + moved) T(std::move_if_noexcept(_pData[moved]));
+        }
+        catch(...)
+        {
+            std::destroy_n(pNewData, moved);
+            std::allocator<T>{}.deallocate(pNewData, capacity);
+            throw;
+        }
+        std::destroy_n(_pData, _size);
+        releaseHeap();
+        _pData = pNewData;
+        _capacity = capacity;
+    }
+
+    void clear()
+    {
+        std::destroy_n(_pData, _size);
+        _size = 0;
+    }
+
+    template<class... Args>
+    T &emplace_back(Args &&... args)
+    {
+        if(_size == _capacity)
+        {
+            // Construct the value before growing - the arguments might refer
+            // to an existing element
+            T value(std::forward<Args>(args)...);
+            reserve(_capacity * 2);
+            new(_pData + _size) T(std::move(value));
+        }
+        else
+            new(_pData + _size) T(std::forward<Args>(args)...);
+        ++_size;
+        return back();
+    }
+    void push_back(const T &value) {emplace_back(value);}
+    void push_back(T &&value) {emplace_back(std::move(value));}
+
+    void pop_back()
+    {
+        assert(!empty());
+        --_size;
+        _pData[_size].~T();
+    }
+
+    // Insert a value before pos; returns an iterator to the inserted value
+    iterator insert(const_iterator pos, T value)
+    {
+        std::size_t index = static_cast<std::size_t>(pos - begin());
+        assert(index <= _size);
+        emplace_back(std::move(value));
+        std::rotate(begin() + index, end() - 1, end());
+        return begin() + index;
+    }
+
+    // Erase the value at pos; returns an iterator to the following value
+    iterator erase(const_iterator pos)
+    {
+        std::size_t index = static_cast<std::size_t>(pos - begin());
+        assert(index < _size);
+        std::move(begin() + index + 1, end(), begin() + index);
+        pop_back();
+        return begin() + index;
+    }
+
+private:
+    T *inlineData() {return reinterpret_cast<T*>(_inline);}
+    const T *inlineData() const {return reinterpret_cast<const T*>(_inline);}
+
+    template<class InputIt>
+    void append(InputIt first, InputIt last)
+    {
+        using Category = typename std::iterator_traits<InputIt>::iterator_category;
+        if constexpr(std::is_base_of<std::forward_iterator_tag, Category>::value)
+            reserve(_size + static_cast<std::size_t>(std::distance(first, last)));
+        for(; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    // Free the heap storage if there is any, returning to inline storage.  The
+    // elements must have been destroyed or moved already.
+    void releaseHeap()
+    {
+        if(!isInline())
+        {
+            std::allocator<T>{}.deallocate(_pData, _capacity);
+            _pData = inlineData();
+            _capacity = N;
+        }
+    }
+
+    // Take the elements from other, which is left empty.  This must be empty
+    // and using inline storage.
+    void takeFrom(SmallVector &other)
+    {
+        assert(empty() && isInline());
+        if(other.isInline())
+        {
+            for(std::size_t i=0; i<other._size; ++i)
+                new(_pData + i) T(std::move(other._pData[i]));
+            _size = other._size;
+            other.clear();
+        }
+        else
+        {
+            _pData = other._pData;
+            _size = other._size;
+            _capacity = other._capacity;
+            other._pData = other.inlineData();
+            other._size = 0;
+            other._capacity = N;
+        }
+    }
+
+private:
+    alignas(T) unsigned char _inline[sizeof(T) * N];
+    T *_pData{inlineData()};
+    std::size_t _size{0};
+    std::size_t _capacity{N};
+};
+
+}}
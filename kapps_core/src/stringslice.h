@@ -82,8 +82,11 @@ public:
     // (If T is non-const, this actually user-defines the copy constructor, but
     // the behavior is the same and it's not straightforward to cram a
     // std::enable_if<> in here since no part of the method call is deduced.)
+    //
+    // This uses the members directly, since ArraySlice<mT>::data() const
+    // would return a const mT*, which can't initialize a mutable slice.
     ArraySlice(const ArraySlice<mT> &array)
-        : ArraySlice{array.data(), array.size()}
+        : _pBegin{array._pBegin}, _pEnd{array._pEnd}
     {}
 
     // Create an ArraySlice from a std::vector.
@@ -243,6 +246,9 @@ public:
     std::vector<mT> to_vector() const {return {begin(), end()};}
 
 private:
+    // ArraySlice<const T> reads the members of ArraySlice<T> when converting
+    template<class> friend class ArraySlice;
+
     T *_pBegin;
     T *_pEnd;
 };
@@ -350,25 +356,106 @@ public:
         return {this->data() + pos, this->data() + pos + resultLen};
     }
 
+    // The searches use Traits::find() to scan for characters; for char this is
+    // memchr(), which the C library vectorizes (and selects at runtime for the
+    // CPU on glibc).  These are the inner loops of the JSON, UAPI, and /proc
+    // parsers.
     std::size_t find(BasicStringSlice value, std::size_t pos = 0) const
     {
-        auto suffix = substr(pos);
-        auto itMatch = std::search(suffix.begin(), suffix.end(), value.begin(),
-            value.end(), &Traits::eq);
-        if(itMatch == suffix.end())
+        if(pos > this->size())
             return npos;
-        return itMatch - this->begin();
+        if(value.empty())
+            return pos;
+        // Scan for the first character of value, then compare the rest
+        const CharT *pNext{this->data() + pos};
+        const CharT *pLastStart{this->end() - std::min(value.size(), this->size())};
+        while(value.size() <= this->size() && pNext <= pLastStart)
+        {
+            pNext = Traits::find(pNext, pLastStart - pNext + 1, value.front());
+            if(!pNext)
+                return npos;
+            if(Traits::compare(pNext + 1, value.data() + 1, value.size() - 1) == 0)
+                return pNext - this->begin();
+            ++pNext;
+        }
+        return npos;
     }
     std::size_t find(CharT c, std::size_t pos = 0) const
     {
-        return find({&c, &c+1}, pos);
+        if(pos >= this->size())
+            return npos;
+        const CharT *pMatch{Traits::find(this->data() + pos, this->size() - pos, c)};
+        return pMatch ? pMatch - this->begin() : npos;
+    }
+    // Find the first character that is (or is not) one of the characters in
+    // 'chars'
+    std::size_t find_first_of(BasicStringSlice chars, std::size_t pos = 0) const
+    {
+        if(chars.size() == 1)
+            return find(chars.front(), pos);
+        return findFirstMatch(chars, pos, true);
+    }
+    std::size_t find_first_not_of(BasicStringSlice chars, std::size_t pos = 0) const
+    {
+        return findFirstMatch(chars, pos, false);
     }
     // rfind
-    // find_first_of
-    // find_first_not_of
     // find_last_of
     // find_last_not_of
 
+    // Split the string at each occurrence of 'delimiter'.  The result always
+    // has one more slice than the number of delimiters - an empty string
+    // produces one empty slice, and leading/trailing delimiters produce empty
+    // slices.  The slices reference this slice's data.
+    std::vector<BasicStringSlice> split(CharT delimiter) const
+    {
+        std::vector<BasicStringSlice> pieces;
+        std::size_t start{0};
+        while(true)
+        {
+            std::size_t end = find(delimiter, start);
+            if(end == npos)
+                break;
+            pieces.push_back({this->data() + start, this->data() + end});
+            start = end + 1;
+        }
+        pieces.push_back({this->data() + start, this->end()});
+        return pieces;
+    }
+
+private:
+    std::size_t findFirstMatch(BasicStringSlice chars, std::size_t pos,
+                               bool matchValue) const
+    {
+        if(pos >= this->size())
+            return npos;
+        if constexpr(sizeof(CharT) == 1)
+        {
+            // Build a table of the characters so each one is a single lookup,
+            // rather than scanning 'chars' for every character
+            std::array<bool, 256> table{};
+            for(CharT c : chars)
+                table[static_cast<unsigned char>(c)] = true;
+            for(auto itChar = this->begin() + pos; itChar != this->end(); ++itChar)
+            {
+                if(table[static_cast<unsigned char>(*itChar)] == matchValue)
+                    return itChar - this->begin();
+            }
+        }
+        else
+        {
+            for(auto itChar = this->begin() + pos; itChar != this->end(); ++itChar)
+            {
+                bool inChars = Traits::find(chars.data(), chars.size(), *itChar);
+                if(inChars == matchValue)
+                    return itChar - this->begin();
+            }
+        }
+        return npos;
+    }
+
+public:
+
     // Convert to a std::string - the result is always UTF-8 and null-terminated.
     // For StringSlice this just copies the data; for WStringSlice it's
     // converted to UTF-8 from UTF-16/32 (depending on the platform's wchar_t).
@@ -568,6 +655,23 @@ IntegerT parseInteger(BasicStringSlice<CharT, TraitsT> str)
     }
 
     IntegerT result{};
+
+    // If there are few enough digits that the value can't overflow, skip the
+    // range checks - this is the case for nearly everything we parse (ports,
+    // latencies, prefix lengths, etc.)
+    if(itChar != str.end() &&
+        str.end() - itChar <= std::numeric_limits<IntegerT>::digits10)
+    {
+        while(itChar != str.end())
+        {
+            if(TraitsT::lt(*itChar, '0') || TraitsT::lt('9', *itChar))
+                throw std::runtime_error{"cannot parse non-digit as number"};
+            result = static_cast<IntegerT>(result * 10 + static_cast<IntegerT>(*itChar - '0') * negate);
+            ++itChar;
+        }
+        return result;
+    }
+
     while(itChar != str.end())
     {
         if(TraitsT::lt(*itChar, '0') || TraitsT::lt('9', *itChar))
@@ -0,0 +1,265 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "subnettrie.h"
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace kapps { namespace core {
+
+namespace
+{
+    unsigned getBit(const PrefixTrie::Bits &bits, unsigned bit)
+    {
+        return (bits[bit / 8] >> (7 - bit % 8)) & 1u;
+    }
+
+    void setBit(PrefixTrie::Bits &bits, unsigned bit, unsigned value)
+    {
+        std::uint8_t mask = static_cast<std::uint8_t>(0x80u >> (bit % 8));
+        if(value)
+            bits[bit / 8] |= mask;
+        else
+            bits[bit / 8] &= static_cast<std::uint8_t>(~mask);
+    }
+
+    PrefixTrie::Bits ipv4Bits(const Ipv4Address &address)
+    {
+        PrefixTrie::Bits bits{};
+        for(int i=0; i<4; ++i)
+            bits[i] = static_cast<std::uint8_t>(address.address() >> (24 - 8*i));
+        return bits;
+    }
+
+    Ipv4Address ipv4FromBits(const PrefixTrie::Bits &bits)
+    {
+        std::uint32_t address{0};
+        for(int i=0; i<4; ++i)
+            address = (address << 8) | bits[i];
+        return {address};
+    }
+
+    PrefixTrie::Bits ipv6Bits(const Ipv6Address &address)
+    {
+        PrefixTrie::Bits bits{};
+        std::memcpy(bits.data(), address.address(), bits.size());
+        return bits;
+    }
+}
+
+PrefixTrie::PrefixTrie(unsigned addressBits)
+    : _addressBits{addressBits}, _nodes{Node{{0, 0}, false}}
+{
+    assert(addressBits <= 128);
+}
+
+std::uint32_t PrefixTrie::child(std::uint32_t node, unsigned bit) const
+{
+    return _nodes[node].children[bit];
+}
+
+std::uint32_t PrefixTrie::childOrNone(std::uint32_t node, unsigned bit) const
+{
+    std::uint32_t next = child(node, bit);
+    return next ? next : noNode;
+}
+
+void PrefixTrie::insert(const Bits &bits, unsigned length)
+{
+    if(length > _addressBits)
+        throw std::runtime_error{"prefix length exceeds address length"};
+
+    std::uint32_t node = 0;
+    for(unsigned i=0; i<length; ++i)
+    {
+        unsigned bit = getBit(bits, i);
+        std::uint32_t next = child(node, bit);
+        if(!next)
+        {
+            next = static_cast<std::uint32_t>(_nodes.size());
+            _nodes.push_back(Node{{0, 0}, false});
+            _nodes[node].children[bit] = next;
+        }
+        node = next;
+    }
+    _nodes[node].terminal = true;
+}
+
+int PrefixTrie::longestMatch(const Bits &address) const
+{
+    int match = _nodes[0].terminal ? 0 : -1;
+    std::uint32_t node = 0;
+    for(unsigned i=0; i<_addressBits; ++i)
+    {
+        node = child(node, getBit(address, i));
+        if(!node)
+            break;
+        if(_nodes[node].terminal)
+            match = static_cast<int>(i) + 1;
+    }
+    return match;
+}
+
+void PrefixTrie::appendCovering(std::uint32_t node, Bits &path, unsigned length,
+                                std::vector<Prefix> &result) const
+{
+    if(_nodes[node].terminal)
+    {
+        // Everything below this node is covered by this prefix
+        result.push_back({path, length});
+        return;
+    }
+
+    auto firstResult = result.size();
+    for(unsigned bit=0; bit<2; ++bit)
+    {
+        std::uint32_t next = child(node, bit);
+        if(!next)
+            continue;
+        setBit(path, length, bit);
+        appendCovering(next, path, length + 1, result);
+        setBit(path, length, 0);
+    }
+
+    // If both halves were covered entirely, they're the two children of this
+    // node; replace them with this node's prefix
+    if(result.size() == firstResult + 2 && result[firstResult].length == length + 1 &&
+       result[firstResult + 1].length == length + 1)
+    {
+        result.resize(firstResult);
+        result.push_back({path, length});
+    }
+}
+
+std::vector<PrefixTrie::Prefix> PrefixTrie::coveringPrefixes() const
+{
+    std::vector<Prefix> result;
+    Bits path{};
+    appendCovering(0, path, 0, result);
+    return result;
+}
+
+void PrefixTrie::appendDifference(std::uint32_t node, bool covered,
+                                  const PrefixTrie &other, std::uint32_t otherNode,
+                                  Bits &path, unsigned length,
+                                  PrefixTrie &result) const
+{
+    // node and otherNode are noNode if that trie has nothing at this path
+    if(otherNode != noNode && other._nodes[otherNode].terminal)
+        return; // Everything here is excluded by 'other'
+    if(node != noNode && _nodes[node].terminal)
+        covered = true;
+
+    if(!covered && node == noNode)
+        return; // Nothing here in this trie
+    if(covered && otherNode == noNode)
+    {
+        // Covered, and nothing in 'other' excludes any part of it
+        result.insert(path, length);
+        return;
+    }
+
+    // Otherwise, split this prefix.  This never goes past the last address
+    // bit - nodes at the full address length are always terminal.
+    for(unsigned bit=0; bit<2; ++bit)
+    {
+        setBit(path, length, bit);
+        appendDifference(node == noNode ? noNode : childOrNone(node, bit),
+                         covered, other,
+                         otherNode == noNode ? noNode : other.childOrNone(otherNode, bit),
+                         path, length + 1, result);
+        setBit(path, length, 0);
+    }
+}
+
+PrefixTrie PrefixTrie::difference(const PrefixTrie &other) const
+{
+    if(other._addressBits != _addressBits)
+        throw std::runtime_error{"can't compare prefixes of different address lengths"};
+
+    PrefixTrie result{_addressBits};
+    Bits path{};
+    appendDifference(0, false, other, 0, path, 0, result);
+    return result;
+}
+
+void Ipv4SubnetSet::insert(const Ipv4Subnet &subnet)
+{
+    _trie.insert(ipv4Bits(subnet.address()), subnet.prefix());
+}
+
+bool Ipv4SubnetSet::contains(const Ipv4Address &address) const
+{
+    return _trie.longestMatch(ipv4Bits(address)) >= 0;
+}
+
+nullable_t<Ipv4Subnet> Ipv4SubnetSet::longestMatch(const Ipv4Address &address) const
+{
+    int length = _trie.longestMatch(ipv4Bits(address));
+    if(length < 0)
+        return {};
+    return Ipv4Subnet{address, static_cast<unsigned>(length)};
+}
+
+std::vector<Ipv4Subnet> Ipv4SubnetSet::aggregate() const
+{
+    std::vector<Ipv4Subnet> result;
+    for(const auto &prefix : _trie.coveringPrefixes())
+        result.push_back({ipv4FromBits(prefix.bits), prefix.length});
+    return result;
+}
+
+Ipv4SubnetSet Ipv4SubnetSet::difference(const Ipv4SubnetSet &other) const
+{
+    return {_trie.difference(other._trie)};
+}
+
+void Ipv6SubnetSet::insert(const Ipv6Subnet &subnet)
+{
+    _trie.insert(ipv6Bits(subnet.address()), subnet.prefix());
+}
+
+bool Ipv6SubnetSet::contains(const Ipv6Address &address) const
+{
+    return _trie.longestMatch(ipv6Bits(address)) >= 0;
+}
+
+nullable_t<Ipv6Subnet> Ipv6SubnetSet::longestMatch(const Ipv6Address &address) const
+{
+    int length = _trie.longestMatch(ipv6Bits(address));
+    if(length < 0)
+        return {};
+    unsigned prefix = static_cast<unsigned>(length);
+    return Ipv6Subnet{Ipv6Address::maskIpv6(address, prefix), prefix};
+}
+
+std::vector<Ipv6Subnet> Ipv6SubnetSet::aggregate() const
+{
+    std::vector<Ipv6Subnet> result;
+    for(const auto &prefix : _trie.coveringPrefixes())
+        result.push_back({Ipv6Address{prefix.bits.data()}, prefix.length});
+    return result;
+}
+
+Ipv6SubnetSet Ipv6SubnetSet::difference(const Ipv6SubnetSet &other) const
+{
+    return {_trie.difference(other._trie)};
+}
+
+}}
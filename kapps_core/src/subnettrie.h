@@ -0,0 +1,148 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include "ipaddress.h"
+#include "util.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace kapps { namespace core {
+
+// PrefixTrie is a binary trie of address prefixes, used to test addresses
+// against a set of subnets and to combine subnet sets.  Each inserted prefix
+// marks the node at the end of its path, so lookups take at most one step per
+// address bit regardless of how many prefixes are in the set.
+//
+// This is family-independent - addresses are given as bytes in network byte
+// order, and IPv4 only uses the first 4 bytes.  Ipv4SubnetSet and
+// Ipv6SubnetSet below provide typed interfaces.
+class KAPPS_CORE_EXPORT PrefixTrie
+{
+public:
+    using Bits = std::array<std::uint8_t, 16>;
+
+    struct Prefix
+    {
+        Bits bits;
+        unsigned length;
+    };
+
+public:
+    // addressBits is 32 for IPv4 or 128 for IPv6
+    explicit PrefixTrie(unsigned addressBits);
+
+private:
+    // Used by difference() for a path that isn't in a trie
+    static constexpr std::uint32_t noNode = 0xFFFFFFFFu;
+
+    struct Node
+    {
+        // Indices of the child nodes for a 0 or 1 bit, or 0 if there is no
+        // child (the root can't be a child)
+        std::array<std::uint32_t, 2> children;
+        // Whether a prefix ending at this node was inserted
+        bool terminal;
+    };
+
+private:
+    std::uint32_t child(std::uint32_t node, unsigned bit) const;
+    std::uint32_t childOrNone(std::uint32_t node, unsigned bit) const;
+    void appendCovering(std::uint32_t node, Bits &path, unsigned length,
+                        std::vector<Prefix> &result) const;
+    void appendDifference(std::uint32_t node, bool covered,
+                          const PrefixTrie &other, std::uint32_t otherNode,
+                          Bits &path, unsigned length,
+                          PrefixTrie &result) const;
+
+public:
+    unsigned addressBits() const {return _addressBits;}
+    bool empty() const {return _nodes.size() == 1 && !_nodes[0].terminal;}
+
+    // Insert a prefix.  Bits after the prefix length are ignored.  Throws if
+    // the length exceeds the address length.
+    void insert(const Bits &bits, unsigned length);
+
+    // Find the longest inserted prefix containing an address.  Returns its
+    // length, or -1 if no prefix contains the address.
+    int longestMatch(const Bits &address) const;
+
+    // Get the smallest set of prefixes covering exactly the same addresses as
+    // the inserted prefixes - nested prefixes are dropped, and sibling
+    // prefixes are combined.  The result is ordered by address.
+    std::vector<Prefix> coveringPrefixes() const;
+
+    // Get the addresses covered by this trie that aren't covered by 'other'.
+    // Both must have the same address length.
+    PrefixTrie difference(const PrefixTrie &other) const;
+
+private:
+    unsigned _addressBits;
+    // _nodes[0] is the root (the zero-length prefix)
+    std::vector<Node> _nodes;
+};
+
+// A set of IPv4 subnets, with longest-prefix matching and aggregation.
+class KAPPS_CORE_EXPORT Ipv4SubnetSet
+{
+public:
+    Ipv4SubnetSet() : _trie{32} {}
+
+private:
+    Ipv4SubnetSet(PrefixTrie trie) : _trie{std::move(trie)} {}
+
+public:
+    bool empty() const {return _trie.empty();}
+    void insert(const Ipv4Subnet &subnet);
+    bool contains(const Ipv4Address &address) const;
+    // The most specific subnet in the set containing this address, if any
+    nullable_t<Ipv4Subnet> longestMatch(const Ipv4Address &address) const;
+    // The smallest set of subnets covering the same addresses, see
+    // PrefixTrie::coveringPrefixes()
+    std::vector<Ipv4Subnet> aggregate() const;
+    // The addresses in this set that aren't in 'other', as a new set
+    Ipv4SubnetSet difference(const Ipv4SubnetSet &other) const;
+
+private:
+    PrefixTrie _trie;
+};
+
+// A set of IPv6 subnets; same as Ipv4SubnetSet
+class KAPPS_CORE_EXPORT Ipv6SubnetSet
+{
+public:
+    Ipv6SubnetSet() : _trie{128} {}
+
+private:
+    Ipv6SubnetSet(PrefixTrie trie) : _trie{std::move(trie)} {}
+
+public:
+    bool empty() const {return _trie.empty();}
+    void insert(const Ipv6Subnet &subnet);
+    bool contains(const Ipv6Address &address) const;
+    nullable_t<Ipv6Subnet> longestMatch(const Ipv6Address &address) const;
+    std::vector<Ipv6Subnet> aggregate() const;
+    Ipv6SubnetSet difference(const Ipv6SubnetSet &other) const;
+
+private:
+    PrefixTrie _trie;
+};
+
+}}
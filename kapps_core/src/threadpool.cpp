@@ -0,0 +1,298 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "threadpool.h"
+#include "logger.h"
+#include "workfunc.h"
+#include <algorithm>
+#include <cassert>
+
+namespace kapps { namespace core {
+
+namespace
+{
+    // The ThreadPool and worker index of the current thread, if it's a worker
+    thread_local ThreadPool *t_pPool{nullptr};
+    thread_local std::size_t t_workerIndex{0};
+
+    // Run a task, tracing any exception (like WorkFunc)
+    void runTask(Task &task)
+    {
+        try
+        {
+            task();
+        }
+        catch(const std::exception &ex)
+        {
+            KAPPS_CORE_WARNING() << "Task threw an exception:" << ex.what();
+        }
+        catch(...)
+        {
+            KAPPS_CORE_WARNING() << "Task threw unknown exception";
+        }
+    }
+
+    void updateMax(std::atomic<std::size_t> &max, std::size_t value)
+    {
+        std::size_t prior = max.load(std::memory_order_relaxed);
+        while(prior < value &&
+            !max.compare_exchange_weak(prior, value, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    // Intentionally leaked, see declaration.  Tasks may block, so use at least
+    // a few threads even on machines with few CPUs.
+    static ThreadPool *pShared = new ThreadPool{std::max(4u, std::thread::hardware_concurrency())};
+    return *pShared;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : _stopping{false}, _queued{0}, _sleeping{0}, _maxQueued{0}, _completed{0},
+      _stolen{0}
+{
+    threadCount = std::max(threadCount, 1u);
+    _workers.reserve(threadCount);
+    for(unsigned i=0; i<threadCount; ++i)
+        _workers.push_back(std::make_unique<Worker>());
+    // Start the threads after all workers exist, since they steal from each
+    // other
+    for(std::size_t i=0; i<_workers.size(); ++i)
+        _workers[i]->thread = std::thread{[this, i]{workerProc(i);}};
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{_sharedMutex};
+        _stopping = true;
+    }
+    _haveTasks.notify_all();
+    for(auto &pWorker : _workers)
+    {
+        assert(pWorker->thread.joinable()); // Class invariant
+        pWorker->thread.join();
+    }
+}
+
+void ThreadPool::workerProc(std::size_t index)
+{
+    t_pPool = this;
+    t_workerIndex = index;
+
+    Task task;
+    while(true)
+    {
+        if(takeTask(index, task))
+        {
+            runTask(task);
+            task.clear();
+            _completed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Nothing to do, wait for a task to be posted.  Register in _sleeping
+        // before checking _queued; post() increments _queued before checking
+        // _sleeping.
+        std::unique_lock<std::mutex> lock{_sharedMutex};
+        ++_sleeping;
+        _haveTasks.wait(lock, [this]{return _stopping || _queued > 0;});
+        --_sleeping;
+        // Run everything that's left before stopping
+        if(_stopping && _queued == 0)
+            return;
+    }
+}
+
+bool ThreadPool::takeTask(std::size_t index, Task &task)
+{
+    // Newest task from this worker's own queue
+    {
+        Worker &worker = *_workers[index];
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        if(!worker.tasks.empty())
+        {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            --_queued;
+            return true;
+        }
+    }
+
+    // Oldest task from the shared queue
+    {
+        std::lock_guard<std::mutex> lock{_sharedMutex};
+        if(!_sharedTasks.empty())
+        {
+            task = std::move(_sharedTasks.front());
+            _sharedTasks.pop_front();
+            --_queued;
+            return true;
+        }
+    }
+
+    // Oldest task from another worker, starting with the next worker
+    for(std::size_t i=1; i<_workers.size(); ++i)
+    {
+        Worker &victim = *_workers[(index + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock{victim.mutex};
+        if(!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --_queued;
+            _stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::post(Task task)
+{
+    assert(task);   // Ensured by caller
+
+    updateMax(_maxQueued, ++_queued);
+    if(t_pPool == this)
+    {
+        Worker &worker = *_workers[t_workerIndex];
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        worker.tasks.push_back(std::move(task));
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock{_sharedMutex};
+        _sharedTasks.push_back(std::move(task));
+    }
+
+    if(_sleeping > 0)
+    {
+        // Synchronize with a worker that is about to wait - it either sees
+        // _queued, or is waiting by the time we notify
+        {
+            std::lock_guard<std::mutex> lock{_sharedMutex};
+        }
+        _haveTasks.notify_one();
+    }
+}
+
+auto ThreadPool::stats() const -> Stats
+{
+    return {_queued.load(std::memory_order_relaxed),
+            _maxQueued.load(std::memory_order_relaxed),
+            _completed.load(std::memory_order_relaxed),
+            _stolen.load(std::memory_order_relaxed)};
+}
+
+void Strand::Stats::trace(std::ostream &os) const
+{
+    os << "queued: " << queued << ", max queued: " << maxQueued
+        << ", completed: " << completed << ", max latency: "
+        << maxLatency.count() << " us, avg latency: "
+        << (completed ? totalLatency.count() / completed : 0) << " us";
+}
+
+const std::size_t Strand::tasksPerTurn{16};
+
+Strand::Strand(std::string name, ThreadPool &pool)
+    : _name{std::move(name)}, _pool{pool}, _scheduled{false},
+      _stats{}
+{
+}
+
+Strand::~Strand()
+{
+    std::unique_lock<std::mutex> lock{_mutex};
+    _idle.wait(lock, [this]{return !_scheduled;});
+    KAPPS_CORE_INFO() << "Strand" << _name << "finished -" << _stats;
+}
+
+void Strand::runTurn()
+{
+    for(std::size_t i=0; i<tasksPerTurn; ++i)
+    {
+        Item item;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if(_items.empty())
+            {
+                _scheduled = false;
+                // The Strand can be destroyed as soon as the lock is released
+                _idle.notify_all();
+                return;
+            }
+            item = std::move(_items.front());
+            _items.pop_front();
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - item.queuedAt);
+            _stats.queued = _items.size();
+            _stats.maxLatency = std::max(_stats.maxLatency, latency);
+            _stats.totalLatency += latency;
+        }
+
+        runTask(item.task);
+        item.task.clear();
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        ++_stats.completed;
+    }
+
+    // Let other work run, then continue
+    _pool.post([this]{runTurn();});
+}
+
+void Strand::post(Task task)
+{
+    assert(task);   // Ensured by caller
+
+    bool schedule{false};
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _items.push_back({std::move(task), std::chrono::steady_clock::now()});
+        _stats.queued = _items.size();
+        _stats.maxQueued = std::max(_stats.maxQueued, _stats.queued);
+        if(!_scheduled)
+        {
+            _scheduled = true;
+            schedule = true;
+        }
+    }
+
+    if(schedule)
+        _pool.post([this]{runTurn();});
+}
+
+void Strand::syncInvoke(std::function<void()> func)
+{
+    SyncWorkFunc syncWork;
+    auto work = syncWork.work<>(std::move(func));
+    post([&work]{work.invoke();});
+    syncWork.wait();
+}
+
+auto Strand::stats() const -> Stats
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _stats;
+}
+
+}}
@@ -0,0 +1,313 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include "util.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kapps { namespace core {
+
+// Task is a move-only void() functor used by ThreadPool and Strand.  Unlike
+// WorkFunc (which wraps std::function) or an Any work item, the functor does
+// not have to be copiable, and small functors are stored inline without a
+// heap allocation.
+class Task
+{
+private:
+    // Functors up to this size are stored inline
+    static constexpr std::size_t inlineSize = 4 * sizeof(void*);
+
+    struct Ops
+    {
+        void (*invoke)(void *pStorage);
+        // Move the functor from pSrc to uninitialized storage at pDst, and
+        // destroy the one in pSrc
+        void (*relocate)(void *pDst, void *pSrc);
+        void (*destroy)(void *pStorage);
+    };
+
+    template<class FuncT>
+    static constexpr bool storedInline()
+    {
+        return sizeof(FuncT) <= inlineSize &&
+            alignof(FuncT) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible<FuncT>::value;
+    }
+
+    template<class FuncT>
+    struct InlineOps
+    {
+        static FuncT &get(void *pStorage) {return *std::launder(reinterpret_cast<FuncT*>(pStorage));}
+        static void invoke(void *pStorage) {get(pStorage)();}
+        static void relocate(void *pDst, void *pSrc)
+        {
+            new(pDst) FuncT{std::move(get(pSrc))};
+            get(pSrc).~FuncT();
+        }
+        static void destroy(void *pStorage) {get(pStorage).~FuncT();}
+        static constexpr Ops ops{&invoke, &relocate, &destroy};
+    };
+
+    template<class FuncT>
+    struct HeapOps
+    {
+        static FuncT *&get(void *pStorage) {return *std::launder(reinterpret_cast<FuncT**>(pStorage));}
+        static void invoke(void *pStorage) {(*get(pStorage))();}
+        static void relocate(void *pDst, void *pSrc)
+        {
+            new(pDst) FuncT*{get(pSrc)};
+        }
+        static void destroy(void *pStorage) {delete get(pStorage);}
+        static constexpr Ops ops{&invoke, &relocate, &destroy};
+    };
+
+public:
+    Task() : _pOps{} {}
+    Task(std::nullptr_t) : Task{} {}
+    template<class FuncT,
+             class = std::enable_if_t<!std::is_same<std::decay_t<FuncT>, Task>::value>>
+    Task(FuncT &&func)
+    {
+        using StoredT = std::decay_t<FuncT>;
+        if constexpr(storedInline<StoredT>())
+        {
+            new(&_storage) StoredT{std::forward<FuncT>(func)};
+            _pOps = &InlineOps<StoredT>::ops;
+        }
+        else
+        {
+            new(&_storage) StoredT*{new StoredT{std::forward<FuncT>(func)}};
+            _pOps = &HeapOps<StoredT>::ops;
+        }
+    }
+    Task(Task &&other) noexcept
+        : _pOps{other._pOps}
+    {
+        if(_pOps)
+        {
+            _pOps->relocate(&_storage, &other._storage);
+            other._pOps = nullptr;
+        }
+    }
+    Task &operator=(Task &&other) noexcept
+    {
+        if(this != &other)
+        {
+            clear();
+            if(other._pOps)
+            {
+                other._pOps->relocate(&_storage, &other._storage);
+                _pOps = other._pOps;
+                other._pOps = nullptr;
+            }
+        }
+        return *this;
+    }
+    ~Task() {clear();}
+
+private:
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+public:
+    explicit operator bool() const {return _pOps;}
+    bool operator!() const {return !_pOps;}
+
+    // Invoke the functor.  The Task must not be empty.
+    void operator()() {_pOps->invoke(&_storage);}
+
+    void clear()
+    {
+        if(_pOps)
+        {
+            _pOps->destroy(&_storage);
+            _pOps = nullptr;
+        }
+    }
+
+private:
+    const Ops *_pOps;
+    std::aligned_storage_t<inlineSize, alignof(std::max_align_t)> _storage;
+};
+
+// ThreadPool is a pool of worker threads that run Tasks.  It's shared by
+// subsystems that previously created their own WorkThread - use a Strand to
+// run a subsystem's tasks serially on the pool.
+//
+// Each worker has its own queue; tasks posted from a worker thread go to that
+// worker's queue, and idle workers steal tasks from other workers' queues.
+// Tasks posted from other threads go to a shared queue.  Tasks posted
+// directly to a ThreadPool run concurrently in no particular order.
+//
+// Tasks may block briefly (they're used for Win32 route changes, destroying
+// waits, etc.), but long-running work should still have its own thread.
+class KAPPS_CORE_EXPORT ThreadPool
+{
+public:
+    struct Stats
+    {
+        // Tasks currently queued (not yet started)
+        std::size_t queued;
+        // Most tasks that have been queued at once
+        std::size_t maxQueued;
+        // Tasks completed
+        std::uint64_t completed;
+        // Tasks that were stolen from another worker's queue
+        std::uint64_t stolen;
+    };
+
+public:
+    // The shared ThreadPool.  It's created on first use and is never destroyed
+    // (it may be used by static objects, and joining threads during static
+    // destruction can deadlock in a DLL on Windows); work that must finish
+    // should be on a Strand, which waits for its tasks when destroyed.
+    static ThreadPool &shared();
+
+public:
+    // Create a ThreadPool with the specified number of worker threads (at
+    // least 1).
+    explicit ThreadPool(unsigned threadCount);
+    // Runs any tasks that are still queued, then stops the worker threads.
+    ~ThreadPool();
+
+private:
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void workerProc(std::size_t index);
+    // Take a task from the worker's queue, the shared queue, or another
+    // worker's queue
+    bool takeTask(std::size_t index, Task &task);
+
+public:
+    void post(Task task);
+    std::size_t threadCount() const {return _workers.size();}
+    Stats stats() const;
+
+private:
+    std::vector<std::unique_ptr<Worker>> _workers;
+    // The shared queue; _sharedMutex also guards _stopping and is used to wait
+    // for work
+    std::mutex _sharedMutex;
+    std::condition_variable _haveTasks;
+    std::deque<Task> _sharedTasks;
+    bool _stopping;
+    // _queued is incremented before a task is queued, and a worker checks it
+    // after registering in _sleeping, so a wakeup can't be missed.
+    std::atomic<std::size_t> _queued;
+    std::atomic<std::size_t> _sleeping;
+    std::atomic<std::size_t> _maxQueued;
+    std::atomic<std::uint64_t> _completed;
+    std::atomic<std::uint64_t> _stolen;
+};
+
+// Strand runs Tasks serially, in the order they're posted, on a ThreadPool.
+// It replaces a dedicated WorkThread - at most one of the Strand's tasks runs
+// at a time, but they're not bound to one thread, and no thread is tied up
+// when the Strand is idle.
+//
+// Destroying a Strand waits for its queued tasks to complete (like
+// WorkThread).  Don't destroy a Strand from one of its own tasks.
+class KAPPS_CORE_EXPORT Strand
+{
+public:
+    struct Stats : public OStreamInsertable<Stats>
+    {
+        // Tasks currently queued (not yet started)
+        std::size_t queued;
+        // Most tasks that have been queued at once
+        std::size_t maxQueued;
+        // Tasks completed
+        std::uint64_t completed;
+        // Longest and total time tasks waited in the queue before starting
+        std::chrono::microseconds maxLatency;
+        std::chrono::microseconds totalLatency;
+
+        void trace(std::ostream &os) const;
+    };
+
+private:
+    // Most tasks run in one turn on the pool before yielding to other
+    // work
+    static const std::size_t tasksPerTurn;
+
+    struct Item
+    {
+        Task task;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+public:
+    explicit Strand(std::string name, ThreadPool &pool = ThreadPool::shared());
+    ~Strand();
+
+private:
+    Strand(const Strand &) = delete;
+    Strand &operator=(const Strand &) = delete;
+
+private:
+    // Run queued tasks on the pool
+    void runTurn();
+
+public:
+    // Queue a task to run asynchronously
+    void post(Task task);
+
+    // Run a functor on the Strand synchronously - the calling thread is
+    // blocked until it completes.  If the functor throws, the exception is
+    // re-thrown on this thread.  Don't call this from one of the Strand's own
+    // tasks.
+    void syncInvoke(std::function<void()> func);
+
+    const std::string &name() const {return _name;}
+    Stats stats() const;
+
+private:
+    std::string _name;
+    ThreadPool &_pool;
+    mutable std::mutex _mutex;
+    std::condition_variable _idle;
+    std::deque<Item> _items;
+    // Whether a turn is scheduled or running on the pool
+    bool _scheduled;
+    Stats _stats;
+};
+
+}}
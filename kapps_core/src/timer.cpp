@@ -17,7 +17,9 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "timer.h"
+#include "timerwheel.h"
 #include "logger.h"
+#include "wakeups.h"
 #include <unordered_map>
 
 namespace kapps { namespace core {
@@ -43,14 +45,21 @@ void Timer::timerElapsed(EventLoop::TokenT token)
 
     assert(itActiveTimer->second);  // Class invariant
 
-    // If it's a single-shot timer, the timer was already canceled, clear _token
-    if(itActiveTimer->second->_single)
-        itActiveTimer->second->_token = EventLoop::InvalidToken;
-    itActiveTimer->second->elapsed();
+    Timer *pTimer = itActiveTimer->second;
+    WakeupScope wakeup{pTimer->_pTag};
+    // If it's a single-shot timer, the timer was already canceled, clear _token.
+    // The token can be reused as soon as elapsed() sets another timer.
+    if(pTimer->_single)
+    {
+        pTimer->_token = EventLoop::InvalidToken;
+        activeTimerTokens.erase(itActiveTimer);
+    }
+    pTimer->elapsed();
 }
 
 Timer::Timer()
-    : _token{EventLoop::InvalidToken}, _single{false}
+    : _token{EventLoop::InvalidToken}, _single{false},
+      _pTag{"kapps::core::Timer"}
 {
     // If the event loop integration hasn't been set yet, we can't create any
     // timers.  This has to be done in intiailization
@@ -72,6 +81,7 @@ Timer &Timer::operator=(Timer &&other)
 {
     std::swap(_token, other._token);
     std::swap(_single, other._single);
+    std::swap(_pTag, other._pTag);
 
     // Update references in activeTimerTokens
     if(active())
@@ -81,32 +91,24 @@ Timer &Timer::operator=(Timer &&other)
     return *this;
 }
 
-void Timer::set(std::chrono::milliseconds interval, bool single)
+void Timer::set(std::chrono::milliseconds interval, bool single,
+                Precision precision)
 {
     cancel();
     _single = single;
 
-    _token = EventLoop::getThreadEventLoop().setTimer(interval, single);
-
-    // It's possible for the factory to fail, though it should avoid this as
-    // much as possible
-    if(!active())
-    {
-        KAPPS_CORE_WARNING() << "Event loop failed to set timer with interval"
-            << traceMsec(interval) << "and single=" << single;
-
-        // Just eat the error, don't throw.  The caller could check active()
-        // after set() if it really wants to, but often there is nothing more
-        // we can do to gracefully degrade.
-        return;
-    }
+    std::chrono::milliseconds tolerance{0};
+    if(precision == Precision::Coarse)
+        tolerance = interval / 20;
+    _token = EventLoop::getThreadEventLoop().timerWheel().add(interval, single,
+                                                              tolerance);
 
     Timer *&pTokenTimer = activeTimerTokens[_token];
     // This should be a new entry - if it was already set to something, the
-    // timer factory returned a duplicate ID
+    // timer wheel returned a duplicate ID
     if(pTokenTimer)
     {
-        KAPPS_CORE_WARNING() << "Event loop returned duplicate timer token"
+        KAPPS_CORE_WARNING() << "Timer wheel returned duplicate timer token"
             << _token << "for interval" << traceMsec(interval) << "and single="
             << single;
 
@@ -123,7 +125,7 @@ void Timer::cancel()
 {
     if(active())
     {
-        EventLoop::getThreadEventLoop().cancelTimer(_token);
+        EventLoop::getThreadEventLoop().timerWheel().cancel(_token);
         activeTimerTokens.erase(_token);
         _token = EventLoop::InvalidToken;
     }
@@ -29,12 +29,22 @@ namespace kapps { namespace core {
 class KAPPS_CORE_EXPORT Timer
 {
 private:
-    // EventLoop::timerElapsed() can call elapsed()
-    friend class EventLoop;
+    // TimerWheel::eventLoopTimerElapsed() can call elapsed()
+    friend class TimerWheel;
 
-    // Called by EventLoop to indicate that a timer elapsed
+    // Called by TimerWheel to indicate that a timer elapsed
     static void timerElapsed(EventLoop::TokenT token);
 
+public:
+    // Coarse timers may elapse up to 5% of their interval later than
+    // requested, so the TimerWheel can combine them with other timers and wake
+    // up less often.  Use Precise when the timing matters.
+    enum class Precision
+    {
+        Precise,
+        Coarse,
+    };
+
 public:
     // Initially, Timer is inactive.  Set a timer with setTimer().
     // If no TimerFactory is set, Timer objects cannot be created at all, so
@@ -59,25 +69,32 @@ public:
 
     // Set a timer.  If a timer is already active, it's canceled.
     //
-    // While EventLoop::setTimer() should avoid failing as much as possible,
-    // if it does fail, set() simply does not activate (it does not throw).
-    // See the implementation for details.
-    void set(std::chrono::milliseconds interval, bool single);
+    // The timer is added to the thread's TimerWheel, which always succeeds.
+    // (If the TimerWheel can't set its EventLoop timer, it traces a warning.)
+    void set(std::chrono::milliseconds interval, bool single,
+             Precision precision = Precision::Precise);
 
     // Cancel the timer, if active.  No effect if not active.
     void cancel();
 
+    // Set the subsystem tag used to account for this timer's wakeups (see
+    // WakeupAccounting).  The tag must be a string with static storage
+    // duration.  Untagged timers are accounted as "kapps::core::Timer".
+    void tag(const char *pTag) {_pTag = pTag;}
+
 public:
     // Signal triggered when the timer elapses
     Signal<> elapsed;
 
 private:
-    // The current timer token, if active.  EventLoop::InvalidToken indicates
+    // The current TimerWheel token, if active.  EventLoop::InvalidToken indicates
     // the timer is not active.  (Note that 0 may be a valid token.)
     EventLoop::TokenT _token;
     // When active, whether this is a single-shot timer - needed so we know to
     // clear _token automatically when elapsed.
     bool _single;
+    // Wakeup accounting tag
+    const char *_pTag;
 };
 
 }}
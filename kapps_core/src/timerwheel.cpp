@@ -0,0 +1,367 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "timerwheel.h"
+#include "timer.h"
+#include "logger.h"
+#include <algorithm>
+#include <cassert>
+
+namespace kapps { namespace core {
+
+namespace
+{
+    // Find the first set bit in 'bits' at or after 'start', wrapping around.
+    // Returns the distance from 'start'.  'bits' must be nonzero.
+    unsigned firstSetFrom(std::uint64_t bits, unsigned start)
+    {
+        assert(bits);   // Ensured by caller
+        std::uint64_t rotated = start ? (bits >> start) | (bits << (64 - start)) : bits;
+        unsigned distance{0};
+        while(!(rotated & 1))
+        {
+            rotated >>= 1;
+            ++distance;
+        }
+        return distance;
+    }
+}
+
+TimerWheel::TimerWheel(EventLoop &eventLoop)
+    : _eventLoop{eventLoop}, _epoch{std::chrono::steady_clock::now()}, _now{0},
+      _freeHead{NoEntry}, _activeCount{0}, _occupied{},
+      _eventLoopToken{EventLoop::InvalidToken}, _eventLoopDeadline{0}
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+    // The EventLoop owns the TimerWheel, so the EventLoop is being destroyed;
+    // don't try to cancel the EventLoop timer.
+    if(_activeCount)
+    {
+        KAPPS_CORE_WARNING() << "Timer wheel destroyed with" << _activeCount
+            << "active timers";
+    }
+}
+
+auto TimerWheel::nowTick() const -> Tick
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - _epoch).count();
+}
+
+auto TimerWheel::coalesce(Tick deadline, std::chrono::milliseconds tolerance) const
+    -> Tick
+{
+    if(tolerance.count() <= 1)
+        return deadline;
+    Tick align{1};
+    while(align * 2 <= tolerance.count())
+        align *= 2;
+    return (deadline + align - 1) / align * align;
+}
+
+void TimerWheel::link(int token, int list)
+{
+    Entry &entry = _entries[token];
+    List &target = _lists[list];
+    entry.location = list;
+    entry.prev = target.tail;
+    entry.next = NoEntry;
+    if(target.tail != NoEntry)
+        _entries[target.tail].next = token;
+    else
+        target.head = token;
+    target.tail = token;
+    if(list != readyList)
+        _occupied[list / slotCount] |= std::uint64_t{1} << (list % slotCount);
+}
+
+void TimerWheel::unlink(int token)
+{
+    Entry &entry = _entries[token];
+    assert(entry.location != FreeLocation);    // Ensured by caller
+    List &source = _lists[entry.location];
+    if(entry.prev != NoEntry)
+        _entries[entry.prev].next = entry.next;
+    else
+        source.head = entry.next;
+    if(entry.next != NoEntry)
+        _entries[entry.next].prev = entry.prev;
+    else
+        source.tail = entry.prev;
+    if(entry.location != readyList && source.head == NoEntry)
+    {
+        _occupied[entry.location / slotCount] &=
+            ~(std::uint64_t{1} << (entry.location % slotCount));
+    }
+    entry.location = FreeLocation;
+    entry.prev = entry.next = NoEntry;
+}
+
+void TimerWheel::insert(int token)
+{
+    Entry &entry = _entries[token];
+    entry.deadline = std::max(entry.deadline, _now + 1);
+
+    Tick delta = entry.deadline - _now;
+    unsigned level{0};
+    while(level < levelCount - 1 && delta >= (Tick{1} << (slotBits * (level + 1))))
+        ++level;
+    // A deadline beyond the top level's range goes in the top level's last
+    // slot; it's reinserted from there until it's in range.
+    Tick slotTick = std::min(entry.deadline,
+                             _now + (Tick{1} << (slotBits * levelCount)) - 1);
+    auto slot = static_cast<int>((slotTick >> (slotBits * level)) & (slotCount - 1));
+    link(token, static_cast<int>(level * slotCount) + slot);
+}
+
+void TimerWheel::freeEntry(int token)
+{
+    Entry &entry = _entries[token];
+    entry.location = FreeLocation;
+    entry.next = _freeHead;
+    _freeHead = token;
+    --_activeCount;
+}
+
+auto TimerWheel::nextEventTick() const -> Tick
+{
+    Tick next{-1};
+    auto consider = [&next](Tick tick)
+    {
+        if(next < 0 || tick < next)
+            next = tick;
+    };
+
+    // Level 0 slots elapse on their tick
+    if(_occupied[0])
+    {
+        unsigned start = static_cast<unsigned>((_now + 1) & (slotCount - 1));
+        consider(_now + 1 + firstSetFrom(_occupied[0], start));
+    }
+
+    // Higher-level slots are moved down at the start of their block
+    for(unsigned level=1; level<levelCount; ++level)
+    {
+        if(!_occupied[level])
+            continue;
+        Tick nowBlock = _now >> (slotBits * level);
+        unsigned start = static_cast<unsigned>((nowBlock + 1) & (slotCount - 1));
+        Tick blocks = firstSetFrom(_occupied[level], start) + 1;
+        consider((nowBlock + blocks) << (slotBits * level));
+    }
+
+    return next;
+}
+
+auto TimerWheel::earliestDeadline() const -> Tick
+{
+    if(_lists[readyList].head != NoEntry)
+        return _now;
+
+    Tick earliest{-1};
+    // In each level, the first occupied slot has the earliest deadlines
+    for(unsigned level=0; level<levelCount; ++level)
+    {
+        if(!_occupied[level])
+            continue;
+        Tick base = (level == 0) ? _now : (_now >> (slotBits * level));
+        unsigned start = static_cast<unsigned>((base + 1) & (slotCount - 1));
+        unsigned slot = (start + firstSetFrom(_occupied[level], start)) & (slotCount - 1);
+        for(int token = _lists[level * slotCount + slot].head; token != NoEntry;
+            token = _entries[token].next)
+        {
+            if(earliest < 0 || _entries[token].deadline < earliest)
+                earliest = _entries[token].deadline;
+        }
+    }
+    return earliest;
+}
+
+void TimerWheel::advance(Tick target)
+{
+    while(true)
+    {
+        Tick tick = nextEventTick();
+        if(tick < 0 || tick > target)
+            break;
+        _now = tick;
+
+        // Move down any higher-level slots starting at this tick, from the
+        // top level down
+        for(unsigned level=levelCount-1; level>0; --level)
+        {
+            if(tick & ((Tick{1} << (slotBits * level)) - 1))
+                continue;
+            int list = static_cast<int>(level * slotCount) +
+                static_cast<int>((tick >> (slotBits * level)) & (slotCount - 1));
+            while(_lists[list].head != NoEntry)
+            {
+                int token = _lists[list].head;
+                unlink(token);
+                if(_entries[token].deadline <= _now)
+                    link(token, readyList);
+                else
+                    insert(token);
+            }
+        }
+
+        // Everything in this level 0 slot has elapsed
+        int list = static_cast<int>(tick & (slotCount - 1));
+        while(_lists[list].head != NoEntry)
+        {
+            int token = _lists[list].head;
+            unlink(token);
+            link(token, readyList);
+        }
+    }
+
+    _now = std::max(_now, target);
+}
+
+void TimerWheel::scheduleEventLoopTimer()
+{
+    Tick deadline = earliestDeadline();
+    if(deadline < 0)
+    {
+        if(_eventLoopToken != EventLoop::InvalidToken)
+        {
+            _eventLoop.cancelTimer(_eventLoopToken);
+            _eventLoopToken = EventLoop::InvalidToken;
+        }
+        return;
+    }
+
+    // If the EventLoop timer is already due by then, leave it alone; if it's
+    // early, the wheel just reschedules it when it elapses.
+    if(_eventLoopToken != EventLoop::InvalidToken && _eventLoopDeadline <= deadline)
+        return;
+
+    if(_eventLoopToken != EventLoop::InvalidToken)
+        _eventLoop.cancelTimer(_eventLoopToken);
+
+    Tick interval = std::max(Tick{0}, deadline - nowTick());
+    _eventLoopToken = _eventLoop.setTimer(std::chrono::milliseconds{interval}, true);
+    _eventLoopDeadline = deadline;
+    if(_eventLoopToken == EventLoop::InvalidToken)
+    {
+        // There's not much we can do about this - the timers will elapse if
+        // the wheel is rescheduled later by another timer change.
+        KAPPS_CORE_WARNING() << "Event loop failed to set timer with interval"
+            << traceMsec(std::chrono::milliseconds{interval}) << "for"
+            << _activeCount << "timers";
+    }
+}
+
+auto TimerWheel::add(std::chrono::milliseconds interval, bool single,
+                     std::chrono::milliseconds tolerance) -> TokenT
+{
+    int token;
+    if(_freeHead != NoEntry)
+    {
+        token = _freeHead;
+        _freeHead = _entries[token].next;
+    }
+    else
+    {
+        token = static_cast<int>(_entries.size());
+        _entries.push_back({});
+    }
+    ++_activeCount;
+
+    Entry &entry = _entries[token];
+    entry.deadline = coalesce(nowTick() + interval.count(), tolerance);
+    entry.interval = interval;
+    entry.tolerance = tolerance;
+    entry.single = single;
+    entry.location = FreeLocation;
+    insert(token);
+
+    scheduleEventLoopTimer();
+    return token;
+}
+
+void TimerWheel::cancel(TokenT token)
+{
+    if(token < 0 || static_cast<std::size_t>(token) >= _entries.size() ||
+        _entries[token].location == FreeLocation)
+    {
+        KAPPS_CORE_WARNING() << "Tried to cancel timer" << token
+            << "which is not active";
+        return;
+    }
+
+    unlink(token);
+    freeEntry(token);
+
+    // A canceled timer might leave the EventLoop timer early, which is fine,
+    // but don't leave it scheduled when there are no timers at all
+    if(!_activeCount && _eventLoopToken != EventLoop::InvalidToken)
+    {
+        _eventLoop.cancelTimer(_eventLoopToken);
+        _eventLoopToken = EventLoop::InvalidToken;
+    }
+}
+
+void TimerWheel::eventLoopTimerElapsed(TokenT token)
+{
+    if(token != _eventLoopToken)
+    {
+        KAPPS_CORE_WARNING() << "Timer" << token
+            << "was invoked but is not the timer wheel's timer"
+            << _eventLoopToken;
+        return;
+    }
+    // It's single-shot, so the EventLoop has already canceled it
+    _eventLoopToken = EventLoop::InvalidToken;
+
+    advance(nowTick());
+
+    // Reschedule even if a timer throws, so the remaining timers still elapse
+    struct Reschedule
+    {
+        TimerWheel &wheel;
+        ~Reschedule() {wheel.scheduleEventLoopTimer();}
+    } reschedule{*this};
+
+    // Timers may be set or canceled while dispatching, including ready timers
+    // that haven't been dispatched yet
+    while(_lists[readyList].head != NoEntry)
+    {
+        int ready = _lists[readyList].head;
+        unlink(ready);
+        Entry &entry = _entries[ready];
+        if(entry.single)
+            freeEntry(ready);
+        else
+        {
+            // If the timer fell behind, skip the missed intervals
+            entry.deadline += entry.interval.count();
+            if(entry.deadline <= _now)
+                entry.deadline = _now + entry.interval.count();
+            entry.deadline = coalesce(entry.deadline, entry.tolerance);
+            insert(ready);
+        }
+
+        Timer::timerElapsed(ready);
+    }
+}
+
+}}
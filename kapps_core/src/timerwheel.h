@@ -0,0 +1,147 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include "eventloop.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace kapps { namespace core {
+
+// TimerWheel multiplexes all of the kapps::core::Timers on a thread onto a
+// single EventLoop timer.  Each EventLoop owns a TimerWheel, Timer uses it to
+// set and cancel timers.
+//
+// This is a hierarchical timing wheel with a 1 ms tick - level 0 has one slot
+// per tick for the next 64 ms, and each higher level has slots 64 times wider.
+// Timers are moved down to lower levels as their deadline approaches, so
+// setting and canceling a timer is O(1) regardless of how many are active.
+//
+// The EventLoop timer is only scheduled for the earliest deadline, so there is
+// at most one pending platform timer per thread.  Timers with a tolerance are
+// aligned to a coarser grid so they tend to elapse together, which reduces
+// wakeups when many coarse timers are active.
+//
+// Deadlines are measured with std::chrono::steady_clock.
+class KAPPS_CORE_EXPORT TimerWheel
+{
+public:
+    using TokenT = EventLoop::TokenT;
+
+private:
+    using Tick = std::int64_t;
+
+    static constexpr unsigned slotBits = 6;
+    static constexpr unsigned slotCount = 1u << slotBits;
+    static constexpr unsigned levelCount = 6;
+    // The list index used for timers that have elapsed and are waiting to be
+    // dispatched; slot lists are level * slotCount + slot
+    static constexpr int readyList = levelCount * slotCount;
+
+    enum : int
+    {
+        NoEntry = -1,
+        // Entry's location when the entry is not in use
+        FreeLocation = -1,
+    };
+
+    struct Entry
+    {
+        Tick deadline;
+        std::chrono::milliseconds interval;
+        std::chrono::milliseconds tolerance;
+        bool single;
+        // The list containing this entry, or FreeLocation
+        int location;
+        // Links in that list (or the free list, using next)
+        int prev, next;
+    };
+
+    struct List
+    {
+        int head{NoEntry};
+        int tail{NoEntry};
+    };
+
+public:
+    TimerWheel(EventLoop &eventLoop);
+    ~TimerWheel();
+
+private:
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+private:
+    Tick nowTick() const;
+    // Align a deadline to the coarsest power-of-two grid within the tolerance
+    Tick coalesce(Tick deadline, std::chrono::milliseconds tolerance) const;
+
+    void link(int token, int list);
+    void unlink(int token);
+    // Place an entry in the wheel according to its deadline.  The deadline is
+    // always after the current tick, so entries elapse on a later pass.
+    void insert(int token);
+    void freeEntry(int token);
+
+    // Find the next tick that has work to do - a level 0 slot that elapses,
+    // or a higher-level slot that has to be moved down.  Returns -1 if the
+    // wheel is empty.
+    Tick nextEventTick() const;
+    // Earliest deadline of any timer in the wheel, or -1 if there are none
+    Tick earliestDeadline() const;
+    // Process ticks up to 'target', moving elapsed timers to the ready list
+    void advance(Tick target);
+    // Schedule (or cancel) the EventLoop timer for the earliest deadline
+    void scheduleEventLoopTimer();
+
+public:
+    // Add a timer - returns its token.  The timer elapses after 'interval',
+    // which may be delayed by up to 'tolerance' to coalesce it with other
+    // timers.  The token is passed to Timer::timerElapsed() when it elapses.
+    TokenT add(std::chrono::milliseconds interval, bool single,
+               std::chrono::milliseconds tolerance);
+    // Cancel a timer.  It won't elapse after this, even if it was already due.
+    void cancel(TokenT token);
+
+    // Called by EventLoop when the wheel's EventLoop timer elapses
+    void eventLoopTimerElapsed(TokenT token);
+
+    // Number of timers currently active
+    std::size_t activeCount() const {return _activeCount;}
+
+private:
+    EventLoop &_eventLoop;
+    std::chrono::steady_clock::time_point _epoch;
+    // The last tick processed - deadlines at or before this tick have elapsed
+    Tick _now;
+    std::vector<Entry> _entries;
+    int _freeHead;
+    std::size_t _activeCount;
+    // Slot lists for each level, followed by the ready list
+    std::array<List, levelCount * slotCount + 1> _lists;
+    // Bitmap of nonempty slots in each level
+    std::array<std::uint64_t, levelCount> _occupied;
+    // The EventLoop timer, if scheduled, and the tick it was scheduled for
+    TokenT _eventLoopToken;
+    Tick _eventLoopDeadline;
+};
+
+}}
@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "util.h"
+#include "stringslice.h"
 std::string KAPPS_CORE_EXPORT qs::joinVec(const std::vector<std::string> &vec, const std::string &del)
 {
   std::string result;
@@ -36,15 +37,16 @@ void KAPPS_CORE_EXPORT qs::detail::formatImpl(std::stringstream &s, const char *
 
 std::vector<std::string> kapps::core::splitString(const std::string &s, char delimiter)
 {
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream{s};
-
-    while(std::getline(tokenStream, token, delimiter))
-    {
-        tokens.push_back(token);
-    }
+    auto pieces = StringSlice{s}.split(delimiter);
+    // Like std::getline(), a trailing delimiter (or an empty string) does not
+    // produce an empty token at the end
+    if(pieces.back().empty())
+        pieces.pop_back();
 
+    std::vector<std::string> tokens;
+    tokens.reserve(pieces.size());
+    for(const auto &piece : pieces)
+        tokens.push_back(piece.to_string());
     return tokens;
 }
 
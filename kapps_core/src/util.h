@@ -32,6 +32,7 @@
 #include <memory>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 
 #ifdef KAPPS_CORE_OS_WINDOWS
 #include "winapi.h"
@@ -58,19 +59,46 @@ public:
     }
 };
 
-// Add a value to a hash - shuffle the existing hash and incorporate the hash of
-// the new value.  Useful when the fields are dynamic, like an array - for
-// fields known at compile time, hashFields() is more convenient.
+// Multiply two 64-bit values and fold the 128-bit product by XORing its
+// halves.  This is the mixing step used by wyhash - every input bit affects
+// most of the output bits, and it's just one wide multiply on 64-bit targets.
+inline std::uint64_t hashMix(std::uint64_t a, std::uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+#else
+    // Portable 64x64->128 multiply from 32-bit halves
+    std::uint64_t aLow = a & 0xFFFFFFFFu, aHigh = a >> 32;
+    std::uint64_t bLow = b & 0xFFFFFFFFu, bHigh = b >> 32;
+    std::uint64_t lowLow = aLow * bLow, lowHigh = aLow * bHigh;
+    std::uint64_t highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+    std::uint64_t middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFFu) + (highLow & 0xFFFFFFFFu);
+    std::uint64_t low = (middle << 32) | (lowLow & 0xFFFFFFFFu);
+    std::uint64_t high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+    return low ^ high;
+#endif
+}
+
+// Finish a hash value from std::hash (or any other hash) so all of its bits
+// are well distributed.  Many std::hash specializations are the identity
+// function for integers, which leaves the low bits (used to pick a bucket in a
+// power-of-two table) poorly distributed.
+inline std::size_t hashFinish(std::size_t hash)
+{
+    return static_cast<std::size_t>(hashMix(hash ^ 0xa0761d6478bd642full,
+                                            0xe7037ed1a0b428dbull));
+}
+
+// Add a value to a hash - mix the existing hash with the hash of the new
+// value.  Useful when the fields are dynamic, like an array - for fields known
+// at compile time, hashFields() is more convenient.
 template<class T>
 [[nodiscard]] std::size_t hashAccumulate(std::size_t hash, const T &value)
 {
-    // The shuffle constant is derived from the golden ratio - first 64 or 32
-    // bits of the fractional part.
-    static const std::size_t shuffleConstant{ (sizeof(std::size_t) == sizeof(std::uint64_t)) ?
-        static_cast<std::size_t>(0x9e3779b97f4a7c15) :    // 64-bit
-        0x9e3779b9};            // 32-bit
-    hash ^= std::hash<T>{}(value) + shuffleConstant + (hash<<6) + (hash >>2);
-    return hash;
+    // The constants are the wyhash secrets
+    return static_cast<std::size_t>(hashMix(hash ^ 0xa0761d6478bd642full,
+        std::uint64_t{std::hash<T>{}(value)} ^ 0xe7037ed1a0b428dbull));
 }
 
 // Combine hashes from any number of fields - useful to implement std::hash or
@@ -0,0 +1,119 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "wakeups.h"
+#include <map>
+#include <mutex>
+
+#if defined(KAPPS_CORE_OS_POSIX)
+#include <time.h>
+#elif defined(KAPPS_CORE_OS_WINDOWS)
+#include "winapi.h"
+#endif
+
+namespace kapps { namespace core {
+
+namespace
+{
+    std::mutex &totalsMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Ordered so snapshots are sorted by tag; guarded by totalsMutex()
+    std::map<std::string, WakeupAccounting::Totals, std::less<>> &totals()
+    {
+        static std::map<std::string, WakeupAccounting::Totals, std::less<>> map;
+        return map;
+    }
+
+    // The innermost enabled WakeupScope on this thread
+    thread_local WakeupScope *t_pCurrentScope{nullptr};
+}
+
+void WakeupAccounting::record(const std::string &tag,
+                              std::chrono::microseconds cpuTime)
+{
+    std::lock_guard<std::mutex> lock{totalsMutex()};
+    auto itTotals = totals().find(tag);
+    if(itTotals == totals().end())
+        itTotals = totals().emplace(tag, Totals{0, {}}).first;
+    ++itTotals->second.wakeups;
+    itTotals->second.cpuTime += cpuTime;
+}
+
+auto WakeupAccounting::snapshot() -> std::vector<std::pair<std::string, Totals>>
+{
+    std::lock_guard<std::mutex> lock{totalsMutex()};
+    return {totals().begin(), totals().end()};
+}
+
+void WakeupAccounting::reset()
+{
+    std::lock_guard<std::mutex> lock{totalsMutex()};
+    totals().clear();
+}
+
+std::chrono::microseconds WakeupAccounting::threadCpuTime()
+{
+#if defined(KAPPS_CORE_OS_POSIX)
+    timespec time{};
+    if(::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+        return {};
+    return std::chrono::seconds{time.tv_sec} +
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds{time.tv_nsec});
+#elif defined(KAPPS_CORE_OS_WINDOWS)
+    FILETIME creation{}, exit{}, kernel{}, user{};
+    if(!::GetThreadTimes(::GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return {};
+    auto toUnits = [](const FILETIME &time)
+    {
+        return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    // FILETIME durations are in 100ns units
+    return std::chrono::microseconds{(toUnits(kernel) + toUnits(user)) / 10};
+#else
+    return {};
+#endif
+}
+
+WakeupScope::WakeupScope(const char *pTag)
+    : _pTag{pTag}, _start{}, _nestedTime{}, _pOuter{nullptr}
+{
+    if(_pTag)
+    {
+        _pOuter = t_pCurrentScope;
+        t_pCurrentScope = this;
+        _start = WakeupAccounting::threadCpuTime();
+    }
+}
+
+WakeupScope::~WakeupScope()
+{
+    if(!_pTag)
+        return;
+
+    auto used = WakeupAccounting::threadCpuTime() - _start;
+    WakeupAccounting::record(_pTag, used - _nestedTime);
+    t_pCurrentScope = _pOuter;
+    if(_pOuter)
+        _pOuter->_nestedTime += used;
+}
+
+}}
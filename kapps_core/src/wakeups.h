@@ -0,0 +1,93 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kapps { namespace core {
+
+// Wakeup accounting records which subsystem woke a thread, and how much CPU
+// time it used before going back to sleep.  This is used to track down idle
+// power regressions - the totals are reported by the daemon's
+// getWakeupAccounting RPC.
+//
+// Wakeups are tagged with a subsystem name.  kapps::core::Timer and PollThread
+// record their wakeups automatically (see Timer::tag() and PollThread's
+// constructor), and the daemon records Qt timer and socket notifier events
+// (see common/src/wakeupaccounting.h).  Other code can record a wakeup with
+// WakeupScope.
+//
+// The totals are process-wide and thread-safe.
+class KAPPS_CORE_EXPORT WakeupAccounting
+{
+public:
+    struct Totals
+    {
+        std::uint64_t wakeups;
+        std::chrono::microseconds cpuTime;
+    };
+
+public:
+    // Record one wakeup for a tag and the CPU time it used
+    static void record(const std::string &tag, std::chrono::microseconds cpuTime);
+
+    // Get the totals for all tags that have recorded a wakeup, ordered by tag
+    static std::vector<std::pair<std::string, Totals>> snapshot();
+
+    // Clear all totals
+    static void reset();
+
+    // The CPU time used by the calling thread so far
+    static std::chrono::microseconds threadCpuTime();
+};
+
+// WakeupScope records a wakeup for a tag when destroyed, with the CPU time
+// used by this thread during its lifetime (like TraceStopwatch, but for CPU
+// time, and recorded rather than traced).  Time this thread spends blocked is
+// not CPU time, so a scope can wrap a blocking wait too.
+//
+// Scopes can nest (a PollThread wakeup that fires a Timer, etc.).  Each scope
+// records its own wakeup, but CPU time used by a nested scope is only counted
+// for the nested scope, so the totals add up to the CPU time actually used.
+class KAPPS_CORE_EXPORT WakeupScope
+{
+public:
+    // The tag isn't copied until the scope is destroyed, it must outlive the
+    // scope.  It can be nullptr to create a disabled scope.
+    explicit WakeupScope(const char *pTag);
+    ~WakeupScope();
+
+private:
+    WakeupScope(const WakeupScope &) = delete;
+    WakeupScope &operator=(const WakeupScope &) = delete;
+
+private:
+    const char *_pTag;
+    std::chrono::microseconds _start;
+    // CPU time used by nested scopes
+    std::chrono::microseconds _nestedTime;
+    // The enclosing scope on this thread, if any
+    WakeupScope *_pOuter;
+};
+
+}}
@@ -36,6 +36,13 @@ typedef struct KANFirewallConfig
 KAPPS_NET_EXPORT void KANConfigureFirewall(const struct KANFirewallConfig *pConfig);
 KAPPS_NET_EXPORT void KANApplyFirewallRules();
 
+// Stage several firewall changes and apply them once.  Between
+// KANBeginFirewallUpdate() and KANCommitFirewallUpdate(), requests to apply
+// rules are deferred; the commit applies rules once if any were requested.
+// Updates can be nested - only the outermost commit applies.
+KAPPS_NET_EXPORT void KANBeginFirewallUpdate();
+KAPPS_NET_EXPORT void KANCommitFirewallUpdate();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,261 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace kapps { namespace net {
+
+// Hash table holding at most maxSize entries.  When full, inserting a new key
+// evicts the least-recently used entry (inserting, or accessing with at(),
+// counts as a use).
+//
+// All storage is allocated up front - entries are kept in a fixed node array
+// linked into an intrusive LRU list, and indexed by an open-addressed table
+// (linear probing, at most half full).  Evicted nodes are reused, so inserting
+// and evicting never allocate (aside from whatever the key/value types do on
+// assignment).
+template <typename KeyType_T, typename ValueType_T>
+class ConstrainedHash
+{
+public:
+    using KeyType = KeyType_T;
+    using ValueType = ValueType_T;
+
+private:
+    using Index = std::uint32_t;
+    enum : Index {None = std::numeric_limits<Index>::max()};
+
+    struct Node
+    {
+        KeyType_T key;
+        ValueType_T value;
+        std::size_t hash;
+        Index prev; // Towards the most-recently used node
+        Index next; // Towards the least-recently used node
+    };
+
+public:
+    ConstrainedHash(size_t maxSize)
+    : _maxSize{maxSize}
+    {
+        assert(_maxSize > 0 && _maxSize < None);
+        _nodes.reserve(_maxSize);
+
+        std::size_t slotCount{1};
+        while(slotCount < _maxSize * 2)
+            slotCount *= 2;
+        _slots.resize(slotCount, None);
+    }
+
+public:
+    // Insert a key, or replace its value if it is already present.  Either
+    // way, it becomes the most-recently used entry.
+    void insert(const std::pair<KeyType_T, ValueType_T> &pair)
+    {
+        std::size_t hash = std::hash<KeyType_T>{}(pair.first);
+        std::size_t slot = findSlot(pair.first, hash);
+        if(_slots[slot] != None)
+        {
+            Index existing = _slots[slot];
+            _nodes[existing].value = pair.second;
+            touch(existing);
+            return;
+        }
+
+        Index node;
+        if(_nodes.size() >= _maxSize)
+        {
+            // Evict the least-recently used entry and reuse its node
+            node = _tail;
+            eraseSlot(findSlot(_nodes[node].key, _nodes[node].hash));
+            unlink(node);
+            _nodes[node].key = pair.first;
+            _nodes[node].value = pair.second;
+            _nodes[node].hash = hash;
+            // Erasing may have shifted entries, find the free slot again
+            slot = findSlot(pair.first, hash);
+        }
+        else
+        {
+            node = static_cast<Index>(_nodes.size());
+            _nodes.push_back({pair.first, pair.second, hash, None, None});
+        }
+
+        _slots[slot] = node;
+        pushFront(node);
+    }
+
+    bool contains(const KeyType_T &key) const
+    {
+        return _slots[findSlot(key, std::hash<KeyType_T>{}(key))] != None;
+    }
+
+    // Get the value for a key, which becomes the most-recently used entry.
+    // Throws std::out_of_range if the key isn't present.
+    ValueType_T &at(const KeyType_T &key)
+    {
+        Index node = _slots[findSlot(key, std::hash<KeyType_T>{}(key))];
+        if(node == None)
+            throw std::out_of_range{"key is not in ConstrainedHash"};
+        touch(node);
+        return _nodes[node].value;
+    }
+
+    // Get the value for a key if it's present (making it the most-recently
+    // used entry), or nullptr if it isn't.
+    ValueType_T *find(const KeyType_T &key)
+    {
+        Index node = _slots[findSlot(key, std::hash<KeyType_T>{}(key))];
+        if(node == None)
+            return nullptr;
+        touch(node);
+        return &_nodes[node].value;
+    }
+
+    // Remove a key if it's present.  Returns true if it was removed.
+    bool erase(const KeyType_T &key)
+    {
+        std::size_t slot = findSlot(key, std::hash<KeyType_T>{}(key));
+        Index node = _slots[slot];
+        if(node == None)
+            return false;
+        eraseSlot(slot);
+        unlink(node);
+
+        // Keep the node array dense - move the last node into the hole
+        Index last = static_cast<Index>(_nodes.size() - 1);
+        if(node != last)
+        {
+            _slots[findSlot(_nodes[last].key, _nodes[last].hash)] = node;
+            Index prev = _nodes[last].prev;
+            Index next = _nodes[last].next;
+            _nodes[node] = std::move(_nodes[last]);
+            if(prev != None)
+                _nodes[prev].next = node;
+            else
+                _head = node;
+            if(next != None)
+                _nodes[next].prev = node;
+            else
+                _tail = node;
+        }
+        _nodes.pop_back();
+        return true;
+    }
+
+    // Remove all entries (the storage remains allocated)
+    void clear()
+    {
+        _nodes.clear();
+        std::fill(_slots.begin(), _slots.end(), None);
+        _head = _tail = None;
+    }
+
+    size_t size() const { return _nodes.size(); }
+
+private:
+    std::size_t slotMask() const {return _slots.size() - 1;}
+
+    // Find the slot containing key, or the empty slot where it would be
+    // inserted
+    std::size_t findSlot(const KeyType_T &key, std::size_t hash) const
+    {
+        std::size_t slot = hash & slotMask();
+        while(_slots[slot] != None &&
+              !(_nodes[_slots[slot]].hash == hash && _nodes[_slots[slot]].key == key))
+        {
+            slot = (slot + 1) & slotMask();
+        }
+        return slot;
+    }
+
+    // Empty a slot, shifting back any following entries in the same probe
+    // run so lookups don't need tombstones
+    void eraseSlot(std::size_t slot)
+    {
+        std::size_t next = slot;
+        while(true)
+        {
+            next = (next + 1) & slotMask();
+            if(_slots[next] == None)
+                break;
+            // An entry can move back to 'slot' only if its ideal slot is not
+            // cyclically in (slot, next]
+            std::size_t ideal = _nodes[_slots[next]].hash & slotMask();
+            bool idealInRange = slot <= next ? (slot < ideal && ideal <= next)
+                                             : (slot < ideal || ideal <= next);
+            if(!idealInRange)
+            {
+                _slots[slot] = _slots[next];
+                slot = next;
+            }
+        }
+        _slots[slot] = None;
+    }
+
+    void unlink(Index node)
+    {
+        Node &n = _nodes[node];
+        if(n.prev != None)
+            _nodes[n.prev].next = n.next;
+        else
+            _head = n.next;
+        if(n.next != None)
+            _nodes[n.next].prev = n.prev;
+        else
+            _tail = n.prev;
+        n.prev = n.next = None;
+    }
+
+    void pushFront(Index node)
+    {
+        _nodes[node].prev = None;
+        _nodes[node].next = _head;
+        if(_head != None)
+            _nodes[_head].prev = node;
+        _head = node;
+        if(_tail == None)
+            _tail = node;
+    }
+
+    void touch(Index node)
+    {
+        if(node != _head)
+        {
+            unlink(node);
+            pushFront(node);
+        }
+    }
+
+private:
+    size_t _maxSize;
+    std::vector<Node> _nodes;
+    std::vector<Index> _slots;
+    Index _head{None};  // Most-recently used
+    Index _tail{None};  // Least-recently used
+};
+
+}}
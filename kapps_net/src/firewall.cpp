@@ -18,6 +18,11 @@
 
 #include "firewall.h"
 #include <kapps_core/src/logger.h>
+#include <atomic>
+
+#if defined(KAPPS_CORE_OS_POSIX)
+#include <kapps_core/src/coreprocess.h>
+#endif
 
 #if defined(KAPPS_CORE_OS_WINDOWS)
 #include "win/win_firewall.h"
@@ -30,6 +35,55 @@
 
 namespace kapps { namespace net {
 
+namespace
+{
+    std::atomic<unsigned> operationCount{0};
+    std::atomic<unsigned> ruleCount{0};
+
+    std::uint64_t processCount()
+    {
+#if defined(KAPPS_CORE_OS_POSIX)
+        return core::Process::spawnLatency().count();
+#else
+        return 0;
+#endif
+    }
+}
+
+FirewallApplyStats &FirewallApplyStats::operator+=(const FirewallApplyStats &other)
+{
+    applies += other.applies;
+    duration += other.duration;
+    operations += other.operations;
+    processes += other.processes;
+    rules += other.rules;
+    return *this;
+}
+
+bool FirewallApplyStats::operator==(const FirewallApplyStats &other) const
+{
+    return applies == other.applies && duration == other.duration &&
+        operations == other.operations && processes == other.processes &&
+        rules == other.rules;
+}
+
+void FirewallApplyStats::trace(std::ostream &os) const
+{
+    os << "applies: " << applies << ", duration: " << duration.count()
+        << " us, operations: " << operations << ", processes: " << processes
+        << ", rules: " << rules;
+}
+
+void FirewallCounters::countOperation()
+{
+    operationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FirewallCounters::countRules(unsigned count)
+{
+    ruleCount.fetch_add(count, std::memory_order_relaxed);
+}
+
 Firewall::Firewall(FirewallConfig config)
 {
 #if defined(KAPPS_CORE_FAMILY_DESKTOP)
@@ -51,9 +105,63 @@ Firewall::Firewall(FirewallConfig config)
 }
 
 void Firewall::applyRules(const FirewallParams &params)
+{
+    if(updating())
+    {
+        _stagedParams = params;
+        return;
+    }
+    applyRulesNow(params);
+}
+
+void Firewall::beginUpdate()
+{
+    ++_updateDepth;
+}
+
+void Firewall::commitUpdate()
+{
+    if(!updating())
+    {
+        KAPPS_CORE_WARNING() << "Firewall update committed without beginUpdate() - ignored";
+        return;
+    }
+
+    --_updateDepth;
+    if(!updating() && _stagedParams)
+    {
+        // Clear _stagedParams before applying in case applyRulesNow() throws
+        FirewallParams params{std::move(*_stagedParams)};
+        _stagedParams.reset();
+        applyRulesNow(params);
+    }
+}
+
+void Firewall::applyRulesNow(const FirewallParams &params)
 {
     assert(_pPlatformFirewall); // Class invariant
+
+    unsigned startOperations = operationCount.load(std::memory_order_relaxed);
+    unsigned startRules = ruleCount.load(std::memory_order_relaxed);
+    std::uint64_t startProcesses = processCount();
+    auto startTime = std::chrono::steady_clock::now();
+
     _pPlatformFirewall->applyRules(params);
+
+    FirewallApplyStats stats;
+    stats.applies = 1;
+    stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime);
+    stats.processes = static_cast<unsigned>(processCount() - startProcesses);
+    stats.rules = ruleCount.load(std::memory_order_relaxed) - startRules;
+    stats.operations = operationCount.load(std::memory_order_relaxed) - startOperations;
+#if defined(KAPPS_CORE_OS_POSIX)
+    // Each firewall command is a process on macOS/Linux
+    stats.operations = stats.processes;
+#endif
+    _lastApplyStats = stats;
+    _totalApplyStats += stats;
+    KAPPS_CORE_INFO() << "Applied firewall rules -" << stats;
 }
 
 #if defined(KAPPS_CORE_OS_MACOS)
@@ -23,7 +23,9 @@
 #include "firewallconfig.h"
 #include "firewallparams.h"
 #include <kapps_core/src/logger.h>
+#include <chrono>
 #include <functional>
+#include <optional>
 
 // ************
 // * Firewall *
@@ -85,6 +87,38 @@
 // state.
 namespace kapps { namespace net {
 
+// Cost of applying firewall rules with Firewall::applyRules(), for diagnostics.
+// This describes either one apply or the sum of several (see 'applies').
+struct KAPPS_NET_EXPORT FirewallApplyStats : public core::OStreamInsertable<FirewallApplyStats>
+{
+    // Number of applies included - 1 for a single apply
+    unsigned applies{0};
+    // Total time spent in applyRules()
+    std::chrono::microseconds duration{0};
+    // Firewall operations issued - WFP objects added or removed on Windows,
+    // pfctl/iptables commands on macOS/Linux (each is a process there)
+    unsigned operations{0};
+    // Child processes created (none on Windows)
+    unsigned processes{0};
+    // Rules installed - WFP filters on Windows, iptables rules on Linux, and
+    // pf rule sets loaded into anchors on macOS
+    unsigned rules{0};
+
+    FirewallApplyStats &operator+=(const FirewallApplyStats &other);
+    bool operator==(const FirewallApplyStats &other) const;
+    bool operator!=(const FirewallApplyStats &other) const {return !(*this == other);}
+    void trace(std::ostream &os) const;
+};
+
+// The platform backends report operations and rules here as they issue them;
+// Firewall::applyRules() attributes them to the apply in progress.  Only one
+// Firewall exists at a time, so these are process-wide.
+namespace FirewallCounters
+{
+    void KAPPS_NET_EXPORT countOperation();
+    void KAPPS_NET_EXPORT countRules(unsigned count);
+}
+
 class KAPPS_NET_EXPORT PlatformFirewall
 {
 public:
@@ -112,8 +146,23 @@ public:
     Firewall(FirewallConfig config);
 
 public:
+    // Apply rules for the desired firewall state.  If an update is open (see
+    // beginUpdate()), the params are just staged.
     void applyRules(const FirewallParams &params);
 
+    // Stage several changes and apply them once.  Between beginUpdate() and
+    // commitUpdate(), applyRules() only stores the params given;
+    // commitUpdate() then applies the most recent params, if any were given.
+    // Updates can be nested - only the outermost commitUpdate() applies.
+    void beginUpdate();
+    void commitUpdate();
+    bool updating() const {return _updateDepth > 0;}
+
+    // Measurements of the last applyRules() call, and the sum of all calls
+    // so far
+    const FirewallApplyStats &lastApplyStats() const {return _lastApplyStats;}
+    const FirewallApplyStats &totalApplyStats() const {return _totalApplyStats;}
+
 #if defined(KAPPS_CORE_OS_MACOS)
     // On macOS only, this API should be called just before attempting to
     // connect to the VPN.  This is used when split tunnel is active to cycle
@@ -133,8 +182,17 @@ public:
     void aboutToConnectToVpn();
 #endif
 
+private:
+    void applyRulesNow(const FirewallParams &params);
+
 protected:
     std::unique_ptr<PlatformFirewall> _pPlatformFirewall;
+    // Nesting depth of beginUpdate() calls, and the params staged by
+    // applyRules() during the update
+    unsigned _updateDepth{0};
+    std::optional<FirewallParams> _stagedParams;
+    FirewallApplyStats _lastApplyStats;
+    FirewallApplyStats _totalApplyStats;
 };
 
 }}
@@ -31,7 +31,46 @@ void KANConfigureFirewall(const KANFirewallConfig *pConfig)
 //    kapps::net::Firewall::instance().configure({pConfig->pAboutToApplyRules, pConfig->pDidApplyRules});
 }
 
+namespace
+{
+    // Nesting depth of KANBeginFirewallUpdate(), and whether an apply was
+    // requested during the update
+    unsigned updateDepth{0};
+    bool applyPending{false};
+
+    void applyFirewallRules()
+    {
+        KAPPS_CORE_INFO() << "KANApplyFirewallRules called (dummy API)";
+    }
+}
+
 void KANApplyFirewallRules()
 {
-    KAPPS_CORE_INFO() << "KANApplyFirewallRules called (dummy API)";
+    if(updateDepth)
+    {
+        applyPending = true;
+        return;
+    }
+    applyFirewallRules();
+}
+
+void KANBeginFirewallUpdate()
+{
+    ++updateDepth;
+}
+
+void KANCommitFirewallUpdate()
+{
+    if(!updateDepth)
+    {
+        KAPPS_CORE_WARNING() << "KANCommitFirewallUpdate called without KANBeginFirewallUpdate - ignored";
+        return;
+    }
+
+    --updateDepth;
+    if(!updateDepth && applyPending)
+    {
+        applyPending = false;
+        applyFirewallRules();
+    }
 }
@@ -24,6 +24,7 @@
 #include <set>
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 #if defined(KAPPS_CORE_OS_WINDOWS)
 #include "win/appidkey.h"
@@ -151,6 +152,59 @@ struct KAPPS_NET_EXPORT FirewallParams
     // are saved in the same folder as pia-daemon 
     bool transparentProxyLogEnabled;
 #endif
+
+    // Compare all parameters - used to skip applying parameters that are
+    // identical to the last ones applied.
+    bool operator==(const FirewallParams &other) const
+    {
+#if defined(KAPPS_CORE_OS_WINDOWS)
+        // The app IDs are compared by value, not by pointer
+        auto appIdsEqual = [](const AppIdSet &first, const AppIdSet &second)
+        {
+            return std::equal(first.begin(), first.end(), second.begin(), second.end(),
+                [](const auto &pFirst, const auto &pSecond){return *pFirst == *pSecond;});
+        };
+#else
+        auto appIdsEqual = [](const std::vector<std::string> &first,
+                              const std::vector<std::string> &second)
+        {
+            return first == second;
+        };
+#endif
+        return tunnelDeviceName == other.tunnelDeviceName &&
+            tunnelDeviceLocalAddress == other.tunnelDeviceLocalAddress &&
+            tunnelDeviceRemoteAddress == other.tunnelDeviceRemoteAddress &&
+            routedPacketsOnVPN == other.routedPacketsOnVPN &&
+            leakProtectionEnabled == other.leakProtectionEnabled &&
+            blockAll == other.blockAll &&
+            allowVPN == other.allowVPN &&
+            allowDHCP == other.allowDHCP &&
+            blockIPv6 == other.blockIPv6 &&
+            allowLAN == other.allowLAN &&
+            blockDNS == other.blockDNS &&
+            allowPIA == other.allowPIA &&
+            allowLoopback == other.allowLoopback &&
+            allowResolver == other.allowResolver &&
+            isConnected == other.isConnected &&
+            hasConnected == other.hasConnected &&
+            bypassDefaultApps == other.bypassDefaultApps &&
+            setDefaultRoute == other.setDefaultRoute &&
+            enableSplitTunnel == other.enableSplitTunnel &&
+            netScan == other.netScan &&
+            splitTunnelDnsEnabled == other.splitTunnelDnsEnabled &&
+            mtu == other.mtu &&
+            effectiveDnsServers == other.effectiveDnsServers &&
+            appIdsEqual(excludeApps, other.excludeApps) &&
+            appIdsEqual(vpnOnlyApps, other.vpnOnlyApps) &&
+            bypassIpv4Subnets == other.bypassIpv4Subnets &&
+            bypassIpv6Subnets == other.bypassIpv6Subnets &&
+            macosPrimaryServiceKey == other.macosPrimaryServiceKey &&
+#if defined(KAPPS_CORE_OS_MACOS)
+            transparentProxyLogEnabled == other.transparentProxyLogEnabled &&
+#endif
+            existingDNSServers == other.existingDNSServers;
+    }
+    bool operator!=(const FirewallParams &other) const {return !(*this == other);}
 };
 
 }}
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <unordered_map>
 #include "../originalnetworkscan.h"
+#include "../firewall.h"
 #include <kapps_core/src/util.h>
 #include <kapps_core/src/ipaddress.h>
 
@@ -77,6 +78,16 @@ bool AnchorInfo::operator==(const AnchorInfo& rhs) const
 // applies the _last_ match in the absence of 'quick'.)
 using AnchorMap = std::map<std::string, AnchorInfo, std::greater<std::string>>;
 
+// Last state applied to an anchor.  Each field is null if that part of the
+// anchor's state is not known (not installed yet, or a command failed).
+struct AnchorState
+{
+    kapps::core::nullable_t<bool> enabled;
+    kapps::core::nullable_t<std::vector<std::string>> rules;
+};
+
+using AnchorStateMap = std::unordered_map<std::string, AnchorState>;
+
 namespace
 {
     using IPVersion = IpTablesFirewall::IPVersion;
@@ -116,8 +127,86 @@ namespace
 
     // Used to indicate no anchor found
     const AnchorInfo AnchorNotFound{};
+
+    // Delimiter for the here-document used to feed iptables-restore; this
+    // can't appear on a line by itself in any transaction.
+    const std::string kRestoreDelimiter{"KAPPS_IPT_RESTORE"};
 }
 
+// Transaction for one table and IP version, applied with a single invocation of
+// iptables-restore (or ip6tables-restore).
+//
+// The transaction is applied with --noflush, so chains that aren't mentioned
+// are not affected.  Declaring a chain (":chain - [0:0]") creates it, or flushes
+// it if it already exists - this is the restore equivalent of
+// "iptables -N chain || iptables -F chain".  iptables-restore commits the whole
+// table at once, so the kernel never sees a partially-applied transaction.
+//
+// If iptables-restore fails (it might not support -w on very old versions, or
+// any one rule might be rejected), nothing in the transaction is applied, and
+// the caller falls back to applying the same changes with individual iptables
+// commands.
+class RestoreTransaction
+{
+public:
+    RestoreTransaction(IPVersion ip, const std::string &tableName)
+        : _ip{ip}, _tableName{tableName}
+    {
+        assert(ip != IPVersion::Both);  // Each IP version is a separate transaction
+    }
+
+public:
+    // Create or flush a chain.  All declarations are rendered before any rule,
+    // so rules can jump to chains declared later.
+    void declareChain(const std::string &chain)
+    {
+        _declarations.push_back(qs::format(":% - [0:0]", chain));
+    }
+
+    // Append a rule to a chain
+    void appendRule(const std::string &chain, const std::string &rule)
+    {
+        _commands.push_back(qs::format("-A % %", chain, rule));
+        ++_ruleCount;
+    }
+
+    // Delete a chain - it must be empty and unreferenced at this point in the
+    // transaction, so it's normally declared (flushed) earlier in the same
+    // transaction.
+    void deleteChain(const std::string &chain)
+    {
+        _commands.push_back(qs::format("-X %", chain));
+    }
+
+    // Apply the transaction.  Returns true if it was applied, or false if
+    // iptables-restore failed (in which case nothing was applied).
+    bool commit() const
+    {
+        std::string script{"*" + _tableName + "\n"};
+        for(const auto &line : _declarations)
+            script += line + "\n";
+        for(const auto &line : _commands)
+            script += line + "\n";
+        script += "COMMIT\n";
+
+        // Exec doesn't provide stdin, so feed the transaction with a quoted
+        // here-document (no expansion occurs in the body).
+        const std::string cmd = getCommand(_ip) + "-restore -w --noflush <<'" +
+            kRestoreDelimiter + "'\n" + script + kRestoreDelimiter + "\n";
+        if(kapps::core::Exec::bash(cmd) != 0)
+            return false;
+        kapps::net::FirewallCounters::countRules(_ruleCount);
+        return true;
+    }
+
+private:
+    IPVersion _ip;
+    std::string _tableName;
+    std::vector<std::string> _declarations;
+    std::vector<std::string> _commands;
+    unsigned _ruleCount{0};
+};
+
 class IptInterface
 {
 public:
@@ -228,6 +317,7 @@ public:
         const std::string cmd = getCommand(ip);
         for(const std::string& rule : anchorInfo.rules)
             kapps::core::Exec::bash(qs::format("% -w -A % % -t %", cmd, anchorInfo.ruleChain, rule, _tableName));
+        kapps::net::FirewallCounters::countRules(static_cast<unsigned>(anchorInfo.rules.size()));
     }
 
     void uninstallAnchor(IPVersion ip, const AnchorInfo &anchorInfo)
@@ -247,35 +337,37 @@ public:
         deleteChain(ip, anchorInfo.oldChain);
     }
 
-    void enableAnchor(IPVersion ip, const AnchorInfo &anchorInfo)
+    // Returns true if the anchor was enabled (or was already enabled)
+    bool enableAnchor(IPVersion ip, const AnchorInfo &anchorInfo)
     {
         if(ip == IPVersion::Both)
         {
-            enableAnchor(IPVersion::IPv4, anchorInfo);
-            enableAnchor(IPVersion::IPv6, anchorInfo);
-            return;
+            bool enabled4 = enableAnchor(IPVersion::IPv4, anchorInfo);
+            bool enabled6 = enableAnchor(IPVersion::IPv6, anchorInfo);
+            return enabled4 && enabled6;
         }
 
         const std::string cmd = getCommand(ip);
         const std::string anchorIpStr = anchorNameWithIp(ip, anchorInfo.anchorName);
 
-        kapps::core::Exec::bash(qs::format("if % -w -C % -j % -t % 2> /dev/null ; then echo '%: ON' ; else echo '%: OFF -> ON' ; % -w -A % -j % -t %; fi",
+        return 0 == kapps::core::Exec::bash(qs::format("if % -w -C % -j % -t % 2> /dev/null ; then echo '%: ON' ; else echo '%: OFF -> ON' ; % -w -A % -j % -t %; fi",
             cmd, anchorInfo.anchorChain, anchorInfo.actualChain, _tableName, anchorIpStr, anchorIpStr, cmd, anchorInfo.anchorChain, anchorInfo.actualChain, _tableName));
     }
 
-    void disableAnchor(IPVersion ip, const AnchorInfo &anchorInfo)
+    // Returns true if the anchor was disabled (or was already disabled)
+    bool disableAnchor(IPVersion ip, const AnchorInfo &anchorInfo)
     {
         if(ip == IPVersion::Both)
         {
-            disableAnchor(IPVersion::IPv4, anchorInfo);
-            disableAnchor(IPVersion::IPv6, anchorInfo);
-            return;
+            bool disabled4 = disableAnchor(IPVersion::IPv4, anchorInfo);
+            bool disabled6 = disableAnchor(IPVersion::IPv6, anchorInfo);
+            return disabled4 && disabled6;
         }
 
         const std::string cmd = getCommand(ip);
         const std::string anchorIpStr = anchorNameWithIp(ip, anchorInfo.anchorName);
 
-        kapps::core::Exec::bash(qs::format("if ! % -w -C % -j % -t % 2> /dev/null ; then echo '%: OFF' ; else echo '%: ON -> OFF' ; % -w -F % -t %; fi",
+        return 0 == kapps::core::Exec::bash(qs::format("if ! % -w -C % -j % -t % 2> /dev/null ; then echo '%: OFF' ; else echo '%: ON -> OFF' ; % -w -F % -t %; fi",
             cmd, anchorInfo.anchorChain, anchorInfo.actualChain, _tableName, anchorIpStr, anchorIpStr, cmd, anchorInfo.anchorChain, _tableName));
     }
 
@@ -305,6 +397,7 @@ public:
         {
             kapps::core::Exec::bash(qs::format("% -w -A % % -t %", cmd, anchorInfo.ruleChain, rule, _tableName));
         }
+        kapps::net::FirewallCounters::countRules(static_cast<unsigned>(newRules.size()));
         // Pivot the actual chain to the new rule chain.  The actual chain should always have
         // exactly 1 rule (the anchor to the rule chain).
         kapps::core::Exec::bash(qs::format("% -w -R % 1 -j % -t %", cmd, anchorInfo.actualChain, anchorInfo.ruleChain, _tableName));
@@ -313,6 +406,48 @@ public:
         deleteChain(ip, anchorInfo.oldChain);
     }
 
+    // Transactional equivalents of installAnchor(), uninstallAnchor() and
+    // replaceAnchor().  These only add to the transaction; the caller commits
+    // it.
+    //
+    // Installing an anchor in a transaction appends the anchor chain to its
+    // root chain unconditionally; the root chain must be declared (flushed)
+    // in the same transaction.
+    void installAnchor(RestoreTransaction &transaction, const AnchorInfo &anchorInfo)
+    {
+        transaction.declareChain(anchorInfo.anchorChain);
+        transaction.appendRule(anchorInfo.rootChain, qs::format("-j %", anchorInfo.anchorChain));
+        // The actual chain is left empty (disabled), as in installAnchor()
+        transaction.declareChain(anchorInfo.actualChain);
+        transaction.declareChain(anchorInfo.ruleChain);
+        transaction.appendRule(anchorInfo.actualChain, qs::format("-j %", anchorInfo.ruleChain));
+        for(const std::string &rule : anchorInfo.rules)
+            transaction.appendRule(anchorInfo.ruleChain, rule);
+    }
+
+    // Declaring each chain before deleting it ensures that it exists and
+    // is empty, so the deletion can't fail and abort the transaction.  The
+    // root chain must also be declared in this transaction (and unlinked from
+    // its built-in chain beforehand).
+    void uninstallAnchor(RestoreTransaction &transaction, const AnchorInfo &anchorInfo)
+    {
+        for(const auto &chain : {anchorInfo.anchorChain, anchorInfo.actualChain,
+                                 anchorInfo.ruleChain, anchorInfo.oldChain})
+        {
+            transaction.declareChain(chain);
+            transaction.deleteChain(chain);
+        }
+    }
+
+    // The rule chain is flushed and repopulated in one commit, so the pivot
+    // through the old-rule chain isn't needed.
+    void replaceAnchor(RestoreTransaction &transaction, const AnchorInfo &anchorInfo, const std::vector<std::string> &newRules)
+    {
+        transaction.declareChain(anchorInfo.ruleChain);
+        for(const auto &rule : newRules)
+            transaction.appendRule(anchorInfo.ruleChain, rule);
+    }
+
 private:
     std::string _tableName;
     std::string _anchorBase;
@@ -353,6 +488,12 @@ private:
 //    constructed.  The replacement occurs by atomically replacing the
 //    content->rule jump to the new chain, then the old-rule chain is cleaned
 //    up.
+//
+// Installing, uninstalling, and replacing anchors are normally applied with
+// one iptables-restore transaction per IP version (see RestoreTransaction).
+// A restore commit is atomic on its own, so a replacement just rewrites the
+// rule chain, and the old-rule chain is only used when falling back to
+// individual iptables commands.
 template <TableEnum tableType>
 class Table
 {
@@ -445,53 +586,90 @@ private:
     }
 
 private:
-    void installRootChains()
+    const AnchorMap &anchorMapFor(IPVersion ip) const
+    {
+        return ip == IPVersion::IPv4 ? _anchorMap4 : _anchorMap6;
+    }
+
+    AnchorStateMap &anchorStateFor(IPVersion ip)
+    {
+        return ip == IPVersion::IPv4 ? _anchorState4 : _anchorState6;
+    }
+
+    // Record the state of every anchor right after installing them - all
+    // anchors are disabled and have their initial rules.
+    void resetAnchorState(IPVersion ip)
+    {
+        auto &anchorState{anchorStateFor(ip)};
+        anchorState.clear();
+        for(const auto &pair : anchorMapFor(ip))
+            anchorState[pair.first] = {false, pair.second.rules};
+    }
+
+    void linkRootChains()
     {
         for(auto rootChain : _rootChains)
-        {
-            _iptInterface.createChain(IPVersion::Both, rootChainNameFor(rootChain));
             _iptInterface.linkChain(IPVersion::Both, rootChainNameFor(rootChain), kChainMap.at(rootChain), true);
-        }
     }
 
-    void uninstallRootChains()
+    void unlinkRootChains()
     {
         for(auto rootChain : _rootChains)
-        {
             _iptInterface.unlinkChain(IPVersion::Both, rootChainNameFor(rootChain), kChainMap.at(rootChain));
-            _iptInterface.deleteChain(IPVersion::Both, rootChainNameFor(rootChain));
-        }
     }
 
-    void installAnchors()
+    // Create the root chains and all anchors for one IP version.  The root
+    // chains aren't linked yet, so nothing takes effect until linkRootChains().
+    void installAnchors(IPVersion ip)
     {
-        for(const auto &pair : _anchorMap4)
-        {
-            // Poor man's structured bindings
-            const auto &anchorInfo{pair.second};
-            _iptInterface.installAnchor(IPVersion::IPv4, anchorInfo);
-        }
+        RestoreTransaction transaction{ip, _tableName};
+        for(auto rootChain : _rootChains)
+            transaction.declareChain(rootChainNameFor(rootChain));
+        // The anchor map order is the priority order, so appending anchors to
+        // the root chains in this order places them correctly
+        for(const auto &pair : anchorMapFor(ip))
+            _iptInterface.installAnchor(transaction, pair.second);
 
-        for(const auto &pair : _anchorMap6)
+        if(transaction.commit())
+            return;
+
+        KAPPS_CORE_WARNING() << "Unable to install" << _tableName
+            << (ip == IPVersion::IPv6 ? "(IPv6)" : "(IPv4)")
+            << "anchors with a transaction, using individual commands";
+        for(auto rootChain : _rootChains)
+            _iptInterface.createChain(ip, rootChainNameFor(rootChain));
+        for(const auto &pair : anchorMapFor(ip))
         {
+            // Poor man's structured bindings
             const auto &anchorInfo{pair.second};
-            _iptInterface.installAnchor(IPVersion::IPv6, anchorInfo);
+            _iptInterface.installAnchor(ip, anchorInfo);
         }
     }
 
-    void uninstallAnchors()
+    // Delete the root chains and all anchors for one IP version.  The root
+    // chains must already be unlinked.
+    void uninstallAnchors(IPVersion ip)
     {
-        for(const auto &pair : _anchorMap4)
-        {
-            // Poor man's structured bindings
-            const auto &anchorInfo{pair.second};
-            _iptInterface.uninstallAnchor(IPVersion::IPv4, anchorInfo);
-        }
+        RestoreTransaction transaction{ip, _tableName};
+        for(auto rootChain : _rootChains)
+            transaction.declareChain(rootChainNameFor(rootChain));
+        for(const auto &pair : anchorMapFor(ip))
+            _iptInterface.uninstallAnchor(transaction, pair.second);
+        for(auto rootChain : _rootChains)
+            transaction.deleteChain(rootChainNameFor(rootChain));
 
-        for(const auto &pair : _anchorMap6)
+        if(transaction.commit())
+            return;
+
+        KAPPS_CORE_WARNING() << "Unable to uninstall" << _tableName
+            << (ip == IPVersion::IPv6 ? "(IPv6)" : "(IPv4)")
+            << "anchors with a transaction, using individual commands";
+        for(auto rootChain : _rootChains)
+            _iptInterface.deleteChain(ip, rootChainNameFor(rootChain));
+        for(const auto &pair : anchorMapFor(ip))
         {
             const auto &anchorInfo{pair.second};
-            _iptInterface.uninstallAnchor(IPVersion::IPv6, anchorInfo);
+            _iptInterface.uninstallAnchor(ip, anchorInfo);
         }
     }
 
@@ -509,18 +687,25 @@ public:
 
     void install()
     {
-        KAPPS_CORE_INFO() << "Installing root chains for" << _tableName;
-        installRootChains();
         KAPPS_CORE_INFO() << "Installing anchors for" << _tableName;
-        installAnchors();
+        installAnchors(IPVersion::IPv4);
+        installAnchors(IPVersion::IPv6);
+        resetAnchorState(IPVersion::IPv4);
+        resetAnchorState(IPVersion::IPv6);
+        // Link the root chains last, so the anchors take effect all at once
+        KAPPS_CORE_INFO() << "Installing root chains for" << _tableName;
+        linkRootChains();
     }
 
     void uninstall()
     {
         KAPPS_CORE_INFO() << "Uninstalling root chains for" << _tableName;
-        uninstallRootChains();
+        unlinkRootChains();
         KAPPS_CORE_INFO() << "Uninstalling anchors for" << _tableName;
-        uninstallAnchors();
+        uninstallAnchors(IPVersion::IPv4);
+        uninstallAnchors(IPVersion::IPv6);
+        _anchorState4.clear();
+        _anchorState6.clear();
     }
 
     void showAllAnchors(IPVersion ip)
@@ -534,6 +719,13 @@ public:
 
     void setAnchorEnabled(IPVersion ip, const std::string &anchorName, bool enabled)
     {
+        if(ip == IPVersion::Both)
+        {
+            setAnchorEnabled(IPVersion::IPv4, anchorName, enabled);
+            setAnchorEnabled(IPVersion::IPv6, anchorName, enabled);
+            return;
+        }
+
         const auto &anchorInfo{getAnchorInfo(ip, anchorName)};
         if(anchorInfo == AnchorNotFound)
         {
@@ -543,14 +735,30 @@ public:
             return;
         }
 
-        if(enabled)
-            _iptInterface.enableAnchor(ip, anchorInfo);
+        // Nothing to do if the anchor is known to be in this state already
+        auto &state{anchorStateFor(ip)[anchorName]};
+        if(state.enabled && *state.enabled == enabled)
+            return;
+
+        bool applied = enabled ? _iptInterface.enableAnchor(ip, anchorInfo)
+                               : _iptInterface.disableAnchor(ip, anchorInfo);
+        // If the command failed, the actual state isn't known - the next
+        // update tries again.
+        if(applied)
+            state.enabled = enabled;
         else
-            _iptInterface.disableAnchor(ip, anchorInfo);
+            state.enabled.clear();
     }
 
     void replaceAnchor(IPVersion ip, const std::string &anchorName, const std::vector<std::string> &newRules)
     {
+        if(ip == IPVersion::Both)
+        {
+            replaceAnchor(IPVersion::IPv4, anchorName, newRules);
+            replaceAnchor(IPVersion::IPv6, anchorName, newRules);
+            return;
+        }
+
         const auto& anchorInfo{getAnchorInfo(ip, anchorName)};
         if(anchorInfo == AnchorNotFound)
         {
@@ -560,16 +768,31 @@ public:
             return;
         }
 
+        // Nothing to do if the anchor already has these rules
+        auto &state{anchorStateFor(ip)[anchorName]};
+        if(state.rules && *state.rules == newRules)
+            return;
+
+        RestoreTransaction transaction{ip, _tableName};
+        _iptInterface.replaceAnchor(transaction, anchorInfo, newRules);
+        if(transaction.commit())
+        {
+            state.rules = newRules;
+            return;
+        }
+
+        KAPPS_CORE_WARNING() << "Unable to replace" << _iptInterface.anchorNameWithIp(ip, anchorName)
+            << "with a transaction, using individual commands";
         _iptInterface.replaceAnchor(ip, anchorInfo, newRules);
+        // The individual commands don't report failure, so the rules actually
+        // in place aren't known; apply them again next time.
+        state.rules.clear();
     }
 
 
     void ensureRootAnchorPriority()
     {
-        for(auto rootChain : _rootChains)
-        {
-            _iptInterface.linkChain(IPVersion::Both, rootChainNameFor(rootChain), kChainMap.at(rootChain), true);
-        }
+        linkRootChains();
     }
 
 private:
@@ -577,6 +800,11 @@ private:
     std::string _tableName;
     AnchorMap _anchorMap4;
     AnchorMap _anchorMap6;
+    // Model of the anchors' current state in the kernel, so updates that
+    // don't change anything are skipped.  Anchors are absent when their state
+    // is not known (not installed, or a command failed).
+    AnchorStateMap _anchorState4;
+    AnchorStateMap _anchorState6;
     std::set<ChainEnum> _rootChains;
     IptInterface _iptInterface;
 };
@@ -878,6 +1106,13 @@ void IpTablesFirewall::Impl::install()
     // Clean up any existing rules if they exist.
     uninstall();
 
+    // Trace which iptables backend is in use.  Most current distributions
+    // ship the nf_tables shim, which translates each restore transaction into
+    // a single atomic nftables batch; the legacy backend commits each table
+    // separately.
+    KAPPS_CORE_INFO() << "iptables version:"
+        << kapps::core::Exec::bashWithOutput("iptables -V", true);
+
     _filterTable.install();
     _natTable.install();
     _mangleTable.install();
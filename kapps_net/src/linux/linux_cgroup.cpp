@@ -21,6 +21,7 @@
 #include "linux_fwmark.h"
 #include "linux_routing.h"
 #include "linux_proc_fs.h"
+#include "linux_proc_table.h"
 #include <kapps_core/src/posix/posix_objects.h>
 #include <kapps_core/src/newexec.h>
 #include <kapps_core/src/fs.h>
@@ -180,6 +181,16 @@ namespace CGroup
         else
         {
             KAPPS_CORE_WARNING() << "Failed to create" << netClsDir;
+            // On hosts that only mount the unified (v2) hierarchy, the v1
+            // net_cls controller usually can't be mounted at all (it may be
+            // compiled out, or systemd may have disabled v1 controllers).
+            // Trace this specifically, it's the most common cause.
+            if(core::fs::exists("/sys/fs/cgroup/cgroup.controllers"))
+            {
+                KAPPS_CORE_WARNING() << "This system uses the unified cgroup v2"
+                    << "hierarchy; split tunnel requires the cgroup v1 net_cls"
+                    << "controller, which is not available";
+            }
             return false;
         }
     }
@@ -198,6 +209,26 @@ namespace CGroup
         // Remove child processes (NOTE: we also recurse through child processes of child processes)
         removeChildPidsFromCgroup(pid, cGroupPath);
     }
+
+    void addPidToCgroup(pid_t pid, const std::string &cGroupPath, const ProcessTable &processes)
+    {
+        writePidToCGroup(pid, cGroupPath);
+        for(pid_t childPid : processes.childPidsOf(pid))
+        {
+            KAPPS_CORE_INFO() << "Adding child pid" << childPid;
+            addPidToCgroup(childPid, cGroupPath, processes);
+        }
+    }
+
+    void removePidFromCgroup(pid_t pid, const std::string &cGroupPath, const ProcessTable &processes)
+    {
+        writePidToCGroup(pid, cGroupPath);
+        for(pid_t childPid : processes.childPidsOf(pid))
+        {
+            KAPPS_CORE_INFO() << "Removing child pid" << childPid << cGroupPath;
+            removePidFromCgroup(childPid, cGroupPath, processes);
+        }
+    }
 }
 
 }}
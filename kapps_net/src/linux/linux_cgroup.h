@@ -28,6 +28,8 @@
 
 namespace kapps { namespace net {
 
+class ProcessTable;
+
 class KAPPS_NET_EXPORT CGroupIds
 {
 public:
@@ -80,6 +82,10 @@ namespace CGroup
     bool KAPPS_NET_EXPORT createNetCls(const std::string &netClsDir, const std::string &mountsFile="/proc/mounts");
     void KAPPS_NET_EXPORT addPidToCgroup(pid_t pid, const std::string &cGroupPath);
     void KAPPS_NET_EXPORT removePidFromCgroup(pid_t pid, const std::string &cGroupPath);
+    // Same as above, but child processes are found in a ProcessTable instead
+    // of scanning /proc
+    void KAPPS_NET_EXPORT addPidToCgroup(pid_t pid, const std::string &cGroupPath, const ProcessTable &processes);
+    void KAPPS_NET_EXPORT removePidFromCgroup(pid_t pid, const std::string &cGroupPath, const ProcessTable &processes);
 };
 
 }}
@@ -27,6 +27,9 @@
 #include <sys/types.h>
 #include <kapps_core/src/newexec.h>
 #include <unistd.h>
+#include <errno.h>
+#include <unordered_map>
+#include <vector>
 
 namespace kapps { namespace net {
 
@@ -55,6 +58,60 @@ namespace
             proc_event event;
         };
     } NetlinkResponse;
+
+    // Maximum number of events read in one batch - limits the time spent in
+    // one activation; the notifier activates again if more events remain.
+    const std::size_t maxEventBatch{1024};
+
+    // Receive buffer size requested for the socket - the default is easily
+    // overrun by process churn, and overflow loses events.
+    const int socketReceiveBuffer{4*1024*1024};
+
+    // Dispatch a batch of events to cnProc's signals
+    void dispatchEvents(CnProc &cnProc, const std::vector<proc_event> &events)
+    {
+        // Find the last exec/exit for each process in this batch; an exec() that
+        // is followed by another exec() or exit() of the same process is
+        // superseded.
+        std::unordered_map<pid_t, std::size_t> lastExecExit;
+        for(std::size_t i=0; i<events.size(); ++i)
+        {
+            const auto &event = events[i];
+            if(event.what == proc_event::PROC_EVENT_EXEC)
+                lastExecExit[event.event_data.exec.process_pid] = i;
+            else if(event.what == proc_event::PROC_EVENT_EXIT)
+                lastExecExit[event.event_data.exit.process_pid] = i;
+        }
+
+        for(std::size_t i=0; i<events.size(); ++i)
+        {
+            // shortcut
+            const auto &eventData = events[i].event_data;
+
+            switch(events[i].what)
+            {
+            case proc_event::PROC_EVENT_NONE:
+                KAPPS_CORE_INFO() << "Listening to process events";
+                cnProc.connected();
+                break;
+            case proc_event::PROC_EVENT_FORK:
+                // New threads are also reported as forks; ignore them
+                if(eventData.fork.child_pid == eventData.fork.child_tgid)
+                    cnProc.fork(eventData.fork.parent_tgid, eventData.fork.child_pid);
+                break;
+            case proc_event::PROC_EVENT_EXEC:
+                if(lastExecExit[eventData.exec.process_pid] == i)
+                    cnProc.exec(eventData.exec.process_pid);
+                break;
+            case proc_event::PROC_EVENT_EXIT:
+                cnProc.exit(eventData.exit.process_pid);
+                break;
+            default:
+                // We're not interested in any other events
+                break;
+            }
+        }
+    }
 }
 
 CnProc::CnProc()
@@ -71,6 +128,17 @@ CnProc::CnProc()
         return;
     }
 
+    // SO_RCVBUFFORCE can exceed rmem_max (we're root); fall back to SO_RCVBUF
+    // otherwise (capped at rmem_max)
+    if(::setsockopt(_cnSock.get(), SOL_SOCKET, SO_RCVBUFFORCE, &socketReceiveBuffer,
+                    sizeof(socketReceiveBuffer)) < 0 &&
+       ::setsockopt(_cnSock.get(), SOL_SOCKET, SO_RCVBUF, &socketReceiveBuffer,
+                    sizeof(socketReceiveBuffer)) < 0)
+    {
+        KAPPS_CORE_WARNING() << "Failed to set Netlink socket receive buffer -"
+            << core::ErrnoTracer{};
+    }
+
     _cnSockNotifier.activated = [this](){readFromSocket();};
     _cnSockNotifier.set(_cnSock.get(), core::PosixFdNotifier::WatchType::Read);
 
@@ -158,42 +226,48 @@ bool CnProc::subscribeToProcEvents(bool enabled)
 
 void CnProc::readFromSocket()
 {
-    NetlinkResponse message = {};
-
-    int received = ::recv(_cnSock.get(), &message, sizeof(message), 0);
+    std::vector<proc_event> events;
+    bool overflow{false};
 
-    if(received < 0)
+    // Drain the socket (up to one batch) before handling any events
+    while(events.size() < maxEventBatch)
     {
-        KAPPS_CORE_WARNING() << "Failed receiving from socket -" << kapps::core::ErrnoTracer{};
-        return;
-    }
+        NetlinkResponse message = {};
 
-    if(received != sizeof(message))
-    {
-        KAPPS_CORE_WARNING() << "Received" << received
-            << "bytes for Netlink message, expected" << sizeof(message);
-        return;
+        int received = ::recv(_cnSock.get(), &message, sizeof(message), MSG_DONTWAIT);
+
+        if(received < 0)
+        {
+            if(errno == ENOBUFS)
+            {
+                // Events were dropped, but the socket is still usable - keep
+                // reading what is left
+                overflow = true;
+                continue;
+            }
+            if(errno != EAGAIN && errno != EWOULDBLOCK)
+                KAPPS_CORE_WARNING() << "Failed receiving from socket -" << kapps::core::ErrnoTracer{};
+            break;
+        }
+
+        if(received != sizeof(message))
+        {
+            KAPPS_CORE_WARNING() << "Received" << received
+                << "bytes for Netlink message, expected" << sizeof(message);
+            continue;
+        }
+
+        events.push_back(message.event);
     }
 
-    // shortcut
-    const auto &eventData = message.event.event_data;
+    dispatchEvents(*this, events);
 
-    switch(message.event.what)
+    if(overflow)
     {
-    case proc_event::PROC_EVENT_NONE:
-        KAPPS_CORE_INFO() << "Listening to process events";
-        connected();
-        break;
-    case proc_event::PROC_EVENT_EXEC:
-        exec(eventData.exec.process_pid);
-        break;
-    case proc_event::PROC_EVENT_EXIT:
-        exit(eventData.exit.process_pid);
-        break;
-    default:
-        // We're not interested in any other events
-        break;
+        KAPPS_CORE_WARNING() << "Netlink socket overflowed, process events were lost";
+        overflowed();
     }
 }
 
+
 }}
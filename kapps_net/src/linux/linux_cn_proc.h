@@ -35,6 +35,12 @@ namespace kapps { namespace net {
 // Linux kernel, most x86_64 kernels seem to include cn_proc, but many ARM
 // kernels seem to omit it.  (These kernels often include NETLINK_CONNECTOR as a
 // module, so the socket will connect but we won't actually receive any events.)
+//
+// Events are drained from the socket in batches, and an exec() is skipped if
+// a later event in the same batch supersedes it (another exec() or an exit()
+// of the same process).  During heavy process churn (parallel builds, etc.)
+// this avoids inspecting processes that are already gone, which helps keep up
+// with the event rate.
 class KAPPS_NET_EXPORT CnProc
 {
 public:
@@ -55,12 +61,21 @@ public:
     // not generate any events.
     core::Signal<> connected;
 
+    // A process fork() has occurred - parent PID, child PID.  This is only
+    // emitted for new processes, not new threads.
+    core::Signal<pid_t, pid_t> fork;
+
     // A process exec() has occurred
     core::Signal<pid_t> exec;
 
     // A process exit has occurred
     core::Signal<pid_t> exit;
 
+    // The socket's receive buffer overflowed, so events were lost.  This is
+    // emitted after the events that were received have been handled; the
+    // receiver should resynchronize any state tracked from the events.
+    core::Signal<> overflowed;
+
 private:
     core::PosixFd _cnSock;
     core::PosixFdNotifier _cnSockNotifier;
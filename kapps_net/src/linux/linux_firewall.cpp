@@ -20,6 +20,8 @@
 #include "linux_fwmark.h"
 #include "linux_routing.h"
 #include "rt_tables_initializer.h"
+#include "linux_nlroute.h"
+#include "../subnetaggregation.h"
 #include <kapps_core/src/newexec.h>
 #include <kapps_core/src/ipaddress.h>
 #include "proc_tracker.h"
@@ -55,6 +57,9 @@ LinuxFirewall::LinuxFirewall(FirewallConfig config)
         {etcRoutingLocation, {shareRoutingLocation, libRoutingLocation}}
     };
     rtTablesInitializer.install();
+    // Use the resolved IDs directly for netlink route changes, even if
+    // rt_tables couldn't be updated
+    NlRouteBatch::cacheTableIds(rtTablesInitializer.tableIds());
 
     _pFilter->install();
 }
@@ -140,7 +145,7 @@ void LinuxFirewall::startSplitTunnel(const FirewallParams &params)
     // Create a worker thread to pump the netlink socket  We don't use any work
     // items (we use syncInvoke() to update firewall params), so the handler is
     // empty.
-    _pSplitTunnelWorker.emplace([](core::Any){});
+    _pSplitTunnelWorker.emplace([](core::Any){}, "splittunnel");
 
     // Create the split tunnel tracker on the worker thread.
     _pSplitTunnelWorker->syncInvoke([&]
@@ -446,33 +451,45 @@ bool LinuxFirewall::updateVpnTunOnlyAnchor(bool hasConnected, std::string tunnel
 void LinuxFirewall::updateForwardedRoutes(const FirewallParams &params, bool shouldBypassVpn)
 {
     const auto &netScan = params.netScan;
+    std::vector<std::string> routeCommands;
 
     // If routed traffic is configured to bypass, create the default gateway
     // route in this table all the time, which ensures that it isn't briefly
     // routed into the VPN while the connection is coming up.
     if(shouldBypassVpn)
-        kapps::core::Exec::bash(qs::format("ip route replace default via % dev % table %", netScan.gatewayIp(), netScan.interfaceName(), _pFilter->routing().forwardedTable()));
+        routeCommands.push_back(qs::format("ip route replace default via % dev % table %", netScan.gatewayIp(), netScan.interfaceName(), _pFilter->routing().forwardedTable()));
     // Otherwise, create the VPN route for this traffic once connected.  This
     // doesn't need to be active while disconnected - the "use VPN" mode of
     // routed traffic intentionally permits traffic when disconnected, setting
     // KS=Always blocks it correctly with the blackhole route if desired.
     else if(params.hasConnected)
-        kapps::core::Exec::bash(qs::format("ip route replace default dev % table %", params.tunnelDeviceName, _pFilter->routing().forwardedTable()));
+        routeCommands.push_back(qs::format("ip route replace default dev % table %", params.tunnelDeviceName, _pFilter->routing().forwardedTable()));
     // Routed = Use VPN, and not connected
     else
-        kapps::core::Exec::bash(qs::format("ip route delete default table %", _pFilter->routing().forwardedTable()));
+        routeCommands.push_back(qs::format("ip route delete default table %", _pFilter->routing().forwardedTable()));
 
     // Add blackhole fall-back route to block all forwarded traffic if killswitch is on (and disconnected)
     if(params.leakProtectionEnabled)
-        kapps::core::Exec::bash(qs::format("ip route replace blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
+        routeCommands.push_back(qs::format("ip route replace blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
     else
-        kapps::core::Exec::bash(qs::format("ip route delete blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
+        routeCommands.push_back(qs::format("ip route delete blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
 
     // Blackhole IPv6 for forwarded connections too, for IPv6 leak protection and killswitch
     if(params.blockIPv6)
-        kapps::core::Exec::bash(qs::format("ip -6 route replace blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
+        routeCommands.push_back(qs::format("ip -6 route replace blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
     else
-        kapps::core::Exec::bash(qs::format("ip -6 route delete blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
+        routeCommands.push_back(qs::format("ip -6 route delete blackhole default metric 32000 table %", _pFilter->routing().forwardedTable()));
+
+    // The routes only depend on these inputs; skip them if nothing changed
+    // since they were last applied.  (A change in the gateway or interface,
+    // such as when the network goes down and comes back, changes the commands,
+    // so routes removed by the kernel are restored.)
+    if(routeCommands == _forwardedRouteCommands)
+        return;
+
+    for(const auto &command : routeCommands)
+        kapps::core::Exec::bash(command);
+    _forwardedRouteCommands = std::move(routeCommands);
 }
 
 
@@ -546,8 +563,13 @@ void LinuxFirewall::disableRouteLocalNet()
     _routeLocalNet = "";
 }
 
-void LinuxFirewall::updateBypassSubnets(IPVersion ipVersion, const std::set<std::string> &bypassSubnets, std::set<std::string> &oldBypassSubnets)
+void LinuxFirewall::updateBypassSubnets(IPVersion ipVersion, const std::set<std::string> &requestedSubnets, std::set<std::string> &oldBypassSubnets)
 {
+    // Write one rule per aggregated subnet rather than per configured subnet
+    std::set<std::string> bypassSubnets = (ipVersion == IPVersion::IPv6) ?
+        aggregateIpv6Subnets(requestedSubnets) :
+        aggregateIpv4Subnets(requestedSubnets);
+
     if(bypassSubnets != oldBypassSubnets)
     {
         if(bypassSubnets.empty())
@@ -603,7 +625,7 @@ void LinuxFirewall::updateBypassSubnets(IPVersion ipVersion, const std::set<std:
             _pFilter->replaceAnchor(TableEnum::Mangle, ipVersion, "200.tagFwdSubnets", subnetMarkRules);
         }
     }
-    oldBypassSubnets = bypassSubnets;
+    oldBypassSubnets = std::move(bypassSubnets);
 }
 
 std::string SplitDNSInfo::existingDNS(const std::vector<uint32_t> &existingDNSServers)
@@ -30,6 +30,13 @@
 
 namespace kapps { namespace net {
 
+// Describes how DNS from one class of split tunnel apps is forced to a
+// particular DNS server.  Split tunnel DNS is implemented entirely with
+// SNAT/DNAT rules matching the app's net_cls cgroup; no resolver process is
+// involved.  Apps are moved between fixed cgroups as the app lists change, so
+// these rules (and any resolver in use) only change when the DNS server,
+// source address, or cgroup behavior changes - not when apps are added or
+// removed.
 class SplitDNSInfo
 {
 public:
@@ -94,7 +101,7 @@ private:
     void disableRouteLocalNet();
     bool updateVpnTunOnlyAnchor(bool hasConnected, std::string tunnelDeviceName, std::string tunnelDeviceLocalAddress);
     void updateForwardedRoutes(const FirewallParams &params, bool shouldBypassVpn);
-    void updateBypassSubnets(IpTablesFirewall::IPVersion ipVersion, const std::set<std::string> &bypassSubnets, std::set<std::string> &oldBypassSubnets);
+    void updateBypassSubnets(IpTablesFirewall::IPVersion ipVersion, const std::set<std::string> &requestedSubnets, std::set<std::string> &oldBypassSubnets);
 
 protected:
     virtual void startSplitTunnel(const FirewallParams& params) override;
@@ -111,6 +118,8 @@ private:
     std::string _routeLocalNet;
     std::set<std::string> _bypassIpv4Subnets;
     std::set<std::string> _bypassIpv6Subnets;
+    // Last commands used to apply the forwarded packet routes
+    std::vector<std::string> _forwardedRouteCommands;
     core::nullable_t<CGroupIds> _pCgroup;
     SplitDNSInfo _routedDnsInfo;    // Last behavior applied for routed packet DNS
     SplitDNSInfo _appDnsInfo;   // Last behavior applied for app DNS (either bypass or VPN only)
@@ -0,0 +1,331 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "linux_nlroute.h"
+#include <kapps_core/src/logger.h>
+#include <kapps_core/src/posix/posix_objects.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/fib_rules.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+namespace kapps { namespace net {
+
+namespace
+{
+    const std::string kRtTablesPath{"/etc/iproute2/rt_tables"};
+
+    // Limit on waiting for acknowledgements - the kernel handles these
+    // messages synchronously, this just ensures we can't block indefinitely.
+    const int kAckTimeoutSec{2};
+
+    // Routing table IDs by name - cached by NlRouteBatch::cacheTableIds(), or
+    // the first time a name is found in rt_tables.  Batches can be built on
+    // more than one thread, so this is guarded by a mutex.
+    std::mutex tableIdsMutex;
+    std::map<std::string, std::uint32_t> tableIds;
+
+    // Resolve a routing table name (or number) to its ID.  Returns 0 (which is
+    // RT_TABLE_UNSPEC) if the table is not known.
+    std::uint32_t resolveTable(const std::string &table)
+    {
+        if(!table.empty() && std::all_of(table.begin(), table.end(), ::isdigit))
+            return static_cast<std::uint32_t>(std::stoul(table));
+
+        std::lock_guard<std::mutex> lock{tableIdsMutex};
+        auto itCached = tableIds.find(table);
+        if(itCached != tableIds.end())
+            return itCached->second;
+
+        // Entries look like "100  piavpnrt"; comments and blank lines don't
+        // parse as a number.  Cache everything found while we're reading it.
+        std::ifstream rtTables{kRtTablesPath};
+        std::string line;
+        while(std::getline(rtTables, line))
+        {
+            std::istringstream lineStream{line};
+            std::uint32_t id{};
+            std::string name;
+            if(lineStream >> id >> name)
+                tableIds.emplace(std::move(name), id);
+        }
+
+        itCached = tableIds.find(table);
+        return itCached != tableIds.end() ? itCached->second : 0;
+    }
+
+    int familyValue(NlRouteBatch::Family family)
+    {
+        return family == NlRouteBatch::Family::IPv6 ? AF_INET6 : AF_INET;
+    }
+
+    // Parse an IP address into buffer; returns the address length or 0 if
+    // it's not valid for the family.
+    std::size_t parseAddress(int family, const std::string &address, unsigned char (&buffer)[16])
+    {
+        if(::inet_pton(family, address.c_str(), buffer) != 1)
+            return 0;
+        return family == AF_INET6 ? 16 : 4;
+    }
+
+    // Begin a message with the netlink header and fixed-size payload.  The
+    // length and sequence number are filled in by NlRouteBatch::apply().
+    template<class Payload>
+    std::vector<unsigned char> beginMessage(std::uint16_t type, std::uint16_t flags, const Payload &payload)
+    {
+        std::vector<unsigned char> message(NLMSG_SPACE(sizeof(Payload)));
+        nlmsghdr header{};
+        header.nlmsg_type = type;
+        header.nlmsg_flags = NLM_F_REQUEST|NLM_F_ACK|flags;
+        std::memcpy(message.data(), &header, sizeof(header));
+        std::memcpy(message.data() + NLMSG_LENGTH(0), &payload, sizeof(payload));
+        return message;
+    }
+
+    void appendAttr(std::vector<unsigned char> &message, std::uint16_t type, const void *pData, std::size_t len)
+    {
+        rtattr attr{};
+        attr.rta_type = type;
+        attr.rta_len = RTA_LENGTH(len);
+        std::size_t offset = message.size();
+        message.resize(offset + RTA_SPACE(len));
+        std::memcpy(message.data() + offset, &attr, sizeof(attr));
+        std::memcpy(message.data() + offset + RTA_LENGTH(0), pData, len);
+    }
+
+    void appendU32(std::vector<unsigned char> &message, std::uint16_t type, std::uint32_t value)
+    {
+        appendAttr(message, type, &value, sizeof(value));
+    }
+}
+
+void NlRouteBatch::cacheTableIds(const std::map<std::string, std::uint32_t> &ids)
+{
+    std::lock_guard<std::mutex> lock{tableIdsMutex};
+    for(const auto &tableId : ids)
+        tableIds[tableId.first] = tableId.second;
+}
+
+void NlRouteBatch::replaceDefaultRoute(Family family, const std::string &gatewayIp,
+                                       const std::string &interfaceName,
+                                       const std::string &table)
+{
+    std::string description = gatewayIp.empty() ?
+        qs::format("route replace default dev % table %", interfaceName, table) :
+        qs::format("route replace default via % dev % table %", gatewayIp, interfaceName, table);
+    addRoute(family, gatewayIp, interfaceName, 0, false, table, std::move(description));
+}
+
+void NlRouteBatch::replaceBlackholeDefaultRoute(Family family, std::uint32_t metric,
+                                                const std::string &table)
+{
+    addRoute(family, {}, {}, metric, true, table,
+        qs::format("route replace blackhole default metric % table %", metric, table));
+}
+
+void NlRouteBatch::addSourceRule(const std::string &sourceIp, const std::string &table,
+                                 std::uint32_t priority)
+{
+    addRule(true, sourceIp, table, priority,
+        qs::format("rule add from % lookup % pri %", sourceIp, table, priority));
+}
+
+void NlRouteBatch::deleteSourceRule(const std::string &sourceIp, const std::string &table,
+                                    std::uint32_t priority)
+{
+    addRule(false, sourceIp, table, priority,
+        qs::format("rule del from % lookup % pri %", sourceIp, table, priority));
+}
+
+void NlRouteBatch::addRoute(Family family, const std::string &gatewayIp,
+                            const std::string &interfaceName, std::uint32_t metric,
+                            bool blackhole, const std::string &table, std::string description)
+{
+    std::uint32_t tableId = resolveTable(table);
+    if(!tableId)
+    {
+        KAPPS_CORE_WARNING() << "Can't apply" << description << "- unknown routing table";
+        return;
+    }
+
+    rtmsg route{};
+    route.rtm_family = static_cast<unsigned char>(familyValue(family));
+    route.rtm_dst_len = 0;  // default route
+    route.rtm_table = tableId < 256 ? tableId : RT_TABLE_UNSPEC;
+    route.rtm_protocol = RTPROT_BOOT;
+    // A unicast route with no gateway is a link-scope route, like "ip" does
+    route.rtm_scope = (blackhole || !gatewayIp.empty()) ? RT_SCOPE_UNIVERSE : RT_SCOPE_LINK;
+    route.rtm_type = blackhole ? RTN_BLACKHOLE : RTN_UNICAST;
+
+    auto message = beginMessage(RTM_NEWROUTE, NLM_F_CREATE|NLM_F_REPLACE, route);
+    appendU32(message, RTA_TABLE, tableId);
+    if(!gatewayIp.empty())
+    {
+        unsigned char address[16]{};
+        std::size_t addressLen = parseAddress(route.rtm_family, gatewayIp, address);
+        if(!addressLen)
+        {
+            KAPPS_CORE_WARNING() << "Can't apply" << description << "- invalid gateway address";
+            return;
+        }
+        appendAttr(message, RTA_GATEWAY, address, addressLen);
+    }
+    if(!interfaceName.empty())
+    {
+        unsigned interfaceIndex = ::if_nametoindex(interfaceName.c_str());
+        if(!interfaceIndex)
+        {
+            KAPPS_CORE_WARNING() << "Can't apply" << description << "- interface not found -"
+                << core::ErrnoTracer{};
+            return;
+        }
+        appendU32(message, RTA_OIF, interfaceIndex);
+    }
+    if(metric)
+        appendU32(message, RTA_PRIORITY, metric);
+
+    _changes.push_back({std::move(description), std::move(message)});
+}
+
+void NlRouteBatch::addRule(bool add, const std::string &sourceIp, const std::string &table,
+                           std::uint32_t priority, std::string description)
+{
+    std::uint32_t tableId = resolveTable(table);
+    if(!tableId)
+    {
+        KAPPS_CORE_WARNING() << "Can't apply" << description << "- unknown routing table";
+        return;
+    }
+
+    unsigned char address[16]{};
+    int family = AF_INET;
+    std::size_t addressLen = parseAddress(family, sourceIp, address);
+    if(!addressLen)
+    {
+        family = AF_INET6;
+        addressLen = parseAddress(family, sourceIp, address);
+    }
+    if(!addressLen)
+    {
+        KAPPS_CORE_WARNING() << "Can't apply" << description << "- invalid source address";
+        return;
+    }
+
+    fib_rule_hdr rule{};
+    rule.family = static_cast<unsigned char>(family);
+    rule.src_len = static_cast<unsigned char>(addressLen * 8);
+    rule.table = tableId < 256 ? tableId : RT_TABLE_UNSPEC;
+    rule.action = FR_ACT_TO_TBL;
+
+    // "ip rule add" uses NLM_F_EXCL, so an identical rule isn't duplicated
+    auto message = add ? beginMessage(RTM_NEWRULE, NLM_F_CREATE|NLM_F_EXCL, rule)
+                       : beginMessage(RTM_DELRULE, 0, rule);
+    appendU32(message, FRA_TABLE, tableId);
+    appendU32(message, FRA_PRIORITY, priority);
+    appendAttr(message, FRA_SRC, address, addressLen);
+
+    _changes.push_back({std::move(description), std::move(message)});
+}
+
+bool NlRouteBatch::apply()
+{
+    std::vector<Change> changes;
+    changes.swap(_changes);
+    if(changes.empty())
+        return true;
+
+    core::PosixFd sock{::socket(AF_NETLINK, SOCK_RAW|SOCK_CLOEXEC, NETLINK_ROUTE)};
+    if(!sock)
+    {
+        KAPPS_CORE_WARNING() << "Failed to open rtnetlink socket -" << core::ErrnoTracer{};
+        return false;
+    }
+
+    timeval timeout{};
+    timeout.tv_sec = kAckTimeoutSec;
+    ::setsockopt(sock.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Combine all messages into one buffer; sequence numbers identify the
+    // acknowledgements.  (Each message's length is already aligned.)
+    std::vector<unsigned char> buffer;
+    for(std::size_t i=0; i<changes.size(); ++i)
+    {
+        auto &message = changes[i].message;
+        auto *pHeader = reinterpret_cast<nlmsghdr*>(message.data());
+        pHeader->nlmsg_len = static_cast<std::uint32_t>(message.size());
+        pHeader->nlmsg_seq = static_cast<std::uint32_t>(i + 1);
+        buffer.insert(buffer.end(), message.begin(), message.end());
+    }
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    if(::sendto(sock.get(), buffer.data(), buffer.size(), 0,
+                reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) !=
+       static_cast<ssize_t>(buffer.size()))
+    {
+        KAPPS_CORE_WARNING() << "Failed to send" << changes.size()
+            << "routing changes -" << core::ErrnoTracer{};
+        return false;
+    }
+
+    bool success{true};
+    std::size_t acked{0};
+    alignas(nlmsghdr) unsigned char ackBuffer[8192];
+    while(acked < changes.size())
+    {
+        ssize_t received = ::recv(sock.get(), ackBuffer, sizeof(ackBuffer), 0);
+        if(received < 0)
+        {
+            KAPPS_CORE_WARNING() << "Failed to receive acknowledgements for"
+                << (changes.size() - acked) << "routing changes -" << core::ErrnoTracer{};
+            return false;
+        }
+
+        int remaining = static_cast<int>(received);
+        for(auto *pHeader = reinterpret_cast<nlmsghdr*>(ackBuffer);
+            NLMSG_OK(pHeader, remaining); pHeader = NLMSG_NEXT(pHeader, remaining))
+        {
+            if(pHeader->nlmsg_type != NLMSG_ERROR)
+                continue;
+
+            ++acked;
+            const auto *pError = reinterpret_cast<const nlmsgerr*>(NLMSG_DATA(pHeader));
+            if(pError->error == 0)
+                continue;
+
+            success = false;
+            std::size_t index = pHeader->nlmsg_seq - 1;
+            const std::string &description = index < changes.size() ?
+                changes[index].description : std::string{"unknown change"};
+            KAPPS_CORE_WARNING() << "Failed:" << description << "-"
+                << ::strerror(-pError->error);
+        }
+    }
+
+    return success;
+}
+
+}}
@@ -0,0 +1,98 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_core/core.h>
+#include <kapps_net/net.h>
+#include <kapps_core/src/util.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace kapps { namespace net {
+
+// Batch of routing table and routing policy rule changes applied with
+// rtnetlink.  This replaces running "ip route ..." / "ip rule ..." for each
+// change - all changes in the batch are sent to the kernel with one sendmsg(),
+// and the acknowledgements are read together, so a network change costs one
+// round trip instead of one fork+exec per route or rule.
+//
+// Each change is still applied individually by the kernel (rtnetlink has no
+// transactions); apply() traces any that fail, like the "ip" commands did.
+//
+// Routing tables are given by name, as with "ip".  Names are resolved from the
+// IDs cached with cacheTableIds(), or from /etc/iproute2/rt_tables (once per
+// name) if they weren't cached.  Numeric table IDs are also accepted.
+class KAPPS_NET_EXPORT NlRouteBatch
+{
+public:
+    enum class Family
+    {
+        IPv4,
+        IPv6,
+    };
+
+public:
+    // Equivalent to "ip route replace default [via <gatewayIp>] dev
+    // <interfaceName> table <table>".  If gatewayIp is empty, this is a
+    // link-scope route through the interface.
+    void replaceDefaultRoute(Family family, const std::string &gatewayIp,
+                             const std::string &interfaceName,
+                             const std::string &table);
+    // Equivalent to "ip route replace blackhole default metric <metric> table
+    // <table>"
+    void replaceBlackholeDefaultRoute(Family family, std::uint32_t metric,
+                                      const std::string &table);
+    // Equivalent to "ip rule add from <sourceIp> lookup <table> pri <priority>"
+    void addSourceRule(const std::string &sourceIp, const std::string &table,
+                       std::uint32_t priority);
+    // Equivalent to "ip rule del from <sourceIp> lookup <table> pri <priority>"
+    void deleteSourceRule(const std::string &sourceIp, const std::string &table,
+                          std::uint32_t priority);
+
+    bool empty() const {return _changes.empty();}
+
+    // Cache routing table IDs by name, normally the ones resolved by
+    // RtTablesInitializer at startup.  Cached tables are used without reading
+    // rt_tables, so nothing on the connect path has to resolve names from a
+    // file (and the tables work even if rt_tables couldn't be written).
+    static void cacheTableIds(const std::map<std::string, std::uint32_t> &tableIds);
+
+    // Send all changes to the kernel.  Returns true if all of them succeeded.
+    // The batch is cleared either way.
+    bool apply();
+
+private:
+    struct Change
+    {
+        std::string description;    // For tracing, like the ip command
+        std::vector<unsigned char> message;
+    };
+
+    void addRoute(Family family, const std::string &gatewayIp,
+                  const std::string &interfaceName, std::uint32_t metric,
+                  bool blackhole, const std::string &table, std::string description);
+    void addRule(bool add, const std::string &sourceIp, const std::string &table,
+                 std::uint32_t priority, std::string description);
+
+private:
+    std::vector<Change> _changes;
+};
+
+}}
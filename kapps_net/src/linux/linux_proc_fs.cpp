@@ -42,7 +42,7 @@ std::string mountNamespaceId(pid_t pid, bool silent)
     return kapps::core::fs::readLink(qs::format("%/%/ns/mnt", kProcDirName, pid), silent);
 }
 
-bool isChildOf(pid_t parentPid, pid_t pid, bool silent)
+pid_t parentPidOf(pid_t pid, bool silent)
 {
     static const std::regex parentPidRegex{"PPid:\\s+([0-9]+)"};
 
@@ -53,11 +53,14 @@ bool isChildOf(pid_t parentPid, pid_t pid, bool silent)
 
     std::regex_search(statusContent, match, parentPidRegex);
     if(match.size() >= 2)
-    {
-        auto foundParentPid = std::stoi(match.str(1));
-        return foundParentPid == parentPid;
-    }
+        return std::stoi(match.str(1));
+
+    return 0;
+}
 
-    return false;
+bool isChildOf(pid_t parentPid, pid_t pid, bool silent)
+{
+    pid_t foundParentPid = parentPidOf(pid, silent);
+    return foundParentPid && foundParentPid == parentPid;
 }
 }
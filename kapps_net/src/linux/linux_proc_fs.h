@@ -54,6 +54,10 @@ namespace ProcFs
     // Currently, we only accept mount namespaces that match the mount namespace of pia-daemon
     std::string mountNamespaceId(pid_t pid, bool silent=false);
 
+    // Given a pid, return the pid of its parent process, or 0 if it can't be
+    // read.
+    pid_t parentPidOf(pid_t pid, bool silent=false);
+
     // Is pid a child of parentPid ?
     bool isChildOf(pid_t parentPid, pid_t pid, bool silent=false);
 
@@ -0,0 +1,174 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "linux_proc_table.h"
+#include "linux_proc_fs.h"
+#include <kapps_core/src/logger.h>
+
+namespace kapps { namespace net {
+
+void ProcessTable::rebuild()
+{
+    _processes.clear();
+    _pathPids.clear();
+
+    // Errors are silenced - it's common for transient processes to exit
+    // before they can be read.  Parents that don't appear in the scan (they
+    // exited during it) are left out of the parent/child links.
+    std::unordered_map<pid_t, pid_t> parentPids;
+    ProcFs::filterPids([&](pid_t pid)
+    {
+        std::string path = ProcFs::pathForPid(pid, true);
+        if(!path.empty())
+        {
+            add(pid, 0, std::move(path));
+            parentPids.emplace(pid, ProcFs::parentPidOf(pid, true));
+        }
+        return false;
+    });
+
+    for(const auto &pidParent : parentPids)
+    {
+        auto itParent = _processes.find(pidParent.second);
+        if(itParent != _processes.end())
+        {
+            _processes[pidParent.first].parentPid = pidParent.second;
+            itParent->second.childPids.insert(pidParent.first);
+        }
+    }
+
+    KAPPS_CORE_INFO() << "Indexed" << _processes.size() << "processes";
+}
+
+void ProcessTable::fork(pid_t parentPid, pid_t childPid)
+{
+    // The child runs the same executable as the parent until it exec()s.  If
+    // we don't know the parent, read the child's path.
+    auto itParent = _processes.find(parentPid);
+    if(itParent != _processes.end())
+    {
+        std::string path = itParent->second.path;
+        add(childPid, parentPid, std::move(path));
+    }
+    else
+    {
+        std::string path = ProcFs::pathForPid(childPid, true);
+        if(!path.empty())
+            add(childPid, 0, std::move(path));
+    }
+}
+
+std::string ProcessTable::exec(pid_t pid)
+{
+    std::string path = ProcFs::pathForPid(pid, true);
+    if(path.empty())
+    {
+        // Already exited, or can't be read - don't keep a stale path
+        exit(pid);
+        return {};
+    }
+
+    auto itProcess = _processes.find(pid);
+    if(itProcess != _processes.end())
+        setPath(pid, itProcess->second, path);
+    else
+        add(pid, 0, path);
+    return path;
+}
+
+void ProcessTable::exit(pid_t pid)
+{
+    auto itProcess = _processes.find(pid);
+    if(itProcess == _processes.end())
+        return;
+
+    Process &process{itProcess->second};
+    setPath(pid, process, {});
+    for(pid_t childPid : process.childPids)
+    {
+        auto itChild = _processes.find(childPid);
+        if(itChild != _processes.end())
+            itChild->second.parentPid = 0;
+    }
+    if(process.parentPid)
+    {
+        auto itParent = _processes.find(process.parentPid);
+        if(itParent != _processes.end())
+            itParent->second.childPids.erase(pid);
+    }
+    _processes.erase(itProcess);
+}
+
+std::unordered_set<pid_t> ProcessTable::pidsForPath(const std::string &path) const
+{
+    auto itPath = _pathPids.find(path);
+    if(itPath == _pathPids.end())
+        return {};
+    return itPath->second;
+}
+
+std::unordered_set<pid_t> ProcessTable::childPidsOf(pid_t parentPid) const
+{
+    auto itProcess = _processes.find(parentPid);
+    if(itProcess == _processes.end())
+        return {};
+    return itProcess->second.childPids;
+}
+
+void ProcessTable::add(pid_t pid, pid_t parentPid, std::string path)
+{
+    // A pid can be reused once we've seen its exit, but if we somehow missed
+    // the exit, drop the old process first.
+    exit(pid);
+
+    Process &process{_processes[pid]};
+    process.parentPid = 0;
+    if(parentPid)
+    {
+        auto itParent = _processes.find(parentPid);
+        if(itParent != _processes.end())
+        {
+            process.parentPid = parentPid;
+            itParent->second.childPids.insert(pid);
+        }
+    }
+    setPath(pid, process, std::move(path));
+}
+
+void ProcessTable::setPath(pid_t pid, Process &process, std::string path)
+{
+    if(process.path == path)
+        return;
+
+    if(!process.path.empty())
+    {
+        auto itPath = _pathPids.find(process.path);
+        if(itPath != _pathPids.end())
+        {
+            itPath->second.erase(pid);
+            if(itPath->second.empty())
+                _pathPids.erase(itPath);
+        }
+    }
+
+    process.path = std::move(path);
+    if(!process.path.empty())
+        _pathPids[process.path].insert(pid);
+}
+
+}}
@@ -0,0 +1,78 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_net/net.h>
+#include <kapps_core/src/util.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/types.h>
+
+namespace kapps { namespace net {
+
+// Index of the running processes by executable path and parent, so split
+// tunnel can find the processes for an app (and their descendants) without
+// scanning /proc.
+//
+// The table is built with one scan of /proc (rebuild()), then kept up to date
+// with process events from CnProc - fork() adds a process with its parent's
+// path, exec() reads the new path, and exit() removes it.  Forks are indexed
+// too, since a process can fork without exec() (the child still runs the same
+// executable, and a /proc scan would have found it).
+//
+// If events might have been missed, rebuild() rescans /proc.
+class KAPPS_NET_EXPORT ProcessTable
+{
+public:
+    // Rebuild the table from /proc
+    void rebuild();
+
+    // A process forked.  Only new processes should be passed, not new threads.
+    void fork(pid_t parentPid, pid_t childPid);
+    // A process exec()'d.  Returns its new path, which is empty if it couldn't
+    // be read (usually because the process has already exited).
+    std::string exec(pid_t pid);
+    // A process exited.  Its children are reparented by the kernel; we don't
+    // know the new parent, so they're just orphaned here.
+    void exit(pid_t pid);
+
+    // Get all processes running the executable at path
+    std::unordered_set<pid_t> pidsForPath(const std::string &path) const;
+    // Get the (immediate) children of a process
+    std::unordered_set<pid_t> childPidsOf(pid_t parentPid) const;
+
+    std::size_t size() const {return _processes.size();}
+
+private:
+    struct Process
+    {
+        std::string path;
+        pid_t parentPid;
+        std::unordered_set<pid_t> childPids;
+    };
+
+    void add(pid_t pid, pid_t parentPid, std::string path);
+    void setPath(pid_t pid, Process &process, std::string path);
+
+private:
+    std::unordered_map<pid_t, Process> _processes;
+    std::unordered_map<std::string, std::unordered_set<pid_t>> _pathPids;
+};
+
+}}
@@ -41,8 +41,18 @@ void ProcTracker::showInvalidMountNamespaceWarning(const std::string &appName, p
 
 void ProcTracker::initiateConnection(const FirewallParams &params, std::string tunnelDeviceName, std::string tunnelDeviceLocalAddress)
 {
+    _cnProc.fork = [this](pid_t parentPid, pid_t childPid) { _processes.fork(parentPid, childPid); };
     _cnProc.exec = [this](pid_t pid) { addLaunchedApp(pid); };
-    _cnProc.exit = [this](pid_t pid) { removeTerminatedApp(pid); };
+    _cnProc.exit = [this](pid_t pid)
+    {
+        _processes.exit(pid);
+        removeTerminatedApp(pid);
+    };
+    _cnProc.overflowed = [this]() { resyncApps(); };
+
+    // Build the process index; events that arrive during the scan are handled
+    // after it, and the table tolerates processes it already knows about.
+    _processes.rebuild();
 
     // setup cgroups + configure routing rules
     _cgroup.setupNetCls();
@@ -59,8 +69,10 @@ void ProcTracker::shutdownConnection()
     // Remove cgroup routing rules
     _cgroup.teardownNetCls();
     removeAllApps();
-    removeRoutingPolicyForSourceIp(_previousNetScan.ipAddress(), _cgroup.routing().bypassTable());
-    removeRoutingPolicyForSourceIp(_previousTunnelDeviceLocalAddress, _cgroup.routing().vpnOnlyTable());
+    NlRouteBatch routeBatch;
+    removeRoutingPolicyForSourceIp(routeBatch, _previousNetScan.ipAddress(), _cgroup.routing().bypassTable());
+    removeRoutingPolicyForSourceIp(routeBatch, _previousTunnelDeviceLocalAddress, _cgroup.routing().vpnOnlyTable());
+    routeBatch.apply();
     teardownReversePathFiltering();
 
     // Clear out our network info
@@ -95,10 +107,7 @@ void ProcTracker::addApps(const std::vector<std::string> &apps, AppMap &appMap,
     {
         // Create the PID set for this app or get the existing one
         auto &appPids = appMap[app];
-        // Since this scans all PIDs, it's common for transient processes to
-        // cause errors as they exit before we get a chance to check them -
-        // silence these errors since this happens a lot.
-        for(pid_t pid : ProcFs::pidsForPath(app, true))
+        for(pid_t pid : _processes.pidsForPath(app))
         {
             if(!isProcessInAllowedMountNamespace(pid))
             {
@@ -107,7 +116,7 @@ void ProcTracker::addApps(const std::vector<std::string> &apps, AppMap &appMap,
             }
 
             // Both these calls are no-ops if the PID is already excluded
-            CGroup::addPidToCgroup(pid, cGroupPath);
+            CGroup::addPidToCgroup(pid, cGroupPath, _processes);
             appPids.insert(pid);
         }
     }
@@ -125,7 +134,7 @@ void ProcTracker::removeApps(const std::vector<std::string> &keepApps, AppMap &a
         if(itr == keepApps.end())
         {
             for(pid_t pid : itApp->second)
-                CGroup::removePidFromCgroup(pid, _defaultFile);
+                CGroup::removePidFromCgroup(pid, _defaultFile, _processes);
 
             itApp = appMap.erase(itApp);
         }
@@ -163,16 +172,16 @@ void ProcTracker::teardownFirewall()
     _firewall.setAnchorEnabled(TableEnum::Mangle, IPVersion::Both, ("100.tagVpnOnly"), false);
 }
 
-void ProcTracker::addRoutingPolicyForSourceIp(std::string ipAddress, std::string routingTableName)
+void ProcTracker::addRoutingPolicyForSourceIp(NlRouteBatch &routeBatch, std::string ipAddress, std::string routingTableName)
 {
     if(!ipAddress.empty())
-        core::Exec::bash(qs::format("ip rule add from % lookup % pri %", ipAddress, routingTableName, Routing::Priorities::sourceIp));
+        routeBatch.addSourceRule(ipAddress, routingTableName, Routing::Priorities::sourceIp);
 }
 
-void ProcTracker::removeRoutingPolicyForSourceIp(std::string ipAddress, std::string routingTableName)
+void ProcTracker::removeRoutingPolicyForSourceIp(NlRouteBatch &routeBatch, std::string ipAddress, std::string routingTableName)
 {
     if(!ipAddress.empty())
-        core::Exec::bash(qs::format("ip rule del from % lookup % pri %", ipAddress, routingTableName, Routing::Priorities::sourceIp));
+        routeBatch.deleteSourceRule(ipAddress, routingTableName, Routing::Priorities::sourceIp);
 }
 
 void ProcTracker::removeTerminatedApp(pid_t pid)
@@ -192,11 +201,45 @@ void ProcTracker::removeTerminatedApp(pid_t pid)
     }
 }
 
+void ProcTracker::resyncApps()
+{
+    KAPPS_CORE_WARNING() << "Process events were lost, rescanning processes";
+    _processes.rebuild();
+    resyncApps(_exclusionsMap, _bypassFile, "bypass");
+    resyncApps(_vpnOnlyMap, _vpnOnlyFile, "VPN only");
+}
+
+void ProcTracker::resyncApps(AppMap &appMap, std::string cGroupPath, core::StringSlice traceName)
+{
+    // Only apps already in the map are tracked (bypass apps are not tracked
+    // when there's no network scan, etc.), so resync those apps.
+    std::vector<std::string> apps;
+    apps.reserve(appMap.size());
+    for(auto &appPids : appMap)
+    {
+        apps.push_back(appPids.first);
+        // Forget PIDs whose exit might have been missed.  (They no longer
+        // exist, so there's nothing to remove from the cgroup.)
+        const auto runningPids = _processes.pidsForPath(appPids.first);
+        auto itPid = appPids.second.begin();
+        while(itPid != appPids.second.end())
+        {
+            if(runningPids.count(*itPid))
+                ++itPid;
+            else
+                itPid = appPids.second.erase(itPid);
+        }
+    }
+
+    // Add any processes whose exec() might have been missed
+    addApps(apps, appMap, std::move(cGroupPath), traceName);
+}
+
 void ProcTracker::addLaunchedApp(pid_t pid)
 {
-    // Get the launch path associated with the PID.  This also tends to trace
-    // errors for transient processes; ignore those.
-    std::string appName = ProcFs::pathForPid(pid, true);
+    // Get the launch path associated with the PID and update the process
+    // index.  Errors for transient processes are ignored.
+    std::string appName = _processes.exec(pid);
 
     // May be empty if the process was so short-lived it exited before we had a chance to read its name
     // In this case we just early-exit and ignore it
@@ -224,7 +267,7 @@ void ProcTracker::addLaunchedApp(pid_t pid)
 
             // Add the PID to the cgroup so its network traffic goes out the
             // physical uplink
-            CGroup::addPidToCgroup(pid, _bypassFile);
+            CGroup::addPidToCgroup(pid, _bypassFile, _processes);
         }
     }
     else if(_vpnOnlyMap.count(appName) > 0)
@@ -234,7 +277,7 @@ void ProcTracker::addLaunchedApp(pid_t pid)
 
         // Add the PID to the cgroup so its network traffic is forced out the
         // VPN
-        CGroup::addPidToCgroup(pid, _vpnOnlyFile);
+        CGroup::addPidToCgroup(pid, _vpnOnlyFile, _processes);
     }
 }
 
@@ -256,7 +299,7 @@ void ProcTracker::updateMasquerade(std::string interfaceName, std::string tunnel
     }
 }
 
-void ProcTracker::updateRoutes(std::string gatewayIp, std::string interfaceName, std::string tunnelDeviceName)
+void ProcTracker::updateRoutes(NlRouteBatch &routeBatch, std::string gatewayIp, std::string interfaceName, std::string tunnelDeviceName)
 {
     // The bypass route can be left as-is if the configuration is not known,
     // even though the route may be out of date - we don't put any processes in
@@ -268,8 +311,8 @@ void ProcTracker::updateRoutes(std::string gatewayIp, std::string interfaceName,
     }
     else
     {
-        core::Exec::bash(qs::format("ip route replace default via % dev % table %",
-            gatewayIp, interfaceName, _cgroup.routing().bypassTable()));
+        routeBatch.replaceDefaultRoute(NlRouteBatch::Family::IPv4, gatewayIp,
+            interfaceName, _cgroup.routing().bypassTable());
     }
 
     // The VPN-only route can be left as-is if we're not connected, VPN-only
@@ -281,11 +324,9 @@ void ProcTracker::updateRoutes(std::string gatewayIp, std::string interfaceName,
     }
     else
     {
-        core::Exec::bash(qs::format("ip route replace default dev % table %",
-            tunnelDeviceName, _cgroup.routing().vpnOnlyTable()));
+        routeBatch.replaceDefaultRoute(NlRouteBatch::Family::IPv4, {},
+            tunnelDeviceName, _cgroup.routing().vpnOnlyTable());
     }
-
-    core::Exec::cmd(qs::format("ip"), {"route", "flush", "cache"});
 }
 
 void ProcTracker::updateNetwork(const FirewallParams &params, std::string tunnelDeviceName,
@@ -298,24 +339,30 @@ void ProcTracker::updateNetwork(const FirewallParams &params, std::string tunnel
     if(_previousNetScan.interfaceName() != params.netScan.interfaceName() || _previousTunnelDeviceName != tunnelDeviceName)
         updateMasquerade(params.netScan.interfaceName(), tunnelDeviceName);
 
+    // All routing changes for this update are applied in one batch
+    NlRouteBatch routeBatch;
+
     // Ensure that packets with the source IP of the physical interface go out the physical interface
     if(_previousNetScan.ipAddress() != params.netScan.ipAddress())
     {
         // Remove the old one (if it exists) before adding a new one
-        removeRoutingPolicyForSourceIp(_previousNetScan.ipAddress(), _cgroup.routing().bypassTable());
-        addRoutingPolicyForSourceIp(params.netScan.ipAddress(), _cgroup.routing().bypassTable());
+        removeRoutingPolicyForSourceIp(routeBatch, _previousNetScan.ipAddress(), _cgroup.routing().bypassTable());
+        addRoutingPolicyForSourceIp(routeBatch, params.netScan.ipAddress(), _cgroup.routing().bypassTable());
     }
 
     // Ensure that packets with source IP of the tunnel go out the tunnel interface
     if(_previousTunnelDeviceLocalAddress !=  tunnelDeviceLocalAddress)
     {
         // Remove the old one (if it exists) before adding a new one
-        removeRoutingPolicyForSourceIp(_previousTunnelDeviceLocalAddress, _cgroup.routing().vpnOnlyTable());
-        addRoutingPolicyForSourceIp(tunnelDeviceLocalAddress, _cgroup.routing().vpnOnlyTable());
+        removeRoutingPolicyForSourceIp(routeBatch, _previousTunnelDeviceLocalAddress, _cgroup.routing().vpnOnlyTable());
+        addRoutingPolicyForSourceIp(routeBatch, tunnelDeviceLocalAddress, _cgroup.routing().vpnOnlyTable());
     }
 
     // always update the routes - as we use 'route replace' so we don't have to worry about adding the same route multiple times
-    updateRoutes(params.netScan.gatewayIp(), params.netScan.interfaceName(), tunnelDeviceName);
+    updateRoutes(routeBatch, params.netScan.gatewayIp(), params.netScan.interfaceName(), tunnelDeviceName);
+    routeBatch.apply();
+    // Equivalent to "ip route flush cache"
+    core::fs::writeString("/proc/sys/net/ipv4/route/flush", "1", true);
 
     updateFirewall(params);
 
@@ -331,7 +378,9 @@ void ProcTracker::setVpnBlackHole()
 {
     // This fall-back route blocks all traffic that hits the vpnOnly routing table
     // The tunnel interface route disappears when the tunnel goes down, exposing this route
-    core::Exec::bash(qs::format("ip route replace blackhole default metric 32000 table %", _cgroup.routing().vpnOnlyTable()));
+    NlRouteBatch routeBatch;
+    routeBatch.replaceBlackholeDefaultRoute(NlRouteBatch::Family::IPv4, 32000, _cgroup.routing().vpnOnlyTable());
+    routeBatch.apply();
 }
 
 void ProcTracker::setupReversePathFiltering()
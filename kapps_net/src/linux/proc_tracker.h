@@ -27,6 +27,8 @@
 #include <unordered_map>
 #include "linux_cgroup.h"
 #include "linux_proc_fs.h"
+#include "linux_proc_table.h"
+#include "linux_nlroute.h"
 
 namespace kapps { namespace net {
 
@@ -77,12 +79,16 @@ private:
                     core::StringSlice traceName);
     void updateFirewall(const FirewallParams &params);
     void teardownFirewall();
-    void addRoutingPolicyForSourceIp(std::string ipAddress, std::string routingTableName);
-    void removeRoutingPolicyForSourceIp(std::string ipAddress, std::string routingTableName);
+    void addRoutingPolicyForSourceIp(NlRouteBatch &routeBatch, std::string ipAddress, std::string routingTableName);
+    void removeRoutingPolicyForSourceIp(NlRouteBatch &routeBatch, std::string ipAddress, std::string routingTableName);
     void removeTerminatedApp(pid_t pid);
     void addLaunchedApp(pid_t pid);
+    // Process events were lost - rebuild the process table and reconcile the
+    // tracked apps with the processes that are actually running.
+    void resyncApps();
+    void resyncApps(AppMap &appMap, std::string cGroupPath, core::StringSlice traceName);
     void updateMasquerade(std::string interfaceName, std::string tunnelDeviceName);
-    void updateRoutes(std::string gatewayIp, std::string interfaceName, std::string tunnelDeviceName);
+    void updateRoutes(NlRouteBatch &routeBatch, std::string gatewayIp, std::string interfaceName, std::string tunnelDeviceName);
     void updateNetwork(const FirewallParams &params, std::string tunnelDeviceName,
                        std::string tunnelDeviceLocalAddres);
     void setVpnBlackHole();
@@ -99,6 +105,9 @@ private:
 
 private:
     CnProc _cnProc;
+    // Index of running processes, kept up to date from _cnProc's events.  App
+    // lookups use this instead of scanning /proc.
+    ProcessTable _processes;
     OriginalNetworkScan _previousNetScan;
     std::string _previousRPFilter;
     std::string _bypassFile;
@@ -18,8 +18,11 @@
 
 #include "rt_tables_initializer.h"
 #include <fstream>
-#include <kapps_core/src/newexec.h>
 #include <kapps_core/src/fs.h>
+#include <kapps_core/src/logger.h>
+#include <algorithm>
+#include <cctype>
+#include <sstream>
 
 namespace kapps { namespace net {
 
@@ -28,6 +31,43 @@ namespace
     // If we cannot find a table index to use (by looking at the existing rt_tables files)
     // then fall back to a table index of 100 as a last resort.
     constexpr int kFallbackIndex{100};
+
+    struct RtEntry
+    {
+        int index;
+        std::string name;
+    };
+
+    // Read the entries of an rt_tables file.  Routing tables are formatted
+    // like this in rt_tables:
+    // 100  myTable1
+    // 101  myTable2
+    // 99   myTable3
+    // 70   myTable4
+    // 200  myTable5
+    // Note that the index (on the left) is not guaranteed to increment
+    // linearly or in order.  Only lines beginning with a number are entries;
+    // comments and other lines are ignored.
+    std::vector<RtEntry> readRtEntries(const std::string &rtPath)
+    {
+        std::vector<RtEntry> entries;
+        std::ifstream rtFile{rtPath};
+        std::string line;
+        while(std::getline(rtFile, line))
+        {
+            if(line.empty() || !std::isdigit(static_cast<unsigned char>(line[0])))
+                continue;
+
+            std::istringstream lineStream{line};
+            RtEntry entry{};
+            if(lineStream >> entry.index)
+            {
+                lineStream >> entry.name;
+                entries.push_back(std::move(entry));
+            }
+        }
+        return entries;
+    }
 }
 
 // For convenience
@@ -46,24 +86,28 @@ RtTablesInitializer::RtTablesInitializer(const std::string &brandPrefix, RtTable
     };
 }
 
-bool RtTablesInitializer::install() const
+bool RtTablesInitializer::install()
 {
     assert(_tableNames.size() > 0); // Invariant
 
     KAPPS_CORE_INFO() << "Preparing to setup routing tables.";
+    _tableIds.clear();
 
     // Setup the _routingTablePath
     // This really means preparing the etcPath for rt_tables on disk
     // so that it's ready to be written to.
-    // If this step fails we cannot proceed - tracing happens inside prepareRtLocation()
+    // If this step fails we can't add our tables to rt_tables - tracing
+    // happens inside prepareRtLocation().  Still pick IDs for the tables so
+    // they can be referred to numerically.
     if(!prepareRtLocation())
+    {
+        assignTableIds(nextAvailableIndex());
         return false;
+    }
 
-    // This function cannot fail - the worst it can do
-    // is not append anything (if the tables already exist in the file)
-    appendRoutingTables(nextAvailableIndex());
-
-    return true;
+    // The worst this can do is not append anything (if the tables already
+    // exist in the file, or it can't be written)
+    return appendRoutingTables(nextAvailableIndex());
 }
 
 int RtTablesInitializer::nextAvailableIndex() const
@@ -90,48 +134,74 @@ int RtTablesInitializer::nextAvailableIndex() const
 
 int RtTablesInitializer::nextAvailableTableIndexFromFile(const std::string &rtPath) const
 {
-    // Routing tables are formatted like this in rt_tables:
-    // 100  myTable1
-    // 101  myTable2
-    // 99   myTable3
-    // 70   myTable4
-    // 200  myTable5
-    // Note that the index (on the left) is not guaranteed to increment linearly or in order
-    // The awk snippet below finds the highest valued index.
-    // TODO: rewrite this in pure C++
-    std::string highestIndex = core::Exec::bashWithOutput(qs::format("awk '/^[0-9]/{print $1}' \"%\" | sort -n | tail -1", rtPath));
+    int highestIndex{-1};
+    for(const auto &entry : readRtEntries(rtPath))
+        highestIndex = std::max(highestIndex, entry.index);
 
-    if(highestIndex.empty())
+    if(highestIndex < 0)
         return -1; // Indicate no index was found
 
     // Add 1 for the next available index
-    return std::stoi(highestIndex) + 1;
+    return highestIndex + 1;
 }
 
-void RtTablesInitializer::appendRoutingTables(int availableIndex) const
+bool RtTablesInitializer::appendRoutingTables(int availableIndex)
 {
+    // Tables we've already installed keep their existing IDs
+    for(const auto &entry : readRtEntries(_rtLocations.etcPath))
+    {
+        if(std::find(_tableNames.begin(), _tableNames.end(), entry.name) != _tableNames.end())
+            _tableIds.emplace(entry.name, static_cast<std::uint32_t>(entry.index));
+    }
+
+    std::vector<std::string> missingTables;
+    for(const auto &tableName : _tableNames)
+    {
+        if(_tableIds.count(tableName) == 0)
+            missingTables.push_back(tableName);
+    }
+
+    if(missingTables.empty())
+    {
+        KAPPS_CORE_INFO() << "No routing tables needed to be added.";
+        return true;
+    }
+
     // Append our routing tables to end of file
     std::ofstream rtFile{_rtLocations.etcPath, std::ios::app};
     int index{availableIndex};
-    for(const auto &tableName : _tableNames)
+    for(const auto &tableName : missingTables)
     {
-        if(!isRoutingTableInstalled(tableName))
-        {
-            // An entry looks like, e.g "100  piavpnrt"
-            rtFile << index << "\t" << tableName << "\n";
-            ++index;
+        // An entry looks like, e.g "100  piavpnrt"
+        rtFile << index << "\t" << tableName << "\n";
+        // Record the ID even if the write fails - the table can still be
+        // used numerically
+        _tableIds.emplace(tableName, static_cast<std::uint32_t>(index));
+
+        KAPPS_CORE_INFO() << qs::format("Added % routing table to % with index %", tableName, _rtLocations.etcPath, index);
+        ++index;
+    }
 
-            KAPPS_CORE_INFO() << qs::format("Added % routing table to % with index %", tableName, _rtLocations.etcPath, index);
-        }
+    rtFile.flush();
+    if(!rtFile)
+    {
+        KAPPS_CORE_WARNING() << "Unable to write routing tables to" << _rtLocations.etcPath
+            << _errorEpilogue;
+        return false;
     }
 
-    if(availableIndex == index)
-        KAPPS_CORE_INFO() << "No routing tables needed to be added.";
+    return true;
 }
 
-bool RtTablesInitializer::isRoutingTableInstalled(const std::string &tableName) const
+void RtTablesInitializer::assignTableIds(int availableIndex)
 {
-    return 0 == core::Exec::bash(qs::format("grep % %", tableName, _rtLocations.etcPath), true);
+    int index{availableIndex};
+    for(const auto &tableName : _tableNames)
+    {
+        _tableIds.emplace(tableName, static_cast<std::uint32_t>(index));
+        KAPPS_CORE_INFO() << qs::format("Using index % for routing table % (not in rt_tables)", index, tableName);
+        ++index;
+    }
 }
 
 bool RtTablesInitializer::prepareRtLocation() const
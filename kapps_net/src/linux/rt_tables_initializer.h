@@ -19,6 +19,7 @@
 #pragma once
 #include <kapps_core/src/util.h>
 #include <kapps_net/net.h>
+#include <map>
 
 namespace kapps { namespace net {
 
@@ -62,14 +63,20 @@ public:
         RtLocations rtLocations);
 
 public:
-    // Install our routing tables in the rt_tables file
-    bool install() const;
+    // Install our routing tables in the rt_tables file.  The table IDs are
+    // resolved even if the file can't be written (e.g. on an immutable root),
+    // so they can still be used numerically; install() returns false in that
+    // case.
+    bool install();
     // Return our routing table names (based on the brandPrefix)
     std::vector<std::string> tableNames() const { return _tableNames; }
+    // The IDs of our routing tables (by name) resolved by install()
+    const std::map<std::string, std::uint32_t> &tableIds() const { return _tableIds; }
 
 private:
-    // Insert our routing tables at the end of rt_tables file
-    void appendRoutingTables(int availableIndex) const;
+    // Insert our routing tables at the end of rt_tables file, and record
+    // their IDs
+    bool appendRoutingTables(int availableIndex);
     // The next available index based on the passed-in rt_tables file
     int nextAvailableTableIndexFromFile(const std::string &rtPath) const;
     // The start index will use for our custom routing tables in /etc/iproute2/rt_tables
@@ -80,8 +87,9 @@ private:
     // If not found, it ensures the parent directory (/etc/iproute2) exists
     // and then creates the /etc/iproute2/rt_tables file
     bool prepareRtLocation() const;
-    // Whether the specific routing table is already installed
-    bool isRoutingTableInstalled(const std::string &tableName) const;
+    // Assign IDs to our tables without writing them to any file, used when
+    // the etc rt_tables file can't be prepared
+    void assignTableIds(int availableIndex);
 
 private:
     // Common error message
@@ -90,6 +98,8 @@ private:
     std::vector<std::string> _tableNames;
     // The locations of the rt_tables file
     RtLocations _rtLocations;
+    // IDs of our routing tables, resolved by install()
+    std::map<std::string, std::uint32_t> _tableIds;
 };
 
 }}
@@ -18,9 +18,13 @@
 
 #pragma once
 #include "packet.h"
+#include "../constrainedhash.h"
 #include <algorithm>
-#include <unordered_map>
-#include <deque>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
 #include <string.h>
 
 namespace std
@@ -71,7 +75,8 @@ public:
          return inAddrEqual(_sourceAddress, rhs._sourceAddress) &&
             _sourcePort == rhs._sourcePort &&
             inAddrEqual(_destAddress, rhs._destAddress) &&
-            _destPort == rhs._destPort;
+            _destPort == rhs._destPort &&
+            _protocol == rhs._protocol;
     }
 
     bool operator!=(const PacketFlow &rhs) const {return !(*this == rhs);}
@@ -121,57 +126,15 @@ namespace kapps { namespace net {
 using PacketFlow4 = PacketFlow<std::uint32_t>;
 using PacketFlow6 = PacketFlow<in6_addr>;
 
-template <typename KeyType_T, typename ValueType_T>
-class ConstrainedHash
-{
-public:
-    using KeyType = KeyType_T;
-    using ValueType = ValueType_T;
-
-    ConstrainedHash(size_t maxSize)
-    : _maxSize{maxSize}
-    {
-    }
-
-public:
-    void insert(const std::pair<KeyType_T, ValueType_T> &pair)
-    {
-        if(_orderedKeys.size() >= _maxSize)
-        {
-            _packetMap.erase(_orderedKeys.front());
-            _orderedKeys.pop_front();
-        }
-
-        _orderedKeys.push_back(pair.first);
-        _packetMap.insert(pair);
-    }
-
-    bool contains(const KeyType_T &key) const
-    {
-        return _packetMap.count(key) != 0;
-    }
-
-    ValueType_T &at(const KeyType_T &key)
-    {
-        return _packetMap.at(key);
-    }
-
-    size_t size() const { return _orderedKeys.size(); }
-
-private:
-    size_t _maxSize;
-    std::deque<KeyType_T> _orderedKeys;
-    std::unordered_map<KeyType_T, ValueType_T> _packetMap;
-};
-
 class FlowTracker
 {
 public:
     enum
     {
         // The number of flows to keep track of.
-        // If we get a new flow beyond this window size, then the oldest flow is dropped
-        WindowSize = 50,
+        // If we get a new flow beyond this window size, then the
+        // least-recently seen flow is dropped
+        WindowSize = 1024,
 
         // The number of repeated flows we allow within WindowSize
         // before dropping the packet
@@ -255,4 +218,44 @@ private:
     ConstrainedHash<PacketFlow6, Info> _flowMap6;
 };
 
+// Values associated with recently-seen TCP and UDP flows, such as the result
+// of classifying a flow.  Like FlowTracker, this holds at most windowSize flows
+// for each IP version, evicting the least-recently used ones.
+template <typename ValueType_T>
+class FlowCache
+{
+public:
+    FlowCache(size_t windowSize = FlowTracker::WindowSize)
+    : _flowMap4{windowSize}
+    , _flowMap6{windowSize}
+    {}
+
+public:
+    // Find the value for a flow, or nullptr if it is not cached
+    ValueType_T *find(const PacketFlow4 &flow) {return _flowMap4.find(flow);}
+    ValueType_T *find(const PacketFlow6 &flow) {return _flowMap6.find(flow);}
+
+    // Cache a value for a flow.  Protocols other than TCP/UDP are ignored,
+    // since they don't have a 'flow'.
+    template <typename FlowType>
+    void insert(const FlowType &flow, const ValueType_T &value)
+    {
+        if(flow.protocol() == IPPROTO_TCP || flow.protocol() == IPPROTO_UDP)
+            map(flow).insert({flow, value});
+    }
+
+    template <typename FlowType>
+    void erase(const FlowType &flow) {map(flow).erase(flow);}
+
+    void clear() {_flowMap4.clear(); _flowMap6.clear();}
+
+private:
+    ConstrainedHash<PacketFlow4, ValueType_T> &map(const PacketFlow4 &) {return _flowMap4;}
+    ConstrainedHash<PacketFlow6, ValueType_T> &map(const PacketFlow6 &) {return _flowMap6;}
+
+private:
+    ConstrainedHash<PacketFlow4, ValueType_T> _flowMap4;
+    ConstrainedHash<PacketFlow6, ValueType_T> _flowMap6;
+};
+
 }}
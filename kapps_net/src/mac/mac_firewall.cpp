@@ -205,7 +205,7 @@ void MacFirewall::startSplitTunnel(const FirewallParams &params)
     // We don't use any work items (we use syncInvoke() to update firewall
     // params and signal the "about-to-connect" condition), so the handler is
     // empty.
-    _pSplitTunnelWorker.emplace([](core::Any){});
+    _pSplitTunnelWorker.emplace([](core::Any){}, "splittunnel");
 
     _pSplitTunnelWorker->syncInvoke([&]
     {
@@ -31,6 +31,7 @@
 #include "utun.h"
 #include "port_finder.h"
 #include "packet.h"
+#include <thread>
 
 namespace
 {
@@ -43,11 +44,83 @@ namespace
     const std::string kSplitTunnelDeviceIpv6Base{"fd00:feed:face:cafe:beef:70:69:1"};
     const std::string kSplitTunnelDeviceIpv4Base{"10.0.255.1"};
 
+    // Time budget for handling packets on each wake-up of the split tunnel
+    // thread - see MacSplitTunnel::readFromSocket()
+    const std::chrono::microseconds kPacketReadBudget{2000};
+
+    // Interval for tracing PacketReadStats
+    const std::chrono::minutes kPacketReadStatsInterval{5};
+
+    // Maximum number of packet worker threads.  Beyond this, the utun reader
+    // itself is the bottleneck.
+    const unsigned kMaxPacketWorkers{4};
+    // Packets are enqueued to a worker in batches of up to this many, or at
+    // the end of each wake-up
+    const std::size_t kPacketBatchSize{64};
+    // If this many packets are queued to the workers and not handled yet,
+    // further packets are dropped until they catch up, like a full NIC ring.
+    // This bounds the memory used if the workers can't keep up.
+    const unsigned kMaxQueuedPackets{4096};
+
+    // How long a cached flow verdict is used before the flow is classified
+    // again.  We rarely see a TCP FIN/RST (the firewall rules route most of a
+    // flow's packets, so they don't reach the utun device), and UDP has no
+    // close at all, so this bounds how long a verdict could outlive the socket
+    // it was reached for if the port is reused by another app.
+    const std::chrono::seconds kFlowVerdictLifetime{10};
+
     template <typename C, typename V>
     bool contains(const C &container, const V &value)
     {
         return std::find(std::begin(container), std::end(container), value) != std::end(container);
     }
+
+    // Hash the flow of a packet read from the utun device (the addresses,
+    // protocol, and TCP/UDP ports) to pick its packet worker.  This reads the
+    // headers directly, because Packet modifies the IP header when it's
+    // created, which must only happen once on the worker.
+    //
+    // This just needs to be consistent for all packets of a flow; malformed
+    // packets are hashed somehow and rejected by the worker.
+    std::size_t packetFlowHash(const std::vector<unsigned char> &buffer)
+    {
+        // FNV-1a
+        std::size_t hash{14695981039346656037ull};
+        auto hashBytes = [&](std::size_t offset, std::size_t len)
+        {
+            for(std::size_t i=offset; i<offset+len && i<buffer.size(); ++i)
+            {
+                hash ^= buffer[i];
+                hash *= 1099511628211ull;
+            }
+        };
+
+        // The address family precedes the IP header
+        const std::size_t ipOffset{sizeof(std::uint32_t)};
+        if(buffer.size() <= ipOffset)
+            return hash;
+
+        std::uint8_t protocol{};
+        std::size_t transportOffset{};
+        if((buffer[ipOffset] >> 4) == 4)
+        {
+            protocol = buffer.size() > ipOffset+9 ? buffer[ipOffset+9] : 0;
+            hashBytes(ipOffset+12, 8);  // ip_src, ip_dst
+            transportOffset = ipOffset + (buffer[ipOffset] & 0x0F) * 4;
+        }
+        else
+        {
+            protocol = buffer.size() > ipOffset+6 ? buffer[ipOffset+6] : 0;
+            hashBytes(ipOffset+8, 32);  // ip6_src, ip6_dst
+            transportOffset = ipOffset + sizeof(ip6_hdr);
+        }
+
+        hash ^= protocol;
+        hash *= 1099511628211ull;
+        if(protocol == IPPROTO_TCP || protocol == IPPROTO_UDP)
+            hashBytes(transportOffset, sizeof(kapps::net::TransportPortHeader));
+        return hash;
+    }
 }
 
 namespace kapps { namespace net {
@@ -71,6 +144,65 @@ void AppCache::refresh(IPVersion ipVersion, const OriginalNetworkScan &netScan)
     }
 }
 
+void PacketReadStats::record(unsigned packets, std::chrono::microseconds elapsed,
+                             bool budgetExhausted)
+{
+    if(!_interval)
+        _interval.start();
+
+    ++_wakes;
+    _packets += packets;
+    _maxPackets = std::max(_maxPackets, packets);
+    if(budgetExhausted)
+        ++_budgetExhausted;
+    _totalElapsed += elapsed;
+    _maxElapsed = std::max(_maxElapsed, elapsed);
+}
+
+void PacketReadStats::traceIfDue()
+{
+    if(!_interval || _interval.elapsed() < kPacketReadStatsInterval || !_wakes)
+        return;
+
+    KAPPS_CORE_INFO() << "Split tunnel packet reads:" << _wakes << "wakes,"
+        << _packets << "packets, avg" << (_packets / _wakes) << "/ max"
+        << _maxPackets << "packets per wake, avg"
+        << (_totalElapsed.count() / _wakes) << "/ max" << _maxElapsed.count()
+        << "us per wake," << _budgetExhausted << "wakes used the full budget,"
+        << _dropped << "packets dropped";
+    *this = {};
+}
+
+PacketBufferPool::Buffer PacketBufferPool::take(std::size_t size)
+{
+    Buffer buffer;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        if(!_free.empty())
+        {
+            buffer = std::move(_free.back());
+            _free.pop_back();
+        }
+    }
+    // This only allocates if the buffer is new or the MTU has grown
+    buffer.resize(size);
+    return buffer;
+}
+
+void PacketBufferPool::give(std::vector<Buffer> &buffers)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    for(auto &buffer : buffers)
+        _free.push_back(std::move(buffer));
+    buffers.clear();
+}
+
+void PacketBufferPool::give(Buffer buffer)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    _free.push_back(std::move(buffer));
+}
+
 PortSet AppCache::ports(IPVersion ipVersion) const
 {
     PortSet allPorts;
@@ -127,7 +259,7 @@ std::string SplitTunnelIp::nextAddress(const std::string &addressStr, IPVersion
 class PiaConnections
 {
 public:
-    PiaConnections(const std::string &path, const std::string &vpnAddress,
+    PiaConnections(const std::set<pid_t> &piaPids, const std::string &vpnAddress,
                    const std::string &physAddress);
     const PortSet &bypassPorts() const {return _bypassPorts;}
     const PortSet &vpnOnlyPorts() const {return _vpnOnlyPorts;}
@@ -142,11 +274,11 @@ bool PiaConnections::isPiaPort(uint16_t port) const
     return _bypassPorts.count(port) || _vpnOnlyPorts.count(port);
 }
 
-PiaConnections::PiaConnections(const std::string &path, const std::string &vpnAddress,
+PiaConnections::PiaConnections(const std::set<pid_t> &piaPids, const std::string &vpnAddress,
                                const std::string &physAddress)
 {
     // An address is a source-ip/source-port pair
-    const auto piaAddresses = PortFinder::addresses4({path});
+    const auto piaAddresses = PortFinder::addresses4(piaPids);
     // Special-case PIA connections - allow them to do what they want and route them to
     // the interface indicated by their source IP
     for(const auto &address : piaAddresses)
@@ -159,6 +291,17 @@ PiaConnections::PiaConnections(const std::string &path, const std::string &vpnAd
     }
 }
 
+MacSplitTunnel::PacketWorker::PacketWorker(MacSplitTunnel &splitTunnel)
+    : thread{[this, &splitTunnel](core::Any item)
+        {
+            item.handle<PacketBatch>([&](PacketBatch &batch)
+            {
+                splitTunnel.handleBatch(shard, batch);
+            });
+        }}
+{
+}
+
 MacSplitTunnel::MacSplitTunnel(const FirewallParams &params, const std::string &executableDir, PFFirewall &filter)
 : _filter{filter}, _bypassRuleUpdater{std::make_unique<BypassStrategy>(filter), filter}
 , _vpnOnlyRuleUpdater{std::make_unique<VpnOnlyStrategy>(filter), filter}
@@ -180,7 +323,10 @@ bool MacSplitTunnel::cycleSplitTunnelDevice()
 
     // Change the Ips of the new tunnel device
     // (this ensures existing connections die)
-    _splitTunnelIp.refresh();
+    {
+        std::lock_guard<std::mutex> lock{_classifyMutex};
+        _splitTunnelIp.refresh();
+    }
 
     kapps::core::Exec::bash(qs::format("ifconfig % % %", pNewUtun->name(), _splitTunnelIp.ip4(), _splitTunnelIp.ip4()));
     kapps::core::Exec::bash(qs::format("ifconfig % inet6 %", pNewUtun->name(), _splitTunnelIp.ip6()));
@@ -230,6 +376,11 @@ void MacSplitTunnel::aboutToConnectToVpn()
         KAPPS_CORE_INFO() << "Split Tunnel ip4 addresses are" << _splitTunnelIp.ip4() << _splitTunnelIp.ip4();
         KAPPS_CORE_INFO() << "Split Tunnel ip6 address is" << _splitTunnelIp.ip6();
 
+        std::lock_guard<std::mutex> lock{_classifyMutex};
+
+        // Flows are classified again on the new device
+        invalidateVerdicts();
+
         // Clear ipv6 rules
         _defaultRuleUpdater.clearRules(IPv6);
         _bypassRuleUpdater.clearRules(IPv6);
@@ -282,10 +433,27 @@ void MacSplitTunnel::initiateConnection(const FirewallParams &params)
     // Setup the ICMP rules
     _defaultRuleUpdater.forceUpdate(IPv4, {}, params);
     _defaultRuleUpdater.forceUpdate(IPv6, {}, params);
+
+    // Start the packet workers once everything else is set up.  With only one
+    // core, there's no benefit to handing packets off to another thread, so
+    // they're handled on this thread.
+    unsigned workerCount = std::min(std::thread::hardware_concurrency(), kMaxPacketWorkers);
+    if(workerCount > 1)
+    {
+        for(unsigned i=0; i<workerCount; ++i)
+            _packetWorkers.push_back(std::make_unique<PacketWorker>(*this));
+    }
+    KAPPS_CORE_INFO() << "Split tunnel packets are handled by" << _packetWorkers.size()
+        << "worker threads";
 }
 
 void MacSplitTunnel::shutdownConnection()
 {
+    // Stop the packet workers first, they use the raw socket.  Any packets
+    // still queued are dropped.
+    _packetWorkers.clear();
+    _queuedPackets = 0;
+
     //_readNotifier.clear();
     _pUtun.clear();
     _routesUp = false;
@@ -295,6 +463,7 @@ void MacSplitTunnel::shutdownConnection()
     _state = State::Inactive;
 
     _defaultAppsCache.clearAll();
+    invalidateVerdicts();
     _bypassRuleUpdater.clearAllRules();
     _vpnOnlyRuleUpdater.clearAllRules();
     _defaultRuleUpdater.clearAllRules();
@@ -307,6 +476,7 @@ void MacSplitTunnel::shutdownConnection()
 }
 void MacSplitTunnel::updateSplitTunnel(const FirewallParams &params)
 {
+    std::lock_guard<std::mutex> lock{_classifyMutex};
     updateApps(params.excludeApps, params.vpnOnlyApps);
     updateNetwork(params);
 }
@@ -324,25 +494,37 @@ void MacSplitTunnel::readFromSocket()
     // packets if our receive buffer is not large enough.  Since the address
     // family is prepended to the packet, we should read at least MTU+4 bytes.
     //
-    // Process up to 100 packets per wake-up.  We don't want to return to
-    // poll(2) for every single packet if a lot are available, as it impacts
-    // throughput.  However, we also can't process all packets until none
-    // remain, as an app could keep us busy in this loop by continuing to send
-    // packets - and the thread would be unable to process work items, such as
-    // reconfiguring split tunnel.
+    // Process packets until the device is drained or the time budget for this
+    // wake-up is used up.  We don't want to return to poll(2) for every single
+    // packet if a lot are available, as it impacts throughput.  However, we
+    // also can't keep reading for as long as packets arrive, as an app could
+    // keep us busy in this loop by continuing to send packets - and the thread
+    // would be unable to process work items, such as reconfiguring split
+    // tunnel.
     //
-    // This is a throughput/latency tradeoff.  We want to make sure the thread
-    // can respond to work items reasonably quickly, while also not impacting
-    // throughput excessively.  Actually measuring the elasped time might be
-    // reasonable here too.
-
-    auto mtu = _pUtun->mtu();
-    int processedCount{0};
-    while(++processedCount <= 100)
+    // The cost of a packet varies a lot (new flows look up the owning process,
+    // repeated ones don't), so a time budget rather than a packet count gives
+    // consistent responsiveness: bulk traffic gets large batches, and a few
+    // expensive packets can't delay work items for long.  PacketReadStats
+    // traces the batch sizes and time spent per wake-up.
+    //
+    // With packet workers, each packet is handed off to the worker for its
+    // flow, so the packets of a flow are still handled in order.  Packets are
+    // enqueued in batches to limit the synchronization per packet.
+
+    // Extra uint32 for the address family
+    const std::size_t bufferSize{_pUtun->mtu() + sizeof(std::uint32_t)};
+
+    const auto readStart = std::chrono::steady_clock::now();
+    const auto readDeadline = readStart + kPacketReadBudget;
+    unsigned processedCount{0};
+    unsigned droppedCount{0};
+    bool budgetExhausted{false};
+    PacketBufferPool::Buffer buffer;
+    while(true)
     {
-        std::vector<unsigned char> buffer;
-        // Extra uint32 for the address family
-        buffer.resize(mtu + sizeof(std::uint32_t));
+        if(buffer.empty())
+            buffer = _packetBuffers.take(bufferSize);
 
         ssize_t actual{};
         NO_EINTR(actual = ::read(_pUtun->fd(), buffer.data(), buffer.size()));
@@ -358,10 +540,66 @@ void MacSplitTunnel::readFromSocket()
             break;  // We're done, nothing left to read
         }
 
-        buffer.resize(static_cast<std::size_t>(actual));
         // Got a packet
-        handleTunnelPacket(std::move(buffer));
+        ++processedCount;
+        if(_packetWorkers.empty())
+        {
+            // Handle it now, and reuse the buffer for the next packet
+            handleTunnelPacket(_inlineShard, {buffer.data(), static_cast<std::size_t>(actual)});
+        }
+        else if(_queuedPackets >= kMaxQueuedPackets)
+        {
+            // The workers are behind, drop the packet and reuse the buffer
+            ++droppedCount;
+        }
+        else
+        {
+            buffer.resize(static_cast<std::size_t>(actual));
+            auto &worker = *_packetWorkers[packetFlowHash(buffer) % _packetWorkers.size()];
+            worker.pending.packets.push_back(std::move(buffer));
+            buffer.clear(); // Take a new buffer for the next packet
+            ++_queuedPackets;
+            if(worker.pending.packets.size() >= kPacketBatchSize)
+                enqueuePending(worker);
+        }
+
+        // If packets remain, the device is still readable, so poll(2) will
+        // wake us again right away after any queued work items.
+        if(std::chrono::steady_clock::now() >= readDeadline)
+        {
+            budgetExhausted = true;
+            break;
+        }
     }
+
+    if(!buffer.empty())
+        _packetBuffers.give(std::move(buffer));
+    for(auto &pWorker : _packetWorkers)
+        enqueuePending(*pWorker);
+
+    _readStats.record(processedCount,
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - readStart),
+        budgetExhausted);
+    if(droppedCount)
+        _readStats.recordDropped(droppedCount);
+    _readStats.traceIfDue();
+}
+
+void MacSplitTunnel::enqueuePending(PacketWorker &worker)
+{
+    if(worker.pending.packets.empty())
+        return;
+    worker.thread.enqueue(std::move(worker.pending));
+    worker.pending = {};
+    worker.pending.packets.reserve(kPacketBatchSize);
+}
+
+void MacSplitTunnel::handleBatch(FlowShard &shard, PacketBatch &batch)
+{
+    for(auto &packet : batch.packets)
+        handleTunnelPacket(shard, {packet.data(), packet.size()});
+    _queuedPackets -= static_cast<unsigned>(batch.packets.size());
+    _packetBuffers.give(batch.packets);
 }
 
 static void applyExtraRules(std::vector<std::string> &paths)
@@ -425,12 +663,14 @@ void MacSplitTunnel::updateApps(std::vector<std::string> excludedApps, std::vect
     {
         _excludedApps = std::move(excludedApps);
         for(const auto &app : _excludedApps) KAPPS_CORE_INFO() << "Excluded Apps:" << app;
+        invalidateVerdicts();
     }
 
     if(_vpnOnlyApps != vpnOnlyApps)
     {
         _vpnOnlyApps = std::move(vpnOnlyApps);
         for(const auto &app : _vpnOnlyApps) KAPPS_CORE_INFO() << "VPN Only Apps:" << app;
+        invalidateVerdicts();
     }
 
     KAPPS_CORE_INFO() << "Updated apps";
@@ -559,8 +799,46 @@ void MacSplitTunnel::updateNetwork(const FirewallParams &params)
         // cycleSplitTunnelDevice();
     }
 
-    // Update our network info
+    // Update our network info.  Verdicts depend on the connection state, KS,
+    // and the VPN/physical addresses, so classify all flows again.
     _params = params;
+    invalidateVerdicts();
+}
+
+template <typename FlowType, typename PacketType>
+kapps::core::nullable_t<MacSplitTunnel::FlowVerdict>
+    MacSplitTunnel::takeCachedVerdict(FlowShard &shard, const PacketType &packet)
+{
+    FlowType flow{packet};
+    CachedVerdict *pCached = shard.flowVerdicts.find(flow);
+    if(!pCached)
+        return {};
+
+    FlowVerdict verdict{pCached->verdict};
+    if(pCached->generation != _verdictGeneration ||
+       pCached->expiry <= std::chrono::steady_clock::now())
+    {
+        shard.flowVerdicts.erase(flow);
+        return {};
+    }
+    if(packet.isTcpClosing())
+        shard.flowVerdicts.erase(flow);
+    return verdict;
+}
+
+template <typename FlowType, typename PacketType>
+void MacSplitTunnel::cacheVerdict(FlowShard &shard, const PacketType &packet,
+                                  FlowVerdict verdict)
+{
+    // Don't cache a verdict for a connection that's closing, it's about to
+    // be irrelevant
+    if(packet.isTcpClosing())
+        return;
+    // The caller holds _classifyMutex, so the generation can't change while
+    // the flow is classified
+    shard.flowVerdicts.insert(FlowType{packet},
+        {verdict, std::chrono::steady_clock::now() + kFlowVerdictLifetime,
+         _verdictGeneration});
 }
 
 bool MacSplitTunnel::isSplitPort(std::uint16_t port,
@@ -570,18 +848,25 @@ bool MacSplitTunnel::isSplitPort(std::uint16_t port,
     return contains(bypassPorts, port) || contains(vpnOnlyPorts, port);
 }
 
-void MacSplitTunnel::handleIp6(std::vector<unsigned char> buffer)
+void MacSplitTunnel::handleIp6(FlowShard &shard, core::ArraySlice<unsigned char> buffer)
 {
-    // Grab size for tracing in case the packet is invalid, since we move from buffer
-    auto actualSize = buffer.size();
     // skip the first 4 bytes (it stores AF_NET)
-    const auto pPacket = Packet6::createFromData(std::move(buffer), 4);
+    const auto pPacket = Packet6::createFromData(buffer, 4);
     if(!pPacket)
     {
-        KAPPS_CORE_WARNING() << "Packet is invalid; read" << actualSize << "bytes from utun";
+        KAPPS_CORE_WARNING() << "Packet is invalid; read" << buffer.size() << "bytes from utun";
         return;
     }
 
+    // Packets of a flow that was already classified skip the lookups below.
+    // IPv6 packets aren't re-injected, so there's nothing else to do with
+    // them.  (No verdicts are cached while connected, connecting invalidates
+    // them and IPv6 packets aren't classified while connected.)
+    if(takeCachedVerdict<PacketFlow6>(shard, *pPacket))
+        return;
+
+    std::lock_guard<std::mutex> lock{_classifyMutex};
+
     if(_params.isConnected)
     {
         // Do not allow any ipv6 packets when connected
@@ -599,8 +884,9 @@ void MacSplitTunnel::handleIp6(std::vector<unsigned char> buffer)
     _defaultAppsCache.refresh(IPv6, _params.netScan);
 
     // Get ports for our tracked apps
-    auto bypassPorts = PortFinder::ports(_excludedApps, IPv6, _params.netScan);
-    auto vpnOnlyPorts = PortFinder::ports(_vpnOnlyApps, IPv6, _params.netScan);
+    _processPaths.refresh();
+    auto bypassPorts = PortFinder::ports(_processPaths.pids(_excludedApps), IPv6, _params.netScan);
+    auto vpnOnlyPorts = PortFinder::ports(_processPaths.pids(_vpnOnlyApps), IPv6, _params.netScan);
     auto defaultPorts = _defaultAppsCache.ports(IPv6);
 
     // These packets seem to have protocol 255, so drop them
@@ -611,6 +897,7 @@ void MacSplitTunnel::handleIp6(std::vector<unsigned char> buffer)
     if(!_params.isConnected && pPacket->sourcePort() && contains(vpnOnlyPorts, pPacket->sourcePort()))
     {
         KAPPS_CORE_INFO() << "Dropping an Ipv6 vpnOnly packet";
+        cacheVerdict<PacketFlow6>(shard, *pPacket, FlowVerdict::Drop);
         return;
     }
 
@@ -638,7 +925,7 @@ void MacSplitTunnel::handleIp6(std::vector<unsigned char> buffer)
     if(_params.blockAll && !_params.isConnected)
         defaultPorts.clear();
 
-    if(_flowTracker.track(*pPacket) == FlowTracker::RepeatedFlow)
+    if(shard.flowTracker.track(*pPacket) == FlowTracker::RepeatedFlow)
     {
         KAPPS_CORE_INFO() << "Observed repeated packet (> 10 times), dropping" << pPacket->toString();
         return;
@@ -648,6 +935,11 @@ void MacSplitTunnel::handleIp6(std::vector<unsigned char> buffer)
     _bypassRuleUpdater.update(IPv6, bypassPorts, _params);
     _vpnOnlyRuleUpdater.update(IPv6, vpnOnlyPorts, _params);
 
+    cacheVerdict<PacketFlow6>(shard, *pPacket,
+        contains(bypassPorts, pPacket->sourcePort()) ? FlowVerdict::Bypass :
+        contains(vpnOnlyPorts, pPacket->sourcePort()) ? FlowVerdict::VpnOnly :
+        FlowVerdict::Default);
+
     // Re-inject the packet
     // Left out for now as IPv6 packet re-injection doesn't
     // work as IPv6 packets are not injected with IP headers intact
@@ -656,28 +948,43 @@ void MacSplitTunnel::handleIp6(std::vector<unsigned char> buffer)
     // TODO: look into data link layer IPv6 injection via PF_NDRV sockets
 }
 
-void MacSplitTunnel::handleIp4(std::vector<unsigned char> buffer)
+void MacSplitTunnel::handleIp4(FlowShard &shard, core::ArraySlice<unsigned char> buffer)
 {
-    // Grab size for tracing in case the packet is invalid, since we move from buffer
-    auto actualSize = buffer.size();
     // skip the first 4 bytes (it stores AF_NET)
-    const auto pPacket = Packet::createFromData(std::move(buffer), 4);
+    const auto pPacket = Packet::createFromData(buffer, 4);
     if(!pPacket)
     {
-        KAPPS_CORE_WARNING() << "Packet is invalid; read" << actualSize << "bytes from stun";
+        KAPPS_CORE_WARNING() << "Packet is invalid; read" << buffer.size() << "bytes from stun";
         return;
     }
 
-    PiaConnections piaConnections{_executableDir, _params.tunnelDeviceLocalAddress,
-        _params.netScan.ipAddress()};
+    // Packets of a flow that was already classified skip the lookups below
+    if(auto cachedVerdict = takeCachedVerdict<PacketFlow4>(shard, *pPacket))
+    {
+        if(*cachedVerdict == FlowVerdict::Drop)
+            return;
+        if(shard.flowTracker.track(*pPacket) == FlowTracker::RepeatedFlow)
+        {
+            KAPPS_CORE_INFO() << "Observed repeated packet (> 10 times), dropping" << pPacket->toString();
+            return;
+        }
+        reinjectIp4(*pPacket);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock{_classifyMutex};
+
+    _processPaths.refresh();
+    PiaConnections piaConnections{_processPaths.pids({_executableDir}),
+        _params.tunnelDeviceLocalAddress, _params.netScan.ipAddress()};
 
     // Update the cache for non-split apps, to keep track of the ports we care about
     // when generating firewall rules
     _defaultAppsCache.refresh(IPv4, _params.netScan);
 
     // Get ports for our tracked apps
-    auto bypassPorts = PortFinder::ports(_excludedApps, IPv4, _params.netScan);
-    auto vpnOnlyPorts = PortFinder::ports(_vpnOnlyApps, IPv4, _params.netScan);
+    auto bypassPorts = PortFinder::ports(_processPaths.pids(_excludedApps), IPv4, _params.netScan);
+    auto vpnOnlyPorts = PortFinder::ports(_processPaths.pids(_vpnOnlyApps), IPv4, _params.netScan);
     auto defaultPorts = _defaultAppsCache.ports(IPv4);
 
     // These packets seem to have protocol 255, so drop them
@@ -697,6 +1004,7 @@ void MacSplitTunnel::handleIp4(std::vector<unsigned char> buffer)
         KAPPS_CORE_INFO() << "Dropping an Ipv4 vpnOnly packet " << pPacket->toString()
           << "for pid" << pid << "and path" << PortFinder::pidToPath(pid);
 
+        cacheVerdict<PacketFlow4>(shard, *pPacket, FlowVerdict::Drop);
         return;
     }
 
@@ -718,7 +1026,7 @@ void MacSplitTunnel::handleIp4(std::vector<unsigned char> buffer)
     if(destAddress.isMulticast() || destAddress.isBroadcast() || (destAddress.toString() == _splitTunnelIp.ip4()))
         return; // We drop a packet by just returning
 
-    if(_flowTracker.track(*pPacket) == FlowTracker::RepeatedFlow)
+    if(shard.flowTracker.track(*pPacket) == FlowTracker::RepeatedFlow)
     {
         KAPPS_CORE_INFO() << "Observed repeated packet (> 10 times), dropping" << pPacket->toString();
         return;
@@ -735,21 +1043,30 @@ void MacSplitTunnel::handleIp4(std::vector<unsigned char> buffer)
     _bypassRuleUpdater.update(IPv4, bypassPorts, _params);
     _vpnOnlyRuleUpdater.update(IPv4, vpnOnlyPorts, _params);
 
-    //KAPPS_CORE_INFO() << "Re-injecting IPv4 packet:" << pPacket->toString();
+    cacheVerdict<PacketFlow4>(shard, *pPacket,
+        contains(bypassPorts, pPacket->sourcePort()) ? FlowVerdict::Bypass :
+        contains(vpnOnlyPorts, pPacket->sourcePort()) ? FlowVerdict::VpnOnly :
+        FlowVerdict::Default);
+
+    reinjectIp4(*pPacket);
+}
+
+void MacSplitTunnel::reinjectIp4(const Packet &packet)
+{
+    //KAPPS_CORE_INFO() << "Re-injecting IPv4 packet:" << packet.toString();
 
-    // Re-inject the packet
     sockaddr_in to{};
     to.sin_family = AF_INET;
-    to.sin_addr.s_addr = htonl(pPacket->destAddress());
+    to.sin_addr.s_addr = htonl(packet.destAddress());
 
-    if(::sendto(_rawFd4->get(), pPacket->toRaw(), pPacket->len() , 0, reinterpret_cast<sockaddr *>(&to), sizeof(to)) == -1)
+    if(::sendto(_rawFd4->get(), packet.toRaw(), packet.len() , 0, reinterpret_cast<sockaddr *>(&to), sizeof(to)) == -1)
     {
-        KAPPS_CORE_WARNING() << "Unable to reinject packet" << pPacket->toString() << "-"
+        KAPPS_CORE_WARNING() << "Unable to reinject packet" << packet.toString() << "-"
             << kapps::core::ErrnoTracer{errno};
     }
 }
 
-void MacSplitTunnel::handleTunnelPacket(std::vector<unsigned char> buffer)
+void MacSplitTunnel::handleTunnelPacket(FlowShard &shard, core::ArraySlice<unsigned char> buffer)
 {
     // First 4 bytes indicate address family (IPv4 or IPv6)
     if(buffer.size() < sizeof(std::uint32_t))
@@ -763,10 +1080,10 @@ void MacSplitTunnel::handleTunnelPacket(std::vector<unsigned char> buffer)
     switch(addressFamily)
     {
     case AF_INET:
-        handleIp4(std::move(buffer));
+        handleIp4(shard, buffer);
         break;
     case AF_INET6:
-        handleIp6(std::move(buffer));
+        handleIp6(shard, buffer);
         break;
     default:
         KAPPS_CORE_WARNING() << "Unsupported address family:" << addressFamily;
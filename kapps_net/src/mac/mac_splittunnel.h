@@ -33,7 +33,13 @@
 #include "../firewallparams.h"
 #include <kapps_core/src/newexec.h>
 #include <kapps_core/src/posix/posixfdnotifier.h>
+#include <kapps_core/src/stopwatch.h>
+#include <kapps_core/src/workqueue.h>
 #include "flow_tracker.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 
 namespace kapps { namespace net {
 struct KAPPS_NET_EXPORT AboutToConnect
@@ -59,6 +65,55 @@ private:
      std::array<PortLookupTable, 2> _cache;
 };
 
+// Statistics on draining packets from the utun device on each wake-up.  These
+// are traced periodically so the read budget can be evaluated - the time spent
+// per wake-up is also how long any work items queued for the split tunnel
+// thread (like reconfiguring split tunnel) can be delayed.
+class KAPPS_NET_EXPORT PacketReadStats
+{
+public:
+    // Record one wake-up: the number of packets handled, the time spent, and
+    // whether the read stopped because the time budget was used up (rather
+    // than because no packets were left).
+    void record(unsigned packets, std::chrono::microseconds elapsed,
+                bool budgetExhausted);
+    // Record packets dropped because the packet workers fell behind.
+    void recordDropped(unsigned packets) {_dropped += packets;}
+    // Trace and reset the stats if the trace interval has elapsed.
+    void traceIfDue();
+
+private:
+    core::Stopwatch _interval;
+    unsigned _wakes{0};
+    unsigned _packets{0};
+    unsigned _maxPackets{0};
+    unsigned _budgetExhausted{0};
+    unsigned _dropped{0};
+    std::chrono::microseconds _totalElapsed{0};
+    std::chrono::microseconds _maxElapsed{0};
+};
+
+// Packet buffers shared by the utun reader and the packet workers.  The reader
+// takes a buffer for each packet, and the workers give them back once the
+// packets are handled, so buffers are only allocated when the number of
+// packets in flight grows.
+class KAPPS_NET_EXPORT PacketBufferPool
+{
+public:
+    using Buffer = std::vector<unsigned char>;
+
+public:
+    // Take a buffer with the given size (the contents are unspecified).
+    Buffer take(std::size_t size);
+    // Return buffers to the pool; this leaves 'buffers' empty.
+    void give(std::vector<Buffer> &buffers);
+    void give(Buffer buffer);
+
+private:
+    std::mutex _mutex;
+    std::vector<Buffer> _free;
+};
+
 class KAPPS_NET_EXPORT SplitTunnelIp
 {
 public:
@@ -117,9 +172,7 @@ private:
     bool isSplitPort(std::uint16_t port,
                      const PortSet &bypassPorts,
                      const PortSet &vpnOnlyPorts);
-    void handleIp6(std::vector<unsigned char> buffer);
-    void handleIp4(std::vector<unsigned char> buffer);
-    void handleTunnelPacket(std::vector<unsigned char> buffer);
+    void reinjectIp4(const Packet &packet);
 
 private:
     enum class State
@@ -128,15 +181,86 @@ private:
         Inactive
     };
 
+    // How a flow read from the utun device was handled
+    enum class FlowVerdict
+    {
+        Bypass,
+        VpnOnly,
+        Default,
+        Drop
+    };
+
+    struct CachedVerdict
+    {
+        FlowVerdict verdict;
+        std::chrono::steady_clock::time_point expiry;
+        // _verdictGeneration when this verdict was reached
+        unsigned generation;
+    };
+
+    // The flow state used to handle packets.  Packets are assigned to packet
+    // workers by flow, so each worker owns a shard of the flow state and
+    // never shares it with other workers.
+    struct FlowShard
+    {
+        FlowTracker flowTracker;
+        // Verdicts for flows that have been classified.  Later packets of
+        // the same flow are handled from this cache, skipping the
+        // process/port lookups.
+        FlowCache<CachedVerdict> flowVerdicts;
+    };
+
+    // A batch of packets read from the utun device for one packet worker
+    struct PacketBatch
+    {
+        std::vector<PacketBufferPool::Buffer> packets;
+    };
+
+    // A thread handling the packets for a shard of the flows
+    struct PacketWorker
+    {
+        PacketWorker(MacSplitTunnel &splitTunnel);
+
+        FlowShard shard;
+        // Packets read for this worker during the current wake-up, enqueued
+        // when the wake-up ends
+        PacketBatch pending;
+        // Destroyed first, so the thread exits before the shard is destroyed
+        core::WorkThread thread;
+    };
+
+    void handleIp6(FlowShard &shard, core::ArraySlice<unsigned char> buffer);
+    void handleIp4(FlowShard &shard, core::ArraySlice<unsigned char> buffer);
+    void handleTunnelPacket(FlowShard &shard, core::ArraySlice<unsigned char> buffer);
+    // Handle a batch of packets on a packet worker thread
+    void handleBatch(FlowShard &shard, PacketBatch &batch);
+    // Enqueue a packet worker's pending packets
+    void enqueuePending(PacketWorker &worker);
+    // Classify flows again - invalidates all cached verdicts
+    void invalidateVerdicts() {++_verdictGeneration;}
+
+    // Find the cached verdict for a packet's flow, if there is one that hasn't
+    // expired.  If the packet closes a TCP connection, the verdict is returned
+    // for this packet but removed from the cache.
+    template <typename FlowType, typename PacketType>
+    kapps::core::nullable_t<FlowVerdict> takeCachedVerdict(FlowShard &shard,
+                                                           const PacketType &packet);
+    template <typename FlowType, typename PacketType>
+    void cacheVerdict(FlowShard &shard, const PacketType &packet, FlowVerdict verdict);
+
 private:
     PFFirewall &_filter;
     kapps::core::nullable_t<kapps::core::PosixFd> _rawFd4;
     kapps::core::nullable_t<UTun> _pUtun;
     kapps::core::PosixFdNotifier _utunNotifier;
+    PacketReadStats _readStats;
     State _state{State::Inactive};
     std::vector<std::string> _excludedApps;
     std::vector<std::string> _vpnOnlyApps;
     AppCache _defaultAppsCache;
+    // Paths of running processes, used to find the processes of the bypass,
+    // VPN-only, and PIA apps
+    ProcessPathCache _processPaths;
     RuleUpdater _bypassRuleUpdater;
     RuleUpdater _vpnOnlyRuleUpdater;
     RuleUpdater _defaultRuleUpdater;
@@ -147,8 +271,31 @@ private:
     std::string _ipForwarding6;
     bool _routesUp{false};
 
-    FlowTracker _flowTracker;
     std::string _executableDir;
+
+    // Classifying a flow uses the state above - the app lists, network
+    // parameters, app cache, and rule updaters.  Packet workers classify
+    // flows while holding this mutex, and the split tunnel thread holds it
+    // while changing that state.  Packets of flows that were already
+    // classified don't need it.
+    std::mutex _classifyMutex;
+    // Cached verdicts are only valid for the generation they were reached in;
+    // this is incremented when the app lists or network change.
+    std::atomic<unsigned> _verdictGeneration{0};
+
+    // Receive buffers for packets read from the utun device
+    PacketBufferPool _packetBuffers;
+    // Number of packets enqueued to packet workers and not handled yet
+    std::atomic<unsigned> _queuedPackets{0};
+    // Flow state used when packets are handled on the split tunnel thread,
+    // when there's only one CPU core to use
+    FlowShard _inlineShard;
+    // Packet workers - packets are assigned to a worker by a hash of their
+    // flow, so the packets of each flow are handled in order.  These are
+    // created when the utun device is opened, and destroyed before it's
+    // closed.  If this is empty, packets are handled on the split tunnel
+    // thread using _inlineShard.
+    std::vector<std::unique_ptr<PacketWorker>> _packetWorkers;
 };
 
 }}
@@ -19,10 +19,23 @@
 #include "packet.h"
 #include <kapps_core/src/logger.h>
 #include <kapps_core/src/ipaddress.h>
+#include <cstring>
 
 namespace kapps { namespace net {
 
-core::nullable_t<Packet> Packet::createFromData(std::vector<unsigned char> data,
+namespace
+{
+    // Get the TCP flags from a TCP header at the given offset, or 0 if the
+    // packet is too short to contain a complete TCP header.
+    std::uint8_t tcpFlags(core::ArraySlice<unsigned char> data, std::size_t offset)
+    {
+        if(data.size() < offset + sizeof(tcphdr))
+            return 0;
+        return reinterpret_cast<const tcphdr*>(data.data() + offset)->th_flags;
+    }
+}
+
+core::nullable_t<Packet> Packet::createFromData(core::ArraySlice<unsigned char> data,
                                           unsigned skipBytes)
 {
     // Must contain an IP header, we read these fields
@@ -69,22 +82,64 @@ core::nullable_t<Packet> Packet::createFromData(std::vector<unsigned char> data,
         pTransportHdr = reinterpret_cast<TransportPortHeader *>(pPkt + ipHdrLen);
     }
 
-    return Packet{std::move(data), pIpHdr, pTransportHdr};
+    Packet packet{pIpHdr, pTransportHdr};
+    if(pIpHdr->ip_p == IPPROTO_TCP)
+        packet._tcpFlags = tcpFlags(data, skipBytes + pIpHdr->ip_hl * 4);
+    return packet;
 }
 
-std::uint16_t Packet::csum(const std::uint16_t *pData, int words)
+std::uint16_t Packet::checksum(const void *pData, std::size_t len)
 {
-    std::uint_fast32_t checksumTotal{};
-    const std::uint16_t *pDataEnd = pData + (words);
-    while(pData != pDataEnd)
+    // Sum 32 bits at a time into a 64-bit accumulator - the carries are all
+    // kept in the upper bits and folded at the end, which gives the same
+    // result as summing 16-bit words (RFC 1071, section 2(B)) with half as
+    // many additions.
+    const unsigned char *pBytes = reinterpret_cast<const unsigned char*>(pData);
+    std::uint_fast64_t sum{};
+    while(len >= sizeof(std::uint32_t))
+    {
+        std::uint32_t dword;
+        std::memcpy(&dword, pBytes, sizeof(dword));
+        sum += dword;
+        pBytes += sizeof(dword);
+        len -= sizeof(dword);
+    }
+    if(len >= sizeof(std::uint16_t))
+    {
+        std::uint16_t word;
+        std::memcpy(&word, pBytes, sizeof(word));
+        sum += word;
+        pBytes += sizeof(word);
+        len -= sizeof(word);
+    }
+    if(len)
     {
-        checksumTotal += *pData;
-        ++pData;
+        // Pad the odd byte with zero, keeping the data's byte order
+        std::uint16_t word{};
+        std::memcpy(&word, pBytes, 1);
+        sum += word;
     }
 
-    checksumTotal = (checksumTotal & 0x0000FFFF) + (checksumTotal >> 16);
-    checksumTotal += (checksumTotal >> 16);
-    return static_cast<std::uint16_t>(~checksumTotal);
+    // Fold the 64-bit sum to 16 bits
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<std::uint16_t>(~sum);
+}
+
+std::uint16_t Packet::updateChecksum(std::uint16_t checksum,
+                                     std::uint16_t oldWord,
+                                     std::uint16_t newWord)
+{
+    // HC' = ~(~HC + ~m + m')
+    std::uint_fast32_t sum = static_cast<std::uint16_t>(~checksum);
+    sum += static_cast<std::uint16_t>(~oldWord);
+    sum += newWord;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<std::uint16_t>(~sum);
 }
 
 std::string Packet::toString() const
@@ -112,7 +167,7 @@ Packet::PacketType Packet::packetType() const
         return Other;
 }
 
-core::nullable_t<Packet6> Packet6::createFromData(std::vector<unsigned char> data,
+core::nullable_t<Packet6> Packet6::createFromData(core::ArraySlice<unsigned char> data,
                                             unsigned skipBytes)
 {
     // Must contain an IPv6 header, we read these fields
@@ -222,7 +277,10 @@ core::nullable_t<Packet6> Packet6::createFromData(std::vector<unsigned char> dat
         pTransportHdr = reinterpret_cast<TransportPortHeader *>(data.data() + transportHeaderOffset);
     }
 
-    return Packet6{std::move(data), nextHeader, pIpHdr, pTransportHdr};
+    Packet6 packet{nextHeader, pIpHdr, pTransportHdr};
+    if(nextHeader == IPPROTO_TCP)
+        packet._tcpFlags = tcpFlags(data, transportHeaderOffset);
+    return packet;
 }
 
 Packet6::PacketType Packet6::packetType() const
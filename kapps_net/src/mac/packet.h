@@ -21,6 +21,7 @@
 #include <kapps_net/net.h>
 #include <vector>
 #include <kapps_core/src/util.h>
+#include <kapps_core/src/stringslice.h>
 #include <netinet/ip.h>
 #include <netinet/ip6.h>
 #include <netinet/tcp.h>
@@ -36,6 +37,9 @@ struct TransportPortHeader
     std::uint16_t dport;
 };
 
+// Packet and Packet6 are views over a packet buffer owned by the caller - they
+// don't copy the data, so the buffer must outlive the Packet/Packet6 (and the
+// split tunnel reuses one receive buffer for every packet).
 class Packet
 {
 public:
@@ -47,21 +51,34 @@ public:
     };
 
 public:
-    static core::nullable_t<Packet> createFromData(std::vector<unsigned char> data,
+    // Interpret a packet buffer.  The IP header is modified in place to
+    // prepare the packet for re-injection.
+    static core::nullable_t<Packet> createFromData(core::ArraySlice<unsigned char> data,
                                              unsigned skipBytes);
 
 public:
-    Packet(std::vector<unsigned char> data, ip *pIpHdr, TransportPortHeader *pTransportHdr)
-        : _data{std::move(data)}, _ipHdr{pIpHdr}, _transportHdr{pTransportHdr}
+    Packet(ip *pIpHdr, TransportPortHeader *pTransportHdr)
+        : _ipHdr{pIpHdr}, _transportHdr{pTransportHdr}
     {
         // Prepare data for re-injection
-        // ip_len and ip_off must be in host order (macOS quirk)
-        _ipHdr->ip_len = ntohs(_ipHdr->ip_len);
-        _ipHdr->ip_off = ntohs(_ipHdr->ip_off);
-        _ipHdr->ip_sum = 0;
-        _ipHdr->ip_sum = csum(reinterpret_cast<const std::uint16_t *>(_ipHdr), _ipHdr->ip_len);
+        // ip_len and ip_off must be in host order (macOS quirk).  Only these
+        // two words change, so the header checksum is updated incrementally
+        // rather than summing the whole header again.
+        setHeaderWord(_ipHdr->ip_len, ntohs(_ipHdr->ip_len));
+        setHeaderWord(_ipHdr->ip_off, ntohs(_ipHdr->ip_off));
     }
 
+    // Compute the Internet checksum (one's complement of the one's complement
+    // sum of 16-bit words, RFC 1071) of a buffer.  An odd trailing byte is
+    // padded with zero.  The result is in the same byte order as the data.
+    static std::uint16_t checksum(const void *pData, std::size_t len);
+
+    // Incrementally update a checksum when one 16-bit word that it covers
+    // changes from oldWord to newWord (RFC 1624, eqn. 3).
+    static std::uint16_t updateChecksum(std::uint16_t checksum,
+                                        std::uint16_t oldWord,
+                                        std::uint16_t newWord);
+
     // ip->ip_len
     std::uint16_t len() const { return _ipHdr->ip_len; }
 
@@ -78,19 +95,28 @@ public:
     std::uint32_t sourceAddress() const { return ntohl(_ipHdr->ip_src.s_addr); }
     std::uint32_t destAddress() const { return ntohl(_ipHdr->ip_dst.s_addr); }
 
+    // Whether this is a TCP FIN or RST, meaning the connection is closing
+    bool isTcpClosing() const {return _tcpFlags & (TH_FIN | TH_RST);}
+
     std::string toString() const;
 
     // Get the raw data for re-injection
     ip * toRaw() const { return _ipHdr; }
 
 private:
-    std::uint16_t csum(const std::uint16_t *buf, int words);
+    // Change a 16-bit word of the IP header and update the header checksum
+    void setHeaderWord(std::uint16_t &word, std::uint16_t value)
+    {
+        _ipHdr->ip_sum = updateChecksum(_ipHdr->ip_sum, word, value);
+        word = value;
+    }
 
 private:
-    // Actual packet data buffer (_ipHdr and _transportHdr point to this)
-    std::vector<unsigned char> _data;
+    // Headers within the caller's packet buffer
     ip * _ipHdr;
     TransportPortHeader * _transportHdr;
+    // TCP flags (th_flags) if this is a TCP packet with a complete header
+    std::uint8_t _tcpFlags{0};
 };
 
 class Packet6
@@ -104,12 +130,12 @@ public:
     };
 
 public:
-    static core::nullable_t<Packet6> createFromData(std::vector<unsigned char> data,
+    static core::nullable_t<Packet6> createFromData(core::ArraySlice<unsigned char> data,
                                               unsigned skipBytes);
 public:
-    Packet6(std::vector<unsigned char> data, std::uint8_t transportProtocol,
-           ip6_hdr *pIpHdr, TransportPortHeader *pTransportHdr)
-        : _data{std::move(data)}, _transportProtocol{transportProtocol},
+    Packet6(std::uint8_t transportProtocol, ip6_hdr *pIpHdr,
+            TransportPortHeader *pTransportHdr)
+        : _transportProtocol{transportProtocol},
           _ipHdr{pIpHdr}, _transportHdr{pTransportHdr}
     {
     }
@@ -127,17 +153,21 @@ public:
     const in6_addr& sourceAddress() const {return _ipHdr->ip6_src;}
     const in6_addr& destAddress() const {return _ipHdr->ip6_dst;}
 
+    // Whether this is a TCP FIN or RST, meaning the connection is closing
+    bool isTcpClosing() const {return _tcpFlags & (TH_FIN | TH_RST);}
+
     std::string toString() const;
 
     // Get the raw data for re-injection
     ip6_hdr * toRaw() const { return _ipHdr; }
 
 private:
-    // Actual packet data buffer (_ipHdr and _transportHdr point to this)
-    std::vector<unsigned char> _data;
     std::uint8_t _transportProtocol;
+    // Headers within the caller's packet buffer
     ip6_hdr * _ipHdr;
     TransportPortHeader * _transportHdr;
+    // TCP flags (th_flags) if this is a TCP packet with a complete header
+    std::uint8_t _tcpFlags{0};
 };
 
 }}
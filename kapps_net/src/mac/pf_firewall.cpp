@@ -24,11 +24,16 @@
 #include "../firewall.h"
 #include <kapps_core/src/newexec.h>
 #include <kapps_core/src/util.h>
+#include <algorithm>
 
 namespace kapps { namespace net {
 
 namespace
 {
+    // Content descriptions for disabled anchors/tables, see
+    // PFFirewall::AnchorContent
+    const std::string kAnchorDisabled{"off"};
+
     const std::string kPfWarning = "pfctl: Use of -f option, could result in flushing of rules\npresent in the main ruleset added by the system at startup.\nSee /etc/pf.conf for further details.\n";
     kapps::core::Executor _pfExecutor{KAPPS_CORE_CURRENT_CATEGORY, kPfWarning};
 }
@@ -47,6 +52,9 @@ void PFFirewall::installRootAnchors()
 {
     KAPPS_CORE_INFO() << "Installing PF root anchors";
 
+    // Reloading the root anchor may reset the sub-anchors
+    clearAnchorContent();
+
     // Append our NAT anchors by reading back and re-applying NAT rules only
     auto insertNatAnchors = qs::format(
         "( "
@@ -95,10 +103,57 @@ std::string PFFirewall::getMacroArgs(const MacroPairs& macroPairs)
     std::vector<std::string> macroVec;
     for(const auto &pair : macroPairs)
         macroVec.push_back(qs::format("-D%=%", pair.first, pair.second));
+    // Sort so the same macros always produce the same arguments - these also
+    // identify the content of an anchor
+    std::sort(macroVec.begin(), macroVec.end());
 
     return qs::joinVec(macroVec, " ");
 }
 
+bool PFFirewall::hasAnchorRules(const std::string &anchor, const std::string &content)
+{
+    std::lock_guard<std::mutex> lock{_anchorContentMutex};
+    auto itAnchor = _anchorContent.find(anchor);
+    return itAnchor != _anchorContent.end() && itAnchor->second.rules == content;
+}
+
+bool PFFirewall::hasAnchorTable(const std::string &anchor, const std::string &table,
+                                const std::string &content)
+{
+    std::lock_guard<std::mutex> lock{_anchorContentMutex};
+    auto itAnchor = _anchorContent.find(anchor);
+    if(itAnchor == _anchorContent.end())
+        return false;
+    auto itTable = itAnchor->second.tables.find(table);
+    return itTable != itAnchor->second.tables.end() && itTable->second == content;
+}
+
+void PFFirewall::storeAnchorRules(const std::string &anchor, const std::string &content,
+                                  bool succeeded)
+{
+    std::lock_guard<std::mutex> lock{_anchorContentMutex};
+    if(succeeded)
+        _anchorContent[anchor] = {content, {}};
+    else
+        _anchorContent.erase(anchor);
+}
+
+void PFFirewall::storeAnchorTable(const std::string &anchor, const std::string &table,
+                                  const std::string &content, bool succeeded)
+{
+    std::lock_guard<std::mutex> lock{_anchorContentMutex};
+    if(succeeded)
+        _anchorContent[anchor].tables[table] = content;
+    else
+        _anchorContent[anchor].tables.erase(table);
+}
+
+void PFFirewall::clearAnchorContent()
+{
+    std::lock_guard<std::mutex> lock{_anchorContentMutex};
+    _anchorContent.clear();
+}
+
 void PFFirewall::install()
 {
     // remove hard-coded (legacy) pia anchor from /etc/pf.conf if it exists
@@ -120,6 +175,8 @@ void PFFirewall::uninstall()
 {
     KAPPS_CORE_INFO() << "Uninstalling PF root anchor";
 
+    clearAnchorContent();
+
     // Flush our rules if any of our root anchors are loaded
     if (areAnyRootAnchorsLoaded())
         execute(qs::format("pfctl -q -a '%' -F all", _rootAnchor));
@@ -140,14 +197,33 @@ void PFFirewall::enableAnchor(const kapps::core::StringSlice &anchor,
                               const kapps::core::StringSlice &modifier,
                               const MacroPairs &macroPairs)
 {
-    execute(qs::format("if pfctl -q -a '%/%' -s % 2> /dev/null | grep -q . ; then echo '%: ON' ; else echo '%: OFF -> ON' ; pfctl -q -a '%/%' -F all % -f '%/pf/%.%.conf' ; fi", _rootAnchor, anchor, modifier, anchor,
-        anchor, _rootAnchor, anchor, getMacroArgs(macroPairs), _config.resourceDir, _rootAnchor, anchor));
+    const std::string anchorStr{anchor.to_string()};
+    const std::string macroArgs{getMacroArgs(macroPairs)};
+    // The anchor is loaded from its file with these macros
+    const std::string content{qs::format("% %", modifier, macroArgs)};
+    if(hasAnchorRules(anchorStr, content))
+        return;
+
+    KAPPS_CORE_INFO() << anchor << ": -> ON" << macroArgs;
+    // Loading with -f replaces the anchor's rules in one transaction, so
+    // there's no point where the anchor is empty.  This also reloads the
+    // anchor if the macros have changed.
+    int result = execute(qs::format("pfctl -q -a '%/%' % -f '%/pf/%.%.conf'",
+        _rootAnchor, anchor, macroArgs, _config.resourceDir, _rootAnchor, anchor));
+    FirewallCounters::countRules(1);
+    storeAnchorRules(anchorStr, content, result == 0);
 }
 
 void PFFirewall::disableAnchor(const kapps::core::StringSlice &anchor,
-                               const kapps::core::StringSlice &modifier)
+                               const kapps::core::StringSlice &)
 {
-    execute(qs::format("if ! pfctl -q -a '%/%' -s % 2> /dev/null | grep -q . ; then echo '%: OFF' ; else echo '%: ON -> OFF' ; pfctl -q -a '%/%' -F all ; fi", _rootAnchor, anchor, modifier, anchor, anchor, _rootAnchor, anchor));
+    const std::string anchorStr{anchor.to_string()};
+    if(hasAnchorRules(anchorStr, kAnchorDisabled))
+        return;
+
+    KAPPS_CORE_INFO() << anchor << ": -> OFF";
+    int result = execute(qs::format("pfctl -q -a '%/%' -F all", _rootAnchor, anchor));
+    storeAnchorRules(anchorStr, kAnchorDisabled, result == 0);
 }
 
 void PFFirewall::setAnchorEnabled(const kapps::core::StringSlice &anchor,
@@ -164,10 +240,21 @@ void PFFirewall::setAnchorTable(const kapps::core::StringSlice &anchor,
                                 bool enabled, const kapps::core::StringSlice &table,
                                 const std::vector<std::string>& items)
 {
+    const std::string anchorStr{anchor.to_string()};
+    const std::string tableStr{table.to_string()};
+    const std::string itemsStr{qs::joinVec(items, " ")};
+    const std::string content{enabled ? qs::format("items %", std::hash<std::string>{}(itemsStr))
+                                      : kAnchorDisabled};
+    if(hasAnchorTable(anchorStr, tableStr, content))
+        return;
+
+    int result;
     if(enabled)
-        execute(qs::format("pfctl -q -a '%/%' -t '%' -T replace %", _rootAnchor, anchor, table, qs::joinVec(items, " ")));
+        result = execute(qs::format("pfctl -q -a '%/%' -t '%' -T replace %", _rootAnchor, anchor, table, itemsStr));
     else
-        execute(qs::format("pfctl -q -a '%/%' -t '%' -T kill", _rootAnchor, anchor, table), true);
+        result = execute(qs::format("pfctl -q -a '%/%' -t '%' -T kill", _rootAnchor, anchor, table), true);
+    // If killing the table fails, it's because it doesn't exist, which is fine
+    storeAnchorTable(anchorStr, tableStr, content, result == 0 || !enabled);
 }
 
 void PFFirewall::setFilterEnabled(const kapps::core::StringSlice &anchor,
@@ -179,10 +266,25 @@ void PFFirewall::setFilterEnabled(const kapps::core::StringSlice &anchor,
 void PFFirewall::setFilterWithRules(const kapps::core::StringSlice &anchor,
                                     bool enabled, const std::vector<std::string> &ruleList)
 {
+    const std::string anchorStr{anchor.to_string()};
+    const std::string rules{qs::joinVec(ruleList, "\n")};
+    const std::string content{enabled ? qs::format("rules %", std::hash<std::string>{}(rules))
+                                      : kAnchorDisabled};
+    if(hasAnchorRules(anchorStr, content))
+        return;
+
     if(!enabled)
-        return (void)execute(qs::format("pfctl -q -a '%/%' -F all", _rootAnchor, anchor), true);
+    {
+        // Flushing an anchor that doesn't exist yet fails, which is fine
+        execute(qs::format("pfctl -q -a '%/%' -F all", _rootAnchor, anchor), true);
+        storeAnchorRules(anchorStr, content, true);
+    }
     else
-        return (void)execute(qs::format("echo -e \"%\" | pfctl -q -a '%/%' -f -", qs::joinVec(ruleList, "\n"), _rootAnchor, anchor));
+    {
+        int result = execute(qs::format("echo -e \"%\" | pfctl -q -a '%/%' -f -", rules, _rootAnchor, anchor));
+        FirewallCounters::countRules(1);
+        storeAnchorRules(anchorStr, content, result == 0);
+    }
 }
 
 void PFFirewall::setTranslationEnabled(const kapps::core::StringSlice &anchor,
@@ -23,6 +23,7 @@
 #include <kapps_net/net.h>
 #include "../firewall.h" // For FirewallConfig
 #include <unordered_map>
+#include <mutex>
 #include <string>
 
 namespace kapps { namespace net {
@@ -31,7 +32,9 @@ namespace kapps { namespace net {
 // implemented in macOS.  It provides the primitive operations we need to
 // enable/disable anchors, set the content of an anchor, etc.
 //
-// This is essentially a driver for PF and has no mutable state of its own.
+// This is essentially a driver for PF.  The only state of its own is a record of
+// the content last loaded into each anchor, so an anchor is only reloaded (with
+// a pfctl process) when its content actually changes.
 // Thread-safety is required as this is used by both the main firewall logic and
 // the macOS split tunnel implementation (from its own worker thread).
 class KAPPS_NET_EXPORT PFFirewall
@@ -48,6 +51,29 @@ private:
     bool areAnyRootAnchorsLoaded();
     std::string getMacroArgs(const MacroPairs& macroPairs);
 
+    // The content loaded into an anchor, as last set by PFFirewall.  These are
+    // descriptions of the content - the file and macros an anchor was loaded
+    // from, or a hash of rules/table items - not the content itself.
+    struct AnchorContent
+    {
+        std::string rules;
+        std::unordered_map<std::string, std::string> tables;
+    };
+    // Check whether an anchor's rules are already 'content'
+    bool hasAnchorRules(const std::string &anchor, const std::string &content);
+    bool hasAnchorTable(const std::string &anchor, const std::string &table,
+                        const std::string &content);
+    // Record the result of changing an anchor.  If the change failed, the
+    // anchor's content is forgotten so it'll be applied again next time.
+    // Changing the rules loads or flushes the anchor's tables too, so those
+    // are forgotten.
+    void storeAnchorRules(const std::string &anchor, const std::string &content,
+                          bool succeeded);
+    void storeAnchorTable(const std::string &anchor, const std::string &table,
+                          const std::string &content, bool succeeded);
+    // Forget all anchor content, when the anchors are reinstalled or removed
+    void clearAnchorContent();
+
 public:
     PFFirewall(const FirewallConfig &config)
     : _rootAnchor{config.brandInfo.identifier}
@@ -88,11 +114,14 @@ public:
     void flushState();
 
 private:
-    // There is no mutable state, which allows MacSplitTunnel to safely use the
-    // same PFFirewall as MacFirewall from its worker thread.
+    // Other than _anchorContent (guarded by _anchorContentMutex), there is no
+    // mutable state, which allows MacSplitTunnel to safely use the same
+    // PFFirewall as MacFirewall from its worker thread.
     const std::string _rootAnchor;
     // Contains config information such as daemonDataDir, etc
     const FirewallConfig _config;
+    std::mutex _anchorContentMutex;
+    std::unordered_map<std::string, AnchorContent> _anchorContent;
 };
 
 }}
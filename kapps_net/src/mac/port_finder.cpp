@@ -18,6 +18,9 @@
 
 #include "port_finder.h"
 #include <unistd.h>
+#include <sys/event.h>
+#include <algorithm>
+#include <array>
 #include <kapps_core/src/ipaddress.h>
 
 namespace kapps { namespace net {
@@ -149,8 +152,11 @@ void addressesForPid(pid_t pid, IPVersion ipVersion, Func_T func)
 
 bool matchesPath(const std::vector<std::string> &paths, pid_t pid)
 {
-    std::string appPath = pidToPath(pid);
+    return matchesPath(paths, pidToPath(pid));
+}
 
+bool matchesPath(const std::vector<std::string> &paths, const std::string &appPath)
+{
     // Check whether the app is one we want to exclude
     return std::any_of(paths.begin(), paths.end(),
         [&appPath](const std::string &prefix) {
@@ -214,9 +220,14 @@ PortSet ports(const std::vector<std::string> &paths, IPVersion ipVersion, const
 }
 
 std::set<AddressAndPort> addresses4(const std::vector<std::string> &paths)
+{
+    return addresses4(pids(paths));
+}
+
+std::set<AddressAndPort> addresses4(const std::set<pid_t> &pids)
 {
     std::set<AddressAndPort> addresses;
-    for(const auto &pid : pids(paths))
+    for(const auto &pid : pids)
         addressesForPid(pid, IPv4, [&addresses](const auto &socketInfo) {
             addresses.insert({static_cast<std::uint32_t>(socketInfo.localIp4()), socketInfo.localPort()});
         });
@@ -224,4 +235,111 @@ std::set<AddressAndPort> addresses4(const std::vector<std::string> &paths)
     return addresses;
 }
 
-}}}
+}
+
+ProcessPathCache::ProcessPathCache()
+    : _kqueue{::kqueue()}
+{
+    if(_kqueue)
+        _kqueue.applyClOExec();
+    else
+    {
+        KAPPS_CORE_WARNING() << "Unable to create kqueue to watch processes -"
+            << core::ErrnoTracer{errno};
+    }
+}
+
+bool ProcessPathCache::watch(pid_t pid)
+{
+    if(!_kqueue)
+        return false;
+
+    // One-shot - after an exec, the process is watched again when its new
+    // path is looked up.  (Exit events end the watch anyway.)
+    struct kevent change{};
+    EV_SET(&change, pid, EVFILT_PROC, EV_ADD|EV_ONESHOT, NOTE_EXEC|NOTE_EXIT,
+           0, nullptr);
+    return ::kevent(_kqueue.get(), &change, 1, nullptr, 0, nullptr) == 0;
+}
+
+void ProcessPathCache::processEvents()
+{
+    if(!_kqueue)
+        return;
+
+    const timespec noWait{};
+    std::array<struct kevent, 64> events;
+    int count;
+    do
+    {
+        count = ::kevent(_kqueue.get(), nullptr, 0, events.data(),
+                         static_cast<int>(events.size()), &noWait);
+        for(int i=0; i<count; ++i)
+            _paths.erase(static_cast<pid_t>(events[i].ident));
+    }
+    while(count == static_cast<int>(events.size()));
+}
+
+void ProcessPathCache::refresh()
+{
+    processEvents();
+
+    _allPids.resize(PortFinder::maxPids);
+    int totalPidCount = proc_listallpids(_allPids.data(),
+        static_cast<int>(_allPids.size() * sizeof(pid_t)));
+    if(totalPidCount < 0)
+    {
+        KAPPS_CORE_WARNING() << "Unable to list processes -" << core::ErrnoTracer{errno};
+        return;
+    }
+    if(totalPidCount == PortFinder::maxPids)
+    {
+        KAPPS_CORE_WARNING() << "Reached max PID count" << PortFinder::maxPids
+            << "- some processes may not be identified";
+    }
+    _allPids.resize(totalPidCount);
+    std::sort(_allPids.begin(), _allPids.end());
+
+    // Drop processes that no longer exist, in case an exit was missed
+    for(auto itEntry = _paths.begin(); itEntry != _paths.end(); )
+    {
+        if(std::binary_search(_allPids.begin(), _allPids.end(), itEntry->first))
+            ++itEntry;
+        else
+            itEntry = _paths.erase(itEntry);
+    }
+
+    _unwatchedPids.clear();
+    for(pid_t pid : _allPids)
+    {
+        if(_paths.count(pid))
+            continue;
+        // Start watching before looking up the path, so an exec in between is
+        // still observed
+        if(watch(pid))
+            _paths.emplace(pid, PortFinder::pidToPath(pid));
+        else
+            _unwatchedPids.push_back(pid);
+    }
+}
+
+std::set<pid_t> ProcessPathCache::pids(const std::vector<std::string> &paths) const
+{
+    std::set<pid_t> matchingPids;
+    if(paths.empty())
+        return matchingPids;
+
+    for(const auto &entry : _paths)
+    {
+        if(PortFinder::matchesPath(paths, entry.second))
+            matchingPids.insert(entry.first);
+    }
+    for(pid_t pid : _unwatchedPids)
+    {
+        if(PortFinder::matchesPath(paths, pid))
+            matchingPids.insert(pid);
+    }
+    return matchingPids;
+}
+
+}}
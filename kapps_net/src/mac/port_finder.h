@@ -19,10 +19,12 @@
 #pragma once
 #include <libproc.h>  // for proc_pidpath()
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include <kapps_net/net.h>
 #include <kapps_core/core.h>
 #include <kapps_core/src/logger.h>
+#include <kapps_core/src/posix/posix_objects.h>
 #include "../originalnetworkscan.h"      // For OriginalNetworkScan
 #include "mac_splittunnel_types.h"
 
@@ -59,10 +61,12 @@ enum { maxPids = 16384 };
 std::set<pid_t> KAPPS_NET_EXPORT pids(const std::vector<std::string> &paths);
 PortSet KAPPS_NET_EXPORT ports(const std::set<pid_t> &pids, IPVersion ipVersion, const OriginalNetworkScan &netScan);
 PortSet KAPPS_NET_EXPORT ports(const std::vector<std::string> &paths, IPVersion ipVersion, const OriginalNetworkScan &netScan);
+std::set<AddressAndPort> KAPPS_NET_EXPORT addresses4(const std::set<pid_t> &pids);
 std::set<AddressAndPort> KAPPS_NET_EXPORT addresses4(const std::vector<std::string> &paths);
 pid_t KAPPS_NET_EXPORT pidForPort(std::uint16_t port, IPVersion ipVersion=IPv4);
 
 bool KAPPS_NET_EXPORT matchesPath(const std::vector<std::string> &paths, pid_t pid);
+bool KAPPS_NET_EXPORT matchesPath(const std::vector<std::string> &paths, const std::string &appPath);
 std::string KAPPS_NET_EXPORT pidToPath(pid_t);
 
 template <typename Func_T>
@@ -119,4 +123,40 @@ std::set<pid_t> pidsFor(Func_T func)
 }
 }
 
+// Tracks the executable paths of running processes, so the processes matching
+// a set of app paths can be found without looking up the path of every process
+// each time (PortFinder::pids() does that for every call).
+//
+// Each process's path is looked up once, when it's first seen.  kqueue
+// process notifications tell us when a process execs (changing its path) or
+// exits, and its entry is then dropped - it's looked up again if the PID is
+// still running.  So refresh() usually only has to list the PIDs.
+class KAPPS_NET_EXPORT ProcessPathCache
+{
+public:
+    ProcessPathCache();
+
+public:
+    // Apply exec/exit notifications and pick up new processes.  Call this
+    // before pids() to observe processes started since the last refresh.
+    void refresh();
+
+    // The PIDs of processes whose paths match any of the app paths (see
+    // PortFinder::matchesPath()), as of the last refresh().
+    std::set<pid_t> pids(const std::vector<std::string> &paths) const;
+
+private:
+    void processEvents();
+    bool watch(pid_t pid);
+
+private:
+    core::PosixFd _kqueue;
+    std::unordered_map<pid_t, std::string> _paths;
+    // Processes that couldn't be watched (if the kqueue can't be created, or
+    // registering fails) - their paths are looked up each time.
+    std::vector<pid_t> _unwatchedPids;
+    // Buffer for proc_listallpids(), reused for each refresh
+    std::vector<pid_t> _allPids;
+};
+
 }}
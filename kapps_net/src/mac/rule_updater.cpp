@@ -37,9 +37,30 @@ namespace
     using StringVector = UpdateStrategy::StringVector;
 }
 
+void RuleUpdater::updatePortAnchors(IPVersion ipVersion, const PortSet &ports)
+{
+    std::array<PortSet, PortAnchorCount> anchorPorts;
+    for(const auto &port : ports)
+        anchorPorts[port % PortAnchorCount].insert(port);
+
+    auto &loaded = _loadedPortAnchors[ipVersion];
+    for(unsigned i=0; i<PortAnchorCount; ++i)
+    {
+        // Skip empty sub-anchors that were never loaded, there's nothing to
+        // flush
+        if(anchorPorts[i].empty() && !loaded[i])
+            continue;
+        _filter.setFilterWithRules(_strategy->portAnchorNameFor(ipVersion, i),
+                                   !anchorPorts[i].empty(),
+                                   _strategy->portRules(ipVersion, anchorPorts[i]));
+        loaded[i] = !anchorPorts[i].empty();
+    }
+}
+
 void RuleUpdater::clearRules(IPVersion ipVersion)
 {
     _filter.setFilterWithRules(_strategy->anchorNameFor(ipVersion), false, {});
+    updatePortAnchors(ipVersion, {});
     _ports[ipVersion].clear();
 }
 
@@ -50,11 +71,17 @@ void RuleUpdater::clearAllRules()
 }
 
 void RuleUpdater::forceUpdate(IPVersion ipVersion, const PortSet &ports,
-                              const kapps::net::FirewallParams &params) const
+                              const kapps::net::FirewallParams &params)
 {
-    StringVector vec;
+    updatePortAnchors(ipVersion, ports);
 
-    const auto &rules = _strategy->rules(ipVersion, ports, params);
+    // Evaluate the port sub-anchors first to tag packets.  Tags are applied
+    // even though those rules aren't the last match, so the routing rules
+    // below can use them.  (The quotes are escaped because
+    // setFilterWithRules() passes the rules through a shell.)
+    StringVector vec{R"(anchor \"ports/*\")"};
+
+    const auto &rules = _strategy->rules(ipVersion, params);
     const auto &routingRules = _strategy->routingRule(ipVersion, params);
 
     vec.insert(vec.end(), rules.begin(), rules.end());
@@ -81,8 +108,7 @@ void RuleUpdater::update(IPVersion ipVersion, const PortSet &ports,
     }
 }
 
-StringVector UpdateStrategy::rules(IPVersion ipVersion, const PortSet &ports,
-                                   const kapps::net::FirewallParams &) const
+StringVector UpdateStrategy::portRules(IPVersion ipVersion, const PortSet &ports) const
 {
     std::vector<std::string> ruleList;
 
@@ -97,6 +123,16 @@ StringVector UpdateStrategy::rules(IPVersion ipVersion, const PortSet &ports,
     return ruleList;
 }
 
+StringVector UpdateStrategy::rules(IPVersion, const kapps::net::FirewallParams &) const
+{
+    return {};
+}
+
+std::string UpdateStrategy::portAnchorNameFor(IPVersion ipVersion, unsigned index) const
+{
+    return qs::format("%/ports/%", anchorNameFor(ipVersion), index);
+}
+
 kapps::core::StringSlice BypassStrategy::tagNameFor(IPVersion ipVersion) const
 {
     return ipVersion == IPv4 ? "BYPASS4" : "BYPASS6";
@@ -226,7 +262,7 @@ std::set<std::string> DefaultStrategy::bypassSubnetsFor(IPVersion ipVersion,
         return params.bypassIpv6Subnets;
 }
 
-StringVector DefaultStrategy::rules(IPVersion ipVersion, const PortSet &ports,
+StringVector DefaultStrategy::rules(IPVersion ipVersion,
                                     const kapps::net::FirewallParams &params) const
 {
     // Add LAN ips to the lanips table. Each table is unique to each anchor - so lanips in kDefaultApps4 is
@@ -242,7 +278,7 @@ StringVector DefaultStrategy::rules(IPVersion ipVersion, const PortSet &ports,
 
     _filter.setAnchorTable(anchorNameFor(ipVersion), true, "lanips", vec);
 
-    StringVector ruleList{UpdateStrategy::rules(ipVersion, ports, params)};
+    StringVector ruleList;
 
     // Send all ICMP (that're not headed towards LAN or bypass ips) out the default interface - we're essentially
     // saying: "manage icmp for all ips EXCEPT LAN and bypass ips"
@@ -21,6 +21,7 @@
 #include <set>
 #include <memory>
 #include <array>
+#include <bitset>
 #include <string>
 #include <arpa/inet.h>
 #include <sys/socket.h>
@@ -34,10 +35,35 @@
 
 class UpdateStrategy;
 
+// RuleUpdater maintains the PF rules for one type of split tunnel traffic -
+// bypass, VPN-only, or default.  Each app port gets a rule to tag its packets,
+// and routing rules route the tagged packets.
+//
+// Ports change all the time (apps open and close sockets), while the routing
+// rules only change with the network.  PF can't put ports in a table (tables
+// only hold addresses), so the port rules are split over PortAnchorCount
+// sub-anchors by port number instead.  A port change only reloads the
+// sub-anchor containing that port, and the main anchor (routing rules, tables)
+// isn't reloaded unless it actually changes.
 class RuleUpdater
 {
+public:
+    enum : unsigned
+    {
+        // Number of sub-anchors for port rules
+        PortAnchorCount = 16
+    };
+
+private:
+    // Load the port rules into the port sub-anchors.  Sub-anchors that
+    // haven't changed aren't reloaded (PFFirewall skips them).
+    void updatePortAnchors(IPVersion ipVersion, const PortSet &ports);
+
 private:
     std::array<PortSet, 2> _ports;
+    // The port sub-anchors that have been loaded with rules, so they can be
+    // flushed when they're no longer needed
+    std::array<std::bitset<PortAnchorCount>, 2> _loadedPortAnchors;
     OriginalNetworkScan _netScan;
     std::set<std::string> _bypassIpv4Subnets;
     std::set<std::string> _bypassIpv6Subnets;
@@ -53,7 +79,7 @@ public:
     void update(IPVersion ipVersion, const PortSet &ports,
                 const kapps::net::FirewallParams &params);
     void forceUpdate(IPVersion ipVersion, const PortSet &ports,
-                     const kapps::net::FirewallParams &params) const;
+                     const kapps::net::FirewallParams &params);
     void clearRules(IPVersion ipVersion);
     void clearAllRules();
 };
@@ -68,12 +94,19 @@ public:
     : _filter{filter}
     {}
     virtual ~UpdateStrategy() = default;
-    virtual StringVector rules(IPVersion ipVersion, const PortSet &ports,
+    // Rules to tag the packets from each port; these are loaded into the
+    // port sub-anchors
+    StringVector portRules(IPVersion ipVersion, const PortSet &ports) const;
+    // Rules for the main anchor other than the port and routing rules
+    virtual StringVector rules(IPVersion ipVersion,
                                const kapps::net::FirewallParams &params) const;
     virtual StringVector routingRule(IPVersion ipVersion,
                                      const kapps::net::FirewallParams &params) const = 0;
     virtual kapps::core::StringSlice anchorNameFor(IPVersion ipVersion) const = 0;
     virtual kapps::core::StringSlice tagNameFor(IPVersion ipVersion) const = 0;
+    // Name of a port sub-anchor, relative to the root anchor like
+    // anchorNameFor()
+    std::string portAnchorNameFor(IPVersion ipVersion, unsigned index) const;
 
 protected:
     kapps::core::StringSlice protocolFor(IPVersion ipVersion) const { return ipVersion == IPv4 ? ("inet") : ("inet6"); }
@@ -114,7 +147,7 @@ class DefaultStrategy : public UpdateStrategy
 public:
     using UpdateStrategy::UpdateStrategy;
 protected:
-    virtual StringVector rules(IPVersion ipVersion, const PortSet &ports,
+    virtual StringVector rules(IPVersion ipVersion,
                                const kapps::net::FirewallParams &params) const override;
     virtual kapps::core::StringSlice tagNameFor(IPVersion ipVersion) const override;
     virtual kapps::core::StringSlice anchorNameFor(IPVersion ipVersion) const override;
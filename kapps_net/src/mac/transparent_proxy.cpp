@@ -35,41 +35,13 @@ namespace
     const std::chrono::seconds syncProxyAttemptInterval{1};
     const std::chrono::seconds systemExtensionAllowInterval{1};
 
-    // Minimal wrapper class to enforce type and arg-order safety
-    struct AppList
-    {
-        const std::vector<std::string> &apps;
-    };
-
     // Given an app path (e.g /Applications/Firefox.app) return
-    // the bundle id (e.g org.mozilla.firefox) or the original path
+    // the bundle id (e.g org.mozilla.firefox), or an empty string
     // if the bundle id cannot be found.
-    auto getAppDescriptor(const std::string &path) -> std::string
+    auto getBundleId(const std::string &path) -> std::string
     {
         std::string bundleId{core::Exec::cmdWithOutput("mdls", {"-raw", "-name", "kMDItemCFBundleIdentifier", path})};
-
-       // First try the bundle id,  failing that, fall back to the app path.
-        // App paths can also be used as descriptors, but they must be a
-        // complete path to the executable binary, not just to the .app
-        // A "descriptor" is how the split tunnel identifies an app - either an
-        // app id or a complete path to a binary.
-        return (bundleId.empty() || bundleId == "(null)") ? path : bundleId;
-    }
-
-    // Add apps to an arg list - we use an AppList as a sort of
-    // named parameter and to enforce type-safety and prevent mixup
-    // of the arg orders (since two args are std::vector<std::string>)
-    auto addAppsToArgs(std::string appOption, AppList appList,
-        std::vector<std::string> &syncArgs) -> void
-    {
-        if(appList.apps.size() == 0)
-            return;
-
-        for(const auto &path: appList.apps)
-        {
-            syncArgs.emplace_back(appOption);
-            syncArgs.emplace_back(getAppDescriptor(path));
-        }
+        return bundleId == "(null)" ? std::string{} : bundleId;
     }
 
     // The number of seconds passed since startTime
@@ -159,6 +131,39 @@ void TransparentProxy::Config::trace(std::ostream &os) const
         << "}";
 }
 
+const std::string &TransparentProxy::appDescriptor(const std::string &path)
+{
+    auto itDescriptor = _appDescriptors.find(path);
+    if(itDescriptor != _appDescriptors.end())
+        return itDescriptor->second;
+
+    // First try the bundle id, failing that, fall back to the app path.
+    // App paths can also be used as descriptors, but they must be a
+    // complete path to the executable binary, not just to the .app
+    // A "descriptor" is how the split tunnel identifies an app - either an
+    // app id or a complete path to a binary.
+    std::string bundleId{getBundleId(path)};
+    if(bundleId.empty())
+    {
+        // Don't cache the fallback - the lookup could fail just because
+        // Spotlight hasn't indexed a newly-installed app yet
+        return path;
+    }
+    return _appDescriptors.emplace(path, std::move(bundleId)).first->second;
+}
+
+// Add apps to an arg list
+void TransparentProxy::addAppsToArgs(const std::string &appOption,
+                                     const std::vector<std::string> &apps,
+                                     std::vector<std::string> &syncArgs)
+{
+    for(const auto &path: apps)
+    {
+        syncArgs.emplace_back(appOption);
+        syncArgs.emplace_back(appDescriptor(path));
+    }
+}
+
 // The first time this runs on a user's system it will pop up a window
 // and require the user to go to settings -> privacy -> security -> and click allow.
 void TransparentProxy::activateSystemExtension() const
@@ -260,6 +265,7 @@ void TransparentProxy::setState(State newState)
 // and require the user to allow the network manager.
 void TransparentProxy::sync(const Config &config)
 {
+    unsigned syncGeneration;
     {
         // Protect the calls to getState() and setState
         std::lock_guard<std::mutex> guard{_mutex};
@@ -271,6 +277,8 @@ void TransparentProxy::sync(const Config &config)
         }
 
         setState(State::Synchronizing);
+        // Tell any attempt to sync an older config to give up
+        syncGeneration = ++_syncGeneration;
     }
 
     KAPPS_CORE_INFO() << "Sending sync request to transparent proxy extension";
@@ -306,9 +314,9 @@ void TransparentProxy::sync(const Config &config)
     }
 
     // Add bypass apps
-    addAppsToArgs("--bypass-app", AppList{config.bypassApps}, syncArgs);
+    addAppsToArgs("--bypass-app", config.bypassApps, syncArgs);
     // Add vpnOnly apps
-    addAppsToArgs("--vpn-only-app", AppList{config.vpnOnlyApps}, syncArgs);
+    addAppsToArgs("--vpn-only-app", config.vpnOnlyApps, syncArgs);
 
     // Apply interface
     syncArgs.emplace_back("--bind-interface");
@@ -321,17 +329,19 @@ void TransparentProxy::sync(const Config &config)
         syncArgs.emplace_back("--route-vpn");
 
     // The 'emplace' here will also call the destructor on
-    // any pre-existing thread (causing it to join()).
-    _pSyncThread.emplace([](core::Any){});
+    // any pre-existing thread (causing it to join()).  If it was still trying
+    // to sync an older config, it gives up at its next attempt since the sync
+    // generation has changed.
+    _pSyncThread.emplace([](core::Any){}, "transparentproxy");
 
     // Kick off our attempts to sync the proxy in a background thread
     // it keeps trying to sync it until it succeeds or it times out.
-    _pSyncThread->queueInvoke([this, syncArgs]
+    _pSyncThread->queueInvoke([this, syncArgs, syncGeneration]
     {
         // Make sure the system extension is active before synchronizing
         if(ensureActivateSystemExtension())
         {
-            attemptSync(syncArgs);
+            attemptSync(syncArgs, syncGeneration);
         }
     });
 }
@@ -339,7 +349,8 @@ void TransparentProxy::sync(const Config &config)
 // Sometimes the proxy doesn't sync immediately - so we keep trying
 // to sync it until either we connect or a timeout is reached
 // this code should only be run in a background thread (see _pSyncThread).
-void TransparentProxy::attemptSync(const std::vector<std::string> &syncArgs)
+void TransparentProxy::attemptSync(const std::vector<std::string> &syncArgs,
+                                   unsigned syncGeneration)
 {
     auto startTime = std::chrono::steady_clock::now();
     auto endTime = startTime + syncProxyTimeout;
@@ -370,6 +381,13 @@ void TransparentProxy::attemptSync(const std::vector<std::string> &syncArgs)
                 KAPPS_CORE_WARNING() << "State is no longer Synchronizing, giving up trying to synchronize transparent proxy.";
                 break;
             }
+            // Has a newer config been requested?  It'll be synced
+            // by the next thread.
+            if(syncGeneration != _syncGeneration)
+            {
+                KAPPS_CORE_INFO() << "Transparent proxy config changed, giving up trying to synchronize the previous config.";
+                break;
+            }
 
             // Trigger the attempt
             proxyCliRun(syncArgs);
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <mutex>
 #include <chrono>
+#include <unordered_map>
 #include <kapps_core/src/posix/pollthread.h>
 
 namespace kapps::net {
@@ -82,7 +83,13 @@ public:
 
 private:
     void sync(const Config &config);
-    void attemptSync(const std::vector<std::string> &syncArgs);
+    void attemptSync(const std::vector<std::string> &syncArgs, unsigned syncGeneration);
+    // Get the descriptor used to identify an app to the proxy - its bundle ID
+    // if it has one, otherwise the path itself
+    const std::string &appDescriptor(const std::string &path);
+    void addAppsToArgs(const std::string &appOption,
+                       const std::vector<std::string> &apps,
+                       std::vector<std::string> &syncArgs);
     void stop();
     void activateSystemExtension() const;
     // Wait until the system extension is activated and allowed by the user.
@@ -104,6 +111,13 @@ private:
     State _state{State::Stopped};
     mutable std::mutex _mutex;
     core::nullable_t<core::PollThread> _pSyncThread;
+    // Incremented (under _mutex) for each sync(), so an attempt to sync an
+    // older config can give up as soon as a newer one is requested.
+    unsigned _syncGeneration{0};
+    // App descriptors found for app paths.  Looking up a bundle ID spawns
+    // mdls, so they're cached rather than looked up on every sync().  Only
+    // used from the thread calling update().
+    std::unordered_map<std::string, std::string> _appDescriptors;
     bool _vpnBoundRouteExists;
     bool _sysExtIsActivated{false};
 };
@@ -19,6 +19,7 @@
 #pragma once
 #include <kapps_net/net.h>
 #include <string>
+#include <vector>
 
 class KAPPS_NET_EXPORT RouteManager
 {
@@ -27,5 +28,30 @@ public:
     virtual void removeRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const = 0;
     virtual void addRoute6(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric=0) const = 0;
     virtual void removeRoute6(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const = 0;
+
+    // Remove and add several routes via the same gateway and interface.
+    // Removals are applied first.  The default implementations just remove
+    // and add each route; implementations can override these to apply the
+    // changes in bulk.
+    virtual void updateRoutes4(const std::vector<std::string> &removeSubnets,
+                               const std::vector<std::string> &addSubnets,
+                               const std::string &gatewayIp,
+                               const std::string &interfaceName) const
+    {
+        for(const auto &subnet : removeSubnets)
+            removeRoute4(subnet, gatewayIp, interfaceName);
+        for(const auto &subnet : addSubnets)
+            addRoute4(subnet, gatewayIp, interfaceName);
+    }
+    virtual void updateRoutes6(const std::vector<std::string> &removeSubnets,
+                               const std::vector<std::string> &addSubnets,
+                               const std::string &gatewayIp,
+                               const std::string &interfaceName) const
+    {
+        for(const auto &subnet : removeSubnets)
+            removeRoute6(subnet, gatewayIp, interfaceName);
+        for(const auto &subnet : addSubnets)
+            addRoute6(subnet, gatewayIp, interfaceName);
+    }
     virtual ~RouteManager() = default;
 };
@@ -0,0 +1,73 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "subnetaggregation.h"
+#include <kapps_core/src/subnettrie.h>
+#include <kapps_core/src/logger.h>
+
+namespace kapps { namespace net {
+
+std::set<std::string> aggregateIpv4Subnets(const std::set<std::string> &subnets)
+{
+    std::set<std::string> result;
+    core::Ipv4SubnetSet subnetSet;
+    for(const auto &subnet : subnets)
+    {
+        try
+        {
+            subnetSet.insert(core::Ipv4Subnet{subnet});
+        }
+        catch(const std::exception &ex)
+        {
+            KAPPS_CORE_WARNING() << "Can't aggregate IPv4 subnet" << subnet
+                << "-" << ex.what();
+            result.insert(subnet);
+        }
+    }
+
+    for(const auto &subnet : subnetSet.aggregate())
+        result.insert(qs::format("%/%", subnet.address(), subnet.prefix()));
+
+    return result;
+}
+
+std::set<std::string> aggregateIpv6Subnets(const std::set<std::string> &subnets)
+{
+    std::set<std::string> result;
+    core::Ipv6SubnetSet subnetSet;
+    for(const auto &subnet : subnets)
+    {
+        try
+        {
+            subnetSet.insert(core::Ipv6Subnet{subnet});
+        }
+        catch(const std::exception &ex)
+        {
+            KAPPS_CORE_WARNING() << "Can't aggregate IPv6 subnet" << subnet
+                << "-" << ex.what();
+            result.insert(subnet);
+        }
+    }
+
+    for(const auto &subnet : subnetSet.aggregate())
+        result.insert(qs::format("%/%", subnet.address(), subnet.prefix()));
+
+    return result;
+}
+
+}}
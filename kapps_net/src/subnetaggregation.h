@@ -0,0 +1,39 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_net/net.h>
+#include <string>
+#include <set>
+
+namespace kapps { namespace net {
+
+// Normalize and aggregate a set of bypass subnets so it can be applied with as
+// few routes/rules as possible:
+// - host bits after the prefix are cleared ("10.0.0.1/8" -> "10.0.0.0/8")
+// - subnets contained in another subnet are dropped
+// - sibling subnets that together form a larger subnet are merged
+//   ("10.0.0.0/25" + "10.0.0.128/25" -> "10.0.0.0/24"), repeatedly
+//
+// The result covers exactly the same addresses as the input.  Subnets that
+// can't be parsed are traced and passed through unchanged, so they still fail
+// the same way they would have without aggregation.
+KAPPS_NET_EXPORT std::set<std::string> aggregateIpv4Subnets(const std::set<std::string> &subnets);
+KAPPS_NET_EXPORT std::set<std::string> aggregateIpv6Subnets(const std::set<std::string> &subnets);
+
+}}
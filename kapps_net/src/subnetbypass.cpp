@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "subnetbypass.h"
+#include "subnetaggregation.h"
 #include <kapps_core/src/logger.h>
 #include <kapps_core/src/util.h>
 
@@ -24,47 +25,40 @@ namespace kapps { namespace net {
 
 void SubnetBypass::clearAllRoutes4()
 {
-    for(const auto &subnet : _ipv4Subnets)
-        _routeManager->removeRoute4(subnet, _netScan.gatewayIp(), _netScan.interfaceName());
+    _routeManager->updateRoutes4({_ipv4Subnets.begin(), _ipv4Subnets.end()}, {},
+                                 _netScan.gatewayIp(), _netScan.interfaceName());
 
     _ipv4Subnets.clear();
 }
 
 void SubnetBypass::clearAllRoutes6()
 {
-    for(const auto &subnet : _ipv6Subnets)
-        _routeManager->removeRoute6(subnet, _netScan.gatewayIp6(), _netScan.interfaceName());
+    _routeManager->updateRoutes6({_ipv6Subnets.begin(), _ipv6Subnets.end()}, {},
+                                 _netScan.gatewayIp6(), _netScan.interfaceName());
 
     _ipv6Subnets.clear();
 }
 
-void SubnetBypass::addAndRemoveSubnets4(const FirewallParams &params)
+void SubnetBypass::addAndRemoveSubnets4(const FirewallParams &params,
+                                        const std::set<std::string> &ipv4Subnets)
 {
-    auto subnetsToRemove{qs::setDifference(_ipv4Subnets, params.bypassIpv4Subnets)};
-    auto subnetsToAdd{qs::setDifference(params.bypassIpv4Subnets,  _ipv4Subnets)};
+    auto subnetsToRemove{qs::setDifference(_ipv4Subnets, ipv4Subnets)};
+    auto subnetsToAdd{qs::setDifference(ipv4Subnets,  _ipv4Subnets)};
 
-
-    // Remove routes for old subnets
-    for(const auto &subnet : subnetsToRemove)
-        _routeManager->removeRoute4(subnet, params.netScan.gatewayIp(), params.netScan.interfaceName());
-
-    // Add routes for new subnets
-    for(auto subnet : subnetsToAdd)
-        _routeManager->addRoute4(subnet, params.netScan.gatewayIp(), params.netScan.interfaceName());
+    // Remove routes for old subnets and add routes for new subnets
+    _routeManager->updateRoutes4(subnetsToRemove, subnetsToAdd,
+                                 params.netScan.gatewayIp(), params.netScan.interfaceName());
 }
 
-void SubnetBypass::addAndRemoveSubnets6(const FirewallParams &params)
+void SubnetBypass::addAndRemoveSubnets6(const FirewallParams &params,
+                                        const std::set<std::string> &ipv6Subnets)
 {
-    auto subnetsToRemove{qs::setDifference(_ipv6Subnets, params.bypassIpv6Subnets)};
-    auto subnetsToAdd{qs::setDifference(params.bypassIpv6Subnets,  _ipv6Subnets)};
+    auto subnetsToRemove{qs::setDifference(_ipv6Subnets, ipv6Subnets)};
+    auto subnetsToAdd{qs::setDifference(ipv6Subnets,  _ipv6Subnets)};
 
-    // Remove routes for old subnets
-    for(const auto &subnet : subnetsToRemove)
-        _routeManager->removeRoute6(subnet, params.netScan.gatewayIp6(), params.netScan.interfaceName());
-
-    // Add routes for new subnets
-    for(auto subnet : subnetsToAdd)
-        _routeManager->addRoute6(subnet, params.netScan.gatewayIp6(), params.netScan.interfaceName());
+    // Remove routes for old subnets and add routes for new subnets
+    _routeManager->updateRoutes6(subnetsToRemove, subnetsToAdd,
+                                 params.netScan.gatewayIp6(), params.netScan.interfaceName());
 }
 
 std::string SubnetBypass::stateChangeString(bool oldValue, bool newValue)
@@ -116,15 +110,22 @@ void SubnetBypass::updateRoutes(const FirewallParams &params)
             clearAllRoutes6();
         }
 
-        if(params.bypassIpv4Subnets != _ipv4Subnets)
-            addAndRemoveSubnets4(params);
+        // Route the aggregated subnets - users may bypass hundreds of
+        // prefixes, many of which are adjacent or overlapping.  The installed
+        // sets are also aggregated, so only the routes that actually change
+        // are touched.
+        auto ipv4Subnets{aggregateIpv4Subnets(params.bypassIpv4Subnets)};
+        auto ipv6Subnets{aggregateIpv6Subnets(params.bypassIpv6Subnets)};
+
+        if(ipv4Subnets != _ipv4Subnets)
+            addAndRemoveSubnets4(params, ipv4Subnets);
 
-        if(params.bypassIpv6Subnets != _ipv6Subnets)
-            addAndRemoveSubnets6(params);
+        if(ipv6Subnets != _ipv6Subnets)
+            addAndRemoveSubnets6(params, ipv6Subnets);
 
         _isEnabled = true;
-        _ipv4Subnets = params.bypassIpv4Subnets;
-        _ipv6Subnets = params.bypassIpv6Subnets;
+        _ipv4Subnets = std::move(ipv4Subnets);
+        _ipv6Subnets = std::move(ipv6Subnets);
         _netScan = params.netScan;
     }
 }
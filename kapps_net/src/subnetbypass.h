@@ -40,8 +40,10 @@ public:
 
     void updateRoutes(const FirewallParams &params);
 private:
-    void addAndRemoveSubnets4(const FirewallParams &params);
-    void addAndRemoveSubnets6(const FirewallParams &params);
+    void addAndRemoveSubnets4(const FirewallParams &params,
+                              const std::set<std::string> &ipv4Subnets);
+    void addAndRemoveSubnets6(const FirewallParams &params,
+                              const std::set<std::string> &ipv6Subnets);
     void clearAllRoutes4();
     void clearAllRoutes6();
     std::string boolToString(bool value) {return value ? "ON" : "OFF";}
@@ -49,6 +51,7 @@ private:
 private:
     std::unique_ptr<RouteManager> _routeManager;
     OriginalNetworkScan _netScan;
+    // The installed (aggregated) bypass subnets
     std::set<std::string> _ipv4Subnets;
     std::set<std::string> _ipv6Subnets;
     bool _isEnabled;
@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "wfp_firewall.h"
+#include "../firewall.h"
 #include <kapps_core/src/win/win_error.h>
 #include <kapps_core/src/uuid.h>
 
@@ -189,6 +190,8 @@ bool FirewallEngine::uninstallProvider()
 WfpFilterObject FirewallEngine::add(const FirewallFilter& filter)
 {
     UINT64 id = 0;
+    FirewallCounters::countOperation();
+    FirewallCounters::countRules(1);
     if (DWORD error = FwpmFilterAdd(_handle, &filter, NULL, &id))
     {
         KAPPS_CORE_ERROR() << core::WinErrTracer{error};
@@ -200,6 +203,7 @@ WfpFilterObject FirewallEngine::add(const FirewallFilter& filter)
 WfpCalloutObject FirewallEngine::add(const Callout& mCallout)
 {
     UINT32 id = 0;
+    FirewallCounters::countOperation();
     if (DWORD error = FwpmCalloutAdd(_handle, &mCallout, NULL, &id))
     {
         KAPPS_CORE_ERROR() << core::WinErrTracer{error};
@@ -211,6 +215,7 @@ WfpCalloutObject FirewallEngine::add(const Callout& mCallout)
 WfpProviderContextObject FirewallEngine::add(const ProviderContext& providerContext)
 {
     UINT64 id = 0;
+    FirewallCounters::countOperation();
     if (DWORD error = FwpmProviderContextAdd(_handle, &providerContext, NULL, &id))
     {
         KAPPS_CORE_ERROR() << core::WinErrTracer{error};
@@ -221,6 +226,7 @@ WfpProviderContextObject FirewallEngine::add(const ProviderContext& providerCont
 
 bool FirewallEngine::remove(const WfpFilterObject &filter)
 {
+    FirewallCounters::countOperation();
     if(DWORD error = FwpmFilterDeleteByKey(_handle, &filter))
     {
         KAPPS_CORE_ERROR() << core::WinErrTracer{error};
@@ -231,6 +237,7 @@ bool FirewallEngine::remove(const WfpFilterObject &filter)
 
 bool FirewallEngine::remove(const WfpCalloutObject &callout)
 {
+    FirewallCounters::countOperation();
     if(DWORD error = FwpmCalloutDeleteByKey(_handle, &callout))
     {
         KAPPS_CORE_ERROR() << core::WinErrTracer{error};
@@ -241,6 +248,7 @@ bool FirewallEngine::remove(const WfpCalloutObject &callout)
 
 bool FirewallEngine::remove(const WfpProviderContextObject &providerContext)
 {
+    FirewallCounters::countOperation();
     if(DWORD error = FwpmProviderContextDeleteByKey(_handle, &providerContext))
     {
         KAPPS_CORE_ERROR() << core::WinErrTracer{error};
@@ -22,16 +22,25 @@
 #include <kapps_core/src/stringslice.h>
 #include <Psapi.h>
 #include <comutil.h>
+#include <evntrace.h>
+#include <evntcons.h>
+#include <tdh.h>
 #include <array>
+#include <thread>
 
 #pragma comment(lib, "comsuppw.lib")
 #pragma comment(lib, "Wbemuuid.lib")
+#pragma comment(lib, "Advapi32.lib")
+#pragma comment(lib, "tdh.lib")
 
 namespace kapps { namespace net {
 
 // The threading model in WinAppMonitor is complex due to the different sources
 // of notifications used.
-// - Process creation notifications are received via WMI on a WMI thread.
+// - Process creation notifications are received via ETW on the trace's
+//   processing thread (WAM::EtwProcessTrace), or via WMI on a WMI thread if
+//   the ETW session couldn't be started.  (Only WMI is shown below; ETW is
+//   equivalent.)
 // - Process terminate notifications are received on thread pool threads using
 //   RegisterWaitForSingleObject() on each process handle.
 //
@@ -116,8 +125,85 @@ private:
     const FILETIME &_tm;
 };
 
-WinAppTracker::WinAppTracker(SplitType type, core::WorkThread &cleanupThread)
-    : _type{type}, _cleanupThread{cleanupThread}
+namespace
+{
+    // Number of executables to remember in WinExecutableCache
+    const std::size_t executableCacheSize{256};
+    // Number of recently created processes to remember for parent lookups
+    const std::size_t recentProcessesSize{1024};
+}
+
+bool WinExecutableCache::FileStamp::operator==(const FileStamp &other) const
+{
+    return _lastWrite.dwLowDateTime == other._lastWrite.dwLowDateTime &&
+        _lastWrite.dwHighDateTime == other._lastWrite.dwHighDateTime &&
+        _sizeHigh == other._sizeHigh && _sizeLow == other._sizeLow;
+}
+
+WinExecutableCache::WinExecutableCache(std::size_t maxSize)
+    : _entries{maxSize}
+{
+}
+
+auto WinExecutableCache::findEntry(const std::wstring &imgPath) -> Entry *
+{
+    // Reading the attributes is much cheaper than loading the app ID or
+    // verifying the signature, and it detects a replaced executable.
+    WIN32_FILE_ATTRIBUTE_DATA attrs{};
+    if(!::GetFileAttributesExW(imgPath.c_str(), GetFileExInfoStandard, &attrs))
+    {
+        KAPPS_CORE_INFO() << "Can't read attributes of" << imgPath
+            << core::WinErrTracer{::GetLastError()};
+        return nullptr;
+    }
+
+    FileStamp stamp{attrs.ftLastWriteTime, attrs.nFileSizeHigh, attrs.nFileSizeLow};
+    Entry *pEntry = _entries.find(imgPath);
+    if(pEntry && pEntry->_stamp == stamp)
+        return pEntry;
+
+    if(pEntry)
+        KAPPS_CORE_INFO() << "Executable has changed, reload" << imgPath;
+    _entries.insert({imgPath, Entry{stamp, {}, false, {}}});
+    return _entries.find(imgPath);
+}
+
+std::shared_ptr<AppIdKey> WinExecutableCache::getAppId(const std::wstring &imgPath)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    Entry *pEntry = findEntry(imgPath);
+    if(pEntry && pEntry->_pAppId)
+        return pEntry->_pAppId;
+
+    std::shared_ptr<AppIdKey> pAppId{new AppIdKey{imgPath}};
+    if(!*pAppId)
+        return {};  // Return empty pointer rather than pointer-to-empty AppIdKey
+    // Failures aren't remembered, they're rare and might be transient.
+    if(pEntry)
+        pEntry->_pAppId = pAppId;
+    return pAppId;
+}
+
+std::set<std::wstring> WinExecutableCache::getSignerNames(const std::wstring &imgPath)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    Entry *pEntry = findEntry(imgPath);
+    if(!pEntry)
+        return winGetExecutableSigners(imgPath);
+
+    // Unsigned executables are remembered too; they're common, and checking
+    // them is just as expensive.
+    if(!pEntry->_haveSignerNames)
+    {
+        pEntry->_signerNames = winGetExecutableSigners(imgPath);
+        pEntry->_haveSignerNames = true;
+    }
+    return pEntry->_signerNames;
+}
+
+WinAppTracker::WinAppTracker(SplitType type, core::Strand &cleanupStrand,
+                             WinExecutableCache &exeCache)
+    : _type{type}, _cleanupStrand{cleanupStrand}, _exeCache{exeCache}
 {
 }
 
@@ -468,7 +554,7 @@ auto WinAppTracker::isAppDescendant(Pid_t parentPid, const std::wstring &imgPath
     if(itProcData->second._excludedAppPos->second._signerNames.empty())
         return _apps.end();
 
-    std::set<std::wstring> signerNames{winGetExecutableSigners(imgPath)};
+    std::set<std::wstring> signerNames{_exeCache.getSignerNames(imgPath)};
 
     for(const auto &expectedSignerName : itProcData->second._excludedAppPos->second._signerNames)
     {
@@ -527,12 +613,11 @@ void WinAppTracker::onProcessExited(HANDLE procHandle)
 
     // We can't destroy the WinSingleWait in _pWaiter on this thread; it can't
     // be destroyed during its own callback.  Queue it over to the cleanup
-    // thread so it is destroyed there later.
+    // strand so it is destroyed there later.
     //
-    // We don't actually have to do any explicit processing on these work items,
-    // Any's destructor will destroy the underlying value when they're pulled
-    // from the queue.
-    _cleanupThread.enqueue(std::move(itProcData->second._pWaiter));
+    // The task doesn't have to do anything, the WinSingleWait is destroyed
+    // with the task after it runs.
+    _cleanupStrand.post([pWaiter = std::move(itProcData->second._pWaiter)]{});
 
     // unique_ptr's move constructor has a stronger-than-normal postcondition
     // that the moved-from object is always empty.
@@ -551,9 +636,10 @@ void WinAppTracker::onProcessExited(HANDLE procHandle)
 }
 
 WinSplitTunnelTracker::WinSplitTunnelTracker()
-    : _cleanupThread{[](core::Any){}}, // Just used to destroy objects, see WinAppTracker::onProcessExited
-      _vpnOnly{WinAppTracker::SplitType::VpnOnly, _cleanupThread},
-      _excluded{WinAppTracker::SplitType::Excluded, _cleanupThread}
+    : _cleanupStrand{"app tracker cleanup"}, // Just used to destroy objects, see WinAppTracker::onProcessExited
+      _exeCache{executableCacheSize}, _recentProcesses{recentProcessesSize},
+      _vpnOnly{WinAppTracker::SplitType::VpnOnly, _cleanupStrand, _exeCache},
+      _excluded{WinAppTracker::SplitType::Excluded, _cleanupStrand, _exeCache}
 {
     _vpnOnly.appIdsChanged = [this]{appIdsChanged();};
     _excluded.appIdsChanged = [this]{appIdsChanged();};
@@ -605,16 +691,37 @@ std::wstring WinSplitTunnelTracker::getProcImagePath(const WinHandle &procHandle
     return procImage;
 }
 
-std::shared_ptr<AppIdKey> WinSplitTunnelTracker::getProcAppId(const WinHandle &procHandle) const
+void WinSplitTunnelTracker::recordProcess(Pid_t pid, const FILETIME &createTime,
+                                          const std::wstring &imgPath)
 {
-    std::wstring imgPath{getProcImagePath(procHandle)};
+    std::lock_guard<std::mutex> lock{_recentProcessesMutex};
+    _recentProcesses.insert({pid, RecentProcess{createTime, imgPath}});
+}
+
+std::shared_ptr<AppIdKey> WinSplitTunnelTracker::getParentAppId(const WinHandle &parentHandle,
+                                                                Pid_t parentPid,
+                                                                const FILETIME &parentCreateTime)
+{
+    std::wstring imgPath;
+    {
+        std::lock_guard<std::mutex> lock{_recentProcessesMutex};
+        const RecentProcess *pRecent = _recentProcesses.find(parentPid);
+        // If the creation time doesn't match, the PID was reused
+        if(pRecent && ::CompareFileTime(&pRecent->_createTime, &parentCreateTime) == 0)
+            imgPath = pRecent->_imgPath;
+    }
+
     if(imgPath.empty())
-        return {};
+    {
+        imgPath = getProcImagePath(parentHandle);
+        if(imgPath.empty())
+            return {};
+        // Parents that we didn't see start (shells, launchers, etc.) tend to
+        // start many processes, remember them too.
+        recordProcess(parentPid, parentCreateTime, imgPath);
+    }
 
-    std::shared_ptr<AppIdKey> pAppId{new AppIdKey{imgPath}};
-    if(!*pAppId)
-        return {};  // Return empty pointer rather than pointer-to-empty AppIdKey
-    return pAppId;
+    return _exeCache.getAppId(imgPath);
 }
 
 AppIdSet WinSplitTunnelTracker::getExcludedAppIds() const
@@ -636,13 +743,17 @@ bool WinSplitTunnelTracker::setSplitTunnelRules(const std::unordered_set<std::ws
 }
 
 void WinSplitTunnelTracker::processCreated(WinHandle procHandle, Pid_t pid,
-                                           WinHandle parentHandle, Pid_t parentPid)
+                                           const FILETIME &createTime,
+                                           WinHandle parentHandle, Pid_t parentPid,
+                                           const FILETIME &parentCreateTime)
 {
     std::wstring imgPath{getProcImagePath(procHandle)};
     std::shared_ptr<AppIdKey> pAppId;
     if(!imgPath.empty())
     {
-        pAppId.reset(new AppIdKey{imgPath});
+        // Remember the image path in case this process starts children
+        recordProcess(pid, createTime, imgPath);
+        pAppId = _exeCache.getAppId(imgPath);
     }
     // Can't do anything if we couldn't get this process's app ID.
     if(!pAppId || !*pAppId)
@@ -683,7 +794,7 @@ void WinSplitTunnelTracker::processCreated(WinHandle procHandle, Pid_t pid,
     // and check if the parent matches any rule.  (If it does, the matching
     // WinAppTracker also checks if the new child should be considered a
     // descendant.)
-    auto pParentAppId{getProcAppId(parentHandle)};
+    auto pParentAppId{getParentAppId(parentHandle, parentPid, parentCreateTime)};
     if(!pParentAppId || !*pParentAppId)
     {
         KAPPS_CORE_WARNING() << "Couldn't get app ID for parent" << parentPid
@@ -985,6 +1096,241 @@ void WinAppMonitor::WbemEventSink::readNewProcess(IWbemClassObject &obj)
             << FileTimeTracer{approxCreateTime};
     }
 
+    // We opened the process successfully, notify WinAppMonitor
+    // (_monitorMutex is locked by Indicate())
+    assert(_pMonitor);    // Checked by Indicate()
+    _pMonitor->notifyProcessCreated(std::move(procHandle), pid,
+                                    actualCreateTime, ppid);
+}
+
+// ETW real-time session used to implement WinAppMonitor.  This enables the
+// Microsoft-Windows-Kernel-Process provider for process start events, which
+// are delivered within a few milliseconds of process creation - much sooner
+// than WMI's polled notifications, and without loading WmiPrvSE when many
+// processes are starting.
+class WinAppMonitor::EtwProcessTrace
+{
+public:
+    EtwProcessTrace(WinAppMonitor &monitor, const std::wstring &sessionName);
+    // Stops the session and waits for the processing thread to finish, so no
+    // more events are sent to WinAppMonitor after this returns.
+    ~EtwProcessTrace();
+
+    EtwProcessTrace(const EtwProcessTrace &) = delete;
+    EtwProcessTrace &operator=(const EtwProcessTrace &) = delete;
+
+public:
+    // Start the session and the processing thread.  Returns false (traced) if
+    // the session can't be started; the caller should fall back to WMI.
+    bool start();
+
+private:
+    static void WINAPI onEventRecord(PEVENT_RECORD pEvent);
+    // Initialize _properties for StartTraceW()/ControlTraceW(), which both
+    // overwrite them
+    EVENT_TRACE_PROPERTIES &initProperties();
+    void stopSession();
+    DWORD readPidProp(const EVENT_RECORD &event, const wchar_t *pPropName);
+    void handleEvent(const EVENT_RECORD &event);
+
+private:
+    WinAppMonitor &_monitor;
+    std::wstring _sessionName;
+    // EVENT_TRACE_PROPERTIES followed by space for the session name
+    std::vector<unsigned char> _properties;
+    TRACEHANDLE _session;
+    TRACEHANDLE _trace;
+    std::thread _processThread;
+};
+
+namespace
+{
+    // Microsoft-Windows-Kernel-Process
+    // {22FD69C8-50B4-4A51-8C05-BA6E18A2A86D}
+    const GUID kernelProcessProvider{0x22fd69c8, 0x50b4, 0x4a51, {0x8c, 0x05, 0xba, 0x6e, 0x18, 0xa2, 0xa8, 0x6d}};
+    // WINEVENT_KEYWORD_PROCESS - process start/stop events
+    const ULONGLONG kernelProcessKeywordProcess{0x10};
+    // Event ID of ProcessStart
+    const USHORT kernelProcessStartEventId{1};
+    // Flush interval for the session's buffers, in milliseconds.  This
+    // determines the worst-case latency of an event when few events are
+    // occurring.
+    const ULONG traceFlushMs{10};
+}
+
+WinAppMonitor::EtwProcessTrace::EtwProcessTrace(WinAppMonitor &monitor,
+                                                const std::wstring &sessionName)
+    : _monitor{monitor}, _sessionName{sessionName},
+      _properties(sizeof(EVENT_TRACE_PROPERTIES) + (sessionName.size() + 1) * sizeof(wchar_t)),
+      _session{0}, _trace{INVALID_PROCESSTRACE_HANDLE}
+{
+}
+
+WinAppMonitor::EtwProcessTrace::~EtwProcessTrace()
+{
+    stopSession();
+}
+
+EVENT_TRACE_PROPERTIES &WinAppMonitor::EtwProcessTrace::initProperties()
+{
+    std::fill(_properties.begin(), _properties.end(), 0);
+    auto &props = *reinterpret_cast<EVENT_TRACE_PROPERTIES*>(_properties.data());
+    props.Wnode.BufferSize = static_cast<ULONG>(_properties.size());
+    props.Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+    props.Wnode.ClientContext = 1;  // QueryPerformanceCounter timestamps
+    props.LogFileMode = EVENT_TRACE_REAL_TIME_MODE | EVENT_TRACE_USE_MS_FLUSH_TIMER;
+    props.FlushTimer = traceFlushMs;
+    // Small buffers - process start events are small and relatively rare
+    props.BufferSize = 4;   // KB
+    props.MinimumBuffers = 2;
+    props.LoggerNameOffset = sizeof(EVENT_TRACE_PROPERTIES);
+    return props;
+}
+
+bool WinAppMonitor::EtwProcessTrace::start()
+{
+    ULONG startErr = ::StartTraceW(&_session, _sessionName.c_str(), &initProperties());
+    if(startErr == ERROR_ALREADY_EXISTS)
+    {
+        // The session is left over from a prior run that didn't stop it
+        // (sessions outlive the process that created them).  Stop it and
+        // start over.
+        KAPPS_CORE_INFO() << "Stopping stale ETW session"
+            << core::WStringSlice{_sessionName};
+        ::ControlTraceW(0, _sessionName.c_str(), &initProperties(),
+                        EVENT_TRACE_CONTROL_STOP);
+        startErr = ::StartTraceW(&_session, _sessionName.c_str(), &initProperties());
+    }
+    if(startErr != ERROR_SUCCESS)
+    {
+        KAPPS_CORE_WARNING() << "Unable to start ETW session -"
+            << core::WinErrTracer{startErr};
+        _session = 0;
+        return false;
+    }
+
+    ULONG enableErr = ::EnableTraceEx2(_session, &kernelProcessProvider,
+                                       EVENT_CONTROL_CODE_ENABLE_PROVIDER,
+                                       TRACE_LEVEL_INFORMATION,
+                                       kernelProcessKeywordProcess, 0, 0,
+                                       nullptr);
+    if(enableErr != ERROR_SUCCESS)
+    {
+        KAPPS_CORE_WARNING() << "Unable to enable kernel process provider -"
+            << core::WinErrTracer{enableErr};
+        stopSession();
+        return false;
+    }
+
+    EVENT_TRACE_LOGFILEW logFile{};
+    logFile.LoggerName = &_sessionName[0];
+    logFile.ProcessTraceMode = PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD;
+    logFile.EventRecordCallback = &EtwProcessTrace::onEventRecord;
+    logFile.Context = this;
+    _trace = ::OpenTraceW(&logFile);
+    if(_trace == INVALID_PROCESSTRACE_HANDLE)
+    {
+        KAPPS_CORE_WARNING() << "Unable to open ETW session -"
+            << core::WinErrTracer{::GetLastError()};
+        stopSession();
+        return false;
+    }
+
+    // ProcessTrace() delivers events until the session is stopped or the
+    // trace is closed
+    _processThread = std::thread{[this]()
+    {
+        ULONG processErr = ::ProcessTrace(&_trace, 1, nullptr, nullptr);
+        KAPPS_CORE_INFO() << "ETW processing finished -"
+            << core::WinErrTracer{processErr};
+    }};
+    return true;
+}
+
+void WinAppMonitor::EtwProcessTrace::stopSession()
+{
+    if(_session)
+    {
+        ULONG stopErr = ::ControlTraceW(_session, nullptr, &initProperties(),
+                                        EVENT_TRACE_CONTROL_STOP);
+        if(stopErr != ERROR_SUCCESS)
+        {
+            KAPPS_CORE_WARNING() << "Unable to stop ETW session -"
+                << core::WinErrTracer{stopErr};
+        }
+        _session = 0;
+    }
+    if(_trace != INVALID_PROCESSTRACE_HANDLE)
+    {
+        ::CloseTrace(_trace);
+        _trace = INVALID_PROCESSTRACE_HANDLE;
+    }
+    if(_processThread.joinable())
+        _processThread.join();
+}
+
+void WINAPI WinAppMonitor::EtwProcessTrace::onEventRecord(PEVENT_RECORD pEvent)
+{
+    if(pEvent && pEvent->UserContext)
+        reinterpret_cast<EtwProcessTrace*>(pEvent->UserContext)->handleEvent(*pEvent);
+}
+
+DWORD WinAppMonitor::EtwProcessTrace::readPidProp(const EVENT_RECORD &event,
+                                                  const wchar_t *pPropName)
+{
+    PROPERTY_DATA_DESCRIPTOR desc{};
+    desc.PropertyName = reinterpret_cast<ULONGLONG>(pPropName);
+    desc.ArrayIndex = ULONG_MAX;
+    DWORD pid{0};
+    ULONG propErr = ::TdhGetProperty(const_cast<PEVENT_RECORD>(&event), 0,
+                                     nullptr, 1, &desc, sizeof(pid),
+                                     reinterpret_cast<PBYTE>(&pid));
+    if(propErr != ERROR_SUCCESS)
+    {
+        KAPPS_CORE_WARNING() << "Failed to read" << core::WStringSlice{pPropName}
+            << "from process start event -" << core::WinErrTracer{propErr};
+        return 0;
+    }
+    return pid;
+}
+
+void WinAppMonitor::EtwProcessTrace::handleEvent(const EVENT_RECORD &event)
+{
+    if(event.EventHeader.ProviderId != kernelProcessProvider ||
+        event.EventHeader.EventDescriptor.Id != kernelProcessStartEventId)
+    {
+        return;
+    }
+
+    DWORD pid = readPidProp(event, L"ProcessID");
+    DWORD ppid = readPidProp(event, L"ParentProcessID");
+    if(!pid || !ppid)
+        return; // Traced by readPidProp()
+
+    KAPPS_CORE_INFO() << "Parent" << ppid << "->" << pid;
+
+    // The event is logged while the process is being created, so the PID
+    // can't have been reused yet unless the process has already exited.
+    WinHandle procHandle{::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid)};
+    if(!procHandle)
+    {
+        KAPPS_CORE_WARNING() << "Unable to open process" << pid;
+        return;
+    }
+    FILETIME createTime, ignored1, ignored2, ignored3;
+    if(!::GetProcessTimes(procHandle.get(), &createTime, &ignored1, &ignored2,
+                          &ignored3))
+    {
+        KAPPS_CORE_WARNING() << "Unable to get creation time of" << pid;
+        return;
+    }
+
+    _monitor.notifyProcessCreated(std::move(procHandle), pid, createTime, ppid);
+}
+
+void WinAppMonitor::notifyProcessCreated(WinHandle procHandle, DWORD pid,
+                                         const FILETIME &createTime, DWORD ppid)
+{
     // Open the parent process
     WinHandle parentHandle{::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, ppid)};
     if(!parentHandle)
@@ -995,7 +1341,7 @@ void WinAppMonitor::WbemEventSink::readNewProcess(IWbemClassObject &obj)
     }
     // Check if this is really the right parent process, in case the PID was
     // reused
-    FILETIME parentCreateTime;
+    FILETIME parentCreateTime, ignored1, ignored2, ignored3;
     if(!::GetProcessTimes(parentHandle.get(), &parentCreateTime, &ignored1,
                           &ignored2, &ignored3))
     {
@@ -1006,11 +1352,11 @@ void WinAppMonitor::WbemEventSink::readNewProcess(IWbemClassObject &obj)
 
     // If the parent process is newer, the PID was reused.  (If they're the
     // same, we're unsure but we assume it's the correct one.)
-    if(::CompareFileTime(&parentCreateTime, &actualCreateTime) > 0)
+    if(::CompareFileTime(&parentCreateTime, &createTime) > 0)
     {
         KAPPS_CORE_WARNING() << "Ignoring PID" << pid
             << "- parent PID" << ppid << "was reused.  Child was created at"
-            << FileTimeTracer{actualCreateTime} << "- parent reported"
+            << FileTimeTracer{createTime} << "- parent reported"
             << FileTimeTracer{parentCreateTime};
         // There's no reason to check the child if the parent PID was reused.
         // - If this had been a child of a process that we're excluding, we
@@ -1022,14 +1368,13 @@ void WinAppMonitor::WbemEventSink::readNewProcess(IWbemClassObject &obj)
         return;
     }
 
-    // We opened the process successfully, notify WinAppMonitor
-    // (_monitorMutex is locked by Indicate())
-    assert(_pMonitor);    // Checked by Indicate()
-    _pMonitor->_tracker.processCreated(std::move(procHandle), pid,
-                                       std::move(parentHandle), ppid);
+
+    _tracker.processCreated(std::move(procHandle), pid, createTime,
+                            std::move(parentHandle), ppid, parentCreateTime);
 }
 
-WinAppMonitor::WinAppMonitor()
+WinAppMonitor::WinAppMonitor(std::wstring traceSessionName)
+    : _traceSessionName{std::move(traceSessionName)}
 {
     _tracker.appIdsChanged = [this]{appIdsChanged();};
 
@@ -1072,16 +1417,40 @@ WinAppMonitor::~WinAppMonitor()
 
 void WinAppMonitor::activate()
 {
-    if(_pSink || _pSinkStubSink)
+    if(_pEtwTrace || _pSink || _pSinkStubSink)
         return; // Already active, skip trace
 
+    if(!activateEtw())
+        activateWmi();
+}
+
+bool WinAppMonitor::activateEtw()
+{
+    if(_traceSessionName.empty())
+        return false;
+
+    KAPPS_CORE_INFO() << "Activating ETW monitor";
+    std::unique_ptr<EtwProcessTrace> pTrace{new EtwProcessTrace{*this, _traceSessionName}};
+    if(!pTrace->start())
+    {
+        KAPPS_CORE_WARNING() << "Unable to activate ETW monitor, falling back to WMI";
+        return false;
+    }
+
+    KAPPS_CORE_INFO() << "Successfully activated ETW monitor";
+    _pEtwTrace = std::move(pTrace);
+    return true;
+}
+
+void WinAppMonitor::activateWmi()
+{
     if(!_pSvcs)
     {
         KAPPS_CORE_WARNING() << "Can't activate monitor, couldn't connect to WMI";
         return;
     }
 
-    KAPPS_CORE_INFO() << "Activating monitor";
+    KAPPS_CORE_INFO() << "Activating WMI monitor";
 
     auto pAptmt = WinComPtr<IUnsecuredApartment>::createLocalInst(CLSID_UnsecuredApartment, IID_IUnsecuredApartment);
     if(!pAptmt)
@@ -1152,17 +1521,19 @@ void WinAppMonitor::activate()
         return;
     }
 
-    KAPPS_CORE_INFO() << "Successfully activated monitor";
+    KAPPS_CORE_INFO() << "Successfully activated WMI monitor";
     _pSink = std::move(pNewSink);
     _pSinkStubSink = std::move(pNewSinkStubSink);
 }
 
 void WinAppMonitor::deactivate()
 {
-    if(!_pSinkStubSink && !_pSink)
+    if(!_pEtwTrace && !_pSinkStubSink && !_pSink)
         return; // Skip trace
 
     KAPPS_CORE_INFO() << "Deactivating monitor";
+    // Waits for the ETW processing thread to finish
+    _pEtwTrace.reset();
     if(_pSvcs && _pSinkStubSink)
         _pSvcs->CancelAsyncCall(_pSinkStubSink.get());
     // We don't know when the sink will actually be released, so we have to
@@ -1188,7 +1559,8 @@ void WinAppMonitor::setSplitTunnelRules(const std::unordered_set<std::wstring> &
 
 void WinAppMonitor::dump() const
 {
-    KAPPS_CORE_INFO() << "_pSvcs:" << !!_pSvcs << "- pSink:" << !!_pSink
+    KAPPS_CORE_INFO() << "_pEtwTrace:" << !!_pEtwTrace << "- _pSvcs:" << !!_pSvcs
+        << "- pSink:" << !!_pSink
         << "- pSinkStubSink:" << !!_pSinkStubSink;
     _tracker.dump();
 }
@@ -18,20 +18,76 @@
 
 #pragma once
 #include "win_firewall.h"
+#include "../constrainedhash.h"
 #include <kapps_core/src/win/win_com.h>
 #include <kapps_core/src/win/win_handle.h>
 #include <kapps_core/src/win/win_wait.h>
-#include <kapps_core/src/workqueue.h>
+#include <kapps_core/src/threadpool.h>
 #include <kapps_core/src/coresignal.h>
+#include <kapps_core/src/flathashmap.h>
 #include <WbemIdl.h>
 #include <set>
 #include <unordered_set>
-#include <unordered_map>
 #include <functional>
+#include <memory>
 #include <mutex>
 
 namespace kapps { namespace net {
 
+// WinExecutableCache remembers the app ID and signer names of recently observed
+// executables.  Builds, browser launches, etc. can start hundreds of processes
+// per second, nearly all from a handful of executables, so this avoids loading
+// the app ID and verifying the signature again for each one.
+//
+// Entries are keyed by image path and are checked against the file's last
+// write time and size on each use, so an executable that is replaced (say, by
+// an update) is loaded again.
+class KAPPS_NET_EXPORT WinExecutableCache
+{
+private:
+    struct FileStamp
+    {
+        FILETIME _lastWrite;
+        DWORD _sizeHigh;
+        DWORD _sizeLow;
+
+        bool operator==(const FileStamp &other) const;
+        bool operator!=(const FileStamp &other) const {return !(*this == other);}
+    };
+
+    struct Entry
+    {
+        FileStamp _stamp;
+        // The app ID, once it has been loaded successfully
+        std::shared_ptr<AppIdKey> _pAppId;
+        // The signer names, once they have been checked (empty if the file is
+        // not signed)
+        bool _haveSignerNames;
+        std::set<std::wstring> _signerNames;
+    };
+
+public:
+    explicit WinExecutableCache(std::size_t maxSize);
+
+public:
+    // Get the app ID for an executable (empty if it can't be loaded).
+    std::shared_ptr<AppIdKey> getAppId(const std::wstring &imgPath);
+    // Get the signer names for an executable.
+    std::set<std::wstring> getSignerNames(const std::wstring &imgPath);
+
+private:
+    // Find the entry for an executable, or add one if it isn't known or the
+    // file has changed.  Returns nullptr if the file's attributes can't be
+    // read - the caller just loads the data directly in that case.  The
+    // pointer is valid until _entries is modified.
+    Entry *findEntry(const std::wstring &imgPath);
+
+private:
+    // Used from the process monitor thread and WinAppTrackers
+    std::mutex _mutex;
+    ConstrainedHash<std::wstring, Entry> _entries;
+};
+
 // WinAppTracker is part of the implementation of WinAppMonitor.  It keeps track
 // of the current set of excluded apps, and it is notified when processes are
 // created/destroyed.
@@ -91,14 +147,16 @@ private:
 
     // This map contains data about the excluded processes, and also provides a
     // way to look up processes by PID alone.
-    using ProcDataMap = std::unordered_map<Pid_t, ProcessData>;
+    using ProcDataMap = core::FlatHashMap<Pid_t, ProcessData>;
 
 public:
-    // waitCleanupThread is used to clean up WinSingleWait objects that trigger,
+    // cleanupStrand is used to clean up WinSingleWait objects that trigger,
     // since we can't destroy them during the callback function.
-    // WinSplitTunnelTracker provides this thread; the WinAppTrackers all share
-    // it.
-    WinAppTracker(SplitType type, core::WorkThread &cleanupThread);
+    // WinSplitTunnelTracker provides this strand; the WinAppTrackers all share
+    // it.  exeCache is similarly shared to check the signatures of new
+    // processes.
+    WinAppTracker(SplitType type, core::Strand &cleanupStrand,
+                  WinExecutableCache &exeCache);
 
 public:
     // Get all the current known app IDs for this rule type.
@@ -168,14 +226,15 @@ public:
 
 private:
     const SplitType _type;
-    core::WorkThread &_cleanupThread;
+    core::Strand &_cleanupStrand;
+    WinExecutableCache &_exeCache;
     // _mutex protects _apps and _procData, because it receives method calls
     // from the WMI thread, product thread, and thread pol threads.
     mutable std::mutex _mutex;
     // These are the current app IDs for this rule type, along with all PIDs
     // currently associated with those app IDs.
     ExcludedApps_t _apps;
-    std::unordered_map<Pid_t, ProcessData> _procData;
+    ProcDataMap _procData;
 };
 
 // WinSplitTunnelTracker managers WinAppTracker objects for each type of split
@@ -189,10 +248,26 @@ public:
 public:
     WinSplitTunnelTracker();
 
+private:
+    // A process observed recently, used to find the image path of parent
+    // processes without querying them.  The creation time identifies the
+    // process in case the PID has been reused.
+    struct RecentProcess
+    {
+        FILETIME _createTime;
+        std::wstring _imgPath;
+    };
+
 private:
     std::wstring getProcImagePath(const WinHandle &procHandle) const;
-    // Get the app ID for a process (empty if it can't be retrieved).
-    std::shared_ptr<AppIdKey> getProcAppId(const WinHandle &procHandle) const;
+    void recordProcess(Pid_t pid, const FILETIME &createTime,
+                       const std::wstring &imgPath);
+    // Get the app ID for a new process's parent (empty if it can't be
+    // retrieved).  Uses the image path recorded when the parent was created if
+    // possible.
+    std::shared_ptr<AppIdKey> getParentAppId(const WinHandle &parentHandle,
+                                             Pid_t parentPid,
+                                             const FILETIME &parentCreateTime);
 
 public:
     // Get all the current known excluded app IDs - both the app IDs from rules
@@ -208,9 +283,11 @@ public:
     bool setSplitTunnelRules(const std::unordered_set<std::wstring> &excludedExes,
                              const std::unordered_set<std::wstring> &vpnOnlyExes);
 
-    // A process has been created.
+    // A process has been created.  The creation times are from
+    // GetProcessTimes().
     void processCreated(WinHandle procHandle, Pid_t pid,
-                        WinHandle parentHandle, Pid_t parentPid);
+                        const FILETIME &createTime, WinHandle parentHandle,
+                        Pid_t parentPid, const FILETIME &parentCreateTime);
 
     void dump() const;
 
@@ -219,9 +296,17 @@ public:
     core::ThreadSignal<> appIdsChanged;
 
 private:
-    // Cleanup thread provided to each WinAppTracker so they can clean up
+    // Cleanup strand provided to each WinAppTracker so they can clean up
     // WinSingleWait objects that have triggered.
-    core::WorkThread _cleanupThread;
+    core::Strand _cleanupStrand;
+    // App IDs and signer names of recently observed executables, shared with
+    // the WinAppTrackers
+    WinExecutableCache _exeCache;
+    // Image paths of recently created processes, by PID.  Most processes are
+    // started by a process that we observed being created, so this avoids
+    // querying the parent's image path for each new process.
+    std::mutex _recentProcessesMutex;
+    ConstrainedHash<Pid_t, RecentProcess> _recentProcesses;
     // It is possible (though unlikely) that we could end up identifying the
     // same executable path as both a VpnOnly app and an Excluded app (such as
     // if the shortcut and exe path both appeared as rules with different
@@ -242,22 +327,36 @@ private:
 // we watch what the app does at runtime.
 //
 // Most of the implementation of WinAppMonitor is delegated to
-// WinSplitTunnelTracker and WinAppTracker.  WinAppMonitor itself handle the
-// connection to WMI - it creates the WbemEventSink when any rules are active,
-// and deactivates it if it's no longer needed.
+// WinSplitTunnelTracker and WinAppTracker.  WinAppMonitor itself handles the
+// source of process creation events - it starts a real-time ETW session for
+// the kernel process provider when any rules are active, and stops it if it's
+// no longer needed.  If the ETW session can't be started, it falls back to a
+// WMI notification query (WbemEventSink), which has much higher latency.
 class KAPPS_NET_EXPORT WinAppMonitor
 {
 private:
     class WbemEventSink;
+    class EtwProcessTrace;
 
 public:
-    WinAppMonitor();
+    // traceSessionName is the name of the ETW session used to observe process
+    // creation; it must be unique to this product.  If it's empty, only WMI
+    // is used.
+    explicit WinAppMonitor(std::wstring traceSessionName = {});
     ~WinAppMonitor();
 
 private:
     void activate();
+    bool activateEtw();
+    void activateWmi();
     void deactivate();
 
+    // A new process was observed by either event source.  Opens the parent
+    // process, checks that the parent PID wasn't reused, and passes both to
+    // the tracker.
+    void notifyProcessCreated(WinHandle procHandle, DWORD pid,
+                              const FILETIME &createTime, DWORD ppid);
+
 public:
     // Get the current excluded app IDs; see WinAppTracker.
     AppIdSet getExcludedAppIds() const {return _tracker.getExcludedAppIds();}
@@ -275,13 +374,17 @@ public:
     // with getExcludedAppIds().)
     //
     // Note that this can be invoked from a number of different threads - the
-    // WMI thread, thread pool threads, or even the product's thread (during
-    // setSplitTunnelRules).  The connected function should typically just queue
-    // a notification to the product's thread.
+    // ETW or WMI thread, thread pool threads, or even the product's thread
+    // (during setSplitTunnelRules).  The connected function should typically
+    // just queue a notification to the product's thread.
     core::ThreadSignal<> appIdsChanged;
 
 private:
     WinSplitTunnelTracker _tracker;
+    const std::wstring _traceSessionName;
+    // The ETW session is active only when notifications are active and it
+    // could be started; otherwise WMI is used.
+    std::unique_ptr<EtwProcessTrace> _pEtwTrace;
     // IWbemServices is loaded at startup, this is always valid if we were able
     // to connect to WMI.
     WinComPtr<IWbemServices> _pSvcs;
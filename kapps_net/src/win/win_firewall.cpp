@@ -179,7 +179,7 @@ namespace
 
 WinFirewall::WinFirewall(FirewallConfig config)
     : _config{std::move(config)},
-      _subnetBypass{std::make_unique<WinRouteManager>()},
+      _subnetBypass{std::make_unique<WinRouteManager>(true)},
       _firewall{new FirewallEngine{_config.brandInfo}},
       _filterAdapterLuid{0},
       // Ensure our filters are zero-initialized - since
@@ -569,11 +569,8 @@ void WinFirewall::updateAllBypassSubnetFilters(const FirewallParams &params)
     }
 }
 
-void WinFirewall::updateBypassSubnetFilters(const std::set<std::string> &subnets, std::set<std::string> &oldSubnets, std::vector<WfpFilterObject> &subnetBypassFilters, FWP_IP_VERSION ipVersion)
+void WinFirewall::updateBypassSubnetFilters(const std::set<std::string> &subnets, std::set<std::string> &oldSubnets, SubnetFilterMap &subnetBypassFilters, FWP_IP_VERSION ipVersion)
 {
-    for (auto &filter : subnetBypassFilters)
-        deactivateFilter(filter, true);
-
     // If we have any IPv6 subnets we need to also whitelist IPv6 link-local and broadcast ranges
     // required by IPv6 Neighbor Discovery
     auto adjustedSubnets = subnets;
@@ -583,22 +580,38 @@ void WinFirewall::updateBypassSubnetFilters(const std::set<std::string> &subnets
         adjustedSubnets.emplace("ff00::/8");
     }
 
-    subnetBypassFilters.resize(adjustedSubnets.size());
+    // Only the filters for subnets that were removed or added change; the
+    // filters for the other subnets are left in place.
+    for(auto it = subnetBypassFilters.begin(); it != subnetBypassFilters.end(); )
+    {
+        if(adjustedSubnets.count(it->first))
+        {
+            ++it;
+            continue;
+        }
+        KAPPS_CORE_INFO() << "Removing Subnet rule" << it->first;
+        deactivateFilter(it->second, true);
+        it = subnetBypassFilters.erase(it);
+    }
 
-    int index{0};
-    for(auto it = adjustedSubnets.begin(); it != adjustedSubnets.end(); ++it, ++index)
+    for(const auto &subnet : adjustedSubnets)
     {
+        // A filter that failed to activate previously is zeroGuid, so it's
+        // tried again
+        WfpFilterObject &filter = subnetBypassFilters[subnet];
+        if(filter != zeroGuid)
+            continue;
         if(ipVersion == FWP_IP_VERSION_V6)
         {
-            KAPPS_CORE_INFO() << "Creating Subnet ipv6 rule" << *it;
-            activateFilter(subnetBypassFilters[index], true,
-                IPSubnetFilter<FWP_ACTION_PERMIT, FWP_DIRECTION_OUTBOUND, FWP_IP_VERSION_V6>(*it, 10));
+            KAPPS_CORE_INFO() << "Creating Subnet ipv6 rule" << subnet;
+            activateFilter(filter, true,
+                IPSubnetFilter<FWP_ACTION_PERMIT, FWP_DIRECTION_OUTBOUND, FWP_IP_VERSION_V6>(subnet, 10));
         }
         else
         {
-            KAPPS_CORE_INFO() << "Creating Subnet ipv4 rule" << *it;
-            activateFilter(subnetBypassFilters[index], true,
-                IPSubnetFilter<FWP_ACTION_PERMIT, FWP_DIRECTION_OUTBOUND, FWP_IP_VERSION_V4>(*it, 10));
+            KAPPS_CORE_INFO() << "Creating Subnet ipv4 rule" << subnet;
+            activateFilter(filter, true,
+                IPSubnetFilter<FWP_ACTION_PERMIT, FWP_DIRECTION_OUTBOUND, FWP_IP_VERSION_V4>(subnet, 10));
         }
     }
 
@@ -606,6 +619,17 @@ void WinFirewall::updateBypassSubnetFilters(const std::set<std::string> &subnets
     oldSubnets = subnets;
 }
 
+void WinFirewall::removeAppFilters(SplitAppFilters &appFilters)
+{
+    deactivateFilter(appFilters.splitAppBind, true);
+    deactivateFilter(appFilters.splitAppConnect, true);
+    deactivateFilter(appFilters.appPermitAnyDns, true);
+    deactivateFilter(appFilters.splitAppFlowEstablished, true);
+    deactivateFilter(appFilters.permitApp, true);
+    deactivateFilter(appFilters.blockAppIpv4, true);
+    deactivateFilter(appFilters.blockAppIpv6, true);
+}
+
 void WinFirewall::removeSplitTunnelAppFilters(SplitAppFilterMap &apps,
                                             const core::StringSlice &traceType)
 {
@@ -613,17 +637,29 @@ void WinFirewall::removeSplitTunnelAppFilters(SplitAppFilterMap &apps,
     {
         KAPPS_CORE_INFO() << "remove" << traceType << "app filters:"
             << core::tracePointer(oldApp.first);
-        deactivateFilter(oldApp.second.splitAppBind, true);
-        deactivateFilter(oldApp.second.splitAppConnect, true);
-        deactivateFilter(oldApp.second.appPermitAnyDns, true);
-        deactivateFilter(oldApp.second.splitAppFlowEstablished, true);
-        deactivateFilter(oldApp.second.permitApp, true);
-        deactivateFilter(oldApp.second.blockAppIpv4, true);
-        deactivateFilter(oldApp.second.blockAppIpv6, true);
+        removeAppFilters(oldApp.second);
     }
     apps.clear();
 }
 
+void WinFirewall::removeStaleAppFilters(SplitAppFilterMap &apps,
+                                        const AppIdSet &newApps,
+                                        const core::StringSlice &traceType)
+{
+    for(auto it = apps.begin(); it != apps.end(); )
+    {
+        if(it->first && newApps.count(it->first))
+        {
+            ++it;
+            continue;
+        }
+        KAPPS_CORE_INFO() << "remove" << traceType << "app filters:"
+            << core::tracePointer(it->first);
+        removeAppFilters(it->second);
+        it = apps.erase(it);
+    }
+}
+
 void WinFirewall::createBypassAppFilters(SplitAppFilterMap &apps,
                                          const WfpProviderContextObject &context,
                                          const std::shared_ptr<const AppIdKey> &pAppId, bool rewriteDns)
@@ -742,10 +778,6 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
     bool sameVpnOnlyApps = areAppsUnchanged(newVpnOnlyApps, vpnOnlyApps);
     bool sameVpnOnlyResolvers = areAppsUnchanged(newVpnOnlyResolvers, vpnOnlyResolvers);
 
-    // If anything changes, we have to delete all filters and recreate
-    // everything.  WFP has been known to throw spurious errors if we try to
-    // reuse callout or context objects, so we delete everything in order to
-    // tear those down and recreate them.
     if(sameExcludedApps && sameVpnOnlyApps && sameVpnOnlyResolvers &&
         _lastSplitParams == params)
     {
@@ -755,6 +787,56 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
         return;
     }
 
+    // We can only create exclude rules when the appropriate bind IP address is known
+    bool createExcludedRules = !params._physicalIp.empty() && !newExcludedApps.empty();
+    // VPN-only rules are applied even if the last tunnel IP is not known
+    // though; we still apply the block rule ("per-app killswitch") until the IP
+    // is known.
+    bool createVpnOnlyRules = !newVpnOnlyApps.empty() || !newVpnOnlyResolvers.empty();
+    // We create bind rules for VPN-only apps when connected and the IP is
+    // known; otherwise we just create a block rule (which does not require the
+    // callout/context objects).
+    bool createVpnOnlyBindRules = params._hasConnected && !params._tunnelIp.empty();
+    // Callout and context objects are needed for any callout rules.  These
+    // aren't needed if split tunnel is completely inactive, or if we are just
+    // blocking VPN-only apps (per-app block rules don't require any callouts).
+    bool createCallouts = createExcludedRules || (createVpnOnlyRules && createVpnOnlyBindRules);
+
+    // The callout and context objects only depend on some of the split tunnel
+    // params.  If those haven't changed, and we still need the same objects,
+    // the existing app filters are still valid - just remove and add the
+    // filters for the apps that changed.  This is common when apps are
+    // launched or exit while split tunnel is active, and when the connection
+    // state changes without changing the tunnel IP.
+    if(_lastSplitParams.contextEquals(params) &&
+        createCallouts == (_filters.splitCalloutBind != zeroGuid))
+    {
+        if(!(_lastSplitParams == params))
+        {
+            _lastSplitParams = params;
+            KAPPS_CORE_INFO() << "Updating split tunnel DNS state with state"
+                << _lastSplitParams;
+            updateSplitTunnelDnsState();
+        }
+        KAPPS_CORE_INFO() << "Updating split tunnel app rules - excluded:"
+            << newExcludedApps.size() << "- VPN-only:" << newVpnOnlyApps.size()
+            << "- resolvers:" << newVpnOnlyResolvers.size();
+        AppIdSet emptyApps;
+        removeStaleAppFilters(excludedApps,
+            createExcludedRules ? newExcludedApps : emptyApps, "excluded");
+        removeStaleAppFilters(vpnOnlyApps, newVpnOnlyApps, "VPN-only");
+        removeStaleAppFilters(vpnOnlyResolvers, newVpnOnlyResolvers, "resolvers");
+        createSplitTunnelAppFilters(newExcludedApps, newVpnOnlyApps,
+                                    newVpnOnlyResolvers, createExcludedRules,
+                                    createVpnOnlyBindRules);
+        return;
+    }
+
+    // Otherwise, we have to delete all filters and recreate everything.  WFP
+    // has been known to throw spurious errors if we try to reuse callout or
+    // context objects, so we delete everything in order to tear those down
+    // and recreate them.
+
     if(_filters.ipInbound != zeroGuid)
     {
         KAPPS_CORE_INFO() << "deactivate IpInbound object";
@@ -831,17 +913,6 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
     _lastSplitParams = params;
     KAPPS_CORE_INFO() << "Creating split tunnel rules with state" << _lastSplitParams;
 
-    // We can only create exclude rules when the appropriate bind IP address is known
-    bool createExcludedRules = !_lastSplitParams._physicalIp.empty() && !newExcludedApps.empty();
-    // VPN-only rules are applied even if the last tunnel IP is not known
-    // though; we still apply the block rule ("per-app killswitch") until the IP
-    // is known.
-    bool createVpnOnlyRules = !newVpnOnlyApps.empty() || !newVpnOnlyResolvers.empty();
-    // We create bind rules for VPN-only apps when connected and the IP is
-    // known; otherwise we just create a block rule (which does not require the
-    // callout/context objects).
-    bool createVpnOnlyBindRules = _lastSplitParams._hasConnected && !_lastSplitParams._tunnelIp.empty();
-
     // See Driver.c in desktop-wfp-callout
     struct ContextData
     {
@@ -857,11 +928,7 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
 
     // Create the new callout and context objects if any callout rules are
     // needed.
-    //
-    // These aren't needed if split tunnel is completely inactive, or if we are
-    // just blocking VPN-only apps (per-app block rules don't require any
-    // callouts).
-    if(createExcludedRules || (createVpnOnlyRules && createVpnOnlyBindRules))
+    if(createCallouts)
     {
         if(_lastSplitParams._forceVpnOnlyDns)
         {
@@ -955,20 +1022,12 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
             << "- VPN-only bind:" << createVpnOnlyBindRules;
     }
 
-    // If we are rewriting DNS for any app rule, activate these filters and
-    // stop the DNSCache service if it's running
-    if(bypassContext.rewriteDnsServer || vpnOnlyContext.rewriteDnsServer)
+    _rewriteBypassDns = bypassContext.rewriteDnsServer != 0;
+    _rewriteVpnOnlyDns = vpnOnlyContext.rewriteDnsServer != 0;
+
+    // If we are rewriting DNS for any app rule, activate these filters
+    if(_rewriteBypassDns || _rewriteVpnOnlyDns)
     {
-        // If DNS leak protection is active, we need to explicitly permit
-        // injected DNS, since the existing DNS servers would be blocked
-        // normally.
-        if(params._blockDNS)
-        {
-            activateFilter(_filters.permitInjectedDns, true,
-                            CalloutDNSFilter<FWP_IP_VERSION_V4>{
-                                _config.brandInfo.wfpCalloutConnectAuthV4,
-                                FWPM_LAYER_ALE_AUTH_CONNECT_V4, 11});
-        }
         // DNS rewriting occurs in the IPPACKET layers.  Outbound packets have
         // to be injected at the IP layer (not at the transport layer) because
         // we have to rewrite the source to the physical interface.  That means
@@ -979,7 +1038,28 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
         activateFilter(_filters.ipOutbound, true, IpOutboundFilter{_config.brandInfo.wfpCalloutIppacketOutboundV4, zeroGuid, 10});
     }
 
-    if(_lastSplitParams._isConnected && (bypassContext.rewriteDnsServer || vpnOnlyContext.rewriteDnsServer))
+    updateSplitTunnelDnsState();
+
+    createSplitTunnelAppFilters(newExcludedApps, newVpnOnlyApps,
+                                newVpnOnlyResolvers, createExcludedRules,
+                                createVpnOnlyBindRules);
+}
+
+void WinFirewall::updateSplitTunnelDnsState()
+{
+    bool rewriteDns = _rewriteBypassDns || _rewriteVpnOnlyDns;
+
+    // If DNS leak protection is active while rewriting DNS, we need to
+    // explicitly permit injected DNS, since the existing DNS servers would be
+    // blocked normally.
+    bool permitInjectedDns = rewriteDns && _lastSplitParams._blockDNS;
+    deactivateFilter(_filters.permitInjectedDns, !permitInjectedDns);
+    activateFilter(_filters.permitInjectedDns, permitInjectedDns,
+                    CalloutDNSFilter<FWP_IP_VERSION_V4>{
+                        _config.brandInfo.wfpCalloutConnectAuthV4,
+                        FWPM_LAYER_ALE_AUTH_CONNECT_V4, 11});
+
+    if(_lastSplitParams._isConnected && rewriteDns)
     {
         // enableDnscache is checked by applyRules(), it suppresses
         // _forceVpnOnlyDns/_forceBypassDns if it wasn't provided
@@ -1004,26 +1084,38 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
         // WireGuard or the OpenVPN static (non-DHCP) method.
         _config.brandInfo.enableDnscache(true);
     }
+}
 
+void WinFirewall::createSplitTunnelAppFilters(const AppIdSet &newExcludedApps,
+                                              const AppIdSet &newVpnOnlyApps,
+                                              const AppIdSet &newVpnOnlyResolvers,
+                                              bool createExcludedRules,
+                                              bool createVpnOnlyBindRules)
+{
+    // Apps that already have filters are skipped
     if(createExcludedRules)
     {
         KAPPS_CORE_INFO() << "Creating exclude rules for" << newExcludedApps.size() << "apps";
         for(const auto &pAppId : newExcludedApps)
         {
+            if(excludedApps.count(pAppId))
+                continue;
             createBypassAppFilters(excludedApps, _filters.providerContextKey,
-                                   pAppId, bypassContext.rewriteDnsServer);
+                                   pAppId, _rewriteBypassDns);
         }
     }
 
-    if(createVpnOnlyRules)
+    if(!newVpnOnlyApps.empty() || !newVpnOnlyResolvers.empty())
     {
         KAPPS_CORE_INFO() << "Creating VPN-only rules for" << newVpnOnlyApps.size() << "apps";
         for(const auto &pAppId : newVpnOnlyApps)
         {
+            if(vpnOnlyApps.count(pAppId))
+                continue;
             if(createVpnOnlyBindRules)
             {
                 createOnlyVPNAppFilters(vpnOnlyApps, _filters.vpnOnlyProviderContextKey,
-                                        pAppId, vpnOnlyContext.rewriteDnsServer);
+                                        pAppId, _rewriteVpnOnlyDns);
             }
             else
             {
@@ -1033,6 +1125,8 @@ void WinFirewall::reapplySplitTunnelFirewall(const SplitTunnelFirewallParams &pa
         KAPPS_CORE_INFO() << "Creating VPN-only rules for" << newVpnOnlyResolvers.size() << "apps";
         for(const auto &pAppId : newVpnOnlyResolvers)
         {
+            if(vpnOnlyResolvers.count(pAppId))
+                continue;
             if(createVpnOnlyBindRules)
             {
                 createOnlyVPNAppFilters(vpnOnlyResolvers, _filters.vpnOnlyProviderContextKey,
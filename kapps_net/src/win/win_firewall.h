@@ -125,21 +125,31 @@ namespace kapps { namespace net {
         std::vector<core::Ipv4Address> _effectiveDnsServers;
 
     public:
-        bool operator==(const SplitTunnelFirewallParams &other)
+        // Whether the callout and provider context objects built from these
+        // params would be the same as those built from other.  The per-app
+        // filters reference those objects, so they only have to be recreated
+        // when this changes - _isConnected and _blockDNS can change without
+        // touching any app filters.
+        bool contextEquals(const SplitTunnelFirewallParams &other) const
         {
             return _physicalIp == other._physicalIp &&
                 _physicalNetPrefix == other._physicalNetPrefix &&
                 _tunnelIp == other._tunnelIp &&
-                _isConnected == other._isConnected &&
                 _hasConnected == other._hasConnected &&
                 _vpnDefaultRoute == other._vpnDefaultRoute &&
-                _blockDNS == other._blockDNS &&
                 _forceVpnOnlyDns == other._forceVpnOnlyDns &&
                 _forceBypassDns == other._forceBypassDns &&
                 _existingDnsServers == other._existingDnsServers &&
                 _effectiveDnsServers == other._effectiveDnsServers;
         }
 
+        bool operator==(const SplitTunnelFirewallParams &other) const
+        {
+            return contextEquals(other) &&
+                _isConnected == other._isConnected &&
+                _blockDNS == other._blockDNS;
+        }
+
         void trace(std::ostream &os) const
         {
             os << "- physical IP known: " << !_physicalIp.empty()
@@ -160,6 +170,8 @@ namespace kapps { namespace net {
         {
         private:
             using SplitAppFilterMap = std::map<std::shared_ptr<const AppIdKey>, SplitAppFilters, core::PtrValueLess>;
+            // Subnet bypass filters, keyed by subnet
+            using SubnetFilterMap = std::map<std::string, WfpFilterObject>;
 
         public:
             WinFirewall(FirewallConfig config);
@@ -192,9 +204,14 @@ namespace kapps { namespace net {
 
             void updateAllBypassSubnetFilters(const FirewallParams &params);
             void updateBypassSubnetFilters(const std::set<std::string> &subnets, std::set<std::string> &oldSubnets,
-                                   std::vector<WfpFilterObject> &subnetBypassFilters, FWP_IP_VERSION ipVersion);
+                                   SubnetFilterMap &subnetBypassFilters, FWP_IP_VERSION ipVersion);
+            void removeAppFilters(SplitAppFilters &appFilters);
             void removeSplitTunnelAppFilters(SplitAppFilterMap &apps,
                                      const core::StringSlice &traceType);
+            // Remove filters for apps that aren't in newApps, keeping the rest
+            void removeStaleAppFilters(SplitAppFilterMap &apps,
+                                       const AppIdSet &newApps,
+                                       const core::StringSlice &traceType);
             void createBypassAppFilters(SplitAppFilterMap &apps,
                                 const WfpProviderContextObject &context,
                                 const std::shared_ptr<const AppIdKey> &pAppId, bool rewriteDns);
@@ -207,6 +224,17 @@ namespace kapps { namespace net {
                                     const AppIdSet &newExcludedApps,
                                     const AppIdSet &newVpnOnlyApps,
                                     const AppIdSet &newVpnOnlyResolvers);
+            // Update the injected DNS permit filter and Dnscache state for
+            // _lastSplitParams; these depend on the connection state and DNS
+            // leak protection, but not on the callout or context objects.
+            void updateSplitTunnelDnsState();
+            // Create filters for any apps that don't have them yet, using the
+            // callout and context objects that are currently active
+            void createSplitTunnelAppFilters(const AppIdSet &newExcludedApps,
+                                             const AppIdSet &newVpnOnlyApps,
+                                             const AppIdSet &newVpnOnlyResolvers,
+                                             bool createExcludedRules,
+                                             bool createVpnOnlyBindRules);
 
         private:
             const FirewallConfig _config{};
@@ -219,7 +247,11 @@ namespace kapps { namespace net {
 
             // Inputs to reapplySplitTunnelFirewall() - the last set of inputs used is
             // stored so we know when to recreate the firewall rules.
-            SplitTunnelFirewallParams _lastSplitParams;
+            SplitTunnelFirewallParams _lastSplitParams{};
+            // Whether the active provider contexts rewrite DNS for bypass and
+            // VPN-only apps, which determines the filters created for each app
+            bool _rewriteBypassDns{false};
+            bool _rewriteVpnOnlyDns{false};
 
             UINT64 _filterAdapterLuid{0}; // LUID of the TAP adapter used in some rules
             std::string _dnsServers[2]; // Last DNS servers that we applied
@@ -232,7 +264,7 @@ namespace kapps { namespace net {
             std::set<std::string> _bypassIpv4Subnets;
             std::set<std::string> _bypassIpv6Subnets;
 
-            std::vector<WfpFilterObject> _subnetBypassFilters4;
-            std::vector<WfpFilterObject> _subnetBypassFilters6;
+            SubnetFilterMap _subnetBypassFilters4;
+            SubnetFilterMap _subnetBypassFilters6;
         };
     }}
@@ -18,9 +18,66 @@
 
 #include "win_routemanager.h"
 #include <kapps_core/src/win/win_error.h>
+#include <kapps_core/src/win/win_handle.h>
+#include <set>
+#include <utility>
 
 namespace kapps { namespace net {
 
+namespace
+{
+    class WinMibDeleter
+    {
+    public:
+        template<class MibType>
+        void operator()(MibType *pMib){::FreeMibTable(reinterpret_cast<void*>(pMib));}
+    };
+
+    template<class MibType>
+    using WinMibPtr = WinGenericHandle<MibType*, WinMibDeleter>;
+
+    // The destination of an IPv4 route - address (network byte order) and
+    // prefix length.
+    using RouteDest4 = std::pair<ULONG, UINT8>;
+
+    RouteDest4 routeDest4(const MIB_IPFORWARD_ROW2 &route)
+    {
+        return {route.DestinationPrefix.Prefix.Ipv4.sin_addr.s_addr,
+                route.DestinationPrefix.PrefixLength};
+    }
+}
+
+WinRouteManager::WinRouteManager(bool applyInBackground)
+{
+    if(applyInBackground)
+    {
+        _pStrand.reset(new core::Strand{"routes"});
+    }
+}
+
+void WinRouteManager::apply(std::function<void()> func) const
+{
+    if(_pStrand)
+    {
+        // Nothing on the strand can report an exception to the caller, so
+        // trace it here
+        _pStrand->post([func = std::move(func)]
+        {
+            try
+            {
+                func();
+            }
+            catch(const std::exception &ex)
+            {
+                KAPPS_CORE_WARNING() << "Unable to apply route change -"
+                    << ex.what();
+            }
+        });
+    }
+    else
+        func();
+}
+
 void WinRouteManager::createRouteEntry(MIB_IPFORWARD_ROW2 &route, const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric) const
 {
     InitializeIpForwardEntry(&route);
@@ -67,6 +124,26 @@ void WinRouteManager::createRouteEntry(MIB_IPFORWARD_ROW2 &route, const std::str
 }
 
 void WinRouteManager::addRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric) const
+{
+    apply([=]{applyAddRoute4(subnet, gatewayIp, interfaceName, metric);});
+}
+
+void WinRouteManager::removeRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const
+{
+    apply([=]{applyRemoveRoute4(subnet, gatewayIp, interfaceName);});
+}
+
+void WinRouteManager::updateRoutes4(const std::vector<std::string> &removeSubnets,
+                                    const std::vector<std::string> &addSubnets,
+                                    const std::string &gatewayIp,
+                                    const std::string &interfaceName) const
+{
+    if(removeSubnets.empty() && addSubnets.empty())
+        return;
+    apply([=]{applyUpdateRoutes4(removeSubnets, addSubnets, gatewayIp, interfaceName);});
+}
+
+void WinRouteManager::applyAddRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric) const
 {
     MIB_IPFORWARD_ROW2 route{};
     createRouteEntry(route, subnet, gatewayIp, interfaceName, metric);
@@ -82,7 +159,7 @@ void WinRouteManager::addRoute4(const std::string &subnet, const std::string &ga
     }
 }
 
-void WinRouteManager::removeRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const
+void WinRouteManager::applyRemoveRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const
 {
     MIB_IPFORWARD_ROW2 route{};
     createRouteEntry(route, subnet, gatewayIp, interfaceName, 0);
@@ -95,4 +172,83 @@ void WinRouteManager::removeRoute4(const std::string &subnet, const std::string
     }
 }
 
+void WinRouteManager::applyUpdateRoutes4(const std::vector<std::string> &removeSubnets,
+                                         const std::vector<std::string> &addSubnets,
+                                         const std::string &gatewayIp,
+                                         const std::string &interfaceName) const
+{
+    // Template row for the interface and gateway; all the routes use these
+    MIB_IPFORWARD_ROW2 route{};
+    createRouteEntry(route, "0.0.0.0/32", gatewayIp, interfaceName, 0);
+    const NET_LUID luid = route.InterfaceLuid;
+    const ULONG nextHop = route.NextHop.Ipv4.sin_addr.s_addr;
+
+    // Find the routes that already exist via this gateway and interface.  If
+    // the table can't be read, just try to apply every change.
+    std::set<RouteDest4> existing;
+    bool haveTable{false};
+    WinMibPtr<MIB_IPFORWARD_TABLE2> pTable;
+    auto tableResult = ::GetIpForwardTable2(AF_INET, pTable.receive());
+    if(tableResult == NO_ERROR && pTable)
+    {
+        haveTable = true;
+        for(ULONG i=0; i<pTable.get()->NumEntries; ++i)
+        {
+            const MIB_IPFORWARD_ROW2 &row = pTable.get()->Table[i];
+            if(row.InterfaceLuid.Value == luid.Value &&
+                row.NextHop.Ipv4.sin_addr.s_addr == nextHop)
+            {
+                existing.insert(routeDest4(row));
+            }
+        }
+    }
+    else
+    {
+        KAPPS_CORE_WARNING() << "Unable to read routing table -"
+            << core::WinErrTracer{tableResult};
+    }
+
+    std::size_t removed{0}, added{0}, unchanged{0};
+    for(const auto &subnet : removeSubnets)
+    {
+        createRouteEntry(route, subnet, gatewayIp, interfaceName, 0);
+        if(haveTable && existing.erase(routeDest4(route)) == 0)
+        {
+            ++unchanged;
+            continue;
+        }
+        auto routeResult = DeleteIpForwardEntry2(&route);
+        if(routeResult != NO_ERROR)
+        {
+            KAPPS_CORE_WARNING() << "Could not delete route for" << subnet
+                << "-" << core::WinErrTracer{routeResult};
+        }
+        else
+            ++removed;
+    }
+
+    for(const auto &subnet : addSubnets)
+    {
+        createRouteEntry(route, subnet, gatewayIp, interfaceName, 0);
+        if(haveTable && !existing.insert(routeDest4(route)).second)
+        {
+            ++unchanged;
+            continue;
+        }
+        auto routeResult = CreateIpForwardEntry2(&route);
+        if(routeResult != NO_ERROR)
+        {
+            KAPPS_CORE_WARNING() << "Could not create route for" << subnet
+                << "-" << core::WinErrTracer{routeResult};
+        }
+        else
+            ++added;
+    }
+
+    KAPPS_CORE_INFO() << "Updated routes via" << interfaceName << "- removed"
+        << removed << "of" << removeSubnets.size() << "- added" << added
+        << "of" << addSubnets.size() << "-" << unchanged
+        << "already up to date";
+}
+
 }}
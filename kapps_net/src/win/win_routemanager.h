@@ -22,11 +22,21 @@
 #include <kapps_core/src/logger.h>
 #include <kapps_core/src/ipaddress.h>
 #include <kapps_core/src/winapi.h>
+#include <kapps_core/src/threadpool.h>
+#include <functional>
+#include <memory>
 
 namespace kapps { namespace net {
 
 class KAPPS_NET_EXPORT WinRouteManager : public RouteManager
 {
+public:
+    // If applyInBackground is set, route changes are queued to a strand on the
+    // shared executor and applied there in order, so callers don't wait for
+    // the IP Helper API.  The destructor waits for any queued changes to be
+    // applied.
+    explicit WinRouteManager(bool applyInBackground = false);
+
 public:
     virtual void addRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric=0) const override;
     virtual void removeRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const override;
@@ -34,8 +44,33 @@ public:
     // TODO: Implement these when we support IPv6
     virtual void addRoute6(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric=0) const override {}
     virtual void removeRoute6(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const override {}
+
+    // Reads the routing table once, then only removes routes that exist and
+    // only adds routes that don't.
+    virtual void updateRoutes4(const std::vector<std::string> &removeSubnets,
+                               const std::vector<std::string> &addSubnets,
+                               const std::string &gatewayIp,
+                               const std::string &interfaceName) const override;
+    virtual void updateRoutes6(const std::vector<std::string> &removeSubnets,
+                               const std::vector<std::string> &addSubnets,
+                               const std::string &gatewayIp,
+                               const std::string &interfaceName) const override {}
+
 private:
     void createRouteEntry(MIB_IPFORWARD_ROW2 &route, const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric) const;
+    void applyAddRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName, uint32_t metric) const;
+    void applyRemoveRoute4(const std::string &subnet, const std::string &gatewayIp, const std::string &interfaceName) const;
+    void applyUpdateRoutes4(const std::vector<std::string> &removeSubnets,
+                            const std::vector<std::string> &addSubnets,
+                            const std::string &gatewayIp,
+                            const std::string &interfaceName) const;
+    // Run a route change on the strand if there is one, or right now
+    // otherwise
+    void apply(std::function<void()> func) const;
+
+private:
+    // Only created if applyInBackground was set
+    std::unique_ptr<core::Strand> _pStrand;
 };
 
 }}
@@ -110,6 +110,46 @@ const KARRegionDisplay *KARMetadataGetRegionDisplay(const KARMetadata *pMetadata
 KAPPS_REGIONS_EXPORT
 KACArraySlice KARMetadataRegionDisplays(const KARMetadata *pMetadata);
 
+// Bulk export of display information for one language.  These work like the
+// region list bulk exports (see regionlist.h) - each returns the total number
+// of elements and fills up to capacity elements; pass a null array and 0
+// capacity to get the total.  Display text is the text for the language given,
+// with the same fallbacks as KARDisplayTextGetLanguageText().
+
+// A country's display information, exported by KARMetadataExportCountryDisplays()
+typedef struct KARCountryDisplayInfo
+{
+    const KARCountryDisplay *pCountryDisplay;
+    KACStringSlice code;
+    KACStringSlice name;
+    KACStringSlice prefix;
+} KARCountryDisplayInfo;
+
+// A region's display information, exported by KARMetadataExportRegionDisplays()
+typedef struct KARRegionDisplayInfo
+{
+    const KARRegionDisplay *pRegionDisplay;
+    KACStringSlice id;
+    KACStringSlice country;
+    double geoLatitude;
+    double geoLongitude;
+    KACStringSlice name;
+} KARRegionDisplayInfo;
+
+// Export all country displays, in the same order as
+// KARMetadataCountryDisplays().
+KAPPS_REGIONS_EXPORT
+size_t KARMetadataExportCountryDisplays(const KARMetadata *pMetadata,
+                                        KACStringSlice language,
+                                        KARCountryDisplayInfo *pCountries,
+                                        size_t capacity);
+// Export all region displays, in the same order as KARMetadataRegionDisplays().
+KAPPS_REGIONS_EXPORT
+size_t KARMetadataExportRegionDisplays(const KARMetadata *pMetadata,
+                                       KACStringSlice language,
+                                       KARRegionDisplayInfo *pRegions,
+                                       size_t capacity);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,8 @@
 #include "manualregion.h"
 #include "region.h"
 #include <kapps_core/stringslice.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -154,6 +156,86 @@ const KARRegion *KARRegionListGetRegion(const KARRegionList *pRegionList,
 KAPPS_REGIONS_EXPORT
 KACArraySlice KARRegionListRegions(const KARRegionList *pRegionList);
 
+// Get a version for the region list's content.  Region lists with the same
+// regions and servers (in any order) have the same version, and a changed list
+// almost always has a different version, so a client rebuilding its own model
+// from each new region list can skip lists that haven't changed.  (0 is
+// returned only for an invalid region list.)
+//
+// Versions are not ordered; just compare them for equality.
+KAPPS_REGIONS_EXPORT
+uint64_t KARRegionListVersion(const KARRegionList *pRegionList);
+
+// ===========
+// Bulk export
+// ===========
+//
+// Building a client model of the whole region list with the per-object
+// accessors takes several calls per region and server.  These functions
+// instead fill caller-provided arrays of flat structs in one call each.
+//
+// Each export function returns the total number of elements available, and
+// fills the first min(total, capacity) elements of the array.  Pass a null
+// array and 0 capacity to get the total in order to allocate the array.
+//
+// All strings, port arrays, and object pointers in the exported structs are
+// owned by the region list, just like the results of the accessors above.
+
+// A region's information, exported by KARRegionListExportRegions().
+typedef struct KARRegionInfo
+{
+    const KARRegion *pRegion;
+    KACStringSlice id;
+    bool autoSafe;
+    bool portForward;
+    bool geoLocated;
+    bool offline;
+    // Zero if this is not a DIP region
+    KACIPv4Address dedicatedIpAddress;
+    // This region's servers are exported by KARRegionListExportServers() as
+    // the elements [firstServer, firstServer + serverCount).
+    size_t firstServer;
+    size_t serverCount;
+} KARRegionInfo;
+
+// Service flags for KARServerInfo - a flag for service s is (1 << s)
+#define KAR_SERVICE_FLAG(service) (1u << (service))
+
+// A server's information, exported by KARRegionListExportServers().
+typedef struct KARServerInfo
+{
+    const KARServer *pServer;
+    // Index of this server's region in the regions exported by
+    // KARRegionListExportRegions()
+    size_t regionIndex;
+    KACIPv4Address ipAddress;
+    KACStringSlice commonName;
+    KACStringSlice fqdn;
+    // Services offered, KAR_SERVICE_FLAG() of each KARService
+    unsigned services;
+    // Service details, as provided by the KARServer accessors.  Port arrays are
+    // empty for services not offered.
+    KACPortArray openVpnUdpPorts;
+    bool openVpnUdpNcp;
+    KACPortArray openVpnTcpPorts;
+    bool openVpnTcpNcp;
+    KACPortArray wireGuardPorts;
+    KACPortArray shadowsocksPorts;
+    KACStringSlice shadowsocksKey;
+    KACStringSlice shadowsocksCipher;
+    KACPortArray metaPorts;
+} KARServerInfo;
+
+// Export all regions, in the same order as KARRegionListRegions().
+KAPPS_REGIONS_EXPORT
+size_t KARRegionListExportRegions(const KARRegionList *pRegionList,
+                                  KARRegionInfo *pRegions, size_t capacity);
+// Export the servers of all regions, grouped by region in the same order as
+// KARRegionListExportRegions().
+KAPPS_REGIONS_EXPORT
+size_t KARRegionListExportServers(const KARRegionList *pRegionList,
+                                  KARServerInfo *pServers, size_t capacity);
+
 #ifdef __cplusplus
 }
 #endif
@@ -97,6 +97,34 @@ namespace
 
         return dips;
     }
+    // Build the flat structs used by the bulk exports
+    KARServerInfo toApiInfo(const Server &server, size_t regionIndex)
+    {
+        unsigned services{0};
+        if(server.hasOpenVpnTcp())
+            services |= KAR_SERVICE_FLAG(KARServiceOpenVpnTcp);
+        if(server.hasOpenVpnUdp())
+            services |= KAR_SERVICE_FLAG(KARServiceOpenVpnUdp);
+        if(server.hasWireGuard())
+            services |= KAR_SERVICE_FLAG(KARServiceWireGuard);
+        if(server.hasIkev2())
+            services |= KAR_SERVICE_FLAG(KARServiceIkev2);
+        if(server.hasShadowsocks())
+            services |= KAR_SERVICE_FLAG(KARServiceShadowsocks);
+        if(server.hasMeta())
+            services |= KAR_SERVICE_FLAG(KARServiceMeta);
+
+        return {toApi(&server), regionIndex, toApi(server.address()),
+                toApi(server.commonName()), toApi(server.fqdn()), services,
+                toApi(server.openVpnUdpPorts()), server.openVpnUdpNcp(),
+                toApi(server.openVpnTcpPorts()), server.openVpnTcpNcp(),
+                toApi(server.wireGuardPorts()),
+                toApi(server.shadowsocksPorts()),
+                toApi(server.shadowsocksKey()),
+                toApi(server.shadowsocksCipher()),
+                toApi(server.metaPorts())};
+    }
+
     std::vector<ManualRegion> fromApi(const KARManualRegion *pManualRegions, size_t manualCount,
         ServiceGroupsStorage &serviceGroupsStorage)
     {
@@ -321,6 +349,52 @@ extern "C"
         return guard(pRegionList, [&]{return toApi(pRegionList->regions());});
     }
 
+    uint64_t KARRegionListVersion(const KARRegionList *pRegionList)
+    {
+        return guard(pRegionList, [&]{return pRegionList->version();});
+    }
+    size_t KARRegionListExportRegions(const KARRegionList *pRegionList,
+                                      KARRegionInfo *pRegions, size_t capacity)
+    {
+        return guard(pRegionList, [&]
+        {
+            verify(pRegions, capacity);
+            auto regions = pRegionList->regions();
+            size_t firstServer{0};
+            for(size_t i=0; i<regions.size() && i<capacity; ++i)
+            {
+                const Region &region{*regions[i]};
+                pRegions[i] = {toApi(&region), toApi(region.id()),
+                               region.autoSafe(), region.portForward(),
+                               region.geoLocated(), region.offline(),
+                               toApi(region.dipAddress()), firstServer,
+                               region.servers().size()};
+                firstServer += region.servers().size();
+            }
+            return regions.size();
+        });
+    }
+    size_t KARRegionListExportServers(const KARRegionList *pRegionList,
+                                      KARServerInfo *pServers, size_t capacity)
+    {
+        return guard(pRegionList, [&]
+        {
+            verify(pServers, capacity);
+            auto regions = pRegionList->regions();
+            size_t total{0};
+            for(size_t regionIndex=0; regionIndex<regions.size(); ++regionIndex)
+            {
+                for(const Server *pServer : regions[regionIndex]->servers())
+                {
+                    if(total < capacity)
+                        pServers[total] = toApiInfo(*pServer, regionIndex);
+                    ++total;
+                }
+            }
+            return total;
+        });
+    }
+
     // KARDisplayText
     KACStringSlice KARDisplayTextGetLanguageText(const KARDisplayText *pDisplayText,
                                                  KACStringSlice language)
@@ -475,4 +549,45 @@ extern "C"
     {
         return guard(pMetadata, [&]{return toApi(pMetadata->regionDisplays());});
     }
+    size_t KARMetadataExportCountryDisplays(const KARMetadata *pMetadata,
+                                            KACStringSlice language,
+                                            KARCountryDisplayInfo *pCountries,
+                                            size_t capacity)
+    {
+        return guard(pMetadata, [&]
+        {
+            verify(pCountries, capacity);
+            Bcp47Tag tag{fromApi(language)};
+            auto countries = pMetadata->countryDisplays();
+            for(size_t i=0; i<countries.size() && i<capacity; ++i)
+            {
+                const CountryDisplay &country{*countries[i]};
+                pCountries[i] = {toApi(&country), toApi(country.code()),
+                                 toApi(country.name().getLanguageText(tag)),
+                                 toApi(country.prefix().getLanguageText(tag))};
+            }
+            return countries.size();
+        });
+    }
+    size_t KARMetadataExportRegionDisplays(const KARMetadata *pMetadata,
+                                           KACStringSlice language,
+                                           KARRegionDisplayInfo *pRegions,
+                                           size_t capacity)
+    {
+        return guard(pMetadata, [&]
+        {
+            verify(pRegions, capacity);
+            Bcp47Tag tag{fromApi(language)};
+            auto regions = pMetadata->regionDisplays();
+            for(size_t i=0; i<regions.size() && i<capacity; ++i)
+            {
+                const RegionDisplay &region{*regions[i]};
+                pRegions[i] = {toApi(&region), toApi(region.id()),
+                               toApi(region.country()), region.geoLatitude(),
+                               region.geoLongitude(),
+                               toApi(region.name().getLanguageText(tag))};
+            }
+            return regions.size();
+        });
+    }
 }
@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include "displaytext.h"
+#include <algorithm>
 #include <kapps_core/src/logger.h>
 #include <kapps_core/src/corejson.h>
 #include <nlohmann/json.hpp>
@@ -134,23 +135,34 @@ std::size_t Bcp47Tag::hash() const
     return kapps::core::hashFields(_language, _script, _region);
 }
 
+LanguageFallbacks::LanguageFallbacks(const Bcp47Tag &lang)
+{
+    _tags.reserve(5);
+    auto addTag = [this](Bcp47Tag tag)
+    {
+        if(std::find(_tags.begin(), _tags.end(), tag) == _tags.end())
+            _tags.push_back(std::move(tag));
+    };
+    addTag(lang);
+    addTag({lang.language(), lang.script(), {}});
+    addTag({lang.language(), {}, lang.region()});
+    addTag({lang.language(), {}, {}});
+    addTag({"en", {}, "US"});
+}
+
 core::StringSlice DisplayText::getLanguageText(const Bcp47Tag &lang) const
 {
-    auto itMatch = _texts.find(lang);
-    if(itMatch != _texts.end())
-        return itMatch->second;
-    itMatch = _texts.find({lang.language(), lang.script(), {}});
-    if(itMatch != _texts.end())
-        return itMatch->second;
-    itMatch = _texts.find({lang.language(), {}, lang.region()});
-    if(itMatch != _texts.end())
-        return itMatch->second;
-    itMatch = _texts.find({lang.language(), {}, {}});
-    if(itMatch != _texts.end())
-        return itMatch->second;
-    itMatch = _texts.find({"en", {}, "US"});
-    if(itMatch != _texts.end())
-        return itMatch->second;
+    return getLanguageText(LanguageFallbacks{lang});
+}
+
+core::StringSlice DisplayText::getLanguageText(const LanguageFallbacks &fallbacks) const
+{
+    for(const auto &tag : fallbacks.tags())
+    {
+        auto itMatch = _texts.find(tag);
+        if(itMatch != _texts.end())
+            return itMatch->second;
+    }
     return {};
 }
 
@@ -21,6 +21,7 @@
 #include <kapps_core/src/stringslice.h>
 #include <kapps_core/src/corejson.h>
 #include <unordered_map>
+#include <vector>
 
 namespace kapps::regions {
 
@@ -96,6 +97,22 @@ KAPPS_CORE_STD_HASH(kapps::regions::Bcp47Tag);
 
 namespace kapps::regions {
 
+// The fallback order used by DisplayText::getLanguageText() for a particular
+// language (duplicates removed).  To resolve many texts for the same language,
+// build this once and pass it to getLanguageText(), instead of building the
+// fallback tags for every lookup.
+class KAPPS_REGIONS_EXPORT LanguageFallbacks
+{
+public:
+    explicit LanguageFallbacks(const Bcp47Tag &lang);
+
+public:
+    core::ArraySlice<const Bcp47Tag> tags() const {return _tags;}
+
+private:
+    std::vector<Bcp47Tag> _tags;
+};
+
 // DisplayText just holds a set of translations identified by language tags.
 class KAPPS_REGIONS_EXPORT DisplayText : public core::JsonReadable<DisplayText>
 {
@@ -119,6 +136,7 @@ public:
     // - <lang>
     // - en-US
     core::StringSlice getLanguageText(const Bcp47Tag &lang) const;
+    core::StringSlice getLanguageText(const LanguageFallbacks &fallbacks) const;
 
     // All the texts can be enumerated this way, but this is rarely useful
     // outside of diagnostics.
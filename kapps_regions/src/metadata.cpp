@@ -18,6 +18,7 @@
 
 #include "metadata.h"
 #include <kapps_core/src/corejson.h>
+#include <kapps_core/src/jsonstream.h>
 #include <nlohmann/json.hpp>
 
 namespace kapps::regions {
@@ -25,7 +26,8 @@ namespace kapps::regions {
 namespace
 {
     template<class T, class GetKeyT, class JsonT>
-    void readSharedElements(const JsonT &j, GetKeyT getKey,
+    void readSharedElements(const std::shared_ptr<core::Arena> &pArena,
+        const JsonT &j, GetKeyT getKey,
         std::unordered_map<core::StringSlice, std::shared_ptr<const T>> &elementsById)
     {
         elementsById.clear();
@@ -40,7 +42,7 @@ namespace
                 }
                 else
                 {
-                    auto pValue = std::make_shared<T>(std::move(value));
+                    auto pValue = core::makeArenaShared<T>(pArena, std::move(value));
                     elementsById.emplace(getKey(*pValue), std::move(pValue));
                 }
             });
@@ -104,7 +106,9 @@ namespace
 
 Metadata::Metadata(core::StringSlice metadataJson,
                    core::ArraySlice<const DedicatedIp> dips,
-                   core::ArraySlice<const ManualRegion> manual)
+                   core::ArraySlice<const ManualRegion> manual,
+                   ImageWriter *pImage)
+    : _pArena{std::make_shared<core::Arena>()}
 {
     auto json = nlohmann::json::parse(metadataJson);
 
@@ -112,18 +116,20 @@ Metadata::Metadata(core::StringSlice metadataJson,
     auto itDynGroups = json.find("dynamic_roles");
     if(itDynGroups != json.end())
     {
-        readSharedElements<DynamicRole>(*itDynGroups,
+        readSharedElements<DynamicRole>(_pArena, *itDynGroups,
             [](const DynamicRole &value){return value.id();},
             _dynamicGroupsById);
     }
 
-    readSharedElements<CountryDisplay>(json.at("countries"),
+    readSharedElements<CountryDisplay>(_pArena, json.at("countries"),
         [](const CountryDisplay &value){return value.code();},
         _countryDisplaysById);
-    readSharedElements<RegionDisplay>(json.at("regions"),
+    readSharedElements<RegionDisplay>(_pArena, json.at("regions"),
         [](const RegionDisplay &value){return value.id();},
         _regionDisplaysById);
 
+    if(pImage)
+        writeImage(*pImage);
     copyDipRegionDisplays(dips);
     buildManualRegionDisplays(manual);
 
@@ -134,9 +140,10 @@ Metadata::Metadata(core::StringSlice metadataJson,
 
 Metadata::Metadata(core::StringSlice regionsv6Json, core::StringSlice metadatav2Json,
                    core::ArraySlice<const DedicatedIp> dips,
-                   core::ArraySlice<const ManualRegion> manual)
+                   core::ArraySlice<const ManualRegion> manual,
+                   ImageWriter *pImage)
+    : _pArena{std::make_shared<core::Arena>()}
 {
-    auto regions = nlohmann::json::parse(regionsv6Json);
     auto metadata = nlohmann::json::parse(metadatav2Json);
 
     // The legacy metadata v2 format provides relatively primitive data - there
@@ -146,29 +153,41 @@ Metadata::Metadata(core::StringSlice regionsv6Json, core::StringSlice metadatav2
     // Read the regions from regions v6 first to start building region/country
     // displays.  Group by country so we can undo the "country"/"ct - city"
     // logic that is applied to display names in metadata v2.
+    //
+    // Only 'id', 'name', and 'country' are needed from the regions list, so
+    // stream it rather than parsing the whole thing to a DOM - each region is
+    // discarded as soon as these are copied out.
     struct RegionIdName
     {
-        core::StringSlice id;
-        core::StringSlice name;
+        std::string id;
+        std::string name;
     };
-    std::unordered_multimap<core::StringSlice, RegionIdName> regionsByCountry;
-    for(const auto &region : core::jsonArray(regions.at("regions")))
-    {
-        try
+    std::unordered_multimap<std::string, RegionIdName> regionsByCountry;
+    bool haveRegions{false};
+    core::streamJsonObject(regionsv6Json,
+        [](core::StringSlice key){return key == "regions";},
+        [&](core::StringSlice key, nlohmann::json &&region)
         {
-            RegionIdName idName{};
-            idName.id = region.at("id").get<core::StringSlice>();
-            idName.name = region.at("name").get<core::StringSlice>();
-            regionsByCountry.emplace(region.at("country").get<core::StringSlice>(),
-                                     idName);
-        }
-        catch(const std::exception &ex)
-        {
-            KAPPS_CORE_WARNING() << "Unable to read region metadata from region"
-                << region;
-            // Ignore this region
-        }
-    }
+            if(key != "regions")
+                return;
+            haveRegions = true;
+            try
+            {
+                RegionIdName idName{};
+                idName.id = region.at("id").get<std::string>();
+                idName.name = region.at("name").get<std::string>();
+                regionsByCountry.emplace(region.at("country").get<std::string>(),
+                                         std::move(idName));
+            }
+            catch(const std::exception &ex)
+            {
+                KAPPS_CORE_WARNING() << "Unable to read region metadata from region"
+                    << region;
+                // Ignore this region
+            }
+        });
+    if(!haveRegions)
+        throw std::runtime_error{"Regions list does not contain \"regions\""};
 
     auto itCountryFirst = regionsByCountry.begin();
     while(itCountryFirst != regionsByCountry.end())
@@ -190,12 +209,12 @@ Metadata::Metadata(core::StringSlice regionsv6Json, core::StringSlice metadatav2
             // case for products using the legacy format.  The country prefix
             // is empty.
             buildPiav2SingleCountryDisplay(metadata,
-                itCountryFirst->first.to_string(),
+                itCountryFirst->first,
                 itCountryFirst->second.name);
             buildPiav2SingleRegionDisplay(metadata,
-                itCountryFirst->second.id.to_string(),
-                itCountryFirst->first.to_string(),
-                itCountryFirst->second.name.to_string());
+                itCountryFirst->second.id,
+                itCountryFirst->first,
+                itCountryFirst->second.name);
         }
         else
         {
@@ -217,7 +236,7 @@ Metadata::Metadata(core::StringSlice regionsv6Json, core::StringSlice metadatav2
             // We now know the country prefix lengths for all languages, so we
             // can build all displays.
             buildPiav2MultipleCountryDisplay(metadata,
-                itCountryFirst->first.to_string(), prefixMap);
+                itCountryFirst->first, prefixMap);
             auto itAddRegion = itCountryFirst;
             while(itAddRegion != itCountryEnd)
             {
@@ -235,6 +254,8 @@ Metadata::Metadata(core::StringSlice regionsv6Json, core::StringSlice metadatav2
         itCountryFirst = itCountryEnd;
     }
 
+    if(pImage)
+        writeImage(*pImage);
     copyDipRegionDisplays(dips);
     buildManualRegionDisplays(manual);
 
@@ -245,6 +266,120 @@ Metadata::Metadata(core::StringSlice regionsv6Json, core::StringSlice metadatav2
     g_MissingTranslationsTracer.trace();
 }
 
+Metadata::Metadata(ImageReader &image,
+                   core::ArraySlice<const DedicatedIp> dips,
+                   core::ArraySlice<const ManualRegion> manual)
+    : _pArena{std::make_shared<core::Arena>()}
+{
+    // Insert an element read from the image, keyed by its ID
+    auto insertElement = [this](auto &elementsById, auto pElement,
+                                core::StringSlice id)
+    {
+        if(!elementsById.emplace(id, std::move(pElement)).second)
+            throw std::runtime_error{"Duplicate element in regions image"};
+    };
+
+    auto dynamicGroupCount = image.count(sizeof(std::uint32_t) * 4);
+    _dynamicGroupsById.reserve(dynamicGroupCount);
+    for(std::size_t i = 0; i < dynamicGroupCount; ++i)
+    {
+        auto id = image.str().to_string();
+        auto name = readImageDisplayText(image);
+        auto resource = image.str().to_string();
+        auto winIcon = image.str().to_string();
+        auto pGroup = core::makeArenaShared<DynamicRole>(_pArena, std::move(id),
+            std::move(name), std::move(resource), std::move(winIcon));
+        insertElement(_dynamicGroupsById, pGroup, pGroup->id());
+    }
+
+    auto countryCount = image.count(sizeof(std::uint32_t) * 3);
+    _countryDisplaysById.reserve(countryCount);
+    for(std::size_t i = 0; i < countryCount; ++i)
+    {
+        auto code = image.str().to_string();
+        auto name = readImageDisplayText(image);
+        auto prefix = readImageDisplayText(image);
+        auto pCountry = core::makeArenaShared<CountryDisplay>(_pArena,
+            std::move(code), std::move(name), std::move(prefix));
+        insertElement(_countryDisplaysById, pCountry, pCountry->code());
+    }
+
+    auto regionCount = image.count(sizeof(std::uint32_t) * 3 + sizeof(double) * 2);
+    _regionDisplaysById.reserve(regionCount);
+    for(std::size_t i = 0; i < regionCount; ++i)
+    {
+        auto id = image.str().to_string();
+        auto country = image.str().to_string();
+        auto geoLatitude = image.f64();
+        auto geoLongitude = image.f64();
+        auto name = readImageDisplayText(image);
+        auto pRegion = core::makeArenaShared<RegionDisplay>(_pArena,
+            std::move(id), std::move(country), geoLatitude, geoLongitude,
+            std::move(name));
+        insertElement(_regionDisplaysById, pRegion, pRegion->id());
+    }
+
+    copyDipRegionDisplays(dips);
+    buildManualRegionDisplays(manual);
+
+    buildFlatVector(_dynamicGroupsById, _dynamicGroups);
+    buildFlatVector(_countryDisplaysById, _countryDisplays);
+    buildFlatVector(_regionDisplaysById, _regionDisplays);
+}
+
+void Metadata::writeImageDisplayText(ImageWriter &image, const DisplayText &text)
+{
+    image.u32(static_cast<std::uint32_t>(text.texts().size()));
+    for(const auto &[language, value] : text.texts())
+    {
+        image.str(language.toString());
+        image.str(value);
+    }
+}
+
+DisplayText Metadata::readImageDisplayText(ImageReader &image)
+{
+    std::unordered_map<Bcp47Tag, std::string> texts;
+    auto count = image.count(sizeof(std::uint32_t) * 2);
+    texts.reserve(count);
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        Bcp47Tag language{image.str()};
+        texts.emplace(std::move(language), image.str().to_string());
+    }
+    return {std::move(texts)};
+}
+
+void Metadata::writeImage(ImageWriter &image) const
+{
+    image.u32(static_cast<std::uint32_t>(_dynamicGroupsById.size()));
+    for(const auto &[id, pGroup] : _dynamicGroupsById)
+    {
+        image.str(pGroup->id());
+        writeImageDisplayText(image, pGroup->name());
+        image.str(pGroup->resource());
+        image.str(pGroup->winIcon());
+    }
+
+    image.u32(static_cast<std::uint32_t>(_countryDisplaysById.size()));
+    for(const auto &[code, pCountry] : _countryDisplaysById)
+    {
+        image.str(pCountry->code());
+        writeImageDisplayText(image, pCountry->name());
+        writeImageDisplayText(image, pCountry->prefix());
+    }
+
+    image.u32(static_cast<std::uint32_t>(_regionDisplaysById.size()));
+    for(const auto &[id, pRegion] : _regionDisplaysById)
+    {
+        image.str(pRegion->id());
+        image.str(pRegion->country());
+        image.f64(pRegion->geoLatitude());
+        image.f64(pRegion->geoLongitude());
+        writeImageDisplayText(image, pRegion->name());
+    }
+}
+
 template<class StringT>
 auto Metadata::buildPiav2DisplayText(const nlohmann::json &metadata,
     core::StringSlice name)
@@ -325,7 +460,7 @@ void Metadata::buildPiav2SingleCountryDisplay(const nlohmann::json &metadata,
     {
         // There are no prefixes known for a country containing one region, it's
         // simply not present in metadata v2.
-        auto pCountryDisplay = std::make_shared<CountryDisplay>(countryCode.to_string(),
+        auto pCountryDisplay = core::makeArenaShared<CountryDisplay>(_pArena, countryCode.to_string(),
             DisplayText{buildPiav2DisplayText<std::string>(metadata, countryName)},
             DisplayText{});
         _countryDisplaysById.emplace(pCountryDisplay->code(), std::move(pCountryDisplay));
@@ -344,7 +479,7 @@ void Metadata::buildPiav2SingleRegionDisplay(const nlohmann::json &metadata,
     try
     {
         auto coords = findPiav2RegionCoords(metadata, regionId);
-        auto pRegionDisplay = std::make_shared<RegionDisplay>(regionId.to_string(),
+        auto pRegionDisplay = core::makeArenaShared<RegionDisplay>(_pArena, regionId.to_string(),
             countryCode.to_string(), coords.first, coords.second,
             DisplayText{buildPiav2DisplayText<std::string>(metadata, regionName)});
         _regionDisplaysById.emplace(pRegionDisplay->id(), std::move(pRegionDisplay));
@@ -507,7 +642,7 @@ void Metadata::buildPiav2MultipleCountryDisplay(const nlohmann::json &metadata,
         std::unordered_map<Bcp47Tag, std::string> ownedPrefixes;
         for(const auto &[lang, text] : prefixMap)
             ownedPrefixes.insert({lang, text.to_string()});
-        auto pCountryDisplay = std::make_shared<CountryDisplay>(countryCode.to_string(),
+        auto pCountryDisplay = core::makeArenaShared<CountryDisplay>(_pArena, countryCode.to_string(),
             buildPiav2MultipleCountryName(metadata, countryCode),
             DisplayText{std::move(ownedPrefixes)});
         _countryDisplaysById.emplace(pCountryDisplay->code(), std::move(pCountryDisplay));
@@ -537,7 +672,7 @@ void Metadata::buildPiav2MultipleRegionDisplay(const nlohmann::json &metadata,
             regionNames.insert({lang, text.substr(prefixLen).to_string()});
         }
         auto coords = findPiav2RegionCoords(metadata, regionId);
-        auto pRegionDisplay = std::make_shared<RegionDisplay>(regionId.to_string(),
+        auto pRegionDisplay = core::makeArenaShared<RegionDisplay>(_pArena, regionId.to_string(),
             countryCode.to_string(), coords.first, coords.second,
             DisplayText{std::move(regionNames)});
         _regionDisplaysById.emplace(pRegionDisplay->id(), std::move(pRegionDisplay));
@@ -562,7 +697,7 @@ void Metadata::copyDipRegionDisplays(core::ArraySlice<const DedicatedIp> dips)
         }
         else
         {
-            auto pDipRegionDisplay = std::make_shared<RegionDisplay>(
+            auto pDipRegionDisplay = core::makeArenaShared<RegionDisplay>(_pArena,
                 dip.dipRegionId.to_string(),
                 pCorrespondingRegion->country().to_string(),
                 pCorrespondingRegion->geoLatitude(),
@@ -601,14 +736,14 @@ void Metadata::buildManualRegionDisplays(core::ArraySlice<const ManualRegion> ma
 
     // Build dummy country "ZZ" to represent manual regions.  "ZZ" is a reserved
     // code for user assignment.
-    auto pManualCountry = std::make_shared<CountryDisplay>("ZZ",
+    auto pManualCountry = core::makeArenaShared<CountryDisplay>(_pArena, "ZZ",
             DisplayText{{{Bcp47Tag{"en-US"}, std::move(manualCountryName)}}},
             DisplayText{{{Bcp47Tag{"en-US"}, "ZZ "}}});
     _countryDisplaysById.emplace(pManualCountry->code(), std::move(pManualCountry));
 
     for(const auto &manual : manualRegions)
     {
-        auto pManualRegion = std::make_shared<RegionDisplay>(
+        auto pManualRegion = core::makeArenaShared<RegionDisplay>(_pArena,
             manual.manualRegionId.to_string(),
             "ZZ", std::numeric_limits<double>::quiet_NaN(),
             std::numeric_limits<double>::quiet_NaN(),
@@ -43,15 +43,27 @@ public:
     // - For manual regions, Metadata fabricates a dummy CountryDisplay and
     //   RegionDisplay.  There are no translations, but there is en-US display
     //   text filled in (for example, the region name becomes "<cn> - <ip>")
+    //
+    // If pImage is given, the metadata (not including DIP or manual regions)
+    // are also written to that regions image; see regionsimage.h.
     Metadata(core::StringSlice metadataJson,
              core::ArraySlice<const DedicatedIp> dips,
-             core::ArraySlice<const ManualRegion> manual);
+             core::ArraySlice<const ManualRegion> manual,
+             ImageWriter *pImage = nullptr);
 
     // Like RegionList, the legacy PIA metadata v2 format can be loaded also.
     // This requires the regions v6 data too - some of the data were moved from
     // the regions list to metadata in v7, so the legacy support reads the
     // corresponding data from regions v6.
     Metadata(core::StringSlice regionsv6Json, core::StringSlice metadatav2Json,
+             core::ArraySlice<const DedicatedIp> dips,
+             core::ArraySlice<const ManualRegion> manual,
+             ImageWriter *pImage = nullptr);
+
+    // Load metadata written to a regions image by one of the constructors
+    // above, then add DIP and manual region displays.  The image is read from
+    // its current position.  Throws if the image is invalid.
+    Metadata(ImageReader &image,
              core::ArraySlice<const DedicatedIp> dips,
              core::ArraySlice<const ManualRegion> manual);
 
@@ -60,6 +72,7 @@ public:
     Metadata(Metadata &&other) : Metadata{} {*this = std::move(other);}
     Metadata &operator=(Metadata &&other)
     {
+        _pArena = std::move(other._pArena);
         _dynamicGroupsById = std::move(other._dynamicGroupsById);
         _dynamicGroups = std::move(other._dynamicGroups);
         _countryDisplaysById = std::move(other._countryDisplaysById);
@@ -200,6 +213,11 @@ private:
     // Build a region and country display for manual regions
     void buildManualRegionDisplays(core::ArraySlice<const ManualRegion> manualRegions);
 
+    // Write and read regions image sections
+    static void writeImageDisplayText(ImageWriter &image, const DisplayText &text);
+    static DisplayText readImageDisplayText(ImageReader &image);
+    void writeImage(ImageWriter &image) const;
+
 public:
     const DynamicRole *getDynamicRole(core::StringSlice id) const;
     core::ArraySlice<const DynamicRole * const> dynamicGroups() const {return _dynamicGroups;}
@@ -209,6 +227,9 @@ public:
     core::ArraySlice<const RegionDisplay * const> regionDisplays() const {return _regionDisplays;}
 
 private:
+    // Like RegionList, all elements are allocated from a per-instance arena,
+    // freed at once when this Metadata is superseded.  Null when empty.
+    std::shared_ptr<core::Arena> _pArena;
     // Like RegionList, the maps own the elements in shared_ptrs, and vectors of
     // raw pointers are held just to provide to the API
     std::unordered_map<core::StringSlice, std::shared_ptr<const DynamicRole>> _dynamicGroupsById;
@@ -19,6 +19,7 @@
 #pragma once
 #include "server.h"
 #include <kapps_core/src/retainshared.h>
+#include <algorithm>
 
 namespace kapps::regions {
 
@@ -66,6 +67,23 @@ public:
         return *this;
     }
 
+    // Regions are equal if all fields are equal and they have equal servers
+    // in the same order
+    bool operator==(const Region &other) const
+    {
+        return id() == other.id() && autoSafe() == other.autoSafe() &&
+            portForward() == other.portForward() &&
+            geoLocated() == other.geoLocated() &&
+            dipAddress() == other.dipAddress() &&
+            std::equal(_servers.begin(), _servers.end(),
+                other._servers.begin(), other._servers.end(),
+                [](const auto &pFirst, const auto &pSecond)
+                {
+                    return *pFirst == *pSecond;
+                });
+    }
+    bool operator!=(const Region &other) const {return !(*this == other);}
+
 public:
     core::StringSlice id() const {return _id;}
     bool autoSafe() const {return _autoSafe;}
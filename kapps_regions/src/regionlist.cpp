@@ -18,16 +18,97 @@
 
 #include "regionlist.h"
 #include <kapps_core/src/logger.h>
+#include <kapps_core/src/jsonstream.h>
+#include <stdexcept>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 
 namespace kapps::regions {
 
+namespace
+{
+    // Flags used in regions images
+    enum : std::uint32_t
+    {
+        ImageGroupOpenVpnUdpNcp = 0x01,
+        ImageGroupOpenVpnTcpNcp = 0x02,
+        ImageGroupIkev2 = 0x04,
+    };
+    enum : std::uint32_t
+    {
+        ImageRegionAutoSafe = 0x01,
+        ImageRegionPortForward = 0x02,
+        ImageRegionGeoLocated = 0x04,
+    };
+
+    // 64-bit FNV-1a hash, used to compute RegionList::version()
+    class ContentHash
+    {
+    public:
+        void add(const void *pData, std::size_t size)
+        {
+            auto pBytes = reinterpret_cast<const unsigned char*>(pData);
+            for(std::size_t i=0; i<size; ++i)
+            {
+                _hash ^= pBytes[i];
+                _hash *= 0x100000001b3ull;
+            }
+        }
+        void add(std::uint64_t value) {add(&value, sizeof(value));}
+        void add(core::StringSlice value)
+        {
+            add(value.size());
+            add(value.data(), value.size());
+        }
+        void add(Ports ports)
+        {
+            add(ports.size());
+            add(ports.data(), ports.size() * sizeof(std::uint16_t));
+        }
+
+        std::uint64_t value() const {return _hash;}
+
+    private:
+        std::uint64_t _hash{0xcbf29ce484222325ull};
+    };
+
+    std::uint64_t hashRegion(const Region &region)
+    {
+        ContentHash hash;
+        hash.add(region.id());
+        hash.add((region.autoSafe() ? ImageRegionAutoSafe : 0) |
+                 (region.portForward() ? ImageRegionPortForward : 0) |
+                 (region.geoLocated() ? ImageRegionGeoLocated : 0));
+        hash.add(region.dipAddress().address());
+        hash.add(region.servers().size());
+        for(const Server *pServer : region.servers())
+        {
+            hash.add(pServer->address().address());
+            hash.add(pServer->commonName());
+            hash.add(pServer->fqdn());
+            hash.add((pServer->openVpnUdpNcp() ? ImageGroupOpenVpnUdpNcp : 0) |
+                     (pServer->openVpnTcpNcp() ? ImageGroupOpenVpnTcpNcp : 0) |
+                     (pServer->hasIkev2() ? ImageGroupIkev2 : 0));
+            hash.add(pServer->openVpnUdpPorts());
+            hash.add(pServer->openVpnTcpPorts());
+            hash.add(pServer->wireGuardPorts());
+            hash.add(pServer->shadowsocksPorts());
+            hash.add(pServer->shadowsocksKey());
+            hash.add(pServer->shadowsocksCipher());
+            hash.add(pServer->metaPorts());
+        }
+        return hash.value();
+    }
+}
+
 RegionList::PIAv6_t RegionList::PIAv6{};
 
 RegionList::RegionList(core::StringSlice regionsJson,
                        core::StringSlice shadowsocksJson,
                        core::ArraySlice<const DedicatedIp> dips,
-                       core::ArraySlice<const ManualRegion> manual)
+                       core::ArraySlice<const ManualRegion> manual,
+                       ImageWriter *pImage)
+    : _pArena{std::make_shared<core::Arena>()}
 {
     auto json = nlohmann::json::parse(regionsJson);
     auto groups = readJsonServiceGroups(json);
@@ -56,109 +137,277 @@ RegionList::RegionList(core::StringSlice regionsJson,
     _regionsById.reserve(jsonRegions.size() + dips.size() + manual.size());
 
     readJsonRegions(jsonRegions, groups, shadowsocksServers);
-    StdRegionsById stdRegions;
-    stdRegions.reserve(_regionsById.size());
-    for(const auto &[id, pRegion] : _regionsById)
-        stdRegions.insert({id, pRegion.get()});
-
-    // Add Dedicated IP regions.  These need to reference standard regions for
-    // some details like port forwarding, etc., so they are added after the
-    // standard regions.
-    buildDipRegions(dips, groups, stdRegions);
-    // Add manual regions too.
-    buildManualRegions(manual, groups, stdRegions);
-
-    // Set up _regions now that we've fully built _regionsById
-    _regions.reserve(_regionsById.size());
-    for(const auto &[id, pRegion] : _regionsById)
-        _regions.push_back(pRegion.get());
+    if(pImage)
+        writeImage(*pImage, groups);
+    buildNonStdRegions(dips, manual, groups);
 }
 
 RegionList::RegionList(PIAv6_t, core::StringSlice regionsJson,
                        core::StringSlice shadowsocksJson,
                        core::ArraySlice<const DedicatedIp> dips,
-                       core::ArraySlice<const ManualRegion> manual)
+                       core::ArraySlice<const ManualRegion> manual,
+                       ImageWriter *pImage)
+    : _pArena{std::make_shared<core::Arena>()}
 {
-    auto json = nlohmann::json::parse(regionsJson);
-    // Read service groups.  The v6 service groups are just an array of services
-    // (the "name" is the property key in "groups"), and the format is nearly
-    // identical to v7 - we can use the normal logic to parse the services
-    // arrays.
+    // If a Shadowsocks list was given, read Shadowsocks servers.  This is
+    // needed before we start reading regions.
+    ShadowsocksServers shadowsocksServers;
+    nlohmann::json shadowsocksJsonObj;
+    if(!shadowsocksJson.empty())
+    {
+        shadowsocksJsonObj = nlohmann::json::parse(shadowsocksJson);
+        shadowsocksServers = readShadowsocksServers(shadowsocksJsonObj);
+    }
+
+    // The v6 regions list is large, stream it instead of building a DOM for
+    // the whole thing.  "groups" is held since the service group keys refer
+    // to it; each region is read and discarded as soon as it's complete.
     //
-    // Unlike v7, the v6 format does not indicate OpenVPN NCP support in the
-    // service group; it's specified on each server instead.  To handle that,
-    // we create two copies of each service group - one with NCP=true, and one
-    // with NCP=false, then select the appropriate one on a per-server basis.
+    // "groups" is needed to read regions; it normally precedes "regions" (the
+    // properties are sorted), but if it doesn't, hold on to regions until
+    // the groups are read.
     ServiceGroups ncpGroups, pssGroups; // "NCP" or "pia-signal-settings" group variants
-    const auto &jsonGroups = json.at("groups");
-    ncpGroups.reserve(jsonGroups.size());
-    pssGroups.reserve(jsonGroups.size());
-    for(const auto &[groupKey, groupValue] : core::jsonObject(json.at("groups")).items())
-    {
-        try
+    nlohmann::json jsonGroups;
+    bool haveGroups{false}, haveRegions{false};
+    nlohmann::json pendingRegions = nlohmann::json::array();
+
+    _regionsById.reserve(dips.size() + manual.size());
+
+    core::streamJsonObject(regionsJson,
+        [](core::StringSlice key){return key == "regions";},
+        [&](core::StringSlice key, nlohmann::json &&value)
         {
-            // Ignore duplicates
-            if(ncpGroups.count(groupKey) || pssGroups.count(groupKey))
+            if(key == "groups")
             {
-                KAPPS_CORE_WARNING() << "Duplicate service group" << groupKey
-                    << "in regions list";
-                throw std::runtime_error{"Duplicate service group in regions list"};
+                jsonGroups = std::move(value);
+                readPiav6JsonGroups(jsonGroups, ncpGroups, pssGroups);
+                haveGroups = true;
+                for(const auto &jsonRegion : pendingRegions)
+                    readPiav6JsonRegion(jsonRegion, ncpGroups, pssGroups, shadowsocksServers);
+                pendingRegions = nlohmann::json::array();
             }
+            else if(key == "regions")
+            {
+                haveRegions = true;
+                if(haveGroups)
+                    readPiav6JsonRegion(value, ncpGroups, pssGroups, shadowsocksServers);
+                else
+                    pendingRegions.push_back(std::move(value));
+            }
+        });
 
-            ServiceGroup newGroup{};
-            newGroup.readPiav6JsonServicesArray(groupValue);
-            // The group has NCP since v6 lacks an "ncp" attribute; create a
-            // pia-signal-settings variation of the group too.  (Do this even if
-            // the group doesn't actually have any OpenVPN services, so we can
-            // still look in either map when reading servers.)
-            pssGroups.emplace(groupKey,
-                std::make_shared<ServiceGroup>(
-                    newGroup.openVpnUdpPorts().to_vector(), false,
-                    newGroup.openVpnTcpPorts().to_vector(), false,
-                    newGroup.wireGuardPorts().to_vector(), newGroup.ikev2(),
-                    newGroup.shadowsocksPorts().to_vector(),
-                    newGroup.shadowsocksKey().to_string(),
-                    newGroup.shadowsocksCipher().to_string(),
-                    newGroup.metaPorts().to_vector()));
-            ncpGroups.emplace(groupKey,
-                std::make_shared<ServiceGroup>(std::move(newGroup)));
-        }
-        catch(const std::exception &ex)
+    // Both are required, like json.at() would require for a DOM
+    if(!haveGroups)
+        throw std::runtime_error{"Regions list does not contain \"groups\""};
+    if(!haveRegions)
+        throw std::runtime_error{"Regions list does not contain \"regions\""};
+
+    // The v6 format does not provide pubdns.
+
+    // DIP and manual regions are assumed not to support NCP (use pssGroups).
+    // Manual has a specific override for this; DIP currently does not.
+    if(pImage)
+        writeImage(*pImage, pssGroups);
+    buildNonStdRegions(dips, manual, pssGroups);
+}
+
+RegionList::RegionList(ImageReader &image,
+                       core::ArraySlice<const DedicatedIp> dips,
+                       core::ArraySlice<const ManualRegion> manual)
+    : _pArena{std::make_shared<core::Arena>()}
+{
+    _publicDnsServers.resize(image.count(sizeof(std::uint32_t)));
+    for(auto &address : _publicDnsServers)
+        address = core::Ipv4Address{image.u32()};
+
+    // All service groups referenced by servers or by name
+    std::vector<std::shared_ptr<ServiceGroup>> groupsByIndex;
+    groupsByIndex.resize(image.count(sizeof(std::uint32_t) * 8));
+    for(auto &pGroup : groupsByIndex)
+    {
+        auto openVpnUdpPorts = image.ports();
+        auto openVpnTcpPorts = image.ports();
+        auto wireGuardPorts = image.ports();
+        auto shadowsocksPorts = image.ports();
+        auto metaPorts = image.ports();
+        auto flags = image.u32();
+        auto shadowsocksKey = image.str().to_string();
+        auto shadowsocksCipher = image.str().to_string();
+        pGroup = core::makeArenaShared<ServiceGroup>(_pArena,
+            openVpnUdpPorts, (flags & ImageGroupOpenVpnUdpNcp) != 0,
+            openVpnTcpPorts, (flags & ImageGroupOpenVpnTcpNcp) != 0,
+            wireGuardPorts, (flags & ImageGroupIkev2) != 0,
+            shadowsocksPorts, std::move(shadowsocksKey),
+            std::move(shadowsocksCipher), metaPorts);
+    }
+    auto groupAt = [&](std::uint32_t index) -> const std::shared_ptr<ServiceGroup> &
+    {
+        if(index >= groupsByIndex.size())
+            throw std::runtime_error{"Invalid service group in regions image"};
+        return groupsByIndex[index];
+    };
+
+    // Named service groups for DIP and manual regions.  The keys refer to the
+    // image data, which outlives this constructor.
+    ServiceGroups namedGroups;
+    auto namedCount = image.count(sizeof(std::uint32_t) * 2);
+    namedGroups.reserve(namedCount);
+    while(namedGroups.size() < namedCount)
+    {
+        auto name = image.str();
+        if(!namedGroups.emplace(name, groupAt(image.u32())).second)
+            throw std::runtime_error{"Duplicate service group in regions image"};
+    }
+
+    auto regionCount = image.count(sizeof(std::uint32_t) * 4);
+    _regionsById.reserve(regionCount + dips.size() + manual.size());
+    for(std::size_t i = 0; i < regionCount; ++i)
+    {
+        auto id = image.str().to_string();
+        auto flags = image.u32();
+        core::Ipv4Address dipAddress{image.u32()};
+        std::vector<std::shared_ptr<const Server>> servers;
+        servers.resize(image.count(sizeof(std::uint32_t) * 4));
+        for(auto &pServer : servers)
         {
-            KAPPS_CORE_WARNING() << "Unable to read service group" << groupKey << "-"
-                << ex.what();
+            core::Ipv4Address address{image.u32()};
+            auto commonName = image.str().to_string();
+            auto fqdn = image.str().to_string();
+            pServer = core::makeArenaShared<Server>(_pArena, address,
+                std::move(commonName), std::move(fqdn), groupAt(image.u32()));
         }
+        auto pRegion = core::makeArenaShared<Region>(_pArena, std::move(id),
+            (flags & ImageRegionAutoSafe) != 0, (flags & ImageRegionPortForward) != 0,
+            (flags & ImageRegionGeoLocated) != 0, dipAddress, std::move(servers));
+        if(!_regionsById.emplace(pRegion->id(), pRegion).second)
+            throw std::runtime_error{"Duplicate region in regions image"};
     }
 
-    // The v6 format does not provide pubdns.
+    buildNonStdRegions(dips, manual, namedGroups);
+}
 
-    // If a Shadowsocks list was given, read Shadowsocks servers.
-    ShadowsocksServers shadowsocksServers;
-    nlohmann::json shadowsocksJsonObj;
-    if(!shadowsocksJson.empty())
+void RegionList::writeImage(ImageWriter &image, const ServiceGroups &namedGroups) const
+{
+    image.u32(static_cast<std::uint32_t>(_publicDnsServers.size()));
+    for(const auto &address : _publicDnsServers)
+        image.u32(address.address());
+
+    // Find all the distinct service groups - servers share them
+    std::vector<const ServiceGroup*> groups;
+    std::unordered_map<const ServiceGroup*, std::uint32_t> groupIndices;
+    auto addGroup = [&](const ServiceGroup *pGroup)
     {
-        shadowsocksJsonObj = nlohmann::json::parse(shadowsocksJson);
-        shadowsocksServers = readShadowsocksServers(shadowsocksJsonObj);
+        if(groupIndices.emplace(pGroup, static_cast<std::uint32_t>(groups.size())).second)
+            groups.push_back(pGroup);
+    };
+    for(const auto &[name, pGroup] : namedGroups)
+    {
+        if(pGroup)
+            addGroup(pGroup.get());
+    }
+    std::uint32_t regionCount{0};
+    for(const auto &[id, pRegion] : _regionsById)
+    {
+        if(!pRegion)
+            continue;
+        ++regionCount;
+        for(const auto &pServer : pRegion->servers())
+            addGroup(&pServer->serviceGroup());
     }
 
-    const auto &jsonRegions = json.at("regions");
-    _regionsById.reserve(jsonRegions.size() + dips.size() + manual.size());
+    image.u32(static_cast<std::uint32_t>(groups.size()));
+    for(const auto &pGroup : groups)
+    {
+        image.ports(pGroup->openVpnUdpPorts());
+        image.ports(pGroup->openVpnTcpPorts());
+        image.ports(pGroup->wireGuardPorts());
+        image.ports(pGroup->shadowsocksPorts());
+        image.ports(pGroup->metaPorts());
+        image.u32((pGroup->openVpnUdpNcp() ? ImageGroupOpenVpnUdpNcp : 0) |
+                  (pGroup->openVpnTcpNcp() ? ImageGroupOpenVpnTcpNcp : 0) |
+                  (pGroup->ikev2() ? ImageGroupIkev2 : 0));
+        image.str(pGroup->shadowsocksKey());
+        image.str(pGroup->shadowsocksCipher());
+    }
+
+    std::uint32_t namedCount{0};
+    for(const auto &[name, pGroup] : namedGroups)
+    {
+        if(pGroup)
+            ++namedCount;
+    }
+    image.u32(namedCount);
+    for(const auto &[name, pGroup] : namedGroups)
+    {
+        if(pGroup)
+        {
+            image.str(name);
+            image.u32(groupIndices.at(pGroup.get()));
+        }
+    }
+
+    image.u32(regionCount);
+    for(const auto &[id, pRegion] : _regionsById)
+    {
+        if(!pRegion)
+            continue;
+        image.str(pRegion->id());
+        image.u32((pRegion->autoSafe() ? ImageRegionAutoSafe : 0) |
+                  (pRegion->portForward() ? ImageRegionPortForward : 0) |
+                  (pRegion->geoLocated() ? ImageRegionGeoLocated : 0));
+        image.u32(pRegion->dipAddress().address());
+        image.u32(static_cast<std::uint32_t>(pRegion->servers().size()));
+        for(const auto &pServer : pRegion->servers())
+        {
+            image.u32(pServer->address().address());
+            image.str(pServer->commonName());
+            image.str(pServer->fqdn());
+            image.u32(groupIndices.at(&pServer->serviceGroup()));
+        }
+    }
+}
 
-    readPiav6JsonRegions(jsonRegions, ncpGroups, pssGroups, shadowsocksServers);
+void RegionList::buildNonStdRegions(core::ArraySlice<const DedicatedIp> dips,
+                                    core::ArraySlice<const ManualRegion> manual,
+                                    const ServiceGroups &groups)
+{
     StdRegionsById stdRegions;
     stdRegions.reserve(_regionsById.size());
     for(const auto &[id, pRegion] : _regionsById)
         stdRegions.insert({id, pRegion.get()});
 
-    // DIP and manual regions are assumed not to support NCP (use pssGroups).
-    // Manual has a specific override for this; DIP currently does not.
-    buildDipRegions(dips, pssGroups, stdRegions);
-    buildManualRegions(manual, pssGroups, stdRegions);
+    // Add Dedicated IP regions.  These need to reference standard regions for
+    // some details like port forwarding, etc., so they are added after the
+    // standard regions.
+    buildDipRegions(dips, groups, stdRegions);
+    // Add manual regions too.
+    buildManualRegions(manual, groups, stdRegions);
 
     // Set up _regions now that we've fully built _regionsById
     _regions.reserve(_regionsById.size());
     for(const auto &[id, pRegion] : _regionsById)
         _regions.push_back(pRegion.get());
+
+    buildVersion();
+}
+
+void RegionList::buildVersion()
+{
+    // _regions is in hash map order, which isn't meaningful, so the region
+    // hashes are combined with a sum to ignore the order.
+    std::uint64_t regionsSum{0};
+    for(const Region *pRegion : _regions)
+        regionsSum += hashRegion(*pRegion);
+
+    ContentHash hash;
+    hash.add(_regions.size());
+    hash.add(regionsSum);
+    for(const auto &dnsServer : _publicDnsServers)
+        hash.add(dnsServer.address());
+    _version = hash.value();
+    // 0 is reserved for an empty RegionList
+    if(_version == 0)
+        _version = 1;
 }
 
 auto RegionList::readJsonServiceGroups(const nlohmann::json &json)
@@ -185,7 +434,7 @@ auto RegionList::readJsonServiceGroups(const nlohmann::json &json)
             }
 
             auto group = jsonGroup.get<ServiceGroup>();
-            groups.emplace(name, std::make_shared<ServiceGroup>(std::move(group)));
+            groups.emplace(name, core::makeArenaShared<ServiceGroup>(_pArena, std::move(group)));
         }
         catch(const std::exception &ex)
         {
@@ -223,7 +472,7 @@ void RegionList::readJsonRegions(const nlohmann::json &jsonRegions,
             if(!servers.empty())
                 addShadowsocksServer(id, servers, shadowsocksServers);
 
-            auto pRegion = std::make_shared<Region>(id.to_string(), autoRegion, portForward,
+            auto pRegion = core::makeArenaShared<Region>(_pArena, id.to_string(), autoRegion, portForward,
                     geo, std::string{}, std::move(servers));
             _regionsById.emplace(pRegion->id(), std::move(pRegion));
         }
@@ -268,7 +517,7 @@ auto RegionList::readJsonRegionServers(const nlohmann::json &jsonRegion,
             // this server.)
             else if(itGroup->second && itGroup->second->hasAnyService())
             {
-                servers.push_back(std::make_shared<Server>(ip, std::move(cn),
+                servers.push_back(core::makeArenaShared<Server>(_pArena, ip, std::move(cn),
                     std::move(fqdn), itGroup->second));
             }
         }
@@ -314,7 +563,7 @@ auto RegionList::readShadowsocksServers(const nlohmann::json &json) const
 
             // Create a service group - no attempt is made to actually deduplicate
             // servers with identical configuration
-            auto pServiceGroup = std::make_shared<ServiceGroup>(
+            auto pServiceGroup = core::makeArenaShared<ServiceGroup>(_pArena,
                 std::vector<std::uint16_t>{}, false,
                 std::vector<std::uint16_t>{}, false,
                 std::vector<std::uint16_t>{}, false,
@@ -324,7 +573,7 @@ auto RegionList::readShadowsocksServers(const nlohmann::json &json) const
                 std::vector<std::uint16_t>{});
             // Then make a server.  No common name is known for these servers,
             // Shadowsocks doesn't need it
-            auto pServer = std::make_shared<Server>(
+            auto pServer = core::makeArenaShared<Server>(_pArena,
                 ssRegion.at("host").get<core::Ipv4Address>(),
                 std::string{}, std::string{}, std::move(pServiceGroup));
             servers.emplace(id, std::move(pServer));
@@ -348,55 +597,104 @@ void RegionList::addShadowsocksServer(core::StringSlice id,
         servers.push_back(itSs->second);
 }
 
-void RegionList::readPiav6JsonRegions(const nlohmann::json &jsonRegions,
-    const ServiceGroups &ncpGroups, const ServiceGroups &pssGroups,
-    const ShadowsocksServers &shadowsocksServers)
+void RegionList::readPiav6JsonGroups(const nlohmann::json &jsonGroups,
+    ServiceGroups &ncpGroups, ServiceGroups &pssGroups)
 {
-    for(const auto &jsonRegion : core::jsonArray(jsonRegions))
+    // Read service groups.  The v6 service groups are just an array of services
+    // (the "name" is the property key in "groups"), and the format is nearly
+    // identical to v7 - we can use the normal logic to parse the services
+    // arrays.
+    //
+    // Unlike v7, the v6 format does not indicate OpenVPN NCP support in the
+    // service group; it's specified on each server instead.  To handle that,
+    // we create two copies of each service group - one with NCP=true, and one
+    // with NCP=false, then select the appropriate one on a per-server basis.
+    ncpGroups.reserve(jsonGroups.size());
+    pssGroups.reserve(jsonGroups.size());
+    for(const auto &[groupKey, groupValue] : core::jsonObject(jsonGroups).items())
     {
-        core::StringSlice id;
         try
         {
-            id = jsonRegion.at("id").get<core::StringSlice>();
-            if(_regionsById.count(id))
+            // Ignore duplicates
+            if(ncpGroups.count(groupKey) || pssGroups.count(groupKey))
             {
-                KAPPS_CORE_WARNING() << "Duplicate region" << id
+                KAPPS_CORE_WARNING() << "Duplicate service group" << groupKey
                     << "in regions list";
-                throw std::runtime_error("Duplicate region ID");
+                throw std::runtime_error{"Duplicate service group in regions list"};
             }
 
-            auto autoRegion = jsonRegion.at("auto_region").get<bool>();
-            auto portForward = jsonRegion.at("port_forward").get<bool>();
-            auto geo = jsonRegion.at("geo").get<bool>();
-            // * v6 doesn't have a 'new' flag.
-            // * 'name' and 'country' are used by Metadata, not RegionList (moved
-            //   to metadata in regions v7 / metadata v3)
-            // * 'dns' is not used.
-            auto offline = jsonRegion.at("offline").get<bool>();
-
-            std::vector<std::shared_ptr<const Server>> servers;
-            // v6 has an explicit 'offline' flag for each region.  v7 just
-            // indicates offline regions by providing no servers.  The 'offline'
-            // flag was never used in lieu of just providing no servers, but
-            // just in case it would be set, skip reading the servers so the
-            // region does become 'offline'.
-            if(!offline)
-                servers = readPiav6JsonRegionServers(jsonRegion, id, ncpGroups, pssGroups);
-            if(!servers.empty())
-                addShadowsocksServer(id, servers, shadowsocksServers);
-
-            auto pRegion = std::make_shared<Region>(id.to_string(), autoRegion,
-                    portForward, geo, std::string{}, std::move(servers));
-            _regionsById.emplace(pRegion->id(), std::move(pRegion));
+            ServiceGroup newGroup{};
+            newGroup.readPiav6JsonServicesArray(groupValue);
+            // The group has NCP since v6 lacks an "ncp" attribute; create a
+            // pia-signal-settings variation of the group too.  (Do this even if
+            // the group doesn't actually have any OpenVPN services, so we can
+            // still look in either map when reading servers.)
+            pssGroups.emplace(groupKey,
+                core::makeArenaShared<ServiceGroup>(_pArena,
+                    newGroup.openVpnUdpPorts().to_vector(), false,
+                    newGroup.openVpnTcpPorts().to_vector(), false,
+                    newGroup.wireGuardPorts().to_vector(), newGroup.ikev2(),
+                    newGroup.shadowsocksPorts().to_vector(),
+                    newGroup.shadowsocksKey().to_string(),
+                    newGroup.shadowsocksCipher().to_string(),
+                    newGroup.metaPorts().to_vector()));
+            ncpGroups.emplace(groupKey,
+                core::makeArenaShared<ServiceGroup>(_pArena, std::move(newGroup)));
         }
         catch(const std::exception &ex)
         {
-            KAPPS_CORE_WARNING() << "Unable to read region" << id << "-"
+            KAPPS_CORE_WARNING() << "Unable to read service group" << groupKey << "-"
                 << ex.what();
         }
     }
 }
 
+void RegionList::readPiav6JsonRegion(const nlohmann::json &jsonRegion,
+    const ServiceGroups &ncpGroups, const ServiceGroups &pssGroups,
+    const ShadowsocksServers &shadowsocksServers)
+{
+    core::StringSlice id;
+    try
+    {
+        id = jsonRegion.at("id").get<core::StringSlice>();
+        if(_regionsById.count(id))
+        {
+            KAPPS_CORE_WARNING() << "Duplicate region" << id
+                << "in regions list";
+            throw std::runtime_error("Duplicate region ID");
+        }
+
+        auto autoRegion = jsonRegion.at("auto_region").get<bool>();
+        auto portForward = jsonRegion.at("port_forward").get<bool>();
+        auto geo = jsonRegion.at("geo").get<bool>();
+        // * v6 doesn't have a 'new' flag.
+        // * 'name' and 'country' are used by Metadata, not RegionList (moved
+        //   to metadata in regions v7 / metadata v3)
+        // * 'dns' is not used.
+        auto offline = jsonRegion.at("offline").get<bool>();
+
+        std::vector<std::shared_ptr<const Server>> servers;
+        // v6 has an explicit 'offline' flag for each region.  v7 just
+        // indicates offline regions by providing no servers.  The 'offline'
+        // flag was never used in lieu of just providing no servers, but
+        // just in case it would be set, skip reading the servers so the
+        // region does become 'offline'.
+        if(!offline)
+            servers = readPiav6JsonRegionServers(jsonRegion, id, ncpGroups, pssGroups);
+        if(!servers.empty())
+            addShadowsocksServer(id, servers, shadowsocksServers);
+
+        auto pRegion = core::makeArenaShared<Region>(_pArena, id.to_string(), autoRegion,
+                portForward, geo, std::string{}, std::move(servers));
+        _regionsById.emplace(pRegion->id(), std::move(pRegion));
+    }
+    catch(const std::exception &ex)
+    {
+        KAPPS_CORE_WARNING() << "Unable to read region" << id << "-"
+            << ex.what();
+    }
+}
+
 auto RegionList::readPiav6JsonRegionServers(const nlohmann::json &jsonRegion,
     core::StringSlice id,
     const ServiceGroups &ncpGroups, const ServiceGroups &pssGroups)
@@ -448,7 +746,7 @@ auto RegionList::readPiav6JsonRegionServers(const nlohmann::json &jsonRegion,
                 // this server.)
                 else if(itGroup->second && itGroup->second->hasAnyService())
                 {
-                    servers.push_back(std::make_shared<Server>(ip, std::move(cn),
+                    servers.push_back(core::makeArenaShared<Server>(_pArena, ip, std::move(cn),
                         std::string{}, itGroup->second));
                 }
             }
@@ -506,14 +804,14 @@ void RegionList::buildDipRegions(const core::ArraySlice<const DedicatedIp> &dips
             }
             else
             {
-                servers.push_back(std::make_shared<Server>(dip.address,
+                servers.push_back(core::makeArenaShared<Server>(_pArena, dip.address,
                     dip.commonName.to_string(), dip.fqdn.to_string(),
                     itServiceGroup->second));
             }
         }
 
         const Region &correspondingRegion{*itCorrespondingRegion->second};
-        auto pRegion = std::make_shared<Region>(dip.dipRegionId.to_string(),
+        auto pRegion = core::makeArenaShared<Region>(_pArena, dip.dipRegionId.to_string(),
                                      false,  // DIP regions are not selected automatically
                                      correspondingRegion.portForward(),
                                      correspondingRegion.geoLocated(),
@@ -566,7 +864,7 @@ void RegionList::buildManualRegions(const core::ArraySlice<const ManualRegion> &
             // group is unchanged, but it's not really worth it since this is a
             // dev tool, and we usually only have at most 1 manual server
             // anyway.
-            effectiveGroups[groupEntry.first] = std::make_shared<ServiceGroup>(
+            effectiveGroups[groupEntry.first] = core::makeArenaShared<ServiceGroup>(_pArena,
                     std::move(openVpnUdpPorts), openVpnUdpNcp,
                     std::move(openVpnTcpPorts), openVpnTcpNcp,
                     existing.wireGuardPorts().to_vector(),
@@ -614,14 +912,14 @@ void RegionList::buildManualRegions(const core::ArraySlice<const ManualRegion> &
                     // don't copy other services.  This also makes unnecessary
                     // duplicates if there's more than one meta server, but
                     // again it's not significant for manual servers.
-                    auto pMetaGroup = std::make_shared<ServiceGroup>(
+                    auto pMetaGroup = core::makeArenaShared<ServiceGroup>(_pArena,
                         std::vector<std::uint16_t>{}, true,
                         std::vector<std::uint16_t>{}, true,
                         std::vector<std::uint16_t>{}, false,
                         std::vector<std::uint16_t>{},
                         std::string{}, std::string{},
                         pServer->metaPorts().to_vector());
-                    servers.push_back(std::make_shared<Server>(pServer->address(),
+                    servers.push_back(core::makeArenaShared<Server>(_pArena, pServer->address(),
                         pServer->commonName().to_string(), pServer->fqdn().to_string(),
                         pMetaGroup));
                 }
@@ -630,7 +928,7 @@ void RegionList::buildManualRegions(const core::ArraySlice<const ManualRegion> &
 
         // Most of the flags for a manual region can be defaulted since this is
         // a dev tool
-        auto pRegion = std::make_shared<Region>(manual.manualRegionId.to_string(),
+        auto pRegion = core::makeArenaShared<Region>(_pArena, manual.manualRegionId.to_string(),
                                      false,  // Manual regions are not selected automatically
                                      true,   // Always has port forwarding
                                      false,  // Never geo-located
@@ -18,9 +18,11 @@
 
 #pragma once
 #include "region.h"
+#include "regionsimage.h"
 #include <kapps_regions/dedicatedip.h>
+#include <kapps_core/src/arena.h>
 #include <kapps_core/src/corejson.h>
-#include <unordered_map>
+#include <kapps_core/src/flathashmap.h>
 #include <vector>
 
 namespace kapps::regions {
@@ -94,17 +96,17 @@ class KAPPS_REGIONS_EXPORT RegionList
 {
 private:
     // Service group map used when building regions
-    using ServiceGroups = std::unordered_map<core::StringSlice, std::shared_ptr<ServiceGroup>>;
+    using ServiceGroups = core::FlatHashMap<core::StringSlice, std::shared_ptr<ServiceGroup>>;
     // Region map used when building regions.  This _only_ includes standard
     // regions, because DIP/manual regions cannot reference another DIP/manual
     // region as the "corresponding region".
     //
     // There's no need to hold more refs on the regions here since they are
     // held by _regionsById when this is used.
-    using StdRegionsById = std::unordered_map<core::StringSlice, const Region*>;
+    using StdRegionsById = core::FlatHashMap<core::StringSlice, const Region*>;
     // Map of Shadowsocks servers from region IDs, used to add them to the
     // regions
-    using ShadowsocksServers = std::unordered_map<core::StringSlice, std::shared_ptr<const Server>>;
+    using ShadowsocksServers = core::FlatHashMap<core::StringSlice, std::shared_ptr<const Server>>;
 
 public:
     // RegionList can be created from the PIA regions list v6 format JSON as
@@ -115,19 +117,31 @@ public:
 public:
     RegionList() = default; // Empty region list
 
+    // If pImage is given, the parsed regions (not including DIP or manual
+    // regions) are also written to that regions image; see regionsimage.h.
     RegionList(core::StringSlice regionsJson,
                core::StringSlice shadowsocksJson,
                core::ArraySlice<const DedicatedIp> dips,
-               core::ArraySlice<const ManualRegion> manual);
+               core::ArraySlice<const ManualRegion> manual,
+               ImageWriter *pImage = nullptr);
 
     // Construct from the legacy PIAv6 format; see RegionList::PIAv6 above
     RegionList(PIAv6_t, core::StringSlice regionsJson,
                core::StringSlice shadowsocksJson,
+               core::ArraySlice<const DedicatedIp> dips,
+               core::ArraySlice<const ManualRegion> manual,
+               ImageWriter *pImage = nullptr);
+
+    // Load the regions written to a regions image by one of the constructors
+    // above, then add DIP and manual regions.  The image is read from its
+    // current position.  Throws if the image is invalid.
+    RegionList(ImageReader &image,
                core::ArraySlice<const DedicatedIp> dips,
                core::ArraySlice<const ManualRegion> manual);
 
     // Default copy and assign are fine - _regions and _regionsById in both
-    // *this and other will refer to the same objects after the copy.
+    // *this and other will refer to the same objects after the copy, and they
+    // share the arena.
     RegionList(const RegionList &) = default;
     RegionList &operator=(const RegionList &) = default;
 
@@ -138,14 +152,17 @@ public:
     RegionList(RegionList &&other) : RegionList{} {*this = std::move(other);}
     RegionList &operator=(RegionList &&other)
     {
+        _pArena = std::move(other._pArena);
         _publicDnsServers = std::move(other._publicDnsServers);
         _regions = std::move(other._regions);
         _regionsById = std::move(other._regionsById);
+        _version = other._version;
         // To guarantee that other is in a valid state (not violating its
         // invariant that _regions corresponds to _regionsById); just clear both
         // containers.
         other._regions.clear();
         other._regionsById.clear();
+        other._version = 0;
         return *this;
     }
 
@@ -174,8 +191,12 @@ private:
         std::vector<std::shared_ptr<const Server>> &servers,
         const ShadowsocksServers &shadowsocksServers) const;
 
-    // Support for legacy PIAv6 format
-    void readPiav6JsonRegions(const nlohmann::json &jsonRegions,
+    // Support for legacy PIAv6 format.  The regions list is streamed, so
+    // regions are read one at a time.  The service group keys refer to
+    // jsonGroups, which must outlive ncpGroups and pssGroups.
+    void readPiav6JsonGroups(const nlohmann::json &jsonGroups,
+        ServiceGroups &ncpGroups, ServiceGroups &pssGroups);
+    void readPiav6JsonRegion(const nlohmann::json &jsonRegion,
         const ServiceGroups &ncpGroups, const ServiceGroups &pssGroups,
         const ShadowsocksServers &shadowsocksServers);
     auto readPiav6JsonRegionServers(const nlohmann::json &jsonRegion,
@@ -184,6 +205,19 @@ private:
                                     const ServiceGroups &pssGroups)
         -> std::vector<std::shared_ptr<const Server>>;
 
+    // Write the standard regions to a regions image - used by the constructors
+    // before DIP/manual regions are added.  namedGroups are the groups
+    // referenced by name by DIP and manual regions.
+    void writeImage(ImageWriter &image, const ServiceGroups &namedGroups) const;
+    // Build DIP and manual regions, and set up _regions, after all standard
+    // regions have been built
+    void buildNonStdRegions(core::ArraySlice<const DedicatedIp> dips,
+                            core::ArraySlice<const ManualRegion> manual,
+                            const ServiceGroups &groups);
+
+    // Compute _version after _regions has been built
+    void buildVersion();
+
     // Build dedicated IP regions from the information given to the constructor
     void buildDipRegions(const core::ArraySlice<const DedicatedIp> &dips,
                          const ServiceGroups &groups,
@@ -207,16 +241,28 @@ public:
     // Get all regions
     core::ArraySlice<const Region * const> regions() const {return _regions;}
 
+    // Get a hash of the regions, servers, and public DNS servers.  Lists with
+    // the same content have the same version regardless of order; see
+    // KARRegionListVersion().  0 for an empty RegionList.
+    std::uint64_t version() const {return _version;}
+
 private:
+    // All regions, servers, and service groups built by this RegionList are
+    // allocated from this arena, so a whole generation of the regions list is
+    // freed at once when it's superseded (once any externally-retained
+    // objects are also released).  Null for an empty RegionList.
+    std::shared_ptr<core::Arena> _pArena;
+
     std::vector<core::Ipv4Address> _publicDnsServers;
 
     // Regions are held with shared_ptr so that callers can continue to use them
     // even if the RegionList is destroyed.  This map is keyed by region IDs;
     // the keys refer to string data from the Region.
-    std::unordered_map<core::StringSlice, std::shared_ptr<const Region>> _regionsById;
+    core::FlatHashMap<core::StringSlice, std::shared_ptr<const Region>> _regionsById;
     // This vector of raw region points is held just to provide an ArraySlice
     // from regions().  The Region objects are owned by the shared_ptrs above.
     std::vector<const Region*> _regions;
+    std::uint64_t _version{0};
 };
 
 }
@@ -0,0 +1,59 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "regionlistdiff.h"
+#include <unordered_map>
+
+namespace kapps::regions {
+
+RegionListDiff diffRegions(core::ArraySlice<const Region * const> oldRegions,
+                           core::ArraySlice<const Region * const> newRegions)
+{
+    std::unordered_map<core::StringSlice, const Region*> oldById;
+    oldById.reserve(oldRegions.size());
+    for(const auto &pRegion : oldRegions)
+    {
+        if(pRegion)
+            oldById[pRegion->id()] = pRegion;
+    }
+
+    RegionListDiff diff;
+    for(const auto &pRegion : newRegions)
+    {
+        if(!pRegion)
+            continue;
+        auto itOld = oldById.find(pRegion->id());
+        if(itOld == oldById.end())
+            diff.added.push_back(pRegion->id().to_string());
+        else
+        {
+            if(*itOld->second != *pRegion)
+                diff.changed.push_back(pRegion->id().to_string());
+            // Remove matched regions, anything left over was removed
+            oldById.erase(itOld);
+        }
+    }
+
+    diff.removed.reserve(oldById.size());
+    for(const auto &[id, pRegion] : oldById)
+        diff.removed.push_back(id.to_string());
+
+    return diff;
+}
+
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include "regionlist.h"
+#include <string>
+#include <vector>
+
+namespace kapps::regions {
+
+// Differences between two generations of a regions list.  Regions are matched
+// by ID; a region is "changed" if it's present in both but any of its fields
+// or servers differ.
+struct KAPPS_REGIONS_EXPORT RegionListDiff
+{
+    // IDs of regions only in the new list
+    std::vector<std::string> added;
+    // IDs of regions only in the old list
+    std::vector<std::string> removed;
+    // IDs of regions present in both lists that differ
+    std::vector<std::string> changed;
+
+    // Whether the lists had exactly the same regions
+    bool empty() const {return added.empty() && removed.empty() && changed.empty();}
+};
+
+// Compare two sets of regions.  IDs are expected to be unique within each set
+// (as they are in a RegionList); null entries are ignored.
+KAPPS_REGIONS_EXPORT RegionListDiff diffRegions(core::ArraySlice<const Region * const> oldRegions,
+                                                core::ArraySlice<const Region * const> newRegions);
+
+// Compare two RegionLists
+inline RegionListDiff diffRegionLists(const RegionList &oldList, const RegionList &newList)
+{
+    return diffRegions(oldList.regions(), newList.regions());
+}
+
+}
@@ -0,0 +1,151 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include "regionsimage.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace kapps::regions {
+
+namespace
+{
+    // "KRGI" in host byte order - a byte-swapped image won't match
+    const std::uint32_t imageMagic{0x4B524749};
+    // Bump this for any change to the image format
+    const std::uint32_t imageVersion{1};
+    // All values are stored at 4-byte alignment
+    const std::size_t imageAlign{4};
+}
+
+ImageWriter::ImageWriter(core::StringSlice tag)
+{
+    u32(imageMagic);
+    u32(imageVersion);
+    str(tag);
+}
+
+void ImageWriter::append(const void *pData, std::size_t len)
+{
+    const auto *pBytes = reinterpret_cast<const std::uint8_t*>(pData);
+    _data.insert(_data.end(), pBytes, pBytes + len);
+}
+
+void ImageWriter::pad()
+{
+    while(_data.size() % imageAlign)
+        _data.push_back(0);
+}
+
+void ImageWriter::u32(std::uint32_t value)
+{
+    append(&value, sizeof(value));
+}
+
+void ImageWriter::f64(double value)
+{
+    append(&value, sizeof(value));
+}
+
+void ImageWriter::str(core::StringSlice value)
+{
+    u32(static_cast<std::uint32_t>(value.size()));
+    append(value.data(), value.size());
+    pad();
+}
+
+void ImageWriter::ports(core::ArraySlice<const std::uint16_t> value)
+{
+    u32(static_cast<std::uint32_t>(value.size()));
+    append(value.data(), value.size() * sizeof(std::uint16_t));
+    pad();
+}
+
+ImageReader::ImageReader(core::ArraySlice<const std::uint8_t> image,
+                         core::StringSlice tag)
+    : _image{image}, _pos{0}
+{
+    if(u32() != imageMagic)
+        throw std::runtime_error{"Not a regions image"};
+    if(u32() != imageVersion)
+        throw std::runtime_error{"Regions image version is not supported"};
+    if(str() != tag)
+        throw std::runtime_error{"Regions image is stale"};
+}
+
+const std::uint8_t *ImageReader::take(std::size_t len)
+{
+    if(len > _image.size() - _pos)
+        throw std::runtime_error{"Regions image is truncated"};
+    const std::uint8_t *pData = _image.data() + _pos;
+    _pos += len;
+    return pData;
+}
+
+void ImageReader::skipPad()
+{
+    std::size_t padLen = (imageAlign - _pos % imageAlign) % imageAlign;
+    take(padLen);
+}
+
+std::uint32_t ImageReader::u32()
+{
+    std::uint32_t value;
+    std::memcpy(&value, take(sizeof(value)), sizeof(value));
+    return value;
+}
+
+std::size_t ImageReader::count(std::size_t minElementSize)
+{
+    std::size_t value = u32();
+    if(minElementSize && value > (_image.size() - _pos) / minElementSize)
+        throw std::runtime_error{"Regions image is truncated"};
+    return value;
+}
+
+double ImageReader::f64()
+{
+    double value;
+    std::memcpy(&value, take(sizeof(value)), sizeof(value));
+    return value;
+}
+
+core::StringSlice ImageReader::str()
+{
+    std::size_t len = u32();
+    const char *pData = reinterpret_cast<const char*>(take(len));
+    skipPad();
+    return {pData, len};
+}
+
+PortList ImageReader::ports()
+{
+    std::size_t len = count(sizeof(std::uint16_t));
+    const std::uint8_t *pData = take(len * sizeof(std::uint16_t));
+    PortList value;
+    value.reserve(len);
+    for(std::size_t i=0; i<len; ++i)
+    {
+        std::uint16_t port;
+        std::memcpy(&port, pData + i * sizeof(std::uint16_t), sizeof(port));
+        value.push_back(port);
+    }
+    skipPad();
+    return value;
+}
+
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <kapps_regions/regions.h>
+#include "servicegroup.h"
+#include <kapps_core/src/stringslice.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kapps::regions {
+
+// # Regions images
+//
+// A regions image is a compact binary form of a parsed RegionList and
+// Metadata, so a product can cache the parsed models and reload them without
+// parsing JSON again.  The image holds everything derived from the regions
+// list and metadata, but not dedicated IP or manual regions - those are still
+// built when loading the image, so they can change without rebuilding it.
+//
+// The image is read in place - it can be memory-mapped - and it's checked as
+// it's read; a truncated or corrupt image results in an exception, not
+// undefined behavior.
+//
+// The format is intended to be a local cache only.  Values are stored in host
+// byte order, and the version is bumped for any change in the format; images
+// with a different version or byte order are rejected.  The image also
+// carries a caller-defined tag, which the caller can use to check whether the
+// image is stale.
+
+// Writes an image.  RegionList and Metadata append their sections with
+// writeImage(); the image begins with a header written by the constructor.
+class KAPPS_REGIONS_EXPORT ImageWriter
+{
+public:
+    explicit ImageWriter(core::StringSlice tag);
+
+public:
+    void u32(std::uint32_t value);
+    void f64(double value);
+    void str(core::StringSlice value);
+    void ports(core::ArraySlice<const std::uint16_t> value);
+
+    const std::vector<std::uint8_t> &data() const {return _data;}
+    std::vector<std::uint8_t> take() {return std::move(_data);}
+
+private:
+    void append(const void *pData, std::size_t len);
+    void pad();
+
+private:
+    std::vector<std::uint8_t> _data;
+};
+
+// Reads an image.  The constructor checks the header and throws if it's not
+// valid, not the current version, or doesn't have the expected tag.  The
+// StringSlices returned by str() refer to the image data, which must outlive
+// the ImageReader and any slices returned.
+class KAPPS_REGIONS_EXPORT ImageReader
+{
+public:
+    ImageReader(core::ArraySlice<const std::uint8_t> image, core::StringSlice tag);
+
+public:
+    std::uint32_t u32();
+    // Read a count of elements that follow, each at least minElementSize
+    // bytes - throws if the image is too short to possibly contain them, so
+    // a corrupt count can't cause a huge allocation.
+    std::size_t count(std::size_t minElementSize);
+    double f64();
+    core::StringSlice str();
+    PortList ports();
+
+    bool atEnd() const {return _pos == _image.size();}
+
+private:
+    const std::uint8_t *take(std::size_t len);
+    void skipPad();
+
+private:
+    core::ArraySlice<const std::uint8_t> _image;
+    std::size_t _pos;
+};
+
+}
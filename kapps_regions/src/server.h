@@ -39,6 +39,16 @@ public:
         assert(_pServiceGroup); // Ensured by caller
     }
 
+    // Servers are equal if they have the same address, names, and services;
+    // the service groups are compared by value.
+    bool operator==(const Server &other) const
+    {
+        return address() == other.address() &&
+            commonName() == other.commonName() && fqdn() == other.fqdn() &&
+            *_pServiceGroup == *other._pServiceGroup;
+    }
+    bool operator!=(const Server &other) const {return !(*this == other);}
+
 public:
     core::Ipv4Address address() const {return _address;}
     core::StringSlice commonName() const {return _commonName;}
@@ -68,6 +78,10 @@ public:
     bool hasMeta() const {return !metaPorts().empty();}
     Ports metaPorts() const {return _pServiceGroup->metaPorts();}
 
+    // The service group is shared by servers from the same regions list
+    // service group; this is used to preserve that sharing in regions images.
+    const ServiceGroup &serviceGroup() const {return *_pServiceGroup;}
+
 private:
     core::Ipv4Address _address;
     std::string _commonName;
@@ -23,27 +23,29 @@
 
 namespace kapps::regions {
 
-ServiceGroup::ServiceGroup(std::vector<std::uint16_t> openVpnUdpPorts, bool openVpnUdpNcp,
-                           std::vector<std::uint16_t> openVpnTcpPorts, bool openVpnTcpNcp,
-                           std::vector<std::uint16_t> wireGuardPorts,
+ServiceGroup::ServiceGroup(Ports openVpnUdpPorts, bool openVpnUdpNcp,
+                           Ports openVpnTcpPorts, bool openVpnTcpNcp,
+                           Ports wireGuardPorts,
                            bool ikev2,
-                           std::vector<std::uint16_t> shadowsocksPorts,
+                           Ports shadowsocksPorts,
                            std::string shadowsocksKey, std::string shadowsocksCipher,
-                           std::vector<std::uint16_t> metaPorts)
-    : _openVpnUdpPorts{std::move(openVpnUdpPorts)}, _openVpnUdpNcp{openVpnUdpNcp},
-      _openVpnTcpPorts{std::move(openVpnTcpPorts)}, _openVpnTcpNcp{openVpnTcpNcp},
-      _wireGuardPorts{std::move(wireGuardPorts)},
+                           Ports metaPorts)
+    : _openVpnUdpPorts{openVpnUdpPorts.begin(), openVpnUdpPorts.end()},
+      _openVpnUdpNcp{openVpnUdpNcp},
+      _openVpnTcpPorts{openVpnTcpPorts.begin(), openVpnTcpPorts.end()},
+      _openVpnTcpNcp{openVpnTcpNcp},
+      _wireGuardPorts{wireGuardPorts.begin(), wireGuardPorts.end()},
       _ikev2{ikev2},
-      _shadowsocksPorts{std::move(shadowsocksPorts)},
+      _shadowsocksPorts{shadowsocksPorts.begin(), shadowsocksPorts.end()},
       _shadowsocksKey{std::move(shadowsocksKey)},
       _shadowsocksCipher{std::move(shadowsocksCipher)},
-      _metaPorts{std::move(metaPorts)}
+      _metaPorts{metaPorts.begin(), metaPorts.end()}
 {
 }
 
 void ServiceGroup::readJsonServicePorts(const nlohmann::json &service,
                                         const core::StringSlice &serviceId,
-                                        std::vector<std::uint16_t> &ports)
+                                        PortList &ports)
 {
     // Get the ports as a vector of std::uint16_t.  While json::get() can do
     // this automatically, it would allow silent float-to-integer conversions
@@ -59,7 +61,7 @@ void ServiceGroup::readJsonServicePorts(const nlohmann::json &service,
         throw std::runtime_error{"Service ports must be an array"};
     }
 
-    std::vector<std::uint16_t> newPorts;
+    PortList newPorts;
     newPorts.reserve(jsonPorts.size());
     for(const auto &port : jsonPorts)
     {
@@ -81,8 +83,8 @@ void ServiceGroup::readJsonServicePorts(const nlohmann::json &service,
     if(!ports.empty())
     {
         KAPPS_CORE_WARNING() << "Service group specified service" << serviceId
-            << "more than once - previously with ports:" << ports
-            << "- now with ports:" << newPorts;
+            << "more than once - previously with ports:" << Ports{ports}
+            << "- now with ports:" << Ports{newPorts};
         throw std::runtime_error{"Service group contained duplicate service"};
     }
 
@@ -99,7 +101,7 @@ void ServiceGroup::readJsonServicePorts(const nlohmann::json &service,
 
 void ServiceGroup::readJsonServiceOpenVpn(const nlohmann::json &service,
                                           const core::StringSlice &serviceId,
-                                          std::vector<std::uint16_t> &ports,
+                                          PortList &ports,
                                           bool &ncp)
 {
     readJsonServicePorts(service, serviceId, ports);
@@ -20,6 +20,7 @@
 #include <kapps_core/src/stringslice.h>
 #include <kapps_regions/service.h>
 #include <kapps_core/src/corejson.h>
+#include <kapps_core/src/smallvector.h>
 #include <cstdint>
 #include <vector>
 #include <string>
@@ -45,6 +46,10 @@ enum class Service
 // Array slice of immutable ports - this is used a lot.
 using Ports = core::ArraySlice<const std::uint16_t>;
 
+// Storage for a service's ports.  Services rarely have more than a handful of
+// ports, so these are stored inline.
+using PortList = core::SmallVector<std::uint16_t, 8>;
+
 // Though Server doesn't expose its service group directly, we still store the
 // service group information in a "service group" so we don't have to copy this
 // tons of times.
@@ -52,25 +57,40 @@ class KAPPS_REGIONS_EXPORT ServiceGroup : public core::JsonReadable<ServiceGroup
 {
 public:
     ServiceGroup() = default;
-    ServiceGroup(std::vector<std::uint16_t> openVpnUdpPorts, bool openVpnUdpNcp,
-                 std::vector<std::uint16_t> openVpnTcpPorts, bool openVpnTcpNcp,
-                 std::vector<std::uint16_t> wireGuardPorts,
+    ServiceGroup(Ports openVpnUdpPorts, bool openVpnUdpNcp,
+                 Ports openVpnTcpPorts, bool openVpnTcpNcp,
+                 Ports wireGuardPorts,
                  bool ikev2,
-                 std::vector<std::uint16_t> shadowsocksPorts,
+                 Ports shadowsocksPorts,
                  std::string shadowsocksKey, std::string shadowsocksCipher,
-                 std::vector<std::uint16_t> metaPorts);
+                 Ports metaPorts);
+
+    bool operator==(const ServiceGroup &other) const
+    {
+        return openVpnUdpPorts() == other.openVpnUdpPorts() &&
+            openVpnUdpNcp() == other.openVpnUdpNcp() &&
+            openVpnTcpPorts() == other.openVpnTcpPorts() &&
+            openVpnTcpNcp() == other.openVpnTcpNcp() &&
+            wireGuardPorts() == other.wireGuardPorts() &&
+            ikev2() == other.ikev2() &&
+            shadowsocksPorts() == other.shadowsocksPorts() &&
+            shadowsocksKey() == other.shadowsocksKey() &&
+            shadowsocksCipher() == other.shadowsocksCipher() &&
+            metaPorts() == other.metaPorts();
+    }
+    bool operator!=(const ServiceGroup &other) const {return !(*this == other);}
 
 private:
     // Read any JSON service definition that specifies a list of ports
     // (includes OpenVPN UDP/TCP, WireGuard, meta)
     void readJsonServicePorts(const nlohmann::json &service,
                               const core::StringSlice &serviceId,
-                              std::vector<std::uint16_t> &ports);
+                              PortList &ports);
     // Read any OpenVPN service (UDP or TCP); these have ports as well as an
     // 'ncp' flag.
     void readJsonServiceOpenVpn(const nlohmann::json &service,
                                 const core::StringSlice &serviceId,
-                                std::vector<std::uint16_t> &ports, bool &ncp);
+                                PortList &ports, bool &ncp);
     // Read a service group's services from the JSON "services" array.  Used to
     // implement readJson() and readPiav6JsonServicesArray()
     void readJsonServicesArray(const nlohmann::json &services,
@@ -106,16 +126,16 @@ public:
     void readPiav6JsonServicesArray(const nlohmann::json &services);
 
 private:
-    std::vector<std::uint16_t> _openVpnUdpPorts;
+    PortList _openVpnUdpPorts;
     bool _openVpnUdpNcp;
-    std::vector<std::uint16_t> _openVpnTcpPorts;
+    PortList _openVpnTcpPorts;
     bool _openVpnTcpNcp;
-    std::vector<std::uint16_t> _wireGuardPorts;
+    PortList _wireGuardPorts;
     bool _ikev2;
-    std::vector<std::uint16_t> _shadowsocksPorts;
+    PortList _shadowsocksPorts;
     std::string _shadowsocksKey;
     std::string _shadowsocksCipher;
-    std::vector<std::uint16_t> _metaPorts;
+    PortList _metaPorts;
 };
 
 }
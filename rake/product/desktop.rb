@@ -33,6 +33,8 @@ module PiaDesktop
             .useQt('Network', :export)
             .tap {|v| PiaBreakpad::add(v)}
             .install(stage, :lib)
+        # shm_open() for the state mirror is in librt with older glibc
+        commonlib.lib('rt') if Build.linux?
 
         clientlib = Executable.new("#{Build::Brand}-clientlib", :dynamic)
             .define('BUILD_CLIENTLIB')
@@ -122,6 +124,7 @@ module PiaDesktop
             daemon
                 .framework('AppKit')
                 .framework('CoreWLAN')
+                .framework('IOKit')
                 .framework('SystemConfiguration')
         elsif(Build.linux?)
             daemon.include('/usr/include/libnl3')
@@ -10,6 +10,8 @@ module PiaUnitTest
         'apiclient',
         'check',
         'connectionconfig',
+        'constrainedhash',
+        'core_logger',
         'core_util',
         'exec',
         'ipaddress',
@@ -20,6 +22,7 @@ module PiaUnitTest
         'latencytracker',
         'linebuffer',
         'localsockets',
+        'metrics',
         'nearestlocations',
         'networkmonitor',
         'networktaskwithretry',
@@ -27,19 +30,26 @@ module PiaUnitTest
         'nullable_t',
         'originalnetworkscan',
         'openssl',
+        'openvpn',
         'path',
         'portforwarder',
         'raii',
         'regionlist',
+        'regionsfuzz',
         'retainshared',
         'semversion',
         'servicegroup',
         'settings',
         'subnetbypass',
+        'subnettrie',
         'tasks',
+        'threadpool',
+        'throughputhistory',
+        'timerwheel',
         'transportselector',
         'updatedownloader',
         'vpnmethod',
+        'wakeups',
         'wireguarduapi',
         'workthread'
     ].tap do |t|
@@ -47,16 +57,40 @@ module PiaUnitTest
             t << 'wfp_filters'
         elsif Build.linux?
             t << 'core_fs'
+            t << 'pollworker'
             t << 'splitdnsinfo'
             t << 'rt_tables_initializer'
+            t << 'proctable'
         elsif Build.macos?
            t << 'core_fs'
-           t << 'constrainedhash'
            t << 'flow_tracker'
+           t << 'packet'
+           t << 'pollworker'
            t << 'scutilparse'
         end
     end
 
+    # Benchmarks are in tests/bench_<name>.cpp; see :benchmark below
+    Benchmarks = [
+        'async',
+        'constrainedhash',
+        'flathashmap',
+        'ipc',
+        'latencytracker',
+        'linebuffer',
+        'regions',
+        'stringslice'
+    ].tap do |b|
+        if Build.macos?
+            b << 'packetpath'
+        end
+    end
+
+    # Performance tests are in tests/perf_<name>.cpp; see :perftest below
+    PerfTests = [
+        'regions'
+    ]
+
     def self.defineTargets(versionlib, deps, artifacts)
         # The all-tests-lib library compiles all client and daemon code once to
         # be shared by all unit tests.
@@ -136,33 +170,8 @@ module PiaUnitTest
         anyTestBin = nil
 
         Tests.each do |t|
-            testExec = Executable.new("test-#{t}", :executable)
-                .use(allTestsLib.export)
-                .useQt('Network') # Common
-                .useQt('Qml') # Client
-                .useQt('Quick')
-                .useQt('QuickControls2')
-                .useQt('Gui')
-                .useQt('Test') # Test
-                .define("TEST_MOC=\"tst_#{t}.moc\"")
-                .sourceFile("tests/tst_#{t}.cpp")
-                .include('.') # Some tests include headers using a path from the repo root due to historical QBS limitations
-                .forceLinkSymbol('forceLinkTestlogCpp') # See testlog.cpp, for static initializer
+            testExec = defineTestExecutable("test-#{t}", "tst_#{t}", allTestsLib)
                 .coverage(true)
-            if(Build.windows?)
-                testExec
-                    .useQt('Xml')
-                    .linkArgs(['/IGNORE:4099'])
-            elsif(Build.macos?)
-                testExec
-                    .framework('AppKit')
-                    .framework('CoreWLAN')
-                    .framework('Security')
-                    .framework('ServiceManagement')
-                    .framework('SystemConfiguration') # Daemon dependencies
-            elsif(Build.linux?)
-                testExec.useQt('Widgets')
-            end
 
             # Just grab the first test executable for this
             anyTestBin = testExec.target if anyTestBin == nil
@@ -175,30 +184,8 @@ module PiaUnitTest
             # coverage-raw directory.
             task "run-test-#{t}" => ["test-#{t}", coverageRawBuild.componentDir] do |task|
                 puts "test: #{t}"
-                testBin = testExec.target
-                cmd = ''
                 covData = coverageRawBuild.artifact("coverage_#{t}.raw")
-                opensslLibPath = File.absolute_path(File.join('deps/built',
-                                                              Build.selectDesktop('win', 'mac', 'linux'),
-                                                              Build::TargetArchitecture.to_s))
-                if Build.windows?
-                    # Don't bother with covData, not supported on MSVC
-                    path = [
-                        File.join(Executable::Qt.targetQtRoot, 'bin'),
-                        opensslLibPath,
-                        ENV['PATH']
-                    ]
-                    cmd = Util.cmd("set \"PATH=#{path.join(';')}\" & set \"UNIT_TEST_LIB=#{opensslLibPath}\" & \"#{testBin}\"")
-                elsif Build.macos?
-                    cmd = "LLVM_PROFILE_FILE=\"#{covData}\" UNIT_TEST_LIB=\"#{opensslLibPath}\" \"#{testBin}\""
-                elsif Build.linux?
-                    libPath = [
-                        File.join(Executable::Qt.targetQtRoot, 'lib'),
-                        opensslLibPath
-                    ]
-                    cmd = "LD_LIBRARY_PATH=\"#{libPath.join(':')}\" LLVM_PROFILE_FILE=\"#{covData}\" UNIT_TEST_LIB=\"#{opensslLibPath}\" \"#{testBin}\""
-                end
-               Util.shellRun cmd
+                Util.shellRun testCommand(testExec.target, covData)
             end
 
             task :build_tests_parallel => "test-#{t}"
@@ -229,6 +216,116 @@ module PiaUnitTest
         task :test => testTarget do |t|
             puts "tests finished"
         end
+
+        # Benchmarks use the same test library, but they aren't part of :test
+        # since they take a while and only make sense on an idle machine.
+        # Build and run them with 'rake benchmark', or individually with
+        # 'rake run-benchmark-<name>'.  Arguments for QtTest (such as
+        # "-median 5") can be given in BENCHMARK_ARGS.
+        #
+        # Besides the usual text output, each benchmark writes its results in
+        # QtTest's CSV format to benchmark/bench_<name>.csv in the build
+        # directory, so results can be collected and trended by CI.
+        desc "Build and run all benchmarks"
+        task :benchmark
+
+        benchmarkBuild = Build.new('benchmark')
+
+        Benchmarks.each do |b|
+            benchExec = defineTestExecutable("benchmark-#{b}", "bench_#{b}", allTestsLib)
+
+            task "benchmark-#{b}" => [allTestsLib.target, benchExec.target]
+
+            task "run-benchmark-#{b}" => ["benchmark-#{b}", benchmarkBuild.componentDir] do |task|
+                puts "benchmark: #{b}"
+                csv = benchmarkBuild.artifact("bench_#{b}.csv")
+                benchArgs = ["-o \"#{csv}\",csv", '-o -,txt', ENV['BENCHMARK_ARGS']].compact.join(' ')
+                Util.shellRun testCommand(benchExec.target, nil, benchArgs)
+            end
+
+            task :benchmark => "run-benchmark-#{b}"
+        end
+
+        # Performance tests check time budgets for hot paths.  Like benchmarks,
+        # they aren't part of :test since the results depend on the machine
+        # and its load.  Build and run them with 'rake perftest', or
+        # individually with 'rake run-perftest-<name>'.  Budgets can be scaled
+        # for slow machines with PERF_BUDGET_SCALE.
+        desc "Build and run all performance tests"
+        task :perftest
+
+        PerfTests.each do |p|
+            perfExec = defineTestExecutable("perftest-#{p}", "perf_#{p}", allTestsLib)
+
+            task "perftest-#{p}" => [allTestsLib.target, perfExec.target]
+
+            task "run-perftest-#{p}" => ["perftest-#{p}"] do |task|
+                puts "perftest: #{p}"
+                Util.shellRun testCommand(perfExec.target, nil)
+            end
+
+            task :perftest => "run-perftest-#{p}"
+        end
+    end
+
+    # Define an executable for a unit test, benchmark, or perf test - source is the name of
+    # the source file in tests/ without the extension.
+    def self.defineTestExecutable(name, source, allTestsLib)
+        testExec = Executable.new(name, :executable)
+            .use(allTestsLib.export)
+            .useQt('Network') # Common
+            .useQt('Qml') # Client
+            .useQt('Quick')
+            .useQt('QuickControls2')
+            .useQt('Gui')
+            .useQt('Test') # Test
+            .define("TEST_MOC=\"#{source}.moc\"")
+            .sourceFile("tests/#{source}.cpp")
+            .include('.') # Some tests include headers using a path from the repo root due to historical QBS limitations
+            .forceLinkSymbol('forceLinkTestlogCpp') # See testlog.cpp, for static initializer
+        if(Build.windows?)
+            testExec
+                .useQt('Xml')
+                .linkArgs(['/IGNORE:4099'])
+        elsif(Build.macos?)
+            testExec
+                .framework('AppKit')
+                .framework('CoreWLAN')
+                .framework('Security')
+                .framework('ServiceManagement')
+                .framework('SystemConfiguration') # Daemon dependencies
+        elsif(Build.linux?)
+            testExec.useQt('Widgets')
+        end
+        testExec
+    end
+
+    # Build the command line to run a test executable with the Qt and OpenSSL
+    # libraries.  If covData is given, coverage data is written there when
+    # possible.  args are appended to the command line.
+    def self.testCommand(testBin, covData, args = nil)
+        opensslLibPath = File.absolute_path(File.join('deps/built',
+                                                      Build.selectDesktop('win', 'mac', 'linux'),
+                                                      Build::TargetArchitecture.to_s))
+        profileEnv = covData ? "LLVM_PROFILE_FILE=\"#{covData}\" " : ''
+        testArgs = args ? " #{args}" : ''
+        if Build.windows?
+            # Don't bother with covData, not supported on MSVC
+            path = [
+                File.join(Executable::Qt.targetQtRoot, 'bin'),
+                opensslLibPath,
+                ENV['PATH']
+            ]
+            Util.cmd("set \"PATH=#{path.join(';')}\" & set \"UNIT_TEST_LIB=#{opensslLibPath}\" & \"#{testBin}\"#{testArgs}")
+        elsif Build.macos?
+            "#{profileEnv}UNIT_TEST_LIB=\"#{opensslLibPath}\" \"#{testBin}\"#{testArgs}"
+        else
+            libPath = [
+                File.join(Executable::Qt.targetQtRoot, 'lib'),
+                opensslLibPath
+            ]
+            "LD_LIBRARY_PATH=\"#{libPath.join(':')}\" #{profileEnv}UNIT_TEST_LIB=\"#{opensslLibPath}\" \"#{testBin}\"#{testArgs}"
+        end
     end
 
     def self.defineCoverageTargets(artifacts, coverageRawBuild, anyTestBin)
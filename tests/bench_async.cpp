@@ -0,0 +1,121 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/async.h>
+#include <QtTest>
+
+/*
+
+=== Async benchmarks ===
+
+Async tasks are used for all API requests, JSON-RPC calls, and many other
+operations in the client and daemon.  These measure task throughput - creating
+and resolving tasks, and running then() chains - for 1000 tasks per
+iteration.
+
+*/
+
+namespace
+{
+    const int taskCount{1000};
+}
+
+class bench_async : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup()
+    {
+        QTRY_COMPARE(BaseTask::getTaskCount(), 0);
+    }
+
+    // Create already-resolved tasks
+    void benchResolved()
+    {
+        int total{0};
+        QBENCHMARK
+        {
+            for(int i = 0; i < taskCount; ++i)
+                total += Async<int>::resolve(i)->result();
+        }
+        QVERIFY(total > 0);
+    }
+
+    // Create pending tasks and resolve them later, like network requests
+    void benchCreateResolve()
+    {
+        QVector<Async<int>> tasks;
+        tasks.reserve(taskCount);
+        QBENCHMARK
+        {
+            for(int i = 0; i < taskCount; ++i)
+                tasks.push_back(Async<int>::create());
+            for(int i = 0; i < taskCount; ++i)
+                tasks[i]->resolve(i);
+            tasks.clear();
+        }
+    }
+
+    // Chains of then() callbacks on pending tasks; the depth varies
+    void benchThenChain_data()
+    {
+        QTest::addColumn<int>("depth");
+        QTest::newRow("1") << 1;
+        QTest::newRow("5") << 5;
+    }
+    void benchThenChain()
+    {
+        QFETCH(int, depth);
+        int total{0};
+        QBENCHMARK
+        {
+            for(int i = 0; i < taskCount / depth; ++i)
+            {
+                auto first = Async<int>::create();
+                Async<int> last = first;
+                for(int d = 0; d < depth; ++d)
+                    last = last->then(this, [](int value){return value + 1;});
+                first->resolve(i);
+                total += last->result();
+            }
+        }
+        QVERIFY(total > 0);
+    }
+
+    // Rejections propagating through a chain to an except() handler
+    void benchReject()
+    {
+        int handled{0};
+        QBENCHMARK
+        {
+            for(int i = 0; i < taskCount; ++i)
+            {
+                auto first = Async<int>::create();
+                auto handler = first->then(this, [](int value){return value + 1;})
+                    ->except(this, [&](const Error &){++handled; return 0;});
+                first->reject(Error{HERE, Error::TaskRejected});
+            }
+        }
+        QVERIFY(handled > 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_async)
+#include TEST_MOC
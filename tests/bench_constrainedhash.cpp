@@ -0,0 +1,102 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <kapps_net/src/constrainedhash.h>
+#include <QtTest>
+#include <random>
+#include <vector>
+
+/*
+
+=== ConstrainedHash benchmarks ===
+
+ConstrainedHash is the flow table used by the split tunnel flow tracker - each
+packet looks up its flow, and new flows are inserted, evicting the least
+recently used flow when the table is full.
+
+These replay 100k packets over a table of 4096 flows.  The flow IDs are
+Zipf-like (a few flows carry most packets, as in real traffic), and the number
+of distinct flows varies so the table either fits them all (hits only) or
+churns (frequent evictions).
+
+*/
+
+namespace
+{
+    const std::size_t tableSize{4096};
+    const int packetCount{100000};
+
+    // Flow ID for each packet; a skewed distribution over flowCount flows
+    std::vector<std::uint64_t> buildPackets(std::size_t flowCount)
+    {
+        std::mt19937_64 random{1};
+        // Approximate a Zipf distribution by squaring a uniform value - small
+        // flow indices are much more frequent
+        std::uniform_real_distribution<double> dist{0.0, 1.0};
+        std::vector<std::uint64_t> packets;
+        packets.reserve(packetCount);
+        for(int i = 0; i < packetCount; ++i)
+        {
+            double x = dist(random);
+            auto flow = static_cast<std::uint64_t>(x * x * static_cast<double>(flowCount));
+            // Spread the IDs out like real 5-tuple hashes
+            packets.push_back(flow * 0x9E3779B97F4A7C15ull);
+        }
+        return packets;
+    }
+}
+
+class bench_constrainedhash : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void benchFlowTable_data()
+    {
+        QTest::addColumn<int>("flowCount");
+        QTest::newRow("fits") << 2048;
+        QTest::newRow("churn") << 65536;
+    }
+    void benchFlowTable()
+    {
+        QFETCH(int, flowCount);
+        auto packets = buildPackets(static_cast<std::size_t>(flowCount));
+
+        std::size_t hits{0};
+        QBENCHMARK
+        {
+            kapps::net::ConstrainedHash<std::uint64_t, std::uint32_t> flows{tableSize};
+            hits = 0;
+            for(auto flow : packets)
+            {
+                if(flows.contains(flow))
+                {
+                    ++flows.at(flow);
+                    ++hits;
+                }
+                else
+                    flows.insert({flow, 1});
+            }
+        }
+        qInfo() << "Hit rate:" << (100.0 * hits / packets.size()) << "%";
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_constrainedhash)
+#include TEST_MOC
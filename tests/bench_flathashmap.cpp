@@ -0,0 +1,170 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <kapps_core/src/flathashmap.h>
+#include <kapps_core/src/stringslice.h>
+#include <QtTest>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+
+=== Hash map benchmarks ===
+
+These compare core::FlatHashMap to std::unordered_map for the lookups that
+RegionList and WinAppTracker do - StringSlice keys (region IDs) and integer
+keys (PIDs).  Each data row uses a different number of entries; the lookups
+are a mix of hits and misses in a fixed random order.
+
+Run with the usual QtTest options, such as "-median 5" or "-callgrind".
+
+*/
+
+namespace
+{
+    // Fraction of lookups that miss, roughly what RegionList sees when merging
+    // DIP and manual regions
+    const int missPercent{25};
+
+    std::vector<std::string> buildIds(int count)
+    {
+        std::vector<std::string> ids;
+        ids.reserve(count);
+        for(int i = 0; i < count; ++i)
+            ids.push_back("region_" + std::to_string(i * 7919));
+        return ids;
+    }
+
+    // Lookups - indices into the IDs, or past the end for a miss
+    std::vector<int> buildLookups(int count)
+    {
+        std::mt19937 rng{static_cast<std::uint32_t>(count)};
+        std::uniform_int_distribution<int> hitDist{0, count-1};
+        std::uniform_int_distribution<int> missDist{0, 99};
+        std::vector<int> lookups;
+        lookups.reserve(10000);
+        for(int i = 0; i < 10000; ++i)
+        {
+            int idx = hitDist(rng);
+            if(missDist(rng) < missPercent)
+                idx += count;
+            lookups.push_back(idx);
+        }
+        return lookups;
+    }
+
+    template<class Map>
+    void benchStringLookups(int count)
+    {
+        // Misses use IDs that aren't in the map
+        std::vector<std::string> ids = buildIds(count*2);
+        std::vector<int> lookups = buildLookups(count);
+        Map map;
+        map.reserve(count);
+        for(int i = 0; i < count; ++i)
+            map.emplace(kapps::core::StringSlice{ids[i]}, i);
+
+        std::size_t found{0};
+        QBENCHMARK
+        {
+            found = 0;
+            for(int idx : lookups)
+            {
+                auto itEntry = map.find(kapps::core::StringSlice{ids[idx]});
+                if(itEntry != map.end())
+                    ++found;
+            }
+        }
+        QVERIFY(found > 0);
+        QVERIFY(found < lookups.size());
+    }
+
+    template<class Map>
+    void benchIntLookups(int count)
+    {
+        std::vector<int> lookups = buildLookups(count);
+        Map map;
+        map.reserve(count);
+        // PIDs are multiples of 4 on Windows
+        for(int i = 0; i < count; ++i)
+            map.emplace(static_cast<std::uint32_t>(i*4), i);
+
+        std::size_t found{0};
+        QBENCHMARK
+        {
+            found = 0;
+            for(int idx : lookups)
+            {
+                if(map.find(static_cast<std::uint32_t>(idx*4)) != map.end())
+                    ++found;
+            }
+        }
+        QVERIFY(found > 0);
+        QVERIFY(found < lookups.size());
+    }
+}
+
+class bench_flathashmap : public QObject
+{
+    Q_OBJECT
+
+private:
+    void addCountRows()
+    {
+        QTest::addColumn<int>("count");
+        QTest::newRow("100") << 100;
+        QTest::newRow("1000") << 1000;
+        QTest::newRow("20000") << 20000;
+    }
+
+private slots:
+    void benchStringFlat_data() {addCountRows();}
+    void benchStringFlat()
+    {
+        QFETCH(int, count);
+        benchStringLookups<kapps::core::FlatHashMap<kapps::core::StringSlice, int>>(count);
+    }
+
+    void benchStringStd_data() {addCountRows();}
+    void benchStringStd()
+    {
+        QFETCH(int, count);
+        benchStringLookups<std::unordered_map<kapps::core::StringSlice, int>>(count);
+    }
+
+    void benchIntFlat_data() {addCountRows();}
+    void benchIntFlat()
+    {
+        QFETCH(int, count);
+        benchIntLookups<kapps::core::FlatHashMap<std::uint32_t, int>>(count);
+    }
+
+    void benchIntStd_data() {addCountRows();}
+    void benchIntStd()
+    {
+        QFETCH(int, count);
+        benchIntLookups<std::unordered_map<std::uint32_t, int>>(count);
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_flathashmap)
+#include TEST_MOC
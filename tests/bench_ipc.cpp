@@ -0,0 +1,204 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/async.h>
+#include <common/src/ipc.h>
+#include <common/src/jsonrpc.h>
+#include <QtTest>
+#include <QDataStream>
+#include <QJsonArray>
+#include <QJsonObject>
+
+/*
+
+=== IPC benchmarks ===
+
+These cover the layers of the daemon's client IPC:
+- JSON-RPC message parsing and building (JSON text and CBOR)
+- Dispatching requests to a LocalMethodRegistry and returning the response
+- Framing messages for the local socket
+- Round trips over a real local socket connection
+
+The payloads resemble the daemon's state updates - a small notification and a
+large one similar to a regions list update.
+
+*/
+
+namespace
+{
+    QJsonArray buildParams(int size)
+    {
+        QJsonObject state;
+        QJsonArray locations;
+        for(int i = 0; i < size; ++i)
+        {
+            locations.push_back(QJsonObject{
+                {QStringLiteral("id"), QStringLiteral("region_%1").arg(i)},
+                {QStringLiteral("latency"), 20.0 + i},
+                {QStringLiteral("portForward"), (i % 2) == 0},
+                {QStringLiteral("offline"), false}
+            });
+        }
+        state.insert(QStringLiteral("availableLocations"), locations);
+        return QJsonArray{state};
+    }
+
+    void addPayloadRows()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("small") << 1;
+        QTest::newRow("large") << 500;
+    }
+}
+
+class bench_ipc : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void benchParseMessage_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::addColumn<bool>("cbor");
+        for(int size : {1, 500})
+        {
+            QTest::addRow("%d json", size) << size << false;
+            QTest::addRow("%d cbor", size) << size << true;
+        }
+    }
+    void benchParseMessage()
+    {
+        QFETCH(int, size);
+        QFETCH(bool, cbor);
+        QByteArray msg = buildJsonRPCNotification(QStringLiteral("data"), buildParams(size),
+            cbor ? JsonRPCEncoding::Cbor : JsonRPCEncoding::Json);
+        QString method;
+        QJsonArray params;
+        QBENCHMARK
+        {
+            parseJsonRPCRequest(parseJsonRPCMessage(msg), method, params);
+        }
+        QCOMPARE(method, QStringLiteral("data"));
+    }
+
+    void benchBuildMessage_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::addColumn<bool>("cbor");
+        for(int size : {1, 500})
+        {
+            QTest::addRow("%d json", size) << size << false;
+            QTest::addRow("%d cbor", size) << size << true;
+        }
+    }
+    void benchBuildMessage()
+    {
+        QFETCH(int, size);
+        QFETCH(bool, cbor);
+        QJsonArray params = buildParams(size);
+        QByteArray msg;
+        QBENCHMARK
+        {
+            msg = buildJsonRPCNotification(QStringLiteral("data"), params,
+                cbor ? JsonRPCEncoding::Cbor : JsonRPCEncoding::Json);
+        }
+        QVERIFY(!msg.isEmpty());
+    }
+
+    // Dispatch a call through LocalCallInterface to a registered method and
+    // deliver the response to RemoteCallInterface, without a socket
+    void benchDispatch()
+    {
+        LocalMethodRegistry registry{
+            {QStringLiteral("add"), [](int a, int b){return a + b;}},
+        };
+        LocalCallInterface server{&registry};
+        RemoteCallInterface client;
+        connect(&client, &RemoteCallInterface::messageReady, &server, &LocalCallInterface::processMessage);
+        connect(&server, &LocalCallInterface::messageReady, &client, &RemoteCallInterface::processMessage);
+
+        int responses{0};
+        QBENCHMARK
+        {
+            auto call = client.call(QStringLiteral("add"), 1, 2);
+            call->notify(this, [&](const Error &, const QJsonValue &){++responses;});
+            QTRY_VERIFY(call->isFinished());
+        }
+        QVERIFY(responses > 0);
+    }
+
+    void benchWriteFrame_data() {addPayloadRows();}
+    void benchWriteFrame()
+    {
+        QFETCH(int, size);
+        QByteArray msg = buildJsonRPCNotification(QStringLiteral("data"), buildParams(size),
+                                                  JsonRPCEncoding::Json);
+        QByteArray frame;
+        QBENCHMARK
+        {
+            frame.clear();
+            QDataStream stream{&frame, QIODevice::WriteOnly};
+            LocalSocketIPCConnection::writeFrame(1, msg, stream);
+        }
+        QVERIFY(frame.size() > msg.size());
+    }
+
+    // Send messages from a client to a server over a local socket; the server
+    // echoes each one back.  Each iteration is a batch of 100 messages.
+    void benchSocketRoundTrip_data() {addPayloadRows();}
+    void benchSocketRoundTrip()
+    {
+        QFETCH(int, size);
+        QByteArray msg = buildJsonRPCNotification(QStringLiteral("data"), buildParams(size),
+                                                  JsonRPCEncoding::Json);
+        const int batchSize{100};
+
+        LocalSocketIPCServer server;
+        connect(&server, &LocalSocketIPCServer::newConnection, this,
+            [](IPCConnection *pConnection)
+            {
+                pConnection->setLagThreshold(1000);
+                connect(pConnection, &IPCConnection::messageReceived, pConnection,
+                        [pConnection](const QByteArray &msg){pConnection->sendMessage(msg);});
+            });
+        QVERIFY(server.listen());
+
+        LocalSocketIPCConnection client;
+        int received{0};
+        connect(&client, &IPCConnection::messageReceived, this,
+                [&](const QByteArray &){++received;});
+        client.connectToServer();
+        QVERIFY(QTest::qWaitFor([&]{return server.count() && client.isConnected();}));
+        client.setLagThreshold(1000);
+
+        QBENCHMARK
+        {
+            received = 0;
+            for(int i = 0; i < batchSize; ++i)
+                client.sendMessage(msg);
+            QVERIFY(QTest::qWaitFor([&]{return received == batchSize;}));
+        }
+
+        client.close();
+        server.stop();
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_ipc)
+#include TEST_MOC
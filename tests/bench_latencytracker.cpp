@@ -0,0 +1,278 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include "daemon/src/latencytracker.h"
+#include "common/src/locations.h"
+#include <QtTest>
+#include <QAbstractEventDispatcher>
+#include <QEventLoop>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/*
+
+=== Latency measurement benchmarks ===
+
+These simulate measuring latency to a set of locations with a fake BatchPinger
+backend.  Each location has a configured round trip time, jitter (standard
+deviation), and loss rate; SimulatedPinger answers each request after a
+sampled round trip time (scaled down by timeScale so the benchmark runs
+quickly, but reporting the unscaled time), or not at all if the request is
+lost.
+
+Each QBENCHMARK iteration is one LatencyBatch round over all locations, with
+the results fed to a LatencyHistory per location as LatencyTracker does.
+After each data row, the harness logs:
+- CPU time and event loop wakeups per round
+- probe throughput (replies processed per CPU second)
+- accuracy of the LatencyHistory statistics compared to the configured
+  distributions (mean absolute error of the mean and p95, and of the loss
+  rate)
+
+The accuracy depends on the number of rounds, so use a fixed iteration count
+to compare runs, such as "-iterations 50".
+
+*/
+
+namespace
+{
+    // Simulated round trip times are divided by this factor
+    const int timeScale{10};
+    // Rounds always run at least this many times to evaluate accuracy
+    const int minRounds{20};
+
+    struct SimulatedLocation
+    {
+        QSharedPointer<const Location> pLocation;
+        QHostAddress address;
+        double rtt;     // ms
+        double jitter;  // ms (standard deviation)
+        double loss;    // 0-1
+    };
+
+    std::chrono::microseconds cpuTime()
+    {
+#if defined(Q_OS_WIN)
+        FILETIME creation, exit, kernel, user;
+        if(!::GetProcessTimes(::GetCurrentProcess(), &creation, &exit, &kernel, &user))
+            return {};
+        auto toUs = [](const FILETIME &time)
+        {
+            ULARGE_INTEGER value;
+            value.LowPart = time.dwLowDateTime;
+            value.HighPart = time.dwHighDateTime;
+            return std::chrono::microseconds{value.QuadPart / 10};
+        };
+        return toUs(kernel) + toUs(user);
+#else
+        struct rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+            std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+#endif
+    }
+
+    // Create a location with one ICMP-pingable server
+    QSharedPointer<const Location> createLocation(int index, const kapps::core::Ipv4Address &ip)
+    {
+        auto pServiceGroup = std::make_shared<kapps::regions::ServiceGroup>(
+            std::vector<std::uint16_t>{}, false,
+            std::vector<std::uint16_t>{}, false,
+            std::vector<std::uint16_t>{1337}, false,
+            std::vector<std::uint16_t>{}, std::string{}, std::string{},
+            std::vector<std::uint16_t>{});
+        auto pServer = std::make_shared<kapps::regions::Server>(ip, "n/a",
+            std::string{}, pServiceGroup);
+        auto pRegion = std::make_shared<kapps::regions::Region>(
+            qs::format("sim-%", index), true, false, false,
+            kapps::core::Ipv4Address{},
+            std::vector<std::shared_ptr<const kapps::regions::Server>>{pServer});
+        return QSharedPointer<Location>::create(std::move(pRegion), nullable_t<double>{});
+    }
+}
+
+// BatchPinger that simulates each location's latency and loss
+class SimulatedPinger : public BatchPinger
+{
+    Q_OBJECT
+
+public:
+    SimulatedPinger(const std::vector<SimulatedLocation> &locations,
+                    PendingRepliesMap &pendingReplies, std::mt19937 &random)
+    {
+        std::uniform_real_distribution<double> lossDist{0.0, 1.0};
+        for(const auto &location : locations)
+        {
+            pendingReplies[HostPortKey{location.address, 0}] = location.pLocation->id();
+            if(lossDist(random) < location.loss)
+                continue;
+
+            std::normal_distribution<double> rttDist{location.rtt, location.jitter};
+            double rtt = std::max(1.0, rttDist(random));
+            std::chrono::microseconds roundtrip{static_cast<std::int64_t>(rtt * 1000.0)};
+            QHostAddress address{location.address};
+            QTimer::singleShot(static_cast<int>(rtt / timeScale), this,
+                [this, address, roundtrip]()
+                {
+                    emit receivedResponse(address, 0, roundtrip);
+                });
+        }
+    }
+};
+
+class bench_latencytracker : public QObject
+{
+    Q_OBJECT
+
+private:
+    std::vector<SimulatedLocation> _locations;
+    std::unordered_map<QString, LatencyHistory> _histories;
+    std::mt19937 _random;
+    int _wakeups;
+    int _replies;
+    int _rounds;
+    std::chrono::microseconds _cpuTime;
+
+    void setUpLocations(int count, double jitterRatio, double loss)
+    {
+        _locations.clear();
+        _histories.clear();
+        _random.seed(1);
+        std::uniform_real_distribution<double> rttDist{10.0, 300.0};
+        _locations.reserve(count);
+        for(int i = 0; i < count; ++i)
+        {
+            kapps::core::Ipv4Address ip{10, static_cast<std::uint8_t>(i >> 16),
+                                        static_cast<std::uint8_t>(i >> 8),
+                                        static_cast<std::uint8_t>(i)};
+            double rtt = rttDist(_random);
+            SimulatedLocation location{createLocation(i, ip),
+                                       QHostAddress{static_cast<quint32>(ip.address())},
+                                       rtt, rtt * jitterRatio, loss};
+            _histories.emplace(location.pLocation->id(), LatencyHistory{});
+            _locations.push_back(std::move(location));
+        }
+        _wakeups = 0;
+        _replies = 0;
+        _rounds = 0;
+        _cpuTime = {};
+    }
+
+    // Run one LatencyBatch over all locations until it completes
+    void runRound()
+    {
+        auto cpuStart = cpuTime();
+
+        PendingRepliesMap pendingReplies;
+        std::unique_ptr<BatchPinger> pPinger{new SimulatedPinger{_locations, pendingReplies, _random}};
+        // Wait long enough for any reply within about 4 standard deviations
+        double maxRtt{0.0};
+        for(const auto &location : _locations)
+            maxRtt = std::max(maxRtt, location.rtt + 4 * location.jitter);
+        std::chrono::milliseconds timeout{static_cast<int>(maxRtt / timeScale) + 20};
+
+        QEventLoop loop;
+        auto pBatch = new LatencyBatch{std::move(pPinger), std::move(pendingReplies),
+                                       timeout, nullptr};
+        connect(pBatch, &LatencyBatch::newMeasurements, this,
+            [this](const LatencyTracker::Latencies &measurements)
+            {
+                for(const auto &measurement : measurements)
+                    _histories[measurement.first].updateLatency(measurement.second);
+                _replies += static_cast<int>(measurements.size());
+            });
+        connect(pBatch, &LatencyBatch::lostMeasurements, this,
+            [this](const QStringList &locationIds)
+            {
+                for(const auto &id : locationIds)
+                    _histories[id].recordLoss();
+            });
+        connect(pBatch, &QObject::destroyed, &loop, &QEventLoop::quit);
+        auto wakeupConnection = connect(QAbstractEventDispatcher::instance(),
+                                        &QAbstractEventDispatcher::awake, this,
+                                        [this](){++_wakeups;});
+        loop.exec();
+        disconnect(wakeupConnection);
+
+        _cpuTime += cpuTime() - cpuStart;
+        ++_rounds;
+    }
+
+    void logResults()
+    {
+        // Compare the statistics to the configured distributions.  The
+        // simulated round trip times are clamped at 1ms, which is not
+        // significant for these distributions.
+        double meanError{0.0}, p95Error{0.0}, lossError{0.0};
+        for(const auto &location : _locations)
+        {
+            const auto &stats = _histories[location.pLocation->id()].statistics();
+            meanError += std::abs(stats.mean - location.rtt);
+            p95Error += std::abs(stats.p95 - (location.rtt + 1.645 * location.jitter));
+            lossError += std::abs(stats.lossRate - location.loss);
+        }
+        double count = static_cast<double>(_locations.size());
+        double cpuMs = _cpuTime.count() / 1000.0;
+
+        qInfo() << _rounds << "rounds";
+        qInfo() << "CPU time per round:" << (cpuMs / _rounds) << "ms";
+        qInfo() << "Wakeups per round:" << (static_cast<double>(_wakeups) / _rounds);
+        qInfo() << "Probe throughput:"
+            << (cpuMs > 0 ? _replies / (cpuMs / 1000.0) : 0.0) << "replies/CPU second";
+        qInfo() << "Mean error:" << (meanError / count) << "ms";
+        qInfo() << "P95 error:" << (p95Error / count) << "ms";
+        qInfo() << "Loss rate error:" << (lossError / count);
+    }
+
+private slots:
+    void benchMeasurements_data()
+    {
+        QTest::addColumn<int>("locations");
+        QTest::addColumn<double>("jitter");
+        QTest::addColumn<double>("loss");
+        QTest::newRow("100 stable") << 100 << 0.02 << 0.0;
+        QTest::newRow("100 jittery") << 100 << 0.2 << 0.0;
+        QTest::newRow("100 lossy") << 100 << 0.05 << 0.1;
+        QTest::newRow("1000 stable") << 1000 << 0.02 << 0.0;
+        QTest::newRow("1000 jittery lossy") << 1000 << 0.2 << 0.1;
+    }
+    void benchMeasurements()
+    {
+        QFETCH(int, locations);
+        QFETCH(double, jitter);
+        QFETCH(double, loss);
+        setUpLocations(locations, jitter, loss);
+
+        QBENCHMARK {runRound();}
+        while(_rounds < minRounds)
+            runRound();
+
+        logResults();
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_latencytracker)
+#include TEST_MOC
@@ -0,0 +1,107 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/linebuffer.h>
+#include <QtTest>
+
+/*
+
+=== LineBuffer benchmarks ===
+
+LineBuffer splits the output of helper processes (OpenVPN, WireGuard, etc.)
+into lines.  These feed 1 MiB of log-like output in chunks of various sizes,
+as it would be read from a pipe, with either the lineView() or lineComplete()
+signal connected.
+
+*/
+
+namespace
+{
+    const int totalSize{1024*1024};
+
+    // Log-like output - lines of varying length, some with CRLF line endings
+    QByteArray buildOutput()
+    {
+        QByteArray output;
+        output.reserve(totalSize + 200);
+        int line{0};
+        while(output.size() < totalSize)
+        {
+            output += "2024-01-01 00:00:00 MANAGEMENT: >STATE:1700000000,ASSIGN_IP,,10.0.0.";
+            output += QByteArray::number(line % 256);
+            output += QByteArray(line % 60, 'x');
+            output += (line % 4 == 0) ? "\r\n" : "\n";
+            ++line;
+        }
+        return output;
+    }
+}
+
+class bench_linebuffer : public QObject
+{
+    Q_OBJECT
+
+private:
+    QByteArray _output;
+
+private slots:
+    void initTestCase()
+    {
+        _output = buildOutput();
+    }
+
+    void benchAppend_data()
+    {
+        QTest::addColumn<int>("chunkSize");
+        QTest::addColumn<bool>("copies");
+        for(int chunkSize : {64, 4096, 65536})
+        {
+            QTest::addRow("%d view", chunkSize) << chunkSize << false;
+            QTest::addRow("%d copy", chunkSize) << chunkSize << true;
+        }
+    }
+    void benchAppend()
+    {
+        QFETCH(int, chunkSize);
+        QFETCH(bool, copies);
+
+        std::vector<QByteArray> chunks;
+        for(qsizetype pos = 0; pos < _output.size(); pos += chunkSize)
+            chunks.push_back(_output.mid(pos, chunkSize));
+
+        LineBuffer buffer;
+        qsizetype lineBytes{0};
+        if(copies)
+            connect(&buffer, &LineBuffer::lineComplete, this,
+                    [&](const QByteArray &line){lineBytes += line.size();});
+        else
+            connect(&buffer, &LineBuffer::lineView, this,
+                    [&](QByteArrayView line){lineBytes += line.size();});
+
+        QBENCHMARK
+        {
+            for(const auto &chunk : chunks)
+                buffer.append(chunk);
+        }
+        QVERIFY(lineBytes > 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_linebuffer)
+#include TEST_MOC
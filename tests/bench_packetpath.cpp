@@ -0,0 +1,376 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <kapps_net/src/mac/packet.h>
+#include <kapps_net/src/mac/flow_tracker.h>
+#include <QtTest>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <set>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/udp.h>
+
+/*
+
+=== Split tunnel packet path benchmarks ===
+
+These replay synthetic traffic through the per-packet work that the utun split
+tunnel does for each packet read from the tunnel device, without the device or
+the raw sockets, so they don't need root:
+- copy the packet into the receive buffer (as the utun read does)
+- Packet::createFromData() / Packet6::createFromData(), which also rewrites
+  the IPv4 header for re-injection
+- the verdict cache lookup, and classifying the flow by port on a miss
+- FlowTracker::track()
+
+The traffic is a set of TCP and UDP flows with random addresses and ports,
+interleaved round-robin so that flows beyond FlowTracker::WindowSize evict each
+other from the verdict cache.  The last packet of each TCP flow is a FIN.
+Classifying a flow on a cache miss only looks up the port in a small port set;
+the real engine also scans the socket tables, so misses are much more
+expensive in practice - the miss rate is logged to account for that.
+
+Each QBENCHMARK iteration replays the whole stream with fresh tracker and
+cache state.  After each data row, the harness logs packets per CPU second,
+allocations per packet, the verdict cache miss rate, and the fraction of
+packets that would be reinjected (FlowTracker drops a flow's packets after the
+first FlowTracker::MaxRepeatedFlows).
+
+Run with the usual QtTest options, such as "-median 5" or "-callgrind".
+
+*/
+
+namespace
+{
+    std::atomic<std::size_t> allocationCount{0};
+}
+
+// Count all allocations made by the process; the benchmark logs the count for
+// the packets processed.
+void *operator new(std::size_t size)
+{
+    ++allocationCount;
+    if(void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept {std::free(p);}
+void operator delete(void *p, std::size_t) noexcept {std::free(p);}
+
+namespace
+{
+    using Packet = kapps::net::Packet;
+    using Packet6 = kapps::net::Packet6;
+    using FlowTracker = kapps::net::FlowTracker;
+    using PacketFlow4 = kapps::net::PacketFlow4;
+    using PacketFlow6 = kapps::net::PacketFlow6;
+
+    // Size of the utun header (address family) before the IP header
+    const unsigned utunHeaderSize{4};
+
+    enum class Verdict
+    {
+        Bypass,
+        VpnOnly,
+        Default,
+    };
+
+    std::chrono::microseconds cpuTime()
+    {
+        struct rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+            std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+    }
+
+    // Build a utun packet - the utun header, IP header, TCP or UDP header,
+    // and payload.  The IPv4 header is in network order with a valid checksum,
+    // as it is when read from the utun device.
+    std::vector<unsigned char> buildPacket(std::mt19937 &random, bool ipv6,
+                                           std::uint8_t protocol,
+                                           std::uint16_t sport,
+                                           std::uint16_t dport,
+                                           std::size_t payloadSize)
+    {
+        std::size_t transportSize{protocol == IPPROTO_TCP ? sizeof(tcphdr) : sizeof(udphdr)};
+        std::size_t ipSize{ipv6 ? sizeof(ip6_hdr) : sizeof(ip)};
+        std::vector<unsigned char> data(utunHeaderSize + ipSize + transportSize + payloadSize);
+        for(std::size_t i = utunHeaderSize + ipSize + transportSize; i < data.size(); ++i)
+            data[i] = static_cast<unsigned char>(random());
+
+        std::uint32_t family = htonl(ipv6 ? AF_INET6 : AF_INET);
+        std::memcpy(data.data(), &family, sizeof(family));
+
+        unsigned char *pIpData = data.data() + utunHeaderSize;
+        if(ipv6)
+        {
+            ip6_hdr ipHdr{};
+            ipHdr.ip6_vfc = 0x60;
+            ipHdr.ip6_plen = htons(static_cast<std::uint16_t>(transportSize + payloadSize));
+            ipHdr.ip6_nxt = protocol;
+            ipHdr.ip6_hlim = 64;
+            // Source in fd00::/8 and destination in 2000::/3
+            ipHdr.ip6_src.s6_addr[0] = 0xFD;
+            ipHdr.ip6_dst.s6_addr[0] = 0x20;
+            for(int i = 1; i < 16; ++i)
+            {
+                ipHdr.ip6_src.s6_addr[i] = static_cast<std::uint8_t>(random());
+                ipHdr.ip6_dst.s6_addr[i] = static_cast<std::uint8_t>(random());
+            }
+            std::memcpy(pIpData, &ipHdr, sizeof(ipHdr));
+        }
+        else
+        {
+            ip ipHdr{};
+            ipHdr.ip_v = 4;
+            ipHdr.ip_hl = sizeof(ip) / 4;
+            ipHdr.ip_len = htons(static_cast<std::uint16_t>(ipSize + transportSize + payloadSize));
+            ipHdr.ip_off = htons(IP_DF);
+            ipHdr.ip_ttl = 64;
+            ipHdr.ip_p = protocol;
+            // Source in 10.0.0.0/8, and a unicast destination
+            ipHdr.ip_src.s_addr = htonl(0x0A000000 | (random() & 0x00FFFFFF));
+            ipHdr.ip_dst.s_addr = htonl(0x01000000 | (random() & 0x5EFFFFFF));
+            ipHdr.ip_sum = Packet::checksum(&ipHdr, sizeof(ipHdr));
+            std::memcpy(pIpData, &ipHdr, sizeof(ipHdr));
+        }
+
+        // The port fields are in the same place for TCP and UDP
+        unsigned char *pTransportData = pIpData + ipSize;
+        kapps::net::TransportPortHeader ports{htons(sport), htons(dport)};
+        std::memcpy(pTransportData, &ports, sizeof(ports));
+        if(protocol == IPPROTO_TCP)
+        {
+            tcphdr *pTcpHdr = reinterpret_cast<tcphdr*>(pTransportData);
+            pTcpHdr->th_off = sizeof(tcphdr) / 4;
+            pTcpHdr->th_flags = TH_ACK;
+        }
+        else
+        {
+            udphdr *pUdpHdr = reinterpret_cast<udphdr*>(pTransportData);
+            pUdpHdr->uh_ulen = htons(static_cast<std::uint16_t>(transportSize + payloadSize));
+        }
+        return data;
+    }
+
+    // The packet that ends a TCP flow; the FIN flag is at the same offset
+    // for either IP version
+    std::vector<unsigned char> finPacket(std::vector<unsigned char> data, bool ipv6)
+    {
+        std::size_t offset{utunHeaderSize + (ipv6 ? sizeof(ip6_hdr) : sizeof(ip))};
+        reinterpret_cast<tcphdr*>(data.data() + offset)->th_flags = TH_FIN | TH_ACK;
+        return data;
+    }
+}
+
+class bench_packetpath : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct SyntheticFlow
+    {
+        bool ipv6;
+        std::vector<unsigned char> packet;
+        // For TCP, the FIN that ends the flow; empty for UDP
+        std::vector<unsigned char> finPacket;
+    };
+
+    std::vector<SyntheticFlow> _flows;
+    // The packets to replay, in order - pointers into _flows
+    std::vector<const std::vector<unsigned char>*> _stream;
+    std::set<std::uint16_t> _bypassPorts, _vpnOnlyPorts;
+    std::vector<unsigned char> _receiveBuffer;
+    std::size_t _packets, _allocations, _misses, _reinjected;
+    int _rounds;
+    std::chrono::microseconds _cpuTime;
+
+    void setUpTraffic(int flows, int packetsPerFlow, int ipv6Percent,
+                      int tcpPercent, int payloadSize)
+    {
+        std::mt19937 random{1};
+        std::uniform_int_distribution<int> percentDist{0, 99};
+        std::uniform_int_distribution<int> portDist{49152, 65535};
+
+        _flows.clear();
+        _flows.reserve(flows);
+        _bypassPorts.clear();
+        _vpnOnlyPorts.clear();
+        for(int i = 0; i < flows; ++i)
+        {
+            bool ipv6 = percentDist(random) < ipv6Percent;
+            bool tcp = percentDist(random) < tcpPercent;
+            auto sport = static_cast<std::uint16_t>(portDist(random));
+            std::uint16_t dport = tcp ? 443 : 53;
+            SyntheticFlow flow{ipv6, buildPacket(random, ipv6,
+                                                 tcp ? IPPROTO_TCP : IPPROTO_UDP,
+                                                 sport, dport,
+                                                 static_cast<std::size_t>(payloadSize)),
+                               {}};
+            if(tcp)
+                flow.finPacket = finPacket(flow.packet, ipv6);
+            _flows.push_back(std::move(flow));
+
+            // A quarter of the flows belong to bypass apps and a quarter to
+            // VPN-only apps
+            switch(i % 4)
+            {
+                case 0:
+                    _bypassPorts.insert(sport);
+                    break;
+                case 1:
+                    _vpnOnlyPorts.insert(sport);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        _stream.clear();
+        _stream.reserve(static_cast<std::size_t>(flows) * packetsPerFlow);
+        for(int p = 0; p < packetsPerFlow; ++p)
+        {
+            for(const auto &flow : _flows)
+            {
+                if(p == packetsPerFlow - 1 && !flow.finPacket.empty())
+                    _stream.push_back(&flow.finPacket);
+                else
+                    _stream.push_back(&flow.packet);
+            }
+        }
+
+        _receiveBuffer.resize(utunHeaderSize + sizeof(ip6_hdr) + sizeof(tcphdr) + payloadSize);
+        _packets = 0;
+        _allocations = 0;
+        _misses = 0;
+        _reinjected = 0;
+        _rounds = 0;
+        _cpuTime = {};
+    }
+
+    Verdict classify(std::uint16_t sourcePort)
+    {
+        ++_misses;
+        if(_bypassPorts.count(sourcePort))
+            return Verdict::Bypass;
+        if(_vpnOnlyPorts.count(sourcePort))
+            return Verdict::VpnOnly;
+        return Verdict::Default;
+    }
+
+    // Look up or classify the packet's flow and track it, as
+    // MacSplitTunnel::handleIp4() does.  Returns true if the packet would be
+    // reinjected.
+    template<class FlowType, class PacketType>
+    bool processPacket(const PacketType &packet, FlowTracker &tracker,
+                       kapps::net::FlowCache<Verdict> &verdicts)
+    {
+        FlowType flow{packet};
+        if(!verdicts.find(flow))
+        {
+            Verdict verdict = classify(packet.sourcePort());
+            if(!packet.isTcpClosing())
+                verdicts.insert(flow, verdict);
+        }
+        else if(packet.isTcpClosing())
+            verdicts.erase(flow);
+
+        return tracker.track(flow) != FlowTracker::RepeatedFlow;
+    }
+
+    void runRound()
+    {
+        FlowTracker tracker;
+        kapps::net::FlowCache<Verdict> verdicts;
+
+        auto cpuStart = cpuTime();
+        std::size_t allocationsStart = allocationCount;
+        for(const auto *pData : _stream)
+        {
+            std::memcpy(_receiveBuffer.data(), pData->data(), pData->size());
+            kapps::core::ArraySlice<unsigned char> buffer{_receiveBuffer.data(),
+                                                          pData->size()};
+            std::uint32_t family;
+            std::memcpy(&family, buffer.data(), sizeof(family));
+            bool reinject{false};
+            if(ntohl(family) == AF_INET6)
+            {
+                if(auto pPacket = Packet6::createFromData(buffer, utunHeaderSize))
+                    reinject = processPacket<PacketFlow6>(*pPacket, tracker, verdicts);
+            }
+            else if(auto pPacket = Packet::createFromData(buffer, utunHeaderSize))
+                reinject = processPacket<PacketFlow4>(*pPacket, tracker, verdicts);
+            if(reinject)
+                ++_reinjected;
+        }
+        _allocations += allocationCount - allocationsStart;
+        _cpuTime += cpuTime() - cpuStart;
+        _packets += _stream.size();
+        ++_rounds;
+    }
+
+    void logResults()
+    {
+        double cpuSec = _cpuTime.count() / 1000000.0;
+        double packets = static_cast<double>(_packets);
+        qInfo() << _rounds << "rounds of" << _stream.size() << "packets";
+        qInfo() << "Throughput:" << (cpuSec > 0 ? packets / cpuSec : 0.0)
+            << "packets/CPU second";
+        qInfo() << "Allocations per packet:" << (_allocations / packets);
+        qInfo() << "Verdict cache miss rate:" << (_misses / packets);
+        qInfo() << "Reinjected:" << (_reinjected / packets);
+    }
+
+private slots:
+    void benchPacketPath_data()
+    {
+        QTest::addColumn<int>("flows");
+        QTest::addColumn<int>("packetsPerFlow");
+        QTest::addColumn<int>("ipv6Percent");
+        QTest::addColumn<int>("tcpPercent");
+        QTest::addColumn<int>("payloadSize");
+        QTest::newRow("16 flows") << 16 << 64 << 0 << 80 << 512;
+        QTest::newRow("256 flows") << 256 << 16 << 0 << 80 << 512;
+        QTest::newRow("256 flows IPv6") << 256 << 16 << 50 << 80 << 512;
+        QTest::newRow("256 flows small packets") << 256 << 16 << 0 << 80 << 0;
+        QTest::newRow("256 flows full packets") << 256 << 16 << 0 << 80 << 1400;
+        // More flows than FlowTracker::WindowSize, most lookups miss
+        QTest::newRow("4096 flows") << 4096 << 4 << 25 << 80 << 512;
+    }
+    void benchPacketPath()
+    {
+        QFETCH(int, flows);
+        QFETCH(int, packetsPerFlow);
+        QFETCH(int, ipv6Percent);
+        QFETCH(int, tcpPercent);
+        QFETCH(int, payloadSize);
+        setUpTraffic(flows, packetsPerFlow, ipv6Percent, tcpPercent, payloadSize);
+
+        QBENCHMARK {runRound();}
+
+        logResults();
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_packetpath)
+#include TEST_MOC
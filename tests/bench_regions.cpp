@@ -0,0 +1,273 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/json.h>
+#include <common/src/locations.h>
+#include <kapps_regions/src/regionlist.h>
+#include <kapps_regions/src/metadata.h>
+#include "src/regionscorpus.h"
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+/*
+
+=== Regions benchmarks ===
+
+These measure the cost of parsing the regions lists and building locations,
+which happens for each regions list refresh and latency update.  They replay
+the recorded regions list and metadata from tests/res at 1x, 5x, and 20x their
+recorded size (the regions are duplicated with new IDs).
+
+benchAdaptJson compares converting the regions list between Qt JSON and
+nlohmann::json directly to the JSON text round trip that was used previously.
+
+For each step, QBENCHMARK reports the time, and the allocation count for one
+run is logged.  The peak RSS of the process is logged after each data row; it
+only increases, so compare the same row between runs.
+
+Run with the usual QtTest options, such as "-median 5" or "-callgrind".
+
+*/
+
+namespace
+{
+    std::atomic<std::size_t> allocationCount{0};
+}
+
+// Count all allocations made by the process; the benchmarks log the count for
+// the operation being measured.
+void *operator new(std::size_t size)
+{
+    ++allocationCount;
+    if(void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept {std::free(p);}
+void operator delete(void *p, std::size_t) noexcept {std::free(p);}
+
+namespace
+{
+    std::size_t peakRssKiB()
+    {
+#if defined(Q_OS_WIN)
+        PROCESS_MEMORY_COUNTERS counters{};
+        if(::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.PeakWorkingSetSize / 1024;
+        return 0;
+#else
+        struct rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+    #if defined(Q_OS_MACOS)
+        return static_cast<std::size_t>(usage.ru_maxrss) / 1024; // bytes
+    #else
+        return static_cast<std::size_t>(usage.ru_maxrss);    // KiB
+    #endif
+#endif
+    }
+
+    // Run a function once and log the number of allocations it made
+    template<class Func>
+    void logAllocations(const char *step, Func func)
+    {
+        std::size_t before = allocationCount;
+        func();
+        qInfo() << step << "-" << (allocationCount - before) << "allocations";
+    }
+}
+
+class bench_regions : public QObject
+{
+    Q_OBJECT
+
+private:
+    QJsonObject _regionsObj, _metadataObj;
+
+    void addScaleRows()
+    {
+        QTest::addColumn<int>("scale");
+        QTest::newRow("1x") << 1;
+        QTest::newRow("5x") << 5;
+        QTest::newRow("20x") << 20;
+    }
+
+    QJsonObject scaledRegions()
+    {
+        QFETCH(int, scale);
+        return RegionsCorpus::scaleRegions(_regionsObj, scale);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        _regionsObj = RegionsCorpus::regions();
+        _metadataObj = RegionsCorpus::metadata();
+        QVERIFY(!_regionsObj.isEmpty());
+        QVERIFY(!_metadataObj.isEmpty());
+    }
+
+    void cleanup()
+    {
+        qInfo() << "Peak RSS:" << peakRssKiB() << "KiB";
+    }
+
+    void benchRegionList_data() {addScaleRows();}
+    void benchRegionList()
+    {
+        QByteArray regionsJson = QJsonDocument{scaledRegions()}.toJson();
+        auto parse = [&]
+        {
+            kapps::regions::RegionList regionList{kapps::regions::RegionList::PIAv6,
+                                                  regionsJson.data(), {}, {}, {}};
+            QVERIFY(!regionList.regions().empty());
+        };
+        logAllocations("RegionList", parse);
+        QBENCHMARK {parse();}
+    }
+
+    void benchMetadata_data() {addScaleRows();}
+    void benchMetadata()
+    {
+        QByteArray regionsJson = QJsonDocument{scaledRegions()}.toJson();
+        QByteArray metadataJson = QJsonDocument{_metadataObj}.toJson();
+        auto parse = [&]
+        {
+            kapps::regions::Metadata metadata{regionsJson.data(),
+                                              metadataJson.data(), {}, {}};
+            QVERIFY(!metadata.regionDisplays().empty());
+        };
+        logAllocations("Metadata", parse);
+        QBENCHMARK {parse();}
+    }
+
+    // Converting the regions list between Qt JSON and nlohmann::json, like the
+    // daemon's state and clientjson serializers do
+    void benchAdaptJson_data()
+    {
+        QTest::addColumn<int>("scale");
+        QTest::addColumn<bool>("direct");
+        for(int scale : {1, 5, 20})
+        {
+            QTest::addRow("%dx text", scale) << scale << false;
+            QTest::addRow("%dx direct", scale) << scale << true;
+        }
+    }
+    void benchAdaptJson()
+    {
+        QFETCH(bool, direct);
+        QJsonObject regionsObj = scaledRegions();
+        auto adapt = [&]
+        {
+            nlohmann::json nlj;
+            QJsonObject qt;
+            if(direct)
+            {
+                nlj = adaptQtToNlj<nlohmann::json>(regionsObj);
+                qt = adaptNljToQt(nlj);
+            }
+            else
+            {
+                QByteArray qtText = QJsonDocument{regionsObj}.toJson();
+                nlj = nlohmann::json::parse(qtText.begin(), qtText.end());
+                qt = adaptJsonTextToQJsonObject(nlj.dump());
+            }
+            QCOMPARE(qt.size(), regionsObj.size());
+        };
+        logAllocations(direct ? "Adapt JSON (direct)" : "Adapt JSON (text)", adapt);
+        QBENCHMARK {adapt();}
+    }
+
+    // Building locations from the lists, as the daemon does when a list is
+    // refreshed
+    void benchBuildLocations_data() {addScaleRows();}
+    void benchBuildLocations()
+    {
+        QJsonObject regionsObj = scaledRegions();
+        LatencyMap latencies = RegionsCorpus::buildLatencies(regionsObj);
+        auto build = [&]
+        {
+            auto locations = buildModernLocations(latencies, regionsObj, {},
+                                                  _metadataObj, {}, {});
+            QVERIFY(!locations.first.empty());
+        };
+        logAllocations("Build locations", build);
+        QBENCHMARK {build();}
+    }
+
+    // Building locations from the regions image, as the daemon does for
+    // latency updates
+    void benchBuildLocationsFromImage_data() {addScaleRows();}
+    void benchBuildLocationsFromImage()
+    {
+        QJsonObject regionsObj = scaledRegions();
+        LatencyMap latencies = RegionsCorpus::buildLatencies(regionsObj);
+        QByteArray image;
+        QString imageTag;
+        buildModernLocations(latencies, regionsObj, {}, _metadataObj, {}, {},
+                             &image, &imageTag);
+        qInfo() << "Regions image:" << image.size() << "bytes";
+        auto build = [&]
+        {
+            auto locations = buildModernLocationsFromImage(latencies, image,
+                                                           imageTag, {}, {});
+            QVERIFY(!locations.first.empty());
+        };
+        logAllocations("Build locations from image", build);
+        QBENCHMARK {build();}
+    }
+
+    // Indexing the locations and selecting the best locations, as the daemon
+    // does when latencies change
+    void benchNearestLocations_data() {addScaleRows();}
+    void benchNearestLocations()
+    {
+        QJsonObject regionsObj = scaledRegions();
+        auto locations = buildModernLocations(RegionsCorpus::buildLatencies(regionsObj),
+                                              regionsObj, {}, _metadataObj,
+                                              {}, {});
+        auto select = [&]
+        {
+            NearestLocations nearest{locations.first};
+            QVERIFY(nearest.getNearestSafeVpnLocation(true));
+            nearest.getBestLocationForService(Service::Shadowsocks);
+            QVERIFY(nearest.getBestMatchingLocation([](const Location &loc)
+                {
+                    return loc.id().startsWith(QStringLiteral("us"));
+                }));
+        };
+        logAllocations("NearestLocations", select);
+        QBENCHMARK {select();}
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_regions)
+#include TEST_MOC
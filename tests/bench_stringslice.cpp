@@ -0,0 +1,125 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <kapps_core/src/stringslice.h>
+#include <QtTest>
+#include <string>
+
+/*
+
+=== StringSlice benchmarks ===
+
+StringSlice searches are the inner loops of the JSON, WireGuard UAPI, and
+/proc parsers.  These scan a 256 KiB UAPI-like "key=value" dump for
+characters, substrings, and character sets, and split it into lines.
+
+*/
+
+namespace
+{
+    std::string buildUapiDump()
+    {
+        std::string dump;
+        int peer{0};
+        while(dump.size() < 256*1024)
+        {
+            dump += "public_key=";
+            dump += std::string(64, static_cast<char>('a' + peer % 6));
+            dump += "\nendpoint=10.0.";
+            dump += std::to_string(peer % 256);
+            dump += ".1:1337\nlast_handshake_time_sec=1700000000\n"
+                    "rx_bytes=123456789\ntx_bytes=987654321\n"
+                    "persistent_keepalive_interval=25\n"
+                    "allowed_ip=0.0.0.0/0\n";
+            ++peer;
+        }
+        dump += "errno=0\n";
+        return dump;
+    }
+}
+
+class bench_stringslice : public QObject
+{
+    Q_OBJECT
+
+private:
+    std::string _dump;
+
+private slots:
+    void initTestCase()
+    {
+        _dump = buildUapiDump();
+    }
+
+    // Find each line break, like the UAPI parser
+    void benchFindChar()
+    {
+        kapps::core::StringSlice dump{_dump};
+        std::size_t lines{0};
+        QBENCHMARK
+        {
+            lines = 0;
+            for(std::size_t pos = dump.find('\n'); pos != kapps::core::StringSlice::npos;
+                pos = dump.find('\n', pos+1))
+            {
+                ++lines;
+            }
+        }
+        QVERIFY(lines > 0);
+    }
+
+    // Find a key that only occurs at the end
+    void benchFindSubstring()
+    {
+        kapps::core::StringSlice dump{_dump};
+        std::size_t pos{};
+        QBENCHMARK
+        {
+            pos = dump.find("errno=");
+        }
+        QVERIFY(pos != kapps::core::StringSlice::npos);
+    }
+
+    // Find the first character that isn't a key character
+    void benchFindFirstNotOf()
+    {
+        kapps::core::StringSlice dump{_dump};
+        kapps::core::StringSlice keyChars{"abcdefghijklmnopqrstuvwxyz_=\n0123456789.:/"};
+        std::size_t pos{};
+        QBENCHMARK
+        {
+            pos = dump.find_first_not_of(keyChars);
+        }
+        QCOMPARE(pos, kapps::core::StringSlice::npos);
+    }
+
+    void benchSplit()
+    {
+        kapps::core::StringSlice dump{_dump};
+        std::size_t count{};
+        QBENCHMARK
+        {
+            count = dump.split('\n').size();
+        }
+        QVERIFY(count > 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_stringslice)
+#include TEST_MOC
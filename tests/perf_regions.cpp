@@ -0,0 +1,186 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/locations.h>
+#include <kapps_regions/src/regionlist.h>
+#include <kapps_regions/src/metadata.h>
+#include "src/regionscorpus.h"
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <limits>
+
+/*
+
+=== Regions performance tests ===
+
+These catch performance regressions in the regions pipeline - the work done by
+the daemon for each regions list refresh and latency update.  Unlike the
+benchmarks (bench_regions.cpp), which just report the times, each step here
+has a time budget and the test fails if the step exceeds it.
+
+The budgets are generous (several times the time observed in a debug build) so
+they only fail for real regressions, like an accidentally quadratic step, not
+for ordinary machine noise.  Each step takes the best of several runs to reduce
+noise further.  On slow machines (emulation, sanitizers, etc.), scale all the
+budgets with PERF_BUDGET_SCALE, such as PERF_BUDGET_SCALE=4.
+
+The corpus is the recorded regions list from tests/res at 1x and 20x its size.
+
+*/
+
+namespace
+{
+    const int runs = 5;
+
+    double budgetScale()
+    {
+        bool ok{false};
+        double scale = qEnvironmentVariable("PERF_BUDGET_SCALE").toDouble(&ok);
+        return (ok && scale > 0) ? scale : 1.0;
+    }
+
+    // Run func several times and return the best time in milliseconds
+    template<class Func>
+    double bestMsec(Func func)
+    {
+        qint64 bestNsec{std::numeric_limits<qint64>::max()};
+        for(int i = 0; i < runs; ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            func();
+            bestNsec = std::min(bestNsec, timer.nsecsElapsed());
+        }
+        return static_cast<double>(bestNsec) / 1000000.0;
+    }
+}
+
+// Check the best time of a step against its budget (in milliseconds, per the
+// scale factor in the data row)
+#define VERIFY_BUDGET(step, budgetPerScaleMsec, func) \
+    do { \
+        QFETCH(int, scale); \
+        double budget = (budgetPerScaleMsec) * scale * budgetScale(); \
+        double msec = bestMsec(func); \
+        qInfo() << step << "-" << msec << "ms, budget" << budget << "ms"; \
+        QVERIFY2(msec <= budget, qPrintable(QStringLiteral("%1 took %2 ms, budget is %3 ms") \
+            .arg(QLatin1String{step}).arg(msec).arg(budget))); \
+    } while(false)
+
+class perf_regions : public QObject
+{
+    Q_OBJECT
+
+private:
+    QJsonObject _regionsObj, _metadataObj;
+
+    void addScaleRows()
+    {
+        QTest::addColumn<int>("scale");
+        QTest::newRow("1x") << 1;
+        QTest::newRow("20x") << 20;
+    }
+
+    QJsonObject scaledRegions()
+    {
+        QFETCH(int, scale);
+        return RegionsCorpus::scaleRegions(_regionsObj, scale);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        _regionsObj = RegionsCorpus::regions();
+        _metadataObj = RegionsCorpus::metadata();
+        QVERIFY(!_regionsObj.isEmpty());
+        QVERIFY(!_metadataObj.isEmpty());
+        qInfo() << "Budget scale:" << budgetScale();
+    }
+
+    void perfRegionList_data() {addScaleRows();}
+    void perfRegionList()
+    {
+        QByteArray regionsJson = QJsonDocument{scaledRegions()}.toJson();
+        VERIFY_BUDGET("RegionList", 50.0, [&]
+            {
+                kapps::regions::RegionList regionList{kapps::regions::RegionList::PIAv6,
+                                                      regionsJson.data(), {}, {}, {}};
+            });
+    }
+
+    void perfMetadata_data() {addScaleRows();}
+    void perfMetadata()
+    {
+        QByteArray regionsJson = QJsonDocument{scaledRegions()}.toJson();
+        QByteArray metadataJson = QJsonDocument{_metadataObj}.toJson();
+        VERIFY_BUDGET("Metadata", 50.0, [&]
+            {
+                kapps::regions::Metadata metadata{regionsJson.data(),
+                                                  metadataJson.data(), {}, {}};
+            });
+    }
+
+    void perfBuildLocations_data() {addScaleRows();}
+    void perfBuildLocations()
+    {
+        QJsonObject regionsObj = scaledRegions();
+        LatencyMap latencies = RegionsCorpus::buildLatencies(regionsObj);
+        VERIFY_BUDGET("Build locations", 100.0, [&]
+            {
+                buildModernLocations(latencies, regionsObj, {}, _metadataObj,
+                                     {}, {});
+            });
+    }
+
+    void perfBuildLocationsFromImage_data() {addScaleRows();}
+    void perfBuildLocationsFromImage()
+    {
+        QJsonObject regionsObj = scaledRegions();
+        LatencyMap latencies = RegionsCorpus::buildLatencies(regionsObj);
+        QByteArray image;
+        QString imageTag;
+        buildModernLocations(latencies, regionsObj, {}, _metadataObj, {}, {},
+                             &image, &imageTag);
+        VERIFY_BUDGET("Build locations from image", 40.0, [&]
+            {
+                buildModernLocationsFromImage(latencies, image, imageTag, {}, {});
+            });
+    }
+
+    void perfNearestLocations_data() {addScaleRows();}
+    void perfNearestLocations()
+    {
+        QJsonObject regionsObj = scaledRegions();
+        auto locations = buildModernLocations(RegionsCorpus::buildLatencies(regionsObj),
+                                              regionsObj, {}, _metadataObj,
+                                              {}, {});
+        VERIFY_BUDGET("NearestLocations", 5.0, [&]
+            {
+                NearestLocations nearest{locations.first};
+                nearest.getNearestSafeVpnLocation(true);
+                nearest.getBestLocationForService(Service::Shadowsocks);
+            });
+    }
+};
+
+QTEST_GUILESS_MAIN(perf_regions)
+#include TEST_MOC
@@ -59,6 +59,16 @@ public:
         QTimer::singleShot(0, this, &MockNetworkReply::finished);
     }
 
+    // Set the HTTP status or a header of the reply
+    void setStatus(int status)
+    {
+        setAttribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute, status);
+    }
+    void setHeader(const QByteArray &name, const QByteArray &value)
+    {
+        setRawHeader(name, value);
+    }
+
 protected:
     virtual qint64 readData(char *data, qint64 maxlen) override
     {
@@ -0,0 +1,74 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line SOURCE_FILE("regionscorpus.cpp")
+
+#include "regionscorpus.h"
+#include "testresource.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+
+namespace RegionsCorpus
+{
+    QJsonObject regions()
+    {
+        return QJsonDocument::fromJson(TestResource::load(QStringLiteral(":/regions-v6.json"))).object();
+    }
+
+    QJsonObject metadata()
+    {
+        return QJsonDocument::fromJson(TestResource::load(QStringLiteral(":/metadata-v2.json"))).object();
+    }
+
+    QJsonObject scaleRegions(const QJsonObject &regionsObj, int scale)
+    {
+        QJsonObject scaled{regionsObj};
+        const auto &regions = regionsObj[QStringLiteral("regions")].toArray();
+        QJsonArray scaledRegions;
+        for(int i = 0; i < scale; ++i)
+        {
+            for(const auto &region : regions)
+            {
+                QJsonObject scaledRegion{region.toObject()};
+                if(i > 0)
+                {
+                    const QString &id = scaledRegion[QStringLiteral("id")].toString();
+                    scaledRegion[QStringLiteral("id")] = id + QStringLiteral("_%1").arg(i);
+                }
+                scaledRegions.push_back(scaledRegion);
+            }
+        }
+        scaled[QStringLiteral("regions")] = scaledRegions;
+        return scaled;
+    }
+
+    LatencyMap buildLatencies(const QJsonObject &regionsObj)
+    {
+        LatencyMap latencies;
+        double latency = 10.0;
+        for(const auto &region : regionsObj[QStringLiteral("regions")].toArray())
+        {
+            latencies.emplace(region.toObject()[QStringLiteral("id")].toString(), latency);
+            latency += 7.5;
+            if(latency > 400.0)
+                latency -= 390.0;
+        }
+        return latencies;
+    }
+}
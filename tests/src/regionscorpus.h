@@ -0,0 +1,46 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#line HEADER_FILE("regionscorpus.h")
+
+#ifndef REGIONSCORPUS_H
+#define REGIONSCORPUS_H
+
+#include <common/src/settings/locations.h>
+#include <QJsonObject>
+
+// The regions corpus is the recorded regions list and metadata from tests/res,
+// which are real-size payloads.  The regions list can be enlarged
+// synthetically to test larger infrastructures.  This is shared by the regions
+// benchmarks, perf tests, and fuzz tests.
+namespace RegionsCorpus
+{
+    // The recorded regions list (regions-v6.json) and metadata
+    // (metadata-v2.json)
+    QJsonObject regions();
+    QJsonObject metadata();
+
+    // Scale the regions list by duplicating each region with new IDs
+    QJsonObject scaleRegions(const QJsonObject &regionsObj, int scale);
+
+    // Give each region a latency so the locations are ordered as usual
+    LatencyMap buildLatencies(const QJsonObject &regionsObj);
+}
+
+#endif
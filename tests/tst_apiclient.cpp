@@ -199,6 +199,38 @@ private slots:
         emit pGetReply->finished();
         QVERIFY(TestData::checkSuccessPort(getSpy));
     }
+
+    // Identical GETs in flight share one request, and a cached response is
+    // reused without sending a request.
+    void testSharedGet()
+    {
+        auto pReply = MockNetworkManager::enqueueReply(TestData::success);
+        TestApiClient client;
+        QSignalSpy consumeSpy{&MockNetworkManager::_replyConsumed, &ReplyConsumedSignal::signal};
+
+        CallbackSpy resultSpy1, resultSpy2;
+        client.getRetry(*client.getApiv1(), TestData::status,
+                        TestData::passwordAuth(), std::chrono::seconds{10})
+            ->notify(&resultSpy1, resultSpy1.callback());
+        client.getRetry(*client.getApiv1(), TestData::status,
+                        TestData::passwordAuth(), std::chrono::seconds{10})
+            ->notify(&resultSpy2, resultSpy2.callback());
+        QVERIFY(consumeSpy.wait(100));
+        QTest::qWait(10);
+        QCOMPARE(consumeSpy.size(), 1);
+
+        emit pReply->finished();
+        QVERIFY(TestData::checkSuccessPort(resultSpy1));
+        QVERIFY(TestData::checkSuccessPort(resultSpy2));
+
+        // The response is still cached, so this doesn't send a request
+        CallbackSpy resultSpy3;
+        client.getRetry(*client.getApiv1(), TestData::status,
+                        TestData::passwordAuth(), std::chrono::seconds{10})
+            ->notify(&resultSpy3, resultSpy3.callback());
+        QTRY_VERIFY_WITH_TIMEOUT(TestData::checkSuccessPort(resultSpy3), 100);
+        QCOMPARE(consumeSpy.size(), 1);
+    }
 };
 
 QTEST_GUILESS_MAIN(tst_apiclient)
@@ -16,7 +16,7 @@
 // along with the Private Internet Access Desktop Client.  If not, see
 // <https://www.gnu.org/licenses/>.
 
-#include <kapps_net/src/mac/flow_tracker.h>
+#include <kapps_net/src/constrainedhash.h>
 #include <QtTest>
 
 template<class K, class V>
@@ -68,6 +68,79 @@ private slots:
         }
     }
 
+    void testLeastRecentlyUsed()
+    {
+        {
+            // at() refreshes an entry
+            ConstrainedHash<std::string, int> ch{2};
+            ch.insert({"foo", 1});
+            ch.insert({"bar", 2});
+            QCOMPARE(ch.at("foo"), 1);
+            ch.insert({"baz", 3});
+
+            QCOMPARE(ch.contains("foo"), true);
+            QCOMPARE(ch.contains("bar"), false);
+            QCOMPARE(ch.contains("baz"), true);
+        }
+
+        {
+            // Re-inserting replaces the value and refreshes the entry, without
+            // adding a second entry for the key
+            ConstrainedHash<std::string, int> ch{2};
+            ch.insert({"foo", 1});
+            ch.insert({"bar", 2});
+            ch.insert({"foo", 10});
+            QCOMPARE(ch.size(), 2);
+            ch.insert({"baz", 3});
+
+            QCOMPARE(ch.size(), 2);
+            QCOMPARE(ch.at("foo"), 10);
+            QCOMPARE(ch.contains("bar"), false);
+            QCOMPARE(ch.at("baz"), 3);
+        }
+
+        {
+            // Many evictions through a larger table keep every remaining
+            // entry reachable
+            ConstrainedHash<int, int> ch{64};
+            for(int i = 0; i < 1000; ++i)
+                ch.insert({i, i * 2});
+
+            QCOMPARE(ch.size(), 64);
+            for(int i = 0; i < 1000 - 64; ++i)
+                QCOMPARE(ch.contains(i), false);
+            for(int i = 1000 - 64; i < 1000; ++i)
+                QCOMPARE(ch.at(i), i * 2);
+        }
+    }
+
+    void testErase()
+    {
+        ConstrainedHash<std::string, int> ch{3};
+        ch.insert({"foo", 1});
+        ch.insert({"bar", 2});
+        ch.insert({"baz", 3});
+
+        QCOMPARE(ch.erase("bar"), true);
+        QCOMPARE(ch.erase("bar"), false);
+        QCOMPARE(ch.size(), 2);
+        QCOMPARE(ch.contains("bar"), false);
+        QCOMPARE(ch.find("bar"), nullptr);
+        QCOMPARE(*ch.find("foo"), 1);
+        QCOMPARE(*ch.find("baz"), 3);
+
+        // The erased entry's space is used before anything is evicted
+        ch.insert({"qux", 4});
+        QCOMPARE(ch.size(), 3);
+        QCOMPARE(ch.contains("foo"), true);
+
+        ch.clear();
+        QCOMPARE(ch.size(), 0);
+        QCOMPARE(ch.contains("foo"), false);
+        ch.insert({"foo", 5});
+        QCOMPARE(ch.at("foo"), 5);
+    }
+
     void testContains()
     {
         {
@@ -0,0 +1,131 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include <kapps_core/logger.h>
+#include <kapps_core/src/logger.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const kapps::core::LogCategory testCategory{KAPPS_CORE_LOG_FILE, "loggertest"};
+    const kapps::core::LogCategory otherCategory{KAPPS_CORE_LOG_FILE, "loggertest.other"};
+
+    KACStringSlice testModuleName()
+    {
+        if(!testCategory.module())
+            return {};
+        return kapps::core::toApi(testCategory.module()->name());
+    }
+
+    // Collects the messages delivered to a batched callback
+    struct BatchSink
+    {
+        static void writeBatch(void *pContext, const KACLogMessage *pMessages,
+                               size_t count)
+        {
+            auto &sink = *reinterpret_cast<BatchSink*>(pContext);
+            std::lock_guard<std::mutex> lock{sink.mutex};
+            sink.batchSizes.push_back(count);
+            for(size_t i=0; i<count; ++i)
+                sink.messages.push_back(pMessages[i].pMessage);
+        }
+
+        std::mutex mutex;
+        std::vector<size_t> batchSizes;
+        std::vector<std::string> messages;
+    };
+}
+
+class tst_core_logger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init()
+    {
+        KACEnableLogging(true);
+    }
+
+    void cleanup()
+    {
+        KACLogClearCategoryLevels();
+        // Removing the callback also delivers anything still queued
+        KACLogInit(nullptr);
+    }
+
+    void testBatchedDelivery()
+    {
+        BatchSink sink;
+        KACLogBatchCallback callback{&sink, &BatchSink::writeBatch, 4, 10};
+        KACLogInitBatched(&callback);
+
+        for(int i=0; i<10; ++i)
+            KAPPS_CORE_INFO_CATEGORY(testCategory) << "message" << i;
+
+        // Replacing the callback delivers everything queued for it
+        KACLogInit(nullptr);
+
+        QCOMPARE(sink.messages.size(), size_t{10});
+        for(int i=0; i<10; ++i)
+            QCOMPARE(sink.messages[i], "message " + std::to_string(i));
+        QVERIFY(sink.batchSizes.size() >= 3);
+        for(size_t batchSize : sink.batchSizes)
+            QVERIFY(batchSize > 0 && batchSize <= 4);
+    }
+
+    void testCategoryLevel()
+    {
+        BatchSink sink;
+        KACLogBatchCallback callback{&sink, &BatchSink::writeBatch, 0, 0};
+        KACLogInitBatched(&callback);
+
+        KACLogSetCategoryLevel(testModuleName(), kapps::core::toApi(testCategory.name()),
+                               KAPPS_CORE_LOG_MESSAGE_LEVEL_WARNING);
+        KAPPS_CORE_INFO_CATEGORY(testCategory) << "filtered";
+        KAPPS_CORE_WARNING_CATEGORY(testCategory) << "warning";
+        KAPPS_CORE_INFO_CATEGORY(otherCategory) << "other";
+
+        // Removing the level logs the category normally again
+        KACLogSetCategoryLevel(testModuleName(), kapps::core::toApi(testCategory.name()), -1);
+        KAPPS_CORE_INFO_CATEGORY(testCategory) << "unfiltered";
+
+        KACLogInit(nullptr);
+        QCOMPARE(sink.messages, (std::vector<std::string>{"warning", "other", "unfiltered"}));
+    }
+
+    // A category's own level takes precedence over its module's level
+    void testModuleLevel()
+    {
+        KACLogSetCategoryLevel(testModuleName(), {}, KAPPS_CORE_LOG_MESSAGE_LEVEL_ERROR);
+        KACLogSetCategoryLevel(testModuleName(), kapps::core::toApi(otherCategory.name()),
+                               KAPPS_CORE_LOG_MESSAGE_LEVEL_DEBUG);
+
+        QVERIFY(!kapps::core::log::categoryLevelEnabled(testCategory, kapps::core::LogMessage::Level::Warning));
+        QVERIFY(kapps::core::log::categoryLevelEnabled(testCategory, kapps::core::LogMessage::Level::Error));
+        QVERIFY(kapps::core::log::categoryLevelEnabled(otherCategory, kapps::core::LogMessage::Level::Debug));
+
+        KACLogClearCategoryLevels();
+        QVERIFY(kapps::core::log::categoryLevelEnabled(testCategory, kapps::core::LogMessage::Level::Debug));
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_core_logger)
+#include TEST_MOC
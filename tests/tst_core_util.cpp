@@ -18,7 +18,9 @@
 
 #include <QtTest>
 #include <kapps_core/src/util.h>
+#include <kapps_core/src/stringslice.h>
 #include <kapps_core/src/configwriter.h>
+#include <kapps_core/src/smallvector.h>
 
 class tst_core_util : public QObject
 {
@@ -79,6 +81,99 @@ private slots:
         }
     }
 
+    void testStringSliceFind()
+    {
+        using kapps::core::StringSlice;
+
+        StringSlice text{"wg0: 1500 peers=3 peers=4"};
+        QVERIFY(text.find(':') == 3u);
+        QVERIFY(text.find('p', 10) == 10u);
+        QVERIFY(text.find('z') == StringSlice::npos);
+        QVERIFY(text.find('w', text.size()) == StringSlice::npos);
+        QVERIFY(text.find("peers") == 10u);
+        QVERIFY(text.find("peers", 11) == 18u);
+        QVERIFY(text.find("peers=5") == StringSlice::npos);
+        QVERIFY(text.find("4") == text.size()-1);
+        QVERIFY(text.find("") == 0u);
+        QVERIFY(text.find("", text.size()) == text.size());
+        QVERIFY(StringSlice{"ab"}.find("abc") == StringSlice::npos);
+
+        QVERIFY(text.find_first_of(" :") == 3u);
+        QVERIFY(text.find_first_of("=", 16) == 23u);
+        QVERIFY(text.find_first_of("xyz") == StringSlice::npos);
+        QVERIFY(text.find_first_not_of("0wg") == 3u);
+        QVERIFY(text.find_first_not_of("0123456789", 5) == 9u);
+        QVERIFY(StringSlice{"  "}.find_first_not_of(" ") == StringSlice::npos);
+    }
+
+    void testStringSliceSplit()
+    {
+        using kapps::core::StringSlice;
+
+        QVERIFY(StringSlice{""}.split('\n') == (std::vector<StringSlice>{""}));
+        QVERIFY(StringSlice{"a\nbc\n"}.split('\n') == (std::vector<StringSlice>{"a", "bc", ""}));
+        QVERIFY(StringSlice{"\na"}.split('\n') == (std::vector<StringSlice>{"", "a"}));
+    }
+
+    void testParseInteger()
+    {
+        using kapps::core::StringSlice;
+        using kapps::core::parseInteger;
+
+        QCOMPARE(parseInteger<int>(StringSlice{"51820"}), 51820);
+        QCOMPARE(parseInteger<int>(StringSlice{"-42"}), -42);
+        QCOMPARE(parseInteger<std::int8_t>(StringSlice{"-128"}), std::int8_t{-128});
+        QCOMPARE(parseInteger<std::uint8_t>(StringSlice{"255"}), std::uint8_t{255});
+        QCOMPARE(parseInteger<std::int64_t>(StringSlice{"9223372036854775807"}),
+                 std::numeric_limits<std::int64_t>::max());
+        QVERIFY_EXCEPTION_THROWN(parseInteger<std::uint8_t>(StringSlice{"256"}), std::range_error);
+        QVERIFY_EXCEPTION_THROWN(parseInteger<int>(StringSlice{"12a"}), std::runtime_error);
+        QVERIFY_EXCEPTION_THROWN(parseInteger<int>(StringSlice{""}), std::runtime_error);
+    }
+
+    void testSmallVector()
+    {
+        using Vec = kapps::core::SmallVector<std::string, 2>;
+
+        Vec values{"a", "b"};
+        QCOMPARE(values.size(), 2u);
+        QVERIFY(values.isInline());
+
+        // Grow beyond the inline storage, including pushing an existing element
+        values.push_back(values[0]);
+        values.insert(values.begin() + 1, "c");
+        QVERIFY(!values.isInline());
+        QVERIFY(values == (Vec{"a", "c", "b", "a"}));
+
+        values.erase(values.begin());
+        QVERIFY(values == (Vec{"c", "b", "a"}));
+
+        // Moving heap storage takes it; moving inline storage moves the
+        // elements
+        Vec moved{std::move(values)};
+        QVERIFY(values.empty());
+        QVERIFY(values.isInline());
+        QVERIFY(moved == (Vec{"c", "b", "a"}));
+
+        Vec small{"x"};
+        Vec movedSmall{std::move(small)};
+        QVERIFY(small.empty());
+        QVERIFY(movedSmall.isInline());
+        QCOMPARE(movedSmall.front(), std::string{"x"});
+
+        // Copies are independent
+        Vec copy{moved};
+        copy.pop_back();
+        QCOMPARE(copy.size(), 2u);
+        QCOMPARE(moved.size(), 3u);
+
+        // Can be viewed as an ArraySlice
+        kapps::core::SmallVector<int, 4> ints{1, 2, 3};
+        kapps::core::ArraySlice<const int> slice = ints;
+        QCOMPARE(slice.size(), 3u);
+        QCOMPARE(slice.back(), 3);
+    }
+
     void testConfigWriterOpen()
     {
         // Verify that ConfigWriter's constructor accepts UTF-8 (again,
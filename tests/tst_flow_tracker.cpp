@@ -68,6 +68,71 @@ private slots:
         }
     }
 
+    void testTrackEvictsLeastRecent()
+    {
+        const std::uint32_t sourceAddress1{QHostAddress{"192.168.1.2"}.toIPv4Address()};
+        const std::uint32_t destAddress1{QHostAddress{"1.1.1.1"}.toIPv4Address()};
+
+        FlowTracker ft{2, 2}; // MaxWindowSize, MaxRepeatedFlows
+        PacketFlow4 flow1{sourceAddress1, 100,  destAddress1, 200, IPPROTO_TCP};
+        PacketFlow4 flow2{sourceAddress1, 101,  destAddress1, 200, IPPROTO_TCP};
+        PacketFlow4 flow3{sourceAddress1, 102,  destAddress1, 200, IPPROTO_TCP};
+
+        QCOMPARE(ft.track(flow1), FlowTracker::NormalFlow);
+        QCOMPARE(ft.track(flow2), FlowTracker::NormalFlow);
+        // Seeing flow1 again makes flow2 the least-recently seen flow
+        QCOMPARE(ft.track(flow1), FlowTracker::NormalFlow);
+
+        // flow3 displaces flow2, not flow1
+        QCOMPARE(ft.track(flow3), FlowTracker::NormalFlow);
+        QCOMPARE(ft.track(flow1), FlowTracker::RepeatedFlow);
+    }
+
+    void testTrackProtocols()
+    {
+        const std::uint32_t sourceAddress1{QHostAddress{"192.168.1.2"}.toIPv4Address()};
+        const std::uint32_t destAddress1{QHostAddress{"1.1.1.1"}.toIPv4Address()};
+
+        // TCP and UDP flows with the same addresses and ports are counted
+        // separately
+        FlowTracker ft{4, 2}; // MaxWindowSize, MaxRepeatedFlows
+        PacketFlow4 tcpFlow{sourceAddress1, 100,  destAddress1, 200, IPPROTO_TCP};
+        PacketFlow4 udpFlow{sourceAddress1, 100,  destAddress1, 200, IPPROTO_UDP};
+
+        QCOMPARE(ft.track(tcpFlow), FlowTracker::NormalFlow);
+        QCOMPARE(ft.track(udpFlow), FlowTracker::NormalFlow);
+        QCOMPARE(ft.track(tcpFlow), FlowTracker::NormalFlow);
+        QCOMPARE(ft.track(udpFlow), FlowTracker::NormalFlow);
+        QCOMPARE(ft.track(tcpFlow), FlowTracker::RepeatedFlow);
+    }
+
+    void testFlowCache()
+    {
+        const std::uint32_t sourceAddress1{QHostAddress{"192.168.1.2"}.toIPv4Address()};
+        const std::uint32_t destAddress1{QHostAddress{"1.1.1.1"}.toIPv4Address()};
+
+        kapps::net::FlowCache<int> cache{2};
+        PacketFlow4 flow1{sourceAddress1, 100,  destAddress1, 200, IPPROTO_TCP};
+        PacketFlow4 flow2{sourceAddress1, 101,  destAddress1, 200, IPPROTO_UDP};
+        PacketFlow4 icmpFlow{sourceAddress1, 0,  destAddress1, 0, IPPROTO_ICMP};
+
+        cache.insert(flow1, 1);
+        cache.insert(flow2, 2);
+        // Not a TCP/UDP flow, so not cached
+        cache.insert(icmpFlow, 3);
+
+        QCOMPARE(*cache.find(flow1), 1);
+        QCOMPARE(*cache.find(flow2), 2);
+        QCOMPARE(cache.find(icmpFlow), nullptr);
+
+        cache.erase(flow1);
+        QCOMPARE(cache.find(flow1), nullptr);
+        QCOMPARE(*cache.find(flow2), 2);
+
+        cache.clear();
+        QCOMPARE(cache.find(flow2), nullptr);
+    }
+
     void testHash4()
     {
         // Make sure all parts of the flow contribute to the IP address
@@ -281,6 +281,40 @@ private slots:
 
        }
 
+       // Parsing accepts the same forms as inet_pton()
+       void testParseIpv4()
+       {
+           QVERIFY(Ipv4Address{"192.168.1.20"} == (Ipv4Address{192, 168, 1, 20}));
+           QVERIFY(Ipv4Address{"255.255.255.255"} == (Ipv4Address{255, 255, 255, 255}));
+           QVERIFY(Ipv4Address{"0.0.0.0"}.isNull());
+           // Parsing a slice only parses that part of the string
+           QVERIFY(Ipv4Address{StringSlice{"10.0.0.1/8"}.substr(0, 8)} == (Ipv4Address{10, 0, 0, 1}));
+
+           // Invalid addresses result in 0.0.0.0
+           QVERIFY(Ipv4Address{"256.0.0.1"}.isNull());
+           QVERIFY(Ipv4Address{"01.2.3.4"}.isNull());
+           QVERIFY(Ipv4Address{"1.2.3"}.isNull());
+           QVERIFY(Ipv4Address{"1.2.3.4."}.isNull());
+           QVERIFY(Ipv4Address{"1..3.4"}.isNull());
+           QVERIFY(Ipv4Address{" 1.2.3.4"}.isNull());
+           QVERIFY(Ipv4Address{""}.isNull());
+
+           // Omitted octets in subnets
+           QVERIFY(Ipv4Subnet{"10."} == (Ipv4Subnet{Ipv4Address{10, 0, 0, 0}, 8}));
+           QVERIFY(Ipv4Subnet{"192.168/16"} == (Ipv4Subnet{Ipv4Address{192, 168, 0, 0}, 16}));
+           QVERIFY(Ipv4Subnet{"10.0.0.1"} == (Ipv4Subnet{Ipv4Address{10, 0, 0, 1}, 32}));
+       }
+
+       void testParseIpv6()
+       {
+           QVERIFY(Ipv6Address{"2001:db8::1"} == (Ipv6Address{0x2001, 0xdb8, 0, 0, 0, 0, 0, 1}));
+           QCOMPARE(Ipv6Address{"2001:db8::1"}.toString(), std::string{"2001:db8::1"});
+           QVERIFY(Ipv6Address{"zz::1"}.isNull());
+           // Longer than any valid address
+           QVERIFY(Ipv6Address{std::string(64, '1')}.isNull());
+           QVERIFY(Ipv6Subnet{"fd00::1/8"} == (Ipv6Subnet{Ipv6Address{0xfd00}, 8}));
+       }
+
  };
 }
 
@@ -21,6 +21,7 @@
 #include <QSignalSpy>
 
 #include <common/src/json.h>
+#include <common/src/jsondelta.h>
 
 #include <QJsonArray>
 #include <QJsonObject>
@@ -52,6 +53,7 @@ public:
     JsonField(QJsonObject, objectField, {})
     JsonField(QString, validatedStringField, QStringLiteral("test"), { "a", "b", "c" })
     JsonField(QJsonArray, validatedArrayField, {}, &TestSettings::arrayValidatorFunc)
+    JsonLazyField(QJsonArray, lazyArrayField, {})
 };
 
 class tst_json : public QObject
@@ -194,6 +196,63 @@ private slots:
         QCOMPARE(settings["test"], "test");
         // TODO: Use compiler black magic to check that settings["test"] = "test"; does not compile
     }
+    void knownProperties()
+    {
+        TestSettings settings;
+        QVERIFY(settings.isKnownProperty("intField"));
+        QVERIFY(settings.isKnownProperty(QStringLiteral("lazyArrayField")));
+        QVERIFY(!settings.isKnownProperty("test"));
+        // Inherited QObject properties aren't JSON properties
+        QVERIFY(!settings.isKnownProperty("objectName"));
+        QVERIFY(settings.set("objectName", "test"));
+        QCOMPARE(settings.get("objectName"), "test");
+        QCOMPARE(settings.objectName(), QString{});
+    }
+    void toJsonObjectRoundTrip()
+    {
+        TestSettings settings;
+        settings.intField(4);
+        settings.stringField(QStringLiteral("test"));
+        settings.lazyArrayField(QJsonArray{1, 2});
+        QVERIFY(settings.set("test", true));
+        QJsonObject json = settings.toJsonObject();
+        QCOMPARE(json.value("intField"), 4);
+        QCOMPARE(json.value("stringField"), "test");
+        QCOMPARE(json.value("lazyArrayField"), (QJsonArray{1, 2}));
+        QCOMPARE(json.value("test"), true);
+        QCOMPARE(json.value("validatedStringField"), "test");
+
+        TestSettings other;
+        QVERIFY(other.readJsonObject(json));
+        QCOMPARE(other.toJsonObject(), json);
+    }
+    // Converting directly between Qt and nlohmann::json gives the same result
+    // as rendering and parsing JSON text
+    void adaptNljAndQt()
+    {
+        QJsonObject qtObj{
+            {"bool", true},
+            {"null", QJsonValue::Null},
+            {"int", 42},
+            {"negative", -7},
+            {"double", 0.25},
+            {"large", 1e20},
+            {"string", QStringLiteral("caf\u00e9")},
+            {"array", QJsonArray{1, "two", QJsonArray{}, QJsonObject{}}},
+            {"object", QJsonObject{{"nested", QJsonObject{{"value", 3.5}}}}}
+        };
+
+        QByteArray qtText = QJsonDocument{qtObj}.toJson();
+        auto parsed = nlohmann::json::parse(qtText.begin(), qtText.end());
+        auto adapted = adaptQtToNlj<nlohmann::json>(qtObj);
+        QCOMPARE(adapted.dump(), parsed.dump());
+        QVERIFY(adapted["int"].is_number_unsigned());
+        QVERIFY(adapted["negative"].is_number_integer());
+
+        QCOMPARE(adaptNljToQt(adapted), qtObj);
+        QCOMPARE(adaptNljToQt(adapted), adaptJsonTextToQJsonObject(adapted.dump()));
+        QVERIFY_EXCEPTION_THROWN(adaptNljToQt(nlohmann::json::array()), std::runtime_error);
+    }
     void assignProperties()
     {
         TestSettings settings;
@@ -286,6 +345,76 @@ private slots:
         settings.validatedArrayField({ 1, 2, 3 });
         QVERIFY(!settings.error());
     }
+    void lazyFieldProperty()
+    {
+        TestSettings settings;
+        QSignalSpy spyChanged(&settings, &TestSettings::lazyArrayFieldChanged);
+        const QJsonArray value{1, 2, 3};
+        QVERIFY(settings.assign({{"lazyArrayField", value}}));
+        QCOMPARE(spyChanged.count(), 1);
+        // JSON reads return the raw value, native reads convert it
+        QCOMPARE(settings.get("lazyArrayField"), QJsonValue{value});
+        QCOMPARE(settings.lazyArrayField(), value);
+        // Assigning from JSON doesn't compare values
+        QVERIFY(settings.assign({{"lazyArrayField", value}}));
+        QCOMPARE(spyChanged.count(), 2);
+        // Native assignment still does
+        settings.lazyArrayField(value);
+        QCOMPARE(spyChanged.count(), 2);
+        // A value of the wrong type is discarded when it's materialized
+        settings.set("lazyArrayField", "test");
+        QCOMPARE(settings.lazyArrayField(), value);
+        settings.reset();
+        QCOMPARE(settings.lazyArrayField(), QJsonArray{});
+    }
+    void deltaRoundTrip()
+    {
+        const QJsonObject prior{
+            {"regions", QJsonArray{
+                QJsonObject{{"id", "us_east"}, {"latency", 40}},
+                QJsonObject{{"id", "us_west"}, {"latency", 80}},
+                QJsonObject{{"id", "ca"}, {"latency", 60}},
+                QJsonObject{{"id", "uk"}, {"latency", 120}}
+            }},
+            {"removed", true},
+            {"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}, {"e", 5}
+        };
+        const QJsonObject current{
+            {"regions", QJsonArray{
+                QJsonObject{{"id", "us_east"}, {"latency", 42}},
+                QJsonObject{{"id", "us_west"}, {"latency", 80}},
+                QJsonObject{{"id", "ca"}, {"latency", 60}},
+                QJsonObject{{"id", "uk"}, {"latency", 120}},
+                QJsonObject{{"id", "de"}, {"latency", 130}}
+            }},
+            {"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}, {"e", 5}, {"added", "x"}
+        };
+
+        const QJsonValue delta = jsonDiff(prior, current);
+        QVERIFY(delta.isObject());
+        // Only part of the value changed, so this should be structural
+        QVERIFY(!delta.toObject().contains("v"));
+        QCOMPARE(jsonPatch(prior, delta), QJsonValue{current});
+    }
+    void deltaUnchanged()
+    {
+        const QJsonArray value{1, 2, QJsonObject{{"x", 3}}};
+        QVERIFY(jsonDiff(value, value).isUndefined());
+    }
+    void deltaReplace()
+    {
+        // Type changes and mostly-changed values are sent in full
+        QCOMPARE(jsonDiff(QJsonArray{1, 2}, QJsonObject{{"a", 1}}),
+                 QJsonValue{QJsonObject{{"v", QJsonObject{{"a", 1}}}}});
+        QCOMPARE(jsonDiff(QJsonArray{1, 2}, QJsonArray{3, 4}),
+                 QJsonValue{QJsonObject{{"v", QJsonArray{3, 4}}}});
+    }
+    void deltaMismatch()
+    {
+        // An array delta can't apply to an object
+        const QJsonValue delta = jsonDiff(QJsonArray{1, 2, 3, 4}, QJsonArray{1, 2, 3});
+        QVERIFY_EXCEPTION_THROWN(jsonPatch(QJsonObject{}, delta), Error);
+    }
 };
 
 QTEST_GUILESS_MAIN(tst_json)
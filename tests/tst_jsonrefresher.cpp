@@ -112,6 +112,38 @@ private slots:
         QVERIFY(fetchSpy.empty());
         QVERIFY(!fetchSpy.wait(1000));
     }
+
+    // Test a conditional fetch - the validators of accepted content are sent,
+    // and a "not modified" reply doesn't emit the content again.
+    void testNotModified()
+    {
+        TestRefresher refresher;
+        QSignalSpy fetchSpy{&refresher, &JsonRefresher::contentLoaded};
+        QSignalSpy validatorsSpy{&refresher, &JsonRefresher::validatorsChanged};
+        QSignalSpy consumeSpy{&MockNetworkManager::_replyConsumed, &ReplyConsumedSignal::signal};
+
+        auto pReply = MockNetworkManager::enqueueReply(TestData::successJson);
+        pReply->setHeader(QByteArrayLiteral("ETag"), QByteArrayLiteral("\"v1\""));
+        pReply->queueFinished();
+        refresher.start(TestData::pUnitTestDummyApi);
+        QVERIFY(fetchSpy.wait());
+        QVERIFY(consumeSpy.takeFirst()[0].value<QNetworkRequest>().rawHeader("If-None-Match").isEmpty());
+
+        // Validators are only used once the content is accepted
+        refresher.loadSucceeded();
+        QCOMPARE(validatorsSpy.size(), 1);
+
+        auto pNotModifiedReply = MockNetworkManager::enqueueReply(QByteArray{});
+        pNotModifiedReply->setStatus(304);
+        pNotModifiedReply->queueFinished();
+        refresher.refresh();
+        QVERIFY(consumeSpy.wait());
+        QCOMPARE(consumeSpy.takeFirst()[0].value<QNetworkRequest>().rawHeader("If-None-Match"),
+                 QByteArrayLiteral("\"v1\""));
+        QVERIFY(!fetchSpy.wait(500));
+        QCOMPARE(fetchSpy.size(), 1);
+        QCOMPARE(validatorsSpy.size(), 1);
+    }
 };
 
 QTEST_GUILESS_MAIN(tst_jsonrefresher)
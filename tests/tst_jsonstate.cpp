@@ -40,6 +40,8 @@ public:
     JsonProperty(std::string, connectedServer);
     // Similar to DaemonState::intervalMeasurements, mocked as only down speeds
     JsonProperty(std::deque<int>, intervalMeasurements);
+    // Similar to DaemonState::groupedLocations, mocked as only the IDs
+    JsonCachedProperty(std::vector<std::string>, regionIds);
 };
 
 class PropertyObserver
@@ -89,7 +91,8 @@ private slots:
         auto expected = nlohmann::json{
             {"connectionState", "Connected"},
             {"connectedServer", "newyork405"},
-            {"intervalMeasurements", {1, 2, 3, 4, 9001}}
+            {"intervalMeasurements", {1, 2, 3, 4, 9001}},
+            {"regionIds", nlohmann::json::array()}
         };
 
         KAPPS_CORE_INFO() << "got:" << actual.dump(2);
@@ -142,6 +145,30 @@ private slots:
             "connectionState"}));
     }
 
+    // Cached properties render the new value after a change
+    void testCachedProperty()
+    {
+        MockState state;
+        PropertyObserver obs{state};
+
+        QCOMPARE(state.getProperty("regionIds"), nlohmann::json::array());
+        state.regionIds({"us_chicago", "us_texas"});
+        QCOMPARE(obs.take(), (Expected{"regionIds"}));
+        QCOMPARE(state.getProperty("regionIds"), nlohmann::json::array({"us_chicago", "us_texas"}));
+        // Unchanged, still the same JSON
+        state.regionIds({"us_chicago", "us_texas"});
+        QCOMPARE(obs.take(), (Expected{}));
+        QCOMPARE(state.getProperty("regionIds"), nlohmann::json::array({"us_chicago", "us_texas"}));
+
+        // Assignment discards the cached JSON if the value changes
+        MockState other;
+        other.regionIds({"ca_toronto"});
+        QCOMPARE(other.getProperty("regionIds"), nlohmann::json::array({"ca_toronto"}));
+        other = state;
+        QCOMPARE(other.getProperty("regionIds"), nlohmann::json::array({"us_chicago", "us_texas"}));
+        QCOMPARE(other.getJsonObject(), state.getJsonObject());
+    }
+
     // Copying and assignment work
     void testCopy()
     {
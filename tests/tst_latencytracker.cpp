@@ -167,6 +167,11 @@ private slots:
                 const auto &locId = signalArgs[0].toString();
                 // Can't emit the same location more than once
                 QVERIFY(pendingLocations.erase(locId) == 1);
+                // The latency is the round trip measured by the pinger (mocked
+                // pings always report 30 ms), not the time taken to process the
+                // reply
+                QCOMPARE(signalArgs[1].value<std::chrono::milliseconds>(),
+                         std::chrono::milliseconds{30});
             }
         }
     }
@@ -272,6 +277,40 @@ private slots:
         QVERIFY(!measurementSpy.wait(2000));
     }
 
+    // Verify the streaming statistics kept by LatencyHistory
+    void historyStatistics()
+    {
+        LatencyHistory history;
+        QVERIFY(!history.hasMeasurements());
+
+        // A constant latency has no jitter, and all quantiles are that latency
+        for(int i = 0; i < 20; ++i)
+            history.updateLatency(std::chrono::milliseconds{50});
+        auto stats = history.statistics();
+        QCOMPARE(stats.mean, 50.0);
+        QCOMPARE(stats.jitter, 0.0);
+        QCOMPARE(stats.p50, 50.0);
+        QCOMPARE(stats.p95, 50.0);
+        QCOMPARE(stats.lossRate, 0.0);
+
+        // Occasional spikes raise the 95th percentile and jitter, but not the
+        // median
+        for(int i = 0; i < 200; ++i)
+            history.updateLatency(std::chrono::milliseconds{(i % 10) == 0 ? 250 : 50});
+        stats = history.statistics();
+        QVERIFY(stats.p50 < 60.0);
+        QVERIFY(stats.p95 > 100.0);
+        QVERIFY(stats.jitter > 10.0);
+
+        // Losses raise the loss rate, and answered pings lower it again
+        history.recordLoss();
+        history.recordLoss();
+        double lossRate = history.statistics().lossRate;
+        QVERIFY(lossRate > 0.2);
+        history.updateLatency(std::chrono::milliseconds{50});
+        QVERIFY(history.statistics().lossRate < lossRate);
+    }
+
     //Verify that a LatencyBatch is cleaned up properly under normal
     //circumstances (all addresses are valid and respond)
     void normalCleanup()
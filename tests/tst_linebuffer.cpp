@@ -122,6 +122,26 @@ private slots:
         QCOMPARE(line, QByteArray{"sunshine"});
     }
 
+    // Lines split across appends and CRLF line endings are handled, and
+    // lineView() provides the same lines as lineComplete()
+    void testLineViews()
+    {
+        LineBuffer buf;
+        QList<QByteArray> viewLines;
+        connect(&buf, &LineBuffer::lineView, this,
+                [&](QByteArrayView line){viewLines.push_back(line.toByteArray());});
+        QSignalSpy spy{&buf, &LineBuffer::lineComplete};
+
+        buf.append(QByteArray{"hel"});
+        buf.append(QByteArray{"lo\r\nwor"});
+        buf.append(QByteArray{"ld\n\npartial"});
+
+        QCOMPARE(viewLines, (QList<QByteArray>{"hello", "world", ""}));
+        QCOMPARE(spy.count(), 3);
+        QCOMPARE(spy.at(1).at(0).toByteArray(), QByteArray{"world"});
+        QCOMPARE(buf.reset(), QByteArray{"partial"});
+    }
+
 };
 
 QTEST_GUILESS_MAIN(tst_linebuffer)
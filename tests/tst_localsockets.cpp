@@ -32,22 +32,25 @@ class tst_localsockets : public QObject
 
 public:
     using ClientFactoryFunc = ClientIPCConnection*(*)(QObject*);
+    using ServerFactoryFunc = IPCServer*(*)(QObject*);
 
-    tst_localsockets(ClientFactoryFunc pClientFactory)
-        : _pClientFactory{pClientFactory}
+    tst_localsockets(ClientFactoryFunc pClientFactory,
+                     ServerFactoryFunc pServerFactory)
+        : _pClientFactory{pClientFactory}, _pServerFactory{pServerFactory}
     {
     }
 
 private:
     ClientFactoryFunc _pClientFactory;
-    QPointer<LocalSocketIPCServer> _server = nullptr;
+    ServerFactoryFunc _pServerFactory;
+    QPointer<IPCServer> _server = nullptr;
     QPointer<ClientIPCConnection> _connection = nullptr; // client end
     QPointer<IPCConnection> _serverClientConnection = nullptr;  // Server's connection to client
 
     void setupServer(std::function<void(const QByteArray& msg, IPCConnection* connection)> messageHandler)
     {
-        _server = new LocalSocketIPCServer(this);
-        connect(_server, &LocalSocketIPCServer::newConnection, this, [this, messageHandler](IPCConnection* connection) {
+        _server = _pServerFactory(this);
+        connect(_server, &IPCServer::newConnection, this, [this, messageHandler](IPCConnection* connection) {
             _serverClientConnection = connection;
             connect(connection, &IPCConnection::messageReceived, this, std::bind(messageHandler, _1, connection));
         });
@@ -105,8 +108,8 @@ private slots:
     // get sent out.
     void simpleConnection()
     {
-        _server = new LocalSocketIPCServer(this);
-        QSignalSpy spyServerClientConnected(_server, &LocalSocketIPCServer::newConnection);
+        _server = _pServerFactory(this);
+        QSignalSpy spyServerClientConnected(_server, &IPCServer::newConnection);
         QVERIFY(_server->listen());
 
         _connection = _pClientFactory(this);
@@ -290,6 +293,12 @@ ClientIPCConnection *connectionFactory(QObject *pParent)
     return new Connection_t{pParent};
 }
 
+template<class Server_t>
+IPCServer *serverFactory(QObject *pParent)
+{
+    return new Server_t{pParent};
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication app{argc, argv};
@@ -297,13 +306,20 @@ int main(int argc, char *argv[])
     int failures = 0;
 
     {
-        tst_localsockets syncTest{&connectionFactory<LocalSocketIPCConnection>};
+        tst_localsockets syncTest{&connectionFactory<LocalSocketIPCConnection>,
+                                  &serverFactory<LocalSocketIPCServer>};
         failures += QTest::qExec(&syncTest, argc, argv);
     }
     {
-        tst_localsockets threadedTest{&connectionFactory<ThreadedLocalIPCConnection>};
+        tst_localsockets threadedTest{&connectionFactory<ThreadedLocalIPCConnection>,
+                                      &serverFactory<LocalSocketIPCServer>};
         failures += QTest::qExec(&threadedTest, argc, argv);
     }
+    {
+        tst_localsockets threadedServerTest{&connectionFactory<LocalSocketIPCConnection>,
+                                            &serverFactory<ThreadedLocalSocketIPCServer>};
+        failures += QTest::qExec(&threadedServerTest, argc, argv);
+    }
 
     return failures;
 }
@@ -0,0 +1,104 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <daemon/src/metrics.h>
+#include "brand.h"
+#include <QtTest>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Render the metrics and split into lines
+    QList<QByteArray> renderLines(const Metrics &metrics)
+    {
+        return metrics.render().split('\n');
+    }
+
+    QByteArray metricLine(const char *pLine)
+    {
+        return QByteArrayLiteral(BRAND_CODE "_") + pLine;
+    }
+}
+
+class tst_metrics : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testEmpty()
+    {
+        Metrics metrics;
+        auto lines = renderLines(metrics);
+        QVERIFY(lines.contains(QByteArrayLiteral("# TYPE " BRAND_CODE "_ipc_messages counter")));
+        // Output ends with EOF and a newline
+        QCOMPARE(lines.size(), lines.indexOf(QByteArrayLiteral("# EOF")) + 2);
+        QCOMPARE(lines.last(), QByteArray{});
+    }
+
+    void testCounter()
+    {
+        Metrics metrics;
+        metrics.add(QStringLiteral("ipc_messages"), {{QStringLiteral("client"), QStringLiteral("1")}});
+        metrics.add(QStringLiteral("ipc_messages"), {{QStringLiteral("client"), QStringLiteral("1")}}, 4);
+        metrics.set(QStringLiteral("ipc_messages"), {{QStringLiteral("client"), QStringLiteral("2")}}, 10);
+        auto lines = renderLines(metrics);
+        QVERIFY(lines.contains(metricLine("ipc_messages_total{client=\"1\"} 5")));
+        QVERIFY(lines.contains(metricLine("ipc_messages_total{client=\"2\"} 10")));
+
+        metrics.clear(QStringLiteral("ipc_messages"));
+        lines = renderLines(metrics);
+        QVERIFY(!lines.contains(metricLine("ipc_messages_total{client=\"1\"} 5")));
+    }
+
+    void testGauge()
+    {
+        Metrics metrics;
+        metrics.set(QStringLiteral("log_queue_bytes"), {}, 1024);
+        metrics.set(QStringLiteral("log_queue_bytes"), {}, 512);
+        QVERIFY(renderLines(metrics).contains(metricLine("log_queue_bytes 512")));
+    }
+
+    void testLabelEscaping()
+    {
+        Metrics metrics;
+        metrics.set(QStringLiteral("log_queue_bytes"), {{QStringLiteral("a"), QStringLiteral("x\"y\\z\n")}}, 1);
+        QVERIFY(renderLines(metrics).contains(metricLine("log_queue_bytes{a=\"x\\\"y\\\\z\\n\"} 1")));
+    }
+
+    void testHistogram()
+    {
+        Metrics metrics;
+        metrics.observe(QStringLiteral("firewall_apply_seconds"), {}, 500us);
+        metrics.observe(QStringLiteral("firewall_apply_seconds"), {}, 20ms);
+        metrics.observe(QStringLiteral("firewall_apply_seconds"), {}, 30s);
+        auto lines = renderLines(metrics);
+        // Buckets are cumulative
+        QVERIFY(lines.contains(metricLine("firewall_apply_seconds_bucket{le=\"0.001\"} 1")));
+        QVERIFY(lines.contains(metricLine("firewall_apply_seconds_bucket{le=\"0.01\"} 1")));
+        QVERIFY(lines.contains(metricLine("firewall_apply_seconds_bucket{le=\"0.025\"} 2")));
+        QVERIFY(lines.contains(metricLine("firewall_apply_seconds_bucket{le=\"10\"} 2")));
+        QVERIFY(lines.contains(metricLine("firewall_apply_seconds_bucket{le=\"+Inf\"} 3")));
+        QVERIFY(lines.contains(metricLine("firewall_apply_seconds_count 3")));
+        QVERIFY(lines.contains(metricLine("firewall_apply_seconds_sum 30.0205")));
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_metrics)
+#include TEST_MOC
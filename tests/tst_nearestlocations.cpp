@@ -459,6 +459,40 @@ private slots:
         QCOMPARE(nearest.id(), "aus_melbourne");
     }
 
+    // Select by score within the same locations that latency selection would
+    // consider
+    void testGetBestScoringVpnLocation()
+    {
+        setLatencies();
+        buildRegions();
+        NearestLocations nearestLocations{locs};
+
+        // Hungary has the best score, but it's not an auto region, so it still
+        // isn't considered.  Poland scores better than ro.
+        std::unordered_map<QString, double> scores{
+            {QStringLiteral("hungary"), 1},
+            {QStringLiteral("us2"), 50},
+            {QStringLiteral("us_california"), 10},
+            {QStringLiteral("ro"), 40},
+            {QStringLiteral("poland"), 30}
+        };
+        auto score = [&scores](const Location &location)
+        {
+            return scores[location.id()];
+        };
+
+        QCOMPARE(nearestLocations.getBestScoringVpnLocation(false, score)->id(),
+                 "us_california");
+        // With port forwarding, only PF locations are considered
+        QCOMPARE(nearestLocations.getBestScoringVpnLocation(true, score)->id(),
+                 "poland");
+
+        // Ties are broken by latency
+        scores[QStringLiteral("us2")] = 10;
+        QCOMPARE(nearestLocations.getBestScoringVpnLocation(false, score)->id(),
+                 "us2");
+    }
+
     // // Further constrain the output with a predicate function
     void testGetNearestSafeServiceLocation()
     {
@@ -479,6 +513,10 @@ private slots:
             [](auto loc){ return loc.id().startsWith(QStringLiteral("zzz")); });
 
         QVERIFY(!nearest2);
+
+        // The precomputed service selections follow the same order
+        QCOMPARE(nearestLocations.getBestLocationForService(Service::WireGuard)->id(), "us2");
+        QVERIFY(!nearestLocations.getBestLocationForService(Service::Shadowsocks));
     }
 
     // // Test all combinations of preferences with geo, auto, and port forwarding.
@@ -150,6 +150,57 @@ private slots:
         QCOMPARE(parseSsid(u8"SP\u00d3\u00d3K\u00ddSP\u00d3\u00d3K\u00ddSP\u00d3\u00d3K\u00ddSP\u00d3\u00d3K\u00ddSP\u00d3\u00d3K\u00dd"),
                  QString{});
     }
+
+    void testDiff()
+    {
+        auto makeConnection = [](const QString &itf, bool defaultIpv4, unsigned mtu)
+        {
+            return NetworkConnection{itf, NetworkConnection::Medium::Wired,
+                                     defaultIpv4, false, {}, {}, {}, {}, mtu, mtu};
+        };
+
+        std::vector<NetworkConnection> oldNetworks{makeConnection(QStringLiteral("eth0"), true, 1500),
+                                                   makeConnection(QStringLiteral("docker0"), false, 1500),
+                                                   makeConnection(QStringLiteral("veth1"), false, 1500)};
+
+        // A non-default connection is added, removed, or changed - the
+        // default isn't affected
+        std::vector<NetworkConnection> newNetworks{makeConnection(QStringLiteral("eth0"), true, 1500),
+                                                   makeConnection(QStringLiteral("docker0"), false, 1400),
+                                                   makeConnection(QStringLiteral("veth2"), false, 1500)};
+        NetworkChanges changes = NetworkChanges::diff(oldNetworks, newNetworks);
+        QVERIFY(changes.added.size() == 1);
+        QCOMPARE(changes.added.front().networkInterface(), QStringLiteral("veth2"));
+        QVERIFY(changes.removed.size() == 1);
+        QCOMPARE(changes.removed.front().networkInterface(), QStringLiteral("veth1"));
+        QVERIFY(changes.changed.size() == 1);
+        QCOMPARE(changes.changed.front().mtu4(), 1400u);
+        QVERIFY(!changes.defaultChanged);
+
+        // The default connection itself changes
+        newNetworks = oldNetworks;
+        newNetworks.front().mtu4(1420);
+        changes = NetworkChanges::diff(oldNetworks, newNetworks);
+        QVERIFY(changes.changed.size() == 1);
+        QVERIFY(changes.defaultChanged);
+
+        // The default moves to a different connection
+        newNetworks = {makeConnection(QStringLiteral("eth0"), false, 1500),
+                       makeConnection(QStringLiteral("docker0"), false, 1500),
+                       makeConnection(QStringLiteral("veth1"), true, 1500)};
+        changes = NetworkChanges::diff(oldNetworks, newNetworks);
+        QVERIFY(changes.defaultChanged);
+
+        // The default goes away
+        changes = NetworkChanges::diff(oldNetworks, {});
+        QVERIFY(changes.removed.size() == 3);
+        QVERIFY(changes.defaultChanged);
+
+        // No change
+        changes = NetworkChanges::diff(oldNetworks, oldNetworks);
+        QVERIFY(changes.empty());
+        QVERIFY(!changes.defaultChanged);
+    }
 };
 
 QTEST_GUILESS_MAIN(tst_networkmonitor)
@@ -179,6 +179,42 @@ private slots:
         testFailRedirect(noPortBase, QStringLiteral("//redir.example.com:444/redir_resource"));
     }
     
+    // Test the hedge delay computed from latency history
+    void testHedgeDelay()
+    {
+        using std::chrono::milliseconds;
+
+        ApiBaseData data{QStringLiteral("https://one.example.com/"),
+                         QStringLiteral("https://two.example.com/")};
+        // No history yet - don't hedge
+        QVERIFY(data.getHedgeDelay(0) == milliseconds{0});
+
+        for(int i=0; i<4; ++i)
+            data.recordLatency(0, milliseconds{400});
+        QVERIFY(data.getHedgeDelay(0) == milliseconds{0});
+
+        // With enough samples, the 90th percentile is used
+        for(int i=0; i<5; ++i)
+            data.recordLatency(0, milliseconds{400});
+        data.recordLatency(0, milliseconds{2000});
+        QVERIFY(data.getHedgeDelay(0) == milliseconds{400});
+        // The other base has no history of its own
+        QVERIFY(data.getHedgeDelay(1) == milliseconds{0});
+
+        // Very fast bases are hedged at the minimum delay
+        ApiBaseData fastData{QStringLiteral("https://one.example.com/"),
+                             QStringLiteral("https://two.example.com/")};
+        for(int i=0; i<8; ++i)
+            fastData.recordLatency(1, milliseconds{20});
+        QVERIFY(fastData.getHedgeDelay(1) == milliseconds{250});
+
+        // A single base is never hedged
+        ApiBaseData singleData{QStringLiteral("https://one.example.com/")};
+        for(int i=0; i<8; ++i)
+            singleData.recordLatency(0, milliseconds{400});
+        QVERIFY(singleData.getHedgeDelay(0) == milliseconds{0});
+    }
+
     // Test some garbage URIs
     void testNoHostFailure()
     {
@@ -0,0 +1,62 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+
+#include <common/src/common.h>
+#include <QtTest>
+#include "daemon/src/openvpn.h"
+
+class tst_openvpn : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testParseBytecount()
+    {
+        quint64 received{1}, sent{2};
+        QVERIFY(OpenVPNProcess::parseBytecount("0,0", received, sent));
+        QCOMPARE(received, 0ull);
+        QCOMPARE(sent, 0ull);
+        QVERIFY(OpenVPNProcess::parseBytecount("123456,7890", received, sent));
+        QCOMPARE(received, 123456ull);
+        QCOMPARE(sent, 7890ull);
+        // >32 bits, and max
+        QVERIFY(OpenVPNProcess::parseBytecount("6000000000,18446744073709551615", received, sent));
+        QCOMPARE(received, 6000000000ull);
+        QCOMPARE(sent, std::numeric_limits<quint64>::max());
+    }
+
+    void testParseBytecountInvalid()
+    {
+        quint64 received{1}, sent{2};
+        QVERIFY(!OpenVPNProcess::parseBytecount("", received, sent));
+        QVERIFY(!OpenVPNProcess::parseBytecount("123", received, sent));
+        QVERIFY(!OpenVPNProcess::parseBytecount("123,", received, sent));
+        QVERIFY(!OpenVPNProcess::parseBytecount(",123", received, sent));
+        QVERIFY(!OpenVPNProcess::parseBytecount("1,2,3", received, sent));
+        QVERIFY(!OpenVPNProcess::parseBytecount("1, 2", received, sent));
+        QVERIFY(!OpenVPNProcess::parseBytecount("-1,2", received, sent));
+        QVERIFY(!OpenVPNProcess::parseBytecount("1,18446744073709551616", received, sent));
+        // Outputs are unchanged
+        QCOMPARE(received, 1ull);
+        QCOMPARE(sent, 2ull);
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_openvpn)
+#include TEST_MOC
@@ -0,0 +1,157 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+#include <kapps_net/src/mac/packet.h>
+#include <QtTest>
+#include <cstring>
+#include <random>
+
+using Packet = kapps::net::Packet;
+
+namespace
+{
+    // Scalar reference implementation of the Internet checksum - sum 16-bit
+    // words, pad an odd trailing byte with zero, fold, and complement
+    std::uint16_t referenceChecksum(const unsigned char *pData, std::size_t len)
+    {
+        std::uint32_t sum{};
+        for(std::size_t i=0; i+1 < len; i += 2)
+        {
+            std::uint16_t word;
+            std::memcpy(&word, pData + i, sizeof(word));
+            sum += word;
+        }
+        if(len % 2)
+        {
+            std::uint16_t word{};
+            std::memcpy(&word, pData + len - 1, 1);
+            sum += word;
+        }
+        while(sum >> 16)
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        return static_cast<std::uint16_t>(~sum);
+    }
+
+    // 0x0000 and 0xFFFF are both one's complement zero; RFC 1624 updates can
+    // produce either one
+    bool checksumsEqual(std::uint16_t first, std::uint16_t second)
+    {
+        auto normalize = [](std::uint16_t value){return value == 0xFFFF ? 0 : value;};
+        return normalize(first) == normalize(second);
+    }
+}
+
+class tst_packet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testChecksum()
+    {
+        std::mt19937 rng{1};
+        // All lengths up to a full packet, including odd lengths and lengths
+        // that aren't a multiple of 4
+        for(std::size_t len = 0; len <= 1504; ++len)
+        {
+            std::vector<unsigned char> data(len);
+            for(auto &byte : data)
+                byte = static_cast<unsigned char>(rng());
+            QCOMPARE(Packet::checksum(data.data(), data.size()),
+                     referenceChecksum(data.data(), data.size()));
+        }
+
+        // All-ones data produces lots of carries
+        std::vector<unsigned char> ones(1500, 0xFF);
+        QCOMPARE(Packet::checksum(ones.data(), ones.size()),
+                 referenceChecksum(ones.data(), ones.size()));
+    }
+
+    void testUpdateChecksum()
+    {
+        std::mt19937 rng{2};
+        for(int i=0; i<1000; ++i)
+        {
+            std::vector<unsigned char> data(60);
+            for(auto &byte : data)
+                byte = static_cast<unsigned char>(rng());
+
+            std::size_t offset = (rng() % (data.size() / 2)) * 2;
+            std::uint16_t oldWord, newWord{static_cast<std::uint16_t>(rng())};
+            std::memcpy(&oldWord, data.data() + offset, sizeof(oldWord));
+            std::uint16_t oldChecksum = referenceChecksum(data.data(), data.size());
+
+            std::memcpy(data.data() + offset, &newWord, sizeof(newWord));
+            QVERIFY(checksumsEqual(Packet::updateChecksum(oldChecksum, oldWord, newWord),
+                                   referenceChecksum(data.data(), data.size())));
+        }
+    }
+
+    void testReinjectionHeader()
+    {
+        // utun address family, then a 20-byte IP header and a TCP port header
+        std::vector<unsigned char> buffer(4 + 20 + 20);
+        ip *pIpHdr = reinterpret_cast<ip*>(buffer.data() + 4);
+        pIpHdr->ip_v = 4;
+        pIpHdr->ip_hl = 5;
+        pIpHdr->ip_len = htons(40);
+        pIpHdr->ip_off = htons(IP_DF);
+        pIpHdr->ip_ttl = 64;
+        pIpHdr->ip_p = IPPROTO_TCP;
+        pIpHdr->ip_src.s_addr = htonl(0xC0A80102);
+        pIpHdr->ip_dst.s_addr = htonl(0x01010101);
+        pIpHdr->ip_sum = referenceChecksum(reinterpret_cast<unsigned char*>(pIpHdr), 20);
+
+        auto pPacket = Packet::createFromData(buffer, 4);
+        QVERIFY(pPacket);
+
+        // ip_len and ip_off are now in host order, and the checksum still
+        // covers the header as it will be reinjected
+        QCOMPARE(pPacket->toRaw()->ip_len, std::uint16_t{40});
+        QCOMPARE(pPacket->toRaw()->ip_off, std::uint16_t{IP_DF});
+        QVERIFY(checksumsEqual(referenceChecksum(reinterpret_cast<unsigned char*>(pIpHdr), 20), 0));
+    }
+
+    void testTcpClosing()
+    {
+        auto createTcpPacket = [](std::vector<unsigned char> &buffer, std::uint8_t flags)
+        {
+            buffer.assign(4 + 20 + 20, 0);
+            ip *pIpHdr = reinterpret_cast<ip*>(buffer.data() + 4);
+            pIpHdr->ip_v = 4;
+            pIpHdr->ip_hl = 5;
+            pIpHdr->ip_len = htons(40);
+            pIpHdr->ip_p = IPPROTO_TCP;
+            reinterpret_cast<tcphdr*>(buffer.data() + 4 + 20)->th_flags = flags;
+            return Packet::createFromData(buffer, 4);
+        };
+
+        std::vector<unsigned char> buffer;
+        QVERIFY(!createTcpPacket(buffer, TH_SYN)->isTcpClosing());
+        QVERIFY(!createTcpPacket(buffer, TH_ACK)->isTcpClosing());
+        QVERIFY(createTcpPacket(buffer, TH_FIN | TH_ACK)->isTcpClosing());
+        QVERIFY(createTcpPacket(buffer, TH_RST)->isTcpClosing());
+
+        // A UDP packet is never closing, even if the byte where TCP flags
+        // would be happens to match
+        createTcpPacket(buffer, TH_RST);
+        reinterpret_cast<ip*>(buffer.data() + 4)->ip_p = IPPROTO_UDP;
+        QVERIFY(!Packet::createFromData(buffer, 4)->isTcpClosing());
+    }
+};
+
+QTEST_APPLESS_MAIN(tst_packet)
+#include TEST_MOC
@@ -0,0 +1,162 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <kapps_core/src/posix/pollthread.h>
+#include <kapps_core/src/posix/posix_objects.h>
+#include <QtTest>
+#include <algorithm>
+#include <unistd.h>
+
+using PollWorker = kapps::core::PollWorker;
+using PosixPipe = kapps::core::PosixPipe;
+
+namespace
+{
+    void signal(const PosixPipe &pipe)
+    {
+        unsigned char data{};
+        QCOMPARE(::write(pipe.writeEnd.get(), &data, sizeof(data)), 1);
+    }
+}
+
+class tst_pollworker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // On Linux and macOS, PollWorker should use epoll/kqueue
+    void testKernelQueue()
+    {
+        PollWorker worker;
+        QVERIFY(!worker.usingPollFallback());
+    }
+
+    // Only the signaled fd is activated
+    void testActivated()
+    {
+        PollWorker worker;
+        auto first = kapps::core::createPipe();
+        auto second = kapps::core::createPipe();
+        int firstToken = worker.addFd(first.readEnd.get(), POLLIN);
+        int secondToken = worker.addFd(second.readEnd.get(), POLLIN);
+        QVERIFY(firstToken != secondToken);
+
+        std::vector<int> activated;
+        worker.activated = [&](int token){activated.push_back(token);};
+
+        signal(second);
+        worker.pollFds();
+        QCOMPARE(activated, (std::vector<int>{secondToken}));
+
+        // Watches are level-triggered; the fd is activated again since it
+        // wasn't drained
+        activated.clear();
+        worker.pollFds();
+        QCOMPARE(activated, (std::vector<int>{secondToken}));
+
+        // Once removed, it's no longer activated
+        second.readEnd.discardAll();
+        worker.removeFd(secondToken);
+        signal(first);
+        activated.clear();
+        worker.pollFds();
+        QCOMPARE(activated, (std::vector<int>{firstToken}));
+    }
+
+    // Read and write watches on the same fd are activated independently
+    void testSameFd()
+    {
+        PollWorker worker;
+        auto pipe = kapps::core::createPipe();
+        int readToken = worker.addFd(pipe.writeEnd.get(), POLLIN);
+        int writeToken = worker.addFd(pipe.writeEnd.get(), POLLOUT);
+
+        std::vector<int> activated;
+        worker.activated = [&](int token){activated.push_back(token);};
+        worker.pollFds();
+        QCOMPARE(activated, (std::vector<int>{writeToken}));
+
+        // Removing one watch leaves the other
+        worker.removeFd(readToken);
+        activated.clear();
+        worker.pollFds();
+        QCOMPARE(activated, (std::vector<int>{writeToken}));
+    }
+
+    // A handler can remove a watch that already has events pending, and
+    // watches added by a handler aren't activated by the same wait, even if
+    // the token and fd number are reused
+    void testChangeDuringDispatch()
+    {
+        PollWorker worker;
+        auto first = kapps::core::createPipe();
+        auto second = kapps::core::createPipe();
+        int firstToken = worker.addFd(first.readEnd.get(), POLLIN);
+        int secondToken = worker.addFd(second.readEnd.get(), POLLIN);
+        int readdedToken{-1};
+
+        std::vector<int> activated;
+        worker.activated = [&](int token)
+        {
+            activated.push_back(token);
+            if(readdedToken < 0)
+            {
+                // Swap out whichever watch wasn't activated
+                int otherToken = (token == firstToken) ? secondToken : firstToken;
+                int otherFd = (token == firstToken) ? second.readEnd.get() : first.readEnd.get();
+                worker.removeFd(otherToken);
+                readdedToken = worker.addFd(otherFd, POLLIN);
+                QCOMPARE(readdedToken, otherToken);
+            }
+        };
+
+        signal(first);
+        signal(second);
+        worker.pollFds();
+        QCOMPARE(activated.size(), std::size_t{1});
+
+        // The re-added watch is activated by the next wait
+        activated.clear();
+        worker.pollFds();
+        QCOMPARE(activated.size(), std::size_t{2});
+        QVERIFY(std::find(activated.begin(), activated.end(), readdedToken) != activated.end());
+    }
+
+    void testNoFds()
+    {
+        PollWorker worker;
+        QVERIFY_EXCEPTION_THROWN(worker.pollFds(), std::runtime_error);
+    }
+
+    // PollThread handles work items through its signal pipe
+    void testPollThread()
+    {
+        int handled{0};
+        {
+            kapps::core::PollThread thread{[&](kapps::core::Any){++handled;}};
+            for(int i=0; i<100; ++i)
+                thread.enqueue(kapps::core::Any{i});
+            thread.syncInvoke([&]{handled += 100;});
+        }
+        QCOMPARE(handled, 200);
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_pollworker)
+#include TEST_MOC
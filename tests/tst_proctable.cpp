@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <QtTest>
+#include <kapps_net/src/linux/linux_proc_table.h>
+#include <kapps_net/src/linux/linux_proc_fs.h>
+#include <unistd.h>
+
+namespace kapps::net {
+class tst_proctable : public QObject
+{
+    Q_OBJECT
+
+    // Pids used for fake processes - these are never read from /proc when
+    // their parent is known.  (They're above the largest possible pid_max, so
+    // they can't be running.)
+    enum : pid_t
+    {
+        FakeChild = 4194310,
+        FakeGrandchild = 4194311,
+    };
+
+    std::string selfPath() const {return ProcFs::pathForPid(getpid());}
+
+private slots:
+    void testRebuild()
+    {
+        ProcessTable table;
+        table.rebuild();
+        QVERIFY(table.pidsForPath(selfPath()).count(getpid()));
+        QVERIFY(table.childPidsOf(getppid()).count(getpid()));
+    }
+
+    void testExec()
+    {
+        ProcessTable table;
+        QCOMPARE(table.exec(getpid()), selfPath());
+        QVERIFY(table.pidsForPath(selfPath()).count(getpid()));
+        QCOMPARE(table.size(), 1u);
+    }
+
+    // Forked children inherit the parent's path and are linked to the parent
+    void testFork()
+    {
+        ProcessTable table;
+        table.exec(getpid());
+        table.fork(getpid(), FakeChild);
+        table.fork(FakeChild, FakeGrandchild);
+
+        auto pids = table.pidsForPath(selfPath());
+        QCOMPARE(pids.size(), 3u);
+        QVERIFY(pids.count(FakeChild));
+        QVERIFY(pids.count(FakeGrandchild));
+        QCOMPARE(table.childPidsOf(getpid()), std::unordered_set<pid_t>{FakeChild});
+        QCOMPARE(table.childPidsOf(FakeChild), std::unordered_set<pid_t>{FakeGrandchild});
+    }
+
+    // Exiting removes the process from its path and parent, and orphans its
+    // children
+    void testExit()
+    {
+        ProcessTable table;
+        table.exec(getpid());
+        table.fork(getpid(), FakeChild);
+        table.fork(FakeChild, FakeGrandchild);
+
+        table.exit(FakeChild);
+        QVERIFY(!table.pidsForPath(selfPath()).count(FakeChild));
+        QVERIFY(table.childPidsOf(getpid()).empty());
+        QVERIFY(table.childPidsOf(FakeChild).empty());
+        QVERIFY(table.pidsForPath(selfPath()).count(FakeGrandchild));
+
+        table.exit(FakeGrandchild);
+        QCOMPARE(table.pidsForPath(selfPath()), std::unordered_set<pid_t>{getpid()});
+    }
+
+    // An exec() for a process that can't be read (it already exited) drops it
+    void testExecExited()
+    {
+        ProcessTable table;
+        table.exec(getpid());
+        table.fork(getpid(), FakeChild);
+
+        QVERIFY(table.exec(FakeChild).empty());
+        QVERIFY(!table.pidsForPath(selfPath()).count(FakeChild));
+        QVERIFY(table.childPidsOf(getpid()).empty());
+    }
+
+    void testUnknownPath()
+    {
+        ProcessTable table;
+        table.exec(getpid());
+        QVERIFY(table.pidsForPath("/nonexistent/app").empty());
+        QVERIFY(table.childPidsOf(FakeChild).empty());
+    }
+};
+}
+
+QTEST_GUILESS_MAIN(kapps::net::tst_proctable)
+#include TEST_MOC
@@ -18,6 +18,8 @@
 
 #include <kapps_regions/src/regionlist.h>
 #include <kapps_regions/src/metadata.h>
+#include <kapps_regions/src/regionlistdiff.h>
+#include <kapps_regions/regionlist.h>
 #include <kapps_core/src/logger.h>
 #include "src/testresource.h"
 #include <QtTest>
@@ -739,6 +741,131 @@ private slots:
         QCOMPARE(pUsChicago->name().getLanguageText({"zh-Hans"}), "芝加哥");
         QCOMPARE(pUsChicago->name().getLanguageText({"zh-Hant"}), "芝加哥");
     }
+
+    // Diff two region lists - regions are matched by ID, and changes to any
+    // server or service are detected
+    void testDiff()
+    {
+        auto buildList = [this](core::StringSlice chicagoPorts,
+                                core::StringSlice lastRegion)
+        {
+            std::string json = R"({
+              "service_configs": [
+                {"name":"traffic1", "services":[{"service":"wireguard", "ports":[)";
+            json += chicagoPorts.to_string();
+            json += R"(]}]},
+                {"name":"meta", "services":[{"service":"meta", "ports":[443]}]}
+              ],
+              "regions": [
+                {"id":"us_chicago", "auto_region":true, "port_forward":false, "geo":false,
+                 "servers":[{"ip":"154.21.23.79", "cn":"chicago412", "service_config":"traffic1"}]},
+                {"id":"spain", "auto_region":true, "port_forward":true, "geo":false,
+                 "servers":[{"ip":"212.102.49.78", "cn":"madrid401", "service_config":"meta"}]},
+                {"id":")";
+            json += lastRegion.to_string();
+            json += R"(", "auto_region":true, "port_forward":true, "geo":false,
+                 "servers":[{"ip":"179.61.228.124", "cn":"perth404", "service_config":"meta"}]}
+              ]
+            })";
+            return parseJson(json);
+        };
+
+        auto original = buildList("1337", "aus_perth");
+        QVERIFY(diffRegionLists(original, buildList("1337", "aus_perth")).empty());
+
+        auto diff = diffRegionLists(original, buildList("1337,51820", "aus_sydney"));
+        QCOMPARE(diff.added, std::vector<std::string>{"aus_sydney"});
+        QCOMPARE(diff.removed, std::vector<std::string>{"aus_perth"});
+        QCOMPARE(diff.changed, std::vector<std::string>{"us_chicago"});
+
+        // The version only changes when the content does
+        QCOMPARE(buildList("1337", "aus_perth").version(), original.version());
+        QVERIFY(buildList("1337,51820", "aus_perth").version() != original.version());
+        QVERIFY(buildList("1337", "aus_sydney").version() != original.version());
+        QCOMPARE(RegionList{}.version(), std::uint64_t{0});
+    }
+
+    // Bulk exports through the C API give the same data as the accessors
+    void testBulkExport()
+    {
+        QByteArray regionsJson = R"({
+          "service_configs": [
+            {"name":"traffic1", "services":[{"service":"wireguard", "ports":[1337]},
+                                            {"service":"openvpn_udp", "ports":[8080,853], "ncp":true}]},
+            {"name":"meta", "services":[{"service":"meta", "ports":[443]}]}
+          ],
+          "regions": [
+            {"id":"us_chicago", "auto_region":true, "port_forward":false, "geo":false,
+             "servers":[{"ip":"154.21.23.79", "cn":"chicago412", "service_config":"traffic1"},
+                        {"ip":"154.21.23.80", "cn":"chicago413", "service_config":"meta"}]},
+            {"id":"spain", "auto_region":true, "port_forward":true, "geo":false,
+             "servers":[{"ip":"212.102.49.78", "cn":"madrid401", "service_config":"meta"}]}
+          ]
+        })";
+        const KARRegionList *pList = KARRegionListCreate({regionsJson.data(), static_cast<size_t>(regionsJson.size())},
+                                                         {}, nullptr, 0, nullptr, 0);
+        QVERIFY(pList);
+        QVERIFY(KARRegionListVersion(pList) != 0);
+
+        QCOMPARE(KARRegionListExportRegions(pList, nullptr, 0), size_t{2});
+        std::vector<KARRegionInfo> regions(2);
+        QCOMPARE(KARRegionListExportRegions(pList, regions.data(), regions.size()), size_t{2});
+        QCOMPARE(KARRegionListExportServers(pList, nullptr, 0), size_t{3});
+        std::vector<KARServerInfo> servers(3);
+        QCOMPARE(KARRegionListExportServers(pList, servers.data(), servers.size()), size_t{3});
+
+        KACArraySlice regionPtrs = KARRegionListRegions(pList);
+        for(size_t i=0; i<regions.size(); ++i)
+        {
+            const auto &region = regions[i];
+            QCOMPARE(region.pRegion, reinterpret_cast<const KARRegion * const *>(regionPtrs.data)[i]);
+            QCOMPARE(core::fromApi(region.id), core::fromApi(KARRegionId(region.pRegion)));
+            QCOMPARE(region.portForward, KARRegionPortForward(region.pRegion));
+            QCOMPARE(region.serverCount, KARRegionServers(region.pRegion).size);
+            for(size_t s=region.firstServer; s<region.firstServer+region.serverCount; ++s)
+                QCOMPARE(servers[s].regionIndex, i);
+        }
+
+        auto itChicago = std::find_if(regions.begin(), regions.end(), [](const auto &region)
+        {
+            return core::fromApi(region.id) == "us_chicago";
+        });
+        QVERIFY(itChicago != regions.end());
+        const auto &chicago412 = servers[itChicago->firstServer];
+        QCOMPARE(core::fromApi(chicago412.commonName), "chicago412");
+        QCOMPARE(chicago412.services, KAR_SERVICE_FLAG(KARServiceWireGuard) |
+                                      KAR_SERVICE_FLAG(KARServiceOpenVpnUdp));
+        QCOMPARE(chicago412.openVpnUdpPorts.size, size_t{2});
+        QVERIFY(chicago412.openVpnUdpNcp);
+        QCOMPARE(chicago412.wireGuardPorts.size, size_t{1});
+        QCOMPARE(chicago412.metaPorts.size, size_t{0});
+
+        // Exports stop at the capacity given
+        KARServerInfo firstServer{};
+        QCOMPARE(KARRegionListExportServers(pList, &firstServer, 1), size_t{3});
+        QCOMPARE(firstServer.pServer, servers[0].pServer);
+
+        KARRegionListDestroy(pList);
+    }
+
+    // A regions image reproduces the list it was written from, and it's
+    // rejected if the tag doesn't match
+    void testImage()
+    {
+        QByteArray regionsv6 = TestResource::load(QStringLiteral(":/regions-v6.json"));
+        ImageWriter writer{"tag"};
+        RegionList original{RegionList::PIAv6, regionsv6.data(), {}, {}, {}, &writer};
+
+        ImageReader reader{writer.data(), "tag"};
+        RegionList loaded{reader, {}, {}};
+        QVERIFY(reader.atEnd());
+        QCOMPARE(loaded.regions().size(), original.regions().size());
+        QVERIFY(diffRegionLists(original, loaded).empty());
+        QCOMPARE(loaded.publicDnsServers(), original.publicDnsServers());
+
+        QVERIFY_EXCEPTION_THROWN((ImageReader{writer.data(), "other"}),
+                                 std::exception);
+    }
 };
 
 }
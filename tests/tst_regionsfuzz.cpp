@@ -0,0 +1,337 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/locations.h>
+#include <kapps_regions/src/regionlist.h>
+#include <kapps_regions/src/metadata.h>
+#include "src/regionscorpus.h"
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <string>
+
+/*
+
+=== Regions fuzz tests ===
+
+The regions list and metadata are downloaded from the network, and the regions
+image is stored in the daemon's data, so none of these can be trusted to be
+valid.  These tests mutate the recorded regions corpus from tests/res and
+check that parsing either succeeds or throws a std::exception - never crashes,
+hangs, or trips a sanitizer.
+
+- Text mutations (flipped bytes, deleted/duplicated ranges, inserted JSON
+  tokens, truncation) exercise the JSON parsers.
+- Structural mutations replace, remove, or duplicate values in otherwise valid
+  JSON, which exercises the regions list and metadata interpretation.  When
+  these are accepted, the locations are also built from the regions image and
+  grouped/indexed like the daemon does.
+- Image mutations corrupt a valid regions image, which exercises ImageReader.
+
+The mutations are deterministic for a given seed so failures are reproducible.
+Set REGIONS_FUZZ_ITERATIONS to run more iterations (the default is quick
+enough for the unit tests), and REGIONS_FUZZ_SEED to vary the seed.
+
+*/
+
+namespace
+{
+    int envInt(const char *name, int defaultValue)
+    {
+        bool ok{false};
+        int value = qEnvironmentVariableIntValue(name, &ok);
+        return ok ? value : defaultValue;
+    }
+
+    const int iterations = envInt("REGIONS_FUZZ_ITERATIONS", 200);
+    const std::uint32_t baseSeed = static_cast<std::uint32_t>(envInt("REGIONS_FUZZ_SEED", 0));
+
+    // Pick a random index in [0, size)
+    std::size_t randomIndex(std::mt19937 &rng, std::size_t size)
+    {
+        return std::uniform_int_distribution<std::size_t>{0, size-1}(rng);
+    }
+
+    // Apply 1-4 random text mutations to a JSON document
+    std::string mutateText(std::string text, std::mt19937 &rng)
+    {
+        static const char *tokens[]{"\"", "{", "}", "[", "]", ",", ":", "null",
+                                    "true", "-1", "65536", "1e999", "\"\""};
+
+        int edits = 1 + static_cast<int>(rng() % 4);
+        for(int i = 0; i < edits && !text.empty(); ++i)
+        {
+            std::size_t pos = randomIndex(rng, text.size());
+            switch(rng() % 5)
+            {
+            case 0: // Flip a byte
+                text[pos] = static_cast<char>(rng());
+                break;
+            case 1: // Delete a range
+                text.erase(pos, 1 + rng() % 64);
+                break;
+            case 2: // Duplicate a range
+                text.insert(pos, text.substr(pos, 1 + rng() % 64));
+                break;
+            case 3: // Insert a JSON token
+                text.insert(pos, tokens[randomIndex(rng, std::size(tokens))]);
+                break;
+            case 4: // Truncate
+                text.resize(pos);
+                break;
+            }
+        }
+        return text;
+    }
+
+    QJsonValue randomValue(std::mt19937 &rng)
+    {
+        switch(rng() % 9)
+        {
+        case 0: return QJsonValue::Null;
+        case 1: return true;
+        case 2: return -1;
+        case 3: return 65536;
+        case 4: return 1e300;
+        case 5: return QString{};
+        case 6: return QStringLiteral("x");
+        case 7: return QJsonArray{};
+        default: return QJsonObject{};
+        }
+    }
+
+    // Replace, remove, or duplicate a random value nested somewhere in value
+    void mutateValue(QJsonValue &value, std::mt19937 &rng)
+    {
+        if(value.isObject() && !value.toObject().isEmpty() && rng() % 4 != 0)
+        {
+            QJsonObject obj = value.toObject();
+            auto it = obj.begin() + static_cast<qsizetype>(randomIndex(rng, obj.size()));
+            if(rng() % 6 == 0)
+                obj.erase(it);
+            else
+            {
+                QJsonValue child = it.value();
+                mutateValue(child, rng);
+                it.value() = child;
+            }
+            value = obj;
+        }
+        else if(value.isArray() && !value.toArray().isEmpty() && rng() % 4 != 0)
+        {
+            QJsonArray arr = value.toArray();
+            auto idx = static_cast<qsizetype>(randomIndex(rng, arr.size()));
+            switch(rng() % 6)
+            {
+            case 0:
+                arr.removeAt(idx);
+                break;
+            case 1:
+                arr.append(arr.at(idx));
+                break;
+            default:
+            {
+                QJsonValue child = arr.at(idx);
+                mutateValue(child, rng);
+                arr.replace(idx, child);
+                break;
+            }
+            }
+            value = arr;
+        }
+        else
+            value = randomValue(rng);
+    }
+
+    QJsonObject mutateObject(const QJsonObject &obj, std::mt19937 &rng)
+    {
+        QJsonValue value{obj};
+        mutateValue(value, rng);
+        // The root could have been replaced with a non-object; that's
+        // equivalent to an empty object for the callers
+        return value.toObject();
+    }
+}
+
+class tst_regionsfuzz : public QObject
+{
+    Q_OBJECT
+
+private:
+    QJsonObject _regionsObj, _metadataObj;
+    std::string _regionsJson, _metadataJson;
+
+    // Parse the text forms; returns true if accepted, false if rejected
+    bool parseText(const std::string &regionsJson, const std::string &metadataJson)
+    {
+        try
+        {
+            kapps::regions::RegionList regionList{kapps::regions::RegionList::PIAv6,
+                                                  regionsJson, {}, {}, {}};
+            kapps::regions::Metadata metadata{regionsJson, metadataJson, {}, {}};
+            return true;
+        }
+        catch(const std::exception &)
+        {
+            return false;
+        }
+    }
+
+private slots:
+    void initTestCase()
+    {
+        _regionsObj = RegionsCorpus::regions();
+        _metadataObj = RegionsCorpus::metadata();
+        QVERIFY(!_regionsObj.isEmpty());
+        QVERIFY(!_metadataObj.isEmpty());
+        _regionsJson = QJsonDocument{_regionsObj}.toJson(QJsonDocument::Compact).toStdString();
+        _metadataJson = QJsonDocument{_metadataObj}.toJson(QJsonDocument::Compact).toStdString();
+        qInfo() << "Fuzzing with" << iterations << "iterations, seed" << baseSeed;
+    }
+
+    // The unmodified corpus must be accepted, otherwise the other tests would
+    // only be testing rejection
+    void testCorpusValid()
+    {
+        QVERIFY(parseText(_regionsJson, _metadataJson));
+    }
+
+    void testTextMutations()
+    {
+        int accepted{0};
+        for(int i = 0; i < iterations; ++i)
+        {
+            std::mt19937 rng{baseSeed + static_cast<std::uint32_t>(i)};
+            // Mutate one of the documents at a time, so the other one doesn't
+            // cause the whole attempt to be rejected
+            if(rng() % 2)
+                accepted += parseText(mutateText(_regionsJson, rng), _metadataJson);
+            else
+                accepted += parseText(_regionsJson, mutateText(_metadataJson, rng));
+        }
+        qInfo() << "Text mutations:" << accepted << "accepted," << (iterations - accepted) << "rejected";
+    }
+
+    void testStructuralMutations()
+    {
+        int accepted{0};
+        for(int i = 0; i < iterations; ++i)
+        {
+            std::mt19937 rng{baseSeed + static_cast<std::uint32_t>(i)};
+            QJsonObject regionsObj{_regionsObj}, metadataObj{_metadataObj};
+            int edits = 1 + static_cast<int>(rng() % 3);
+            for(int e = 0; e < edits; ++e)
+            {
+                if(rng() % 2)
+                    regionsObj = mutateObject(regionsObj, rng);
+                else
+                    metadataObj = mutateObject(metadataObj, rng);
+            }
+
+            LatencyMap latencies = RegionsCorpus::buildLatencies(regionsObj);
+            QByteArray image;
+            QString imageTag;
+            std::pair<LocationsById, kapps::regions::Metadata> locations;
+            try
+            {
+                locations = buildModernLocations(latencies, regionsObj, {},
+                                                 metadataObj, {}, {}, &image,
+                                                 &imageTag);
+            }
+            catch(const std::exception &)
+            {
+                continue;
+            }
+            ++accepted;
+
+            // Whatever was accepted must round-trip through the image
+            auto imageLocations = buildModernLocationsFromImage(latencies, image,
+                                                                imageTag, {}, {});
+            QCOMPARE(imageLocations.first.size(), locations.first.size());
+            for(const auto &[id, pLocation] : locations.first)
+                QVERIFY(imageLocations.first.count(id));
+
+            // And the consumers of the locations must handle it
+            std::vector<CountryLocations> grouped;
+            std::vector<QSharedPointer<const Location>> dipLocations;
+            buildGroupedLocations(locations.first, locations.second, grouped,
+                                  dipLocations);
+            NearestLocations nearest{locations.first};
+            nearest.getNearestSafeVpnLocation(true);
+            nearest.getBestLocationForService(Service::Shadowsocks);
+        }
+        qInfo() << "Structural mutations:" << accepted << "accepted," << (iterations - accepted) << "rejected";
+    }
+
+    void testImageMutations()
+    {
+        LatencyMap latencies = RegionsCorpus::buildLatencies(_regionsObj);
+        QByteArray image;
+        QString imageTag;
+        buildModernLocations(latencies, _regionsObj, {}, _metadataObj, {}, {},
+                             &image, &imageTag);
+        QVERIFY(!image.isEmpty());
+
+        int accepted{0};
+        for(int i = 0; i < iterations; ++i)
+        {
+            std::mt19937 rng{baseSeed + static_cast<std::uint32_t>(i)};
+            QByteArray corrupt{image};
+            int edits = 1 + static_cast<int>(rng() % 3);
+            for(int e = 0; e < edits && !corrupt.isEmpty(); ++e)
+            {
+                auto pos = static_cast<qsizetype>(randomIndex(rng, corrupt.size()));
+                switch(rng() % 3)
+                {
+                case 0: // Flip a bit
+                    corrupt[pos] = static_cast<char>(corrupt[pos] ^ (1 << (rng() % 8)));
+                    break;
+                case 1: // Truncate
+                    corrupt.truncate(pos);
+                    break;
+                case 2: // Overwrite a word, often with a huge size or offset
+                {
+                    std::uint32_t word = (rng() % 2) ? 0xFFFFFFFFu : static_cast<std::uint32_t>(rng());
+                    pos &= ~qsizetype{3};
+                    if(pos + 4 <= corrupt.size())
+                        std::memcpy(corrupt.data() + pos, &word, sizeof(word));
+                    break;
+                }
+                }
+            }
+
+            try
+            {
+                buildModernLocationsFromImage(latencies, corrupt, imageTag, {}, {});
+                ++accepted;
+            }
+            catch(const std::exception &)
+            {
+            }
+        }
+        qInfo() << "Image mutations:" << accepted << "accepted," << (iterations - accepted) << "rejected";
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_regionsfuzz)
+#include TEST_MOC
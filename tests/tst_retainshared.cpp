@@ -17,6 +17,7 @@
 // <https://www.gnu.org/licenses/>.
 
 #include <kapps_core/src/retainshared.h>
+#include <kapps_core/src/arena.h>
 #include <kapps_core/src/logger.h>
 #include <QtTest>
 
@@ -329,6 +330,34 @@ private slots:
         auto p = std::make_unique<RetainedValue>();
         QVERIFY_EXCEPTION_THROWN(p->release(), std::exception);
     }
+
+    // Objects allocated in an Arena can be retained, and the arena remains
+    // valid until the last object is released
+    void testArenaRetain()
+    {
+        QCOMPARE(RetainedValue::instanceCount(), 0);
+        auto pArena = std::make_shared<Arena>();
+        std::weak_ptr<Arena> pWeakArena{pArena};
+        auto p = makeArenaShared<RetainedValue>(pArena, 5);
+        auto p2 = makeArenaShared<RetainedValue>(pArena, 6);
+        QCOMPARE(RetainedValue::instanceCount(), 2);
+        QVERIFY(pArena->bytesUsed() >= 2 * sizeof(RetainedValue));
+        QCOMPARE(pArena->chunkCount(), 1u);
+
+        const RetainedValue *pRaw = p.get();
+        pRaw->retain();
+        pArena.reset();
+        p.reset();
+        p2.reset();
+        // Still alive due to the API reference
+        QCOMPARE(RetainedValue::instanceCount(), 1);
+        QVERIFY(!pWeakArena.expired());
+        QCOMPARE(pRaw->value(), 5);
+
+        pRaw->release();
+        QCOMPARE(RetainedValue::instanceCount(), 0);
+        QVERIFY(pWeakArena.expired());
+    }
 };
 
 };
@@ -481,6 +481,54 @@ private slots:
           QCOMPARE(actualContent, expectedContent);
     }
   }
+
+  void testResolvesTableIds()
+  {
+      // Existing tables keep their IDs, new tables get the IDs they were
+      // appended with
+      {
+          QTemporaryFile etcFile;
+          QVERIFY(etcFile.open());
+          {
+              QTextStream out(&etcFile);
+              out << "100\ttable1\n";
+              out << "120\tpiavpnOnlyrt\n";
+          }
+
+          RtTablesInitializer rt{"pia", {etcFile.fileName().toStdString(), {"libPathNotProvided"}} };
+          QVERIFY(rt.install());
+
+          std::map<std::string, std::uint32_t> expectedIds{
+              {"piavpnrt", 121},
+              {"piavpnOnlyrt", 120},
+              {"piavpnWgrt", 122},
+              {"piavpnFwdrt", 123},
+          };
+          QVERIFY(rt.tableIds() == expectedIds);
+      }
+
+      // If the etc file can't be created, IDs are still assigned (from the
+      // fallback file), but install() reports the failure
+      {
+          QTemporaryFile libFile;
+          QVERIFY(libFile.open());
+          {
+              QTextStream out(&libFile);
+              out << "500\ttable2\n";
+          }
+
+          RtTablesInitializer rt{"pia", {"/proc/self/rt_tables_dir/rt_tables", {libFile.fileName().toStdString()}} };
+          QVERIFY(!rt.install());
+
+          std::map<std::string, std::uint32_t> expectedIds{
+              {"piavpnrt", 501},
+              {"piavpnOnlyrt", 502},
+              {"piavpnWgrt", 503},
+              {"piavpnFwdrt", 504},
+          };
+          QVERIFY(rt.tableIds() == expectedIds);
+      }
+  }
 };
 }
 
@@ -19,6 +19,8 @@
 #include <common/src/common.h>
 #include <QtTest>
 #include <QString>
+#include <QJsonArray>
+#include <QJsonObject>
 #include "extras/openvpn/mac/scutil_parser.h"
 
 class tst_scutilparse : public QObject
@@ -107,6 +109,32 @@ private slots:
         QCOMPARE(betaValue, "b");
         QCOMPARE(gammaValue, "g");
     }
+
+    void testSplitMultipleResults()
+    {
+        // Output of "show" for a key that exists, one that doesn't, and a
+        // dictionary with nested containers
+        const QString scutilText = "<dictionary> {\n  PrimaryService : ABC\n}\n"
+            "  No such key\n"
+            "<dictionary> {\n  Addresses : <array> {\n    0 : 192.168.1.41\n  }\n  Nested : <dictionary> {\n    key : value\n  }\n}\n";
+        auto results = scutilSplit(scutilText);
+
+        QCOMPARE(results.size(), 3);
+        QCOMPARE(scutilParse(results[0]).toObject().value("PrimaryService").toString(), "ABC");
+        QCOMPARE(scutilParse(results[1]), QJsonValue::Null);
+        auto third = scutilParse(results[2]).toObject();
+        QCOMPARE(third.value("Addresses").toArray()[0].toString(), "192.168.1.41");
+        QCOMPARE(third.value("Nested").toObject().value("key").toString(), "value");
+    }
+
+    void testSplitIncompleteResult()
+    {
+        const QString scutilText = "<dictionary> {\n  PrimaryService : ABC\n}\n<dictionary> {\n  Foo : bar\n";
+        auto results = scutilSplit(scutilText);
+
+        QCOMPARE(results.size(), 2);
+        QCOMPARE(scutilParse(results[1]), QJsonValue::Undefined);
+    }
 };
 
 QTEST_GUILESS_MAIN(tst_scutilparse)
@@ -494,6 +494,42 @@ private slots:
         QVERIFY(pAlUpd);
         QCOMPARE(pAlUpd->latency().get(), alLatency);
     }
+
+    // Unchanged locations are reused from the previous generation, changed
+    // ones are rebuilt
+    void reusePreviousLocations()
+    {
+        LatencyMap latencies;
+        latencies["al"] = 121.0;
+
+        LocationsById previousLocs{buildModernLocations(latencies,
+            sample_docs::twoLocations, {}, sample_docs::metadataJson, {},
+            {}).first};
+        QVERIFY(previousLocs.size() == 2);
+
+        // Same lists and latencies - the same objects are used
+        LocationsById sameLocs{buildModernLocations(latencies,
+            sample_docs::twoLocations, {}, sample_docs::metadataJson, {},
+            {}, nullptr, nullptr, &previousLocs).first};
+        QVERIFY(sameLocs == previousLocs);
+
+        // Change one latency - only that location is rebuilt
+        latencies["al"] = 97.0;
+        LocationsById updatedLocs{buildModernLocations(latencies,
+            sample_docs::twoLocations, {}, sample_docs::metadataJson, {},
+            {}, nullptr, nullptr, &previousLocs).first};
+        QVERIFY(updatedLocs.size() == 2);
+        for(const auto &locEntry : updatedLocs)
+        {
+            if(locEntry.first == "al")
+            {
+                QVERIFY(locEntry.second != previousLocs.at("al"));
+                QCOMPARE(locEntry.second->latency().get(), 97.0);
+            }
+            else
+                QVERIFY(locEntry.second == previousLocs.at(locEntry.first));
+        }
+    }
 };
 #undef COMMA
 QTEST_GUILESS_MAIN(tst_settings)
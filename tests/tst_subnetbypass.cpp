@@ -409,6 +409,38 @@ private slots:
         verifyMethodCalledInOrder(1, "removeRoute4", "192.168.1.0/24", oldParams.netScan.gatewayIp(), oldParams.netScan.interfaceName(), recorder->methodCalls());
         verifyMethodCalledInOrder(2, "addRoute4", "192.168.1.0/24", params.netScan.gatewayIp(), params.netScan.interfaceName(), recorder->methodCalls());
     }
+
+    void testAggregatedSubnets()
+    {
+        MethodRecorder *recorder{nullptr};
+
+        FirewallParams params{validFirewallParams()};
+        // Siblings, a contained subnet, and a subnet with host bits set
+        params.bypassIpv4Subnets = std::set<std::string> { "10.0.0.0/25", "10.0.0.128/25", "10.0.0.5/32", "192.168.1.7/24" };
+        params.bypassIpv6Subnets = std::set<std::string> { "2001:db8::/33", "2001:db8:8000::/33", "2001:cafe::1/128" };
+
+        SubnetBypass bypass{createRouteManager(recorder)};
+        bypass.updateRoutes(params);
+
+        QVERIFY(recorder->methodCalls().size() == 4);
+        verifyMethodCall("addRoute4", "10.0.0.0/24", params.netScan.gatewayIp(), params.netScan.interfaceName(), recorder->methodCalls());
+        verifyMethodCall("addRoute4", "192.168.1.0/24", params.netScan.gatewayIp(), params.netScan.interfaceName(), recorder->methodCalls());
+        verifyMethodCall("addRoute6", "2001:db8::/32", params.netScan.gatewayIp6(), params.netScan.interfaceName(), recorder->methodCalls());
+        verifyMethodCall("addRoute6", "2001:cafe::1/128", params.netScan.gatewayIp6(), params.netScan.interfaceName(), recorder->methodCalls());
+
+        // Adding a subnet that's already covered doesn't change any routes
+        recorder->reset();
+        params.bypassIpv4Subnets.insert("10.0.0.64/26");
+        bypass.updateRoutes(params);
+        QVERIFY(recorder->methodCalls().size() == 0);
+
+        // Removing one half of a merged pair replaces the aggregate route
+        params.bypassIpv4Subnets = std::set<std::string> { "10.0.0.0/25", "192.168.1.0/24" };
+        bypass.updateRoutes(params);
+        QVERIFY(recorder->methodCalls().size() == 2);
+        verifyMethodCalledInOrder(0, "removeRoute4", "10.0.0.0/24", params.netScan.gatewayIp(), params.netScan.interfaceName(), recorder->methodCalls());
+        verifyMethodCalledInOrder(1, "addRoute4", "10.0.0.0/25", params.netScan.gatewayIp(), params.netScan.interfaceName(), recorder->methodCalls());
+    }
  };
 
 QTEST_GUILESS_MAIN(tst_subnetbypass)
@@ -0,0 +1,111 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <kapps_core/src/subnettrie.h>
+#include <QtTest>
+
+using namespace kapps::core;
+
+namespace
+{
+    std::vector<std::string> toStrings(const std::vector<Ipv4Subnet> &subnets)
+    {
+        std::vector<std::string> result;
+        for(const auto &subnet : subnets)
+            result.push_back(qs::format("%/%", subnet.address(), subnet.prefix()));
+        return result;
+    }
+
+    Ipv4SubnetSet ipv4Set(std::initializer_list<const char *> subnets)
+    {
+        Ipv4SubnetSet set;
+        for(const auto &subnet : subnets)
+            set.insert(Ipv4Subnet{subnet});
+        return set;
+    }
+}
+
+class tst_subnettrie : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testLongestMatch()
+    {
+        auto set = ipv4Set({"10.0.0.0/8", "192.168.0.0/16", "192.168.1.0/24",
+                            "192.168.1.7/32"});
+
+        QVERIFY(set.contains(Ipv4Address{10, 1, 2, 3}));
+        QVERIFY(!set.contains(Ipv4Address{11, 0, 0, 1}));
+        QCOMPARE(set.longestMatch(Ipv4Address{192, 168, 1, 7}).get().prefix(), 32u);
+        QCOMPARE(set.longestMatch(Ipv4Address{192, 168, 1, 8}).get().prefix(), 24u);
+        QVERIFY(set.longestMatch(Ipv4Address{192, 168, 1, 8}).get() ==
+                (Ipv4Subnet{Ipv4Address{192, 168, 1, 0}, 24}));
+        QCOMPARE(set.longestMatch(Ipv4Address{192, 168, 2, 1}).get().prefix(), 16u);
+        QVERIFY(!set.longestMatch(Ipv4Address{172, 16, 0, 1}));
+
+        // The default route matches everything
+        set.insert(Ipv4Subnet{"0.0.0.0/0"});
+        QCOMPARE(set.longestMatch(Ipv4Address{172, 16, 0, 1}).get().prefix(), 0u);
+    }
+
+    void testAggregate()
+    {
+        auto set = ipv4Set({"10.0.0.0/25", "10.0.0.128/25", "10.0.1.0/24",
+                            "10.0.1.64/26", "192.168.1.0/24"});
+        QCOMPARE(toStrings(set.aggregate()),
+                 (std::vector<std::string>{"10.0.0.0/23", "192.168.1.0/24"}));
+        QVERIFY(Ipv4SubnetSet{}.aggregate().empty());
+    }
+
+    void testDifference()
+    {
+        auto set = ipv4Set({"10.0.0.0/24", "192.168.1.0/24"});
+        auto excluded = ipv4Set({"10.0.0.64/26", "192.168.0.0/16"});
+
+        QCOMPARE(toStrings(set.difference(excluded).aggregate()),
+                 (std::vector<std::string>{"10.0.0.0/26", "10.0.0.128/25"}));
+        QVERIFY(excluded.difference(excluded).empty());
+        QCOMPARE(toStrings(excluded.difference(Ipv4SubnetSet{}).aggregate()),
+                 toStrings(excluded.aggregate()));
+    }
+
+    void testIpv6()
+    {
+        Ipv6SubnetSet set;
+        set.insert(Ipv6Subnet{"fc00::/7"});
+        set.insert(Ipv6Subnet{"fe80::/10"});
+
+        QVERIFY(set.contains(Ipv6Address{0xfd12, 0, 0, 0, 0, 0, 0, 1}));
+        QVERIFY(!set.contains(Ipv6Address{0x2001, 0xdb8, 0, 0, 0, 0, 0, 1}));
+        auto match = set.longestMatch(Ipv6Address{0xfe80, 0, 0, 0, 0, 0, 0, 1});
+        QVERIFY(match);
+        QVERIFY(match.get() == (Ipv6Subnet{Ipv6Address{0xfe80}, 10}));
+
+        Ipv6SubnetSet excluded;
+        excluded.insert(Ipv6Subnet{"fd00::/8"});
+        auto remaining = set.difference(excluded).aggregate();
+        QCOMPARE(remaining.size(), std::size_t{2});
+        QVERIFY(remaining[0] == (Ipv6Subnet{Ipv6Address{0xfc00}, 8}));
+        QVERIFY(remaining[1] == (Ipv6Subnet{Ipv6Address{0xfe80}, 10}));
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_subnettrie)
+#include TEST_MOC
@@ -498,6 +498,34 @@ private slots:
         QVERIFY(result->isRejected());
         QCOMPARE(result->error().code(), Error::TaskRecipientDestroyed);
     }
+    void finishedParentReleased()
+    {
+        // Once a task has delivered its result to a chained task, the chained
+        // task no longer keeps it alive, even if it's still pending
+        auto innerTask = Async<int>::create();
+        auto sourceTask = Async<int>::create();
+        auto thenTask = sourceTask->then([&](int) { return innerTask; });
+        sourceTask->resolve(1);
+        sourceTask.reset();
+        QVERIFY(thenTask->isPending());
+        QCOMPARE(BaseTask::getTaskCount(), 2);
+        innerTask->resolve(2);
+        QVERIFY(thenTask->isResolved());
+        QCOMPARE(thenTask->result(), 2);
+        innerTask.reset();
+        thenTask.reset();
+    }
+    void notifyFinishedTask()
+    {
+        // Continuations added to a finished task are delivered immediately
+        auto sourceTask = Async<int>::resolve(3);
+        auto thenTask = sourceTask->then(add);
+        QVERIFY(thenTask->isResolved());
+        QCOMPARE(thenTask->result(), 4);
+        thenTask.reset();
+        QCOMPARE(BaseTask::getTaskCount(), 1);
+        sourceTask.reset();
+    }
     void chainQueued()
     {
         auto root = Async<int>::create();
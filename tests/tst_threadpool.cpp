@@ -0,0 +1,134 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <kapps_core/src/threadpool.h>
+#include <QtTest>
+#include <array>
+#include <atomic>
+
+using ThreadPool = kapps::core::ThreadPool;
+using Strand = kapps::core::Strand;
+using Task = kapps::core::Task;
+
+class tst_threadpool : public QObject
+{
+    Q_OBJECT
+
+private:
+    void delay()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    }
+
+private slots:
+    void testTask()
+    {
+        // Move-only functors can be used, both inline and on the heap
+        int value{0};
+        auto pInt = std::make_unique<int>(3);
+        Task small{[&value, pInt = std::move(pInt)]{value += *pInt;}};
+        std::array<int, 64> big{};
+        big[63] = 4;
+        Task large{[&value, big]{value += big[63];}};
+
+        Task moved{std::move(small)};
+        QVERIFY(!small);
+        QVERIFY(moved);
+        moved();
+        large();
+        QCOMPARE(value, 7);
+
+        moved.clear();
+        QVERIFY(!moved);
+    }
+
+    void testStrandOrder()
+    {
+        std::vector<std::string> workedItems{};
+
+        // Strand tasks are serialized, and the Strand's destructor waits for
+        // them, so it's OK to capture workedItems by reference.
+        {
+            Strand strand{"test"};
+            strand.post([&]{delay(); workedItems.push_back("red");});
+            strand.post([&]{workedItems.push_back("orange");});
+            strand.post([&]{workedItems.push_back("yellow");});
+            strand.post([&]{workedItems.push_back("green");});
+        }
+
+        QCOMPARE(workedItems, (std::vector<std::string>{"red", "orange", "yellow", "green"}));
+    }
+
+    void testStrandManyTasks()
+    {
+        // More tasks than one turn runs, to exercise rescheduling
+        std::vector<int> workedItems{};
+        {
+            Strand strand{"test"};
+            for(int i=0; i<100; ++i)
+                strand.post([&workedItems, i]{workedItems.push_back(i);});
+        }
+
+        QCOMPARE(workedItems.size(), std::size_t{100});
+        for(int i=0; i<100; ++i)
+            QCOMPARE(workedItems[i], i);
+    }
+
+    void testSyncInvoke()
+    {
+        std::vector<std::string> workedItems{};
+
+        {
+            Strand strand{"test"};
+            strand.syncInvoke([&]{delay(); workedItems.push_back("red");});
+            workedItems.push_back("orange");
+            strand.syncInvoke([&]{delay(); workedItems.push_back("yellow");});
+            workedItems.push_back("green");
+
+            // Exceptions are re-thrown on the calling thread
+            QVERIFY_EXCEPTION_THROWN(strand.syncInvoke([]{throw std::runtime_error{"test"};}),
+                                     std::runtime_error);
+        }
+
+        QCOMPARE(workedItems, (std::vector<std::string>{"red", "orange", "yellow", "green"}));
+    }
+
+    void testThreadPool()
+    {
+        // Tasks posted from a worker are run too, including stolen ones
+        std::atomic<int> count{0};
+        {
+            ThreadPool pool{4};
+            for(int i=0; i<10; ++i)
+            {
+                pool.post([&]
+                {
+                    for(int j=0; j<10; ++j)
+                        pool.post([&]{++count;});
+                });
+            }
+            // Destructor runs everything queued before stopping
+        }
+
+        QCOMPARE(count.load(), 100);
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_threadpool)
+#include TEST_MOC
@@ -0,0 +1,128 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <QtTest>
+#include "daemon/src/throughputhistory.h"
+
+using namespace std::chrono_literals;
+
+class tst_throughputhistory : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Arbitrary base time, aligned to all resolutions
+    static constexpr qint64 base = 1'800'000'000'000;
+
+private slots:
+    void testFineResolution()
+    {
+        ThroughputHistory history;
+        history.addMeasurement(100, 10, base + 1000);
+        history.addMeasurement(200, 20, base + 6000);
+        history.addMeasurement(300, 30, base + 11000);
+
+        std::vector<ThroughputHistory::Sample> samples;
+        QVERIFY(history.query(5s, 0, samples));
+        QCOMPARE(samples.size(), 3u);
+        QCOMPARE(samples[0]._time, base);
+        QCOMPARE(samples[0]._received, 100ull);
+        QCOMPARE(samples[1]._time, base + 5000);
+        QCOMPARE(samples[2]._sent, 30ull);
+    }
+
+    void testAggregation()
+    {
+        ThroughputHistory history;
+        // 13 measurements 5 seconds apart - the first 12 land in one minute
+        for(int i=0; i<13; ++i)
+            history.addMeasurement(10, 1, base + i*5000);
+
+        std::vector<ThroughputHistory::Sample> samples;
+        QVERIFY(history.query(60s, 0, samples));
+        QCOMPARE(samples.size(), 2u);
+        QCOMPARE(samples[0]._time, base);
+        QCOMPARE(samples[0]._received, 120ull);
+        QCOMPARE(samples[0]._sent, 12ull);
+        QCOMPARE(samples[1]._time, base + 60000);
+        QCOMPARE(samples[1]._received, 10ull);
+
+        QVERIFY(history.query(600s, 0, samples));
+        QCOMPARE(samples.size(), 1u);
+        QCOMPARE(samples[0]._received, 130ull);
+    }
+
+    void testCapacity()
+    {
+        ThroughputHistory history;
+        // Add more than 30 minutes of 5-second measurements
+        const int count = 400;
+        for(int i=0; i<count; ++i)
+            history.addMeasurement(i, 0, base + i*5000);
+
+        std::vector<ThroughputHistory::Sample> samples;
+        QVERIFY(history.query(5s, 0, samples));
+        QCOMPARE(samples.size(), 360u);
+        // The oldest samples were dropped
+        QCOMPARE(samples.front()._time, base + (count-360)*5000);
+        QCOMPARE(samples.back()._received, static_cast<quint64>(count-1));
+    }
+
+    void testSince()
+    {
+        ThroughputHistory history;
+        for(int i=0; i<10; ++i)
+            history.addMeasurement(1, 1, base + i*5000);
+
+        std::vector<ThroughputHistory::Sample> samples;
+        QVERIFY(history.query(5s, base + 25000, samples));
+        QCOMPARE(samples.size(), 5u);
+        QCOMPARE(samples.front()._time, base + 25000);
+
+        QJsonArray json;
+        QVERIFY(history.queryJson(5s, base + 40000, json));
+        QCOMPARE(json.size(), 2);
+        QCOMPARE(json[0].toObject()[QStringLiteral("time")].toDouble(),
+                 static_cast<double>(base + 40000));
+        QCOMPARE(json[0].toObject()[QStringLiteral("received")].toDouble(), 1.0);
+    }
+
+    void testInvalidResolution()
+    {
+        ThroughputHistory history;
+        history.addMeasurement(1, 1, base);
+        std::vector<ThroughputHistory::Sample> samples;
+        QVERIFY(!history.query(30s, 0, samples));
+        QJsonArray json;
+        QVERIFY(!history.queryJson(1s, 0, json));
+    }
+
+    void testClear()
+    {
+        ThroughputHistory history;
+        history.addMeasurement(1, 1, base);
+        history.clear();
+        std::vector<ThroughputHistory::Sample> samples;
+        QVERIFY(history.query(5s, 0, samples));
+        QVERIFY(samples.empty());
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_throughputhistory)
+#include TEST_MOC
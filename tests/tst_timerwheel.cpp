@@ -0,0 +1,127 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/dtop.h>
+#include <kapps_core/src/timer.h>
+#include <QtTest>
+
+using Timer = kapps::core::Timer;
+using namespace std::chrono_literals;
+
+class tst_timerwheel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        initKApps();
+    }
+
+    void testOrder()
+    {
+        // Timers elapse in deadline order, regardless of the order they were
+        // set or which level of the wheel they start in
+        std::vector<int> elapsed;
+        std::vector<Timer> timers(4);
+        const std::array<std::chrono::milliseconds, 4> intervals{300ms, 10ms, 100ms, 0ms};
+        for(std::size_t i=0; i<timers.size(); ++i)
+        {
+            timers[i].elapsed = [&elapsed, i]{elapsed.push_back(static_cast<int>(i));};
+            timers[i].set(intervals[i], true);
+        }
+
+        QTRY_COMPARE(elapsed.size(), std::size_t{4});
+        QCOMPARE(elapsed, (std::vector<int>{3, 1, 2, 0}));
+        for(const auto &timer : timers)
+            QVERIFY(!timer.active());
+    }
+
+    void testCancel()
+    {
+        // Canceling a timer that's due at the same time as the one elapsing
+        // prevents it from elapsing
+        int firstCount{0}, secondCount{0};
+        Timer first, second;
+        first.elapsed = [&]{++firstCount; second.cancel();};
+        second.elapsed = [&]{++secondCount;};
+        first.set(20ms, true);
+        second.set(20ms, true);
+
+        QTRY_COMPARE(firstCount, 1);
+        QTest::qWait(100);
+        QCOMPARE(secondCount, 0);
+    }
+
+    void testRecurring()
+    {
+        int count{0};
+        Timer timer;
+        timer.elapsed = [&]
+        {
+            if(++count == 5)
+                timer.cancel();
+        };
+        timer.set(20ms, false, Timer::Precision::Coarse);
+
+        QTRY_COMPARE(count, 5);
+        QVERIFY(!timer.active());
+        QTest::qWait(100);
+        QCOMPARE(count, 5);
+    }
+
+    void testResetFromElapsed()
+    {
+        // A single-shot timer can be set again from its own elapsed signal
+        int count{0};
+        Timer timer;
+        timer.elapsed = [&]
+        {
+            if(++count < 3)
+                timer.set(10ms, true);
+        };
+        timer.set(10ms, true);
+
+        QTRY_COMPARE(count, 3);
+        QVERIFY(!timer.active());
+    }
+
+    void testLongInterval()
+    {
+        // Cancel a timer in a high level of the wheel, then check that short
+        // timers still work
+        Timer longTimer;
+        bool longElapsed{false};
+        longTimer.elapsed = [&]{longElapsed = true;};
+        longTimer.set(std::chrono::hours{48}, true);
+        QVERIFY(longTimer.active());
+
+        Timer shortTimer;
+        bool shortElapsed{false};
+        shortTimer.elapsed = [&]{shortElapsed = true;};
+        shortTimer.set(5000ms, true, Timer::Precision::Coarse);
+
+        longTimer.cancel();
+        QTRY_VERIFY_WITH_TIMEOUT(shortElapsed, 7000);
+        QVERIFY(!longElapsed);
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_timerwheel)
+#include TEST_MOC
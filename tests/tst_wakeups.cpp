@@ -0,0 +1,127 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <common/src/common.h>
+#include <common/src/dtop.h>
+#include <common/src/wakeupaccounting.h>
+#include <kapps_core/src/timer.h>
+#include <kapps_core/src/wakeups.h>
+#include <QtTest>
+
+using WakeupAccounting = kapps::core::WakeupAccounting;
+using WakeupScope = kapps::core::WakeupScope;
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Get the totals for a tag; wakeups is 0 if the tag hasn't been recorded
+    WakeupAccounting::Totals totalsFor(const std::string &tag)
+    {
+        for(const auto &[snapshotTag, totals] : WakeupAccounting::snapshot())
+        {
+            if(snapshotTag == tag)
+                return totals;
+        }
+        return {0, {}};
+    }
+
+    // Use some CPU time
+    void spin()
+    {
+        auto start = WakeupAccounting::threadCpuTime();
+        while(WakeupAccounting::threadCpuTime() - start < 5ms);
+    }
+}
+
+class tst_wakeups : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        initKApps();
+    }
+
+    void init()
+    {
+        WakeupAccounting::reset();
+    }
+
+    void testScope()
+    {
+        for(int i=0; i<3; ++i)
+        {
+            WakeupScope wakeup{"test"};
+            spin();
+        }
+
+        auto totals = totalsFor("test");
+        QCOMPARE(totals.wakeups, std::uint64_t{3});
+        QVERIFY(totals.cpuTime >= 15ms);
+    }
+
+    void testDisabledScope()
+    {
+        {
+            WakeupScope wakeup{nullptr};
+        }
+        QVERIFY(WakeupAccounting::snapshot().empty());
+    }
+
+    // CPU time used by a nested scope is only counted for that scope
+    void testNested()
+    {
+        {
+            WakeupScope outer{"outer"};
+            WakeupScope inner{"inner"};
+            spin();
+        }
+
+        auto outer = totalsFor("outer");
+        auto inner = totalsFor("inner");
+        QCOMPARE(outer.wakeups, std::uint64_t{1});
+        QCOMPARE(inner.wakeups, std::uint64_t{1});
+        QVERIFY(inner.cpuTime >= 5ms);
+        QVERIFY(outer.cpuTime < inner.cpuTime);
+    }
+
+    void testTimerTag()
+    {
+        int count{0};
+        kapps::core::Timer timer;
+        timer.tag("test timer");
+        timer.elapsed = [&]{++count;};
+        timer.set(10ms, true);
+
+        QTRY_COMPARE(count, 1);
+        QCOMPARE(totalsFor("test timer").wakeups, std::uint64_t{1});
+    }
+
+    void testJson()
+    {
+        {
+            WakeupScope wakeup{"json"};
+        }
+        QJsonObject json = wakeupAccountingJson();
+        QCOMPARE(json.value(QStringLiteral("json"))[QStringLiteral("wakeups")].toInteger(), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_wakeups)
+#include TEST_MOC
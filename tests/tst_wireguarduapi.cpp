@@ -222,6 +222,37 @@ private slots:
         Uapi::appendRequest(msg, dummyKey, ip6);
         QCOMPARE(msg, QByteArrayLiteral("dummy=2800::56/64\n"));
     }
+
+    // WgDevStatus is reused for status polls; clearing it must leave a valid
+    // empty device that links new peers and allowed IPs correctly.
+    void testDevStatusReuse()
+    {
+        WgDevStatus status{};
+        for(int poll = 0; poll < 3; ++poll)
+        {
+            status.clear();
+            QVERIFY(!status.device().first_peer);
+            QVERIFY(!status.device().last_peer);
+            QVERIFY(status.device().flags == 0);
+
+            wg_peer peer{};
+            peer.rx_bytes = static_cast<uint64_t>(1000 + poll);
+            status.addPeer(peer);
+            wg_allowedip ip4{};
+            ip4.family = AF_INET;
+            ip4.cidr = 0;
+            status.addAllowedIp(ip4);
+
+            const wg_peer *pPeer = status.device().first_peer;
+            QVERIFY(pPeer);
+            QCOMPARE(pPeer, status.device().last_peer);
+            QVERIFY(!pPeer->next_peer);
+            QCOMPARE(pPeer->rx_bytes, static_cast<uint64_t>(1000 + poll));
+            QVERIFY(pPeer->first_allowedip);
+            QCOMPARE(pPeer->first_allowedip, pPeer->last_allowedip);
+            QVERIFY(!pPeer->first_allowedip->next_allowedip);
+        }
+    }
 };
 
 QTEST_GUILESS_MAIN(tst_wireguarduapi)
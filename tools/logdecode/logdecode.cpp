@@ -0,0 +1,181 @@
+// Copyright (c) 2024 Private Internet Access, Inc.
+//
+// This file is part of the Private Internet Access Desktop Client.
+//
+// The Private Internet Access Desktop Client is free software: you can
+// redistribute it and/or modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The Private Internet Access Desktop Client is distributed in the hope that
+// it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the Private Internet Access Desktop Client.  If not, see
+// <https://www.gnu.org/licenses/>.
+
+#include <binarylog.h>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+void showHelp(const char *argv0)
+{
+    std::cout << "usage:" << std::endl;
+    std::cout << "  " << argv0 << " [--json] <logfile>" << std::endl;
+    std::cout << "  " << argv0 << " --help" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Decodes a binary log file (daemon.log.bin, etc.) and writes it to standard" << std::endl;
+    std::cout << "output." << std::endl;
+    std::cout << std::endl;
+    std::cout << "  --json: Write one JSON object per message instead of text log lines" << std::endl;
+    std::cout << "  --help: Show this help" << std::endl;
+}
+
+// Render a timestamp like the text log - [yyyy-MM-dd hh:mm:ss.zzz], UTC
+std::string renderTimestamp(std::int64_t timestampMs)
+{
+    std::time_t seconds = static_cast<std::time_t>(timestampMs / 1000);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    char buf[80];
+    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+                  utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour,
+                  utc.tm_min, utc.tm_sec, static_cast<int>(timestampMs % 1000));
+    return buf;
+}
+
+void writeJsonString(std::ostream &os, const std::string &value)
+{
+    os << '"';
+    for(char c : value)
+    {
+        switch(c)
+        {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if(static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    os << escape;
+                }
+                else
+                    os << c;
+                break;
+        }
+    }
+    os << '"';
+}
+
+void writeText(std::ostream &os, const BinaryLog::DecodedMessage &msg)
+{
+    char threadTag[8];
+    std::snprintf(threadTag, sizeof(threadTag), "%04x", msg.threadTag);
+
+    std::string prefix{"[" + renderTimestamp(msg.timestampMs) + "][" +
+                       threadTag + "][" + msg.category + "][" + msg.file + ":" +
+                       std::to_string(msg.line) + "][" +
+                       BinaryLog::levelName(msg.level) + "] "};
+
+    // Prefix each line, like the text log
+    std::size_t lineEnd = 0;
+    while(lineEnd < msg.message.size())
+    {
+        std::size_t lineStart = lineEnd;
+        lineEnd = msg.message.find('\n', lineEnd);
+        if(lineEnd == std::string::npos)
+            lineEnd = msg.message.size();
+        else
+            ++lineEnd;
+        os << prefix;
+        os.write(msg.message.data() + lineStart, lineEnd - lineStart);
+    }
+    os << '\n';
+}
+
+void writeJson(std::ostream &os, const BinaryLog::DecodedMessage &msg)
+{
+    os << "{\"time\":";
+    writeJsonString(os, renderTimestamp(msg.timestampMs));
+    os << ",\"timestampMs\":" << msg.timestampMs;
+    os << ",\"thread\":" << msg.threadTag;
+    os << ",\"level\":";
+    writeJsonString(os, BinaryLog::levelName(msg.level));
+    os << ",\"category\":";
+    writeJsonString(os, msg.category);
+    os << ",\"file\":";
+    writeJsonString(os, msg.file);
+    os << ",\"line\":" << msg.line;
+    os << ",\"message\":";
+    writeJsonString(os, msg.message);
+    os << "}\n";
+}
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    const char *pLogFile = nullptr;
+    for(int i=1; i<argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if(arg == "--help")
+        {
+            showHelp(argv[0]);
+            return 0;
+        }
+        else if(arg == "--json")
+            json = true;
+        else if(!pLogFile)
+            pLogFile = argv[i];
+        else
+        {
+            showHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    if(!pLogFile)
+    {
+        showHelp(argv[0]);
+        return 1;
+    }
+
+    std::ifstream logFile{pLogFile, std::ios::in | std::ios::binary};
+    if(!logFile)
+    {
+        std::cerr << "Unable to open " << pLogFile << std::endl;
+        return 1;
+    }
+    std::string data{std::istreambuf_iterator<char>{logFile}, std::istreambuf_iterator<char>{}};
+
+    BinaryLog::Decoder decoder{data.data(), data.size()};
+    BinaryLog::DecodedMessage msg;
+    while(decoder.next(msg))
+    {
+        if(json)
+            writeJson(std::cout, msg);
+        else
+            writeText(std::cout, msg);
+    }
+
+    if(decoder.error())
+    {
+        std::cerr << "Log file is truncated or invalid, decoded as much as possible" << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# Copyright (c) 2024 Private Internet Access, Inc.
+#
+# This file is part of the Private Internet Access Desktop Client.
+#
+# The Private Internet Access Desktop Client is free software: you can
+# redistribute it and/or modify it under the terms of the GNU General Public
+# License as published by the Free Software Foundation, either version 3 of
+# the License, or (at your option) any later version.
+#
+# The Private Internet Access Desktop Client is distributed in the hope that
+# it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+# warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with the Private Internet Access Desktop Client.  If not, see
+# <https://www.gnu.org/licenses/>.
+
+# Optional environment variables:
+# IPERF_PORT - port for the iperf3 server (default 5201)
+IPERF_PORT=${IPERF_PORT:-5201}
+
+# Serve one client at a time until stopped; the throughput script runs each
+# test in sequence
+exec iperf3 --server --port "$IPERF_PORT"
@@ -0,0 +1,168 @@
+#!/usr/bin/env ruby
+require_relative '../../headless_tests/src/piactl.rb'
+require 'csv'
+require 'json'
+require 'open3'
+
+# Measures tunnel throughput and CPU cost for each VPN backend and MTU setting.
+#
+# For each configuration, this connects through the daemon, runs iperf3 bulk
+# (TCP) and small-packet (UDP) tests against IPERF_SERVER through the tunnel,
+# and samples CPU time on this machine during each test.  Linux only - CPU
+# time is read from /proc, and the WireGuard kernel backend only exists on
+# Linux.
+#
+# The daemon must already be logged in.  The results are printed and written
+# as CSV; see README.md for the variables that control the run.
+
+IPERF_SERVER = ENV['IPERF_SERVER'] or abort "IPERF_SERVER must be set to the iperf3 server's address"
+IPERF_PORT = ENV['IPERF_PORT'] || '5201'
+DURATION = (ENV['DURATION'] || 10).to_i
+RESULTS = ENV['RESULTS'] || 'throughput_results.csv'
+
+# Settings applied for each backend
+BACKENDS = {
+    'wireguard-kernel' => {'method' => 'wireguard', 'wireguardUseKernel' => true},
+    'wireguard-go' => {'method' => 'wireguard', 'wireguardUseKernel' => false},
+    'openvpn-udp' => {'method' => 'openvpn', 'protocol' => 'udp'},
+    'openvpn-tcp' => {'method' => 'openvpn', 'protocol' => 'tcp'}
+}
+
+# Values of the 'mtu' setting - path MTU detection, large packets, and small
+# packets
+MTUS = {'auto' => -1, 'large' => 0, 'small' => 1250}
+
+# iperf3 arguments for each test
+TESTS = {
+    # Bulk transfer with a few parallel streams, in both directions
+    'bulk-upload' => ['-P', '4'],
+    'bulk-download' => ['-P', '4', '-R'],
+    # Small UDP packets at an unlimited rate - this measures per-packet cost
+    # rather than bandwidth
+    'small-packet' => ['-u', '-b', '0', '-l', '64']
+}
+
+# Processes whose CPU time is attributed to the backend.  The kernel backend
+# has no process; its cost shows up only in the system-wide time.
+BACKEND_PROCESSES = ['pia-daemon', 'pia-wireguard-go', 'pia-openvpn']
+
+def select(all, env_name)
+    return all unless ENV[env_name]
+    names = ENV[env_name].split(',')
+    unknown = names - all.keys
+    abort "Unknown #{env_name}: #{unknown.join(', ')} (valid: #{all.keys.join(', ')})" unless unknown.empty?
+    all.slice(*names)
+end
+
+# Busy CPU time for the whole system in seconds, including interrupt and
+# softirq time, where most of the kernel's packet processing happens
+def system_cpu_seconds
+    fields = File.readlines('/proc/stat').first.split.drop(1).map(&:to_i)
+    user, nice, system, _idle, _iowait, irq, softirq, steal = fields
+    (user + nice + system + irq + softirq + steal) / clock_ticks
+end
+
+# CPU time (user + system) in seconds for processes with the given name
+def process_cpu_seconds(name)
+    Dir.glob('/proc/[0-9]*/stat').sum do |path|
+        # Processes can exit while being listed
+        stat = File.read(path) rescue nil
+        next 0 unless stat
+        # The command name is in parentheses and may contain spaces; fields
+        # after it are space-separated
+        comm = stat[/\((.*)\)/, 1]
+        next 0 unless comm == name[0, 15]
+        fields = stat[(stat.rindex(')') + 2)..].split
+        (fields[11].to_i + fields[12].to_i) / clock_ticks
+    end
+end
+
+def clock_ticks
+    @clock_ticks ||= `getconf CLK_TCK`.to_f
+end
+
+def cpu_sample
+    sample = {'system' => system_cpu_seconds}
+    BACKEND_PROCESSES.each { |name| sample[name] = process_cpu_seconds(name) }
+    sample
+end
+
+# Run one iperf3 test and return [bits per second, bytes transferred, extra]
+def run_iperf(args)
+    command = ['iperf3', '--client', IPERF_SERVER, '--port', IPERF_PORT,
+               '--time', DURATION.to_s, '--json', *args]
+    output, status = Open3.capture2(*command)
+    result = JSON.parse(output)
+    raise "iperf3 failed: #{result['error'] || status}" unless status.success?
+
+    summary = result['end']
+    if args.include?('-u')
+        sum = summary['sum']
+        [sum['bits_per_second'], sum['bytes'], {'lost_percent' => sum['lost_percent']}]
+    else
+        # The receiver's rate is the useful throughput for TCP
+        sum = summary['sum_received']
+        [sum['bits_per_second'], sum['bytes'], {}]
+    end
+end
+
+def configure(backend_settings, mtu)
+    backend_settings.merge('mtu' => mtu).each do |setting, value|
+        PiaCtl.set_unstable(setting, value)
+    end
+end
+
+# Use a specific server if given, otherwise the configured region
+if ENV['MANUAL_SERVER_IP']
+    PiaCtl.set_unstable('manualServer', {
+        'ip' => ENV['MANUAL_SERVER_IP'],
+        'cn' => ENV['MANUAL_SERVER_CN'] || abort('MANUAL_SERVER_CN is required with MANUAL_SERVER_IP')
+    })
+    PiaCtl.set_unstable('location', 'manual')
+end
+
+backends = select(BACKENDS, 'BACKENDS')
+mtus = select(MTUS, 'MTUS')
+columns = ['backend', 'mtu', 'test', 'mbit_per_sec', 'gbit', 'system_cpu_sec',
+           'system_cpu_sec_per_gbit', *BACKEND_PROCESSES.map { |name| "#{name}_cpu_sec" },
+           'lost_percent']
+
+CSV.open(RESULTS, 'w') do |csv|
+    csv << columns
+    backends.each do |backend, settings|
+        mtus.each do |mtu_name, mtu|
+            puts "=== #{backend}, #{mtu_name} MTU ==="
+            PiaCtl.disconnect
+            configure(settings, mtu)
+            PiaCtl.connect
+
+            TESTS.each do |test, args|
+                before = cpu_sample
+                bits_per_second, bytes, extra = run_iperf(args)
+                after = cpu_sample
+                cpu = after.to_h { |name, seconds| [name, seconds - before[name]] }
+
+                gbit = bytes * 8 / 1e9
+                row = {
+                    'backend' => backend,
+                    'mtu' => mtu_name,
+                    'test' => test,
+                    'mbit_per_sec' => (bits_per_second / 1e6).round(1),
+                    'gbit' => gbit.round(3),
+                    'system_cpu_sec' => cpu['system'].round(2),
+                    'system_cpu_sec_per_gbit' => gbit > 0 ? (cpu['system'] / gbit).round(3) : nil,
+                    'lost_percent' => extra['lost_percent']&.round(2)
+                }
+                BACKEND_PROCESSES.each { |name| row["#{name}_cpu_sec"] = cpu[name].round(2) }
+
+                puts "#{test.ljust(14)} #{row['mbit_per_sec'].to_s.rjust(9)} Mbit/s  " \
+                     "#{row['system_cpu_sec_per_gbit'].to_s.rjust(7)} CPU-s/Gbit"
+                csv << columns.map { |column| row[column] }
+                csv.flush
+            end
+        end
+    end
+end
+
+PiaCtl.disconnect
+puts "Results written to #{RESULTS}"